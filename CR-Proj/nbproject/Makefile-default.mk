@@ -86,6 +86,10 @@ ifneq ($(INFORMATION_MESSAGE), )
 	@echo $(INFORMATION_MESSAGE)
 endif
 	${MAKE}  -f nbproject/Makefile-default.mk ${DISTDIR}/CR-Proj.${IMAGE_TYPE}.${OUTPUT_SUFFIX}
+	@echo "--------------------------------------"
+	@echo "User defined post-build step: [python3 ../tools/membudget.py ${DISTDIR}/CR-Proj.${IMAGE_TYPE}.map]"
+	@python3 ../tools/membudget.py ${DISTDIR}/CR-Proj.${IMAGE_TYPE}.map
+	@echo "--------------------------------------"
 
 MP_PROCESSOR_OPTION=ATSAME51J20A
 MP_LINKER_FILE_OPTION=,--script="..\src\config\default\ATSAME51J20A.ld"
@@ -8,3 +8,7 @@ CND_BASEDIR=`pwd`
 CND_ARTIFACT_DIR_default=dist/default/production
 CND_ARTIFACT_NAME_default=CR-Proj.production.hex
 CND_ARTIFACT_PATH_default=dist/default/production/CR-Proj.production.hex
+# release configuration
+CND_ARTIFACT_DIR_release=dist/release/production
+CND_ARTIFACT_NAME_release=CR-Proj.production.hex
+CND_ARTIFACT_PATH_release=dist/release/production/CR-Proj.production.hex
@@ -1,167 +1,1757 @@
 #include "actuator.h"
 #include <sam.h>
+#include <string.h>
 #include "FreeRTOS.h"
 #include "definitions.h"
 #include "task.h"
-#include <stdio.h>
-// If you completely removed the dcc_stdio from your build, remove this include.
-// Otherwise, keep it for your debug prints.
-// #include "dcc_stdio.h" 
-
-// Internal State
-static volatile bool is_up = false;
-static volatile bool is_down = false;
-
-// Internal Helpers
-static uint32_t interpolateNum(uint32_t min, uint32_t max, uint32_t number);
-static void act_off(void);
-static void act_up(void);
-static void act_down(void);
-static void act_reset(void);
-
-// Actuator Sequences
-static void act_random_drop(void);
-static void act_quick_up(void);
-static void act_violent(void);
+#include "timers.h"
+#include "irqprio.h"
+#include "rng.h"
+#include "showclock.h"
+#include "nvstore.h"
+#include "nvwrite.h"
+#include "stats.h"
+#include "wear.h"
+#include "brownout.h"
+#include "imgcheck.h"
+#include "metrics.h"
+#if ACT_CUR_SENSE
+#include "motor_sense.h"
+#endif
+#if ACT_PWM_DRIVE
+#include "motor_pwm.h"
+#endif
+#if ACT_STEPPER_DRIVE
+#include "stepper.h"
+#endif
+#include "estop.h"
+#include "log.h"
+#include "tlog.h"
+#include "cli.h"
+#include "rtos_trace.h"
+#include "irqstat.h"
+#include "tickless.h"
+#include "sound.h"
+#include "assetcache.h"
+#include "ioseq.h"
+#include "servo.h"
+#include "showsync.h"
+#include "evbus.h"
+#include "mode.h"
+#include "latbench.h"
+#include "resume.h"
+#include "replay.h"
 
-void Actuator_InitPorts(void)
+// Local step shorthand: back down to the stop from wherever the lid is
+// (a full travel at most), then release
+#define ACT_RESET             ACT_HOME(MS_PER_SECOND), ACT_OFF(0u)
+
+// Reversal gap: with the soft drive it has to fit the soft stop; a
+// stepper has no contacts to release and ramps down to its start rate
+// anyway, DIR needs microseconds
+#if ACT_STEPPER_DRIVE
+#define ACT_GAP_MS            0u
+#elif ACT_PWM_DRIVE && (MPWM_RAMP_MS > ACT_DEAD_MS)
+#define ACT_GAP_MS            MPWM_RAMP_MS
+#else
+#define ACT_GAP_MS            ACT_DEAD_MS
+#endif
+
+// A stepper move ends this long before its step's timer at the latest:
+// the timer may fire up to a tick short of its period
+#define ACT_STEP_SLACK_MS     portTICK_PERIOD_MS
+
+// ---------------------------------------------------------
+// Sequences
+// ---------------------------------------------------------
+// Lift, then SLAM_MAX slams alternating long / short, then reset. In RAM:
+// the slam count is tunable ("slams"), its loop is ACT_VIOLENT_LOOP
+#if (SLAM_MAX % 2UL) != 1UL
+#error "act_violent ends on a long slam: SLAM_MAX must be odd"
+#endif
+#define ACT_SLAM              ACT_SOUND_AT(SOUND_SLAM, ACT_SLAM_SOUND_MS)
+#define ACT_VIOLENT_LOOP      8u
+static act_step_t act_violent[] =
+{
+    ACT_SOUND(SOUND_CREAK),  ACT_UP(MS_PER_SECOND),
+    ACT_SLAM, ACT_DOWN(MS_SLAM_LONG),  ACT_UP(MS_SLAM_LONG),
+    ACT_SLAM, ACT_DOWN(MS_SLAM_SHORT), ACT_UP(MS_SLAM_SHORT),
+    ACT_LOOP(6u, SLAM_MAX / 2u),
+    ACT_SLAM, ACT_DOWN(MS_SLAM_LONG),  ACT_UP(MS_SLAM_LONG),    // odd SLAM_MAX: last long slam
+    ACT_RESET,
+    ACT_END
+};
+
+// Hold up for a random 5-15 s, then drop
+static const act_step_t act_random_drop[] =
+{
+    ACT_SOUND(SOUND_CREAK),
+    ACT_UP_RAND(MIN_DROP_MS, MAX_DROP_MS),
+    ACT_SLAM,
+    ACT_RESET,
+    ACT_END
+};
+
+static const act_step_t act_quick_up[] =
+{
+    ACT_SOUND(SOUND_CREAK),
+    ACT_UP_TRAVEL(MS_PER_SECOND),
+    ACT_RESET,
+    ACT_END
+};
+
+#if ACT_CUR_SENSE
+// Travel calibration, run unscaled: home, then time UP and DOWN to the stop
+#define ACT_CAL_PC_UP    3u             // pc after the timed steps
+#define ACT_CAL_PC_DOWN  5u
+static const act_step_t act_cal_seq[] =
+{
+    ACT_DOWN_TRAVEL(ACT_CAL_TIMEOUT_MS), ACT_OFF(500u),
+    ACT_UP_TRAVEL(ACT_CAL_TIMEOUT_MS),   ACT_OFF(500u),
+    ACT_DOWN_TRAVEL(ACT_CAL_TIMEOUT_MS), ACT_OFF(0u),
+    ACT_END
+};
+#endif
+
+#define ACT_CAL_NVKEY    NVSTORE_KEY('A', 'T', 'R', 'V')
+
+// Random-event pool, weights from actuator.h
+static const act_step_t *const act_pool[] =
+{
+    act_quick_up, act_random_drop, act_violent
+};
+static const uint16_t act_pool_weight[] =
+{
+    ACT_WEIGHT_QUICK_UP, ACT_WEIGHT_RANDOM_DROP, ACT_WEIGHT_VIOLENT
+};
+
+// ---------------------------------------------------------
+// Live tuning (cli.h)
+// ---------------------------------------------------------
+// Defaults from actuator.h. The CLI task writes them and the timer task
+// reads them, whole words each, so no lock is needed
+static uint32_t act_min_start_ms = MS_MIN_START;
+static uint32_t act_max_start_ms = MS_MAX_START;
+static uint32_t act_cooldown_ms  = ACT_PRESENCE_COOLDOWN_MS;
+static uint32_t act_slams        = SLAM_MAX;
+
+static void act_slams_changed(void)
 {
-    // Set PA20 and PA21 as outputs
-    PORT_REGS->GROUP[0].PORT_DIRSET = PIN_ACT_UP | PIN_ACT_DOWN;
-    // Ensure they start off
-    act_off();
+    act_slams |= 1u;                                    // ends on a long slam: odd only
+    act_violent[ACT_VIOLENT_LOOP].count = (uint16_t)(act_slams / 2u);
 }
 
+static const cli_param_t act_params[] =
+{
+    { "pause_min", &act_min_start_ms, CLI_U32, 1000u, 600000u, NULL,
+      "ms, shortest random pause (before pacing)" },
+    { "pause_max", &act_max_start_ms, CLI_U32, 1000u, 600000u, NULL,
+      "ms, longest random pause (before pacing)" },
+    { "cooldown",  &act_cooldown_ms,  CLI_U32, 0u,    600000u, NULL,
+      "ms, presence ignored after a sequence" },
+    { "slams",     &act_slams,        CLI_U32, 3u,    31u,     act_slams_changed,
+      "slams in the violent sequence, odd" },
+};
 
+// ---------------------------------------------------------
+// Channel table
+// ---------------------------------------------------------
+typedef struct
+{
+    uint8_t  group;         // PORT group of both relays
+    uint32_t up;            // UP relay pin mask
+    uint32_t down;          // DOWN relay pin mask
+    bool     scheduled;     // runs the random / presence schedule
+} act_chan_cfg_t;
 
+#define ACT_X_CFG(id, name, group, up, down, sched) \
+    [ACT_CH_##id] = { group, up, down, sched },
 
+static const act_chan_cfg_t act_cfg[ACT_CHANNELS] =
+{
+    SHOW_ACTUATORS(ACT_X_CFG)
+};
+
+#define ACT_X_TCC(id, name, group, up, down, sched) \
+    && (ACT_CH_##id != ACT_CH_LID || ((group) == 0u && (up) == PIN_ACT_UP && (down) == PIN_ACT_DOWN))
+
+_Static_assert(1 SHOW_ACTUATORS(ACT_X_TCC), "the LID row must be PA20 / PA21, where TCC1 drives");
+
+// Per-channel sequence, interlock and thermal state; only the timer task
+// touches it
+typedef struct
+{
+    TimerHandle_t     timer;
+    const act_step_t *seq;          // running table, NULL while waiting
+    uint8_t    pc;
+    uint16_t   loops;               // LOOP passes done so far
+    uint16_t   steps;               // steps executed, runaway guard
+    uint8_t    last;                // op last driven, for the interlock
+    bool       dt_pending;          // reversal held back by the dead time
+    uint8_t    dt_op;
+    uint32_t   dt_hold;
+    bool       travel;              // current step has ACT_ARG_TRAVEL
+    bool       snd_pending;         // SOUND step waiting for the next edge
+    uint8_t    snd_id;
+    uint16_t   snd_gain;
+    uint32_t   snd_ms;              // its delay plus, with ACT_HW_TIMING, the
+                                    // edge's offset from the pattern start
+    bool       cooling;             // a sequence has ended...
+    TickType_t end_tick;            // ...at this tick (presence cooldown)
+    bool       cue_pending;         // timer is counting down to `cued`
+    const act_step_t *cued;
+    const act_step_t *cue_seq;      // Actuator_TriggerAt() slot (any task)...
+    uint32_t   cue_at;              // ...and its show time
+
+    // Thermal budget: energised ms per direction in ACT_DUTY_BUCKETS
+    // buckets; the bucket at duty_idx started at duty_tick
+    uint32_t   duty_up[ACT_DUTY_BUCKETS];
+    uint32_t   duty_down[ACT_DUTY_BUCKETS];
+    uint8_t    duty_idx;
+    TickType_t duty_tick;
+    uint32_t   throttled;
+    uint8_t    on_op;               // relay driven since on_tick
+    TickType_t on_tick;
+
+    // Travel calibration: UP / DOWN holds x scale_q8 / 256
+    uint16_t   scale_q8[2];         // [0] up, [1] down
+    uint32_t   travel_ms[2];        // measured full travel, 0 = none
+    bool       cal_run;             // act_cal_seq is playing...
+    uint32_t   cal_ms[2];           // ...and has timed these so far
+
+    // Position model, ACT_POS_UNITS per full travel, up to the last edge
+    uint32_t   pos;
+    bool       pos_known;
+    uint32_t   step_n;              // stepper lid: the steps of the GOTO resolved, 0 = none
+} act_chan_t;
+
+static act_chan_t act_ch[ACT_CHANNELS];
+static StaticTimer_t act_timer_buf[ACT_CHANNELS];
+
+#define ACT_LID     (&act_ch[ACT_CH_LID])
+
+// ---------------------------------------------------------
+// Position model (dead reckoning)
+// ---------------------------------------------------------
+#define ACT_POS_UNITS   (ACT_POS_FULL * 1000UL)     // fine enough that rounding never adds up
+
+// Full travel in direction `op`, ms: measured, or what the tables assume;
+// on the stepper lid the length of a full-travel move
+static uint32_t act_travel(const act_chan_t *c, uint8_t op)
+{
+    uint32_t t = c->travel_ms[op == ACT_OP_DOWN];
+
+#if ACT_STEPPER_DRIVE
+    if (c == ACT_LID) return Stepper_MoveMs(STEPPER_TRAVEL_STEPS);
+#endif
+    return (t != 0u) ? t : ACT_TRAVEL_NOMINAL_MS;
+}
+
+// Move a model position by `d` units of drive `op`, clamped at the stops;
+// an unknown position becomes known once a drive makes a full travel
+static void act_pos_move(uint8_t op, uint32_t d, uint32_t *pos, bool *known)
+{
+    if (op != ACT_OP_UP && op != ACT_OP_DOWN) return;
+    if (d > ACT_POS_UNITS) d = ACT_POS_UNITS;
+    if (!*known)
+    {
+        if (d < ACT_POS_UNITS) return;
+        *known = true;
+        *pos   = (op == ACT_OP_UP) ? ACT_POS_UNITS : 0u;
+        return;
+    }
+    if (op == ACT_OP_UP) *pos = (*pos > ACT_POS_UNITS - d) ? ACT_POS_UNITS : *pos + d;
+    else                 *pos = (*pos > d) ? *pos - d : 0u;
+}
+
+// ...by `ms` of drive at the travel speed
+static void act_pos_step(const act_chan_t *c, uint8_t op, uint32_t ms, uint32_t *pos, bool *known)
+{
+    uint32_t full = act_travel(c, op);
+
+    act_pos_move(op, (ms >= full) ? ACT_POS_UNITS : (uint32_t)((uint64_t)ms * ACT_POS_UNITS / full),
+                 pos, known);
+}
+
+#if ACT_STEPPER_DRIVE
+// Steps of the stepper lid as model units
+static uint32_t act_step_units(uint32_t steps)
+{
+    return (steps >= STEPPER_TRAVEL_STEPS) ? ACT_POS_UNITS
+         : (uint32_t)((uint64_t)steps * ACT_POS_UNITS / STEPPER_TRAVEL_STEPS);
+}
+#endif
+
+// Where the channel is now, counting the drive in progress
+static void act_pos_now(const act_chan_t *c, uint32_t *pos, bool *known)
+{
+    *pos   = c->pos;
+    *known = c->pos_known;
+    if (c->on_op == ACT_OP_OFF) return;
+#if ACT_STEPPER_DRIVE
+    if (c == ACT_LID)
+    {
+        act_pos_move(c->on_op, act_step_units(Stepper_Done()), pos, known);
+        return;
+    }
+#endif
+    act_pos_step(c, c->on_op, (uint32_t)(xTaskGetTickCount() - c->on_tick) * portTICK_PERIOD_MS,
+                 pos, known);
+}
+
+// ---------------------------------------------------------
+// Thermal budget (duty-cycle accountant)
+// ---------------------------------------------------------
+// Move the window up to now, clearing buckets that have aged out
+static void act_duty_roll(act_chan_t *c)
+{
+    const TickType_t bt = pdMS_TO_TICKS(ACT_DUTY_BUCKET_MS);
+    TickType_t k = (xTaskGetTickCount() - c->duty_tick) / bt;
+
+    if (k == 0u) return;
+    c->duty_tick += k * bt;
+    if (k > ACT_DUTY_BUCKETS) k = ACT_DUTY_BUCKETS;
+    while (k-- != 0u)
+    {
+        c->duty_idx = (uint8_t)((c->duty_idx + 1u) % ACT_DUTY_BUCKETS);
+        c->duty_up[c->duty_idx]   = 0;
+        c->duty_down[c->duty_idx] = 0;
+    }
+}
+
+static void act_duty_charge(act_chan_t *c, uint8_t op, uint32_t ms)
+{
+    act_duty_roll(c);
+    if (op == ACT_OP_UP)        c->duty_up[c->duty_idx]   += ms;
+    else if (op == ACT_OP_DOWN) c->duty_down[c->duty_idx] += ms;
+    if (op != ACT_OP_OFF) Wear_Energised((act_channel_t)(c - act_ch), ms);
+}
+
+// Lid figures for status displays (metrics.h); timer task only
+static uint32_t act_triggers;
+static uint32_t act_trigger_ms;
+static volatile bool act_parked;       // Actuator_Park(): no sequence starts, no schedule
+
+static void act_publish(void)
+{
+    const act_chan_t *c = ACT_LID;
+    metrics_act_t m;
+    uint32_t on = 0;
+
+    for (uint8_t b = 0; b < ACT_DUTY_BUCKETS; b++)
+        on += c->duty_up[b] + c->duty_down[b];
+    m.duty_pct        = (uint16_t)(on * 100UL / (ACT_DUTY_BUCKET_MS * ACT_DUTY_BUCKETS));
+    m.triggers        = act_triggers;
+    m.last_trigger_ms = act_trigger_ms;
+    Metrics_PublishAct(&m);
+}
+
+// Relay change: charge the time the previous drive was energised
+static void act_duty_edge(act_chan_t *c, uint8_t op)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    if (c->on_op != ACT_OP_OFF)
+    {
+        uint32_t ms = (uint32_t)(now - c->on_tick) * portTICK_PERIOD_MS;
+
+        act_duty_charge(c, c->on_op, ms);
+#if ACT_STEPPER_DRIVE
+        // The stepper lid: a move still running ends here, the steps it made count
+        if (c == ACT_LID)
+            act_pos_move(c->on_op, act_step_units(Stepper_Halt()), &c->pos, &c->pos_known);
+        else
+#endif
+        act_pos_step(c, c->on_op, ms, &c->pos, &c->pos_known);
+    }
+    if (op != c->on_op)
+    {
+        Wear_Relay((act_channel_t)(c - act_ch), op);
+        EventBus_Publish(EVBUS_ACTUATOR, (uint8_t)(c - act_ch), op);
+    }
+    c->on_op   = op;
+    c->on_tick = now;
+    if (c == ACT_LID) act_publish();
+}
+
+// Budget left in the window, counting a drive that is still on
+static uint32_t act_duty_left(act_chan_t *c)
+{
+    uint32_t used = 0;
+
+    act_duty_roll(c);
+    for (uint8_t b = 0; b < ACT_DUTY_BUCKETS; b++)
+        used += c->duty_up[b] + c->duty_down[b];
+    if (c->on_op != ACT_OP_OFF)
+        used += (uint32_t)(xTaskGetTickCount() - c->on_tick) * portTICK_PERIOD_MS;
+    return (used < ACT_DUTY_BUDGET_MS) ? ACT_DUTY_BUDGET_MS - used : 0u;
+}
+
+// Hold of an UP / DOWN step scaled to the channel's calibrated travel
+static uint32_t act_scale(const act_chan_t *c, uint8_t op, uint32_t ms)
+{
+    if (op == ACT_OP_OFF || c->cal_run) return ms;
+    return (ms * c->scale_q8[op == ACT_OP_DOWN] + 128u) >> 8;
+}
+
+// Longest drive of a GOTO step in direction `op`: a whole travel plus the
+// end margin, within its scaled cap
+static uint32_t act_goto_max(const act_chan_t *c, const act_step_t *s, uint8_t op)
+{
+    uint32_t full = act_travel(c, op);
+    uint32_t ms   = full + full * ACT_POS_END_MARGIN_PCT / 100u;
+    uint32_t cap  = act_scale(c, op, s->ms);
+
+    return (s->ms != 0u && cap < ms) ? cap : ms;
+}
+
+// Resolve a GOTO step against the model: the drive and hold from where
+// the channel is now to the target, a stop target pressed into by the
+// end margin. With the position unknown, the nearer stop for a full travel.
+// On the stepper lid the steps are kept for the move and the hold is its length
+static void act_goto(act_chan_t *c, const act_step_t *s, uint8_t *op, uint32_t *hold)
+{
+    uint32_t target = (s->count < ACT_POS_FULL) ? s->count : ACT_POS_FULL;
+    uint32_t pos, dist;
+    bool     known;
+
+    target *= ACT_POS_UNITS / ACT_POS_FULL;
+    act_pos_now(c, &pos, &known);
+    if (!known)
+    {
+        target = (target < ACT_POS_UNITS / 2u) ? 0u : ACT_POS_UNITS;
+        pos    = ACT_POS_UNITS - target;
+    }
+    *op  = (target > pos) ? ACT_OP_UP : ACT_OP_DOWN;
+    dist = (target > pos) ? target - pos : pos - target;
+    if (dist < ACT_POS_DEADBAND * (ACT_POS_UNITS / ACT_POS_FULL))
+    {
+        *op   = ACT_OP_OFF;                 // there already
+        *hold = 0u;
+        return;
+    }
+
+#if ACT_STEPPER_DRIVE
+    if (c == ACT_LID)
+    {
+        uint32_t n   = (uint32_t)(((uint64_t)dist * STEPPER_TRAVEL_STEPS + ACT_POS_UNITS - 1u) / ACT_POS_UNITS);
+        uint32_t cap = act_goto_max(c, s, *op);
+
+        if (target == 0u || target == ACT_POS_UNITS)
+            n += STEPPER_TRAVEL_STEPS * ACT_POS_END_MARGIN_PCT / 100u;
+        if (Stepper_MoveMs(n) > cap) n = Stepper_StepsIn(cap);
+        c->step_n = n;
+        *hold     = Stepper_MoveMs(n) + ACT_STEP_SLACK_MS;
+        return;
+    }
+#endif
+
+    uint32_t full = act_travel(c, *op);
+
+    *hold = (uint32_t)(((uint64_t)dist * full + ACT_POS_UNITS - 1u) / ACT_POS_UNITS);
+    if (target == 0u || target == ACT_POS_UNITS)
+        *hold += full * ACT_POS_END_MARGIN_PCT / 100u;
+    if (*hold > act_goto_max(c, s, *op))
+        *hold = act_goto_max(c, s, *op);
+}
+
+// Worst-case energised time of a table: loops unrolled, random holds at
+// ms_max, dead time not subtracted
+static uint32_t act_cost(const act_chan_t *c, const act_step_t *seq)
+{
+    uint32_t ms = 0;
+    uint16_t loops = 0;
+    uint16_t steps = 0;
+    uint8_t  pc = 0;
+
+    while (steps++ < ACT_SEQ_MAX_STEPS * 16u && pc < ACT_SEQ_MAX_STEPS)
+    {
+        const act_step_t *s = &seq[pc];
+
+        if (s->op == ACT_OP_END || s->op > ACT_OP_GOTO) break;
+        if (s->op == ACT_OP_LOOP)
+        {
+            if (s->arg > pc) break;
+            if (++loops < s->count) pc = (uint8_t)(pc - s->arg);
+            else { loops = 0; pc++; }
+            continue;
+        }
+        if (s->op == ACT_OP_UP || s->op == ACT_OP_DOWN)
+            ms += act_scale(c, s->op, (s->ms_max > s->ms) ? s->ms_max : s->ms);
+        if (s->op == ACT_OP_GOTO)
+        {
+            uint32_t up = act_goto_max(c, s, ACT_OP_UP), down = act_goto_max(c, s, ACT_OP_DOWN);
+
+            ms += (up > down) ? up : down;
+        }
+        pc++;
+    }
+    return ms;
+}
+
+#if ACT_HW_TIMING || ESTOP_ENABLE
+// ---------------------------------------------------------
+// Lid relays on TCC1 (pattern generator overrides WO4 / WO5)
+// ---------------------------------------------------------
+#define ACT_HW_PGE      (TCC_PATT_PGE4_Msk | TCC_PATT_PGE5_Msk)
+#if ACT_STEPPER_DRIVE
+#define ACT_HW_UP       (TCC_PATT_PGV4_Msk | TCC_PATT_PGV5_Msk)    // DIR up, ENABLE
+#else
+#define ACT_HW_UP       TCC_PATT_PGV4_Msk
+#endif
+#define ACT_HW_DOWN     TCC_PATT_PGV5_Msk
+
+// One TCC1 pattern per relay op; the interlock is in the table itself
+static uint16_t act_hw_patt(uint8_t op)
+{
+    if (op == ACT_OP_UP) return ACT_HW_PGE | ACT_HW_UP;
+    if (op == ACT_OP_DOWN) return ACT_HW_PGE | ACT_HW_DOWN;
+    return ACT_HW_PGE;
+}
+
+// PA20 / PA21 to TCC1 (function F) or back to GPIO driving low
+static void act_hw_pins(bool tcc)
+{
+    if (tcc)
+    {
+        PORT_REGS->GROUP[0].PORT_PMUX[20 >> 1] = PORT_PMUX_PMUXE(5U) | PORT_PMUX_PMUXO(5U);
+        PORT_REGS->GROUP[0].PORT_PINCFG[20] |= PORT_PINCFG_PMUXEN_Msk;
+        PORT_REGS->GROUP[0].PORT_PINCFG[21] |= PORT_PINCFG_PMUXEN_Msk;
+    }
+    else
+    {
+        PORT_REGS->GROUP[0].PORT_OUTCLR = PIN_ACT_UP | PIN_ACT_DOWN;
+        PORT_REGS->GROUP[0].PORT_PINCFG[20] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+        PORT_REGS->GROUP[0].PORT_PINCFG[21] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+    }
+}
+#endif
+
+#if ESTOP_ENABLE
+// The e-stop fault (estop.h) can only force the pins while TCC1 drives
+// them, so they stay on TCC1 for good: between hardware patterns, and in
+// software timing throughout, TCC1 runs idle with a static pattern that
+// act_up() / act_down() / act_off() rewrite. The exception is a latch
+// without the fault behind it (held at power-up, or a TCC1 reset since the
+// press): the pins are parked low on GPIO then, back on TCC1 at the clear.
+#define ACT_ESTOPPED()  EStop_Latched()
+
+static void act_tcc_idle(void)
+{
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_TCC1_Msk;
+
+    TCC1_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC1_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0U) { }
+
+    TCC1_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV1024 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC1_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NFRQ;
+    EStop_TccConfig();
+    TCC1_REGS->TCC_PATT  = ACT_HW_PGE;              // both relays off
+    while (TCC1_REGS->TCC_SYNCBUSY != 0U) { }
+
+    TCC1_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    while ((TCC1_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0U) { }
+    act_hw_pins(!ACT_ESTOPPED());       // latched already: no fault to force them
+}
+
+// The lid's relay levels in software timing
+static void act_tcc_patt(uint8_t op)
+{
+    TCC1_REGS->TCC_PATT = act_hw_patt(op);
+    while ((TCC1_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_PATT_Msk) != 0U) { }
+}
+#else
+#define ACT_ESTOPPED()  false
+#endif
 
 // ---------------------------------------------------------
 // Core Relay Control (Interlocked for safety)
 // ---------------------------------------------------------
-static void act_up(void)
+static void act_off(act_chan_t *c);
+
+static void act_up(act_chan_t *c)
+{
+    const act_chan_cfg_t *cfg = &act_cfg[c - act_ch];
+
+    if (ACT_ESTOPPED()) { act_off(c); return; }     // nothing drives until the clear
+    act_duty_edge(c, ACT_OP_UP);
+#if ACT_CUR_SENSE
+    if (c == ACT_LID) MotorSense_Arm();             // blanks the inrush itself
+#endif
+#if ACT_PWM_DRIVE
+    if (c == ACT_LID) MotorPwm_Cut();               // relays switch dry
+#endif
+#if ACT_STEPPER_DRIVE
+    if (c == ACT_LID)
+        PORT_REGS->GROUP[cfg->group].PORT_OUTSET = cfg->up | cfg->down;    // DIR up, ENABLE
+    else
+#endif
+    {
+        PORT_REGS->GROUP[cfg->group].PORT_OUTCLR = cfg->down;   // Ensure down is off
+        PORT_REGS->GROUP[cfg->group].PORT_OUTSET = cfg->up;     // Turn up on
+    }
+#if ESTOP_ENABLE
+    if (c == ACT_LID) act_tcc_patt(ACT_OP_UP);
+#endif
+    if (c == ACT_LID) LATBENCH_RELAY_ON();
+#if ACT_PWM_DRIVE
+    if (c == ACT_LID) MotorPwm_RampUp();
+#endif
+}
+
+static void act_down(act_chan_t *c)
 {
-    PORT_REGS->GROUP[0].PORT_OUTCLR = PIN_ACT_DOWN; // Ensure down is off
-    is_down = false;
-    PORT_REGS->GROUP[0].PORT_OUTSET = PIN_ACT_UP;   // Turn up on
-    is_up = true;
+    const act_chan_cfg_t *cfg = &act_cfg[c - act_ch];
+
+    if (ACT_ESTOPPED()) { act_off(c); return; }
+    act_duty_edge(c, ACT_OP_DOWN);
+#if ACT_CUR_SENSE
+    if (c == ACT_LID) MotorSense_Arm();
+#endif
+#if ACT_PWM_DRIVE
+    if (c == ACT_LID) MotorPwm_Cut();
+#endif
+    PORT_REGS->GROUP[cfg->group].PORT_OUTCLR = cfg->up;     // Ensure up is off
+    PORT_REGS->GROUP[cfg->group].PORT_OUTSET = cfg->down;   // Turn down on
+#if ESTOP_ENABLE
+    if (c == ACT_LID) act_tcc_patt(ACT_OP_DOWN);
+#endif
+    if (c == ACT_LID) LATBENCH_RELAY_ON();
+#if ACT_PWM_DRIVE
+    if (c == ACT_LID) MotorPwm_RampUp();
+#endif
 }
 
-static void act_down(void)
+static void act_off(act_chan_t *c)
 {
-    PORT_REGS->GROUP[0].PORT_OUTCLR = PIN_ACT_UP;   // Ensure up is off
-    is_up = false;
-    PORT_REGS->GROUP[0].PORT_OUTSET = PIN_ACT_DOWN; // Turn down on
-    is_down = true;
+    const act_chan_cfg_t *cfg = &act_cfg[c - act_ch];
+
+    act_duty_edge(c, ACT_OP_OFF);
+#if ACT_CUR_SENSE
+    if (c == ACT_LID) MotorSense_Disarm();
+#endif
+#if ACT_PWM_DRIVE
+    // Soft stop: the relays open once it has ramped out (act_ev_pwm_off)
+    if (c == ACT_LID && MotorPwm_RampDown()) return;
+#endif
+    PORT_REGS->GROUP[cfg->group].PORT_OUTCLR = cfg->up | cfg->down;
+#if ESTOP_ENABLE
+    if (c == ACT_LID) act_tcc_patt(ACT_OP_OFF);
+#endif
 }
 
-static void act_off(void)
+#if ACT_STEPPER_DRIVE
+// The stepper lid's move for a drive step: a GOTO's steps, else the
+// longest move that fits the hold, cut at the stop (plus the end margin)
+// when the position is known. DIR and ENABLE are already set
+static void act_step_go(act_chan_t *c, uint8_t op, uint32_t hold)
 {
-    PORT_REGS->GROUP[0].PORT_OUTCLR = PIN_ACT_UP;
-    PORT_REGS->GROUP[0].PORT_OUTCLR = PIN_ACT_DOWN;
-    is_up = false;
-    is_down = false;
+    uint32_t n = (c->step_n != 0u) ? c->step_n
+               : Stepper_StepsIn((hold > ACT_STEP_SLACK_MS) ? hold - ACT_STEP_SLACK_MS : 0u);
+
+    c->step_n = 0u;
+    if (ACT_ESTOPPED()) return;
+    if (c->pos_known)
+    {
+        uint32_t left = (op == ACT_OP_UP) ? ACT_POS_UNITS - c->pos : c->pos;
+        uint32_t cap  = (uint32_t)((uint64_t)left * STEPPER_TRAVEL_STEPS / ACT_POS_UNITS)
+                      + STEPPER_TRAVEL_STEPS * ACT_POS_END_MARGIN_PCT / 100u;
+
+        if (n > cap) n = cap;
+    }
+    (void)Stepper_Move(n);
 }
+#endif
 
-static void act_reset(void)
+void Actuator_InitPorts(void)
 {
-    act_down();
-    vTaskDelay(pdMS_TO_TICKS(MS_PER_SECOND));
-    act_off();
+#if ESTOP_ENABLE
+    act_tcc_idle();                 // lid pins on TCC1 before anything drives them
+#endif
+    for (uint8_t i = 0; i < ACT_CHANNELS; i++)
+    {
+        // Relay pins as outputs, starting off
+        PORT_REGS->GROUP[act_cfg[i].group].PORT_DIRSET = act_cfg[i].up | act_cfg[i].down;
+        act_ch[i].last  = ACT_OP_OFF;
+        act_ch[i].on_op = ACT_OP_OFF;
+        act_off(&act_ch[i]);
+    }
 }
 
+#if RESUME_ENABLE
+// The lid's part of the warm-resume snapshot (resume.h), timer task only
+static TickType_t act_resume_due;               // end of the pause as last armed, 0 = none
+static uint8_t    act_resume_patt = RESUME_NONE;
+static void act_resume_save(void);
+#endif
+
 // ---------------------------------------------------------
-// Sequences
+// Sequence state machine (runs in the timer service task)
+// ---------------------------------------------------------
+// Re-arm the channel's one-shot timer; from the timer task itself, so never block
+static void act_schedule(act_chan_t *c, uint32_t ms)
+{
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+
+    if (ticks == 0u) ticks = 1u;
+    (void)xTimerChangePeriod(c->timer, ticks, 0);
+#if RESUME_ENABLE
+    if (c == ACT_LID)
+    {
+        // A pause, not a step hold or a cue countdown; 0 is kept for none
+        act_resume_due = (act_resume_patt == RESUME_NONE && !c->cue_pending)
+                       ? ((xTaskGetTickCount() + ticks) | 1u) : 0u;
+        act_resume_save();
+    }
+#endif
+}
+
+// Cue the SOUND step held for this edge, `at_ms` after the moment
+static void act_sound(act_chan_t *c, uint32_t at_ms)
+{
+    if (!c->snd_pending) return;
+    c->snd_pending = false;
+    (void)Sound_Cue(c->snd_id, c->snd_gain, c->snd_ms + at_ms);
+}
+
+// Next drive step of the running table: its op (UP / DOWN / OFF) and hold
+// time, with loops and random ranges resolved; a SOUND step on the way is
+// held for act_sound(). False at END or on a malformed table.
+static bool act_next(act_chan_t *c, uint8_t *op, uint32_t *hold)
+{
+    while (c->steps < ACT_SEQ_MAX_STEPS * 16u && c->pc < ACT_SEQ_MAX_STEPS)
+    {
+        const act_step_t *s = &c->seq[c->pc];
+
+        c->steps++;
+        if (s->op == ACT_OP_END || s->op > ACT_OP_GOTO) return false;
+        if (s->op == ACT_OP_SOUND)
+        {
+            act_sound(c, 0u);                   // two on one edge: both now
+            c->snd_pending = true;
+            c->snd_id   = s->arg;
+            c->snd_gain = s->count;
+            c->snd_ms   = s->ms;
+            c->pc++;
+            continue;
+        }
+        if (s->op == ACT_OP_LOOP)
+        {
+            if (s->arg > c->pc) return false;   // jumps before the start
+            if (++c->loops < s->count)
+            {
+                c->pc = (uint8_t)(c->pc - s->arg);
+            }
+            else
+            {
+                c->loops = 0;
+                c->pc++;
+            }
+            continue;
+        }
+
+        *op   = s->op;
+        *hold = s->ms;
+        c->travel = (s->arg & ACT_ARG_TRAVEL) != 0u;
+        if (s->op == ACT_OP_GOTO)
+        {
+            act_goto(c, s, op, hold);           // already in real ms
+            c->pc++;
+            return true;
+        }
+        if (s->ms_max > s->ms)
+        {
+            *hold = Rng_Map(Rng_Next32(), s->ms, s->ms_max);
+            REPLAY_DECIDE(REPLAY_HOLD, (uint8_t)(c - act_ch), *hold);
+        }
+        *hold = act_scale(c, s->op, *hold);
+        c->pc++;
+        return true;
+    }
+    return false;
+}
+
+// act_next() with the reversal interlock: UP straight after DOWN (or the
+// reverse) first gets ACT_GAP_MS of both relays off, taken out of the
+// new step's hold so the rhythm is unchanged
+static bool act_next_interlocked(act_chan_t *c, uint8_t *op, uint32_t *hold)
+{
+    if (c->dt_pending)
+    {
+        c->dt_pending = false;
+        *op   = c->dt_op;
+        *hold = c->dt_hold;
+    }
+    else
+    {
+        if (!act_next(c, op, hold)) return false;
+
+        if (ACT_GAP_MS != 0u && *op != ACT_OP_OFF && c->last != ACT_OP_OFF && *op != c->last)
+        {
+            c->dt_pending = true;
+            c->dt_op   = *op;
+            c->dt_hold = (*hold > ACT_GAP_MS) ? *hold - ACT_GAP_MS : 1u;
+            *op   = ACT_OP_OFF;
+            *hold = ACT_GAP_MS;
+        }
+    }
+    c->last = *op;
+    return true;
+}
+
+// Execute steps up to the next hold; returns its length, or 0 once the
+// table has ended (or was malformed) and the relays are off
+static uint32_t act_advance(act_chan_t *c)
+{
+    uint8_t  op;
+    uint32_t hold;
+
+    while (act_next_interlocked(c, &op, &hold))
+    {
+        switch (op) {
+            case ACT_OP_UP:   act_up(c);   break;
+            case ACT_OP_DOWN: act_down(c); break;
+            default:          act_off(c);  break;
+        }
+#if ACT_STEPPER_DRIVE
+        if (c == ACT_LID && op != ACT_OP_OFF) act_step_go(c, op, hold);
+#endif
+        if (!c->dt_pending) act_sound(c, 0u);  // with the step, not its gap
+        if (hold != 0u) return hold;
+    }
+
+    act_off(c);
+    act_sound(c, 0u);
+    c->seq = NULL;
+    return 0;
+}
+
+#if ACT_HW_TIMING
+// ---------------------------------------------------------
+// Hardware-timed patterns (TCC1 pattern generator, lid only)
+// ---------------------------------------------------------
+// The whole table is resolved up front into segments of (relay lines,
+// duration). TCC1 runs in normal-frequency mode with PER = segment length;
+// PATT overrides WO4 (PA20, up) and WO5 (PA21, down) with the segment's
+// levels. The next segment goes into PERBUF / PATTBUF, which the hardware
+// takes over exactly at the overflow, so the ISR only has to run some time
+// within the current segment and scheduling cannot move an edge.
+typedef struct
+{
+    uint16_t patt;      // TCC_PATT: enables + levels
+    uint32_t per;       // TCC_PER: counts - 1
+} act_hw_seg_t;
+
+static act_hw_seg_t act_hw_seg[ACT_HW_MAX_SEGS];
+static uint8_t act_hw_count = 0;
+static volatile uint8_t act_hw_pos = 0;         // segment on the pins
+
+static void act_ev_hw_done(void *unused0, uint32_t unused1);
+
+static void act_hw_stop(void)
+{
+    TCC1_REGS->TCC_INTENCLR = TCC_INTENCLR_OVF_Msk;
+#if ESTOP_ENABLE
+    // TCC1 runs on with both relays off, a latched e-stop fault kept
+    TCC1_REGS->TCC_PATTBUF = ACT_HW_PGE;
+    act_tcc_patt(ACT_OP_OFF);
+#else
+    act_hw_pins(false);
+    TCC1_REGS->TCC_CTRLA &= ~TCC_CTRLA_ENABLE_Msk;
+    while ((TCC1_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0U) { }
+#endif
+}
+
+// A pattern is playing: its overflow interrupt is on only meanwhile
+static bool act_hw_busy(void)
+{
+    return (TCC1_REGS->TCC_INTENSET & TCC_INTENSET_OVF_Msk) != 0U;
+}
+
+// Resolve the lid's running table into segments; false if it drives nothing
+static bool act_hw_compile(act_chan_t *c)
+{
+    uint8_t  op;
+    uint32_t hold;
+    uint32_t at = 0;                    // ms from the pattern start
+    uint8_t  prev = ACT_OP_OFF;
+
+    act_hw_count = 0;
+    while (act_hw_count < ACT_HW_MAX_SEGS && act_next_interlocked(c, &op, &hold))
+    {
+        if (!c->dt_pending) act_sound(c, at);  // cued now, sample-timed to its edge
+        if (hold == 0u) continue;       // superseded at once
+        if (hold > ACT_HW_MAX_MS) hold = ACT_HW_MAX_MS;
+        at += hold;
+
+        act_duty_charge(c, op, hold);   // relays are never read back: charge up front
+        act_pos_step(c, op, hold, &c->pos, &c->pos_known);     // so the next GOTO starts here
+        if (op != prev) Wear_Relay(ACT_CH_LID, op);
+        prev = op;
+        act_hw_seg[act_hw_count].patt = act_hw_patt(op);
+        act_hw_seg[act_hw_count].per  = (hold * 1875u + 8u) / 16u - 1u;    // 117.1875 counts/ms
+        act_hw_count++;
+    }
+    act_sound(c, at);
+    c->seq = NULL;
+    return act_hw_count != 0u;
+}
+
+static void act_hw_start(void)
+{
+    // TCC1 shares GCLK channel 25 (GCLK0, 120 MHz) with TCC0; /1024 -> 117.1875 kHz
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_TCC1_Msk;
+
+    TCC1_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC1_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0U) { }
+
+    TCC1_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV1024 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC1_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NFRQ;
+#if ESTOP_ENABLE
+    EStop_TccConfig();
+#endif
+    TCC1_REGS->TCC_PATT  = act_hw_seg[0].patt;
+    TCC1_REGS->TCC_PER   = act_hw_seg[0].per;
+    if (act_hw_count > 1u)
+    {
+        TCC1_REGS->TCC_PATTBUF = act_hw_seg[1].patt;
+        TCC1_REGS->TCC_PERBUF  = act_hw_seg[1].per;
+    }
+    while (TCC1_REGS->TCC_SYNCBUSY != 0U) { }
+
+    act_hw_pos = 0;
+    TCC1_REGS->TCC_INTFLAG  = TCC_INTFLAG_OVF_Msk;
+    TCC1_REGS->TCC_INTENSET = TCC_INTENSET_OVF_Msk;
+    NVIC_SetPriority(TCC1_OTHER_IRQn, IRQ_PRIO_ACTUATOR);
+    NVIC_EnableIRQ(TCC1_OTHER_IRQn);
+
+    TCC1_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    while ((TCC1_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0U) { }
+#if ESTOP_ENABLE
+    // The reset above cleared the fault: a press meanwhile is only in the
+    // latch, so the pins stay parked low until the clear
+    if (ACT_ESTOPPED())
+    {
+        act_hw_pins(false);
+        taskENTER_CRITICAL();
+        act_hw_stop();
+        taskEXIT_CRITICAL();
+        return;
+    }
+#endif
+    act_hw_pins(true);              // pattern already on the outputs, no glitch
+    LATBENCH_RELAY_ON();
+}
+
+// Overflow: the buffered segment just took over; queue the one after it
+void TCC1_OTHER_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+    uint8_t pos;
+
+    IRQSTAT_ENTER(IRQSTAT_ACTUATOR);
+    RTOS_TRACE_ISR_ENTER();
+    TCC1_REGS->TCC_INTFLAG = TCC_INTFLAG_OVF_Msk;
+    pos = (uint8_t)(act_hw_pos + 1u);
+    act_hw_pos = pos;
+
+    if (pos + 1u < act_hw_count)
+    {
+        TCC1_REGS->TCC_PATTBUF = act_hw_seg[pos + 1u].patt;
+        TCC1_REGS->TCC_PERBUF  = act_hw_seg[pos + 1u].per;
+    }
+    else if (pos >= act_hw_count)
+    {
+        act_hw_stop();              // last segment has ended
+        (void)xTimerPendFunctionCallFromISR(act_ev_hw_done, NULL, 0u, &woken);
+    }
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_ACTUATOR);
+    portYIELD_FROM_ISR(woken);
+}
+#endif /* ACT_HW_TIMING */
+
+// ---------------------------------------------------------
+// Presence pacing
 // ---------------------------------------------------------
-static void act_violent(void)
+#if ACT_PACE_BUSY_Q8 > ACT_PACE_IDLE_Q8
+#error "ACT_PACE_BUSY_Q8 must not exceed ACT_PACE_IDLE_Q8"
+#endif
+
+// Arrival ticks, newest at act_pace_head; more than ACT_PACE_BUSY_ARRIVALS
+// per window saturates the pace anyway. Timer task only, except
+// Actuator_GetPace().
+static TickType_t act_pace_arr[ACT_PACE_BUSY_ARRIVALS];
+static uint8_t    act_pace_head;
+static uint8_t    act_pace_n;
+static bool       act_pace_present;
+static TickType_t act_pace_since;       // arrival of the visitor present now
+static uint32_t   act_pace_dwell;       // average dwell ms, 0 = none yet
+
+static uint32_t act_pace_arrivals(TickType_t now)
+{
+    uint32_t n = 0;
+
+    for (uint8_t i = 0; i < act_pace_n; i++)
+        if ((now - act_pace_arr[i]) < pdMS_TO_TICKS(ACT_PACE_WINDOW_MS)) n++;
+    return n;
+}
+
+static void act_pace_edge(bool detected)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    if (detected)
+    {
+        // A lost falling edge (queue full) just restarts the visit
+        act_pace_head = (uint8_t)((act_pace_head + 1u) % ACT_PACE_BUSY_ARRIVALS);
+        act_pace_arr[act_pace_head] = now;
+        if (act_pace_n < ACT_PACE_BUSY_ARRIVALS) act_pace_n++;
+        act_pace_present = true;
+        act_pace_since   = now;
+        return;
+    }
+    if (!act_pace_present) return;
+
+    uint32_t dwell = (uint32_t)((now - act_pace_since) * portTICK_PERIOD_MS);
+
+    act_pace_present = false;
+    if (act_pace_dwell == 0u) act_pace_dwell = dwell;
+    else act_pace_dwell = act_pace_dwell - (act_pace_dwell >> ACT_PACE_DWELL_SHIFT) +
+                          (dwell >> ACT_PACE_DWELL_SHIFT);
+}
+
+#if RESUME_ENABLE
+_Static_assert(sizeof(TickType_t) == sizeof(uint32_t), "resume_lid_t keeps ticks as words");
+
+// Pattern, step, pause and pacing into the backup RAM snapshot
+static void act_resume_save(void)
 {
-    act_up();
-    vTaskDelay(pdMS_TO_TICKS(MS_PER_SECOND));
+    resume_lid_t r;
+
+    r.due        = act_resume_due;
+    r.pace_dwell = act_pace_dwell;
+    memcpy(r.pace_arr, act_pace_arr, sizeof(r.pace_arr));
+    r.pace_head  = act_pace_head;
+    r.pace_n     = act_pace_n;
+    r.patt       = act_resume_patt;
+    r.pc         = ACT_LID->pc;
+    Resume_SaveLid(&r);
+}
 
-    for (int count = 0; count < SLAM_MAX; count++)
+// The snapshot's pacing back in place; the ms before the lid's first pattern
+static uint32_t act_resume(const resume_lid_t *r)
+{
+    memcpy(act_pace_arr, r->pace_arr, sizeof(act_pace_arr));
+    act_pace_head  = (uint8_t)(r->pace_head % ACT_PACE_BUSY_ARRIVALS);
+    act_pace_n     = (r->pace_n < ACT_PACE_BUSY_ARRIVALS) ? r->pace_n : (uint8_t)ACT_PACE_BUSY_ARRIVALS;
+    act_pace_dwell = r->pace_dwell;
+
+    // A pattern cut by the reset is not replayed: the lid dropped with the relays
+    if (r->patt != RESUME_NONE)
     {
-        uint32_t timeMod = (count % 2 == 0) ? MS_SLAM_LONG : MS_SLAM_SHORT;
-        
-        act_down();
-        vTaskDelay(pdMS_TO_TICKS(timeMod));
-        
-        act_up();
-        vTaskDelay(pdMS_TO_TICKS(timeMod));
+        LOG_INFO("Actuator pattern %u cut at step %u, next after the cooldown",
+                 (unsigned)r->patt, (unsigned)r->pc);
+        return act_cooldown_ms;
     }
-    act_reset();
+    if (r->due != 0u) return r->due * portTICK_PERIOD_MS;
+    return ACT_BOOT_DELAY_MS;
 }
+#endif
 
-static void act_random_drop(void)
+// Random pause range for the current room activity
+static void act_pace_range(uint32_t *lo, uint32_t *hi)
 {
-    // Grab a true random number from the hardware
-    uint32_t randomNumber = TRNG_ReadData();
-    
-    act_up();
-    vTaskDelay(pdMS_TO_TICKS(interpolateNum(MIN_DROP_MS, MAX_DROP_MS, randomNumber)));
-    act_reset();
+    uint32_t act = act_pace_arrivals(xTaskGetTickCount()) * 256u / ACT_PACE_BUSY_ARRIVALS;
+    uint32_t q8  = ACT_PACE_IDLE_Q8 - (ACT_PACE_IDLE_Q8 - ACT_PACE_BUSY_Q8) * act / 256u;
+
+    *lo = (uint32_t)(((uint64_t)act_min_start_ms * q8) >> 8);
+    *hi = (uint32_t)(((uint64_t)act_max_start_ms * q8) >> 8);
+    if (act_pace_present && act_pace_dwell != 0u && *hi > act_pace_dwell / 2u)
+        *hi = act_pace_dwell / 2u;
+    if (*hi < ACT_PACE_FLOOR_MS) *hi = ACT_PACE_FLOOR_MS;
+    if (*lo < ACT_PACE_FLOOR_MS) *lo = ACT_PACE_FLOOR_MS;
+    if (*lo > *hi) *lo = *hi;
 }
 
-static void act_quick_up(void)
+static uint32_t act_pace_wait(void)
 {
-    act_up();
-    vTaskDelay(pdMS_TO_TICKS(MS_PER_SECOND));
-    act_reset();
+    uint32_t lo, hi;
+
+    act_pace_range(&lo, &hi);
+    return Rng_Map(Rng_Next32(), lo, hi);
 }
 
-static uint32_t interpolateNum(uint32_t min, uint32_t max, uint32_t number)
+// Someone arrived while the lid waits: a pause drawn for an emptier room
+// is redrawn at the current pace
+static void act_pace_hurry(act_chan_t *c)
 {
-    uint32_t out = number;
-    if (out > max) {
-        while (out > max) out = out >> 1;
-        if (out < min) out = min;
-    } else if (out < min) {
-        while (out < min) out = out << 1;
-        if (out > max) out = max;
+    uint32_t lo, hi;
+
+    if (c->seq != NULL || c->cue_pending || xTimerIsTimerActive(c->timer) == pdFALSE)
+        return;
+    act_pace_range(&lo, &hi);
+
+    TickType_t left = xTimerGetExpiryTime(c->timer) - xTaskGetTickCount();
+    if (left > pdMS_TO_TICKS(hi))
+    {
+        uint32_t ms = Rng_Map(Rng_Next32(), lo, hi);
+
+        REPLAY_DECIDE(REPLAY_HURRY, (uint8_t)(c - act_ch), ms);
+        act_schedule(c, ms);
     }
-    return out;
 }
 
 // ---------------------------------------------------------
-// Main RTOS Task
+// Travel calibration
 // ---------------------------------------------------------
-void Actuator_Task(void *pvParameters)
+// Scale every UP / DOWN hold to measured full travel (plus margin)
+static void act_cal_apply(act_chan_t *c, uint32_t up_ms, uint32_t down_ms)
 {
-    uint32_t act_index;
-    uint32_t randomNumber;
+    const uint32_t t[2] = { up_ms, down_ms };
+
+    for (uint8_t d = 0; d < 2u; d++)
+    {
+        c->travel_ms[d] = t[d];
+        c->scale_q8[d]  = (uint16_t)((t[d] * (100u + ACT_CAL_MARGIN_PCT) * 256u +
+                                      ACT_TRAVEL_NOMINAL_MS * 50u) / (ACT_TRAVEL_NOMINAL_MS * 100u));
+    }
+}
 
-    // Initial boot delay (15 seconds)
-    vTaskDelay(pdMS_TO_TICKS(MS_PER_SECOND * 15));
+static bool act_cal_plausible(uint32_t ms)
+{
+    return ms >= ACT_CAL_MIN_MS && ms < ACT_CAL_TIMEOUT_MS;
+}
 
-    while (1)
+static void act_cal_load(act_chan_t *c)
+{
+    uint32_t rec[NVSTORE_WORDS];
+
+    if (NvStore_Load(ACT_CAL_NVKEY, rec) && act_cal_plausible(rec[0]) && act_cal_plausible(rec[1]))
+        act_cal_apply(c, rec[0], rec[1]);
+}
+
+#if ACT_CUR_SENSE
+// act_cal_seq has ended (or was aborted): keep the result if both
+// travels reached their stop
+static void act_cal_finish(act_chan_t *c)
+{
+    uint32_t rec[NVSTORE_WORDS] = { c->cal_ms[0], c->cal_ms[1] };
+
+    c->cal_run = false;
+    if (!act_cal_plausible(rec[0]) || !act_cal_plausible(rec[1]))
     {
-        // 1. Pick a sequence using the hardware TRNG
-        act_index = TRNG_ReadData();
-        #ifndef NDEBUG
-            printf("Actuator Sequence done start\n");
-        #endif
-        
+        LOG_WARN("Actuator calibration failed (%lu / %lu ms)", rec[0], rec[1]);
+        return;
+    }
+    act_cal_apply(c, rec[0], rec[1]);
+    (void)NvWrite_Post(ACT_CAL_NVKEY, rec);     // written between frames, not here in the timer task
+    LOG_INFO("Actuator travel up %lu ms, down %lu ms", rec[0], rec[1]);
+}
+#endif
 
-        if (act_index < 0x7FFFFFFFUL) act_index = 1;
-        else if (act_index < 0XD5555554UL) act_index = 0;
-        else act_index = 2;
+// Sequence over: the lid idles until the next random event, other
+// channels until they are triggered again
+static void act_idle(act_chan_t *c)
+{
+#if ACT_CUR_SENSE
+    if (c->cal_run) act_cal_finish(c);
+#endif
+    c->cooling  = true;
+    c->end_tick = xTaskGetTickCount();
+    EventBus_Publish(EVBUS_ACTUATOR, (uint8_t)(c - act_ch), ACT_OP_END);
+    if (c == ACT_LID)
+    {
+        EventBus_SetState(EVBUS_STATE_LID_BUSY, false);
+        Mode_ScareOver(act_cooldown_ms);        // presence ignored as long
+#if RESUME_ENABLE
+        act_resume_patt = RESUME_NONE;
+        act_resume_due  = 0u;                   // until the next pause is armed
+        act_resume_save();
+#endif
+    }
+    if (!act_cfg[c - act_ch].scheduled || act_parked || ACT_ESTOPPED()) return;
+
+    uint32_t randomNumber = act_pace_wait();
+
+    REPLAY_DECIDE(REPLAY_PACE, (uint8_t)(c - act_ch), randomNumber);
+
+    LOG_DEBUG("Actuator Sequence done next %lu ms", (unsigned long)randomNumber);
+    act_schedule(c, randomNumber);
+}
 
+// A sequence is being played (software steps or the TCC1 pattern)
+static bool act_running(act_chan_t *c)
+{
+#if ACT_HW_TIMING
+    if (c == ACT_LID)
+        return act_hw_busy();
+#endif
+    return c->seq != NULL;
+}
+
+// Standby would stop TCC1, the PWM and the step timing mid-sequence
+static bool act_tickless_veto(void)
+{
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+        if (act_running(&act_ch[i])) return true;
+    return false;
+}
+
+// Pick a built-in sequence among those the lid's thermal budget allows;
+// NULL (counted as throttled) if none fits, NULL in a brown-out, parked or
+// before the image is verified
+static const act_step_t *act_pick(act_chan_t *c)
+{
+    const uint8_t n = (uint8_t)(sizeof(act_pool_weight) / sizeof(act_pool_weight[0]));
+    uint16_t weight[sizeof(act_pool_weight) / sizeof(act_pool_weight[0])];
+    uint32_t left = act_duty_left(c);
+    bool     any  = false;
 
-        // 2. Execute sequence (These functions block internally via vTaskDelay)
-        switch(act_index) {
-            case 0: act_random_drop(); break;
-            case 1: act_quick_up();    break;
-            case 2: act_violent();     break;
-            default: act_reset();      break;
+    if (Brownout_Active() || act_parked || !ImgCheck_Ok()) return NULL;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        weight[i] = (act_cost(c, act_pool[i]) <= left) ? act_pool_weight[i] : 0u;
+        any = any || (weight[i] != 0u);
+    }
+    if (!any)
+    {
+        c->throttled++;
+        return NULL;
+    }
+    uint8_t pick = Rng_Weighted(weight, n);
+
+    REPLAY_DECIDE(REPLAY_POOL, (uint8_t)(c - act_ch), pick);
+    return act_pool[pick];
+}
+
+// An explicit table fits the thermal budget (counted as throttled if not);
+// nothing fits a brown-out, a parked actuator or an image not verified (imgcheck.h)
+static bool act_fits(act_chan_t *c, const act_step_t *seq)
+{
+    if (Brownout_Active() || act_parked || !ImgCheck_Ok()) return false;
+    if (act_cost(c, seq) <= act_duty_left(c)) return true;
+    c->throttled++;
+    return false;
+}
+
+// Every clip the table cues into the asset cache, ahead of its SOUND steps
+static void act_prefetch(const act_step_t *seq)
+{
+    for (uint8_t i = 0; i < ACT_SEQ_MAX_STEPS && seq[i].op != ACT_OP_END; i++)
+        if (seq[i].op == ACT_OP_SOUND) AssetCache_PrefetchSound(seq[i].arg);
+}
+
+static void act_begin(act_chan_t *c, const act_step_t *seq)
+{
+    uint32_t hold;
+
+    LOG_DEBUG("Actuator Sequence done start");
+    if (c == ACT_LID)
+    {
+        act_triggers++;
+        Wear_Scare();
+        act_trigger_ms = (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+        if (act_trigger_ms == 0u) act_trigger_ms = 1u;      // 0 = none yet
+        TLOG("act: lid trigger %u at %u ms", act_triggers, act_trigger_ms);
+        EventBus_SetState(EVBUS_STATE_LID_BUSY, true);
+        Mode_Scare();
+#if RESUME_ENABLE
+        act_resume_patt = RESUME_OTHER;
+        for (uint8_t i = 0; i < sizeof(act_pool) / sizeof(act_pool[0]); i++)
+            if (seq == act_pool[i]) act_resume_patt = i;
+        act_resume_due = 0u;
+        act_resume_save();
+#endif
+    }
+#if ACT_HW_TIMING
+    if (c == ACT_LID)
+    {
+        taskENTER_CRITICAL();       // masks the TCC1 ISR
+        act_hw_stop();
+        taskEXIT_CRITICAL();
+    }
+#endif
+    act_off(c);
+    act_prefetch(seq);
+    c->cue_pending = false;
+    c->seq   = seq;
+    c->pc    = 0;
+    c->loops = 0;
+    c->steps = 0;
+    c->last  = ACT_OP_OFF;
+    c->dt_pending = false;
+    c->snd_pending = false;
+#if ACT_CUR_SENSE
+    c->cal_run = (seq == act_cal_seq);
+    c->cal_ms[0] = 0;
+    c->cal_ms[1] = 0;
+#endif
+
+#if ACT_HW_TIMING
+    if (c == ACT_LID)
+    {
+        if (!ACT_ESTOPPED() && act_hw_compile(c))
+        {
+            act_hw_start();         // act_ev_hw_done() follows the last segment
+            return;
+        }
+        act_idle(c);
+        return;
+    }
+#endif
+    hold = act_advance(c);
+    if (hold != 0u) act_schedule(c, hold);
+    else act_idle(c);
+}
+
+// A cue is due: start `seq` (NULL = a random pick on a scheduled channel)
+// if the budget allows, otherwise back to the schedule
+static void act_cue_due(act_chan_t *c, const act_step_t *seq)
+{
+    EventBus_Publish(EVBUS_CUE, (uint8_t)(c - act_ch), ShowClock_Now());
+    if (seq == NULL) seq = act_cfg[c - act_ch].scheduled ? act_pick(c) : NULL;
+    else if (!act_fits(c, seq)) seq = NULL;
+    if (seq != NULL) act_begin(c, seq);
+    else act_idle(c);
+}
+
+static void act_timer_cb(TimerHandle_t timer)
+{
+    act_chan_t *c = &act_ch[(uintptr_t)pvTimerGetTimerID(timer)];
+
+    if (c->cue_pending)
+    {
+        c->cue_pending = false;                 // cue time reached
+        act_cue_due(c, c->cued);
+        return;
+    }
+    if (c->seq == NULL)
+    {
+        // Random wait is over; on a sync network the master scares the room
+        if (c == ACT_LID && ShowSync_Following())
+        {
+            act_idle(c);
+            return;
         }
+        if (c == ACT_LID && ShowSync_Scare()) return;
+
+        const act_step_t *seq = act_pick(c);
+
+        if (seq != NULL) act_begin(c, seq);
+        else act_schedule(c, ACT_DUTY_BUCKET_MS);   // over budget: retry as it ages out
+        return;
+    }
+
+    uint32_t hold = act_advance(c);
+    if (hold != 0u) act_schedule(c, hold);
+    else act_idle(c);
+}
+
+// Events from other tasks, serialised with the timer callbacks; the
+// channel travels in the 32-bit parameter
+static void act_ev_trigger(void *arg, uint32_t ch)
+{
+    act_chan_t *c = &act_ch[ch];
+    const act_step_t *seq = (const act_step_t *)arg;
+
+    if (seq == NULL) seq = act_cfg[ch].scheduled ? act_pick(c) : NULL;
+    else if (!act_fits(c, seq)) seq = NULL;
+    if (seq != NULL) act_begin(c, seq);
+}
+
+static void act_ev_presence(void *unused, uint32_t detected)
+{
+    act_chan_t *c = ACT_LID;
 
-        // 3. Calculate next event time using the hardware TRNG
-        randomNumber = TRNG_ReadData();
-        randomNumber = interpolateNum(MS_MIN_START, MS_MAX_START, randomNumber);
-        #ifndef NDEBUG
-            printf("Actuator Sequence done next %lu ms\n", randomNumber);
-        #endif
-        
-        // 4. Sleep the task until the next event
-        vTaskDelay(pdMS_TO_TICKS(randomNumber));
-    }
-}
\ No newline at end of file
+    (void)unused;
+    act_pace_edge(detected != 0u);
+#if RESUME_ENABLE
+    act_resume_save();
+#endif
+    Stats_Edge(detected != 0u);
+    Mode_Presence(detected != 0u);
+    if (detected == 0u) return;
+
+    if (act_running(c) || c->cue_pending) return;
+    if (c->cooling &&
+        (xTaskGetTickCount() - c->end_tick) < pdMS_TO_TICKS(act_cooldown_ms))
+    {
+        act_pace_hurry(c);
+        return;
+    }
+
+    if (ShowSync_Scare()) return;           // the whole room, on a sync network
+
+    const act_step_t *seq = act_pick(c);
+    if (seq != NULL) act_begin(c, seq);
+}
+
+#if ACT_CUR_SENSE
+// Lid motor current left its running window: the actuator is at a stop
+static void act_ev_endstop(void *unused, uint32_t code)
+{
+    act_chan_t *c = ACT_LID;
+
+    (void)unused;
+    (void)code;
+
+    // Stale if the drive has changed since (a new one is still blanked)
+    if (c->seq == NULL || c->on_op == ACT_OP_OFF ||
+        (xTaskGetTickCount() - c->on_tick) < pdMS_TO_TICKS(MSENSE_BLANK_MS))
+        return;
+
+    uint32_t ran = (uint32_t)(xTaskGetTickCount() - c->on_tick) * portTICK_PERIOD_MS;
+    uint8_t  dir = c->on_op;
+
+    act_off(c);
+    c->pos       = (dir == ACT_OP_UP) ? ACT_POS_UNITS : 0u;  // the model is exact at a stop
+    c->pos_known = true;
+    if (!c->travel) return;                 // relays open, the hold runs on
+    if (c->cal_run)
+    {
+        if (c->pc == ACT_CAL_PC_UP)   c->cal_ms[0] = ran;
+        if (c->pc == ACT_CAL_PC_DOWN) c->cal_ms[1] = ran;
+    }
+
+    uint32_t hold = act_advance(c);
+    if (hold != 0u) act_schedule(c, hold);
+    else act_idle(c);
+}
+
+static void act_endstop_isr(uint16_t code)
+{
+    BaseType_t woken = pdFALSE;
+
+    (void)xTimerPendFunctionCallFromISR(act_ev_endstop, NULL, code, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+#if ACT_PWM_DRIVE
+// Lid soft stop has ramped out: open the relays, unless a drive has
+// started since (it cut the ramp) or a newer stop is still ramping
+static void act_ev_pwm_off(void *unused0, uint32_t unused1)
+{
+    const act_chan_cfg_t *cfg = &act_cfg[ACT_CH_LID];
+
+    (void)unused0;
+    (void)unused1;
+    if (ACT_LID->on_op == ACT_OP_OFF && MotorPwm_IsOff())
+    {
+        PORT_REGS->GROUP[cfg->group].PORT_OUTCLR = cfg->up | cfg->down;
+#if ESTOP_ENABLE
+        act_tcc_patt(ACT_OP_OFF);
+#endif
+    }
+}
+
+static void act_pwm_off_isr(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    (void)xTimerPendFunctionCallFromISR(act_ev_pwm_off, NULL, 0u, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+// Relays off and no sequence; the schedule is left to the caller
+static void act_stop(act_chan_t *c)
+{
+#if ACT_HW_TIMING
+    if (c == ACT_LID)
+    {
+        taskENTER_CRITICAL();
+        act_hw_stop();
+        taskEXIT_CRITICAL();
+    }
+#endif
+    act_off(c);
+    c->seq = NULL;
+    c->cue_pending = false;
+    c->snd_pending = false;
+}
+
+static void act_ev_abort(void *unused, uint32_t ch)
+{
+    act_chan_t *c = &act_ch[ch];
+
+    (void)unused;
+    act_stop(c);
+    act_idle(c);
+}
+
+// Actuator_Park(): every channel stopped and its timer with it, or the
+// schedule started again from now
+static void act_ev_park(void *unused, uint32_t parked)
+{
+    (void)unused;
+    if ((parked != 0u) == act_parked) return;
+    act_parked = (parked != 0u);
+    LOG_INFO("Actuator %s", act_parked ? "parked" : "resumed");
+    if (act_parked) IoSeq_Stop();
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+    {
+        act_chan_t *c = &act_ch[i];
+
+        act_stop(c);
+        if (act_parked) (void)xTimerStop(c->timer, 0);
+        act_idle(c);
+    }
+}
+
+#if ESTOP_ENABLE
+// E-stop pressed (latched != 0): every channel stopped and its timer with
+// it, the relays already off; or released: the schedules start from now
+static void act_ev_estop(void *unused, uint32_t latched)
+{
+    (void)unused;
+    if (latched != 0u) LOG_WARN("Actuator e-stop (%lu)", (unsigned long)EStop_Count());
+    else LOG_INFO("Actuator e-stop cleared");
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+    {
+        act_chan_t *c = &act_ch[i];
+
+        act_stop(c);
+        if (latched != 0u) (void)xTimerStop(c->timer, 0);
+        act_idle(c);                // no schedule while latched or parked
+    }
+    if (latched == 0u && !ACT_ESTOPPED()) act_hw_pins(true);   // parked lid pins back on TCC1
+}
+#endif
+
+// Actuator_TriggerAt(): stop now, count down to the cue on the channel timer
+static void act_ev_cue(void *unused, uint32_t ch)
+{
+    act_chan_t *c = &act_ch[ch];
+    const act_step_t *seq;
+    uint32_t at;
+
+    (void)unused;
+    taskENTER_CRITICAL();
+    seq = c->cue_seq;
+    at  = c->cue_at;
+    taskEXIT_CRITICAL();
+
+    act_stop(c);
+    int32_t wait = ShowClock_Until(at);
+    if (wait < 500)                         // due within half a tick: now
+    {
+        act_cue_due(c, seq);
+        return;
+    }
+    if (seq != NULL) act_prefetch(seq);     // in SRAM by the cue time
+    c->cued = seq;
+    c->cue_pending = true;
+    act_schedule(c, ((uint32_t)wait + 500u) / 1000u);
+}
+
+#if ACT_HW_TIMING
+static void act_ev_hw_done(void *unused0, uint32_t unused1)
+{
+    (void)unused0;
+    (void)unused1;
+
+    // Stale if a trigger has already started the next pattern
+    if (!act_hw_busy())
+        act_idle(ACT_LID);
+}
+#endif
+
+// ---------------------------------------------------------
+// Public API
+// ---------------------------------------------------------
+void Actuator_Start(void)
+{
+    uint32_t first = ACT_BOOT_DELAY_MS;
+
+#if RESUME_ENABLE
+    // After a warm reset, what the pause it cut had left (resume.h)
+    if (Resume_Lid() != NULL) first = act_resume(Resume_Lid());
+#endif
+    if (pdMS_TO_TICKS(first) == 0u) first = portTICK_PERIOD_MS;
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+    {
+        act_ch[i].timer = xTimerCreateStatic("Actuator", pdMS_TO_TICKS(first), pdFALSE,
+                                             (void *)(uintptr_t)i, act_timer_cb, &act_timer_buf[i]);
+        act_ch[i].scale_q8[0] = 256u;
+        act_ch[i].scale_q8[1] = 256u;
+    }
+    if (!ACT_STEPPER_DRIVE) act_cal_load(ACT_LID);     // the stepper's travel is in steps
+    (void)Tickless_RegisterVeto(act_tickless_veto);
+    for (uint32_t i = 0; i < sizeof(act_params) / sizeof(act_params[0]); i++)
+        (void)Cli_Register(&act_params[i]);
+#if ACT_PWM_DRIVE
+    MotorPwm_Init(act_pwm_off_isr);
+#endif
+#if ACT_STEPPER_DRIVE
+    Stepper_Init();
+#endif
+#if ACT_CUR_SENSE
+    MotorSense_Init(act_endstop_isr);
+    if (ACT_LID->travel_ms[0] == 0u) (void)Actuator_Calibrate();
+#endif
+    // Initial boot delay (ACT_BOOT_DELAY_MS, or the resumed pause), then random lid sequences forever
+    (void)xTimerStart(ACT_LID->timer, 0);
+}
+
+bool Actuator_Trigger(act_channel_t ch, const act_step_t *seq)
+{
+    if (ch >= ACT_CHANNELS) return false;
+    return xTimerPendFunctionCall(act_ev_trigger, (void *)seq, (uint32_t)ch, 0) == pdPASS;
+}
+
+bool Actuator_TriggerAt(act_channel_t ch, const act_step_t *seq, uint32_t at)
+{
+    if (ch >= ACT_CHANNELS) return false;
+
+    taskENTER_CRITICAL();
+    act_ch[ch].cue_seq = seq;
+    act_ch[ch].cue_at  = at;
+    taskEXIT_CRITICAL();
+    return xTimerPendFunctionCall(act_ev_cue, NULL, (uint32_t)ch, 0) == pdPASS;
+}
+
+const act_step_t *Actuator_Pattern(uint8_t index)
+{
+    return (index < sizeof(act_pool) / sizeof(act_pool[0])) ? act_pool[index] : NULL;
+}
+
+bool Actuator_Abort(act_channel_t ch)
+{
+    if (ch >= ACT_CHANNELS) return false;
+    return xTimerPendFunctionCall(act_ev_abort, NULL, (uint32_t)ch, 0) == pdPASS;
+}
+
+void Actuator_GetDuty(act_channel_t ch, act_duty_t *out)
+{
+    const act_chan_t *c = &act_ch[(ch < ACT_CHANNELS) ? ch : ACT_CH_LID];
+    uint32_t up = 0, down = 0;
+
+    taskENTER_CRITICAL();
+    for (uint8_t b = 0; b < ACT_DUTY_BUCKETS; b++)
+    {
+        up   += c->duty_up[b];
+        down += c->duty_down[b];
+    }
+    out->throttled = c->throttled;
+    taskEXIT_CRITICAL();
+    out->up_ms     = up;
+    out->down_ms   = down;
+    out->budget_ms = ACT_DUTY_BUDGET_MS;
+}
+
+void Actuator_GetPace(act_pace_t *out)
+{
+    uint32_t lo, hi;
+
+    taskENTER_CRITICAL();
+    out->arrivals = act_pace_arrivals(xTaskGetTickCount());
+    out->dwell_ms = act_pace_dwell;
+    out->present  = act_pace_present;
+    act_pace_range(&lo, &hi);
+    taskEXIT_CRITICAL();
+    out->wait_min_ms = lo;
+    out->wait_max_ms = hi;
+}
+
+bool Actuator_QuietFor(uint32_t ms)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+    {
+        act_chan_t *c = &act_ch[i];
+
+        if (act_running(c) || c->cue_pending) return false;
+        if (c->timer != NULL && xTimerIsTimerActive(c->timer) != pdFALSE &&
+            (TickType_t)(xTimerGetExpiryTime(c->timer) - now) < pdMS_TO_TICKS(ms))
+            return false;
+    }
+    return true;
+}
+
+bool Actuator_Park(bool parked)
+{
+    return xTimerPendFunctionCall(act_ev_park, NULL, parked ? 1u : 0u, 0) == pdPASS;
+}
+
+bool Actuator_Parked(void)
+{
+    return act_parked;
+}
+
+void Actuator_Safe(void)
+{
+    PORT_REGS->GROUP[0].PORT_PINCFG[20] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+    PORT_REGS->GROUP[0].PORT_PINCFG[21] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+        PORT_REGS->GROUP[act_cfg[i].group].PORT_OUTCLR = act_cfg[i].up | act_cfg[i].down;
+#if ACT_STEPPER_DRIVE
+    (void)Stepper_Halt();           // no step pulses into a disabled driver
+#endif
+    IoSeq_Stop();                   // fog, strobe and knocker with them
+    Servo_ReleaseAll();             // eyes and jaw limp
+}
+
+#if ESTOP_ENABLE
+void Actuator_EStopFromISR(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    for (uint32_t i = 0; i < ACT_CHANNELS; i++)
+        PORT_REGS->GROUP[act_cfg[i].group].PORT_OUTCLR = act_cfg[i].up | act_cfg[i].down;
+#if ACT_STEPPER_DRIVE
+    (void)Stepper_Halt();
+#endif
+    IoSeq_Stop();
+    Servo_ReleaseAll();
+    (void)xTimerPendFunctionCallFromISR(act_ev_estop, NULL, 1u, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+bool Actuator_EStopRelease(void)
+{
+    return xTimerPendFunctionCall(act_ev_estop, NULL, 0u, 0) == pdPASS;
+}
+#endif
+
+bool Actuator_Calibrate(void)
+{
+#if ACT_CUR_SENSE
+    return Actuator_Trigger(ACT_CH_LID, act_cal_seq);
+#else
+    return false;
+#endif
+}
+
+void Actuator_GetTravel(act_travel_t *out)
+{
+    taskENTER_CRITICAL();
+    out->up_ms   = ACT_LID->travel_ms[0];
+    out->down_ms = ACT_LID->travel_ms[1];
+    taskEXIT_CRITICAL();
+    out->valid = (out->up_ms != 0u);
+}
+
+uint16_t Actuator_Position(act_channel_t ch)
+{
+    uint32_t pos;
+    bool     known;
+
+    if (ch >= ACT_CHANNELS) return ACT_POS_UNKNOWN;
+    taskENTER_CRITICAL();
+    act_pos_now(&act_ch[ch], &pos, &known);
+    taskEXIT_CRITICAL();
+    return known ? (uint16_t)((pos + ACT_POS_UNITS / ACT_POS_FULL / 2u) / (ACT_POS_UNITS / ACT_POS_FULL))
+                 : ACT_POS_UNKNOWN;
+}
+
+void Actuator_PresenceFromISR(bool detected)
+{
+    BaseType_t woken = pdFALSE;
+
+    // Queue full: a command is already pending, dropping this edge is fine
+    (void)xTimerPendFunctionCallFromISR(act_ev_presence, NULL, detected ? 1u : 0u, &woken);
+    portYIELD_FROM_ISR(woken);
+}
@@ -3,12 +3,28 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "showcfg.h"
 
-// Actuator Pin Definitions (Assigned to Group 0 / PORTA)
-#define PIN_ACT_UP   PORT_PA20
-#define PIN_ACT_DOWN PORT_PA21
+// Lid relays: the TCC1 timing and current sensing are wired to these, the
+// LID row of SHOW_ACTUATORS must name the same pins
+#define PIN_ACT_UP   PORT_PA20          // group 0 (RELAY_1)
+#define PIN_ACT_DOWN PORT_PA21          // group 0 (RELAY_2)
 
-// Timing Constants
+// Channels, one UP / DOWN relay pair each (SHOW_ACTUATORS in showcfg.h):
+// each has its own sequence, interlock, thermal budget and one-shot timer;
+// all of them are stepped by the FreeRTOS timer task. Only the lid owns
+// the optional TCC1 timing and current sensing; the rows say which
+// channels run the random / presence schedule.
+#define ACT_X_ID(id, ...)   ACT_CH_##id,
+
+typedef enum
+{
+    SHOW_ACTUATORS(ACT_X_ID)
+    ACT_CHANNELS
+} act_channel_t;
+
+// Timing Constants. MS_MIN/MAX_START, SLAM_MAX and ACT_PRESENCE_COOLDOWN_MS
+// are only defaults: Actuator_Start() registers them with cli.h for live tuning
 #define MS_PER_SECOND 1000UL
 #define MS_PER_MIN    (MS_PER_SECOND * 60UL)
 #define MS_MIN_START  (MS_PER_SECOND * 25UL)
@@ -19,8 +35,300 @@
 #define MIN_DROP_MS   (MS_PER_SECOND * 5UL)
 #define SLAM_MAX      5UL
 
+// Lid idle from Actuator_Start() to its first scare; a timer, so the lights
+// and everything else come up without waiting for it
+#define ACT_BOOT_DELAY_MS  (MS_PER_SECOND * 15UL)
+
+// Presence trigger: a sensor edge is ignored while a sequence runs and for
+// ACT_PRESENCE_COOLDOWN_MS after one ends, so a visitor cannot spam the prop
+#define ACT_PRESENCE_COOLDOWN_MS  (MS_PER_SECOND * 20UL)
+
+// Pacing: the random pause between lid scares follows the room. With no
+// arrival in ACT_PACE_WINDOW_MS the MS_MIN/MAX_START range is scaled by
+// ACT_PACE_IDLE_Q8 / 256, moving linearly to ACT_PACE_BUSY_Q8 / 256 as
+// arrivals reach ACT_PACE_BUSY_ARRIVALS per window. While someone is in
+// front of the sensor the pause is also capped at half the average dwell
+// time, so the next scare lands before they walk on. Never below
+// ACT_PACE_FLOOR_MS.
+#define ACT_PACE_WINDOW_MS       (MS_PER_MIN * 5UL)
+#define ACT_PACE_BUSY_ARRIVALS   10u
+#define ACT_PACE_IDLE_Q8         768u       // empty room: 75-180 s
+#define ACT_PACE_BUSY_Q8         128u       // packed room: 12.5-30 s
+#define ACT_PACE_FLOOR_MS        (MS_PER_SECOND * 10UL)
+#define ACT_PACE_DWELL_SHIFT     2u         // dwell average weight 1/4
+
+// Thermal budget: energised time (either direction) is summed over a
+// sliding window of ACT_DUTY_BUCKETS x ACT_DUTY_BUCKET_MS. A sequence only
+// starts if its worst-case energised time fits in what is left of
+// ACT_DUTY_BUDGET_PCT of the window; the random schedule picks among the
+// sequences that fit, or retries one bucket later when none does.
+#define ACT_DUTY_BUCKET_MS   (MS_PER_SECOND * 10UL)
+#define ACT_DUTY_BUCKETS     30u                     // 5 min window
+#define ACT_DUTY_BUDGET_PCT  25u                     // actuator rated duty cycle
+#define ACT_DUTY_BUDGET_MS   (ACT_DUTY_BUCKET_MS * ACT_DUTY_BUCKETS * ACT_DUTY_BUDGET_PCT / 100UL)
+
+// End-of-travel sensing (motor_sense.h, needs the shunt amplifier on PA02):
+// an UP / DOWN step with ACT_ARG_TRAVEL ends as soon as the motor current
+// shows the stop was reached, its ms being only the timeout; on any other
+// drive step the relays just open early and the hold runs on. Software
+// timing only, the TCC1 pattern cannot be cut short per step.
+#define ACT_CUR_SENSE      0
+#define ACT_ARG_TRAVEL     0x01u        // UP / DOWN `arg`: end at the stop
+
+// Travel calibration: UP / DOWN holds on the lid (built-in tables, triggered
+// ones, MIN/MAX_DROP_MS) are written for ACT_TRAVEL_NOMINAL_MS of full
+// travel. Actuator_Calibrate() (needs ACT_CUR_SENSE) homes the lid down and
+// times one full UP and one full DOWN travel to the stop; from then on each
+// direction's holds are scaled to the measured travel plus
+// ACT_CAL_MARGIN_PCT. The result is kept in flash (nvstore.h) and loaded
+// at start; without one the holds run as written.
+#define ACT_TRAVEL_NOMINAL_MS  MS_PER_SECOND
+#define ACT_CAL_MARGIN_PCT     15u
+#define ACT_CAL_TIMEOUT_MS     (MS_PER_SECOND * 5UL)    // per travel, no stop = failed
+#define ACT_CAL_MIN_MS         200UL                    // shorter = it did not move
+
+// Position model: each channel dead-reckons where its lid is, 0 at the
+// bottom stop to ACT_POS_FULL at the top, from the energised time per
+// direction at the calibrated travel speed (ACT_TRAVEL_NOMINAL_MS without
+// a calibration), clamped at the stops. After a reset it is unknown until
+// a drive outlasts a full travel; a sensed end stop (ACT_CUR_SENSE) sets
+// it exactly. A GOTO step drives from wherever the model puts the lid to
+// a target, so a sequence starts from the current position, and the
+// built-in ones end with ACT_HOME: only the way still left down, plus
+// ACT_POS_END_MARGIN_PCT of a travel into the stop to take out the drift,
+// instead of a full one-second drive. The soft-drive ramps (ACT_PWM_DRIVE)
+// are counted at full speed; the margin covers them too.
+#define ACT_POS_FULL           1000u                    // per mille of full travel
+#define ACT_POS_UNKNOWN        0xFFFFu                  // Actuator_Position(), not homed
+#define ACT_POS_END_MARGIN_PCT ACT_CAL_MARGIN_PCT       // past a target at a stop
+#define ACT_POS_DEADBAND       10u                      // nearer than this: no drive
+
+// Sound on the built-in sequences (sound.h): the creak starts with the
+// lift, the slam ACT_SLAM_SOUND_MS after each DOWN edge, when the lid
+// lands (relay, motor and travel; measure it on the prop)
+#define ACT_SLAM_SOUND_MS      60u
+
+// Relative odds of each built-in sequence per random event (0 = never)
+#define ACT_WEIGHT_QUICK_UP     3u
+#define ACT_WEIGHT_RANDOM_DROP  2u
+#define ACT_WEIGHT_VIOLENT      1u
+
+// ---------------------------------------------------------
+// Sequence step tables
+// ---------------------------------------------------------
+// A sequence is an array of steps ending in ACT_OP_END. UP / DOWN / OFF
+// drive the relays and hold for ms, or for a randomly picked time in
+// [ms, ms_max] when ms_max > ms. LOOP jumps back `arg` steps, `count`
+// times in total (one loop level, no nesting). UP / DOWN `arg` takes
+// ACT_ARG_TRAVEL (end-of-travel sensing). GOTO drives UP or DOWN from
+// the modelled position to `count` (0..ACT_POS_FULL) for as long as the
+// model says, at most ms (scaled like any hold, 0 = no cap); an unknown
+// position sends it to the nearer stop for a full travel, which homes the
+// model. It takes ACT_ARG_TRAVEL too. SOUND takes no time: it cues
+// clip `arg` at gain `count` (sound.h) with the next drive step, ms after
+// its edge (after the reversal gap, if one is inserted), or at the end
+// of the table if no step follows. Tables are const, so they
+// can live in flash or be copied from SmartEEPROM; the interpreter keeps
+// only a program counter and a loop counter.
+#define ACT_SEQ_MAX_STEPS  64u          // runaway guard for bad tables
+
+// Reversal interlock: a direction change inside a sequence first opens
+// both relays for ACT_DEAD_MS so the contacts have released before the
+// other coil is energised (0 = off). In ACT_HW_TIMING mode the gap is a
+// TCC1 pattern segment, so it is exact too.
+#define ACT_DEAD_MS        10u
+
+// ACT_HW_TIMING = 1 plays each sequence from TCC1's pattern generator
+// (PA20 = WO4, PA21 = WO5): edges are exact to ~8.5 us whatever the task
+// load. A table is resolved up front into at most ACT_HW_MAX_SEGS segments
+// of at most ACT_HW_MAX_MS each (24-bit counter at 120 MHz / 1024).
+#define ACT_HW_TIMING      0
+#define ACT_HW_MAX_SEGS    48u
+#define ACT_HW_MAX_MS      143000UL
+
+#if ACT_CUR_SENSE && ACT_HW_TIMING
+#error "ACT_CUR_SENSE ends steps early: it needs ACT_HW_TIMING = 0"
+#endif
+
+// ACT_PWM_DRIVE = 1 soft-drives the lid through a MOSFET stage on PA10
+// (motor_pwm.h): the relays only pick the direction and TCC0 ramps the
+// supply up at every drive step and down at every stop, so there is no
+// inrush to sag the LED rail and the relays open with no current. The
+// reversal gap grows to MPWM_RAMP_MS to fit the soft stop. Software timing
+// only, the TCC1 pattern drives the relays directly.
+#define ACT_PWM_DRIVE      0
+
+#if ACT_PWM_DRIVE && ACT_HW_TIMING
+#error "ACT_PWM_DRIVE needs ACT_HW_TIMING = 0"
+#endif
+
+// ACT_STEPPER_DRIVE = 1: the lid is a stepper motor (stepper.h). PA20
+// becomes its driver's DIR and PA21 its ENABLE, and TCC0 with the DMAC
+// makes the step pulses along a precomputed acceleration ramp, no CPU per
+// step. A drive step is the longest move that fits its hold, a GOTO the
+// exact steps to its target; the position model counts steps. There is no
+// relay to sense or soft-drive, and the TCC1 pattern cannot make steps.
+#define ACT_STEPPER_DRIVE  0
+
+#if ACT_STEPPER_DRIVE && (ACT_HW_TIMING || ACT_CUR_SENSE || ACT_PWM_DRIVE)
+#error "ACT_STEPPER_DRIVE needs ACT_HW_TIMING, ACT_CUR_SENSE and ACT_PWM_DRIVE = 0"
+#endif
+
+typedef enum
+{
+    ACT_OP_END = 0,
+    ACT_OP_UP,
+    ACT_OP_DOWN,
+    ACT_OP_OFF,
+    ACT_OP_LOOP,
+    ACT_OP_SOUND,
+    ACT_OP_GOTO
+} act_op_t;
+
+typedef struct
+{
+    uint8_t  op;        // act_op_t
+    uint8_t  arg;       // LOOP: steps to jump back, SOUND: clip id
+    uint16_t count;     // LOOP: passes in total, SOUND: gain (256 = unity), GOTO: target
+    uint16_t ms;        // hold time, SOUND: delay after the next edge, GOTO: cap
+    uint16_t ms_max;    // > ms: random hold in [ms, ms_max]
+} act_step_t;
+
+// Step shorthands for building tables
+#define ACT_UP(ms)            { ACT_OP_UP,   0u, 0u, (ms), 0u }
+#define ACT_DOWN(ms)          { ACT_OP_DOWN, 0u, 0u, (ms), 0u }
+#define ACT_OFF(ms)           { ACT_OP_OFF,  0u, 0u, (ms), 0u }
+#define ACT_UP_RAND(min, max) { ACT_OP_UP,   0u, 0u, (min), (max) }
+#define ACT_UP_TRAVEL(ms)     { ACT_OP_UP,   ACT_ARG_TRAVEL, 0u, (ms), 0u }
+#define ACT_DOWN_TRAVEL(ms)   { ACT_OP_DOWN, ACT_ARG_TRAVEL, 0u, (ms), 0u }
+#define ACT_LOOP(back, n)     { ACT_OP_LOOP, (back), (n), 0u, 0u }
+#define ACT_SOUND(id)         { ACT_OP_SOUND, (id), 256u, 0u, 0u }
+#define ACT_SOUND_AT(id, ms)  { ACT_OP_SOUND, (id), 256u, (ms), 0u }
+#define ACT_GOTO(pos)         { ACT_OP_GOTO, 0u, (pos), 0u, 0u }
+#define ACT_HOME(ms)          { ACT_OP_GOTO, ACT_ARG_TRAVEL, 0u, (ms), 0u }
+#define ACT_END               { ACT_OP_END,  0u, 0u, 0u, 0u }
+
+// Thermal accounting snapshot (Actuator_GetDuty())
+typedef struct
+{
+    uint32_t up_ms;         // energised UP in the window
+    uint32_t down_ms;       // energised DOWN in the window
+    uint32_t budget_ms;     // ACT_DUTY_BUDGET_MS
+    uint32_t throttled;     // sequences refused or postponed since boot
+} act_duty_t;
+
+// Pacing snapshot (Actuator_GetPace())
+typedef struct
+{
+    uint32_t arrivals;      // presence edges in the last ACT_PACE_WINDOW_MS
+    uint32_t dwell_ms;      // average time in front of the sensor, 0 = none yet
+    bool     present;       // someone is in front of it now
+    uint32_t wait_min_ms;   // random pause range the next wait is drawn from
+    uint32_t wait_max_ms;
+} act_pace_t;
+
+// Measured full travel (Actuator_GetTravel())
+typedef struct
+{
+    uint32_t up_ms;
+    uint32_t down_ms;
+    bool     valid;         // false: never calibrated, holds unscaled
+} act_travel_t;
+
 // Public Function Prototypes
 void Actuator_InitPorts(void);
-void Actuator_Task(void *pvParameters);
+
+// Create one sequence timer per channel and load the lid's travel
+// calibration; with ACT_CUR_SENSE and none stored, it calibrates first.
+// On the lid, after ACT_BOOT_DELAY_MS (after a warm reset, what was left of
+// the pause it cut, resume.h) a random built-in sequence runs, then the next one after a random
+// pause (25-60 s, paced by presence, see ACT_PACE_*); other channels idle
+// until triggered. Registers the lid's tunables with cli.h. Steps are advanced
+// by timer callbacks in the FreeRTOS timer task, so nothing blocks and no
+// actuator task is needed. Call before vTaskStartScheduler().
+void Actuator_Start(void);
+
+// Abort whatever channel `ch` is running and start `seq` (NULL = a random
+// built-in one, lid only) now, unless it would exceed that channel's
+// thermal budget (then nothing changes). Channels run concurrently. The
+// table must stay valid until it ends. Any task; false if the timer
+// command queue is full.
+bool Actuator_Trigger(act_channel_t ch, const act_step_t *seq);
+
+// Actuator_Trigger() at show time `at` (showclock.h): whatever `ch` runs
+// is stopped now and `seq` starts at `at`, to the RTOS tick, so it stays
+// in step with a Timeline_PlayAt() cue on the same time. A time already
+// past starts at once. The budget is checked at the start, and a NULL
+// `seq` is picked then, as for Actuator_Trigger(). Any task.
+bool Actuator_TriggerAt(act_channel_t ch, const act_step_t *seq, uint32_t at);
+
+// Built-in random-pool sequence `index` (0 quick up, 1 random drop,
+// 2 violent), NULL past the end; how a cue names one over the network.
+const act_step_t *Actuator_Pattern(uint8_t index);
+
+// Stop channel `ch` with its relays off; on the lid the random schedule
+// resumes from now. Any task.
+bool Actuator_Abort(act_channel_t ch);
+
+// Presence edge from the sensor ISR (dsun_edge_enable() callback). An
+// arrival (detected) starts a random built-in sequence unless one is
+// running or cooling down, in which case a long pending pause is cut to
+// the busier pace instead; on a show-sync network the arrival scares every
+// prop at once (ShowSync_Scare()). Both edges feed the pacing statistics. The timer
+// task runs at the top priority, so the first relay edge follows the sensor
+// edge by well under 10 ms. ISR at or below configMAX_SYSCALL_INTERRUPT_PRIORITY.
+void Actuator_PresenceFromISR(bool detected);
+
+// Energised time of channel `ch` in its sliding window so far. Any task;
+// the window is rolled by the timer task, so idle buckets age out at the
+// next event.
+void Actuator_GetDuty(act_channel_t ch, act_duty_t *out);
+
+// Presence statistics and the pause range they give right now. Any task.
+void Actuator_GetPace(act_pace_t *out);
+
+// True if no channel runs a sequence or holds a cue and none is due to
+// start within `ms`: a gap for something that must not cut a scare short
+// (fwupdate.h). Timer task, like the sequences themselves.
+bool Actuator_QuietFor(uint32_t ms);
+
+// Park every channel: what runs is stopped with its relays off (the lid
+// drops to rest), and nothing starts until the park is lifted, neither
+// the random schedule nor presence, cues or explicit triggers. Lifting it
+// starts the lid's schedule from now. For closed hours (showcal.h). Any
+// task; false if the timer command queue is full.
+bool Actuator_Park(bool parked);
+
+// True while parked. Any task.
+bool Actuator_Parked(void);
+
+// Every relay open straight on the PORT (PA20 / PA21 back from TCC1 too)
+// and the output sequencer stopped (ioseq.h), no RTOS call and no state
+// touched: for the fault and brown-out handlers (fault.h, brownout.h).
+// Any context.
+void Actuator_Safe(void);
+
+// E-stop press (estop.h), from its ISR: every relay off on the PORT (the
+// lid's are forced off by TCC1 already) and the output sequencer stopped,
+// then every channel stopped in the timer task. Nothing drives and no
+// schedule runs until the latch is cleared. ESTOP_ENABLE builds only.
+void Actuator_EStopFromISR(void);
+
+// The e-stop latch has been cleared (EStop_Clear()): the schedules start
+// again from now, unless parked. Any task; false if the timer command
+// queue is full.
+bool Actuator_EStopRelease(void);
+
+// Abort the lid and measure its travel times (ACT_CUR_SENSE builds only,
+// false otherwise), about 12 s. A good result is saved to flash and scales
+// every later sequence; a failed one keeps the previous scale. Any task.
+bool Actuator_Calibrate(void);
+
+// Travel calibration in use. Any task.
+void Actuator_GetTravel(act_travel_t *out);
+
+// Modelled position of channel `ch`, 0 (bottom) to ACT_POS_FULL (top), a
+// drive still running included; ACT_POS_UNKNOWN until it is homed. Any task.
+uint16_t Actuator_Position(act_channel_t ch);
 
 #endif /* ACTUATOR_H */
\ No newline at end of file
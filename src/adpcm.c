@@ -0,0 +1,100 @@
+/* =============================================================================
+ * adpcm.c  -  IMA-ADPCM sound clips: 4 bits a sample, decoded in the mixer
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "adpcm.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"     /* __SSAT */
+#define ADPCM_SAT16(x)      __SSAT((x), 16)
+#else
+#define ADPCM_SAT16(x)      (((x) < -32768) ? -32768 : (((x) > 32767) ? 32767 : (x)))
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const int16_t adpcm_step[ADPCM_INDEX_MAX + 1u] =
+{
+        7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+       19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+       50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+      130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+      337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+      876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+     2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+     5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t adpcm_index[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/* -- Public API implementation ----------------------------------------------- */
+
+uint32_t Adpcm_Bytes(uint32_t samples)
+{
+    uint32_t tail = samples % ADPCM_BLOCK_SAMPLES;
+
+    return (samples / ADPCM_BLOCK_SAMPLES) * ADPCM_BLOCK_BYTES +
+           ((tail != 0u) ? ADPCM_HEADER_BYTES + (tail + 1u) / 2u : 0u);
+}
+
+uint32_t Adpcm_Samples(uint32_t bytes)
+{
+    uint32_t tail = bytes % ADPCM_BLOCK_BYTES;
+
+    return (bytes / ADPCM_BLOCK_BYTES) * ADPCM_BLOCK_SAMPLES +
+           ((tail > ADPCM_HEADER_BYTES) ? (tail - ADPCM_HEADER_BYTES) * 2u : 0u);
+}
+
+void Adpcm_Start(adpcm_dec_t *d)
+{
+    d->pos   = 0u;
+    d->pred  = 0;
+    d->index = 0;
+}
+
+void Adpcm_Mix(adpcm_dec_t *d, const uint8_t *data, int32_t *acc, uint32_t n, uint16_t gain)
+{
+    uint32_t pos = d->pos;
+    int32_t  p   = d->pred;
+    int32_t  ix  = d->index;
+    int32_t  g   = (int32_t)gain;
+
+    while (n != 0u)
+    {
+        const uint8_t *b  = data + (pos / ADPCM_BLOCK_SAMPLES) * ADPCM_BLOCK_BYTES;
+        uint32_t       in = pos % ADPCM_BLOCK_SAMPLES;
+        uint32_t       k  = ADPCM_BLOCK_SAMPLES - in;
+
+        if (in == 0u)
+        {
+            p  = (int16_t)(b[0] | (b[1] << 8));
+            ix = (b[2] > ADPCM_INDEX_MAX) ? (int32_t)ADPCM_INDEX_MAX : (int32_t)b[2];
+        }
+        if (k > n) k = n;
+        pos += k;
+        n   -= k;
+
+        const uint8_t *q   = b + ADPCM_HEADER_BYTES;
+        uint32_t       end = in + k;
+
+        for (; in < end; in++)
+        {
+            uint32_t nib  = (q[in >> 1] >> ((in & 1u) << 2)) & 0x0Fu;      /* low nibble first */
+            int32_t  diff = (int32_t)((((nib & 7u) << 1) + 1u) * (uint32_t)adpcm_step[ix]) >> 3;
+
+            p   = ADPCM_SAT16((nib & 8u) ? p - diff : p + diff);
+            ix += adpcm_index[nib];
+            if ((uint32_t)ix > ADPCM_INDEX_MAX) ix = (ix < 0) ? 0 : (int32_t)ADPCM_INDEX_MAX;
+            *acc++ += (p * g) >> 8;
+        }
+    }
+    d->pos   = pos;
+    d->pred  = p;
+    d->index = ix;
+}
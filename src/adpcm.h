@@ -0,0 +1,63 @@
+/* =============================================================================
+ * adpcm.h  -  IMA-ADPCM sound clips: 4 bits a sample, decoded in the mixer
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A clip in SOUND_FMT_ADPCM (sound.h) is 16-bit sound at SOUND_RATE_HZ
+ * coded as IMA-ADPCM in independent blocks of ADPCM_BLOCK_SAMPLES:
+ *
+ *   block    predictor(s16)  index(u8)  reserved(u8)  data[ADPCM_BLOCK_SAMPLES / 2]
+ *
+ * little-endian, the low nibble of each data byte first. predictor and
+ * index are the decoder state before the block's first sample (the
+ * sample itself is not played), so every block starts from its header
+ * and a bit error never runs past it. The last block may be cut short
+ * after the sample count of the clip. 132 bytes hold 256 samples of
+ * 16-bit sound: half the flash and QSPI bandwidth of the 8-bit clip it
+ * replaces, a quarter of 16-bit PCM. tools/wav2clip.py --adpcm (and
+ * mkassets.py --adpcm) encode it, with the same arithmetic as below.
+ *
+ * Adpcm_Mix() decodes straight into the mixer's accumulator, no sample
+ * buffer between: per sample a nibble, one table step load, one multiply
+ * for the difference ((2 n + 1) step / 8, the IMA sum of shifted steps
+ * without its rounding per bit), an SSAT to 16 bits and the index step,
+ * then the multiply-add by the voice gain. "adpcm" in "rtbench"
+ * (rtosbench.h) is the cost of one block of it.
+ * ============================================================================= */
+
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <stdint.h>
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define ADPCM_BLOCK_SAMPLES     256u
+#define ADPCM_HEADER_BYTES      4u
+#define ADPCM_BLOCK_BYTES       (ADPCM_HEADER_BYTES + ADPCM_BLOCK_SAMPLES / 2u)
+#define ADPCM_INDEX_MAX         88u
+
+/* Where a voice is in its clip; the data pointer is passed on every call,
+ * so the clip can move (assetcache.h) while it plays */
+typedef struct
+{
+    uint32_t pos;               /* samples decoded                           */
+    int32_t  pred;              /* last sample, 16-bit                       */
+    int32_t  index;             /* step table, 0..ADPCM_INDEX_MAX            */
+} adpcm_dec_t;
+
+/** Bytes of a clip of `samples`, the last block cut short. */
+uint32_t Adpcm_Bytes(uint32_t samples);
+
+/** Samples in `bytes` of blocks. */
+uint32_t Adpcm_Samples(uint32_t bytes);
+
+/** Back to the clip's first sample. */
+void Adpcm_Start(adpcm_dec_t *d);
+
+/**
+ * Decode the next `n` samples of the clip at `data` and add each, times
+ * `gain` / 256, to `acc`: at SOUND_GAIN_UNITY, full scale spans +-32768 as
+ * an 8-bit clip does. The caller keeps `n` within the clip. Any context.
+ */
+void Adpcm_Mix(adpcm_dec_t *d, const uint8_t *data, int32_t *acc, uint32_t n, uint16_t gain);
+
+#endif /* ADPCM_H */
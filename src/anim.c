@@ -0,0 +1,242 @@
+/* =============================================================================
+ * anim.c  -  Playback of precomputed NeoPixel animations stored in flash
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "anim.h"
+#include "neopixel.h"
+#include "stream.h"
+#include <stddef.h>
+#include <string.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const uint8_t *anim_clip   = NULL;
+static uint32_t       anim_size   = 0u;
+static uint32_t       anim_pos    = 0u;     /* next frame's first op          */
+static uint16_t       anim_frames = 0u;
+static uint16_t       anim_frame  = 0u;     /* next frame to decode           */
+static uint8_t        anim_hold   = 1u;
+static uint8_t        anim_wait   = 0u;     /* slots left on the shown frame  */
+static bool           anim_loop   = false;
+
+/* Stream mode: anim_clip is the staging buffer, anim_size its fill */
+static int32_t        anim_stream = -1;
+static uint8_t        anim_sbuf[ANIM_STREAM_BYTES];
+static volatile uint32_t anim_underruns;
+
+/* -- Decoder ----------------------------------------------------------------- */
+
+/* Apply one frame's ops from anim_pos; false if it runs past the clip */
+static bool anim_decode_frame(void)
+{
+    uint16_t led = 0u;
+
+    while (anim_pos < anim_size)
+    {
+        uint8_t  op = anim_clip[anim_pos++];
+        uint16_t n  = (uint16_t)((op & ~ANIM_OP_MASK) + 1u);
+
+        switch (op & ANIM_OP_MASK)
+        {
+            case ANIM_OP_SKIP:
+                led = (uint16_t)(led + n);
+                break;
+
+            case ANIM_OP_LITERAL:
+                if (anim_size - anim_pos < (uint32_t)n * 3u)
+                    return false;
+                for (uint16_t k = 0; k < n; k++, led++, anim_pos += 3u)
+                    NeoPixel_SetPixel(led, anim_clip[anim_pos], anim_clip[anim_pos + 1u],
+                                      anim_clip[anim_pos + 2u]);
+                break;
+
+            case ANIM_OP_RUN:
+                if (anim_size - anim_pos < 3u)
+                    return false;
+                for (uint16_t k = 0; k < n; k++, led++)
+                    NeoPixel_SetPixel(led, anim_clip[anim_pos], anim_clip[anim_pos + 1u],
+                                      anim_clip[anim_pos + 2u]);
+                anim_pos += 3u;
+                break;
+
+            default:                            /* ANIM_OP_END */
+                return (op == ANIM_OP_END);
+        }
+    }
+    return false;
+}
+
+/* Check a header; false if malformed */
+static bool anim_header(const uint8_t *h, uint16_t *frames, uint8_t *hold)
+{
+    if (h[0] != 'N' || h[1] != 'A' || h[2] != ANIM_VERSION) return false;
+
+    uint16_t leds = (uint16_t)(h[4] | ((uint16_t)h[5] << 8));
+
+    *frames = (uint16_t)(h[6] | ((uint16_t)h[7] << 8));
+    *hold   = (h[3] == 0u) ? 1u : h[3];
+    return leds != 0u && *frames != 0u;
+}
+
+/* Bytes of the frame at p, END included; 0 if it is not all there */
+static uint32_t anim_frame_bytes(const uint8_t *p, uint32_t avail)
+{
+    uint32_t i = 0u;
+
+    while (i < avail)
+    {
+        uint8_t op = p[i++];
+
+        switch (op & ANIM_OP_MASK)
+        {
+            case ANIM_OP_SKIP:    break;
+            case ANIM_OP_LITERAL: i += ((op & ~ANIM_OP_MASK) + 1u) * 3u; break;
+            case ANIM_OP_RUN:     i += 3u; break;
+            default:              return i;             /* END or bad: decode decides */
+        }
+    }
+    return 0u;
+}
+
+/* Stream mode: get the next header (or frame) whole into the staging
+   buffer. 1 = there, 0 = not in yet, -1 = the stream is over or corrupt */
+static int32_t anim_stream_fill(bool header)
+{
+    memmove(anim_sbuf, &anim_sbuf[anim_pos], anim_size - anim_pos);
+    anim_size -= anim_pos;
+    anim_pos   = 0u;
+
+    for (;;)
+    {
+        uint32_t want  = header ? ANIM_HEADER_BYTES : anim_frame_bytes(anim_sbuf, anim_size);
+        uint32_t avail = Stream_Available(anim_stream);
+        uint32_t room  = ANIM_STREAM_BYTES - anim_size;
+
+        if (want != 0u && want <= anim_size) return 1;
+        if (room == 0u) return -1;                      /* frame bigger than the buffer */
+        if (avail == 0u) return Stream_Ended(anim_stream) ? -1 : 0;
+        if (avail > room) avail = room;
+        anim_size += Stream_Read(anim_stream, &anim_sbuf[anim_size], avail);
+    }
+}
+
+/* A streamed clip's header, at its start or a loop restart */
+static int32_t anim_stream_header(void)
+{
+    int32_t r = anim_stream_fill(true);
+
+    if (r <= 0) return r;
+    if (!anim_header(anim_sbuf, &anim_frames, &anim_hold)) return -1;
+    anim_pos  += ANIM_HEADER_BYTES;
+    anim_frame = 0u;
+    return 1;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Anim_Start(const uint8_t *clip, uint32_t size, bool loop)
+{
+    Anim_Stop();
+
+    uint16_t frames;
+    uint8_t  hold;
+
+    if (clip == NULL || size < ANIM_HEADER_BYTES) return false;
+    if (!anim_header(clip, &frames, &hold)) return false;
+
+    anim_clip   = clip;
+    anim_size   = size;
+    anim_pos    = ANIM_HEADER_BYTES;
+    anim_hold   = hold;
+    anim_frames = frames;
+    anim_frame  = 0u;
+    anim_wait   = 0u;
+    anim_loop   = loop;
+    return true;
+}
+
+bool Anim_StartStream(int32_t stream)
+{
+    Anim_Stop();
+
+    if (stream < 0) return false;
+    anim_stream = stream;
+    anim_clip   = anim_sbuf;
+    anim_size   = 0u;
+    anim_pos    = 0u;
+    anim_frames = 0u;                           /* header still to come */
+    anim_frame  = 0u;
+    anim_wait   = 0u;
+    anim_loop   = false;                        /* the stream loops, if at all */
+    return true;
+}
+
+uint32_t Anim_Underruns(void)
+{
+    return anim_underruns;
+}
+
+void Anim_Stop(void)
+{
+    if (anim_stream >= 0) Stream_Close(anim_stream);
+    anim_stream = -1;
+    anim_clip   = NULL;
+}
+
+bool Anim_Active(void)
+{
+    return (anim_clip != NULL);
+}
+
+bool Anim_Step(uint8_t steps)
+{
+    if (anim_clip == NULL) return false;
+
+    /* Deltas build on each other, so every frame that fell due is decoded */
+    for (uint8_t s = 0; s < steps; s++)
+    {
+        if (anim_wait > 0u)
+        {
+            anim_wait--;
+            continue;
+        }
+
+        if (anim_stream >= 0)
+        {
+            /* Hold the frame on screen until the next one is all in */
+            int32_t r = (anim_frame == anim_frames) ? anim_stream_header() : 1;
+
+            if (r > 0) r = anim_stream_fill(false);
+            if (r < 0)
+            {
+                Anim_Stop();
+                return false;
+            }
+            if (r == 0)
+            {
+                anim_underruns++;
+                return true;
+            }
+        }
+        else if (anim_frame == anim_frames)
+        {
+            if (!anim_loop)
+            {
+                Anim_Stop();
+                return false;
+            }
+            anim_pos   = ANIM_HEADER_BYTES;     /* keyframe rewrites every LED */
+            anim_frame = 0u;
+        }
+
+        if (!anim_decode_frame())
+        {
+            Anim_Stop();
+            return false;
+        }
+        anim_frame++;
+        anim_wait = (uint8_t)(anim_hold - 1u);
+    }
+    return true;
+}
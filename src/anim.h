@@ -0,0 +1,84 @@
+/* =============================================================================
+ * anim.h  -  Playback of precomputed NeoPixel animations stored in flash
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A clip is a const byte array (placed in the 1 MB flash by the linker) that
+ * holds a keyframe followed by per-frame deltas of the strip, so a sequence
+ * too heavy to compute live costs only a decode of the LEDs that changed.
+ *
+ * CLIP FORMAT (all multi-byte fields little-endian)
+ * -------------------------------------------------
+ *   header   'N' 'A' version(1) hold  leds(u16)  frames(u16)
+ *   frame    op ... op END
+ *
+ *   op  00nnnnnn            SKIP    n + 1 pixels unchanged
+ *       01nnnnnn c0 .. cn   LITERAL n + 1 pixels, 3 bytes each
+ *       10nnnnnn c          RUN     n + 1 pixels of one colour c
+ *       11000000            END     of frame
+ *
+ * Colours are R, G, B bytes as passed to NeoPixel_SetPixel(), so gamma and
+ * brightness still apply. Frame 0 is the keyframe and must write every LED
+ * (no SKIP); each later frame is a delta on the one before. hold is how many
+ * calls to Anim_Step() each frame stays on screen (>= 1). LEDs past NUM_LEDS
+ * are ignored, so a clip made for a longer strip still plays.
+ *
+ * Anim_Step() writes only the changed pixels into the NeoPixel back buffer
+ * (Show() keeps it in step with the frame on the wire) and leaves Show() to
+ * the caller.
+ *
+ * A clip can also play from an SD card stream (stream.h) with
+ * Anim_StartStream(): frames are copied from the read-ahead ring into a
+ * staging buffer of ANIM_STREAM_BYTES and decoded only once complete, so a
+ * frame that has not arrived holds the one on screen (Anim_Underruns())
+ * instead of tearing. A looping stream carries the header again at each
+ * restart, which is checked and skipped.
+ * ============================================================================= */
+
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ANIM_VERSION        1u
+#define ANIM_HEADER_BYTES   8u
+
+#define ANIM_OP_SKIP        0x00u
+#define ANIM_OP_LITERAL     0x40u
+#define ANIM_OP_RUN         0x80u
+#define ANIM_OP_END         0xC0u
+#define ANIM_OP_MASK        0xC0u
+
+#define ANIM_STREAM_BYTES   2048u       /* largest frame a stream may carry */
+
+/**
+ * Start playing a clip from its keyframe. The data must stay valid while it
+ * plays. loop = true rewinds to the keyframe after the last frame.
+ * Returns false (and plays nothing) if the header is malformed.
+ */
+bool Anim_Start(const uint8_t *clip, uint32_t size, bool loop);
+
+/**
+ * Start playing an open stream (stream.h) of a clip; playback owns the
+ * handle and closes it on Anim_Stop() or at the end. The header is read
+ * when it arrives; open the stream early enough for Stream_Ready().
+ */
+bool Anim_StartStream(int32_t stream);
+
+/** Steps a streamed frame was not in yet, since boot. */
+uint32_t Anim_Underruns(void);
+
+/** Stop playback; the back buffer keeps the last decoded frame. */
+void Anim_Stop(void);
+
+/** true while a clip is playing. */
+bool Anim_Active(void);
+
+/**
+ * Advance playback by `steps` frame slots (>= 1), decoding every frame that
+ * becomes due into the back buffer. Returns false once the clip has ended
+ * (loop = false) or turned out to be corrupt; playback stops in that case.
+ */
+bool Anim_Step(uint8_t steps);
+
+#endif /* ANIM_H */
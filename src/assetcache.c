@@ -0,0 +1,340 @@
+/* =============================================================================
+ * assetcache.c  -  SRAM copies of the assets the show plays most
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "assetcache.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "qflash.h"
+#include "sound.h"
+#include "loadtest.h"
+
+#define AC_ON       (ASSETCACHE_ENABLE && QFLASH_ENABLE)
+#define AC_STACK    (configMINIMAL_STACK_SIZE * 2u)
+
+_Static_assert((ASSETCACHE_BLOCK_BYTES % 4u) == 0u, "ASSETCACHE_BLOCK_BYTES: whole words");
+_Static_assert(ASSETCACHE_BLOCKS <= 255u && ASSETCACHE_ENTRIES <= 255u, "block and entry numbers are 8 bits");
+
+typedef enum
+{
+    AC_FREE = 0,
+    AC_FILLING,                         /* blocks claimed, the copy is running */
+    AC_READY
+} ac_state_t;
+
+typedef struct
+{
+    uint8_t  state;                     /* ac_state_t                   */
+    uint8_t  pins;                      /* AssetCache_Acquire() holders */
+    uint8_t  first;                     /* block                        */
+    uint8_t  blocks;
+    uint16_t index;                     /* asset table entry            */
+    uint8_t  kind;
+    uint8_t  id;
+    const uint8_t *flash;               /* its data in the QSPI window  */
+    uint32_t used;                      /* ac_clock at the last use     */
+} ac_entry_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static assetcache_stats_t ac_stats;
+
+#if AC_ON
+static uint8_t       ac_arena[ASSETCACHE_BLOCKS][ASSETCACHE_BLOCK_BYTES] __attribute__((aligned(4)));
+static uint8_t       ac_owner[ASSETCACHE_BLOCKS];           /* entry + 1, 0 = free */
+static ac_entry_t    ac_entry[ASSETCACHE_ENTRIES];
+static uint32_t      ac_clock;
+
+static StackType_t   ac_stack[AC_STACK];
+static StaticTask_t  ac_tcb;
+static QueueHandle_t ac_queue;
+static StaticQueue_t ac_queue_buf;
+static uint8_t       ac_queue_store[ASSETCACHE_QUEUE * sizeof(uint16_t)];
+
+/* The rest is called with interrupts masked */
+
+static ac_entry_t *ac_find(uint32_t index)
+{
+    for (uint32_t i = 0; i < ASSETCACHE_ENTRIES; i++)
+        if (ac_entry[i].state != AC_FREE && ac_entry[i].index == index) return &ac_entry[i];
+    return NULL;
+}
+
+/* The resident entry whose copy holds `p`, or NULL */
+static ac_entry_t *ac_owning(const uint8_t *p)
+{
+    uint32_t b;
+
+    if (p < &ac_arena[0][0] || p >= &ac_arena[ASSETCACHE_BLOCKS][0]) return NULL;
+    b = (uint32_t)(p - &ac_arena[0][0]) / ASSETCACHE_BLOCK_BYTES;
+    return (ac_owner[b] != 0u) ? &ac_entry[ac_owner[b] - 1u] : NULL;
+}
+
+/* First free run of n blocks, -1 if none */
+static int32_t ac_run(uint32_t n)
+{
+    uint32_t len = 0u;
+
+    for (uint32_t b = 0; b < ASSETCACHE_BLOCKS; b++)
+    {
+        len = (ac_owner[b] == 0u) ? len + 1u : 0u;
+        if (len == n) return (int32_t)(b + 1u - n);
+    }
+    return -1;
+}
+
+static ac_entry_t *ac_slot(void)
+{
+    for (uint32_t i = 0; i < ASSETCACHE_ENTRIES; i++)
+        if (ac_entry[i].state == AC_FREE) return &ac_entry[i];
+    return NULL;
+}
+
+/* Least recently used copy nobody holds, NULL if every one is pinned or filling */
+static ac_entry_t *ac_lru(void)
+{
+    ac_entry_t *v = NULL;
+
+    for (uint32_t i = 0; i < ASSETCACHE_ENTRIES; i++)
+    {
+        ac_entry_t *e = &ac_entry[i];
+
+        if (e->state == AC_READY && e->pins == 0u &&
+            (v == NULL || (ac_clock - e->used) > (ac_clock - v->used)))
+            v = e;
+    }
+    return v;
+}
+
+/* Clip back to the flash first: the mixer only runs between two of our steps */
+static void ac_evict(ac_entry_t *e)
+{
+    if (e->kind == ASSET_SOUND) (void)Assets_PlaceSound(e->id, ac_arena[e->first], e->flash);
+    for (uint32_t b = 0; b < e->blocks; b++) ac_owner[e->first + b] = 0u;
+    e->state = AC_FREE;
+    ac_stats.evictions++;
+}
+
+/* -- Cache task -------------------------------------------------------------- */
+
+/* Claim a run for `a`, evicting as needed; NULL if it does not fit or is there already */
+static ac_entry_t *ac_claim(uint32_t index, const asset_t *a)
+{
+    uint32_t    n = (a->size + ASSETCACHE_BLOCK_BYTES - 1u) / ASSETCACHE_BLOCK_BYTES;
+    ac_entry_t *e = NULL;
+
+    taskENTER_CRITICAL();
+    while (ac_find(index) == NULL)
+    {
+        int32_t     first = ac_run(n);
+        ac_entry_t *slot  = ac_slot();
+        ac_entry_t *v;
+
+        if (first >= 0 && slot != NULL)
+        {
+            e = slot;
+            e->state  = AC_FILLING;
+            e->pins   = 0u;
+            e->first  = (uint8_t)first;
+            e->blocks = (uint8_t)n;
+            e->index  = (uint16_t)index;
+            e->kind   = a->kind;
+            e->id     = a->id;
+            e->flash  = a->data;
+            for (uint32_t b = 0; b < n; b++) ac_owner[(uint32_t)first + b] = (uint8_t)(e - ac_entry + 1);
+            break;
+        }
+        v = ac_lru();
+        if (v == NULL)
+        {
+            ac_stats.too_big++;             /* everything left is pinned */
+            break;
+        }
+        ac_evict(v);
+    }
+    taskEXIT_CRITICAL();
+    return e;
+}
+
+static void ac_fill(uint32_t index)
+{
+    asset_t     a;
+    ac_entry_t *e;
+    bool        ok;
+
+    if (!Assets_Get(index, &a) || a.size == 0u) return;
+    if (a.size > sizeof(ac_arena))
+    {
+        taskENTER_CRITICAL();
+        ac_stats.too_big++;
+        taskEXIT_CRITICAL();
+        return;
+    }
+    e = ac_claim(index, &a);
+    if (e == NULL) return;
+
+    ok = QFlash_Read(ac_arena[e->first], (uint32_t)a.data - QFLASH_BASE, a.size);
+
+    taskENTER_CRITICAL();
+    if (!ok)
+    {
+        for (uint32_t b = 0; b < e->blocks; b++) ac_owner[e->first + b] = 0u;
+        e->state = AC_FREE;
+    }
+    else
+    {
+        e->state = AC_READY;
+        e->used  = ++ac_clock;
+        ac_stats.fills++;
+        if (e->kind == ASSET_SOUND) (void)Assets_PlaceSound(e->id, e->flash, ac_arena[e->first]);
+    }
+    taskEXIT_CRITICAL();
+}
+
+static void ac_task(void *arg)
+{
+    uint16_t index;
+
+    (void)arg;
+    for (;;)
+    {
+        if (xQueueReceive(ac_queue, &index, portMAX_DELAY) == pdPASS) ac_fill(index);
+    }
+}
+#endif /* AC_ON */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void AssetCache_Start(void)
+{
+#if AC_ON
+    ac_queue = xQueueCreateStatic(ASSETCACHE_QUEUE, sizeof(uint16_t), ac_queue_store, &ac_queue_buf);
+    LOADTEST_NAME(ac_queue, "assetcache");
+    (void)xTaskCreateStatic(ac_task, "ACache", AC_STACK, NULL, ASSETCACHE_TASK_PRIO, ac_stack, &ac_tcb);
+
+    /* The lid's own clips play on every scare: in before the first one */
+    for (uint8_t id = 0; id < SOUND_BUILTIN_COUNT; id++) AssetCache_PrefetchSound(id);
+#endif
+}
+
+void AssetCache_Prefetch(uint32_t index)
+{
+#if AC_ON
+    uint16_t    i = (uint16_t)index;
+    ac_entry_t *e;
+
+    if (ac_queue == NULL || index >= Assets_Count()) return;
+
+    taskENTER_CRITICAL();
+    e = ac_find(index);
+    if (e != NULL)
+    {
+        e->used = ++ac_clock;
+        if (e->state == AC_READY) ac_stats.hits++;
+    }
+    else
+    {
+        ac_stats.misses++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (e == NULL && xQueueSend(ac_queue, &i, 0) != pdPASS)
+    {
+        taskENTER_CRITICAL();
+        ac_stats.dropped++;
+        taskEXIT_CRITICAL();
+    }
+#else
+    (void)index;
+#endif
+}
+
+void AssetCache_PrefetchSound(uint8_t id)
+{
+    asset_t a;
+
+    /* From the end: with two entries for one id, Assets_Init() registered the last */
+    for (uint32_t i = Assets_Count(); i-- != 0u; )
+    {
+        if (Assets_Get(i, &a) && a.kind == ASSET_SOUND && a.id == id)
+        {
+            AssetCache_Prefetch(i);
+            return;
+        }
+    }
+}
+
+bool AssetCache_Acquire(uint32_t index, asset_t *out)
+{
+    if (!Assets_Get(index, out)) return false;
+#if AC_ON
+    ac_entry_t *e;
+    bool        hit;
+
+    taskENTER_CRITICAL();
+    e   = ac_find(index);
+    hit = (e != NULL && e->state == AC_READY);
+    if (hit)
+    {
+        out->data = ac_arena[e->first];
+        e->pins++;
+        e->used = ++ac_clock;
+        ac_stats.hits++;
+    }
+    taskEXIT_CRITICAL();
+
+    /* A miss plays from the flash this time and from SRAM the next */
+    if (!hit) AssetCache_Prefetch(index);
+#endif
+    return true;
+}
+
+void AssetCache_Release(const asset_t *a)
+{
+#if AC_ON
+    ac_entry_t *e;
+
+    taskENTER_CRITICAL();
+    e = ac_owning(a->data);
+    if (e != NULL && e->pins != 0u) e->pins--;
+    taskEXIT_CRITICAL();
+#else
+    (void)a;
+#endif
+}
+
+bool AssetCache_Resident(uint32_t index)
+{
+#if AC_ON
+    ac_entry_t *e;
+    bool        r;
+
+    taskENTER_CRITICAL();
+    e = ac_find(index);
+    r = (e != NULL && e->state == AC_READY);
+    taskEXIT_CRITICAL();
+    return r;
+#else
+    (void)index;
+    return false;
+#endif
+}
+
+void AssetCache_GetStats(assetcache_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = ac_stats;
+#if AC_ON
+    out->blocks_used = 0u;
+    out->resident    = 0u;
+    for (uint32_t i = 0; i < ASSETCACHE_ENTRIES; i++)
+    {
+        if (ac_entry[i].state != AC_READY) continue;
+        out->blocks_used = (uint16_t)(out->blocks_used + ac_entry[i].blocks);
+        out->resident++;
+    }
+#endif
+    taskEXIT_CRITICAL();
+}
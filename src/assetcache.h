@@ -0,0 +1,95 @@
+/* =============================================================================
+ * assetcache.h  -  SRAM copies of the assets the show plays most
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Assets play straight from the QSPI window (assets.h), and a read there
+ * costs whatever the chip and the CMCC make of it: a clip heard a hundred
+ * times a night still waits on the flash every time, more so while the SD
+ * card, a streamed animation or an update holds the bus. This cache keeps
+ * copies of the frequently played ones in internal SRAM, in the RAM that
+ * static allocation freed from the heap_1 arena (configTOTAL_HEAP_SIZE is
+ * 4 KB now, it was 40).
+ *
+ *   Blocks    ASSETCACHE_BLOCKS blocks of ASSETCACHE_BLOCK_BYTES; an asset
+ *             takes a contiguous run of them (first fit), so consumers keep
+ *             a plain pointer. Assets larger than the whole arena are never
+ *             cached ("acache" counts them as too big).
+ *   LRU       when no run is free, the least recently used unpinned asset
+ *             goes, then the next, until one is. Every prefetch or acquire
+ *             of a resident asset makes it the most recent.
+ *   Prefetch  AssetCache_Prefetch() queues an asset for the "ACache" task,
+ *             which copies it with QFlash_Read() (DMA, BULK class) while it
+ *             sleeps. Upcoming cues call it ahead of their start: the
+ *             actuator for every SOUND step of a table when it is started
+ *             or cued at a later show time, showsync.c for a network sound
+ *             cue, and the built-in clips are loaded at start.
+ *
+ * Sound clips swap over on their own: once a copy is in, the clip
+ * registered for its id (assets.c) points to it, and back to the flash
+ * before the copy is evicted. The mixer runs above the cache task, so it
+ * never sees a block change under a mix. Anything else that holds on to
+ * the data (Anim_Start()) takes it with AssetCache_Acquire(), which pins
+ * the copy until AssetCache_Release().
+ *
+ * A cue on a resident asset counts as a hit, one that had to be fetched as
+ * a miss, so "acache" shows whether the arena is large enough.
+ * ============================================================================= */
+
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "assets.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef ASSETCACHE_ENABLE
+#define ASSETCACHE_ENABLE       1       /* with QFLASH_ENABLE                   */
+#endif
+#define ASSETCACHE_BLOCK_BYTES  2048u   /* multiple of 4: word DMA beats        */
+#define ASSETCACHE_BLOCKS       16u     /* 32 KB of the 36 KB the heap gave up  */
+#define ASSETCACHE_ENTRIES      8u      /* assets resident at once              */
+#define ASSETCACHE_QUEUE        8u      /* prefetches waiting for the task      */
+#define ASSETCACHE_TASK_PRIO    2u      /* with Stream: below the mixer         */
+
+typedef struct
+{
+    uint32_t hits;              /* prefetch or acquire found it resident */
+    uint32_t misses;            /* ...had to fetch it                    */
+    uint32_t fills;             /* copies made                           */
+    uint32_t evictions;
+    uint32_t too_big;           /* larger than the arena, or all pinned  */
+    uint32_t dropped;           /* prefetch queue full                   */
+    uint16_t blocks_used;
+    uint8_t  resident;          /* assets in SRAM now                    */
+} assetcache_stats_t;
+
+/**
+ * Create the queue and the task (static) and queue the built-in sound
+ * clips. After Assets_Init(), before the scheduler. No-op without
+ * QFLASH_ENABLE.
+ */
+void AssetCache_Start(void);
+
+/** Copy asset `index` into SRAM unless it is there already. Any task, never blocks. */
+void AssetCache_Prefetch(uint32_t index);
+
+/** AssetCache_Prefetch() for the sound asset with cue id `id`, if any. Any task. */
+void AssetCache_PrefetchSound(uint8_t id);
+
+/**
+ * Entry `index` as Assets_Get(), its data pointing to the SRAM copy when
+ * there is one, which then stays until AssetCache_Release(). Any task.
+ */
+bool AssetCache_Acquire(uint32_t index, asset_t *out);
+
+/** Done with `a` from AssetCache_Acquire(): unpins its copy, if it had one. Any task. */
+void AssetCache_Release(const asset_t *a);
+
+/** Asset `index` is in SRAM now. Any task. */
+bool AssetCache_Resident(uint32_t index);
+
+/** Counters since boot and the arena now. Any task. */
+void AssetCache_GetStats(assetcache_stats_t *out);
+
+#endif /* ASSETCACHE_H */
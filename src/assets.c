@@ -0,0 +1,111 @@
+/* =============================================================================
+ * assets.c  -  Asset table in the QSPI flash: animations and sound clips
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "assets.h"
+#include <string.h>
+#include "qflash.h"
+#include "sound.h"
+#include "adpcm.h"
+
+#define ASSETS_HEADER_BYTES 8u
+#define ASSETS_ENTRY_BYTES  32u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const uint8_t *assets_table;             /* first entry, mapped */
+static uint32_t       assets_count;
+
+/* Sound_Register() keeps the pointer, so the clips live here */
+static sound_clip_t   assets_clips[SOUND_CLIPS];
+
+static uint16_t assets_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t assets_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void assets_decode(const uint8_t *e, asset_t *out)
+{
+    memcpy(out->name, e, ASSETS_NAME_LEN);
+    out->name[ASSETS_NAME_LEN] = '\0';
+    out->kind = e[20];
+    out->id   = e[21];
+    out->size = assets_u32(&e[28]);
+    out->data = QFlash_Map(assets_u32(&e[24]));
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+uint32_t Assets_Init(void)
+{
+    const uint8_t *h = QFlash_Map(0u);
+    qflash_info_t  info;
+    uint32_t       n;
+
+    assets_count = 0u;
+    if (h == NULL || assets_u32(h) != ASSETS_MAGIC || assets_u16(&h[4]) != ASSETS_VERSION)
+        return 0u;
+
+    QFlash_GetInfo(&info);
+    n = assets_u16(&h[6]);
+    if (n > ASSETS_MAX) n = ASSETS_MAX;
+    assets_table = h + ASSETS_HEADER_BYTES;
+
+    /* Entries are checked in order; the first one pointing off the chip ends the table */
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const uint8_t *e   = assets_table + i * ASSETS_ENTRY_BYTES;
+        uint32_t       off = assets_u32(&e[24]);
+        uint32_t       len = assets_u32(&e[28]);
+        asset_t        a;
+
+        if (off > info.size || len > info.size - off) break;
+        assets_count = i + 1u;
+
+        assets_decode(e, &a);
+        if (a.kind == ASSET_SOUND && a.id < SOUND_CLIPS)
+        {
+            assets_clips[a.id].pcm = (const int8_t *)a.data;
+            assets_clips[a.id].fmt = (e[22] == SOUND_FMT_ADPCM) ? SOUND_FMT_ADPCM : SOUND_FMT_PCM8;
+            assets_clips[a.id].len = (assets_clips[a.id].fmt == SOUND_FMT_ADPCM) ? Adpcm_Samples(a.size) : a.size;
+            (void)Sound_Register(a.id, &assets_clips[a.id]);
+        }
+    }
+    return assets_count;
+}
+
+uint32_t Assets_Count(void)
+{
+    return assets_count;
+}
+
+bool Assets_Get(uint32_t index, asset_t *out)
+{
+    if (index >= assets_count) return false;
+    assets_decode(assets_table + index * ASSETS_ENTRY_BYTES, out);
+    return true;
+}
+
+bool Assets_Find(const char *name, asset_t *out)
+{
+    for (uint32_t i = 0; i < assets_count; i++)
+    {
+        const uint8_t *e = assets_table + i * ASSETS_ENTRY_BYTES;
+
+        if (strncmp((const char *)e, name, ASSETS_NAME_LEN) == 0)
+        {
+            assets_decode(e, out);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Assets_PlaceSound(uint8_t id, const uint8_t *from, const uint8_t *to)
+{
+    if (id >= SOUND_CLIPS || assets_clips[id].pcm != (const int8_t *)from) return false;
+    assets_clips[id].pcm = (const int8_t *)to;
+    return true;
+}
@@ -0,0 +1,76 @@
+/* =============================================================================
+ * assets.h  -  Asset table in the QSPI flash: animations and sound clips
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * tools/mkassets.py packs anim.h clips and WAV files into one image that is
+ * programmed into the chip from offset 0. The image starts with a table:
+ *
+ *   header   'C' 'R' 'A' 'S'  version(u16)  count(u16)
+ *   entry    name[20] kind(u8) id(u8) fmt(u8) reserved(u8) offset(u32) size(u32)
+ *
+ * count entries of 32 bytes follow the 8-byte header, all little-endian;
+ * offset is from the start of the chip, name is NUL-padded. The data is
+ * never copied: an asset's data pointer is its QFlash_Map() address, so
+ * Anim_Start(a.data, a.size, loop) plays an animation straight from the
+ * chip, and each ASSET_SOUND entry (8-bit mono at SOUND_RATE_HZ, the
+ * wav2clip.py format, or with fmt SOUND_FMT_ADPCM the adpcm.h blocks of
+ * mkassets.py --adpcm) is registered with Sound_Register() under its id, so
+ * the mixer reads the samples from the chip as they play, or from the
+ * SRAM copy assetcache.h keeps of it (Assets_PlaceSound()). An ASSET_SHOW
+ * entry is a tools/mkshow.py cue stream, played by showscript.h, an
+ * ASSET_PLUGIN entry an effect plug-in, copied to SRAM by plugin.h.
+ * ============================================================================= */
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ASSETS_MAGIC        0x53415243u     /* "CRAS" */
+#define ASSETS_VERSION      1u
+#define ASSETS_MAX          64u             /* entries read; more are ignored */
+#define ASSETS_NAME_LEN     20u
+
+typedef enum
+{
+    ASSET_RAW = 0,                      /* opaque bytes             */
+    ASSET_ANIM,                         /* anim.h clip              */
+    ASSET_SOUND,                        /* sound clip, id = cue id  */
+    ASSET_SHOW,                         /* showscript.h cue stream  */
+    ASSET_PLUGIN                        /* plugin.h effect image    */
+} asset_kind_t;
+
+typedef struct
+{
+    char           name[ASSETS_NAME_LEN + 1u];
+    const uint8_t *data;                /* mapped, in the QSPI window */
+    uint32_t       size;
+    uint8_t        kind;                /* asset_kind_t               */
+    uint8_t        id;
+} asset_t;
+
+/**
+ * Read and check the table, and register every sound asset with
+ * Sound_Register(). After QFlash_Init(), before Sound_Start(). Returns the
+ * number of valid entries, 0 with no chip or no table.
+ */
+uint32_t Assets_Init(void);
+
+/** Valid entries found by Assets_Init(). */
+uint32_t Assets_Count(void);
+
+/** Entry `index` (< Assets_Count()); false if out of range. */
+bool Assets_Get(uint32_t index, asset_t *out);
+
+/** Entry called `name`; false if there is none. */
+bool Assets_Find(const char *name, asset_t *out);
+
+/**
+ * Point the clip registered for sound `id` from `from` to `to`, the same
+ * samples elsewhere; false (unchanged) if it is not at `from`. One word
+ * written, so a voice playing it carries on. Any context.
+ */
+bool Assets_PlaceSound(uint8_t id, const uint8_t *from, const uint8_t *to);
+
+#endif /* ASSETS_H */
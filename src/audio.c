@@ -0,0 +1,420 @@
+/* =============================================================================
+ * audio.c  -  Microphone spectrum and beat detection for audio-reactive effects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "audio.h"
+#include "definitions.h"        /* core_cm4.h: DWT, __RBIT, __DMB; plib_dmac.h */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "neopixel.h"
+#include "pixdist.h"
+#include "palette.h"
+#include "fastmath.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "rtos_trace.h"
+#include "cache.h"            /* CACHE_HOT */
+#include <string.h>
+
+#if AUDIO_FFT_N != 256u
+#error "the band edges below are laid out for AUDIO_FFT_N = 256"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Published copy, buf[seq & 1]; the Audio task is the only writer */
+static struct
+{
+    volatile uint32_t seq;
+    audio_levels_t    buf[2];
+} audio_pub;
+
+/* Effect side: NeoPixel task only */
+static audio_levels_t audio_fx;
+static uint8_t        audio_fx_pulse;
+
+#if AUDIO_ENABLE
+
+/* First bin of every band and the end of the last: 61 Hz bins, roughly
+ * half an octave to an octave each, 61 Hz .. 7.8 kHz */
+static const uint8_t audio_band_edge[AUDIO_BANDS + 1u] = { 1, 2, 4, 7, 12, 20, 34, 58, 128 };
+
+#define AUDIO_STACK         (configMINIMAL_STACK_SIZE * 2u)
+
+static StackType_t   audio_stack[AUDIO_STACK];
+static StaticTask_t  audio_tcb;
+static TaskHandle_t  audio_task_handle;
+
+/* DMA ring: the DMAC fills one half while the task reads the other */
+static uint16_t      audio_buf[2][AUDIO_FFT_N] DMA_RAM;
+static dmac_descriptor_registers_t audio_desc1 DMA_RAM __ALIGNED(16);
+static volatile uint32_t audio_done;            /* halves completed, ISR */
+
+/* FFT work area and tables, Audio task only */
+static int16_t       audio_re[AUDIO_FFT_N];
+static int16_t       audio_im[AUDIO_FFT_N];
+static int16_t       audio_window[AUDIO_FFT_N];
+static int16_t       audio_cos[AUDIO_FFT_N / 2u];
+static int16_t       audio_sin[AUDIO_FFT_N / 2u];
+
+static uint32_t      audio_peak_q8;             /* AGC peak, log2 x 256 */
+static uint32_t      audio_bass_avg_q8;
+static TickType_t    audio_last_beat;
+static audio_levels_t audio_out;
+
+static volatile uint32_t audio_cycles_max;
+static volatile uint32_t audio_over_budget;
+static volatile uint32_t audio_overruns;
+
+/* -- ISR --------------------------------------------------------------------- */
+
+/* A half is full (dma_qos.c DMAC_OTHER dispatch) */
+static void audio_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) != 0u)
+    {
+        audio_done++;
+        RTOS_TRACE_DMA_EVENT(AUDIO_DMA_CHANNEL, 1u);
+        vTaskNotifyGiveFromISR(audio_task_handle, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/* -- Analysis ---------------------------------------------------------------- */
+
+/* log2(x) in 1/16 steps, 0 for x = 0 */
+static uint32_t audio_log2_q4(uint64_t x)
+{
+    uint32_t hi = (uint32_t)(x >> 32);
+    uint32_t n  = (hi != 0u) ? 63u - (uint32_t)__CLZ(hi) : 31u - (uint32_t)__CLZ((uint32_t)x);
+
+    if (x == 0u) return 0u;
+    return n * 16u + (uint32_t)(((n >= 4u) ? (x >> (n - 4u)) : (x << (4u - n))) & 0xFu);
+}
+
+/* In place, e^(-j 2 pi k n / N), scaled by 1/N (1/2 per stage) */
+static void audio_fft(int16_t *re, int16_t *im)
+{
+    for (uint32_t i = 0; i < AUDIO_FFT_N; i++)
+    {
+        uint32_t j = __RBIT(i) >> (32u - AUDIO_FFT_LOG2);
+
+        if (j > i)
+        {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint32_t half = 1u, step = AUDIO_FFT_N / 2u; half < AUDIO_FFT_N; half <<= 1, step >>= 1)
+    {
+        for (uint32_t k = 0; k < half; k++)
+        {
+            int32_t wr = audio_cos[k * step];
+            int32_t wi = -audio_sin[k * step];
+
+            for (uint32_t i = k; i < AUDIO_FFT_N; i += 2u * half)
+            {
+                uint32_t j  = i + half;
+                int32_t  tr = (wr * re[j] - wi * im[j]) >> 15;
+                int32_t  ti = (wr * im[j] + wi * re[j]) >> 15;
+                int32_t  ar = re[i];
+                int32_t  ai = im[i];
+
+                re[j] = (int16_t)((ar - tr) >> 1);
+                im[j] = (int16_t)((ai - ti) >> 1);
+                re[i] = (int16_t)((ar + tr) >> 1);
+                im[i] = (int16_t)((ai + ti) >> 1);
+            }
+        }
+    }
+}
+
+/* Log value relative to the AGC peak, 0-255 over AUDIO_RANGE_Q4 */
+static uint8_t audio_scale(uint32_t l_q4, uint32_t peak_q4)
+{
+    uint32_t floor = peak_q4 - AUDIO_RANGE_Q4;
+
+    if (l_q4 <= floor) return 0u;
+    l_q4 -= floor;
+    return (uint8_t)((l_q4 >= AUDIO_RANGE_Q4) ? 255u : l_q4 * 255u / AUDIO_RANGE_Q4);
+}
+
+static void audio_analyse(const uint16_t *s)
+{
+    uint64_t band[AUDIO_BANDS];
+    uint64_t total = 0u;
+    uint32_t sum   = 0u;
+    uint32_t peak_q4, bass_q4, mean, l;
+    TickType_t now = xTaskGetTickCount();
+
+    /* 1. DC out, 12 bits to +-2^14 (no overflow in any stage), window */
+    for (uint32_t i = 0; i < AUDIO_FFT_N; i++) sum += s[i];
+    mean = sum / AUDIO_FFT_N;
+    for (uint32_t i = 0; i < AUDIO_FFT_N; i++)
+    {
+        int32_t x = ((int32_t)s[i] - (int32_t)mean) << 3;
+
+        if (x >  16383) x =  16383;
+        if (x < -16384) x = -16384;
+        audio_re[i] = (int16_t)((x * audio_window[i]) >> 15);
+        audio_im[i] = 0;
+    }
+
+    /* 2. */
+    audio_fft(audio_re, audio_im);
+
+    /* 3. Bins 1..N/2-1: the upper half mirrors them */
+    for (uint32_t b = 0; b < AUDIO_BANDS; b++)
+    {
+        band[b] = 0u;
+        for (uint32_t k = audio_band_edge[b]; k < audio_band_edge[b + 1u]; k++)
+            band[b] += (uint64_t)((int32_t)audio_re[k] * audio_re[k] + (int32_t)audio_im[k] * audio_im[k]);
+        total += band[b];
+    }
+
+    /* 4. AGC peak follows the loudest band up at once, down slowly */
+    peak_q4 = 0u;
+    for (uint32_t b = 0; b < AUDIO_BANDS; b++)
+    {
+        l = audio_log2_q4(band[b]);
+        if (l > peak_q4) peak_q4 = l;
+    }
+    if (peak_q4 * 16u > audio_peak_q8)         audio_peak_q8 = peak_q4 * 16u;
+    else if (audio_peak_q8 > AUDIO_AGC_DECAY)  audio_peak_q8 -= AUDIO_AGC_DECAY;
+    if (audio_peak_q8 < AUDIO_GATE_Q4 * 16u)   audio_peak_q8 = AUDIO_GATE_Q4 * 16u;
+    peak_q4 = audio_peak_q8 / 16u;
+
+    for (uint32_t b = 0; b < AUDIO_BANDS; b++)
+        audio_out.band[b] = audio_scale(audio_log2_q4(band[b]), peak_q4);
+    l = audio_log2_q4(total);                    /* sum of 8 bands: 3 octaves above one */
+    audio_out.level = audio_scale((l > 48u) ? l - 48u : 0u, peak_q4);
+
+    /* 5. Bass (the two lowest bands) against its own running average */
+    bass_q4 = audio_log2_q4(band[0] + band[1]);
+    audio_out.beat = bass_q4 * 16u > audio_bass_avg_q8 + AUDIO_BEAT_Q4 * 16u
+                  && bass_q4 > AUDIO_GATE_Q4
+                  && (now - audio_last_beat) >= pdMS_TO_TICKS(AUDIO_BEAT_HOLD_MS);
+    if (audio_out.beat)
+    {
+        audio_last_beat = now;
+        audio_out.beats++;
+    }
+    audio_bass_avg_q8 += (bass_q4 * 16u) / AUDIO_BEAT_AVG;
+    audio_bass_avg_q8 -= audio_bass_avg_q8 / AUDIO_BEAT_AVG;
+    audio_out.seq++;
+}
+
+static void audio_publish(void)
+{
+    uint32_t s = audio_pub.seq;
+
+    audio_pub.buf[(s + 1u) & 1u] = audio_out;
+    __DMB();
+    audio_pub.seq = s + 1u;
+}
+
+static void audio_task(void *arg)
+{
+    uint32_t seen = 0u;
+
+    (void)arg;
+    for (;;)
+    {
+        (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t done = audio_done;
+        uint32_t t0;
+
+        if (done - seen > 1u) audio_overruns += done - seen - 1u;
+        seen = done;
+
+        /* Half (done - 1) & 1 just completed; the DMAC is on the other */
+        t0 = DWT->CYCCNT;
+        audio_analyse(audio_buf[(done - 1u) & 1u]);
+        t0 = DWT->CYCCNT - t0;
+        if (t0 > audio_cycles_max) audio_cycles_max = t0;
+        if (t0 > AUDIO_BUDGET_CYCLES) audio_over_budget++;
+
+        audio_publish();
+    }
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+static inline void audio_adc_sync(uint32_t mask)
+{
+    while ((ADC1_REGS->ADC_SYNCBUSY & mask) != 0u) {}
+}
+
+/* Two descriptors, each one half, linked in a ring; interrupt per half */
+static void audio_dma_init(void)
+{
+    dmac_descriptor_registers_t *desc0 =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + AUDIO_DMA_CHANNEL;
+    const uint16_t btctrl = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_HWORD
+                          | DMAC_BTCTRL_DSTINC_Msk | DMAC_BTCTRL_BLOCKACT_INT;
+
+    desc0->DMAC_BTCTRL   = btctrl;
+    desc0->DMAC_BTCNT    = AUDIO_FFT_N;
+    desc0->DMAC_SRCADDR  = (uint32_t)&ADC1_REGS->ADC_RESULT;
+    desc0->DMAC_DSTADDR  = (uint32_t)&audio_buf[0][AUDIO_FFT_N];     /* end address with DSTINC */
+    desc0->DMAC_DESCADDR = (uint32_t)&audio_desc1;
+
+    audio_desc1.DMAC_BTCTRL   = btctrl;
+    audio_desc1.DMAC_BTCNT    = AUDIO_FFT_N;
+    audio_desc1.DMAC_SRCADDR  = (uint32_t)&ADC1_REGS->ADC_RESULT;
+    audio_desc1.DMAC_DSTADDR  = (uint32_t)&audio_buf[1][AUDIO_FFT_N];
+    audio_desc1.DMAC_DESCADDR = (uint32_t)desc0;
+
+    DMAC_REGS->CHANNEL[AUDIO_DMA_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(ADC1_DMAC_ID_RESRDY) | DMAC_CHCTRLA_TRIGACT_BURST;   /* one beat per result */
+    Dma_Assign(AUDIO_DMA_CHANNEL, DMA_CLASS_STREAM);
+    (void)Dma_OtherRegister(AUDIO_DMA_CHANNEL, audio_dma_isr);
+    DMAC_REGS->CHANNEL[AUDIO_DMA_CHANNEL].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk;
+    DMAC_REGS->CHANNEL[AUDIO_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+}
+
+static void audio_adc_init(void)
+{
+    uint32_t sw0 = SW0_FUSES_REGS->FUSES_SW0_WORD_0;
+
+    /* ADC1 on GCLK3 (48 MHz) / 4 = 12 MHz, like ADC0 in motor_sense.c */
+    MCLK_REGS->MCLK_APBDMASK |= MCLK_APBDMASK_ADC1_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[ADC1_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK3 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[ADC1_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    ADC1_REGS->ADC_CTRLA = ADC_CTRLA_SWRST_Msk;
+    audio_adc_sync(ADC_SYNCBUSY_SWRST_Msk);
+
+    ADC1_REGS->ADC_CALIB =
+        ADC_CALIB_BIASCOMP((sw0 & FUSES_SW0_WORD_0_ADC1_BIASCOMP_Msk) >> FUSES_SW0_WORD_0_ADC1_BIASCOMP_Pos)
+      | ADC_CALIB_BIASR2R((sw0 & FUSES_SW0_WORD_0_ADC1_BIASR2R_Msk) >> FUSES_SW0_WORD_0_ADC1_BIASR2R_Pos)
+      | ADC_CALIB_BIASREFBUF((sw0 & FUSES_SW0_WORD_0_ADC1_BIASREFBUF_Msk) >> FUSES_SW0_WORD_0_ADC1_BIASREFBUF_Pos);
+
+    /* One START event = 4 averaged conversions (~5 us), 12-bit result */
+    ADC1_REGS->ADC_CTRLA     = ADC_CTRLA_PRESCALER_DIV4;
+    ADC1_REGS->ADC_REFCTRL   = ADC_REFCTRL_REFSEL(ADC_REFCTRL_REFSEL_INTVCC1_Val);
+    ADC1_REGS->ADC_INPUTCTRL = ADC_INPUTCTRL_MUXPOS(6u) | ADC_INPUTCTRL_MUXNEG_GND;    /* AIN6 */
+    ADC1_REGS->ADC_AVGCTRL   = ADC_AVGCTRL_SAMPLENUM(ADC_AVGCTRL_SAMPLENUM_4_Val) | ADC_AVGCTRL_ADJRES(2u);
+    ADC1_REGS->ADC_SAMPCTRL  = ADC_SAMPCTRL_SAMPLEN(3u);
+    ADC1_REGS->ADC_CTRLB     = ADC_CTRLB_RESSEL_16BIT;
+    ADC1_REGS->ADC_EVCTRL    = ADC_EVCTRL_STARTEI_Msk;
+    audio_adc_sync(ADC_SYNCBUSY_Msk);
+
+    /* PB04 -> peripheral B (analog) */
+    PORT_REGS->GROUP[1].PORT_PMUX[4u >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[1].PORT_PMUX[4u >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(1u));
+    PORT_REGS->GROUP[1].PORT_PINCFG[4] = PORT_PINCFG_PMUXEN_Msk;
+
+    ADC1_REGS->ADC_CTRLA |= ADC_CTRLA_ENABLE_Msk;
+    audio_adc_sync(ADC_SYNCBUSY_ENABLE_Msk);
+}
+
+/* TC5 overflow every AUDIO_RATE_DIV us -> EVSYS -> ADC1 START */
+static void audio_timer_init(void)
+{
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_TC5_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TC5_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;   /* shared with TC4 */
+    while ((GCLK_REGS->GCLK_PCHCTRL[TC5_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_ADC1_START] = EVSYS_USER_CHANNEL(AUDIO_EVSYS_CHANNEL + 1u);
+    EVSYS_REGS->CHANNEL[AUDIO_EVSYS_CHANNEL].EVSYS_CHANNEL =
+        EVSYS_CHANNEL_EVGEN(EVENT_ID_GEN_TC5_OVF) | EVSYS_CHANNEL_PATH(2U);      /* asynchronous */
+
+    TC5_REGS->COUNT16.TC_CTRLA = TC_CTRLA_SWRST_Msk;
+    while ((TC5_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TC5_REGS->COUNT16.TC_CTRLA = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1;
+    TC5_REGS->COUNT16.TC_WAVE  = TC_WAVE_WAVEGEN_MFRQ;
+    TC5_REGS->COUNT16.TC_CC[0] = AUDIO_RATE_DIV - 1u;
+    TC5_REGS->COUNT16.TC_EVCTRL = TC_EVCTRL_OVFEO_Msk;
+    while ((TC5_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_CC0_Msk) != 0u) {}
+    TC5_REGS->COUNT16.TC_CTRLA |= TC_CTRLA_ENABLE_Msk;
+    while ((TC5_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+}
+
+#endif /* AUDIO_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Audio_Start(void)
+{
+#if AUDIO_ENABLE
+    for (uint32_t i = 0; i < AUDIO_FFT_N; i++)
+    {
+        uint16_t a = (uint16_t)(i * (65536u / AUDIO_FFT_N));
+
+        audio_window[i] = (int16_t)((32767 - Math_Cos16(a)) >> 1);          /* Hann */
+        if (i < AUDIO_FFT_N / 2u)
+        {
+            audio_cos[i] = Math_Cos16(a);
+            audio_sin[i] = Math_Sin16(a);
+        }
+    }
+
+    audio_task_handle = xTaskCreateStatic(audio_task, "Audio", AUDIO_STACK, NULL, AUDIO_TASK_PRIO,
+                                          audio_stack, &audio_tcb);
+    audio_adc_init();
+    audio_dma_init();
+    audio_timer_init();                         /* first conversion from here */
+#endif
+}
+
+void Audio_Read(audio_levels_t *out)
+{
+    uint32_t s;
+
+    do {
+        s = audio_pub.seq;
+        __DMB();
+        *out = audio_pub.buf[s & 1u];
+        __DMB();
+    } while (s != audio_pub.seq);
+}
+
+#if AUDIO_ENABLE
+uint32_t Audio_CyclesMax(void)  { return audio_cycles_max; }
+uint32_t Audio_OverBudget(void) { return audio_over_budget; }
+uint32_t Audio_Overruns(void)   { return audio_overruns; }
+#else
+uint32_t Audio_CyclesMax(void)  { return 0u; }
+uint32_t Audio_OverBudget(void) { return 0u; }
+uint32_t Audio_Overruns(void)   { return 0u; }
+#endif
+
+uint32_t Audio_Beats(void)
+{
+    audio_levels_t a;
+
+    Audio_Read(&a);
+    return a.beats;
+}
+
+/* -- Effect ------------------------------------------------------------------ */
+
+bool Audio_Update(uint8_t steps)
+{
+    uint32_t seq = audio_fx.seq;
+
+    Audio_Read(&audio_fx);
+    if (audio_fx.seq != seq && audio_fx.beat)
+        audio_fx_pulse = 255u;
+    else
+        audio_fx_pulse = (audio_fx_pulse > AUDIO_FX_PULSE_DECAY * steps)
+                       ? (uint8_t)(audio_fx_pulse - AUDIO_FX_PULSE_DECAY * steps) : 0u;
+    return audio_fx.seq != seq || audio_fx_pulse != 0u;
+}
+
+pix_t CACHE_HOT Audio_Pixel(uint16_t i, uint8_t offset)
+{
+    uint32_t b = ((uint32_t)i * AUDIO_BANDS) / PIXDIST_SCENE_LEDS;
+    pix_t    p;
+
+    (void)offset;
+    if (b >= AUDIO_BANDS) b = AUDIO_BANDS - 1u;
+    p = Pix_Scale(Palette_Lookup(PALETTE_RAINBOW, (uint8_t)(b * (256u / AUDIO_BANDS))), audio_fx.band[b]);
+    return Pix_AddSat(p, Pix_Make(audio_fx_pulse >> 2, audio_fx_pulse >> 2, audio_fx_pulse >> 2));
+}
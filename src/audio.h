@@ -0,0 +1,106 @@
+/* =============================================================================
+ * audio.h  -  Microphone spectrum and beat detection for audio-reactive effects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * An amplified electret microphone (MAX4466 / MAX9814 style, output biased
+ * at mid-supply) feeds PB04 (ADC1 AIN6). The CPU takes no part in sampling:
+ *
+ *   TC5 overflow (GCLK2 1 MHz / 64 = 15625 Hz)
+ *     -> EVSYS AUDIO_EVSYS_CHANNEL -> ADC1 START
+ *     -> ADC1 RESRDY -> DMAC AUDIO_DMA_CHANNEL -> ping-pong buffer
+ *
+ * Two linked descriptors fill the halves in turn; every completed half
+ * (AUDIO_FFT_N samples, 16.4 ms) raises one DMAC interrupt that wakes the
+ * "Audio" task, which meanwhile owns that half:
+ *
+ *   1. remove DC (block mean), scale to Q15 headroom, Hann window
+ *   2. AUDIO_FFT_N point radix-2 complex FFT, Q15 with a 1/2 scale per
+ *      stage so nothing can overflow
+ *   3. power summed into AUDIO_BANDS log-spaced bands, log2 in 1/16 steps
+ *   4. automatic gain: each band relative to a slowly decaying peak over
+ *      AUDIO_RANGE_Q4 (~36 dB), gated below AUDIO_GATE_Q4
+ *   5. beat: bass energy AUDIO_BEAT_Q4 above its running average, at most
+ *      once per AUDIO_BEAT_HOLD_MS
+ *
+ * The result is published lock-free (one writer, seq flip like metrics.h)
+ * and read with Audio_Read() by any task; the "audio" effect (effects.h)
+ * draws it as a spectrum with a flash on every beat.
+ *
+ * Budget: AUDIO_BUDGET_CYCLES per block, ~2 % of the CPU at 120 MHz
+ * (measured around steps 1-5 with DWT; a block that takes longer is
+ * counted in Audio_OverBudget(), the worst one in Audio_CyclesMax(), both
+ * on telemetry). A block not processed before the next half completes is
+ * counted by Audio_Overruns().
+ *
+ * The CMSIS pack in this tree carries CMSIS-Core only, not CMSIS-DSP, so
+ * the FFT is the small fixed-point one in audio.c; arm_cfft_q15() is a
+ * drop-in for audio_fft() if the DSP library is ever added.
+ *
+ * The DMAC descriptor table (ATSAME51J20A.ld) has a slot for channel 4, which
+ * the MCC configuration does not use; its interrupt comes through
+ * Dma_OtherRegister() (dma_qos.h).
+ * ============================================================================= */
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define AUDIO_ENABLE            0       /* 1 = build and start the pipeline (mic on PB04) */
+#define AUDIO_FFT_LOG2          8u
+#define AUDIO_FFT_N             (1u << AUDIO_FFT_LOG2)   /* samples per block   */
+#define AUDIO_RATE_DIV          64u     /* TC5: 1 MHz / 64 = 15625 Hz, 61 Hz bins */
+#define AUDIO_BANDS             8u
+#define AUDIO_RANGE_Q4          96u     /* log2 x 16: 6 octaves of power, ~36 dB */
+#define AUDIO_GATE_Q4           256u    /* peaks below this count as silence     */
+#define AUDIO_AGC_DECAY         4u      /* peak fall per block, log2 / 256 units */
+#define AUDIO_BEAT_Q4           8u      /* bass 1.4x (3 dB) above its average    */
+#define AUDIO_BEAT_AVG          32u     /* average over ~0.5 s of blocks         */
+#define AUDIO_BEAT_HOLD_MS      250u    /* shortest beat interval (240 bpm)      */
+#define AUDIO_BUDGET_CYCLES     40000u  /* per block; 16.4 ms = 1.97 M cycles    */
+#define AUDIO_TASK_PRIO         2u      /* below NeoPixel, above the shell      */
+#define AUDIO_DMA_CHANNEL       4u      /* outside the MCC channels, see above   */
+#define AUDIO_EVSYS_CHANNEL     4u      /* 0, 1: NeoPixel, 2, 3: D-SUN           */
+#define AUDIO_FX_PULSE_DECAY    24u     /* beat flash fall per frame             */
+
+typedef struct
+{
+    uint8_t  band[AUDIO_BANDS];     /* 0-255 per band, lowest first          */
+    uint8_t  level;                 /* 0-255 whole spectrum                  */
+    bool     beat;                  /* this block started a beat             */
+    uint32_t beats;                 /* beats since start                     */
+    uint32_t seq;                   /* blocks analysed; unchanged = no audio */
+} audio_levels_t;
+
+/**
+ * Set up TC5, EVSYS, ADC1 and the DMA ring, then create the task (static).
+ * After Dma_Init() and Metrics_Init(), before the scheduler. No-op unless
+ * AUDIO_ENABLE.
+ */
+void Audio_Start(void);
+
+/** Latest analysis. Any task; never blocks the writer. Zeros until the first block. */
+void Audio_Read(audio_levels_t *out);
+
+/** Worst cycles for one block since boot. */
+uint32_t Audio_CyclesMax(void);
+
+/** Blocks over AUDIO_BUDGET_CYCLES. */
+uint32_t Audio_OverBudget(void);
+
+/** Blocks dropped because the task was still busy with the previous one. */
+uint32_t Audio_Overruns(void);
+
+/** Beats detected since boot. */
+uint32_t Audio_Beats(void);
+
+/** Effect frame hook: picks up the latest levels. True while audio runs or a flash fades. */
+bool Audio_Update(uint8_t steps);
+
+/** Effect kernel: AUDIO_BANDS bars over the strip in rainbow colours, white flash on beats. */
+pix_t Audio_Pixel(uint16_t i, uint8_t offset);
+
+#endif /* AUDIO_H */
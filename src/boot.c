@@ -0,0 +1,156 @@
+/* =============================================================================
+ * boot.c  -  Boot-phase timestamps from reset, peripherals started after the first frame
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "boot.h"
+#include "definitions.h"        /* DWT, CPU_CLOCK_FREQUENCY, SERCOM5 / TCC0 plibs */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log.h"
+#include "mode.h"
+#include "statusled.h"
+
+#define BOOT_STACK          (configMINIMAL_STACK_SIZE * 2u)
+#define BOOT_CYCLES_US      (CPU_CLOCK_FREQUENCY / 1000000u)
+
+typedef struct
+{
+    const char   *name;
+    boot_init_fn  fn;
+    uint32_t      us;
+} boot_init_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t boot_cycles[BOOT_PHASES];     /* CYCCNT per phase, 0 = not yet */
+
+static boot_init_t       boot_init[BOOT_DEFER_MAX];
+static uint32_t          boot_count;
+static volatile uint32_t boot_ran;
+
+static TaskHandle_t boot_task_handle;
+static StackType_t  boot_stack[BOOT_STACK];
+static StaticTask_t boot_tcb;
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* From Reset_Handler, before .data and .bss: registers only. CYCCNT is not
+ * reset with the core, so it is zeroed here */
+void _on_reset(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0u;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* -- Init task --------------------------------------------------------------- */
+
+static void boot_report(void)
+{
+    char   line[BOOT_PHASES * 20u];
+    size_t n = 0;
+
+    for (uint32_t p = BOOT_MAIN; p < BOOT_PHASES; p++)
+        n += Log_Format(line + n, sizeof(line) - n, " %s %lu", Boot_PhaseName((boot_phase_t)p),
+                        (unsigned long)Boot_Us((boot_phase_t)p));
+    LOG_INFO("boot: us from reset:%s", line);
+
+    n = 0;
+    for (uint32_t i = 0; i < boot_count; i++)
+        n += Log_Format(line + n, sizeof(line) - n, " %s %lu", boot_init[i].name,
+                        (unsigned long)boot_init[i].us);
+    if (n != 0u) LOG_INFO("boot: deferred us:%s", line);
+}
+
+static void boot_task(void *arg)
+{
+    (void)arg;
+    (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BOOT_DEFER_WAIT_MS));     /* the first frame */
+
+    for (uint32_t i = 0; i < boot_count; i++)
+    {
+        uint32_t t = DWT->CYCCNT;
+
+        boot_init[i].fn();
+        boot_init[i].us = (DWT->CYCCNT - t) / BOOT_CYCLES_US;
+        boot_ran = i + 1u;
+    }
+    Boot_Mark(BOOT_DEFERRED);
+    StatusLed_Booted();
+    boot_report();
+    Mode_Ready();
+    vTaskDelete(NULL);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Boot_Mark(boot_phase_t phase)
+{
+    if (phase == BOOT_RESET || phase >= BOOT_PHASES || boot_cycles[phase] != 0u) return;
+
+    boot_cycles[phase] = DWT->CYCCNT;
+    if (phase == BOOT_FRAME && boot_task_handle != NULL) xTaskNotifyGive(boot_task_handle);
+}
+
+uint32_t Boot_Us(boot_phase_t phase)
+{
+    uint32_t c, clock;
+
+    if (phase == BOOT_RESET || phase >= BOOT_PHASES) return 0u;
+    c     = boot_cycles[phase];
+    clock = boot_cycles[BOOT_CLOCK];
+    if (clock == 0u || c <= clock) return c / (BOOT_RESET_HZ / 1000000u);
+    return clock / (BOOT_RESET_HZ / 1000000u) + (c - clock) / BOOT_CYCLES_US;
+}
+
+const char *Boot_PhaseName(boot_phase_t phase)
+{
+    static const char *const name[BOOT_PHASES] =
+    {
+        "reset", "main", "clock", "sysinit", "lit", "drivers", "scheduler", "frame", "deferred"
+    };
+
+    return (phase < BOOT_PHASES) ? name[phase] : "?";
+}
+
+bool Boot_Defer(const char *name, boot_init_fn fn)
+{
+    if (boot_count >= BOOT_DEFER_MAX || boot_task_handle != NULL)
+    {
+        fn();
+        return false;
+    }
+    boot_init[boot_count].name = name;
+    boot_init[boot_count].fn   = fn;
+    boot_init[boot_count].us   = 0u;
+    boot_count++;
+    return true;
+}
+
+bool Boot_Start(void)
+{
+    /* What SYS_Initialize() left out (initialization.c) */
+#if BOOT_DEFER_USART
+    (void)Boot_Defer("usart", SERCOM5_USART_Initialize);
+#endif
+#if BOOT_DEFER_TCC0
+    (void)Boot_Defer("tcc0", TCC0_PWMInitialize);
+#endif
+    boot_task_handle = xTaskCreateStatic(boot_task, "Init", BOOT_STACK, NULL, BOOT_TASK_PRIO,
+                                         boot_stack, &boot_tcb);
+    if (boot_task_handle != NULL) return true;
+
+    for (uint32_t i = 0; i < boot_count; i++) boot_init[i].fn();       /* the console at least */
+    boot_ran = boot_count;
+    Mode_Ready();
+    return false;
+}
+
+bool Boot_DeferredInfo(uint32_t i, const char **name, uint32_t *us)
+{
+    if (i >= boot_count) return false;
+    *name = boot_init[i].name;
+    *us   = (i < boot_ran) ? boot_init[i].us : 0u;
+    return true;
+}
@@ -0,0 +1,101 @@
+/* =============================================================================
+ * boot.h  -  Boot-phase timestamps from reset, peripherals started after the first frame
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The DWT cycle counter is started (and zeroed) by _on_reset(), before the
+ * C runtime copies .data, so every Boot_Mark() is a cycle count from the
+ * reset vector. The CPU runs the 48 MHz DFLL until CLOCK_Initialize()
+ * switches GCLK0 to 120 MHz; BOOT_CLOCK marks the switch and Boot_Us()
+ * converts each side at its own rate. The counter wraps after 35 s, far
+ * past the last phase.
+ *
+ *   BOOT_MAIN       main() entered: startup code, .data / .bss, FPU on
+ *   BOOT_CLOCK      GCLK0 at 120 MHz, inside SYS_Initialize()
+ *   BOOT_SYSINIT    SYS_Initialize() done
+ *   BOOT_LIT        the boot frame started on the strip (NeoPixel_ShowBootFrame())
+ *   BOOT_DRIVERS    the application drivers are up, tasks about to be created
+ *   BOOT_SCHEDULER  vTaskStartScheduler() called
+ *   BOOT_FRAME      the first LED frame handed to the strip
+ *   BOOT_DEFERRED   every Boot_Defer() init has run
+ *
+ * Deferred init: what is only needed later is taken out of
+ * SYS_Initialize() (under BOOT_DEFER_*) and queued with Boot_Defer(). A
+ * one-shot "Init" task below the render task runs the queue once the
+ * first frame is out (or after BOOT_DEFER_WAIT_MS, for a pixdist slave
+ * that has nothing to show yet), logs the phases and deletes itself.
+ *
+ *   SERCOM5 USART   the console. Log lines before it is up wait in the
+ *                   stdio DMA ring (stdio_uart.c) and leave once it is
+ *                   enabled; nothing on the boot path polls the UART.
+ *   TCC0            only the CCL / TCC NeoPixel backends, motor_pwm.c,
+ *                   stepper.c and servo.c use it, and those configure it
+ *                   before the first frame; deferred only with the SPI
+ *                   backend and none of ACT_PWM_DRIVE, ACT_STEPPER_DRIVE
+ *                   and SERVO_ENABLE.
+ *
+ * The lid's ACT_BOOT_DELAY_MS before its first scare is a timer, not a
+ * wait on the boot path: the lights come up regardless.
+ * ============================================================================= */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "neopixel.h"           /* NEO_BACKEND */
+#include "actuator.h"           /* ACT_PWM_DRIVE, ACT_STEPPER_DRIVE */
+#include "servo.h"              /* SERVO_ENABLE */
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef BOOT_DEFER_ENABLE
+#define BOOT_DEFER_ENABLE       1
+#endif
+#define BOOT_DEFER_USART        BOOT_DEFER_ENABLE
+#define BOOT_DEFER_TCC0         (BOOT_DEFER_ENABLE && NEO_BACKEND == NEO_BACKEND_SPI && !ACT_PWM_DRIVE && \
+                                 !ACT_STEPPER_DRIVE && !SERVO_ENABLE)
+#define BOOT_DEFER_MAX          8u
+#define BOOT_DEFER_WAIT_MS      500u    /* no first frame by then: run the queue anyway */
+#define BOOT_TASK_PRIO          2u      /* below the render task (3) */
+#define BOOT_RESET_HZ           48000000u       /* DFLL48M, until CLOCK_Initialize() */
+
+typedef enum
+{
+    BOOT_RESET = 0,             /* the counter's zero */
+    BOOT_MAIN,
+    BOOT_CLOCK,
+    BOOT_SYSINIT,
+    BOOT_LIT,
+    BOOT_DRIVERS,
+    BOOT_SCHEDULER,
+    BOOT_FRAME,
+    BOOT_DEFERRED,
+    BOOT_PHASES
+} boot_phase_t;
+
+typedef void (*boot_init_fn)(void);
+
+/** Stamp `phase`; only the first call counts. Any context, a few cycles. */
+void Boot_Mark(boot_phase_t phase);
+
+/** Microseconds from reset to `phase`, 0 if not reached yet. */
+uint32_t Boot_Us(boot_phase_t phase);
+
+/** "main", "clock", ... for reports. */
+const char *Boot_PhaseName(boot_phase_t phase);
+
+/**
+ * Queue `fn` for the Init task; the name is kept by pointer. Before
+ * Boot_Start(); false when BOOT_DEFER_MAX are queued (`fn` then runs at once).
+ */
+bool Boot_Defer(const char *name, boot_init_fn fn);
+
+/** Create the Init task. Before the scheduler. */
+bool Boot_Start(void);
+
+/**
+ * Entry `i` of the deferred queue: its name and the microseconds it took,
+ * 0 until the Init task has run it. False past the end.
+ */
+bool Boot_DeferredInfo(uint32_t i, const char **name, uint32_t *us);
+
+#endif /* BOOT_H */
@@ -0,0 +1,147 @@
+/* =============================================================================
+ * brownout.c  -  Supply brown-out early warning: relays off, LEDs dark, state saved
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "brownout.h"
+#include "definitions.h"        /* SUPC, NVIC, RSTC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "actuator.h"
+#include "effects.h"
+#include "settings.h"
+#include "wear.h"
+#include "log.h"
+#include "irqstat.h"
+
+/* BOD33.LEVEL: about 6 mV a step from 1.5 V (BOD33 characteristics) */
+#define BROWNOUT_LEVEL      ((BROWNOUT_MV - 1500u) / 6u)
+
+#if BROWNOUT_LEVEL > 255u
+#error "BROWNOUT_MV: above the BOD33 range"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Backup RAM, NOLOAD like the fault record: survives the reset, not a power loss */
+static struct
+{
+    uint32_t magic;
+    uint32_t tick;              /* of the warning */
+    uint32_t ms_low;            /* below the level, until the reset or the hold */
+} brownout_mark __attribute__((section(".bkupram_noinit")));
+
+static volatile bool brownout_active;
+static bool          brownout_was;      /* brownout_mark taken by Brownout_Init() */
+static TickType_t    brownout_since;    /* of the warning        */
+static TickType_t    brownout_ok;       /* of the supply's return, 0 = low */
+
+static TimerHandle_t brownout_timer;
+static StaticTimer_t brownout_timer_buf;
+
+static bool brownout_low(void)
+{
+    return (SUPC_REGS->SUPC_STATUS & SUPC_STATUS_BOD33DET_Msk) != 0u;
+}
+
+/* -- Timer service task ------------------------------------------------------ */
+
+/* Supply back for BROWNOUT_SETTLE_MS, or held long enough: restart the show */
+static void brownout_timer_cb(TimerHandle_t t)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    (void)t;
+    if (brownout_low()) brownout_ok = 0u;
+    else if (brownout_ok == 0u) brownout_ok = now;
+
+    if ((brownout_ok != 0u && (now - brownout_ok) >= pdMS_TO_TICKS(BROWNOUT_SETTLE_MS)) ||
+        (now - brownout_since) >= pdMS_TO_TICKS(BROWNOUT_HOLD_MS))
+    {
+        brownout_mark.ms_low = (uint32_t)(((brownout_ok != 0u) ? brownout_ok : now) - brownout_since)
+                             * portTICK_PERIOD_MS;
+        brownout_mark.magic  = BROWNOUT_MAGIC;
+        __DSB();
+        NVIC_SystemReset();
+    }
+}
+
+/* Everything that is not urgent enough for the ISR */
+static void brownout_save(void *a, uint32_t b)
+{
+    (void)a;
+    (void)b;
+    for (uint32_t ch = 0; ch < ACT_CHANNELS; ch++)
+        (void)Actuator_Abort((act_channel_t)ch);
+
+    Wear_Brownout();
+    Wear_Commit();
+    (void)Settings_Put(SETTINGS_KEY_EFFECT, Effects_Current());
+    while (Settings_Ready() && !Settings_Flush()) {}    /* the flash, not the retry timer */
+
+    brownout_since = brownout_mark.tick;
+    brownout_ok    = 0u;
+    (void)xTimerStart(brownout_timer, 0u);
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+void SUPC_BODDET_Handler(void)
+{
+    static const effect_cmd_t dark = { .op = EFFECT_CMD_BRIGHTNESS, .value = 0u };
+    BaseType_t woken = pdFALSE;
+
+    IRQSTAT_ENTER(IRQSTAT_BROWNOUT);
+    Actuator_Safe();
+    SUPC_REGS->SUPC_INTENCLR = SUPC_INTENCLR_BOD33DET_Msk;      /* once; the reset re-arms it */
+    SUPC_REGS->SUPC_INTFLAG  = SUPC_INTFLAG_BOD33DET_Msk;
+
+    brownout_active    = true;
+    brownout_mark.tick = xTaskGetTickCountFromISR();
+    (void)Effects_PostFromISR(&dark);
+    (void)xTimerPendFunctionCallFromISR(brownout_save, NULL, 0u, &woken);
+    IRQSTAT_EXIT(IRQSTAT_BROWNOUT);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Brownout_Init(void)
+{
+    if (brownout_mark.magic == BROWNOUT_MAGIC)
+    {
+        brownout_mark.magic = 0u;
+        brownout_was        = true;
+        LOG_WARN("brownout: supply sagged at tick %lu for %lu ms, show resumed",
+                 (unsigned long)brownout_mark.tick, (unsigned long)brownout_mark.ms_low);
+    }
+
+#if BROWNOUT_ENABLE
+    brownout_timer = xTimerCreateStatic("Brownout", pdMS_TO_TICKS(BROWNOUT_POLL_MS), pdTRUE, NULL,
+                                        brownout_timer_cb, &brownout_timer_buf);
+    if (brownout_timer == NULL) return;
+
+    /* Reconfigure only while off; it needs a few cycles to come ready */
+    SUPC_REGS->SUPC_BOD33 &= ~SUPC_BOD33_ENABLE_Msk;
+    while ((SUPC_REGS->SUPC_STATUS & SUPC_STATUS_B33SRDY_Msk) == 0u) {}
+    SUPC_REGS->SUPC_BOD33 = SUPC_BOD33_ACTION_INT | SUPC_BOD33_HYST(BROWNOUT_HYST) |
+                            SUPC_BOD33_LEVEL(BROWNOUT_LEVEL);
+    SUPC_REGS->SUPC_INTFLAG  = SUPC_INTFLAG_BOD33DET_Msk;
+    SUPC_REGS->SUPC_INTENSET = SUPC_INTENSET_BOD33DET_Msk;
+    NVIC_SetPriority(SUPC_BODDET_IRQn, BROWNOUT_IRQ_PRIO);
+    NVIC_EnableIRQ(SUPC_BODDET_IRQn);
+    SUPC_REGS->SUPC_BOD33 |= SUPC_BOD33_ENABLE_Msk;
+    while ((SUPC_REGS->SUPC_STATUS & SUPC_STATUS_BOD33RDY_Msk) == 0u) {}
+#endif
+}
+
+bool Brownout_Active(void)
+{
+    return brownout_active;
+}
+
+bool Brownout_WasReset(void)
+{
+    return brownout_was || brownout_mark.magic == BROWNOUT_MAGIC;
+}
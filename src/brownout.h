@@ -0,0 +1,62 @@
+/* =============================================================================
+ * brownout.h  -  Supply brown-out early warning: relays off, LEDs dark, state saved
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * LED inrush and the actuator can sag the supply. The BOD33 fuse leaves
+ * the detector off (and would only reset); Brownout_Init() turns it on
+ * at BROWNOUT_MV, well above the flash's minimum, with ACTION = INT, so a
+ * sag raises SUPC_BODDET while there is still time to act:
+ *
+ *   ISR        every relay open on the PORT (Actuator_Safe()), brightness
+ *              0 posted to the renderer (its next frame goes out black, a
+ *              few ms), then the rest pended to the timer service task.
+ *              Microseconds; at configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ *   Save       both actuator channels aborted, the brown-out counted, the
+ *              wear counters (wear.h) and the running effect handed to
+ *              settings.h and flushed to the SmartEEPROM at once, waiting
+ *              on the flash instead of the usual SETTINGS_FLUSH_MS.
+ *   Recover    once the supply has been back above the level for
+ *              BROWNOUT_SETTLE_MS, or after BROWNOUT_HOLD_MS in any case,
+ *              the board resets.
+ *
+ * The show then starts the way every boot does, from the saved state: the
+ * effect that was running, the saved parameters and counters, the lid's
+ * boot delay before its first scare. A supply still low at that boot is
+ * caught again straight away, so the prop stays dark and the relays open
+ * until the supply recovers. A sag that ends in a full power loss has had
+ * its state written before the POR.
+ * ============================================================================= */
+
+#ifndef BROWNOUT_H
+#define BROWNOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef BROWNOUT_ENABLE
+#define BROWNOUT_ENABLE         1
+#endif
+#define BROWNOUT_MV             3000u   /* VDD warning level, 3.3 V rail          */
+#define BROWNOUT_HYST           4u      /* BOD33.HYST steps above the level       */
+#define BROWNOUT_IRQ_PRIO       IRQ_PRIO_BROWNOUT   /* irqprio.h: = the ceiling  */
+#define BROWNOUT_POLL_MS        20u     /* supply checked while low               */
+#define BROWNOUT_SETTLE_MS      200u    /* back above the level this long: reset  */
+#define BROWNOUT_HOLD_MS        10000u  /* reset anyway; under the lid's boot delay */
+
+#define BROWNOUT_MAGIC          0x4E574F42u     /* "BOWN": kept over the reset */
+
+/**
+ * Report a brown-out before this boot, then arm the detector. After
+ * Wear_Init() and Effects_Init(), before the scheduler.
+ */
+void Brownout_Init(void);
+
+/** True from the warning until the reset. Any task. */
+bool Brownout_Active(void);
+
+/** True if the last reset was this module's, after a warning. Any time from reset. */
+bool Brownout_WasReset(void);
+
+#endif /* BROWNOUT_H */
@@ -0,0 +1,92 @@
+/* =============================================================================
+ * cache.c  -  CMCC hit counter and locked cache ways for the frame hot path
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "cache.h"
+#include "definitions.h"        /* CMCC plib: CMCC_Disable(), CMCC_WAY_SIZE, ... */
+#include "log.h"
+
+#define CACHE_CFG           CMCC_CFG_CSIZESW(CMCC_CFG_CSIZESW_CONF_CSIZE_4KB_Val)
+#define CACHE_ALL_WAYS      ((1u << CMCC_NO_OF_WAYS) - 1u)
+
+/* .cache_hot in the linker script */
+extern const uint8_t __cache_hot_start[];
+extern const uint8_t __cache_hot_end[];
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t cache_locked;           /* ways */
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+#if CACHE_LOCK_ENABLE
+/* Disabled cache, data allocation only, all ways invalid: fill way by way */
+static void cache_lock(void)
+{
+    uint32_t start = (uint32_t)__cache_hot_start;
+    uint32_t bytes = Cache_HotBytes();
+    uint32_t ways  = (bytes + CMCC_WAY_SIZE - 1u) / CMCC_WAY_SIZE;
+    uint32_t primask = __get_PRIMASK();
+
+    if (ways > CACHE_LOCK_WAYS) ways = CACHE_LOCK_WAYS;
+    if (ways == 0u) return;
+
+    __disable_irq();                    /* an ISR's reads would land in the way too */
+    CMCC_InvalidateAll();               /* leaves it disabled */
+    CMCC_REGS->CMCC_CFG = CACHE_CFG | CMCC_CFG_ICDIS_Msk;
+    for (uint32_t w = 0; w < ways; w++)
+    {
+        uint32_t end = start + (w + 1u) * CMCC_WAY_SIZE;
+
+        if (end > start + bytes) end = start + bytes;
+        CMCC_REGS->CMCC_LCKWAY = CMCC_LCKWAY_LCKWAY(CACHE_ALL_WAYS & ~(1u << w));
+        CMCC_REGS->CMCC_CTRL   = CMCC_CTRL_CEN_Msk;
+        for (uint32_t a = start + w * CMCC_WAY_SIZE; a < end; a += CMCC_LINE_SIZE)
+            (void)*(const volatile uint32_t *)a;
+        CMCC_Disable();
+    }
+    CMCC_REGS->CMCC_LCKWAY = CMCC_LCKWAY_LCKWAY((1u << ways) - 1u);
+    CMCC_REGS->CMCC_CFG    = CACHE_CFG | CMCC_CFG_DCDIS_Msk;       /* as the startup code left it */
+    CMCC_REGS->CMCC_CTRL   = CMCC_CTRL_CEN_Msk;
+    __set_PRIMASK(primask);
+
+    cache_locked = ways;
+    if (bytes > ways * CMCC_WAY_SIZE)
+        LOG_WARN("cache: hot path %lu bytes, first %lu locked", (unsigned long)bytes,
+                 (unsigned long)(ways * CMCC_WAY_SIZE));
+}
+#endif
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Cache_Init(void)
+{
+    if ((CMCC_REGS->CMCC_MEN & CMCC_MEN_MENABLE_Msk) == 0u)      /* again: keep the count */
+    {
+        CMCC_REGS->CMCC_MCFG  = CMCC_MCFG_MODE_IHIT_COUNT;
+        CMCC_REGS->CMCC_MCTRL = CMCC_MCTRL_SWRST_Msk;
+        CMCC_REGS->CMCC_MEN   = CMCC_MEN_MENABLE_Msk;
+    }
+
+#if CACHE_LOCK_ENABLE
+    cache_lock();
+#endif
+    if ((CMCC_REGS->CMCC_SR & CMCC_SR_CSTS_Msk) == 0u)
+        CMCC_REGS->CMCC_CTRL = CMCC_CTRL_CEN_Msk;
+}
+
+uint32_t Cache_Hits(void)
+{
+    return CMCC_REGS->CMCC_MSR;
+}
+
+uint32_t Cache_LockedWays(void)
+{
+    return cache_locked;
+}
+
+uint32_t Cache_HotBytes(void)
+{
+    return (uint32_t)(__cache_hot_end - __cache_hot_start);
+}
@@ -0,0 +1,76 @@
+/* =============================================================================
+ * cache.h  -  CMCC hit counter and locked cache ways for the frame hot path
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The CMCC is a 4 KB, 4-way cache (1 KB a way, 16-byte lines) in front of
+ * the internal flash and the QSPI XIP window. The startup code enables it
+ * for instructions only (CFG.DCDIS): flash written through NVMCTRL and
+ * QSPI data are never served stale.
+ *
+ *   Monitor    the CMCC's event counter runs free in IHIT mode (instruction
+ *              fetches served from the cache). Cache_Hits() is the running
+ *              count; the render task publishes hits per METRICS_NEO_MS in
+ *              metrics.h ("icache_hits" in telem.h, `cache` on the console).
+ *              The CMCC counts no misses, so this is a figure to compare
+ *              between windows (an asset read, a heavy effect, the lock on
+ *              or off), not a ratio.
+ *   Lock       functions tagged CACHE_HOT (WS2812 encoder, compositor, the
+ *              per-pixel effect kernels) are linked into one contiguous
+ *              .cache_hot section. With CACHE_LOCK_ENABLE, Cache_Init()
+ *              loads it, a way at a time, into up to CACHE_LOCK_WAYS ways
+ *              and locks them, so QSPI asset reads and cold code can only
+ *              evict what is left. The frame time then stops depending on
+ *              what ran before it; everything else shares the rest.
+ *
+ * Loading a way: with the cache off, instruction allocation is disabled
+ * and data allocation enabled (CFG), everything invalidated, and every
+ * way but the target locked; one data read per line then fills exactly
+ * that way (the CMCC tags are shared by fetches and reads). The fill loop's
+ * own fetches bypass the cache meanwhile. A section larger than the locked
+ * ways is locked from its start and reported by Cache_Init(). With
+ * RAMFUNC_HOT_PATH (ramfunc.h) the section is empty: the hot path runs
+ * from SRAM and nothing needs locking.
+ * ============================================================================= */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ramfunc.h"            /* RAMFUNC_HOT_PATH */
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef CACHE_LOCK_ENABLE
+#define CACHE_LOCK_ENABLE       0
+#endif
+#define CACHE_LOCK_WAYS         2u      /* at most 3: one way stays for the rest */
+
+#if CACHE_LOCK_WAYS > 3u
+#error "CACHE_LOCK_WAYS: leave at least one CMCC way unlocked"
+#endif
+
+/* Frame hot path: linked together so it can be locked in the cache, or
+ * run from SRAM instead with RAMFUNC_HOT_PATH (ramfunc.h) */
+#if RAMFUNC_HOT_PATH
+#define CACHE_HOT               RAMFUNC
+#else
+#define CACHE_HOT               __attribute__((section(".cache_hot")))
+#endif
+
+/**
+ * Start the hit counter, lock the hot section if configured, and enable
+ * the cache if the startup code did not. Before the scheduler, once the
+ * log works.
+ */
+void Cache_Init(void);
+
+/** Running CMCC hit count; wraps, take differences. Any context. */
+uint32_t Cache_Hits(void);
+
+/** Ways holding the hot section, 0 = none locked. */
+uint32_t Cache_LockedWays(void);
+
+/** Size of the .cache_hot section in bytes. */
+uint32_t Cache_HotBytes(void);
+
+#endif /* CACHE_H */
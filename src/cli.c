@@ -0,0 +1,1641 @@
+/* =============================================================================
+ * cli.c  -  Serial command shell for live tuning, values kept in flash
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "cli.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "stream_buffer.h"
+#include "semphr.h"
+#include "stdio_uart.h"
+#include "effects.h"
+#include "nvstore.h"
+#include "nvwrite.h"
+#include "settings.h"
+#include "wear.h"
+#include "fault.h"
+#include "boot.h"
+#include "cache.h"
+#include "ramfunc.h"
+#include "fwupdate.h"
+#include "crc.h"
+#include "log.h"
+#include "rtos_trace.h"
+#include "metrics.h"
+#include "cpuload.h"
+#include "idle.h"
+#include "stackmon.h"
+#include "pool.h"
+#include "fpu.h"
+#include "sound.h"
+#include "qflash.h"
+#include "assets.h"
+#include "assetcache.h"
+#include "sdcard.h"
+#include "fat.h"
+#include "stream.h"
+#include "anim.h"
+#include "actuator.h"
+#include "estop.h"
+#include "showsync.h"
+#include "dmx.h"
+#include "pixdist.h"
+#include "usbcdc.h"
+#include "netbridge.h"
+#include "telem.h"
+#include "cpufreq.h"
+#include "latbench.h"
+#include "rtosbench.h"
+#include "adpcm.h"
+#include "dmaram.h"
+#include "defer.h"
+#include "loadtest.h"
+#include "irqstat.h"
+#include "memstat.h"
+#include "statusled.h"
+#include "fpsctl.h"
+#include "showcal.h"
+#include "railmon.h"
+#include "knob.h"
+#include "tof.h"
+#include "imgcheck.h"
+#include "ioseq.h"
+#include "servo.h"
+#include "motion.h"
+#include "hrtimer.h"
+#include "showclock.h"
+#include "showscript.h"
+#include "power.h"
+#include "plugin.h"
+#include "replay.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLI_SAVE_TIMEOUT_MS 2000u       /* a block erase included */
+#define CLI_ARGS_MAX        4u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const cli_param_t *cli_params[CLI_MAX_PARAMS];
+static uint32_t           cli_defaults[CLI_MAX_PARAMS];
+static uint32_t           cli_count;
+static volatile bool      cli_save_ok;
+
+/* A shell port: the stream its lines come from and where its output goes */
+typedef struct
+{
+    const char          *name;                  /* its task */
+    StreamBufferHandle_t (*rx)(void);
+    size_t             (*write)(const void *data, size_t count);
+} cli_port_t;
+
+static size_t cli_console_write(const void *data, size_t count)
+{
+    return fwrite(data, 1u, count, stdout);
+}
+
+static const cli_port_t cli_ports[] =
+{
+    { "CLI",     STDIO_RxStream,  cli_console_write },
+#if USBCDC_ENABLE
+    { "CLI-USB", UsbCdc_RxStream, UsbCdc_Write      },
+#endif
+#if NETBRIDGE_ENABLE
+    { "CLI-NET", NetBridge_RxStream, NetBridge_Write },
+#endif
+};
+#define CLI_PORTS           (sizeof(cli_ports) / sizeof(cli_ports[0]))
+
+/* One line runs at a time, its output to the port it came from */
+static SemaphoreHandle_t  cli_lock;
+static StaticSemaphore_t  cli_lock_buf;
+static const cli_port_t  *cli_out = &cli_ports[0];
+
+#define CLI_STACK           (configMINIMAL_STACK_SIZE * 3u)
+static StackType_t        cli_stack[CLI_PORTS][CLI_STACK];
+static StaticTask_t       cli_tcb[CLI_PORTS];
+
+static void cli_print(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void cli_print(const char *fmt, ...)
+{
+    char    buf[LOG_LINE_MAX];
+    va_list ap;
+    size_t  n;
+
+    va_start(ap, fmt);
+    n = Log_VFormat(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    (void)cli_out->write(buf, n);
+}
+
+static uint32_t cli_get(const cli_param_t *p)
+{
+    switch (p->type)
+    {
+    case CLI_U8:  return *(const uint8_t *)p->value;
+    case CLI_U16: return *(const uint16_t *)p->value;
+    default:      return *(const uint32_t *)p->value;
+    }
+}
+
+/* Store v (already range checked) and let the owner react */
+static void cli_set(const cli_param_t *p, uint32_t v)
+{
+    switch (p->type)
+    {
+    case CLI_U8:  *(uint8_t *)p->value  = (uint8_t)v;  break;
+    case CLI_U16: *(uint16_t *)p->value = (uint16_t)v; break;
+    default:      *(uint32_t *)p->value = v;           break;
+    }
+    if (p->changed != NULL) p->changed();
+}
+
+/* nvstore key of a parameter: FNV-1a of its name, never the erased value */
+static uint32_t cli_key(const cli_param_t *p)
+{
+    uint32_t h = 2166136261u;
+
+    for (const char *s = p->name; *s != '\0'; s++)
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    return (h == 0xFFFFFFFFu) ? 0xFFFFFFFEu : h;
+}
+
+static const cli_param_t *cli_find(const char *name)
+{
+    for (uint32_t i = 0; i < cli_count; i++)
+        if (strcmp(cli_params[i]->name, name) == 0) return cli_params[i];
+    return NULL;
+}
+
+/* Whole-string number, decimal or 0x hex */
+static bool cli_number(const char *s, uint32_t *out)
+{
+    char *end;
+
+    if (s == NULL || *s == '\0' || *s == '-') return false;
+    *out = (uint32_t)strtoul(s, &end, 0);
+    return *end == '\0';
+}
+
+static void cli_show(const cli_param_t *p)
+{
+    cli_print("%-12s %10lu  [%lu..%lu]  %s\r\n", p->name, (unsigned long)cli_get(p),
+              (unsigned long)p->min, (unsigned long)p->max,
+              (p->help != NULL) ? p->help : "");
+}
+
+/* Keep a changed value: written with the next settings.h batch */
+static void cli_keep(const cli_param_t *p)
+{
+    (void)Settings_Put(cli_key(p), cli_get(p));
+}
+
+/* Timer service task: the one that owns the settings flush; nvstore
+ * records go to the NvWrite task, which the CLI task then waits for */
+static void cli_save_pended(void *task, uint32_t unused)
+{
+    bool ok = true;
+
+    (void)unused;
+    for (uint32_t i = 0; i < cli_count; i++)
+    {
+        uint32_t v    = cli_get(cli_params[i]);
+        uint32_t d[2] = { v, ~v };
+
+        if (Settings_Ready()) cli_keep(cli_params[i]);
+        else if (!NvWrite_Post(cli_key(cli_params[i]), d)) ok = false;
+    }
+    if (Settings_Ready())
+    {
+        Wear_Commit();
+        ok = Settings_Flush();
+    }
+    cli_save_ok = ok;
+    xTaskNotifyGive((TaskHandle_t)task);
+}
+
+/* -- Commands ------------------------------------------------------------------ */
+
+static void cli_cmd_get(uint32_t argc, char **argv)
+{
+    if (argc < 2u)
+    {
+        for (uint32_t i = 0; i < cli_count; i++) cli_show(cli_params[i]);
+        return;
+    }
+    const cli_param_t *p = cli_find(argv[1]);
+
+    if (p == NULL) cli_print("unknown parameter '%s'\r\n", argv[1]);
+    else cli_show(p);
+}
+
+static void cli_cmd_set(uint32_t argc, char **argv)
+{
+    const cli_param_t *p = (argc == 3u) ? cli_find(argv[1]) : NULL;
+    uint32_t v;
+
+    if (p == NULL)
+    {
+        cli_print("usage: set <name> <value>, see 'get'\r\n");
+        return;
+    }
+    if (!cli_number(argv[2], &v) || v < p->min || v > p->max)
+    {
+        cli_print("%s: %lu..%lu\r\n", p->name, (unsigned long)p->min, (unsigned long)p->max);
+        return;
+    }
+    cli_set(p, v);
+    cli_keep(p);
+    cli_show(p);                        /* the hook may have adjusted it */
+}
+
+static void cli_cmd_save(uint32_t argc, char **argv)
+{
+    uint32_t failed = NvWrite_Failures();
+
+    (void)argc;
+    (void)argv;
+    (void)ulTaskNotifyTake(pdTRUE, 0);
+    cli_save_ok = false;
+    if (xTimerPendFunctionCall(cli_save_pended, xTaskGetCurrentTaskHandle(), 0u,
+                               pdMS_TO_TICKS(100u)) != pdPASS ||
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CLI_SAVE_TIMEOUT_MS)) == 0u)
+    {
+        cli_print("save: timer task busy\r\n");
+        return;
+    }
+    if (!Settings_Ready() && cli_save_ok)
+        cli_save_ok = NvWrite_Flush(CLI_SAVE_TIMEOUT_MS) && NvWrite_Failures() == failed;
+    if (cli_save_ok) cli_print("save: ok\r\n");
+    else cli_print("save: %s\r\n", Settings_Ready() ? "flash busy, written shortly" : "FAILED");
+}
+
+static void cli_cmd_defaults(uint32_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    for (uint32_t i = 0; i < cli_count; i++)
+    {
+        cli_set(cli_params[i], cli_defaults[i]);
+        cli_keep(cli_params[i]);
+    }
+    cli_print(Settings_Ready() ? "defaults restored\r\n" : "defaults restored, 'save' to keep them\r\n");
+}
+
+/* Effect plug-ins: what each costs against its budget, or one more from the card */
+static void cli_fx_plugins(uint32_t argc, char **argv)
+{
+    plugin_info_t   p;
+    plugin_status_t st;
+    effect_id_t     id;
+
+    if (strcmp(argv[1], "load") == 0)
+    {
+        if (argc < 3u)
+        {
+            cli_print("usage: fx load <file>, an effect plug-in on the card\r\n");
+            return;
+        }
+        st = Plugin_LoadFile(argv[2], &id);
+        if (st == PLUGIN_OK) cli_print("%s: effect %u '%s'\r\n", argv[2], (unsigned)id, Effects_Name(id));
+        else cli_print("%s: %s\r\n", argv[2], Plugin_StatusName(st));
+        return;
+    }
+    for (uint8_t i = 0; Plugin_GetInfo(i, &p); i++)
+        cli_print("%u %-16s %5lu + %5lu bytes, %lu cyc/led, slowest %lu, over %lu%s\r\n",
+                  (unsigned)(EFFECT_COUNT + i), p.name, (unsigned long)p.size, (unsigned long)p.bss,
+                  (unsigned long)p.budget, (unsigned long)p.max_cycles, (unsigned long)p.overruns,
+                  p.disabled ? ", off" : "");
+    if (Plugin_Count() == 0u) cli_print("no plug-ins\r\n");
+}
+
+static void cli_cmd_fx(uint32_t argc, char **argv)
+{
+    uint32_t id = EFFECT_COUNT, frames = 0u;
+
+    if (argc >= 2u && (strcmp(argv[1], "load") == 0 || strcmp(argv[1], "plugins") == 0))
+    {
+        cli_fx_plugins(argc, argv);
+        return;
+    }
+    if (argc < 2u)
+    {
+        effects_admit_t a;
+        effect_cost_t   c;
+
+        for (uint32_t i = 0; i < Effects_Count(); i++)
+        {
+            (void)Effects_GetCost((effect_id_t)i, &c);
+            cli_print("%lu %-16s %4lu cyc/led + %6lu/frame%s\r\n", (unsigned long)i,
+                      Effects_Name((effect_id_t)i), (unsigned long)c.pixel, (unsigned long)c.frame,
+                      (i == (uint32_t)Effects_Current()) ? " *" : "");
+        }
+        Effects_GetAdmit(&a);
+        cli_print("scene %lu of %lu cycles, %lu refused, %lu fades cut\r\n", (unsigned long)a.cost,
+                  (unsigned long)a.budget, (unsigned long)a.refused, (unsigned long)a.fades_cut);
+        return;
+    }
+    if (!cli_number(argv[1], &id))
+    {
+        for (id = 0; id < Effects_Count(); id++)
+            if (strcmp(Effects_Name((effect_id_t)id), argv[1]) == 0) break;
+    }
+    if (id >= Effects_Count() || (argc > 2u && (!cli_number(argv[2], &frames) || frames > 0xFFFFu)))
+    {
+        cli_print("usage: fx <name|n> [frames], see 'fx'\r\n");
+        return;
+    }
+    Effects_Select((effect_id_t)id, (uint16_t)frames);
+    (void)Settings_Put(SETTINGS_KEY_EFFECT, id);            /* the one to start with */
+}
+
+static void cli_cmd_frame(uint32_t argc, char **argv)
+{
+    uint32_t id, frames = 1u;
+
+    if (argc < 2u)
+    {
+        for (id = 0; id < NEO_FRAME_COUNT; id++)
+            cli_print("%lu %s\r\n", (unsigned long)id, NeoPixel_FrameName((neo_frame_id_t)id));
+        return;
+    }
+    if (!cli_number(argv[1], &id))
+    {
+        for (id = 0; id < NEO_FRAME_COUNT; id++)
+            if (strcmp(NeoPixel_FrameName((neo_frame_id_t)id), argv[1]) == 0) break;
+    }
+    if (id >= NEO_FRAME_COUNT || (argc > 2u && (!cli_number(argv[2], &frames) || frames > 0xFFFFu)))
+    {
+        cli_print("usage: frame <name|n> [frames], see 'frame'\r\n");
+        return;
+    }
+    Effects_ShowFrame((uint8_t)id, (uint16_t)frames);
+}
+
+/* Permille as "12.3" */
+static void cli_print_pm(const char *label, uint32_t pm)
+{
+    cli_print("%s%3lu.%lu%%", label, (unsigned long)(pm / 10u), (unsigned long)(pm % 10u));
+}
+
+static void cli_cmd_top(uint32_t argc, char **argv)
+{
+    static metrics_tasks_t tasks;       /* CLI task only; too big for its stack */
+    metrics_t m;
+
+    (void)argc;
+    (void)argv;
+    Metrics_Read(&m);
+    Metrics_ReadTasks(&tasks);
+    if (tasks.count == 0u)
+    {
+        cli_print("top: no sample yet\r\n");
+        return;
+    }
+    cli_print("%-16s   cpu  stack\r\n", "task");
+    for (uint32_t i = 0; i < tasks.count; i++)
+    {
+        cli_print("%-16s", tasks.task[i].name);
+        cli_print_pm(" ", tasks.task[i].pm);
+        cli_print(" %5u\r\n", (unsigned)tasks.task[i].stack_free);
+    }
+    cli_print_pm("busy ", m.cpu.busy_pm);
+    cli_print_pm("  idle ", m.cpu.idle_pm);
+    cli_print_pm("  peak ", m.cpu.peak_pm);
+    cli_print(" (%lu s)\r\n", (unsigned long)(CPULOAD_PEAK_PERIODS * CPULOAD_PERIOD_MS / 1000u));
+    cli_print_pm("awake", Idle_LoadPm());
+    cli_print(" (idle.h, not sleeping)\r\n");
+    if (CPUFREQ_ENABLE)
+    {
+        cli_print_pm("slow ", CpuFreq_LowPm());
+        cli_print(" at %lu MHz (cpufreq.h, %lu switches)\r\n",
+                  (unsigned long)(configCPU_CLOCK_HZ / 1000000u / CPUFREQ_LOW_DIV),
+                  (unsigned long)CpuFreq_Switches());
+    }
+    cli_print("icache %lu hits in %lu ms, hot path %lu bytes, %lu of 4 ways locked, %lu bytes in SRAM\r\n",
+              (unsigned long)m.neo.cache_hits, (unsigned long)METRICS_NEO_MS,
+              (unsigned long)Cache_HotBytes(), (unsigned long)Cache_LockedWays(),
+              (unsigned long)Ramfunc_Bytes());
+    if (Fpu_Strays() != 0u || Fpu_IsrStrays() != 0u)
+        cli_print("fpu: %lu undeclared tasks (last %s), %lu in ISRs\r\n",
+                  (unsigned long)Fpu_Strays(),
+                  (Fpu_LastStray() != NULL) ? Fpu_LastStray() : "-",
+                  (unsigned long)Fpu_IsrStrays());
+}
+
+/* Peak stack use per task and what each could shrink to */
+static void cli_cmd_stack(uint32_t argc, char **argv)
+{
+    static stackmon_report_t r;         /* CLI task only */
+    uint32_t spare = 0u;
+
+    (void)argc;
+    (void)argv;
+    StackMon_Read(&r);
+    if (r.count == 0u)
+    {
+        cli_print("stack: no sample yet\r\n");
+        return;
+    }
+    cli_print("%-16s  size  used   rec  (words)\r\n", "task");
+    for (uint32_t i = 0; i < r.count; i++)
+    {
+        const stackmon_task_t *t = &r.task[i];
+
+        cli_print("%-16s %5u %5u %5u\r\n", t->name,
+                  (unsigned)t->size, (unsigned)t->used, (unsigned)t->recommend);
+        if (t->recommend < t->size) spare += t->size - t->recommend;
+    }
+    cli_print("resize frees %lu words (%lu bytes)\r\n",
+              (unsigned long)spare, (unsigned long)(spare * sizeof(StackType_t)));
+}
+
+/* Block use per pool class */
+static void cli_cmd_pool(uint32_t argc, char **argv)
+{
+    pool_stats_t s;
+
+    (void)argc;
+    (void)argv;
+    cli_print("%5s %5s %5s %5s %6s\r\n", "size", "count", "used", "peak", "fails");
+    for (uint32_t c = 0; Pool_GetStats(c, &s); c++)
+        cli_print("%5u %5u %5u %5u %6lu\r\n", (unsigned)s.size, (unsigned)s.count,
+                  (unsigned)s.used, (unsigned)s.peak, (unsigned long)s.fails);
+    cli_print("failed allocations %lu\r\n", (unsigned long)Pool_Fails());
+}
+
+/* Heap, pools, stacks and sections in one place (memstat.h) */
+static void cli_cmd_mem(uint32_t argc, char **argv)
+{
+    memstat_t m;
+
+    (void)argc;
+    (void)argv;
+    MemStat_Read(&m);
+    cli_print("heap    %6lu  free %6lu  min %6lu\r\n", (unsigned long)m.heap_size,
+              (unsigned long)m.heap_free, (unsigned long)m.heap_min);
+    cli_print("pools   %6lu  used %6lu  peak %5lu  fails %lu\r\n", (unsigned long)m.pool_bytes,
+              (unsigned long)m.pool_used, (unsigned long)m.pool_peak, (unsigned long)m.pool_fails);
+    if (m.tasks != 0u)
+        cli_print("stacks  %6lu  used %6lu  tightest %lu words free, %lu tasks\r\n",
+                  (unsigned long)(m.stack_words * sizeof(StackType_t)),
+                  (unsigned long)(m.stack_used * sizeof(StackType_t)),
+                  (unsigned long)m.stack_min_free, (unsigned long)m.tasks);
+    cli_print("ram     %6lu  static %6lu  free %6lu  (ramfunc %lu)\r\n", (unsigned long)m.ram_size,
+              (unsigned long)m.ram_static, (unsigned long)m.ram_free, (unsigned long)m.ramfunc);
+    cli_print("dma ram %6lu  used %6lu\r\n", (unsigned long)m.dma_size, (unsigned long)m.dma_used);
+    cli_print("flash hot %lu, backup ram %lu (bytes)\r\n",
+              (unsigned long)m.cache_hot, (unsigned long)m.bkupram);
+}
+
+/* Cue a clip by id, as from an ACT_SOUND() step */
+static void cli_cmd_play(uint32_t argc, char **argv)
+{
+    uint32_t id, gain = SOUND_GAIN_UNITY;
+
+    if (argc < 2u || !cli_number(argv[1], &id) || id >= SOUND_CLIPS
+        || (argc > 2u && (!cli_number(argv[2], &gain) || gain > 0xFFFFu)))
+    {
+        cli_print("usage: play <id> [gain], 256 = unity\r\n");
+        return;
+    }
+    if (!Sound_Cue((uint8_t)id, (uint16_t)gain, 0u))
+        cli_print("play: no clip %lu, or sound off\r\n", (unsigned long)id);
+    cli_print("late blocks %lu, dropped cues %lu\r\n",
+              (unsigned long)Sound_Late(), (unsigned long)Sound_Dropped());
+}
+
+/* The QSPI chip and its asset table */
+static void cli_cmd_assets(uint32_t argc, char **argv)
+{
+    static const char *const kinds[] = { "raw", "anim", "sound", "show", "fx" };
+    qflash_info_t info;
+    asset_t       a;
+    bool          check = (argc >= 2u && strcmp(argv[1], "crc") == 0);
+
+    QFlash_GetInfo(&info);
+    if (info.size == 0u)
+    {
+        cli_print("assets: no QSPI flash\r\n");
+        return;
+    }
+    cli_print("flash %02x %02x %02x, %lu KB, %lu assets\r\n", info.jedec[0], info.jedec[1],
+              info.jedec[2], (unsigned long)(info.size >> 10), (unsigned long)Assets_Count());
+    for (uint32_t i = 0; Assets_Get(i, &a); i++)
+    {
+        uint32_t crc;
+
+        cli_print("%-20s %-5s %3u %08lx %7lu", a.name, (a.kind <= ASSET_PLUGIN) ? kinds[a.kind] : "?",
+                  (unsigned)a.id, (unsigned long)((uint32_t)a.data - QFLASH_BASE), (unsigned long)a.size);
+        if (check && Crc_Memory(a.data, a.size, &crc)) cli_print(" %08lx", (unsigned long)crc);
+        else if (check) cli_print(" crc failed");
+        cli_print("\r\n");
+    }
+}
+
+/* The SRAM asset cache: what is in, and how often cues found it there */
+static void cli_cmd_acache(uint32_t argc, char **argv)
+{
+    assetcache_stats_t st;
+    asset_t            a;
+
+    (void)argc;
+    (void)argv;
+    AssetCache_GetStats(&st);
+    cli_print("acache: %u assets, %u / %u blocks of %u bytes\r\n", (unsigned)st.resident,
+              (unsigned)st.blocks_used, (unsigned)ASSETCACHE_BLOCKS, (unsigned)ASSETCACHE_BLOCK_BYTES);
+    cli_print("hits %lu, misses %lu, fills %lu, evicted %lu, too big %lu, dropped %lu\r\n",
+              (unsigned long)st.hits, (unsigned long)st.misses, (unsigned long)st.fills,
+              (unsigned long)st.evictions, (unsigned long)st.too_big, (unsigned long)st.dropped);
+    for (uint32_t i = 0; Assets_Get(i, &a); i++)
+        if (AssetCache_Resident(i)) cli_print("  %-20s %7lu\r\n", a.name, (unsigned long)a.size);
+}
+
+/* The SD card, a directory on it, and how streaming keeps up */
+static void cli_cmd_sd(uint32_t argc, char **argv)
+{
+    sdcard_info_t     info;
+    fat_entry_t       e;
+    stream_lz_stats_t lz;
+
+    SdCard_GetInfo(&info);
+    if (info.blocks == 0u || !Fat_Mounted())
+    {
+        cli_print("sd: no card, or no FAT16/32 volume\r\n");
+        return;
+    }
+    cli_print("card %lu MB%s, slowest read %lu us, errors %lu\r\n",
+              (unsigned long)(info.blocks >> 11), info.high_capacity ? " SDHC" : "",
+              (unsigned long)SdCard_LatencyMaxUs(), (unsigned long)SdCard_Errors());
+    cli_print("stream underruns %lu, anim frames held %lu\r\n",
+              (unsigned long)Stream_Underruns(), (unsigned long)Anim_Underruns());
+    Stream_GetLzStats(&lz);
+    if (lz.blocks != 0u || lz.errors != 0u)
+        cli_print("packed: %lu blocks, %lu KB read for %lu KB, %lu avg %lu max cycles a block, %lu bad\r\n",
+                  (unsigned long)lz.blocks, (unsigned long)lz.in_kb, (unsigned long)lz.out_kb,
+                  (unsigned long)lz.cycles_avg, (unsigned long)lz.cycles_max, (unsigned long)lz.errors);
+    for (uint32_t i = 0; Fat_List((argc > 1u) ? argv[1] : "", i, &e); i++)
+        cli_print("  %-12s %s%lu\r\n", e.name, e.dir ? "<dir> " : "", (unsigned long)e.size);
+}
+
+/* Stream a raw clip (tools/wav2clip.py --raw) from the card through the mixer */
+static void cli_cmd_sdplay(uint32_t argc, char **argv)
+{
+    uint32_t gain = SOUND_GAIN_UNITY;
+    int32_t  s;
+
+    if (argc < 2u || (argc > 2u && (!cli_number(argv[2], &gain) || gain > 0xFFFFu)))
+    {
+        cli_print("usage: sdplay <file> [gain], 256 = unity\r\n");
+        return;
+    }
+    s = Stream_Open(argv[1], false);
+    if (s < 0)
+    {
+        cli_print("sdplay: no free stream\r\n");
+        return;
+    }
+    for (uint32_t t = 0; t < 200u && !Stream_Ready(s) && !Stream_Ended(s); t++)
+        vTaskDelay(pdMS_TO_TICKS(10u));
+    if (Stream_Available(s) == 0u)
+    {
+        cli_print("sdplay: %s not found or empty\r\n", argv[1]);
+        Stream_Close(s);
+        return;
+    }
+    if (!Sound_CueStream(s, (uint16_t)gain))
+        cli_print("sdplay: sound off, or cue queue full\r\n");
+}
+
+/* Show-sync state, or a cue for every prop on the bus SHOWSYNC_CUE_LEAD_US ahead */
+static void cli_cmd_sync(uint32_t argc, char **argv)
+{
+    showsync_cue_t    q = { 0 };
+    showsync_status_t st;
+    uint32_t          a = 0u, b = 0u;
+
+    if (argc < 2u)
+    {
+        ShowSync_GetStatus(&st);
+        cli_print("node %u, master %u%s, %u peer(s)\r\n", st.node, st.master,
+                  st.locked ? "" : " (not locked)", st.peers);
+        cli_print("error %ld us, rate %ld ppm, delay %ld us, steps %lu, bus errors %lu\r\n",
+                  (long)st.err_us, (long)st.drift_ppm, (long)st.delay_us, (unsigned long)st.steps,
+                  (unsigned long)st.bus_errors);
+        return;
+    }
+    q.at = ShowSync_Now() + SHOWSYNC_CUE_LEAD_US;
+    if (strcmp(argv[1], "scare") == 0)
+    {
+        q.kind = SHOWSYNC_CUE_ACT;
+        q.ch   = ACT_CH_LID;
+        q.id   = SHOWSYNC_PICK;
+    }
+    else if (strcmp(argv[1], "play") == 0 && argc > 2u && cli_number(argv[2], &a) && a <= 0xFFu &&
+             (argc < 4u || (cli_number(argv[3], &b) && b <= 0xFFFFu)))
+    {
+        q.kind = SHOWSYNC_CUE_SOUND;
+        q.id   = (uint8_t)a;
+        q.gain = (argc < 4u) ? SOUND_GAIN_UNITY : (uint16_t)b;
+    }
+    else if (strcmp(argv[1], "fx") == 0 && argc > 2u && cli_number(argv[2], &a) && a < EFFECT_COUNT &&
+             (argc < 4u || (cli_number(argv[3], &b) && b <= 0xFFFFu)))
+    {
+        q.kind      = SHOWSYNC_CUE_EFFECT;
+        q.fx.op     = EFFECT_CMD_SELECT;
+        q.fx.id     = (uint8_t)a;
+        q.fx.frames = (uint16_t)b;
+    }
+    else if (strcmp(argv[1], "tl") == 0 && argc > 2u && cli_number(argv[2], &a) && a < SHOWSYNC_TIMELINES)
+    {
+        q.kind = SHOWSYNC_CUE_TIMELINE;
+        q.id   = (uint8_t)a;
+    }
+    else
+    {
+        cli_print("usage: sync [scare | play <id> [gain] | fx <n> [frames] | tl <id>]\r\n");
+        return;
+    }
+    if (!ShowSync_Cue(&q)) cli_print("sync: not sent, played here only\r\n");
+}
+
+static void cli_cmd_dmx(uint32_t argc, char **argv)
+{
+    dmx_stats_t st;
+
+    (void)argc;
+    (void)argv;
+    Dmx_GetStats(&st);
+    cli_print("dmx %s, %u slots, %lu packets, %lu dropped, %lu overruns\r\n",
+              st.present ? "present" : "no signal", st.slots, (unsigned long)st.packets,
+              (unsigned long)st.dropped, (unsigned long)st.overruns);
+}
+
+static void cli_cmd_net(uint32_t argc, char **argv)
+{
+    netbridge_stats_t st;
+
+    (void)argc;
+    (void)argv;
+    NetBridge_GetStats(&st);
+    cli_print("net %s, %u slots%s, %lu frames of %lu, %lu crc errors, %lu dropped, %lu overruns\r\n",
+              !NETBRIDGE_ENABLE ? "off" : st.present ? "present" : "no signal", st.slots,
+              !st.present ? "" : st.artnet ? " (Art-Net)" : " (sACN)", (unsigned long)st.frames,
+              (unsigned long)st.received, (unsigned long)st.crc_errors, (unsigned long)st.dropped,
+              (unsigned long)st.overruns);
+    cli_print("control %lu bytes in, %lu out, %lu lost\r\n",
+              (unsigned long)st.ctrl_in, (unsigned long)st.ctrl_out, (unsigned long)st.ctrl_lost);
+}
+
+static void cli_cmd_pixdist(uint32_t argc, char **argv)
+{
+    pixdist_stats_t st;
+
+    (void)argc;
+    (void)argv;
+    PixDist_GetStats(&st);
+    cli_print("pixdist %s, %lu frames, %lu skipped, %lu crc errors, %lu dropped, %lu overruns%s\r\n",
+              (PIXDIST_ROLE == PIXDIST_MASTER) ? "master" : (PIXDIST_ROLE == PIXDIST_SLAVE) ? "slave" : "off",
+              (unsigned long)st.frames, (unsigned long)st.skipped, (unsigned long)st.crc_errors,
+              (unsigned long)st.dropped, (unsigned long)st.overruns,
+              (PIXDIST_ROLE == PIXDIST_SLAVE && !st.present) ? ", no signal" : "");
+    cli_print("%lu key sections, %lu resyncs, %lu bytes sent\r\n",
+              (unsigned long)st.keys, (unsigned long)st.resyncs, (unsigned long)st.bytes);
+}
+
+#define CLI_X_ACT_NAME(id, name, ...)   name,      /* SHOW_ACTUATORS rows */
+
+/* Lifetime counts for the replacement schedule (wear.h) */
+static void cli_cmd_wear(uint32_t argc, char **argv)
+{
+    static const char *const chan[ACT_CHANNELS] = { SHOW_ACTUATORS(CLI_X_ACT_NAME) };
+    wear_t w;
+
+    (void)argc;
+    (void)argv;
+    Wear_Get(&w);
+    cli_print("boots %lu, scares %lu, brown-outs %lu, powered %lu h %02lu min%s\r\n",
+              (unsigned long)w.boots, (unsigned long)w.scares, (unsigned long)w.brownouts,
+              (unsigned long)(w.uptime_s / 3600u), (unsigned long)(w.uptime_s / 60u % 60u),
+              Settings_Ready() ? "" : " (since boot, not kept)");
+    for (uint32_t ch = 0; ch < ACT_CHANNELS; ch++)
+        cli_print("%s: relay up %lu, down %lu closures, energised %lu s\r\n", chan[ch],
+                  (unsigned long)w.relay[ch][0], (unsigned long)w.relay[ch][1],
+                  (unsigned long)w.on_s[ch]);
+}
+
+#if ESTOP_ENABLE
+/* E-stop latch (estop.h); `clear` releases it once the switch is up */
+static void cli_cmd_estop(uint32_t argc, char **argv)
+{
+    if (argc == 2u && strcmp(argv[1], "clear") == 0 && !EStop_Clear())
+        cli_print("still held, latch kept\r\n");
+    cli_print("e-stop %s, input %s, %lu presses\r\n", EStop_Latched() ? "LATCHED" : "clear",
+              EStop_Held() ? "held" : "up", (unsigned long)EStop_Count());
+}
+#endif
+
+/* The fault that reset the board last (fault.h), kept until the next reset */
+static void cli_cmd_fault(uint32_t argc, char **argv)
+{
+    const fault_record_t *r = Fault_Last();
+
+    if (argc == 2u && strcmp(argv[1], "ack") == 0)
+    {
+        StatusLed_Ack();
+        cli_print("status LED back to normal\r\n");
+        return;
+    }
+    if (r == NULL)
+    {
+        cli_print("no fault before this boot\r\n");
+        return;
+    }
+    cli_print("%s, task '%s', exception %lu, tick %lu\r\n", Fault_CauseName(r->cause), r->task,
+              (unsigned long)r->exception, (unsigned long)r->tick);
+    if (r->cause == FAULT_ASSERT)
+        cli_print("assert at %s:%lu\r\n", r->file, (unsigned long)r->line);
+    if (r->cause == FAULT_WATCHDOG)
+        cli_print("'%s' missed its heartbeat\r\n", r->late);
+    cli_print("r0  %08lx r1  %08lx r2  %08lx r3  %08lx\r\n", (unsigned long)r->frame[0],
+              (unsigned long)r->frame[1], (unsigned long)r->frame[2], (unsigned long)r->frame[3]);
+    cli_print("r12 %08lx lr  %08lx pc  %08lx psr %08lx\r\n", (unsigned long)r->frame[4],
+              (unsigned long)r->frame[5], (unsigned long)r->frame[6], (unsigned long)r->frame[7]);
+    cli_print("sp  %08lx exc %08lx\r\n", (unsigned long)r->sp, (unsigned long)r->exc_return);
+    cli_print("cfsr %08lx hfsr %08lx mmfar %08lx bfar %08lx\r\n", (unsigned long)r->cfsr,
+              (unsigned long)r->hfsr, (unsigned long)r->mmfar, (unsigned long)r->bfar);
+    cli_print("trace");
+    for (uint32_t i = 0; i < FAULT_TRACE && r->trace[i] != 0u; i++)
+        cli_print(" %08lx", (unsigned long)r->trace[i]);
+    cli_print("\r\n");
+}
+
+/* Microseconds from reset to each boot phase, and what the Init task ran (boot.h) */
+static void cli_cmd_boot(uint32_t argc, char **argv)
+{
+    const char *name;
+    uint32_t    us;
+
+    (void)argc;
+    (void)argv;
+    for (uint32_t p = BOOT_MAIN; p < BOOT_PHASES; p++)
+        cli_print("%-10s %8lu us\r\n", Boot_PhaseName((boot_phase_t)p), (unsigned long)Boot_Us((boot_phase_t)p));
+    for (uint32_t i = 0; Boot_DeferredInfo(i, &name, &us); i++)
+        cli_print("deferred %-8s %4lu us\r\n", name, (unsigned long)us);
+}
+
+/* An image into the other flash bank (fwupdate.h), sent by tools/fwupdate.py:
+ * one "fwup: more <offset>" per FWUPDATE_CHUNK, so the RX stream never overflows */
+static void cli_cmd_fwup(uint32_t argc, char **argv)
+{
+    static uint8_t chunk[FWUPDATE_CHUNK];       /* one line runs at a time (cli_lock) */
+    static const char *const state[] = { "idle", "receiving", "armed, swapping at the next gap", "failed" };
+    StreamBufferHandle_t rx = cli_out->rx();
+    uint32_t size, crc;
+
+    if (argc == 2u && strcmp(argv[1], "cancel") == 0)
+    {
+        FwUpdate_Cancel();
+        cli_print("fwup: cancelled\r\n");
+        return;
+    }
+    if (argc == 1u)
+    {
+        cli_print("fwup: running bank %c, %s, %lu bytes written\r\n", FwUpdate_BankA() ? 'A' : 'B',
+                  state[FwUpdate_State()], (unsigned long)FwUpdate_Written());
+        return;
+    }
+    if (argc < 3u || !cli_number(argv[1], &size) || !cli_number(argv[2], &crc) || !FwUpdate_Begin(size, crc))
+    {
+        cli_print("usage: fwup [<size> <crc32> | cancel], size a multiple of 4 up to %lu\r\n",
+                  (unsigned long)FWUPDATE_IMAGE_MAX);
+        return;
+    }
+
+    for (uint32_t done = 0; done < size; )
+    {
+        uint32_t want = (size - done < FWUPDATE_CHUNK) ? size - done : FWUPDATE_CHUNK;
+        uint32_t got  = 0;
+
+        cli_print("fwup: more %lu\r\n", (unsigned long)done);
+        while (got < want)
+        {
+            size_t n = xStreamBufferReceive(rx, &chunk[got], want - got, pdMS_TO_TICKS(FWUPDATE_CHUNK_MS));
+
+            if (n == 0u)
+            {
+                FwUpdate_Cancel();
+                cli_print("fwup: FAILED, timeout at %lu\r\n", (unsigned long)(done + got));
+                return;
+            }
+            got += (uint32_t)n;
+        }
+        if (!FwUpdate_Write(chunk, want))
+        {
+            cli_print("fwup: FAILED, flash error at %lu\r\n", (unsigned long)done);
+            return;
+        }
+        done += want;
+    }
+    cli_print(FwUpdate_Finish() ? "fwup: image ok, swapping at the next gap\r\n"
+                                : "fwup: FAILED, CRC mismatch\r\n");
+}
+
+/* Rendered frames to the host as telem.h 'F' frames */
+static void cli_cmd_capture(uint32_t argc, char **argv)
+{
+    uint32_t frames;
+    uint32_t every = Telem_CaptureEvery();
+
+    if (argc >= 2u)
+    {
+        if (!cli_number(argv[1], &frames) || (argc >= 3u && (!cli_number(argv[2], &every) || every > 255u)))
+        {
+            cli_print("usage: capture [frames] [every], 0 = stop\r\n");
+            return;
+        }
+        Telem_Capture(frames, (uint8_t)every);
+    }
+    cli_print("capture: %lu frames to send, 1 in %u, on %s\r\n", (unsigned long)Telem_CaptureLeft(),
+              (unsigned)Telem_CaptureEvery(), UsbCdc_Connected() ? "USB" : "the console");
+}
+
+#if RTOS_TRACE_ENABLE
+/* Stop the recorder and print the whole area for tools/rtos_trace2json.py */
+static void cli_cmd_trace(uint32_t argc, char **argv)
+{
+    const uint8_t *p = (const uint8_t *)&rtos_trace;
+
+    (void)argc;
+    (void)argv;
+    RtosTrace_Enable(0u);
+    cli_print("trace begin %lu\r\n", (unsigned long)sizeof(rtos_trace));
+    for (uint32_t off = 0; off < sizeof(rtos_trace); off += 32u)
+    {
+        char     hex[2u * 32u + 1u];
+        uint32_t n = (sizeof(rtos_trace) - off < 32u) ? sizeof(rtos_trace) - off : 32u;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            hex[2u * i]      = "0123456789abcdef"[p[off + i] >> 4];
+            hex[2u * i + 1u] = "0123456789abcdef"[p[off + i] & 0x0Fu];
+        }
+        hex[2u * n] = '\0';
+        cli_print("trace %05lx %s\r\n", (unsigned long)off, hex);
+    }
+    cli_print("trace end\r\n");
+    RtosTrace_Enable(1u);
+}
+#endif
+
+#if LATBENCH_ENABLE
+/* Edge -> relay / LED percentiles so far (latbench.h); "lat reset" starts a new run */
+static void cli_cmd_lat(uint32_t argc, char **argv)
+{
+    static const char *const stage[LATBENCH_STAGES] = { "relay", "led" };
+    latbench_result_t r;
+
+    if (argc == 2u && strcmp(argv[1], "reset") == 0)
+    {
+        LatBench_Reset();
+        cli_print("lat: new run\r\n");
+        return;
+    }
+    cli_print("lat: %lu edges, %lu while busy\r\n",
+              (unsigned long)LatBench_Edges(), (unsigned long)LatBench_Overlapped());
+    for (uint32_t s = 0; s < LATBENCH_STAGES; s++)
+    {
+        (void)LatBench_Get((latbench_stage_t)s, &r);
+        cli_print("%-6s n %6lu  p50 %7lu  p99 %7lu  max %7lu us  lost %lu\r\n", stage[s],
+                  (unsigned long)r.n, (unsigned long)r.p50_us, (unsigned long)r.p99_us,
+                  (unsigned long)r.max_us, (unsigned long)r.lost);
+    }
+}
+#endif
+
+#if RTOSBENCH_ENABLE
+/* The kernel primitives in cycles (rtosbench.h), and the options they depend on */
+static void cli_cmd_rtbench(uint32_t argc, char **argv)
+{
+    static rtosbench_result_t r[RTOSBENCH_ROWS];
+
+    (void)argc;
+    (void)argv;
+    cli_print("rtbench: FreeRTOS %s, gcc %s%s, port task select %u, stack check %u, trace %u, run stats %u\r\n",
+              tskKERNEL_VERSION_NUMBER, __VERSION__,
+#if defined(__OPTIMIZE_SIZE__)
+              " -Os",
+#elif defined(__OPTIMIZE__)
+              " -O1+",
+#else
+              " -O0",
+#endif
+              (unsigned)configUSE_PORT_OPTIMISED_TASK_SELECTION, (unsigned)configCHECK_FOR_STACK_OVERFLOW,
+              (unsigned)configUSE_TRACE_FACILITY, (unsigned)configGENERATE_RUN_TIME_STATS);
+    RtosBench_Run(r);
+    cli_print("%-10s %6s %6s %6s %6s cycles\r\n", "", "n", "min", "avg", "max");
+    for (uint32_t i = 0; i < RTOSBENCH_ROWS; i++)
+        cli_print("%-10s %6lu %6lu %6lu %6lu\r\n", RtosBench_Name((rtosbench_row_t)i), (unsigned long)r[i].n,
+                  (unsigned long)r[i].min, (unsigned long)r[i].avg, (unsigned long)r[i].max);
+    if (r[RTOSBENCH_STREAM].avg != 0u)
+        cli_print("stream: %lu KB/s in %u-byte sends\r\n",
+                  (unsigned long)((uint64_t)RTOSBENCH_SB_CHUNK * configCPU_CLOCK_HZ / r[RTOSBENCH_STREAM].avg / 1024u),
+                  (unsigned)RTOSBENCH_SB_CHUNK);
+    if (r[RTOSBENCH_LZ_BLOCK].avg != 0u)
+        cli_print("lz block: %lu KB/s decoded\r\n",
+                  (unsigned long)((uint64_t)RTOSBENCH_LZ_BYTES * configCPU_CLOCK_HZ / r[RTOSBENCH_LZ_BLOCK].avg / 1024u));
+    if (r[RTOSBENCH_ADPCM_BLOCK].avg != 0u)
+    {
+        /* hundredths of a per cent of the CPU for one voice in real time */
+        uint32_t load = (uint32_t)((uint64_t)r[RTOSBENCH_ADPCM_BLOCK].avg * SOUND_RATE_HZ * 10000u /
+                                   ((uint64_t)ADPCM_BLOCK_SAMPLES * configCPU_CLOCK_HZ));
+
+        cli_print("adpcm: %lu cycles a sample, %lu.%02lu %% of the CPU a voice\r\n",
+                  (unsigned long)(r[RTOSBENCH_ADPCM_BLOCK].avg / ADPCM_BLOCK_SAMPLES),
+                  (unsigned long)(load / 100u), (unsigned long)(load % 100u));
+    }
+}
+#endif
+
+#if DMARAM_BENCH_ENABLE
+/* CPU passes with the DMAC idle and busy, buffers apart and shared (dmaram.h) */
+static void cli_cmd_dmabench(uint32_t argc, char **argv)
+{
+    static dmaram_bench_result_t r[DMARAM_BENCH_ROWS];
+
+    (void)argc;
+    (void)argv;
+    DmaRam_Benchmark(r);
+    cli_print("dmabench: %u-byte CPU pass, %u-byte DMAC copy in ram_dma\r\n",
+              (unsigned)DMARAM_BENCH_CPU_BYTES, (unsigned)DMARAM_BENCH_BYTES);
+    cli_print("%-10s %6s %6s %6s %6s %6s cycles\r\n", "", "n", "min", "avg", "max", "dma");
+    for (uint32_t i = 0; i < DMARAM_BENCH_ROWS; i++)
+        cli_print("%-10s %6lu %6lu %6lu %6lu %6lu\r\n", DmaRam_BenchName((dmaram_bench_row_t)i),
+                  (unsigned long)r[i].n, (unsigned long)r[i].min, (unsigned long)r[i].avg,
+                  (unsigned long)r[i].max, (unsigned long)r[i].dma_avg);
+}
+#endif
+
+#if LOADTEST_ENABLE
+/* Synthetic load (loadtest.h): "load <edges/s> [s] [fx]" starts, "load stop" ends, "load" the table */
+static void cli_cmd_load(uint32_t argc, char **argv)
+{
+    static loadtest_level_t lv[LOADTEST_OBJECTS];
+    loadtest_status_t       st;
+    uint32_t                n;
+
+    if (argc > 1u && strcmp(argv[1], "stop") == 0)
+    {
+        LoadTest_Stop();
+    }
+    else if (argc > 1u)
+    {
+        uint32_t hz = (uint32_t)strtoul(argv[1], NULL, 0);
+        uint32_t s  = (argc > 2u) ? (uint32_t)strtoul(argv[2], NULL, 0) : 0u;
+        bool     fx = argc > 3u && strcmp(argv[3], "fx") == 0;
+
+        if (!LoadTest_Start(hz, s, fx))
+        {
+            cli_print("load: 0 .. %u edges/s, up to 1800 s\r\n", (unsigned)LOADTEST_EDGE_HZ_MAX);
+            return;
+        }
+    }
+    LoadTest_GetStatus(&st);
+    cli_print("load: %s, %lu edges/s%s, %lu edges in %lu ms (\"top\": task shares)\r\n",
+              st.running ? "running" : "stopped", (unsigned long)st.edge_hz, st.fx ? " + fx layers" : "",
+              (unsigned long)st.edges, (unsigned long)st.ms);
+    n = LoadTest_GetLevels(lv, LOADTEST_OBJECTS);
+    cli_print("%-12s %6s %6s %8s %6s\r\n", "object", "high", "size", "sends", "full");
+    for (uint32_t i = 0; i < n; i++)
+    {
+        char addr[12];
+
+        if (lv[i].name == NULL) (void)snprintf(addr, sizeof(addr), "%08lx", (unsigned long)(uintptr_t)lv[i].obj);
+        cli_print("%-12s %6lu %6lu %8lu %6lu\r\n", (lv[i].name != NULL) ? lv[i].name : addr,
+                  (unsigned long)lv[i].high, (unsigned long)lv[i].size, (unsigned long)lv[i].sends,
+                  (unsigned long)lv[i].full);
+    }
+}
+#endif
+
+#if REPLAY_ENABLE
+/* Record / play back the inputs and draws (replay.h); "dump" prints "put" lines that load it again */
+static void cli_cmd_replay(uint32_t argc, char **argv)
+{
+    static const char *const mode[] = { "idle", "recording", "playing" };
+    static const char *const kind[REPLAY_KINDS] = { "?", "seed", "mix", "edge", "knob", "hold",
+                                                    "pace", "hurry", "pool", "end" };
+    replay_status_t st;
+    replay_rec_t    r;
+    const char     *op = (argc > 1u) ? argv[1] : "";
+
+    if (strcmp(op, "rec") == 0)
+    {
+        Replay_Record();
+    }
+    else if (strcmp(op, "stop") == 0)
+    {
+        Replay_Stop();
+    }
+    else if (strcmp(op, "play") == 0)
+    {
+        if (!Replay_Play())
+        {
+            cli_print("replay: nothing complete to play (\"replay stop\" ends a recording)\r\n");
+            return;
+        }
+    }
+    else if (strcmp(op, "clear") == 0)
+    {
+        Replay_Clear();
+        return;
+    }
+    else if (strcmp(op, "put") == 0)
+    {
+        uint8_t *p = (uint8_t *)&r;
+
+        if (argc != 3u || strlen(argv[2]) != 2u * sizeof(r))
+        {
+            cli_print("replay: put <%u hex digits>\r\n", (unsigned)(2u * sizeof(r)));
+            return;
+        }
+        for (uint32_t i = 0; i < sizeof(r); i++)
+        {
+            char byte[3] = { argv[2][2u * i], argv[2][2u * i + 1u], '\0' };
+
+            p[i] = (uint8_t)strtoul(byte, NULL, 16);
+        }
+        if (!Replay_Put(&r)) cli_print("replay: put refused (full, busy or not a record)\r\n");
+        return;
+    }
+    else if (strcmp(op, "dump") == 0 || strcmp(op, "list") == 0)
+    {
+        bool hex = op[0] == 'd';
+
+        if (hex) cli_print("replay clear\r\n");
+        for (uint32_t i = 0; Replay_Get(i, &r); i++)
+        {
+            if (hex)
+            {
+                const uint8_t *p = (const uint8_t *)&r;
+                char           line[2u * sizeof(r) + 1u];
+
+                for (uint32_t k = 0; k < sizeof(r); k++)
+                {
+                    line[2u * k]      = "0123456789abcdef"[p[k] >> 4];
+                    line[2u * k + 1u] = "0123456789abcdef"[p[k] & 0x0Fu];
+                }
+                line[2u * sizeof(r)] = '\0';
+                cli_print("replay put %s\r\n", line);
+            }
+            else
+            {
+                cli_print("%4lu %-5s %2u %10lu %s %ld\r\n", (unsigned long)i,
+                          (r.kind < REPLAY_KINDS) ? kind[r.kind] : "?", (unsigned)r.arg,
+                          (unsigned long)r.at, (r.kind == REPLAY_MIX) ? "draw" : "us  ", (long)r.value);
+            }
+        }
+        return;
+    }
+    else if (argc > 1u)
+    {
+        cli_print("replay: [rec|stop|play|dump|list|clear|put <hex>]\r\n");
+        return;
+    }
+    Replay_GetStatus(&st);
+    cli_print("replay: %s, %lu of %u records, %lu ms%s\r\n", mode[st.mode], (unsigned long)st.records,
+              (unsigned)REPLAY_RECORDS, (unsigned long)st.span_ms, st.full ? " (ring full: ended)" : "");
+    cli_print("replay: %lu inputs fed, %lu decisions as recorded, %lu diverged", (unsigned long)st.fed,
+              (unsigned long)st.matched, (unsigned long)st.diverged);
+    if (st.diverged != 0u) cli_print(" from %lu ms", (unsigned long)st.diverged_ms);
+    cli_print("\r\n");
+}
+#endif
+
+/* Where the frame rate controller stands (fpsctl.h) */
+static void cli_cmd_fps(uint32_t argc, char **argv)
+{
+    fpsctl_status_t s;
+
+    (void)argc;
+    (void)argv;
+    FpsCtl_Get(&s);
+    cli_print("fps: rung %lu, %lu.%02lu fps, peak frame %lu us, next rise after %lu windows\r\n",
+              (unsigned long)s.rung, (unsigned long)(s.fps_q4 / 16u),
+              (unsigned long)((s.fps_q4 % 16u) * 100u / 16u), (unsigned long)s.peak_us,
+              (unsigned long)s.hold);
+    cli_print("fps: %lu steps down, %lu up%s\r\n", (unsigned long)s.downs, (unsigned long)s.ups,
+              FPSCTL_ENABLE ? "" : " (FPSCTL_ENABLE 0: fixed)");
+}
+
+/* Supply rails, room light and what they drive (railmon.h, power.h) */
+static void cli_cmd_rail(uint32_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    cli_print("rail: 5 V %lu mV, actuator %lu mV, light %lu / 1000%s\r\n",
+              (unsigned long)RailMon_Read(RAILMON_5V), (unsigned long)RailMon_Read(RAILMON_ACT),
+              (unsigned long)RailMon_Read(RAILMON_LIGHT), RAILMON_ENABLE ? "" : " (RAILMON_ENABLE 0)");
+    cli_print("rail: LED budget %lu of %lu mA, last frame %lu mA, brightness %lu%%\r\n",
+              (unsigned long)Power_Budget(), (unsigned long)POWER_BUDGET_MA,
+              (unsigned long)Power_LastMilliamps(), (unsigned long)RailMon_BrightPct());
+    cli_print("rail: %lu scans, %lu late\r\n", (unsigned long)RailMon_Scans(), (unsigned long)RailMon_Late());
+}
+
+static void cli_cmd_knob(uint32_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    cli_print("knob: %ld detents, %lu quadrature errors%s\r\n", (long)Knob_Position(),
+              (unsigned long)Knob_Errors(), KNOB_ENABLE ? "" : " (KNOB_ENABLE 0)");
+}
+
+static void cli_cmd_tof(uint32_t argc, char **argv)
+{
+    tof_stats_t s;
+
+    (void)argc;
+    (void)argv;
+    Tof_GetStats(&s);
+    cli_print("tof: %s, %u mm status %u, signal %lu kcps, ambient %lu kcps, %u SPADs%s\r\n",
+              s.ranging ? "ranging" : "stopped", (unsigned)s.mm, (unsigned)s.status,
+              (unsigned long)s.signal_kcps, (unsigned long)s.ambient_kcps, (unsigned)s.spads,
+              TOF_ENABLE ? "" : " (TOF_ENABLE 0)");
+    cli_print("tof: %lu readings, %lu invalid, %lu missed, %lu I2C errors, %lu setups\r\n",
+              (unsigned long)s.readings, (unsigned long)s.invalid, (unsigned long)s.missed,
+              (unsigned long)s.i2c_errors, (unsigned long)s.setups);
+}
+
+static void cli_cmd_img(uint32_t argc, char **argv)
+{
+    static const char * const state[] = { "not sealed", "checking", "verified", "BAD" };
+    imgcheck_state_t s = ImgCheck_State();
+
+    if (argc > 1u && strcmp(argv[1], "seal") == 0)
+    {
+        cli_print("img: %s\r\n", ImgCheck_SealRunning() ? "sealed" : "seal failed");
+        return;
+    }
+    cli_print("img: %s, %lu bytes, boot pass %lu us, relays %s%s\r\n", state[s],
+              (unsigned long)ImgCheck_Size(), (unsigned long)ImgCheck_BootUs(),
+              ImgCheck_Ok() ? "allowed" : "held off", IMGCHECK_ENABLE ? "" : " (IMGCHECK_ENABLE 0)");
+}
+
+static hrtimer_t         cli_hrt;
+static volatile uint32_t cli_hrt_ran;
+
+static void cli_hrt_fn(hrtimer_t *t, void *arg)
+{
+    (void)t;
+    (void)arg;
+    cli_hrt_ran = ShowClock_Now();
+}
+
+/* Microsecond callbacks (hrtimer.h): their counters; "hrt <us>" times a one-shot */
+static void cli_cmd_hrt(uint32_t argc, char **argv)
+{
+    hrtimer_stats_t st;
+
+    if (argc > 1u)
+    {
+        uint32_t us  = (uint32_t)strtoul(argv[1], NULL, 0);
+        uint32_t due;
+
+        if (us == 0u || us > 1000000u)
+        {
+            cli_print("hrt: 1 .. 1000000 us\r\n");
+            return;
+        }
+        if (cli_hrt.fn == NULL) HrTimer_Create(&cli_hrt, cli_hrt_fn, NULL, HRTIMER_ISR);
+        cli_hrt_ran = 0u;
+        due = ShowClock_Now() + us;
+        HrTimer_StartAt(&cli_hrt, due, 0u);
+        vTaskDelay(ShowClock_TicksUntil(due) + 2u);
+        if (HrTimer_Armed(&cli_hrt)) cli_print("hrt: not fired\r\n");
+        else                         cli_print("hrt: ran %ld us after its due time\r\n", (long)(int32_t)(cli_hrt_ran - due));
+    }
+    HrTimer_GetStats(&st);
+    cli_print("hrt: %u armed, fired %lu, to the timer task %lu, dropped %lu, late %lu (max %lu us), skipped %lu\r\n",
+              (unsigned)st.armed, (unsigned long)st.fired, (unsigned long)st.deferred, (unsigned long)st.dropped,
+              (unsigned long)st.late, (unsigned long)st.late_max_us, (unsigned long)st.skipped);
+}
+
+/* A compiled show (showscript.h): play an ASSET_SHOW asset, stop, or its progress */
+static void cli_cmd_show(uint32_t argc, char **argv)
+{
+    showscript_status_t st;
+
+    if (argc > 1u && strcmp(argv[1], "stop") == 0)
+    {
+        ShowScript_Stop();
+    }
+    else if (argc > 1u && !ShowScript_PlayAsset(argv[1]))
+    {
+        cli_print("show: no valid show asset '%s' (\"assets\" lists them)\r\n", argv[1]);
+        return;
+    }
+    ShowScript_GetStatus(&st);
+    cli_print("show: %s%s%s, %u cues, %u timelines, loop %lu ms, pass %lu, done %lu, refused %lu, late %lu\r\n",
+              st.playing ? "playing" : "idle", (st.name[0] != '\0') ? " " : "", st.name,
+              (unsigned)st.cues, (unsigned)st.timelines, (unsigned long)(st.loop_us / 1000u),
+              (unsigned long)st.passes, (unsigned long)st.done, (unsigned long)st.refused,
+              (unsigned long)st.late);
+}
+
+/* The output sequencer: play a built-in pattern, stop, or its state */
+static void cli_cmd_ioseq(uint32_t argc, char **argv)
+{
+    ioseq_stats_t st;
+    uint32_t      p;
+
+    if (argc > 1u && strcmp(argv[1], "stop") == 0)
+    {
+        IoSeq_Stop();
+    }
+    else if (argc > 1u)
+    {
+        for (p = 0; p < IOSEQ_PATTERNS; p++)
+            if (strcmp(IoSeq_PatternName((ioseq_pattern_t)p), argv[1]) == 0) break;
+        if (p == IOSEQ_PATTERNS)
+        {
+            cli_print("ioseq: patterns");
+            for (p = 0; p < IOSEQ_PATTERNS; p++) cli_print(" %s", IoSeq_PatternName((ioseq_pattern_t)p));
+            cli_print("\r\n");
+            return;
+        }
+        if (!IoSeq_Pattern((ioseq_pattern_t)p))
+            cli_print("ioseq: refused (brown-out, parked or image not verified)\r\n");
+    }
+    IoSeq_GetStats(&st);
+    cli_print("ioseq: %s, %u ring words, played %lu, done %lu, refused %lu%s\r\n",
+              IoSeq_Busy() ? "playing" : "idle", (unsigned)st.words, (unsigned long)st.plays,
+              (unsigned long)st.done, (unsigned long)st.refused, IOSEQ_ENABLE ? "" : " (IOSEQ_ENABLE 0)");
+}
+
+/* The servo bank: every servo's state, or move / release one */
+static void cli_cmd_servo(uint32_t argc, char **argv)
+{
+    servo_state_t st;
+    uint32_t      i;
+
+    if (argc > 2u)
+    {
+        for (i = 0; i < SERVO_COUNT; i++)
+            if (Servo_Name((servo_id_t)i) != NULL && strcmp(Servo_Name((servo_id_t)i), argv[1]) == 0) break;
+        if (i == SERVO_COUNT)
+        {
+            cli_print("servo: no \"%s\"\r\n", argv[1]);
+            return;
+        }
+        if (strcmp(argv[2], "off") == 0)
+            Servo_Release((servo_id_t)i);
+        else if (!Servo_Set((servo_id_t)i, (uint16_t)strtoul(argv[2], NULL, 10)))
+            cli_print("servo: SERVO_ENABLE 0\r\n");
+    }
+    for (i = 0; i < SERVO_COUNT; i++)
+    {
+        if (!Servo_Get((servo_id_t)i, &st)) continue;
+        cli_print("servo %-6s %4u us -> %4u us%s%s\r\n", Servo_Name((servo_id_t)i), (unsigned)st.now_us,
+                  (unsigned)st.target_us, st.released ? ", off" : "", st.moving ? ", moving" : "");
+    }
+    cli_print("servo: %lu frames%s\r\n", (unsigned long)Servo_Frames(), SERVO_ENABLE ? "" : " (SERVO_ENABLE 0)");
+}
+
+/* Plan a move and show its segments; the cache counters either way */
+static void cli_cmd_motion(uint32_t argc, char **argv)
+{
+    motion_stats_t   st;
+    motion_profile_t pf;
+
+    if (argc >= 4u)
+    {
+        motion_move_t m = { (int32_t)strtol(argv[1], NULL, 10), (uint32_t)strtoul(argv[2], NULL, 10),
+                            (uint32_t)strtoul(argv[3], NULL, 10),
+                            (argc > 4u) ? (uint32_t)strtoul(argv[4], NULL, 10) : 0u,
+                            (argc > 5u) ? (uint32_t)strtoul(argv[5], NULL, 10) : 1000u };
+
+        if (!Motion_Plan(&m, &pf))
+        {
+            cli_print("motion: refused (limit 0 or too fine, or too long)\r\n");
+        }
+        else
+        {
+            cli_print("motion: %ld in %lu ticks, %lu ms:", (long)pf.dist, (unsigned long)pf.ticks,
+                      (unsigned long)((uint64_t)pf.ticks * 1000u / m.tick_hz));
+            for (uint32_t i = 0; i < pf.segs; i++) cli_print(" %lu", (unsigned long)pf.seg[i].ticks);
+            cli_print("\r\n");
+        }
+    }
+    Motion_GetStats(&st);
+    cli_print("motion: %lu planned, %lu from the cache, %lu refused\r\n",
+              (unsigned long)st.plans, (unsigned long)st.hits, (unsigned long)st.refused);
+}
+
+static const char * const cli_day[7] = { "mon", "tue", "wed", "thu", "fri", "sat", "sun" };
+
+/* "hh:mm" -> minute of the day */
+static bool cli_hhmm(const char *s, uint32_t *out)
+{
+    char    *end;
+    uint32_t h = (uint32_t)strtoul(s, &end, 10);
+    uint32_t m;
+
+    if (end == s || *end != ':') return false;
+    s = end + 1;
+    m = (uint32_t)strtoul(s, &end, 10);
+    if (end == s || *end != '\0' || h > 23u || m > 59u) return false;
+    *out = h * 60u + m;
+    return true;
+}
+
+/* Opening hours: the clock, open or closed, the windows (showcal.h) */
+static void cli_cmd_cal(uint32_t argc, char **argv)
+{
+    showcal_window_t w;
+    uint32_t         n, mow, day;
+
+    if (argc == 4u && strcmp(argv[1], "time") == 0)
+    {
+        for (day = 0; day < 7u && strcmp(argv[2], cli_day[day]) != 0; day++) {}
+        if (day == 7u || !cli_hhmm(argv[3], &mow))
+        {
+            cli_print("usage: cal time <mon..sun> <hh:mm>\r\n");
+            return;
+        }
+        ShowCal_SetTime(day * 24u * 60u + mow);
+    }
+    else if (argc >= 3u && strcmp(argv[1], "win") == 0)
+    {
+        uint32_t days = 0u, open = 0u, close = 0u;
+        bool     off  = (argc == 4u && strcmp(argv[3], "off") == 0);
+        bool     ok   = cli_number(argv[2], &n)
+                     && (off || (argc == 6u && cli_number(argv[3], &days) && days != 0u && days <= 0x7Fu
+                                 && cli_hhmm(argv[4], &open) && cli_hhmm(argv[5], &close)));
+        w.days  = (uint8_t)days;
+        w.open  = (uint16_t)open;
+        w.close = (uint16_t)close;
+        if (!ok || !ShowCal_SetWindow(n, &w))
+        {
+            cli_print("usage: cal win <0..%lu> <days 0x01 mon .. 0x40 sun> <hh:mm> <hh:mm> | off\r\n",
+                      (unsigned long)(SHOWCAL_MAX_WINDOWS - 1u));
+            return;
+        }
+    }
+    else if (argc != 1u)
+    {
+        cli_print("usage: cal [time <day> <hh:mm> | win <n> ...]\r\n");
+        return;
+    }
+
+    if (ShowCal_Now(&mow))
+        cli_print("cal: %s %02lu:%02lu, ", cli_day[mow / (24u * 60u)],
+                  (unsigned long)(mow / 60u % 24u), (unsigned long)(mow % 60u));
+    else
+        cli_print("cal: clock not set, ");
+    n = ShowCal_WakeLeft();
+    if (n != 0u)
+        cli_print("open for an arrival, %lu min left\r\n", (unsigned long)n);
+    else
+        cli_print("%s%s\r\n", ShowCal_Open() ? "open" : "closed", SHOWCAL_ENABLE ? "" : " (SHOWCAL_ENABLE 0)");
+    for (n = 0; n < SHOWCAL_MAX_WINDOWS; n++)
+    {
+        if (!ShowCal_GetWindow(n, &w) || w.days == 0u) continue;
+        cli_print("  %lu: days 0x%02x  %02u:%02u - %02u:%02u\r\n", (unsigned long)n, w.days,
+                  w.open / 60u, w.open % 60u, w.close / 60u, w.close % 60u);
+    }
+}
+
+/* The NVIC priority table (irqprio.h) and, with IRQSTAT_ENABLE, what each ISR costs */
+static void cli_cmd_irq(uint32_t argc, char **argv)
+{
+#if IRQSTAT_ENABLE
+    irqstat_t     s;
+    defer_stats_t d;
+    uint32_t      block;
+
+    if (argc == 2u && strcmp(argv[1], "reset") == 0)
+    {
+        IrqStat_Reset();
+        cli_print("irq: counters cleared\r\n");
+        return;
+    }
+    cli_print("irq       pri        n    max    avg   late    avg  cycles\r\n");
+    for (uint32_t i = 0; i < IRQSTAT_COUNT; i++)
+    {
+        IrqStat_Get((irqstat_id_t)i, &s);
+        cli_print("%-9s %3lu %8lu %6lu %6lu", IrqStat_Name((irqstat_id_t)i),
+                  (unsigned long)IrqStat_Prio((irqstat_id_t)i), (unsigned long)s.n,
+                  (unsigned long)s.max_cycles,
+                  (unsigned long)((s.n != 0u) ? s.busy_cycles / s.n : 0u));
+        if (s.late_n != 0u)
+            cli_print(" %6lu %6lu\r\n", (unsigned long)s.late_max_cycles,
+                      (unsigned long)(s.late_cycles / s.late_n));
+        else
+            cli_print("\r\n");
+    }
+    block = IrqStat_NeoBlockCycles();
+    cli_print("neo refill: held off <= %lu cycles (%lu us) by the others\r\n",
+              (unsigned long)block, (unsigned long)(block / (configCPU_CLOCK_HZ / 1000000u)));
+    Defer_GetStats(&d);
+    cli_print("defer: %lu calls, %lu dropped, %lu of %u waiting at most, longest %lu cycles\r\n",
+              (unsigned long)d.calls, (unsigned long)d.dropped, (unsigned long)d.peak,
+              (unsigned)DEFER_SLOTS, (unsigned long)d.max_cycles);
+#else
+    (void)argc;
+    (void)argv;
+    cli_print("irq       pri  (IRQSTAT_ENABLE 0: no counters)\r\n");
+    for (uint32_t i = 0; i < IRQSTAT_COUNT; i++)
+        cli_print("%-9s %3lu\r\n", IrqStat_Name((irqstat_id_t)i),
+                  (unsigned long)IrqStat_Prio((irqstat_id_t)i));
+#endif
+}
+
+static void cli_cmd_help(uint32_t argc, char **argv);
+
+typedef struct
+{
+    const char *name;
+    void      (*run)(uint32_t argc, char **argv);
+    const char *help;
+} cli_cmd_t;
+
+static const cli_cmd_t cli_cmds[] =
+{
+    { "get",      cli_cmd_get,      "[name]          show parameters"         },
+    { "set",      cli_cmd_set,      "<name> <value>  change one"              },
+    { "save",     cli_cmd_save,     "                keep them in flash"      },
+    { "defaults", cli_cmd_defaults, "                back to the built-in set" },
+    { "fx",       cli_cmd_fx,       "[name|n] [fr]   list / switch, load / plugins" },
+    { "frame",    cli_cmd_frame,    "[name|n] [fr]   pre-encoded frame"       },
+    { "top",      cli_cmd_top,      "                CPU share per task"      },
+    { "stack",    cli_cmd_stack,    "                stack use, sizes to set" },
+    { "pool",     cli_cmd_pool,     "                memory pool use"         },
+    { "mem",      cli_cmd_mem,      "                heap, pools, stacks, RAM" },
+    { "play",     cli_cmd_play,     "<id> [gain]     cue a sound clip"        },
+    { "assets",   cli_cmd_assets,   "[crc]           QSPI flash asset table"  },
+    { "acache",   cli_cmd_acache,   "                SRAM asset cache"        },
+    { "sd",       cli_cmd_sd,       "[dir]           SD card and a listing"   },
+    { "sdplay",   cli_cmd_sdplay,   "<file> [gain]   stream a clip from SD"   },
+    { "sync",     cli_cmd_sync,     "[scare|play|fx] show-sync state / cue"   },
+    { "dmx",      cli_cmd_dmx,      "                DMX512 receiver state"   },
+    { "net",      cli_cmd_net,      "                co-processor link state" },
+    { "pixdist",  cli_cmd_pixdist,  "                pixel link state"        },
+    { "capture",  cli_cmd_capture,  "[frames] [ev]   frames to the host"      },
+    { "wear",     cli_cmd_wear,     "                relay and scare counts"  },
+    { "fwup",     cli_cmd_fwup,     "[size crc]      update the firmware"     },
+    { "fault",    cli_cmd_fault,    "[ack]           why the last reset"      },
+#if ESTOP_ENABLE
+    { "estop",    cli_cmd_estop,    "[clear]         e-stop latch"            },
+#endif
+    { "boot",     cli_cmd_boot,     "                boot phases from reset"  },
+#if RTOS_TRACE_ENABLE
+    { "trace",    cli_cmd_trace,    "                dump the event recorder" },
+#endif
+#if LATBENCH_ENABLE
+    { "lat",      cli_cmd_lat,      "[reset]         edge -> relay / LED latency" },
+#endif
+#if RTOSBENCH_ENABLE
+    { "rtbench",  cli_cmd_rtbench,  "                kernel primitive costs"  },
+#endif
+#if DMARAM_BENCH_ENABLE
+    { "dmabench", cli_cmd_dmabench, "                CPU / DMA SRAM contention" },
+#endif
+#if LOADTEST_ENABLE
+    { "load",     cli_cmd_load,     "[hz s fx|stop]  synthetic edges, fx"    },
+#endif
+#if REPLAY_ENABLE
+    { "replay",   cli_cmd_replay,   "[rec|play|...]  record / play inputs"   },
+#endif
+    { "fps",      cli_cmd_fps,      "                frame rate and detail"   },
+    { "cal",      cli_cmd_cal,      "[time|win ...]  opening hours"           },
+    { "rail",     cli_cmd_rail,     "                supply rails and light"  },
+    { "knob",     cli_cmd_knob,     "                encoder position"        },
+    { "tof",      cli_cmd_tof,      "                distance sensor"         },
+    { "img",      cli_cmd_img,      "[seal]          image digest check"      },
+    { "ioseq",    cli_cmd_ioseq,    "[pattern|stop]  fog / strobe / knocker"  },
+    { "servo",    cli_cmd_servo,    "[name pos|off]  eyes / jaw servos"       },
+    { "motion",   cli_cmd_motion,   "[d v a [j hz]]  move profile"            },
+    { "show",     cli_cmd_show,     "[name|stop]     compiled show script"    },
+    { "hrt",      cli_cmd_hrt,      "[us]            microsecond callbacks"   },
+    { "irq",      cli_cmd_irq,      "[reset]         ISR priorities and cost" },
+    { "help",     cli_cmd_help,     "                this list"               },
+};
+#define CLI_CMDS    (sizeof(cli_cmds) / sizeof(cli_cmds[0]))
+
+static void cli_cmd_help(uint32_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    for (uint32_t i = 0; i < CLI_CMDS; i++)
+        cli_print("%-9s%s\r\n", cli_cmds[i].name, cli_cmds[i].help);
+}
+
+/* Split on spaces and run one line */
+static void cli_exec(char *line)
+{
+    char    *argv[CLI_ARGS_MAX];
+    uint32_t argc = 0;
+
+    for (char *s = strtok(line, " \t"); s != NULL && argc < CLI_ARGS_MAX; s = strtok(NULL, " \t"))
+        argv[argc++] = s;
+    if (argc == 0u) return;
+
+    for (uint32_t i = 0; i < CLI_CMDS; i++)
+    {
+        if (strcmp(cli_cmds[i].name, argv[0]) == 0)
+        {
+            cli_cmds[i].run(argc, argv);
+            return;
+        }
+    }
+    cli_print("unknown command '%s', try 'help'\r\n", argv[0]);
+}
+
+static void cli_task(void *arg)
+{
+    const cli_port_t    *port = (const cli_port_t *)arg;
+    StreamBufferHandle_t rx   = port->rx();
+    char    line[CLI_LINE_MAX];
+    uint32_t len = 0;
+
+    (void)xSemaphoreTake(cli_lock, portMAX_DELAY);
+    cli_out = port;
+    cli_print("\r\n> ");
+    (void)xSemaphoreGive(cli_lock);
+    for (;;)
+    {
+        uint8_t chunk[16];
+        size_t  n = xStreamBufferReceive(rx, chunk, sizeof(chunk), portMAX_DELAY);
+
+        (void)xSemaphoreTake(cli_lock, portMAX_DELAY);
+        cli_out = port;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            char c = (char)chunk[i];
+
+            if (c == '\r' || c == '\n')
+            {
+                if (len == 0u) continue;            /* "\r\n": one line end */
+                line[len] = '\0';
+                len = 0;
+                cli_print("\r\n");
+                cli_exec(line);
+                cli_print("> ");
+            }
+            else if (c == '\b' || c == 0x7F)
+            {
+                if (len == 0u) continue;
+                len--;
+                cli_print("\b \b");
+            }
+            else if (c >= ' ' && len < CLI_LINE_MAX - 1u)
+            {
+                line[len++] = c;
+                (void)port->write(&c, 1u);
+            }
+        }
+        (void)xSemaphoreGive(cli_lock);
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Cli_Register(const cli_param_t *p)
+{
+    if (cli_count == CLI_MAX_PARAMS || p->min > p->max) return false;
+
+    cli_defaults[cli_count] = cli_get(p);
+    cli_params[cli_count++] = p;
+    return true;
+}
+
+bool Cli_Start(void)
+{
+    if (STDIO_RxStream() == NULL) return false;
+
+    for (uint32_t i = 0; i < cli_count; i++)
+    {
+        const cli_param_t *p = cli_params[i];
+        uint32_t d[NVSTORE_WORDS];
+
+        if (!Settings_Load(cli_key(p), &d[0]))
+        {
+            if (!NvStore_Load(cli_key(p), d) || d[1] != ~d[0]) continue;
+        }
+        if (d[0] >= p->min && d[0] <= p->max) cli_set(p, d[0]);
+    }
+    cli_lock = xSemaphoreCreateMutexStatic(&cli_lock_buf);
+
+    /* The console shell, then one per extra port that is up */
+    for (uint32_t i = 1; i < CLI_PORTS; i++)
+        if (cli_ports[i].rx() != NULL)
+            (void)xTaskCreateStatic(cli_task, cli_ports[i].name, CLI_STACK, (void *)&cli_ports[i],
+                                    CLI_TASK_PRIO, cli_stack[i], &cli_tcb[i]);
+    return xTaskCreateStatic(cli_task, cli_ports[0].name, CLI_STACK, (void *)&cli_ports[0],
+                             CLI_TASK_PRIO, cli_stack[0], &cli_tcb[0]) != NULL;
+}
@@ -0,0 +1,86 @@
+/* =============================================================================
+ * cli.h  -  Serial command shell for live tuning, values kept in flash
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The "CLI" task reads lines from the console RX stream (STDIO_RxStream(),
+ * nothing runs until a line is in) and echoes them back. Modules register
+ * their tunable parameters with Cli_Register() (name, pointer, type,
+ * min / max, optional change hook), so a value can be read and set on the
+ * floor without a rebuild:
+ *
+ *   get                     every parameter with its range
+ *   get <name>              one parameter
+ *   set <name> <value>      range checked, then the change hook runs
+ *   save                    write every parameter to flash now
+ *   defaults                back to the values they had at registration
+ *   fx                      list the effects
+ *   fx <name|n> [frames]    switch segment 0, crossfading over frames
+ *   top                     CPU share and stack headroom per task (cpuload.h), cache hits
+ *   capture [frames] [every] rendered frames to the host (telem.h)
+ *   wear                    lifetime relay cycles, boots, scares (wear.h)
+ *   fwup [<size> <crc>|cancel] image into the other flash bank (fwupdate.h)
+ *   fault                   the record of the fault that caused this boot (fault.h)
+ *   boot                    microseconds from reset to each boot phase (boot.h)
+ *   trace                   dump the event recorder (RTOS_TRACE_ENABLE)
+ *   help
+ *
+ * With USBCDC_ENABLE a "CLI-USB" task runs the same shell on the USB
+ * port's stream (usbcdc.h). One line runs at a time, under a mutex, and
+ * its output goes back to the port it came from.
+ * Each parameter is saved under its own key, a hash of its name, so adding
+ * or reordering parameters never loads one's value into another. With the
+ * SmartEEPROM configured (settings.h) every `set`, `defaults` and `fx` is
+ * kept on its own, SETTINGS_FLUSH_MS after the last change; without it
+ * only `save` writes them, to nvstore.h: it pends its work to the timer
+ * service task, which posts the records to the NvWrite task (nvwrite.h)
+ * like the other nvstore users (actuator calibration, stats), and waits
+ * until they are written.
+ *
+ * Numbers are decimal, or hex with 0x. Hooks run in the CLI task, or
+ * before the scheduler for values loaded by Cli_Start().
+ * ============================================================================= */
+
+#ifndef CLI_H
+#define CLI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define CLI_MAX_PARAMS      11u         /* one nvstore key each            */
+#define CLI_LINE_MAX        64u         /* bytes per command line          */
+#define CLI_TASK_PRIO       1u          /* with the Coop task, above idle   */
+
+typedef enum
+{
+    CLI_U8 = 0,
+    CLI_U16,
+    CLI_U32
+} cli_type_t;
+
+typedef struct
+{
+    const char *name;           /* no spaces, unique                      */
+    void       *value;          /* uint8_t / uint16_t / uint32_t per type */
+    cli_type_t  type;
+    uint32_t    min;
+    uint32_t    max;
+    void      (*changed)(void); /* NULL, or called after every set / load */
+    const char *help;           /* one line, units                        */
+} cli_param_t;
+
+/**
+ * Add a parameter; its current value becomes its default. The entry must
+ * stay valid for good. Before Cli_Start(); false if the table is full or
+ * the range is empty.
+ */
+bool Cli_Register(const cli_param_t *p);
+
+/**
+ * Load saved values of every registered parameter (out-of-range ones are
+ * ignored), then create the CLI task. Before the scheduler starts, after
+ * STDIO_RxStart(); false if there is no RX stream.
+ */
+bool Cli_Start(void);
+
+#endif /* CLI_H */
@@ -0,0 +1,38 @@
+/* =============================================================================
+ * cobs.c  -  Consistent Overhead Byte Stuffing for binary console frames
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "cobs.h"
+
+/* -- Public API implementation ----------------------------------------------- */
+
+size_t Cobs_Encode(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    uint8_t *code = dst;
+    uint8_t *out  = dst + 1;
+
+    *code = 1u;
+    for (size_t i = 0u; i < len; i++)
+    {
+        if (src[i] != 0u)
+        {
+            *out++ = src[i];
+            if (++(*code) != 0xFFu) continue;
+            if (i + 1u == len) break;           /* full block ends the data */
+        }
+        code  = out++;                          /* zero, or a full 254-byte block */
+        *code = 1u;
+    }
+    return (size_t)(out - dst);
+}
+
+size_t Cobs_Frame(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    size_t n;
+
+    dst[0] = 0x00u;
+    n = 1u + Cobs_Encode(&dst[1], src, len);
+    dst[n++] = 0x00u;
+    return n;
+}
@@ -0,0 +1,33 @@
+/* =============================================================================
+ * cobs.h  -  Consistent Overhead Byte Stuffing for binary console frames
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * COBS rewrites a payload so it contains no 0x00 byte, at a cost of one
+ * byte per 254 (plus one). The binary streams on the console (tlog.h,
+ * telem.h) send every frame as
+ *
+ *   00 | cobs(payload) | 00
+ *
+ * Text output never contains 0x00, so a host tool can split the port on
+ * zero bytes, decode what validates as a frame and pass the rest through.
+ * ============================================================================= */
+
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Bytes Cobs_Frame() writes at most for a len-byte payload. */
+#define COBS_FRAME_MAX(len)     ((len) + (len) / 254u + 3u)
+
+/** COBS-encode len bytes from src into dst; returns the bytes written. */
+size_t Cobs_Encode(uint8_t *dst, const uint8_t *src, size_t len);
+
+/**
+ * Full frame into dst (at least COBS_FRAME_MAX(len) bytes): leading and
+ * trailing 0x00 around the encoded payload. Returns the frame length.
+ */
+size_t Cobs_Frame(uint8_t *dst, const uint8_t *src, size_t len);
+
+#endif /* COBS_H */
@@ -88,7 +88,7 @@
  * 0 to keep the tick interrupt running at all times.  Not all FreeRTOS ports
  * support tickless mode. See https://www.freertos.org/low-power-tickless-rtos.html
  * Defaults to 0 if left undefined. */
-#define configUSE_TICKLESS_IDLE                 0
+#define configUSE_TICKLESS_IDLE                 2    /* tickless.c: RTC wake, STANDBY */
 
 /* configMAX_PRIORITIES Sets the number of available task priorities.  Tasks can
  * be assigned priorities of 0 to (configMAX_PRIORITIES - 1).  Zero is the lowest
@@ -131,7 +131,7 @@
  * configTASK_NOTIFICATION_ARRAY_ENTRIES sets the number of indexes in the array.
  * See https://www.freertos.org/RTOS-task-notifications.html  Defaults to 1 if
  * left undefined. */
-#define configTASK_NOTIFICATION_ARRAY_ENTRIES      1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES      5    /* 4: dmamem.h */
 
 /* configQUEUE_REGISTRY_SIZE sets the maximum number of queues and semaphores
  * that can be referenced from the queue registry.  Only required when using a
@@ -203,26 +203,26 @@
  * FreeRTOS/source/timers.c source file must be included in the build if
  * configUSE_TIMERS is set to 1.  Default to 0 if left undefined.  See
  * https://www.freertos.org/RTOS-software-timer.html. */
-#define configUSE_TIMERS                        0
+#define configUSE_TIMERS                        1
 
 /* configTIMER_TASK_PRIORITY sets the priority used by the timer task.  Only
  * used if configUSE_TIMERS is set to 1.  The timer task is a standard FreeRTOS
  * task, so its priority is set like any other task.  See
  * https://www.freertos.org/RTOS-software-timer-service-daemon-task.html  Only used
  * if configUSE_TIMERS is set to 1. */
-#define configTIMER_TASK_PRIORITY               0
+#define configTIMER_TASK_PRIORITY               ( configMAX_PRIORITIES - 1 )    /* actuator: sensor-to-relay latency */
 
 /* configTIMER_TASK_STACK_DEPTH sets the size of the stack allocated to the
  * timer task (in words, not in bytes!).  The timer task is a standard FreeRTOS
  * task.  See https://www.freertos.org/RTOS-software-timer-service-daemon-task.html
  * Only used if configUSE_TIMERS is set to 1. */
-#define configTIMER_TASK_STACK_DEPTH            0
+#define configTIMER_TASK_STACK_DEPTH            192    /* actuator: log.h, no printf */
 
 /* configTIMER_QUEUE_LENGTH sets the length of the queue (the number of discrete
  * items the queue can hold) used to send commands to the timer task.  See
  * https://www.freertos.org/RTOS-software-timer-service-daemon-task.html  Only used
  * if configUSE_TIMERS is set to 1. */
-#define configTIMER_QUEUE_LENGTH                0
+#define configTIMER_QUEUE_LENGTH                8
 
 /******************************************************************************/
 /* Event Group related definitions. *******************************************/
@@ -255,7 +255,7 @@
  * memory in the build.  Set to 0 to exclude the ability to create statically
  * allocated objects from the build.  Defaults to 0 if left undefined.  See
  * https://www.freertos.org/Static_Vs_Dynamic_Memory_Allocation.html. */
-#define configSUPPORT_STATIC_ALLOCATION         0
+#define configSUPPORT_STATIC_ALLOCATION         1    /* every object: freertos_hooks.c */
 
 /* Set configSUPPORT_DYNAMIC_ALLOCATION to 1 to include FreeRTOS API functions
  * that create FreeRTOS objects (tasks, queues, etc.) using dynamically allocated
@@ -268,7 +268,7 @@
  * or heap_4.c are included in the build.  This value is defaulted to 4096 bytes but
  * it must be tailored to each application.  Note the heap will appear in the .bss
  * section.  See https://www.freertos.org/a00111.html. */
-#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 40960 )
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 4096 )  /* nothing allocates it now */
 
 /* Set configAPPLICATION_ALLOCATED_HEAP to 1 to have the application allocate
  * the array used as the FreeRTOS heap.  Set to 0 to have the linker allocate the
@@ -292,18 +292,20 @@
 /* Interrupt nesting behaviour configuration. *********************************/
 /******************************************************************************/
 
+#include "irqprio.h"
+
 /* configKERNEL_INTERRUPT_PRIORITY sets the priority of the tick and context
  * switch performing interrupts.  Not supported by all FreeRTOS ports.  See
  * https://www.freertos.org/RTOS-Cortex-M3-M4.html for information specific to
  * ARM Cortex-M devices. */
-#define configKERNEL_INTERRUPT_PRIORITY         (7 << (8 - 3))
+#define configKERNEL_INTERRUPT_PRIORITY         IRQ_PRIO_BYTE(IRQ_PRIO_KERNEL)     /* irqprio.h */
 /* configMAX_SYSCALL_INTERRUPT_PRIORITY sets the interrupt priority above which
  * FreeRTOS API calls must not be made.  Interrupts above this priority are never
  * disabled, so never delayed by RTOS activity.  The default value is set to the
  * highest interrupt priority (0).  Not supported by all FreeRTOS ports.
  * See https://www.freertos.org/RTOS-Cortex-M3-M4.html for information specific to
  * ARM Cortex-M devices. */
-#define configMAX_SYSCALL_INTERRUPT_PRIORITY    (1 << (8 - 3))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY    IRQ_PRIO_BYTE(IRQ_PRIO_SYSCALL)
 
 /* Another name for configMAX_SYSCALL_INTERRUPT_PRIORITY - the name used depends
  * on the FreeRTOS port. */
@@ -316,7 +318,7 @@
  * functionality in the build.  Set to 0 to exclude the hook functionality from the
  * build.  The application writer is responsible for providing the hook function
  * for any set to 1.  See https://www.freertos.org/a00016.html. */
-#define configUSE_IDLE_HOOK                     0
+#define configUSE_IDLE_HOOK                     1    /* idle.h: WFI + load meter */
 #define configUSE_TICK_HOOK                     0
 #define configUSE_MALLOC_FAILED_HOOK            1
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
@@ -340,7 +342,17 @@
  * the stack overflow callback when configCHECK_FOR_STACK_OVERFLOW is set to 1.
  * See https://www.freertos.org/Stacks-and-stack-overflow-checking.html  Defaults
  * to 0 if left undefined. */
+/* With the MPU stack guard (stackguard.h) an overflow faults at once, the
+ * pattern check is not needed */
+#include "stackguard.h"
+#if STACKGUARD_ENABLE
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#else
 #define configCHECK_FOR_STACK_OVERFLOW          2
+#endif
+
+/* Keep the top of every stack in the TCB; stackmon.c derives the sizes */
+#define configRECORD_STACK_HIGH_ADDRESS         1
 
 /******************************************************************************/
 /* Run time and task stats gathering related definitions. *********************/
@@ -350,13 +362,28 @@
  * processing time used by each task.  Set to 0 to not collect the data.  The
  * application writer needs to provide a clock source if set to 1.  Defaults to 0
  * if left undefined.  See https://www.freertos.org/rtos-run-time-stats.html. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
+
+/* Run-time base for the per-task CPU load in cpuload.h: the DWT cycle counter
+ * (120 MHz, enabled by Metrics_Init() before the scheduler), one register
+ * read per context switch. It stops while the core sleeps; idle.h adds the
+ * slept cycles back on wake-up. With the CPU clock divided (cpufreq.h) the
+ * switch also scales what the task it leaves ran up. Per-task totals wrap
+ * every ~35 s of CPU time, so readers work on differences taken more often
+ * than that. */
+#include "cpufreq.h"
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    do { } while (0)
+#if CPUFREQ_ENABLE
+#define portGET_RUN_TIME_COUNTER_VALUE()            CpuFreq_Cycles()
+#else
+#define portGET_RUN_TIME_COUNTER_VALUE()            (*(volatile uint32_t *)0xE0001004UL)   /* DWT->CYCCNT */
+#endif
 
 /* Set configUSE_TRACE_FACILITY to include additional task structure members
  * are used by trace and visualisation functions and tools.  Set to 0 to exclude
  * the additional information from the structures. Defaults to 0 if left
  * undefined. */
-#define configUSE_TRACE_FACILITY                0
+#define configUSE_TRACE_FACILITY                1    /* uxTaskGetSystemState() for telem.h */
 
 /* Set to 1 to include the vTaskList() and vTaskGetRunTimeStats() functions in
  * the build.  Set to 0 to exclude these functions from the build.  These two
@@ -411,7 +438,7 @@
 #define configUSE_COUNTING_SEMAPHORES           1
 #define configUSE_QUEUE_SETS                    0
 #define configUSE_APPLICATION_TASK_TAG          0
-#define configUSE_TASK_FPU_SUPPORT              0
+#define configUSE_TASK_FPU_SUPPORT              1    /* not read by ARM_CM4F: always lazy, fpu.h */
 
 
 /* Set the following INCLUDE_* constants to 1 to incldue the named API function,
@@ -426,13 +453,13 @@
 #define INCLUDE_xResumeFromISR                  1
 #define INCLUDE_vTaskDelayUntil                 1
 #define INCLUDE_vTaskDelay                      1
-#define INCLUDE_xTaskGetSchedulerState          0
+#define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
 #define INCLUDE_uxTaskGetStackHighWaterMark     0
-#define INCLUDE_xTaskGetIdleTaskHandle          0
+#define INCLUDE_xTaskGetIdleTaskHandle          1    /* cpuload.c: idle share */
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        1
-#define INCLUDE_xTimerPendFunctionCall          0
+#define INCLUDE_xTimerPendFunctionCall          1
 #define INCLUDE_xTaskAbortDelay                 0
 #define INCLUDE_xTaskGetHandle                  0
 #define INCLUDE_xQueueGetMutexHolder            0
@@ -442,5 +469,63 @@
 
 
 
+/* Event recorder hooks (rtos_trace.h): off unless RTOS_TRACE_ENABLE */
+#include "rtos_trace.h"
+#include "fpu.h"
+#if RTOS_TRACE_ENABLE
+#define RTOS_TRACE_SWITCHED_IN()                RtosTrace_Event(RTOS_TRACE_SWITCH, RTOS_TRACE_PTR(pxCurrentTCB))
+#else
+#define RTOS_TRACE_SWITCHED_IN()                ((void)0)
+#endif
+
+/* FPU on for declared FP users only (fpu.h) */
+#if FPU_GUARD
+#define FPU_SWITCHED_IN()                       Fpu_SwitchedIn(pxCurrentTCB)
+#else
+#define FPU_SWITCHED_IN()                       ((void)0)
+#endif
+
+/* MPU guard below the incoming task's stack (stackguard.h) */
+#if STACKGUARD_ENABLE
+#define STACKGUARD_SWITCHED_IN()                StackGuard_SwitchedIn(pxCurrentTCB->pxStack)
+#else
+#define STACKGUARD_SWITCHED_IN()                ((void)0)
+#endif
+
+#define traceTASK_SWITCHED_IN()                 do { RTOS_TRACE_SWITCHED_IN(); FPU_SWITCHED_IN(); \
+                                                     STACKGUARD_SWITCHED_IN(); } while (0)
+
+#if RTOS_TRACE_ENABLE
+#define traceTASK_CREATE( pxNewTCB )            RtosTrace_TaskCreate((pxNewTCB), (pxNewTCB)->pcTaskName)
+#define traceQUEUE_RECEIVE( pxQueue )           RtosTrace_Event(RTOS_TRACE_Q_RECV, RTOS_TRACE_PTR(pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )  RtosTrace_Event(RTOS_TRACE_Q_RECV, RTOS_TRACE_PTR(pxQueue))
+#define RTOS_TRACE_Q(ev, q)                     RtosTrace_Event((ev), RTOS_TRACE_PTR(q))
+#else
+#define RTOS_TRACE_Q(ev, q)                     ((void)0)
+#endif
+
+/* Queue and stream buffer fill under load (loadtest.h): off unless LOADTEST_ENABLE.
+   The queue send hooks run before the copy; semaphores (no items) are left out */
+#include "loadtest.h"
+#if LOADTEST_ENABLE
+#define LOADTEST_Q_SEND(q)                      do { if ((q)->uxItemSize != 0u) LoadTest_QueueSend((q), \
+                                                     (uint32_t)(q)->uxMessagesWaiting + 1u, (uint32_t)(q)->uxLength); } while (0)
+#define LOADTEST_Q_FAIL(q)                      do { if ((q)->uxItemSize != 0u) LoadTest_QueueFull((q), \
+                                                     (uint32_t)(q)->uxLength); } while (0)
+#define traceSTREAM_BUFFER_SEND( xStreamBuffer, xBytes )          LoadTest_StreamSend((xStreamBuffer), true)
+#define traceSTREAM_BUFFER_SEND_FROM_ISR( xStreamBuffer, xBytes ) LoadTest_StreamSend((xStreamBuffer), (xBytes) != 0u)
+#define traceSTREAM_BUFFER_SEND_FAILED( xStreamBuffer )           LoadTest_StreamSend((xStreamBuffer), false)
+#else
+#define LOADTEST_Q_SEND(q)                      ((void)0)
+#define LOADTEST_Q_FAIL(q)                      ((void)0)
+#endif
+
+#if RTOS_TRACE_ENABLE || LOADTEST_ENABLE
+#define traceQUEUE_SEND( pxQueue )              do { RTOS_TRACE_Q(RTOS_TRACE_Q_SEND, pxQueue); LOADTEST_Q_SEND(pxQueue); } while (0)
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )     do { RTOS_TRACE_Q(RTOS_TRACE_Q_SEND, pxQueue); LOADTEST_Q_SEND(pxQueue); } while (0)
+#define traceQUEUE_SEND_FAILED( pxQueue )       do { RTOS_TRACE_Q(RTOS_TRACE_Q_FAIL, pxQueue); LOADTEST_Q_FAIL(pxQueue); } while (0)
+#define traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue ) do { RTOS_TRACE_Q(RTOS_TRACE_Q_FAIL, pxQueue); LOADTEST_Q_FAIL(pxQueue); } while (0)
+#endif
+
 /* MISRAC 2012 deviation block end */
 #endif /* FREERTOS_CONFIG_H */
@@ -38,11 +38,25 @@
 // DOM-IGNORE-END
 #include "FreeRTOS.h"
 #include "task.h"
+#include "idle.h"
+#include "fault.h"
 
 
 void vApplicationIdleHook( void );
 void vApplicationTickHook( void );
 void vAssertCalled( const char * pcFile, unsigned long ulLine );
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    configSTACK_DEPTH_TYPE * puxIdleTaskStackSize );
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     configSTACK_DEPTH_TYPE * puxTimerTaskStackSize );
+
+/* Kernel task memory, with configSUPPORT_STATIC_ALLOCATION */
+static StaticTask_t xIdleTaskTCB;
+static StackType_t  uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+static StaticTask_t xTimerTaskTCB;
+static StackType_t  uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
 
 /*
 *********************************************************************************************************
@@ -61,18 +75,13 @@ void vAssertCalled( const char * pcFile, unsigned long ulLine );
 */
 void vApplicationStackOverflowHook( TaskHandle_t xTask, char *pcTaskName )
 {
-   ( void ) pcTaskName;
    ( void ) xTask;
 
    /* Run time task stack overflow checking is performed if
    configCHECK_FOR_STACK_OVERFLOW is defined to 1 or 2.  This hook  function is
    called if a task stack overflow is detected.  Note the system/interrupt
-   stack is not checked. */
-   taskDISABLE_INTERRUPTS();
-   for( ;; )
-   {
-       /* Do Nothing */
-   }
+   stack is not checked. Recorded for the next boot, relays off, reset. */
+   Fault_StackOverflow( pcTaskName );
 }
 
 /*
@@ -113,13 +122,10 @@ void vApplicationMallocFailedHook( void )
       heap available to pvPortMalloc() is defined by configTOTAL_HEAP_SIZE in
       FreeRTOSConfig.h, and the xPortGetFreeHeapSize() API function can be used
       to query the size of free heap space that remains (although it does not
-      provide information on how the remaining heap might be fragmented). */
-
-   taskDISABLE_INTERRUPTS();
-   for( ;; )
-   {
-       /* Do Nothing */
-   }
+      provide information on how the remaining heap might be fragmented).
+      Recorded with the caller's trace for the next boot, relays off, reset
+      (memstat.h has the heap's use). */
+   Fault_MallocFailed();
 }
 /*-----------------------------------------------------------*/
 
@@ -134,7 +140,7 @@ void vApplicationIdleHook( void )
     important that vApplicationIdleHook() is permitted to return to its calling
     function, because it is the responsibility of the idle task to clean up
     memory allocated by the kernel to any task that has since been deleted. */
-    
+    Idle_Hook();                /* WFI until the next interrupt, timed */
 }
 
 /*-----------------------------------------------------------*/
@@ -155,24 +161,52 @@ void vApplicationTickHook( void )
 
 /*-----------------------------------------------------------*/
 
-/* Error Handler */
+/*
+*********************************************************************************************************
+*                                          vApplicationGetIdleTaskMemory()
+*
+* Description : Supplies the idle task TCB and stack when configSUPPORT_STATIC_ALLOCATION is 1.
+*
+* Note(s)     : called once by vTaskStartScheduler().
+*********************************************************************************************************
+*/
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    configSTACK_DEPTH_TYPE * puxIdleTaskStackSize )
+{
+    *ppxIdleTaskTCBBuffer   = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *puxIdleTaskStackSize   = configMINIMAL_STACK_SIZE;
+}
+
+/*
+*********************************************************************************************************
+*                                          vApplicationGetTimerTaskMemory()
+*
+* Description : Supplies the timer service task TCB and stack when configSUPPORT_STATIC_ALLOCATION is 1.
+*
+* Note(s)     : called once by xTimerCreateTimerTask().
+*********************************************************************************************************
+*/
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     configSTACK_DEPTH_TYPE * puxTimerTaskStackSize )
+{
+    *ppxTimerTaskTCBBuffer   = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *puxTimerTaskStackSize   = configTIMER_TASK_STACK_DEPTH;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Error Handler: recorded for the next boot (fault.h), relays off, reset.
+   Debug builds stop here first; continue in the debugger to reset. */
 void vAssertCalled( const char * pcFile, unsigned long ulLine )
 {
-   volatile unsigned long ul = 0;
-
-   ( void ) pcFile;
-   ( void ) ulLine;
-
-   taskENTER_CRITICAL();
-   {
-      /* Set ul to a non-zero value using the debugger to step out of this
-         function. */
-      while( ul == 0U )
-      {
-         portNOP();
-      }
-   }
-   taskEXIT_CRITICAL();
+#if defined(__DEBUG) || defined(__DEBUG_D) && defined(__XC32)
+   __builtin_software_breakpoint();
+#endif
+   Fault_Assert( pcFile, ulLine );
 }
 /*-----------------------------------------------------------*/
 
@@ -45,6 +45,7 @@
 // *****************************************************************************
 #include "definitions.h"
 #include "device.h"
+#include "boot.h"               /* BOOT_DEFER_*: started later by the Init task */
 
 
 // ****************************************************************************
@@ -57,8 +58,8 @@
 #pragma config BOD33_ACTION = RESET
 #pragma config BOD33_HYST = 0x2U
 #pragma config NVMCTRL_BOOTPROT = 0
-#pragma config NVMCTRL_SEESBLK = 0x0U
-#pragma config NVMCTRL_SEEPSZ = 0x0U
+#pragma config NVMCTRL_SEESBLK = 0x1U
+#pragma config NVMCTRL_SEEPSZ = 0x2U
 #pragma config RAMECC_ECCDIS = SET
 #pragma config WDT_ENABLE = CLEAR
 #pragma config WDT_ALWAYSON = CLEAR
@@ -111,27 +112,6 @@
 // *****************************************************************************
 // *****************************************************************************
 
-/*******************************************************************************
-  Function:
-    void STDIO_BufferModeSet ( void )
-
-  Summary:
-    Sets the buffering mode for stdin and stdout
-
-  Remarks:
- ********************************************************************************/
-static void STDIO_BufferModeSet(void)
-{
-    /* MISRAC 2023 deviation block start */
-    /* MISRA C-2023 Rule 21.6 deviated 2 times in this file.  Deviation record ID -  H3_MISRAC_2023_R_21_6_DR_3 */
-
-    /* Make stdin unbuffered */
-    setbuf(stdin, NULL);
-
-    /* Make stdout unbuffered */
-    setbuf(stdout, NULL);
-    /* MISRAC 2023 deviation block end */
-}
 
 
 /* MISRAC 2023 deviation block end */
@@ -154,29 +134,29 @@ void SYS_Initialize ( void* data )
 
     NVMCTRL_Initialize( );
 
-    STDIO_BufferModeSet();
-
 
   
     PORT_Initialize();
 
     CLOCK_Initialize();
+    Boot_Mark(BOOT_CLOCK);
 
 
 
 
-    SERCOM1_SPI_Initialize();
-
+#if !BOOT_DEFER_TCC0
     TCC0_PWMInitialize();
+#endif
 
     EVSYS_Initialize();
 
-	SYSTICK_TimerInitialize();
     DMAC_Initialize();
 
 	TRNG_Initialize();
 
+#if !BOOT_DEFER_USART
     SERCOM5_USART_Initialize();
+#endif
 
 
     NVIC_Initialize();
@@ -51,6 +51,7 @@
 #include "device_vectors.h"
 #include "interrupts.h"
 #include "definitions.h"
+#include "fault.h"
 
 
 
@@ -66,15 +67,11 @@ extern const H3DeviceVectors exception_table;
 
 extern void Dummy_Handler(void);
 
-/* Brief default interrupt handler for unused IRQs.*/
-void __attribute__((optimize("-O1"), long_call, noreturn, used))Dummy_Handler(void)
+/* Brief default interrupt handler for unused IRQs: recorded and reset (fault.h),
+   the IRQ is the record's exception number less 16 */
+void __attribute__((naked, noreturn, used))Dummy_Handler(void)
 {
-#if defined(__DEBUG) || defined(__DEBUG_D) && defined(__XC32)
-    __builtin_software_breakpoint();
-#endif
-    while (true)
-    {
-    }
+    FAULT_ENTRY(FAULT_IRQ);
 }
 
 /* MISRAC 2023 deviation block start */
@@ -113,6 +110,7 @@ extern void EIC_EXTINT_15_Handler      ( void ) __attribute__((weak, alias("Dumm
 extern void FREQM_Handler              ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
 extern void NVMCTRL_0_Handler          ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
 extern void NVMCTRL_1_Handler          ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
+extern void DMAC_0_Handler             ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
 extern void DMAC_1_Handler             ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
 extern void DMAC_2_Handler             ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
 extern void DMAC_3_Handler             ( void ) __attribute__((weak, alias("Dummy_Handler"),noreturn));
@@ -261,7 +259,7 @@ const H3DeviceVectors exception_table=
     .pfnFREQM_Handler              = FREQM_Handler,
     .pfnNVMCTRL_0_Handler          = NVMCTRL_0_Handler,
     .pfnNVMCTRL_1_Handler          = NVMCTRL_1_Handler,
-    .pfnDMAC_0_Handler             = DMAC_0_InterruptHandler,
+    .pfnDMAC_0_Handler             = DMAC_0_Handler,
     .pfnDMAC_1_Handler             = DMAC_1_Handler,
     .pfnDMAC_2_Handler             = DMAC_2_Handler,
     .pfnDMAC_3_Handler             = DMAC_3_Handler,
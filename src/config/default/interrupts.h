@@ -64,7 +64,6 @@ void BusFault_Handler (void);
 void UsageFault_Handler (void);
 void DebugMonitor_Handler (void);
 void xPortSysTickHandler (void);
-void DMAC_0_InterruptHandler (void);
 
 
 
@@ -54,7 +54,7 @@
 // *****************************************************************************
 // *****************************************************************************
 
-#define DMAC_CHANNELS_NUMBER        (1U)
+#define DMAC_CHANNELS_NUMBER        (4U)
 
 #define DMAC_CRC_CHANNEL_OFFSET     (0x20U)
 
@@ -120,6 +120,39 @@ void DMAC_Initialize( void )
 
    DMAC_REGS->CHANNEL[0].DMAC_CHINTENSET = (DMAC_CHINTENSET_TERR_Msk | DMAC_CHINTENSET_TCMPL_Msk);
 
+   /***************** Configure DMA channel 1 ********************/
+   DMAC_REGS->CHANNEL[1].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT(2U) | DMAC_CHCTRLA_TRIGSRC(11U) | DMAC_CHCTRLA_THRESHOLD(0U) | DMAC_CHCTRLA_BURSTLEN(0U) ;
+
+   descriptor_section[1].DMAC_BTCTRL = DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk ;
+
+   DMAC_REGS->CHANNEL[1].DMAC_CHPRILVL = DMAC_CHPRILVL_PRILVL(0U);
+
+   dmacChannelObj[1].inUse = true;
+
+   DMAC_REGS->CHANNEL[1].DMAC_CHINTENSET = (DMAC_CHINTENSET_TERR_Msk | DMAC_CHINTENSET_TCMPL_Msk);
+
+   /***************** Configure DMA channel 2 ********************/
+   DMAC_REGS->CHANNEL[2].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT(2U) | DMAC_CHCTRLA_TRIGSRC(5U) | DMAC_CHCTRLA_THRESHOLD(0U) | DMAC_CHCTRLA_BURSTLEN(0U) ;
+
+   descriptor_section[2].DMAC_BTCTRL = DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk ;
+
+   DMAC_REGS->CHANNEL[2].DMAC_CHPRILVL = DMAC_CHPRILVL_PRILVL(0U);
+
+   dmacChannelObj[2].inUse = true;
+
+   DMAC_REGS->CHANNEL[2].DMAC_CHINTENSET = (DMAC_CHINTENSET_TERR_Msk | DMAC_CHINTENSET_TCMPL_Msk);
+
+   /***************** Configure DMA channel 3 ********************/
+   DMAC_REGS->CHANNEL[3].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT(2U) | DMAC_CHCTRLA_TRIGSRC(13U) | DMAC_CHCTRLA_THRESHOLD(0U) | DMAC_CHCTRLA_BURSTLEN(0U) ;
+
+   descriptor_section[3].DMAC_BTCTRL = DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk ;
+
+   DMAC_REGS->CHANNEL[3].DMAC_CHPRILVL = DMAC_CHPRILVL_PRILVL(0U);
+
+   dmacChannelObj[3].inUse = true;
+
+   DMAC_REGS->CHANNEL[3].DMAC_CHINTENSET = (DMAC_CHINTENSET_TERR_Msk | DMAC_CHINTENSET_TCMPL_Msk);
+
     /* Enable the DMAC module & Priority Level x Enable */
     DMAC_REGS->DMAC_CTRL = DMAC_CTRL_DMAENABLE_Msk | DMAC_CTRL_LVLEN0_Msk | DMAC_CTRL_LVLEN1_Msk | DMAC_CTRL_LVLEN2_Msk | DMAC_CTRL_LVLEN3_Msk;
 }
@@ -196,6 +229,45 @@ bool DMAC_ChannelTransfer( DMAC_CHANNEL channel, const void *srcAddr, const void
     return returnStatus;
 }
 
+/*******************************************************************************
+    This function submits a list of DMA transfers.
+
+    The first descriptor is copied into the channel's descriptor section; the
+    remaining descriptors are fetched by the DMAC from the DESCADDR chain, so
+    they must stay valid (and 64-bit aligned) until the transfer completes.
+********************************************************************************/
+
+bool DMAC_ChannelLinkedListTransfer (DMAC_CHANNEL channel, dmac_descriptor_registers_t* channelDesc)
+{
+    bool returnStatus = false;
+    bool isBusy = dmacChannelObj[channel].isBusy;
+
+    if (((DMAC_REGS->CHANNEL[channel].DMAC_CHINTFLAG & (DMAC_CHINTENCLR_TCMPL_Msk | DMAC_CHINTENCLR_TERR_Msk)) != 0U) || (!isBusy) )
+    {
+        /* Clear the transfer complete flag */
+        DMAC_REGS->CHANNEL[channel].DMAC_CHINTFLAG = DMAC_CHINTENCLR_TCMPL_Msk | DMAC_CHINTENCLR_TERR_Msk;
+
+        dmacChannelObj[channel].isBusy = true;
+
+        /* Copy the first descriptor of the list into the channel descriptor section */
+        (void) memcpy(&descriptor_section[channel], channelDesc, sizeof(dmac_descriptor_registers_t));
+
+        /* Enable the channel */
+        DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+
+        /* Verify if Trigger source is Software Trigger */
+        if ((((DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA & DMAC_CHCTRLA_TRIGSRC_Msk) >> DMAC_CHCTRLA_TRIGSRC_Pos) == 0x00U)
+                                                && (((DMAC_REGS->CHANNEL[channel].DMAC_CHEVCTRL & DMAC_CHEVCTRL_EVIE_Msk)) != DMAC_CHEVCTRL_EVIE_Msk))
+        {
+            /* Trigger the DMA transfer */
+            DMAC_REGS->DMAC_SWTRIGCTRL |= ((uint32_t)1U << channel);
+        }
+        returnStatus = true;
+    }
+
+    return returnStatus;
+}
+
 /*******************************************************************************
     This function returns the status of the channel.
 ********************************************************************************/
@@ -483,3 +555,18 @@ void __attribute__((used)) DMAC_0_InterruptHandler( void )
    DMAC_channel_interruptHandler(0U);
 }
 
+void __attribute__((used)) DMAC_1_InterruptHandler( void )
+{
+   DMAC_channel_interruptHandler(1U);
+}
+
+void __attribute__((used)) DMAC_2_InterruptHandler( void )
+{
+   DMAC_channel_interruptHandler(2U);
+}
+
+void __attribute__((used)) DMAC_3_InterruptHandler( void )
+{
+   DMAC_channel_interruptHandler(3U);
+}
+
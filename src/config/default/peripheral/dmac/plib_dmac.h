@@ -87,6 +87,12 @@ typedef uint8_t DMAC_CRC_BEAT_SIZE;
 
     /* DMAC Channel 0 */
 #define  DMAC_CHANNEL_0   (0U)
+    /* DMAC Channel 1 */
+#define  DMAC_CHANNEL_1   (1U)
+    /* DMAC Channel 2 */
+#define  DMAC_CHANNEL_2   (2U)
+    /* DMAC Channel 3 */
+#define  DMAC_CHANNEL_3   (3U)
 typedef uint32_t DMAC_CHANNEL;
 
 typedef enum
@@ -146,6 +152,7 @@ typedef void (*DMAC_CHANNEL_CALLBACK) (DMAC_TRANSFER_EVENT event, uintptr_t cont
 void DMAC_ChannelCallbackRegister (DMAC_CHANNEL channel, const DMAC_CHANNEL_CALLBACK callback, const uintptr_t context);
 void DMAC_Initialize( void );
 bool DMAC_ChannelTransfer (DMAC_CHANNEL channel, const void *srcAddr, const void *destAddr, size_t blockSize);
+bool DMAC_ChannelLinkedListTransfer (DMAC_CHANNEL channel, dmac_descriptor_registers_t* channelDesc);
 bool DMAC_ChannelIsBusy ( DMAC_CHANNEL channel );
 void DMAC_ChannelDisable ( DMAC_CHANNEL channel );
 DMAC_CHANNEL_CONFIG  DMAC_ChannelSettingsGet ( DMAC_CHANNEL channel );
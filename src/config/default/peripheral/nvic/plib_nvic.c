@@ -40,6 +40,7 @@
 
 #include "device.h"
 #include "plib_nvic.h"
+#include "irqprio.h"             /* the priorities, not the MCC literals */
 
 
 // *****************************************************************************
@@ -59,9 +60,15 @@ void NVIC_Initialize( void )
 
     /* Enable the interrupt sources and configure the priorities as configured
      * from within the "Interrupt Manager" of MHC. */
-    NVIC_SetPriority(SysTick_IRQn, 7);
-    NVIC_SetPriority(DMAC_0_IRQn, 7);
+    NVIC_SetPriority(SysTick_IRQn, IRQ_PRIO_SYSTICK);
+    NVIC_SetPriority(DMAC_0_IRQn, IRQ_PRIO_DMAC);
     NVIC_EnableIRQ(DMAC_0_IRQn);
+    NVIC_SetPriority(DMAC_1_IRQn, IRQ_PRIO_DMAC);
+    NVIC_EnableIRQ(DMAC_1_IRQn);
+    NVIC_SetPriority(DMAC_2_IRQn, IRQ_PRIO_DMAC);
+    NVIC_EnableIRQ(DMAC_2_IRQn);
+    NVIC_SetPriority(DMAC_3_IRQn, IRQ_PRIO_DMAC);
+    NVIC_EnableIRQ(DMAC_3_IRQn);
 
     /* Enable Usage fault */
     SCB->SHCSR |= (SCB_SHCSR_USGFAULTENA_Msk);
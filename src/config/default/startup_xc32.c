@@ -65,6 +65,11 @@ extern void __attribute__((weak,long_call, alias("Dummy_App_Func"))) __xc32_on_b
 
 /* Linker defined variables */
 extern uint32_t __svectors;
+extern uint32_t __ramfunc_start;        /* .ramfunc: SRAM-resident code (ramfunc.h) */
+extern uint32_t __ramfunc_end;
+extern uint32_t __ramfunc_load;
+extern uint32_t __dma_ram_start;        /* .dma_ram: DMA buffers, NOLOAD (dmaram.h) */
+extern uint32_t __dma_ram_end;
 #if defined (__REINIT_STACK_POINTER)
 extern uint32_t _stack;
 #endif
@@ -148,6 +153,18 @@ void __attribute__((optimize("-O1"), section(".text.Reset_Handler"), long_call,
     /* Configure CMCC */
     CMCC_Configure();
 
+    /* Copy the SRAM-resident code (.ramfunc) from its flash image */
+    for (uint32_t *pDst = &__ramfunc_start, *pLoad = &__ramfunc_load; pDst < &__ramfunc_end; )
+    {
+        *pDst++ = *pLoad++;
+    }
+
+    /* Zero the DMA buffers: NOLOAD, so no .dinit record covers them */
+    for (uint32_t *pDst = &__dma_ram_start; pDst < &__dma_ram_end; )
+    {
+        *pDst++ = 0U;
+    }
+
     /* Initialize data after TCM is enabled.
      * Data initialization from the XC32 .dinit template */
     __pic32c_data_initialization();
@@ -0,0 +1,117 @@
+/* =============================================================================
+ * coop.c  -  Stackless cooperative threads: small behaviours on one task stack
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "coop.h"
+#include "watchdog.h"
+#include "log.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    const char *name;
+    coop_fn     fn;             /* NULL once exited */
+    void       *arg;
+    coop_t      pt;
+    uint8_t     state;          /* coop_state_t of the last call */
+} coop_thread_t;
+
+static coop_thread_t     coop_thr[COOP_MAX_THREADS];
+static uint32_t          coop_n;
+static volatile uint32_t coop_live;
+static volatile uint32_t coop_passes;
+
+static StackType_t       coop_stack[COOP_STACK];
+static StaticTask_t      coop_tcb;
+static TaskHandle_t      coop_task_handle;
+
+static void coop_task(void *arg)
+{
+    watchdog_id_t wd = Watchdog_Register("Coop", COOP_HEARTBEAT_MS);
+
+    (void)arg;
+    for (;;)
+    {
+        TickType_t sleep = pdMS_TO_TICKS(COOP_POLL_MS);
+
+        Watchdog_CheckIn(wd);
+        for (uint32_t i = 0; i < coop_n; i++)
+        {
+            coop_thread_t *t = &coop_thr[i];
+            int32_t        left;
+
+            if (t->fn == NULL) continue;
+            if (t->state == COOP_SLEEPING)
+            {
+                left = (int32_t)(t->pt.wake - xTaskGetTickCount());
+                if (left > 0)
+                {
+                    if ((TickType_t)left < sleep) sleep = (TickType_t)left;
+                    continue;
+                }
+            }
+
+            t->state = (uint8_t)t->fn(&t->pt, t->arg);
+            if (t->state == COOP_EXITED)
+            {
+                LOG_DEBUG("coop: %s done", t->name);
+                t->fn = NULL;
+                coop_live--;
+            }
+            else if (t->state == COOP_SLEEPING)
+            {
+                left = (int32_t)(t->pt.wake - xTaskGetTickCount());
+                if (left <= 0) sleep = 0u;
+                else if ((TickType_t)left < sleep) sleep = (TickType_t)left;
+            }
+        }
+        coop_passes++;
+        if (sleep != 0u) (void)ulTaskNotifyTake(pdTRUE, sleep);
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Coop_Add(const char *name, coop_fn fn, void *arg)
+{
+    configASSERT(xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED);
+    if (coop_n >= COOP_MAX_THREADS) return false;
+
+    coop_thr[coop_n].name  = name;
+    coop_thr[coop_n].fn    = fn;
+    coop_thr[coop_n].arg   = arg;
+    coop_thr[coop_n].pt.lc = 0u;
+    coop_thr[coop_n].state = COOP_WAITING;
+    coop_n++;
+    coop_live++;
+    return true;
+}
+
+bool Coop_Start(void)
+{
+    coop_task_handle = xTaskCreateStatic(coop_task, "Coop", COOP_STACK, NULL, COOP_PRIO,
+                                         coop_stack, &coop_tcb);
+    return coop_task_handle != NULL;
+}
+
+void Coop_Wake(void)
+{
+    if (coop_task_handle != NULL) xTaskNotifyGive(coop_task_handle);
+}
+
+void Coop_WakeFromISR(BaseType_t *woken)
+{
+    if (coop_task_handle != NULL) vTaskNotifyGiveFromISR(coop_task_handle, woken);
+}
+
+uint32_t Coop_Threads(void)
+{
+    return coop_live;
+}
+
+uint32_t Coop_Passes(void)
+{
+    return coop_passes;
+}
@@ -0,0 +1,118 @@
+/* =============================================================================
+ * coop.h  -  Stackless cooperative threads: small behaviours on one task stack
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A behaviour that blinks a LED or refreshes a display every so often
+ * needs neither a stack nor a TCB of its own. Written as a protothread, a
+ * function that returns where it would wait and resumes there on the next
+ * call, it costs a coop_t (a few words) in the one "Coop" task:
+ *
+ *     static coop_state_t blink(coop_t *pt, void *arg)
+ *     {
+ *         COOP_BEGIN(pt);
+ *         for (;;)
+ *         {
+ *             PORT_REGS->GROUP[0].PORT_OUTTGL = PORT_PA14;
+ *             COOP_SLEEP(pt, 500u);
+ *         }
+ *         COOP_END(pt);
+ *     }
+ *
+ *     (void)Coop_Add("blink", blink, NULL);
+ *
+ * The macros are a switch on the line of the last wait (coop_t.lc), so:
+ *   - locals do not survive a COOP_* wait: keep state static or in `arg`;
+ *   - no COOP_* wait inside a switch statement of its own;
+ *   - nothing is preempted by another thread: code between two waits runs
+ *     to the end, and a blocking driver call (an I2C write) holds up the
+ *     others for that long. Fine for milliseconds, not for a 1 s wait.
+ *
+ * The runner calls every thread once per pass, skipping those asleep in
+ * COOP_SLEEP() until their tick, and then sleeps until the earliest such
+ * wake; COOP_WAIT_UNTIL() conditions are looked at again after at most
+ * COOP_POLL_MS, or at once on Coop_Wake(). It checks in with the
+ * watchdog (watchdog.h) every pass: a thread that never returns resets
+ * the board like a starved task.
+ *
+ * FreeRTOS co-routines (croutine.c) do the same with their own scheduler
+ * and priority list; these need no kernel option and keep their timing in
+ * RTOS ticks, like every task.
+ * ============================================================================= */
+
+#ifndef COOP_H
+#define COOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define COOP_MAX_THREADS        8u
+#define COOP_STACK              (configMINIMAL_STACK_SIZE * 2u)     /* the deepest thread's calls */
+#define COOP_PRIO               1u      /* with the console, above idle */
+#define COOP_POLL_MS            50u     /* COOP_WAIT_UNTIL() re-check period */
+#define COOP_HEARTBEAT_MS       2000u   /* lowest priority: starvation shows here */
+
+typedef enum
+{
+    COOP_WAITING = 0,       /* on a condition: call again next pass */
+    COOP_SLEEPING,          /* until coop_t.wake */
+    COOP_EXITED             /* done: dropped from the runner */
+} coop_state_t;
+
+typedef struct
+{
+    uint16_t   lc;          /* resume point: __LINE__ of the last wait, 0 = start */
+    TickType_t wake;        /* COOP_SLEEP*() deadline */
+} coop_t;
+
+typedef coop_state_t (*coop_fn)(coop_t *pt, void *arg);
+
+/* -- Thread body ------------------------------------------------------------- */
+
+#define COOP_BEGIN(pt)          switch ((pt)->lc) { case 0:
+#define COOP_END(pt)            } (pt)->lc = 0u; return COOP_EXITED
+
+/** Give the other threads a turn; back here on the next pass. */
+#define COOP_YIELD(pt)                                                      \
+    do { (pt)->lc = __LINE__; return COOP_WAITING; case __LINE__:; } while (0)
+
+/** Resume once `cond` is true, looked at every pass. */
+#define COOP_WAIT_UNTIL(pt, cond)                                           \
+    do { (pt)->lc = __LINE__; __attribute__((fallthrough)); case __LINE__:  \
+         if (!(cond)) return COOP_WAITING; } while (0)
+
+/** Resume at tick `at` (a drift-free period: (pt)->wake += period). */
+#define COOP_SLEEP_UNTIL(pt, at)                                            \
+    do { (pt)->wake = (at); (pt)->lc = __LINE__;                            \
+         __attribute__((fallthrough)); case __LINE__:                       \
+         if ((int32_t)((pt)->wake - xTaskGetTickCount()) > 0)               \
+             return COOP_SLEEPING; } while (0)
+
+/** Resume after `ms`. */
+#define COOP_SLEEP(pt, ms)                                                  \
+    COOP_SLEEP_UNTIL(pt, xTaskGetTickCount() + pdMS_TO_TICKS(ms))
+
+#define COOP_EXIT(pt)           do { (pt)->lc = 0u; return COOP_EXITED; } while (0)
+
+/* -- Runner ------------------------------------------------------------------ */
+
+/**
+ * Run `fn(pt, arg)` from the Coop task until it exits. Before the
+ * scheduler starts; false if the table is full.
+ */
+bool Coop_Add(const char *name, coop_fn fn, void *arg);
+
+/** Create the Coop task. Before the scheduler, before or after the Coop_Add() calls. */
+bool Coop_Start(void);
+
+/** Look at every COOP_WAIT_UNTIL() now rather than in COOP_POLL_MS. */
+void Coop_Wake(void);
+void Coop_WakeFromISR(BaseType_t *woken);
+
+/** Threads still running, and passes since boot. */
+uint32_t Coop_Threads(void);
+uint32_t Coop_Passes(void);
+
+#endif /* COOP_H */
@@ -0,0 +1,176 @@
+/* =============================================================================
+ * cpufreq.c  -  CPU clock scaling: full speed to render, divided in between
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "cpufreq.h"
+#include "definitions.h"        /* MCLK_REGS, SysTick, DWT, CPU_CLOCK_FREQUENCY */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "ramfunc.h"
+
+#define CPUFREQ_TICK_CYCLES     (CPU_CLOCK_FREQUENCY / configTICK_RATE_HZ)
+#define CPUFREQ_WINDOW_CYC      ((CPU_CLOCK_FREQUENCY / 1000u) * CPUFREQ_WINDOW_MS)
+#define CPUFREQ_MIN_LEFT        16u     /* SysTick counts: reloaded before LOAD is rewritten */
+
+#if CPUFREQ_WINDOW_MS > 30000u
+#error "CPUFREQ_WINDOW_MS must stay below one DWT->CYCCNT wrap"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Interrupts masked */
+#if CPUFREQ_ENABLE
+static uint32_t cpufreq_holds;
+#endif
+static uint32_t cpufreq_cyc0;           /* CYCCNT at the last settle */
+static uint32_t cpufreq_low_cyc0;       /* CYCCNT when the clock last dropped */
+static uint32_t cpufreq_win_start;
+static uint32_t cpufreq_win_low;
+
+/* Published for any context */
+static volatile uint32_t cpufreq_div = 1u;
+static volatile uint32_t cpufreq_low_pm;
+static volatile uint32_t cpufreq_switches;
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* Interrupts masked: scale the core cycles counted since the last settle to
+ * wall cycles. Sleeps are added through CpuFreq_AddCycles() and not scaled. */
+static uint32_t cpufreq_settle(void)
+{
+    uint32_t div = cpufreq_div;
+
+    if (div > 1u)
+        DWT->CYCCNT += (DWT->CYCCNT - cpufreq_cyc0) * (div - 1u);
+    cpufreq_cyc0 = DWT->CYCCNT;
+    return cpufreq_cyc0;
+}
+
+/* Interrupts masked: close the low-clock share window if it is over */
+static void cpufreq_window(uint32_t now)
+{
+    uint32_t span = now - cpufreq_win_start;
+
+    if (cpufreq_div > 1u)
+    {
+        cpufreq_win_low  += now - cpufreq_low_cyc0;
+        cpufreq_low_cyc0  = now;
+    }
+    if (span >= CPUFREQ_WINDOW_CYC)
+    {
+        cpufreq_low_pm    = (uint32_t)(((uint64_t)cpufreq_win_low * 1000u + span / 2u) / span);
+        cpufreq_win_start = now;
+        cpufreq_win_low   = 0u;
+    }
+}
+
+#if CPUFREQ_ENABLE
+/* Interrupts masked: switch the CPU clock and carry the SysTick period over */
+static void cpufreq_set(uint32_t div)
+{
+    uint32_t old = cpufreq_div;
+    uint32_t now = cpufreq_settle();
+
+    if (div == old) return;
+    cpufreq_window(now);
+
+    /* What is left of this tick, in counts of the new clock */
+    uint32_t left = (uint32_t)(((uint64_t)SysTick->VAL * old) / div);
+
+    MCLK_REGS->MCLK_CPUDIV = MCLK_CPUDIV_DIV(div);
+    while ((MCLK_REGS->MCLK_INTFLAG & MCLK_INTFLAG_CKRDY_Msk) == 0u) {}
+    MCLK_REGS->MCLK_INTFLAG = MCLK_INTFLAG_CKRDY_Msk;
+
+    if ((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0u)
+    {
+        if (left < CPUFREQ_MIN_LEFT) left = CPUFREQ_MIN_LEFT;
+        SysTick->LOAD = left - 1u;
+        SysTick->VAL  = 0u;                             /* reloads at the next count */
+        SysTick->LOAD = CPUFREQ_TICK_CYCLES / div - 1u; /* taken at the reload after */
+    }
+
+    cpufreq_div      = div;
+    cpufreq_cyc0     = DWT->CYCCNT;
+    cpufreq_low_cyc0 = cpufreq_cyc0;
+    cpufreq_switches++;
+}
+#endif /* CPUFREQ_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void CpuFreq_Init(void)
+{
+    /* The port programs the SysTick for 120 MHz in vTaskStartScheduler():
+     * the first drop waits for the first CpuFreq_Release() */
+    cpufreq_cyc0      = DWT->CYCCNT;
+    cpufreq_win_start = cpufreq_cyc0;
+}
+
+void CpuFreq_Hold(void)
+{
+#if CPUFREQ_ENABLE
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();                    /* the switch and its SysTick reload together */
+    if (cpufreq_holds++ == 0u) cpufreq_set(1u);
+    __set_PRIMASK(primask);
+#endif
+}
+
+void CpuFreq_Release(void)
+{
+#if CPUFREQ_ENABLE
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    configASSERT(cpufreq_holds > 0u);
+    if (--cpufreq_holds == 0u) cpufreq_set(CPUFREQ_LOW_DIV);
+    __set_PRIMASK(primask);
+#endif
+}
+
+uint32_t CpuFreq_Div(void)
+{
+    return cpufreq_div;
+}
+
+/* From vTaskSwitchContext(), in SRAM with it (ramfunc.h) */
+RAMFUNC uint32_t CpuFreq_Cycles(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t c;
+
+    __disable_irq();
+    c = cpufreq_settle();
+    __set_PRIMASK(primask);
+    return c;
+}
+
+void CpuFreq_AddCycles(uint32_t n)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    (void)cpufreq_settle();
+    DWT->CYCCNT  += n;
+    cpufreq_cyc0 += n;
+    __set_PRIMASK(primask);
+}
+
+uint32_t CpuFreq_LowPm(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t pm;
+
+    __disable_irq();
+    cpufreq_window(cpufreq_settle());
+    pm = cpufreq_low_pm;
+    __set_PRIMASK(primask);
+    return pm;
+}
+
+uint32_t CpuFreq_Switches(void)
+{
+    return cpufreq_switches;
+}
@@ -0,0 +1,85 @@
+/* =============================================================================
+ * cpufreq.h  -  CPU clock scaling: full speed to render, divided in between
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The render task needs 120 MHz for a few milliseconds a frame; the rest
+ * of the time the core runs the console, telemetry and the idle loop,
+ * which 15 MHz does as well. With CPUFREQ_ENABLE the CPU clock is divided
+ * by CPUFREQ_LOW_DIV (MCLK CPUDIV, the GCLK0 / DPLL0 source stays at
+ * 120 MHz) whenever no task holds it up:
+ *
+ *     CpuFreq_Hold();   ... render, encode, start the DMA ...   CpuFreq_Release();
+ *
+ * Holds nest and count; the clock is raised in the first Hold() and
+ * dropped in the last Release(), a few cycles each (CKRDY).
+ *
+ * What the divider reaches, and what it does not:
+ *   peripherals   every peripheral clock is a GCLK (plib_clock.c): SERCOM1
+ *                 SPI (the WS2812 bit timing) and the other SERCOMs on
+ *                 GCLK1 / GCLK3, the TCs on GCLK2, TCC0-3 and EVSYS on
+ *                 GCLK0. Their bauds and periods stay put; only register
+ *                 access (APB / AHB, CPU clock) slows down, and the DMAC
+ *                 with it, still far above the 300 KB/s the strip needs.
+ *   SysTick       counts the CPU clock. Each switch reprograms it for the
+ *                 new clock, the current period scaled to what is left of
+ *                 it, so the 1 kHz tick neither slips nor jumps; tickless.c
+ *                 resumes it at CpuFreq_Div() too.
+ *   DWT->CYCCNT   counts the CPU clock too, and the run-time stats, trace
+ *                 stamps and every cycle-to-time conversion in the tree
+ *                 assume 120 MHz of wall time (idle.h keeps it so across
+ *                 sleeps). While the clock is low, CpuFreq_Cycles() scales
+ *                 what CYCCNT counted since its last call by the divider;
+ *                 it is the run-time counter (FreeRTOSConfig.h), so every
+ *                 context switch settles the task it leaves. idle.c adds
+ *                 its slept cycles through CpuFreq_AddCycles(), which are
+ *                 wall time already. A span taken with raw CYCCNT reads
+ *                 inside one task at the low clock counts CPU cycles, not
+ *                 wall time: time work under a hold.
+ *
+ * Off by default: mains installs gain nothing from it. Battery installs
+ * set CPUFREQ_ENABLE to 1, together with TICKLESS_STANDBY (tickless.h).
+ * ============================================================================= */
+
+#ifndef CPUFREQ_H
+#define CPUFREQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef CPUFREQ_ENABLE
+#define CPUFREQ_ENABLE          0       /* 1 = divide the CPU clock between holds */
+#endif
+#define CPUFREQ_LOW_DIV         8u      /* 120 MHz / 8 = 15 MHz; a power of two, <= 128 */
+#define CPUFREQ_WINDOW_MS       1000u   /* CpuFreq_LowPm() update period */
+
+#if (CPUFREQ_LOW_DIV & (CPUFREQ_LOW_DIV - 1u)) != 0u || CPUFREQ_LOW_DIV < 2u || CPUFREQ_LOW_DIV > 128u
+#error "CPUFREQ_LOW_DIV must be a power of two from 2 to 128 (MCLK CPUDIV)"
+#endif
+
+/** Start the share meter, before the scheduler. The clock first drops in
+ *  the first CpuFreq_Release(); without CPUFREQ_ENABLE it stays at 120 MHz. */
+void CpuFreq_Init(void);
+
+/** Full speed until the matching CpuFreq_Release(). Task context. */
+void CpuFreq_Hold(void);
+void CpuFreq_Release(void);
+
+/** Current CPU clock divider: 1, or CPUFREQ_LOW_DIV. Any context. */
+uint32_t CpuFreq_Div(void);
+
+/** DWT->CYCCNT brought up to wall time at 120 MHz first; the FreeRTOS
+ *  run-time counter. Any context. */
+uint32_t CpuFreq_Cycles(void);
+
+/** Step DWT->CYCCNT by n wall cycles the core did not count (a sleep),
+ *  unscaled. Any context. */
+void CpuFreq_AddCycles(uint32_t n);
+
+/** Share of the last window spent at the low clock, permille. Any task. */
+uint32_t CpuFreq_LowPm(void);
+
+/** Clock switches since boot. */
+uint32_t CpuFreq_Switches(void);
+
+#endif /* CPUFREQ_H */
@@ -0,0 +1,118 @@
+/* =============================================================================
+ * cpuload.c  -  Per-task CPU utilisation from the FreeRTOS run-time counters
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "cpuload.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "metrics.h"
+#include "stackguard.h"
+#include <string.h>
+
+#if CPULOAD_PERIOD_MS > 30000u
+#error "CPULOAD_PERIOD_MS too long for the 32-bit cycle counter"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Timer service task only */
+static TaskStatus_t    cpuload_ts[METRICS_MAX_TASKS];
+static TaskHandle_t    cpuload_prev_task[METRICS_MAX_TASKS];
+static uint32_t        cpuload_prev_rt[METRICS_MAX_TASKS];
+static uint32_t        cpuload_prev_total;
+static TickType_t      cpuload_prev_tick;
+static uint16_t        cpuload_busy[CPULOAD_PEAK_PERIODS];
+static uint32_t        cpuload_pos;
+static bool            cpuload_primed;      /* first call only sets the baseline */
+static metrics_tasks_t cpuload_tasks;
+static StaticTimer_t   cpuload_timer;
+
+static uint16_t cpuload_pm(uint32_t part, uint32_t span)
+{
+    uint32_t pm = (uint32_t)(((uint64_t)part * 1000u + span / 2u) / span);
+
+    return (uint16_t)((pm > 1000u) ? 1000u : pm);
+}
+
+/* The high-water scan reads this task's own stack bottom too, under its guard */
+static UBaseType_t cpuload_state(uint32_t *total)
+{
+    UBaseType_t n;
+
+    vTaskSuspendAll();
+    StackGuard_Lift();
+    n = uxTaskGetSystemState(cpuload_ts, METRICS_MAX_TASKS, total);
+    StackGuard_Restore();
+    (void)xTaskResumeAll();
+    return n;
+}
+
+static void cpuload_sample(TimerHandle_t timer)
+{
+    uint32_t      total;
+    UBaseType_t   n     = cpuload_state(&total);
+    uint32_t      span  = total - cpuload_prev_total;
+    TickType_t    now   = xTaskGetTickCount();
+    TaskHandle_t  idle  = xTaskGetIdleTaskHandle();
+    uint32_t      idle_rt = 0u;
+    metrics_cpu_t cpu;
+
+    (void)timer;
+    cpuload_tasks.count = 0u;
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        const TaskStatus_t *ts   = &cpuload_ts[i];
+        uint32_t            prev = ts->ulRunTimeCounter;    /* new task: from now */
+        uint32_t            k;
+
+        for (k = 0; k < METRICS_MAX_TASKS; k++)
+            if (cpuload_prev_task[k] == ts->xHandle) prev = cpuload_prev_rt[k];
+        if (ts->xHandle == idle) idle_rt = ts->ulRunTimeCounter - prev;
+
+        metrics_task_load_t *t = &cpuload_tasks.task[cpuload_tasks.count++];
+
+        strncpy(t->name, ts->pcTaskName, sizeof(t->name) - 1u);
+        t->name[sizeof(t->name) - 1u] = '\0';
+        t->pm         = (span != 0u) ? cpuload_pm(ts->ulRunTimeCounter - prev, span) : 0u;
+        t->stack_free = (uint16_t)(ts->usStackHighWaterMark - StackGuard_Words(ts->pxStackBase));
+    }
+
+    memset(cpuload_prev_task, 0, sizeof(cpuload_prev_task));
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        cpuload_prev_task[i] = cpuload_ts[i].xHandle;
+        cpuload_prev_rt[i]   = cpuload_ts[i].ulRunTimeCounter;
+    }
+    cpuload_prev_total = total;
+    if (!cpuload_primed || span == 0u)
+    {
+        cpuload_primed    = true;
+        cpuload_prev_tick = now;
+        return;
+    }
+
+    cpu.idle_pm   = cpuload_pm(idle_rt, span);
+    cpu.busy_pm   = (uint16_t)(1000u - cpu.idle_pm);
+    cpu.period_ms = (uint32_t)((now - cpuload_prev_tick) * portTICK_PERIOD_MS);
+    cpuload_prev_tick = now;
+
+    cpuload_busy[cpuload_pos] = cpu.busy_pm;
+    cpuload_pos = (cpuload_pos + 1u) % CPULOAD_PEAK_PERIODS;
+    cpu.peak_pm = 0u;
+    for (uint32_t i = 0; i < CPULOAD_PEAK_PERIODS; i++)
+        if (cpuload_busy[i] > cpu.peak_pm) cpu.peak_pm = cpuload_busy[i];
+
+    Metrics_PublishCpu(&cpu, &cpuload_tasks);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool CpuLoad_Start(void)
+{
+    TimerHandle_t t = xTimerCreateStatic("CpuLoad", pdMS_TO_TICKS(CPULOAD_PERIOD_MS), pdTRUE,
+                                         NULL, cpuload_sample, &cpuload_timer);
+
+    return xTimerStart(t, 0) == pdPASS;
+}
@@ -0,0 +1,38 @@
+/* =============================================================================
+ * cpuload.h  -  Per-task CPU utilisation from the FreeRTOS run-time counters
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The kernel charges every cycle to the task that was running
+ * (configGENERATE_RUN_TIME_STATS on DWT->CYCCNT, FreeRTOSConfig.h). Once
+ * per CPULOAD_PERIOD_MS a timer callback reads all counters, takes the
+ * difference to the previous reading and publishes through metrics.h:
+ *
+ *   metrics_t.cpu       busy / idle share of the period, and the highest
+ *                       busy share of the last CPULOAD_PEAK_PERIODS
+ *   Metrics_ReadTasks() the share of every task, with its stack headroom
+ *
+ * Busy is everything but the idle task, so it includes the timer task and
+ * interrupt handlers (counted to whichever task they interrupted); 1000 -
+ * peak_pm is the headroom left for more LEDs and effects.
+ *
+ * CYCCNT is 32 bits at 120 MHz and wraps every ~35 s; unsigned differences
+ * are exact as long as the period stays well below that.
+ * The CLI "top" command and telemetry ('L' frames, cpu_* channels) read it.
+ * ============================================================================= */
+
+#ifndef CPULOAD_H
+#define CPULOAD_H
+
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define CPULOAD_PERIOD_MS       1000u
+#define CPULOAD_PEAK_PERIODS    60u         /* rolling peak: last minute */
+
+/**
+ * Create (static) and start the sampling timer. After Metrics_Init(),
+ * before the scheduler; false if the timer queue is full.
+ */
+bool CpuLoad_Start(void);
+
+#endif /* CPULOAD_H */
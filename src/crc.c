@@ -0,0 +1,218 @@
+/* =============================================================================
+ * crc.c  -  CRC-32 on the DMAC CRC engine, for bulk checks or during a DMA
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "crc.h"
+#include "definitions.h"        /* DMAC plib, __RBIT */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "dma_qos.h"
+#include "log.h"
+
+#define CRC_CHECK_VALUE     0xCBF43926u         /* CRC-32 of "123456789" */
+#define CRC_SEED            0xFFFFFFFFu
+#define CRC_MAX_BEATS       0xFFFFu             /* BTCNT */
+#define CRC_NONE            0xFFu               /* crc_form: engine unusable */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static SemaphoreHandle_t     crc_lock;
+static StaticSemaphore_t     crc_lock_buf;
+static uint8_t               crc_form = CRC_NONE;   /* bit 0: complement, bit 1: bit-reverse */
+static volatile uint32_t     crc_sink;              /* bulk destination, never read */
+static volatile uint8_t      crc_dma_flags;
+static volatile TaskHandle_t crc_waiter;
+
+/* CRC-16/CCITT-FALSE, a byte per step: Crc16_Ccitt() */
+static const uint16_t crc16_tab[256] =
+{
+    0x0000u, 0x1021u, 0x2042u, 0x3063u, 0x4084u, 0x50A5u, 0x60C6u, 0x70E7u,
+    0x8108u, 0x9129u, 0xA14Au, 0xB16Bu, 0xC18Cu, 0xD1ADu, 0xE1CEu, 0xF1EFu,
+    0x1231u, 0x0210u, 0x3273u, 0x2252u, 0x52B5u, 0x4294u, 0x72F7u, 0x62D6u,
+    0x9339u, 0x8318u, 0xB37Bu, 0xA35Au, 0xD3BDu, 0xC39Cu, 0xF3FFu, 0xE3DEu,
+    0x2462u, 0x3443u, 0x0420u, 0x1401u, 0x64E6u, 0x74C7u, 0x44A4u, 0x5485u,
+    0xA56Au, 0xB54Bu, 0x8528u, 0x9509u, 0xE5EEu, 0xF5CFu, 0xC5ACu, 0xD58Du,
+    0x3653u, 0x2672u, 0x1611u, 0x0630u, 0x76D7u, 0x66F6u, 0x5695u, 0x46B4u,
+    0xB75Bu, 0xA77Au, 0x9719u, 0x8738u, 0xF7DFu, 0xE7FEu, 0xD79Du, 0xC7BCu,
+    0x48C4u, 0x58E5u, 0x6886u, 0x78A7u, 0x0840u, 0x1861u, 0x2802u, 0x3823u,
+    0xC9CCu, 0xD9EDu, 0xE98Eu, 0xF9AFu, 0x8948u, 0x9969u, 0xA90Au, 0xB92Bu,
+    0x5AF5u, 0x4AD4u, 0x7AB7u, 0x6A96u, 0x1A71u, 0x0A50u, 0x3A33u, 0x2A12u,
+    0xDBFDu, 0xCBDCu, 0xFBBFu, 0xEB9Eu, 0x9B79u, 0x8B58u, 0xBB3Bu, 0xAB1Au,
+    0x6CA6u, 0x7C87u, 0x4CE4u, 0x5CC5u, 0x2C22u, 0x3C03u, 0x0C60u, 0x1C41u,
+    0xEDAEu, 0xFD8Fu, 0xCDECu, 0xDDCDu, 0xAD2Au, 0xBD0Bu, 0x8D68u, 0x9D49u,
+    0x7E97u, 0x6EB6u, 0x5ED5u, 0x4EF4u, 0x3E13u, 0x2E32u, 0x1E51u, 0x0E70u,
+    0xFF9Fu, 0xEFBEu, 0xDFDDu, 0xCFFCu, 0xBF1Bu, 0xAF3Au, 0x9F59u, 0x8F78u,
+    0x9188u, 0x81A9u, 0xB1CAu, 0xA1EBu, 0xD10Cu, 0xC12Du, 0xF14Eu, 0xE16Fu,
+    0x1080u, 0x00A1u, 0x30C2u, 0x20E3u, 0x5004u, 0x4025u, 0x7046u, 0x6067u,
+    0x83B9u, 0x9398u, 0xA3FBu, 0xB3DAu, 0xC33Du, 0xD31Cu, 0xE37Fu, 0xF35Eu,
+    0x02B1u, 0x1290u, 0x22F3u, 0x32D2u, 0x4235u, 0x5214u, 0x6277u, 0x7256u,
+    0xB5EAu, 0xA5CBu, 0x95A8u, 0x8589u, 0xF56Eu, 0xE54Fu, 0xD52Cu, 0xC50Du,
+    0x34E2u, 0x24C3u, 0x14A0u, 0x0481u, 0x7466u, 0x6447u, 0x5424u, 0x4405u,
+    0xA7DBu, 0xB7FAu, 0x8799u, 0x97B8u, 0xE75Fu, 0xF77Eu, 0xC71Du, 0xD73Cu,
+    0x26D3u, 0x36F2u, 0x0691u, 0x16B0u, 0x6657u, 0x7676u, 0x4615u, 0x5634u,
+    0xD94Cu, 0xC96Du, 0xF90Eu, 0xE92Fu, 0x99C8u, 0x89E9u, 0xB98Au, 0xA9ABu,
+    0x5844u, 0x4865u, 0x7806u, 0x6827u, 0x18C0u, 0x08E1u, 0x3882u, 0x28A3u,
+    0xCB7Du, 0xDB5Cu, 0xEB3Fu, 0xFB1Eu, 0x8BF9u, 0x9BD8u, 0xABBBu, 0xBB9Au,
+    0x4A75u, 0x5A54u, 0x6A37u, 0x7A16u, 0x0AF1u, 0x1AD0u, 0x2AB3u, 0x3A92u,
+    0xFD2Eu, 0xED0Fu, 0xDD6Cu, 0xCD4Du, 0xBDAAu, 0xAD8Bu, 0x9DE8u, 0x8DC9u,
+    0x7C26u, 0x6C07u, 0x5C64u, 0x4C45u, 0x3CA2u, 0x2C83u, 0x1CE0u, 0x0CC1u,
+    0xEF1Fu, 0xFF3Eu, 0xCF5Du, 0xDF7Cu, 0xAF9Bu, 0xBFBAu, 0x8FD9u, 0x9FF8u,
+    0x6E17u, 0x7E36u, 0x4E55u, 0x5E74u, 0x2E93u, 0x3EB2u, 0x0ED1u, 0x1EF0u
+};
+
+static const DMAC_CRC_SETUP crc_setup =
+{
+    .polynomial_type = DMAC_CRC_TYPE_32,
+    .crc_mode        = DMAC_CRC_MODE_DEFAULT,
+    .seed            = CRC_SEED,
+};
+
+/* The engine's checksum as the standard CRC-32 */
+static uint32_t crc_normal(uint32_t v)
+{
+    if ((crc_form & 2u) != 0u) v = __RBIT(v);
+    if ((crc_form & 1u) != 0u) v = ~v;
+    return v;
+}
+
+static uint32_t crc_result(void)
+{
+    return crc_normal(DMAC_CRCRead());
+}
+
+/* -- DMA --------------------------------------------------------------------- */
+
+/* Block done or failed (dma_qos.c DMAC_OTHER dispatch) */
+static void crc_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    crc_dma_flags = flags;
+    if (crc_waiter != NULL) vTaskNotifyGiveIndexedFromISR(crc_waiter, CRC_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* One block of `beats` from src into the sink, software triggered */
+static bool crc_dma_block(uint32_t src, uint32_t beats, bool words)
+{
+    dmac_descriptor_registers_t *d =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + CRC_DMA_CHANNEL;
+    uint32_t got;
+
+    d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk
+                     | (words ? DMAC_BTCTRL_BEATSIZE_WORD : DMAC_BTCTRL_BEATSIZE_BYTE)
+                     | DMAC_BTCTRL_BLOCKACT_INT;
+    d->DMAC_BTCNT    = (uint16_t)beats;
+    d->DMAC_SRCADDR  = src + beats * (words ? 4u : 1u);     /* end address with increment */
+    d->DMAC_DSTADDR  = (uint32_t)&crc_sink;
+    d->DMAC_DESCADDR = 0u;
+
+    crc_dma_flags = 0u;
+    crc_waiter    = xTaskGetCurrentTaskHandle();
+    (void)ulTaskNotifyTakeIndexed(CRC_NOTIFY_INDEX, pdTRUE, 0u);         /* drop a stale give */
+    DMAC_REGS->CHANNEL[CRC_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    DMAC_REGS->DMAC_SWTRIGCTRL = DMAC_SWTRIGCTRL_SWTRIG0_Msk << CRC_DMA_CHANNEL;
+
+    got = ulTaskNotifyTakeIndexed(CRC_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(CRC_TIMEOUT_MS));
+    crc_waiter = NULL;
+    if (got == 0u)
+    {
+        DMAC_REGS->CHANNEL[CRC_DMA_CHANNEL].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+        while ((DMAC_REGS->CHANNEL[CRC_DMA_CHANNEL].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u) {}
+        return false;
+    }
+    return (crc_dma_flags & DMAC_CHINTFLAG_TERR_Msk) == 0u;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Crc_Init(void)
+{
+    static const uint8_t check[9] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    uint32_t raw = DMAC_CRCCalculate((void *)check, sizeof(check), crc_setup);
+
+    DMAC_CRCDisable();
+    crc_form = CRC_NONE;
+    for (uint8_t f = 0; f < 4u; f++)
+    {
+        uint32_t v = ((f & 2u) != 0u) ? __RBIT(raw) : raw;
+
+        if ((((f & 1u) != 0u) ? ~v : v) == CRC_CHECK_VALUE) { crc_form = f; break; }
+    }
+    if (crc_form == CRC_NONE)
+    {
+        LOG_ERROR("crc: engine gave %08lx for the check value", (unsigned long)raw);
+        return false;
+    }
+
+    crc_lock = xSemaphoreCreateMutexStatic(&crc_lock_buf);
+    DMAC_REGS->CHANNEL[CRC_DMA_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(0u) | DMAC_CHCTRLA_TRIGACT_BLOCK | DMAC_CHCTRLA_BURSTLEN_16BEAT;
+    Dma_Assign(CRC_DMA_CHANNEL, DMA_CLASS_BULK);
+    (void)Dma_OtherRegister(CRC_DMA_CHANNEL, crc_dma_isr);
+    DMAC_REGS->CHANNEL[CRC_DMA_CHANNEL].DMAC_CHINTENSET =
+        DMAC_CHINTENSET_TCMPL_Msk | DMAC_CHINTENSET_TERR_Msk;
+    return crc_lock != NULL;
+}
+
+bool Crc_Memory(const void *data, uint32_t len, uint32_t *crc)
+{
+    uint32_t src   = (uint32_t)data;
+    bool     words = ((src | len) & 3u) == 0u;
+    bool     ok;
+
+    if (!Crc_StreamBegin(CRC_DMA_CHANNEL)) return false;
+    ok = true;
+    while (ok && len != 0u)
+    {
+        uint32_t beats = words ? len / 4u : len;
+
+        if (beats > CRC_MAX_BEATS) beats = CRC_MAX_BEATS;
+        ok = crc_dma_block(src, beats, words);
+        src += beats * (words ? 4u : 1u);
+        len -= beats * (words ? 4u : 1u);
+    }
+    *crc = Crc_StreamEnd();
+    return ok;
+}
+
+bool Crc_StreamBegin(uint8_t ch)
+{
+    if (crc_form == CRC_NONE || crc_lock == NULL) return false;
+
+    (void)xSemaphoreTake(crc_lock, portMAX_DELAY);
+    DMAC_ChannelCRCSetup((DMAC_CHANNEL)ch, crc_setup);
+    return true;
+}
+
+uint32_t Crc_StreamEnd(void)
+{
+    uint32_t crc = crc_result();
+
+    DMAC_CRCDisable();
+    (void)xSemaphoreGive(crc_lock);
+    return crc;
+}
+
+bool Crc_TryBuffer(const void *data, uint32_t len, uint32_t *crc)
+{
+    if (crc_form == CRC_NONE || crc_lock == NULL) return false;
+    if (xSemaphoreTake(crc_lock, 0u) != pdTRUE) return false;       /* a bulk or stream check is on */
+
+    *crc = crc_normal(DMAC_CRCCalculate((void *)data, len, crc_setup));
+    DMAC_CRCDisable();
+    (void)xSemaphoreGive(crc_lock);
+    return true;
+}
+
+uint16_t Crc16_Ccitt(const void *data, uint32_t len)
+{
+    const uint8_t *p   = (const uint8_t *)data;
+    uint16_t       crc = 0xFFFFu;
+
+    while (len-- != 0u)
+        crc = (uint16_t)((crc << 8) ^ crc16_tab[(uint8_t)((crc >> 8) ^ *p++)]);
+    return crc;
+}
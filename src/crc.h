@@ -0,0 +1,73 @@
+/* =============================================================================
+ * crc.h  -  CRC-32 on the DMAC CRC engine, for bulk checks or during a DMA
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The DMAC has one CRC engine that can be hooked to any channel: it folds
+ * every beat the channel reads into the checksum as the transfer runs, so
+ * a check costs no CPU time at all. This module owns the engine and
+ * shares it, under a mutex, two ways:
+ *
+ *   Bulk    Crc_Memory() reads a run of memory (RAM, internal flash, the
+ *           QSPI window) on its own BULK channel into a one-word sink; the
+ *           caller sleeps until the last block is in.
+ *   Stream  Crc_StreamBegin(ch) hooks the engine to a client's channel and
+ *           Crc_StreamEnd() collects the checksum of every beat that
+ *           channel moved in between, over as many blocks as it needed
+ *           (QFlash_ReadCrc() copies and checks at once this way).
+ *   Try     Crc_TryBuffer() feeds a buffer to the engine from the CPU,
+ *           without a channel or a sleep, if nobody holds it; a caller
+ *           that can do without the CRC (neopixel.c's unchanged-frame
+ *           skip) gets false instead of waiting behind a bulk check.
+ *
+ * The result is the usual CRC-32 (IEEE 802.3: zlib, Ethernet, PNG), check
+ * value 0xCBF43926 for "123456789". Crc_Init() computes that check value
+ * once and normalises the engine's output to it; if neither form matches,
+ * every call fails rather than return a wrong CRC.
+ *
+ * Crc16_Ccitt() is the CPU's own, small-frame check, shared by the serial
+ * links (telem.c, pixdist.c, netbridge.c): CRC-16/CCITT-FALSE, poly
+ * 0x1021, init 0xFFFF, check value 0x29B1, from a 512-byte table in flash.
+ * ============================================================================= */
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define CRC_DMA_CHANNEL         9u      /* DMA_OTHER channel, dma_qos.h            */
+#define CRC_NOTIFY_INDEX        3u      /* qflash.h's: a task waits on one at a time */
+#define CRC_TIMEOUT_MS          1000u   /* per 64 K-beat block                     */
+
+/** Check the engine, set up the channel and the lock. After Dma_Init(), before the scheduler. */
+bool Crc_Init(void);
+
+/**
+ * CRC-32 of `len` bytes at `data` (word beats when both are 4-aligned,
+ * bytes otherwise). Tasks only, sleeps; false if the engine is unusable or
+ * the DMA failed.
+ */
+bool Crc_Memory(const void *data, uint32_t len, uint32_t *crc);
+
+/**
+ * Take the engine and hook it to DMAC channel `ch`; start that channel's
+ * transfers after this. Tasks only, waits for the engine. False if it is
+ * unusable (nothing is held then).
+ */
+bool Crc_StreamBegin(uint8_t ch);
+
+/** CRC-32 of what the channel read since Crc_StreamBegin(); releases the engine. */
+uint32_t Crc_StreamEnd(void);
+
+/**
+ * CRC-32 of `len` bytes at `data`, fed by the CPU, if the engine is free
+ * right now. Tasks, or before the scheduler; never waits. False if it is
+ * held or unusable: `crc` is not written then.
+ */
+bool Crc_TryBuffer(const void *data, uint32_t len, uint32_t *crc);
+
+/** CRC-16/CCITT-FALSE of `len` bytes at `data`. Any context, no engine, no lock. */
+uint16_t Crc16_Ccitt(const void *data, uint32_t len);
+
+#endif /* CRC_H */
@@ -0,0 +1,99 @@
+/* =============================================================================
+ * defer.c  -  Work handed from ISRs to one high-priority task, through a ring
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "defer.h"
+#include "task.h"
+#include "ring.h"
+#include "cpufreq.h"
+#include "watchdog.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    defer_fn fn;
+    void    *arg1;
+    uint32_t arg2;
+} defer_call_t;
+
+RING_STATIC(defer_ring, sizeof(defer_call_t), DEFER_SLOTS);
+
+static StackType_t       defer_stack[DEFER_STACK];
+static StaticTask_t      defer_tcb;
+static TaskHandle_t      defer_task_handle;
+
+static volatile uint32_t defer_calls;
+static volatile uint32_t defer_peak;
+static volatile uint32_t defer_max_cycles;
+
+/* A slot filled in place: the claim, three stores, the publish */
+static bool defer_put(defer_fn fn, void *arg1, uint32_t arg2)
+{
+    defer_call_t *c = Ring_ClaimMP(&defer_ring);
+
+    if (c == NULL) return false;
+    c->fn   = fn;
+    c->arg1 = arg1;
+    c->arg2 = arg2;
+    Ring_PublishMP(&defer_ring);
+    return true;
+}
+
+static void defer_task(void *arg)
+{
+    watchdog_id_t wd = Watchdog_Register("Defer", DEFER_HEARTBEAT_MS * 2u);
+    defer_call_t  c;
+
+    (void)arg;
+    for (;;)
+    {
+        for (;;)
+        {
+            uint32_t depth = Ring_Count(&defer_ring), t0, dt;
+
+            if (depth > defer_peak) defer_peak = depth;
+            if (!Ring_Get(&defer_ring, &c)) break;
+
+            t0 = CpuFreq_Cycles();
+            c.fn(c.arg1, c.arg2);
+            dt = CpuFreq_Cycles() - t0;
+            if (dt > defer_max_cycles) defer_max_cycles = dt;
+            defer_calls++;
+        }
+        Watchdog_CheckIn(wd);
+        (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DEFER_HEARTBEAT_MS));
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Defer_Start(void)
+{
+    defer_task_handle = xTaskCreateStatic(defer_task, "Defer", DEFER_STACK, NULL, DEFER_TASK_PRIO,
+                                          defer_stack, &defer_tcb);
+    return defer_task_handle != NULL;
+}
+
+bool Defer_FromISR(defer_fn fn, void *arg1, uint32_t arg2, BaseType_t *woken)
+{
+    if (!defer_put(fn, arg1, arg2)) return false;
+    if (defer_task_handle != NULL) vTaskNotifyGiveFromISR(defer_task_handle, woken);
+    return true;
+}
+
+bool Defer_Call(defer_fn fn, void *arg1, uint32_t arg2)
+{
+    if (!defer_put(fn, arg1, arg2)) return false;
+    if (defer_task_handle != NULL) xTaskNotifyGive(defer_task_handle);
+    return true;
+}
+
+void Defer_GetStats(defer_stats_t *out)
+{
+    out->calls      = defer_calls;
+    out->dropped    = defer_ring.dropped;
+    out->peak       = defer_peak;
+    out->max_cycles = defer_max_cycles;
+}
@@ -0,0 +1,73 @@
+/* =============================================================================
+ * defer.h  -  Work handed from ISRs to one high-priority task, through a ring
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * An ISR that has follow-up work (a DMA block done, a sensor edge, a line
+ * of received bytes) either wakes a task of its own, a stack and a TCB for
+ * a few lines of code, or pends a call to the timer service task, which
+ * goes through the timer command queue: a critical section and a queue
+ * copy in the ISR, and the call then waits behind the actuator's timer
+ * callbacks in a queue of configTIMER_QUEUE_LENGTH.
+ *
+ * Defer_FromISR(fn, arg1, arg2) instead puts the call into a multi-producer
+ * ring (ring.h, DEFER_SLOTS calls of a function and its two arguments, as
+ * a PendedFunction_t) and notifies the "Defer" task, which runs the calls
+ * in the order they were queued:
+ *
+ *     EIC ISR: clear the flag, Defer_FromISR(edge_work, NULL, level, &woken)
+ *     Defer task: edge_work(NULL, level)
+ *
+ * The ISR part is an LDREX / STREX claim, three word stores and a give:
+ * no critical section, so it is safe at any priority at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY (the give is a FromISR call).
+ * Defer_Call() is the same from a task. A full ring refuses the call
+ * (false) and counts it.
+ *
+ * The task runs at DEFER_TASK_PRIO, the top with the timer service task,
+ * so a deferred call runs right after the interrupts are done. Each call
+ * must be short and never block: it holds up every call behind it, and
+ * the actuator's steps with it. Calls that need the actuator's own
+ * context (the timer task) keep using xTimerPendFunctionCallFromISR().
+ * The task checks in with the watchdog (watchdog.h) at least every
+ * DEFER_HEARTBEAT_MS, so a call that never returns resets the board.
+ *
+ * "irq" on the console prints the calls, the drops, the deepest the ring
+ * got and the longest call.
+ * ============================================================================= */
+
+#ifndef DEFER_H
+#define DEFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"           /* BaseType_t */
+
+/* -- User configuration ------------------------------------------------------ */
+#define DEFER_SLOTS             32u     /* calls in flight, power of two              */
+#define DEFER_TASK_PRIO         (configMAX_PRIORITIES - 1u)     /* with the timer task */
+#define DEFER_STACK             (configMINIMAL_STACK_SIZE * 2u) /* the deepest call    */
+#define DEFER_HEARTBEAT_MS      1000u   /* idle wake-ups to check in with the watchdog */
+
+/** A deferred call, as a pended function for the timer task. */
+typedef void (*defer_fn)(void *arg1, uint32_t arg2);
+
+typedef struct
+{
+    uint32_t calls;             /* run since boot */
+    uint32_t dropped;           /* refused, ring full */
+    uint32_t peak;              /* most calls waiting at once */
+    uint32_t max_cycles;        /* longest single call */
+} defer_stats_t;
+
+/** Create the Defer task (static). Before the scheduler. */
+bool Defer_Start(void);
+
+/** Queue fn(arg1, arg2) for the Defer task; false, counted, if the ring is full. ISRs. */
+bool Defer_FromISR(defer_fn fn, void *arg1, uint32_t arg2, BaseType_t *woken);
+
+/** The same from a task. */
+bool Defer_Call(defer_fn fn, void *arg1, uint32_t arg2);
+
+void Defer_GetStats(defer_stats_t *out);
+
+#endif /* DEFER_H */
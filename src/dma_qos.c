@@ -0,0 +1,206 @@
+/* =============================================================================
+ * dma_qos.c  -  DMAC priority levels and bus QoS per DMA client
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "dma_qos.h"
+#include "rtos_trace.h"
+#include "irqstat.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static dma_other_fn dma_other[DMA_OTHER_COUNT];
+static dma_other_fn dma_fast[DMA_OTHER_FIRST];
+
+/* The plib's channel handlers (plib_dmac.c), called from the vectors below */
+void DMAC_0_InterruptHandler(void);
+void DMAC_1_InterruptHandler(void);
+void DMAC_2_InterruptHandler(void);
+void DMAC_3_InterruptHandler(void);
+
+/* -- ISR --------------------------------------------------------------------- */
+
+#define DMA_OTHER_MASK      (((1u << DMA_OTHER_COUNT) - 1u) << DMA_OTHER_FIRST)
+
+/* A plib channel's vector (the MCC NVIC settings name these): a fast
+ * handler gets the flags, cleared, otherwise the plib's handler runs the
+ * channel object and the callback. Inlined, so DMAC_0_Handler runs from
+ * SRAM as a whole (ramfunc.h) */
+static inline __attribute__((always_inline)) void dma_plib_isr(uint32_t ch, void (*plib)(void))
+{
+    dma_other_fn fast = dma_fast[ch];
+    uint8_t      flags;
+
+    IRQSTAT_ENTER((irqstat_id_t)((uint32_t)IRQSTAT_DMAC_0 + ch));
+    RTOS_TRACE_ISR_ENTER();
+    flags = DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG;
+    if (fast != NULL)
+    {
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = flags;
+        fast(flags);
+    }
+    else
+    {
+        plib();
+        RTOS_TRACE_DMA_EVENT(ch, (((flags & DMAC_CHINTFLAG_TCMPL_Msk) != 0u)
+                                  && ((flags & DMAC_CHINTFLAG_TERR_Msk) == 0u))
+                                 ? DMAC_TRANSFER_EVENT_COMPLETE : DMAC_TRANSFER_EVENT_ERROR);
+    }
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT((irqstat_id_t)((uint32_t)IRQSTAT_DMAC_0 + ch));
+}
+
+void DMAC_0_Handler(void)
+{
+    dma_plib_isr(0u, DMAC_0_InterruptHandler);
+}
+
+void DMAC_1_Handler(void)
+{
+    dma_plib_isr(1u, DMAC_1_InterruptHandler);
+}
+
+void DMAC_2_Handler(void)
+{
+    dma_plib_isr(2u, DMAC_2_InterruptHandler);
+}
+
+void DMAC_3_Handler(void)
+{
+    dma_plib_isr(3u, DMAC_3_InterruptHandler);
+}
+
+/* Every channel from DMA_OTHER_FIRST up.
+ * INTSTATUS names the channels with an enabled interrupt pending, so only
+ * those are visited, lowest first */
+void DMAC_OTHER_Handler(void)
+{
+    uint32_t pend;
+
+    IRQSTAT_ENTER(IRQSTAT_DMA_OTHER);
+    RTOS_TRACE_ISR_ENTER();
+    pend = DMAC_REGS->DMAC_INTSTATUS & DMA_OTHER_MASK;
+    while (pend != 0u)
+    {
+        uint32_t ch    = (uint32_t)__builtin_ctz(pend);
+        uint8_t  flags = DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG;
+
+        pend &= pend - 1u;
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = flags;
+        if (dma_other[ch - DMA_OTHER_FIRST] != NULL) dma_other[ch - DMA_OTHER_FIRST](flags);
+    }
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_DMA_OTHER);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Dma_Init(void)
+{
+    /* Round robin only where fairness beats determinism (levels 0 and 1) */
+    DMAC_REGS->DMAC_PRICTRL0 = DMAC_PRICTRL0_QOS3(DMAC_PRICTRL0_QOS0_CRITICAL_Val)
+                             | DMAC_PRICTRL0_QOS2(DMAC_PRICTRL0_QOS0_SENSITIVE_Val)
+                             | DMAC_PRICTRL0_QOS1(DMAC_PRICTRL0_QOS0_SHORTAGE_Val)
+                             | DMAC_PRICTRL0_RRLVLEN1_Msk
+                             | DMAC_PRICTRL0_QOS0(DMAC_PRICTRL0_QOS0_REGULAR_Val)
+                             | DMAC_PRICTRL0_RRLVLEN0_Msk;
+}
+
+void Dma_Assign(DMAC_CHANNEL ch, dma_class_t cls)
+{
+    if (cls >= DMA_CLASS_COUNT) return;
+
+    DMAC_REGS->CHANNEL[ch].DMAC_CHPRILVL = DMAC_CHPRILVL_PRILVL(cls);
+}
+
+void Dma_FastRegister(DMAC_CHANNEL ch, dma_other_fn fn)
+{
+    if (ch < DMA_OTHER_FIRST) dma_fast[ch] = fn;
+}
+
+bool Dma_OtherRegister(uint8_t ch, dma_other_fn fn)
+{
+    if (ch < DMA_OTHER_FIRST || ch >= DMA_OTHER_FIRST + DMA_OTHER_COUNT) return false;
+
+    dma_other[ch - DMA_OTHER_FIRST] = fn;
+    NVIC_SetPriority(DMAC_OTHER_IRQn, DMA_OTHER_PRIO);
+    NVIC_EnableIRQ(DMAC_OTHER_IRQn);
+    return true;
+}
+
+/* -- Stress benchmark -------------------------------------------------------- */
+
+#if DMA_STRESS_ENABLE
+
+#include "neopixel.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+
+#if (NEO_BACKEND == NEO_BACKEND_SPI) && (NEO_OUTPUTS > 3u)
+#error "DMA_STRESS_CHANNEL is one of the NeoPixel outputs"
+#endif
+
+static uint32_t dma_stress_src[DMA_STRESS_BYTES / 4u];
+static uint32_t dma_stress_dst[DMA_STRESS_BYTES / 4u];
+static volatile bool     dma_stress_run    = false;
+static volatile uint32_t dma_stress_blocks = 0u;
+
+/* Re-arm the copy as soon as it finishes so the bus never rests */
+static void Dma_StressCallback(DMAC_TRANSFER_EVENT event, uintptr_t context)
+{
+    (void)event;
+    (void)context;
+
+    dma_stress_blocks++;
+    if (dma_stress_run)
+        (void)DMAC_ChannelTransfer(DMA_STRESS_CHANNEL, dma_stress_src, dma_stress_dst,
+                                   DMA_STRESS_BYTES);
+}
+
+void Dma_StressTest(uint16_t frames)
+{
+    neo_tx_stats_t st;
+
+    /* Software trigger, one whole 16-beat-burst block per trigger, words */
+    DMAC_ChannelDisable(DMA_STRESS_CHANNEL);
+    DMAC_REGS->CHANNEL[DMA_STRESS_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGACT(3U) | DMAC_CHCTRLA_TRIGSRC(0U) | DMAC_CHCTRLA_BURSTLEN(15U);
+    (void)DMAC_ChannelSettingsSet(DMA_STRESS_CHANNEL,
+                                  DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_WORD
+                                  | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk
+                                  | DMAC_BTCTRL_DSTINC_Msk);
+    Dma_Assign(DMA_STRESS_CHANNEL, DMA_CLASS_BULK);
+    DMAC_ChannelCallbackRegister(DMA_STRESS_CHANNEL, Dma_StressCallback, 0u);
+
+    NeoPixel_ResetStats();
+    dma_stress_blocks = 0u;
+    dma_stress_run    = true;
+    (void)DMAC_ChannelTransfer(DMA_STRESS_CHANNEL, dma_stress_src, dma_stress_dst,
+                               DMA_STRESS_BYTES);
+
+    TickType_t t0 = xTaskGetTickCount();
+
+    for (uint16_t f = 0; f < frames; f++)
+    {
+        NeoPixel_SetPixel(0u, (uint8_t)f, 0u, 0u);      /* never an unchanged frame */
+        NeoPixel_Show();
+    }
+    NeoPixel_Wait();
+
+    TickType_t ms = (xTaskGetTickCount() - t0) * portTICK_PERIOD_MS;
+
+    dma_stress_run = false;
+    DMAC_ChannelDisable(DMA_STRESS_CHANNEL);
+    NeoPixel_GetStats(&st);
+
+    printf("dma stress: %u frames in %lu ms, bulk %lu KiB/s\n", (unsigned)frames, (unsigned long)ms,
+           (unsigned long)((uint64_t)dma_stress_blocks * DMA_STRESS_BYTES / 1024u * 1000u
+                           / ((ms != 0u) ? ms : 1u)));
+    printf("  dma_errors %lu  spi_errors %lu  timeouts %lu  late %lu  -> %s\n",
+           (unsigned long)st.dma_errors, (unsigned long)st.spi_errors,
+           (unsigned long)st.timeouts, (unsigned long)st.late,
+           (st.dma_errors | st.spi_errors | st.timeouts | st.late) == 0u ? "PASS" : "FAIL");
+}
+
+#endif /* DMA_STRESS_ENABLE */
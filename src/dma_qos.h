@@ -0,0 +1,118 @@
+/* =============================================================================
+ * dma_qos.h  -  DMAC priority levels and bus QoS per DMA client
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * MCC leaves every channel at priority level 0 with round-robin arbitration
+ * on all levels, so an LED stream competes on equal terms with any bulk
+ * transfer and can be starved mid-frame (the WS2812 then latches early).
+ *
+ * Each client instead declares a class, which is its DMAC priority level:
+ *
+ *   REALTIME  3  LED streams, audio     static priority, QoS latency critical
+ *   STREAM    2  ADC / sensor capture   static priority, QoS latency sensitive
+ *   COMMS     1  USART / SPI peripherals round robin,   QoS bandwidth shortage
+ *   BULK      0  logging, memory copies round robin,    QoS regular
+ *
+ * A pending request on a higher level always wins the next arbitration,
+ * and the level's QoS is what the DMAC presents to the bus matrix against
+ * the CPU. Within the two top levels the lowest channel number wins, so
+ * the order is fixed; the lower levels share fairly.
+ *
+ * Channels DMA_OTHER_FIRST and up are outside the MCC configuration (its
+ * plib only knows DMAC_CHANNEL_0-3) and are programmed by their clients
+ * directly; they share the DMAC_OTHER interrupt, which this module owns
+ * and hands to the callback each client registers; the handler walks only
+ * the channels DMAC_INTSTATUS shows pending:
+ *
+ *   4  audio.c   ADC1 microphone ring
+ *   5  sound.c   DAC playback ring
+ *   6  qflash.c  QSPI flash to RAM copies
+ *   7  dmx.c     DMX512 USART receive
+ *   8  pixdist.c pixel link to or from the other boards
+ *   9  crc.c     memory into the CRC engine (bulk checks)
+ *  10  dmamem.c  memory copies and fills, two channels
+ *  11
+ *  12  statusled.c status LED pattern on the TCC3 overflow
+ *  13  railmon.c ADC0 input sequence and results, two channels
+ *  14
+ *  15  ioseq.c   auxiliary output toggles and step lengths on the TCC4
+ *                overflow, two channels
+ *  17  netbridge.c network co-processor link receive and transmit, two
+ *                channels
+ *  19  stepper.c stepper lid periods on the TCC0 overflow
+ *  20  i2c_bus.c I2C read phases (sercom.h)
+ *
+ * The vectors of the plib's own channels 0-3 are this module's too,
+ * DMAC_0_Handler to DMAC_3_Handler (the MCC NVIC settings point them here):
+ * they count and trace the interrupt and call the plib's handler, so the
+ * generated plib_dmac.c is left as MCC writes it. A streaming client that
+ * takes an interrupt per chunk (the NeoPixel refills with NEO_STREAMING)
+ * registers a fast handler instead of a callback, Dma_FastRegister(): it
+ * gets the channel's flags, cleared, and by-passes the plib's channel
+ * object, event and context. It ends its transfers with
+ * DMAC_ChannelDisable(), which resets the plib's busy state.
+ *
+ * With DMA_STRESS_ENABLE, Dma_StressTest() keeps a BULK memory-to-memory
+ * channel saturating the bus while the NeoPixel driver sends frames, and it
+ * reports the driver's error, timeout and late-frame counters.
+ * ============================================================================= */
+
+#ifndef DMA_QOS_H
+#define DMA_QOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define DMA_STRESS_ENABLE   0           /* 1 = build Dma_StressTest()           */
+#define DMA_STRESS_CHANNEL  DMAC_CHANNEL_3  /* spare MCC channel, reprogrammed  */
+#define DMA_STRESS_BYTES    4096u       /* bytes per memory-to-memory block     */
+#define DMA_STRESS_FRAMES   500u        /* frames sent under load               */
+#define DMA_OTHER_FIRST     4u          /* first channel the plib does not own  */
+#define DMA_OTHER_COUNT     17u         /* descriptor slots, ATSAME51J20A.ld    */
+#define DMA_OTHER_PRIO      IRQ_PRIO_DMA_OTHER  /* NVIC, irqprio.h          */
+
+typedef enum
+{
+    DMA_CLASS_BULK = 0,
+    DMA_CLASS_COMMS,
+    DMA_CLASS_STREAM,
+    DMA_CLASS_REALTIME,
+    DMA_CLASS_COUNT
+} dma_class_t;
+
+/** Channel interrupt of a DMA_OTHER or fast channel: its CHINTFLAG bits, already cleared. ISR. */
+typedef void (*dma_other_fn)(uint8_t flags);
+
+/** Program level arbitration and QoS. Call after SYS_Initialize(), before any Dma_Assign(). */
+void Dma_Init(void);
+
+/** Put a channel on its class's priority level. Call while the channel is idle. */
+void Dma_Assign(DMAC_CHANNEL ch, dma_class_t cls);
+
+/**
+ * Route the interrupt of channel `ch` (DMA_OTHER_FIRST and up) to `fn` and
+ * enable DMAC_OTHER. Before the channel's interrupts are enabled; false if
+ * `ch` is not one of them.
+ */
+bool Dma_OtherRegister(uint8_t ch, dma_other_fn fn);
+
+/**
+ * Route the interrupt of plib channel `ch` (below DMA_OTHER_FIRST) to `fn`
+ * instead of the plib's callback; NULL hands it back. While the channel's
+ * interrupts are off.
+ */
+void Dma_FastRegister(DMAC_CHANNEL ch, dma_other_fn fn);
+
+#if DMA_STRESS_ENABLE
+/**
+ * Send `frames` NeoPixel frames while DMA_STRESS_CHANNEL copies memory
+ * back to back, then print the transfer counters and PASS/FAIL to stdout.
+ * Call from the task that owns the NeoPixel driver.
+ */
+void Dma_StressTest(uint16_t frames);
+#endif
+
+#endif /* DMA_QOS_H */
@@ -0,0 +1,233 @@
+/* =============================================================================
+ * dmamem.c  -  Memory copy and fill on spare DMAC channels, asynchronously
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "dmamem.h"
+#include "definitions.h"        /* DMAC_REGS, dmac_descriptor_registers_t */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dma_qos.h"
+#include "log.h"
+#include <string.h>
+
+#define DMAMEM_MAX_BEATS    0xFFFFu             /* BTCNT */
+
+#if (DMAMEM_BURST & (DMAMEM_BURST - 1u)) != 0u || DMAMEM_BURST > 16u
+#error "DMAMEM_BURST must be 1, 2, 4, 8 or 16 beats"
+#endif
+#if DMAMEM_CHANNEL_FIRST < DMA_OTHER_FIRST || DMAMEM_CHANNEL_FIRST + DMAMEM_CHANNELS > DMA_OTHER_FIRST + DMA_OTHER_COUNT
+#error "DMAMEM channels must be DMA_OTHER channels with a descriptor slot (dma_qos.h)"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* One per channel; kept until DmaMem_Wait() so the CPU can redo a failed one */
+typedef struct
+{
+    uint8_t          *dst;
+    const uint8_t    *src;              /* NULL: a fill of `pattern` */
+    uint32_t          bytes;            /* the DMA's part only */
+    uint32_t          pattern;          /* fill source, read by the channel */
+    TaskHandle_t      waiter;
+    bool              used;
+    volatile bool     done;
+    volatile uint8_t  flags;
+} dmamem_job_t;
+
+static dmamem_job_t      dmamem_job[DMAMEM_CHANNELS];
+static volatile uint32_t dmamem_errors;
+
+/* -- DMA --------------------------------------------------------------------- */
+
+/* Block done or failed (dma_qos.c DMAC_OTHER dispatch) */
+static void dmamem_isr(dmamem_job_t *j, uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    j->flags = flags;
+    j->done  = true;
+    vTaskNotifyGiveIndexedFromISR(j->waiter, DMAMEM_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void dmamem_isr0(uint8_t flags) { dmamem_isr(&dmamem_job[0], flags); }
+#if DMAMEM_CHANNELS > 1u
+static void dmamem_isr1(uint8_t flags) { dmamem_isr(&dmamem_job[1], flags); }
+#endif
+#if DMAMEM_CHANNELS > 2u
+#error "DMAMEM_CHANNELS: add an ISR entry per channel"
+#endif
+
+static void dmamem_cpu(const dmamem_job_t *j)
+{
+    if (j->src != NULL)
+    {
+        memcpy(j->dst, j->src, j->bytes);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < j->bytes; i += 4u)
+            *(uint32_t *)(j->dst + i) = j->pattern;
+    }
+}
+
+/* A free channel's job, claimed; NULL when all are in flight */
+static dmamem_job_t *dmamem_claim(void)
+{
+    dmamem_job_t *j = NULL;
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < DMAMEM_CHANNELS && j == NULL; i++)
+    {
+        if (!dmamem_job[i].used)
+        {
+            j = &dmamem_job[i];
+            j->used = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return j;
+}
+
+/*
+ * Move `bytes` (whole beats of `beat` bytes) on a channel, or on the CPU if
+ * none is free or the run is short. Fills always use word beats.
+ */
+static dmamem_t dmamem_start(uint8_t *dst, const uint8_t *src, uint32_t pattern,
+                             uint32_t bytes, uint32_t beat)
+{
+    dmamem_job_t  tmp = { .dst = dst, .src = src, .bytes = bytes, .pattern = pattern };
+    dmamem_job_t *j   = NULL;
+
+    if (bytes >= DMAMEM_MIN_BYTES && bytes / beat <= DMAMEM_MAX_BEATS &&
+        xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        j = dmamem_claim();
+    if (j == NULL)
+    {
+        dmamem_cpu(&tmp);
+        return DMAMEM_DONE;
+    }
+
+    uint8_t ch = (uint8_t)(DMAMEM_CHANNEL_FIRST + (uint32_t)(j - dmamem_job));
+    dmac_descriptor_registers_t *d = (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + ch;
+    uint32_t size = (beat == 4u) ? DMAC_BTCTRL_BEATSIZE_WORD
+                  : (beat == 2u) ? DMAC_BTCTRL_BEATSIZE_HWORD : DMAC_BTCTRL_BEATSIZE_BYTE;
+
+    j->dst     = dst;
+    j->src     = src;
+    j->bytes   = bytes;
+    j->pattern = pattern;
+    j->waiter  = xTaskGetCurrentTaskHandle();
+    j->flags   = 0u;
+    j->done    = false;
+
+    d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_DSTINC_Msk | size | DMAC_BTCTRL_BLOCKACT_INT
+                     | ((src != NULL) ? DMAC_BTCTRL_SRCINC_Msk : 0u);
+    d->DMAC_BTCNT    = (uint16_t)(bytes / beat);
+    d->DMAC_SRCADDR  = (src != NULL) ? (uint32_t)src + bytes : (uint32_t)&j->pattern;  /* end address with increment */
+    d->DMAC_DSTADDR  = (uint32_t)dst + bytes;
+    d->DMAC_DESCADDR = 0u;
+
+    DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    DMAC_REGS->DMAC_SWTRIGCTRL = DMAC_SWTRIGCTRL_SWTRIG0_Msk << ch;
+    return (dmamem_t)(j - dmamem_job);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void DmaMem_Init(void)
+{
+    static const dma_other_fn isr[DMAMEM_CHANNELS] =
+    {
+        dmamem_isr0,
+#if DMAMEM_CHANNELS > 1u
+        dmamem_isr1,
+#endif
+    };
+
+    for (uint32_t i = 0; i < DMAMEM_CHANNELS; i++)
+    {
+        uint8_t ch = (uint8_t)(DMAMEM_CHANNEL_FIRST + i);
+
+        DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA =
+            DMAC_CHCTRLA_TRIGSRC(0u) | DMAC_CHCTRLA_TRIGACT_BLOCK | DMAC_CHCTRLA_BURSTLEN(DMAMEM_BURST - 1u);
+        Dma_Assign((DMAC_CHANNEL)ch, DMA_CLASS_BULK);
+        (void)Dma_OtherRegister(ch, isr[i]);
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk | DMAC_CHINTENSET_TERR_Msk;
+    }
+}
+
+dmamem_t DmaMem_Copy(void *dst, const void *src, uint32_t len)
+{
+    uint32_t align = (uint32_t)dst | (uint32_t)src;
+    uint32_t beat  = ((align & 3u) == 0u) ? 4u : ((align & 1u) == 0u) ? 2u : 1u;
+    uint32_t tail  = len & (beat - 1u);
+
+    memcpy((uint8_t *)dst + len - tail, (const uint8_t *)src + len - tail, tail);
+    return dmamem_start(dst, src, 0u, len - tail, beat);
+}
+
+dmamem_t DmaMem_Fill(void *dst, uint8_t value, uint32_t len)
+{
+    uint8_t *p    = dst;
+    uint32_t head = (4u - ((uint32_t)p & 3u)) & 3u;
+
+    if (head > len) head = len;
+    memset(p, value, head);
+    p   += head;
+    len -= head;
+    memset(p + (len & ~3u), value, len & 3u);
+    return dmamem_start(p, NULL, value * 0x01010101u, len & ~3u, 4u);
+}
+
+dmamem_t DmaMem_Fill32(uint32_t *dst, uint32_t pattern, uint32_t words)
+{
+    return dmamem_start((uint8_t *)dst, NULL, pattern, words * 4u, 4u);
+}
+
+bool DmaMem_Busy(dmamem_t t)
+{
+    return t < DMAMEM_CHANNELS && !dmamem_job[t].done;
+}
+
+bool DmaMem_Wait(dmamem_t t)
+{
+    if (t >= DMAMEM_CHANNELS) return true;
+
+    dmamem_job_t *j  = &dmamem_job[t];
+    uint8_t       ch = (uint8_t)(DMAMEM_CHANNEL_FIRST + t);
+    TickType_t    t0 = xTaskGetTickCount();
+    bool          ok;
+
+    configASSERT(j->used && j->waiter == xTaskGetCurrentTaskHandle());
+
+    /* The give may be another channel's: check this one's flag every wake */
+    while (!j->done)
+    {
+        TickType_t gone = xTaskGetTickCount() - t0;
+
+        if (gone >= pdMS_TO_TICKS(DMAMEM_TIMEOUT_MS) ||
+            ulTaskNotifyTakeIndexed(DMAMEM_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(DMAMEM_TIMEOUT_MS) - gone) == 0u)
+            break;
+    }
+
+    ok = j->done && (j->flags & DMAC_CHINTFLAG_TERR_Msk) == 0u;
+    if (!ok)
+    {
+        DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+        while ((DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u) {}
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = DMAC_CHINTFLAG_TCMPL_Msk | DMAC_CHINTFLAG_TERR_Msk;
+        dmamem_cpu(j);
+        dmamem_errors++;
+        LOG_WARN("dmamem: channel %u %s, %lu bytes redone", (unsigned)ch,
+                 j->done ? "error" : "timeout", (unsigned long)j->bytes);
+    }
+    j->used = false;
+    return ok;
+}
+
+uint32_t DmaMem_Errors(void)
+{
+    return dmamem_errors;
+}
@@ -0,0 +1,72 @@
+/* =============================================================================
+ * dmamem.h  -  Memory copy and fill on spare DMAC channels, asynchronously
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Clearing a buffer or copying a frame costs the CPU one bus cycle per
+ * word; the DMAC does the same in bursts while the CPU renders the next
+ * layer. DMAMEM_CHANNELS channels from DMAMEM_CHANNEL_FIRST (DMA_OTHER
+ * channels, dma_qos.h) are kept for it, software triggered, one block of
+ * DMAMEM_BURST-beat bursts per request, on the BULK level: the LED and
+ * audio streams always win the bus from them.
+ *
+ *     dmamem_t t = DmaMem_Fill32(fx_px, 0u, n);    start clearing
+ *     ... render into other buffers ...
+ *     DmaMem_Wait(t);                              sleep until it is done
+ *
+ * A request returns a handle, which the task that made it waits for
+ * exactly once; the channel is free again after that. When no channel is
+ * free, the run is shorter than DMAMEM_MIN_BYTES (the CPU is done
+ * before the DMAC is set up), the scheduler is not running, or the run is
+ * too long for one block, the CPU does the work before returning and the
+ * handle is DMAMEM_DONE. Bytes that do not fill a whole beat (unaligned
+ * heads and tails) are always done by the CPU, before the request returns.
+ *
+ * A DMA error or a transfer past DMAMEM_TIMEOUT_MS is redone by the CPU in
+ * DmaMem_Wait() and counted: the buffer is always right once it returns.
+ * The CMCC caches no data (cache.h), so there is nothing to flush.
+ * ============================================================================= */
+
+#ifndef DMAMEM_H
+#define DMAMEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define DMAMEM_CHANNEL_FIRST    10u     /* DMA_OTHER channels, dma_qos.h           */
+#define DMAMEM_CHANNELS         2u      /* transfers in flight at once             */
+#define DMAMEM_BURST            16u     /* beats per burst: 1, 2, 4, 8 or 16       */
+#define DMAMEM_MIN_BYTES        256u    /* shorter runs go to the CPU              */
+#define DMAMEM_NOTIFY_INDEX     4u      /* 0: NeoPixel, 1: effects, 2: I2C, 3: qflash */
+#define DMAMEM_TIMEOUT_MS       50u     /* per transfer: 256 KB take ~4 ms, ~8x at a divided clock */
+
+#define DMAMEM_DONE             0xFFu   /* no transfer in flight                   */
+
+/** A transfer in flight, or DMAMEM_DONE. */
+typedef uint8_t dmamem_t;
+
+/** Set up the channels. After Dma_Init(), before the scheduler. */
+void DmaMem_Init(void);
+
+/** Start copying `len` bytes; the regions must not overlap. Tasks only. */
+dmamem_t DmaMem_Copy(void *dst, const void *src, uint32_t len);
+
+/** Start setting `len` bytes to `value`, as memset(). Tasks only. */
+dmamem_t DmaMem_Fill(void *dst, uint8_t value, uint32_t len);
+
+/** Start setting `words` 32-bit words (pix_t, 4-aligned) to `pattern`. Tasks only. */
+dmamem_t DmaMem_Fill32(uint32_t *dst, uint32_t pattern, uint32_t words);
+
+/** True while `t` is still running. */
+bool DmaMem_Busy(dmamem_t t);
+
+/**
+ * Sleep until `t` is done; DMAMEM_DONE returns at once. From the task that
+ * started it. False if the DMAC failed and the CPU did the work instead.
+ */
+bool DmaMem_Wait(dmamem_t t);
+
+/** Transfers redone by the CPU since boot. */
+uint32_t DmaMem_Errors(void);
+
+#endif /* DMAMEM_H */
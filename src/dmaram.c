@@ -0,0 +1,135 @@
+/* =============================================================================
+ * dmaram.c  -  DMA buffers in their own SRAM range, apart from the CPU's data
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "dmaram.h"
+
+/* Linker script (ATSAME51J20A.ld) */
+extern const uint8_t __dma_ram_start[];
+extern const uint8_t __dma_ram_end[];
+extern const uint8_t __dma_ram_limit[];
+
+#if DMARAM_BENCH_ENABLE
+
+#include "definitions.h"        /* core_cm4.h: DWT */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dmamem.h"
+#include "cpufreq.h"
+#include <string.h>
+
+#define DR_NOW()            (DWT->CYCCNT)
+#define DR_WORDS            (DMARAM_BENCH_BYTES / 4u)
+#define DR_CPU_WORDS        (DMARAM_BENCH_CPU_BYTES / 4u)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const char * const dr_name[DMARAM_BENCH_ROWS] =
+{
+    "cpu idle", "cpu split", "dma idle", "dma shared"
+};
+
+static uint32_t dr_src[DR_WORDS] DMA_RAM;           /* the DMAC's copy */
+static uint32_t dr_dst[DR_WORDS] DMA_RAM;
+static uint32_t dr_cpu_dma[DR_CPU_WORDS] DMA_RAM;   /* the CPU's pass, in ram_dma */
+static uint32_t dr_cpu[DR_CPU_WORDS];               /* and in ram, next to the stacks */
+
+/* Load, modify, store every word: as many accesses as a render pass makes */
+static uint32_t __attribute__((noinline)) dr_pass(uint32_t *p)
+{
+    uint32_t t0 = DR_NOW();
+
+    for (uint32_t i = 0; i < DR_CPU_WORDS; i++)
+        p[i] = p[i] * 3u + 1u;
+    return DR_NOW() - t0;
+}
+
+static void dr_row(dmaram_bench_result_t *out, uint32_t *cpu, bool dma)
+{
+    uint64_t sum = 0u, dma_sum = 0u;
+
+    out->min = UINT32_MAX;
+    for (uint32_t r = 0; r < DMARAM_BENCH_ROUNDS; r++)
+    {
+        dmamem_t t  = DMAMEM_DONE;
+        uint32_t t0 = DR_NOW(), c;
+        bool     outlasted;
+
+        if (dma)
+        {
+            t = DmaMem_Copy(dr_dst, dr_src, sizeof(dr_src));
+            if (t == DMAMEM_DONE) continue;         /* no channel: the CPU copied */
+        }
+
+        taskENTER_CRITICAL();
+        c = dr_pass(cpu);
+        taskEXIT_CRITICAL();
+
+        outlasted = DmaMem_Busy(t);
+        while (DmaMem_Busy(t)) {}
+        if (dma)
+        {
+            uint32_t d = DR_NOW() - t0;
+
+            (void)DmaMem_Wait(t);
+            if (!outlasted) continue;               /* the pass ran past the copy */
+            dma_sum += d;
+        }
+
+        out->n++;
+        sum += c;
+        if (c < out->min) out->min = c;
+        if (c > out->max) out->max = c;
+    }
+
+    if (out->n == 0u)
+    {
+        out->min = 0u;
+        return;
+    }
+    out->avg     = (uint32_t)(sum / out->n);
+    out->dma_avg = (uint32_t)(dma_sum / out->n);
+}
+
+#endif /* DMARAM_BENCH_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool DmaRam_In(const void *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+
+    return b >= __dma_ram_start && b < __dma_ram_limit;
+}
+
+uint32_t DmaRam_Used(void)
+{
+    return (uint32_t)(__dma_ram_end - __dma_ram_start);
+}
+
+uint32_t DmaRam_Size(void)
+{
+    return (uint32_t)(__dma_ram_limit - __dma_ram_start);
+}
+
+#if DMARAM_BENCH_ENABLE
+
+void DmaRam_Benchmark(dmaram_bench_result_t out[DMARAM_BENCH_ROWS])
+{
+    memset(out, 0, DMARAM_BENCH_ROWS * sizeof(out[0]));
+
+    CpuFreq_Hold();                                 /* cycles at 120 MHz throughout */
+    dr_row(&out[DMARAM_BENCH_CPU_IDLE],   dr_cpu,     false);
+    dr_row(&out[DMARAM_BENCH_CPU_SPLIT],  dr_cpu,     true);
+    dr_row(&out[DMARAM_BENCH_DMA_IDLE],   dr_cpu_dma, false);
+    dr_row(&out[DMARAM_BENCH_DMA_SHARED], dr_cpu_dma, true);
+    CpuFreq_Release();
+}
+
+const char *DmaRam_BenchName(dmaram_bench_row_t r)
+{
+    return ((uint32_t)r < DMARAM_BENCH_ROWS) ? dr_name[r] : "?";
+}
+
+#endif /* DMARAM_BENCH_ENABLE */
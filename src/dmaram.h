@@ -0,0 +1,92 @@
+/* =============================================================================
+ * dmaram.h  -  DMA buffers in their own SRAM range, apart from the CPU's data
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The XC32 best-fit allocator packs .data and .bss from the bottom of the
+ * SRAM in whatever order fits, so a WS2812 frame the DMAC streams out can
+ * sit between two task stacks and the effect state the renderer works on.
+ * The SRAM is reached by several bus matrix masters (CPU, DMAC, USB,
+ * SDHC) through its AHB slave ports, and a master waits whenever another
+ * holds the part of the SRAM it needs. Keeping the two kinds of traffic
+ * in separate ranges lets them proceed side by side as far as the SRAM
+ * allows; how far that is, the benchmark below measures.
+ *
+ * The linker script (ATSAME51J20A.ld) therefore splits the SRAM:
+ *
+ *   ram        0x20000000 up: .data, .bss, the stacks, the heap: the CPU
+ *   ram_dma    DMARAM_LENGTH (64 KB) below the RTT block: every object
+ *              tagged DMA_RAM, in the .dma_ram output section
+ *
+ * ram_dma has no attributes, so the allocator places nothing there that
+ * is not tagged. The section is NOLOAD and zeroed by Reset_Handler before
+ * .data; a DMA_RAM object cannot have an initialiser. The section opens
+ * with the DMAC descriptors and write-back, the plib's tables placed by
+ * the linker script; tagged are the buffers the DMAC and
+ * USB stream from or into: the LED frames and descriptors, the audio and
+ * sound rings, DMX, the pixel link, the status LED, output sequencer and
+ * rail monitor words, the SD ADMA table and the USB endpoint buffers.
+ * Buffers the CPU mostly works on (the 16-bit strip, the FFT) stay in ram.
+ * Overflowing ram_dma is a link error; "mem" prints its use.
+ *
+ * DmaRam_Benchmark() measures what it is worth on this board: a CPU
+ * read-modify-write pass over DMARAM_BENCH_CPU_BYTES while a DMAMEM copy
+ * of DMARAM_BENCH_BYTES runs inside ram_dma, with the CPU's buffer in ram
+ * and in ram_dma, against the same passes with the DMAC idle. "dmabench"
+ * on the console prints the table.
+ * ============================================================================= */
+
+#ifndef DMARAM_H
+#define DMARAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef DMARAM_BENCH_ENABLE
+#define DMARAM_BENCH_ENABLE     0       /* 1 = build the contention benchmark in   */
+#endif
+#define DMARAM_BENCH_ROUNDS     200u    /* passes per row                          */
+#define DMARAM_BENCH_BYTES      8192u   /* DMAC copy per pass, outlasts the CPU's  */
+#define DMARAM_BENCH_CPU_BYTES  1024u   /* CPU read-modify-write per pass          */
+
+/* Link into ram_dma; zero-initialised objects only */
+#define DMA_RAM                 __attribute__((section(".dma_ram")))
+
+typedef enum
+{
+    DMARAM_BENCH_CPU_IDLE = 0,  /* CPU buffer in ram,     DMAC idle          */
+    DMARAM_BENCH_CPU_SPLIT,     /* CPU buffer in ram,     DMAC in ram_dma    */
+    DMARAM_BENCH_DMA_IDLE,      /* CPU buffer in ram_dma, DMAC idle          */
+    DMARAM_BENCH_DMA_SHARED,    /* CPU buffer in ram_dma, DMAC in ram_dma    */
+    DMARAM_BENCH_ROWS
+} dmaram_bench_row_t;
+
+typedef struct
+{
+    uint32_t n;                 /* passes; with the DMAC, only those it outlasted */
+    uint32_t min;               /* CPU pass, cycles */
+    uint32_t avg;
+    uint32_t max;
+    uint32_t dma_avg;           /* the DMAC copy, start to seen done; 0 idle */
+} dmaram_bench_result_t;
+
+/** True if `p` is in ram_dma. */
+bool DmaRam_In(const void *p);
+
+/** Bytes of ram_dma in use, and its size. */
+uint32_t DmaRam_Used(void);
+uint32_t DmaRam_Size(void);
+
+#if DMARAM_BENCH_ENABLE
+/**
+ * Run every row into `out`; about a hundred milliseconds, interrupts
+ * masked during each CPU pass. From a task, with DMAMEM channels free
+ * (passes the CPU had to copy itself are not counted).
+ */
+void DmaRam_Benchmark(dmaram_bench_result_t out[DMARAM_BENCH_ROWS]);
+
+/** Console name of row `r`. */
+const char *DmaRam_BenchName(dmaram_bench_row_t r);
+#endif
+
+#endif /* DMARAM_H */
@@ -0,0 +1,219 @@
+/* =============================================================================
+ * dmx.c  -  DMX512 receiver: a lighting console drives the LEDs
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "dmx.h"
+#include "definitions.h"        /* SERCOM0, DMAC, __ALIGNED */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "effects.h"
+#include "neopixel.h"
+#include "pixdist.h"
+#include "cli.h"
+#include "cache.h"            /* CACHE_HOT */
+#include "irqstat.h"
+#include "sercom.h"
+
+#if DMX_ENABLE && ((NEO_BACKEND == NEO_BACKEND_CCL) || (NEO_OUTPUTS > 2u))
+#error "DMX_ENABLE needs SERCOM0 / PA04, which the NeoPixel CCL backend and output 2 use"
+#endif
+
+#define DMX_BUF             (1u + DMX_SLOTS)    /* start code + slots */
+#define DMX_BAUD_HZ         250000u
+#define DMX_GCLK_HZ         48000000u           /* GCLK3 */
+#define DMX_SERCOM          0u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t dmx_packets;
+static volatile uint32_t dmx_dropped;
+static volatile uint32_t dmx_overruns;
+
+#if DMX_ENABLE
+
+static uint16_t dmx_addr  = 1u;                 /* first slot of LED 0, 1-based */
+static uint16_t dmx_group = 1u;                 /* LEDs per 3-slot cell         */
+
+/* Triple buffer: DMAC writes dmx_w, dmx_ready holds the newest packet, the renderer reads dmx_rd */
+static uint8_t  dmx_buf[3][DMX_BUF] DMA_RAM __ALIGNED(4);
+static uint16_t dmx_len[3];                     /* bytes, start code included */
+static uint8_t  dmx_w = 0u, dmx_ready = 1u, dmx_rd = 2u;
+static volatile bool dmx_fresh;
+static uint16_t dmx_rd_len;                     /* renderer's copy of dmx_len[dmx_rd] */
+
+static volatile TickType_t dmx_last;            /* tick of the latest packet */
+static volatile bool       dmx_seen;            /* any packet since boot    */
+
+static const cli_param_t dmx_params[] =
+{
+    { "dmx_addr",  &dmx_addr,  CLI_U16, 1u, DMX_SLOTS, NULL, "DMX slot of LED 0's red, 1-based" },
+    { "dmx_group", &dmx_group, CLI_U16, 1u, PIXDIST_SCENE_LEDS, NULL, "LEDs per DMX RGB cell" },
+};
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* Capture the next packet into dmx_buf[dmx_w] */
+static void dmx_arm(void)
+{
+    Sercom_DmaStart(DMX_SERCOM, SERCOM_DMA_RX, DMX_DMA_CHANNEL, dmx_buf[dmx_w], DMX_BUF);
+}
+
+/* Stop the capture; bytes it took */
+static uint32_t dmx_stop(void)
+{
+    return DMX_BUF - Sercom_DmaStop(DMX_DMA_CHANNEL);
+}
+
+/* Frame error = break: the bytes before it are one packet */
+static void dmx_isr(void)
+{
+    uint16_t   status = SERCOM0_REGS->USART_INT.SERCOM_STATUS;
+    uint32_t   n;
+
+    SERCOM0_REGS->USART_INT.SERCOM_STATUS  = status;
+    SERCOM0_REGS->USART_INT.SERCOM_INTFLAG = SERCOM_USART_INT_INTFLAG_ERROR_Msk;
+    if ((status & SERCOM_USART_INT_STATUS_BUFOVF_Msk) != 0u) dmx_overruns++;
+    if ((status & SERCOM_USART_INT_STATUS_FERR_Msk) == 0u) return;
+
+    n = dmx_stop();
+    if ((SERCOM0_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_RXC_Msk) != 0u)
+        (void)SERCOM0_REGS->USART_INT.SERCOM_DATA;          /* the break byte, not taken */
+    else if (n != 0u)
+        n--;                                                /* the DMAC took it last     */
+
+    if (n >= 2u && dmx_buf[dmx_w][0] == DMX_START_CODE)
+    {
+        TickType_t now  = xTaskGetTickCountFromISR();
+        bool       lost = !dmx_seen || (now - dmx_last) >= pdMS_TO_TICKS(DMX_LOSS_MS);
+        uint8_t    t    = dmx_ready;
+
+        dmx_len[dmx_w] = (uint16_t)n;
+        dmx_ready = dmx_w;
+        dmx_w     = t;
+        dmx_fresh = true;
+        dmx_last  = now;
+        dmx_seen  = true;
+        dmx_packets++;
+        dmx_arm();
+
+        if (DMX_AUTO_SELECT && lost)
+        {
+            const effect_cmd_t cmd = { EFFECT_CMD_SELECT, 0u, EFFECT_DMX, 0u, 0u, 0u };
+
+            if (Effects_PostFromISR(&cmd)) return;
+        }
+        Effects_WakeFromISR();
+        return;
+    }
+    if (n != 0u) dmx_dropped++;
+    dmx_arm();
+}
+
+static void dmx_irq(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_DMX);
+    dmx_isr();
+    IRQSTAT_EXIT(IRQSTAT_DMX);
+}
+
+static void dmx_hw_init(void)
+{
+    /* 8N2, LSB first, receive only */
+    static const sercom_cfg_t usart =
+    {
+        SERCOM_USART, 3u, 0u, 0u, SERCOM_F_RX | SERCOM_F_STOP2,
+        SERCOM_USART_BAUD(DMX_GCLK_HZ, DMX_BAUD_HZ), 0u
+    };
+
+    Sercom_Open(DMX_SERCOM, &usart);
+
+    /* PA04 -> peripheral D (SERCOM0 PAD0), pulled up so an open line reads idle */
+    PORT_REGS->GROUP[0].PORT_PMUX[4u >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[4u >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(3u));
+    PORT_REGS->GROUP[0].PORT_OUTSET = 1u << 4;
+    PORT_REGS->GROUP[0].PORT_PINCFG[4] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_PULLEN_Msk;
+
+    SERCOM0_REGS->USART_INT.SERCOM_INTENSET = SERCOM_USART_INT_INTENSET_ERROR_Msk;
+
+    (void)Sercom_DmaAttach(DMX_SERCOM, SERCOM_DMA_RX, DMX_DMA_CHANNEL, DMA_CLASS_COMMS, NULL);
+    dmx_arm();
+
+    Sercom_Enable(DMX_SERCOM);
+    (void)Sercom_Irq(DMX_SERCOM, dmx_irq, DMX_IRQ_PRIO);
+}
+
+#endif /* DMX_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Dmx_Start(void)
+{
+#if DMX_ENABLE
+    for (uint32_t i = 0; i < sizeof(dmx_params) / sizeof(dmx_params[0]); i++)
+        (void)Cli_Register(&dmx_params[i]);
+    dmx_hw_init();
+#endif
+}
+
+void Dmx_GetStats(dmx_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    out->packets  = dmx_packets;
+    out->dropped  = dmx_dropped;
+    out->overruns = dmx_overruns;
+#if DMX_ENABLE
+    out->slots    = dmx_seen ? (uint16_t)(dmx_len[dmx_ready] - 1u) : 0u;
+    out->present  = dmx_seen && (xTaskGetTickCount() - dmx_last) < pdMS_TO_TICKS(DMX_LOSS_MS);
+#else
+    out->slots    = 0u;
+    out->present  = false;
+#endif
+    taskEXIT_CRITICAL();
+}
+
+uint32_t Dmx_Packets(void)
+{
+    return dmx_packets;
+}
+
+bool Dmx_Update(uint8_t steps)
+{
+    (void)steps;
+#if DMX_ENABLE
+    bool fresh;
+
+    taskENTER_CRITICAL();
+    fresh = dmx_fresh;
+    if (fresh)
+    {
+        uint8_t t = dmx_rd;
+
+        dmx_rd    = dmx_ready;
+        dmx_ready = t;
+        dmx_fresh = false;
+    }
+    taskEXIT_CRITICAL();
+    dmx_rd_len = dmx_len[dmx_rd];
+    return fresh;
+#else
+    return false;
+#endif
+}
+
+pix_t CACHE_HOT Dmx_Pixel(uint16_t i, uint8_t offset)
+{
+    (void)offset;
+#if DMX_ENABLE
+    const uint8_t *u = dmx_buf[dmx_rd];
+    uint32_t slot = dmx_addr + (uint32_t)(i / dmx_group) * 3u;
+
+    if (slot + 2u >= dmx_rd_len) return Pix_Make(0u, 0u, 0u);
+    return Pix_Make(u[slot], u[slot + 1u], u[slot + 2u]);
+#else
+    (void)i;
+    return Pix_Make(0u, 0u, 0u);
+#endif
+}
@@ -0,0 +1,81 @@
+/* =============================================================================
+ * dmx.h  -  DMX512 receiver: a lighting console drives the LEDs
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * An RS-485 receiver (MAX3485 / SN75176 style, RO pin) on SERCOM0 PAD0,
+ * PA04, peripheral D. SERCOM0 runs as a receive-only USART at 250 kbit/s,
+ * 8N2, from GCLK3 48 MHz.
+ *
+ * A DMX packet is a break (line low >= 88 us), a start code and up to 512
+ * slots. The break arrives as a frame error on a 0x00 byte, the only
+ * interrupt this module takes: it ends the packet in flight and re-arms
+ * the DMA channel for the next one. Slots themselves go from the USART to
+ * RAM by the DMAC (DMX_DMA_CHANNEL, COMMS class), one beat per byte, so a
+ * full universe costs one interrupt per packet and no CPU per slot.
+ *
+ * Packets land in a triple buffer: the DMAC fills one, the newest whole
+ * packet waits in the second, and the renderer reads the third for a
+ * whole frame, so a frame never mixes two packets. Only start code 0
+ * (dimmer data) is used; RDM and text packets are dropped.
+ *
+ * EFFECT_DMX reads its pixels straight from that buffer: LED i shows
+ * slots dmx_addr + 3 * (i / dmx_group) .. + 2 as R, G, B (CLI parameters,
+ * so the patch is set from the console). One DMX cell per dmx_group LEDs
+ * lets a 512-slot universe cover a whole strip. With DMX_AUTO_SELECT, the
+ * first packet after DMX_LOSS_MS of silence switches segment 0 to it; when
+ * the console stops, the last look is held.
+ *
+ * The NeoPixel CCL backend and parallel output 2 (NEO_OUTPUTS > 2) use
+ * SERCOM0, so they cannot be built with DMX_ENABLE.
+ * ============================================================================= */
+
+#ifndef DMX_H
+#define DMX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define DMX_ENABLE              0       /* 1 = an RS-485 receiver is on PA04        */
+#define DMX_DMA_CHANNEL         7u      /* DMA_OTHER channel, dma_qos.h              */
+#define DMX_IRQ_PRIO            IRQ_PRIO_DMX        /* NVIC, irqprio.h           */
+#define DMX_LOSS_MS             1000u   /* no packet for this long: signal lost      */
+#define DMX_AUTO_SELECT         1       /* 1 = first packet after a loss selects it  */
+
+#define DMX_SLOTS               512u
+#define DMX_START_CODE          0x00u   /* dimmer data                               */
+
+typedef struct
+{
+    uint32_t packets;                   /* start code 0 packets received             */
+    uint32_t dropped;                   /* other start codes, runts                  */
+    uint32_t overruns;                  /* USART buffer overflows                    */
+    uint16_t slots;                     /* in the latest packet                      */
+    bool     present;                   /* a packet within DMX_LOSS_MS               */
+} dmx_stats_t;
+
+/**
+ * Set up PA04, SERCOM0 and the DMA channel and start listening; registers
+ * dmx_addr and dmx_group. Before the scheduler. Does nothing unless
+ * DMX_ENABLE.
+ */
+void Dmx_Start(void);
+
+/** Counters and signal state. Any task. */
+void Dmx_GetStats(dmx_stats_t *out);
+
+/** Packets received (telemetry). Any task. */
+uint32_t Dmx_Packets(void);
+
+/**
+ * Effect frame hook: take the newest whole packet, if one came since the
+ * last frame, for the Dmx_Pixel() calls that follow. True if it did.
+ */
+bool Dmx_Update(uint8_t steps);
+
+/** Effect kernel: LED i from its patched slots, black past the packet's end. */
+pix_t Dmx_Pixel(uint16_t i, uint8_t offset);
+
+#endif /* DMX_H */
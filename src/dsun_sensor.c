@@ -24,6 +24,17 @@
 
 #include "dsun_sensor.h"
 #include "definitions.h"
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+#include "showclock.h"
+#include "rtos_trace.h"
+#include "tickless.h"
+#include "evbus.h"
+#include "latbench.h"
+#include "loadtest.h"
+#include "replay.h"
+#include "irqstat.h"
+#include "cpufreq.h"
 
 /* ************************************************************************** */
 /* ************************************************************************** */
@@ -46,8 +57,59 @@
  */
 static dsun_state_t current_state = DSUN_STATE_UNKNOWN;
 static dsun_state_t previous_state = DSUN_STATE_UNKNOWN;
-static uint32_t last_change_time = 0;
+static uint32_t last_change_time = 0;   /* show clock, us */
 static bool sensor_initialized = false;
+static volatile dsun_edge_callback_t edge_callback = NULL;
+
+/* ************************************************************************** */
+/** Interrupt-Driven State
+
+  @Summary
+    Sensor state as last seen by EIC_EXTINT_3_Handler().
+
+  @Description
+    Once dsun_events_enable() has run, the EIC filter does the debouncing
+    and these replace the polled state: the level at the last edge plus
+    one latch per edge direction for the just_detected / just_lost checks.
+ */
+static StreamBufferHandle_t event_buffer = NULL;
+static StaticStreamBuffer_t event_buffer_buf;
+static uint8_t event_buffer_store[DSUN_EVENT_DEPTH * sizeof(dsun_event_t)];
+static volatile bool     eic_tracking = false;
+static volatile bool     eic_level = false;
+static volatile bool     eic_rise_latch = false;
+static volatile bool     eic_fall_latch = false;
+static volatile uint32_t event_drops = 0;
+static volatile bool     inject_pending = false;    /* dsun_inject_edge() */
+static volatile bool     inject_level = false;
+
+/* ************************************************************************** */
+/** Distance Mode State
+
+  @Summary
+    Latest ping result as written by TC2_Handler().
+ */
+static volatile dsun_range_callback_t range_callback = NULL;
+static volatile uint16_t range_mm = DSUN_NO_RANGE;
+static volatile uint32_t range_time = 0;    /* show clock at the last ping, us */
+static uint32_t range_period_us = 0;        /* 0: ranging off */
+
+/* ************************************************************************** */
+/** Sensor Array State
+
+  @Summary
+    Vertical counters and edge latches of the array, one bit per PORT pin.
+
+  @Description
+    Bit n of array_cnt1:array_cnt0 counts how many samples in a row pin n
+    has differed from bit n of array_state; all pins step in parallel.
+ */
+static uint32_t array_state = 0;
+static uint32_t array_cnt0 = 0;
+static uint32_t array_cnt1 = 0;
+static uint32_t array_rise = 0;
+static uint32_t array_fall = 0;
+static uint32_t array_sample_time = 0;      /* show clock, us */
 
 /* ************************************************************************** */
 /* ************************************************************************** */
@@ -57,28 +119,28 @@ static bool sensor_initialized = false;
 
 /** 
   @Function
-    uint32_t get_system_time_ms(void)
+    uint32_t get_system_time_us(void)
 
   @Summary
-    Get current system time in milliseconds.
+    Get current system time in microseconds.
 
   @Description
-    Simple millisecond counter for debounce timing. This is a placeholder
-    implementation - replace with actual system tick counter if available.
+    Reads the shared hardware show clock (showclock.h), so debounce timing
+    is real time whatever the polling rate or task load.
 
   @Returns
-    Current time in milliseconds (approximate)
+    Current time in microseconds, wrapping at 2^32.
 
   @Remarks
-    This is a simple implementation. For more accurate timing, integrate
-    with your system's tick timer or use SysTick counter.
+    Compare times only through unsigned differences.
  */
-static uint32_t get_system_time_ms(void) {
-    // Simple approximation - replace with actual system timer
-    // This assumes your main loop runs frequently enough for reasonable timing
-    static uint32_t time_counter = 0;
-    time_counter++;
-    return time_counter / 1000; // Very rough approximation
+static uint32_t get_system_time_us(void) {
+    return ShowClock_Now();
+}
+
+// Standby would stop TC2 / TC4 while ranging; the EIC edge wakes us anyway
+static bool dsun_tickless_veto(void) {
+    return range_period_us != 0u;
 }
 
 /* ************************************************************************** */
@@ -99,9 +161,10 @@ static uint32_t get_system_time_ms(void) {
     Refer to the dsun_sensor.h interface header for function usage details.
  */
 void dsun_sensor_init(void) {
+    (void)Tickless_RegisterVeto(dsun_tickless_veto);
     current_state = DSUN_STATE_UNKNOWN;
     previous_state = DSUN_STATE_UNKNOWN;
-    last_change_time = 0;
+    last_change_time = get_system_time_us();
     sensor_initialized = true;
     
     // Read initial state
@@ -139,18 +202,21 @@ dsun_state_t dsun_get_state(void) {
     if (!sensor_initialized) {
         return DSUN_STATE_UNKNOWN;
     }
+    if (eic_tracking) {
+        return eic_level ? DSUN_OBJECT_DETECTED : DSUN_NO_OBJECT;
+    }
     
     // Read raw sensor state
     bool raw_reading = dsun_read_raw();
     dsun_state_t new_state = raw_reading ? DSUN_OBJECT_DETECTED : DSUN_NO_OBJECT;
     
     // Get current time
-    uint32_t current_time = get_system_time_ms();
+    uint32_t current_time = get_system_time_us();
     
     // Check if state has changed
     if (new_state != current_state) {
         // State changed - check if enough time has passed for debouncing
-        if (current_time - last_change_time >= DSUN_DEBOUNCE_MS) {
+        if (current_time - last_change_time >= DSUN_DEBOUNCE_MS * 1000u) {
             // Update states
             previous_state = current_state;
             current_state = new_state;
@@ -192,6 +258,12 @@ bool dsun_object_detected(void) {
     Refer to the dsun_sensor.h interface header for function usage details.
  */
 bool dsun_object_just_detected(void) {
+    if (eic_tracking) {
+        bool rise = eic_rise_latch;
+        eic_rise_latch = false;
+        return rise;
+    }
+
     dsun_state_t current = dsun_get_state();
     
     // Check for rising edge: previous was no object, current is object detected
@@ -213,6 +285,12 @@ bool dsun_object_just_detected(void) {
     Refer to the dsun_sensor.h interface header for function usage details.
  */
 bool dsun_object_just_lost(void) {
+    if (eic_tracking) {
+        bool fall = eic_fall_latch;
+        eic_fall_latch = false;
+        return fall;
+    }
+
     dsun_state_t current = dsun_get_state();
     
     // Check for falling edge: previous was object detected, current is no object
@@ -222,6 +300,446 @@ bool dsun_object_just_lost(void) {
     return falling_edge;
 }
 
+// *****************************************************************************
+/** 
+  @Function
+    void dsun_edge_enable(dsun_edge_callback_t callback)
+
+  @Summary
+    Call a function from interrupt context on every detection edge.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+/** 
+  @Function
+    static void dsun_eic_stop(void)
+
+  @Summary
+    Disable the EIC so its enable-protected registers can be written.
+
+  @Remarks
+    The presence line and the echo line share the EIC; pair every call
+    with dsun_eic_start().
+ */
+static void dsun_eic_stop(void) {
+    // EIC on the 32 kHz ULP clock: no GCLK channel needed
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_EIC_Msk;
+    EIC_REGS->EIC_CTRLA = 0u;
+    while ((EIC_REGS->EIC_SYNCBUSY & EIC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    EIC_REGS->EIC_CTRLA = EIC_CTRLA_CKSEL_CLK_ULP32K;
+}
+
+static void dsun_eic_start(void) {
+    EIC_REGS->EIC_CTRLA |= EIC_CTRLA_ENABLE_Msk;
+    while ((EIC_REGS->EIC_SYNCBUSY & EIC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+}
+
+/** 
+  @Function
+    static void dsun_eic_arm(void)
+
+  @Summary
+    Route PA19 to EIC line DSUN_EXTINT, both edges, and enable its interrupt.
+ */
+static void dsun_eic_arm(void) {
+    dsun_eic_stop();
+
+#if DSUN_HW_DEBOUNCE
+    // Line 3: both edges through the debouncer, 7 low-frequency samples,
+    // plus an event per debounced edge (all enable-protected)
+    EIC_REGS->EIC_CONFIG[0] = (EIC_REGS->EIC_CONFIG[0] &
+                               ~(EIC_CONFIG_SENSE3_Msk | EIC_CONFIG_FILTEN3_Msk)) |
+                              EIC_CONFIG_SENSE3_BOTH;
+    EIC_REGS->EIC_DPRESCALER = (EIC_REGS->EIC_DPRESCALER &
+                                ~(EIC_DPRESCALER_PRESCALER0_Msk | EIC_DPRESCALER_STATES0_Msk)) |
+                               EIC_DPRESCALER_PRESCALER0(DSUN_HW_DEBOUNCE_PRESC) |
+                               EIC_DPRESCALER_STATES0_LFREQ7 | EIC_DPRESCALER_TICKON_CLK_LFREQ;
+    EIC_REGS->EIC_DEBOUNCEN |= EIC_DEBOUNCEN_DEBOUNCEN(1u << DSUN_EXTINT);
+    EIC_REGS->EIC_EVCTRL    |= EIC_EVCTRL_EXTINTEO(1u << DSUN_EXTINT);
+
+    // EXTINT3 event -> TC0 time stamp; a pulse event, so the async path
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_TC0_EVU] = EVSYS_USER_CHANNEL(DSUN_EVSYS_CHANNEL + 1u);
+    EVSYS_REGS->CHANNEL[DSUN_EVSYS_CHANNEL].EVSYS_CHANNEL =
+        EVSYS_CHANNEL_EVGEN(EVENT_ID_GEN_EIC_EXTINT_3) | EVSYS_CHANNEL_PATH(2U);
+#else
+    // Line 3: both edges, majority filter (CONFIG is enable-protected)
+    EIC_REGS->EIC_CONFIG[0] = (EIC_REGS->EIC_CONFIG[0] &
+                               ~(EIC_CONFIG_SENSE3_Msk | EIC_CONFIG_FILTEN3_Msk)) |
+                              EIC_CONFIG_SENSE3_BOTH | EIC_CONFIG_FILTEN3_Msk;
+#endif
+    EIC_REGS->EIC_INTFLAG  = EIC_INTFLAG_EXTINT(1u << DSUN_EXTINT);
+    EIC_REGS->EIC_INTENSET = EIC_INTENSET_EXTINT(1u << DSUN_EXTINT);
+
+    // PA19 -> peripheral A (EXTINT[3]); keep the input + pull-down from MCC
+    PORT_REGS->GROUP[0].PORT_PMUX[19u >> 1] &= (uint8_t)~PORT_PMUX_PMUXO_Msk;
+    PORT_REGS->GROUP[0].PORT_PINCFG[19] |= PORT_PINCFG_PMUXEN_Msk;
+
+    dsun_eic_start();
+
+    NVIC_SetPriority(EIC_EXTINT_3_IRQn, DSUN_EXTINT_PRIO);
+    NVIC_ClearPendingIRQ(EIC_EXTINT_3_IRQn);
+    NVIC_EnableIRQ(EIC_EXTINT_3_IRQn);
+}
+
+void dsun_edge_enable(dsun_edge_callback_t callback) {
+    if (callback == NULL) {
+        edge_callback = NULL;
+        if (event_buffer == NULL) {     // events still need the line
+            EIC_REGS->EIC_INTENCLR = EIC_INTENCLR_EXTINT(1u << DSUN_EXTINT);
+        }
+        return;
+    }
+    edge_callback = callback;
+    dsun_eic_arm();
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    bool dsun_events_enable(void)
+
+  @Summary
+    Queue every detection edge, timestamped, for a consumer task.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+bool dsun_events_enable(void) {
+    if (event_buffer != NULL) {
+        return true;
+    }
+    event_buffer = xStreamBufferCreateStatic(sizeof(event_buffer_store), sizeof(dsun_event_t),
+                                             event_buffer_store, &event_buffer_buf);
+    if (event_buffer == NULL) {
+        return false;
+    }
+    LOADTEST_NAME(event_buffer, "dsun events");
+    event_drops = 0;
+    eic_level = dsun_read_raw();
+    eic_rise_latch = false;
+    eic_fall_latch = false;
+    eic_tracking = true;
+    dsun_eic_arm();
+    return true;
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    bool dsun_event_wait(dsun_event_t *event, uint32_t timeout_ms)
+
+  @Summary
+    Block until the next sensor edge.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+bool dsun_event_wait(dsun_event_t *event, uint32_t timeout_ms) {
+    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+
+    if (event_buffer == NULL) {
+        return false;
+    }
+    return xStreamBufferReceive(event_buffer, event, sizeof(*event), ticks) == sizeof(*event);
+}
+
+uint32_t dsun_event_dropped(void) {
+    return event_drops;
+}
+
+void dsun_inject_edge(bool detected) {
+    inject_level = detected;
+    inject_pending = true;
+    NVIC_SetPendingIRQ(EIC_EXTINT_3_IRQn);
+}
+
+void EIC_EXTINT_3_Handler(void) {
+#if DSUN_HW_DEBOUNCE
+    // Stamped by TC0 at the debounced edge; back to when the level changed
+    uint32_t now = ShowClock_Stamp() - DSUN_HW_DEBOUNCE_US;
+#else
+    uint32_t now = ShowClock_Now();     // before anything else: edge time
+#endif
+    BaseType_t woken = pdFALSE;
+
+    RTOS_TRACE_ISR_ENTER();
+    IRQSTAT_ENTER(IRQSTAT_DSUN_EDGE);
+#if DSUN_HW_DEBOUNCE
+    // The interrupt was raised at the stamp: entry latency, to the microsecond
+    IRQSTAT_DUE(IRQSTAT_DSUN_EDGE, CpuFreq_Cycles()
+                - (ShowClock_Now() - now - DSUN_HW_DEBOUNCE_US) * (configCPU_CLOCK_HZ / 1000000u));
+#endif
+    EIC_REGS->EIC_INTFLAG = EIC_INTFLAG_EXTINT(1u << DSUN_EXTINT);
+
+    // Active high output: the level now tells which edge it was
+    bool level = dsun_read_raw();
+    bool live = !inject_pending;
+    if (inject_pending) {
+        inject_pending = false;
+        level = inject_level;
+    }
+    // A playback (replay.h) stands in for the room: real edges are dropped
+    bool muted = live && REPLAY_PLAYING();
+    if (!muted) {
+        REPLAY_INPUT(REPLAY_EDGE, 0u, now, level ? 1u : 0u);
+    }
+
+    if (eic_tracking && !muted) {
+        if (level && !eic_level) {
+            eic_rise_latch = true;
+        } else if (!level && eic_level) {
+            eic_fall_latch = true;
+        }
+        eic_level = level;
+
+        // Whole events only: one writer (this ISR), so the space check holds
+        dsun_event_t ev = { now, level };
+        if (xStreamBufferSpacesAvailable(event_buffer) >= sizeof(ev)) {
+            (void)xStreamBufferSendFromISR(event_buffer, &ev, sizeof(ev), &woken);
+        } else {
+            event_drops++;
+        }
+        if (level) LATBENCH_EDGE(ShowClock_Now() - now);
+        EventBus_PublishFromISR(EVBUS_SENSOR_EDGE, 0u, level ? 1u : 0u, &woken);
+        EventBus_SetStateFromISR(EVBUS_STATE_PRESENCE, level, &woken);
+    }
+
+    dsun_edge_callback_t cb = edge_callback;
+    if (cb != NULL && !muted) {
+        cb(level);
+    }
+    IRQSTAT_EXIT(IRQSTAT_DSUN_EDGE);
+    RTOS_TRACE_ISR_EXIT();
+    portYIELD_FROM_ISR(woken);
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    bool dsun_range_enable(uint16_t rate_hz, dsun_range_callback_t callback)
+
+  @Summary
+    Start echo ranging at rate_hz pings per second.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+bool dsun_range_enable(uint16_t rate_hz, dsun_range_callback_t callback) {
+    if ((rate_hz < DSUN_RANGE_MIN_HZ) || (rate_hz > DSUN_RANGE_MAX_HZ)) {
+        return false;
+    }
+    dsun_range_disable();
+    range_callback = callback;
+    range_mm = DSUN_NO_RANGE;
+    range_time = ShowClock_Now();
+    range_period_us = 1000000u / rate_hz;
+
+    // TC2 + TC4 from the 1 MHz GCLK2, like the show clock
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_TC2_Msk;
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_TC4_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TC2_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[TC2_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+    GCLK_REGS->GCLK_PCHCTRL[TC4_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[TC4_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    // ECHO, line 8: level sense so the event carries the pin level to TC2;
+    // asynchronous, so microsecond edges are not resampled at 32 kHz
+    dsun_eic_stop();
+    EIC_REGS->EIC_CONFIG[1] = (EIC_REGS->EIC_CONFIG[1] &
+                               ~(EIC_CONFIG_SENSE0_Msk | EIC_CONFIG_FILTEN0_Msk)) |
+                              EIC_CONFIG_SENSE0_HIGH;
+    EIC_REGS->EIC_ASYNCH  |= EIC_ASYNCH_ASYNCH(1u << DSUN_RANGE_EXTINT);
+    EIC_REGS->EIC_EVCTRL  |= EIC_EVCTRL_EXTINTEO(1u << DSUN_RANGE_EXTINT);
+    EIC_REGS->EIC_INTENCLR = EIC_INTENCLR_EXTINT(1u << DSUN_RANGE_EXTINT);
+    dsun_eic_start();
+
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_TC2_EVU] = EVSYS_USER_CHANNEL(DSUN_RANGE_EVSYS_CHANNEL + 1u);
+    EVSYS_REGS->CHANNEL[DSUN_RANGE_EVSYS_CHANNEL].EVSYS_CHANNEL =
+        EVSYS_CHANNEL_EVGEN(EVENT_ID_GEN_EIC_EXTINT_8) | EVSYS_CHANNEL_PATH(2U);
+
+    // TC2: rising echo edge restarts the count, falling edge captures the
+    // width in CC1 (period in CC0); 65 ms range at 1 us
+    TC2_REGS->COUNT16.TC_CTRLA = TC_CTRLA_SWRST_Msk;
+    while ((TC2_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TC2_REGS->COUNT16.TC_CTRLA  = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1 |
+                                  TC_CTRLA_CAPTEN0_Msk | TC_CTRLA_CAPTEN1_Msk;
+    TC2_REGS->COUNT16.TC_EVCTRL = TC_EVCTRL_TCEI_Msk | TC_EVCTRL_EVACT_PPW;
+    TC2_REGS->COUNT16.TC_INTFLAG  = TC_INTFLAG_Msk;
+    TC2_REGS->COUNT16.TC_INTENSET = TC_INTENSET_MC1_Msk;
+    TC2_REGS->COUNT16.TC_CTRLA |= TC_CTRLA_ENABLE_Msk;
+    while ((TC2_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    NVIC_SetPriority(TC2_IRQn, DSUN_EXTINT_PRIO);
+    NVIC_ClearPendingIRQ(TC2_IRQn);
+    NVIC_EnableIRQ(TC2_IRQn);
+
+    // TC4: match PWM at 62.5 kHz, top CC0 = one ping period, WO1 high for
+    // CC1 = 1 count (16 us) at the start of each period
+    TC4_REGS->COUNT16.TC_CTRLA = TC_CTRLA_SWRST_Msk;
+    while ((TC4_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TC4_REGS->COUNT16.TC_CTRLA = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV16;
+    TC4_REGS->COUNT16.TC_WAVE  = TC_WAVE_WAVEGEN_MPWM;
+    TC4_REGS->COUNT16.TC_CC[0] = (uint16_t)(62500u / rate_hz - 1u);
+    TC4_REGS->COUNT16.TC_CC[1] = 1u;
+    while ((TC4_REGS->COUNT16.TC_SYNCBUSY & (TC_SYNCBUSY_CC0_Msk | TC_SYNCBUSY_CC1_Msk)) != 0u) {}
+
+    // PB08 -> peripheral A (EXTINT[8]) with pull-down, PB09 -> peripheral E (TC4/WO1)
+    PORT_REGS->GROUP[1].PORT_OUTCLR = 1u << 8;
+    PORT_REGS->GROUP[1].PORT_PMUX[8u >> 1] = PORT_PMUX_PMUXE(0x0u) | PORT_PMUX_PMUXO(0x4u);
+    PORT_REGS->GROUP[1].PORT_PINCFG[8] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_INEN_Msk |
+                                         PORT_PINCFG_PULLEN_Msk;
+    PORT_REGS->GROUP[1].PORT_PINCFG[9] = PORT_PINCFG_PMUXEN_Msk;
+
+    TC4_REGS->COUNT16.TC_CTRLA |= TC_CTRLA_ENABLE_Msk;
+    while ((TC4_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    return true;
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    void dsun_range_disable(void)
+
+  @Summary
+    Stop pinging and release TC2, TC4 and the echo line.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+void dsun_range_disable(void) {
+    if (range_period_us == 0u) {
+        return;
+    }
+    range_period_us = 0u;
+    range_mm = DSUN_NO_RANGE;
+
+    PORT_REGS->GROUP[1].PORT_PINCFG[9] = 0u;        // TRIG back to a low GPIO
+    TC4_REGS->COUNT16.TC_CTRLA = 0u;
+    while ((TC4_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    NVIC_DisableIRQ(TC2_IRQn);
+    TC2_REGS->COUNT16.TC_CTRLA = 0u;
+    while ((TC2_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_TC2_EVU] = 0u;
+
+    dsun_eic_stop();
+    EIC_REGS->EIC_EVCTRL &= ~EIC_EVCTRL_EXTINTEO(1u << DSUN_RANGE_EXTINT);
+    EIC_REGS->EIC_CONFIG[1] &= ~EIC_CONFIG_SENSE0_Msk;
+    dsun_eic_start();
+    range_callback = NULL;
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    uint16_t dsun_range_mm(void)
+
+  @Summary
+    Distance of the latest ping in millimetres.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+uint16_t dsun_range_mm(void) {
+    uint32_t period = range_period_us;
+
+    if ((period == 0u) || (ShowClock_Since(range_time) > 2u * period)) {
+        return DSUN_NO_RANGE;
+    }
+    return range_mm;
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    void dsun_array_init(void)
+
+  @Summary
+    Start debouncing every sensor in DSUN_ARRAY_MASK.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+void dsun_array_init(void) {
+    array_state = PORT_REGS->GROUP[DSUN_ARRAY_GROUP].PORT_IN & DSUN_ARRAY_MASK;
+    array_cnt0 = 0;
+    array_cnt1 = 0;
+    array_rise = 0;
+    array_fall = 0;
+    array_sample_time = get_system_time_us();
+}
+
+// *****************************************************************************
+/** 
+  @Function
+    uint32_t dsun_array_update(void)
+
+  @Summary
+    Sample and debounce all array sensors at once.
+
+  @Remarks
+    Refer to the dsun_sensor.h interface header for function usage details.
+ */
+uint32_t dsun_array_update(void) {
+    uint32_t now = get_system_time_us();
+
+    if (now - array_sample_time < DSUN_ARRAY_SAMPLE_US) {
+        return array_state;
+    }
+    array_sample_time = now;
+
+    // Pins that differ count up, pins that agree reset; a pin flips on the
+    // 4th differing sample in a row, when its counter wraps to 0
+    uint32_t delta = (PORT_REGS->GROUP[DSUN_ARRAY_GROUP].PORT_IN & DSUN_ARRAY_MASK) ^ array_state;
+    array_cnt1 = (array_cnt1 ^ array_cnt0) & delta;
+    array_cnt0 = ~array_cnt0 & delta;
+    uint32_t toggle = delta & ~(array_cnt0 | array_cnt1);
+
+    array_state ^= toggle;
+    array_rise |= toggle & array_state;
+    array_fall |= toggle & ~array_state;
+    return array_state;
+}
+
+uint32_t dsun_array_present(void) {
+    return array_state;
+}
+
+uint32_t dsun_array_rising(void) {
+    uint32_t rise = array_rise;
+    array_rise = 0;
+    return rise;
+}
+
+uint32_t dsun_array_falling(void) {
+    uint32_t fall = array_fall;
+    array_fall = 0;
+    return fall;
+}
+
+void TC2_Handler(void) {
+    // Reading CC1 clears MC1; CC0 is the ping period, not needed
+    uint32_t width = TC2_REGS->COUNT16.TC_CC[1];
+    uint16_t mm = DSUN_NO_RANGE;
+
+    RTOS_TRACE_ISR_ENTER();
+    IRQSTAT_ENTER(IRQSTAT_DSUN_RANGE);
+    TC2_REGS->COUNT16.TC_INTFLAG = TC_INTFLAG_Msk;
+    if (width <= DSUN_RANGE_MAX_US) {
+        mm = (uint16_t)(width * DSUN_RANGE_SOUND_MPS / 2000u);
+    }
+    range_mm = mm;
+    range_time = ShowClock_Now();
+
+    dsun_range_callback_t cb = range_callback;
+    if (cb != NULL) {
+        cb(mm);
+    }
+    IRQSTAT_EXIT(IRQSTAT_DSUN_RANGE);
+    RTOS_TRACE_ISR_EXIT();
+}
+
 /* *****************************************************************************
  End of File
  */
\ No newline at end of file
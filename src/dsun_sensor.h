@@ -28,6 +28,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "irqprio.h"
+#include "showcfg.h"
 
 /* Provide C++ Compatibility */
 #ifdef __cplusplus
@@ -63,10 +65,143 @@ extern "C" {
     
       @Description
         Prevents false triggering due to sensor noise or rapid state changes.
+        A new level must hold this long, in real time on the show clock,
+        before dsun_get_state() reports it, however often it is polled.
         Adjust this value based on your application needs.
      */
 #define DSUN_DEBOUNCE_MS    50
 
+    /* ************************************************************************** */
+    /** Edge Interrupt Line
+
+      @Summary
+        EIC line wired to DSUN_SENSOR_PIN.
+
+      @Description
+        PA19 is EXTINT[3] on peripheral function A. The line is clocked from
+        the 32 kHz ultra-low-power oscillator with the majority filter on, so
+        sensor glitches shorter than about 100 us are ignored.
+
+      @Remarks
+        The NVIC priority comes from irqprio.h, which keeps it at or below
+        configMAX_SYSCALL_INTERRUPT_PRIORITY: the edge callback may use
+        FreeRTOS FromISR calls.
+     */
+#define DSUN_EXTINT         3u
+#define DSUN_EXTINT_PRIO    IRQ_PRIO_DSUN
+
+    /* ************************************************************************** */
+    /** Hardware Debounce Mode
+
+      @Summary
+        Debounce and timestamp sensor edges in hardware.
+
+      @Description
+        With DSUN_HW_DEBOUNCE = 1 the EIC debouncer replaces the majority
+        filter on line DSUN_EXTINT: a new level must be sampled 7 times in
+        a row at 32768 Hz >> (DSUN_HW_DEBOUNCE_PRESC + 1) before the edge
+        fires, about DSUN_HW_DEBOUNCE_US (0.43 ms at the default). The
+        debounced edge is also an EIC event that EVSYS channel
+        DSUN_EVSYS_CHANNEL routes to TC0, which stamps the show clock into
+        CC0 (ShowClock_Stamp()). Edge times are then exact whatever the
+        interrupt latency, and nothing is polled in software.
+
+      @Remarks
+        The EIC-tracked state needs dsun_events_enable(); plain polling
+        keeps the DSUN_DEBOUNCE_MS software debounce.
+     */
+#define DSUN_HW_DEBOUNCE        0
+#define DSUN_HW_DEBOUNCE_PRESC  0u          /* DPRESCALER0: 32768 / 2 Hz */
+#define DSUN_HW_DEBOUNCE_US     (7u * 1000000u / (32768u >> (DSUN_HW_DEBOUNCE_PRESC + 1u)))
+#define DSUN_EVSYS_CHANNEL      2u          /* 0, 1: NeoPixel frame / CCL */
+
+    /* ************************************************************************** */
+    /** Edge Event Buffer Depth
+
+      @Summary
+        Timestamped edges held for dsun_event_wait().
+
+      @Description
+        Edges that arrive while the buffer is full are dropped and counted
+        by dsun_event_dropped().
+     */
+#define DSUN_EVENT_DEPTH    16u
+
+    /* ************************************************************************** */
+    /** Sensor Array Wiring
+
+      @Summary
+        PORT group and pins of every switched-output sensor in the array.
+
+      @Description
+        All array sensors sit on one PORT group so a single PORT_IN read
+        samples them together. DSUN_ARRAY_MASK has one bit per sensor pin,
+        in PORT bit positions, and the dsun_array_*() masks use the same
+        positions: test them with DSUN_ARRAY_BIT(pin number). Add a sensor
+        by wiring it to a free pin of the group and adding its row to
+        SHOW_SENSORS (showcfg.h); the mask is built from the rows.
+
+      @Remarks
+        Pins must be inputs (pull-down for active-high outputs) in MCC.
+     */
+#define DSUN_ARRAY_GROUP        0u                  /* PORTA */
+#define DSUN_ARRAY_BIT(pin)     (1UL << (pin))
+#define DSUN_X_BIT(id, pin, depth)  | DSUN_ARRAY_BIT(pin)
+#define DSUN_ARRAY_MASK         (0UL SHOW_SENSORS(DSUN_X_BIT))
+
+    /* ************************************************************************** */
+    /** Sensor Array Debounce
+
+      @Summary
+        Sampling period of the array's vertical-counter debounce.
+
+      @Description
+        A pin's level must differ from its debounced state for 4 samples
+        in a row to flip it, so the array debounces over DSUN_DEBOUNCE_MS
+        like the single sensor, however often dsun_array_update() is called.
+     */
+#define DSUN_ARRAY_SAMPLE_US    (DSUN_DEBOUNCE_MS * 1000u / 4u)
+
+    /* ************************************************************************** */
+    /** Distance Mode Wiring
+
+      @Summary
+        Pins, timers and event channel of the echo ranging mode.
+
+      @Description
+        For sensors with a TRIG / ECHO pair instead of a switched output.
+        TC4 drives TRIG on PB09 (WO1, peripheral E) with a 16 us pulse at
+        the ranging rate. ECHO on PB08 is EIC line DSUN_RANGE_EXTINT at
+        level sense; its event goes over EVSYS channel DSUN_RANGE_EVSYS_CHANNEL
+        to TC2, which restarts on the rising edge and captures the pulse
+        width in microseconds (GCLK2, 1 MHz) on the falling edge.
+
+      @Remarks
+        The sensor's 5 V ECHO output needs a divider: PB08 is not 5 V tolerant.
+     */
+#define DSUN_RANGE_TRIG_PIN         PORT_PIN_PB09
+#define DSUN_RANGE_ECHO_PIN         PORT_PIN_PB08
+#define DSUN_RANGE_EXTINT           8u
+#define DSUN_RANGE_EVSYS_CHANNEL    3u      /* 2: DSUN_HW_DEBOUNCE */
+
+    /* ************************************************************************** */
+    /** Distance Mode Limits
+
+      @Summary
+        Ranging rates, echo timeout and speed of sound.
+
+      @Description
+        A ping needs about 60 ms to die out, so DSUN_RANGE_MAX_HZ is 16.
+        Echoes longer than DSUN_RANGE_MAX_US (no target, about 5 m at the
+        default) read as DSUN_NO_RANGE. Distance in mm is the echo time
+        times DSUN_RANGE_SOUND_MPS / 2000 (there and back).
+     */
+#define DSUN_RANGE_MIN_HZ       1u
+#define DSUN_RANGE_MAX_HZ       16u
+#define DSUN_RANGE_MAX_US       30000u
+#define DSUN_RANGE_SOUND_MPS    343u        /* air at 20 C */
+#define DSUN_NO_RANGE           0xFFFFu
+
     // *****************************************************************************
     // *****************************************************************************
     // Section: Data Types
@@ -92,6 +227,20 @@ extern "C" {
         DSUN_STATE_UNKNOWN      /* Initial/undefined state */
     } dsun_state_t;
 
+    /** Edge callback, called from the EIC interrupt handler; `detected` is
+        true when an object appeared, false when it left. */
+    typedef void (*dsun_edge_callback_t)(bool detected);
+
+    /** One sensor edge as seen by the EIC interrupt handler. */
+    typedef struct {
+        uint32_t time_us;       /* ShowClock_Now() at the edge (showclock.h) */
+        bool     detected;      /* true: object appeared, false: it left */
+    } dsun_event_t;
+
+    /** Range callback, called from the TC2 interrupt handler once per ping
+        with the distance in mm, or DSUN_NO_RANGE when nothing echoed. */
+    typedef void (*dsun_range_callback_t)(uint16_t mm);
+
     // *****************************************************************************
     // *****************************************************************************
     // Section: Interface Functions
@@ -111,7 +260,8 @@ extern "C" {
         Must be called once before using other sensor functions.
 
       @Precondition
-        PA19 must be configured as digital input with pull-down in MCC.
+        PA19 must be configured as digital input with pull-down in MCC,
+        and ShowClock_Init() called (debounce timebase).
 
       @Parameters
         None.
@@ -297,6 +447,299 @@ extern "C" {
      */
     bool dsun_object_just_lost(void);
 
+    // *****************************************************************************
+    /**
+      @Function
+        void dsun_edge_enable(dsun_edge_callback_t callback)
+
+      @Summary
+        Call a function from interrupt context on every detection edge.
+
+      @Description
+        Routes PA19 to EIC line DSUN_EXTINT, arms it for both edges and
+        calls `callback` from EIC_EXTINT_3_Handler() each time an object
+        appears (true) or leaves (false). Edges reach the callback within a
+        few microseconds, with no polling loop involved.
+
+      @Precondition
+        PA19 must be configured as digital input with pull-down in MCC.
+
+      @Parameters
+        @param callback Function to call per edge, or NULL to disarm the line.
+
+      @Returns
+        None.
+
+      @Remarks
+        The callback runs at NVIC priority DSUN_EXTINT_PRIO. Keep it short and
+        use only FromISR FreeRTOS calls.
+
+      @Example
+        @code
+        dsun_edge_enable(Actuator_PresenceFromISR);
+        @endcode
+     */
+    void dsun_edge_enable(dsun_edge_callback_t callback);
+
+    // *****************************************************************************
+    /**
+      @Function
+        bool dsun_events_enable(void)
+
+      @Summary
+        Queue every detection edge, timestamped, for a consumer task.
+
+      @Description
+        Arms EIC line DSUN_EXTINT like dsun_edge_enable() and creates a
+        FreeRTOS stream buffer of DSUN_EVENT_DEPTH events. From then on
+        EIC_EXTINT_3_Handler() stamps each edge with the show clock and
+        pushes it, so a task can block in dsun_event_wait() instead of
+        polling. It also makes dsun_get_state() and the just_detected /
+        just_lost checks follow the interrupt instead of reading the pin.
+
+      @Precondition
+        ShowClock_Init() and dsun_sensor_init() called.
+
+      @Parameters
+        None.
+
+      @Returns
+        @retval true  Events are being queued
+        @retval false The buffer could not be allocated
+
+      @Remarks
+        Call once, before the scheduler or from a task. It can be combined
+        with an edge callback.
+
+      @Example
+        @code
+        dsun_events_enable();
+        @endcode
+     */
+    bool dsun_events_enable(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        bool dsun_event_wait(dsun_event_t *event, uint32_t timeout_ms)
+
+      @Summary
+        Block until the next sensor edge.
+
+      @Description
+        Takes the oldest queued edge, waiting up to timeout_ms for one.
+
+      @Precondition
+        dsun_events_enable() returned true.
+
+      @Parameters
+        @param event      Receives the edge.
+        @param timeout_ms Longest wait, 0 to poll, UINT32_MAX to wait forever.
+
+      @Returns
+        @retval true  An edge was taken
+        @retval false Timeout, or events were never enabled
+
+      @Remarks
+        Stream buffers have a single reader: call it from one task only.
+
+      @Example
+        @code
+        dsun_event_t ev;
+        while (dsun_event_wait(&ev, UINT32_MAX)) {
+            if (ev.detected) { start_scare(ev.time_us); }
+        }
+        @endcode
+     */
+    bool dsun_event_wait(dsun_event_t *event, uint32_t timeout_ms);
+
+    // *****************************************************************************
+    /**
+      @Function
+        uint32_t dsun_event_dropped(void)
+
+      @Summary
+        Edges lost because the event buffer was full.
+
+      @Returns
+        Count since dsun_events_enable().
+     */
+    uint32_t dsun_event_dropped(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        void dsun_inject_edge(bool detected)
+
+      @Summary
+        Feed a synthetic edge through the EIC interrupt handler.
+
+      @Description
+        Pends EIC_EXTINT_3_IRQn with `detected` standing in for the pin
+        level, so the edge takes the same path as a real one: the event
+        buffer, the event bus and the edge callback, at DSUN_EXTINT_PRIO.
+        The load generator (loadtest.h) drives it at rates no sensor does.
+
+      @Precondition
+        dsun_edge_enable() or dsun_events_enable() armed the line.
+
+      @Remarks
+        Any task or ISR. A real edge in the same interrupt is taken with
+        the synthetic level.
+     */
+    void dsun_inject_edge(bool detected);
+
+    // *****************************************************************************
+    /**
+      @Function
+        bool dsun_range_enable(uint16_t rate_hz, dsun_range_callback_t callback)
+
+      @Summary
+        Start echo ranging at rate_hz pings per second.
+
+      @Description
+        Starts TC4 pinging TRIG and arms the ECHO capture chain (see
+        Distance Mode Wiring). Each echo is measured by TC2 in hardware;
+        only the end of a ping interrupts, to convert it to millimetres
+        for dsun_range_mm() and `callback`. Call again to change the rate.
+
+      @Precondition
+        ShowClock_Init() called (GCLK2 running).
+
+      @Parameters
+        @param rate_hz  DSUN_RANGE_MIN_HZ .. DSUN_RANGE_MAX_HZ.
+        @param callback Function to call per ping, or NULL.
+
+      @Returns
+        @retval true  Ranging started
+        @retval false rate_hz out of range
+
+      @Remarks
+        The callback runs at NVIC priority DSUN_EXTINT_PRIO; FromISR calls only.
+
+      @Example
+        @code
+        dsun_range_enable(10u, NULL);
+        uint16_t mm = dsun_range_mm();
+        if (mm != DSUN_NO_RANGE) { glow = 255u - mm / 8u; }
+        @endcode
+     */
+    bool dsun_range_enable(uint16_t rate_hz, dsun_range_callback_t callback);
+
+    // *****************************************************************************
+    /**
+      @Function
+        void dsun_range_disable(void)
+
+      @Summary
+        Stop pinging and release TC2, TC4 and the echo line.
+     */
+    void dsun_range_disable(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        uint16_t dsun_range_mm(void)
+
+      @Summary
+        Distance of the latest ping in millimetres.
+
+      @Returns
+        Millimetres, or DSUN_NO_RANGE if nothing echoed, ranging is off or
+        no ping has completed for two periods (sensor unplugged).
+
+      @Remarks
+        Any task; never blocks.
+     */
+    uint16_t dsun_range_mm(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        void dsun_array_init(void)
+
+      @Summary
+        Start debouncing every sensor in DSUN_ARRAY_MASK.
+
+      @Description
+        Takes the current pin levels as the debounced state and clears the
+        edge latches.
+
+      @Precondition
+        ShowClock_Init() called.
+     */
+    void dsun_array_init(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        uint32_t dsun_array_update(void)
+
+      @Summary
+        Sample and debounce all array sensors at once.
+
+      @Description
+        Once DSUN_ARRAY_SAMPLE_US have passed since the last sample, reads
+        PORT_IN of DSUN_ARRAY_GROUP once and steps a 2-bit vertical counter
+        per pin with a few word-wide logic operations, so the cost is the
+        same for one sensor or eight. Debounced edges are latched for
+        dsun_array_rising() / dsun_array_falling().
+
+      @Precondition
+        dsun_array_init() called.
+
+      @Returns
+        Debounced presence mask (bit set: object detected), PORT bit positions.
+
+      @Remarks
+        Call from one task, at least every DSUN_ARRAY_SAMPLE_US for the
+        nominal debounce time; calling it more often is harmless.
+
+      @Example
+        @code
+        uint32_t present = dsun_array_update();
+        uint32_t arrived = dsun_array_rising();
+        if (arrived & DSUN_ARRAY_BIT(19u)) { start_scare(); }
+        @endcode
+     */
+    uint32_t dsun_array_update(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        uint32_t dsun_array_present(void)
+
+      @Summary
+        Debounced presence mask as of the last dsun_array_update().
+     */
+    uint32_t dsun_array_present(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        uint32_t dsun_array_rising(void)
+
+      @Summary
+        Sensors that detected an object since the last call.
+
+      @Returns
+        Mask of latched rising edges, cleared by the call.
+     */
+    uint32_t dsun_array_rising(void);
+
+    // *****************************************************************************
+    /**
+      @Function
+        uint32_t dsun_array_falling(void)
+
+      @Summary
+        Sensors that lost their object since the last call.
+
+      @Returns
+        Mask of latched falling edges, cleared by the call.
+     */
+    uint32_t dsun_array_falling(void);
+
 /* Provide C++ Compatibility */
 #ifdef __cplusplus
 }
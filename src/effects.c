@@ -0,0 +1,859 @@
+/* =============================================================================
+ * effects.c  -  Effect registry, segments, crossfades and overlay layers
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "effects.h"
+#include "neopixel.h"
+#include "fire.h"
+#include "particles.h"
+#include "timeline.h"
+#include "audio.h"
+#include "dmx.h"
+#include "netbridge.h"
+#include "pixdist.h"
+#include "power.h"
+#include "telem.h"
+#include "dmamem.h"
+#include "latbench.h"
+#include "loadtest.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "cache.h"
+#include "plugin.h"
+#include "log.h"
+#if EFFECTS_BENCH_ENABLE
+#include "profile.h"
+#include <stdio.h>
+#endif
+
+/* -- Registry ---------------------------------------------------------------- */
+
+#define FX_X_ROW(id, name, pixel, frame, prepare, animated, speed, bright, px_cyc, frame_cyc) \
+    [EFFECT_##id] = { name, pixel, frame, prepare, animated, { speed, bright }, { px_cyc, frame_cyc } },
+
+static const effect_t effect_table[EFFECT_COUNT] =
+{
+    SHOW_EFFECTS(FX_X_ROW)
+};
+
+typedef struct
+{
+    uint16_t start;
+    uint16_t count;
+    uint8_t  id;
+} fx_layout_t;
+
+#define FX_X_SEG(start, count, id)  { start, count, SHOW_CAT(EFFECT_, id) },
+
+static const fx_layout_t fx_boot[] = { SHOW_SEGMENTS(FX_X_SEG) };
+
+_Static_assert(EFFECT_COUNT <= 32u, "step_effect() keeps one bit per effect");
+
+/* Built-in row, or the plug-in registered under that id (plugin.h); NULL if neither */
+static inline const effect_t *fx_def(uint8_t id)
+{
+    return (id < EFFECT_COUNT) ? &effect_table[id] : Plugin_Effect((uint8_t)(id - EFFECT_COUNT));
+}
+
+static inline bool fx_valid(uint8_t id)
+{
+    return id < EFFECT_COUNT || Plugin_Effect((uint8_t)(id - EFFECT_COUNT)) != NULL;
+}
+_Static_assert(sizeof(fx_boot) / sizeof(fx_boot[0]) <= EFFECTS_MAX_SEGMENTS,
+               "SHOW_SEGMENTS has more rows than EFFECTS_MAX_SEGMENTS");
+
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES <= EFFECTS_NOTIFY_INDEX
+#error "Effects_WaitForChange() needs configTASK_NOTIFICATION_ARRAY_ENTRIES >= 2"
+#endif
+
+#define FX_CPU_HZ       120000000u  /* the render task holds full speed (cpufreq.h)    */
+
+#define EFFECT_NONE     0xFFu       /* no effect / no pending Effects_Select() request */
+#define LAYER_CLEAR     0xFEu       /* pending Effects_ClearLayer()                    */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    uint16_t        start;
+    uint16_t        count;          /* 0 = segment unused                 */
+    uint8_t         cur;            /* active / fade target               */
+    uint8_t         prev;           /* fading out, or EFFECT_NONE         */
+    effect_params_t params;
+    effect_params_t prev_params;
+    effect_state_t  state;
+    effect_state_t  prev_state;
+    uint16_t        fade_len;       /* frames in the fade                 */
+    uint16_t        fade_pos;       /* frames elapsed                     */
+} fx_segment_t;
+
+static fx_segment_t fx_seg[EFFECTS_MAX_SEGMENTS];
+
+static volatile uint8_t  fx_req_id[EFFECTS_MAX_SEGMENTS];
+static volatile uint16_t fx_req_frames[EFFECTS_MAX_SEGMENTS];
+
+typedef struct
+{
+    uint8_t         id;             /* EFFECT_NONE = layer off            */
+    uint8_t         mode;           /* effect_blend_t                     */
+    effect_params_t params;
+    effect_state_t  state;
+} fx_layer_t;
+
+static fx_layer_t fx_layer[EFFECTS_MAX_LAYERS];
+
+static volatile uint8_t  fx_layer_req[EFFECTS_MAX_LAYERS];         /* id, LAYER_CLEAR or EFFECT_NONE */
+static volatile uint8_t  fx_layer_req_mode[EFFECTS_MAX_LAYERS];
+static volatile uint8_t  fx_layer_alpha[EFFECTS_MAX_LAYERS];       /* written directly, one byte */
+
+static volatile uint8_t  fx_frame_req = EFFECT_NONE;   /* neo_frame_id_t or EFFECT_NONE */
+static volatile uint16_t fx_frame_req_frames;
+static uint8_t           fx_hold_id;                   /* constant frame instead of the scene */
+static uint16_t          fx_hold_left;                 /* frame slots still to hold it        */
+
+static TaskHandle_t  fx_task  = NULL;            /* renderer, known from its first frame */
+static QueueHandle_t fx_queue = NULL;            /* effect_cmd_t from Effects_Post*()     */
+static StaticQueue_t fx_queue_buf;
+static uint8_t       fx_queue_store[EFFECTS_QUEUE_LEN * sizeof(effect_cmd_t)];
+
+static pix_t fx_px[PIXDIST_SCENE_LEDS];          /* all segments, then output */
+static pix_t fx_old[PIXDIST_SCENE_LEDS];         /* effects fading out        */
+static pix_t fx_lpx[EFFECTS_MAX_LAYERS][PIXDIST_SCENE_LEDS];    /* overlay layers */
+
+/* -- Blending ---------------------------------------------------------------- */
+
+/* floor(sqrt(x)) for x <= 255^2, bit by bit */
+static uint8_t isqrt16(uint32_t x)
+{
+    uint32_t res = 0u;
+    uint32_t bit = 1u << 14;
+
+    while (bit > x)
+        bit >>= 2;
+
+    while (bit != 0u)
+    {
+        if (x >= res + bit)
+        {
+            x  -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint8_t)res;
+}
+
+/* Mix a -> b by t/256 in linear light, approximating the LED gamma as 2.0 */
+static uint8_t blend_linear(uint8_t a, uint8_t b, uint16_t t)
+{
+    uint32_t la = (uint32_t)a * a;
+    uint32_t lb = (uint32_t)b * b;
+
+    return isqrt16((la * (256u - t) + lb * t) >> 8);
+}
+
+/* dst combined with src by mode, then mixed back over dst by t / 256 */
+static inline pix_t blend_layer(pix_t dst, pix_t src, uint8_t mode, uint16_t t)
+{
+    pix_t out;
+
+    switch (mode)
+    {
+        case EFFECT_BLEND_ADD:      out = Pix_AddSat(dst, src);   break;
+        case EFFECT_BLEND_MULTIPLY: out = Pix_Multiply(dst, src); break;
+        case EFFECT_BLEND_MAX:      out = Pix_Max(dst, src);      break;
+        default:                    out = src;                    break;
+    }
+    return (t >= 256u) ? out : Pix_Blend(dst, out, t);
+}
+
+/* Render an effect over px[0..n-1] at the given phase and brightness */
+static void CACHE_HOT render_span(uint8_t id, const effect_params_t *params, const effect_state_t *state,
+                        pix_t *px, uint16_t n)
+{
+    const effect_t *fx = fx_def(id);
+
+    if (fx->pixel == NULL)
+        Plugin_Render((uint8_t)(id - EFFECT_COUNT), px, n, params, state->offset);
+    else
+        for (uint16_t i = 0; i < n; i++)
+            px[i] = fx->pixel(i, state->offset);
+
+    Pix_ScaleStrip(px, n, params->brightness);
+}
+
+/* Render one segment into fx_px, crossfading if a transition is running */
+static void CACHE_HOT render_segment(fx_segment_t *sg, uint8_t steps)
+{
+    pix_t *px = &fx_px[sg->start];
+
+    render_span(sg->cur, &sg->params, &sg->state, px, sg->count);
+
+    if (sg->prev != EFFECT_NONE)
+    {
+        pix_t   *old = &fx_old[sg->start];
+        uint16_t t   = (uint16_t)(((uint32_t)sg->fade_pos << 8) / sg->fade_len);
+
+        render_span(sg->prev, &sg->prev_params, &sg->prev_state, old, sg->count);
+        for (uint16_t i = 0; i < sg->count; i++)
+        {
+            pix_t p0 = old[i];
+            pix_t p1 = px[i];
+
+            px[i] = Pix_Make(blend_linear(Pix_R(p0), Pix_R(p1), t),
+                             blend_linear(Pix_G(p0), Pix_G(p1), t),
+                             blend_linear(Pix_B(p0), Pix_B(p1), t));
+        }
+
+        sg->prev_state.offset += (uint8_t)(sg->prev_params.speed * steps);
+
+        sg->fade_pos += steps;
+        if (sg->fade_pos >= sg->fade_len)
+            sg->prev = EFFECT_NONE;         /* fade done, new effect alone */
+    }
+
+    sg->state.offset += (uint8_t)(sg->params.speed * steps);
+}
+
+/* An effect starts on a span of n pixels: its per-pixel tables before the first frame */
+static void start_effect(uint8_t id, uint16_t n)
+{
+    if (fx_def(id)->prepare != NULL)
+        fx_def(id)->prepare(n);
+}
+
+/* Run an effect's frame hook unless it already ran this frame; busy marks hooks still changing */
+static void step_effect(uint8_t id, uint8_t steps, uint32_t *stepped, uint32_t *busy)
+{
+    if (id == EFFECT_NONE || (*stepped & (1u << id)) != 0u) return;
+
+    if (fx_def(id)->frame != NULL && fx_def(id)->frame(steps))
+        *busy |= 1u << id;
+    *stepped |= 1u << id;
+}
+
+/* True if effect id can look different next frame */
+static bool effect_live(uint8_t id, const effect_params_t *params, uint32_t busy)
+{
+    return (fx_def(id)->animated && params->speed != 0u) || ((busy & (1u << id)) != 0u);
+}
+
+static void fx_wake(void)
+{
+    TaskHandle_t t = fx_task;
+
+    if (t != NULL)
+        (void)xTaskNotifyGiveIndexed(t, EFFECTS_NOTIFY_INDEX);
+}
+
+/* -- Admission --------------------------------------------------------------- */
+
+static uint32_t          fx_budget;                     /* cycles a frame, 0 = off */
+static volatile uint32_t fx_refused;
+static volatile uint32_t fx_fades_cut;
+
+/* Effect id on n LEDs; its frame hook only the first time this scene (seen) */
+static uint32_t fx_cost(uint8_t id, uint16_t n, uint32_t *seen)
+{
+    const effect_cost_t *c = &fx_def(id)->cost;
+    uint32_t             r = c->pixel * n;
+
+    if (c->frame != 0u && (*seen & (1u << id)) == 0u)
+    {
+        *seen |= 1u << id;          /* frame hooks are built-ins, id < 32 */
+        r += c->frame;
+    }
+    return r;
+}
+
+/* Declared cycles of the scene as the segments and layers stand */
+static uint32_t fx_scene_cost(void)
+{
+    uint32_t seen = 0u;
+    uint32_t c    = 0u;
+
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS; k++)
+    {
+        const fx_segment_t *sg = &fx_seg[k];
+
+        if (sg->count == 0u) continue;
+        c += fx_cost(sg->cur, sg->count, &seen);
+        if (sg->prev != EFFECT_NONE)
+            c += fx_cost(sg->prev, sg->count, &seen) + EFFECTS_COST_FADE_PX * sg->count;
+    }
+    for (uint8_t k = 0; k < EFFECTS_MAX_LAYERS; k++)
+    {
+        if (fx_layer[k].id != EFFECT_NONE)
+            c += fx_cost(fx_layer[k].id, PIXDIST_SCENE_LEDS, &seen)
+               + EFFECTS_COST_LAYER_PX * PIXDIST_SCENE_LEDS;
+    }
+    return c;
+}
+
+/* The scene just changed to include `id`: true if it fits, cutting the fade
+ * (*fade, NULL if none can go) first; false and the caller takes it back */
+static bool fx_admit(uint8_t id, uint8_t *fade)
+{
+    uint32_t c;
+
+    if (fx_budget == 0u) return true;
+    c = fx_scene_cost();
+    if (c > fx_budget && fade != NULL && *fade != EFFECT_NONE)
+    {
+        *fade = EFFECT_NONE;
+        c = fx_scene_cost();
+        if (c <= fx_budget) fx_fades_cut++;
+    }
+    if (c <= fx_budget) return true;
+
+    fx_refused++;
+    LOG_WARN("effects: '%s' refused, the scene needs %lu of %lu cycles",
+             fx_def(id)->name, (unsigned long)c, (unsigned long)fx_budget);
+    return false;
+}
+
+/* -- Requests, shared by the direct API and the command queue ---------------- */
+
+static bool req_select(uint8_t seg, uint8_t id, uint16_t frames)
+{
+    if (seg >= EFFECTS_MAX_SEGMENTS || !fx_valid(id)) return false;
+
+    taskENTER_CRITICAL();
+    fx_req_id[seg]     = id;
+    fx_req_frames[seg] = frames;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+static bool req_layer(uint8_t layer, uint8_t id, uint8_t mode, uint8_t alpha)
+{
+    if (layer >= EFFECTS_MAX_LAYERS || !fx_valid(id) || mode >= EFFECT_BLEND_COUNT) return false;
+
+    taskENTER_CRITICAL();
+    fx_layer_req[layer]      = id;
+    fx_layer_req_mode[layer] = mode;
+    fx_layer_alpha[layer]    = alpha;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+static bool req_layer_alpha(uint8_t layer, uint8_t alpha)
+{
+    if (layer >= EFFECTS_MAX_LAYERS) return false;
+
+    fx_layer_alpha[layer] = alpha;
+    return true;
+}
+
+static bool req_clear_layer(uint8_t layer)
+{
+    if (layer >= EFFECTS_MAX_LAYERS) return false;
+
+    fx_layer_req[layer] = LAYER_CLEAR;
+    return true;
+}
+
+static bool req_frame(uint8_t id, uint16_t frames)
+{
+    if (id >= NEO_FRAME_COUNT) return false;
+
+    taskENTER_CRITICAL();
+    fx_frame_req        = id;
+    fx_frame_req_frames = frames;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/* Apply every queued command, oldest first; runs in the renderer before the requests are read */
+static void drain_commands(void)
+{
+    effect_cmd_t c;
+
+    while (xQueueReceive(fx_queue, &c, 0) == pdPASS)
+    {
+        switch (c.op)
+        {
+            case EFFECT_CMD_SELECT:      (void)req_select(c.index, c.id, c.frames);         break;
+            case EFFECT_CMD_SET_LAYER:   (void)req_layer(c.index, c.id, c.mode, c.value);   break;
+            case EFFECT_CMD_LAYER_ALPHA: (void)req_layer_alpha(c.index, c.value);           break;
+            case EFFECT_CMD_CLEAR_LAYER: (void)req_clear_layer(c.index);                    break;
+            case EFFECT_CMD_BRIGHTNESS:  NeoPixel_SetBrightness(c.value);                   break;
+            case EFFECT_CMD_FRAME:       (void)req_frame(c.id, c.frames);                   break;
+            default:                                                                        break;
+        }
+        LATBENCH_REACT();
+    }
+}
+
+/* A pending Effects_ShowFrame() starts, or ends, the hold */
+static void take_frame_request(void)
+{
+    uint8_t  id;
+    uint16_t frames;
+
+    taskENTER_CRITICAL();
+    id           = fx_frame_req;
+    frames       = fx_frame_req_frames;
+    fx_frame_req = EFFECT_NONE;
+    taskEXIT_CRITICAL();
+
+    if (id != EFFECT_NONE)
+    {
+        fx_hold_id   = id;
+        fx_hold_left = frames;
+    }
+}
+
+/* The visible layers of this frame, from render_layers() to blend_layers() */
+static uint8_t  fx_blend_mode[EFFECTS_MAX_LAYERS];
+static uint16_t fx_blend_t[EFFECTS_MAX_LAYERS];
+static uint8_t  fx_blend_idx[EFFECTS_MAX_LAYERS];
+static uint8_t  fx_layer_cap = EFFECTS_MAX_LAYERS;      /* Effects_SetLayerCap() */
+
+/* Render the visible layers into their own buffers; fx_px is not touched */
+static uint8_t CACHE_HOT render_layers(uint8_t steps)
+{
+    uint8_t n = 0u;
+
+    for (uint8_t k = 0; k < EFFECTS_MAX_LAYERS; k++)
+    {
+        fx_layer_t *ly    = &fx_layer[k];
+        uint8_t     alpha = fx_layer_alpha[k];
+
+        if (ly->id == EFFECT_NONE) continue;
+
+        if (alpha != 0u && k < fx_layer_cap)
+        {
+            render_span(ly->id, &ly->params, &ly->state, fx_lpx[k], PIXDIST_SCENE_LEDS);
+            fx_blend_mode[n] = ly->mode;
+            fx_blend_t[n]    = (uint16_t)alpha + (alpha >> 7);      /* 255 -> 256 */
+            fx_blend_idx[n]  = k;
+            n++;
+        }
+        ly->state.offset += (uint8_t)(ly->params.speed * steps);
+    }
+    return n;
+}
+
+/* Blend the n layers render_layers() rendered into fx_px in one pass */
+static void CACHE_HOT blend_layers(uint8_t n)
+{
+    for (uint16_t i = 0; i < PIXDIST_SCENE_LEDS && n != 0u; i++)
+    {
+        pix_t p = fx_px[i];
+
+        for (uint8_t k = 0; k < n; k++)
+            p = blend_layer(p, fx_lpx[fx_blend_idx[k]][i], fx_blend_mode[k], fx_blend_t[k]);
+        fx_px[i] = p;
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Effects_Init(effect_id_t id)
+{
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS; k++)
+    {
+        fx_seg[k].count = 0u;
+        fx_req_id[k]    = EFFECT_NONE;
+    }
+    for (uint8_t k = 0; k < EFFECTS_MAX_LAYERS; k++)
+    {
+        fx_layer[k].id  = EFFECT_NONE;
+        fx_layer_req[k] = EFFECT_NONE;
+    }
+    if (fx_queue == NULL)
+        fx_queue = xQueueCreateStatic(EFFECTS_QUEUE_LEN, sizeof(effect_cmd_t),
+                                      fx_queue_store, &fx_queue_buf);
+    configASSERT(fx_queue != NULL);
+    LOADTEST_NAME(fx_queue, "effects");
+    for (uint8_t k = 0; k < sizeof(fx_boot) / sizeof(fx_boot[0]); k++)
+        (void)Effects_SetSegment(k, fx_boot[k].start, fx_boot[k].count,
+                                 (k == 0u) ? id : (effect_id_t)fx_boot[k].id, NULL);
+}
+
+bool Effects_SetSegment(uint8_t seg, uint16_t start, uint16_t count,
+                        effect_id_t id, const effect_params_t *params)
+{
+    if (seg >= EFFECTS_MAX_SEGMENTS || !fx_valid((uint8_t)id)) return false;
+    if ((uint32_t)start + count > PIXDIST_SCENE_LEDS) return false;
+
+    fx_segment_t *sg  = &fx_seg[seg];
+    fx_segment_t  was = *sg;
+
+    sg->start        = start;
+    sg->count        = count;
+    sg->cur          = (uint8_t)id;
+    sg->prev         = EFFECT_NONE;
+    sg->params       = (params != NULL) ? *params : fx_def((uint8_t)id)->params;
+    sg->state.offset = 0u;
+    sg->fade_len     = 0u;
+    sg->fade_pos     = 0u;
+    if (count != 0u && !fx_admit(sg->cur, NULL))
+    {
+        *sg = was;
+        return false;
+    }
+    start_effect(sg->cur, count);
+    return true;
+}
+
+bool Effects_GetPhase(uint8_t seg, effect_id_t *id, uint8_t *offset)
+{
+    if (seg >= EFFECTS_MAX_SEGMENTS || fx_seg[seg].count == 0u) return false;
+    *id     = (effect_id_t)fx_seg[seg].cur;
+    *offset = fx_seg[seg].state.offset;
+    return true;
+}
+
+bool Effects_SetPhase(uint8_t seg, effect_id_t id, uint8_t offset)
+{
+    if (seg >= EFFECTS_MAX_SEGMENTS || fx_seg[seg].count == 0u) return false;
+    if (!Effects_SetSegment(seg, fx_seg[seg].start, fx_seg[seg].count, id, NULL)) return false;
+    fx_seg[seg].state.offset = offset;
+    return true;
+}
+
+void Effects_SelectSegment(uint8_t seg, effect_id_t id, uint16_t frames)
+{
+    if (req_select(seg, (uint8_t)id, frames))
+        fx_wake();
+}
+
+void Effects_Select(effect_id_t id, uint16_t frames)
+{
+    Effects_SelectSegment(0u, id, frames);
+}
+
+void Effects_SetLayer(uint8_t layer, effect_id_t id, effect_blend_t mode, uint8_t alpha)
+{
+    if (req_layer(layer, (uint8_t)id, (uint8_t)mode, alpha))
+        fx_wake();
+}
+
+void Effects_SetLayerAlpha(uint8_t layer, uint8_t alpha)
+{
+    if (req_layer_alpha(layer, alpha))
+        fx_wake();
+}
+
+void Effects_ClearLayer(uint8_t layer)
+{
+    if (req_clear_layer(layer))
+        fx_wake();
+}
+
+void Effects_ShowFrame(uint8_t id, uint16_t frames)
+{
+    if (req_frame(id, frames))
+        fx_wake();
+}
+
+void Effects_SetLayerCap(uint8_t n)
+{
+    fx_layer_cap = (n < EFFECTS_MAX_LAYERS) ? n : EFFECTS_MAX_LAYERS;
+}
+
+void Effects_Wake(void)
+{
+    fx_wake();
+}
+
+void Effects_WakeFromISR(void)
+{
+    BaseType_t   woken = pdFALSE;
+    TaskHandle_t t     = fx_task;
+
+    if (t == NULL) return;
+    vTaskNotifyGiveIndexedFromISR(t, EFFECTS_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+bool Effects_Post(const effect_cmd_t *cmd)
+{
+    if (xQueueSend(fx_queue, cmd, 0) != pdPASS) return false;
+
+    fx_wake();
+    return true;
+}
+
+bool Effects_PostFromISR(const effect_cmd_t *cmd)
+{
+    BaseType_t   woken = pdFALSE;
+    TaskHandle_t t     = fx_task;
+
+    if (xQueueSendFromISR(fx_queue, cmd, &woken) != pdPASS) return false;
+
+    if (t != NULL)
+        vTaskNotifyGiveIndexedFromISR(t, EFFECTS_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+    return true;
+}
+
+void Effects_WaitForChange(void)
+{
+    (void)ulTaskNotifyTakeIndexed(EFFECTS_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+}
+
+effect_id_t Effects_Current(void)
+{
+    return (effect_id_t)fx_seg[0].cur;
+}
+
+uint32_t Effects_Count(void)
+{
+    return EFFECT_COUNT + Plugin_Count();
+}
+
+const char *Effects_Name(effect_id_t id)
+{
+    return fx_valid((uint8_t)id) ? fx_def((uint8_t)id)->name : "?";
+}
+
+bool Effects_GetCost(effect_id_t id, effect_cost_t *out)
+{
+    if (!fx_valid((uint8_t)id)) return false;
+    *out = fx_def((uint8_t)id)->cost;
+    return true;
+}
+
+void Effects_SetBudget(uint32_t frame_us)
+{
+    fx_budget = (uint32_t)((uint64_t)frame_us * (FX_CPU_HZ / 1000000u) * EFFECTS_BUDGET_PCT / 100u);
+}
+
+void Effects_GetAdmit(effects_admit_t *out)
+{
+    out->budget    = fx_budget;
+    out->cost      = fx_scene_cost();
+    out->refused   = fx_refused;
+    out->fades_cut = fx_fades_cut;
+}
+
+bool CACHE_HOT Effects_Render(uint8_t steps)
+{
+    uint32_t stepped = 0u;          /* effects whose frame hook already ran */
+    uint32_t busy    = 0u;          /* ... and reported a change           */
+    bool     covered = false;
+    bool     live    = false;
+
+    fx_task = xTaskGetCurrentTaskHandle();
+    drain_commands();
+    take_frame_request();
+
+    /* A constant frame instead of the scene: one descriptor per slot, no
+     * kernels; the other requests wait for the scene to come back */
+    if (fx_hold_left != 0u)
+    {
+        fx_hold_left = (fx_hold_left > steps) ? (uint16_t)(fx_hold_left - steps) : 0u;
+        if (NeoPixel_ShowFrame((neo_frame_id_t)fx_hold_id))
+            return true;
+        fx_hold_left = 0u;
+    }
+
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS; k++)
+    {
+        fx_segment_t *sg = &fx_seg[k];
+        uint8_t  req;
+        uint16_t frames;
+
+        taskENTER_CRITICAL();
+        req           = fx_req_id[k];
+        frames        = fx_req_frames[k];
+        fx_req_id[k]  = EFFECT_NONE;
+        taskEXIT_CRITICAL();
+
+        if (sg->count == 0u) continue;
+
+        if (req != EFFECT_NONE && req != sg->cur)
+        {
+            fx_segment_t was = *sg;
+
+            /* A new request mid-fade restarts from whatever is on top now */
+            sg->prev        = (frames != 0u) ? sg->cur : EFFECT_NONE;
+            sg->prev_params = sg->params;
+            sg->prev_state  = sg->state;
+            sg->cur         = req;
+            sg->params      = fx_def(req)->params;
+            sg->state.offset = 0u;
+            sg->fade_len    = frames;
+            sg->fade_pos    = 0u;
+            if (fx_admit(req, &sg->prev)) start_effect(req, sg->count);
+            else *sg = was;
+        }
+
+        /* Stateful effects advance once per frame, however many segments show them */
+        step_effect(sg->cur, steps, &stepped, &busy);
+        step_effect(sg->prev, steps, &stepped, &busy);
+
+        covered = covered || (sg->start == 0u && sg->count == PIXDIST_SCENE_LEDS);
+    }
+
+    for (uint8_t k = 0; k < EFFECTS_MAX_LAYERS; k++)
+    {
+        fx_layer_t *ly  = &fx_layer[k];
+        fx_layer_t  was = *ly;
+        uint8_t     req;
+
+        taskENTER_CRITICAL();
+        req             = fx_layer_req[k];
+        ly->mode        = fx_valid(req) ? fx_layer_req_mode[k] : ly->mode;
+        fx_layer_req[k] = EFFECT_NONE;
+        taskEXIT_CRITICAL();
+
+        if (req == LAYER_CLEAR)
+        {
+            ly->id = EFFECT_NONE;
+        }
+        else if (req != EFFECT_NONE)
+        {
+            ly->id           = req;
+            ly->params       = fx_def(req)->params;
+            ly->state.offset = 0u;
+            if (fx_admit(req, NULL)) start_effect(req, PIXDIST_SCENE_LEDS);
+            else *ly = was;
+        }
+
+        step_effect(ly->id, steps, &stepped, &busy);
+    }
+
+    /* LEDs outside every segment stay black: the DMAC clears them while the
+     * layers render into their own buffers (dmamem.h) */
+    dmamem_t clear  = covered ? DMAMEM_DONE : DmaMem_Fill32(fx_px, 0u, PIXDIST_SCENE_LEDS);
+    uint8_t  layers = render_layers(steps);
+
+    (void)DmaMem_Wait(clear);
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS; k++)
+    {
+        if (fx_seg[k].count != 0u)
+            render_segment(&fx_seg[k], steps);
+    }
+
+    blend_layers(layers);
+
+#if PIXDIST_ROLE == PIXDIST_MASTER
+    /* The slaves' part first, so their transfer overlaps this strip's */
+    for (uint32_t b = 0; b < PIXDIST_BOARDS; b++)
+        (void)Power_Limit(&fx_px[NUM_LEDS + b * PIXDIST_BOARD_LEDS], PIXDIST_BOARD_LEDS);
+    (void)PixDist_Send(&fx_px[NUM_LEDS], NeoPixel_GetBrightness());
+#endif
+    (void)Power_Limit(fx_px, NUM_LEDS);
+    Telem_CaptureFrame(fx_px, PIXDIST_SCENE_LEDS);
+    NeoPixel_SetStrip(fx_px);
+    NeoPixel_Show();
+
+    /* A dark strip stays dark whatever plays: one black frame, then sleep
+     * until a command (closed hours, showcal.h; a brown-out) */
+    if (NeoPixel_GetBrightness() == 0u) return false;
+
+    /* Anything that can change the next frame keeps the renderer running */
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS && !live; k++)
+    {
+        const fx_segment_t *sg = &fx_seg[k];
+
+        live = (sg->count != 0u)
+            && (sg->prev != EFFECT_NONE || effect_live(sg->cur, &sg->params, busy));
+    }
+    for (uint8_t k = 0; k < EFFECTS_MAX_LAYERS && !live; k++)
+    {
+        const fx_layer_t *ly = &fx_layer[k];
+
+        live = (ly->id != EFFECT_NONE) && (fx_layer_alpha[k] != 0u)
+            && effect_live(ly->id, &ly->params, busy);
+    }
+    return live;
+}
+
+/* -- Benchmark --------------------------------------------------------------- */
+
+#if EFFECTS_BENCH_ENABLE
+
+#if !PROFILE_ENABLE
+#error "EFFECTS_BENCH_ENABLE needs PROFILE_ENABLE for the DWT slots"
+#endif
+
+#if NEO_BACKEND == NEO_BACKEND_CCL
+#define FX_BENCH_BACKEND    "ccl"
+#elif NEO_BACKEND == NEO_BACKEND_TCC
+#define FX_BENCH_BACKEND    "tcc"
+#elif NEO_STREAMING
+#define FX_BENCH_BACKEND    "spi_stream"
+#else
+#define FX_BENCH_BACKEND    "spi"
+#endif
+
+static const char * const fx_bench_slot[3] = { "render", "encode", "dma_wait" };
+
+void Effects_Benchmark(uint16_t frames)
+{
+    effect_id_t keep   = Effects_Current();
+    uint32_t    budget = fx_budget;
+
+    fx_budget = 0u;                 /* every effect runs, whatever it costs */
+    printf("bench,backend,effect,slot,frames,min,avg,max\n");
+
+    for (uint8_t id = 0; id < EFFECT_COUNT; id++)
+    {
+        Effects_Init((effect_id_t)id);
+        Profile_Reset();
+
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            PROFILE_START(t_render);
+            (void)Effects_Render(1u);
+            PROFILE_ADD(PROFILE_RENDER, t_render);
+            Profile_FrameEnd();
+        }
+
+        for (uint8_t s = 0; s < 3u; s++)
+        {
+            profile_stat_t st;
+
+            Profile_Get((profile_slot_t)(PROFILE_RENDER + s), &st);
+            printf("bench,%s,%s,%s,%lu,%lu,%lu,%lu\n", FX_BENCH_BACKEND,
+                   effect_table[id].name, fx_bench_slot[s], (unsigned long)st.frames,
+                   (unsigned long)((st.frames != 0u) ? st.min : 0u),
+                   (unsigned long)((st.frames != 0u) ? st.sum / st.frames : 0u),
+                   (unsigned long)st.max);
+        }
+    }
+
+    /* Kernel and frame hook apart, worst case: the SHOW_EFFECTS cost columns */
+    printf("cost,effect,per_led,per_frame\n");
+    for (uint8_t id = 0; id < EFFECT_COUNT; id++)
+    {
+        const effect_t *fx    = &effect_table[id];
+        effect_state_t  state = { 0u };
+        uint32_t        px = 0u, hook = 0u;
+
+        start_effect(id, PIXDIST_SCENE_LEDS);
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            uint32_t t = DWT->CYCCNT;
+
+            if (fx->frame != NULL) (void)fx->frame(1u);
+            t = DWT->CYCCNT - t;
+            if (t > hook) hook = t;
+
+            t = DWT->CYCCNT;
+            render_span(id, &fx->params, &state, fx_px, PIXDIST_SCENE_LEDS);
+            t = DWT->CYCCNT - t;
+            if (t > px) px = t;
+            state.offset += fx->params.speed;
+        }
+        printf("cost,%s,%lu,%lu\n", fx->name,
+               (unsigned long)((px + PIXDIST_SCENE_LEDS - 1u) / PIXDIST_SCENE_LEDS), (unsigned long)hook);
+    }
+
+    Profile_Reset();
+    fx_budget = budget;
+    Effects_Init(keep);
+}
+
+#endif /* EFFECTS_BENCH_ENABLE */
@@ -0,0 +1,325 @@
+/* =============================================================================
+ * effects.h  -  Effect registry, segments and crossfades for the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Every effect is a table entry holding its per-pixel render kernel, an
+ * optional per-frame hook for stateful effects (simulations) and its default
+ * parameters. The table and effect_id_t are generated from SHOW_EFFECTS in
+ * showcfg.h, the boot layout from SHOW_SEGMENTS. Effect plug-ins loaded at
+ * runtime (plugin.h) take the ids from EFFECT_COUNT up, to Effects_Count().
+ *
+ * The strip is split into up to EFFECTS_MAX_SEGMENTS segments (start, count,
+ * effect, parameters), each with its own animation phase. Effects_Render()
+ * draws every segment's effect over its own span of one packed strip
+ * (pixmath.h), applies each segment's brightness, stages the strip into the
+ * NeoPixel driver and calls Show() exactly once. Kernels see the LED index
+ * relative to their segment. Later segments draw over earlier ones where
+ * they overlap; LEDs in no segment are black.
+ *
+ * On top of the segments up to EFFECTS_MAX_LAYERS full-strip overlay layers
+ * (e.g. a scare flash over the ambient background) are composited, each with
+ * its own effect, blend mode and 0-255 alpha. Every layer is rendered to its
+ * own buffer and then all of them are blended in a single pass over the
+ * frame, lowest layer first.
+ *
+ * Effects_ShowFrame() puts one of the constant frames pre-encoded in flash
+ * (a strobe flash, a blackout) on the strip instead, for a number of frame
+ * slots, at no render or encode cost.
+ *
+ * Effects_Select*() switches a segment's effect either at once or as a
+ * crossfade over N frames. While fading both effects are rendered and mixed
+ * in linear light (gamma 2.0: square, lerp, square root), all in fixed
+ * point, so the fade looks even.
+ *
+ * Effects_Render() reports whether the next frame can differ: an effect is
+ * animated if its kernel moves with the phase (and its speed is not 0) or
+ * its frame hook says its state changed. When nothing is animated the
+ * renderer sleeps in Effects_WaitForChange() until a request from another
+ * task wakes it, so a static scene costs no CPU, DMA or tick wake-ups.
+ *
+ * Other tasks and ISRs can also post effect_cmd_t commands (Effects_Post*())
+ * to a FreeRTOS queue instead of touching the driver. The renderer drains
+ * it at the start of every frame and applies the commands in posting order,
+ * so no producer ever shares the framebuffer with Effects_Render().
+ *
+ * Every effect declares what it costs (effect_cost_t: cycles per LED and per
+ * frame, from the benchmark), and the renderer admits a change of scene by
+ * the sum, before it is drawn rather than after a frame ran late:
+ *
+ *   scene    each effect on its span, every frame hook once, a fade's
+ *            second effect and mix (EFFECTS_COST_FADE_PX), each layer and
+ *            its blend (EFFECTS_COST_LAYER_PX) whatever its alpha
+ *   budget   EFFECTS_BUDGET_PCT of the frame period (Effects_SetBudget()),
+ *            the rest left to encoding, the DMA wait and the other tasks
+ *   over     a select that would not fit cuts over instead of fading; if
+ *            the new effect alone does not fit, the select, layer or
+ *            segment is refused and the scene stays as it was
+ *
+ * fpsctl.h still sheds rate and detail when the frames measured run long;
+ * admission keeps a scene it would have to shed from starting at all.
+ * ============================================================================= */
+
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+#include "showcfg.h"
+
+#define EFFECTS_MAX_SEGMENTS    4u
+#define EFFECTS_MAX_LAYERS      2u      /* overlays above the segments, 4 bytes per scene LED */
+#define EFFECTS_NOTIFY_INDEX    1u      /* renderer wake-up; index 0 is the NeoPixel DMA's */
+#define EFFECTS_QUEUE_LEN       16u     /* effect_cmd_t commands in flight */
+#define EFFECTS_BENCH_ENABLE    0       /* 1 = benchmark every effect at boot, needs PROFILE_ENABLE */
+#define EFFECTS_BENCH_FRAMES    200u    /* frames per effect */
+#define EFFECTS_BUDGET_PCT      60u     /* of the frame period, for the declared scene cost */
+#define EFFECTS_COST_FADE_PX    240u    /* crossfade mix per LED, cycles (three isqrt16)    */
+#define EFFECTS_COST_LAYER_PX   40u     /* one layer's blend per LED, cycles                */
+
+/* One per SHOW_EFFECTS row (showcfg.h), in table order */
+#define EFFECT_X_ID(id, ...)    EFFECT_##id,
+
+typedef enum
+{
+    SHOW_EFFECTS(EFFECT_X_ID)
+    EFFECT_COUNT
+} effect_id_t;
+
+#define EFFECT_DEFAULT          SHOW_CAT(EFFECT_, SHOW_EFFECT_DEFAULT)
+
+/** How an overlay layer combines with what is below it, before its alpha. */
+typedef enum
+{
+    EFFECT_BLEND_REPLACE = 0,   /* layer colour                          */
+    EFFECT_BLEND_ADD,           /* saturating sum                        */
+    EFFECT_BLEND_MULTIPLY,      /* below x layer / 256 (tint / mask)     */
+    EFFECT_BLEND_MAX,           /* brighter of the two, per channel      */
+    EFFECT_BLEND_COUNT
+} effect_blend_t;
+
+/** Per-pixel kernel: packed colour of LED i at full brightness for the given phase. */
+typedef pix_t (*effect_pixel_fn)(uint16_t i, uint8_t offset);
+
+/**
+ * Optional frame hook: advance internal state by `steps` frame slots before
+ * the pixels are drawn. Returns true while the state is still changing.
+ */
+typedef bool (*effect_frame_fn)(uint8_t steps);
+
+/**
+ * Optional prepare hook: build what the kernel reads per pixel and that no
+ * frame changes (positions, phases), for pixels 0..count-1 of a span. Runs
+ * in the renderer each time the effect starts on a segment or layer,
+ * before its first frame, so keep it cheap when the tables already hold.
+ */
+typedef void (*effect_prepare_fn)(uint16_t count);
+
+typedef struct
+{
+    uint8_t speed;          /* phase advance per frame                    */
+    uint8_t brightness;     /* 0-255 strip scale, before global brightness */
+} effect_params_t;
+
+typedef struct
+{
+    uint8_t offset;         /* animation phase                            */
+} effect_state_t;
+
+/** Commands for Effects_Post*(); fields not used by an op are ignored. */
+typedef enum
+{
+    EFFECT_CMD_SELECT = 0,      /* Effects_SelectSegment(index, id, frames)     */
+    EFFECT_CMD_SET_LAYER,       /* Effects_SetLayer(index, id, mode, value)     */
+    EFFECT_CMD_LAYER_ALPHA,     /* Effects_SetLayerAlpha(index, value)          */
+    EFFECT_CMD_CLEAR_LAYER,     /* Effects_ClearLayer(index)                    */
+    EFFECT_CMD_BRIGHTNESS,      /* NeoPixel_SetBrightness(value)                */
+    EFFECT_CMD_FRAME,           /* Effects_ShowFrame(id, frames)                */
+    EFFECT_CMD_COUNT
+} effect_cmd_op_t;
+
+typedef struct
+{
+    uint8_t  op;            /* effect_cmd_op_t                            */
+    uint8_t  index;         /* segment or layer                           */
+    uint8_t  id;            /* effect_id_t (neo_frame_id_t for FRAME)     */
+    uint8_t  mode;          /* effect_blend_t                             */
+    uint8_t  value;         /* alpha or brightness                        */
+    uint16_t frames;        /* crossfade length                           */
+} effect_cmd_t;
+
+/** Worst case of an effect, CPU cycles at 120 MHz (the "cost" bench lines). */
+typedef struct
+{
+    uint32_t pixel;         /* kernel and brightness scale, per LED        */
+    uint32_t frame;         /* frame hook, once per frame however many spans */
+} effect_cost_t;
+
+typedef struct
+{
+    const char        *name;
+    effect_pixel_fn    pixel;
+    effect_frame_fn    frame;       /* NULL for stateless effects          */
+    effect_prepare_fn  prepare;     /* NULL: nothing per pixel to cache    */
+    bool               animated;    /* kernel output moves with the phase  */
+    effect_params_t    params;      /* defaults for new segments           */
+    effect_cost_t      cost;
+} effect_t;
+
+typedef struct
+{
+    uint32_t budget;        /* cycles per frame, 0 = everything is admitted */
+    uint32_t cost;          /* declared cost of the scene now               */
+    uint32_t refused;       /* selects, layers and segments turned down     */
+    uint32_t fades_cut;     /* selects that cut over to fit                 */
+} effects_admit_t;
+
+/**
+ * Lay the segments out as SHOW_SEGMENTS, with `id` on segment 0 (the saved
+ * effect, or EFFECT_DEFAULT); disable all other segments. Also creates the
+ * command queue, so call it before the scheduler starts.
+ */
+void Effects_Init(effect_id_t id);
+
+/**
+ * Define segment seg: `count` LEDs from `start` running `id` with `params`
+ * (NULL = the effect's defaults), phase reset, no transition. count = 0
+ * disables the segment. Returns false if seg or the span is out of range,
+ * or the scene would not fit its budget (the segment is left as it was).
+ * Call from the NeoPixel task, or before the scheduler starts.
+ */
+bool Effects_SetSegment(uint8_t seg, uint16_t start, uint16_t count,
+                        effect_id_t id, const effect_params_t *params);
+
+/**
+ * Switch segment seg to effect `id` with its default parameters. frames = 0
+ * cuts over on the next frame, otherwise the old and new effects are
+ * crossfaded over that many frames. Safe to call from any task; the request
+ * is picked up by Effects_Render().
+ */
+void Effects_SelectSegment(uint8_t seg, effect_id_t id, uint16_t frames);
+
+/** Effects_SelectSegment() on segment 0. */
+void Effects_Select(effect_id_t id, uint16_t frames);
+
+/**
+ * Effect and animation phase of segment seg (the fade target while a
+ * transition runs); false if the segment is unused. NeoPixel task.
+ */
+bool Effects_GetPhase(uint8_t seg, effect_id_t *id, uint8_t *offset);
+
+/**
+ * Restart segment seg, on its span, with `id` from phase `offset` (see
+ * resume.h). False if the segment is unused or `id` out of range. As
+ * Effects_SetSegment().
+ */
+bool Effects_SetPhase(uint8_t seg, effect_id_t id, uint8_t offset);
+
+/** Active effect of segment 0 (the fade target while a transition is running). */
+effect_id_t Effects_Current(void);
+
+/** Effect ids in use: the built-ins and, after them, the plug-ins loaded (plugin.h). */
+uint32_t Effects_Count(void);
+
+/** Registry name of effect `id` ("?" if out of range). */
+const char *Effects_Name(effect_id_t id);
+
+/** Declared cost of effect `id`; false if out of range. Any task. */
+bool Effects_GetCost(effect_id_t id, effect_cost_t *out);
+
+/**
+ * Admit scenes within EFFECTS_BUDGET_PCT of a `frame_us` frame at 120 MHz
+ * from now on; 0 admits everything. Before Effects_Init(), so the boot
+ * layout is checked too, or from the NeoPixel task.
+ */
+void Effects_SetBudget(uint32_t frame_us);
+
+/** The budget, the scene's cost and what admission turned down. Any task. */
+void Effects_GetAdmit(effects_admit_t *out);
+
+/**
+ * Put effect `id` with its default parameters on overlay layer `layer`,
+ * phase reset, combined with `mode` at `alpha` (0 = invisible, 255 = full).
+ * Safe to call from any task; takes effect on the next frame.
+ */
+void Effects_SetLayer(uint8_t layer, effect_id_t id, effect_blend_t mode, uint8_t alpha);
+
+/** Change a layer's alpha only (e.g. to fade an overlay in or out). Any task. */
+void Effects_SetLayerAlpha(uint8_t layer, uint8_t alpha);
+
+/** Remove overlay layer `layer`. Any task. */
+void Effects_ClearLayer(uint8_t layer);
+
+/**
+ * Send constant frame `id` (neo_frame_id_t, SHOW_FRAMES in showcfg.h) from
+ * flash instead of the scene for `frames` frame slots, then go back to the
+ * scene; frames = 0 ends a hold early. Nothing renders meanwhile, so
+ * effects, fades and layers pause where they are. A frame the driver
+ * cannot send (NeoPixel_ShowFrame()) leaves the scene on. Any task.
+ */
+void Effects_ShowFrame(uint8_t id, uint16_t frames);
+
+/**
+ * Composite only the overlay layers below `n` (EFFECTS_MAX_LAYERS = all);
+ * the others keep their settings and phase but are not drawn. Detail
+ * control for fpsctl.h, so keep the overlay that must show on layer 0.
+ * Render task.
+ */
+void Effects_SetLayerCap(uint8_t n);
+
+/**
+ * Render one frame of every segment (and any transition), composite the
+ * overlay layers and Show() it.
+ * steps : frame slots elapsed since the previous call (>= 1); effects and
+ *         fades advance by that many so dropped frames keep real-time speed.
+ * Returns false when the next frame would be identical (nothing animated).
+ * Must be called from the task that owns the NeoPixel driver.
+ */
+bool Effects_Render(uint8_t steps);
+
+/**
+ * Block the renderer until a request arrives (Effects_Select*(),
+ * Effects_*Layer*(), Effects_Wake()). Call from the Effects_Render() task.
+ */
+void Effects_WaitForChange(void);
+
+/** Ask the renderer for a new frame, e.g. after changing driver settings. Any task. */
+void Effects_Wake(void);
+
+/** Effects_Wake() from an ISR at or below configMAX_SYSCALL_INTERRUPT_PRIORITY. */
+void Effects_WakeFromISR(void);
+
+/**
+ * Queue a command for the next frame and wake the renderer. Never blocks.
+ * Returns false if the queue is full (the command is dropped). Any task.
+ */
+bool Effects_Post(const effect_cmd_t *cmd);
+
+/**
+ * Effects_Post() from an ISR at or below configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ * Requests a context switch on exit if the renderer was woken.
+ */
+bool Effects_PostFromISR(const effect_cmd_t *cmd);
+
+#if EFFECTS_BENCH_ENABLE
+/**
+ * Run every registered effect full-strip for `frames` frames through the
+ * built NeoPixel backend and print DWT cycles min/avg/max per frame for the
+ * render, encode and DMA-wait slots as CSV on stdout:
+ *
+ *   bench,<backend>,<effect>,<slot>,<frames>,<min>,<avg>,<max>
+ *
+ * then, per effect, its worst kernel cycles per LED and frame hook cycles,
+ * the last two columns of its SHOW_EFFECTS row:
+ *
+ *   cost,<effect>,<per LED>,<per frame>
+ *
+ * The backend is a build option, so each firmware variant reports its own;
+ * diff the lines between builds and releases. Segment 0 is restored to its
+ * effect afterwards, other segments and layers are cleared. Call from the
+ * NeoPixel task, before its frame loop.
+ */
+void Effects_Benchmark(uint16_t frames);
+#endif
+
+#endif /* EFFECTS_H */
@@ -0,0 +1,129 @@
+/* =============================================================================
+ * estop.c  -  Emergency stop: input pin to the lid relays in hardware, latched
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "estop.h"
+
+#if ESTOP_ENABLE
+
+#include "definitions.h"        /* EIC, EVSYS, TCC1, PORT, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "actuator.h"
+#include "irqprio.h"
+#include "irqstat.h"
+#include "rtos_trace.h"
+
+#define ES_LINE             (1u << ESTOP_EXTINT)
+#define ES_PORT             (&PORT_REGS->GROUP[1])      /* PB */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile bool     es_latched;
+static volatile uint32_t es_count;
+
+/* -- Handler ----------------------------------------------------------------- */
+
+/* The relays are already forced off by TCC1; the rest is bookkeeping */
+void EIC_EXTINT_6_Handler(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_ESTOP);
+    RTOS_TRACE_ISR_ENTER();
+    EIC_REGS->EIC_INTFLAG = EIC_INTFLAG_EXTINT(ES_LINE);
+    es_latched = true;
+    es_count++;
+    Actuator_EStopFromISR();
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_ESTOP);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void EStop_Init(void)
+{
+    /* PB22 input with pull-up, to EXTINT[6] (function A) */
+    ES_PORT->PORT_DIRCLR = 1u << ESTOP_PIN;
+    ES_PORT->PORT_OUTSET = 1u << ESTOP_PIN;
+    ES_PORT->PORT_PMUX[ESTOP_PIN >> 1] &= (uint8_t)~PORT_PMUX_PMUXE_Msk;
+    ES_PORT->PORT_PINCFG[ESTOP_PIN] = PORT_PINCFG_INEN_Msk | PORT_PINCFG_PULLEN_Msk | PORT_PINCFG_PMUXEN_Msk;
+
+    /* Line 6: falling edge, no filter, detected without a clock, plus an
+     * event (all enable-protected, as in dsun_sensor.c) */
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_EIC_Msk;
+    EIC_REGS->EIC_CTRLA &= (uint8_t)~EIC_CTRLA_ENABLE_Msk;
+    while ((EIC_REGS->EIC_SYNCBUSY & EIC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    EIC_REGS->EIC_CTRLA |= EIC_CTRLA_CKSEL_CLK_ULP32K;
+    EIC_REGS->EIC_CONFIG[0] = (EIC_REGS->EIC_CONFIG[0] &
+                               ~(EIC_CONFIG_SENSE6_Msk | EIC_CONFIG_FILTEN6_Msk)) |
+                              EIC_CONFIG_SENSE6_FALL;
+    EIC_REGS->EIC_ASYNCH  |= EIC_ASYNCH_ASYNCH(ES_LINE);
+    EIC_REGS->EIC_EVCTRL  |= EIC_EVCTRL_EXTINTEO(ES_LINE);
+    EIC_REGS->EIC_INTFLAG  = EIC_INTFLAG_EXTINT(ES_LINE);
+    EIC_REGS->EIC_INTENSET = EIC_INTENSET_EXTINT(ES_LINE);
+    EIC_REGS->EIC_CTRLA |= EIC_CTRLA_ENABLE_Msk;
+    while ((EIC_REGS->EIC_SYNCBUSY & EIC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    /* EXTINT6 -> TCC1 EV0; asynchronous, so no channel clock and no delay */
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_TCC1_EV_0] = EVSYS_USER_CHANNEL(ESTOP_EVSYS_CHANNEL + 1u);
+    EVSYS_REGS->CHANNEL[ESTOP_EVSYS_CHANNEL].EVSYS_CHANNEL =
+        EVSYS_CHANNEL_EVGEN(EVENT_ID_GEN_EIC_EXTINT_6) | EVSYS_CHANNEL_PATH(2U);
+
+    /* Held at power-up: latched from the start. There was no edge, so no
+     * TCC1 fault either: the relay pins are parked low on GPIO until the
+     * clear (Actuator_InitPorts() keeps them off TCC1 while latched) */
+    es_latched = EStop_Held();
+    if (es_latched)
+    {
+        PORT_REGS->GROUP[0].PORT_OUTCLR = PIN_ACT_UP | PIN_ACT_DOWN;
+        PORT_REGS->GROUP[0].PORT_PINCFG[20] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+        PORT_REGS->GROUP[0].PORT_PINCFG[21] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+        PORT_REGS->GROUP[0].PORT_DIRSET = PIN_ACT_UP | PIN_ACT_DOWN;
+    }
+
+    NVIC_SetPriority(EIC_EXTINT_6_IRQn, IRQ_PRIO_ESTOP);
+    NVIC_ClearPendingIRQ(EIC_EXTINT_6_IRQn);
+    NVIC_EnableIRQ(EIC_EXTINT_6_IRQn);
+}
+
+void EStop_TccConfig(void)
+{
+    TCC1_REGS->TCC_EVCTRL  |= TCC_EVCTRL_EVACT0_FAULT | TCC_EVCTRL_TCEI0_Msk;
+    TCC1_REGS->TCC_DRVCTRL |= TCC_DRVCTRL_NRE4_Msk | TCC_DRVCTRL_NRE5_Msk;     /* NRV4 / NRV5 = 0 */
+}
+
+bool EStop_Latched(void)
+{
+    return es_latched;
+}
+
+bool EStop_Held(void)
+{
+    return (ES_PORT->PORT_IN & (1u << ESTOP_PIN)) == 0u;
+}
+
+uint32_t EStop_Count(void)
+{
+    return es_count;
+}
+
+bool EStop_Clear(void)
+{
+    bool cleared;
+
+    taskENTER_CRITICAL();
+    cleared = !EStop_Held();
+    if (cleared)
+    {
+        /* Write one to leave the fault state; the input is inactive now */
+        TCC1_REGS->TCC_STATUS  = TCC_STATUS_FAULT0_Msk;
+        TCC1_REGS->TCC_INTFLAG = TCC_INTFLAG_FAULT0_Msk;
+        es_latched = false;
+    }
+    taskEXIT_CRITICAL();
+
+    if (cleared) (void)Actuator_EStopRelease();
+    return cleared;
+}
+
+#endif /* ESTOP_ENABLE */
@@ -0,0 +1,77 @@
+/* =============================================================================
+ * estop.h  -  Emergency stop: input pin to the lid relays in hardware, latched
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Stopping the lid in software needs the timer task to run act_off(); a
+ * press must not wait for that. The e-stop input (PB22, active low, pulled
+ * up) is EIC line ESTOP_EXTINT with asynchronous edge detection and no
+ * filter, and its event goes over EVSYS channel ESTOP_EVSYS_CHANNEL
+ * (asynchronous path) to TCC1 EV0 as a non-recoverable fault:
+ *
+ *   PB22 fall -> EIC EXTINT6 -> EVSYS -> TCC1 fault -> WO4 / WO5 low
+ *
+ * TCC1 drives PA20 / PA21 (PIN_ACT_UP / PIN_ACT_DOWN); with ESTOP_ENABLE
+ * the actuator keeps them on TCC1 for good, in software timing too (a
+ * static pattern), so the fault forces both relays off within a few gate
+ * delays of the edge, no clock, CPU or task in the path. The relay pins
+ * are not CCL outputs, which is why TCC1 and not the CCL does the cut.
+ *
+ * The TCC1 fault state is the latch: the relays stay forced off until
+ * EStop_Clear(), which refuses while the input is still held. A latch
+ * with no fault behind it (held at power-up, no edge; or TCC1 reset by the
+ * actuator since the press) parks PA20 / PA21 low on GPIO instead, off
+ * TCC1 until the clear. The same
+ * edge also interrupts (IRQ_PRIO_ESTOP): the other channels' relays and
+ * the output sequencer are switched off from the ISR, and the actuator
+ * stops every channel and refuses to drive until the clear
+ * (Actuator_EStopFromISR()). The CLI `estop` command shows and clears it.
+ *
+ * Not covered: while the EIC is reconfigured (the presence sensor arming
+ * its lines) edges are not seen for a few microseconds.
+ * ============================================================================= */
+
+#ifndef ESTOP_H
+#define ESTOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef ESTOP_ENABLE
+#define ESTOP_ENABLE            0       /* 1 = an e-stop switch is wired to PB22    */
+#endif
+#define ESTOP_PIN               22u     /* PB22, EXTINT[6] on peripheral function A */
+#define ESTOP_EXTINT            6u
+#define ESTOP_EVSYS_CHANNEL     5u      /* 0, 1: NeoPixel, 2, 3: D-SUN, 4: audio    */
+
+#if ESTOP_ENABLE
+
+/** Input, EIC line, event route and interrupt. Before Actuator_InitPorts(). */
+void EStop_Init(void);
+
+/**
+ * The fault half in TCC1 (enable-protected, so with TCC1 disabled): EV0
+ * as a non-recoverable fault, WO4 / WO5 forced low by it. For actuator.c,
+ * each time it resets TCC1.
+ */
+void EStop_TccConfig(void);
+
+/** True from a press until EStop_Clear(). Any context. */
+bool EStop_Latched(void);
+
+/** True while the input is held (low). Any context. */
+bool EStop_Held(void);
+
+/** Presses since boot. */
+uint32_t EStop_Count(void);
+
+/**
+ * Release the latch: the TCC1 fault first, then the actuator's schedules
+ * start again (Actuator_EStopRelease()). False, latch kept, while the
+ * input is still held. Any task.
+ */
+bool EStop_Clear(void);
+
+#endif /* ESTOP_ENABLE */
+
+#endif /* ESTOP_H */
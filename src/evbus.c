@@ -0,0 +1,128 @@
+/* =============================================================================
+ * evbus.c  -  Typed events between subsystems: publish, subscribe, block
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "evbus.h"
+#include "task.h"
+#include "event_groups.h"
+#include "message_buffer.h"
+#include "showclock.h"
+#include "loadtest.h"
+
+/* One event as stored: the message buffer keeps a length word in front */
+#define EVBUS_BUF_BYTES     (EVBUS_DEPTH * (sizeof(evbus_event_t) + sizeof(configMESSAGE_BUFFER_LENGTH_TYPE)) + 1u)
+
+#if EVBUS_TYPES > 32
+#error "evbus: a subscription mask holds 32 event types"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    MessageBufferHandle_t buf;
+    uint32_t              mask;
+} evbus_subscriber_t;
+
+static evbus_subscriber_t    evbus_sub[EVBUS_MAX_SUBS];
+static uint32_t              evbus_nsub;
+static uint32_t              evbus_types;           /* every subscribed type */
+static volatile uint32_t     evbus_dropped;
+
+static uint8_t               evbus_store[EVBUS_MAX_SUBS][EVBUS_BUF_BYTES];
+static StaticMessageBuffer_t evbus_buf[EVBUS_MAX_SUBS];
+
+static EventGroupHandle_t    evbus_state;
+static StaticEventGroup_t    evbus_state_buf;
+
+/* -- Delivery ---------------------------------------------------------------- */
+
+/* Copy to every subscriber of the type; the mask makes each buffer single-writer */
+static void evbus_deliver(evbus_type_t type, uint8_t arg, uint32_t value, BaseType_t *woken)
+{
+    evbus_event_t ev = { ShowClock_Now(), value, (uint8_t)type, arg };
+    UBaseType_t   mask;
+
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    for (uint32_t i = 0; i < evbus_nsub; i++)
+    {
+        if ((evbus_sub[i].mask & EVBUS_MASK(type)) == 0u) continue;
+        if (xMessageBufferSendFromISR(evbus_sub[i].buf, &ev, sizeof(ev), woken) == 0u)
+            evbus_dropped++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void EventBus_Init(void)
+{
+    evbus_state = xEventGroupCreateStatic(&evbus_state_buf);
+}
+
+evbus_sub_t EventBus_Subscribe(uint32_t mask)
+{
+    uint32_t i = evbus_nsub;
+
+    if (i >= EVBUS_MAX_SUBS) return EVBUS_NONE;
+
+    evbus_sub[i].buf  = xMessageBufferCreateStatic(sizeof(evbus_store[i]), evbus_store[i], &evbus_buf[i]);
+    evbus_sub[i].mask = mask;
+    LOADTEST_NAME(evbus_sub[i].buf, "evbus");
+    evbus_types |= mask;
+    evbus_nsub   = i + 1u;
+    return (evbus_sub_t)i;
+}
+
+bool EventBus_Receive(evbus_sub_t s, evbus_event_t *ev, TickType_t ticks)
+{
+    if (s >= evbus_nsub)
+    {
+        vTaskDelay(ticks);          /* EVBUS_NONE: the timeout still holds */
+        return false;
+    }
+    return xMessageBufferReceive(evbus_sub[s].buf, ev, sizeof(*ev), ticks) == sizeof(*ev);
+}
+
+void EventBus_Publish(evbus_type_t type, uint8_t arg, uint32_t value)
+{
+    BaseType_t woken = pdFALSE;
+
+    if ((evbus_types & EVBUS_MASK(type)) == 0u) return;     /* nobody listens */
+    evbus_deliver(type, arg, value, &woken);
+    if (woken != pdFALSE) taskYIELD();
+}
+
+void EventBus_PublishFromISR(evbus_type_t type, uint8_t arg, uint32_t value, BaseType_t *woken)
+{
+    if ((evbus_types & EVBUS_MASK(type)) == 0u) return;
+    evbus_deliver(type, arg, value, woken);
+}
+
+void EventBus_SetState(uint32_t bits, bool on)
+{
+    if (on) (void)xEventGroupSetBits(evbus_state, bits);
+    else    (void)xEventGroupClearBits(evbus_state, bits);
+}
+
+void EventBus_SetStateFromISR(uint32_t bits, bool on, BaseType_t *woken)
+{
+    if (on) (void)xEventGroupSetBitsFromISR(evbus_state, bits, woken);
+    else    (void)xEventGroupClearBitsFromISR(evbus_state, bits);
+}
+
+uint32_t EventBus_State(void)
+{
+    return (uint32_t)xEventGroupGetBitsFromISR(evbus_state);
+}
+
+uint32_t EventBus_WaitState(uint32_t bits, bool all, TickType_t ticks)
+{
+    return (uint32_t)xEventGroupWaitBits(evbus_state, bits, pdFALSE, all ? pdTRUE : pdFALSE, ticks);
+}
+
+uint32_t EventBus_Dropped(void)
+{
+    return evbus_dropped;
+}
@@ -0,0 +1,111 @@
+/* =============================================================================
+ * evbus.h  -  Typed events between subsystems: publish, subscribe, block
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A subsystem that wants to know when something happened elsewhere (a
+ * frame went out, the lid moved, the sensor saw someone, a cue came due)
+ * subscribes to those event types once and blocks in EventBus_Receive();
+ * it wakes for exactly those events, never on a poll interval. Publishers
+ * do not know who listens.
+ *
+ *   Events   each subscriber owns a message buffer of EVBUS_DEPTH events.
+ *            A publish copies the event into every buffer whose mask
+ *            has its type; a full buffer drops it and counts the drop
+ *            (EventBus_Dropped()), the publisher never waits. Publishers
+ *            may be tasks and ISRs at once: the copies are made under
+ *            the interrupt mask, so one buffer never sees two writers.
+ *   State    levels that stay true (someone is in front of the sensor,
+ *            the lid is playing a sequence) are bits of one event group.
+ *            EventBus_WaitState() blocks until they are set; nothing is
+ *            cleared by reading them.
+ *
+ * Publishers in the tree:
+ *
+ *   EVBUS_FRAME_DONE   neopixel.c   DMAC ISR       value: frames sent
+ *   EVBUS_ACTUATOR     actuator.c   timer task     arg: channel, value: relay
+ *                                                  act_op_t, ACT_OP_END when
+ *                                                  the sequence is over
+ *   EVBUS_SENSOR_EDGE  dsun_sensor  EIC ISR        value: 1 presence, 0 gone
+ *   EVBUS_CUE          actuator.c   timer task     arg: channel, value: show time
+ *   EVBUS_KNOB         knob.c       PDEC ISR       value: detents turned, int32_t
+ *   EVBUS_DISTANCE     tof.c        ToF task       arg: range status (0 valid),
+ *                                                  value: distance, mm
+ *
+ * Subscribe before the scheduler starts; the table is fixed from then on.
+ * ============================================================================= */
+
+#ifndef EVBUS_H
+#define EVBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define EVBUS_MAX_SUBS          4u      /* subscribers                            */
+#define EVBUS_DEPTH             8u      /* events buffered per subscriber         */
+
+typedef enum
+{
+    EVBUS_FRAME_DONE = 0,
+    EVBUS_ACTUATOR,
+    EVBUS_SENSOR_EDGE,
+    EVBUS_CUE,
+    EVBUS_KNOB,
+    EVBUS_DISTANCE,
+    EVBUS_TYPES
+} evbus_type_t;
+
+#define EVBUS_MASK(type)        (1u << (type))
+
+/* State bits (EventBus_WaitState()) */
+#define EVBUS_STATE_PRESENCE    (1u << 0)   /* the D-SUN sees someone    */
+#define EVBUS_STATE_LID_BUSY    (1u << 1)   /* a lid sequence is playing */
+
+typedef struct
+{
+    uint32_t t_us;              /* ShowClock_Now() at the publish */
+    uint32_t value;
+    uint8_t  type;              /* evbus_type_t */
+    uint8_t  arg;
+} evbus_event_t;
+
+/** A subscription; EVBUS_NONE if the table was full. */
+typedef uint8_t evbus_sub_t;
+#define EVBUS_NONE              0xFFu
+
+/** Create the state group. Before any other call, before the scheduler. */
+void EventBus_Init(void);
+
+/** Receive the types in `mask` (EVBUS_MASK() ORed). Before the scheduler. */
+evbus_sub_t EventBus_Subscribe(uint32_t mask);
+
+/**
+ * Next event for `s`, waiting up to `ticks`. False on timeout; EVBUS_NONE
+ * just waits the ticks out. From one task only.
+ */
+bool EventBus_Receive(evbus_sub_t s, evbus_event_t *ev, TickType_t ticks);
+
+/** Hand an event to every subscriber of its type. Task context. */
+void EventBus_Publish(evbus_type_t type, uint8_t arg, uint32_t value);
+
+/** EventBus_Publish() from an ISR; `woken` as for any FromISR call. */
+void EventBus_PublishFromISR(evbus_type_t type, uint8_t arg, uint32_t value, BaseType_t *woken);
+
+/** Set or clear state bits. Task context, or FromISR (deferred to the timer task). */
+void EventBus_SetState(uint32_t bits, bool on);
+void EventBus_SetStateFromISR(uint32_t bits, bool on, BaseType_t *woken);
+
+/** Current state bits. Any context. */
+uint32_t EventBus_State(void);
+
+/**
+ * Wait until `bits` are set (all of them, or any with all = false), up to
+ * `ticks`; returns the state bits then. Tasks only.
+ */
+uint32_t EventBus_WaitState(uint32_t bits, bool all, TickType_t ticks);
+
+/** Events dropped on full subscriber buffers since boot. */
+uint32_t EventBus_Dropped(void);
+
+#endif /* EVBUS_H */
@@ -0,0 +1,233 @@
+/* =============================================================================
+ * fastmath.c  -  8/16-bit integer waveforms and noise for effects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fastmath.h"
+
+/* -- Tables ------------------------------------------------------------------ */
+
+/* round(128 + 127.5 sin(2 pi i / 256)), clipped to 0-255 */
+const uint8_t math_sin8_lut[256] =
+{
+    128, 131, 134, 137, 140, 144, 147, 150, 153, 156, 159, 162, 165, 168, 171, 174,
+    177, 180, 183, 185, 188, 191, 194, 196, 199, 201, 204, 206, 209, 211, 214, 216,
+    218, 220, 222, 225, 227, 229, 230, 232, 234, 236, 237, 239, 240, 242, 243, 245,
+    246, 247, 248, 249, 250, 251, 252, 252, 253, 254, 254, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 254, 254, 253, 252, 252, 251, 250, 249, 248, 247,
+    246, 245, 243, 242, 240, 239, 237, 236, 234, 232, 230, 229, 227, 225, 222, 220,
+    218, 216, 214, 211, 209, 206, 204, 201, 199, 196, 194, 191, 188, 185, 183, 180,
+    177, 174, 171, 168, 165, 162, 159, 156, 153, 150, 147, 144, 140, 137, 134, 131,
+    128, 125, 122, 119, 116, 112, 109, 106, 103, 100,  97,  94,  91,  88,  85,  82,
+     79,  76,  73,  71,  68,  65,  62,  60,  57,  55,  52,  50,  47,  45,  42,  40,
+     38,  36,  34,  31,  29,  27,  26,  24,  22,  20,  19,  17,  16,  14,  13,  11,
+     10,   9,   8,   7,   6,   5,   4,   4,   3,   2,   2,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   2,   2,   3,   4,   4,   5,   6,   7,   8,   9,
+     10,  11,  13,  14,  16,  17,  19,  20,  22,  24,  26,  27,  29,  31,  34,  36,
+     38,  40,  42,  45,  47,  50,  52,  55,  57,  60,  62,  65,  68,  71,  73,  76,
+     79,  82,  85,  88,  91,  94,  97, 100, 103, 106, 109, 112, 116, 119, 122, 125
+};
+
+/* round(32767 sin(2 pi i / 256)); entry 256 closes the turn for interpolation */
+static const int16_t math_sin16_lut[257] =
+{
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+      6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+     18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+     27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+     32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+     32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+     27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+     18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+      6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+     -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+    -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+    -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+    -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+     -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+         0
+};
+
+/* Ken Perlin's reference permutation of 0-255 */
+const uint8_t math_perm[256] =
+{
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+    140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+    247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+     74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+     60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+    200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+     52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+    119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+    129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+     81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+    184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180
+};
+
+/* -- Helpers ----------------------------------------------------------------- */
+
+#define PERM(i)             math_perm[(uint8_t)(i)]
+
+/* Value of 16-bit lattice cell c */
+static inline uint8_t lattice16(uint16_t c)
+{
+    return PERM(PERM(c >> 8) + c);
+}
+
+/* 6t^5 - 15t^4 + 10t^3 on Q16 */
+static inline int32_t fade16(int32_t t)
+{
+    int64_t a = ((int64_t)t * (6 * t - (15 << 16))) >> 16;       /* 6t^2 - 15t   */
+    int64_t t3 = (((int64_t)t * t >> 16) * t) >> 16;
+
+    return (int32_t)((t3 * (a + (10 << 16))) >> 16);
+}
+
+static inline int32_t lerp16(int32_t a, int32_t b, int32_t t)
+{
+    return a + (int32_t)(((int64_t)(b - a) * t) >> 16);
+}
+
+/* Dot product of the hashed lattice gradient with (x, y), Q16 */
+static inline int32_t grad2(uint8_t h, int32_t x, int32_t y)
+{
+    switch (h & 7u)
+    {
+        case 0u: return  x + y;
+        case 1u: return -x + y;
+        case 2u: return  x - y;
+        case 3u: return -x - y;
+        case 4u: return  x;
+        case 5u: return -x;
+        case 6u: return  y;
+        default: return -y;
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+int16_t Math_Sin16(uint16_t x)
+{
+    int32_t a = math_sin16_lut[x >> 8];
+    int32_t b = math_sin16_lut[(x >> 8) + 1u];
+
+    return (int16_t)(a + (((b - a) * (int32_t)(x & 0xFFu)) >> 8));
+}
+
+uint16_t Math_Beat16(uint16_t bpm88, uint32_t ms)
+{
+    /* beats = ms x bpm / 60000; 65536 x 256 / 60000 = 279.6, so x 280 >> 16 */
+    return (uint16_t)(((uint64_t)ms * bpm88 * 280u) >> 16);
+}
+
+uint8_t Math_BeatSin8(uint16_t bpm88, uint8_t lo, uint8_t hi, uint32_t ms)
+{
+    uint8_t s = Math_Sin8(Math_Beat8(bpm88, ms));
+
+    return (uint8_t)(lo + (((uint32_t)s * (uint8_t)(hi - lo) + 128u) >> 8));
+}
+
+uint8_t Math_ValueNoise8(uint32_t x)
+{
+    uint16_t xi = (uint16_t)(x >> 8);
+
+    return Math_Lerp8(lattice16(xi), lattice16((uint16_t)(xi + 1u)), Math_Ease8((uint8_t)x));
+}
+
+uint8_t Math_ValueNoise8_2D(uint16_t x, uint16_t y, uint8_t z)
+{
+    uint8_t xi = (uint8_t)(x >> 8);
+    uint8_t yi = (uint8_t)(y >> 8);
+    uint8_t a  = PERM(PERM(xi)      + yi);
+    uint8_t b  = PERM(PERM(xi + 1u) + yi);
+    uint8_t sx = Math_Ease8((uint8_t)x);
+
+    uint8_t top = Math_Lerp8(PERM(a + z),      PERM(b + z),      sx);
+    uint8_t bot = Math_Lerp8(PERM(a + 1u + z), PERM(b + 1u + z), sx);
+
+    return Math_Lerp8(top, bot, Math_Ease8((uint8_t)y));
+}
+
+int16_t Math_Perlin16(uint32_t x, uint32_t y)
+{
+    uint8_t xi = (uint8_t)(x >> 16);
+    uint8_t yi = (uint8_t)(y >> 16);
+    int32_t fx = (int32_t)(x & 0xFFFFu);
+    int32_t fy = (int32_t)(y & 0xFFFFu);
+    int32_t u  = fade16(fx);
+    int32_t v  = fade16(fy);
+
+    uint8_t a  = PERM(PERM(xi)      + yi);
+    uint8_t b  = PERM(PERM(xi + 1u) + yi);
+
+    int32_t top = lerp16(grad2(PERM(a),      fx,           fy),
+                         grad2(PERM(b),      fx - 65536,   fy),           u);
+    int32_t bot = lerp16(grad2(PERM(a + 1u), fx,           fy - 65536),
+                         grad2(PERM(b + 1u), fx - 65536,   fy - 65536),   u);
+    int32_t n   = lerp16(top, bot, v) >> 1;                 /* |n| <= 1.0 in Q15 */
+
+    if (n >  32767) n =  32767;
+    if (n < -32767) n = -32767;
+    return (int16_t)n;
+}
+
+uint8_t Math_Perlin8(uint16_t x, uint16_t y)
+{
+    return (uint8_t)((Math_Perlin16((uint32_t)x << 8, (uint32_t)y << 8) + 32768) >> 8);
+}
+
+#if PROFILE_ENABLE
+
+#include <stdio.h>
+
+#define MATH_BENCH_CALLS    256u
+
+static volatile uint32_t math_sink;     /* keeps the calls from being optimised out */
+
+#define MATH_BENCH(name, expr)                                                  \
+    do                                                                          \
+    {                                                                           \
+        uint32_t t0 = DWT->CYCCNT;                                              \
+        for (uint32_t i = 0; i < MATH_BENCH_CALLS; i++)                         \
+            math_sink += (uint32_t)(expr);                                      \
+        printf("  %-16s %4lu\n", name,                                          \
+               (unsigned long)((DWT->CYCCNT - t0) / MATH_BENCH_CALLS));         \
+    } while (0)
+
+void Math_Benchmark(void)
+{
+    printf("fastmath: cycles per call (incl. loop)\n");
+    MATH_BENCH("sin8",          Math_Sin8((uint8_t)(i * 7u)));
+    MATH_BENCH("sin16",         Math_Sin16((uint16_t)(i * 997u)));
+    MATH_BENCH("triwave8",      Math_Triwave8((uint8_t)i));
+    MATH_BENCH("beatsin8",      Math_BeatSin8(60u << 8, 10u, 240u, i * 13u));
+    MATH_BENCH("valuenoise8",   Math_ValueNoise8(i * 37u));
+    MATH_BENCH("valuenoise8_2d", Math_ValueNoise8_2D((uint16_t)(i * 37u), (uint16_t)(i * 11u), 3u));
+    MATH_BENCH("perlin8",       Math_Perlin8((uint16_t)(i * 37u), (uint16_t)(i * 11u)));
+    MATH_BENCH("perlin16",      Math_Perlin16(i * 9473u, i * 2851u));
+}
+
+#endif /* PROFILE_ENABLE */
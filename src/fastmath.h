@@ -0,0 +1,100 @@
+/* =============================================================================
+ * fastmath.h  -  8/16-bit integer waveforms and noise for effects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Effect tasks run without FPU context (configUSE_TASK_FPU_SUPPORT 0), so
+ * every waveform here is integer only:
+ *
+ *   Math_Sin8 / Cos8      256-entry flash table, angle 0-255 = one turn
+ *   Math_Sin16 / Cos16    256-entry int16 table, linear interpolation
+ *   Math_Triwave8 / Ease8 triangle wave and 3x^2 - 2x^3 easing
+ *   Math_Beat*            sawtooth / sine oscillators at a given BPM
+ *   Math_ValueNoise8*     smoothed lattice noise, 1D and 2D
+ *   Math_Perlin8 / 16     2D gradient noise
+ *
+ * Both noise types index one 256-entry permutation table in flash (Ken
+ * Perlin's reference permutation). Positions are fixed point: 8.8 for the
+ * 8-bit functions (integer part = lattice cell), 16.16 for Math_Perlin16().
+ * With PROFILE_ENABLE, Math_Benchmark() prints the cycles per call of each.
+ * ============================================================================= */
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <stdint.h>
+#include "profile.h"
+
+extern const uint8_t math_sin8_lut[256];
+extern const uint8_t math_perm[256];
+
+/** 128 + 127.5 sin(2 pi x / 256), rounded: 0-255 around 128. */
+static inline uint8_t Math_Sin8(uint8_t x)
+{
+    return math_sin8_lut[x];
+}
+
+static inline uint8_t Math_Cos8(uint8_t x)
+{
+    return math_sin8_lut[(uint8_t)(x + 64u)];
+}
+
+/** 0 -> 254 -> 0 over one period of x. */
+static inline uint8_t Math_Triwave8(uint8_t x)
+{
+    if (x & 0x80u)
+        x = (uint8_t)(255u - x);
+    return (uint8_t)(x << 1);
+}
+
+/** Smoothstep 3x^2 - 2x^3 on 0-255. */
+static inline uint8_t Math_Ease8(uint8_t x)
+{
+    return (uint8_t)(((uint32_t)x * x * (768u - 2u * x)) >> 16);
+}
+
+/** a -> b by t / 256. */
+static inline uint8_t Math_Lerp8(uint8_t a, uint8_t b, uint8_t t)
+{
+    return (uint8_t)(a + ((((int32_t)b - a) * t) >> 8));
+}
+
+/** 32767 sin(2 pi x / 65536). */
+int16_t Math_Sin16(uint16_t x);
+
+static inline int16_t Math_Cos16(uint16_t x)
+{
+    return Math_Sin16((uint16_t)(x + 16384u));
+}
+
+/**
+ * Sawtooth phase of a bpm88 (beats per minute, 8.8) oscillator at time ms:
+ * Math_Beat16() wraps 0-65535 once per beat, Math_Beat8() is its top byte.
+ */
+uint16_t Math_Beat16(uint16_t bpm88, uint32_t ms);
+
+static inline uint8_t Math_Beat8(uint16_t bpm88, uint32_t ms)
+{
+    return (uint8_t)(Math_Beat16(bpm88, ms) >> 8);
+}
+
+/** Sine between lo and hi at bpm88, e.g. for breathing brightness. */
+uint8_t Math_BeatSin8(uint16_t bpm88, uint8_t lo, uint8_t hi, uint32_t ms);
+
+/** 1D value noise at x (24.8), 0-255, period 65536 cells. */
+uint8_t Math_ValueNoise8(uint32_t x);
+
+/** 2D value noise at (x, y) (8.8) in layer z, 0-255. */
+uint8_t Math_ValueNoise8_2D(uint16_t x, uint16_t y, uint8_t z);
+
+/** 2D Perlin noise at (x, y) (16.16), about -32767..32767. */
+int16_t Math_Perlin16(uint32_t x, uint32_t y);
+
+/** 2D Perlin noise at (x, y) (8.8), 0-255 around 128. */
+uint8_t Math_Perlin8(uint16_t x, uint16_t y);
+
+#if PROFILE_ENABLE
+/** Print cycles per call of every function above to stdout (DWT, blocking). */
+void Math_Benchmark(void);
+#endif
+
+#endif /* FASTMATH_H */
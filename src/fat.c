@@ -0,0 +1,364 @@
+/* =============================================================================
+ * fat.c  -  Minimal read-only FAT16 / FAT32 on the SD card
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fat.h"
+#include "sdcard.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include <string.h>
+
+#define FAT_SECTOR          SDCARD_BLOCK
+#define FAT_ATTR_DIR        0x10u
+#define FAT_ATTR_VOLUME     0x08u
+#define FAT_ATTR_LFN        0x0Fu
+#define FAT_DELETED         0xE5u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static bool     fat_mounted;
+static bool     fat_is32;
+static uint32_t fat_lba;                /* first FAT                      */
+static uint32_t fat_data;               /* cluster 2                      */
+static uint32_t fat_root;               /* FAT16: root dir LBA, FAT32: its cluster */
+static uint32_t fat_root_sectors;       /* FAT16 only                     */
+static uint32_t fat_spc;                /* sectors per cluster            */
+static uint32_t fat_clusters;           /* data clusters + 2              */
+
+/* Directory / boot sectors, and the one FAT sector cached for chains */
+static uint8_t  fat_buf[FAT_SECTOR]   __attribute__((aligned(4)));
+static uint8_t  fat_cache[FAT_SECTOR] __attribute__((aligned(4)));
+static uint32_t fat_cache_lba = 0xFFFFFFFFu;
+
+/* Stream reader and CLI listing share the buffers */
+static SemaphoreHandle_t fat_mutex;
+static StaticSemaphore_t fat_mutex_buf;
+
+typedef struct
+{
+    uint32_t cluster;                   /* 0 = FAT16 root area */
+    uint32_t lba;
+    uint32_t left;                      /* sectors left in the cluster / root area */
+    uint32_t i;                         /* entry in fat_buf, 16 per sector */
+} fat_dir_t;
+
+static uint16_t fat_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t fat_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* -- Clusters ---------------------------------------------------------------- */
+
+static uint32_t fat_cluster_lba(uint32_t c)
+{
+    return fat_data + (c - 2u) * fat_spc;
+}
+
+/* Next cluster in the chain; 0 at the end or on a read error */
+static uint32_t fat_next(uint32_t c)
+{
+    uint32_t off = c * (fat_is32 ? 4u : 2u);
+    uint32_t lba = fat_lba + off / FAT_SECTOR;
+    uint32_t n;
+
+    if (lba != fat_cache_lba)
+    {
+        if (!SdCard_Read(lba, fat_cache, 1u))
+        {
+            fat_cache_lba = 0xFFFFFFFFu;
+            return 0u;
+        }
+        fat_cache_lba = lba;
+    }
+    off %= FAT_SECTOR;
+    n = fat_is32 ? (fat_u32(&fat_cache[off]) & 0x0FFFFFFFu) : fat_u16(&fat_cache[off]);
+    return (n >= 2u && n < fat_clusters) ? n : 0u;
+}
+
+/* -- Directories ------------------------------------------------------------- */
+
+static bool fat_dir_open(fat_dir_t *d, uint32_t cluster)
+{
+    if (cluster == 0u && fat_is32) cluster = fat_root;
+    d->cluster = cluster;
+    d->lba     = (cluster == 0u) ? fat_root : fat_cluster_lba(cluster);
+    d->left    = (cluster == 0u) ? fat_root_sectors : fat_spc;
+    d->i       = 0u;
+    return SdCard_Read(d->lba, fat_buf, 1u);
+}
+
+/* Next raw entry, or NULL at the end of the directory */
+static const uint8_t *fat_dir_next(fat_dir_t *d)
+{
+    if (d->i == FAT_SECTOR / 32u)
+    {
+        d->i = 0u;
+        if (--d->left == 0u)
+        {
+            if (d->cluster == 0u) return NULL;
+            d->cluster = fat_next(d->cluster);
+            if (d->cluster == 0u) return NULL;
+            d->lba  = fat_cluster_lba(d->cluster);
+            d->left = fat_spc;
+        }
+        else
+        {
+            d->lba++;
+        }
+        if (!SdCard_Read(d->lba, fat_buf, 1u)) return NULL;
+    }
+
+    const uint8_t *e = &fat_buf[32u * d->i++];
+
+    return (e[0] == 0x00u) ? NULL : e;
+}
+
+/* A file or directory, not a long-name part, label, deleted slot or dot entry */
+static bool fat_dir_real(const uint8_t *e)
+{
+    return e[0] != FAT_DELETED && e[0] != '.' && e[11] != FAT_ATTR_LFN
+        && (e[11] & FAT_ATTR_VOLUME) == 0u;
+}
+
+static uint32_t fat_entry_cluster(const uint8_t *e)
+{
+    return ((uint32_t)fat_u16(&e[20]) << 16) | fat_u16(&e[26]);
+}
+
+/* "SLAM.PCM" (up to the next '/') -> "SLAM    PCM"; false if not 8.3 */
+static bool fat_name83(const char *s, uint32_t n, char out[11])
+{
+    uint32_t i = 0u, k = 0u;
+
+    memset(out, ' ', 11u);
+    for (; i < n && s[i] != '.'; i++)
+    {
+        if (k == 8u) return false;
+        out[k++] = (s[i] >= 'a' && s[i] <= 'z') ? (char)(s[i] - 32) : s[i];
+    }
+    if (k == 0u) return false;
+    if (i < n) i++;                                 /* the dot */
+    for (k = 8u; i < n; i++)
+    {
+        if (k == 11u) return false;
+        out[k++] = (s[i] >= 'a' && s[i] <= 'z') ? (char)(s[i] - 32) : s[i];
+    }
+    return true;
+}
+
+/* "SLAM    PCM" -> "SLAM.PCM" */
+static void fat_name_print(const uint8_t *e, char out[13])
+{
+    uint32_t k = 0u;
+
+    for (uint32_t i = 0; i < 8u && e[i] != ' '; i++) out[k++] = (char)e[i];
+    if (e[8] != ' ')
+    {
+        out[k++] = '.';
+        for (uint32_t i = 8u; i < 11u && e[i] != ' '; i++) out[k++] = (char)e[i];
+    }
+    out[k] = '\0';
+}
+
+/* Walk `path` from the root; the entry found is copied to `ent` */
+static bool fat_lookup(const char *path, uint8_t ent[32])
+{
+    uint32_t dir = 0u;
+
+    while (*path == '/') path++;
+    while (*path != '\0')
+    {
+        const char *end = strchr(path, '/');
+        uint32_t    n   = (end != NULL) ? (uint32_t)(end - path) : (uint32_t)strlen(path);
+        char        want[11];
+        const uint8_t *e;
+        fat_dir_t   d;
+
+        if (!fat_name83(path, n, want) || !fat_dir_open(&d, dir)) return false;
+        while ((e = fat_dir_next(&d)) != NULL)
+            if (fat_dir_real(e) && memcmp(e, want, 11u) == 0) break;
+        if (e == NULL) return false;
+        memcpy(ent, e, 32u);
+
+        path += n;
+        while (*path == '/') path++;
+        if (*path != '\0')
+        {
+            if ((ent[11] & FAT_ATTR_DIR) == 0u) return false;
+            dir = fat_entry_cluster(ent);
+        }
+    }
+    return true;
+}
+
+/* Fat_List() under the mutex */
+static bool fat_list(const char *path, uint32_t index, fat_entry_t *out)
+{
+    uint8_t        e[32];
+    const uint8_t *p;
+    uint32_t       dir = 0u;
+    fat_dir_t      d;
+
+    if (path[0] != '\0' && !(path[0] == '/' && path[1] == '\0'))
+    {
+        if (!fat_lookup(path, e) || (e[11] & FAT_ATTR_DIR) == 0u) return false;
+        dir = fat_entry_cluster(e);
+    }
+    if (!fat_dir_open(&d, dir)) return false;
+    while ((p = fat_dir_next(&d)) != NULL)
+    {
+        if (!fat_dir_real(p) || index-- != 0u) continue;
+        fat_name_print(p, out->name);
+        out->dir  = (p[11] & FAT_ATTR_DIR) != 0u;
+        out->size = fat_u32(&p[28]);
+        return true;
+    }
+    return false;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Fat_Mount(void)
+{
+    uint32_t part = 0u;
+    const uint8_t *b = fat_buf;
+
+    if (fat_mutex == NULL) fat_mutex = xSemaphoreCreateMutexStatic(&fat_mutex_buf);
+    (void)xSemaphoreTake(fat_mutex, portMAX_DELAY);
+    fat_mounted   = false;
+    fat_cache_lba = 0xFFFFFFFFu;
+
+    /* A boot sector has a jump at 0; an MBR has partition 1's type at 0x1C2 */
+    bool ok = SdCard_Read(0u, fat_buf, 1u) && fat_u16(&b[510]) == 0xAA55u;
+    if (ok && b[0] != 0xEBu && b[0] != 0xE9u)
+    {
+        uint8_t type = b[0x1C2];
+
+        part = fat_u32(&b[0x1C6]);
+        ok = (type == 0x04u || type == 0x06u || type == 0x0Eu || type == 0x0Bu || type == 0x0Cu)
+          && SdCard_Read(part, fat_buf, 1u) && fat_u16(&b[510]) == 0xAA55u;
+    }
+
+    if (ok)
+    {
+        uint32_t bps      = fat_u16(&b[11]);
+        uint32_t reserved = fat_u16(&b[14]);
+        uint32_t nfats    = b[16];
+        uint32_t roots    = fat_u16(&b[17]);
+        uint32_t total    = (fat_u16(&b[19]) != 0u) ? fat_u16(&b[19]) : fat_u32(&b[32]);
+        uint32_t fatsz    = (fat_u16(&b[22]) != 0u) ? fat_u16(&b[22]) : fat_u32(&b[36]);
+
+        fat_spc = b[13];
+        ok = bps == FAT_SECTOR && fat_spc != 0u && (fat_spc & (fat_spc - 1u)) == 0u && nfats != 0u;
+        if (ok)
+        {
+            fat_lba          = part + reserved;
+            fat_root_sectors = (roots * 32u + FAT_SECTOR - 1u) / FAT_SECTOR;
+            fat_data         = fat_lba + nfats * fatsz + fat_root_sectors;
+            fat_clusters     = (total - (fat_data - part)) / fat_spc + 2u;
+            fat_is32         = (fat_clusters - 2u) >= 65525u;
+            fat_root         = fat_is32 ? fat_u32(&b[44]) : fat_lba + nfats * fatsz;
+            ok = (fat_clusters - 2u) >= 4085u;              /* FAT12 is not handled */
+        }
+    }
+    fat_mounted = ok;
+    (void)xSemaphoreGive(fat_mutex);
+    return ok;
+}
+
+void Fat_Unmount(void)
+{
+    fat_mounted = false;
+}
+
+bool Fat_Mounted(void)
+{
+    return fat_mounted;
+}
+
+bool Fat_Open(const char *path, fat_file_t *f)
+{
+    uint8_t e[32];
+    bool    ok;
+
+    if (!fat_mounted) return false;
+    (void)xSemaphoreTake(fat_mutex, portMAX_DELAY);
+    ok = fat_lookup(path, e) && (e[11] & FAT_ATTR_DIR) == 0u;
+    if (ok)
+    {
+        f->first = fat_entry_cluster(e);
+        f->size  = fat_u32(&e[28]);
+        Fat_Rewind(f);
+    }
+    (void)xSemaphoreGive(fat_mutex);
+    return ok;
+}
+
+void Fat_Rewind(fat_file_t *f)
+{
+    f->pos     = 0u;
+    f->cluster = f->first;
+}
+
+int32_t Fat_Read(fat_file_t *f, void *dst, uint32_t len)
+{
+    const uint32_t cbytes = fat_spc * FAT_SECTOR;
+    uint8_t *d    = dst;
+    uint32_t done = 0u;
+
+    if (!fat_mounted) return -1;
+    if (len > f->size - f->pos) len = f->size - f->pos;
+
+    (void)xSemaphoreTake(fat_mutex, portMAX_DELAY);
+    while (done < len)
+    {
+        uint32_t want = (len - done + FAT_SECTOR - 1u) / FAT_SECTOR;
+        uint32_t sec  = (f->pos % cbytes) / FAT_SECTOR;
+        uint32_t last = f->cluster;
+        uint32_t n    = fat_spc - sec;
+        uint32_t got;
+
+        if (f->cluster < 2u) break;                         /* chain shorter than the size */
+
+        /* Stretch the run over clusters that follow on the card */
+        while (n < want)
+        {
+            uint32_t next = fat_next(last);
+
+            if (next != last + 1u) break;
+            last = next;
+            n += fat_spc;
+        }
+        if (n > want) n = want;
+        if (!SdCard_Read(fat_cluster_lba(f->cluster) + sec, d, n))
+        {
+            (void)xSemaphoreGive(fat_mutex);
+            return -1;
+        }
+
+        got = n * FAT_SECTOR;
+        if (got > len - done) got = len - done;
+        d      += got;
+        done   += got;
+        f->pos += got;
+
+        /* Where pos is now: inside `last`, or at the start of the one after */
+        last = f->cluster + (f->pos - 1u) / cbytes - (f->pos - got) / cbytes;
+        f->cluster = ((f->pos % cbytes) == 0u && f->pos < f->size) ? fat_next(last) : last;
+    }
+    (void)xSemaphoreGive(fat_mutex);
+    return (int32_t)done;
+}
+
+bool Fat_List(const char *path, uint32_t index, fat_entry_t *out)
+{
+    bool ok;
+
+    if (!fat_mounted) return false;
+    (void)xSemaphoreTake(fat_mutex, portMAX_DELAY);
+    ok = fat_list(path, index, out);
+    (void)xSemaphoreGive(fat_mutex);
+    return ok;
+}
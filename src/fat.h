@@ -0,0 +1,67 @@
+/* =============================================================================
+ * fat.h  -  Minimal read-only FAT16 / FAT32 on the SD card
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Enough of FAT to find a file and read it in order: the first partition
+ * of an MBR card (or a card formatted without one), FAT16 or FAT32, and
+ * 8.3 names only: long-name entries are skipped, so give show files 8.3
+ * names or open them by their short alias. Paths go through directories
+ * with '/', case-insensitive. Nothing is ever written.
+ *
+ * Fat_Read() moves whole runs of contiguous clusters with one SdCard_Read()
+ * each, straight into the caller's buffer, so a file copied onto a freshly
+ * formatted card costs one command per read however large the read. One
+ * sector of the FAT is cached for following cluster chains.
+ * ============================================================================= */
+
+#ifndef FAT_H
+#define FAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    uint32_t first;                     /* first cluster, 0 = empty file         */
+    uint32_t size;                      /* bytes                                 */
+    uint32_t pos;                       /* bytes read so far                     */
+    uint32_t cluster;                   /* cluster holding pos (pos < size)      */
+} fat_file_t;
+
+typedef struct
+{
+    char     name[13];                  /* "NAME.EXT" */
+    bool     dir;
+    uint32_t size;
+} fat_entry_t;
+
+/** Read the boot sector of an identified card (sdcard.h); false if no FAT16/32 volume. */
+bool Fat_Mount(void);
+
+/** Forget the volume (card gone); every call then fails until Fat_Mount(). */
+void Fat_Unmount(void);
+
+/** true between a good Fat_Mount() and Fat_Unmount(). */
+bool Fat_Mounted(void);
+
+/** Open `path` ("SOUNDS/SLAM.PCM") for reading from its start; false if not found. */
+bool Fat_Open(const char *path, fat_file_t *f);
+
+/** Back to the start (loop a stream). */
+void Fat_Rewind(fat_file_t *f);
+
+/**
+ * Read up to `len` bytes into `dst` (4-byte aligned, room for `len` rounded
+ * up to 512). Reads are whole sectors, so `len` must be a multiple of 512
+ * except for the one that reaches the end of the file. Returns the bytes
+ * read, 0 at the end, -1 on a card error. From a task.
+ */
+int32_t Fat_Read(fat_file_t *f, void *dst, uint32_t len);
+
+/**
+ * Entry `index` of the directory at `path` ("" = root), counting files and
+ * directories only; false past the last.
+ */
+bool Fat_List(const char *path, uint32_t index, fat_entry_t *out);
+
+#endif /* FAT_H */
@@ -0,0 +1,211 @@
+/* =============================================================================
+ * fault.c  -  Post-mortem fault record in backup RAM, relays safed, fast reboot
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fault.h"
+#include "definitions.h"        /* SCB, NVIC_SystemReset, HSRAM_*, FLASH_SIZE */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "actuator.h"
+#include "watchdog.h"
+#include "stackguard.h"
+#include "fpu.h"                /* FPU_GUARD: fpu.c has the UsageFault */
+#include "ramfunc.h"
+#include "log.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define FAULT_CODE_END      (FLASH_SIZE / 2u)       /* the running bank, mapped at 0 */
+#define FAULT_EXC_BASIC     0x10u                   /* EXC_RETURN: no FP context     */
+#define FAULT_XPSR_PAD      (1u << 9)               /* frame realigned by one word   */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Backup RAM, NOLOAD (.bkupram_noinit in the linker script): kept over the reset */
+static fault_record_t fault_rec __attribute__((section(".bkupram_noinit")));
+
+static fault_record_t fault_last;       /* Fault_Init()'s copy */
+static bool           fault_had;
+
+static bool fault_in_sram(uint32_t addr, uint32_t bytes)
+{
+    return (addr & 3u) == 0u && addr >= HSRAM_ADDR && addr <= HSRAM_ADDR + HSRAM_SIZE - bytes;
+}
+
+static void fault_copy(char *dst, const char *src, uint32_t size)
+{
+    uint32_t i = 0;
+
+    while (i < size - 1u && src[i] != '\0') { dst[i] = src[i]; i++; }
+    dst[i] = '\0';
+}
+
+/* What is true of every cause: registers, tick, the running task */
+static fault_record_t *fault_begin(uint32_t cause)
+{
+    fault_record_t *r = &fault_rec;
+
+    __disable_irq();
+    Actuator_Safe();
+
+    memset(r, 0, sizeof(*r));
+    r->cause     = cause;
+    r->exception = __get_IPSR();
+    r->cfsr      = SCB->CFSR;
+    r->hfsr      = SCB->HFSR;
+    r->mmfar     = SCB->MMFAR;
+    r->bfar      = SCB->BFAR;
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+    {
+        TaskHandle_t t = xTaskGetCurrentTaskHandle();
+
+        r->tick = xTaskGetTickCountFromISR();
+        if (fault_in_sram((uint32_t)t, 4u)) fault_copy(r->task, pcTaskGetName(t), sizeof(r->task));
+    }
+    return r;
+}
+
+/* Code addresses (Thumb, odd; flash or .ramfunc) among the stack words from `sp` up */
+static void fault_scan(fault_record_t *r, uint32_t sp)
+{
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < FAULT_SCAN_WORDS && n < FAULT_TRACE && fault_in_sram(sp, 4u); i++, sp += 4u)
+    {
+        uint32_t v = *(const uint32_t *)sp;
+
+        if ((v & 1u) != 0u && (v < FAULT_CODE_END || Ramfunc_InRam((const void *)v))) r->trace[n++] = v & ~1u;
+    }
+}
+
+static void __attribute__((noreturn)) fault_reset(fault_record_t *r)
+{
+    r->magic = FAULT_MAGIC;
+    __DSB();
+    NVIC_SystemReset();
+    for (;;) {}
+}
+
+static uint32_t fault_sp(void)
+{
+    uint32_t sp;
+
+#ifdef __arm__
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+#else
+    sp = (uint32_t)(uintptr_t)__builtin_frame_address(0);     /* tools/host */
+#endif
+    return sp;
+}
+
+/* -- Handlers ---------------------------------------------------------------- */
+
+/* These replace the weak spinning ones in exceptions.c; with FPU_GUARD
+ * fpu.c has the UsageFault, the NOCP trap */
+void __attribute__((naked, noreturn)) HardFault_Handler(void)        { FAULT_ENTRY(FAULT_HARD); }
+void __attribute__((naked, noreturn)) MemoryManagement_Handler(void) { FAULT_ENTRY(FAULT_MEMMANAGE); }
+void __attribute__((naked, noreturn)) BusFault_Handler(void)         { FAULT_ENTRY(FAULT_BUSFAULT); }
+#if !FPU_GUARD
+void __attribute__((naked, noreturn)) UsageFault_Handler(void)       { FAULT_ENTRY(FAULT_USAGE); }
+#endif
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Fault_Capture(const uint32_t *frame, uint32_t exc_return, uint32_t cause)
+{
+    fault_record_t *r  = fault_begin(cause);
+    uint32_t        sp = (uint32_t)frame;
+
+    r->exc_return = exc_return;
+    r->sp         = sp;
+    if (cause == FAULT_MEMMANAGE && StackGuard_Hit(r->cfsr, r->mmfar)) r->cause = FAULT_STACK;
+    if (cause == FAULT_WATCHDOG) fault_copy(r->late, Watchdog_Late(), sizeof(r->late));
+    if (fault_in_sram(sp, sizeof(r->frame)))
+    {
+        for (uint32_t i = 0; i < 8u; i++) r->frame[i] = frame[i];
+        sp += ((exc_return & FAULT_EXC_BASIC) != 0u) ? 8u * 4u : 26u * 4u;
+        if ((r->frame[7] & FAULT_XPSR_PAD) != 0u) sp += 4u;
+        fault_scan(r, sp);
+    }
+    fault_reset(r);
+}
+
+void Fault_Assert(const char *file, unsigned long line)
+{
+    fault_record_t *r    = fault_begin(FAULT_ASSERT);
+    const char     *base = file;
+
+    for (const char *p = file; *p != '\0'; p++)
+        if (*p == '/' || *p == '\\') base = p + 1;
+    fault_copy(r->file, base, sizeof(r->file));
+    r->line = (uint32_t)line;
+    fault_scan(r, fault_sp());
+    fault_reset(r);
+}
+
+void Fault_StackOverflow(const char *task)
+{
+    fault_record_t *r = fault_begin(FAULT_STACK);
+
+    /* The hook runs in PendSV: the name is the task that overflowed */
+    fault_copy(r->task, task, sizeof(r->task));
+    fault_reset(r);
+}
+
+void Fault_MallocFailed(void)
+{
+    fault_record_t *r = fault_begin(FAULT_MALLOC);
+
+    /* The hook runs inside pvPortMalloc(): the trace shows who asked */
+    fault_scan(r, fault_sp());
+    fault_reset(r);
+}
+
+void Fault_Init(void)
+{
+    const fault_record_t *r = &fault_last;
+    char   line[FAULT_TRACE * 9u + 1u];
+    size_t n = 0;
+
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+    if (fault_rec.magic != FAULT_MAGIC)
+    {
+        if ((RSTC_REGS->RSTC_RCAUSE & RSTC_RCAUSE_WDT_Msk) != 0u)
+            LOG_ERROR("fault: last reset was the watchdog, no record (interrupts off for a second)");
+        return;
+    }
+    fault_last      = fault_rec;
+    fault_had       = true;
+    fault_rec.magic = 0u;
+
+    LOG_ERROR("fault: last reset was a %s, task '%s', exception %lu, tick %lu",
+              Fault_CauseName(r->cause), r->task, (unsigned long)r->exception, (unsigned long)r->tick);
+    if (r->cause == FAULT_ASSERT)
+        LOG_ERROR("fault: assert at %s:%lu", r->file, (unsigned long)r->line);
+    if (r->cause == FAULT_WATCHDOG)
+        LOG_ERROR("fault: '%s' missed its heartbeat", r->late);
+    if (r->frame[6] != 0u)
+        LOG_ERROR("fault: pc %08lx lr %08lx cfsr %08lx hfsr %08lx",
+                  (unsigned long)r->frame[6], (unsigned long)r->frame[5],
+                  (unsigned long)r->cfsr, (unsigned long)r->hfsr);
+    for (uint32_t i = 0; i < FAULT_TRACE && r->trace[i] != 0u; i++)
+        n += Log_Format(line + n, sizeof(line) - n, " %08lx", (unsigned long)r->trace[i]);
+    if (n != 0u) LOG_ERROR("fault: trace%s", line);
+}
+
+const fault_record_t *Fault_Last(void)
+{
+    return fault_had ? &fault_last : NULL;
+}
+
+const char *Fault_CauseName(uint32_t cause)
+{
+    static const char *const name[] =
+    {
+        "?", "HardFault", "MemManage", "BusFault", "UsageFault", "unhandled IRQ", "assert", "stack overflow",
+        "watchdog", "heap exhausted"
+    };
+
+    return (cause < sizeof(name) / sizeof(name[0])) ? name[cause] : name[0];
+}
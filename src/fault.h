@@ -0,0 +1,120 @@
+/* =============================================================================
+ * fault.h  -  Post-mortem fault record in backup RAM, relays safed, fast reboot
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * An unattended prop that faults must not sit frozen with a relay closed
+ * until someone cycles the power. Every way to die ends in Fault_Capture():
+ *
+ *   HardFault, MemManage, BusFault, UsageFault   the handlers below
+ *   an interrupt nobody serves                   Dummy_Handler (interrupts.c)
+ *   configASSERT() / a stack overflow            freertos_hooks.c, stackguard.h
+ *   a missed heartbeat                           watchdog.h's early warning
+ *
+ * which, with interrupts masked, opens every relay straight on the PORT
+ * (the actuator's task and timers are not trusted any more), writes one
+ * record and resets at once. The record lives in backup RAM in a NOLOAD
+ * section, so neither the reset nor start-up clears it:
+ *
+ *   - the stacked r0-r3, r12, lr, pc and xPSR, EXC_RETURN and the stack
+ *     pointer of the frame, for the exceptions;
+ *   - CFSR, HFSR, MMFAR and BFAR;
+ *   - the task that was running, the active exception if any, the tick;
+ *   - the source file and line of an assert, the overflowing task, or
+ *     the task that missed its watchdog heartbeat;
+ *   - a short trace: code addresses found on the stack above the frame,
+ *     most recent first. They are return-address candidates, not an
+ *     unwound call chain; look them up in the .map or with addr2line.
+ *
+ * Fault_Init() on the next boot takes the record, logs it and clears it;
+ * the CLI `fault` command prints it in full until the following reset.
+ * A stacked frame that is not in SRAM (a stack pointer run wild) is not
+ * read, so the capture cannot fault on its own.
+ * ============================================================================= */
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <stdint.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define FAULT_TRACE             8u      /* code addresses kept from the stack     */
+#define FAULT_SCAN_WORDS        128u    /* stack words searched for them          */
+
+#define FAULT_MAGIC             0x544C4146u     /* "FALT" */
+
+/* Causes: plain numbers, the entry macro pastes them into assembly */
+#define FAULT_HARD              1
+#define FAULT_MEMMANAGE         2
+#define FAULT_BUSFAULT          3
+#define FAULT_USAGE             4
+#define FAULT_IRQ               5       /* unhandled interrupt, see `exception`   */
+#define FAULT_ASSERT            6       /* configASSERT(): `file`, `line`         */
+#define FAULT_STACK             7       /* stack guard or overflow hook: `task`   */
+#define FAULT_WATCHDOG          8       /* early warning: `late`                  */
+#define FAULT_MALLOC            9       /* pvPortMalloc() failed: `task`, `trace` */
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t cause;             /* FAULT_*                                        */
+    uint32_t exception;         /* IPSR: 0 thread mode, else the exception number */
+    uint32_t tick;              /* xTaskGetTickCount() at the fault               */
+    uint32_t frame[8];          /* r0 r1 r2 r3 r12 lr pc xpsr, 0 without a frame  */
+    uint32_t exc_return;
+    uint32_t sp;                /* where the frame was                            */
+    uint32_t cfsr;
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    uint32_t line;
+    char     file[24];          /* basename, assert only                          */
+    char     task[16];          /* "" before the scheduler                        */
+    char     late[16];          /* watchdog only: the task that missed            */
+    uint32_t trace[FAULT_TRACE];
+} fault_record_t;
+
+/* Exception entry: the frame is on MSP or PSP by EXC_RETURN bit 2; hand it,
+ * EXC_RETURN and the cause to Fault_Capture(). For naked handlers only. The
+ * host simulation (tools/host) has no exception frame: the cause alone */
+#define FAULT_STR_(x)           #x
+#define FAULT_STR(x)            FAULT_STR_(x)
+#ifndef __arm__
+#define FAULT_ENTRY(cause)      Fault_Capture(NULL, 0u, (cause))
+#else
+#define FAULT_ENTRY(cause)                          \
+    __asm volatile ("tst   lr, #4           \n"     \
+                    "ite   eq               \n"     \
+                    "mrseq r0, msp          \n"     \
+                    "mrsne r0, psp          \n"     \
+                    "mov   r1, lr           \n"     \
+                    "movs  r2, #" FAULT_STR(cause) "\n" \
+                    "b     Fault_Capture    \n")
+#endif
+
+/** Record a fault, safe the relays and reset. From FAULT_ENTRY(); `frame` may be NULL. */
+void Fault_Capture(const uint32_t *frame, uint32_t exc_return, uint32_t cause) __attribute__((noreturn));
+
+/** Record a failed configASSERT() and reset. */
+void Fault_Assert(const char *file, unsigned long line) __attribute__((noreturn));
+
+/** Record a task's stack overflow and reset. */
+void Fault_StackOverflow(const char *task) __attribute__((noreturn));
+
+/** Record a failed pvPortMalloc() (the heap is exhausted) and reset. */
+void Fault_MallocFailed(void) __attribute__((noreturn));
+
+/**
+ * Take the last boot's record, if any, and log it (or a watchdog reset
+ * that left none); enable the MemManage,
+ * BusFault and UsageFault handlers (otherwise all three escalate to
+ * HardFault). After Rtt_Init(), before the scheduler.
+ */
+void Fault_Init(void);
+
+/** The record Fault_Init() took, NULL if the last reset was not a fault. Any task. */
+const fault_record_t *Fault_Last(void);
+
+/** Short name of a FAULT_* cause. */
+const char *Fault_CauseName(uint32_t cause);
+
+#endif /* FAULT_H */
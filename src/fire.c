@@ -0,0 +1,89 @@
+/* =============================================================================
+ * fire.c  -  Heat-diffusion fire simulation for the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fire.h"
+#include "neopixel.h"
+#include "pixdist.h"
+#include "palette.h"
+#include "rng.h"
+#include "cache.h"
+#include <string.h>
+
+/* Largest random cooling per step, scaled so the flame height suits the strip */
+#define FIRE_COOL_MAX       ((uint8_t)(((FIRE_COOLING * 10u) / PIXDIST_SCENE_LEDS) + 2u))
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint8_t  fire_heat[PIXDIST_SCENE_LEDS];
+static uint32_t fire_rng = 1u;
+
+/* xorshift32; cheap enough to draw per LED and never returns 0 once seeded */
+static inline uint32_t fire_rand(void)
+{
+    uint32_t x = fire_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fire_rng = x;
+    return x;
+}
+
+/* Random 0..range-1 without a divide */
+static inline uint8_t fire_rand8(uint8_t range)
+{
+    return (uint8_t)(((fire_rand() & 0xFFu) * range) >> 8);
+}
+
+static void fire_step(void)
+{
+    /* 1. Cool down every cell a little */
+    for (uint16_t i = 0; i < PIXDIST_SCENE_LEDS; i++)
+    {
+        uint8_t cool = fire_rand8(FIRE_COOL_MAX);
+        fire_heat[i] = (fire_heat[i] > cool) ? (uint8_t)(fire_heat[i] - cool) : 0u;
+    }
+
+    /* 2. Heat drifts up and diffuses; x / 3 as (x * 171) >> 9 for x <= 765 */
+    for (uint16_t k = PIXDIST_SCENE_LEDS - 1u; k >= 2u; k--)
+    {
+        uint16_t sum = (uint16_t)fire_heat[k - 1u] + fire_heat[k - 2u] + fire_heat[k - 2u];
+        fire_heat[k] = (uint8_t)(((uint32_t)sum * 171u) >> 9);
+    }
+
+    /* 3. Randomly ignite a new spark near the base */
+    if ((fire_rand() & 0xFFu) < FIRE_SPARKING)
+    {
+        uint8_t  y   = fire_rand8(FIRE_SPARK_ZONE);
+        uint16_t hot = (uint16_t)fire_heat[y] + 160u + fire_rand8(96u);
+        fire_heat[y] = (hot > 255u) ? 255u : (uint8_t)hot;
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Fire_Init(void)
+{
+    memset(fire_heat, 0, sizeof(fire_heat));
+
+    fire_rng = Rng_Next32();
+    if (fire_rng == 0u)
+        fire_rng = 1u;                  /* xorshift would stick at zero */
+}
+
+bool Fire_Update(uint8_t steps)
+{
+    if (steps > FIRE_MAX_STEPS)
+        steps = FIRE_MAX_STEPS;
+
+    for (uint8_t s = 0; s < steps; s++)
+        fire_step();
+    return true;
+}
+
+pix_t CACHE_HOT Fire_Pixel(uint16_t i, uint8_t offset)
+{
+    (void)offset;
+    return Palette_Lookup(PALETTE_HEAT, fire_heat[i]);
+}
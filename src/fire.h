@@ -0,0 +1,43 @@
+/* =============================================================================
+ * fire.h  -  Heat-diffusion fire simulation for the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Stateful fire in the style of "Fire2012": every LED holds an 8-bit heat
+ * value, LED 0 being the base of the flame. Each simulation step
+ *
+ *   1. cools every cell by a small random amount,
+ *   2. lets heat drift upwards: h[k] = (h[k-1] + 2 h[k-2]) / 3,
+ *   3. may ignite a spark near the base,
+ *
+ * and Fire_Pixel() maps heat through the heat palette. Everything is 8-bit
+ * fixed point with no divides; randomness comes from an xorshift generator
+ * seeded from rng.h, so the per-step cost is a fixed O(PIXDIST_SCENE_LEDS) loop.
+ * ============================================================================= */
+
+#ifndef FIRE_H
+#define FIRE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define FIRE_COOLING        55u         /* 20-100: higher = shorter flames        */
+#define FIRE_SPARKING       120u        /* 50-200: chance of a spark per step /256 */
+#define FIRE_SPARK_ZONE     7u          /* sparks land in LEDs 0..ZONE-1          */
+#define FIRE_MAX_STEPS      4u          /* steps simulated per frame, at most     */
+
+/** Clear the heat array and seed the generator from rng.h (before the scheduler). */
+void Fire_Init(void);
+
+/**
+ * Advance the simulation by `steps` frame slots, capped at FIRE_MAX_STEPS so
+ * a late frame never costs more than that many passes. Effect frame hook;
+ * the flame never settles, so it always returns true.
+ */
+bool Fire_Update(uint8_t steps);
+
+/** Per-pixel kernel for the effect registry: heat of LED i through the heat palette. */
+pix_t Fire_Pixel(uint16_t i, uint8_t offset);
+
+#endif /* FIRE_H */
@@ -0,0 +1,162 @@
+/* =============================================================================
+ * fpsctl.c  -  Frame rate and effect detail that follow the render load
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fpsctl.h"
+#include "neopixel.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define FC_CYCLES_US        (configCPU_CLOCK_HZ / 1000000u)
+#define FC_NOT_PROBING      0xFFFFFFFFu
+
+static const fpsctl_rung_t fc_ladder[] = FPSCTL_LADDER;
+
+#define FC_RUNGS            (sizeof(fc_ladder) / sizeof(fc_ladder[0]))
+
+_Static_assert(FPSCTL_UP_PCT < FPSCTL_LOAD_PCT, "FPSCTL_UP_PCT must leave room below FPSCTL_LOAD_PCT");
+_Static_assert(FPSCTL_UP_WINDOWS <= FPSCTL_HOLD_MAX, "FPSCTL_HOLD_MAX is below FPSCTL_UP_WINDOWS");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Written by the render task; Get() copies them with interrupts masked */
+static uint32_t fc_period_us;               /* base slot */
+static uint32_t fc_top;                     /* best rung the wire time allows */
+static uint32_t fc_rung;
+static uint32_t fc_n;                       /* frames of this window */
+static uint32_t fc_over;                    /* ... over FPSCTL_LOAD_PCT */
+static uint32_t fc_peak;                    /* us, this window */
+static uint32_t fc_last_peak;               /* us, the window before */
+static uint32_t fc_quiet;                   /* windows in a row that fit the rung above */
+static uint32_t fc_hold = FPSCTL_UP_WINDOWS;
+static uint32_t fc_since_up = FC_NOT_PROBING;   /* windows since the last rise */
+static uint32_t fc_downs, fc_ups;
+
+/* Base slots per frame of rung r; the frame timer does not change its rate */
+static uint32_t fc_div(uint32_t r)
+{
+    return NEO_HW_FRAME_START ? 1u : fc_ladder[r].divider;
+}
+
+static uint32_t fc_rung_us(uint32_t r)
+{
+    return fc_period_us * fc_div(r);
+}
+
+#if FPSCTL_ENABLE
+
+static void fc_apply(void)
+{
+    Particles_SetCap(fc_ladder[fc_rung].particles);
+    Effects_SetLayerCap(fc_ladder[fc_rung].layers);
+}
+
+static void fc_window_reset(void)
+{
+    fc_n    = 0u;
+    fc_over = 0u;
+    fc_peak = 0u;
+}
+
+static void fc_down(void)
+{
+    fc_last_peak = fc_peak;
+    fc_window_reset();
+    fc_quiet = 0u;
+    if (fc_rung + 1u >= FC_RUNGS) return;       /* the bottom: frames will be late */
+
+    if (fc_since_up < fc_hold)                  /* the last rise did not hold */
+        fc_hold = (2u * fc_hold < FPSCTL_HOLD_MAX) ? 2u * fc_hold : FPSCTL_HOLD_MAX;
+    fc_since_up = FC_NOT_PROBING;
+    fc_rung++;
+    fc_downs++;
+    fc_apply();
+}
+
+static void fc_up(void)
+{
+    fc_quiet    = 0u;
+    fc_since_up = 0u;
+    fc_rung--;
+    fc_ups++;
+    fc_apply();
+}
+
+#endif /* FPSCTL_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void FpsCtl_Init(uint32_t period_us)
+{
+    fc_period_us = period_us;
+#if FPSCTL_ENABLE
+    while (fc_top + 1u < FC_RUNGS && fc_rung_us(fc_top) < NEO_WIRE_US)
+        fc_top++;
+    fc_rung = fc_top;
+    fc_apply();
+#endif
+}
+
+void FpsCtl_Frame(uint32_t cycles)
+{
+#if FPSCTL_ENABLE
+    uint32_t us     = cycles / FC_CYCLES_US;
+    uint32_t period = fc_rung_us(fc_rung);
+
+    if (us > fc_peak) fc_peak = us;
+    if (us > period) { fc_down(); return; }
+    if ((uint64_t)us * 100u > (uint64_t)period * FPSCTL_LOAD_PCT && ++fc_over >= FPSCTL_DOWN_FRAMES)
+    {
+        fc_down();
+        return;
+    }
+    if (++fc_n < FPSCTL_WINDOW) return;
+
+    /* A rise that lasted the hold is good: let the next one come sooner */
+    if (fc_since_up != FC_NOT_PROBING && ++fc_since_up >= fc_hold)
+    {
+        fc_since_up = FC_NOT_PROBING;
+        fc_hold     = (fc_hold / 2u > FPSCTL_UP_WINDOWS) ? fc_hold / 2u : FPSCTL_UP_WINDOWS;
+    }
+
+    if (fc_rung > fc_top &&
+        (uint64_t)fc_peak * 100u <= (uint64_t)fc_rung_us(fc_rung - 1u) * FPSCTL_UP_PCT)
+    {
+        if (++fc_quiet >= fc_hold) fc_up();
+    }
+    else
+        fc_quiet = 0u;
+
+    fc_last_peak = fc_peak;
+    fc_window_reset();
+#else
+    (void)cycles;
+#endif
+}
+
+uint32_t FpsCtl_Divider(void)
+{
+#if FPSCTL_ENABLE
+    return fc_div(fc_rung);
+#else
+    return 1u;
+#endif
+}
+
+uint32_t FpsCtl_Rung(void)
+{
+    return fc_rung;
+}
+
+void FpsCtl_Get(fpsctl_status_t *out)
+{
+    taskENTER_CRITICAL();
+    out->rung    = fc_rung;
+    out->fps_q4  = (fc_period_us != 0u) ? 16000000u / fc_rung_us(fc_rung) : 0u;
+    out->peak_us = fc_last_peak;
+    out->hold    = fc_hold;
+    out->downs   = fc_downs;
+    out->ups     = fc_ups;
+    taskEXIT_CRITICAL();
+}
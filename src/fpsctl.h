@@ -0,0 +1,96 @@
+/* =============================================================================
+ * fpsctl.h  -  Frame rate and effect detail that follow the render load
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A frame that overruns its slot repeats the last one and the next moves
+ * by two slots: a stutter. Heavier scenes (particles, overlay layers, long
+ * strips) should instead run at a lower rate that they can hold, with
+ * every frame on time. The controller walks a ladder of rungs, best first:
+ *
+ *   { frame divider, particle cap, overlay layers }
+ *
+ * The divider runs the render task every n-th slot of the base rate
+ * (NEO_TARGET_FPS, main.c), so 50, 25, 16.7 and 12.5 fps at 50 Hz: whole
+ * slots, each frame advancing the animation by the same n steps. The
+ * particle cap (Particles_SetCap()) and the layer count
+ * (Effects_SetLayerCap()) shed detail where a lower rate alone does not
+ * fit.
+ *
+ * The cost of a frame is the render task's Effects_Render(): the kernels,
+ * compositing, encoding and the wait for the previous frame to leave the
+ * wire. Per rung:
+ *
+ *   down   a frame over its whole period, or FPSCTL_DOWN_FRAMES frames in
+ *          one window over FPSCTL_LOAD_PCT of it: one rung down, at once
+ *   up     FPSCTL_UP_WINDOWS windows of FPSCTL_WINDOW frames whose peak
+ *          fits FPSCTL_UP_PCT of the next faster rung's period. A rise
+ *          that falls again inside the hold doubles the hold (up to
+ *          FPSCTL_HOLD_MAX windows), so a scene on the edge settles on
+ *          the lower rung instead of hunting between the two
+ *
+ * Rungs whose period is shorter than the strip's wire time (NEO_WIRE_US)
+ * are never used. With NEO_HW_FRAME_START the frame timer keeps its rate,
+ * and only the detail of the rungs applies. A static scene, paused in
+ * Effects_WaitForChange(), keeps its rung.
+ * ============================================================================= */
+
+#ifndef FPSCTL_H
+#define FPSCTL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "particles.h"
+#include "effects.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef FPSCTL_ENABLE
+#define FPSCTL_ENABLE           1       /* 0 = fixed rate and full detail       */
+#endif
+#define FPSCTL_LADDER                                                           \
+    {                                                                           \
+        { 1u, PARTICLES_MAX,      EFFECTS_MAX_LAYERS      },                    \
+        { 2u, PARTICLES_MAX,      EFFECTS_MAX_LAYERS      },                    \
+        { 2u, PARTICLES_MAX / 2u, EFFECTS_MAX_LAYERS      },                    \
+        { 3u, PARTICLES_MAX / 2u, EFFECTS_MAX_LAYERS - 1u },                    \
+        { 4u, PARTICLES_MAX / 4u, 1u                      },                    \
+    }
+#define FPSCTL_WINDOW           32u     /* frames per peak window               */
+#define FPSCTL_LOAD_PCT         85u     /* a rung holds while frames fit this   */
+#define FPSCTL_DOWN_FRAMES      3u      /* ... over it in one window: step down */
+#define FPSCTL_UP_PCT           60u     /* faster rung's period the peak fits   */
+#define FPSCTL_UP_WINDOWS       4u      /* quiet windows before stepping up     */
+#define FPSCTL_HOLD_MAX         64u     /* windows, after repeated failed rises */
+
+typedef struct
+{
+    uint8_t divider;            /* base frame slots per frame */
+    uint8_t particles;          /* Particles_SetCap()         */
+    uint8_t layers;             /* Effects_SetLayerCap()      */
+} fpsctl_rung_t;
+
+typedef struct
+{
+    uint32_t rung;              /* 0 = best */
+    uint32_t fps_q4;            /* the rung's rate, fps x 16 */
+    uint32_t peak_us;           /* costliest frame of the last window */
+    uint32_t hold;              /* quiet windows the next rise waits for */
+    uint32_t downs;             /* steps down since boot */
+    uint32_t ups;
+} fpsctl_status_t;
+
+/** The base frame period, in us; starts on the best rung the wire allows. Before the render task. */
+void FpsCtl_Init(uint32_t period_us);
+
+/** One frame's Effects_Render() took `cycles` at full CPU speed. Render task. */
+void FpsCtl_Frame(uint32_t cycles);
+
+/** Base frame slots until the next frame (1 when the rate is fixed). Render task. */
+uint32_t FpsCtl_Divider(void);
+
+/** The rung in use, for telemetry. Any task. */
+uint32_t FpsCtl_Rung(void);
+
+/** The controller's state. Any task. */
+void FpsCtl_Get(fpsctl_status_t *out);
+
+#endif /* FPSCTL_H */
@@ -0,0 +1,121 @@
+/* =============================================================================
+ * fpu.c  -  Which tasks may use the M4F floating-point unit
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fpu.h"
+#include "fault.h"
+#include "definitions.h"        /* core_cm4.h: SCB */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define FPU_CPACR_CP10_CP11 (0xFu << 20)    /* full access to CP10 and CP11 */
+#define FPU_CFSR_NOCP_BIT   19              /* SCB_CFSR_NOCP_Msk, for the asm */
+
+_Static_assert((1ul << FPU_CFSR_NOCP_BIT) == SCB_CFSR_NOCP_Msk, "FPU_CFSR_NOCP_BIT");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* FP users; written with interrupts masked, read by the switch hook */
+static const void *volatile fpu_task[FPU_MAX_TASKS];
+static volatile uint32_t    fpu_tasks;
+static volatile uint32_t    fpu_strays;
+static volatile uint32_t    fpu_isr_strays;
+static const char *volatile fpu_stray_name;     /* latest stray task */
+
+static void fpu_add(const void *tcb)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    for (uint32_t i = 0; i < fpu_tasks; i++)
+        if (fpu_task[i] == tcb) tcb = NULL;
+    if (tcb != NULL && fpu_tasks < FPU_MAX_TASKS) fpu_task[fpu_tasks++] = tcb;
+    __set_PRIMASK(primask);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Fpu_Init(void)
+{
+#if FPU_GUARD
+    SCB->SHCSR |= SCB_SHCSR_USGFAULTENA_Msk;    /* NOCP to UsageFault, not HardFault */
+#endif
+}
+
+void Fpu_TaskUses(void *task)
+{
+    fpu_add(task);
+}
+
+void Fpu_SwitchedIn(const void *tcb)
+{
+#if FPU_GUARD
+    uint32_t on = (fpu_tasks == FPU_MAX_TASKS);     /* table full: guard off */
+
+    for (uint32_t i = 0; i < fpu_tasks && !on; i++)
+        if (fpu_task[i] == tcb) on = 1u;
+
+    /* Exception return from PendSV synchronises the write */
+    if (on) SCB->CPACR |= FPU_CPACR_CP10_CP11;
+    else    SCB->CPACR &= ~FPU_CPACR_CP10_CP11;
+#else
+    (void)tcb;
+#endif
+}
+
+uint32_t Fpu_Strays(void)
+{
+    return fpu_strays;
+}
+
+uint32_t Fpu_IsrStrays(void)
+{
+    return fpu_isr_strays;
+}
+
+const char *Fpu_LastStray(void)
+{
+    return fpu_stray_name;
+}
+
+#if FPU_GUARD
+void Fpu_NocpTrap(void);
+
+/* Replaces fault.c's handler. A NOCP fault, an FP instruction with the FPU
+ * off, branches to Fpu_NocpTrap() with LR still EXC_RETURN, so its return
+ * resumes the instruction; any other usage fault goes to Fault_Capture()
+ * with its frame, as fault.c's own handler would */
+void __attribute__((naked)) UsageFault_Handler(void)
+{
+#ifdef __arm__
+    __asm volatile ("ldr   r0, =0xE000ED28  \n"     /* SCB->CFSR */
+                    "ldr   r0, [r0]         \n"
+                    "tst   r0, #(1 << " FAULT_STR(FPU_CFSR_NOCP_BIT) ")\n"
+                    "bne   Fpu_NocpTrap     \n");
+#endif
+    FAULT_ENTRY(FAULT_USAGE);
+}
+
+/* The task becomes an FP user; from UsageFault_Handler() only */
+void Fpu_NocpTrap(void)
+{
+    SCB->CFSR   = SCB_CFSR_NOCP_Msk;             /* write one to clear */
+    SCB->CPACR |= FPU_CPACR_CP10_CP11;
+    if ((SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) != 0u)
+    {
+        /* Thread mode was interrupted: the running task */
+        TaskHandle_t t = xTaskGetCurrentTaskHandle();
+
+        fpu_add(t);
+        fpu_stray_name = pcTaskGetName(t);
+        fpu_strays++;
+    }
+    else
+    {
+        fpu_isr_strays++;
+    }
+    __DSB();
+    __ISB();
+}
+#endif /* FPU_GUARD */
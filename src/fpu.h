@@ -0,0 +1,62 @@
+/* =============================================================================
+ * fpu.h  -  Which tasks may use the M4F floating-point unit
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The ARM_CM4F port always preserves the FPU per task, lazily: the core
+ * sets CONTROL.FPCA on a task's first FP instruction, only such tasks get
+ * the extended exception frame (S0-S15, FPSCR, stacked by hardware only if
+ * the handler itself touches the FPU) and PendSV saves S16-S31 only for
+ * them. A task that never executes an FP instruction pays one branch per
+ * switch. configUSE_TASK_FPU_SUPPORT is not read by this port.
+ *
+ * What is left to get wrong is an integer task picking up FP instructions
+ * by accident (a float in a helper, a soft spill of the compiler into S
+ * registers): from then on it carries the FP context too. So FP users are
+ * declared with Fpu_TaskUses(), and with FPU_GUARD every other task runs
+ * with the FPU switched off (CPACR, on every switch-in; the port turns it
+ * on once more for the very first task). Its first FP
+ * instruction then raises a NOCP UsageFault, which is handled here: the
+ * task is logged as a stray, added to the FP users and resumed where it
+ * stopped, so the guard reports instead of halting. Fpu_Strays() counts
+ * them; the CLI "top" command names the latest.
+ *
+ * An FP user needs FPU_TASK_STACK_EXTRA more words of stack for the
+ * extended frame and S16-S31. Interrupt handlers should keep to integer
+ * code; under FPU_GUARD their FP use is counted in Fpu_IsrStrays().
+ * ============================================================================= */
+
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>             /* no FreeRTOS.h: FreeRTOSConfig.h includes this */
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef FPU_GUARD
+#ifdef NDEBUG
+#define FPU_GUARD           0
+#else
+#define FPU_GUARD           1       /* trap FP use by undeclared tasks */
+#endif
+#endif
+#define FPU_MAX_TASKS       6u
+#define FPU_TASK_STACK_EXTRA 40u    /* words: 26 extended frame + 16 S16-S31, less overlap */
+
+/** Enable UsageFault reporting for the guard. Before the scheduler. */
+void Fpu_Init(void);
+
+/** Declare a task (TaskHandle_t) as an FPU user. Before or after the scheduler starts. */
+void Fpu_TaskUses(void *task);
+
+/** Context-switch hook (traceTASK_SWITCHED_IN); FPU on only for FP users. */
+void Fpu_SwitchedIn(const void *tcb);
+
+/** Undeclared tasks caught executing FP instructions. */
+uint32_t Fpu_Strays(void);
+
+/** FP instructions caught in interrupt handlers. */
+uint32_t Fpu_IsrStrays(void);
+
+/** Name of the latest stray task, NULL if none. */
+const char *Fpu_LastStray(void);
+
+#endif /* FPU_H */
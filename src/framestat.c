@@ -0,0 +1,123 @@
+/* =============================================================================
+ * framestat.c  -  Always-on frame timing: interval, render time, start jitter
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "framestat.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cpufreq.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FS_CYCLES_US        (configCPU_CLOCK_HZ / 1000000u)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t hist[FRAMESTAT_BUCKETS];
+    uint32_t n;
+    uint32_t max_us;
+} fs_hist_t;
+
+/* Written by the render task only (with NEO_QUEUE_FRAMES the interval and
+ * jitter by the frame queue's ISR); Reset() masks both out for the clear */
+static fs_hist_t fs_h[FRAMESTAT_KINDS];
+
+static uint32_t  fs_period;                 /* cycles */
+static uint32_t  fs_last;                   /* DMA start of the frame before */
+static uint32_t  fs_ideal;                  /* where the grid put it */
+static uint32_t  fs_slots;                  /* 0: no frame before, start over */
+
+static inline void fs_add(framestat_kind_t k, uint32_t us)
+{
+    fs_hist_t *h = &fs_h[k];
+
+    Hist_Add(h->hist, FRAMESTAT_BUCKETS, us);
+    h->n++;
+    if (us > h->max_us) h->max_us = us;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void FrameStat_Init(uint32_t period_us)
+{
+    fs_period = period_us * FS_CYCLES_US;
+    fs_slots  = 0u;
+}
+
+void FrameStat_Slots(uint32_t slots)
+{
+    fs_slots = slots;
+}
+
+void FrameStat_Render(uint32_t cycles)
+{
+    fs_add(FRAMESTAT_RENDER, cycles / FS_CYCLES_US);
+}
+
+void FrameStat_Shown(void)
+{
+    uint32_t now = CpuFreq_Cycles();
+
+    if (fs_slots == 0u)
+    {
+        fs_ideal = now;
+    }
+    else
+    {
+        int32_t late;
+
+        fs_add(FRAMESTAT_INTERVAL, (now - fs_last) / FS_CYCLES_US);
+        fs_ideal += fs_slots * fs_period;
+        late = (int32_t)(now - fs_ideal);
+        if (late < 0)
+        {
+            fs_ideal = now;             /* earliest start yet: the grid moves back */
+            late     = 0;
+        }
+        fs_add(FRAMESTAT_JITTER, (uint32_t)late / FS_CYCLES_US);
+        if ((uint32_t)late >= fs_period / 2u)
+            fs_ideal += ((uint32_t)late + fs_period / 2u) / fs_period * fs_period;  /* a slot repeated */
+        else
+            fs_ideal += (uint32_t)late >> FRAMESTAT_TRACK_SHIFT;
+    }
+    fs_last  = now;
+    fs_slots = 1u;
+}
+
+void FrameStat_Get(framestat_kind_t k, framestat_result_t *out)
+{
+    const fs_hist_t *h = &fs_h[k];
+
+    /* A frame landing mid-walk moves a percentile by one sample at most */
+    out->n      = h->n;
+    out->max_us = h->max_us;
+    out->p50_us = Hist_Percentile(h->hist, FRAMESTAT_BUCKETS, out->n, 500u);
+    out->p99_us = Hist_Percentile(h->hist, FRAMESTAT_BUCKETS, out->n, 990u);
+    if (out->p50_us > out->max_us) out->p50_us = out->max_us;
+    if (out->p99_us > out->max_us) out->p99_us = out->max_us;
+}
+
+void FrameStat_Reset(void)
+{
+    taskENTER_CRITICAL();
+    memset(fs_h, 0, sizeof(fs_h));
+    fs_slots = 0u;
+    taskEXIT_CRITICAL();
+}
+
+void FrameStat_Print(void)
+{
+    static const char *const name[FRAMESTAT_KINDS] = { "interval", "render", "jitter" };
+    framestat_result_t r;
+
+    printf("frames: us n / p50 / p99 / max\n");
+    for (uint32_t k = 0; k < FRAMESTAT_KINDS; k++)
+    {
+        FrameStat_Get((framestat_kind_t)k, &r);
+        printf("  %-8s %8lu %7lu %7lu %7lu\n", name[k], (unsigned long)r.n,
+               (unsigned long)r.p50_us, (unsigned long)r.p99_us, (unsigned long)r.max_us);
+    }
+}
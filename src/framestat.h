@@ -0,0 +1,84 @@
+/* =============================================================================
+ * framestat.h  -  Always-on frame timing: interval, render time, start jitter
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A stutter is one frame in a few thousand that leaves late; averages do
+ * not show it. Three histograms of microseconds (hist.h) are kept from
+ * boot, at a few dozen cycles a frame:
+ *
+ *   interval   DMA start to DMA start (NeoPixel_Show(), or the queue's
+ *              show clock ISR with NEO_QUEUE_FRAMES), what the eye
+ *              sees; not counted across a static-scene pause
+ *   render     Effects_Render() of the render task, encode included
+ *   jitter     how late each DMA start is against the ideal schedule: a
+ *              grid of the frame period that follows the earliest starts
+ *              (an early start moves it back at once, late ones pull it
+ *              forward by 1 / 2^FRAMESTAT_TRACK_SHIFT of the lateness, so
+ *              a steady render time or a period off by a fraction of a
+ *              microsecond do not count, a spike does). Dropped slots
+ *              move the grid by as many periods; a start half a period
+ *              or more late counts once and moves it to that slot.
+ *
+ * Missed and dropped slots are counted by the render task (main.c) and
+ * published with the metrics snapshot. The p99 and max of each histogram
+ * go out as telemetry channels (telem.c); with PROFILE_ENABLE the render
+ * task prints all of it with the profile report.
+ *
+ * Stamps are CpuFreq_Cycles(): wall time at any CPU clock divider.
+ * ============================================================================= */
+
+#ifndef FRAMESTAT_H
+#define FRAMESTAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hist.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define FRAMESTAT_OCTAVES       14u     /* up to 2^17 us (131 ms), longer in the last bucket */
+#define FRAMESTAT_TRACK_SHIFT   6u      /* jitter grid: late starts pull it by 1/64 */
+
+#define FRAMESTAT_BUCKETS       HIST_BUCKETS(FRAMESTAT_OCTAVES)
+
+typedef enum
+{
+    FRAMESTAT_INTERVAL = 0,
+    FRAMESTAT_RENDER,
+    FRAMESTAT_JITTER,
+    FRAMESTAT_KINDS
+} framestat_kind_t;
+
+typedef struct
+{
+    uint32_t n;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} framestat_result_t;
+
+/** The ideal frame period. Before the render task starts. */
+void FrameStat_Init(uint32_t period_us);
+
+/**
+ * Frame slots the next frame is after the one before (1 on schedule,
+ * more after dropped slots), or 0 after a pause: the next frame starts
+ * a new interval and grid. Render task.
+ */
+void FrameStat_Slots(uint32_t slots);
+
+/** One Effects_Render() took `cycles`. Render task. */
+void FrameStat_Render(uint32_t cycles);
+
+/** The DMA of a frame starts now. NeoPixel_Show(). */
+void FrameStat_Shown(void);
+
+/** Percentiles of one histogram so far, read live. Any task. */
+void FrameStat_Get(framestat_kind_t k, framestat_result_t *out);
+
+/** Start over. Any task. */
+void FrameStat_Reset(void);
+
+/** All three on stdout, blocking (the PROFILE_ENABLE report). */
+void FrameStat_Print(void);
+
+#endif /* FRAMESTAT_H */
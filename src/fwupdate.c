@@ -0,0 +1,273 @@
+/* =============================================================================
+ * fwupdate.c  -  In-field firmware update into the other flash bank
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "fwupdate.h"
+#include "definitions.h"        /* NVMCTRL plib, DSU, PAC, FLASH_SIZE */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "nvstore.h"
+#include "nvwrite.h"
+#include "settings.h"
+#include "actuator.h"
+#include "wear.h"
+#include "imgcheck.h"
+#include "log.h"
+#include <string.h>
+
+#define FWUP_PAGE           NVMCTRL_FLASH_PAGESIZE
+#define FWUP_REGION         (FLASH_SIZE / 32u)          /* lock regions */
+#define FWUP_NVM_ERRORS     (NVMCTRL_INTFLAG_ADDRE_Msk | NVMCTRL_INTFLAG_PROGE_Msk | \
+                             NVMCTRL_INTFLAG_LOCKE_Msk | NVMCTRL_INTFLAG_NVME_Msk)
+#define FWUP_CHECK          0xFFFFFFFFu                 /* step: only wait and check */
+
+_Static_assert(FWUPDATE_BANK == FLASH_SIZE / 2u, "FWUPDATE_BANK: half the flash");
+_Static_assert(FWUPDATE_IMAGE_MAX == FWUPDATE_BANK - (2u * SETTINGS_SEESBLK + 1u) * NVMCTRL_FLASH_BLOCKSIZE,
+               "FWUPDATE_IMAGE_MAX: the bank less nvstore and the SmartEEPROM sectors");
+
+typedef enum
+{
+    FWUP_AGAIN = 0,             /* a command was issued or the flash is busy */
+    FWUP_DONE,
+    FWUP_FAIL
+} fwup_step_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t fwup_page[FWUP_PAGE / 4u];      /* filled by the caller, programmed by the timer task */
+static uint32_t fwup_fill;                      /* bytes in fwup_page                */
+static uint32_t fwup_addr;                      /* where fwup_page goes              */
+static uint32_t fwup_size;
+static uint32_t fwup_crc;
+static uint32_t fwup_digest[IMGCHECK_WORDS];   /* the ICM's, sealed at the swap */
+static volatile uint32_t         fwup_written;
+static volatile fwupdate_state_t fwup_state;
+
+static volatile fwup_step_t fwup_result;
+static bool                 fwup_unlocked;      /* this page's region, this step run */
+static bool                 fwup_erased;        /* this page's block               */
+
+static TimerHandle_t fwup_timer;
+static StaticTimer_t fwup_timer_buf;
+
+/* -- Flash steps: timer service task ------------------------------------------ */
+
+/* Error flags of the commands since the last fwup_clear(). Best effort: a
+ * flash user in between may clear them, the CRC catches what they miss */
+static bool fwup_nvm_error(void)
+{
+    return (NVMCTRL_REGS->NVMCTRL_INTFLAG & FWUP_NVM_ERRORS) != 0u;
+}
+
+static void fwup_clear(void)
+{
+    NVMCTRL_REGS->NVMCTRL_INTFLAG = FWUP_NVM_ERRORS;
+}
+
+/* One command at most; the caller comes back until FWUP_DONE */
+static fwup_step_t fwup_step(uint32_t addr)
+{
+    if (NVMCTRL_IsBusy() || NVMCTRL_SmartEEPROM_IsBusy() || !NvWrite_Idle()) return FWUP_AGAIN;
+    if (fwup_nvm_error()) return FWUP_FAIL;
+    if (addr == FWUP_CHECK) return FWUP_DONE;
+
+    if ((addr % FWUP_REGION) == 0u && !fwup_unlocked)
+    {
+        NVMCTRL_RegionUnlock(addr);
+        fwup_unlocked = true;
+        return FWUP_AGAIN;
+    }
+    if ((addr % NVMCTRL_FLASH_BLOCKSIZE) == 0u && !fwup_erased)
+    {
+        (void)NVMCTRL_BlockErase(addr);
+        fwup_erased = true;
+        return FWUP_AGAIN;
+    }
+    (void)NVMCTRL_PageWrite(fwup_page, addr);
+    fwup_unlocked = false;
+    fwup_erased   = false;
+    return FWUP_DONE;
+}
+
+static void fwup_pended(void *task, uint32_t addr)
+{
+    if (addr == FWUPDATE_BANK && !fwup_unlocked) fwup_clear();     /* first page */
+    fwup_result = fwup_step(addr);
+    xTaskNotifyGive((TaskHandle_t)task);
+}
+
+/* Calling task: run the steps for addr until done, the flash polled between them */
+static bool fwup_run(uint32_t addr)
+{
+    TaskHandle_t self  = xTaskGetCurrentTaskHandle();
+    TickType_t   start = xTaskGetTickCount();
+
+    for (;;)
+    {
+        if (xTimerPendFunctionCall(fwup_pended, self, addr, pdMS_TO_TICKS(FWUPDATE_STEP_MS)) != pdPASS ||
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FWUPDATE_STEP_MS)) == 0u)
+            return false;
+        if (fwup_result != FWUP_AGAIN) return fwup_result == FWUP_DONE;
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(FWUPDATE_STEP_MS)) return false;
+        vTaskDelay(1);
+    }
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* DSU CRC-32 of words at addr; the DSU reads them as a bus master */
+static bool fwup_crc32(uint32_t addr, uint32_t size, uint32_t *crc)
+{
+    PAC_REGS->PAC_WRCTRL = PAC_WRCTRL_PERID(ID_DSU) | PAC_WRCTRL_KEY_CLR;  /* write-protected out of reset */
+    DSU_REGS->DSU_STATUSA = DSU_STATUSA_DONE_Msk | DSU_STATUSA_BERR_Msk;
+    DSU_REGS->DSU_ADDR    = DSU_ADDR_ADDR(addr >> 2);
+    DSU_REGS->DSU_LENGTH  = DSU_LENGTH_LENGTH(size >> 2);
+    DSU_REGS->DSU_DATA    = 0xFFFFFFFFu;
+    DSU_REGS->DSU_CTRL    = DSU_CTRL_CRC_Msk;
+    while ((DSU_REGS->DSU_STATUSA & DSU_STATUSA_DONE_Msk) == 0u) vTaskDelay(1);
+
+    *crc = ~DSU_REGS->DSU_DATA;                 /* zlib's final inversion */
+    return (DSU_REGS->DSU_STATUSA & DSU_STATUSA_BERR_Msk) == 0u;
+}
+
+static void fwup_wait(void)
+{
+    while (NVMCTRL_IsBusy()) {}
+}
+
+/* The nvstore block into the same place in this bank, where it will be
+ * after the swap. This bank is the one running: its fetches stall for the
+ * erase and the writes, which is fine right before the reset */
+static bool fwup_carry(void)
+{
+    uint32_t src = NvStore_Address();
+    uint32_t dst = src - FWUPDATE_BANK;
+
+    fwup_wait();
+    fwup_clear();
+    NVMCTRL_RegionUnlock(dst);
+    fwup_wait();
+    (void)NVMCTRL_BlockErase(dst);
+    fwup_wait();
+    for (uint32_t off = 0; off < NVMCTRL_FLASH_BLOCKSIZE; off += FWUP_PAGE)
+    {
+        memcpy(fwup_page, (const void *)(src + off), FWUP_PAGE);
+        (void)NVMCTRL_PageWrite(fwup_page, dst + off);
+        fwup_wait();
+    }
+    return !fwup_nvm_error();
+}
+
+/* Armed: look for a gap between cues, then swap (and reset) */
+static void fwup_timer_cb(TimerHandle_t t)
+{
+    (void)t;
+    if (fwup_state != FWUPDATE_ARMED || !Actuator_QuietFor(FWUPDATE_GAP_MS)) return;
+
+    /* Counters and settings out first; busy: the next poll */
+    Wear_Commit();
+    if (!Settings_Flush() || !NvWrite_Idle() || NVMCTRL_IsBusy() || NVMCTRL_SmartEEPROM_IsBusy()) return;
+
+    LOG_INFO("fwupdate: swapping to bank %c", FwUpdate_BankA() ? 'B' : 'A');
+    if (IMGCHECK_ENABLE && !ImgCheck_Seal(fwup_size, fwup_digest))
+        LOG_ERROR("fwupdate: new image not sealed, it boots unchecked");
+    if (!fwup_carry()) LOG_ERROR("fwupdate: nvstore not carried, its records reset");
+    while (NVMCTRL_SmartEEPROM_IsBusy()) {}
+    NVMCTRL_BankSwap();                         /* resets */
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool FwUpdate_Begin(uint32_t size, uint32_t crc)
+{
+    FwUpdate_Cancel();
+    if (size == 0u || size > FWUPDATE_IMAGE_MAX || (size & 3u) != 0u) return false;
+
+    if (fwup_timer == NULL)
+        fwup_timer = xTimerCreateStatic("FwUpdate", pdMS_TO_TICKS(FWUPDATE_POLL_MS), pdTRUE, NULL,
+                                        fwup_timer_cb, &fwup_timer_buf);
+    fwup_size     = size;
+    fwup_crc      = crc;
+    fwup_addr     = FWUPDATE_BANK;
+    fwup_fill     = 0u;
+    fwup_written  = 0u;
+    fwup_unlocked = false;
+    fwup_erased   = false;
+    fwup_state    = FWUPDATE_RECEIVING;
+    return fwup_timer != NULL;
+}
+
+bool FwUpdate_Write(const uint8_t *data, uint32_t count)
+{
+    if (fwup_state != FWUPDATE_RECEIVING) return false;
+    if (count > fwup_size - fwup_written)
+    {
+        fwup_state = FWUPDATE_FAILED;
+        return false;
+    }
+
+    while (count != 0u)
+    {
+        uint32_t n = FWUP_PAGE - fwup_fill;
+
+        if (n > count) n = count;
+        memcpy((uint8_t *)fwup_page + fwup_fill, data, n);
+        fwup_fill    += n;
+        fwup_written += n;
+        data  += n;
+        count -= n;
+        if (fwup_fill == FWUP_PAGE)
+        {
+            if (!fwup_run(fwup_addr))
+            {
+                fwup_state = FWUPDATE_FAILED;
+                return false;
+            }
+            fwup_addr += FWUP_PAGE;
+            fwup_fill  = 0u;
+        }
+    }
+    return true;
+}
+
+bool FwUpdate_Finish(void)
+{
+    uint32_t crc = ~fwup_crc;
+    bool ok = (fwup_state == FWUPDATE_RECEIVING && fwup_written == fwup_size);
+
+    if (ok && fwup_fill != 0u)
+    {
+        memset((uint8_t *)fwup_page + fwup_fill, 0xFF, FWUP_PAGE - fwup_fill);
+        ok = fwup_run(fwup_addr);
+    }
+    ok = ok && fwup_run(FWUP_CHECK);
+    ok = ok && fwup_crc32(FWUPDATE_BANK, fwup_size, &crc) && crc == fwup_crc;
+    ok = ok && (!IMGCHECK_ENABLE || ImgCheck_Digest(FWUPDATE_BANK, fwup_size, fwup_digest));
+
+    fwup_state = ok ? FWUPDATE_ARMED : FWUPDATE_FAILED;
+    if (ok) (void)xTimerStart(fwup_timer, 0u);
+    return ok;
+}
+
+void FwUpdate_Cancel(void)
+{
+    if (fwup_timer != NULL) (void)xTimerStop(fwup_timer, 0u);
+    if (fwup_state == FWUPDATE_RECEIVING || fwup_state == FWUPDATE_ARMED) fwup_state = FWUPDATE_FAILED;
+}
+
+fwupdate_state_t FwUpdate_State(void)
+{
+    return fwup_state;
+}
+
+uint32_t FwUpdate_Written(void)
+{
+    return fwup_written;
+}
+
+bool FwUpdate_BankA(void)
+{
+    return (NVMCTRL_REGS->NVMCTRL_STATUS & NVMCTRL_STATUS_AFIRST_Msk) != 0u;
+}
@@ -0,0 +1,86 @@
+/* =============================================================================
+ * fwupdate.h  -  In-field firmware update into the other flash bank
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The 1 MB flash is two 512 KB banks; the one the chip boots from is
+ * mapped at 0, the other at FWUPDATE_BANK. A new image is written into the
+ * other bank while the show keeps running from this one (erasing and
+ * programming one bank does not stall code fetched from the other), then
+ * checked with the DSU's hardware CRC32 and, once it matches, the banks
+ * are swapped at the next gap between cues: NVMCTRL_BankSwap() maps the
+ * new image at 0 and resets, so the downtime is one boot.
+ *
+ *   Layout  An image may be FWUPDATE_IMAGE_MAX long: each bank ends in
+ *           the blocks kept for nvstore.h and the SmartEEPROM sectors
+ *           (settings.h), which the update never erases. The linker's
+ *           ROM_LENGTH is set to the same size (CR-Proj configuration),
+ *           so a build that would not fit fails to link.
+ *   Flash   The update's NVMCTRL commands run in the timer service task,
+ *           with the settings flush; each step issues one command and
+ *           returns, the caller polls until the flash is ready, so no
+ *           step holds the timer task for an erase. A step waits while
+ *           the NvWrite task (nvwrite.h) has an nvstore save in hand.
+ *   Swap    Armed after a good CRC. It waits until no actuator channel
+ *           runs or holds a cue and none is due within FWUPDATE_GAP_MS,
+ *           copies the nvstore block across (its records follow the
+ *           image) and swaps. The old image stays in the other bank, so
+ *           a second update with it goes back.
+ *   Seal    After the CRC the ICM takes the new image's SHA-256
+ *           (imgcheck.h); it is sealed in nvstore right before the swap,
+ *           and the next boot checks the image against it before the
+ *           relays may move.
+ *
+ * The transport is the CLI (`fwup`, cli.h), on the console or the USB
+ * port; tools/fwupdate.py sends an image with per-chunk flow control.
+ * ============================================================================= */
+
+#ifndef FWUPDATE_H
+#define FWUPDATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define FWUPDATE_CHUNK          256u    /* bytes per host chunk, <= RX streams      */
+#define FWUPDATE_CHUNK_MS       3000u   /* host silent this long: abort             */
+#define FWUPDATE_GAP_MS         5000u   /* quiet actuators ahead before the swap    */
+#define FWUPDATE_POLL_MS        100u    /* armed: how often the gap is looked for   */
+#define FWUPDATE_STEP_MS        1000u   /* one flash step, an erase included        */
+
+#define FWUPDATE_BANK           0x80000u                        /* the other bank's base */
+#define FWUPDATE_IMAGE_MAX      0x7A000u                        /* 488 KB, see Layout    */
+
+typedef enum
+{
+    FWUPDATE_IDLE = 0,
+    FWUPDATE_RECEIVING,         /* FwUpdate_Begin() until FwUpdate_Finish()      */
+    FWUPDATE_ARMED,             /* verified, swapping at the next gap            */
+    FWUPDATE_FAILED             /* CRC mismatch, flash error or aborted          */
+} fwupdate_state_t;
+
+/**
+ * Start an image of `size` bytes (a multiple of 4, at most
+ * FWUPDATE_IMAGE_MAX) whose CRC-32 (zlib / IEEE 802.3) is `crc`; a swap
+ * still armed is cancelled. False if the size is bad. One task at a time.
+ */
+bool FwUpdate_Begin(uint32_t size, uint32_t crc);
+
+/** Next `count` bytes of the image, programmed a page at a time. False on a flash error. */
+bool FwUpdate_Write(const uint8_t *data, uint32_t count);
+
+/** Program the last page and check the CRC; true arms the swap. */
+bool FwUpdate_Finish(void);
+
+/** Abort a transfer or disarm the swap; the other bank keeps what was written. */
+void FwUpdate_Cancel(void);
+
+/** Where the update stands. Any task. */
+fwupdate_state_t FwUpdate_State(void);
+
+/** Bytes written so far of the current or last image. Any task. */
+uint32_t FwUpdate_Written(void);
+
+/** True when running from bank A (neither swapped nor swapped back). Any task. */
+bool FwUpdate_BankA(void);
+
+#endif /* FWUPDATE_H */
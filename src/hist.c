@@ -0,0 +1,20 @@
+/* =============================================================================
+ * hist.c  -  Log-linear histograms of microseconds, percentiles from them
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "hist.h"
+
+uint32_t Hist_Percentile(const uint32_t *h, uint32_t buckets, uint32_t n, uint32_t pm)
+{
+    uint64_t rank = ((uint64_t)n * pm + 999u) / 1000u;
+    uint64_t acc  = 0u;
+
+    if (rank == 0u) return 0u;
+    for (uint32_t b = 0; b < buckets; b++)
+    {
+        acc += h[b];
+        if (acc >= rank) return Hist_Top(b);
+    }
+    return Hist_Top(buckets - 1u);
+}
@@ -0,0 +1,59 @@
+/* =============================================================================
+ * hist.h  -  Log-linear histograms of microseconds, percentiles from them
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * HIST_SUB buckets per power of two, one bucket per value below HIST_SUB:
+ * a bucket spans 1 / HIST_SUB of its value, so percentiles read from the
+ * bucket tops are within 12.5 % over the true value, from 1 us to seconds
+ * in a hundred-odd counters. Adding a sample is a CLZ, two shifts and an
+ * increment; reading the percentiles walks the buckets once.
+ *
+ * Used by latbench.c (edge to relay / LED) and framestat.c (frame timing).
+ * ============================================================================= */
+
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+
+#define HIST_SUB_BITS           3u
+#define HIST_SUB                (1u << HIST_SUB_BITS)
+
+/** Buckets for values up to 2^(octaves + HIST_SUB_BITS) - 1. */
+#define HIST_BUCKETS(octaves)   (((octaves) + 1u) * HIST_SUB)
+
+/** Bucket of value v; the last bucket of `buckets` takes everything above. */
+static inline uint32_t Hist_Bucket(uint32_t v, uint32_t buckets)
+{
+    uint32_t e, b;
+
+    if (v < HIST_SUB) return v;
+    e = 31u - (uint32_t)__builtin_clz(v);
+    b = (e - HIST_SUB_BITS + 1u) * HIST_SUB + ((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1u));
+    return (b < buckets) ? b : buckets - 1u;
+}
+
+/** Largest value bucket b holds. */
+static inline uint32_t Hist_Top(uint32_t b)
+{
+    uint32_t e;
+
+    if (b < HIST_SUB) return b;
+    e = b / HIST_SUB + HIST_SUB_BITS - 1u;
+    return ((HIST_SUB + b % HIST_SUB + 1u) << (e - HIST_SUB_BITS)) - 1u;
+}
+
+/** Add one sample of value v. */
+static inline void Hist_Add(uint32_t *h, uint32_t buckets, uint32_t v)
+{
+    h[Hist_Bucket(v, buckets)]++;
+}
+
+/**
+ * The value `pm` permille of the `n` samples in `h` are at or below (rank
+ * rounded up: p99 of 100 samples is the 99th), as its bucket's top; 0 for
+ * no samples. Clamp to the exact max if one is kept.
+ */
+uint32_t Hist_Percentile(const uint32_t *h, uint32_t buckets, uint32_t n, uint32_t pm);
+
+#endif /* HIST_H */
@@ -0,0 +1,176 @@
+/* =============================================================================
+ * hrtimer.c  -  Microsecond one-shot and periodic callbacks on the show clock
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "hrtimer.h"
+#include "definitions.h"        /* TC0_REGS, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "showclock.h"
+#include "tickless.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static hrtimer_t       *hr_head;                    /* armed, soonest first */
+static hrtimer_stats_t  hr_stats;
+
+/* The rest is called with interrupts masked */
+
+static void hr_insert(hrtimer_t *t)
+{
+    hrtimer_t **pp = &hr_head;
+
+    while (*pp != NULL && (int32_t)((*pp)->due - t->due) <= 0) pp = &(*pp)->next;
+    t->next  = *pp;
+    *pp      = t;
+    t->armed = true;
+    hr_stats.armed++;
+}
+
+static bool hr_remove(hrtimer_t *t)
+{
+    for (hrtimer_t **pp = &hr_head; *pp != NULL; pp = &(*pp)->next)
+    {
+        if (*pp != t) continue;
+        *pp      = t->next;
+        t->armed = false;
+        hr_stats.armed--;
+        return true;
+    }
+    return false;
+}
+
+/* CC1 on the first due time; one already too close runs from the pended vector */
+static void hr_program(void)
+{
+    if (hr_head == NULL) return;
+
+    TC0_REGS->COUNT32.TC_CC[1] = hr_head->due;
+    while ((TC0_REGS->COUNT32.TC_SYNCBUSY & TC_SYNCBUSY_CC1_Msk) != 0u) {}
+    TC0_REGS->COUNT32.TC_INTFLAG = TC_INTFLAG_MC1_Msk;
+    if (ShowClock_Until(hr_head->due) < (int32_t)HRTIMER_MIN_US) NVIC_SetPendingIRQ(TC0_IRQn);
+}
+
+/* Timer task: a HRTIMER_TASK callback */
+static void hr_deferred(void *p, uint32_t unused)
+{
+    hrtimer_t *t = p;
+
+    (void)unused;
+    t->fn(t, t->arg);
+}
+
+static bool hr_tickless_veto(void)
+{
+    return hr_head != NULL;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void HrTimer_Init(void)
+{
+    TC0_REGS->COUNT32.TC_INTFLAG  = TC_INTFLAG_MC1_Msk;
+    TC0_REGS->COUNT32.TC_INTENSET = TC_INTENSET_MC1_Msk;   /* TC0_IRQn: ShowClock_Init() */
+    (void)Tickless_RegisterVeto(hr_tickless_veto);
+}
+
+void HrTimer_Create(hrtimer_t *t, hrtimer_fn fn, void *arg, hrtimer_ctx_t ctx)
+{
+    t->next      = NULL;
+    t->due       = 0u;
+    t->period_us = 0u;
+    t->fn        = fn;
+    t->arg       = arg;
+    t->ctx       = (uint8_t)ctx;
+    t->armed     = false;
+}
+
+void HrTimer_StartAt(hrtimer_t *t, uint32_t due, uint32_t period_us)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    (void)hr_remove(t);
+    t->due       = due;
+    t->period_us = (period_us != 0u && period_us < HRTIMER_MIN_US) ? HRTIMER_MIN_US : period_us;
+    hr_insert(t);
+    if (hr_head == t) hr_program();
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void HrTimer_Start(hrtimer_t *t, uint32_t us, uint32_t period_us)
+{
+    HrTimer_StartAt(t, ShowClock_Now() + us, period_us);
+}
+
+bool HrTimer_Stop(hrtimer_t *t)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    bool        was  = hr_remove(t);
+
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return was;                     /* CC1 may still match for it: the ISR finds nothing due */
+}
+
+bool HrTimer_Armed(const hrtimer_t *t)
+{
+    return t->armed;
+}
+
+void HrTimer_Isr(BaseType_t *woken)
+{
+    for (;;)
+    {
+        UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+        hrtimer_t  *t    = hr_head;
+        uint32_t    now  = ShowClock_Now();
+        int32_t     late;
+
+        if (t == NULL || (int32_t)(t->due - now) >= (int32_t)HRTIMER_MIN_US)
+        {
+            hr_program();
+            taskEXIT_CRITICAL_FROM_ISR(mask);
+            return;
+        }
+        late = (int32_t)(now - t->due);
+        (void)hr_remove(t);
+        if (t->period_us != 0u)
+        {
+            t->due += t->period_us;
+            while ((int32_t)(now - t->due) >= 0)
+            {
+                t->due += t->period_us;     /* overran: keep the phase, lose the periods */
+                hr_stats.skipped++;
+            }
+            hr_insert(t);
+        }
+        hr_stats.fired++;
+        if (late > (int32_t)HRTIMER_LATE_US)
+        {
+            hr_stats.late++;
+            if ((uint32_t)late > hr_stats.late_max_us) hr_stats.late_max_us = (uint32_t)late;
+        }
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+
+        if (t->ctx == HRTIMER_ISR)
+        {
+            t->fn(t, t->arg);
+        }
+        else if (xTimerPendFunctionCallFromISR(hr_deferred, t, 0u, woken) == pdPASS)
+        {
+            hr_stats.deferred++;
+        }
+        else
+        {
+            hr_stats.dropped++;
+        }
+    }
+}
+
+void HrTimer_GetStats(hrtimer_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = hr_stats;
+    taskEXIT_CRITICAL();
+}
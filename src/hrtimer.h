@@ -0,0 +1,104 @@
+/* =============================================================================
+ * hrtimer.h  -  Microsecond one-shot and periodic callbacks on the show clock
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * An RTOS delay is whole ticks (configTICK_RATE_HZ 1000), and a software
+ * timer runs on the tick too: a slam's brake pulse, a sensor trigger or a
+ * sound cue lined up with a relay edge lands anywhere in the millisecond.
+ * Raising the tick rate would cost every task the extra ticks. This
+ * service puts the callbacks on the show clock instead (showclock.h):
+ * TC0's free-running microsecond count, compared in hardware on CC1.
+ *
+ *   List     the armed timers, caller-owned hrtimer_t, sorted by due
+ *            time; CC1 holds the first. Its match (TC0_Handler(), the
+ *            vector showclock.c owns) runs every timer due by then, each
+ *            periodic one put back a period on from its last due time, so
+ *            it does not drift.
+ *   Context  HRTIMER_ISR callbacks run in that interrupt, at
+ *            IRQ_PRIO_SHOWCLOCK: short, FromISR API only. HRTIMER_TASK
+ *            ones are handed to the timer service task
+ *            (xTimerPendFunctionCallFromISR()), which runs them in order
+ *            at its priority, a few microseconds later.
+ *
+ * Times are show times (ShowClock_Now()), so a cue taken from the show
+ * clock lands on the microsecond, and less than ~35 minutes ahead. A time
+ * already past, or closer than HRTIMER_MIN_US, fires at once and counts as
+ * late. "hrt" prints the counters and the worst lateness seen.
+ *
+ * The show clock stops in STANDBY: tickless idle is vetoed while a timer
+ * is armed.
+ * ============================================================================= */
+
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"           /* BaseType_t */
+
+/* -- User configuration ------------------------------------------------------ */
+#define HRTIMER_MIN_US          3u      /* closer than this: run now, CC1 would miss it */
+#define HRTIMER_LATE_US         20u     /* past due by more: counted late            */
+
+typedef struct hrtimer hrtimer_t;
+
+/** Callback: the timer and its argument. ISR or timer task, per hrtimer_ctx_t. */
+typedef void (*hrtimer_fn)(hrtimer_t *t, void *arg);
+
+typedef enum
+{
+    HRTIMER_ISR = 0,            /* in TC0_Handler(), FromISR API only */
+    HRTIMER_TASK                /* in the timer service task          */
+} hrtimer_ctx_t;
+
+/** Caller-owned; set up with HrTimer_Create(), fields private. */
+struct hrtimer
+{
+    hrtimer_t *next;
+    uint32_t   due;             /* show time */
+    uint32_t   period_us;       /* 0 = one-shot */
+    hrtimer_fn fn;
+    void      *arg;
+    uint8_t    ctx;             /* hrtimer_ctx_t */
+    bool       armed;
+};
+
+typedef struct
+{
+    uint32_t fired;
+    uint32_t deferred;          /* handed to the timer task               */
+    uint32_t dropped;           /* ...timer command queue full            */
+    uint32_t late;              /* ran over HRTIMER_LATE_US after its due */
+    uint32_t late_max_us;
+    uint32_t skipped;           /* periods lost, a periodic one overran   */
+    uint8_t  armed;
+} hrtimer_stats_t;
+
+/** Enable the CC1 compare on the show clock. After ShowClock_Init(), before the scheduler. */
+void HrTimer_Init(void);
+
+/** Set up `t` with its callback; it starts disarmed. Before arming it. */
+void HrTimer_Create(hrtimer_t *t, hrtimer_fn fn, void *arg, hrtimer_ctx_t ctx);
+
+/**
+ * Arm `t` for show time `due`, then every `period_us` (0 = once),
+ * re-arming it if it was. Any task or ISR at or below the syscall ceiling.
+ */
+void HrTimer_StartAt(hrtimer_t *t, uint32_t due, uint32_t period_us);
+
+/** HrTimer_StartAt() `us` microseconds from now. Same contexts. */
+void HrTimer_Start(hrtimer_t *t, uint32_t us, uint32_t period_us);
+
+/** Disarm `t`; true if it was armed. A HRTIMER_TASK call already handed over still runs. Same contexts. */
+bool HrTimer_Stop(hrtimer_t *t);
+
+/** `t` is armed. Any context. */
+bool HrTimer_Armed(const hrtimer_t *t);
+
+/** Run the timers due and set CC1 for the next. TC0_Handler() only. */
+void HrTimer_Isr(BaseType_t *woken);
+
+/** Counters since boot. Any task. */
+void HrTimer_GetStats(hrtimer_stats_t *out);
+
+#endif /* HRTIMER_H */
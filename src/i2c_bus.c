@@ -0,0 +1,285 @@
+/* =============================================================================
+ * i2c_bus.c  -  Interrupt-driven SERCOM2 I2C master with a transaction queue
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "i2c_bus.h"
+#include "definitions.h"        /* SERCOM2_REGS, PORT */
+#include "rtos_trace.h"
+#include "irqstat.h"
+#include "tickless.h"
+#include "sercom.h"
+
+#define I2C_SERCOM          2u
+#define I2C_REGS            (&SERCOM2_REGS->I2CM)
+
+/* fSCL = fGCLK / (10 + 2 * BAUD + fGCLK * tRISE) */
+#define I2C_BAUD            SERCOM_I2C_BAUD(I2C_GCLK_HZ, I2C_SCL_HZ, I2C_RISE_NS)
+
+#if (I2C_BAUD < 1u) || (I2C_BAUD > 255u)
+#error "I2C_SCL_HZ out of reach of GCLK3"
+#endif
+#if (I2C_DMA_MIN < 2u) || (I2C_DMA_MIN > 255u)
+#error "I2C_DMA_MIN: 2..255, ADDR.LEN is 8 bits"
+#endif
+
+#define I2C_CMD_READ        2u          /* CTRLB.CMD: ACK and read the next byte */
+#define I2C_CMD_STOP        3u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static i2c_txn_t *i2c_head;             /* on the bus (or next), NULL = idle */
+static i2c_txn_t *i2c_tail;
+static uint16_t   i2c_pos;              /* bytes of the current phase done   */
+static bool       i2c_dma;              /* read phase on I2C_DMA_RX          */
+static bool       i2c_open;             /* I2c_Init() done                   */
+
+static void i2c_isr(void);
+
+static inline void i2c_sync(void)
+{
+    while ((I2C_REGS->SERCOM_SYNCBUSY & SERCOM_I2CM_SYNCBUSY_SYSOP_Msk) != 0u) {}
+}
+
+/* Address the head for its read phase: by DMA with the length in ADDR, or byte by byte in SB */
+static void i2c_read(i2c_txn_t *t)
+{
+    uint32_t addr = SERCOM_I2CM_ADDR_ADDR(((uint32_t)t->addr << 1) | 1u);
+
+    i2c_pos = 0u;
+    if (t->rx_len >= I2C_DMA_MIN && t->rx_len <= 255u)
+    {
+        i2c_dma = true;
+        I2C_REGS->SERCOM_INTENCLR = SERCOM_I2CM_INTENCLR_SB_Msk;
+        Sercom_DmaStart(I2C_SERCOM, SERCOM_DMA_RX, I2C_DMA_RX, t->rx, t->rx_len);
+        addr |= SERCOM_I2CM_ADDR_LENEN_Msk | SERCOM_I2CM_ADDR_LEN(t->rx_len);
+    }
+    I2C_REGS->SERCOM_ADDR = addr;
+}
+
+/* Address the head transaction: write phase first, or straight to the read */
+static void i2c_start(void)
+{
+    i2c_txn_t *t = i2c_head;
+
+    i2c_pos = 0u;
+    I2C_REGS->SERCOM_CTRLB &= ~SERCOM_I2CM_CTRLB_ACKACT_Msk;
+    i2c_sync();
+    if (t->tx_len == 0u)
+        i2c_read(t);
+    else
+        I2C_REGS->SERCOM_ADDR = SERCOM_I2CM_ADDR_ADDR((uint32_t)t->addr << 1);
+}
+
+/* Finish the head transaction and start the next one; ISR or critical section */
+static void i2c_finish(i2c_status_t status, BaseType_t *woken)
+{
+    i2c_txn_t *t = i2c_head;
+
+    if (i2c_dma)
+    {
+        /* Done, or cut short by a NACK, an error or a timeout */
+        (void)Sercom_DmaStop(I2C_DMA_RX);
+        I2C_REGS->SERCOM_INTFLAG  = SERCOM_I2CM_INTFLAG_SB_Msk;
+        I2C_REGS->SERCOM_INTENSET = SERCOM_I2CM_INTENSET_SB_Msk;
+        i2c_dma = false;
+    }
+    i2c_head = t->next;
+    if (i2c_head == NULL) i2c_tail = NULL;
+    t->status = status;
+    if (t->task != NULL) vTaskNotifyGiveIndexedFromISR(t->task, I2C_NOTIFY_INDEX, woken);
+    if (i2c_head != NULL) i2c_start();
+}
+
+static void i2c_stop(void)
+{
+    I2C_REGS->SERCOM_CTRLB |= SERCOM_I2CM_CTRLB_CMD(I2C_CMD_STOP);
+    i2c_sync();
+}
+
+/* Standby would stop SERCOM2 mid-transfer */
+static bool i2c_tickless_veto(void)
+{
+    return i2c_head != NULL;
+}
+
+/* Read phase complete (dma_qos.c DMAC_OTHER dispatch); the master NACKs and STOPs by itself */
+static void i2c_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (!i2c_dma || i2c_head == NULL) return;
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) == 0u) i2c_stop();
+    i2c_finish(((flags & DMAC_CHINTFLAG_TCMPL_Msk) != 0u) ? I2C_OK : I2C_BUS_ERROR, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void I2c_Init(void)
+{
+    /* Smart mode: reading DATA acknowledges and fetches the next byte */
+    static const sercom_cfg_t i2c =
+    {
+        SERCOM_I2C, 3u, 0u, 0u, (I2C_SCL_HZ > 100000u) ? SERCOM_F_FAST : 0u, (uint16_t)I2C_BAUD, 0u
+    };
+
+    if (i2c_open) return;
+    i2c_open = true;
+    Sercom_Open(I2C_SERCOM, &i2c);
+    I2C_REGS->SERCOM_INTENSET = SERCOM_I2CM_INTENSET_MB_Msk | SERCOM_I2CM_INTENSET_SB_Msk |
+                                SERCOM_I2CM_INTENSET_ERROR_Msk;
+    (void)Sercom_DmaAttach(I2C_SERCOM, SERCOM_DMA_RX, I2C_DMA_RX, DMA_CLASS_COMMS, i2c_dma_isr);
+    Sercom_Enable(I2C_SERCOM);
+
+    /* PA12 / PA13 -> peripheral C */
+    PORT_REGS->GROUP[0].PORT_PMUX[12u >> 1] = PORT_PMUX_PMUXE(0x2u) | PORT_PMUX_PMUXO(0x2u);
+    PORT_REGS->GROUP[0].PORT_PINCFG[12] = PORT_PINCFG_PMUXEN_Msk;
+    PORT_REGS->GROUP[0].PORT_PINCFG[13] = PORT_PINCFG_PMUXEN_Msk;
+
+    i2c_head = NULL;
+    i2c_tail = NULL;
+    i2c_dma  = false;
+    (void)Tickless_RegisterVeto(i2c_tickless_veto);
+    (void)Sercom_Irq(I2C_SERCOM, i2c_isr, I2C_IRQ_PRIO);
+}
+
+void I2c_Submit(i2c_txn_t *txn)
+{
+    txn->next   = NULL;
+    txn->status = I2C_PENDING;
+    txn->task   = xTaskGetCurrentTaskHandle();
+    (void)ulTaskNotifyTakeIndexed(I2C_NOTIFY_INDEX, pdTRUE, 0u);   /* drop a stale give */
+
+    taskENTER_CRITICAL();
+    if (i2c_tail != NULL)
+    {
+        i2c_tail->next = txn;
+        i2c_tail = txn;
+    }
+    else
+    {
+        i2c_head = i2c_tail = txn;
+        i2c_start();
+    }
+    taskEXIT_CRITICAL();
+}
+
+i2c_status_t I2c_Wait(i2c_txn_t *txn, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t limit = pdMS_TO_TICKS(timeout_ms) + 1u;
+
+    while (txn->status == I2C_PENDING)
+    {
+        TickType_t spent = xTaskGetTickCount() - start;
+        if (spent >= limit) break;
+        (void)ulTaskNotifyTakeIndexed(I2C_NOTIFY_INDEX, pdTRUE, limit - spent);
+    }
+
+    taskENTER_CRITICAL();
+    if (txn->status == I2C_PENDING)
+    {
+        if (txn == i2c_head)
+        {
+            /* On the bus: stop it and move on */
+            BaseType_t unused = pdFALSE;
+
+            i2c_stop();
+            txn->task = NULL;
+            i2c_finish(I2C_TIMEOUT, &unused);
+        }
+        else
+        {
+            /* Still queued: unlink */
+            i2c_txn_t *p = i2c_head;
+
+            while (p->next != txn) p = p->next;
+            p->next = txn->next;
+            if (i2c_tail == txn) i2c_tail = p;
+            txn->status = I2C_TIMEOUT;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return txn->status;
+}
+
+i2c_status_t I2c_Transfer(uint8_t addr, const uint8_t *tx, uint16_t tx_len,
+                          uint8_t *rx, uint16_t rx_len, uint32_t timeout_ms)
+{
+    i2c_txn_t t;
+
+    t.addr   = addr;
+    t.tx     = tx;
+    t.tx_len = tx_len;
+    t.rx     = rx;
+    t.rx_len = rx_len;
+    I2c_Submit(&t);
+    return I2c_Wait(&t, timeout_ms);
+}
+
+/* -- Interrupt handler --------------------------------------------------------- */
+
+static void i2c_isr(void)
+{
+    uint8_t    flags = I2C_REGS->SERCOM_INTFLAG;
+    BaseType_t woken = pdFALSE;
+    i2c_txn_t *t     = i2c_head;
+
+    IRQSTAT_ENTER(IRQSTAT_I2C);
+    if (t == NULL)
+    {
+        I2C_REGS->SERCOM_INTFLAG = SERCOM_I2CM_INTFLAG_Msk;
+        IRQSTAT_EXIT(IRQSTAT_I2C);
+        return;
+    }
+    RTOS_TRACE_ISR_ENTER();
+
+    if ((flags & SERCOM_I2CM_INTFLAG_ERROR_Msk) != 0u)
+    {
+        /* Bus error / lost arbitration: the bus is released by the hardware */
+        I2C_REGS->SERCOM_STATUS   = SERCOM_I2CM_STATUS_BUSERR_Msk | SERCOM_I2CM_STATUS_ARBLOST_Msk;
+        I2C_REGS->SERCOM_INTFLAG  = SERCOM_I2CM_INTFLAG_Msk;
+        i2c_finish(I2C_BUS_ERROR, &woken);
+    }
+    else if ((flags & SERCOM_I2CM_INTFLAG_MB_Msk) != 0u)
+    {
+        /* Master on bus: address or data byte written */
+        if ((I2C_REGS->SERCOM_STATUS & SERCOM_I2CM_STATUS_RXNACK_Msk) != 0u)
+        {
+            i2c_stop();
+            i2c_finish(I2C_NACK, &woken);
+        }
+        else if (i2c_pos < t->tx_len)
+        {
+            I2C_REGS->SERCOM_DATA = t->tx[i2c_pos++];
+        }
+        else if (t->rx_len != 0u)
+        {
+            i2c_read(t);
+        }
+        else
+        {
+            i2c_stop();
+            i2c_finish(I2C_OK, &woken);
+        }
+    }
+    else if ((flags & SERCOM_I2CM_INTFLAG_SB_Msk) != 0u)
+    {
+        /* Slave on bus: a byte was read; NACK + STOP before taking the last */
+        if (i2c_pos + 1u >= t->rx_len)
+        {
+            I2C_REGS->SERCOM_CTRLB |= SERCOM_I2CM_CTRLB_ACKACT_Msk;
+            i2c_stop();
+            t->rx[i2c_pos] = (uint8_t)I2C_REGS->SERCOM_DATA;
+            i2c_finish(I2C_OK, &woken);
+        }
+        else
+        {
+            t->rx[i2c_pos++] = (uint8_t)I2C_REGS->SERCOM_DATA;
+        }
+    }
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_I2C);
+    portYIELD_FROM_ISR(woken);
+}
@@ -0,0 +1,87 @@
+/* =============================================================================
+ * i2c_bus.h  -  Interrupt-driven SERCOM2 I2C master with a transaction queue
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * SERCOM2 on PA12 (SDA, PAD0) / PA13 (SCL, PAD1), peripheral C, clocked
+ * from GCLK3 (48 MHz). A transaction is one addressed write, read or
+ * write-then-read (repeated start), described by an i2c_txn_t that the
+ * caller owns. I2c_Submit() appends it to a queue; the SERCOM interrupts
+ * move every byte and start the next transaction as soon as one ends, so
+ * the CPU is only busy for a few instructions per byte. A read phase of
+ * I2C_DMA_MIN..255 bytes costs none: the address goes out with
+ * ADDR.LENEN, the master ACKs and finally NACKs and STOPs by itself, and
+ * DMA_OTHER channel I2C_DMA_RX (sercom.h) takes the bytes; its completion
+ * ends the transaction. When a
+ * transaction finishes, the task that submitted it gets a notification on
+ * I2C_NOTIFY_INDEX. I2c_Transfer() wraps submit + wait for the usual
+ * blocking call, with no busy-waiting underneath.
+ *
+ *   static const uint8_t on[] = { 0x08 };
+ *   i2c_status_t s = I2c_Transfer(0x27, on, 1u, NULL, 0u, 10u);
+ *
+ * Any number of tasks may share the bus. A task waits for one transaction
+ * at a time. Not from ISRs.
+ * ============================================================================= */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define I2C_SCL_HZ          100000u     /* 100 kHz standard, 400 kHz fast mode */
+#define I2C_GCLK_HZ         48000000u   /* GCLK3                               */
+#define I2C_RISE_NS         300u        /* bus rise time, for the baud value   */
+#define I2C_IRQ_PRIO        IRQ_PRIO_I2C        /* NVIC, irqprio.h         */
+#define I2C_DMA_RX          20u         /* DMA_OTHER channel, dma_qos.h        */
+#define I2C_DMA_MIN         2u          /* shorter reads stay on the interrupt */
+#define I2C_NOTIFY_INDEX    2u          /* 0: NeoPixel DMA, 1: effects wake-up */
+
+typedef enum
+{
+    I2C_OK = 0,
+    I2C_PENDING,            /* queued or on the bus                       */
+    I2C_NACK,               /* address or data byte not acknowledged      */
+    I2C_BUS_ERROR,          /* bus error or arbitration lost              */
+    I2C_TIMEOUT             /* I2c_Wait() gave up; transaction withdrawn  */
+} i2c_status_t;
+
+typedef struct i2c_txn
+{
+    struct i2c_txn         *next;       /* queue link, owned by the driver */
+    const uint8_t          *tx;         /* written first (tx_len may be 0) */
+    uint8_t                *rx;         /* then read after a repeated start */
+    uint16_t                tx_len;
+    uint16_t                rx_len;
+    uint8_t                 addr;       /* 7-bit address                   */
+    volatile i2c_status_t   status;
+    TaskHandle_t            task;       /* notified on completion          */
+} i2c_txn_t;
+
+/**
+ * Configure SERCOM2, its pins and the read DMA, before the scheduler
+ * starts. Every bus user calls it; the calls after the first do nothing.
+ */
+void I2c_Init(void);
+
+/**
+ * Queue txn (fill addr, tx/tx_len, rx/rx_len; the rest is set here). The
+ * struct and buffers must stay valid until I2c_Wait() returns.
+ */
+void I2c_Submit(i2c_txn_t *txn);
+
+/**
+ * Block until txn completes or timeout_ms passes; on timeout it is taken
+ * off the queue (or the bus is stopped) and I2C_TIMEOUT is returned.
+ */
+i2c_status_t I2c_Wait(i2c_txn_t *txn, uint32_t timeout_ms);
+
+/** I2c_Submit() + I2c_Wait() on a transaction on the caller's stack. */
+i2c_status_t I2c_Transfer(uint8_t addr, const uint8_t *tx, uint16_t tx_len,
+                          uint8_t *rx, uint16_t rx_len, uint32_t timeout_ms);
+
+#endif /* I2C_BUS_H */
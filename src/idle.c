@@ -0,0 +1,98 @@
+/* =============================================================================
+ * idle.c  -  Sleep in idle, and an always-on load meter from the sleep time
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "idle.h"
+#include "definitions.h"        /* PM_REGS, DWT, CPU_CLOCK_FREQUENCY */
+#include "showclock.h"
+#include "cpufreq.h"          /* CYCCNT steps at any CPU clock */
+
+#define IDLE_CYCLES_PER_US  (CPU_CLOCK_FREQUENCY / 1000000u)
+#define IDLE_WINDOW_US      (IDLE_WINDOW_MS * 1000u)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Idle task only, interrupts masked */
+static uint32_t idle_sleep_us0;
+static uint32_t idle_sleep_cyc0;
+static uint32_t idle_win_start;
+static uint32_t idle_win_slept;
+static uint32_t idle_win_paused;        /* standby time the show clock missed */
+
+/* Published for any task */
+static volatile uint32_t idle_load_pm = 1000u;
+static volatile uint32_t idle_pub_us;
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Idle_Init(void)
+{
+    PM_REGS->PM_SLEEPCFG = PM_SLEEPCFG_SLEEPMODE_IDLE;
+    while ((PM_REGS->PM_SLEEPCFG & PM_SLEEPCFG_SLEEPMODE_Msk) != PM_SLEEPCFG_SLEEPMODE_IDLE) {}
+    idle_win_start = ShowClock_Now();
+    idle_pub_us    = idle_win_start;
+}
+
+void Idle_SleepEnter(void)
+{
+    idle_sleep_us0  = ShowClock_Now();
+    idle_sleep_cyc0 = CpuFreq_Cycles();
+}
+
+/* One sleep of slept us is over; paused: the show clock did not see it */
+static void idle_account(uint32_t now, uint32_t slept, uint32_t paused)
+{
+    uint32_t wall    = slept * IDLE_CYCLES_PER_US;     /* < 2^32: sleeps are < 30 s */
+    uint32_t counted = DWT->CYCCNT - idle_sleep_cyc0;
+
+    /* Cycles the stopped core did not count; never step the counter back */
+    if (wall > counted) CpuFreq_AddCycles(wall - counted);
+
+    idle_win_slept  += slept;
+    idle_win_paused += paused;
+    uint32_t span = now - idle_win_start + idle_win_paused;
+
+    if (span >= IDLE_WINDOW_US)
+    {
+        uint32_t busy = (idle_win_slept < span) ? span - idle_win_slept : 0u;
+
+        idle_load_pm    = (uint32_t)(((uint64_t)busy * 1000u + span / 2u) / span);
+        idle_pub_us     = now;
+        idle_win_start  = now;
+        idle_win_slept  = 0u;
+        idle_win_paused = 0u;
+    }
+}
+
+void Idle_SleepExit(void)
+{
+    uint32_t now = ShowClock_Now();
+
+    idle_account(now, now - idle_sleep_us0, 0u);
+}
+
+void Idle_SleepExitStandby(uint32_t slept_us)
+{
+    idle_account(ShowClock_Now(), slept_us, slept_us);
+}
+
+void Idle_Hook(void)
+{
+#if IDLE_SLEEP
+    /* A wake-up pending already makes the WFI fall through: none is lost */
+    __disable_irq();
+    Idle_SleepEnter();
+    __DSB();
+    __WFI();
+    __ISB();
+    Idle_SleepExit();
+    __enable_irq();
+#endif
+}
+
+uint32_t Idle_LoadPm(void)
+{
+    if ((ShowClock_Now() - idle_pub_us) >= 2u * IDLE_WINDOW_US) return 1000u;
+    return idle_load_pm;
+}
@@ -0,0 +1,58 @@
+/* =============================================================================
+ * idle.h  -  Sleep in idle, and an always-on load meter from the sleep time
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The idle task sleeps whenever it runs:
+ *   - short gaps: vApplicationIdleHook() (freertos_hooks.c) calls
+ *     Idle_Hook(), which waits for the next interrupt (WFI);
+ *   - gaps of two ticks or more: tickless.h stops the tick and sleeps on
+ *     the RTC, timing the sleep through Idle_SleepEnter() / _Exit().
+ * Both sleep with interrupts masked, so the ISR that wakes the core runs
+ * only after the sleep has been timed.
+ *
+ * Sleep time is measured on the ShowClock (1 MHz TC0, running in IDLE
+ * sleep), or on the RTC for STANDBY, which pauses the ShowClock.
+ * Once every IDLE_WINDOW_MS of it the share not slept is published as
+ * Idle_LoadPm(): a cheap load figure that needs no run-time stats. It
+ * counts interrupts and the idle loop itself as busy.
+ *
+ * The core clock stops in sleep and DWT->CYCCNT with it. Idle_SleepExit()
+ * adds the slept cycles back, so the run-time stats (cpuload.h), render
+ * timing and trace stamps keep counting wall time; at a divided CPU clock
+ * through cpufreq.h, which scales the cycles counted awake.
+ *
+ * The idle hook always uses SLEEPMODE IDLE, which stops only the CPU; the
+ * DMAC, SERCOMs and timers keep running, so NeoPixel frames, console and
+ * sensors go on undisturbed. STANDBY is tickless.h's decision.
+ * ============================================================================= */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define IDLE_SLEEP          1           /* 0 = spin in the idle hook (debug)  */
+#define IDLE_WINDOW_MS      1000u       /* Idle_LoadPm() update period        */
+
+/** Select the IDLE sleep mode and start the meter. After ShowClock_Init(). */
+void Idle_Init(void);
+
+/** From vApplicationIdleHook() only. */
+void Idle_Hook(void);
+
+/** Around a WFI, interrupts masked: tickless.c and Idle_Hook(). */
+void Idle_SleepEnter(void);
+void Idle_SleepExit(void);
+
+/** Instead of Idle_SleepExit() after STANDBY: the show clock was paused,
+ *  slept_us comes from the RTC. */
+void Idle_SleepExitStandby(uint32_t slept_us);
+
+/**
+ * Busy share of the last window, permille. 1000 if the idle task has not
+ * run for two windows (the CPU is saturated). Any task.
+ */
+uint32_t Idle_LoadPm(void);
+
+#endif /* IDLE_H */
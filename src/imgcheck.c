@@ -0,0 +1,249 @@
+/* =============================================================================
+ * imgcheck.c  -  Image integrity on the ICM: SHA-256 at boot and in the background
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "imgcheck.h"
+#include "definitions.h"        /* ICM_REGS, MCLK, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "nvstore.h"
+#include "nvwrite.h"
+#include "fwupdate.h"
+#include "actuator.h"
+#include "statusled.h"
+#include "showclock.h"
+#include "irqprio.h"
+#include "irqstat.h"
+#include "log.h"
+#include <string.h>
+
+#define IC_BLOCK            64u                     /* ICM: bytes per SHA block */
+#define IC_ALGO_SHA256      1u
+#define IC_KEY_SIZE         NVSTORE_KEY('I', 'M', 'G', 'S')
+#define IC_KEY(n)           NVSTORE_KEY('I', 'M', 'G', '0' + (n))
+#define IC_RECORDS          (IMGCHECK_WORDS / NVSTORE_WORDS)
+#define IC_REGION_IRQ       (ICM_RCFG_WCIEN_DIS | ICM_RCFG_ECIEN_DIS | ICM_RCFG_SUIEN_DIS)
+
+_Static_assert(IMGCHECK_WORDS % NVSTORE_WORDS == 0u, "whole nvstore records per digest");
+_Static_assert(FWUPDATE_IMAGE_MAX / IC_BLOCK <= 0x10000u, "RCTRL.TRSIZE is 16 bits of blocks");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Read by the ICM as a bus master: the descriptor on 64 bytes, the hash area (4 regions) on 128 */
+static icm_descriptor_registers_t ic_dscr __attribute__((aligned(64)));
+static uint32_t                   ic_hash[4u * IMGCHECK_WORDS] __attribute__((aligned(128)));
+
+static uint32_t                   ic_seal[IMGCHECK_WORDS];
+static uint32_t                   ic_size;
+static volatile imgcheck_state_t  ic_state;
+static volatile uint32_t          ic_boot_us;
+static uint32_t                   ic_t0;
+
+static uint32_t                   ic_new[IMGCHECK_WORDS];   /* ImgCheck_SealRunning(), to the timer task */
+
+/* Disabled, no interrupt left pending; ICM_ISR clears on read */
+static void ic_stop(void)
+{
+    ICM_REGS->ICM_CTRL = ICM_CTRL_DISABLE_Msk;
+    while ((ICM_REGS->ICM_SR & ICM_SR_ENABLE_Msk) != 0u) {}
+    ICM_REGS->ICM_IDR = ICM_IDR_Msk;
+    (void)ICM_REGS->ICM_ISR;
+}
+
+/* One region descriptor and go; the caller picks compare or write-back, wrap or end */
+static void ic_start(uint32_t addr, uint32_t size, uint32_t rcfg)
+{
+    ic_dscr.ICM_RADDR = addr;
+    ic_dscr.ICM_RCFG  = rcfg | ICM_RCFG_ALGO(IC_ALGO_SHA256) | IC_REGION_IRQ;
+    ic_dscr.ICM_RCTRL = ICM_RCTRL_TRSIZE((size + IC_BLOCK - 1u) / IC_BLOCK - 1u);
+    ic_dscr.ICM_RNEXT = 0u;
+
+    ICM_REGS->ICM_CFG  = ICM_CFG_BBC(IMGCHECK_BBC) | ICM_CFG_SLBDIS_Msk;
+    ICM_REGS->ICM_DSCR = (uint32_t)&ic_dscr;
+    ICM_REGS->ICM_HASH = (uint32_t)ic_hash;
+    ICM_REGS->ICM_CTRL = ICM_CTRL_RMEN(1u);
+    ICM_REGS->ICM_CTRL = ICM_CTRL_ENABLE_Msk;
+}
+
+/* The running image against its seal: once, or for ever with IMGCHECK_WATCH */
+static void ic_watch(void)
+{
+    if (ic_size == 0u || ic_state == IMGCHECK_BAD) return;
+    memcpy(ic_hash, ic_seal, sizeof(ic_seal));
+    ic_start(0u, ic_size, ICM_RCFG_CDWBN_COMP | (IMGCHECK_WATCH ? ICM_RCFG_WRAP_YES : ICM_RCFG_EOM_YES));
+    ICM_REGS->ICM_IER = ICM_IER_RDM(1u) | ICM_IER_RBE(1u)
+                      | ((ic_state == IMGCHECK_CHECKING) ? ICM_IER_RHC(1u) : 0u);
+}
+
+static void ic_ev_ok(void *a, uint32_t us)
+{
+    (void)a;
+    LOG_INFO("imgcheck: image verified, %lu bytes in %lu us", (unsigned long)ic_size, (unsigned long)us);
+}
+
+/* Size first cleared, last set: a seal cut short reads as none, not as a
+ * mismatch. `save` is NvStore_Save(), or NvWrite_Post(), which keeps the order */
+static bool ic_save_seal(bool (*save)(uint32_t, const uint32_t *), uint32_t size,
+                         const uint32_t digest[IMGCHECK_WORDS])
+{
+    uint32_t w[NVSTORE_WORDS] = { 0u, 0xFFFFFFFFu };
+    bool     ok;
+
+    ok = save(IC_KEY_SIZE, w);
+    for (uint32_t k = 0; ok && k < IC_RECORDS; k++)
+        ok = save(IC_KEY(k), &digest[k * NVSTORE_WORDS]);
+    w[0] = size;
+    w[1] = ~size;
+    return ok && save(IC_KEY_SIZE, w);
+}
+
+/* Timer task: the relays are already open (ICM_Handler()); keep them so */
+static void ic_ev_bad(void *a, uint32_t isr)
+{
+    (void)a;
+    LOG_ERROR("imgcheck: image %s, relays held off",
+              ((isr & ICM_ISR_RBE(1u)) != 0u) ? "unreadable" : "digest mismatch");
+    (void)Actuator_Park(true);
+    StatusLed_Set(STATUSLED_DEGRADED);
+}
+
+static void ic_ev_seal(void *a, uint32_t size)
+{
+    (void)a;
+    if (!ic_save_seal(NvWrite_Post, size, ic_new)) LOG_ERROR("imgcheck: seal not saved");
+}
+
+/* Running image end: its last programmed word below FWUPDATE_IMAGE_MAX */
+static uint32_t ic_image_end(void)
+{
+    const uint32_t *w = (const uint32_t *)0u;
+    uint32_t        n = FWUPDATE_IMAGE_MAX / 4u;
+
+    while (n != 0u && w[n - 1u] == 0xFFFFFFFFu) n--;
+    return n * 4u;
+}
+
+void ICM_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+    uint32_t   isr;
+
+    IRQSTAT_ENTER(IRQSTAT_IMGCHECK);
+    isr = ICM_REGS->ICM_ISR & ICM_REGS->ICM_IMR;
+    if ((isr & (ICM_ISR_RDM(1u) | ICM_ISR_RBE(1u))) != 0u)
+    {
+        Actuator_Safe();
+        ic_state = IMGCHECK_BAD;
+        ICM_REGS->ICM_IDR = ICM_IDR_Msk;
+        (void)xTimerPendFunctionCallFromISR(ic_ev_bad, NULL, isr, &woken);
+    }
+    else if ((isr & ICM_ISR_RHC(1u)) != 0u && ic_state == IMGCHECK_CHECKING)
+    {
+        ic_boot_us = ShowClock_Now() - ic_t0;
+        ic_state   = IMGCHECK_OK;
+        ICM_REGS->ICM_IDR = ICM_IDR_RHC(1u);        /* from here on, only a mismatch interrupts */
+        (void)xTimerPendFunctionCallFromISR(ic_ev_ok, NULL, ic_boot_us, &woken);
+    }
+    IRQSTAT_EXIT(IRQSTAT_IMGCHECK);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void ImgCheck_Init(void)
+{
+#if IMGCHECK_ENABLE
+    uint32_t w[NVSTORE_WORDS];
+    bool     sealed = NvStore_Load(IC_KEY_SIZE, w) && w[1] == ~w[0]
+                   && w[0] != 0u && w[0] <= FWUPDATE_IMAGE_MAX;
+
+    for (uint32_t k = 0; sealed && k < IC_RECORDS; k++)
+        sealed = NvStore_Load(IC_KEY(k), &ic_seal[k * NVSTORE_WORDS]);
+
+    MCLK_REGS->MCLK_AHBMASK  |= MCLK_AHBMASK_ICM_Msk;
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_ICM_Msk;
+    ic_stop();
+    NVIC_SetPriority(ICM_IRQn, IRQ_PRIO_IMGCHECK);
+    NVIC_ClearPendingIRQ(ICM_IRQn);
+    NVIC_EnableIRQ(ICM_IRQn);
+
+    if (!sealed)
+    {
+        ic_state = IMGCHECK_UNSEALED;
+        LOG_WARN("imgcheck: image not sealed%s, 'img seal' to seal it",
+                 IMGCHECK_REQUIRE_SEAL ? ", relays held off" : "");
+        return;
+    }
+    ic_size  = w[0];
+    ic_state = IMGCHECK_CHECKING;
+    ic_t0    = ShowClock_Now();
+    ic_watch();
+#endif
+}
+
+bool ImgCheck_Ok(void)
+{
+    imgcheck_state_t s = ic_state;
+
+    return !IMGCHECK_ENABLE || s == IMGCHECK_OK || (s == IMGCHECK_UNSEALED && !IMGCHECK_REQUIRE_SEAL);
+}
+
+imgcheck_state_t ImgCheck_State(void)
+{
+    return ic_state;
+}
+
+uint32_t ImgCheck_Size(void)
+{
+    return ic_size;
+}
+
+uint32_t ImgCheck_BootUs(void)
+{
+    return ic_boot_us;
+}
+
+bool ImgCheck_Digest(uint32_t addr, uint32_t size, uint32_t digest[IMGCHECK_WORDS])
+{
+    TickType_t start = xTaskGetTickCount();
+    uint32_t   isr   = 0u;
+    bool       ok;
+
+    if (!IMGCHECK_ENABLE || size == 0u || size > FWUPDATE_IMAGE_MAX || (addr % IC_BLOCK) != 0u)
+        return false;
+
+    ic_stop();
+    ic_start(addr, size, ICM_RCFG_CDWBN_WRBA | ICM_RCFG_EOM_YES);
+    while (((isr |= ICM_REGS->ICM_ISR) & (ICM_ISR_RHC(1u) | ICM_ISR_RBE(1u))) == 0u &&
+           (xTaskGetTickCount() - start) < pdMS_TO_TICKS(IMGCHECK_TIMEOUT_MS))
+        vTaskDelay(1);
+
+    ok = (isr & ICM_ISR_RHC(1u)) != 0u && (isr & ICM_ISR_RBE(1u)) == 0u;
+    if (ok) memcpy(digest, ic_hash, IMGCHECK_WORDS * 4u);
+    ic_stop();
+    ic_watch();
+    return ok;
+}
+
+bool ImgCheck_Seal(uint32_t size, const uint32_t digest[IMGCHECK_WORDS])
+{
+    return ic_save_seal(NvStore_Save, size, digest);
+}
+
+bool ImgCheck_SealRunning(void)
+{
+    uint32_t size = ic_image_end();
+
+    if (!ImgCheck_Digest(0u, size, ic_new)) return false;
+
+    taskENTER_CRITICAL();
+    memcpy(ic_seal, ic_new, sizeof(ic_seal));
+    ic_size  = size;
+    ic_state = IMGCHECK_OK;                 /* hashed just now */
+    taskEXIT_CRITICAL();
+    ic_stop();
+    ic_watch();
+    return xTimerPendFunctionCall(ic_ev_seal, NULL, size, pdMS_TO_TICKS(100)) == pdPASS;
+}
@@ -0,0 +1,82 @@
+/* =============================================================================
+ * imgcheck.h  -  Image integrity on the ICM: SHA-256 at boot and in the background
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The Integrity Check Monitor hashes flash as a bus master, by DMA: no
+ * CPU time goes into the digest. At boot ImgCheck_Init() hands it the
+ * running image (bank at 0) and the digest sealed for it, and returns;
+ * the first pass compares in hardware, a few milliseconds at 120 MHz, and
+ * the ICM interrupt reports the result. Until the pass has matched no
+ * actuator sequence starts (ImgCheck_Ok(), actuator.c): the LEDs come up
+ * as before, the relays wait for a known image.
+ *
+ *   Seal     The digest (eight words) and the image size are records in
+ *            nvstore.h, for the image mapped at 0. fwupdate.c takes the
+ *            new image's digest with ImgCheck_Digest() once its CRC is
+ *            good and seals it right before the bank swap, so the next
+ *            boot checks what was just written. An image put on with the
+ *            debugger has no seal: "img seal" takes its digest, up to its
+ *            last programmed word.
+ *   Watch    With IMGCHECK_WATCH the ICM keeps hashing the image after
+ *            the first pass, each pass compared too, IMGCHECK_BBC idle
+ *            cycles between its bus bursts so it does not crowd the CPU's
+ *            fetches. A mismatch at any time opens every relay
+ *            (Actuator_Safe()), blocks the sequences and shows
+ *            STATUSLED_DEGRADED: the flash is failing under the show.
+ *
+ * The digest is the ICM's over whole 64-byte blocks, the last one padded
+ * with erased flash; it is not a sha256sum of the file. Unsealed images
+ * run with a warning unless IMGCHECK_REQUIRE_SEAL.
+ * ============================================================================= */
+
+#ifndef IMGCHECK_H
+#define IMGCHECK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef IMGCHECK_ENABLE
+#define IMGCHECK_ENABLE         1
+#endif
+#define IMGCHECK_WATCH          1       /* keep hashing after the boot pass     */
+#define IMGCHECK_BBC            15u     /* idle cycles between bursts, 0 .. 15  */
+#define IMGCHECK_REQUIRE_SEAL   0       /* 1 = no seal, no relays               */
+#define IMGCHECK_TIMEOUT_MS     1000u   /* one ImgCheck_Digest() pass           */
+
+#define IMGCHECK_WORDS          8u      /* SHA-256 */
+
+typedef enum
+{
+    IMGCHECK_UNSEALED = 0,      /* no digest stored for this image */
+    IMGCHECK_CHECKING,          /* first pass running              */
+    IMGCHECK_OK,
+    IMGCHECK_BAD                /* digest mismatch or bus error    */
+} imgcheck_state_t;
+
+/** Load the seal and start the first pass. After ShowClock_Init(), before Actuator_Start(). */
+void ImgCheck_Init(void);
+
+/** The image may drive the relays: matched, or unsealed without IMGCHECK_REQUIRE_SEAL. Any context. */
+bool ImgCheck_Ok(void);
+
+/** Where the check stands. Any task. */
+imgcheck_state_t ImgCheck_State(void);
+
+/** Sealed image size in bytes, 0 if none; microseconds the boot pass took, 0 until done. Any task. */
+uint32_t ImgCheck_Size(void);
+uint32_t ImgCheck_BootUs(void);
+
+/**
+ * ICM digest of `size` bytes at `addr` (64-byte aligned) into `digest`;
+ * the watch pauses meanwhile. Blocks up to IMGCHECK_TIMEOUT_MS. One task at a time.
+ */
+bool ImgCheck_Digest(uint32_t addr, uint32_t size, uint32_t digest[IMGCHECK_WORDS]);
+
+/** Seal the image at 0 as `size` bytes with `digest`, written before it returns. fwupdate.c, right before the swap. */
+bool ImgCheck_Seal(uint32_t size, const uint32_t digest[IMGCHECK_WORDS]);
+
+/** Digest the running image and seal it, the watch then compares against it. Any task. */
+bool ImgCheck_SealRunning(void);
+
+#endif /* IMGCHECK_H */
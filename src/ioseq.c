@@ -0,0 +1,307 @@
+/* =============================================================================
+ * ioseq.c  -  Auxiliary output choreography played by TCC4 and the DMAC, no CPU
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "ioseq.h"
+#include "definitions.h"        /* PORT_REGS, TCC4_REGS, DMAC_REGS */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "tickless.h"
+#include "brownout.h"
+#include "imgcheck.h"
+#include "actuator.h"
+
+#define IO_TICK_MAX         0x10000u                /* TCC4 is 16 bits, 1 us ticks (GCLK2) */
+
+_Static_assert(IOSEQ_OUTPUTS >= 1u && IOSEQ_OUTPUTS <= 16u, "SHOW_IOSEQ: a step is 16 bits");
+_Static_assert(IOSEQ_STEPS_MAX >= 2u && IOSEQ_STEPS_MAX <= 0xFFFFu, "IOSEQ_STEPS_MAX: BTCNT is 16 bits");
+_Static_assert(IOSEQ_MIN_US >= 2u, "IOSEQ_MIN_US: PERBUF needs the reload before the next overflow");
+#if IOSEQ_DMA_TGL < DMA_OTHER_FIRST || IOSEQ_DMA_TGL >= DMA_OTHER_FIRST + DMA_OTHER_COUNT || \
+    IOSEQ_DMA_PER < DMA_OTHER_FIRST || IOSEQ_DMA_PER >= DMA_OTHER_FIRST + DMA_OTHER_COUNT
+#error "IOSEQ_DMA_TGL / IOSEQ_DMA_PER must be DMA_OTHER channels with a descriptor slot (dma_qos.h)"
+#endif
+
+static const uint32_t io_pin[IOSEQ_OUTPUTS] =
+{
+#define IO_X_PIN(id, name, pin) [IOSEQ_##id] = (pin),
+    SHOW_IOSEQ(IO_X_PIN)
+#undef IO_X_PIN
+};
+
+#define IO_X_MASK(id, name, pin) | (pin)
+#define IO_ALL              (0u SHOW_IOSEQ(IO_X_MASK))
+
+/* -- Built-in patterns ------------------------------------------------------- */
+
+static const ioseq_step_t io_strobe[] =
+{
+    { IOSEQ_BIT(STROBE),   5000u }, { 0u,  95000u },
+};
+
+static const ioseq_step_t io_knock[] =
+{
+    { IOSEQ_BIT(KNOCK),   30000u }, { 0u, 170000u },
+    { IOSEQ_BIT(KNOCK),   30000u }, { 0u, 170000u },
+    { IOSEQ_BIT(KNOCK),   30000u },
+};
+
+static const ioseq_step_t io_fog[] =
+{
+    { IOSEQ_BIT(FOG),   3000000u },
+};
+
+static const ioseq_step_t io_storm[] =
+{
+    { IOSEQ_BIT(STROBE),  20000u }, { 0u,  80000u },
+    { IOSEQ_BIT(STROBE),  40000u }, { 0u, 900000u },
+    { IOSEQ_BIT(KNOCK),   30000u }, { 0u, 170000u },
+    { IOSEQ_BIT(STROBE) | IOSEQ_BIT(KNOCK), 30000u }, { 0u, 3500000u },
+};
+
+static const struct
+{
+    const char         *name;
+    const ioseq_step_t *steps;
+    uint8_t             count;
+    bool                loop;
+} io_pattern[IOSEQ_PATTERNS] =
+{
+    [IOSEQ_PAT_STROBE] = { "strobe", io_strobe, sizeof(io_strobe) / sizeof(io_strobe[0]), true  },
+    [IOSEQ_PAT_KNOCK]  = { "knock",  io_knock,  sizeof(io_knock)  / sizeof(io_knock[0]),  false },
+    [IOSEQ_PAT_FOG]    = { "fog",    io_fog,    sizeof(io_fog)    / sizeof(io_fog[0]),    false },
+    [IOSEQ_PAT_STORM]  = { "storm",  io_storm,  sizeof(io_storm)  / sizeof(io_storm[0]),  true  },
+};
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t          io_tgl[IOSEQ_STEPS_MAX] DMA_RAM; /* OUTTGL words, read by the DMAC        */
+static uint32_t          io_per[IOSEQ_STEPS_MAX] DMA_RAM; /* PERBUF words, the step after next     */
+static ioseq_stats_t     io_stats;
+static volatile bool     io_busy;
+static bool              io_loop;
+static bool              io_ready;                   /* IoSeq_Init() has clocked TCC4 */
+
+#if IOSEQ_ENABLE
+
+static port_group_registers_t *io_port(void)
+{
+    return &PORT_REGS->GROUP[IOSEQ_GROUP];
+}
+
+static uint32_t io_mask(uint16_t on)
+{
+    uint32_t m = 0u;
+
+    for (uint32_t i = 0; i < IOSEQ_OUTPUTS; i++)
+        if (((on >> i) & 1u) != 0u) m |= io_pin[i];
+    return m;
+}
+
+static void io_channel_off(uint32_t ch)
+{
+    DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+    while ((DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u) {}
+    DMAC_REGS->CHANNEL[ch].DMAC_CHINTENCLR = DMAC_CHINTENCLR_Msk;
+    DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG  = DMAC_CHINTFLAG_Msk;
+}
+
+static void io_timer_off(void)
+{
+    TCC4_REGS->TCC_CTRLA &= ~TCC_CTRLA_ENABLE_Msk;
+    while ((TCC4_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+}
+
+/*
+ * Steps into the rings: first the port state and length of each ring word,
+ * long steps split evenly, then in place the toggle from each state to the
+ * next and the length two words on. Returns the words, 0 if over the rings.
+ * `*per0` / `*per1` get the first two lengths (PER, PERBUF at the start).
+ */
+static uint32_t io_compile(const ioseq_step_t *steps, uint32_t n, bool loop,
+                           uint32_t *state0, uint32_t *per0, uint32_t *per1)
+{
+    uint32_t m = 0u;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint32_t us = steps[i].us;
+        uint32_t parts, base, extra;
+
+        if (us == 0u) continue;
+        if (us < IOSEQ_MIN_US) us = IOSEQ_MIN_US;
+        parts = (us + IO_TICK_MAX - 1u) / IO_TICK_MAX;
+        if (parts > IOSEQ_STEPS_MAX - m) return 0u;
+        base  = us / parts;
+        extra = us % parts;
+        for (uint32_t p = 0; p < parts; p++, m++)
+        {
+            io_tgl[m] = io_mask(steps[i].on);
+            io_per[m] = base + ((p < extra) ? 1u : 0u) - 1u;
+        }
+    }
+    if (m == 0u) return 0u;
+
+    *state0 = io_tgl[0];
+    *per0   = io_per[0];
+    *per1   = io_per[1u % m];
+    for (uint32_t k = 0; k < m; k++)
+    {
+        io_tgl[k] ^= (k + 1u < m) ? io_tgl[k + 1u] : (loop ? *state0 : 0u);
+        io_per[k]  = (k + 2u < m) ? io_per[k + 2u] : (k + 2u == m) ? *per0 : *per1;
+    }
+    return m;
+}
+
+/* A ring of `words` words into the given register, linked to itself or not */
+static void io_desc(uint32_t ch, const uint32_t *ring, uint32_t words, volatile void *dst, uint32_t act, bool loop)
+{
+    dmac_descriptor_registers_t *desc0 = (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + ch;
+
+    desc0->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_SRCINC_Msk | act;
+    desc0->DMAC_BTCNT    = (uint16_t)words;
+    desc0->DMAC_SRCADDR  = (uint32_t)&ring[words];      /* end address with SRCINC */
+    desc0->DMAC_DSTADDR  = (uint32_t)dst;
+    desc0->DMAC_DESCADDR = loop ? (uint32_t)desc0 : 0u;
+}
+
+/* One-shot table: the last toggle has turned everything off. DMAC_OTHER ISR */
+static void io_dma_isr(uint8_t flags)
+{
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) == 0u || io_loop) return;
+
+    io_timer_off();
+    io_busy = false;
+    io_stats.done++;
+}
+
+static bool io_tickless_veto(void)
+{
+    return io_busy;
+}
+
+static bool io_gated(void)
+{
+    return Brownout_Active() || Actuator_Parked() || !ImgCheck_Ok();
+}
+#endif /* IOSEQ_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void IoSeq_Init(void)
+{
+#if IOSEQ_ENABLE
+    port_group_registers_t *g = io_port();
+
+    g->PORT_OUTCLR = IO_ALL;
+    g->PORT_DIRSET = IO_ALL;
+
+    MCLK_REGS->MCLK_APBDMASK |= MCLK_APBDMASK_TCC4_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TCC4_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;   /* 1 MHz */
+    while ((GCLK_REGS->GCLK_PCHCTRL[TCC4_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    TCC4_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC4_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TCC4_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV1 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC4_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NFRQ;
+    while (TCC4_REGS->TCC_SYNCBUSY != 0u) {}
+
+    /* Both channels on the overflow, one word each per step */
+    DMAC_REGS->CHANNEL[IOSEQ_DMA_TGL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(TCC4_DMAC_ID_OVF) | DMAC_CHCTRLA_TRIGACT_BURST;
+    DMAC_REGS->CHANNEL[IOSEQ_DMA_PER].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(TCC4_DMAC_ID_OVF) | DMAC_CHCTRLA_TRIGACT_BURST;
+    Dma_Assign((DMAC_CHANNEL)IOSEQ_DMA_TGL, DMA_CLASS_STREAM);
+    Dma_Assign((DMAC_CHANNEL)IOSEQ_DMA_PER, DMA_CLASS_STREAM);
+    (void)Dma_OtherRegister(IOSEQ_DMA_TGL, io_dma_isr);
+    (void)Tickless_RegisterVeto(io_tickless_veto);
+    io_ready = true;
+#endif
+}
+
+bool IoSeq_Play(const ioseq_step_t *steps, uint32_t n, bool loop)
+{
+#if IOSEQ_ENABLE
+    uint32_t state0, per0, per1, words;
+    bool     ok;
+
+    IoSeq_Stop();
+    words = io_gated() ? 0u : io_compile(steps, n, loop, &state0, &per0, &per1);
+    if (words == 0u)
+    {
+        io_stats.refused++;
+        return false;
+    }
+    io_desc(IOSEQ_DMA_TGL, io_tgl, words, &io_port()->PORT_OUTTGL, DMAC_BTCTRL_BLOCKACT_INT, loop);
+    io_desc(IOSEQ_DMA_PER, io_per, words, &TCC4_REGS->TCC_PERBUF, DMAC_BTCTRL_BLOCKACT_NOACT, loop);
+
+    TCC4_REGS->TCC_COUNT  = 0u;
+    TCC4_REGS->TCC_PER    = per0;
+    TCC4_REGS->TCC_PERBUF = per1;                       /* loaded at the first overflow */
+    while (TCC4_REGS->TCC_SYNCBUSY != 0u) {}
+
+    /* A brown-out or a failed check between the gate and here must win */
+    taskENTER_CRITICAL();
+    ok = !io_gated();
+    if (ok)
+    {
+        io_loop = loop;
+        io_busy = true;
+        io_stats.plays++;
+        io_stats.words = (uint16_t)words;
+        if (!loop) DMAC_REGS->CHANNEL[IOSEQ_DMA_TGL].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk;
+        DMAC_REGS->CHANNEL[IOSEQ_DMA_TGL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+        DMAC_REGS->CHANNEL[IOSEQ_DMA_PER].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+        io_port()->PORT_OUTSET = state0;
+        TCC4_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    }
+    else
+    {
+        io_stats.refused++;
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+#else
+    (void)steps;
+    (void)n;
+    (void)loop;
+    return false;
+#endif
+}
+
+bool IoSeq_Pattern(ioseq_pattern_t p)
+{
+    if ((uint32_t)p >= IOSEQ_PATTERNS) return false;
+    return IoSeq_Play(io_pattern[p].steps, io_pattern[p].count, io_pattern[p].loop);
+}
+
+const char *IoSeq_PatternName(ioseq_pattern_t p)
+{
+    return ((uint32_t)p < IOSEQ_PATTERNS) ? io_pattern[p].name : NULL;
+}
+
+void IoSeq_Stop(void)
+{
+#if IOSEQ_ENABLE
+    if (!io_ready) return;                              /* a brown-out before the init */
+    io_timer_off();
+    io_channel_off(IOSEQ_DMA_TGL);
+    io_channel_off(IOSEQ_DMA_PER);
+    io_port()->PORT_OUTCLR = IO_ALL;
+    io_busy = false;
+#endif
+}
+
+bool IoSeq_Busy(void)
+{
+    return io_busy;
+}
+
+void IoSeq_GetStats(ioseq_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = io_stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,106 @@
+/* =============================================================================
+ * ioseq.h  -  Auxiliary output choreography played by TCC4 and the DMAC, no CPU
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The fog trigger, the strobe and the knocker (SHOW_IOSEQ, showcfg.h) are
+ * plain outputs on IOSEQ_GROUP. Rather than a task per output sleeping
+ * between edges, as Actuator_Task does for the relays, a table of steps is
+ * compiled once into two rings the DMAC plays on its own:
+ *
+ *   Outputs  a word per step written to PORT OUTTGL, the outputs that
+ *            change between a step and the next; one channel
+ *            (IOSEQ_DMA_TGL). A toggle mask in one beat moves every
+ *            output of the step together, with none of the others touched.
+ *   Timing   TCC4 counts 1 us ticks (GCLK2) and overflows at the end of
+ *            each step; the overflow triggers both channels. The second one
+ *            (IOSEQ_DMA_PER) writes the length of the step after next to
+ *            PERBUF, which the TCC loads at the following overflow, so
+ *            every step has its own length, 1 us resolution, no jitter.
+ *
+ * A step longer than 65536 us is split into as many as it takes. With
+ * `loop` both descriptors are linked to themselves and the table repeats
+ * until IoSeq_Stop(); without, the outputs go off after the last step and
+ * the ring's block interrupt stops TCC4.
+ *
+ * The same gates as the relays apply: no play in a brown-out, parked or
+ * before the image check (imgcheck.h) has passed, and Actuator_Safe()
+ * stops the sequencer with the relays. TCC4 runs on GCLK2, which STANDBY
+ * stops, so tickless idle is vetoed while a table plays.
+ * ============================================================================= */
+
+#ifndef IOSEQ_H
+#define IOSEQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "showcfg.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef IOSEQ_ENABLE
+#define IOSEQ_ENABLE            1
+#endif
+#define IOSEQ_GROUP             1u          /* PORTB                                */
+#define IOSEQ_DMA_TGL           15u         /* DMA_OTHER channels, dma_qos.h        */
+#define IOSEQ_DMA_PER           16u
+#define IOSEQ_STEPS_MAX         512u        /* ring words, after splitting long steps */
+#define IOSEQ_MIN_US            5u          /* DMA reload margin per step           */
+
+typedef enum
+{
+#define IOSEQ_X_ENUM(id, name, pin) IOSEQ_##id,
+    SHOW_IOSEQ(IOSEQ_X_ENUM)
+#undef IOSEQ_X_ENUM
+    IOSEQ_OUTPUTS
+} ioseq_output_t;
+
+#define IOSEQ_BIT(id)           (1u << IOSEQ_##id)
+
+/** One step: the outputs on (IOSEQ_BIT()s) for `us` microseconds */
+typedef struct
+{
+    uint16_t on;
+    uint32_t us;
+} ioseq_step_t;
+
+typedef enum
+{
+    IOSEQ_PAT_STROBE = 0,       /* 10 Hz flash, until stopped          */
+    IOSEQ_PAT_KNOCK,            /* three knocks on the lid             */
+    IOSEQ_PAT_FOG,              /* a 3 s burst of fog                  */
+    IOSEQ_PAT_STORM,            /* lightning and knocks, until stopped */
+    IOSEQ_PATTERNS
+} ioseq_pattern_t;
+
+typedef struct
+{
+    uint32_t plays;
+    uint32_t refused;           /* gated, or too many steps after splitting */
+    uint32_t done;              /* one-shot tables run to their end         */
+    uint16_t words;             /* ring words of the table playing          */
+} ioseq_stats_t;
+
+/** Pins to outputs, all off; TCC4 and the two channels. After Dma_Init(), before the scheduler. */
+void IoSeq_Init(void);
+
+/**
+ * Compile `n` steps and play them from now, replacing any table playing;
+ * false if gated or over IOSEQ_STEPS_MAX words. One task at a time.
+ */
+bool IoSeq_Play(const ioseq_step_t *steps, uint32_t n, bool loop);
+
+/** Built-in pattern `p`. One task at a time. */
+bool IoSeq_Pattern(ioseq_pattern_t p);
+
+/** Console name of pattern `p`, NULL past the last. Any context. */
+const char *IoSeq_PatternName(ioseq_pattern_t p);
+
+/** Stop, every output off. Any context, interrupts included. */
+void IoSeq_Stop(void);
+
+/** A table is playing. Any context. */
+bool IoSeq_Busy(void);
+
+/** Counters since boot. Any task. */
+void IoSeq_GetStats(ioseq_stats_t *out);
+
+#endif /* IOSEQ_H */
@@ -0,0 +1,134 @@
+/* =============================================================================
+ * irqprio.h  -  Every NVIC priority in one table, checked at compile time
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * 3 priority bits, 0 is the highest; no sub-priorities (NVIC_Initialize()).
+ * FreeRTOSConfig.h takes the kernel and syscall levels from here, the
+ * modules take their own: change a priority here, not in the module.
+ *
+ *   0  WDT          watchdog early warning: dumps and resets, no RTOS calls
+ *   1  SUPC_BODDET  brownout: saves before the supply is gone (= ceiling)
+ *      EIC_6        e-stop press; the relays are cut in hardware already
+ *   2  DMAC_0..3    NeoPixel refill / wire done, and whatever else runs on
+ *                   the plib channels (stdio TX, motor PWM); short handlers
+ *      SERCOM0      CCL backend only: the frame's last bit is out (neopixel.c)
+ *   3  EIC_3, TC2   presence sensor edge and ranging (dsun_sensor.c)
+ *      TCC1         actuator pattern step (actuator.c)
+ *      ADC0         motor current window (motor_sense.c)
+ *      TC0          show clock carry, microsecond callbacks (hrtimer.c)
+ *   4  DMAC_OTHER   channels 4+: audio, DMX, pixdist and netbridge DMA (dma_qos.c)
+ *      SERCOM2      I2C bus
+ *      SERCOM5, TC3 console RX and its idle timeout (stdio_uart.c)
+ *   5  SERCOM0      DMX break / RX
+ *      SERCOM4      pixel distribution link
+ *      SERCOM3      network co-processor link, a frame's break (netbridge.c)
+ *      CAN1         show sync
+ *      USB          CDC console
+ *      PDEC         operator knob, a detent (knob.c)
+ *      FREQM        pended by rtosbench.c only (RTOSBENCH_ENABLE)
+ *      TCC0         servo frame: the next pulses to CCBUF (servo.c)
+ *      EIC_15       distance sensor has a reading: wakes its task (tof.c)
+ *   6  SDHC0        SD card
+ *      ICM          image digest: boot pass done, mismatch (imgcheck.c)
+ *   7  SysTick, PendSV, RTC (tickless wake), TRNG
+ *
+ * Everything from IRQ_PRIO_SYSCALL down is masked by FreeRTOS critical
+ * sections and may call the FromISR API; only the WDT sits above it.
+ * The NeoPixel refill has the highest level that may call the RTOS: in
+ * NEO_STREAMING mode it must re-encode a chunk within one chunk's wire
+ * time, and nothing that can run for long may delay it. The checks below
+ * fail the build if a FromISR user is put above the ceiling, or the DMX,
+ * audio, CAN or any other bulk interrupt at or above the refill.
+ *
+ * irqstat.h measures what the table promises: per ISR count, duration and,
+ * where the ISR knows when it was due, entry latency.
+ * ============================================================================= */
+
+#ifndef IRQPRIO_H
+#define IRQPRIO_H
+
+#define IRQ_PRIO_BITS           3u      /* __NVIC_PRIO_BITS of the SAME51 */
+
+/* -- The table --------------------------------------------------------------- */
+#define IRQ_PRIO_SYSCALL        1u      /* configMAX_SYSCALL_INTERRUPT_PRIORITY */
+#define IRQ_PRIO_KERNEL         7u      /* configKERNEL_INTERRUPT_PRIORITY      */
+
+#define IRQ_PRIO_WDT            0u
+#define IRQ_PRIO_BROWNOUT       1u
+#define IRQ_PRIO_ESTOP          1u
+#define IRQ_PRIO_DMAC           2u      /* DMAC_0..3, the NeoPixel refill       */
+#define IRQ_PRIO_DSUN           3u
+#define IRQ_PRIO_ACTUATOR       3u
+#define IRQ_PRIO_MSENSE         3u
+#define IRQ_PRIO_SHOWCLOCK      3u      /* hrtimer.h callbacks run in it        */
+#define IRQ_PRIO_DMA_OTHER      4u
+#define IRQ_PRIO_I2C            4u
+#define IRQ_PRIO_STDIO          4u
+#define IRQ_PRIO_DMX            5u
+#define IRQ_PRIO_PIXDIST        5u
+#define IRQ_PRIO_NETBRIDGE      5u
+#define IRQ_PRIO_SHOWSYNC       5u
+#define IRQ_PRIO_USB            5u
+#define IRQ_PRIO_KNOB           5u
+#define IRQ_PRIO_RTOSBENCH      5u
+#define IRQ_PRIO_SERVO          5u
+#define IRQ_PRIO_TOF            5u
+#define IRQ_PRIO_SDCARD         6u
+#define IRQ_PRIO_IMGCHECK       6u
+#define IRQ_PRIO_SYSTICK        IRQ_PRIO_KERNEL
+#define IRQ_PRIO_TICKLESS       7u
+#define IRQ_PRIO_TRNG           7u
+
+#define IRQ_PRIO_NEO            IRQ_PRIO_DMAC
+
+/** A table priority as the BASEPRI / configXXX_INTERRUPT_PRIORITY byte. */
+#define IRQ_PRIO_BYTE(p)        ((p) << (8u - IRQ_PRIO_BITS))
+
+/* -- Compile-time checks ----------------------------------------------------- */
+
+#if IRQ_PRIO_KERNEL != ((1u << IRQ_PRIO_BITS) - 1u)
+#error "irqprio.h: the kernel interrupts must have the lowest priority"
+#endif
+#if IRQ_PRIO_SYSCALL == 0u
+#error "irqprio.h: a syscall ceiling of 0 masks nothing (BASEPRI 0 is off)"
+#endif
+
+/* Calls the FromISR API: must be at or below the syscall ceiling */
+#define IRQ_PRIO_RTOS_OK(p)     ((p) >= IRQ_PRIO_SYSCALL && (p) <= IRQ_PRIO_KERNEL)
+
+#if !IRQ_PRIO_RTOS_OK(IRQ_PRIO_BROWNOUT)  || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_DMAC)     \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_ESTOP)                                               \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_DSUN)      || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_ACTUATOR) \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_MSENSE)    || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_DMA_OTHER) \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_I2C)       || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_STDIO)    \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_DMX)       || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_PIXDIST)  \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_SHOWSYNC)  || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_USB)      \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_SDCARD)    || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_TICKLESS) \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_SHOWCLOCK) || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_TRNG)     \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_KNOB)      || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_IMGCHECK) \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_RTOSBENCH)  || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_NETBRIDGE) \
+ || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_SERVO)     || !IRQ_PRIO_RTOS_OK(IRQ_PRIO_TOF)
+#error "irqprio.h: an ISR that calls FreeRTOS is above configMAX_SYSCALL_INTERRUPT_PRIORITY"
+#endif
+
+#if IRQ_PRIO_WDT >= IRQ_PRIO_SYSCALL
+#error "irqprio.h: the watchdog warning must not be masked by critical sections"
+#endif
+
+/* Bulk traffic must not delay the NeoPixel refill: strictly below it */
+#define IRQ_PRIO_BELOW_NEO(p)   ((p) > IRQ_PRIO_NEO)
+
+#if !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_DSUN)      || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_ACTUATOR) \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_MSENSE)    || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_DMA_OTHER) \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_I2C)       || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_STDIO)    \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_DMX)       || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_PIXDIST)  \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_SHOWSYNC)  || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_USB)      \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_SDCARD)    || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_TICKLESS) \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_SHOWCLOCK) || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_TRNG)     \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_KNOB)      || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_IMGCHECK) \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_RTOSBENCH)  || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_NETBRIDGE) \
+ || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_SERVO)     || !IRQ_PRIO_BELOW_NEO(IRQ_PRIO_TOF)
+#error "irqprio.h: an interrupt would delay the NeoPixel DMA refill"
+#endif
+
+#endif /* IRQPRIO_H */
@@ -0,0 +1,172 @@
+/* =============================================================================
+ * irqstat.c  -  Per-ISR count, duration and entry latency
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "irqstat.h"
+#include "irqprio.h"
+
+/* -- The table --------------------------------------------------------------- */
+
+typedef struct
+{
+    const char *name;
+    uint8_t     prio;
+} is_info_t;
+
+static const is_info_t is_info[IRQSTAT_COUNT] =
+{
+    [IRQSTAT_DMAC_0]     = { "dmac0",    IRQ_PRIO_DMAC      },
+    [IRQSTAT_DMAC_1]     = { "dmac1",    IRQ_PRIO_DMAC      },
+    [IRQSTAT_DMAC_2]     = { "dmac2",    IRQ_PRIO_DMAC      },
+    [IRQSTAT_DMAC_3]     = { "dmac3",    IRQ_PRIO_DMAC      },
+    [IRQSTAT_BROWNOUT]   = { "brownout", IRQ_PRIO_BROWNOUT  },
+    [IRQSTAT_ESTOP]      = { "estop",    IRQ_PRIO_ESTOP     },
+    [IRQSTAT_DSUN_EDGE]  = { "dsun",     IRQ_PRIO_DSUN      },
+    [IRQSTAT_DSUN_RANGE] = { "dsun-tc",  IRQ_PRIO_DSUN      },
+    [IRQSTAT_ACTUATOR]   = { "actuator", IRQ_PRIO_ACTUATOR  },
+    [IRQSTAT_MSENSE]     = { "msense",   IRQ_PRIO_MSENSE    },
+    [IRQSTAT_DMA_OTHER]  = { "dma4+",    IRQ_PRIO_DMA_OTHER },
+    [IRQSTAT_I2C]        = { "i2c",      IRQ_PRIO_I2C       },
+    [IRQSTAT_STDIO_RX]   = { "stdio",    IRQ_PRIO_STDIO     },
+    [IRQSTAT_STDIO_IDLE] = { "stdio-tc", IRQ_PRIO_STDIO     },
+    [IRQSTAT_DMX]        = { "dmx",      IRQ_PRIO_DMX       },
+    [IRQSTAT_PIXDIST]    = { "pixdist",  IRQ_PRIO_PIXDIST   },
+    [IRQSTAT_SHOWSYNC]   = { "can",      IRQ_PRIO_SHOWSYNC  },
+    [IRQSTAT_USB]        = { "usb",      IRQ_PRIO_USB       },
+    [IRQSTAT_SDCARD]     = { "sdcard",   IRQ_PRIO_SDCARD    },
+    [IRQSTAT_TICKLESS]   = { "rtc",      IRQ_PRIO_TICKLESS  },
+    [IRQSTAT_SHOWCLOCK]  = { "showclk",  IRQ_PRIO_SHOWCLOCK },
+    [IRQSTAT_TRNG]       = { "trng",     IRQ_PRIO_TRNG      },
+    [IRQSTAT_KNOB]       = { "knob",     IRQ_PRIO_KNOB      },
+    [IRQSTAT_IMGCHECK]   = { "icm",      IRQ_PRIO_IMGCHECK  },
+    [IRQSTAT_NETBRIDGE]  = { "netbr",    IRQ_PRIO_NETBRIDGE },
+    [IRQSTAT_SERVO]      = { "servo",    IRQ_PRIO_SERVO },
+    [IRQSTAT_TOF]        = { "tof",      IRQ_PRIO_TOF },
+};
+
+const char *IrqStat_Name(irqstat_id_t id)
+{
+    return (id < IRQSTAT_COUNT) ? is_info[id].name : "?";
+}
+
+uint32_t IrqStat_Prio(irqstat_id_t id)
+{
+    return (id < IRQSTAT_COUNT) ? is_info[id].prio : 0u;
+}
+
+#if IRQSTAT_ENABLE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cpufreq.h"
+#include <string.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    uint8_t  id;
+    uint32_t start;             /* ENTER stamp */
+    uint32_t nested;            /* cycles of the ISRs that preempted this one */
+} is_frame_t;
+
+/* Only touched with interrupts masked up to the ceiling: every entry is below it */
+static is_frame_t is_stack[IRQSTAT_NEST_MAX];
+static uint32_t   is_depth;
+static irqstat_t  is_st[IRQSTAT_COUNT];
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void IrqStat_Enter(irqstat_id_t id)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    if (is_depth < IRQSTAT_NEST_MAX)
+    {
+        is_frame_t *f = &is_stack[is_depth];
+
+        f->id     = (uint8_t)id;
+        f->start  = CpuFreq_Cycles();
+        f->nested = 0u;
+    }
+    is_depth++;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void IrqStat_Exit(irqstat_id_t id)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    uint32_t    now  = CpuFreq_Cycles();
+
+    (void)id;                   /* the stack knows; ENTER and EXIT pair by nesting */
+    if (is_depth != 0u && --is_depth < IRQSTAT_NEST_MAX)
+    {
+        const is_frame_t *f   = &is_stack[is_depth];
+        irqstat_t        *s   = &is_st[f->id];
+        uint32_t          all = now - f->start;
+        uint32_t          own = all - f->nested;
+
+        s->n++;
+        s->busy_cycles += own;
+        if (own > s->max_cycles) s->max_cycles = own;
+        if (is_depth != 0u) is_stack[is_depth - 1u].nested += all;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void IrqStat_Due(irqstat_id_t id, uint32_t due)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    /* Whatever preempted the caller has exited again: its frame is on top */
+    if (is_depth != 0u && is_depth <= IRQSTAT_NEST_MAX && is_stack[is_depth - 1u].id == (uint8_t)id)
+    {
+        int32_t    late = (int32_t)(is_stack[is_depth - 1u].start - due);
+        irqstat_t *s    = &is_st[id];
+
+        if (late < 0) late = 0;
+        s->late_n++;
+        s->late_cycles += (uint32_t)late;
+        if ((uint32_t)late > s->late_max_cycles) s->late_max_cycles = (uint32_t)late;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void IrqStat_Get(irqstat_id_t id, irqstat_t *out)
+{
+    if (id >= IRQSTAT_COUNT)
+    {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    taskENTER_CRITICAL();
+    *out = is_st[id];
+    taskEXIT_CRITICAL();
+}
+
+uint32_t IrqStat_NeoBlockCycles(void)
+{
+    uint32_t same = 0u, above = 0u;
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < IRQSTAT_COUNT; i++)
+    {
+        if (i == (uint32_t)IRQSTAT_NEO) continue;
+        if (is_info[i].prio < IRQ_PRIO_NEO)
+            above += is_st[i].max_cycles;       /* preempts, once each */
+        else if (is_info[i].prio == IRQ_PRIO_NEO && is_st[i].max_cycles > same)
+            same = is_st[i].max_cycles;         /* may be running, does not nest */
+    }
+    taskEXIT_CRITICAL();
+    return same + above;
+}
+
+void IrqStat_Reset(void)
+{
+    taskENTER_CRITICAL();
+    memset(is_st, 0, sizeof(is_st));
+    taskEXIT_CRITICAL();
+}
+
+#endif /* IRQSTAT_ENABLE */
@@ -0,0 +1,124 @@
+/* =============================================================================
+ * irqstat.h  -  Per-ISR count, duration and entry latency
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Every handler of the irqprio.h table brackets its body with
+ * IRQSTAT_ENTER(id) / IRQSTAT_EXIT(id). Per ISR this keeps:
+ *
+ *   n        entries since the last reset
+ *   busy     the cycles spent in it, without the ISRs that preempted it
+ *            (a nesting stack charges those to themselves), and the max
+ *            of one entry: what it costs everything at or below it
+ *   late     entry latency, for ISRs that know when they were due: the
+ *            cycles from the due time (IrqStat_Due()) to the ENTER stamp.
+ *            The NEO_STREAMING refill sets it from the chunk wire time,
+ *            the presence edge from its TC0 stamp.
+ *
+ * From the max durations, "irq" on the console also prints the worst a
+ * NeoPixel refill can be held off by others: the longest entry of an ISR
+ * at its priority plus one entry of each above it. If that stays under
+ * the refill's slack, no interrupt in the table can make the strip
+ * stutter; the measured refill lateness shows how close it came.
+ *
+ * Stamps are CpuFreq_Cycles(); each ENTER / EXIT masks interrupts for a
+ * dozen cycles. SysTick / PendSV (port.c) and the WDT warning, which never
+ * returns, are not instrumented. With IRQSTAT_ENABLE = 0 the hooks expand
+ * to nothing; "irq" still prints the priority table.
+ * ============================================================================= */
+
+#ifndef IRQSTAT_H
+#define IRQSTAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef IRQSTAT_ENABLE
+#define IRQSTAT_ENABLE          0       /* 1 = count every ISR entry            */
+#endif
+#define IRQSTAT_NEST_MAX        8u      /* one level per NVIC priority          */
+
+typedef enum
+{
+    IRQSTAT_DMAC_0 = 0,         /* DMAC_0_Handler() to DMAC_3_Handler() (dma_qos.c) */
+    IRQSTAT_DMAC_1,
+    IRQSTAT_DMAC_2,
+    IRQSTAT_DMAC_3,
+    IRQSTAT_BROWNOUT,
+    IRQSTAT_ESTOP,
+    IRQSTAT_DSUN_EDGE,
+    IRQSTAT_DSUN_RANGE,
+    IRQSTAT_ACTUATOR,
+    IRQSTAT_MSENSE,
+    IRQSTAT_DMA_OTHER,
+    IRQSTAT_I2C,
+    IRQSTAT_STDIO_RX,
+    IRQSTAT_STDIO_IDLE,
+    IRQSTAT_DMX,
+    IRQSTAT_PIXDIST,
+    IRQSTAT_SHOWSYNC,
+    IRQSTAT_USB,
+    IRQSTAT_SDCARD,
+    IRQSTAT_TICKLESS,
+    IRQSTAT_SHOWCLOCK,
+    IRQSTAT_TRNG,
+    IRQSTAT_KNOB,
+    IRQSTAT_IMGCHECK,
+    IRQSTAT_NETBRIDGE,
+    IRQSTAT_SERVO,
+    IRQSTAT_TOF,
+    IRQSTAT_COUNT
+} irqstat_id_t;
+
+#define IRQSTAT_NEO             IRQSTAT_DMAC_0      /* DMAC_CHANNEL_NEO */
+
+typedef struct
+{
+    uint32_t n;                 /* entries */
+    uint32_t max_cycles;        /* longest entry, own cycles */
+    uint64_t busy_cycles;       /* all entries, own cycles */
+    uint32_t late_n;            /* entries with a due time */
+    uint32_t late_max_cycles;
+    uint64_t late_cycles;       /* sum, for the mean */
+} irqstat_t;
+
+/** Name and NVIC priority of an id (irqprio.h), with the stats or not. */
+const char *IrqStat_Name(irqstat_id_t id);
+uint32_t    IrqStat_Prio(irqstat_id_t id);
+
+#if IRQSTAT_ENABLE
+
+#define IRQSTAT_ENTER(id)       IrqStat_Enter(id)
+#define IRQSTAT_EXIT(id)        IrqStat_Exit(id)
+#define IRQSTAT_DUE(id, due)    IrqStat_Due(id, due)
+
+/** First thing in the handler. */
+void IrqStat_Enter(irqstat_id_t id);
+
+/** Last thing in the handler, on every return path. */
+void IrqStat_Exit(irqstat_id_t id);
+
+/** Between Enter and Exit: the interrupt was due at CpuFreq_Cycles() `due`. */
+void IrqStat_Due(irqstat_id_t id, uint32_t due);
+
+/** A consistent copy of one ISR's counters. Any task. */
+void IrqStat_Get(irqstat_id_t id, irqstat_t *out);
+
+/**
+ * Worst cycles a NeoPixel refill can wait on the other ISRs, from the
+ * max durations so far (see above). Any task.
+ */
+uint32_t IrqStat_NeoBlockCycles(void);
+
+/** Start over. Any task. */
+void IrqStat_Reset(void);
+
+#else
+
+#define IRQSTAT_ENTER(id)       ((void)0)
+#define IRQSTAT_EXIT(id)        ((void)0)
+#define IRQSTAT_DUE(id, due)    ((void)0)
+
+#endif /* IRQSTAT_ENABLE */
+
+#endif /* IRQSTAT_H */
@@ -0,0 +1,162 @@
+/* =============================================================================
+ * knob.c  -  Rotary encoder knob on the PDEC: counted and filtered in hardware
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "knob.h"
+#include "definitions.h"        /* PDEC_REGS, PORT_REGS, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "evbus.h"
+#include "coop.h"
+#include "usbcdc.h"
+#include "irqprio.h"
+#include "irqstat.h"
+#include "showclock.h"
+#include "replay.h"
+
+#define KN_FILTER_HZ        (120000000u / 1024u)    /* GCLK0 / PRESC DIV1024 */
+#define KN_FILTER           (KN_FILTER_HZ / 1000u * KNOB_FILTER_US / 1000u)
+#define KN_ANGULAR_BITS     9u                      /* CTRLA.ANGULAR 0 */
+#define KN_REV_MSK          0x7Fu                   /* the 7 bits above: detents */
+#define KN_PIN_A            24u
+#define KN_PIN_B            25u
+
+_Static_assert(KNOB_COUNTS_PER_DETENT >= 1u && KNOB_COUNTS_PER_DETENT <= (1u << KN_ANGULAR_BITS),
+               "KNOB_COUNTS_PER_DETENT: the angular counter is 9 bits");
+_Static_assert(KN_FILTER >= 1u && KN_FILTER <= 0xFFu, "KNOB_FILTER_US: the PDEC filter is 8 bits");
+#if KNOB_ENABLE && USBCDC_ENABLE
+#error "knob.h: KNOB_ENABLE needs PA24 / PA25, the USB pins (USBCDC_ENABLE)"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile int32_t  kn_pos;
+static volatile uint32_t kn_errors;
+static uint32_t          kn_rev;                    /* revolution field at the last read */
+static volatile int32_t  kn_inject;                 /* Knob_Inject(), for the handler    */
+
+/* Caller masks interrupts: one READSYNC at a time */
+static uint32_t kn_read(void)
+{
+    PDEC_REGS->PDEC_CTRLBSET = PDEC_CTRLBSET_CMD_READSYNC;
+    while ((PDEC_REGS->PDEC_SYNCBUSY & (PDEC_SYNCBUSY_CTRLB_Msk | PDEC_SYNCBUSY_COUNT_Msk)) != 0u) {}
+    return PDEC_REGS->PDEC_COUNT;
+}
+
+/* Detents since the last call, from the 7-bit revolution field */
+static int32_t kn_delta(void)
+{
+    uint32_t rev = (kn_read() >> KN_ANGULAR_BITS) & KN_REV_MSK;
+    int32_t  d   = (int32_t)((rev - kn_rev) & KN_REV_MSK);
+
+    kn_rev = rev;
+    return (d > (int32_t)(KN_REV_MSK / 2u)) ? d - (int32_t)(KN_REV_MSK + 1u) : d;
+}
+
+/* Angular wrap (a detent) or a quadrature error */
+void PDEC_OTHER_Handler(void)
+{
+    BaseType_t  woken = pdFALSE;
+    UBaseType_t mask;
+    uint8_t     flags;
+    int32_t     d;
+
+    IRQSTAT_ENTER(IRQSTAT_KNOB);
+    flags = PDEC_REGS->PDEC_INTFLAG;
+    PDEC_REGS->PDEC_INTFLAG = flags;
+    if ((flags & PDEC_INTFLAG_ERR_Msk) != 0u)
+    {
+        PDEC_REGS->PDEC_STATUS = PDEC_STATUS_QERR_Msk;
+        kn_errors++;
+    }
+    d = kn_delta();
+    if (REPLAY_PLAYING()) d = 0;        /* a playback (replay.h) turns it instead */
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    d += kn_inject;
+    kn_inject = 0;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    if (d != 0)
+    {
+        REPLAY_INPUT(REPLAY_KNOB, 0u, ShowClock_Now(), (uint32_t)d);
+        kn_pos += d;
+        EventBus_PublishFromISR(EVBUS_KNOB, 0u, (uint32_t)d, &woken);
+        Coop_WakeFromISR(&woken);       /* the main.c thread applies it now */
+    }
+    IRQSTAT_EXIT(IRQSTAT_KNOB);
+    portYIELD_FROM_ISR(woken);
+}
+
+#if KNOB_ENABLE
+static void kn_pin(uint32_t pin)
+{
+    port_group_registers_t *g = &PORT_REGS->GROUP[0];
+    uint8_t pmux = g->PORT_PMUX[pin >> 1];
+
+    pmux = ((pin & 1u) != 0u) ? (uint8_t)((pmux & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(6u))     /* G */
+                              : (uint8_t)((pmux & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(6u));
+    g->PORT_PMUX[pin >> 1] = pmux;
+    g->PORT_OUTSET         = 1u << pin;                                  /* pull-up */
+    g->PORT_PINCFG[pin]    = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_INEN_Msk | PORT_PINCFG_PULLEN_Msk;
+}
+#endif
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Knob_Init(void)
+{
+#if KNOB_ENABLE
+    kn_pin(KN_PIN_A);
+    kn_pin(KN_PIN_B);
+
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_PDEC_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[PDEC_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK0 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[PDEC_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    PDEC_REGS->PDEC_CTRLA = PDEC_CTRLA_SWRST_Msk;
+    while ((PDEC_REGS->PDEC_SYNCBUSY & PDEC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    PDEC_REGS->PDEC_CTRLA = PDEC_CTRLA_MODE_QDEC | PDEC_CTRLA_CONF_X4 | PDEC_CTRLA_ANGULAR(0u)
+                          | PDEC_CTRLA_PEREN_Msk | PDEC_CTRLA_PINEN0_Msk | PDEC_CTRLA_PINEN1_Msk
+                          | PDEC_CTRLA_SWAP(KNOB_REVERSE);
+    PDEC_REGS->PDEC_PRESC  = PDEC_PRESC_PRESC_DIV1024;
+    PDEC_REGS->PDEC_FILTER = PDEC_FILTER_FILTER(KN_FILTER);
+    /* Period: the angular part wraps per detent, the revolution part at its top */
+    PDEC_REGS->PDEC_CC[0]  = (KN_REV_MSK << KN_ANGULAR_BITS) | (KNOB_COUNTS_PER_DETENT - 1u);
+    while (PDEC_REGS->PDEC_SYNCBUSY != 0u) {}
+
+    PDEC_REGS->PDEC_INTFLAG  = PDEC_INTFLAG_OVF_Msk | PDEC_INTFLAG_ERR_Msk;
+    PDEC_REGS->PDEC_INTENSET = PDEC_INTENSET_OVF_Msk | PDEC_INTENSET_ERR_Msk;
+    PDEC_REGS->PDEC_CTRLA   |= PDEC_CTRLA_ENABLE_Msk;
+    while ((PDEC_REGS->PDEC_SYNCBUSY & PDEC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    PDEC_REGS->PDEC_CTRLBSET = PDEC_CTRLBSET_CMD_START;
+    while ((PDEC_REGS->PDEC_SYNCBUSY & PDEC_SYNCBUSY_CTRLB_Msk) != 0u) {}
+    kn_rev = (kn_read() >> KN_ANGULAR_BITS) & KN_REV_MSK;
+
+    NVIC_SetPriority(PDEC_OTHER_IRQn, IRQ_PRIO_KNOB);
+    NVIC_ClearPendingIRQ(PDEC_OTHER_IRQn);
+    NVIC_EnableIRQ(PDEC_OTHER_IRQn);
+#endif
+}
+
+int32_t Knob_Position(void)
+{
+    return kn_pos;
+}
+
+uint32_t Knob_Errors(void)
+{
+    return kn_errors;
+}
+
+void Knob_Inject(int32_t detents)
+{
+#if KNOB_ENABLE
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    kn_inject += detents;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    NVIC_SetPendingIRQ(PDEC_OTHER_IRQn);
+#else
+    (void)detents;
+#endif
+}
@@ -0,0 +1,67 @@
+/* =============================================================================
+ * knob.h  -  Rotary encoder knob on the PDEC: counted and filtered in hardware
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A mechanical quadrature encoder (24 detents a turn, A/B to ground,
+ * internal pull-ups) for the operator: turning it nudges the brightness
+ * or steps through the effects during a show, no laptop needed.
+ *
+ *   KNOB_A  PA24  PDEC QDI0 (peripheral G)
+ *   KNOB_B  PA25  PDEC QDI1
+ *
+ * The position decoder does the work: the inputs are filtered for
+ * KNOB_FILTER_US (contact bounce), decoded X4 and counted. The angular
+ * counter wraps every KNOB_COUNTS_PER_DETENT counts, so the revolution
+ * counter above it counts detents, and every wrap raises the one
+ * interrupt. Its handler reads the detent count and publishes the
+ * difference since the last read as EVBUS_KNOB (evbus.h): a knob at rest
+ * costs nothing, and a fast spin that coalesces interrupts still arrives
+ * whole, as one larger delta. The hardware never drops a count; the
+ * handler must only run once per 64 detents.
+ *
+ * main.c applies the deltas (KNOB_ACTION). Quadrature errors, both phases
+ * changing at once, are counted ("knob"): many of them mean
+ * KNOB_FILTER_US is too long for the spin, or a loose wire.
+ *
+ * PA24 / PA25 are also the USB pins (usbcdc.h): the knob and the USB
+ * console do not build together. The PDEC runs on GCLK0 and stops in
+ * STANDBY, which only the closed show (showcal.h) enters.
+ * ============================================================================= */
+
+#ifndef KNOB_H
+#define KNOB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef KNOB_ENABLE
+#define KNOB_ENABLE             0       /* 1 = the encoder is fitted            */
+#endif
+#define KNOB_COUNTS_PER_DETENT  4u      /* X4 counts from one detent to the next */
+#define KNOB_FILTER_US          500u    /* input stable this long, <= 2170 us   */
+#define KNOB_REVERSE            0       /* 1 = clockwise counts down            */
+
+#define KNOB_ACTION_BRIGHTNESS  0
+#define KNOB_ACTION_EFFECT      1
+#define KNOB_ACTION             KNOB_ACTION_BRIGHTNESS
+#define KNOB_BRIGHT_STEP        8u      /* brightness per detent, of 255        */
+#define KNOB_FADE_FRAMES        30u     /* crossfade to the next effect         */
+
+/** Set up the pins and the PDEC and start counting. Before the scheduler. */
+void Knob_Init(void);
+
+/** Detents turned since boot, clockwise positive. Any task. */
+int32_t Knob_Position(void);
+
+/** Quadrature errors since boot. Any task. */
+uint32_t Knob_Errors(void);
+
+/**
+ * Feed `detents` through the PDEC handler as if turned (replay.h): the
+ * event bus and main.c take it as any turn. Any task or ISR at or below
+ * the syscall ceiling.
+ */
+void Knob_Inject(int32_t detents);
+
+#endif /* KNOB_H */
@@ -0,0 +1,151 @@
+/* =============================================================================
+ * latbench.c  -  Sensor edge to relay and LED latency, as histograms
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "latbench.h"
+
+#if LATBENCH_ENABLE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cpufreq.h"
+#include <string.h>
+
+#define LB_CYCLES_US        (configCPU_CLOCK_HZ / 1000000u)
+#define LB_TIMEOUT_CYCLES   (LATBENCH_TIMEOUT_MS * (configCPU_CLOCK_HZ / 1000u))
+#define LB_ALL              ((1u << LATBENCH_STAGES) - 1u)
+
+#if LB_TIMEOUT_CYCLES >= 0x80000000u
+#error "LATBENCH_TIMEOUT_MS must stay under half a CYCCNT wrap"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t lb_edge;           /* wall cycles of the edge being measured */
+static volatile uint8_t  lb_want;           /* stages still due, one bit each */
+static volatile bool     lb_react;          /* a command applied since the edge */
+static uint32_t          lb_edges;
+static uint32_t          lb_overlap;
+
+typedef struct
+{
+    uint32_t hist[LATBENCH_BUCKETS];
+    uint32_t n;
+    uint32_t lost;
+    uint32_t max_us;
+} lb_stage_t;
+
+static lb_stage_t lb_st[LATBENCH_STAGES];
+
+static void lb_lose_pending(void)
+{
+    for (uint32_t s = 0; s < LATBENCH_STAGES; s++)
+        if ((lb_want & (1u << s)) != 0u) lb_st[s].lost++;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void LatBench_Edge(uint32_t age_us)
+{
+    uint32_t    now = CpuFreq_Cycles();
+    UBaseType_t mask;
+
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    lb_edges++;
+    if (lb_want != 0u && (now - lb_edge) < LB_TIMEOUT_CYCLES)
+    {
+        lb_overlap++;           /* the visitor before is still being answered */
+    }
+    else
+    {
+        lb_lose_pending();
+        lb_edge  = now - age_us * LB_CYCLES_US;
+        lb_want  = (uint8_t)LB_ALL;
+        lb_react = false;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void LatBench_Stamp(latbench_stage_t st)
+{
+    uint32_t now = CpuFreq_Cycles();
+    uint32_t bit = 1u << st;
+
+    if ((lb_want & bit) == 0u) return;
+
+    taskENTER_CRITICAL();
+    if ((lb_want & bit) != 0u)
+    {
+        uint32_t    us = (now - lb_edge) / LB_CYCLES_US;
+        lb_stage_t *s  = &lb_st[st];
+
+        lb_want &= (uint8_t)~bit;
+        if (us >= LATBENCH_TIMEOUT_MS * 1000u)
+        {
+            s->lost++;
+        }
+        else
+        {
+            Hist_Add(s->hist, LATBENCH_BUCKETS, us);
+            s->n++;
+            if (us > s->max_us) s->max_us = us;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+void LatBench_React(void)
+{
+    if ((lb_want & (1u << LATBENCH_LED)) != 0u) lb_react = true;
+}
+
+void LatBench_Frame(void)
+{
+    if (!lb_react) return;
+    lb_react = false;
+    LatBench_Stamp(LATBENCH_LED);
+}
+
+void LatBench_Reset(void)
+{
+    taskENTER_CRITICAL();
+    memset(lb_st, 0, sizeof(lb_st));
+    lb_want    = 0u;
+    lb_react   = false;
+    lb_edges   = 0u;
+    lb_overlap = 0u;
+    taskEXIT_CRITICAL();
+}
+
+bool LatBench_Get(latbench_stage_t st, latbench_result_t *out)
+{
+    static uint32_t hist[LATBENCH_BUCKETS];     /* one caller at a time: the console */
+
+    if (st >= LATBENCH_STAGES) return false;
+
+    taskENTER_CRITICAL();
+    memcpy(hist, lb_st[st].hist, sizeof(hist));
+    out->n      = lb_st[st].n;
+    out->lost   = lb_st[st].lost;
+    out->max_us = lb_st[st].max_us;
+    taskEXIT_CRITICAL();
+
+    out->p50_us = Hist_Percentile(hist, LATBENCH_BUCKETS, out->n, 500u);
+    out->p99_us = Hist_Percentile(hist, LATBENCH_BUCKETS, out->n, 990u);
+    if (out->p50_us > out->max_us) out->p50_us = out->max_us;
+    if (out->p99_us > out->max_us) out->p99_us = out->max_us;
+    return true;
+}
+
+uint32_t LatBench_Edges(void)
+{
+    return lb_edges;
+}
+
+uint32_t LatBench_Overlapped(void)
+{
+    return lb_overlap;
+}
+
+#endif /* LATBENCH_ENABLE */
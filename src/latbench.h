@@ -0,0 +1,100 @@
+/* =============================================================================
+ * latbench.h  -  Sensor edge to relay and LED latency, as histograms
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * How long a visitor waits for the prop, measured on every presence edge:
+ *
+ *   edge     EIC_EXTINT_3_Handler() (dsun_sensor.c), back-dated by the
+ *            TC0 debounce with DSUN_HW_DEBOUNCE: the level change itself
+ *   relay    the first lid relay PORT write after it (actuator.c act_up /
+ *            act_down, or the TCC1 pattern start with ACT_HW_TIMING)
+ *   led      the first frame handed to the strip (NeoPixel_Show()) after
+ *            the renderer applied a command posted since the edge: the
+ *            scare's brightness step (mode.h), a show-sync cue. Frames
+ *            that only animate on do not count, they would come anyway.
+ *
+ * Stamps are CpuFreq_Cycles() (DWT, wall time at 120 MHz). One edge is
+ * measured at a time: edges while both stamps are still due are counted
+ * as overlapped, and a stamp that does not come within LATBENCH_TIMEOUT_MS
+ * (a presence in the cooldown, a throttled scare) as lost.
+ *
+ * Each stage keeps a histogram of microseconds (hist.h): percentiles come
+ * out as bucket upper bounds, within 12.5 % of the true value, max
+ * exactly. "lat" on the console
+ * prints n / p50 / p99 / max per stage, "lat reset" starts a new run: run
+ * a few thousand triggers (a pulse generator on the sensor line with the
+ * actuator "cooldown" at 0), change a priority, run again.
+ *
+ * With LATBENCH_ENABLE = 0 the hooks expand to nothing and the module is
+ * not built.
+ * ============================================================================= */
+
+#ifndef LATBENCH_H
+#define LATBENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hist.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef LATBENCH_ENABLE
+#define LATBENCH_ENABLE         0       /* 1 = build the benchmark in         */
+#endif
+#define LATBENCH_TIMEOUT_MS     2000u   /* a stamp later than this is lost    */
+#define LATBENCH_OCTAVES        18u     /* up to 2^21 us, past the timeout    */
+
+#define LATBENCH_BUCKETS        HIST_BUCKETS(LATBENCH_OCTAVES)
+
+typedef enum
+{
+    LATBENCH_RELAY = 0,         /* edge -> relay PORT write */
+    LATBENCH_LED,               /* edge -> first changed frame out */
+    LATBENCH_STAGES
+} latbench_stage_t;
+
+typedef struct
+{
+    uint32_t n;                 /* samples */
+    uint32_t lost;              /* edges the stamp never came for */
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} latbench_result_t;
+
+#if LATBENCH_ENABLE
+
+#define LATBENCH_EDGE(age_us)   LatBench_Edge(age_us)
+#define LATBENCH_RELAY_ON()     LatBench_Stamp(LATBENCH_RELAY)
+#define LATBENCH_REACT()        LatBench_React()
+#define LATBENCH_FRAME()        LatBench_Frame()
+
+/** A presence edge `age_us` ago. EIC ISR. */
+void LatBench_Edge(uint32_t age_us);
+
+/** Stage `st` reached now, if it is still due for the last edge. Tasks. */
+void LatBench_Stamp(latbench_stage_t st);
+
+/** The renderer applied a command; the next LatBench_Frame() is the LED stamp. */
+void LatBench_React(void);
+void LatBench_Frame(void);
+
+/** Start a new run. Any task. */
+void LatBench_Reset(void);
+
+/** Percentiles of stage `st` so far; false for no such stage. */
+bool LatBench_Get(latbench_stage_t st, latbench_result_t *out);
+
+/** Presence edges seen, and those while one was still measured. */
+uint32_t LatBench_Edges(void);
+uint32_t LatBench_Overlapped(void);
+
+#else
+
+#define LATBENCH_EDGE(age_us)   ((void)0)
+#define LATBENCH_RELAY_ON()     ((void)0)
+#define LATBENCH_REACT()        ((void)0)
+#define LATBENCH_FRAME()        ((void)0)
+
+#endif /* LATBENCH_ENABLE */
+
+#endif /* LATBENCH_H */
@@ -1,85 +1,438 @@
-//#include "lcd_i2c.h"
-//#include "definitions.h" // Harmony PLIB headers for I2C functions
-//
-//static uint8_t _addr;
-//static uint8_t _backlight = LCD_BACKLIGHT;
-//
-//static void LCD_I2C_Write4Bits(uint8_t data)
-//{
-//    SERCOM2_I2C_Write(_addr, &data, 1); // Change SERCOM2_I2C_ to your instance
-//}
-//
-//static void LCD_I2C_PulseEnable(uint8_t data)
-//{
-//    LCD_I2C_Write4Bits(data | LCD_ENABLE_BIT);
-//    SYSTICK_DelayMs(1);
-//    LCD_I2C_Write4Bits(data & ~LCD_ENABLE_BIT);
-//    SYSTICK_DelayMs(1);
-//}
-//
-//static void LCD_I2C_Send(uint8_t value, uint8_t mode)
-//{
-//    uint8_t high = value & 0xF0;
-//    uint8_t low  = (value << 4) & 0xF0;
-//
-//    uint8_t data = high | mode | _backlight;
-//    LCD_I2C_Write4Bits(data);
-//    LCD_I2C_PulseEnable(data);
-//
-//    data = low | mode | _backlight;
-//    LCD_I2C_Write4Bits(data);
-//    LCD_I2C_PulseEnable(data);
-//}
-//
-//void LCD_I2C_Command(uint8_t cmd)
-//{
-//    LCD_I2C_Send(cmd, 0x00);
-//}
-//
-//void LCD_I2C_WriteChar(char c)
-//{
-//    LCD_I2C_Send(c, 0x01);
-//}
-//
-//void LCD_I2C_Clear(void)
-//{
-//    LCD_I2C_Command(LCD_CMD_CLEAR);
-//    SYSTICK_DelayMs(2);
-//}
-//
-//void LCD_I2C_Home(void)
-//{
-//    LCD_I2C_Command(LCD_CMD_HOME);
-//    SYSTICK_DelayMs(2);
-//}
-//
-//void LCD_I2C_SetCursor(uint8_t col, uint8_t row)
-//{
-//    static const uint8_t offsets[] = {0x00, 0x40, 0x14, 0x54};
-//    if (row > 1) row = 1;
-//    LCD_I2C_Command(LCD_CMD_SETDDRAMADDR | (col + offsets[row]));
-//}
-//
-//void LCD_I2C_Print(const char *str)
-//{
-//    while (*str)
-//        LCD_I2C_WriteChar(*str++);
-//}
-//
-//void LCD_I2C_Initialize(uint8_t i2cAddress)
-//{
-//    _addr = i2cAddress;
-//
-//    SYSTICK_DelayMs(50); // wait for LCD to power up
-//
-//    LCD_I2C_Send(0x30, 0x00);
-//    SYSTICK_DelayMs(5);
-//    LCD_I2C_Send(0x30, 0x00);
-//    SYSTICK_DelayMs(5);
-//    LCD_I2C_Send(0x20, 0x00); // 4-bit mode
-//
-//    LCD_I2C_Command(LCD_CMD_FUNCTIONSET | LCD_2LINE | LCD_5x8DOTS | LCD_4BITMODE);
-//    LCD_I2C_Command(LCD_CMD_DISPLAYCONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
-//    LCD_I2C_Command(LCD_CMD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
-//    LCD_I2C_Clear();
-//}
+#include "lcd_i2c.h"
+#include "i2c_bus.h"            // queued SERCOM2 I2C master
+#include "FreeRTOS.h"
+#include "task.h"
+#include "coop.h"              // the flush runs as a thread of the Coop task
+#include <string.h>
+
+// The PCF8574 is a 100 kHz part. At that rate one expander byte holds the
+// outputs ~90 us, far above the HD44780's E pulse (230 ns), set-up (80 ns)
+// and per-byte execution (37 us) times, so whole strings stream as one write
+#if I2C_SCL_HZ > 100000u
+#error "lcd_i2c: PCF8574 backpacks need I2C_SCL_HZ <= 100 kHz"
+#endif
+
+// Per HD44780 byte: hi|E, hi, lo|E, lo. E falls with the data already on the
+// pins since the byte before; RS only changes in a byte of its own (E low)
+#define LCD_BYTES_PER_SEND  4u
+#define LCD_BATCH_SENDS     (LCD_COLS * LCD_ROWS + LCD_ROWS)    // a screen + cursor moves
+#define LCD_TIMEOUT_MS      100u
+
+static uint8_t _addr;
+static uint8_t _backlight = LCD_BACKLIGHT;
+static i2c_status_t _status = I2C_OK;
+static uint8_t _buf[LCD_BATCH_SENDS * LCD_BYTES_PER_SEND + LCD_BATCH_SENDS];
+static uint16_t _pos;
+static uint8_t _mode;                  // RS of the batch so far, 0xFF = none
+
+static void LCD_I2C_Begin(void)
+{
+    _pos  = 0u;
+    _mode = 0xFF;
+}
+
+static void LCD_I2C_Flush(void)
+{
+    if (_pos != 0u)
+    {
+        // One transaction per batch; the task sleeps while the bus runs it
+        _status = I2c_Transfer(_addr, _buf, _pos, NULL, 0u, LCD_TIMEOUT_MS);
+    }
+    LCD_I2C_Begin();
+}
+
+// Append one nibble (high four bits of data); RS must already be set
+static void LCD_I2C_PutNibble(uint8_t nibble)
+{
+    uint8_t data = (nibble & 0xF0) | _mode | _backlight;
+
+    _buf[_pos++] = data | LCD_ENABLE_BIT;
+    _buf[_pos++] = data;
+}
+
+static void LCD_I2C_SetMode(uint8_t mode)
+{
+    if (_mode != mode)
+    {
+        _mode = mode;
+        _buf[_pos++] = mode | _backlight;
+    }
+}
+
+static void LCD_I2C_Put(uint8_t value, uint8_t mode)
+{
+    if (_pos + LCD_BYTES_PER_SEND + 1u > sizeof(_buf))
+        LCD_I2C_Flush();
+    LCD_I2C_SetMode(mode);
+    LCD_I2C_PutNibble(value);
+    LCD_I2C_PutNibble((uint8_t)(value << 4));
+}
+
+static void LCD_I2C_Send(uint8_t value, uint8_t mode)
+{
+    LCD_I2C_Begin();
+    LCD_I2C_Put(value, mode);
+    LCD_I2C_Flush();
+}
+
+static void LCD_I2C_PutCursor(uint8_t col, uint8_t row)
+{
+    static const uint8_t offsets[] = {0x00, 0x40, 0x14, 0x54};
+    if (row >= LCD_ROWS) row = LCD_ROWS - 1u;
+    LCD_I2C_Put(LCD_CMD_SETDDRAMADDR | (col + offsets[row]), 0x00);
+}
+
+static void LCD_I2C_PutString(const char *str)
+{
+    while (*str)
+        LCD_I2C_Put((uint8_t)*str++, 0x01);
+}
+
+void LCD_I2C_Command(uint8_t cmd)
+{
+    LCD_I2C_Send(cmd, 0x00);
+}
+
+void LCD_I2C_WriteChar(char c)
+{
+    LCD_I2C_Send((uint8_t)c, 0x01);
+}
+
+void LCD_I2C_Clear(void)
+{
+    LCD_I2C_Command(LCD_CMD_CLEAR);
+    vTaskDelay(pdMS_TO_TICKS(2));       // 1.52 ms execution time
+}
+
+void LCD_I2C_Home(void)
+{
+    LCD_I2C_Command(LCD_CMD_HOME);
+    vTaskDelay(pdMS_TO_TICKS(2));
+}
+
+void LCD_I2C_SetCursor(uint8_t col, uint8_t row)
+{
+    LCD_I2C_Begin();
+    LCD_I2C_PutCursor(col, row);
+    LCD_I2C_Flush();
+}
+
+void LCD_I2C_Print(const char *str)
+{
+    LCD_I2C_Begin();
+    LCD_I2C_PutString(str);
+    LCD_I2C_Flush();
+}
+
+void LCD_I2C_PrintAt(uint8_t col, uint8_t row, const char *str)
+{
+    LCD_I2C_Begin();
+    LCD_I2C_PutCursor(col, row);
+    LCD_I2C_PutString(str);
+    LCD_I2C_Flush();
+}
+
+void LCD_I2C_PrintScreen(const char *const lines[LCD_ROWS])
+{
+    LCD_I2C_Begin();
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+    {
+        LCD_I2C_PutCursor(0u, row);
+        LCD_I2C_PutString(lines[row]);
+    }
+    LCD_I2C_Flush();
+}
+
+void LCD_I2C_SetBacklight(bool on)
+{
+    _backlight = on ? LCD_BACKLIGHT : 0x00;
+    LCD_I2C_Begin();
+    _buf[_pos++] = _backlight;
+    LCD_I2C_Flush();
+}
+
+// Init nibble in 8-bit mode: instructions take up to 4.1 ms, each on its own
+static void LCD_I2C_InitNibble(uint8_t nibble, uint32_t wait_ms)
+{
+    LCD_I2C_Begin();
+    LCD_I2C_SetMode(0x00);
+    LCD_I2C_PutNibble(nibble);
+    LCD_I2C_Flush();
+    if (wait_ms != 0u)
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+}
+
+bool LCD_I2C_Initialize(uint8_t i2cAddress)
+{
+    _addr = i2cAddress;
+
+    vTaskDelay(pdMS_TO_TICKS(50));      // wait for LCD to power up
+
+    // Back to 8-bit mode from any state, then into 4-bit mode
+    LCD_I2C_InitNibble(0x30, 5u);
+    if (_status != I2C_OK) return false;
+    LCD_I2C_InitNibble(0x30, 1u);
+    LCD_I2C_InitNibble(0x30, 1u);
+    LCD_I2C_InitNibble(0x20, 1u);
+
+    LCD_I2C_Begin();
+    LCD_I2C_Put(LCD_CMD_FUNCTIONSET | LCD_2LINE | LCD_5x8DOTS | LCD_4BITMODE, 0x00);
+    LCD_I2C_Put(LCD_CMD_DISPLAYCONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF, 0x00);
+    LCD_I2C_Put(LCD_CMD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT, 0x00);
+    LCD_I2C_Flush();
+    LCD_I2C_Clear();
+    return _status == I2C_OK;
+}
+
+bool LCD_I2C_Ok(void)
+{
+    return _status == I2C_OK;
+}
+
+// ---------------------------------------------------------
+// Shadow framebuffer
+// ---------------------------------------------------------
+#if LCD_COLS > 32u
+#error "lcd_i2c: the dirty bitmap holds 32 columns per row"
+#endif
+
+// Rewriting a clean gap this short is cheaper than a cursor move
+#define LCD_FRAME_GAP       2u
+
+static char     _frame[LCD_ROWS][LCD_COLS];     // what the screen should show
+static char     _shown[LCD_ROWS][LCD_COLS];     // what it shows
+static uint32_t _dirty[LCD_ROWS];               // bit c: column c differs
+static uint8_t  _frame_addr;
+
+// ---------------------------------------------------------
+// CGRAM glyph cache
+// ---------------------------------------------------------
+// LCD_GLYPHS patterns are defined, at most 8 are in CGRAM. Cells hold
+// LCD_GLYPH(id); the flush maps each id to its slot (char 8 + slot),
+// uploading it first if it is not resident. Glyphs still in the frame are
+// never evicted; among the rest the least recently shown goes.
+#define LCD_CGRAM_SLOTS     8u
+#define LCD_NO_SLOT         0xFF
+#define LCD_CMD_SETCGRAMADDR 0x40
+
+static uint8_t  _glyph[LCD_GLYPHS][8] =
+{
+    // LCD_GLYPH_BAR1 .. LCD_GLYPH_BAR4: 1..4 columns lit from the left
+    [LCD_GLYPH_BAR1]     = { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 },
+    [LCD_GLYPH_BAR1 + 1] = { 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18 },
+    [LCD_GLYPH_BAR1 + 2] = { 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C },
+    [LCD_GLYPH_BAR1 + 3] = { 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E },
+};
+static uint16_t _glyph_stale;                   // bit id: pattern changed since upload
+static uint8_t  _glyph_slot[LCD_GLYPHS];        // CGRAM slot, LCD_NO_SLOT = not loaded
+static uint8_t  _slot_glyph[LCD_CGRAM_SLOTS];   // glyph id, LCD_NO_SLOT = free
+static uint32_t _slot_used[LCD_CGRAM_SLOTS];    // flush count when last shown
+static uint32_t _flushes;
+
+static inline bool LCD_I2C_IsGlyph(char c)
+{
+    return (uint8_t)c >= LCD_GLYPH(0) && (uint8_t)c < LCD_GLYPH(LCD_GLYPHS);
+}
+
+void LCD_I2C_GlyphDefine(uint8_t id, const uint8_t rows[8])
+{
+    if (id >= LCD_GLYPHS) return;
+
+    taskENTER_CRITICAL();
+    memcpy(_glyph[id], rows, 8u);
+    _glyph_stale |= (uint16_t)(1u << id);       // CGRAM rewrite redraws it in place
+    taskEXIT_CRITICAL();
+}
+
+// Pick a slot for glyph id, sparing glyphs in `keep`; LCD_NO_SLOT if all are
+static uint8_t LCD_I2C_GlyphSlot(uint16_t keep)
+{
+    uint8_t best = LCD_NO_SLOT;
+
+    for (uint8_t s = 0; s < LCD_CGRAM_SLOTS; s++)
+    {
+        if (_slot_glyph[s] == LCD_NO_SLOT) return s;
+        if ((keep & (1u << _slot_glyph[s])) != 0u) continue;
+        if (best == LCD_NO_SLOT || (int32_t)(_slot_used[s] - _slot_used[best]) < 0) best = s;
+    }
+    return best;
+}
+
+// Make every glyph in `used` resident, uploading only what is missing or
+// stale; returns the ids that did not fit
+static uint16_t LCD_I2C_GlyphLoad(uint16_t used, uint16_t stale, const uint8_t pattern[LCD_GLYPHS][8])
+{
+    uint16_t failed = 0u;
+
+    _flushes++;
+    for (uint8_t id = 0; id < LCD_GLYPHS; id++)
+    {
+        if ((used & (1u << id)) == 0u) continue;
+
+        uint8_t s = _glyph_slot[id];
+        bool upload = (s == LCD_NO_SLOT) || ((stale & (1u << id)) != 0u);
+
+        if (s == LCD_NO_SLOT)
+        {
+            s = LCD_I2C_GlyphSlot(used);
+            if (s == LCD_NO_SLOT) { failed |= (uint16_t)(1u << id); continue; }
+            if (_slot_glyph[s] != LCD_NO_SLOT) _glyph_slot[_slot_glyph[s]] = LCD_NO_SLOT;
+            _slot_glyph[s] = id;
+            _glyph_slot[id] = s;
+        }
+        if (upload)
+        {
+            LCD_I2C_Put(LCD_CMD_SETCGRAMADDR | (uint8_t)(s << 3), 0x00);
+            for (uint8_t r = 0; r < 8u; r++)
+                LCD_I2C_Put(pattern[id][r], 0x01);
+        }
+        _slot_used[s] = _flushes;
+    }
+    return failed;
+}
+
+void LCD_I2C_FrameBar(uint8_t col, uint8_t row, uint8_t width, uint32_t value, uint32_t max)
+{
+    char     bar[LCD_COLS + 1];
+    uint32_t lit;
+
+    if (width > LCD_COLS) width = LCD_COLS;
+    if (max == 0u) max = 1u;
+    if (value > max) value = max;
+    lit = (uint32_t)(((uint64_t)value * width * 5u + max / 2u) / max);     // pixel columns
+
+    for (uint8_t i = 0; i < width; i++, lit = (lit > 5u) ? lit - 5u : 0u)
+        bar[i] = (lit >= 5u) ? (char)0xFF : (lit == 0u) ? ' ' : (char)LCD_GLYPH(LCD_GLYPH_BAR1 + lit - 1u);
+    bar[width] = '\0';
+    LCD_I2C_FrameWrite(col, row, bar);
+}
+
+void LCD_I2C_FrameWrite(uint8_t col, uint8_t row, const char *str)
+{
+    if (row >= LCD_ROWS) return;
+
+    taskENTER_CRITICAL();
+    for (; *str && col < LCD_COLS; col++, str++)
+    {
+        _frame[row][col] = *str;
+        if (*str != _shown[row][col]) _dirty[row] |= 1uL << col;
+        else                          _dirty[row] &= ~(1uL << col);
+    }
+    taskEXIT_CRITICAL();
+}
+
+void LCD_I2C_FrameClear(void)
+{
+    char blank[LCD_COLS + 1];
+
+    memset(blank, ' ', LCD_COLS);
+    blank[LCD_COLS] = '\0';
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+        LCD_I2C_FrameWrite(0u, row, blank);
+}
+
+void LCD_I2C_FrameFlush(void)
+{
+    static char    cells[LCD_ROWS][LCD_COLS];
+    static uint8_t pattern[LCD_GLYPHS][8];
+    uint32_t dirty[LCD_ROWS];
+    uint16_t used = 0u, stale, failed;
+
+    // Take the changes; writes landing after this go next flush
+    taskENTER_CRITICAL();
+    memcpy(dirty, _dirty, sizeof(dirty));
+    memset(_dirty, 0, sizeof(_dirty));
+    memcpy(cells, _frame, sizeof(cells));
+    memcpy(pattern, _glyph, sizeof(pattern));
+    stale = _glyph_stale;
+    _glyph_stale = 0u;
+    taskEXIT_CRITICAL();
+
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+        for (uint8_t col = 0; col < LCD_COLS; col++)
+            if (LCD_I2C_IsGlyph(cells[row][col]))
+                used |= (uint16_t)(1u << ((uint8_t)cells[row][col] - LCD_GLYPH(0)));
+
+    // CGRAM first: the cursor moves below put the address back into DDRAM
+    LCD_I2C_Begin();
+    failed = LCD_I2C_GlyphLoad(used, stale, pattern);
+
+    // Redefined glyphs not uploaded now stay stale until they are next used
+    taskENTER_CRITICAL();
+    _glyph_stale |= stale & (uint16_t)~(used & ~failed);
+    taskEXIT_CRITICAL();
+
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+    {
+        uint8_t at = 0xFF;               // DDRAM column the cursor is on
+        while (dirty[row] != 0u)
+        {
+            uint8_t col = (uint8_t)__builtin_ctz(dirty[row]);
+
+            if (at == 0xFF || col < at || (uint32_t)(col - at) > LCD_FRAME_GAP)
+            {
+                LCD_I2C_PutCursor(col, row);
+                at = col;
+            }
+            for (; at <= col; at++)     // the changed cell and any short gap
+            {
+                char c = cells[row][at];
+
+                if (LCD_I2C_IsGlyph(c))
+                {
+                    uint8_t id = (uint8_t)c - LCD_GLYPH(0);
+
+                    if ((failed & (1u << id)) != 0u)
+                    {
+                        // More than 8 glyphs on screen: placeholder, retried next flush
+                        LCD_I2C_Put('?', 0x01);
+                        _shown[row][at] = '?';
+                        taskENTER_CRITICAL();
+                        if (_frame[row][at] == c) _dirty[row] |= 1uL << at;
+                        taskEXIT_CRITICAL();
+                        continue;
+                    }
+                    LCD_I2C_Put((uint8_t)(LCD_CGRAM_SLOTS + _glyph_slot[id]), 0x01);
+                }
+                else
+                {
+                    LCD_I2C_Put((uint8_t)c, 0x01);
+                }
+                _shown[row][at] = c;
+            }
+            dirty[row] &= ~(1uL << col);
+        }
+    }
+    LCD_I2C_Flush();
+}
+
+// Coop thread: the power-up delays hold the Coop task once, the flushes an I2C write
+static coop_state_t LCD_I2C_FrameThread(coop_t *pt, void *arg)
+{
+    (void)arg;
+    COOP_BEGIN(pt);
+    (void)LCD_I2C_Initialize(_frame_addr);
+
+    for (;;)
+    {
+        uint32_t any = 0u;
+
+        for (uint8_t row = 0; row < LCD_ROWS; row++) any |= _dirty[row];
+        if (any != 0u) LCD_I2C_FrameFlush();
+        COOP_SLEEP(pt, LCD_FRAME_MS);
+    }
+    COOP_END(pt);
+}
+
+bool LCD_I2C_FrameStart(uint8_t i2cAddress)
+{
+    // The display is blank after LCD_I2C_Initialize(): so is the shadow
+    memset(_frame, ' ', sizeof(_frame));
+    memset(_shown, ' ', sizeof(_shown));
+    memset(_dirty, 0, sizeof(_dirty));
+    memset(_glyph_slot, LCD_NO_SLOT, sizeof(_glyph_slot));
+    memset(_slot_glyph, LCD_NO_SLOT, sizeof(_slot_glyph));
+    _glyph_stale = 0u;
+    _frame_addr = i2cAddress;
+    return Coop_Add("lcd", LCD_I2C_FrameThread, NULL);
+}
@@ -12,7 +12,12 @@
   @Description
     This file provides an interface to the HD44780-compatible 1602 LCD
     using an I2C I/O expander (PCF8574/PCF8574A). It is designed for 
-    use with Microchip SAME51J20A and MPLAB Harmony 3 I2C PLIB drivers.
+    use with Microchip SAME51J20A over the queued SERCOM2 I2C master in
+    i2c_bus.h. Every call builds its whole expander byte sequence (four
+    bytes per character, plus one per RS change) and sends it as one I2C
+    write and the calling task sleeps while the interrupt-driven bus
+    sends it, so printing a line costs microseconds of CPU, not milliseconds.
+    Call from one task only.
  */
 /* ************************************************************************** */
 
@@ -55,6 +60,16 @@
 #define LCD_5x8DOTS             0x00
 #define LCD_4BITMODE            0x00
 
+#define LCD_COLS                16u     /* 16 x 2 or 20 x 4 modules */
+#define LCD_ROWS                2u
+
+#define LCD_FRAME_MS            100u    /* shadow framebuffer flush period */
+
+/* Custom glyphs for the framebuffer: put LCD_GLYPH(id) in a string */
+#define LCD_GLYPHS              16u     /* ids defined; 8 fit in CGRAM at once */
+#define LCD_GLYPH(id)           (0x10u + (id))
+#define LCD_GLYPH_BAR1          12u     /* 12..15: bar cells, 1..4 of 5 columns */
+
 /* ************************************************************************** */
 /* Section: Data Types                                                        */
 /* ************************************************************************** */
@@ -82,7 +97,7 @@ extern "C" {
 
 /**
   @Function
-    void LCD_I2C_Initialize(uint8_t i2cAddress);
+    bool LCD_I2C_Initialize(uint8_t i2cAddress);
 
   @Summary
     Initializes the LCD over I2C.
@@ -92,15 +107,15 @@ extern "C" {
     I2C backpack (PCF8574). Must be called after I2C peripheral is initialized.
 
   @Precondition
-    I2C peripheral must be initialized and enabled.
+    I2c_Init() called; from a task (it sleeps through the power-up delays).
 
   @Parameters
     @param i2cAddress - I2C address of the LCD backpack (e.g., 0x27 or 0x3F).
 
   @Returns
-    None.
+    true if the backpack acknowledged every transfer.
 */
-void LCD_I2C_Initialize(uint8_t i2cAddress);
+bool LCD_I2C_Initialize(uint8_t i2cAddress);
 
 /**
   @Function
@@ -138,6 +153,28 @@ void LCD_I2C_SetCursor(uint8_t col, uint8_t row);
 */
 void LCD_I2C_Print(const char *str);
 
+/**
+  @Function
+    void LCD_I2C_PrintAt(uint8_t col, uint8_t row, const char *str);
+
+  @Summary
+    Moves the cursor and prints a string in a single I2C write.
+*/
+void LCD_I2C_PrintAt(uint8_t col, uint8_t row, const char *str);
+
+/**
+  @Function
+    void LCD_I2C_PrintScreen(const char *const lines[LCD_ROWS]);
+
+  @Summary
+    Writes every row from column 0 in a single I2C write.
+
+  @Description
+    Rows shorter than LCD_COLS leave the rest of the row as it was; pad
+    them with spaces to overwrite it.
+*/
+void LCD_I2C_PrintScreen(const char *const lines[LCD_ROWS]);
+
 /**
   @Function
     void LCD_I2C_WriteChar(char c);
@@ -156,6 +193,109 @@ void LCD_I2C_WriteChar(char c);
 */
 void LCD_I2C_Command(uint8_t cmd);
 
+/**
+  @Function
+    void LCD_I2C_SetBacklight(bool on);
+
+  @Summary
+    Switches the backpack's backlight transistor.
+*/
+void LCD_I2C_SetBacklight(bool on);
+
+/**
+  @Function
+    bool LCD_I2C_Ok(void);
+
+  @Summary
+    True if the last transfer to the LCD was acknowledged.
+*/
+bool LCD_I2C_Ok(void);
+
+/**
+  @Function
+    bool LCD_I2C_FrameStart(uint8_t i2cAddress);
+
+  @Summary
+    Drives the display from a shadow framebuffer in a background thread.
+
+  @Description
+    Adds the LCD flush thread to the Coop task (coop.h), which initializes
+    the display and then, every LCD_FRAME_MS, sends only the cells changed since the last flush:
+    a cursor move per run of changed cells plus the characters themselves,
+    all in one I2C write. Repaints cost bus time in proportion to what
+    changed, and never clear the screen, so nothing flickers.
+
+  @Precondition
+    I2c_Init() called, before the scheduler. From then on the thread owns
+    the LCD: use only the LCD_I2C_Frame*() calls.
+
+  @Returns
+    false if the coop thread table is full.
+*/
+bool LCD_I2C_FrameStart(uint8_t i2cAddress);
+
+/**
+  @Function
+    void LCD_I2C_FrameWrite(uint8_t col, uint8_t row, const char *str);
+
+  @Summary
+    Puts a string into the framebuffer; any task.
+
+  @Description
+    Text past the end of the row is cut off. Cells written with what the
+    display already shows cost nothing at the next flush.
+*/
+void LCD_I2C_FrameWrite(uint8_t col, uint8_t row, const char *str);
+
+/**
+  @Function
+    void LCD_I2C_FrameClear(void);
+
+  @Summary
+    Fills the framebuffer with spaces (no LCD_CMD_CLEAR); any task.
+*/
+void LCD_I2C_FrameClear(void);
+
+/**
+  @Function
+    void LCD_I2C_FrameFlush(void);
+
+  @Summary
+    Sends the changed cells now; from the task that owns the LCD.
+*/
+void LCD_I2C_FrameFlush(void);
+
+/**
+  @Function
+    void LCD_I2C_GlyphDefine(uint8_t id, const uint8_t rows[8]);
+
+  @Summary
+    Sets the 5x8 pattern of glyph id (low 5 bits of each row); any task.
+
+  @Description
+    Glyphs live in a cache over the 8 CGRAM slots: the flush uploads one
+    only when a frame cell uses it and it is not already resident (or was
+    redefined), evicting the least recently shown glyph that is not on
+    screen. Unchanged glyphs cost no bus time however often they redraw.
+    With more than 8 distinct glyphs on screen the extra ones show '?'.
+*/
+void LCD_I2C_GlyphDefine(uint8_t id, const uint8_t rows[8]);
+
+/**
+  @Function
+    void LCD_I2C_FrameBar(uint8_t col, uint8_t row, uint8_t width,
+                          uint32_t value, uint32_t max);
+
+  @Summary
+    Draws value / max as a horizontal bar of width cells; any task.
+
+  @Description
+    Five steps per cell: full cells use the ROM block (0xFF), the partial
+    cell one of the LCD_GLYPH_BAR1 glyphs, so a bar needs at most one
+    CGRAM slot at a time.
+*/
+void LCD_I2C_FrameBar(uint8_t col, uint8_t row, uint8_t width, uint32_t value, uint32_t max);
+
 #ifdef __cplusplus
 }
 #endif
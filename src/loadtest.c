@@ -0,0 +1,204 @@
+/* =============================================================================
+ * loadtest.c  -  Synthetic load on the target: sensor storms, heavy effects,
+ *                queue high-water marks
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "loadtest.h"
+
+#if LOADTEST_ENABLE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream_buffer.h"
+#include "hrtimer.h"
+#include "showclock.h"
+#include "dsun_sensor.h"
+#include "effects.h"
+#include <string.h>
+
+#define LT_SECONDS_MAX      1800u           /* under half the show clock wrap */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static loadtest_level_t  lt_obj[LOADTEST_OBJECTS];
+static uint32_t          lt_objs;
+static loadtest_status_t lt_status;
+static uint32_t          lt_start;
+static hrtimer_t         lt_edge_timer;
+static hrtimer_t         lt_end_timer;
+static bool              lt_ready;
+static bool              lt_level;
+
+/* The entry of `obj`, added on its first send; NULL with the table full. Masked */
+static loadtest_level_t *lt_find(const void *obj)
+{
+    for (uint32_t i = 0; i < lt_objs; i++)
+        if (lt_obj[i].obj == obj) return &lt_obj[i];
+    if (lt_objs == LOADTEST_OBJECTS) return NULL;
+
+    lt_obj[lt_objs].obj = obj;
+    return &lt_obj[lt_objs++];
+}
+
+/* Show clock ISR: the next synthetic edge */
+static void lt_edge(hrtimer_t *t, void *arg)
+{
+    (void)t;
+    (void)arg;
+    lt_level = !lt_level;
+    dsun_inject_edge(lt_level);
+    lt_status.edges++;
+}
+
+/* Timer task: the run's time is up */
+static void lt_end(hrtimer_t *t, void *arg)
+{
+    (void)t;
+    (void)arg;
+    LoadTest_Stop();
+}
+
+static void lt_layers(bool on)
+{
+    effect_cmd_t cmd = { 0 };
+
+    for (uint8_t l = 0; l < 2u && l < EFFECTS_MAX_LAYERS; l++)
+    {
+        cmd.op    = on ? EFFECT_CMD_SET_LAYER : EFFECT_CMD_CLEAR_LAYER;
+        cmd.index = l;
+        cmd.id    = (l == 0u) ? LOADTEST_FX_LAYER0 : LOADTEST_FX_LAYER1;
+        cmd.mode  = (l == 0u) ? EFFECT_BLEND_MAX : EFFECT_BLEND_ADD;
+        cmd.value = 255u;
+        (void)Effects_Post(&cmd);
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool LoadTest_Start(uint32_t edge_hz, uint32_t seconds, bool fx)
+{
+    if (edge_hz > LOADTEST_EDGE_HZ_MAX || seconds > LT_SECONDS_MAX) return false;
+
+    if (!lt_ready)
+    {
+        HrTimer_Create(&lt_edge_timer, lt_edge, NULL, HRTIMER_ISR);
+        HrTimer_Create(&lt_end_timer, lt_end, NULL, HRTIMER_TASK);
+        lt_ready = true;
+    }
+    LoadTest_Stop();
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < lt_objs; i++)
+    {
+        lt_obj[i].high  = 0u;
+        lt_obj[i].sends = 0u;
+        lt_obj[i].full  = 0u;
+    }
+    lt_status.running = true;
+    lt_status.fx      = fx;
+    lt_status.edge_hz = edge_hz;
+    lt_status.edges   = 0u;
+    lt_status.ms      = 0u;
+    lt_start          = ShowClock_Now();
+    taskEXIT_CRITICAL();
+
+    if (fx) lt_layers(true);
+    if (edge_hz != 0u) HrTimer_Start(&lt_edge_timer, 1000000u / edge_hz, 1000000u / edge_hz);
+    if (seconds != 0u) HrTimer_Start(&lt_end_timer, seconds * 1000000u, 0u);
+    return true;
+}
+
+void LoadTest_Stop(void)
+{
+    bool fx;
+
+    if (!lt_ready) return;
+
+    (void)HrTimer_Stop(&lt_edge_timer);
+    (void)HrTimer_Stop(&lt_end_timer);
+
+    taskENTER_CRITICAL();
+    fx = lt_status.running && lt_status.fx;
+    if (lt_status.running) lt_status.ms = ShowClock_Since(lt_start) / 1000u;
+    lt_status.running = false;
+    taskEXIT_CRITICAL();
+
+    if (fx) lt_layers(false);
+}
+
+void LoadTest_GetStatus(loadtest_status_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = lt_status;
+    if (out->running) out->ms = ShowClock_Since(lt_start) / 1000u;
+    taskEXIT_CRITICAL();
+}
+
+uint32_t LoadTest_GetLevels(loadtest_level_t *out, uint32_t max)
+{
+    uint32_t n;
+
+    taskENTER_CRITICAL();
+    n = (lt_objs < max) ? lt_objs : max;
+    memcpy(out, lt_obj, n * sizeof(out[0]));
+    taskEXIT_CRITICAL();
+    return n;
+}
+
+void LoadTest_Name(const void *obj, const char *name)
+{
+    UBaseType_t       mask = taskENTER_CRITICAL_FROM_ISR();
+    loadtest_level_t *e    = lt_find(obj);
+
+    if (e != NULL) e->name = name;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void LoadTest_QueueSend(const void *obj, uint32_t used, uint32_t size)
+{
+    UBaseType_t       mask = taskENTER_CRITICAL_FROM_ISR();
+    loadtest_level_t *e    = lt_find(obj);
+
+    if (e != NULL)
+    {
+        e->size = size;
+        e->sends++;
+        if (used > e->high) e->high = used;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void LoadTest_QueueFull(const void *obj, uint32_t size)
+{
+    UBaseType_t       mask = taskENTER_CRITICAL_FROM_ISR();
+    loadtest_level_t *e    = lt_find(obj);
+
+    if (e != NULL)
+    {
+        e->size = size;
+        e->high = size;
+        e->full++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void LoadTest_StreamSend(void *obj, bool sent)
+{
+    StreamBufferHandle_t sb   = obj;
+    uint32_t             used = (uint32_t)xStreamBufferBytesAvailable(sb);
+    uint32_t             size = used + (uint32_t)xStreamBufferSpacesAvailable(sb);
+    UBaseType_t          mask = taskENTER_CRITICAL_FROM_ISR();
+    loadtest_level_t    *e    = lt_find(obj);
+
+    if (e != NULL)
+    {
+        e->size = size;
+        e->sends++;
+        if (!sent) e->full++;
+        if (used > e->high) e->high = used;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+#endif /* LOADTEST_ENABLE */
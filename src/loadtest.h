@@ -0,0 +1,102 @@
+/* =============================================================================
+ * loadtest.h  -  Synthetic load on the target: sensor storms, heavy effects,
+ *                queue high-water marks
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Scheduling headroom is found by pushing the real firmware past what a
+ * visitor ever does, on the bench with the actuator parked, rather than on
+ * a host model of it: the same kernel port, the same DMAC and interrupt
+ * timing. A run combines:
+ *
+ *   edges    synthetic presence edges at `edge_hz`, alternating, through
+ *            dsun_inject_edge(): the EIC handler runs for each exactly as
+ *            for a real one (event stream, event bus, edge callback), so
+ *            every consumer downstream sees the rate
+ *   effects  both overlay layers on the costliest effects at full alpha
+ *            (LOADTEST_FX_LAYER0 / 1), cleared again at the end
+ *
+ * Meanwhile the queue and stream buffer sends are watched through the
+ * FreeRTOS trace hooks (FreeRTOSConfig.h): per object the send count, the
+ * sends that found it full and the deepest fill seen against its
+ * capacity. Objects are named by the module that creates them
+ * (LOADTEST_NAME()); the rest show as an address. The per-task CPU share
+ * and stack headroom under the load are the "top" figures (cpuload.h).
+ *
+ * "load <edges/s> [s] [fx]" on the console starts a run, "load" prints the
+ * table, "load stop" ends it early. Park the actuator first (Actuator_Park())
+ * unless the relays are meant to take the storm too.
+ *
+ * With LOADTEST_ENABLE = 0 the hooks expand to nothing and the module is
+ * not built.
+ * ============================================================================= */
+
+#ifndef LOADTEST_H
+#define LOADTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef LOADTEST_ENABLE
+#define LOADTEST_ENABLE         0       /* 1 = build the load generator in    */
+#endif
+#define LOADTEST_OBJECTS        16u     /* queues and stream buffers watched  */
+#define LOADTEST_EDGE_HZ_MAX    20000u  /* synthetic edges per second         */
+#define LOADTEST_FX_LAYER0      EFFECT_FIRE_SIM     /* blended MAX            */
+#define LOADTEST_FX_LAYER1      EFFECT_PARTICLES    /* blended ADD            */
+
+typedef struct
+{
+    const void *obj;            /* queue or stream buffer handle */
+    const char *name;           /* NULL: not named               */
+    uint32_t    size;           /* items, or bytes               */
+    uint32_t    high;           /* deepest fill seen             */
+    uint32_t    sends;
+    uint32_t    full;           /* sends that found no room      */
+} loadtest_level_t;
+
+typedef struct
+{
+    bool     running;
+    bool     fx;
+    uint32_t edge_hz;
+    uint32_t edges;             /* injected this run    */
+    uint32_t ms;                /* run length so far    */
+} loadtest_status_t;
+
+#if LOADTEST_ENABLE
+
+#define LOADTEST_NAME(obj, name)    LoadTest_Name((obj), (name))
+
+/**
+ * Start a run: `edge_hz` presence edges per second (0 = none) for
+ * `seconds` (0 = until LoadTest_Stop()), the heavy effect layers with
+ * `fx`. Clears the high-water marks. False for a rate over
+ * LOADTEST_EDGE_HZ_MAX. Any task.
+ */
+bool LoadTest_Start(uint32_t edge_hz, uint32_t seconds, bool fx);
+
+/** End the run, clearing its effect layers. Any task. */
+void LoadTest_Stop(void);
+
+/** State of the current or last run. Any task. */
+void LoadTest_GetStatus(loadtest_status_t *out);
+
+/** Copy up to `max` watched objects into `out`; returns how many. Any task. */
+uint32_t LoadTest_GetLevels(loadtest_level_t *out, uint32_t max);
+
+/** Label `obj` in the table. After creating it. */
+void LoadTest_Name(const void *obj, const char *name);
+
+/* Trace hooks (FreeRTOSConfig.h): a send that will leave `used` of `size` */
+void LoadTest_QueueSend(const void *obj, uint32_t used, uint32_t size);
+void LoadTest_QueueFull(const void *obj, uint32_t size);
+void LoadTest_StreamSend(void *obj, bool sent);
+
+#else
+
+#define LOADTEST_NAME(obj, name)    ((void)0)
+
+#endif /* LOADTEST_ENABLE */
+
+#endif /* LOADTEST_H */
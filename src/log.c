@@ -0,0 +1,180 @@
+/* =============================================================================
+ * log.c  -  Small integer-only formatted logging with compile-time levels
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    char *p;
+    char *end;          /* last usable byte, kept for the NUL */
+} log_out_t;
+
+static void log_stdout(const char *line, size_t len)
+{
+    (void)fwrite(line, 1u, len, stdout);
+}
+
+static log_sink_t log_sink = log_stdout;
+
+static const char log_tag[] = { '?', 'E', 'W', 'I', 'D' };
+
+static inline void log_putc(log_out_t *o, char c)
+{
+    if (o->p < o->end) *o->p++ = c;
+}
+
+static void log_pad(log_out_t *o, char c, int32_t n)
+{
+    while (n-- > 0) log_putc(o, c);
+}
+
+/* One integer, right- or left-aligned in `width` */
+static void log_num(log_out_t *o, uint32_t v, uint8_t base, bool neg, bool upper,
+                    uint8_t width, bool zero, bool left)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[10];                                       /* 2^32 in decimal */
+    uint8_t n = 0;
+
+    do
+    {
+        tmp[n++] = digits[v % base];
+        v /= base;
+    } while (v != 0u);
+
+    int32_t fill = (int32_t)width - n - (neg ? 1 : 0);
+
+    if (!left && !zero) log_pad(o, ' ', fill);
+    if (neg) log_putc(o, '-');
+    if (!left && zero) log_pad(o, '0', fill);
+    while (n != 0u) log_putc(o, tmp[--n]);
+    if (left) log_pad(o, ' ', fill);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+size_t Log_VFormat(char *buf, size_t size, const char *fmt, va_list ap)
+{
+    log_out_t o = { buf, buf + size - 1u };
+
+    if (size == 0u) return 0u;
+
+    while (*fmt != '\0')
+    {
+        char c = *fmt++;
+
+        if (c != '%')
+        {
+            log_putc(&o, c);
+            continue;
+        }
+
+        bool    left  = false;
+        bool    zero  = false;
+        uint8_t width = 0;
+
+        for (;; fmt++)
+        {
+            if (*fmt == '-') left = true;
+            else if (*fmt == '0') zero = true;
+            else break;
+        }
+        while (*fmt >= '0' && *fmt <= '9')
+        {
+            if (width < 10u) width = (uint8_t)(width * 10u + (uint8_t)(*fmt - '0'));
+            fmt++;
+        }
+        while (*fmt == 'l' || *fmt == 'h') fmt++;
+
+        switch (c = *fmt++)
+        {
+            case 'd':
+            case 'i':
+            {
+                int32_t v = va_arg(ap, int32_t);
+                uint32_t m = (v < 0) ? 0u - (uint32_t)v : (uint32_t)v;
+
+                log_num(&o, m, 10u, v < 0, false, width, zero, left);
+                break;
+            }
+            case 'u':
+                log_num(&o, va_arg(ap, uint32_t), 10u, false, false, width, zero, left);
+                break;
+            case 'x':
+            case 'X':
+                log_num(&o, va_arg(ap, uint32_t), 16u, false, c == 'X', width, zero, left);
+                break;
+            case 'p':
+                log_putc(&o, '0');
+                log_putc(&o, 'x');
+                log_num(&o, (uint32_t)(uintptr_t)va_arg(ap, void *), 16u, false, false, 8u, true, false);
+                break;
+            case 'c':
+                if (!left) log_pad(&o, ' ', (int32_t)width - 1);
+                log_putc(&o, (char)va_arg(ap, int));
+                if (left) log_pad(&o, ' ', (int32_t)width - 1);
+                break;
+            case 's':
+            {
+                const char *s = va_arg(ap, const char *);
+                int32_t n = 0;
+
+                if (s == NULL) s = "(null)";
+                while (s[n] != '\0') n++;
+                if (!left) log_pad(&o, ' ', (int32_t)width - n);
+                while (*s != '\0') log_putc(&o, *s++);
+                if (left) log_pad(&o, ' ', (int32_t)width - n);
+                break;
+            }
+            case '\0':
+                fmt--;                      /* lone '%' at the end */
+                break;
+            default:
+                log_putc(&o, '%');          /* '%%' or unknown: copy it out */
+                if (c != '%') log_putc(&o, c);
+                break;
+        }
+    }
+    *o.p = '\0';
+    return (size_t)(o.p - buf);
+}
+
+size_t Log_Format(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list ap;
+    size_t n;
+
+    va_start(ap, fmt);
+    n = Log_VFormat(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void Log_SetSink(log_sink_t sink)
+{
+    log_sink = (sink != NULL) ? sink : log_stdout;
+}
+
+void Log_Write(uint8_t level, const char *fmt, ...)
+{
+    char line[LOG_LINE_MAX + 1u];
+    va_list ap;
+    size_t n;
+
+    n = Log_Format(line, sizeof(line) - 1u, "%8lu %c ",
+                   (unsigned long)xTaskGetTickCount(),
+                   log_tag[(level < sizeof(log_tag)) ? level : 0u]);
+    va_start(ap, fmt);
+    n += Log_VFormat(&line[n], sizeof(line) - 1u - n, fmt, ap);
+    va_end(ap);
+    line[n++] = '\n';                       /* the spare byte kept above */
+    log_sink(line, n);
+}
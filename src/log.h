@@ -0,0 +1,82 @@
+/* =============================================================================
+ * log.h  -  Small integer-only formatted logging with compile-time levels
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * LOG_ERROR() .. LOG_DEBUG() take printf-style arguments, but are formatted
+ * by a few hundred bytes of code instead of libc printf: no heap, no
+ * locale, no floating point, and about LOG_LINE_MAX + 64 bytes of the
+ * caller's stack. Each line gets the tick and level in front and goes to
+ * the sink (stdout, i.e. the SERCOM5 console, by default) in one call.
+ *
+ * Calls above LOG_LEVEL are removed by the preprocessor, arguments and all,
+ * so release builds (NDEBUG) carry no debug strings or formatting.
+ *
+ * Supported conversions: %d %i %u %x %X %c %s %p %%, with the '-' and '0'
+ * flags, a field width and the 'l' / 'h' length modifiers (all integers
+ * are 32-bit here). Anything else is copied out as is. Output past
+ * LOG_LINE_MAX is cut off.
+ *
+ * Reentrant: any task may log at once. Not for ISRs.
+ * ============================================================================= */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef LOG_LEVEL
+#ifdef NDEBUG
+#define LOG_LEVEL           LOG_LEVEL_WARN
+#else
+#define LOG_LEVEL           LOG_LEVEL_DEBUG
+#endif
+#endif
+#define LOG_LINE_MAX        96u         /* bytes per line, prefix and '\n' included */
+
+/** Receives each finished line (not NUL-terminated), from the logging task. */
+typedef void (*log_sink_t)(const char *line, size_t len);
+
+/** Route lines elsewhere (NULL = back to stdout). Before the scheduler. */
+void Log_SetSink(log_sink_t sink);
+
+/** Format one line at `level` and hand it to the sink. Use the macros below. */
+void Log_Write(uint8_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * The formatter on its own: at most size - 1 characters and a NUL into buf.
+ * Returns the characters stored.
+ */
+size_t Log_VFormat(char *buf, size_t size, const char *fmt, va_list ap);
+size_t Log_Format(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...)      Log_Write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...)      ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...)       Log_Write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)       ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...)       Log_Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)       ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...)      Log_Write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)      ((void)0)
+#endif
+
+#endif /* LOG_H */
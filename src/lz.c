@@ -0,0 +1,247 @@
+/* =============================================================================
+ * lz.c  -  Streaming LZ4 block decoder for compressed show files
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "lz.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH        4u
+#define LZ_RUN_MASK         15u
+
+typedef enum
+{
+    LZ_S_FILE = 0,              /* gathering the file header      */
+    LZ_S_HEAD,                  /* gathering a block header       */
+    LZ_S_STORED,                /* copying a stored block         */
+    LZ_S_TOKEN,
+    LZ_S_LITLEN,                /* literal length extension bytes */
+    LZ_S_LIT,
+    LZ_S_OFFSET,
+    LZ_S_MATCHLEN,              /* match length extension bytes   */
+    LZ_S_MATCH,
+    LZ_S_END,
+    LZ_S_ERROR
+} lz_state_t;
+
+static uint32_t lz_le16(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+/* A block header gathered: set up its decode; false if it cannot be one */
+static bool lz_block(lz_dec_t *d)
+{
+    uint32_t dsize = lz_le16(d->hdr);
+    uint32_t c     = lz_le16(&d->hdr[2]);
+    uint32_t data  = c & ~LZ_STORED;
+
+    if (c == 0u)
+    {
+        d->state = (dsize == 0u) ? LZ_S_END : LZ_S_ERROR;
+        return dsize == 0u;
+    }
+    if (dsize == 0u || dsize > d->block || data > dsize) return false;
+    if ((c & LZ_STORED) != 0u && data != dsize) return false;
+
+    d->dsize = dsize;
+    d->csize = data + LZ_BLOCK_HEADER;
+    d->left  = data;
+    d->pos   = 0u;
+    d->state = ((c & LZ_STORED) != 0u) ? LZ_S_STORED : LZ_S_TOKEN;
+    return true;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Lz_Init(lz_dec_t *d, uint32_t max)
+{
+    memset(d, 0, sizeof(*d));
+    d->max   = max;
+    d->state = LZ_S_FILE;
+}
+
+bool Lz_IsPacked(const uint8_t *p)
+{
+    return p[0] == 'C' && p[1] == 'R' && p[2] == 'L' && p[3] == 'Z';
+}
+
+lz_result_t Lz_Decode(lz_dec_t *d, const uint8_t *in, uint32_t len, uint32_t *used, uint8_t *out)
+{
+    const uint8_t *p   = in;
+    const uint8_t *end = in + len;
+    lz_result_t    r   = LZ_MORE;
+    uint32_t       n;
+    uint8_t        b;
+
+    while (r == LZ_MORE)
+    {
+        switch (d->state)
+        {
+            case LZ_S_FILE:
+            case LZ_S_HEAD:
+                n = (d->state == LZ_S_FILE) ? LZ_FILE_HEADER : LZ_BLOCK_HEADER;
+                while (d->hn < n && p < end) d->hdr[d->hn++] = *p++;
+                if (d->hn < n)
+                {
+                    *used = (uint32_t)(p - in);
+                    return LZ_MORE;
+                }
+                d->hn = 0u;
+                if (d->state == LZ_S_HEAD)
+                {
+                    if (!lz_block(d)) d->state = LZ_S_ERROR;
+                    else if (d->state == LZ_S_END) r = LZ_END;
+                    break;
+                }
+                d->block = lz_le16(&d->hdr[6]);
+                d->state = (Lz_IsPacked(d->hdr) && d->hdr[4] == LZ_VERSION &&
+                            d->block != 0u && d->block <= d->max) ? LZ_S_HEAD : LZ_S_ERROR;
+                break;
+
+            case LZ_S_STORED:
+                n = (uint32_t)(end - p);
+                if (n > d->left) n = d->left;
+                memcpy(&out[d->pos], p, n);
+                p       += n;
+                d->pos  += n;
+                d->left -= n;
+                if (d->left != 0u)
+                {
+                    *used = (uint32_t)(p - in);
+                    return LZ_MORE;
+                }
+                d->state = LZ_S_HEAD;
+                r = LZ_BLOCK;
+                break;
+
+            case LZ_S_TOKEN:
+                if (d->left == 0u)                      /* the last sequence ends on literals */
+                {
+                    d->state = (d->pos == d->dsize) ? LZ_S_HEAD : LZ_S_ERROR;
+                    if (d->state == LZ_S_HEAD) r = LZ_BLOCK;
+                    break;
+                }
+                if (p == end)
+                {
+                    *used = (uint32_t)(p - in);
+                    return LZ_MORE;
+                }
+                d->token = *p++;
+                d->left--;
+                d->lit   = (uint32_t)(d->token >> 4);
+                d->state = (d->lit == LZ_RUN_MASK) ? LZ_S_LITLEN : LZ_S_LIT;
+                break;
+
+            case LZ_S_LITLEN:
+            case LZ_S_MATCHLEN:
+                /* 255 says another byte follows; the block bounds the sum */
+                for (b = 255u; b == 255u && p < end && d->left != 0u; d->left--)
+                {
+                    b = *p++;
+                    if (d->state == LZ_S_LITLEN) d->lit   += b;
+                    else                         d->match += b;
+                }
+                if (b != 255u)
+                {
+                    d->state = (d->state == LZ_S_LITLEN) ? LZ_S_LIT : LZ_S_MATCH;
+                    break;
+                }
+                if (d->left == 0u)
+                {
+                    d->state = LZ_S_ERROR;
+                    break;
+                }
+                *used = (uint32_t)(p - in);
+                return LZ_MORE;
+
+            case LZ_S_LIT:
+                if (d->lit > d->dsize - d->pos || d->lit > d->left)
+                {
+                    d->state = LZ_S_ERROR;
+                    break;
+                }
+                n = (uint32_t)(end - p);
+                if (n > d->lit) n = d->lit;
+                memcpy(&out[d->pos], p, n);
+                p       += n;
+                d->pos  += n;
+                d->left -= n;
+                d->lit  -= n;
+                if (d->lit != 0u)
+                {
+                    *used = (uint32_t)(p - in);
+                    return LZ_MORE;
+                }
+                d->state = (d->left == 0u) ? LZ_S_TOKEN : LZ_S_OFFSET;
+                break;
+
+            case LZ_S_OFFSET:
+                while (d->hn < 2u && p < end && d->left != 0u)
+                {
+                    d->hdr[d->hn++] = *p++;
+                    d->left--;
+                }
+                if (d->hn < 2u)
+                {
+                    if (d->left == 0u)
+                    {
+                        d->state = LZ_S_ERROR;
+                        break;
+                    }
+                    *used = (uint32_t)(p - in);
+                    return LZ_MORE;
+                }
+                d->hn = 0u;
+                n = lz_le16(d->hdr);
+                if (n == 0u || n > d->pos)              /* before the block: out of the window */
+                {
+                    d->state = LZ_S_ERROR;
+                    break;
+                }
+                d->dist  = n;
+                d->match = (d->token & LZ_RUN_MASK) + LZ_MIN_MATCH;
+                d->state = ((d->token & LZ_RUN_MASK) == LZ_RUN_MASK) ? LZ_S_MATCHLEN : LZ_S_MATCH;
+                break;
+
+            case LZ_S_MATCH:
+                if (d->match > d->dsize - d->pos)
+                {
+                    d->state = LZ_S_ERROR;
+                    break;
+                }
+                {
+                    uint8_t       *o = &out[d->pos];
+                    const uint8_t *s = o - d->dist;
+
+                    if (d->dist >= d->match) memcpy(o, s, d->match);
+                    else for (n = 0; n < d->match; n++) o[n] = s[n];  /* overlap: a run */
+                }
+                d->pos  += d->match;
+                d->match = 0u;
+                d->state = LZ_S_TOKEN;
+                break;
+
+            case LZ_S_END:
+                r = LZ_END;
+                break;
+
+            default:
+                r = LZ_ERROR;
+                break;
+        }
+        if (d->state == LZ_S_ERROR) r = LZ_ERROR;
+    }
+    *used = (uint32_t)(p - in);
+    return r;
+}
+
+uint32_t Lz_BlockBytes(const lz_dec_t *d)
+{
+    return d->dsize;
+}
+
+uint32_t Lz_BlockPacked(const lz_dec_t *d)
+{
+    return d->csize;
+}
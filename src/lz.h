@@ -0,0 +1,83 @@
+/* =============================================================================
+ * lz.h  -  Streaming LZ4 block decoder for compressed show files
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Animations and sound read from the card are mostly repeats: unchanged
+ * colours, runs, silence. tools/lzpack.py packs a file into independent
+ * LZ4 blocks, so the card moves fewer bytes for the same show:
+ *
+ *   header   'C' 'R' 'L' 'Z'  version(u8)  reserved(u8)  block(u16)
+ *   block    dsize(u16) csize(u16) data[csize & 0x7FFF]
+ *   end      0000 0000
+ *
+ * all little-endian. dsize is the block decoded (<= block, every block but
+ * the last one exactly block), csize its data, bit 15 set if stored as it
+ * is. The data is the plain LZ4 block format (token, literal length,
+ * literals, 16-bit offset, match length), and no match reaches before the
+ * start of its block: the window is the block being decoded and nothing
+ * more, so the decoder needs no history buffer of its own.
+ *
+ * Lz_Decode() takes the input in whatever pieces it arrives, picks up
+ * mid-sequence where the last piece ended, and writes the block straight
+ * into the caller's buffer, which must be the same one until LZ_BLOCK.
+ * Every length and offset is checked against the block, so a corrupt
+ * file stops with LZ_ERROR and never writes outside it. stream.h decodes
+ * with it in the Stream task, a block per read-ahead segment.
+ * ============================================================================= */
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LZ_MAGIC            0x5A4C5243u     /* "CRLZ" */
+#define LZ_VERSION          1u
+#define LZ_FILE_HEADER      8u
+#define LZ_BLOCK_HEADER     4u
+#define LZ_STORED           0x8000u         /* csize: the block as it is */
+
+typedef enum
+{
+    LZ_MORE = 0,                /* all input used: the next piece         */
+    LZ_BLOCK,                   /* a block complete in the buffer         */
+    LZ_END,                     /* the end marker                         */
+    LZ_ERROR                    /* corrupt, or a block over the maximum   */
+} lz_result_t;
+
+typedef struct
+{
+    uint32_t max;               /* largest block the caller's buffer takes */
+    uint32_t block;             /* from the file header                    */
+    uint32_t dsize;             /* the block being decoded                 */
+    uint32_t csize;             /* and its data, header included           */
+    uint32_t pos;               /* decoded into it so far                  */
+    uint32_t left;              /* its data still to come                  */
+    uint32_t lit;               /* literals left of the sequence           */
+    uint32_t match;             /* and its match                           */
+    uint32_t dist;              /* the match's offset back                 */
+    uint8_t  state;
+    uint8_t  token;
+    uint8_t  hn;                /* header bytes gathered                   */
+    uint8_t  hdr[LZ_FILE_HEADER];
+} lz_dec_t;
+
+/** Start decoding a file from its header, into blocks of up to `max` bytes. */
+void Lz_Init(lz_dec_t *d, uint32_t max);
+
+/** True if `p` (>= 4 bytes) starts a compressed file. */
+bool Lz_IsPacked(const uint8_t *p);
+
+/**
+ * Decode from `len` bytes at `in` into the block at `out`, stopping at the
+ * end of the input, of a block, or of the file; `*used` is the input
+ * taken, and LZ_BLOCK leaves Lz_BlockBytes() decoded at `out`. Pass a
+ * new `out` after LZ_BLOCK.
+ */
+lz_result_t Lz_Decode(lz_dec_t *d, const uint8_t *in, uint32_t len, uint32_t *used, uint8_t *out);
+
+/** Bytes of the block just completed, and of its data in the file. */
+uint32_t Lz_BlockBytes(const lz_dec_t *d);
+uint32_t Lz_BlockPacked(const lz_dec_t *d);
+
+#endif /* LZ_H */
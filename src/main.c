@@ -5,44 +5,379 @@
 
 // Your custom packages
 #include "actuator.h"
+#include "estop.h"
 #include "neopixel.h" // Ensure your NeoPixel header is included
-#include <stdio.h>
+#include "profile.h"
+#include "effects.h"
+#include "palette.h"
+#include "fire.h"
+#include "fastmath.h"
+#include "particles.h"
+#include "dma_qos.h"
+#include "crc.h"
+#include "rng.h"
+#include "dsun_sensor.h"
+#include "showclock.h"
+#include "evbus.h"
+#include "log.h"
+#include "stats.h"
+#include "metrics.h"
+#include "status.h"
+#include "tlog.h"
+#include "stdio_uart.h"
+#include "cli.h"
+#include "settings.h"
+#include "wear.h"
+#include "fault.h"
+#include "watchdog.h"
+#include "brownout.h"
+#include "telem.h"
+#include "rtt.h"
+#include "rtos_trace.h"
+#include "cpuload.h"
+#include "stackmon.h"
+#include "pool.h"
+#include "fpu.h"
+#include "stackguard.h"
+#include "audio.h"
+#include "sound.h"
+#include "qflash.h"
+#include "assets.h"
+#include "assetcache.h"
+#include "sdcard.h"
+#include "stream.h"
+#include "showsync.h"
+#include "dmx.h"
+#include "pixdist.h"
+#include "netbridge.h"
+#include "usbcdc.h"
+#include "idle.h"
+#include "tickless.h"
+#include "boot.h"
+#include "cache.h"
+#include "ramfunc.h"
+#include "cpufreq.h"
+#include "dmamem.h"
+#include "mode.h"
+#include "coop.h"
+#include "framestat.h"
+#include "fpsctl.h"
+#include "statusled.h"
+#include "showcal.h"
+#include "railmon.h"
+#include "knob.h"
+#include "imgcheck.h"
+#include "ioseq.h"
+#include "servo.h"
+#include "tof.h"
+#include "hrtimer.h"
+#include "defer.h"
+#include "resume.h"
+#include "plugin.h"
+#include "nvwrite.h"
 #define DEBUG_WAIT 10000000UL
 
-// Define an LED pin for your heartbeat (assuming PA14)
-#define BLINKY_LED_PIN PORT_PA14
+// NeoPixel frame rate; the period is rounded down to whole RTOS ticks.
+// With NEO_HW_FRAME_START the driver's frame timer sets the pace instead
+#if NEO_HW_FRAME_START
+#define NEO_TARGET_FPS   NEO_HW_FRAME_HZ
+#define NEO_FRAME_US     (1000000u / NEO_HW_FRAME_HZ)
+#else
+#define NEO_TARGET_FPS   50u
+#define NEO_FRAME_US     ((uint32_t)NEO_FRAME_TICKS * (1000000u / configTICK_RATE_HZ))
+#endif
+#define NEO_FRAME_TICKS  ((TickType_t)(configTICK_RATE_HZ / NEO_TARGET_FPS))
 
-// ---------------------------------------------------------
-// Blinky RTOS Task
-// ---------------------------------------------------------
-void Blinky_Task(void *pvParameters)
+// Global LED brightness, tunable on the console ("set bright n"); the CLI
+// hands it to the renderer as a command, the driver is not touched here
+static uint8_t neo_brightness = 80u;
+
+// Scaled by the prop mode (percent): dim with nobody there, up for a scare;
+// by the room light with RAILMON_ENABLE (railmon.h); dark outside the
+// opening hours (showcal.h)
+static const uint16_t neo_mode_pct[MODE_COUNT] = { 100u, 60u, 100u, 160u, 80u };
+static bool           neo_mode_hold;
+
+static void neo_brightness_changed(void)
 {
-    // Setup LED pin as output
-    PORT_REGS->GROUP[0].PORT_DIRSET = BLINKY_LED_PIN;
+    uint32_t     b   = ShowCal_Open() ? (uint32_t)neo_brightness * neo_mode_pct[Mode_Get()]
+                                        * RailMon_BrightPct() / 10000u : 0u;
+    effect_cmd_t cmd = { .op = EFFECT_CMD_BRIGHTNESS, .value = (uint8_t)((b > 255u) ? 255u : b) };
 
-    while(1)
+    (void)Effects_Post(&cmd);
+}
+
+// Mode hook (timer task): the brightness, and the full CPU clock for a whole scare
+static void neo_mode_changed(mode_id_t from, mode_id_t to)
+{
+    bool hold = (to == MODE_SCARE);
+
+    (void)from;
+    neo_brightness_changed();
+    if (hold == neo_mode_hold) return;
+    neo_mode_hold = hold;
+    if (hold) CpuFreq_Hold();
+    else      CpuFreq_Release();
+}
+
+// Calendar hook (timer task): open or closed, the brightness follows
+static void neo_show_hours(bool open)
+{
+    (void)open;
+    neo_brightness_changed();
+}
+
+// Ambient light hook (timer task): the scale moved a step
+static void neo_ambient_changed(uint32_t pct)
+{
+    (void)pct;
+    neo_brightness_changed();
+}
+
+#if QFLASH_ENABLE
+// Init task (boot.h): the effect plug-ins in the asset table, then the
+// saved effect if it is one of them (Effects_Init() only knew the built-ins)
+static void neo_load_plugins(void)
+{
+    uint32_t fx;
+
+    Plugin_LoadAssets();
+    if (Settings_Load(SETTINGS_KEY_EFFECT, &fx) && fx >= EFFECT_COUNT && fx < Effects_Count())
+        Effects_Select((effect_id_t)fx, 0u);
+}
+#endif
+
+#if KNOB_ENABLE
+// Operator knob (knob.h): its deltas off the event bus, on the Coop task
+static evbus_sub_t   neo_knob_sub = EVBUS_NONE;
+static evbus_event_t neo_knob_ev;
+
+static void neo_knob_turned(int32_t d)
+{
+#if KNOB_ACTION == KNOB_ACTION_EFFECT
+    int32_t      n   = (int32_t)Effects_Count();
+    int32_t      id  = ((int32_t)Effects_Current() + d % n + n) % n;
+    effect_cmd_t cmd = { .op = EFFECT_CMD_SELECT, .id = (uint8_t)id, .frames = KNOB_FADE_FRAMES };
+
+    (void)Effects_Post(&cmd);
+#else
+    int32_t b = (int32_t)neo_brightness + d * (int32_t)KNOB_BRIGHT_STEP;
+
+    neo_brightness = (uint8_t)((b < 0) ? 0 : (b > 255) ? 255 : b);
+    neo_brightness_changed();
+#endif
+}
+
+static coop_state_t neo_knob_thread(coop_t *pt, void *arg)
+{
+    (void)arg;
+    COOP_BEGIN(pt);
+    for (;;)
     {
-        // Toggle the LED
-        PORT_REGS->GROUP[0].PORT_OUTTGL = BLINKY_LED_PIN;
-        // Sleep this task for 500ms (1Hz blink rate)
-        vTaskDelay(pdMS_TO_TICKS(500)); 
+        COOP_WAIT_UNTIL(pt, EventBus_Receive(neo_knob_sub, &neo_knob_ev, 0u));
+        neo_knob_turned((int32_t)neo_knob_ev.value);
     }
+    COOP_END(pt);
 }
+#endif
+
+static const cli_param_t neo_brightness_param =
+{
+    "bright", &neo_brightness, CLI_U8, 0u, 255u, neo_brightness_changed,
+    "global LED brightness, after gamma"
+};
+
+// Task memory: every kernel object is static, so the map shows the whole RAM budget
+#define NEOPIXEL_STACK  (512 + FPU_TASK_STACK_EXTRA)    // LED buffering; FP context for float effects
+static StackType_t  neopixel_stack[NEOPIXEL_STACK];
+static StaticTask_t neopixel_tcb;
+
+// Heartbeat deadlines (watchdog.h): a few loop periods each
+#define NEO_HEARTBEAT_MS        1000u   // one frame slot, a Show() timeout included
 
 // ---------------------------------------------------------
 // NeoPixel RTOS Task
 // ---------------------------------------------------------
+
+// Frame scheduler counters (watch in the debugger)
+typedef struct
+{
+    uint32_t frames;    // frames rendered and sent
+    uint32_t missed;    // renders that overran their slot
+    uint32_t dropped;   // slots skipped to get back on schedule
+} neo_frame_stats_t;
+
+static volatile neo_frame_stats_t neo_frame_stats;
+
+// Once per METRICS_NEO_MS hand the frame figures to the metrics snapshot
+static void neo_publish_metrics(uint32_t render_cycles)
+{
+    static TickType_t since;
+    static uint32_t   frames, cycles, hits;
+    TickType_t now = xTaskGetTickCount();
+
+    frames++;
+    cycles += render_cycles;
+    if ((now - since) < pdMS_TO_TICKS(METRICS_NEO_MS)) return;
+
+    metrics_neo_t m;
+    uint32_t ms = (uint32_t)(now - since) * portTICK_PERIOD_MS;
+    uint32_t h  = Cache_Hits();
+
+    m.fps_q4        = (uint16_t)((frames * 16000u + ms / 2u) / ms);
+    m.render_cycles = cycles / frames;
+    m.frames        = neo_frame_stats.frames;
+    m.missed        = neo_frame_stats.missed;
+    m.dropped       = neo_frame_stats.dropped;
+    m.cache_hits    = h - hits;
+    Metrics_PublishNeo(&m);
+    since  = now;
+    frames = 0u;
+    cycles = 0u;
+    hits   = h;
+}
+
 void NeoPixel_Task(void *pvParameters)
 {
-    uint8_t frame = 0;
+    (void)pvParameters;
+#if DMA_STRESS_ENABLE
+    // One-off check that LED frames survive a saturated bus
+    Dma_StressTest(DMA_STRESS_FRAMES);
+#endif
+#if EFFECTS_BENCH_ENABLE
+    // Cycles per frame of every effect on this backend, CSV on the console
+    Effects_Benchmark(EFFECTS_BENCH_FRAMES);
+#endif
+#if RAMFUNC_BENCH_ENABLE
+    // Cycles per strip of each kernel, cache warm / cold / off, from flash or SRAM
+    Ramfunc_Benchmark();
+#endif
+    // A pixdist slave only shows what the master sends; this never returns there
+    PixDist_Run();
+
+    watchdog_id_t wd = Watchdog_Register("NeoPixel", NEO_HEARTBEAT_MS);
+    uint8_t steps = 1;
+#if NEO_QUEUE_FRAMES
+    uint32_t present = ShowClock_Now() + NEO_FRAME_US;   // show time of the frame rendered next
+#else
+    TickType_t wake = xTaskGetTickCount();
+#endif
     
     while(1)
     {
-    // Execute the NeoPixel animation
-    NeoPixel_GreenPurple(frame++, 80);
-      
-        // Yield the CPU for 20ms (~50 FPS update rate)
-        vTaskDelay(pdMS_TO_TICKS(20)); 
+        Watchdog_CheckIn(wd);
+        CpuFreq_Hold();                 // 120 MHz for the frame, divided again before each sleep
+
+        // Execute the active effect (or crossfade) from the registry
+#if NEO_QUEUE_FRAMES
+        NeoPixel_SetPresentTime(present);
+#endif
+        PROFILE_START(t_render);
+        uint32_t t_metrics = DWT->CYCCNT;
+        bool animating = Effects_Render(steps);
+        uint32_t render_cycles = DWT->CYCCNT - t_metrics;
+        PROFILE_ADD(PROFILE_RENDER, t_render);
+        FrameStat_Render(render_cycles);
+        FpsCtl_Frame(render_cycles);    // rate and detail for the frames after this one
+        neo_frame_stats.frames++;
+        Resume_SaveFrame();             // effects and phases to backup RAM, for a warm reset
+        NvWrite_FrameDone();            // a queued nvstore save may go, in the gap to the next frame
+        Boot_Mark(BOOT_FRAME);          // the first one lets the deferred inits run
+        neo_publish_metrics(render_cycles);
+
+        if (!animating)
+        {
+            // Static scene: the strip holds its last frame, so sleep until an
+            // effect request instead of re-sending it every slot
+            CpuFreq_Release();
+            PROFILE_START(t_idle);
+            Watchdog_Pause(wd);
+            Effects_WaitForChange();
+            PROFILE_ADD(PROFILE_IDLE, t_idle);
+            steps = 1;
+            FrameStat_Slots(0u);        // no interval across the pause
+#if NEO_QUEUE_FRAMES
+            present = ShowClock_Now() + NEO_FRAME_US;
+#else
+            wake  = xTaskGetTickCount();
+#endif
+        }
+        else
+        {
+#if NEO_QUEUE_FRAMES
+            // Show() queued the frame for `present` and only blocked while the
+            // queue was full, so the render runs up to NEO_QUEUE_FRAMES frames
+            // ahead and a slow one eats into that lead. Only when the queue ran
+            // dry and the next time has already passed are slots dropped, the
+            // animation still advancing by all of them
+            uint32_t div    = FpsCtl_Divider();
+            uint32_t period = div * NEO_FRAME_US;
+            int32_t  behind = -ShowClock_Until(present + period);
+
+            present += period;
+            steps    = (uint8_t)div;
+            if (behind > 0)
+            {
+                uint32_t skip = (uint32_t)behind / period + 1u;
+
+                present += skip * period;
+                steps    = ((skip + 1u) * div < 255u) ? (uint8_t)((skip + 1u) * div) : 255u;
+                neo_frame_stats.missed++;
+                neo_frame_stats.dropped += skip;
+            }
+            CpuFreq_Release();          // any wait for room was in Show(), at full speed
+#elif NEO_HW_FRAME_START
+            // Show() returns one hardware frame slot after the previous call, or
+            // more if the render overran and slots were repeated; advance the
+            // animation by the slots that actually passed
+            TickType_t now   = xTaskGetTickCount();
+            TickType_t slots = (now - wake + NEO_FRAME_TICKS / 2u) / NEO_FRAME_TICKS;
+
+            wake  = now;
+            steps = (slots == 0u) ? 1u : (slots < 255u) ? (uint8_t)slots : 255u;
+            if (steps > 1u)
+            {
+                neo_frame_stats.missed++;
+                neo_frame_stats.dropped += steps - 1u;
+            }
+            CpuFreq_Release();          // the slot wait was in Show(), at full speed
+#else
+            // If the render ran past its frame, drop the frames already lost instead
+            // of bursting late frames back to back; the animation still advances
+            // by every slot so its speed stays tied to wall time. fpsctl.h runs
+            // heavy scenes every div-th slot, each frame div steps on
+            TickType_t div    = (TickType_t)FpsCtl_Divider();
+            TickType_t period = div * NEO_FRAME_TICKS;
+            TickType_t late   = xTaskGetTickCount() - wake;
+            steps = (uint8_t)div;
+            if (late >= period)
+            {
+                TickType_t skip = late / period;
+
+                wake  += skip * period;
+                steps  = ((skip + 1u) * div < 255u) ? (uint8_t)((skip + 1u) * div) : 255u;
+                neo_frame_stats.missed++;
+                neo_frame_stats.dropped += skip;
+            }
+            FrameStat_Slots(steps);     // where the next frame is due on the grid
+
+            // Sleep until the start of the next frame (fixed rate, no drift)
+            CpuFreq_Release();
+            PROFILE_START(t_idle);
+            (void)xTaskDelayUntil(&wake, period);
+            PROFILE_ADD(PROFILE_IDLE, t_idle);
+#endif
+        }
+
+        Profile_FrameEnd();
+#if PROFILE_ENABLE
+        // Blocking console dump; the frame after a report is expected to be late
+        if ((neo_frame_stats.frames % PROFILE_PRINT_FRAMES) == 0u)
+        {
+            Profile_Print();
+            FrameStat_Print();
+        }
+#endif
     }
 }
 
@@ -51,62 +386,216 @@ void NeoPixel_Task(void *pvParameters)
 // ---------------------------------------------------------
 int main(void)
 {
-
-    // Cache Enable (Improves performance for NeoPixel math & RTOS context switching)
-    if ((CMCC_REGS->CMCC_SR & CMCC_SR_CSTS_Msk) == 0) {
-        CMCC_REGS->CMCC_CTRL = CMCC_CTRL_CEN_Msk;
-    }
+    Boot_Mark(BOOT_MAIN);            // DWT counting since the reset vector (boot.h)
+    // The startup code has the CMCC on, instructions cached (cache.h)
 
     // 1. Initialize System and Hardware Drivers
-    SYS_Initialize(NULL);
+    SYS_Initialize(NULL);            // the UART and an unused TCC0 are left to the Init task
+    STDIO_Init();                    // unbuffered stdin / stdout (stdio_uart.h)
+    Boot_Mark(BOOT_SYSINIT);
+
+    // Clocks, SERCOM1 and the DMAC are up: light the strip from flash before anything else
+    ShowClock_Init();                // 1 MHz show timebase for LED + actuator cues, the rail settle
+    NeoPixel_Init();
+    NeoPixel_ShowBootFrame();        // SHOW_BOOT_FRAME; the first Show() waits for it
+    Boot_Mark(BOOT_LIT);
     
     // 2. Initialize Custom Peripherals
+    Rtt_Init();                      // SWD-read debug channel, usable from here on
+#if RTT_LOG
+    Log_SetSink(Rtt_LogSink);        // profiling: keep the log off the UART
+#endif
+    Fault_Init();                    // last reset's fault record, if any, to the log
+    Metrics_Init();                  // DWT cycle counter + empty snapshot
+    ImgCheck_Init();                 // ICM hashes the image by DMA; no relay moves before it matches
+    EventBus_Init();                 // before anything subscribes or publishes
+    Cache_Init();                    // CMCC hit counter; hot path locked with CACHE_LOCK_ENABLE
+    Pool_Init();                     // fixed-block pools for transient objects
+    Fpu_Init();                      // FP use outside declared tasks reported, fpu.h
+    StackGuard_Init();               // MPU guard below the running task's stack, stackguard.h
+    Idle_Init();                     // idle task sleeps (WFI), timed on the show clock
+    Tickless_Init();                 // RTC wakes tickless sleeps; STANDBY if nothing vetoes
+    HrTimer_Init();                  // microsecond callbacks on the show clock's CC1
+    CpuFreq_Init();                  // CPU clock divided between frames with CPUFREQ_ENABLE
+    Mode_Init();                     // boot / idle / armed / scare / cooldown, vetoes standby
+    (void)Mode_OnChange(neo_mode_changed);
+#if RTOS_TRACE_ENABLE
+    RtosTrace_Init();                // scheduler event ring, stamped by DWT; before any task
+#endif
+    Rng_Init();                      // TRNG seed for every random draw below
+#if ESTOP_ENABLE
+    EStop_Init();                    // e-stop input to TCC1's fault in hardware, latched
+#endif
     Actuator_InitPorts();
-    NeoPixel_Init();
+    Stats_Init();                    // lifetime visitor counters from NVM
+    if (!Settings_Init())            // SmartEEPROM settings; CLI falls back to nvstore
+        LOG_WARN("settings: SmartEEPROM fuses not set, 'save' to keep parameters");
+    Wear_Init();                     // lifetime relay / scare counters, this boot counted
+    Dma_Init();                      // DMAC priority levels / QoS, before any client
+    (void)Crc_Init();                // DMAC CRC engine, checked on the CRC-32 check value
+    DmaMem_Init();                   // memory copies and fills on two BULK channels
+    StatusLed_Init();                // LED pattern from TCC3 + DMAC: boot blink, or the fault code
+    IoSeq_Init();                    // fog / strobe / knocker outputs off, TCC4 + DMAC sequencer
+    Servo_Init();                    // eyes / jaw servos on TCC0, limp until their first setpoint
+    RailMon_Init(neo_ambient_changed);   // 5 V / actuator rails and room light, ADC0 scanned by the DMAC
+    NeoPixel_SetBrightness(neo_brightness);  // global dimming, after gamma
+    FrameStat_Init(NEO_FRAME_US);    // interval / render / jitter histograms from the first frame
+    FpsCtl_Init(NEO_FRAME_US);       // frame divider and effect detail follow the render cost
+    Effects_SetBudget(NEO_FRAME_US); // scenes admitted by their effects' declared cycles
+    Palette_Init();                  // expand effect palettes to 256 entries
+    Fire_Init();                     // seeds its local generator from rng.h
+    Particles_Init();
+    uint32_t fx;
+    Effects_Init((Settings_Load(SETTINGS_KEY_EFFECT, &fx) && fx < EFFECT_COUNT)
+                 ? (effect_id_t)fx : EFFECT_DEFAULT);   // last one chosen, or running at a brown-out
+    (void)Resume_Init();             // after a watchdog / fault / brown-out reset: effects at their phase
+    Brownout_Init();                 // BOD33 warning: relays off, LEDs dark, state saved, reset
+    ShowCal_Init();                  // opening hours on the RTC: closed = parked, dark, standby
+    (void)ShowCal_OnChange(neo_show_hours);
+    (void)Cli_Register(&neo_brightness_param);
+#if KNOB_ENABLE
+    Knob_Init();                     // PDEC counts the encoder; a detent -> EVBUS_KNOB -> neo_knob_thread
+    neo_knob_sub = EventBus_Subscribe(EVBUS_MASK(EVBUS_KNOB));
+    (void)Coop_Add("knob", neo_knob_thread, NULL);
+#endif
+    Profile_Init();
+#if PROFILE_ENABLE
+    Math_Benchmark();                // cycles per call of the effect maths
+#endif
 
 #ifndef NDEBUG
-    printf("~~~DEBUG ENABLED~~~\n");
+    LOG_INFO("~~~DEBUG ENABLED~~~");
+#if NEO_BACKEND == NEO_BACKEND_SPI
+    if (NeoPixel_SelfTest() != 0u)
+        LOG_ERROR("neopixel: encoder self test FAILED");
+#endif
 #endif
 
     // 3. Create RTOS Tasks
+    Boot_Mark(BOOT_DRIVERS);
     
-    // Low priority system heartbeat
-    xTaskCreate(
-        Blinky_Task,              
-        "Blinky",                 
-        configMINIMAL_STACK_SIZE, 
-        NULL,                     
-        1,                        
-        NULL                      
-    );
-
-    // Medium priority logic controller
-    // Currently appears bugged as this will break blinky 
- 
-    xTaskCreate(
-        Actuator_Task,            // Implemented in actuator.c
-        "Actuator",               
-        512,                      // Increased stack for RNG and logic
-        NULL,                     
-        2,                        
-        NULL                      
-    );
+    // ISR follow-up work, run in order at the top priority with the timer task (defer.h)
+    if (!Defer_Start())
+        LOG_ERROR("defer: task not created");
+
+    // The small low priority behaviours on one stack (coop.h)
+    if (!Coop_Start())
+        LOG_ERROR("coop: task not created");
+
+    // Logic controller: a software timer, no task of its own; its steps run
+    // in the timer service task, the highest priority (configTIMER_TASK_PRIORITY)
+    Actuator_Start();
+
+    // Visitor walks up / leaves: D-SUN edges -> EIC ISR -> actuator sequence + pacing
+    dsun_sensor_init();
+    dsun_edge_enable(Actuator_PresenceFromISR);
+
+    // How far away they are: VL53L1X on the I2C bus, GPIO1 on PA15 -> ToF task -> EVBUS_DISTANCE
+    Tof_Start();
+
+    // Console input by interrupt: readers sleep until a whole line is in
+    if (!STDIO_RxStart())
+        LOG_ERROR("stdio: RX stream not created");
+
+    // Microphone -> ADC1 by event, DMA ping-pong, FFT bands + beats for the "audio" effect
+    Audio_Start();
+
+    // QSPI flash mapped at 0x04000000; its asset table registers the sound clips it holds
+#if QFLASH_ENABLE
+    if (!QFlash_Init())
+        LOG_ERROR("qflash: no chip answered");
+    else if (Assets_Init() == 0u)
+        LOG_ERROR("assets: no table in flash");
+
+    // Fixed-block SRAM copies of the clips cues are about to play, LRU; loads the built-in ones
+    AssetCache_Start();
+
+    // Effect plug-ins from the table into SRAM, CRC-checked, once the first frame is out (plugin.h)
+    (void)Boot_Defer("plugins", neo_load_plugins);
+#endif
+
+    // SD card on SDHC0 (same pins as the QSPI flash); the Stream task brings it up and reads ahead
+    SdCard_Init();
+    Stream_Start();
+
+    // CAN FD show sync (PB14/PB15): shared show time and cues with the other props; registers node
+    ShowSync_Start();
+
+    // DMX512 from a lighting console on PA04 (SERCOM0 + DMA) into EFFECT_DMX; registers dmx_addr/dmx_group
+    Dmx_Start();
+
+    // Pixel link to the slave boards, or from the master (SERCOM4 PB12/PB13 + DMA); a slave registers pd_board
+    PixDist_Start();
+
+    // sACN / Art-Net universes and a shell from a network co-processor (SERCOM3 PA22/PA23 + DMA)
+    // into EFFECT_NET; registers net_univ/net_addr/net_group, before Cli_Start for CLI-NET
+    NetBridge_Start();
+
+    // USB CDC port (PA24/PA25, DFLL on the host's SOF): a second shell, telemetry and frame capture
+    UsbCdc_Start();
+
+    // Sound effects: TCC2-paced DMA into DAC1 (PA05), cued by ACT_SOUND() steps; registers volume
+    Sound_Start();
+
+    // Per-task CPU share once a second from the run-time counters, for "top" and telem
+    if (!CpuLoad_Start())
+        LOG_ERROR("cpuload: timer not created");
+
+    // Just above idle: nvstore saves posted by the timer task, written between frames
+    if (!NvWrite_Start())
+        LOG_ERROR("nvwrite: task not created, saves made on the spot");
+
+    // Stack high-water marks every few seconds, for "stack" and telem
+    if (!StackMon_Start())
+        LOG_ERROR("stackmon: timer not created");
+
+    // Binary counters and task load for a host dashboard; registers telem_hz
+    if (!Telem_Start())
+        LOG_ERROR("telem: task not created");
+
+    // Console shell: live tuning of every registered parameter, saved values loaded now
+    if (!Cli_Start())
+        LOG_ERROR("cli: task not created");
+
+#if TLOG_ENABLE
+    // Just above idle: tokenized records -> COBS frames on the console
+    if (!Tlog_Start())
+        LOG_ERROR("tlog: drain task not created");
+#endif
+
+#if STATUS_LCD_ENABLE
+    // Idle priority: fps / render / duty / heap on the I2C LCD
+    if (!Status_Start())
+        LOG_ERROR("status: LCD tasks not created");
+#endif
+
+    // Hardware watchdog, fed while every registered task checks in; its early
+    // warning records the one that missed and resets (fault.h)
+    if (!Watchdog_Start())
+        LOG_ERROR("watchdog: timer not created");
+
+    // Below the render task: what SYS_Initialize() left out, once the first frame is out
+    if (!Boot_Start())
+        LOG_ERROR("boot: Init task not created, deferred inits ran now");
 
     // High priority visual updates (Keeps animations smooth)
-    xTaskCreate(
+    // The render task is the one FPU user: float / CMSIS-DSP effects run here
+    Fpu_TaskUses(xTaskCreateStatic(
         NeoPixel_Task,            
         "NeoPixel",               
-        512,                      // Increased stack for NeoPixel array buffering
+        NEOPIXEL_STACK,
         NULL,                     
         3,                        
-        NULL                      
-    );
+        neopixel_stack,
+        &neopixel_tcb
+    ));
 
     // 4. Hand control to the FreeRTOS Scheduler
     // Execution context shifts here. The bare-metal while(1) loop is gone.
+    Boot_Mark(BOOT_SCHEDULER);
     vTaskStartScheduler();
 
-    // 5. Code below this line never executes unless heap memory allocation fails.
+    // 5. Code below this line never executes (idle and timer tasks are static too).
     while (1) {}
     
     return 0;
@@ -0,0 +1,212 @@
+/* =============================================================================
+ * matrix.c  -  2D LED matrix mapping over the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "matrix.h"
+#include "fastmath.h"
+
+/* -- Layout tables ----------------------------------------------------------- */
+
+#define MX_W                MATRIX_WIDTH
+#define MX_H                MATRIX_HEIGHT
+
+/* Tables are padded to whole 64-entry blocks so the preprocessor can build them */
+#define MX_LUT_SIZE         ((MATRIX_LEDS + 63u) / 64u * 64u)
+
+#if MATRIX_LAYOUT == MATRIX_ROWS
+#define MX_OFFSET(x, y)     ((y) * MX_W + (x))
+#define MX_X(j)             ((j) % MX_W)
+#define MX_Y(j)             ((j) / MX_W)
+#elif MATRIX_LAYOUT == MATRIX_ROWS_SERPENTINE
+#define MX_OFFSET(x, y)     ((y) * MX_W + (((y) & 1u) ? (MX_W - 1u - (x)) : (x)))
+#define MX_X(j)             ((((j) / MX_W) & 1u) ? (MX_W - 1u - (j) % MX_W) : ((j) % MX_W))
+#define MX_Y(j)             ((j) / MX_W)
+#elif MATRIX_LAYOUT == MATRIX_COLUMNS
+#define MX_OFFSET(x, y)     ((x) * MX_H + (y))
+#define MX_X(j)             ((j) / MX_H)
+#define MX_Y(j)             ((j) % MX_H)
+#elif MATRIX_LAYOUT == MATRIX_COLUMNS_SERPENTINE
+#define MX_OFFSET(x, y)     ((x) * MX_H + (((x) & 1u) ? (MX_H - 1u - (y)) : (y)))
+#define MX_X(j)             ((j) / MX_H)
+#define MX_Y(j)             ((((j) / MX_H) & 1u) ? (MX_H - 1u - (j) % MX_H) : ((j) % MX_H))
+#else
+#error "Unknown MATRIX_LAYOUT"
+#endif
+
+/* Entry k of (x, y) -> offset, k = y * width + x; and of offset -> (y << 8 | x) */
+#define MX_XY_E(k)          ((uint16_t)(((k) < MATRIX_LEDS) ? MX_OFFSET((k) % MX_W, (k) / MX_W) : 0u))
+#define MX_POS_E(j)         ((uint16_t)(((j) < MATRIX_LEDS) ? ((MX_Y(j) << 8) | MX_X(j)) : 0u))
+
+#define MX_4(E, k)          E(k), E((k) + 1u), E((k) + 2u), E((k) + 3u)
+#define MX_16(E, k)         MX_4(E, k), MX_4(E, (k) + 4u), MX_4(E, (k) + 8u), MX_4(E, (k) + 12u)
+#define MX_64(E, k)         MX_16(E, k), MX_16(E, (k) + 16u), MX_16(E, (k) + 32u), MX_16(E, (k) + 48u)
+
+const uint16_t matrix_xy_lut[MX_LUT_SIZE] =
+{
+    MX_64(MX_XY_E, 0u),
+#if MATRIX_LEDS > 64u
+    MX_64(MX_XY_E, 64u),
+#endif
+#if MATRIX_LEDS > 128u
+    MX_64(MX_XY_E, 128u),
+#endif
+#if MATRIX_LEDS > 192u
+    MX_64(MX_XY_E, 192u),
+#endif
+#if MATRIX_LEDS > 256u
+    MX_64(MX_XY_E, 256u),
+#endif
+#if MATRIX_LEDS > 320u
+    MX_64(MX_XY_E, 320u),
+#endif
+#if MATRIX_LEDS > 384u
+    MX_64(MX_XY_E, 384u),
+#endif
+#if MATRIX_LEDS > 448u
+    MX_64(MX_XY_E, 448u),
+#endif
+#if MATRIX_LEDS > 512u
+    MX_64(MX_XY_E, 512u),
+#endif
+#if MATRIX_LEDS > 576u
+    MX_64(MX_XY_E, 576u),
+#endif
+#if MATRIX_LEDS > 640u
+    MX_64(MX_XY_E, 640u),
+#endif
+#if MATRIX_LEDS > 704u
+    MX_64(MX_XY_E, 704u),
+#endif
+#if MATRIX_LEDS > 768u
+    MX_64(MX_XY_E, 768u),
+#endif
+#if MATRIX_LEDS > 832u
+    MX_64(MX_XY_E, 832u),
+#endif
+#if MATRIX_LEDS > 896u
+    MX_64(MX_XY_E, 896u),
+#endif
+#if MATRIX_LEDS > 960u
+    MX_64(MX_XY_E, 960u),
+#endif
+};
+
+/* Wiring order -> (y << 8 | x), walked by the 2D kernels */
+static const uint16_t matrix_pos_lut[MX_LUT_SIZE] =
+{
+    MX_64(MX_POS_E, 0u),
+#if MATRIX_LEDS > 64u
+    MX_64(MX_POS_E, 64u),
+#endif
+#if MATRIX_LEDS > 128u
+    MX_64(MX_POS_E, 128u),
+#endif
+#if MATRIX_LEDS > 192u
+    MX_64(MX_POS_E, 192u),
+#endif
+#if MATRIX_LEDS > 256u
+    MX_64(MX_POS_E, 256u),
+#endif
+#if MATRIX_LEDS > 320u
+    MX_64(MX_POS_E, 320u),
+#endif
+#if MATRIX_LEDS > 384u
+    MX_64(MX_POS_E, 384u),
+#endif
+#if MATRIX_LEDS > 448u
+    MX_64(MX_POS_E, 448u),
+#endif
+#if MATRIX_LEDS > 512u
+    MX_64(MX_POS_E, 512u),
+#endif
+#if MATRIX_LEDS > 576u
+    MX_64(MX_POS_E, 576u),
+#endif
+#if MATRIX_LEDS > 640u
+    MX_64(MX_POS_E, 640u),
+#endif
+#if MATRIX_LEDS > 704u
+    MX_64(MX_POS_E, 704u),
+#endif
+#if MATRIX_LEDS > 768u
+    MX_64(MX_POS_E, 768u),
+#endif
+#if MATRIX_LEDS > 832u
+    MX_64(MX_POS_E, 832u),
+#endif
+#if MATRIX_LEDS > 896u
+    MX_64(MX_POS_E, 896u),
+#endif
+#if MATRIX_LEDS > 960u
+    MX_64(MX_POS_E, 960u),
+#endif
+};
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Matrix_Set(pix_t *strip, int16_t x, int16_t y, pix_t colour)
+{
+    if (x < 0 || y < 0 || x >= (int16_t)MATRIX_WIDTH || y >= (int16_t)MATRIX_HEIGHT) return;
+
+    strip[Matrix_XY((uint8_t)x, (uint8_t)y)] = colour;
+}
+
+void Matrix_Render(pix_t *strip, matrix_pixel_fn fn, uint8_t offset)
+{
+    pix_t *px = &strip[MATRIX_FIRST_LED];
+
+    for (uint16_t j = 0; j < MATRIX_LEDS; j++)
+    {
+        uint16_t pos = matrix_pos_lut[j];
+
+        px[j] = fn((uint8_t)pos, (uint8_t)(pos >> 8), offset);
+    }
+}
+
+void Matrix_FillRect(pix_t *strip, uint8_t x0, uint8_t y0, uint8_t w, uint8_t h, pix_t colour)
+{
+    if (x0 >= MATRIX_WIDTH || y0 >= MATRIX_HEIGHT) return;
+    if (w > MATRIX_WIDTH - x0)  w = (uint8_t)(MATRIX_WIDTH - x0);
+    if (h > MATRIX_HEIGHT - y0) h = (uint8_t)(MATRIX_HEIGHT - y0);
+    if (w == 0u || h == 0u) return;
+
+    /* One contiguous strip run per wired row (or column), in wiring order */
+#if (MATRIX_LAYOUT == MATRIX_ROWS) || (MATRIX_LAYOUT == MATRIX_ROWS_SERPENTINE)
+    for (uint8_t y = y0; y < y0 + h; y++)
+    {
+        uint16_t a = Matrix_XY(x0, y);
+        uint16_t b = Matrix_XY((uint8_t)(x0 + w - 1u), y);
+
+        Pix_Fill(&strip[(a < b) ? a : b], w, colour);
+    }
+#else
+    for (uint8_t x = x0; x < x0 + w; x++)
+    {
+        uint16_t a = Matrix_XY(x, y0);
+        uint16_t b = Matrix_XY(x, (uint8_t)(y0 + h - 1u));
+
+        Pix_Fill(&strip[(a < b) ? a : b], h, colour);
+    }
+#endif
+}
+
+void Matrix_Blend(pix_t *dst, const pix_t *src, uint16_t t)
+{
+    Pix_BlendStrip(&dst[MATRIX_FIRST_LED], &src[MATRIX_FIRST_LED], MATRIX_LEDS, t);
+}
+
+void Matrix_Noise(pix_t *strip, palette_id_t pal, uint16_t scale,
+                  uint16_t shift_x, uint16_t shift_y, uint8_t z)
+{
+    pix_t *px = &strip[MATRIX_FIRST_LED];
+
+    for (uint16_t j = 0; j < MATRIX_LEDS; j++)
+    {
+        uint16_t pos = matrix_pos_lut[j];
+        uint16_t u   = (uint16_t)((uint8_t)pos * scale + shift_x);          /* 8.8 cells */
+        uint16_t v   = (uint16_t)((uint8_t)(pos >> 8) * scale + shift_y);
+
+        px[j] = Palette_Lookup(pal, Math_ValueNoise8_2D(u, v, z));
+    }
+}
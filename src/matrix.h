@@ -0,0 +1,85 @@
+/* =============================================================================
+ * matrix.h  -  2D LED matrix mapping over the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A MATRIX_WIDTH x MATRIX_HEIGHT panel is wired as one run of the strip from
+ * LED MATRIX_FIRST_LED on, in one of four layouts:
+ *
+ *   MATRIX_ROWS                 every row left to right
+ *   MATRIX_ROWS_SERPENTINE      odd rows right to left
+ *   MATRIX_COLUMNS              every column top to bottom
+ *   MATRIX_COLUMNS_SERPENTINE   odd columns bottom to top
+ *
+ * The preprocessor builds two flash tables from the layout: (x, y) ->
+ * strip index for random access through Matrix_XY(), and strip order ->
+ * (x, y) so the 2D kernels below can walk the panel in wiring order and
+ * write the strip buffer front to back, with no serpentine test or divide
+ * per pixel. Coordinates are 0-based from the top left.
+ * ============================================================================= */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stdint.h>
+#include "pixmath.h"
+#include "palette.h"
+#include "neopixel.h"
+
+#define MATRIX_ROWS                 0
+#define MATRIX_ROWS_SERPENTINE      1
+#define MATRIX_COLUMNS              2
+#define MATRIX_COLUMNS_SERPENTINE   3
+
+/* -- User configuration ------------------------------------------------------ */
+#define MATRIX_WIDTH        16u         /* columns, 1..255                       */
+#define MATRIX_HEIGHT       8u          /* rows, 1..255                          */
+#define MATRIX_FIRST_LED    0u          /* strip index of the first matrix LED   */
+#define MATRIX_LAYOUT       MATRIX_ROWS_SERPENTINE
+
+#define MATRIX_LEDS         (MATRIX_WIDTH * MATRIX_HEIGHT)
+
+#if (MATRIX_WIDTH < 1u) || (MATRIX_WIDTH > 255u) || (MATRIX_HEIGHT < 1u) || (MATRIX_HEIGHT > 255u)
+#error "MATRIX_WIDTH and MATRIX_HEIGHT must be 1..255"
+#endif
+#if MATRIX_FIRST_LED + MATRIX_LEDS > NUM_LEDS
+#error "The matrix must fit in the strip: MATRIX_FIRST_LED + MATRIX_LEDS <= NUM_LEDS"
+#endif
+#if MATRIX_LEDS > 1024u
+#error "Matrix tables are generated for up to 1024 LEDs"
+#endif
+
+/* (x, y) -> offset from MATRIX_FIRST_LED, row-major; use Matrix_XY() */
+extern const uint16_t matrix_xy_lut[];
+
+/** Strip index of (x, y); x < MATRIX_WIDTH and y < MATRIX_HEIGHT are not checked. */
+static inline uint16_t Matrix_XY(uint8_t x, uint8_t y)
+{
+    return (uint16_t)(MATRIX_FIRST_LED + matrix_xy_lut[(uint32_t)y * MATRIX_WIDTH + x]);
+}
+
+/** Set (x, y) in a strip buffer; points off the panel are dropped. */
+void Matrix_Set(pix_t *strip, int16_t x, int16_t y, pix_t colour);
+
+/* -- 2D kernels (strip = NUM_LEDS buffer; only the matrix span is written) -- */
+
+/** 2D per-pixel kernel: colour of (x, y) at the given phase. */
+typedef pix_t (*matrix_pixel_fn)(uint8_t x, uint8_t y, uint8_t offset);
+
+/** Render fn over the whole panel, in wiring order. */
+void Matrix_Render(pix_t *strip, matrix_pixel_fn fn, uint8_t offset);
+
+/** Fill the w x h rectangle at (x0, y0), clipped to the panel. */
+void Matrix_FillRect(pix_t *strip, uint8_t x0, uint8_t y0, uint8_t w, uint8_t h, pix_t colour);
+
+/** Panel of dst -> panel of src by t / 256 (t = 0..256). */
+void Matrix_Blend(pix_t *dst, const pix_t *src, uint16_t t);
+
+/**
+ * 2D value noise through a palette. scale is the lattice step in 1/256 cells
+ * per LED (e.g. 48 = about 5 LEDs per cell); shift_x / shift_y / z move the
+ * field (8.8 cells) and step through time.
+ */
+void Matrix_Noise(pix_t *strip, palette_id_t pal, uint16_t scale,
+                  uint16_t shift_x, uint16_t shift_y, uint8_t z);
+
+#endif /* MATRIX_H */
@@ -0,0 +1,80 @@
+/* =============================================================================
+ * memstat.c  -  Where the RAM goes, measured: heap, pools, stacks, sections
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "memstat.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "pool.h"
+#include "stackmon.h"
+#include "ramfunc.h"
+#include "cache.h"
+#include "dmaram.h"
+
+/* Linker script (ATSAME51J20A.ld) and XC32 */
+extern const uint8_t __ram_start[];
+extern const uint8_t __ram_end[];
+extern const uint8_t _stack[];              /* top of the main stack, above every static */
+extern const uint8_t __bkupram_used_start[];
+extern const uint8_t __bkupram_used_end[];
+
+/* -- Public API implementation ----------------------------------------------- */
+
+uint32_t MemStat_HeapMin(void)
+{
+    return (uint32_t)xPortGetFreeHeapSize();    /* heap_1: only ever shrinks */
+}
+
+uint32_t MemStat_PoolPeak(void)
+{
+    pool_stats_t s;
+    uint32_t     peak = 0u;
+
+    for (uint32_t c = 0; Pool_GetStats(c, &s); c++)
+        peak += (uint32_t)s.peak * s.size;
+    return peak;
+}
+
+uint32_t MemStat_RamFree(void)
+{
+    return (uint32_t)(__ram_end - _stack);
+}
+
+void MemStat_Read(memstat_t *out)
+{
+    static stackmon_report_t r;     /* one caller at a time: the console */
+    pool_stats_t s;
+
+    out->heap_size = (uint32_t)configTOTAL_HEAP_SIZE;
+    out->heap_free = (uint32_t)xPortGetFreeHeapSize();
+    out->heap_min  = MemStat_HeapMin();
+
+    out->pool_bytes = out->pool_used = out->pool_peak = 0u;
+    for (uint32_t c = 0; Pool_GetStats(c, &s); c++)
+    {
+        out->pool_bytes += (uint32_t)s.count * s.size;
+        out->pool_used  += (uint32_t)s.used  * s.size;
+        out->pool_peak  += (uint32_t)s.peak  * s.size;
+    }
+    out->pool_fails = Pool_Fails();
+
+    StackMon_Read(&r);
+    out->tasks       = r.count;
+    out->stack_words = out->stack_used = 0u;
+    for (uint32_t i = 0; i < r.count; i++)
+    {
+        out->stack_words += r.task[i].size;
+        out->stack_used  += r.task[i].used;
+    }
+    out->stack_min_free = StackMon_MinFree();
+
+    out->ram_size   = (uint32_t)(__ram_end - __ram_start);
+    out->ram_static = (uint32_t)(_stack - __ram_start);
+    out->ram_free   = MemStat_RamFree();
+    out->dma_size   = DmaRam_Size();
+    out->dma_used   = DmaRam_Used();
+    out->ramfunc    = Ramfunc_Bytes();
+    out->cache_hot  = Cache_HotBytes();
+    out->bkupram    = (uint32_t)(__bkupram_used_end - __bkupram_used_start);
+}
@@ -0,0 +1,72 @@
+/* =============================================================================
+ * memstat.h  -  Where the RAM goes, measured: heap, pools, stacks, sections
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * One report of everything the firmware allocates, for sizing the strip
+ * and the asset caches against real numbers:
+ *
+ *   heap       configTOTAL_HEAP_SIZE, free now and the low-water mark.
+ *              heap_1 never frees, so its free size is its low-water mark
+ *              (it has no xPortGetMinimumEverFreeHeapSize()).
+ *   pools      bytes in the pool classes (pool.h): all, in use, the sum
+ *              of the class peaks, and failed allocations
+ *   stacks     the task stacks stackmon.h sampled last: words given,
+ *              peak words used, the smallest headroom
+ *   sections   from linker symbols: RAM below _stack (the .data and .bss
+ *              the XC32 best-fit allocator packs from the bottom, and the
+ *              main stack reservation), RAM above it up to ram_dma,
+ *              ram_dma (dmaram.h) in use, .ramfunc, the CACHE_HOT code,
+ *              backup RAM in use
+ *
+ * "mem" on the console prints it; telemetry carries heap_min, pool_peak_b
+ * and ram_free. The per-module split of the static sections is
+ * tools/membudget.py's, from the map file.
+ *
+ * A failed pvPortMalloc() no longer hangs: vApplicationMallocFailedHook()
+ * records a FAULT_MALLOC with the caller's trace and resets (fault.h).
+ * ============================================================================= */
+
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t heap_size;         /* bytes, configTOTAL_HEAP_SIZE */
+    uint32_t heap_free;
+    uint32_t heap_min;
+
+    uint32_t pool_bytes;        /* every block of every class */
+    uint32_t pool_used;         /* bytes handed out now */
+    uint32_t pool_peak;         /* sum of the class peaks */
+    uint32_t pool_fails;
+
+    uint32_t tasks;             /* 0 before stackmon's first sample */
+    uint32_t stack_words;       /* given to the tasks */
+    uint32_t stack_used;        /* peak words, summed */
+    uint32_t stack_min_free;    /* words, the tightest task */
+
+    uint32_t ram_size;          /* the ram region, without ram_dma and the RTT block */
+    uint32_t ram_static;        /* below _stack: .data, .bss, main stack */
+    uint32_t ram_free;          /* above _stack */
+    uint32_t dma_size;          /* ram_dma, the DMA buffers */
+    uint32_t dma_used;          /* of it in use */
+    uint32_t ramfunc;           /* SRAM code, part of ram_static */
+    uint32_t cache_hot;         /* CACHE_HOT code in flash */
+    uint32_t bkupram;           /* backup RAM in use */
+} memstat_t;
+
+/** The heap's low-water mark, bytes. Any task or ISR. */
+uint32_t MemStat_HeapMin(void);
+
+/** Bytes of pool blocks ever in use at once per class, summed. Any task. */
+uint32_t MemStat_PoolPeak(void);
+
+/** RAM above _stack, bytes. Any task. */
+uint32_t MemStat_RamFree(void);
+
+/** The whole report. Any task. */
+void MemStat_Read(memstat_t *out);
+
+#endif /* MEMSTAT_H */
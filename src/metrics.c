@@ -0,0 +1,106 @@
+/* =============================================================================
+ * metrics.c  -  Lock-free runtime metrics snapshot for status displays
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "metrics.h"
+#include "definitions.h"        /* core_cm4.h: DWT, CoreDebug, __DMB */
+#include "FreeRTOS.h"
+#include "memstat.h"
+#include <string.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* One writer per group: buf[seq & 1] is the published copy */
+typedef struct
+{
+    volatile uint32_t seq;
+    metrics_neo_t     buf[2];
+} metrics_neo_slot_t;
+
+typedef struct
+{
+    volatile uint32_t seq;
+    metrics_act_t     buf[2];
+} metrics_act_slot_t;
+
+typedef struct
+{
+    volatile uint32_t seq;
+    metrics_cpu_t     buf[2];
+} metrics_cpu_slot_t;
+
+typedef struct
+{
+    volatile uint32_t seq;
+    metrics_tasks_t   buf[2];
+} metrics_tasks_slot_t;
+
+static metrics_neo_slot_t   metrics_neo;
+static metrics_act_slot_t   metrics_act;
+static metrics_cpu_slot_t   metrics_cpu;
+static metrics_tasks_slot_t metrics_tasks;
+
+/* Fill the hidden copy, then flip; the barrier orders data before the flip */
+#define METRICS_PUBLISH(slot, m)                        \
+    do {                                                \
+        uint32_t s_ = (slot).seq;                       \
+        (slot).buf[(s_ + 1u) & 1u] = *(m);              \
+        __DMB();                                        \
+        (slot).seq = s_ + 1u;                           \
+    } while (0)
+
+/* Copy the published copy; retry if the writer flipped meanwhile (it may
+ * then be refilling the very copy we read) */
+#define METRICS_READ(slot, out)                         \
+    do {                                                \
+        uint32_t s_;                                    \
+        do {                                            \
+            s_ = (slot).seq;                            \
+            __DMB();                                    \
+            (out) = (slot).buf[s_ & 1u];                \
+            __DMB();                                    \
+        } while ((slot).seq != s_);                     \
+    } while (0)
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Metrics_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+    memset(&metrics_neo, 0, sizeof(metrics_neo));
+    memset(&metrics_act, 0, sizeof(metrics_act));
+    memset(&metrics_cpu, 0, sizeof(metrics_cpu));
+    memset(&metrics_tasks, 0, sizeof(metrics_tasks));
+}
+
+void Metrics_PublishNeo(const metrics_neo_t *m)
+{
+    METRICS_PUBLISH(metrics_neo, m);
+}
+
+void Metrics_PublishAct(const metrics_act_t *m)
+{
+    METRICS_PUBLISH(metrics_act, m);
+}
+
+void Metrics_PublishCpu(const metrics_cpu_t *m, const metrics_tasks_t *tasks)
+{
+    METRICS_PUBLISH(metrics_tasks, tasks);
+    METRICS_PUBLISH(metrics_cpu, m);
+}
+
+void Metrics_Read(metrics_t *out)
+{
+    METRICS_READ(metrics_neo, out->neo);
+    METRICS_READ(metrics_act, out->act);
+    METRICS_READ(metrics_cpu, out->cpu);
+    out->heap_free = (uint32_t)xPortGetFreeHeapSize();
+    out->heap_min  = MemStat_HeapMin();      /* heap_1 has no minimum-ever call */
+}
+
+void Metrics_ReadTasks(metrics_tasks_t *out)
+{
+    METRICS_READ(metrics_tasks, *out);
+}
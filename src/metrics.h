@@ -0,0 +1,98 @@
+/* =============================================================================
+ * metrics.h  -  Lock-free runtime metrics snapshot for status displays
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Each subsystem owns one group of figures and is its only writer: the
+ * NeoPixel task publishes frame rate and render cycles once a second, the
+ * actuator (timer service task) publishes duty and trigger times at every
+ * relay change, cpuload.c (timer service task) the CPU share of every task
+ * once a second. A group is double buffered: the writer fills the copy
+ * readers are not looking at, then bumps the group's sequence counter to
+ * flip it. Writers never wait, take no lock and never mask interrupts;
+ * a reader that raced with a flip simply copies again.
+ *
+ * So a display or logging task can read everything as often as it likes
+ * without adding a cycle of jitter to the tasks it is watching.
+ * ============================================================================= */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/* NeoPixel task, published once per METRICS_NEO_MS */
+typedef struct
+{
+    uint16_t fps_q4;            /* frames per second, Q4          */
+    uint32_t render_cycles;     /* average Effects_Render() cycles */
+    uint32_t frames;            /* since boot                      */
+    uint32_t missed;            /* renders that overran their slot */
+    uint32_t dropped;           /* slots skipped to catch up       */
+    uint32_t cache_hits;        /* CMCC instruction hits, this window (cache.h) */
+} metrics_neo_t;
+
+/* Actuator, lid channel, published at every relay change */
+typedef struct
+{
+    uint16_t duty_pct;          /* energised share of the duty window */
+    uint32_t triggers;          /* sequences started since boot       */
+    uint32_t last_trigger_ms;   /* tick time of the latest, 0 = none  */
+} metrics_act_t;
+
+/* CPU load, published once per CPULOAD_PERIOD_MS, all in permille */
+typedef struct
+{
+    uint16_t busy_pm;           /* everything but the idle task, last period */
+    uint16_t idle_pm;
+    uint16_t peak_pm;           /* highest busy_pm of the rolling window     */
+    uint32_t period_ms;         /* length of the last period                 */
+} metrics_cpu_t;
+
+/* Per-task share of the same period; a separate group, Metrics_ReadTasks() */
+#define METRICS_MAX_TASKS   12u
+#define METRICS_TASK_NAME   16u         /* configMAX_TASK_NAME_LEN */
+
+typedef struct
+{
+    char     name[METRICS_TASK_NAME];
+    uint16_t pm;
+    uint16_t stack_free;        /* words, high-water mark */
+} metrics_task_load_t;
+
+typedef struct
+{
+    uint32_t            count;
+    metrics_task_load_t task[METRICS_MAX_TASKS];
+} metrics_tasks_t;
+
+typedef struct
+{
+    metrics_neo_t neo;
+    metrics_act_t act;
+    metrics_cpu_t cpu;
+    uint32_t      heap_free;    /* bytes, read at Metrics_Read() */
+    uint32_t      heap_min;     /* low-water mark since boot     */
+} metrics_t;
+
+/* -- User configuration ------------------------------------------------------ */
+#define METRICS_NEO_MS      1000u
+
+/** Enable the DWT cycle counter for the render timing. Before the scheduler. */
+void Metrics_Init(void);
+
+/** Publish a new NeoPixel group. Only from the NeoPixel task. */
+void Metrics_PublishNeo(const metrics_neo_t *m);
+
+/** Publish a new actuator group. Only from the timer service task. */
+void Metrics_PublishAct(const metrics_act_t *m);
+
+/** Publish a new CPU group and the task table. Only from cpuload.c. */
+void Metrics_PublishCpu(const metrics_cpu_t *m, const metrics_tasks_t *tasks);
+
+/** Consistent copy of every group. Any task; never blocks a writer. */
+void Metrics_Read(metrics_t *out);
+
+/** Consistent copy of the task table (too big for metrics_t). Any task. */
+void Metrics_ReadTasks(metrics_tasks_t *out);
+
+#endif /* METRICS_H */
@@ -0,0 +1,144 @@
+/* =============================================================================
+ * mode.c  -  Prop mode: boot, idle, armed, scare, cooldown
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "mode.h"
+#include "task.h"
+#include "timers.h"
+#include "event_groups.h"
+#include "tickless.h"
+#include "log.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Written by the timer service task only: every transition runs there */
+static volatile mode_id_t mode_cur = MODE_BOOT;
+static bool               mode_present;
+static uint32_t           mode_changes;
+
+static mode_hook_fn       mode_hooks[MODE_MAX_HOOKS];
+static uint32_t           mode_nhooks;
+
+static EventGroupHandle_t mode_group;
+static StaticEventGroup_t mode_group_buf;
+static TimerHandle_t      mode_timer;           /* end of COOLDOWN */
+static StaticTimer_t      mode_timer_buf;
+
+static const char *const mode_names[MODE_COUNT] =
+{
+    "boot", "idle", "armed", "scare", "cooldown"
+};
+
+static void mode_set(mode_id_t to)
+{
+    mode_id_t from = mode_cur;
+
+    if (to == from) return;
+    mode_cur = to;
+    mode_changes++;
+
+    /* One bit at a time: a waiter never sees two modes, or wakes on none */
+    (void)xEventGroupClearBits(mode_group, MODE_BIT(from));
+    (void)xEventGroupSetBits(mode_group, MODE_BIT(to));
+
+    for (uint32_t i = 0; i < mode_nhooks; i++)
+        mode_hooks[i](from, to);
+    LOG_DEBUG("mode: %s -> %s", mode_names[from], mode_names[to]);
+}
+
+static mode_id_t mode_settled(void)
+{
+    return mode_present ? MODE_ARMED : MODE_IDLE;
+}
+
+static void mode_timer_cb(TimerHandle_t timer)
+{
+    (void)timer;
+    if (mode_cur == MODE_COOLDOWN) mode_set(mode_settled());
+}
+
+static void mode_ev_ready(void *unused, uint32_t arg)
+{
+    (void)unused;
+    (void)arg;
+    if (mode_cur == MODE_BOOT) mode_set(mode_settled());
+}
+
+/* STANDBY only with nobody there; ISR context */
+static bool mode_tickless_veto(void)
+{
+    return mode_cur != MODE_IDLE;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Mode_Init(void)
+{
+    mode_group = xEventGroupCreateStatic(&mode_group_buf);
+    (void)xEventGroupSetBits(mode_group, MODE_BIT(MODE_BOOT));
+    mode_timer = xTimerCreateStatic("Mode", 1u, pdFALSE, NULL, mode_timer_cb, &mode_timer_buf);
+    (void)Tickless_RegisterVeto(mode_tickless_veto);
+}
+
+bool Mode_OnChange(mode_hook_fn hook)
+{
+    if (mode_nhooks >= MODE_MAX_HOOKS) return false;
+    mode_hooks[mode_nhooks++] = hook;
+    return true;
+}
+
+void Mode_Ready(void)
+{
+    /* From the Init task: hand it to the timer task like every other transition */
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        (void)xTimerPendFunctionCall(mode_ev_ready, NULL, 0u, portMAX_DELAY);
+    else
+        mode_ev_ready(NULL, 0u);
+}
+
+void Mode_Presence(bool detected)
+{
+    mode_present = detected;
+    if (mode_cur == MODE_IDLE || mode_cur == MODE_ARMED) mode_set(mode_settled());
+}
+
+void Mode_Scare(void)
+{
+    (void)xTimerStop(mode_timer, 0u);
+    mode_set(MODE_SCARE);
+}
+
+void Mode_ScareOver(uint32_t cooldown_ms)
+{
+    TickType_t ticks = pdMS_TO_TICKS(cooldown_ms);
+
+    if (mode_cur != MODE_SCARE) return;
+    if (ticks == 0u || xTimerChangePeriod(mode_timer, ticks, 0u) != pdPASS)
+    {
+        mode_set(mode_settled());
+        return;
+    }
+    mode_set(MODE_COOLDOWN);
+}
+
+mode_id_t Mode_Get(void)
+{
+    return mode_cur;
+}
+
+const char *Mode_Name(mode_id_t m)
+{
+    return (m < MODE_COUNT) ? mode_names[m] : "?";
+}
+
+mode_id_t Mode_WaitChange(mode_id_t from, TickType_t ticks)
+{
+    (void)xEventGroupWaitBits(mode_group, MODE_ALL & ~MODE_BIT(from), pdFALSE, pdFALSE, ticks);
+    return mode_cur;
+}
+
+uint32_t Mode_Changes(void)
+{
+    return mode_changes;
+}
@@ -0,0 +1,89 @@
+/* =============================================================================
+ * mode.h  -  Prop mode: boot, idle, armed, scare, cooldown
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * One state for the whole prop, so the LEDs, the clock and the sleep
+ * policy can follow what the visitor sees without each watching the
+ * sensor and the lid themselves:
+ *
+ *   BOOT       until the deferred inits have run (boot.h)
+ *   IDLE       nobody in front of the sensor
+ *   ARMED      someone is there, no sequence playing
+ *   SCARE      a lid sequence is playing
+ *   COOLDOWN   the sequence is over; for the actuator "cooldown" time,
+ *              then ARMED or IDLE, whichever the sensor says
+ *
+ * The actuator drives it from its timer-task events (Mode_Presence(),
+ * Mode_Scare(), Mode_ScareOver()); nobody else sets a mode.
+ *
+ * Every mode is one bit of an event group, only the current one set:
+ * a task blocks in Mode_WaitChange() and wakes on the transition, with no
+ * poll. Modules without a task of their own (the effects queue, the clock
+ * holds) register a Mode_OnChange() hook instead. Every transition runs
+ * in the timer service task, Mode_Ready() is handed over to it, and so do
+ * the hooks: post or set, never block there.
+ *
+ * The mode itself vetoes STANDBY (tickless.h) outside IDLE: a visitor in
+ * front of the prop gets the lid at once, not after a wake from standby.
+ * ============================================================================= */
+
+#ifndef MODE_H
+#define MODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define MODE_MAX_HOOKS          4u
+
+typedef enum
+{
+    MODE_BOOT = 0,
+    MODE_IDLE,
+    MODE_ARMED,
+    MODE_SCARE,
+    MODE_COOLDOWN,
+    MODE_COUNT
+} mode_id_t;
+
+#define MODE_BIT(m)             (1u << (m))
+#define MODE_ALL                (MODE_BIT(MODE_COUNT) - 1u)
+
+/** Transition hook: from -> to, in the setter's task. Must not block. */
+typedef void (*mode_hook_fn)(mode_id_t from, mode_id_t to);
+
+/** Start in MODE_BOOT. After Tickless_Init(), before the scheduler. */
+void Mode_Init(void);
+
+/** Add a transition hook. Before the scheduler; false if the table is full. */
+bool Mode_OnChange(mode_hook_fn hook);
+
+/** BOOT -> IDLE, or ARMED if someone is already there. Any task, once. */
+void Mode_Ready(void);
+
+/** The sensor level changed: IDLE <-> ARMED; remembered in the others. Timer task. */
+void Mode_Presence(bool detected);
+
+/** A lid sequence starts: SCARE. Timer task. */
+void Mode_Scare(void);
+
+/** The lid sequence is over: COOLDOWN for `cooldown_ms`, then ARMED or IDLE. Timer task. */
+void Mode_ScareOver(uint32_t cooldown_ms);
+
+/** Current mode. Any context. */
+mode_id_t Mode_Get(void);
+
+/** "boot", "idle", ... */
+const char *Mode_Name(mode_id_t m);
+
+/**
+ * Block until the mode is no longer `from`, up to `ticks`; returns the
+ * mode then (still `from` on a timeout). Tasks only.
+ */
+mode_id_t Mode_WaitChange(mode_id_t from, TickType_t ticks);
+
+/** Transitions since boot. */
+uint32_t Mode_Changes(void);
+
+#endif /* MODE_H */
@@ -0,0 +1,280 @@
+/* =============================================================================
+ * motion.c  -  Fixed-point trapezoidal / S-curve move profiles, O(1) per tick
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include <string.h>
+#include "motion.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    motion_move_t    key;
+    motion_profile_t pf;
+    bool             used;
+} mo_slot_t;
+
+static mo_slot_t      mo_cache[MOTION_CACHE_SLOTS];
+static uint32_t       mo_next;                  /* slot to replace next */
+static motion_stats_t mo_stats;
+
+static uint64_t mo_cdiv(uint64_t a, uint64_t b)
+{
+    return (a + b - 1u) / b;
+}
+
+/* ceil(sqrt(x)) */
+static uint64_t mo_csqrt(uint64_t x)
+{
+    uint64_t r = 0u, y = x;
+
+    for (uint64_t b = 1ull << 62; b != 0u; b >>= 2)
+    {
+        if (y >= r + b)
+        {
+            y -= r + b;
+            r  = (r >> 1) + b;
+        }
+        else
+        {
+            r >>= 1;
+        }
+    }
+    return (r * r < x) ? r + 1u : r;
+}
+
+/* ceil(cbrt(x)), x < 2^60 */
+static uint64_t mo_ccbrt(uint64_t x)
+{
+    uint64_t lo = 0u, hi = 1u << 20;            /* (2^20)^3 = 2^60 */
+
+    while (lo < hi)
+    {
+        uint64_t mid = (lo + hi) >> 1;
+
+        if (mid * mid * mid < x) lo = mid + 1u;
+        else                     hi = mid;
+    }
+    return lo;
+}
+
+static bool mo_same(const motion_move_t *a, const motion_move_t *b)
+{
+    return a->dist == b->dist && a->v_max == b->v_max && a->a_max == b->a_max &&
+           a->jerk == b->jerk && a->tick_hz == b->tick_hz;
+}
+
+static void mo_seg(motion_profile_t *pf, uint64_t ticks, int64_t a0, int64_t j)
+{
+    if (ticks == 0u) return;
+    pf->seg[pf->segs].ticks = (uint32_t)ticks;
+    pf->seg[pf->segs].a0    = a0;
+    pf->seg[pf->segs].j     = j;
+    pf->segs++;
+    pf->ticks += (uint32_t)ticks;
+}
+
+/*
+ * Phase lengths in whole ticks from the limits (Q16 units per tick), each
+ * rounded up, then the jerk or acceleration that makes the distance come
+ * out exactly: D = a ta (ta + tv) for a trapezoid, D = j tj (tj + ta)
+ * (2 tj + ta + tv) for an S-curve.
+ */
+static bool mo_plan(const motion_move_t *m, motion_profile_t *pf)
+{
+    uint64_t hz = m->tick_hz;
+    uint64_t d, v, a, j, tj = 0u, ta, tv = 0u;
+    int64_t  s  = (m->dist < 0) ? -1 : 1;
+
+    memset(pf, 0, sizeof(*pf));
+    pf->dist = m->dist;
+    if (m->dist == 0) return true;
+    d = (uint64_t)((m->dist < 0) ? -(int64_t)m->dist : (int64_t)m->dist) << 16;
+
+    v = ((uint64_t)m->v_max << 16) / hz;
+    a = ((uint64_t)m->a_max << 16) / hz / hz;
+    j = (((uint64_t)m->jerk << 16) / hz) / hz / hz;
+    if (v == 0u || a == 0u || (m->jerk != 0u && j == 0u))
+        return false;                               /* below one Q16 unit per tick */
+
+    /* Never more than the whole move in one tick: keeps the products below in range */
+    if (v > d) v = d;
+    if (a > d) a = d;
+    if (j > d) j = d;
+
+    if (m->jerk == 0u)
+    {
+        ta = mo_cdiv(v, a);                         /* to full speed */
+        if (ta > MOTION_TICKS_MAX) return false;
+        if (ta <= d / v)
+            tv = mo_cdiv(d - v * ta, v);
+        else
+            ta = mo_csqrt(mo_cdiv(d, a));           /* no cruise: D = a ta^2 */
+        if (2u * ta + tv > MOTION_TICKS_MAX) return false;
+
+        int64_t acc = (int64_t)(((d >> 16) << 32) / (ta * (ta + tv)));
+
+        mo_seg(pf, ta, s * acc, 0);
+        mo_seg(pf, tv, 0, 0);
+        mo_seg(pf, ta, -s * acc, 0);
+        return true;
+    }
+
+    uint64_t apk;
+
+    tj = mo_cdiv(a, j);                             /* to full acceleration */
+    if (tj > MOTION_TICKS_MAX) return false;
+    if (v / j < tj * tj)
+    {
+        tj  = mo_csqrt(mo_cdiv(v, j));              /* full speed first */
+        ta  = 0u;
+        apk = j * tj;
+    }
+    else
+    {
+        ta  = mo_cdiv(v, a);
+        ta  = (ta > tj) ? ta - tj : 0u;
+        apk = a;
+    }
+    if (2u * tj + ta > MOTION_TICKS_MAX) return false;
+
+    if (2u * tj + ta <= d / v)
+    {
+        tv = mo_cdiv(d - v * (2u * tj + ta), v);
+    }
+    else if (d / apk < 2u * tj * tj)
+    {
+        ta = 0u;                                    /* D = 2 j tj^3 */
+        tj = mo_ccbrt(mo_cdiv(d, 2u * j));
+    }
+    else
+    {
+        uint64_t u = mo_cdiv(mo_csqrt(tj * tj + 4u * mo_cdiv(d, apk)) - tj, 2u);
+
+        ta = (u > tj) ? u - tj : 0u;                /* D = apk u (u + tj), u = tj + ta */
+    }
+    if (tj == 0u) tj = 1u;
+    if (4u * tj + 2u * ta + tv > MOTION_TICKS_MAX) return false;
+
+    int64_t jq = (int64_t)(((d >> 16) << 32) / (tj * (tj + ta) * (2u * tj + ta + tv)));
+    int64_t aq = jq * (int64_t)tj;
+
+    mo_seg(pf, tj, 0, s * jq);
+    mo_seg(pf, ta, s * aq, 0);
+    mo_seg(pf, tj, s * aq, -s * jq);
+    mo_seg(pf, tv, 0, 0);
+    mo_seg(pf, tj, 0, -s * jq);
+    mo_seg(pf, ta, -s * aq, 0);
+    mo_seg(pf, tj, -s * aq, s * jq);
+    return true;
+}
+
+static void mo_enter(motion_run_t *r)
+{
+    const motion_seg_t *sg = &r->pf->seg[r->seg];
+
+    r->left = sg->ticks;
+    r->a    = sg->a0;
+    r->j    = sg->j;
+    r->j2   = sg->j / 2;
+    r->j6   = sg->j / 6;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Motion_Plan(const motion_move_t *m, motion_profile_t *out)
+{
+    bool ok;
+
+    if (m->v_max == 0u || m->a_max == 0u || m->tick_hz == 0u ||
+        m->dist > MOTION_DIST_MAX || m->dist < -MOTION_DIST_MAX)
+    {
+        memset(out, 0, sizeof(*out));
+        taskENTER_CRITICAL();
+        mo_stats.refused++;
+        taskEXIT_CRITICAL();
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < MOTION_CACHE_SLOTS; i++)
+    {
+        if (mo_cache[i].used && mo_same(&mo_cache[i].key, m))
+        {
+            *out = mo_cache[i].pf;
+            mo_stats.hits++;
+            taskEXIT_CRITICAL();
+            return true;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    ok = mo_plan(m, out);                           /* outside: a few us of divisions */
+    taskENTER_CRITICAL();
+    if (ok)
+    {
+        mo_cache[mo_next].key  = *m;
+        mo_cache[mo_next].pf   = *out;
+        mo_cache[mo_next].used = true;
+        mo_next = (mo_next + 1u) % MOTION_CACHE_SLOTS;
+        mo_stats.plans++;
+    }
+    else
+    {
+        mo_stats.refused++;
+    }
+    taskEXIT_CRITICAL();
+    if (!ok) memset(out, 0, sizeof(*out));
+    return ok;
+}
+
+void Motion_Start(motion_run_t *r, const motion_profile_t *pf)
+{
+    memset(r, 0, sizeof(*r));
+    r->pf = pf;
+    if (pf->segs != 0u) mo_enter(r);
+}
+
+int32_t Motion_Tick(motion_run_t *r)
+{
+    if (r->left == 0u) return r->pf->dist;
+
+    /* The segment's cubic sampled exactly, one tick on */
+    r->p += r->v + (r->a >> 1) + r->j6;
+    r->v += r->a + r->j2;
+    r->a += r->j;
+    if (--r->left == 0u)
+    {
+        if (++r->seg < r->pf->segs)
+        {
+            mo_enter(r);
+        }
+        else
+        {
+            r->p = (int64_t)r->pf->dist << 32;      /* on the distance, not beside it */
+            r->v = 0;
+            r->a = 0;
+        }
+    }
+    return (int32_t)((r->p + (1ll << 31)) >> 32);
+}
+
+bool Motion_Done(const motion_run_t *r)
+{
+    return r->left == 0u;
+}
+
+int32_t Motion_Vel(const motion_run_t *r)
+{
+    return (int32_t)(r->v >> 16);
+}
+
+void Motion_GetStats(motion_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = mo_stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,115 @@
+/* =============================================================================
+ * motion.h  -  Fixed-point trapezoidal / S-curve move profiles, O(1) per tick
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A move is a distance in the caller's units (servo counts, steps, ...)
+ * with limits on speed, acceleration and, optionally, jerk, run at a
+ * fixed control rate. Motion_Plan() turns it into at most seven segments,
+ * each a number of ticks and a constant jerk:
+ *
+ *   jerk > 0    S-curve   +j, 0, -j | cruise | -j, 0, +j
+ *   jerk = 0    trapezoid  +a | cruise | -a
+ *
+ * (segments of no length left out), rest to rest. The phase lengths are
+ * whole ticks, rounded up from the limits, and the jerk (or, for a
+ * trapezoid, the acceleration) is then solved for so the move covers the
+ * distance exactly: rounding only ever lowers a peak, so no limit is
+ * exceeded. A move that is too short to reach its speed limit gets the
+ * shorter shape (no cruise, then no constant-acceleration phase).
+ *
+ * Motion_Start() / Motion_Tick() step a motion_run_t through the table
+ * with a handful of 64-bit adds per tick: the cubic between segment
+ * boundaries is sampled exactly by forward differences, position,
+ * velocity and acceleration in Q32 units, and the last tick lands on the
+ * distance. No division, square root or table look-up on the way.
+ *
+ * A plan is kept in a small cache keyed by the move (MOTION_CACHE_SLOTS,
+ * oldest out), so a sequence that makes the same move again, as a show
+ * loop does every pass, finds it planned. Planning itself is a few
+ * 64-bit divisions and a root; "motion" on the console plans a move and
+ * shows its table and the cache counters.
+ *
+ * Distances up to MOTION_DIST_MAX units and moves up to MOTION_TICKS_MAX
+ * ticks; Motion_Plan() refuses anything beyond, and limits finer than
+ * 1/65536 unit per tick (per tick^2, per tick^3): at 1 kHz, 15 units/s^2
+ * or 15,000 units/s^3.
+ * ============================================================================= */
+
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define MOTION_CACHE_SLOTS      8u      /* plans kept                                */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define MOTION_SEGS_MAX         7u
+#define MOTION_DIST_MAX         0x3FFFFFFFL             /* units, either way         */
+#define MOTION_TICKS_MAX        0x100000u               /* a move, ticks             */
+
+typedef struct
+{
+    int32_t  dist;              /* units, signed                             */
+    uint32_t v_max;             /* units/s, > 0                              */
+    uint32_t a_max;             /* units/s^2, > 0                            */
+    uint32_t jerk;              /* units/s^3, 0 = trapezoid                  */
+    uint32_t tick_hz;           /* control rate, > 0                         */
+} motion_move_t;
+
+typedef struct
+{
+    uint32_t ticks;
+    int64_t  a0;                /* acceleration at its start, Q32 units/tick^2 */
+    int64_t  j;                 /* jerk, Q32 units/tick^3                    */
+} motion_seg_t;
+
+typedef struct
+{
+    int32_t      dist;
+    uint32_t     ticks;         /* the whole move                            */
+    uint8_t      segs;
+    motion_seg_t seg[MOTION_SEGS_MAX];
+} motion_profile_t;
+
+/* A move under way; read through the functions below */
+typedef struct
+{
+    const motion_profile_t *pf;
+    uint32_t seg;
+    uint32_t left;              /* ticks of this segment                     */
+    int64_t  p, v, a;           /* Q32 units, per tick                       */
+    int64_t  j, j2, j6;         /* the segment's jerk, / 2, / 6              */
+} motion_run_t;
+
+typedef struct
+{
+    uint32_t plans;             /* computed                                  */
+    uint32_t hits;              /* found in the cache                        */
+    uint32_t refused;           /* out of range                              */
+} motion_stats_t;
+
+/**
+ * The profile of `m` into `out`, from the cache or planned (and cached).
+ * False, `out` empty, if a limit is 0 or below the resolution, or the move
+ * is beyond MOTION_DIST_MAX / MOTION_TICKS_MAX. Any task.
+ */
+bool Motion_Plan(const motion_move_t *m, motion_profile_t *out);
+
+/** Start `r` at the beginning of `pf`, which must stay put until it is done. Any context. */
+void Motion_Start(motion_run_t *r, const motion_profile_t *pf);
+
+/** One tick: the position after it, whole units from the start. Any context. */
+int32_t Motion_Tick(motion_run_t *r);
+
+/** The run has reached the end of its profile. */
+bool Motion_Done(const motion_run_t *r);
+
+/** Present speed, Q16 units per tick, signed. */
+int32_t Motion_Vel(const motion_run_t *r);
+
+/** Plans and cache hits since boot. Any task. */
+void Motion_GetStats(motion_stats_t *out);
+
+#endif /* MOTION_H */
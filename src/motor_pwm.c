@@ -0,0 +1,163 @@
+/* =============================================================================
+ * motor_pwm.c  -  Soft-start / soft-stop PWM drive for the lid actuator
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "motor_pwm.h"
+#include "definitions.h"        /* TCC0, DMAC plib */
+#include "neopixel.h"           /* NEO_BACKEND, NEO_OUTPUTS */
+#include "dma_qos.h"
+
+#if NEO_BACKEND != NEO_BACKEND_SPI
+#error "motor_pwm needs TCC0, which the CCL / TCC NeoPixel backends use"
+#endif
+#if (NEO_OUTPUTS > 3u) || DMA_STRESS_ENABLE
+#error "MPWM_DMA_CHANNEL is claimed by a NeoPixel output or the DMA stress test"
+#endif
+
+#define MPWM_PER    (120000000u / MPWM_FREQ_HZ)         /* counts per period; CC = PER is full on */
+#define MPWM_STEPS  (MPWM_RAMP_MS * MPWM_FREQ_HZ / 1000u)
+
+#if (MPWM_STEPS < 2u) || (MPWM_STEPS > 0xFFFFu) || (MPWM_PER > 0xFFFFu)
+#error "MPWM_RAMP_MS / MPWM_FREQ_HZ out of range"
+#endif
+
+typedef enum
+{
+    MPWM_OFF = 0,
+    MPWM_UP,                /* ramping up, then full on */
+    MPWM_DOWN
+} mpwm_state_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint16_t mpwm_up[MPWM_STEPS];
+static uint16_t mpwm_down[MPWM_STEPS];
+static mpwm_callback_t       mpwm_cb    = NULL;
+static volatile mpwm_state_t mpwm_state = MPWM_OFF;
+static bool                  mpwm_ready = false;
+
+/* Profile at x = 0..65536 (Q16), same scale out */
+static uint32_t mpwm_shape(uint32_t x)
+{
+#if MPWM_PROFILE == MPWM_PROFILE_QUADRATIC
+    return (uint32_t)(((uint64_t)x * x) >> 16);
+#elif MPWM_PROFILE == MPWM_PROFILE_SCURVE
+    uint32_t x2 = (uint32_t)(((uint64_t)x * x) >> 16);
+    uint32_t x3 = (uint32_t)(((uint64_t)x2 * x) >> 16);
+
+    return 3u * x2 - 2u * x3;
+#else
+    return x;
+#endif
+}
+
+static void mpwm_duty_now(uint16_t cc)
+{
+    TCC0_REGS->TCC_CCBUF[2] = cc;
+    TCC0_REGS->TCC_CC[2]    = cc;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_CC2_Msk) != 0u) {}
+}
+
+static void mpwm_start(const uint16_t *src, uint32_t steps)
+{
+    (void)DMAC_ChannelTransfer(MPWM_DMA_CHANNEL, src, (const void *)&TCC0_REGS->TCC_CCBUF[2],
+                               steps * sizeof(uint16_t));
+}
+
+/* -- ISR --------------------------------------------------------------------- */
+
+static void mpwm_dma_done(DMAC_TRANSFER_EVENT event, uintptr_t context)
+{
+    (void)event;
+    (void)context;
+
+    if (mpwm_state != MPWM_DOWN)
+        return;                             /* soft start done: stays full on */
+    mpwm_state = MPWM_OFF;
+    if (mpwm_cb != NULL)
+        mpwm_cb();
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void MotorPwm_Init(mpwm_callback_t stopped)
+{
+    for (uint32_t i = 0; i < MPWM_STEPS; i++)
+    {
+        mpwm_up[i]   = (uint16_t)((mpwm_shape(((i + 1u) << 16) / MPWM_STEPS) * MPWM_PER + 32768u) >> 16);
+        mpwm_down[i] = (uint16_t)((mpwm_shape(((MPWM_STEPS - 1u - i) << 16) / MPWM_STEPS) * MPWM_PER
+                                   + 32768u) >> 16);
+    }
+
+    /* TCC0 on GCLK channel 25 (GCLK0, 120 MHz), as MCC leaves it; replace its setup */
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_TCC0_Msk;
+    TCC0_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0u) {}
+
+    TCC0_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV1 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC0_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NPWM;
+    TCC0_REGS->TCC_PER   = MPWM_PER - 1u;
+    TCC0_REGS->TCC_CC[2] = 0u;
+    while (TCC0_REGS->TCC_SYNCBUSY != 0u) {}
+    TCC0_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    /* PA10 -> peripheral F (TCC0/WO2), low from here on */
+    PORT_REGS->GROUP[0].PORT_PMUX[10u >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[10u >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(5u));
+    PORT_REGS->GROUP[0].PORT_PINCFG[10] |= PORT_PINCFG_PMUXEN_Msk;
+
+    /* One halfword to CCBUF[2] per TCC0 overflow */
+    DMAC_ChannelDisable(MPWM_DMA_CHANNEL);
+    DMAC_REGS->CHANNEL[MPWM_DMA_CHANNEL].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT(2U)
+                                                      | DMAC_CHCTRLA_TRIGSRC(TCC0_DMAC_ID_OVF);
+    (void)DMAC_ChannelSettingsSet(MPWM_DMA_CHANNEL,
+                                  DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BLOCKACT_INT
+                                  | DMAC_BTCTRL_BEATSIZE_HWORD | DMAC_BTCTRL_SRCINC_Msk);
+    Dma_Assign(MPWM_DMA_CHANNEL, DMA_CLASS_STREAM);
+    DMAC_ChannelCallbackRegister(MPWM_DMA_CHANNEL, mpwm_dma_done, 0u);
+
+    mpwm_cb    = stopped;
+    mpwm_state = MPWM_OFF;
+    mpwm_ready = true;
+}
+
+void MotorPwm_RampUp(void)
+{
+    if (!mpwm_ready) return;
+    MotorPwm_Cut();
+    mpwm_state = MPWM_UP;
+    mpwm_start(mpwm_up, MPWM_STEPS);
+}
+
+bool MotorPwm_RampDown(void)
+{
+    uint32_t k = 0;
+    uint16_t cc;
+
+    if (!mpwm_ready || mpwm_state == MPWM_OFF) return false;
+
+    DMAC_ChannelDisable(MPWM_DMA_CHANNEL);
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_CC2_Msk) != 0u) {}
+    cc = (uint16_t)TCC0_REGS->TCC_CC[2];
+
+    /* Join the down ramp where it meets the present duty: no step up */
+    while (k < MPWM_STEPS - 1u && mpwm_down[k] > cc) k++;
+    mpwm_state = MPWM_DOWN;
+    mpwm_start(&mpwm_down[k], MPWM_STEPS - k);
+    return true;
+}
+
+void MotorPwm_Cut(void)
+{
+    if (!mpwm_ready) return;
+    DMAC_ChannelDisable(MPWM_DMA_CHANNEL);
+    mpwm_state = MPWM_OFF;
+    mpwm_duty_now(0u);
+}
+
+bool MotorPwm_IsOff(void)
+{
+    return mpwm_state == MPWM_OFF;
+}
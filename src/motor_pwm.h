@@ -0,0 +1,58 @@
+/* =============================================================================
+ * motor_pwm.h  -  Soft-start / soft-stop PWM drive for the lid actuator
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A logic-level MOSFET in the actuator supply is driven from PA10 (TCC0
+ * WO2) while the relays only pick the direction. TCC0 runs single-slope
+ * PWM at MPWM_FREQ_HZ from GCLK0; every overflow triggers one DMAC beat
+ * that writes the next duty from a ramp table into CCBUF[2], which the
+ * counter takes over at the following period. A start or stop is one DMA
+ * block of MPWM_RAMP_MS, so the ramp is exact to the PWM period and the
+ * CPU only sees the block-complete interrupt at its end.
+ *
+ * The ramp shape is MPWM_PROFILE; both tables (up and down) are built once
+ * by MotorPwm_Init(), MPWM_RAMP_MS * MPWM_FREQ_HZ / 1000 halfwords each.
+ *
+ * TCC0 is free only with the SPI NeoPixel backend (the CCL and TCC
+ * backends make the WS2812 pulses with it), and DMAC_CHANNEL_3 only while
+ * neither four NeoPixel outputs nor the DMA stress test claim it.
+ * ============================================================================= */
+
+#ifndef MOTOR_PWM_H
+#define MOTOR_PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define MPWM_PROFILE_LINEAR     0       /* constant slope                      */
+#define MPWM_PROFILE_QUADRATIC  1       /* slow start, gentlest inrush         */
+#define MPWM_PROFILE_SCURVE     2       /* smoothstep: soft at both ends       */
+
+#define MPWM_PROFILE        MPWM_PROFILE_SCURVE
+#define MPWM_FREQ_HZ        20000u      /* above hearing, MOSFET gate losses low */
+#define MPWM_RAMP_MS        30u         /* soft start and soft stop length     */
+#define MPWM_DMA_CHANNEL    DMAC_CHANNEL_3
+
+/** Called from the DMAC ISR when a soft stop has reached 0 % duty. */
+typedef void (*mpwm_callback_t)(void);
+
+/** Set up TCC0 / PA10 at 0 % and build the ramp tables. Before the scheduler. */
+void MotorPwm_Init(mpwm_callback_t stopped);
+
+/** Ramp from 0 % to full on. Relays must already select the direction. Any task. */
+void MotorPwm_RampUp(void);
+
+/**
+ * Ramp from the present duty to 0 %, then call the stopped callback. False
+ * (and no callback) if the output is already off or before Init. Any task.
+ */
+bool MotorPwm_RampDown(void);
+
+/** 0 % at once, any ramp abandoned. Any task. */
+void MotorPwm_Cut(void);
+
+/** The output is at 0 % and no ramp is running. */
+bool MotorPwm_IsOff(void);
+
+#endif /* MOTOR_PWM_H */
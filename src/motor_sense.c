@@ -0,0 +1,114 @@
+/* =============================================================================
+ * motor_sense.c  -  Actuator motor-current window monitor (end of travel)
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "motor_sense.h"
+#include "definitions.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "irqstat.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static msense_callback_t   msense_cb = NULL;
+static volatile bool       msense_armed = false;
+static volatile TickType_t msense_arm_tick = 0;
+
+static inline void msense_sync(uint32_t mask)
+{
+    while ((ADC0_REGS->ADC_SYNCBUSY & mask) != 0u) {}
+}
+
+/* -- ISR --------------------------------------------------------------------- */
+
+static void msense_isr(void)
+{
+    ADC0_REGS->ADC_INTFLAG = ADC_INTFLAG_WINMON_Msk | ADC_INTFLAG_OVERRUN_Msk;
+
+    if (!msense_armed)
+        return;
+    /* Inrush looks like a stall: keep watching until the blanking has passed */
+    if ((xTaskGetTickCountFromISR() - msense_arm_tick) < pdMS_TO_TICKS(MSENSE_BLANK_MS))
+        return;
+
+    msense_armed = false;
+    ADC0_REGS->ADC_INTENCLR = ADC_INTENCLR_WINMON_Msk;
+    if (msense_cb != NULL)
+        msense_cb(ADC0_REGS->ADC_RESULT);
+}
+
+void ADC0_OTHER_Handler(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_MSENSE);
+    msense_isr();
+    IRQSTAT_EXIT(IRQSTAT_MSENSE);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void MotorSense_Init(msense_callback_t callback)
+{
+    uint32_t sw0 = SW0_FUSES_REGS->FUSES_SW0_WORD_0;
+
+    /* ADC0 on GCLK3 (48 MHz) / 4 = 12 MHz, ~1.3 us per 12-bit conversion */
+    MCLK_REGS->MCLK_APBDMASK |= MCLK_APBDMASK_ADC0_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[ADC0_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK3 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[ADC0_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    ADC0_REGS->ADC_CTRLA = ADC_CTRLA_SWRST_Msk;
+    msense_sync(ADC_SYNCBUSY_SWRST_Msk);
+
+    /* Factory bias calibration from the NVM software calibration row */
+    ADC0_REGS->ADC_CALIB =
+        ADC_CALIB_BIASCOMP((sw0 & FUSES_SW0_WORD_0_ADC0_BIASCOMP_Msk) >> FUSES_SW0_WORD_0_ADC0_BIASCOMP_Pos)
+      | ADC_CALIB_BIASR2R((sw0 & FUSES_SW0_WORD_0_ADC0_BIASR2R_Msk) >> FUSES_SW0_WORD_0_ADC0_BIASR2R_Pos)
+      | ADC_CALIB_BIASREFBUF((sw0 & FUSES_SW0_WORD_0_ADC0_BIASREFBUF_Msk) >> FUSES_SW0_WORD_0_ADC0_BIASREFBUF_Pos);
+
+    ADC0_REGS->ADC_CTRLA     = ADC_CTRLA_PRESCALER_DIV4;
+    ADC0_REGS->ADC_REFCTRL   = ADC_REFCTRL_REFSEL(ADC_REFCTRL_REFSEL_INTVCC1_Val);
+    ADC0_REGS->ADC_INPUTCTRL = ADC_INPUTCTRL_MUXPOS(0u) | ADC_INPUTCTRL_MUXNEG_GND;    /* AIN0 */
+    ADC0_REGS->ADC_AVGCTRL   = ADC_AVGCTRL_SAMPLENUM(ADC_AVGCTRL_SAMPLENUM_256_Val) | ADC_AVGCTRL_ADJRES(4u);
+    ADC0_REGS->ADC_SAMPCTRL  = ADC_SAMPCTRL_SAMPLEN(3u);
+    ADC0_REGS->ADC_WINLT     = MSENSE_STOP_CODE;
+    ADC0_REGS->ADC_WINUT     = MSENSE_STALL_CODE;
+    ADC0_REGS->ADC_CTRLB     = ADC_CTRLB_RESSEL_16BIT | ADC_CTRLB_FREERUN_Msk
+                             | ADC_CTRLB_WINMODE_MODE4;       /* outside the window */
+    msense_sync(ADC_SYNCBUSY_Msk);
+
+    /* PA02 -> peripheral B (analog); the digital input buffer stays off */
+    PORT_REGS->GROUP[0].PORT_PMUX[2u >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[2u >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(1u));
+    PORT_REGS->GROUP[0].PORT_PINCFG[2] = PORT_PINCFG_PMUXEN_Msk;
+
+    ADC0_REGS->ADC_CTRLA |= ADC_CTRLA_ENABLE_Msk;
+    msense_sync(ADC_SYNCBUSY_ENABLE_Msk);
+    ADC0_REGS->ADC_SWTRIG = ADC_SWTRIG_START_Msk;             /* free run from here */
+    msense_cb = callback;
+
+    NVIC_SetPriority(ADC0_OTHER_IRQn, MSENSE_PRIO);
+    NVIC_ClearPendingIRQ(ADC0_OTHER_IRQn);
+    NVIC_EnableIRQ(ADC0_OTHER_IRQn);
+}
+
+void MotorSense_Arm(void)
+{
+    if (msense_cb == NULL) return;              /* before Init: ADC0 unclocked */
+    ADC0_REGS->ADC_INTENCLR = ADC_INTENCLR_WINMON_Msk;
+    msense_arm_tick = xTaskGetTickCount();
+    msense_armed    = true;
+    ADC0_REGS->ADC_INTFLAG  = ADC_INTFLAG_WINMON_Msk;
+    ADC0_REGS->ADC_INTENSET = ADC_INTENSET_WINMON_Msk;
+}
+
+void MotorSense_Disarm(void)
+{
+    if (msense_cb == NULL) return;
+    ADC0_REGS->ADC_INTENCLR = ADC_INTENCLR_WINMON_Msk;
+    msense_armed = false;
+}
+
+uint16_t MotorSense_Read(void)
+{
+    return ADC0_REGS->ADC_RESULT;
+}
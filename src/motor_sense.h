@@ -0,0 +1,49 @@
+/* =============================================================================
+ * motor_sense.h  -  Actuator motor-current window monitor (end of travel)
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A shunt amplifier on the actuator supply feeds PA02 (ADC0 AIN0). ADC0
+ * free-runs and averages 256 conversions per result in hardware
+ * (~0.34 ms), and its window monitor flags every result outside
+ * [MSENSE_STOP_CODE, MSENSE_STALL_CODE]:
+ *
+ *   below STOP   the actuator's internal limit switch has opened
+ *   above STALL  the motor is stalled against a mechanical stop
+ *
+ * Either way the motion is over. The CPU sees no per-sample work: only the
+ * first out-of-window result after MotorSense_Arm() (and its inrush
+ * blanking time) raises an interrupt, which disarms the monitor and calls
+ * the registered callback from the ISR.
+ *
+ * Codes are 16-bit (256-sample accumulation shifted by 4) against the
+ * VDDANA reference; set the thresholds from the shunt and amplifier gain.
+ * ============================================================================= */
+
+#ifndef MOTOR_SENSE_H
+#define MOTOR_SENSE_H
+
+#include <stdint.h>
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define MSENSE_STOP_CODE    1200u       /* below: no current, limit switch open */
+#define MSENSE_STALL_CODE   48000u      /* above: stall current                 */
+#define MSENSE_BLANK_MS     150u        /* ignore inrush after each Arm()       */
+#define MSENSE_PRIO         IRQ_PRIO_MSENSE     /* NVIC, irqprio.h          */
+
+/** Called from the ADC0 ISR with the out-of-window result (must not be NULL). */
+typedef void (*msense_callback_t)(uint16_t code);
+
+/** Start ADC0 free-running on PA02 and register the callback. Before the scheduler. */
+void MotorSense_Init(msense_callback_t callback);
+
+/** Watch the current of a motion that has just started. Any task; no-op before Init. */
+void MotorSense_Arm(void);
+
+/** Stop watching (relays off). Any task. */
+void MotorSense_Disarm(void);
+
+/** Latest averaged result, for calibrating the thresholds. */
+uint16_t MotorSense_Read(void);
+
+#endif /* MOTOR_SENSE_H */
@@ -4,96 +4,1873 @@
  * ============================================================================= */
 
 #include "neopixel.h"
-#include "definitions.h"   /* MCC Melody umbrella ? pulls in SERCOM1, DMAC, SYSTICK */
+#include "profile.h"
+#include "cache.h"
+#include "palette.h"
+#include "power.h"
+#include "fastmath.h"
+#include "dma_qos.h"
+#include "pixdist.h"
+#include "dmamem.h"
+#include "dmaram.h"
+#include "evbus.h"
+#include "latbench.h"
+#include "framestat.h"
+#include "irqstat.h"
+#include "cpufreq.h"
+#include "showclock.h"
+#include "hrtimer.h"
+#include "sercom.h"
+#include "crc.h"
+#include "definitions.h"   /* MCC Melody umbrella ? pulls in SERCOM1, DMAC, TCC0 */
+#include "FreeRTOS.h"
+#include "task.h"
 #include <string.h>
 
 /* ?? Internal state ??????????????????????????????????????????????????????????? */
 
-static uint8_t  neo_buf[NEO_BUF_SIZE];
-static volatile bool tx_done = false;
+#define NEO_WIRE_MS         ((NEO_WIRE_US + 999u) / 1000u)
+#define NEO_TX_TIMEOUT_MS   (2u * NEO_WIRE_MS + 2u)     /* 144 LEDs: 5 ms frame, 12 ms */
+
+#if NEO_BACKEND == NEO_BACKEND_CCL
+
+/*
+ * CCL backend: the frame is plain G,R,B bytes (wire order). SERCOM0 shifts
+ * them out at exactly one bit per 1.25 us and CCL LUT0 turns every bit into a
+ * WS2812 pulse using two TCC0 outputs that rise at the start of each period:
+ *
+ *   OUT0 = WO1 | (MOSI & WO2)     WO1 high for T0H, WO2 high for T1H
+ *
+ * SERCOM0 and TCC0 both run from the 120 MHz GCLK0 (BAUD 74, PER 149), so
+ * once TCC0 is started by the first DMA beat the two stay locked for the frame.
+ */
+#define NEO_PIX_BYTES       ((uint32_t)(NUM_LEDS) * 3u)
+#define NEO_STAGED_BYTES    NEO_PIX_BYTES
+#define DMAC_CHANNEL_CCL    DMAC_CHANNEL_2  /* SERCOM0 TX trigger, see DMAC_Initialize() */
+
+#define NEO_CCL_SPI_BAUD    74u         /* 120 MHz / (2 x 75)  = 800 kHz             */
+#define NEO_CCL_T0H_COUNTS  42u         /* TCC0 CC1: 42 / 120 MHz = 350 ns           */
+#define NEO_CCL_T1H_COUNTS  96u         /* TCC0 CC2: 96 / 120 MHz = 800 ns           */
+#define NEO_CCL_LATCH_TICKS 2u          /* idle time between frames, >= 280 us       */
+
+static uint8_t  neo_pix[2][NEO_PIX_BYTES] DMA_RAM __ALIGNED(4);
+static uint8_t *neo_back  = neo_pix[0];
+static uint8_t *neo_front = neo_pix[1];
+
+/* One single-block descriptor per frame; beat events start TCC0 */
+static dmac_descriptor_registers_t neo_ccl_desc[2] DMA_RAM __ALIGNED(8);
+
+static volatile TickType_t neo_latch_tick = 0u;    /* tick the last frame ended */
+
+static void NeoPixel_CclStop(void);
+
+#elif NEO_BACKEND == NEO_BACKEND_TCC
+
+/*
+ * TCC backend: one duty byte per WS2812 bit. TCC0 runs NPWM at 800 kHz on PA08
+ * (WO0) and every overflow requests a DMA beat into CCBUF0, which the counter
+ * takes over at the next overflow. The trailing zero bytes hold the line low
+ * for the latch and leave CC0 = 0, so the idle output stays low.
+ */
+#define NEO_TCC_DATA_BYTES  ((uint32_t)(NUM_LEDS) * 24u)
+#define NEO_TCC_RESET_BITS  (((uint32_t)NEO_RESET_BYTES * 8u) / 3u)    /* same latch as SPI */
+#define NEO_TCC_BUF_SIZE    (NEO_TCC_DATA_BYTES + NEO_TCC_RESET_BITS)
+#define NEO_STAGED_BYTES    NEO_TCC_DATA_BYTES
+
+#define NEO_TCC_T0H_COUNTS  48u         /* 48 / 120 MHz = 400 ns                     */
+#define NEO_TCC_T1H_COUNTS  96u         /* 96 / 120 MHz = 800 ns                     */
+
+static uint8_t  neo_duty[2][NEO_TCC_BUF_SIZE] DMA_RAM __ALIGNED(4);
+static uint8_t *neo_back  = neo_duty[0];
+static uint8_t *neo_front = neo_duty[1];
+
+static dmac_descriptor_registers_t neo_tcc_desc[2] DMA_RAM __ALIGNED(8);
+
+#elif NEO_STREAMING
+
+/*
+ * Streaming mode: pixels are kept as plain bytes in wire order and only
+ * NEO_CHUNK_LEDS at a time are expanded into one of two SPI chunk buffers.
+ * The two chunk descriptors form a ring; every block-complete interrupt
+ * re-encodes the chunk that just drained while the other one is on the wire.
+ * The last data chunk links to a zero tail that forms the reset pulse.
+ */
+#define NEO_PIX_BYTES       ((uint32_t)(NUM_LEDS) * NEO_CHANNELS)
+#define NEO_CHUNKS          ((uint16_t)(((uint32_t)(NUM_LEDS) + NEO_CHUNK_LEDS - 1u) / NEO_CHUNK_LEDS))
+
+static uint8_t  neo_pix[2][NEO_PIX_BYTES] __ALIGNED(4);
+static uint8_t *neo_back  = neo_pix[0];
+static uint8_t *neo_front = neo_pix[1];
+
+static uint8_t  neo_chunk[2][NEO_CHUNK_BYTES] DMA_RAM;
+static const uint32_t neo_zero = 0u;     /* reset tail source, read NEO_RESET_BYTES times */
+
+static dmac_descriptor_registers_t neo_desc[2]   DMA_RAM __ALIGNED(8);
+static dmac_descriptor_registers_t neo_tail_desc DMA_RAM __ALIGNED(8);
+
+static volatile uint16_t neo_blocks_done = 0u;
+
+#if IRQSTAT_ENABLE
+/* A full chunk's wire time: when its block-complete interrupt is due */
+#define NEO_CHUNK_CYCLES    ((uint32_t)((uint64_t)NEO_CHUNK_BYTES * 8u * configCPU_CLOCK_HZ / NEO_SPI_HZ))
+static uint32_t neo_chunk_due;      /* CpuFreq_Cycles() the chunk on the wire ends */
+#endif
+
+static void NeoPixel_ChunkPrepare(uint16_t chunk);
+
+#define NEO_STAGED_BYTES    NEO_PIX_BYTES
+
+#else
+
+/*
+ * Two wire images: effects stage into neo_back while the DMAC streams
+ * neo_front out. NeoPixel_Show() swaps the pair; with NEO_QUEUE_FRAMES
+ * there is one more per queued frame, and neo_front is the newest of
+ * them (the one the new back image is refreshed from). Each image holds one
+ * NEO_SEG_BUF_SIZE segment (data padded to a whole beat) per output, back
+ * to back; the reset tails are not stored at all (neo_zero_desc).
+ */
+#if NEO_QUEUE_FRAMES
+#define NEO_IMAGES          (NEO_QUEUE_FRAMES + 1u)     /* the queue and the back image */
+#else
+#define NEO_IMAGES          2u
+#endif
+
+static uint8_t  neo_buf[NEO_IMAGES][NEO_BUF_SIZE] DMA_RAM __ALIGNED(4);
+static uint8_t *neo_back  = neo_buf[0];
+static uint8_t *neo_front = neo_buf[1];
+
+/*
+ * One descriptor chain per wire image and output, then one per constant
+ * frame (SHOW_FRAMES) and output. A block moves at most 64K
+ * beats, so long segments are split over up to NEO_DMA_BLOCKS linked
+ * descriptors. The last one links to the output's reset tail, which reads
+ * the one zero word with the source fixed and raises the completion
+ * interrupt; all images share it. An empty segment starts at its tail.
+ */
+#define NEO_CHAINS          (NEO_IMAGES + NEO_FRAME_COUNT)
+
+static dmac_descriptor_registers_t neo_wire_desc[NEO_CHAINS][NEO_OUTPUTS][NEO_DMA_BLOCKS] DMA_RAM __ALIGNED(8);
+static dmac_descriptor_registers_t neo_zero_desc[NEO_OUTPUTS] DMA_RAM __ALIGNED(8);
+static const uint32_t neo_zero = 0u;
+
+#if NEO_DITHER
+/*
+ * Corrected pixels in 1/256 output steps (wire order G, R, B), quantised
+ * into neo_back by NeoPixel_DitherEncode() at every Show(). The residue of
+ * each channel carries over to the next frame (temporal error diffusion).
+ */
+static uint16_t neo_px16[NUM_LEDS][3];
+static uint8_t  neo_dither_err[NUM_LEDS][3];
+#endif
+
+typedef struct
+{
+    sercom_registers_t *spi;
+    DMAC_CHANNEL        ch;
+    uint8_t             sercom;     /* sercom.h instance */
+} neo_output_t;
+
+/* Output 0's pin is muxed by MCC; the others are set up in NeoPixel_OutputInit() */
+static const neo_output_t neo_out[4] =
+{
+    { SERCOM1_REGS, DMAC_CHANNEL_NEO, 1u },     /* PA16 */
+    { SERCOM3_REGS, DMAC_CHANNEL_1,   3u },     /* PA22 */
+    { SERCOM0_REGS, DMAC_CHANNEL_2,   0u },     /* PA04 */
+    { SERCOM4_REGS, DMAC_CHANNEL_3,   4u },     /* PB12 */
+};
+
+static volatile uint8_t tx_pending = 0u;    /* outputs still on the wire */
+
+#if NEO_QUEUE_FRAMES
+/*
+ * Frames queued by Show(), oldest first: image index and present time. The
+ * head is on the wire (tx_busy) or waits for neo_q_timer. Show() adds under
+ * a critical section, the DMA callback drops the head and arms the timer
+ * for the next, the timer ISR starts it.
+ */
+static uint8_t           neo_q_img[NEO_QUEUE_FRAMES];        /* chain: image or constant frame */
+static uint32_t          neo_q_at[NEO_QUEUE_FRAMES];
+static bool              neo_q_timed[NEO_QUEUE_FRAMES];
+static uint8_t           neo_q_head;
+static volatile uint8_t  neo_q_count;
+static hrtimer_t         neo_q_timer;
+static uint32_t          neo_q_next_at;     /* NeoPixel_SetPresentTime(), for the next Show() */
+static bool              neo_q_next_set;
+
+static void NeoPixel_QueueNext(void);
+static void NeoPixel_QueueDue(hrtimer_t *t, void *arg);
+#endif
+
+#define NEO_STAGED_BYTES    NEO_BUF_SIZE
+
+#endif /* NEO_BACKEND / NEO_STREAMING */
+
+static volatile bool tx_busy = false;
+static volatile TaskHandle_t tx_waiter = NULL;
+static volatile TickType_t   tx_start  = 0u;        /* tick the running transfer began */
+
+/* Written by the DMAC callback and NeoPixel_Wait(); read with NeoPixel_GetStats() */
+static volatile neo_tx_stats_t neo_stats;
+
+#if NEO_SKIP_UNCHANGED
+static uint32_t neo_last_crc   = 0u;        /* CRC-32 of the last frame sent */
+static bool     neo_last_valid = false;
+#endif
+
+/* Back frame being refreshed from the front one, or cleared, by the DMAC (dmamem.h) */
+static dmamem_t neo_back_dma = DMAMEM_DONE;
+
+/* First thing in every call that touches the back frame */
+static inline void neo_back_sync(void)
+{
+    if (neo_back_dma != DMAMEM_DONE)
+    {
+        (void)DmaMem_Wait(neo_back_dma);
+        neo_back_dma = DMAMEM_DONE;
+    }
+}
+
+#if NEO_RAIL_GATE
+static bool          neo_dark = true;   /* staged frame known to be all black */
+static volatile bool neo_rail_on;       /* read by the Show() task, cut by the timer task */
+static bool          neo_rail_dark;     /* only dark frames shown since the timer was armed */
+static uint32_t      neo_rail_since;    /* show time the rail was switched on */
+static hrtimer_t     neo_rail_timer;
+#endif
+
+/* A staging call: the whole strip, or part of it, written with `lit` set
+ * if any of it is not black. A partial black write says nothing */
+static inline void neo_rail_staged(bool whole, bool lit)
+{
+#if NEO_RAIL_GATE
+    if (whole || lit)
+        neo_dark = !lit;
+#else
+    (void)whole;
+    (void)lit;
+#endif
+}
+
+/* ?? LED rail gate ????????????????????????????????????????????????????????????? */
+
+#if NEO_RAIL_GATE
+static void NeoPixel_RailSwitch(bool on)
+{
+    PORT_PinWrite(NEO_RAIL_PIN, on == (NEO_RAIL_ON_LEVEL != 0));
+    neo_rail_on = on;
+    if (on)
+        neo_rail_since = ShowClock_Now();
+}
+
+/* Until the rail has been up NEO_RAIL_SETTLE_US: whole ticks asleep from a
+ * task, the rest spinning on the show clock */
+static void NeoPixel_RailSettle(bool sleep)
+{
+    uint32_t at = neo_rail_since + NEO_RAIL_SETTLE_US;
+
+    if (sleep)
+        vTaskDelay(ShowClock_TicksUntil(at));
+    while (!ShowClock_Expired(at)) { }
+}
+
+/* Timer task: nothing but dark frames for NEO_RAIL_OFF_MS */
+static void NeoPixel_RailOff(hrtimer_t *t, void *arg)
+{
+    bool retry = false;
+
+    (void)arg;
+    taskENTER_CRITICAL();
+    if (neo_rail_dark)
+    {
+#if NEO_QUEUE_FRAMES
+        retry = tx_busy || (neo_q_count != 0u);
+#else
+        retry = tx_busy;
+#endif
+        if (!retry)
+            NeoPixel_RailSwitch(false);     /* the reset tail went last: the data line is low */
+    }
+    taskEXIT_CRITICAL();
+
+    if (retry)
+        HrTimer_Start(t, NEO_RAIL_OFF_MS * 1000u, 0u);      /* the last one is still going out */
+}
+
+/*
+ * In the Show() task before a frame is started. A lit frame brings the rail
+ * up and waits for it to settle; false for a dark one while it is off, which
+ * is then not sent at all.
+ */
+static bool NeoPixel_RailFrame(bool dark)
+{
+    if (dark)
+    {
+        if (!neo_rail_on)
+            return false;
+        if (!neo_rail_dark)
+        {
+            neo_rail_dark = true;
+            HrTimer_Start(&neo_rail_timer, NEO_RAIL_OFF_MS * 1000u, 0u);
+        }
+        return true;
+    }
+
+    taskENTER_CRITICAL();
+    neo_rail_dark = false;              /* from here on RailOff() leaves the rail up */
+    taskEXIT_CRITICAL();
+    (void)HrTimer_Stop(&neo_rail_timer);
+
+    if (!neo_rail_on)
+    {
+        NeoPixel_RailSwitch(true);
+        neo_stats.rail_wakes++;
+        NeoPixel_RailSettle(true);
+    }
+    return true;
+}
+#endif /* NEO_RAIL_GATE */
+
+/* From every backend's Init(): the rail powered, as for the boot frame */
+static void NeoPixel_RailInit(void)
+{
+#if NEO_RAIL_GATE
+    PORT_PinOutputEnable(NEO_RAIL_PIN);
+    NeoPixel_RailSwitch(true);
+    neo_rail_dark = false;
+    HrTimer_Create(&neo_rail_timer, NeoPixel_RailOff, NULL, HRTIMER_TASK);
+#endif
+}
 
 /* ?? DMA callback ????????????????????????????????????????????????????????????? */
 
-static void NeoPixel_DMA_Callback(DMAC_TRANSFER_EVENT event, uintptr_t context)
+/*
+ * Runs in DMAC_n interrupt context (IRQ_PRIO_DMAC, irqprio.h: only the
+ * watchdog and brownout are above it, no bulk ISR delays the refill).
+ * Every output's channel uses the same priority, so callbacks never nest.
+ */
+#if NEO_BACKEND != NEO_BACKEND_TCC
+/* Count and clear SERCOM error flags left by the frame */
+static inline void NeoPixel_SpiCheck(sercom_registers_t *spi)
+{
+    uint16_t st = spi->SPIM.SERCOM_STATUS
+                & (uint16_t)(SERCOM_SPIM_STATUS_BUFOVF_Msk | SERCOM_SPIM_STATUS_LENERR_Msk);
+
+    if (st != 0u)
+    {
+        neo_stats.spi_errors++;
+        spi->SPIM.SERCOM_STATUS = st;       /* write one to clear */
+    }
+}
+#endif
+
+/* The frame has left the wire: wake the waiter and tell the bus */
+static void NeoPixel_FrameDone(BaseType_t *woken)
+{
+    if (!tx_busy)
+        return;             /* aborted by NeoPixel_Wait() */
+    if ((TickType_t)(xTaskGetTickCountFromISR() - tx_start) > NEO_WIRE_MS + 1u)
+        neo_stats.late++;
+    tx_busy = false;
+#if NEO_QUEUE_FRAMES
+    NeoPixel_QueueNext();
+#endif
+    if (tx_waiter != NULL)
+    {
+        vTaskNotifyGiveFromISR(tx_waiter, woken);
+    }
+    EventBus_PublishFromISR(EVBUS_FRAME_DONE, 0u, neo_stats.frames, woken);
+}
+
+#if NEO_BACKEND == NEO_BACKEND_CCL
+/* Park TCC0 with both pulses low so the line idles for the latch */
+static void NeoPixel_CclEnd(BaseType_t *woken)
+{
+    SERCOM0_REGS->SPIM.SERCOM_INTENCLR = (uint8_t)SERCOM_SPIM_INTENCLR_TXC_Msk;
+    NeoPixel_CclStop();
+    NeoPixel_SpiCheck(SERCOM0_REGS);
+    neo_latch_tick = xTaskGetTickCountFromISR();
+    NeoPixel_FrameDone(woken);
+}
+
+/* SERCOM0 TXC, at IRQ_PRIO_NEO: the last bit of the frame left the shifter */
+static void NeoPixel_CclTxc(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    NeoPixel_CclEnd(&woken);
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+static void NeoPixel_DMA_Callback(DMAC_TRANSFER_EVENT event, uintptr_t context)
+{
+    BaseType_t woken = pdFALSE;
+
+    (void)context;
+
+    if (event == DMAC_TRANSFER_EVENT_ERROR)
+        neo_stats.dma_errors++;
+
+#if NEO_BACKEND == NEO_BACKEND_CCL
+    /* The last byte is still in the shifter (<= 20 us): its TXC interrupt
+     * ends the frame, nothing waits for it here. After a DMA error the
+     * shifter may never have started, so end the frame now. */
+    if (event == DMAC_TRANSFER_EVENT_COMPLETE)
+    {
+        SERCOM0_REGS->SPIM.SERCOM_INTENSET = (uint8_t)SERCOM_SPIM_INTENSET_TXC_Msk;
+        return;
+    }
+    NeoPixel_CclEnd(&woken);
+    portYIELD_FROM_ISR(woken);
+    return;
+#elif NEO_BACKEND == NEO_BACKEND_TCC
+    (void)event;        /* the reset tail is already on the wire, TCC0 idles low */
+#elif NEO_STREAMING
+    if (event == DMAC_TRANSFER_EVENT_COMPLETE)
+    {
+        /* Block b just drained; its descriptor is next fetched for block b+2 */
+        uint16_t next = (uint16_t)(neo_blocks_done + 2u);
+
+#if IRQSTAT_ENABLE
+        if ((uint16_t)(neo_blocks_done + 1u) < NEO_CHUNKS)   /* a full chunk, not the last */
+        {
+            IRQSTAT_DUE(IRQSTAT_NEO, neo_chunk_due);
+            neo_chunk_due += NEO_CHUNK_CYCLES;
+        }
+#endif
+        neo_blocks_done++;
+        if (neo_blocks_done <= NEO_CHUNKS)
+        {
+            if (next < NEO_CHUNKS)
+                NeoPixel_ChunkPrepare(next);
+            return;             /* frame still on the wire (tail not yet sent) */
+        }
+    }
+    DMAC_ChannelDisable(DMAC_CHANNEL_NEO);
+    NeoPixel_SpiCheck(SERCOM1_REGS);
+#else
+    /* On error the channel is idle too, never leave Show() stuck */
+    NeoPixel_SpiCheck(neo_out[context].spi);
+    if (--tx_pending != 0u)
+        return;             /* other outputs still sending */
+#endif
+
+#if NEO_BACKEND != NEO_BACKEND_CCL
+    NeoPixel_FrameDone(&woken);
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+
+#if NEO_STREAMING
+/* Fast handler (dma_qos.h): a refill per chunk, without the plib's dispatch */
+static void NeoPixel_DMA_Fast(uint8_t flags)
+{
+    NeoPixel_DMA_Callback(((flags & DMAC_CHINTFLAG_TERR_Msk) != 0u) ? DMAC_TRANSFER_EVENT_ERROR
+                                                                     : DMAC_TRANSFER_EVENT_COMPLETE, 0u);
+}
+#endif
+
+/* ?? Bit encoding ????????????????????????????????????????????????????????????? */
+
+/*
+ * neo_enc_lut[]
+ * Converts one 8-bit NeoPixel colour component into NEO_ENC_BYTES SPI bytes.
+ * Shown for the WS2812B profile; 4-bit profiles work the same with 4 SPI
+ * bits per pixel bit and 4 bytes per component.
+ *
+ * Each NeoPixel bit ? 3 SPI bits:
+ *   pixel '1'  ?  1 1 0  (0x6)
+ *   pixel '0'  ?  1 0 0  (0x4)
+ *
+ * 8 pixel bits  3 SPI bits = 24 SPI bits = 3 bytes, packed MSB-first.
+ *
+ * Example: pixel byte 0xC0 = 1100 0000
+ *   bit7=1 ? 110 | bit6=1 ? 110 | bit5=0 ? 100 | bit4=0 ? 100 | ?
+ *   24-bit SPI word = 110 110 100 100 100 100 100 100
+ *                   = 1101 1010 0100 1001 0010 0100
+ *                   = 0xDA  0x49  0x24
+ *
+ * The whole mapping is a 256 x NEO_ENC_BYTES table in flash, expanded by the
+ * preprocessor so there is no init-time cost and no RAM copy.
+ *
+ * Every SPI group is NEO_SPI_ZERO or NEO_SPI_ONE, placed at SPI bit
+ * NEO_SPI_BITS * i for bit i of the pixel byte.
+ */
+#define NEO_ENC_BIT(v, i)   ((uint32_t)((((uint32_t)(v) >> (i)) & 1u) ? NEO_SPI_ONE : NEO_SPI_ZERO) \
+                             << (NEO_SPI_BITS * (i)))
+#define NEO_ENC_WORD(v)     (NEO_ENC_BIT(v, 7) | NEO_ENC_BIT(v, 6)             \
+                             | NEO_ENC_BIT(v, 5) | NEO_ENC_BIT(v, 4)           \
+                             | NEO_ENC_BIT(v, 3) | NEO_ENC_BIT(v, 2)           \
+                             | NEO_ENC_BIT(v, 1) | NEO_ENC_BIT(v, 0))
+#if NEO_ENC_BYTES == 4u
+#define NEO_ENC_1(v)        { (uint8_t)(NEO_ENC_WORD(v) >> 24u),              \
+                              (uint8_t)(NEO_ENC_WORD(v) >> 16u),              \
+                              (uint8_t)(NEO_ENC_WORD(v) >>  8u),              \
+                              (uint8_t)(NEO_ENC_WORD(v)       ) }
+#else
+#define NEO_ENC_1(v)        { (uint8_t)(NEO_ENC_WORD(v) >> 16u),              \
+                              (uint8_t)(NEO_ENC_WORD(v) >>  8u),              \
+                              (uint8_t)(NEO_ENC_WORD(v)       ) }
+#endif
+#define NEO_ENC_4(v)        NEO_ENC_1(v),        NEO_ENC_1((v) + 1u),          \
+                            NEO_ENC_1((v) + 2u), NEO_ENC_1((v) + 3u)
+#define NEO_ENC_16(v)       NEO_ENC_4(v),        NEO_ENC_4((v) + 4u),          \
+                            NEO_ENC_4((v) + 8u), NEO_ENC_4((v) + 12u)
+#define NEO_ENC_64(v)       NEO_ENC_16(v),        NEO_ENC_16((v) + 16u),       \
+                            NEO_ENC_16((v) + 32u), NEO_ENC_16((v) + 48u)
+
+#if NEO_BACKEND == NEO_BACKEND_SPI      /* CCL and TCC shape the pulses in hardware */
+static const uint8_t neo_enc_lut[256][NEO_ENC_BYTES] =
+{
+    NEO_ENC_64(0u), NEO_ENC_64(64u), NEO_ENC_64(128u), NEO_ENC_64(192u)
+};
+
+#if !NEO_STREAMING
+/*
+ * Constant frames: one segment of identical wire LEDs per SHOW_FRAMES row,
+ * filled by a GCC range designator. The spare LED stays zero; it only pads
+ * the last beat, as the zero padding of the RAM images does.
+ */
+typedef struct
+{
+    uint8_t ch[NEO_CHANNELS][NEO_ENC_BYTES];
+} neo_wire_led_t;
+
+typedef struct __attribute__((aligned(4)))
+{
+    neo_wire_led_t led[NEO_SEG_LEDS + 1u];
+} neo_const_frame_t;
+
+#if NEO_CHANNELS == 4u
+#define NEO_ENC_SLOTS(a, b, c, d)   { NEO_ENC_1(a), NEO_ENC_1(b), NEO_ENC_1(c), NEO_ENC_1(d) }
+#else
+#define NEO_ENC_SLOTS(a, b, c)      { NEO_ENC_1(a), NEO_ENC_1(b), NEO_ENC_1(c) }
+#endif
+#define NEO_ENC_LED(...)            NEO_ENC_SLOTS(__VA_ARGS__)     /* NEO_WIRE_SLOTS() expanded first */
+#define NEO_X_FRAME(id, name, r, g, b, w) \
+    { { [0 ... NEO_SEG_LEDS - 1u] = { NEO_ENC_LED(NEO_WIRE_SLOTS(r, g, b, w)) } } },
+
+static const neo_const_frame_t neo_const_frame[NEO_FRAME_COUNT] = { SHOW_FRAMES(NEO_X_FRAME) };
+
+/* The strip current of a row as Power_Limit() estimates it, mA */
+#define NEO_FRAME_MA(r, g, b)       (((uint32_t)(NUM_LEDS) * (POWER_IDLE_MA_X10 * 255u \
+                                     + 10u * ((r) * POWER_MA_R + (g) * POWER_MA_G + (b) * POWER_MA_B))) / 2550u)
+#define NEO_X_FRAME_MA(id, name, r, g, b, w)    (uint16_t)NEO_FRAME_MA(r, g, b),
+#define NEO_X_FRAME_CHECK(id, name, r, g, b, w) \
+    _Static_assert(POWER_BUDGET_MA == 0u || NEO_FRAME_MA(r, g, b) <= POWER_BUDGET_MA, \
+                   "SHOW_FRAMES: \"" name "\" is over POWER_BUDGET_MA");
+
+static const uint16_t neo_const_ma[NEO_FRAME_COUNT] = { SHOW_FRAMES(NEO_X_FRAME_MA) };
+SHOW_FRAMES(NEO_X_FRAME_CHECK)
+
+#if NEO_RAIL_GATE
+#define NEO_X_FRAME_DARK(id, name, r, g, b, w)  (((r) | (g) | (b) | (w)) == 0u),
+
+static const bool neo_const_dark[NEO_FRAME_COUNT] = { SHOW_FRAMES(NEO_X_FRAME_DARK) };
+#endif
+#endif /* !NEO_STREAMING */
+#endif
+
+/* ?? Colour correction ?????????????????????????????????????????????????????? */
+
+/*
+ * Gamma, global brightness and white balance are folded into one encode
+ * table per wire channel (G, R, B), rebuilt only when a setting changes:
+ *
+ *   neo_enc_corr[c][v] = encode( gamma(v) * brightness/255 * balance[c]/255 )
+ *
+ * so the hot path is still a single 3-byte table copy per colour byte.
+ */
+#if NEO_GAMMA
+/* round(65535 * (v/255)^2.8) */
+static const uint16_t neo_gamma16[256] =
+{
+        0,     0,     0,     0,     1,     1,     2,     3,
+        4,     6,     8,    10,    13,    16,    19,    24,
+       28,    33,    39,    46,    53,    60,    69,    78,
+       88,    98,   110,   122,   135,   149,   164,   179,
+      196,   214,   232,   252,   273,   295,   317,   341,
+      366,   393,   420,   449,   478,   510,   542,   575,
+      610,   647,   684,   723,   764,   806,   849,   894,
+      940,   988,  1037,  1088,  1140,  1194,  1250,  1307,
+     1366,  1427,  1489,  1553,  1619,  1686,  1756,  1827,
+     1900,  1975,  2051,  2130,  2210,  2293,  2377,  2463,
+     2552,  2642,  2734,  2829,  2925,  3024,  3124,  3227,
+     3332,  3439,  3548,  3660,  3774,  3890,  4008,  4128,
+     4251,  4376,  4504,  4634,  4766,  4901,  5038,  5177,
+     5319,  5464,  5611,  5760,  5912,  6067,  6224,  6384,
+     6546,  6711,  6879,  7049,  7222,  7397,  7576,  7757,
+     7941,  8128,  8317,  8509,  8704,  8902,  9103,  9307,
+     9514,  9723,  9936, 10151, 10370, 10591, 10816, 11043,
+    11274, 11507, 11744, 11984, 12227, 12473, 12722, 12975,
+    13230, 13489, 13751, 14017, 14285, 14557, 14833, 15111,
+    15393, 15678, 15967, 16259, 16554, 16853, 17155, 17461,
+    17770, 18083, 18399, 18719, 19042, 19369, 19700, 20034,
+    20372, 20713, 21058, 21407, 21759, 22115, 22475, 22838,
+    23206, 23577, 23952, 24330, 24713, 25099, 25489, 25884,
+    26282, 26683, 27089, 27499, 27913, 28330, 28752, 29178,
+    29608, 30041, 30479, 30921, 31367, 31818, 32272, 32730,
+    33193, 33660, 34131, 34606, 35085, 35569, 36057, 36549,
+    37046, 37547, 38052, 38561, 39075, 39593, 40116, 40643,
+    41175, 41711, 42251, 42796, 43346, 43899, 44458, 45021,
+    45588, 46161, 46737, 47319, 47905, 48495, 49091, 49691,
+    50295, 50905, 51519, 52138, 52761, 53390, 54023, 54661,
+    55303, 55951, 56604, 57261, 57923, 58590, 59262, 59939,
+    60621, 61308, 62000, 62697, 63399, 64106, 64818, 65535
+};
+#endif
+
+#if NEO_BACKEND != NEO_BACKEND_SPI
+static uint8_t neo_corr8[3][256];                       /* [G,R,B][value], not encoded */
+#elif NEO_DITHER
+static uint16_t neo_corr16[3][256];                     /* [G,R,B][value], 1/256 steps */
+static uint32_t neo_gain16[3];                          /* linear 0..65535 -> 1/256 steps, Q32 */
+#else
+static uint8_t neo_enc_corr[NEO_CHANNELS][256][NEO_ENC_BYTES]; /* [wire slot][value] */
+#endif
+
+static uint8_t neo_brightness = NEO_BRIGHTNESS_DEFAULT;
+static uint8_t neo_balance[4] = { 255u, 255u, 255u, 255u };    /* wire order, NEO_CHANNELS used */
+
+static const uint8_t neo_wire_order[NEO_CHANNELS] = NEO_WIRE_ORDER;   /* colour per wire slot */
+
+static void NeoPixel_BuildCorrection(void)
+{
+    for (uint8_t c = 0; c < NEO_CHANNELS; c++)
+    {
+        uint32_t scale = (uint32_t)neo_brightness * neo_balance[c];     /* 0 .. 255^2 */
+
+#if NEO_DITHER
+        neo_gain16[c] = (uint32_t)((((uint64_t)scale * 65280u) << 32) / (65535u * 65025u));
+#endif
+
+        for (uint32_t v = 0; v < 256u; v++)
+        {
+#if NEO_GAMMA
+            uint64_t lin = neo_gamma16[v];
+#else
+            uint64_t lin = v * 257u;                                    /* 0 .. 65535 */
+#endif
+            /* round(lin/65535 * scale/65025 * 255) */
+            uint8_t out = (uint8_t)((lin * scale * 255u + 65535u * 65025u / 2u)
+                                    / (65535u * 65025u));
+#if NEO_BACKEND != NEO_BACKEND_SPI
+            neo_corr8[c][v] = out;
+#elif NEO_DITHER
+            (void)out;          /* full precision kept, quantised per frame */
+            neo_corr16[c][v] = (uint16_t)((lin * scale * 65280u + 65535u * 65025u / 2u)
+                                          / (65535u * 65025u));
+#else
+            memcpy(neo_enc_corr[c][v], neo_enc_lut[out], NEO_ENC_BYTES);
+#endif
+        }
+    }
+
+#if NEO_SKIP_UNCHANGED
+    neo_last_valid = false;     /* same pixels may now encode differently */
+#endif
+}
+
+#if (NEO_BACKEND == NEO_BACKEND_SPI) && !NEO_DITHER
+/* Corrected, encoded copy of colour byte v for wire slot c (WS2812B: 0 = G, 1 = R, 2 = B) */
+static inline void encode_byte(uint8_t c, uint8_t pixel_byte, uint8_t *out)
+{
+    const uint8_t *e = neo_enc_corr[c][pixel_byte];
+    for (uint8_t k = 0; k < NEO_ENC_BYTES; k++)
+        out[k] = e[k];
+}
+#endif
+
+#if NEO_BACKEND == NEO_BACKEND_SPI
+/* Transmit-only SPI master on GCLK3 at the chip profile's bit rate, with the
+ * data size in CTRLC; BAUD and CTRLC are enable-protected, so it is opened again */
+static void NeoPixel_SpiSetup(uint8_t sercom, uint32_t ctrlc)
+{
+    const sercom_cfg_t cfg = { SERCOM_SPI, 3u, 0u, 0u, 0u, (uint16_t)NEO_SPI_BAUD, ctrlc };
+
+    Sercom_Open(sercom, &cfg);
+    Sercom_Enable(sercom);
+}
+#endif
+
+void NeoPixel_SetBrightness(uint8_t brightness)
+{
+    neo_brightness = brightness;
+    NeoPixel_BuildCorrection();
+}
+
+uint8_t NeoPixel_GetBrightness(void)
+{
+    return neo_brightness;
+}
+
+void NeoPixel_SetWhiteBalance(uint8_t r, uint8_t g, uint8_t b)
+{
+    const uint8_t bal[4] = { r, g, b, 255u };   /* W is never balanced */
+
+    for (uint8_t c = 0; c < NEO_CHANNELS; c++)
+        neo_balance[c] = bal[neo_wire_order[c]];
+    NeoPixel_BuildCorrection();
+}
+
+/* ?? Public API implementation ???????????????????????????????????????????????? */
+
+#if NEO_BACKEND == NEO_BACKEND_CCL
+
+/* Stop TCC0 and park the counter at TOP, past both compares, so WO1/WO2 stay low */
+static void NeoPixel_CclStop(void)
+{
+    TCC0_REGS->TCC_CTRLBSET = TCC_CTRLBSET_CMD_STOP;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_CTRLB_Msk) != 0u) { }
+
+    TCC0_REGS->TCC_COUNT = TCC0_REGS->TCC_PER;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_COUNT_Msk) != 0u) { }
+}
+
+static void NeoPixel_CclInit(void)
+{
+    /* SERCOM0: 800 kHz SPI master from GCLK0. CPHA trailing edge, so each bit
+     * cell starts with the data change; its pads stay unmuxed (CCL taps them). */
+    static const sercom_cfg_t spi = { SERCOM_SPI, 0u, 0u, 0u, SERCOM_F_CPHA, NEO_CCL_SPI_BAUD, 0u };
+
+    Sercom_Open(0u, &spi);
+    Sercom_Enable(0u);
+
+    /* TCC0 is left NPWM / PER 149 by TCC0_PWMInitialize(); add the two pulse
+     * widths and let event 0 (the first DMA beat) start the counter. */
+    TCC0_REGS->TCC_CC[1]   = NEO_CCL_T0H_COUNTS;
+    TCC0_REGS->TCC_CC[2]   = NEO_CCL_T1H_COUNTS;
+    TCC0_REGS->TCC_EVCTRL |= TCC_EVCTRL_TCEI0_Msk | TCC_EVCTRL_EVACT0_START;
+    TCC0_REGS->TCC_CTRLA  |= TCC_CTRLA_ENABLE_Msk;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0u) { }
+    NeoPixel_CclStop();
+
+    /* EVSYS channel 1: DMAC channel beat -> TCC0 EV0 (USER value is channel + 1) */
+    DMAC_REGS->CHANNEL[DMAC_CHANNEL_CCL].DMAC_CHEVCTRL = DMAC_CHEVCTRL_EVOE_Msk | DMAC_CHEVCTRL_EVOMODE_DEFAULT;
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_TCC0_EV_0] = EVSYS_USER_CHANNEL(0x2U);
+    EVSYS_REGS->CHANNEL[1].EVSYS_CHANNEL = EVSYS_CHANNEL_EVGEN(EVENT_ID_GEN_DMAC_CH_2)
+                                         | EVSYS_CHANNEL_PATH(2U);              /* asynchronous */
+
+    /* CCL LUT0: IN0 = SERCOM0 PAD0 (MOSI), IN1 = TCC0 WO1, IN2 = TCC0 WO2.
+     * Truth table of IN1 | (IN0 & IN2) over index (IN2 IN1 IN0) = 0xEC. */
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_CCL_Msk;
+    CCL_REGS->CCL_LUTCTRL[0] = CCL_LUTCTRL_INSEL0_SERCOM | CCL_LUTCTRL_INSEL1_TCC | CCL_LUTCTRL_INSEL2_TCC
+                             | CCL_LUTCTRL_TRUTH(0xECu) | CCL_LUTCTRL_ENABLE_Msk;
+    CCL_REGS->CCL_CTRL = CCL_CTRL_ENABLE_Msk;
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA07, PERIPHERAL_FUNCTION_N);    /* CCL OUT0 */
+}
+
+void NeoPixel_Init(void)
+{
+    NeoPixel_BuildCorrection();
+    NeoPixel_RailInit();
+    memset(neo_pix, 0x00, sizeof(neo_pix));
+    neo_back  = neo_pix[0];
+    neo_front = neo_pix[1];
+    tx_busy   = false;
+
+    for (uint8_t k = 0; k < 2u; k++)
+    {
+        dmac_descriptor_registers_t *d = &neo_ccl_desc[k];
+
+        d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_BYTE
+                         | DMAC_BTCTRL_SRCINC_Msk | DMAC_BTCTRL_EVOSEL_BURST;
+        d->DMAC_BTCNT    = (uint16_t)NEO_PIX_BYTES;
+        d->DMAC_SRCADDR  = (uint32_t)&neo_pix[k][NEO_PIX_BYTES];    /* SRCINC: end address */
+        d->DMAC_DSTADDR  = (uint32_t)&SERCOM0_REGS->SPIM.SERCOM_DATA;
+        d->DMAC_DESCADDR = 0u;
+    }
+
+    NeoPixel_CclInit();
+    Dma_Assign(DMAC_CHANNEL_CCL, DMA_CLASS_REALTIME);
+    DMAC_ChannelCallbackRegister(DMAC_CHANNEL_CCL, NeoPixel_DMA_Callback, 0u);
+    (void)Sercom_Irq(0u, NeoPixel_CclTxc, IRQ_PRIO_NEO);     /* the frame's end */
+}
+
+#define NEO_STAGE_BYTES     3u          /* staged bytes per LED */
+
+static inline uint8_t *neo_stage_ptr(uint16_t index)
+{
+    return &neo_back[(uint32_t)index * 3u];
+}
+
+/* Stage one in-range pixel */
+static inline void neo_stage_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t *p = neo_stage_ptr(index);
+    p[0] = neo_corr8[0][g];  /* WS2812B / SK6812 wire order is G, R, B */
+    p[1] = neo_corr8[1][r];
+    p[2] = neo_corr8[2][b];
+}
+
+void NeoPixel_Clear(void)
+{
+    neo_back_sync();
+    neo_back_dma = DmaMem_Fill(neo_back, 0x00, NEO_PIX_BYTES);
+    neo_rail_staged(true, false);
+}
+
+#elif NEO_BACKEND == NEO_BACKEND_TCC
+
+#define NEO_TCC_NIB(n, i)   ((((n) >> (3u - (i))) & 1u) ? NEO_TCC_T1H_COUNTS : NEO_TCC_T0H_COUNTS)
+#define NEO_TCC_NIBBLE(n)   ((uint32_t)NEO_TCC_NIB(n, 0u)         | ((uint32_t)NEO_TCC_NIB(n, 1u) << 8)  \
+                           | ((uint32_t)NEO_TCC_NIB(n, 2u) << 16) | ((uint32_t)NEO_TCC_NIB(n, 3u) << 24))
+
+/* Duty bytes for 4 bits, MSB first in the lowest address (little-endian word) */
+static const uint32_t neo_tcc_nibble[16] =
+{
+    NEO_TCC_NIBBLE(0u),  NEO_TCC_NIBBLE(1u),  NEO_TCC_NIBBLE(2u),  NEO_TCC_NIBBLE(3u),
+    NEO_TCC_NIBBLE(4u),  NEO_TCC_NIBBLE(5u),  NEO_TCC_NIBBLE(6u),  NEO_TCC_NIBBLE(7u),
+    NEO_TCC_NIBBLE(8u),  NEO_TCC_NIBBLE(9u),  NEO_TCC_NIBBLE(10u), NEO_TCC_NIBBLE(11u),
+    NEO_TCC_NIBBLE(12u), NEO_TCC_NIBBLE(13u), NEO_TCC_NIBBLE(14u), NEO_TCC_NIBBLE(15u)
+};
+
+/* 8 duty bytes for one corrected colour byte; out is word aligned */
+static inline void duty_byte(uint8_t v, uint32_t *out)
+{
+    out[0] = neo_tcc_nibble[v >> 4];
+    out[1] = neo_tcc_nibble[v & 0x0Fu];
+}
+
+void NeoPixel_Init(void)
+{
+    NeoPixel_BuildCorrection();
+    NeoPixel_RailInit();
+    memset(neo_duty, 0x00, sizeof(neo_duty));
+    neo_back  = neo_duty[0];
+    neo_front = neo_duty[1];
+    tx_busy   = false;
+
+    /* Blank image, then the reset tail; the tail stays zero after this */
+    for (uint8_t k = 0; k < 2u; k++)
+    {
+        for (uint32_t i = 0; i < NEO_TCC_DATA_BYTES; i += 8u)
+            duty_byte(0u, (uint32_t *)&neo_duty[k][i]);
+
+        dmac_descriptor_registers_t *d = &neo_tcc_desc[k];
+
+        d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BLOCKACT_INT
+                         | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC_Msk;
+        d->DMAC_BTCNT    = (uint16_t)NEO_TCC_BUF_SIZE;
+        d->DMAC_SRCADDR  = (uint32_t)&neo_duty[k][NEO_TCC_BUF_SIZE];   /* SRCINC: end address */
+        d->DMAC_DSTADDR  = (uint32_t)&TCC0_REGS->TCC_CCBUF[0];         /* low byte, CC0 -> WO0 */
+        d->DMAC_DESCADDR = 0u;
+    }
+
+    /* DMAC_Initialize() triggers this channel from SERCOM1 TX; pace it by
+     * TCC0 overflow instead, one beat per bit period. */
+    DMAC_REGS->CHANNEL[DMAC_CHANNEL_NEO].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT(2U)
+                                                      | DMAC_CHCTRLA_TRIGSRC(TCC0_DMAC_ID_OVF);
+    Dma_Assign(DMAC_CHANNEL_NEO, DMA_CLASS_REALTIME);
+    DMAC_ChannelCallbackRegister(DMAC_CHANNEL_NEO, NeoPixel_DMA_Callback, 0u);
+
+    /* PA08 is already TCC0/WO0; run NPWM free with CC0 = 0 (line low) */
+    TCC0_REGS->TCC_CC[0] = 0u;
+    TCC0_PWMStart();
+}
+
+#define NEO_STAGE_BYTES     24u         /* staged bytes per LED */
+
+static inline uint8_t *neo_stage_ptr(uint16_t index)
+{
+    return &neo_back[(uint32_t)index * 24u];
+}
+
+/* Stage one in-range pixel */
+static inline void neo_stage_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint32_t *p = (uint32_t *)neo_stage_ptr(index);
+    duty_byte(neo_corr8[0][g], &p[0]);    /* WS2812B / SK6812 wire order is G, R, B */
+    duty_byte(neo_corr8[1][r], &p[2]);
+    duty_byte(neo_corr8[2][b], &p[4]);
+}
+
+void NeoPixel_Clear(void)
+{
+    neo_back_sync();
+    for (uint32_t i = 0; i < NEO_TCC_DATA_BYTES; i += 8u)
+        duty_byte(0u, (uint32_t *)&neo_back[i]);
+    neo_rail_staged(true, false);
+}
+
+#elif NEO_STREAMING
+
+/* Encode one chunk of the front frame in place of the chunk that just drained. */
+static void CACHE_HOT NeoPixel_ChunkPrepare(uint16_t chunk)
+{
+    dmac_descriptor_registers_t *d = &neo_desc[chunk & 1u];
+    uint8_t       *out  = neo_chunk[chunk & 1u];
+    const uint8_t *src  = &neo_front[(uint32_t)chunk * NEO_CHUNK_LEDS * NEO_CHANNELS];
+    uint32_t       leds = (uint32_t)NUM_LEDS - (uint32_t)chunk * NEO_CHUNK_LEDS;
+
+    if (leds > NEO_CHUNK_LEDS)
+        leds = NEO_CHUNK_LEDS;
+
+    for (uint32_t i = 0; i < leds; i++)
+    {
+        uint8_t *o = out + i * NEO_LED_BYTES;
+
+        for (uint8_t c = 0; c < NEO_CHANNELS; c++)
+            encode_byte(c, src[i * NEO_CHANNELS + c], o + c * NEO_ENC_BYTES);
+    }
+
+    d->DMAC_BTCNT    = (uint16_t)(leds * NEO_LED_BYTES);
+    d->DMAC_SRCADDR  = (uint32_t)(out + leds * NEO_LED_BYTES);     /* SRCINC: end address */
+    d->DMAC_DESCADDR = ((uint16_t)(chunk + 1u) < NEO_CHUNKS)
+                     ? (uint32_t)&neo_desc[(chunk + 1u) & 1u]
+                     : (uint32_t)&neo_tail_desc;
+}
+
+void NeoPixel_Init(void)
+{
+    NeoPixel_BuildCorrection();
+    NeoPixel_RailInit();
+    const uint16_t btctrl = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BLOCKACT_INT
+                          | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC_Msk;
+
+    memset(neo_pix, 0x00, sizeof(neo_pix));
+    neo_back  = neo_pix[0];
+    neo_front = neo_pix[1];
+    tx_busy   = false;
+
+    for (uint8_t k = 0; k < 2u; k++)
+    {
+        neo_desc[k].DMAC_BTCTRL  = btctrl;
+        neo_desc[k].DMAC_DSTADDR = (uint32_t)&SERCOM1_REGS->SPIM.SERCOM_DATA;
+    }
+    neo_tail_desc.DMAC_BTCTRL   = btctrl & (uint16_t)~DMAC_BTCTRL_SRCINC_Msk;
+    neo_tail_desc.DMAC_BTCNT    = NEO_RESET_BYTES;
+    neo_tail_desc.DMAC_SRCADDR  = (uint32_t)&neo_zero;                /* fixed source */
+    neo_tail_desc.DMAC_DSTADDR  = (uint32_t)&SERCOM1_REGS->SPIM.SERCOM_DATA;
+    neo_tail_desc.DMAC_DESCADDR = 0u;
+
+    NeoPixel_SpiSetup(1u, 0u);
+    Dma_Assign(DMAC_CHANNEL_NEO, DMA_CLASS_REALTIME);
+    Dma_FastRegister(DMAC_CHANNEL_NEO, NeoPixel_DMA_Fast);
+}
+
+#define NEO_STAGE_BYTES     NEO_CHANNELS    /* staged bytes per LED */
+
+static inline uint8_t *neo_stage_ptr(uint16_t index)
+{
+    return &neo_back[(uint32_t)index * NEO_CHANNELS];
+}
+
+/* Stage one in-range pixel, channels in the chip's wire order */
+static inline void neo_stage_rgbw(uint16_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+{
+    const uint8_t v[4] = { r, g, b, w };
+    uint8_t *p = neo_stage_ptr(index);
+
+    for (uint8_t c = 0; c < NEO_CHANNELS; c++)
+        p[c] = v[neo_wire_order[c]];
+}
+
+static inline void neo_stage_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    neo_stage_rgbw(index, r, g, b, 0u);
+}
+
+void NeoPixel_Clear(void)
+{
+    neo_back_sync();
+    neo_back_dma = DmaMem_Fill(neo_back, 0x00, NEO_PIX_BYTES);
+    neo_rail_staged(true, false);
+}
+
+#else
+
+#if NEO_DMA_WORDS
+#define NEO_DMA_BEATSIZE    DMAC_BTCTRL_BEATSIZE_WORD
+#define NEO_SPI_CTRLC       SERCOM_SPIM_CTRLC_DATA32B_Msk   /* DATA takes 4 bytes per write */
+#else
+#define NEO_DMA_BEATSIZE    DMAC_BTCTRL_BEATSIZE_BYTE
+#define NEO_SPI_CTRLC       0u
+#endif
+
+#if NEO_OUTPUTS > 1
+/* Bring up output o as the same transmit-only SPI master as output 0 (GCLK3,
+ * so every output has the same bit time) on its own pin. */
+static void NeoPixel_OutputInit(uint8_t o)
+{
+    switch (o)
+    {
+        case 1u:  PORT_PinPeripheralFunctionConfig(PORT_PIN_PA22, PERIPHERAL_FUNCTION_C); break;
+        case 2u:  PORT_PinPeripheralFunctionConfig(PORT_PIN_PA04, PERIPHERAL_FUNCTION_D); break;
+        default:  PORT_PinPeripheralFunctionConfig(PORT_PIN_PB12, PERIPHERAL_FUNCTION_C); break;
+    }
+    NeoPixel_SpiSetup(neo_out[o].sercom, NEO_SPI_CTRLC);
+}
+#endif /* NEO_OUTPUTS > 1 */
+
+#if NEO_HW_FRAME_START
+
+#define NEO_FRAME_CLK_HZ    1875000u    /* TCC0: 120 MHz GCLK0 / 64 */
+
+/*
+ * TCC0 as the frame clock: its overflow event reaches the DMA channel through
+ * EVSYS channel 0 (already routed by EVSYS_Initialize()). With EVACT CBLOCK a
+ * channel armed by Show() holds the SERCOM1 DRE trigger until that event, so
+ * the single block of the frame starts on the overflow.
+ */
+static void NeoPixel_FrameTimerInit(void)
+{
+    TCC0_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV64 | TCC_CTRLA_PRESCSYNC_PRESC | TCC_CTRLA_RUNSTDBY_Msk;
+    TCC0_REGS->TCC_PER   = (NEO_FRAME_CLK_HZ / NEO_HW_FRAME_HZ) - 1u;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_PER_Msk) != 0u) { }
+
+    /* MCC leaves the channel on the synchronous path with no edge selected
+     * (no events); TCC0 OVF is a pulse event, take the asynchronous path */
+    EVSYS_REGS->EVSYS_USER[EVENT_ID_USER_DMAC_CH_0 + (uint32_t)DMAC_CHANNEL_NEO] = EVSYS_USER_CHANNEL(0x1U);
+    EVSYS_REGS->CHANNEL[0].EVSYS_CHANNEL = EVSYS_CHANNEL_EVGEN(EVENT_ID_GEN_TCC0_OVF)
+                                         | EVSYS_CHANNEL_PATH(2U);
+    DMAC_REGS->CHANNEL[DMAC_CHANNEL_NEO].DMAC_CHEVCTRL = DMAC_CHEVCTRL_EVIE_Msk | DMAC_CHEVCTRL_EVACT_CBLOCK;
+
+    TCC0_PWMStart();            /* OVFEO is already set by TCC0_PWMInitialize() */
+}
+
+#endif /* NEO_HW_FRAME_START */
+
+/* First wire byte of LED index in the back image */
+static inline uint8_t *neo_wire_pixel(uint16_t index)
+{
+#if NEO_OUTPUTS > 1
+    uint32_t o = (uint32_t)index / NEO_SEG_LEDS;
+    return &neo_back[o * NEO_SEG_BUF_SIZE + ((uint32_t)index - o * NEO_SEG_LEDS) * NEO_LED_BYTES];
+#else
+    return &neo_back[(uint32_t)index * NEO_LED_BYTES];
+#endif
+}
+
+#if NEO_DITHER
+
+/* Linear light 0..65535 of a 16-bit input, interpolating the gamma table */
+static inline uint32_t neo_linear16(uint16_t v)
+{
+#if NEO_GAMMA
+    uint32_t t = (uint32_t)v * 255u;            /* table index in 8.16 */
+    uint32_t i = t >> 16;
+    uint32_t f = (t >> 8) & 0xFFu;
+    uint32_t a = neo_gamma16[i];
+    uint32_t b = (i < 255u) ? neo_gamma16[i + 1u] : 65535u;
+
+    return a + (((b - a) * f) >> 8);
+#else
+    return v;
+#endif
+}
+
+/* Quantise neo_px16 into the back image, carrying each residue to the next frame */
+static void NeoPixel_DitherEncode(void)
+{
+    PROFILE_START(t_enc);
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+    {
+        uint8_t *p = neo_wire_pixel(i);
+
+        for (uint8_t c = 0; c < 3u; c++, p += 3u)
+        {
+            uint32_t acc = (uint32_t)neo_px16[i][c] + neo_dither_err[i][c];   /* <= 65535 */
+            const uint8_t *e = neo_enc_lut[acc >> 8];
+
+            neo_dither_err[i][c] = (uint8_t)acc;
+            p[0] = e[0];
+            p[1] = e[1];
+            p[2] = e[2];
+        }
+    }
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
+}
+
+#endif /* NEO_DITHER */
+
+void NeoPixel_Init(void)
+{
+    NeoPixel_BuildCorrection();
+    NeoPixel_RailInit();
+    memset(neo_buf, 0x00, sizeof(neo_buf));
+    neo_back   = neo_buf[0];
+    neo_front  = neo_buf[1];
+    tx_busy    = false;
+    tx_pending = 0u;
+#if NEO_QUEUE_FRAMES
+    neo_q_head  = 0u;
+    neo_q_count = 0u;
+    HrTimer_Create(&neo_q_timer, NeoPixel_QueueDue, NULL, HRTIMER_ISR);
+#endif
+
+#if NEO_DITHER
+    /* Stagger the starting residues so neighbours do not step in unison */
+    memset(neo_px16, 0x00, sizeof(neo_px16));
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+        for (uint8_t c = 0; c < 3u; c++)
+            neo_dither_err[i][c] = (uint8_t)(((uint32_t)i * 3u + c) * 83u);
+#endif
+
+    NeoPixel_SpiSetup(1u, NEO_SPI_CTRLC);              /* profile bit rate, beat size */
+
+    for (uint8_t o = 0; o < NEO_OUTPUTS; o++)
+    {
+#if NEO_OUTPUTS > 1
+        if (o != 0u)
+            NeoPixel_OutputInit(o);
+#endif
+
+        /* The last segment may be short (or empty); it still sends its reset tail */
+        uint32_t first  = (uint32_t)o * NEO_SEG_LEDS;
+        uint32_t leds   = ((uint32_t)NUM_LEDS > first) ? (uint32_t)NUM_LEDS - first : 0u;
+        if (leds > NEO_SEG_LEDS)
+            leds = NEO_SEG_LEDS;
+        uint32_t bytes  = ((leds * NEO_LED_BYTES + NEO_DMA_BEAT - 1u) / NEO_DMA_BEAT) * NEO_DMA_BEAT;
+        uint32_t blocks = (bytes + NEO_DMA_BLOCK_MAX - 1u) / NEO_DMA_BLOCK_MAX;
+        dmac_descriptor_registers_t *tail = &neo_zero_desc[o];
+
+        tail->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | NEO_DMA_BEATSIZE | DMAC_BTCTRL_BLOCKACT_INT;
+        tail->DMAC_BTCNT    = (uint16_t)NEO_RESET_BEATS;
+        tail->DMAC_SRCADDR  = (uint32_t)&neo_zero;                   /* no SRCINC: fixed */
+        tail->DMAC_DSTADDR  = (uint32_t)&neo_out[o].spi->SPIM.SERCOM_DATA;
+        tail->DMAC_DESCADDR = 0u;
+
+        /* Every LED of a constant frame is the same: all outputs read its start */
+        for (uint8_t k = 0; k < NEO_CHAINS; k++)
+        {
+            const uint8_t *seg = (k < NEO_IMAGES)
+                               ? &neo_buf[k][(uint32_t)o * NEO_SEG_BUF_SIZE]
+                               : neo_const_frame[k - NEO_IMAGES].led[0].ch[0];
+
+            for (uint32_t n = 0; n < blocks; n++)
+            {
+                dmac_descriptor_registers_t *d = &neo_wire_desc[k][o][n];
+                uint32_t off  = n * NEO_DMA_BLOCK_MAX;
+                uint32_t len  = bytes - off;
+                bool     last = (n + 1u == blocks);
+
+                if (len > NEO_DMA_BLOCK_MAX)
+                    len = NEO_DMA_BLOCK_MAX;
+
+                d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | NEO_DMA_BEATSIZE | DMAC_BTCTRL_SRCINC_Msk
+                                 | DMAC_BTCTRL_BLOCKACT_NOACT;
+                d->DMAC_BTCNT    = (uint16_t)(len / NEO_DMA_BEAT);
+                d->DMAC_SRCADDR  = (uint32_t)&seg[off + len];          /* SRCINC: end address */
+                d->DMAC_DSTADDR  = (uint32_t)&neo_out[o].spi->SPIM.SERCOM_DATA;
+                d->DMAC_DESCADDR = last ? (uint32_t)tail : (uint32_t)&neo_wire_desc[k][o][n + 1u];
+            }
+        }
+
+        Dma_Assign(neo_out[o].ch, DMA_CLASS_REALTIME);
+        DMAC_ChannelCallbackRegister(neo_out[o].ch, NeoPixel_DMA_Callback, (uintptr_t)o);
+    }
+
+#if NEO_HW_FRAME_START
+    NeoPixel_FrameTimerInit();
+#endif
+}
+
+#if NEO_DITHER
+
+#define NEO_STAGE_BYTES     sizeof(neo_px16[0])    /* staged bytes per LED */
+
+static inline uint8_t *neo_stage_ptr(uint16_t index)
 {
-    (void)context;
-    if (event == DMAC_TRANSFER_EVENT_COMPLETE)
-        tx_done = true;
+    return (uint8_t *)neo_px16[index];
 }
 
-/* ?? Bit encoding ????????????????????????????????????????????????????????????? */
+/* Stage one in-range pixel */
+static inline void neo_stage_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint16_t *p = neo_px16[index];
+    p[0] = neo_corr16[0][g];     /* WS2812B / SK6812 wire order is G, R, B */
+    p[1] = neo_corr16[1][r];
+    p[2] = neo_corr16[2][b];
+}
+
+void NeoPixel_SetPixel16(uint16_t index, uint16_t r, uint16_t g, uint16_t b)
+{
+    if (index >= NUM_LEDS) return;
+    neo_rail_staged(false, (r | g | b) != 0u);
+
+    uint16_t *p = neo_px16[index];
+    p[0] = (uint16_t)(((uint64_t)neo_linear16(g) * neo_gain16[0]) >> 32);
+    p[1] = (uint16_t)(((uint64_t)neo_linear16(r) * neo_gain16[1]) >> 32);
+    p[2] = (uint16_t)(((uint64_t)neo_linear16(b) * neo_gain16[2]) >> 32);
+}
+
+#else
+
+#define NEO_STAGE_BYTES     NEO_LED_BYTES   /* staged bytes per LED */
+#define NEO_STAGE_RUN       NEO_SEG_LEDS    /* LEDs contiguous in the wire image */
+
+static inline uint8_t *neo_stage_ptr(uint16_t index)
+{
+    return neo_wire_pixel(index);
+}
+
+/* Stage one in-range pixel, channels in the chip's wire order */
+static inline void neo_stage_rgbw(uint16_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+{
+    const uint8_t v[4] = { r, g, b, w };
+    uint8_t *p = neo_wire_pixel(index);
+
+    for (uint8_t c = 0; c < NEO_CHANNELS; c++)
+        encode_byte(c, v[neo_wire_order[c]], p + c * NEO_ENC_BYTES);
+}
+
+static inline void neo_stage_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    neo_stage_rgbw(index, r, g, b, 0u);
+}
+
+#endif /* NEO_DITHER */
+
+void NeoPixel_Clear(void)
+{
+    NeoPixel_FillSolid(0u, NUM_LEDS, 0u);
+}
+
+#endif /* NEO_BACKEND / NEO_STREAMING */
+
+#ifndef NEO_STAGE_RUN
+#define NEO_STAGE_RUN       NUM_LEDS    /* whole strip is one contiguous staging run */
+#endif
+
+/* ?? Staging ?????????????????????????????????????????????????????????????????? */
 
 /*
- * encode_byte()
- * Converts one 8-bit NeoPixel colour component into 3 SPI bytes.
- *
- * Each NeoPixel bit ? 3 SPI bits:
- *   pixel '1'  ?  1 1 0  (0x6)
- *   pixel '0'  ?  1 0 0  (0x4)
- *
- * 8 pixel bits  3 SPI bits = 24 SPI bits = 3 bytes, packed MSB-first.
- *
- * Example: pixel byte 0xC0 = 1100 0000
- *   bit7=1 ? 110 | bit6=1 ? 110 | bit5=0 ? 100 | bit4=0 ? 100 | ?
- *   24-bit SPI word = 110 110 100 100 100 100 100 100
- *                   = 1101 1010 0100 1001 0010 0100
- *                   = 0xDA  0x49  0x24
+ * Clip [start, start + count) to the strip once; returns the in-range count.
  */
-static inline void encode_byte(uint8_t pixel_byte, uint8_t *out)
+static inline uint16_t neo_clip(uint16_t start, uint16_t count)
 {
-    uint32_t word = 0;
-    for (int8_t i = 7; i >= 0; i--)
+    if (start >= NUM_LEDS) return 0u;
+    return (count > NUM_LEDS - start) ? (uint16_t)(NUM_LEDS - start) : count;
+}
+
+void NeoPixel_SetPixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (index >= NUM_LEDS) return;
+    neo_back_sync();
+    neo_rail_staged(false, (r | g | b) != 0u);
+
+    PROFILE_START(t_enc);
+    neo_stage_pixel(index, r, g, b);
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
+}
+
+void NeoPixel_SetPixelRGBW(uint16_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+{
+#if NEO_CHANNELS == 4u
+    if (index >= NUM_LEDS) return;
+    neo_back_sync();
+    neo_rail_staged(false, (r | g | b | w) != 0u);
+
+    PROFILE_START(t_enc);
+    neo_stage_rgbw(index, r, g, b, w);
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
+#else
+    (void)w;
+    NeoPixel_SetPixel(index, r, g, b);
+#endif
+}
+
+void CACHE_HOT NeoPixel_WriteSpan(uint16_t start, const pix_t *src, uint16_t count)
+{
+    pix_t any = 0u;
+
+    count = neo_clip(start, count);
+    neo_back_sync();
+
+    PROFILE_START(t_enc);
+    for (uint16_t i = 0; i < count; i++)
     {
-        word = (word << 3u) | (((pixel_byte >> i) & 1u) ? 0x6u : 0x4u);
+        any |= src[i];
+        neo_stage_pixel((uint16_t)(start + i), Pix_R(src[i]), Pix_G(src[i]), Pix_B(src[i]));
     }
-    out[0] = (uint8_t)(word >> 16u);
-    out[1] = (uint8_t)(word >>  8u);
-    out[2] = (uint8_t)(word        );
+    neo_rail_staged(count == NUM_LEDS, any != 0u);
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
 }
 
-/* ?? Public API implementation ???????????????????????????????????????????????? */
+void CACHE_HOT NeoPixel_FillSolid(uint16_t start, uint16_t count, pix_t colour)
+{
+    count = neo_clip(start, count);
+    neo_back_sync();
+    neo_rail_staged(count == NUM_LEDS, colour != 0u);
 
-void NeoPixel_Init(void)
+    PROFILE_START(t_enc);
+    while (count != 0u)
+    {
+        /* Encode the first LED of the run, then double the copied region */
+        uint16_t run = (uint16_t)(NEO_STAGE_RUN - start % NEO_STAGE_RUN);
+        if (run > count)
+            run = count;
+
+        uint8_t *p     = neo_stage_ptr(start);
+        uint32_t total = (uint32_t)run * NEO_STAGE_BYTES;
+        uint32_t done  = NEO_STAGE_BYTES;
+
+        neo_stage_pixel(start, Pix_R(colour), Pix_G(colour), Pix_B(colour));
+        while (done < total)
+        {
+            uint32_t n = (done < total - done) ? done : total - done;
+
+            memcpy(p + done, p, n);
+            done += n;
+        }
+
+        start  = (uint16_t)(start + run);
+        count  = (uint16_t)(count - run);
+    }
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
+}
+
+#if NEO_SKIP_UNCHANGED
+/*
+ * CRC-32 of the staged frame through the DMAC CRC engine (CPU-fed IO mode,
+ * word beats). Returns true when it matches the last frame put on the wire.
+ */
+static bool NeoPixel_FrameUnchanged(void)
 {
-    memset(neo_buf, 0x00, sizeof(neo_buf));
-    DMAC_ChannelCallbackRegister(DMAC_CHANNEL_NEO, NeoPixel_DMA_Callback, 0u);
+    uint32_t crc;
+
+    /* crc.c's engine, busy with a QSPI or plugin check: send, and forget
+     * the last CRC, as this frame has none */
+    if (!Crc_TryBuffer(neo_back, NEO_STAGED_BYTES, &crc))
+    {
+        neo_last_valid = false;
+        return false;
+    }
+
+    if (neo_last_valid && (crc == neo_last_crc))
+        return true;
+
+    neo_last_crc   = crc;
+    neo_last_valid = true;
+    return false;
 }
+#endif /* NEO_SKIP_UNCHANGED */
 
-void NeoPixel_SetPixel(uint8_t index, uint8_t r, uint8_t g, uint8_t b)
+#if !NEO_DITHER
+/* Without the 16-bit framebuffer the extra precision is rounded away */
+void NeoPixel_SetPixel16(uint16_t index, uint16_t r, uint16_t g, uint16_t b)
 {
-    if (index >= NUM_LEDS) return;
+    NeoPixel_SetPixel(index, (uint8_t)(((uint32_t)r + 128u) / 257u),
+                             (uint8_t)(((uint32_t)g + 128u) / 257u),
+                             (uint8_t)(((uint32_t)b + 128u) / 257u));
+}
+#endif
 
-    uint8_t *p = &neo_buf[(uint16_t)index * 9u];
-    encode_byte(g, p);       /* WS2812B / SK6812 wire order is G ? R ? B */
-    encode_byte(r, p + 3u);
-    encode_byte(b, p + 6u);
+void CACHE_HOT NeoPixel_SetStrip(const pix_t *px)
+{
+    NeoPixel_WriteSpan(0u, px, NUM_LEDS);
 }
 
-void NeoPixel_Clear(void)
+void CACHE_HOT NeoPixel_SetPlanes(const pix_planes_t *pl)
+{
+    const uint8_t *r   = (const uint8_t *)pl->r;
+    const uint8_t *g   = (const uint8_t *)pl->g;
+    const uint8_t *b   = (const uint8_t *)pl->b;
+    uint32_t       any = 0u;
+
+    neo_back_sync();
+
+    PROFILE_START(t_enc);
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+    {
+        any |= (uint32_t)r[i] | g[i] | b[i];
+        neo_stage_pixel(i, r[i], g[i], b[i]);
+    }
+    neo_rail_staged(true, any != 0u);
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
+}
+
+#if NEO_STREAMING
+uint8_t *NeoPixel_StageBytes(void)
+{
+    neo_back_sync();
+    neo_rail_staged(false, true);       /* raw bytes: assume lit */
+    return neo_back;
+}
+#endif
+
+#if (NEO_BACKEND == NEO_BACKEND_SPI) && !NEO_STREAMING
+/* Start chain k, a wire image or a constant frame, on every output. Masked */
+static void NeoPixel_StartChain(uint8_t k)
+{
+    tx_pending = NEO_OUTPUTS;
+    for (uint8_t o = 0; o < NEO_OUTPUTS; o++)
+        DMAC_ChannelLinkedListTransfer(neo_out[o].ch,
+                                       (neo_wire_desc[k][o][0].DMAC_BTCNT != 0u)
+                                       ? neo_wire_desc[k][o] : &neo_zero_desc[o]);
+}
+#endif
+
+/* Stop a transfer that never completed; runs in a critical section */
+static void NeoPixel_Abort(void)
+{
+#if NEO_BACKEND == NEO_BACKEND_CCL
+    DMAC_ChannelDisable(DMAC_CHANNEL_CCL);
+    SERCOM0_REGS->SPIM.SERCOM_INTENCLR = (uint8_t)SERCOM_SPIM_INTENCLR_TXC_Msk;
+    NeoPixel_CclStop();
+    neo_latch_tick = xTaskGetTickCount();
+#elif (NEO_BACKEND == NEO_BACKEND_TCC) || NEO_STREAMING
+    DMAC_ChannelDisable(DMAC_CHANNEL_NEO);
+#else
+    for (uint8_t o = 0; o < NEO_OUTPUTS; o++)
+        DMAC_ChannelDisable(neo_out[o].ch);
+    tx_pending = 0u;
+#if NEO_QUEUE_FRAMES
+    (void)HrTimer_Stop(&neo_q_timer);
+    neo_q_count = 0u;           /* the frames behind it would be late anyway */
+#endif
+#endif
+    tx_busy = false;
+}
+
+#if NEO_QUEUE_FRAMES
+
+/* ?? Frame queue ?????????????????????????????????????????????????????????????? */
+
+/* Start the head frame on every output. Queue ISRs, masked */
+static void NeoPixel_QueueKick(void)
+{
+    uint8_t k = neo_q_img[neo_q_head];
+
+    if (neo_q_timed[neo_q_head] && ShowClock_Until(neo_q_at[neo_q_head]) < -(int32_t)HRTIMER_LATE_US)
+        neo_stats.overdue++;
+
+    tx_start   = xTaskGetTickCountFromISR();
+    tx_busy    = true;
+    neo_stats.frames++;
+    FrameStat_Shown();
+    NeoPixel_StartChain(k);
+}
+
+/* Show clock ISR: the head frame's present time */
+static void NeoPixel_QueueDue(hrtimer_t *t, void *arg)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    (void)t;
+    (void)arg;
+    if (!tx_busy && neo_q_count != 0u)
+        NeoPixel_QueueKick();
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/* DMA callback: the head frame is off the wire, its image is free again */
+static void NeoPixel_QueueNext(void)
+{
+    neo_q_head = (uint8_t)((neo_q_head + 1u) % NEO_QUEUE_FRAMES);
+    neo_q_count--;
+    if (neo_q_count != 0u)
+        HrTimer_StartAt(&neo_q_timer, neo_q_at[neo_q_head], 0u);    /* past due: at once */
+}
+
+/* An image neither queued nor on the wire; one always is after a push. Masked */
+static uint8_t *NeoPixel_QueueFree(void)
+{
+    for (uint8_t k = 0; k < NEO_IMAGES; k++)
+    {
+        bool used = false;
+
+        for (uint8_t n = 0; n < neo_q_count; n++)
+            used = used || (neo_q_img[(neo_q_head + n) % NEO_QUEUE_FRAMES] == k);
+        if (!used)
+            return neo_buf[k];
+    }
+    return neo_back;            /* not reached */
+}
+
+/*
+ * Block until at most `max` frames are queued. Only a frame that stays on
+ * the wire past the timeout is aborted, not one waiting for its time.
+ */
+static void NeoPixel_QueueWait(uint8_t max)
+{
+    tx_waiter = xTaskGetCurrentTaskHandle();
+    while (neo_q_count > max)
+    {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NEO_TX_TIMEOUT_MS)) != 0u)
+            continue;
+
+        taskENTER_CRITICAL();
+        if (tx_busy && (TickType_t)(xTaskGetTickCount() - tx_start) > pdMS_TO_TICKS(NEO_TX_TIMEOUT_MS))
+        {
+            NeoPixel_Abort();
+            neo_stats.timeouts++;
+        }
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*
+ * Queue chain k for its present time. The staged image (Show()) is replaced
+ * by a free one, refreshed from it; a constant frame leaves it as it is.
+ */
+static void NeoPixel_QueuePush(uint8_t k)
+{
+    uint8_t  n;
+    uint32_t at;
+
+    PROFILE_START(t_wait);
+    NeoPixel_QueueWait(NEO_QUEUE_FRAMES - 1u);     /* room for this one */
+    PROFILE_ADD(PROFILE_DMA_WAIT, t_wait);
+    LATBENCH_FRAME();
+
+    at = neo_q_next_set ? neo_q_next_at : ShowClock_Now();
+
+    taskENTER_CRITICAL();
+    n = (uint8_t)((neo_q_head + neo_q_count) % NEO_QUEUE_FRAMES);
+    neo_q_img[n]   = k;
+    neo_q_at[n]    = at;
+    neo_q_timed[n] = neo_q_next_set;
+    neo_q_count++;
+    if (neo_q_count == 1u)
+        HrTimer_StartAt(&neo_q_timer, at, 0u);
+    if (k < NEO_IMAGES)
+    {
+        neo_front = neo_back;
+        neo_back  = NeoPixel_QueueFree();
+    }
+    taskEXIT_CRITICAL();
+    neo_q_next_set = false;
+
+    /* As with two images: the new back image starts as a copy of this frame */
+    if (k < NEO_IMAGES)
+        neo_back_dma = DmaMem_Copy(neo_back, neo_front, NEO_BUF_SIZE);
+}
+
+void NeoPixel_SetPresentTime(uint32_t at)
+{
+    neo_q_next_at  = at;
+    neo_q_next_set = true;
+}
+
+uint8_t NeoPixel_Queued(void)
+{
+    return neo_q_count;
+}
+
+#endif /* NEO_QUEUE_FRAMES */
+
+void NeoPixel_Wait(void)
+{
+#if NEO_QUEUE_FRAMES
+    NeoPixel_QueueWait(0u);
+#else
+    while (tx_busy)
+    {
+        /* Woken by NeoPixel_DMA_Callback; a timeout means the transfer is lost */
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NEO_TX_TIMEOUT_MS)) != 0u)
+            continue;
+
+        taskENTER_CRITICAL();
+        if (tx_busy)
+        {
+            NeoPixel_Abort();
+            neo_stats.timeouts++;
+        }
+        taskEXIT_CRITICAL();
+    }
+#endif
+}
+
+void NeoPixel_GetStats(neo_tx_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = neo_stats;
+    taskEXIT_CRITICAL();
+}
+
+void NeoPixel_ResetStats(void)
+{
+    taskENTER_CRITICAL();
+    neo_stats.frames     = 0u;
+    neo_stats.dma_errors = 0u;
+    neo_stats.spi_errors = 0u;
+    neo_stats.timeouts   = 0u;
+    neo_stats.late       = 0u;
+    neo_stats.overdue    = 0u;
+    neo_stats.rail_wakes = 0u;
+    taskEXIT_CRITICAL();
+}
+
+void CACHE_HOT NeoPixel_Show(void)
+{
+#if !NEO_QUEUE_FRAMES
+    uint8_t *staged;
+#endif
+
+    neo_back_sync();            /* a Clear() or the last refresh may still run */
+#if NEO_DITHER
+    NeoPixel_DitherEncode();    /* new quantisation every frame, even for a still image */
+#endif
+
+#if NEO_SKIP_UNCHANGED
+    /* Strip already shows this frame: no DMA, no completion interrupt */
+    if (NeoPixel_FrameUnchanged())
+        return;
+#endif
+
+#if NEO_RAIL_GATE
+    if (!NeoPixel_RailFrame(neo_dark || neo_brightness == 0u))
+        return;                 /* dark, and the strip is not even powered */
+#endif
+
+#if NEO_QUEUE_FRAMES
+    /* The show clock starts it */
+    NeoPixel_QueuePush((uint8_t)((neo_back - neo_buf[0]) / NEO_BUF_SIZE));
+#else
+    PROFILE_START(t_wait);
+    NeoPixel_Wait();            /* previous frame must be off the wire */
+    PROFILE_ADD(PROFILE_DMA_WAIT, t_wait);
+
+    staged    = neo_back;
+    neo_back  = neo_front;
+    neo_front = staged;
+
+    tx_waiter = xTaskGetCurrentTaskHandle();
+    tx_start  = xTaskGetTickCount();
+    tx_busy   = true;
+    neo_stats.frames++;
+    FrameStat_Shown();
+    LATBENCH_FRAME();
+
+#if NEO_BACKEND == NEO_BACKEND_CCL
+    {
+        /* CCL has no reset tail: keep the line idle long enough to latch */
+        TickType_t idle = xTaskGetTickCount() - neo_latch_tick;
+        if (idle < NEO_CCL_LATCH_TICKS)
+            vTaskDelay(NEO_CCL_LATCH_TICKS - idle);
+        tx_start = xTaskGetTickCount();
+    }
+
+    SERCOM0_REGS->SPIM.SERCOM_INTFLAG = (uint8_t)SERCOM_SPIM_INTFLAG_TXC_Msk;
+    DMAC_ChannelLinkedListTransfer(DMAC_CHANNEL_CCL,
+                                   &neo_ccl_desc[(neo_front == neo_pix[0]) ? 0u : 1u]);
+
+    /* Keep the new back frame current so incremental SetPixel() users work */
+    neo_back_dma = DmaMem_Copy(neo_back, neo_front, NEO_PIX_BYTES);
+#elif NEO_BACKEND == NEO_BACKEND_TCC
+    DMAC_ChannelLinkedListTransfer(DMAC_CHANNEL_NEO,
+                                   &neo_tcc_desc[(neo_front == neo_duty[0]) ? 0u : 1u]);
+
+    /* Keep the new back frame current so incremental SetPixel() users work */
+    neo_back_dma = DmaMem_Copy(neo_back, neo_front, NEO_TCC_DATA_BYTES);
+#elif NEO_STREAMING
+    neo_blocks_done = 0u;
+
+    /* Only the two primed chunks are profiled; the rest are encoded in the ISR */
+    PROFILE_START(t_enc);
+    NeoPixel_ChunkPrepare(0u);
+    if (NEO_CHUNKS > 1u)
+        NeoPixel_ChunkPrepare(1u);
+    PROFILE_ADD(PROFILE_ENCODE, t_enc);
+
+#if IRQSTAT_ENABLE
+    neo_chunk_due = CpuFreq_Cycles() + NEO_CHUNK_CYCLES;
+#endif
+    DMAC_ChannelLinkedListTransfer(DMAC_CHANNEL_NEO, &neo_desc[0]);
+
+    /* Keep the new back frame current so incremental SetPixel() users work */
+    neo_back_dma = DmaMem_Copy(neo_back, neo_front, NEO_PIX_BYTES);
+#else
+    {
+        uint8_t k = (neo_front == neo_buf[0]) ? 0u : 1u;
+
+        /* Start every output back to back so the segments latch together */
+        taskENTER_CRITICAL();
+        NeoPixel_StartChain(k);
+        taskEXIT_CRITICAL();
+    }
+
+    /*
+     * Bring the new back buffer up to date while the DMA runs so callers that
+     * only touch a few pixels per frame keep working. The DMAC only reads the
+     * front buffer. A BULK channel copies it (dmamem.h); the next call that
+     * stages waits.
+     */
+    neo_back_dma = DmaMem_Copy(neo_back, neo_front, NEO_BUF_SIZE);
+#endif /* NEO_BACKEND / NEO_STREAMING */
+#endif /* NEO_QUEUE_FRAMES */
+}
+
+#define NEO_X_FRAME_NAME(id, name, ...)     name,
+
+static const char *const neo_frame_name[NEO_FRAME_COUNT] = { SHOW_FRAMES(NEO_X_FRAME_NAME) };
+
+const char *NeoPixel_FrameName(neo_frame_id_t id)
 {
-    for (uint8_t i = 0; i < NUM_LEDS; i++)
-        NeoPixel_SetPixel(i, 0u, 0u, 0u);
+    return ((uint32_t)id < NEO_FRAME_COUNT) ? neo_frame_name[id] : "?";
 }
 
-void NeoPixel_Show(void)
+#if (NEO_BACKEND == NEO_BACKEND_SPI) && !NEO_STREAMING
+bool NeoPixel_ShowFrame(neo_frame_id_t id)
 {
-    tx_done = false;
+    uint32_t budget = Power_Budget();
 
-    DMAC_ChannelTransfer(
-        DMAC_CHANNEL_NEO,
-        (const void *)neo_buf,
-        (const void *)&SERCOM1_REGS->SPIM.SERCOM_DATA,
-        NEO_BUF_SIZE
-    );
+    if ((uint32_t)id >= NEO_FRAME_COUNT || NeoPixel_GetBrightness() == 0u
+        || (budget != 0u && neo_const_ma[id] > budget))
+        return false;
+#if NEO_RAIL_GATE
+    if (!NeoPixel_RailFrame(neo_const_dark[id]))
+        return true;            /* a black frame on an unpowered strip */
+#endif
 
-    while (!tx_done)
+#if NEO_QUEUE_FRAMES
+    NeoPixel_QueuePush((uint8_t)(NEO_IMAGES + id));
+#else
+    PROFILE_START(t_wait);
+    NeoPixel_Wait();            /* previous frame must be off the wire */
+    PROFILE_ADD(PROFILE_DMA_WAIT, t_wait);
+
+    tx_waiter = xTaskGetCurrentTaskHandle();
+    tx_start  = xTaskGetTickCount();
+    tx_busy   = true;
+    neo_stats.frames++;
+    FrameStat_Shown();
+    LATBENCH_FRAME();
+
+    /* One descriptor per output: the back and front images stay as they were */
+    taskENTER_CRITICAL();
+    NeoPixel_StartChain((uint8_t)(NEO_IMAGES + id));
+    taskEXIT_CRITICAL();
+#endif
+
+#if NEO_SKIP_UNCHANGED
+    neo_last_valid = false;     /* the strip no longer shows the last frame staged */
+#endif
+    return true;
+}
+
+void NeoPixel_ShowBootFrame(void)
+{
+#if NEO_RAIL_GATE
+    NeoPixel_RailSettle(false);     /* up since Init(); no scheduler to sleep on */
+#endif
+    /* Its completion interrupt may wait for the scheduler: nobody to notify */
+    tx_waiter = NULL;
+    tx_start  = 0u;
+    tx_busy   = true;
+    NeoPixel_StartChain((uint8_t)(NEO_IMAGES + NEO_BOOT_FRAME));
+}
+#else
+bool NeoPixel_ShowFrame(neo_frame_id_t id)
+{
+    (void)id;
+    return false;               /* no full SPI frames to chain */
+}
+
+void NeoPixel_ShowBootFrame(void)
+{
+}
+#endif
+
+/* ?? Self test ???????????????????????????????????????????????????????????????? */
+
+#if !defined(NDEBUG) && (NEO_BACKEND == NEO_BACKEND_SPI)
+/* Reference encoder: one SPI group per colour bit, MSB first, no table */
+static uint32_t NeoPixel_EncodeRef(uint8_t v)
+{
+    uint32_t w = 0u;
+
+    for (int8_t i = 7; i >= 0; i--)
+        w = (w << NEO_SPI_BITS) | ((((uint32_t)v >> i) & 1u) ? NEO_SPI_ONE : NEO_SPI_ZERO);
+    return w;
+}
+
+uint8_t NeoPixel_SelfTest(void)
+{
+    uint8_t fails = 0u;
+
+    /* Every table entry against the bit loop, as big-endian SPI bytes */
+    for (uint16_t v = 0; v < 256u; v++)
+    {
+        uint32_t w = NeoPixel_EncodeRef((uint8_t)v);
+
+        for (uint8_t b = 0; b < NEO_ENC_BYTES; b++)
+        {
+            if (neo_enc_lut[v][b] != (uint8_t)(w >> (8u * (NEO_ENC_BYTES - 1u - b))))
+            {
+                fails++;
+                break;
+            }
+        }
+    }
+
+#if NEO_CHIP == NEO_CHIP_WS2812B
+    /* Golden vector: 0xA5 = 1010 0101 -> 110 100 110 100 100 110 100 110 */
+    if (neo_enc_lut[0xA5][0] != 0xD3u || neo_enc_lut[0xA5][1] != 0x49u
+        || neo_enc_lut[0xA5][2] != 0xA6u)
+        fails++;
+#endif
+
+#if !NEO_STREAMING
+    /* The beat padding after each segment stays low in every wire image */
+    for (uint8_t k = 0; k < NEO_IMAGES; k++)
     {
-        /* optionally: asm("nop"); */
+        for (uint8_t o = 0; o < NEO_OUTPUTS; o++)
+        {
+            const uint8_t *seg = &neo_buf[k][(uint32_t)o * NEO_SEG_BUF_SIZE];
+
+            for (uint32_t i = NEO_SEG_LEDS * NEO_LED_BYTES; i < NEO_SEG_BUF_SIZE; i++)
+            {
+                if (seg[i] != 0u)
+                {
+                    fails++;
+                    break;
+                }
+            }
+        }
     }
+#endif
+    return fails;
 }
+#endif /* !NDEBUG && NEO_BACKEND_SPI */
 
 /* ?? Colour helpers ??????????????????????????????????????????????????????????? */
 
+/*
+ * NeoPixel_HSVtoRGB(h, 255, 255) for every hue, packed (see pixmath.h). Lower
+ * saturation and value are applied with two packed scales instead of the
+ * divide and six-way switch of the scalar version.
+ */
+static const pix_t neo_hue_lut[256] =
+{
+    0x0000FFu, 0x0006FFu, 0x000CFFu, 0x0012FFu, 0x0018FFu, 0x001EFFu, 0x0024FFu, 0x002AFFu,
+    0x0030FFu, 0x0036FFu, 0x003CFFu, 0x0042FFu, 0x0048FFu, 0x004EFFu, 0x0054FFu, 0x005AFFu,
+    0x0060FFu, 0x0066FFu, 0x006CFFu, 0x0072FFu, 0x0078FFu, 0x007EFFu, 0x0084FFu, 0x008AFFu,
+    0x0090FFu, 0x0096FFu, 0x009CFFu, 0x00A2FFu, 0x00A8FFu, 0x00AEFFu, 0x00B4FFu, 0x00BAFFu,
+    0x00C0FFu, 0x00C6FFu, 0x00CCFFu, 0x00D2FFu, 0x00D8FFu, 0x00DEFFu, 0x00E4FFu, 0x00EAFFu,
+    0x00F0FFu, 0x00F6FFu, 0x00FCFFu, 0x00FFFEu, 0x00FFF9u, 0x00FFF3u, 0x00FFEDu, 0x00FFE7u,
+    0x00FFE1u, 0x00FFDBu, 0x00FFD5u, 0x00FFCFu, 0x00FFC9u, 0x00FFC3u, 0x00FFBDu, 0x00FFB7u,
+    0x00FFB1u, 0x00FFABu, 0x00FFA5u, 0x00FF9Fu, 0x00FF99u, 0x00FF93u, 0x00FF8Du, 0x00FF87u,
+    0x00FF81u, 0x00FF7Bu, 0x00FF75u, 0x00FF6Fu, 0x00FF69u, 0x00FF63u, 0x00FF5Du, 0x00FF57u,
+    0x00FF51u, 0x00FF4Bu, 0x00FF45u, 0x00FF3Fu, 0x00FF39u, 0x00FF33u, 0x00FF2Du, 0x00FF27u,
+    0x00FF21u, 0x00FF1Bu, 0x00FF15u, 0x00FF0Fu, 0x00FF09u, 0x00FF03u, 0x00FF00u, 0x06FF00u,
+    0x0CFF00u, 0x12FF00u, 0x18FF00u, 0x1EFF00u, 0x24FF00u, 0x2AFF00u, 0x30FF00u, 0x36FF00u,
+    0x3CFF00u, 0x42FF00u, 0x48FF00u, 0x4EFF00u, 0x54FF00u, 0x5AFF00u, 0x60FF00u, 0x66FF00u,
+    0x6CFF00u, 0x72FF00u, 0x78FF00u, 0x7EFF00u, 0x84FF00u, 0x8AFF00u, 0x90FF00u, 0x96FF00u,
+    0x9CFF00u, 0xA2FF00u, 0xA8FF00u, 0xAEFF00u, 0xB4FF00u, 0xBAFF00u, 0xC0FF00u, 0xC6FF00u,
+    0xCCFF00u, 0xD2FF00u, 0xD8FF00u, 0xDEFF00u, 0xE4FF00u, 0xEAFF00u, 0xF0FF00u, 0xF6FF00u,
+    0xFCFF00u, 0xFFFE00u, 0xFFF900u, 0xFFF300u, 0xFFED00u, 0xFFE700u, 0xFFE100u, 0xFFDB00u,
+    0xFFD500u, 0xFFCF00u, 0xFFC900u, 0xFFC300u, 0xFFBD00u, 0xFFB700u, 0xFFB100u, 0xFFAB00u,
+    0xFFA500u, 0xFF9F00u, 0xFF9900u, 0xFF9300u, 0xFF8D00u, 0xFF8700u, 0xFF8100u, 0xFF7B00u,
+    0xFF7500u, 0xFF6F00u, 0xFF6900u, 0xFF6300u, 0xFF5D00u, 0xFF5700u, 0xFF5100u, 0xFF4B00u,
+    0xFF4500u, 0xFF3F00u, 0xFF3900u, 0xFF3300u, 0xFF2D00u, 0xFF2700u, 0xFF2100u, 0xFF1B00u,
+    0xFF1500u, 0xFF0F00u, 0xFF0900u, 0xFF0300u, 0xFF0000u, 0xFF0006u, 0xFF000Cu, 0xFF0012u,
+    0xFF0018u, 0xFF001Eu, 0xFF0024u, 0xFF002Au, 0xFF0030u, 0xFF0036u, 0xFF003Cu, 0xFF0042u,
+    0xFF0048u, 0xFF004Eu, 0xFF0054u, 0xFF005Au, 0xFF0060u, 0xFF0066u, 0xFF006Cu, 0xFF0072u,
+    0xFF0078u, 0xFF007Eu, 0xFF0084u, 0xFF008Au, 0xFF0090u, 0xFF0096u, 0xFF009Cu, 0xFF00A2u,
+    0xFF00A8u, 0xFF00AEu, 0xFF00B4u, 0xFF00BAu, 0xFF00C0u, 0xFF00C6u, 0xFF00CCu, 0xFF00D2u,
+    0xFF00D8u, 0xFF00DEu, 0xFF00E4u, 0xFF00EAu, 0xFF00F0u, 0xFF00F6u, 0xFF00FCu, 0xFE00FFu,
+    0xF900FFu, 0xF300FFu, 0xED00FFu, 0xE700FFu, 0xE100FFu, 0xDB00FFu, 0xD500FFu, 0xCF00FFu,
+    0xC900FFu, 0xC300FFu, 0xBD00FFu, 0xB700FFu, 0xB100FFu, 0xAB00FFu, 0xA500FFu, 0x9F00FFu,
+    0x9900FFu, 0x9300FFu, 0x8D00FFu, 0x8700FFu, 0x8100FFu, 0x7B00FFu, 0x7500FFu, 0x6F00FFu,
+    0x6900FFu, 0x6300FFu, 0x5D00FFu, 0x5700FFu, 0x5100FFu, 0x4B00FFu, 0x4500FFu, 0x3F00FFu,
+    0x3900FFu, 0x3300FFu, 0x2D00FFu, 0x2700FFu, 0x2100FFu, 0x1B00FFu, 0x1500FFu, 0x0F00FFu
+};
+
+
 void NeoPixel_HSVtoRGB(uint8_t h, uint8_t s, uint8_t v,
                         uint8_t *r, uint8_t *g, uint8_t *b)
 {
@@ -121,89 +1898,102 @@ void NeoPixel_HSVtoRGB(uint8_t h, uint8_t s, uint8_t v,
     }
 }
 
-void NeoPixel_Rainbow(uint8_t offset, uint8_t brightness)
+void NeoPixel_FillHSV(pix_t *span, const uint8_t *hues, uint16_t n, uint8_t s, uint8_t v)
 {
-    for (uint8_t i = 0; i < NUM_LEDS; i++)
+    /* HSV: c' = v * (255 - s * (255 - c)), c from the full-colour hue table */
+    if (s == 255u)
     {
-        uint8_t hue = (uint8_t)(((uint16_t)i * 256u / NUM_LEDS) + offset);
-        uint8_t r, g, b;
-        NeoPixel_HSVtoRGB(hue, 255u, brightness, &r, &g, &b);
-        NeoPixel_SetPixel(i, r, g, b);
+        for (uint16_t i = 0; i < n; i++)
+            span[i] = Pix_Scale(neo_hue_lut[hues[i]], v);
+    }
+    else
+    {
+        const pix_t white = Pix_Make(255u, 255u, 255u);
+
+        for (uint16_t i = 0; i < n; i++)
+            span[i] = Pix_Scale(white - Pix_Scale(white - neo_hue_lut[hues[i]], s), v);
     }
-    NeoPixel_Show();
 }
 
+/* ?? Effects ?????????????????????????????????????????????????????????????????? */
 
-void NeoPixel_GreenPurple(uint8_t offset, uint8_t brightness)
-{
-    const uint8_t hueStart = 85;   // Green
-    const uint8_t hueEnd   = 200;  // Purple
-    const uint8_t hueRange = hueEnd - hueStart;
+/*
+ * Each effect is a per-pixel kernel so callers (see effects.c) can render it
+ * straight into the back buffer or blend it with another one pixel by pixel.
+ * The NeoPixel_<Effect>() wrappers fill the whole strip and call Show().
+ */
 
-    for (uint8_t i = 0; i < NUM_LEDS; i++)
-    {
-        uint8_t pos = (uint8_t)(((uint16_t)i * 256u / NUM_LEDS) + offset);
+/* Render a kernel over the strip, dim it as one packed pass and Show() it */
+static void NeoPixel_ShowKernel(pix_t (*pixel)(uint16_t, uint8_t),
+                                uint8_t offset, uint8_t brightness)
+{
+    static pix_t px[NUM_LEDS];
 
-        // Scale position into our limited hue range
-        uint8_t hue = hueStart + ((uint16_t)pos * hueRange >> 8);
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+        px[i] = pixel(i, offset);
 
-        uint8_t r, g, b;
-        NeoPixel_HSVtoRGB(hue, 255u, brightness, &r, &g, &b);
-        NeoPixel_SetPixel(i, r, g, b);
-    }
+    Pix_ScaleStrip(px, NUM_LEDS, brightness);
+    (void)Power_Limit(px, NUM_LEDS);
+    NeoPixel_SetStrip(px);
     NeoPixel_Show();
 }
 
-static uint8_t hash8(uint16_t x)
+/* Palette position of each LED along the scene, i * 256 / PIXDIST_SCENE_LEDS */
+static uint8_t  neo_ramp[PIXDIST_SCENE_LEDS];
+static uint16_t neo_ramp_n;                     /* entries filled */
+
+void NeoPixel_RampPrepare(uint16_t count)
 {
-    // Better hash with 16-bit input
-    x ^= x >> 8;
-    x *= 0x9E37;   // good mixing constant
-    x ^= x >> 8;
-    return (uint8_t)x;
+    if (count > PIXDIST_SCENE_LEDS) count = PIXDIST_SCENE_LEDS;
+
+    for (uint16_t i = neo_ramp_n; i < count; i++)
+        neo_ramp[i] = (uint8_t)((uint32_t)i * 256u / PIXDIST_SCENE_LEDS);
+    if (count > neo_ramp_n) neo_ramp_n = count;
 }
 
-static uint8_t lerp8by16(uint8_t a, uint8_t b, uint16_t t)
+pix_t CACHE_HOT NeoPixel_RainbowPixel(uint16_t i, uint8_t offset)
 {
-    // t = 0?65535
-    return a + (((uint32_t)(b - a) * t) >> 16);
+    return Palette_Lookup(PALETTE_RAINBOW, (uint8_t)(neo_ramp[i] + offset));
 }
 
-void NeoPixel_Fire(uint8_t offset, uint8_t brightness)
+void NeoPixel_Rainbow(uint8_t offset, uint8_t brightness)
 {
-    for (uint8_t i = 0; i < NUM_LEDS; i++)
-    {
-        // High-resolution position (key difference)
-        uint16_t x = ((uint16_t)i * 256u) + ((uint16_t)offset * 64u);
-
-        uint16_t xi = x >> 8;      // integer part
-        uint16_t xf = x & 0xFF;    // fractional part
-
-        // Smoothstep (proper easing curve)
-        uint16_t t = (uint16_t)xf * xf * (65535u - (xf << 1)) >> 16;
-
-        uint8_t n0 = hash8(xi);
-        uint8_t n1 = hash8(xi + 1);
+    NeoPixel_RampPrepare(NUM_LEDS);
+    NeoPixel_ShowKernel(NeoPixel_RainbowPixel, offset, brightness);
+}
 
-        uint8_t noise = lerp8by16(n0, n1, t);
+pix_t CACHE_HOT NeoPixel_GreenPurplePixel(uint16_t i, uint8_t offset)
+{
+    // Green (hue 85) to purple (hue 200) ramp, see palette.c
+    return Palette_Lookup(PALETTE_GREEN_PURPLE, (uint8_t)(neo_ramp[i] + offset));
+}
 
-        // Shape into flame intensity
-        uint16_t heat16 = (uint16_t)noise * noise;
-        uint8_t heat = (uint8_t)(heat16 >> 8);
+void NeoPixel_GreenPurple(uint8_t offset, uint8_t brightness)
+{
+    NeoPixel_RampPrepare(NUM_LEDS);
+    NeoPixel_ShowKernel(NeoPixel_GreenPurplePixel, offset, brightness);
+}
 
-        // Boost low end so strip is never "dead"
-        heat = (heat >> 1) + 40;
+pix_t CACHE_HOT NeoPixel_FirePixel(uint16_t i, uint8_t offset)
+{
+    // High-resolution position (key difference): one noise cell per LED, 8.8
+    uint32_t x = ((uint32_t)i * 256u) + ((uint32_t)offset * 64u);
 
-        uint8_t value = (heat > brightness) ? brightness : heat;
+    // Smoothed value noise, see fastmath.h
+    uint8_t noise = Math_ValueNoise8(x);
 
-        // Fire color mapping (tuned range)
-        uint8_t hue = (uint8_t)((uint16_t)heat * 50u / 255u);
+    // Shape into flame intensity
+    uint16_t heat16 = (uint16_t)noise * noise;
+    uint8_t heat = (uint8_t)(heat16 >> 8);
 
-        uint8_t r, g, b;
-        NeoPixel_HSVtoRGB(hue, 255u, value, &r, &g, &b);
+    // Boost low end so strip is never "dead"
+    heat = (heat >> 1) + 40;
 
-        NeoPixel_SetPixel(i, r, g, b);
-    }
+    // Fire color mapping: hue 0-50 and value both follow heat
+    return Palette_Lookup(PALETTE_HEAT, heat);
+}
 
-    NeoPixel_Show();
+void NeoPixel_Fire(uint8_t offset, uint8_t brightness)
+{
+    NeoPixel_ShowKernel(NeoPixel_FirePixel, offset, brightness);
 }
\ No newline at end of file
@@ -11,7 +11,147 @@
  *   NeoPixel '0' ? SPI 1-0-0  ?  T0H = 417 ns  T0L = 833 ns   ? (spec 400150 / 850150)
  *
  * 24 NeoPixel bits (1 LED, GRB order) ? 72 SPI bits ? 9 SPI bytes
- * Buffer tail: RESET_BYTES  0x00 ? keeps MOSI low ? 167 s  (> 50 s reset minimum)
+ * Reset tail:  RESET_BYTES  0x00 ? keeps MOSI low ? 167 s  (> 50 s reset minimum)
+ *
+ * CHIP PROFILES (NEO_CHIP)
+ * ------------------------
+ * The above is the WS2812B profile. Each profile fixes the wire byte order,
+ * bytes per pixel, SPI bit patterns, SPI rate and reset length, and the
+ * preprocessor builds its own encode table, so none of it costs anything at
+ * run time:
+ *
+ *   NEO_CHIP_WS2812B      G,R,B    800 kHz  3 SPI bits @ 2.4 MHz  110 / 100
+ *   NEO_CHIP_SK6812_RGBW  G,R,B,W  800 kHz  4 SPI bits @ 3.0 MHz  1100 / 1000
+ *   NEO_CHIP_WS2811       R,G,B    400 kHz  4 SPI bits @ 1.6 MHz  1100 / 1000
+ *
+ * A 4-bit profile takes 4 SPI bytes per colour byte. The SPI rate is set
+ * from the 48 MHz SERCOM clock at Init(); the other profiles' rates divide
+ * it exactly. The W channel of RGBW chips is fed by NeoPixel_SetPixelRGBW();
+ * everything else leaves it off. The CCL and TCC backends and NEO_DITHER
+ * keep the WS2812B timing and three channels.
+ *
+ * 32-BIT TRANSFERS (NEO_DMA_WORDS = 1)
+ * ------------------------------------
+ * SERCOM SPI runs with CTRLC.DATA32B so each DMA beat moves one word into
+ * DATA (sent least significant byte first, i.e. in memory order). That is a
+ * quarter of the bus transactions of byte beats; the data and the reset tail
+ * are each padded to a whole word, which only lengthens the latch pulse.
+ *
+ * STREAMING MODE (NEO_STREAMING = 1)
+ * ----------------------------------
+ * The default build keeps two full wire images (2 x NEO_BUF_SIZE bytes).
+ * Streaming mode instead keeps two plain 3-byte-per-LED frames and encodes
+ * NEO_CHUNK_LEDS at a time into two ping-pong chunk buffers, refilled from the
+ * DMAC block-complete interrupt through a linked descriptor ring. RAM drops
+ * from 18 to 6 bytes per LED; the cost is one short ISR per chunk, which must
+ * run within one chunk time (NEO_CHUNK_LEDS x 30 us) or the strip latches early.
+ *
+ * PARALLEL OUTPUTS (NEO_OUTPUTS = 2..4)
+ * -------------------------------------
+ * One SHOW_STRIPS row in showcfg.h per output, all of the same length.
+ * The logical pixel space is split into NEO_OUTPUTS equal segments, each sent
+ * by its own SERCOM SPI on its own DMAC channel. All channels are started back
+ * to back from NeoPixel_Show(), so frame time follows the longest segment
+ * (NEO_SEG_LEDS) instead of NUM_LEDS. Index i lives on output i / NEO_SEG_LEDS.
+ *
+ *   output 0 : SERCOM1 PAD0  PA16 (MUX-C)  DMAC ch 0  (MCC-configured)
+ *   output 1 : SERCOM3 PAD0  PA22 (MUX-C)  DMAC ch 1
+ *   output 2 : SERCOM0 PAD0  PA04 (MUX-D)  DMAC ch 2
+ *   output 3 : SERCOM4 PAD0  PB12 (MUX-C)  DMAC ch 3
+ *
+ * Each extra output needs its own 74AHCT125 buffer like output 0 below.
+ * Streaming mode drives output 0 only.
+ *
+ * CCL BACKEND (NEO_BACKEND = NEO_BACKEND_CCL)
+ * -------------------------------------------
+ * No bit expansion at all: the DMAC sends the plain 3-byte G,R,B frame to
+ * SERCOM0 at 800 kHz and the CCL builds the waveform on PA07 (CCL OUT0):
+ *
+ *   TCC0 WO1  --+___________________   T0H  350 ns, restarts every 1.25 us
+ *   TCC0 WO2  ---------+____________   T1H  800 ns
+ *   MOSI      <   bit value 1.25 us   >
+ *   OUT0 = WO1 | (MOSI & WO2)
+ *
+ * 3 bytes of RAM per LED (x2 for double buffering) and no encode cost. The
+ * strip's DATA-IN moves to PA07 (through the same 74AHCT125); SERCOM1 and
+ * PA16 are unused. The waveform comes from internal signals only, so check
+ * the pulse widths on a scope when bringing it up.
+ *
+ * TCC BACKEND (NEO_BACKEND = NEO_BACKEND_TCC)
+ * -------------------------------------------
+ * TCC0 already runs NPWM at 800 kHz (PER 149 at 120 MHz) on PA08 / WO0. Each
+ * WS2812 bit becomes one duty byte (48 = 400 ns, 96 = 800 ns) and every TCC0
+ * overflow DMAs the next one into CCBUF0, so the pulse edges come straight
+ * from the timer. RAM is 24 bytes per LED (x2); the encode is two 16-entry
+ * nibble lookups per colour byte. The strip's DATA-IN moves to PA08 and
+ * SERCOM1 is left free. Compare backends with PROFILE_ENABLE: the encode
+ * slot gives the CPU cost, a scope on the data pin the timing.
+ *
+ * TEMPORAL DITHERING (NEO_DITHER = 1, SPI backend, full frames)
+ * -------------------------------------------------------------
+ * At low global brightness the corrected output only has a handful of
+ * levels, so slow fades step visibly. With NEO_DITHER SetPixel() keeps the
+ * corrected value of every channel at 16 bits (1/256 output step) and
+ * Show() quantises the whole strip to 8 bits, adding each channel's residue
+ * from the previous frame first. The strip then averages out to the exact
+ * level over a few frames. Costs 9 bytes of RAM per LED and an encode of
+ * the full strip per Show() (about as much as SetPixel() on every LED),
+ * shown under the profiler's encode slot. Use
+ * NeoPixel_SetPixel16() to feed more than 8 bits of effect precision.
+ *
+ * HARDWARE FRAME START (NEO_HW_FRAME_START = 1, SPI backend)
+ * ---------------------------------------------------------
+ * TCC0 is reused as a frame timer (120 MHz / 64, overflow at NEO_HW_FRAME_HZ)
+ * and EVSYS channel 0 carries its overflow event to the NeoPixel DMA channel.
+ * Show() only arms the channel; the frame leaves the SPI at the next overflow,
+ * so the start of every frame is exact whatever the task scheduling.
+ * Show() then blocks until the previous frame has gone out, which paces the
+ * caller at the hardware rate: render the next frame before the next
+ * overflow and no software delay is needed. A late Show() waits for the
+ * following overflow, so one frame slot is repeated. The event releases one DMA
+ * block, so the frame must fit in one (7276 WS2812B LEDs with byte beats).
+ *
+ * CONSTANT FRAMES (SPI backend, full frames)
+ * ------------------------------------------
+ * A strobe, a blackout or a solid scare colour is the same wire image every
+ * time. The SHOW_FRAMES rows (showcfg.h) are encoded by the preprocessor
+ * into const arrays in flash, one segment long since every LED is the same,
+ * each with a descriptor chain per output built at Init() and linked to the
+ * reset tail like the RAM images. NeoPixel_ShowFrame() points the channels
+ * at that chain: no render, no encode, no RAM, and the staged back frame is
+ * left as it was for the next Show(). Since nothing has to be rendered,
+ * NeoPixel_ShowBootFrame() can send SHOW_BOOT_FRAME straight after Init(),
+ * before the scheduler starts: the strip lights within milliseconds of
+ * reset rather than after every driver, task and the first render.
+ *
+ * RENDER-AHEAD QUEUE (NEO_QUEUE_FRAMES = 2..8, SPI backend)
+ * -----------------------------------------------------------
+ * With two images one frame that renders longer than the frame period (a
+ * particle burst) is a visible stutter, though the average keeps up. The
+ * queue keeps NEO_QUEUE_FRAMES + 1 wire images instead: the caller tags
+ * each frame with its presentation time on the show clock
+ * (NeoPixel_SetPresentTime()), Show() queues it and returns at once, and a
+ * show clock timer (hrtimer.h) starts each queued frame's DMA at its time.
+ * Show() only blocks while the queue is full, which paces the renderer up
+ * to NEO_QUEUE_FRAMES frames ahead; a spike then eats into that slack
+ * instead of a frame slot. A frame whose time has passed goes out as soon
+ * as the one before it is off the wire, counted as overdue. The cost is
+ * one wire image of RAM per queued frame and NEO_QUEUE_FRAMES periods more
+ * latency from an effect request to the strip.
+ *
+ * LED RAIL GATE (NEO_RAIL_GATE = 1)
+ * ---------------------------------
+ * A dark WS2812 still draws about 1 mA, 144 mA for the strip: more than the
+ * whole board in tickless idle. With the gate a MOSFET on NEO_RAIL_PIN
+ * switches the LED 5 V supply. The staging calls track whether the staged
+ * frame is all black; once the strip has shown nothing but dark frames (or
+ * brightness 0) for NEO_RAIL_OFF_MS, a show clock timer switches the rail
+ * off, and while it is off a dark frame is not sent at all, so the data
+ * line stays low and cannot feed the strip through DIN. The first lit
+ * Show() or ShowFrame() switches the rail on and waits NEO_RAIL_SETTLE_US
+ * (bulk capacitor charged, LEDs out of power-on reset) before that frame
+ * goes on the wire, so no frame is lost. The boot frame waits the same way.
+ *   NEO_RAIL_PIN ??[1 k]??? gate driver / logic-level P-MOSFET, LED 5 V
  *
  * HARDWARE CONNECTIONS
  * --------------------
@@ -29,41 +169,310 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "pixmath.h"
+#include "showcfg.h"
 
 /* ?? User configuration ?????????????????????????????????????????????????????? */
-#define NUM_LEDS            144          /* adjust to your strip length          */
+#define NUM_LEDS            (0 SHOW_STRIPS(NEO_X_LEDS))   /* showcfg.h, < 64K  */
 #define DMAC_CHANNEL_NEO    DMAC_CHANNEL_0  /* must match MCC DMAC assignment   */
+#define NEO_STREAMING       0            /* 1 = encode on the fly, see below     */
+#define NEO_CHUNK_LEDS      16u          /* streaming: LEDs per DMA chunk        */
+#define NEO_OUTPUTS         (0u SHOW_STRIPS(SHOW_X_ONE))  /* showcfg.h, 1..4   */
+#define NEO_GAMMA           1            /* 1 = gamma 2.8 correction in encoder  */
+#define NEO_BRIGHTNESS_DEFAULT 255u      /* global brightness after Init()       */
+#define NEO_SKIP_UNCHANGED  0            /* 1 = Show() skips repeated frames     */
+#define NEO_DMA_WORDS       1            /* 1 = 32-bit SPI/DMA beats (full mode) */
+
+#define NEO_BACKEND_SPI     0            /* SERCOM1 SPI, 3 SPI bits per LED bit  */
+#define NEO_BACKEND_CCL     1            /* SERCOM0 + TCC0 pulses + CCL LUT0     */
+#define NEO_BACKEND_TCC     2            /* TCC0 PWM on PA08, DMA duty per bit   */
+#define NEO_BACKEND         NEO_BACKEND_SPI
+#define NEO_DITHER          0            /* 1 = 16-bit framebuffer + dithering   */
+#define NEO_HW_FRAME_START  0            /* 1 = TCC0 overflow starts each frame  */
+#define NEO_HW_FRAME_HZ     50u          /* hardware frame rate, 1..1000 Hz      */
+#define NEO_QUEUE_FRAMES    0            /* 2..8 = render-ahead queue, see below */
+#define NEO_RAIL_GATE       0            /* 1 = switch the LED supply off when dark */
+#define NEO_RAIL_PIN        PORT_PIN_PB16 /* rail switch, NEO_RAIL_ON_LEVEL = on  */
+#define NEO_RAIL_ON_LEVEL   1            /* pin level that powers the strip      */
+#define NEO_RAIL_OFF_MS     10000u       /* dark this long before the rail is cut */
+#define NEO_RAIL_SETTLE_US  1000u        /* rail on -> first frame on the wire   */
+
+#define NEO_CHIP_WS2812B     0           /* GRB, 800 kHz (and WS2813, SK6812 RGB)  */
+#define NEO_CHIP_SK6812_RGBW 1           /* GRBW, 800 kHz                          */
+#define NEO_CHIP_WS2811      2           /* RGB, 400 kHz                           */
+#define NEO_CHIP            NEO_CHIP_WS2812B
+
+/* ?? Chip profiles ??????????????????????????????????????????????????????????? */
+/* NEO_WIRE_ORDER lists the colour (0 R, 1 G, 2 B, 3 W) sent in each wire slot,
+ * NEO_WIRE_SLOTS() the same for the preprocessor (constant frames) */
+#if NEO_CHIP == NEO_CHIP_WS2812B
+#define NEO_CHANNELS        3u           /* bytes per pixel on the wire          */
+#define NEO_WIRE_ORDER      { 1u, 0u, 2u }
+#define NEO_WIRE_SLOTS(r, g, b, w)  (g), (r), (b)
+#define NEO_SPI_BITS        3u           /* SPI bits per LED bit                 */
+#define NEO_SPI_ONE         0x6u         /* 1 1 0                                */
+#define NEO_SPI_ZERO        0x4u         /* 1 0 0                                */
+#define NEO_SPI_HZ          2400000u
+#define NEO_RESET_US        166u         /* > 50 us latch                        */
+#elif NEO_CHIP == NEO_CHIP_SK6812_RGBW
+#define NEO_CHANNELS        4u
+#define NEO_WIRE_ORDER      { 1u, 0u, 2u, 3u }
+#define NEO_WIRE_SLOTS(r, g, b, w)  (g), (r), (b), (w)
+#define NEO_SPI_BITS        4u           /* 333 ns: T0H 333, T1H 667 ns          */
+#define NEO_SPI_ONE         0xCu         /* 1 1 0 0                              */
+#define NEO_SPI_ZERO        0x8u         /* 1 0 0 0                              */
+#define NEO_SPI_HZ          3000000u
+#define NEO_RESET_US        100u         /* > 80 us latch                        */
+#elif NEO_CHIP == NEO_CHIP_WS2811
+#define NEO_CHANNELS        3u
+#define NEO_WIRE_ORDER      { 0u, 1u, 2u }
+#define NEO_WIRE_SLOTS(r, g, b, w)  (r), (g), (b)
+#define NEO_SPI_BITS        4u           /* 625 ns: T0H 625 ns, T1H 1.25 us      */
+#define NEO_SPI_ONE         0xCu
+#define NEO_SPI_ZERO        0x8u
+#define NEO_SPI_HZ          1600000u
+#define NEO_RESET_US        300u         /* > 280 us latch on newer parts        */
+#else
+#error "Unknown NEO_CHIP"
+#endif
 
 /* ?? Derived constants ? do not edit ???????????????????????????????????????? */
-#define NEO_RESET_BYTES     50u         /* 50  8  416.7 ns ? 167 s ? 50 s */
-#define NEO_DATA_BYTES      ((uint16_t)(NUM_LEDS) * 9u)
-#define NEO_BUF_SIZE        (NEO_DATA_BYTES + NEO_RESET_BYTES)
+#define NEO_RESET_BYTES     ((NEO_RESET_US * (NEO_SPI_HZ / 1000u) + 7999u) / 8000u)   /* zero SPI bytes */
+#define NEO_SPI_GCLK_HZ     48000000u   /* GCLK3 feeding the SPI SERCOMs (sercom.h)  */
+#define NEO_SPI_BAUD        (NEO_SPI_GCLK_HZ / (2u * NEO_SPI_HZ) - 1u)
+#define NEO_ENC_BYTES       NEO_SPI_BITS                       /* SPI bytes per colour byte */
+#define NEO_LED_BYTES       (NEO_CHANNELS * NEO_ENC_BYTES)     /* SPI bytes per LED         */
+#define NEO_DATA_BYTES      ((uint32_t)(NUM_LEDS) * NEO_LED_BYTES)
+#define NEO_X_LEDS(name, leds)  + (leds)                      /* SHOW_STRIPS rows */
+#define NEO_X_SQUARE(name, leds)  + (leds) * (leds)
+#define NEO_SEG_LEDS        (((uint32_t)(NUM_LEDS) + NEO_OUTPUTS - 1u) / NEO_OUTPUTS)
+#define NEO_DMA_BEAT        ((NEO_DMA_WORDS) ? 4u : 1u)        /* bytes per DMA beat */
+#define NEO_RESET_BEATS     ((NEO_RESET_BYTES + NEO_DMA_BEAT - 1u) / NEO_DMA_BEAT)
+#define NEO_SEG_BUF_SIZE    (((NEO_SEG_LEDS * NEO_LED_BYTES + NEO_DMA_BEAT - 1u) \
+                              / NEO_DMA_BEAT) * NEO_DMA_BEAT)   /* data padded to beats, no tail */
+#define NEO_BUF_SIZE        (NEO_OUTPUTS * NEO_SEG_BUF_SIZE)   /* one frame, all outputs */
+#define NEO_WIRE_US         ((uint32_t)NEO_SEG_LEDS * NEO_CHANNELS * 8u * NEO_SPI_BITS * 1000u \
+                             / (NEO_SPI_HZ / 1000u) + NEO_RESET_US)    /* one frame, reset tail included */
+#define NEO_CHUNK_BYTES     ((uint16_t)(NEO_CHUNK_LEDS) * NEO_LED_BYTES)
+#define NEO_DMA_BLOCK_MAX   (0xFFFFu * NEO_DMA_BEAT)   /* DMAC BTCNT is 16 bits (beats) */
+#define NEO_DMA_BLOCKS      ((NEO_SEG_BUF_SIZE + NEO_DMA_BLOCK_MAX - 1u) / NEO_DMA_BLOCK_MAX)
+
+#if (NEO_SPI_GCLK_HZ % (2u * NEO_SPI_HZ)) != 0u
+#error "NEO_SPI_HZ must divide the SERCOM clock: NEO_SPI_GCLK_HZ / (2 x (BAUD + 1))"
+#endif
+#if ((NEO_BACKEND != NEO_BACKEND_SPI) || NEO_DITHER) && (NEO_CHIP != NEO_CHIP_WS2812B)
+#error "NEO_BACKEND_CCL / _TCC and NEO_DITHER support NEO_CHIP_WS2812B only"
+#endif
+#if (NEO_OUTPUTS < 1) || (NEO_OUTPUTS > 4)
+#error "NEO_OUTPUTS must be 1..4"
+#endif
+#if NEO_OUTPUTS * (0 SHOW_STRIPS(NEO_X_SQUARE)) != (NUM_LEDS) * (NUM_LEDS)   /* equal only if all are */
+#error "showcfg.h: parallel strips must all have the same length"
+#endif
+#if NEO_STREAMING && (NEO_OUTPUTS > 1)
+#error "NEO_STREAMING drives a single output"
+#endif
+#if NEO_STREAMING && NEO_DMA_WORDS
+#error "NEO_STREAMING uses byte beats, set NEO_DMA_WORDS to 0"
+#endif
+#if (NEO_BACKEND != NEO_BACKEND_SPI) && (NEO_STREAMING || (NEO_OUTPUTS > 1))
+#error "NEO_BACKEND_CCL / _TCC drive a single full frame: no streaming, one output"
+#endif
+#if (NEO_BACKEND == NEO_BACKEND_CCL) && ((NUM_LEDS) * 3 > 0xFFFF)
+#error "NEO_BACKEND_CCL sends the frame as one DMA block (max 21845 LEDs)"
+#endif
+#if (NEO_BACKEND == NEO_BACKEND_TCC) && ((NUM_LEDS) * 24 + 133 > 0xFFFF)
+#error "NEO_BACKEND_TCC sends the frame as one DMA block (max 2725 LEDs)"
+#endif
+#if NEO_HW_FRAME_START && ((NEO_BACKEND != NEO_BACKEND_SPI) || NEO_STREAMING || (NEO_OUTPUTS > 1))
+#error "NEO_HW_FRAME_START needs the SPI backend, full frames and one output"
+#endif
+#if NEO_DITHER && ((NEO_BACKEND != NEO_BACKEND_SPI) || NEO_STREAMING)
+#error "NEO_DITHER quantises full SPI frames, set NEO_STREAMING to 0"
+#endif
+#if NEO_HW_FRAME_START && NEO_SKIP_UNCHANGED
+#error "NEO_HW_FRAME_START paces the caller on every frame, set NEO_SKIP_UNCHANGED to 0"
+#endif
+#if NEO_QUEUE_FRAMES && ((NEO_BACKEND != NEO_BACKEND_SPI) || NEO_STREAMING || NEO_HW_FRAME_START \
+                         || NEO_SKIP_UNCHANGED || (NEO_QUEUE_FRAMES < 2) || (NEO_QUEUE_FRAMES > 8))
+#error "NEO_QUEUE_FRAMES (2..8) queues full SPI frames on the show clock, not with streaming, HW frame start or skip"
+#endif
 
 /* ?? Public API ?????????????????????????????????????????????????????????????? */
 
-/** Call once after SYSTEM_Initialize(). Registers DMA callback, zeroes buffer. */
+/** Call once after SYSTEM_Initialize(). Registers DMA callback, zeroes both buffers. */
 void NeoPixel_Init(void);
 
 /**
  * Stage a single pixel colour into the DMA buffer (does NOT transmit yet).
- * index : 0 ? NUM_LEDS-1
+ * index : 0 ? NUM_LEDS-1 (16-bit, strips may exceed 255 LEDs)
  * r,g,b : 0 ? 255
  */
-void NeoPixel_SetPixel(uint8_t index, uint8_t r, uint8_t g, uint8_t b);
+void NeoPixel_SetPixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * As NeoPixel_SetPixel() with 16-bit channels (0-65535). Only NEO_DITHER
+ * keeps the extra bits; otherwise the values are rounded to 8 bits.
+ */
+void NeoPixel_SetPixel16(uint16_t index, uint16_t r, uint16_t g, uint16_t b);
+
+/**
+ * As NeoPixel_SetPixel() with the white channel of RGBW chips; w is
+ * dropped on chips without one.
+ */
+void NeoPixel_SetPixelRGBW(uint16_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t w);
 
 /** Stage all pixels off (does NOT transmit). */
 void NeoPixel_Clear(void);
 
+/** Stage a whole packed strip (NUM_LEDS pixels, see pixmath.h) into the back buffer. */
+void NeoPixel_SetStrip(const pix_t *px);
+
+/**
+ * Stage count packed pixels from src at LEDs start.. (does NOT transmit).
+ * The span is clipped to the strip once, then encoded back to back.
+ */
+void NeoPixel_WriteSpan(uint16_t start, const pix_t *src, uint16_t count);
+
+/**
+ * Stage a whole planar strip (NUM_LEDS pixels, pix_planes_t in pixmath.h)
+ * into the back buffer. The channels meet here for the first time, one
+ * byte of each per LED, straight into the wire encoding.
+ */
+void NeoPixel_SetPlanes(const pix_planes_t *pl);
+
+/**
+ * Stage count LEDs from start to one colour (does NOT transmit). Only the
+ * first LED is encoded; its wire pattern is then replicated with doubling
+ * memcpy()s, so clears and solid washes cost little more than a copy.
+ */
+void NeoPixel_FillSolid(uint16_t start, uint16_t count, pix_t colour);
+
+#if NEO_STREAMING
+/**
+ * The streaming back frame: NUM_LEDS x NEO_CHANNELS plain bytes in wire
+ * order, uncorrected, which the next Show() puts on the strip. For writers
+ * that fill it whole, e.g. by DMA (pixdist.h). Changes at every Show().
+ */
+uint8_t *NeoPixel_StageBytes(void);
+#endif
+
 /**
- * Transmit the buffer via SPI+DMA. Blocks until DMA finishes.
- * The reset pulse is baked into the tail of the buffer, so no extra delay needed.
+ * Transmit the staged frame via SPI+DMA and return without waiting for it.
+ * The frame is double-buffered: staging continues into the back buffer while
+ * the front one is on the wire. If the previous frame is still being sent the
+ * calling task blocks (not spins) until the DMA callback notifies it.
+ * The reset pulse is chained after the data by the DMAC, so no extra delay needed.
+ * With NEO_SKIP_UNCHANGED the staged frame is CRC-32'd by the DMAC CRC engine
+ * first and Show() returns at once if it matches the last frame sent.
+ * With NEO_QUEUE_FRAMES the frame is queued for its presentation time
+ * instead, and Show() blocks only while the queue is full.
+ * Must be called from a task - it uses the caller's task notification.
  */
 void NeoPixel_Show(void);
 
+/* One per SHOW_FRAMES row (showcfg.h) */
+#define NEO_X_FRAME_ID(id, ...) NEO_FRAME_##id,
+
+typedef enum
+{
+    SHOW_FRAMES(NEO_X_FRAME_ID)
+    NEO_FRAME_COUNT
+} neo_frame_id_t;
+
+/**
+ * Send constant frame `id` from flash in place of a staged one, paced and
+ * queued like Show(). Its colour is the row's wire value: gamma and
+ * brightness do not apply. False, and nothing sent, on a build without
+ * full SPI frames, with the brightness at 0 or if the frame would draw
+ * more than Power_Budget(). The Show() task.
+ */
+bool NeoPixel_ShowFrame(neo_frame_id_t id);
+
+/** Registry name of constant frame `id` ("?" if out of range). Any task. */
+const char *NeoPixel_FrameName(neo_frame_id_t id);
+
+#define NEO_BOOT_FRAME          SHOW_CAT(NEO_FRAME_, SHOW_BOOT_FRAME)
+
+/**
+ * Start NEO_BOOT_FRAME on every output and return: no task notification,
+ * no wait, not counted in the stats. The next Show() waits for it to leave
+ * the wire like any frame. Main, after NeoPixel_Init() and before the
+ * scheduler starts; does nothing on a build without full SPI frames.
+ */
+void NeoPixel_ShowBootFrame(void);
+
+#if NEO_QUEUE_FRAMES
+/**
+ * Present the frame the next Show() or ShowFrame() queues at show time `at`
+ * (ShowClock_Now() base); without it a frame goes out as soon as the ones
+ * queued before it. Times must not go backwards. The Show() task.
+ */
+void NeoPixel_SetPresentTime(uint32_t at);
+
+/** Frames queued and not yet off the wire. Any task. */
+uint8_t NeoPixel_Queued(void);
+#endif
+
+/**
+ * Block the calling task until the last NeoPixel_Show() frame has been sent
+ * (with NEO_QUEUE_FRAMES, until the queue is empty).
+ * A transfer that has not completed within twice its wire time is aborted
+ * and counted as a timeout, so a failed DMA never hangs the caller.
+ */
+void NeoPixel_Wait(void);
+
+/*
+ * Transfer health counters. Errors and timeouts point at wiring, descriptors
+ * or a dead channel; late frames (sent, but slower than the wire time) point
+ * at DMA/bus contention.
+ */
+typedef struct
+{
+    uint32_t frames;        /* transfers started                                */
+    uint32_t dma_errors;    /* DMAC_TRANSFER_EVENT_ERROR callbacks               */
+    uint32_t spi_errors;    /* SERCOM STATUS LENERR / BUFOVF at frame end        */
+    uint32_t timeouts;      /* no completion within the timeout, channel aborted */
+    uint32_t late;          /* completed more than a tick after the wire time    */
+    uint32_t overdue;       /* NEO_QUEUE_FRAMES: started past their present time */
+    uint32_t rail_wakes;    /* NEO_RAIL_GATE: LED supply switched back on        */
+} neo_tx_stats_t;
+
+/** Snapshot of the transfer counters. Any task. */
+void NeoPixel_GetStats(neo_tx_stats_t *out);
+
+/** Zero the transfer counters. Any task. */
+void NeoPixel_ResetStats(void);
+
+#if !defined(NDEBUG) && (NEO_BACKEND == NEO_BACKEND_SPI)
+/**
+ * Check the encode table against a bit-by-bit reference encoder and a
+ * golden vector, and every wire image's beat padding. Call after
+ * NeoPixel_Init(), before the first Show(). Returns the number of failures.
+ * "make -C tools/host test" runs it on the PC, with the wire checks.
+ */
+uint8_t NeoPixel_SelfTest(void);
+#endif
+
+/**
+ * Colour correction applied while encoding, after SetPixel():
+ *   out = gamma(v) * brightness/255 * balance/255   (per channel)
+ * Each call rebuilds the per-channel encode tables (~770 entries), so call it
+ * from the render task between frames, not per pixel. Pixels already staged
+ * keep their old correction until they are set again.
+ */
+void NeoPixel_SetBrightness(uint8_t brightness);
+
+/** Global brightness currently folded into the encode tables. */
+uint8_t NeoPixel_GetBrightness(void);
+
+/** White balance: per-channel scale 0-255 (255, 255, 255 = neutral). */
+void NeoPixel_SetWhiteBalance(uint8_t r, uint8_t g, uint8_t b);
+
 /**
  * Fill the strip with a moving rainbow and call Show().
  * offset : 0-255, increment each frame to animate.
- * brightness : 0-255 (keep ? 128 when powering many LEDs from USB).
+ * brightness : 0-255; the power limiter (power.h) caps the resulting current.
  */
 void NeoPixel_Rainbow(uint8_t offset, uint8_t brightness);
 
@@ -71,6 +480,24 @@ void NeoPixel_GreenPurple(uint8_t offset, uint8_t brightness);
 
 void NeoPixel_Fire(uint8_t offset, uint8_t brightness);
 
+/**
+ * Per-pixel kernels behind the effects above: packed colour of LED i at full
+ * brightness for the given offset, without touching the buffer. Callers scale
+ * whole strips afterwards with Pix_ScaleStrip() (see effects.h). Colours come
+ * from the palette tables, so Palette_Init() must have run.
+ */
+pix_t NeoPixel_RainbowPixel(uint16_t i, uint8_t offset);
+pix_t NeoPixel_GreenPurplePixel(uint16_t i, uint8_t offset);
+pix_t NeoPixel_FirePixel(uint16_t i, uint8_t offset);
+
+/**
+ * Prepare hook of the rainbow and green-purple kernels (effects.h): the
+ * palette position of LEDs 0..count-1 along the scene, computed once, so
+ * a frame is a table read and an add per LED. The kernels read the table
+ * as it stands: run it for every span they render.
+ */
+void NeoPixel_RampPrepare(uint16_t count);
+
 /**
  * HSV ? RGB helper (public so main.c can compose custom effects).
  * h,s,v : 0-255
@@ -78,4 +505,12 @@ void NeoPixel_Fire(uint8_t offset, uint8_t brightness);
 void NeoPixel_HSVtoRGB(uint8_t h, uint8_t s, uint8_t v,
                         uint8_t *r, uint8_t *g, uint8_t *b);
 
+/**
+ * Batch HSV -> RGB: span[i] = colour of hues[i] at saturation s, value v.
+ * Table lookup plus packed scaling, no divide; within 1 LSB of the scalar
+ * NeoPixel_HSVtoRGB() above, which stays the reference. span may be a
+ * caller's strip (then NeoPixel_SetStrip()) or any part of one.
+ */
+void NeoPixel_FillHSV(pix_t *span, const uint8_t *hues, uint16_t n, uint8_t s, uint8_t v);
+
 #endif /* NEOPIXEL_H */
\ No newline at end of file
@@ -0,0 +1,466 @@
+/* =============================================================================
+ * netbridge.c  -  Network co-processor link: sACN / Art-Net universes over a UART
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "netbridge.h"
+#include "definitions.h"        /* SERCOM3, DMAC, DWT, __ALIGNED */
+#include "task.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "effects.h"
+#include "neopixel.h"
+#include "pixdist.h"
+#include "cli.h"
+#include "cache.h"            /* CACHE_HOT */
+#include "crc.h"
+#include "irqstat.h"
+#include "sercom.h"
+#include <string.h>
+
+#if NETBRIDGE_ENABLE && (NEO_OUTPUTS > 1u)
+#error "NETBRIDGE_ENABLE needs SERCOM3 / PA22, which NeoPixel output 1 uses"
+#endif
+#if NETBRIDGE_FRAME_BYTES > 0xFFFFu
+#error "NETBRIDGE frame too long for one DMA block, lower NETBRIDGE_UNIVERSES"
+#endif
+#define NB_SERCOM           3u
+#define NB_GCLK_HZ          48000000u       /* GCLK3 */
+#if NETBRIDGE_BAUD_HZ > NB_GCLK_HZ / 16u
+#error "NETBRIDGE_BAUD_HZ: 48 MHz / 16 at most"
+#endif
+#define NB_PA22             22u             /* TX, SERCOM3 PAD0 */
+#define NB_PA23             23u             /* RX, SERCOM3 PAD1 */
+#define NB_CYC_US           (configCPU_CLOCK_HZ / 1000000u)
+#define NB_USABLE           510u            /* slots per universe patched: 170 RGB */
+#define NB_TX_BYTES         (NETBRIDGE_HDR_BYTES + NETBRIDGE_CTRL_MAX + 2u)
+#define NB_STATUS_BYTES     4u
+#define NB_NOTIFY_INDEX     1u              /* the NetBr task's own; runs no effects */
+#define NB_STACK            (configMINIMAL_STACK_SIZE * 2u)
+#define NB_FLAG_ARTNET      0x01u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t nb_frames;
+static volatile uint32_t nb_received;
+static volatile uint32_t nb_crc_errors;
+static volatile uint32_t nb_dropped;
+static volatile uint32_t nb_overruns;
+static volatile uint32_t nb_ctrl_in;
+static volatile uint32_t nb_ctrl_out;
+static volatile uint32_t nb_ctrl_lost;
+
+#if NETBRIDGE_ENABLE
+
+static uint16_t net_univ  = 1u;                 /* first universe taken          */
+static uint16_t net_addr  = 1u;                 /* its slot of LED 0's red       */
+static uint16_t net_group = 1u;                 /* LEDs per 3-slot cell          */
+
+/* Triple buffer: DMAC writes nb_w, nb_ready holds the newest frame, the renderer reads nb_rd */
+static uint8_t  nb_buf[3][NETBRIDGE_FRAME_BYTES] DMA_RAM __ALIGNED(4);
+static uint16_t nb_len[3];                      /* payload bytes                */
+static uint8_t  nb_w = 0u, nb_ready = 1u, nb_rd = 2u;
+static volatile bool nb_fresh;
+static uint16_t nb_rd_len;                      /* renderer's checked copy       */
+static bool     nb_artnet;
+
+static volatile TickType_t nb_last;             /* tick of the latest pixel frame */
+static volatile bool       nb_seen;
+
+static uint8_t       nb_tx[NB_TX_BYTES] DMA_RAM __ALIGNED(4);
+static uint8_t       nb_seq;
+static TaskHandle_t  nb_task;
+
+static StreamBufferHandle_t nb_rx_stream = NULL;
+static StaticStreamBuffer_t nb_rx_stream_buf;
+static uint8_t              nb_rx_stream_store[NETBRIDGE_RX_STREAM + 1u];
+static StreamBufferHandle_t nb_tx_stream = NULL;
+static StaticStreamBuffer_t nb_tx_stream_buf;
+static uint8_t              nb_tx_stream_store[NETBRIDGE_TX_STREAM + 1u];
+
+static StackType_t  nb_stack[NB_STACK];
+static StaticTask_t nb_tcb;
+
+static const cli_param_t nb_params[] =
+{
+    { "net_univ",  &net_univ,  CLI_U16, 1u, 63999u, NULL, "first sACN / Art-Net universe taken" },
+    { "net_addr",  &net_addr,  CLI_U16, 1u, NB_USABLE - 2u, NULL, "slot of LED 0's red in it, 1-based" },
+    { "net_group", &net_group, CLI_U16, 1u, PIXDIST_SCENE_LEDS, NULL, "LEDs per network RGB cell" },
+};
+
+/* -- Helpers ----------------------------------------------------------------- */
+
+static uint16_t nb_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* The frame in `b` with `len` payload bytes ends in its CRC */
+static bool nb_crc_ok(const uint8_t *b, uint32_t len)
+{
+    return Crc16_Ccitt(b, NETBRIDGE_HDR_BYTES + len) == nb_u16(&b[NETBRIDGE_HDR_BYTES + len]);
+}
+
+/* Payload slot of the patch's slot p: 510 to a universe, 512 apart */
+static uint32_t nb_slot(uint32_t p)
+{
+    return (p / NB_USABLE) * NETBRIDGE_SLOTS + p % NB_USABLE;
+}
+
+static void nb_spin_us(uint32_t us)
+{
+    uint32_t t0 = DWT->CYCCNT;
+
+    while ((DWT->CYCCNT - t0) < us * NB_CYC_US) {}
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* Capture the next frame into nb_buf[nb_w] */
+static void nb_arm(void)
+{
+    Sercom_DmaStart(NB_SERCOM, SERCOM_DMA_RX, NETBRIDGE_DMA_RX, nb_buf[nb_w], NETBRIDGE_FRAME_BYTES);
+}
+
+/* Stop the capture; bytes it took */
+static uint32_t nb_stop(void)
+{
+    return NETBRIDGE_FRAME_BYTES - Sercom_DmaStop(NETBRIDGE_DMA_RX);
+}
+
+/* A pixel frame of `len` payload bytes is in nb_buf[nb_w]: hand it over; true to select EFFECT_NET */
+static bool nb_pixels_in(uint16_t len)
+{
+    TickType_t now  = xTaskGetTickCountFromISR();
+    bool       lost = !nb_seen || (now - nb_last) >= pdMS_TO_TICKS(NETBRIDGE_LOSS_MS);
+    uint8_t    t    = nb_ready;
+
+    nb_len[nb_w] = len;
+    nb_ready = nb_w;
+    nb_w     = t;
+    nb_fresh = true;
+    nb_last  = now;
+    nb_seen  = true;
+    nb_received++;
+    return lost;
+}
+
+/* Control bytes for the shell, checked here: the stream keeps no frame to check later */
+static void nb_control_in(const uint8_t *b, uint16_t len, BaseType_t *woken)
+{
+    size_t n;
+
+    if (!nb_crc_ok(b, len))
+    {
+        nb_crc_errors++;
+        return;
+    }
+    n = xStreamBufferSendFromISR(nb_rx_stream, &b[NETBRIDGE_HDR_BYTES], len, woken);
+    nb_ctrl_in   += n;
+    nb_ctrl_lost += len - n;
+}
+
+/* Frame error = break: the bytes before it are one frame */
+static void nb_isr(void)
+{
+    uint16_t   status = SERCOM3_REGS->USART_INT.SERCOM_STATUS;
+    BaseType_t woken  = pdFALSE;
+    bool       pixels = false, lost = false;
+    uint32_t   n;
+
+    SERCOM3_REGS->USART_INT.SERCOM_STATUS  = status;
+    SERCOM3_REGS->USART_INT.SERCOM_INTFLAG = SERCOM_USART_INT_INTFLAG_ERROR_Msk;
+    if ((status & SERCOM_USART_INT_STATUS_BUFOVF_Msk) != 0u) nb_overruns++;
+    if ((status & SERCOM_USART_INT_STATUS_FERR_Msk) == 0u) return;
+
+    n = nb_stop();
+    if ((SERCOM3_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_RXC_Msk) != 0u)
+        (void)SERCOM3_REGS->USART_INT.SERCOM_DATA;          /* the break byte, not taken */
+    else if (n != 0u)
+        n--;                                                /* the DMAC took it last     */
+
+    const uint8_t *b   = nb_buf[nb_w];
+    uint16_t       len = (n >= NETBRIDGE_HDR_BYTES) ? nb_u16(&b[4]) : 0u;
+
+    if (n < NETBRIDGE_HDR_BYTES + 2u || b[0] != NETBRIDGE_MAGIC || n != NETBRIDGE_HDR_BYTES + len + 2u)
+    {
+        if (n != 0u) nb_dropped++;
+    }
+    else if (b[1] == NETBRIDGE_PIXELS && len <= NETBRIDGE_PIXELS_MAX)
+    {
+        lost   = nb_pixels_in(len);                         /* CRC: the renderer's */
+        pixels = true;
+    }
+    else if (b[1] == NETBRIDGE_CONTROL && len <= NETBRIDGE_CTRL_MAX)
+        nb_control_in(b, len, &woken);
+    else
+        nb_dropped++;
+    nb_arm();
+
+    if (pixels)
+    {
+        const effect_cmd_t cmd = { EFFECT_CMD_SELECT, 0u, EFFECT_NET, 0u, 0u, 0u };
+
+        if (!(NETBRIDGE_AUTO_SELECT && lost && Effects_PostFromISR(&cmd))) Effects_WakeFromISR();
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+static void nb_irq(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_NETBRIDGE);
+    nb_isr();
+    IRQSTAT_EXIT(IRQSTAT_NETBRIDGE);
+}
+
+/* Frame out (dma_qos.c DMAC_OTHER dispatch) */
+static void nb_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    (void)flags;
+    if (nb_task != NULL) vTaskNotifyGiveIndexedFromISR(nb_task, NB_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void nb_hw_init(void)
+{
+    /* TX on PAD0, RX on PAD1, 8N1 */
+    static const sercom_cfg_t usart =
+    {
+        SERCOM_USART, 3u, 0u, 1u, SERCOM_F_TX | SERCOM_F_RX,
+        SERCOM_USART_BAUD(NB_GCLK_HZ, NETBRIDGE_BAUD_HZ), 0u
+    };
+
+    Sercom_Open(NB_SERCOM, &usart);
+
+    /* PA22 -> peripheral C (SERCOM3 PAD0); PORT drives it low for the break */
+    PORT_REGS->GROUP[0].PORT_PMUX[NB_PA22 >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[NB_PA22 >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(2u));
+    PORT_REGS->GROUP[0].PORT_OUTCLR = 1u << NB_PA22;
+    PORT_REGS->GROUP[0].PORT_DIRSET = 1u << NB_PA22;
+    PORT_REGS->GROUP[0].PORT_PINCFG[NB_PA22] = PORT_PINCFG_PMUXEN_Msk;
+
+    /* PA23 -> peripheral C (SERCOM3 PAD1), pulled up so a co-processor in reset reads idle */
+    PORT_REGS->GROUP[0].PORT_PMUX[NB_PA23 >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[NB_PA23 >> 1] & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(2u));
+    PORT_REGS->GROUP[0].PORT_OUTSET = 1u << NB_PA23;
+    PORT_REGS->GROUP[0].PORT_PINCFG[NB_PA23] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_PULLEN_Msk;
+
+    SERCOM3_REGS->USART_INT.SERCOM_INTENSET = SERCOM_USART_INT_INTENSET_ERROR_Msk;
+
+    (void)Sercom_DmaAttach(NB_SERCOM, SERCOM_DMA_RX, NETBRIDGE_DMA_RX, DMA_CLASS_COMMS, NULL);
+    (void)Sercom_DmaAttach(NB_SERCOM, SERCOM_DMA_TX, NETBRIDGE_DMA_TX, DMA_CLASS_COMMS, nb_dma_isr);
+    nb_arm();
+
+    Sercom_Enable(NB_SERCOM);
+    (void)Sercom_Irq(NB_SERCOM, nb_irq, NETBRIDGE_IRQ_PRIO);
+}
+
+/* -- Transmit ---------------------------------------------------------------- */
+
+/* Frame the `len` payload bytes already at nb_tx + header, send it and the break. NetBr task */
+static void nb_send(uint8_t type, uint32_t len)
+{
+    uint32_t n = NETBRIDGE_HDR_BYTES + len;
+    uint16_t crc;
+
+    nb_tx[0] = NETBRIDGE_MAGIC;
+    nb_tx[1] = type;
+    nb_tx[2] = nb_seq++;
+    nb_tx[3] = 0u;
+    nb_tx[4] = (uint8_t)len;
+    nb_tx[5] = (uint8_t)(len >> 8);
+    crc = Crc16_Ccitt(nb_tx, n);
+    nb_tx[n++] = (uint8_t)crc;
+    nb_tx[n++] = (uint8_t)(crc >> 8);
+
+    (void)ulTaskNotifyTakeIndexed(NB_NOTIFY_INDEX, pdTRUE, 0u);
+    Sercom_DmaStart(NB_SERCOM, SERCOM_DMA_TX, NETBRIDGE_DMA_TX, nb_tx, n);
+
+    /* The DMAC is done when the last byte is in the shifter; the line goes low after it */
+    if (ulTaskNotifyTakeIndexed(NB_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(10u)) == 0u)
+        (void)Sercom_DmaStop(NETBRIDGE_DMA_TX);
+    while ((SERCOM3_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_TXC_Msk) == 0u) {}
+    SERCOM3_REGS->USART_INT.SERCOM_INTFLAG = SERCOM_USART_INT_INTFLAG_TXC_Msk;
+    PORT_REGS->GROUP[0].PORT_PINCFG[NB_PA22] = 0u;
+    nb_spin_us(NETBRIDGE_BREAK_US);
+    PORT_REGS->GROUP[0].PORT_PINCFG[NB_PA22] = PORT_PINCFG_PMUXEN_Msk;
+}
+
+static void nb_status(void)
+{
+    bool present = nb_seen && (xTaskGetTickCount() - nb_last) < pdMS_TO_TICKS(NETBRIDGE_LOSS_MS);
+    uint8_t *p   = &nb_tx[NETBRIDGE_HDR_BYTES];
+
+    p[0] = (uint8_t)net_univ;
+    p[1] = (uint8_t)(net_univ >> 8);
+    p[2] = (uint8_t)NETBRIDGE_UNIVERSES;
+    p[3] = present ? 1u : 0u;
+    nb_send(NETBRIDGE_STATUS, NB_STATUS_BYTES);
+}
+
+/* The shell's output as control frames, and the status when due */
+static void nb_task_fn(void *arg)
+{
+    TickType_t next = xTaskGetTickCount();
+
+    (void)arg;
+    for (;;)
+    {
+        TickType_t now  = xTaskGetTickCount();
+        TickType_t wait = ((int32_t)(next - now) > 0) ? next - now : 0u;
+        size_t     n    = xStreamBufferReceive(nb_tx_stream, &nb_tx[NETBRIDGE_HDR_BYTES],
+                                               NETBRIDGE_CTRL_MAX, wait);
+
+        if (n != 0u)
+        {
+            nb_send(NETBRIDGE_CONTROL, n);
+            nb_ctrl_out += n;
+        }
+        if ((int32_t)(xTaskGetTickCount() - next) >= 0)
+        {
+            nb_status();
+            next = xTaskGetTickCount() + pdMS_TO_TICKS(NETBRIDGE_STATUS_MS);
+        }
+    }
+}
+
+#endif /* NETBRIDGE_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void NetBridge_Start(void)
+{
+#if NETBRIDGE_ENABLE
+    for (uint32_t i = 0; i < sizeof(nb_params) / sizeof(nb_params[0]); i++)
+        (void)Cli_Register(&nb_params[i]);
+    nb_rx_stream = xStreamBufferCreateStatic(NETBRIDGE_RX_STREAM, 1u, nb_rx_stream_store, &nb_rx_stream_buf);
+    nb_tx_stream = xStreamBufferCreateStatic(NETBRIDGE_TX_STREAM, 1u, nb_tx_stream_store, &nb_tx_stream_buf);
+    nb_task = xTaskCreateStatic(nb_task_fn, "NetBr", NB_STACK, NULL, NETBRIDGE_TASK_PRIO,
+                                nb_stack, &nb_tcb);
+    nb_hw_init();
+#endif
+}
+
+void NetBridge_GetStats(netbridge_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    out->frames     = nb_frames;
+    out->received   = nb_received;
+    out->crc_errors = nb_crc_errors;
+    out->dropped    = nb_dropped;
+    out->overruns   = nb_overruns;
+    out->ctrl_in    = nb_ctrl_in;
+    out->ctrl_out   = nb_ctrl_out;
+    out->ctrl_lost  = nb_ctrl_lost;
+#if NETBRIDGE_ENABLE
+    out->slots      = nb_seen ? nb_len[nb_ready] : 0u;
+    out->artnet     = nb_artnet;
+    out->present    = nb_seen && (xTaskGetTickCount() - nb_last) < pdMS_TO_TICKS(NETBRIDGE_LOSS_MS);
+#else
+    out->slots      = 0u;
+    out->artnet     = false;
+    out->present    = false;
+#endif
+    taskEXIT_CRITICAL();
+}
+
+uint32_t NetBridge_Frames(void)
+{
+    return nb_frames;
+}
+
+bool NetBridge_Update(uint8_t steps)
+{
+    (void)steps;
+#if NETBRIDGE_ENABLE
+    bool back = true;                           /* nb_ready still holds the look on show */
+
+    for (;;)
+    {
+        bool    fresh;
+        uint8_t t;
+
+        taskENTER_CRITICAL();
+        fresh = nb_fresh;
+        if (fresh)
+        {
+            t         = nb_rd;
+            nb_rd     = nb_ready;
+            nb_ready  = t;
+            nb_fresh  = false;
+        }
+        taskEXIT_CRITICAL();
+        if (!fresh) return false;
+
+        const uint8_t *b   = nb_buf[nb_rd];
+        uint16_t       len = nb_len[nb_rd];
+
+        if (nb_crc_ok(b, len))
+        {
+            nb_rd_len = len;
+            nb_artnet = (b[3] & NB_FLAG_ARTNET) != 0u;
+            nb_frames++;
+            return true;
+        }
+        nb_crc_errors++;
+
+        /* Back to the last good frame, unless the receiver has recycled it for a newer one */
+        taskENTER_CRITICAL();
+        fresh = nb_fresh;
+        if (!fresh && back)
+        {
+            t        = nb_rd;
+            nb_rd    = nb_ready;
+            nb_ready = t;
+        }
+        taskEXIT_CRITICAL();
+        if (!fresh)
+        {
+            if (!back) nb_rd_len = 0u;          /* nothing good left: black until the next */
+            return false;
+        }
+        back = false;
+    }
+#else
+    return false;
+#endif
+}
+
+pix_t CACHE_HOT NetBridge_Pixel(uint16_t i, uint8_t offset)
+{
+    (void)offset;
+#if NETBRIDGE_ENABLE
+    const uint8_t *u = &nb_buf[nb_rd][NETBRIDGE_HDR_BYTES];
+    uint32_t p = (net_addr - 1u) + (uint32_t)(i / net_group) * 3u;
+    uint32_t r = nb_slot(p), g = nb_slot(p + 1u), b = nb_slot(p + 2u);
+
+    if (b >= nb_rd_len) return Pix_Make(0u, 0u, 0u);
+    return Pix_Make(u[r], u[g], u[b]);
+#else
+    (void)i;
+    return Pix_Make(0u, 0u, 0u);
+#endif
+}
+
+StreamBufferHandle_t NetBridge_RxStream(void)
+{
+#if NETBRIDGE_ENABLE
+    return nb_rx_stream;
+#else
+    return NULL;
+#endif
+}
+
+size_t NetBridge_Write(const void *data, size_t count)
+{
+#if NETBRIDGE_ENABLE
+    if (nb_tx_stream == NULL) return 0u;
+    return xStreamBufferSend(nb_tx_stream, data, count, pdMS_TO_TICKS(NETBRIDGE_WRITE_MS));
+#else
+    (void)data;
+    (void)count;
+    return 0u;
+#endif
+}
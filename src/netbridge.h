@@ -0,0 +1,150 @@
+/* =============================================================================
+ * netbridge.h  -  Network co-processor link: sACN / Art-Net universes over a UART
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The SAME51 has no Ethernet MAC, so a prop that is to join a networked
+ * lighting rig does it through a co-processor (an ESP32 on Wi-Fi or with
+ * an Ethernet PHY) that speaks sACN (E1.31) and Art-Net, merges the
+ * universes this prop takes and forwards them, whole, as one frame per
+ * look over a high-rate UART:
+ *
+ *   Link   SERCOM3 USART at NETBRIDGE_BAUD_HZ 8N1 from GCLK3 48 MHz,
+ *          peripheral C: TX to the co-processor on PA22 (PAD0), RX from
+ *          it on PA23 (PAD1). Board to board, 3.3 V, no transceiver.
+ *   Frame  header, payload, CRC, then a break (line low >= 2 characters;
+ *          ESP-IDF's uart_write_bytes_with_break() sends exactly this):
+ *
+ *            magic 0xC5, type, seq, flags, len (u16), payload[len], CRC-16
+ *
+ *          little endian; the CRC is CRC-16/CCITT-FALSE (as pixdist.h)
+ *          over everything before it. In both directions.
+ *   Types  co-processor to prop:
+ *            PIXELS   the slots of universes net_univ .. + NETBRIDGE_UNIVERSES
+ *                     - 1, 512 each, back to back (len may stop short:
+ *                     the rest read as 0); flags bit 0: from Art-Net
+ *            CONTROL  console bytes for the "CLI-NET" shell (cli.h)
+ *          prop to co-processor:
+ *            CONTROL  that shell's output
+ *            STATUS   net_univ (u16), NETBRIDGE_UNIVERSES (u8), 1 if frames
+ *                     are arriving (u8); every NETBRIDGE_STATUS_MS, so the
+ *                     co-processor knows what to subscribe to
+ *
+ * The receive side is the DMX path (dmx.h) at a higher rate: the DMAC
+ * (NETBRIDGE_DMA_RX, COMMS class) moves every byte from the USART into
+ * one of three frame buffers, and the break that ends a frame is the only
+ * interrupt: it checks the header, hands a pixel frame over (the newest
+ * whole one waits, the renderer reads the third) and re-arms. EFFECT_NET
+ * reads its pixels straight out of the frame buffer, no copy on the way:
+ * LED i shows slots net_addr + 3 * (i / net_group) .. + 2 as R, G, B,
+ * 170 pixels to a universe (slots 511 and 512 unused, as pixel
+ * controllers patch them), so NETBRIDGE_UNIVERSES universes cover the
+ * scene (pixdist.h included) through the normal gamma, brightness and
+ * power limiting. The frame's CRC is checked when the renderer takes it;
+ * a bad one is counted and the last good look stays. With
+ * NETBRIDGE_AUTO_SELECT the first frame after NETBRIDGE_LOSS_MS switches
+ * segment 0 to it, as for DMX.
+ *
+ * At 3 Mbit/s a frame of two universes takes ~3.5 ms, so the link carries
+ * the whole scene at any rate the strip can show. Control frames go to a
+ * stream buffer from the same interrupt; the "NetBr" task, just above
+ * idle, frames the shell's output and the status and sends them by DMA
+ * (NETBRIDGE_DMA_TX).
+ *
+ * SERCOM3 and PA22 are NeoPixel output 1, so NETBRIDGE_ENABLE needs
+ * NEO_OUTPUTS == 1. DMX, the pixdist link (SERCOM4) and the show sync
+ * build alongside it.
+ * ============================================================================= */
+
+#ifndef NETBRIDGE_H
+#define NETBRIDGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+#include "pixmath.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef NETBRIDGE_ENABLE
+#define NETBRIDGE_ENABLE        0       /* 1 = a network co-processor is on PA22/PA23 */
+#endif
+#define NETBRIDGE_BAUD_HZ       3000000u    /* 48 MHz / 16 at most                   */
+#define NETBRIDGE_UNIVERSES     2u      /* taken from net_univ on, 170 pixels each   */
+#define NETBRIDGE_DMA_RX        17u     /* DMA_OTHER channels, dma_qos.h             */
+#define NETBRIDGE_DMA_TX        18u
+#define NETBRIDGE_IRQ_PRIO      IRQ_PRIO_NETBRIDGE  /* NVIC, irqprio.h           */
+#define NETBRIDGE_LOSS_MS       1000u   /* no pixel frame for this long: lost        */
+#define NETBRIDGE_AUTO_SELECT   1       /* 1 = first frame after a loss selects it   */
+#define NETBRIDGE_CTRL_MAX      128u    /* control bytes per frame, either way       */
+#define NETBRIDGE_RX_STREAM     256u    /* control bytes waiting for the shell       */
+#define NETBRIDGE_TX_STREAM     512u    /* shell output waiting for the link         */
+#define NETBRIDGE_WRITE_MS      50u     /* NetBridge_Write(): longest wait for room  */
+#define NETBRIDGE_STATUS_MS     1000u   /* STATUS to the co-processor                */
+#define NETBRIDGE_BREAK_US      10u     /* after a frame we send: 30 bit times       */
+#define NETBRIDGE_TASK_PRIO     1u      /* with the shell, just above idle           */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define NETBRIDGE_MAGIC         0xC5u
+#define NETBRIDGE_HDR_BYTES     6u
+#define NETBRIDGE_SLOTS         512u                                       /* per universe */
+#define NETBRIDGE_PIXELS_MAX    (NETBRIDGE_UNIVERSES * NETBRIDGE_SLOTS)    /* payload      */
+#define NETBRIDGE_FRAME_BYTES   (NETBRIDGE_HDR_BYTES + NETBRIDGE_PIXELS_MAX + 2u)
+
+typedef enum
+{
+    NETBRIDGE_PIXELS  = 1,
+    NETBRIDGE_CONTROL = 2,
+    NETBRIDGE_STATUS  = 3
+} netbridge_type_t;
+
+typedef struct
+{
+    uint32_t frames;            /* pixel frames taken by the renderer        */
+    uint32_t received;          /* ...and in from the link                   */
+    uint32_t crc_errors;
+    uint32_t dropped;           /* runts, bad headers, unknown types         */
+    uint32_t overruns;          /* USART buffer overflows                    */
+    uint32_t ctrl_in;           /* control bytes to the shell                */
+    uint32_t ctrl_out;          /* ...and from it                            */
+    uint32_t ctrl_lost;         /* control bytes the full stream refused     */
+    uint16_t slots;             /* in the latest pixel frame                 */
+    bool     artnet;            /* ...from Art-Net, else sACN                */
+    bool     present;           /* a pixel frame within NETBRIDGE_LOSS_MS    */
+} netbridge_stats_t;
+
+/**
+ * Set up PA22/PA23, SERCOM3 and both DMA channels, the streams and the
+ * "NetBr" task, and start listening; registers net_univ, net_addr and
+ * net_group. Before the scheduler and Cli_Start(). Does nothing unless
+ * NETBRIDGE_ENABLE.
+ */
+void NetBridge_Start(void);
+
+/** Counters and signal state. Any task. */
+void NetBridge_GetStats(netbridge_stats_t *out);
+
+/** Pixel frames taken (telemetry). Any task. */
+uint32_t NetBridge_Frames(void);
+
+/**
+ * Effect frame hook: take the newest whole frame, if one came since the
+ * last and its CRC holds, for the NetBridge_Pixel() calls that follow.
+ * True if it did.
+ */
+bool NetBridge_Update(uint8_t steps);
+
+/** Effect kernel: LED i from its patched slots, black past the frame's end. */
+pix_t NetBridge_Pixel(uint16_t i, uint8_t offset);
+
+/** Control bytes from the co-processor; NULL unless NETBRIDGE_ENABLE. Read by one task only. */
+StreamBufferHandle_t NetBridge_RxStream(void);
+
+/**
+ * Queue `count` bytes for the co-processor as CONTROL frames, waiting up
+ * to NETBRIDGE_WRITE_MS for room. Bytes queued. One task (the CLI-NET
+ * shell) only.
+ */
+size_t NetBridge_Write(const void *data, size_t count);
+
+#endif /* NETBRIDGE_H */
@@ -0,0 +1,195 @@
+/* =============================================================================
+ * nvstore.c  -  Small persistent records in a flash block
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "nvstore.h"
+#include "definitions.h"        /* NVMCTRL plib, FLASH_ADDR, CMCC */
+#include "settings.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include <string.h>
+
+/* The block below the two SmartEEPROM sectors (settings.h), which end the flash */
+#define NVSTORE_ADDR    (FLASH_ADDR + FLASH_SIZE - (2u * SETTINGS_SEESBLK + 1u) * NVMCTRL_FLASH_BLOCKSIZE)
+#define NVSTORE_REC     16u                                 /* one quad word */
+#define NVSTORE_SLOTS   (NVMCTRL_FLASH_BLOCKSIZE / NVSTORE_REC)
+#define NVSTORE_ERASED  0xFFFFFFFFu
+#define NVSTORE_SALT    0x5AC3E10Fu
+
+#if (NVSTORE_WORDS + 2u) * 4u != NVSTORE_REC
+#error "a record is key + NVSTORE_WORDS + check in one 16-byte quad word"
+#endif
+
+_Static_assert(NVSTORE_ADDR >= FLASH_ADDR + FLASH_SIZE / 2u,
+               "nvstore in the upper bank, never the one running: writes must not stall fetches");
+
+typedef struct
+{
+    uint32_t key;
+    uint32_t data[NVSTORE_WORDS];
+    uint32_t check;
+} nvstore_rec_t;
+
+/* -- Internal helpers --------------------------------------------------------- */
+
+static const nvstore_rec_t *nvstore_slot(uint32_t i)
+{
+    return (const nvstore_rec_t *)(NVSTORE_ADDR + i * NVSTORE_REC);
+}
+
+static uint32_t nvstore_check(const nvstore_rec_t *r)
+{
+    uint32_t c = r->key ^ NVSTORE_SALT;
+
+    for (uint32_t w = 0; w < NVSTORE_WORDS; w++)
+        c = ((c << 5) | (c >> 27)) ^ r->data[w];
+    return c;
+}
+
+static bool nvstore_valid(const nvstore_rec_t *r)
+{
+    return r->key != NVSTORE_ERASED && r->check == nvstore_check(r);
+}
+
+/* First never-written slot, NVSTORE_SLOTS if the block is full */
+static uint32_t nvstore_free(void)
+{
+    uint32_t i = 0;
+
+    while (i < NVSTORE_SLOTS && nvstore_slot(i)->key != NVSTORE_ERASED)
+        i++;
+    return i;
+}
+
+/* Newest valid record of key, NULL if none */
+static const nvstore_rec_t *nvstore_find(uint32_t key)
+{
+    const nvstore_rec_t *found = NULL;
+
+    for (uint32_t i = 0; i < NVSTORE_SLOTS; i++)
+    {
+        const nvstore_rec_t *r = nvstore_slot(i);
+
+        if (r->key == NVSTORE_ERASED) break;
+        if (r->key == key && nvstore_valid(r)) found = r;
+    }
+    return found;
+}
+
+/* The CMCC caches flash: drop its lines after the block has changed */
+static void nvstore_invalidate(void)
+{
+    if ((CMCC_REGS->CMCC_SR & CMCC_SR_CSTS_Msk) == 0u) return;
+
+    CMCC_REGS->CMCC_CTRL = 0u;
+    while ((CMCC_REGS->CMCC_SR & CMCC_SR_CSTS_Msk) != 0u) {}
+    CMCC_REGS->CMCC_MAINT0 = CMCC_MAINT0_INVALL_Msk;
+    CMCC_REGS->CMCC_CTRL = CMCC_CTRL_CEN_Msk;
+}
+
+/* Sleep through the busy flash (nvwrite.h), except where a task may not
+ * block: before the scheduler, and in the timer task (fwupdate.c's seal
+ * and carry, right before the swap) */
+static void nvstore_idle(void)
+{
+    bool sleep = xTaskGetSchedulerState() == taskSCHEDULER_RUNNING &&
+                 xTaskGetCurrentTaskHandle() != xTimerGetTimerDaemonTaskHandle();
+
+    while (NVMCTRL_IsBusy() || NVMCTRL_SmartEEPROM_IsBusy())
+        if (sleep) vTaskDelay(1);
+}
+
+/* A command of another flash user (fwupdate.c) may still run: a new one
+ * issued now would be lost */
+static void nvstore_ready(void)
+{
+    nvstore_idle();
+}
+
+static bool nvstore_wait(void)
+{
+    nvstore_idle();
+    return NVMCTRL_ErrorGet() == 0u;
+}
+
+static bool nvstore_write(uint32_t slot, const nvstore_rec_t *r)
+{
+    if (!NVMCTRL_QuadWordWrite((const uint32_t *)r, NVSTORE_ADDR + slot * NVSTORE_REC))
+        return false;
+    return nvstore_wait();
+}
+
+/* Block full: keep the newest record of every key, erase, write them back */
+static bool nvstore_compact(uint32_t *next)
+{
+    static nvstore_rec_t keep[NVSTORE_MAX_KEYS];     /* off the caller's stack */
+    uint32_t n = 0;
+    bool ok = true;
+
+    for (uint32_t i = 0; i < NVSTORE_SLOTS; i++)
+    {
+        const nvstore_rec_t *r = nvstore_slot(i);
+        uint32_t k = 0;
+
+        if (!nvstore_valid(r)) continue;
+        while (k < n && keep[k].key != r->key) k++;
+        if (k == n)
+        {
+            if (n == NVSTORE_MAX_KEYS) return false;
+            n++;
+        }
+        keep[k] = *r;
+    }
+
+    nvstore_ready();
+    NVMCTRL_RegionUnlock(NVSTORE_ADDR);
+    if (!NVMCTRL_BlockErase(NVSTORE_ADDR) || !nvstore_wait()) ok = false;
+    for (uint32_t k = 0; ok && k < n; k++)
+        ok = nvstore_write(k, &keep[k]);
+    nvstore_invalidate();
+    *next = n;
+    return ok;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool NvStore_Load(uint32_t key, uint32_t data[NVSTORE_WORDS])
+{
+    const nvstore_rec_t *r = nvstore_find(key);
+
+    if (r == NULL) return false;
+    memcpy(data, r->data, sizeof(r->data));
+    return true;
+}
+
+bool NvStore_Save(uint32_t key, const uint32_t data[NVSTORE_WORDS])
+{
+    const nvstore_rec_t *old = nvstore_find(key);
+    nvstore_rec_t rec;
+    uint32_t slot;
+    bool ok;
+
+    if (key == NVSTORE_ERASED) return false;
+    if (old != NULL && memcmp(old->data, data, sizeof(old->data)) == 0) return true;
+
+    rec.key = key;
+    memcpy(rec.data, data, sizeof(rec.data));
+    rec.check = nvstore_check(&rec);
+
+    slot = nvstore_free();
+    if (slot == NVSTORE_SLOTS && !nvstore_compact(&slot)) return false;
+    if (slot == NVSTORE_SLOTS) return false;            /* NVSTORE_MAX_KEYS fill it */
+
+    nvstore_ready();
+    NVMCTRL_RegionUnlock(NVSTORE_ADDR);
+    ok = nvstore_write(slot, &rec);
+    nvstore_invalidate();
+    return ok;
+}
+
+uint32_t NvStore_Address(void)
+{
+    return NVSTORE_ADDR;
+}
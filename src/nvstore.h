@@ -0,0 +1,49 @@
+/* =============================================================================
+ * nvstore.h  -  Small persistent records in a flash block
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The 8 KB erase block just below the SmartEEPROM sectors (settings.h) at
+ * the end of flash (bank B, so programming it does not stall code running
+ * from bank A) holds an append-only log of 16-byte records: a 32-bit key,
+ * NVSTORE_WORDS data words and a check word, each written with one NVMCTRL
+ * quad-word write. Saving a key appends a new
+ * record; loading returns the newest valid one. When the block is full the
+ * newest record of every key is kept in RAM, the block is erased and they
+ * are written back, so one erase covers ~500 saves.
+ *
+ * An interrupted write or erase only loses the record being written: a
+ * record whose check word does not match is skipped.
+ *
+ * Not reentrant: saves are made by the NvWrite task (nvwrite.h), between
+ * frames, or before the scheduler. Writes wait for the flash, ~0.1 ms
+ * each, an erase a few ms more; in a task they sleep through it.
+ * ============================================================================= */
+
+#ifndef NVSTORE_H
+#define NVSTORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define NVSTORE_WORDS       2u          /* data words per record               */
+#define NVSTORE_MAX_KEYS    16u         /* distinct keys kept across an erase  */
+
+/** Pick keys as four-character codes; 0xFFFFFFFF (erased flash) is reserved. */
+#define NVSTORE_KEY(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/** Newest record saved under key; false if there is none. */
+bool NvStore_Load(uint32_t key, uint32_t data[NVSTORE_WORDS]);
+
+/**
+ * Save a record under key, unless the newest one already holds the same
+ * data. False on a flash error or if the block is full of more than
+ * NVSTORE_MAX_KEYS keys.
+ */
+bool NvStore_Save(uint32_t key, const uint32_t data[NVSTORE_WORDS]);
+
+/** Flash address of the block, for fwupdate.c to carry it across a bank swap. */
+uint32_t NvStore_Address(void);
+
+#endif /* NVSTORE_H */
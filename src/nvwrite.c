@@ -0,0 +1,117 @@
+/* =============================================================================
+ * nvwrite.c  -  Background writer for the nvstore records, between frames
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "nvwrite.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include <string.h>
+
+#define NVW_STACK           (configMINIMAL_STACK_SIZE * 2u)
+#define NVW_FLUSH_POLL_MS   5u
+
+typedef struct
+{
+    uint32_t key;
+    uint32_t data[NVSTORE_WORDS];
+} nvw_job_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static StackType_t       nvw_stack[NVW_STACK];
+static StaticTask_t      nvw_tcb;
+static TaskHandle_t      nvw_task;
+static QueueHandle_t     nvw_queue;
+static StaticQueue_t     nvw_queue_buf;
+static uint8_t           nvw_queue_store[NVWRITE_JOBS * sizeof(nvw_job_t)];
+
+static volatile bool     nvw_busy;              /* a job taken, not yet written */
+static volatile bool     nvw_want;              /* waiting for the end of a frame */
+static volatile uint32_t nvw_failures;
+static volatile uint32_t nvw_dropped;
+
+static void nvw_task_fn(void *arg)
+{
+    nvw_job_t job;
+
+    (void)arg;
+    for (;;)
+    {
+        (void)xQueuePeek(nvw_queue, &job, portMAX_DELAY);
+        nvw_busy = true;                        /* before it leaves the queue: Idle() */
+        (void)xQueueReceive(nvw_queue, &job, 0);
+
+        /* Just after a frame: the whole gap to the next one is the writer's */
+        (void)ulTaskNotifyTake(pdTRUE, 0);
+        nvw_want = true;
+        (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NVWRITE_GAP_MS));
+        nvw_want = false;
+
+        if (!NvStore_Save(job.key, job.data)) nvw_failures++;
+        nvw_busy = false;
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool NvWrite_Start(void)
+{
+    nvw_queue = xQueueCreateStatic(NVWRITE_JOBS, sizeof(nvw_job_t), nvw_queue_store, &nvw_queue_buf);
+    if (nvw_queue == NULL) return false;
+    nvw_task = xTaskCreateStatic(nvw_task_fn, "NvWrite", NVW_STACK, NULL, NVWRITE_TASK_PRIO,
+                                 nvw_stack, &nvw_tcb);
+    return nvw_task != NULL;
+}
+
+bool NvWrite_Post(uint32_t key, const uint32_t data[NVSTORE_WORDS])
+{
+    nvw_job_t job;
+
+    if (nvw_task == NULL)
+    {
+        if (NvStore_Save(key, data)) return true;
+        nvw_failures++;
+        return false;
+    }
+    job.key = key;
+    memcpy(job.data, data, sizeof(job.data));
+    if (xQueueSend(nvw_queue, &job, 0) == pdPASS) return true;
+    nvw_dropped++;
+    return false;
+}
+
+bool NvWrite_Idle(void)
+{
+    return nvw_task == NULL || (!nvw_busy && uxQueueMessagesWaiting(nvw_queue) == 0u);
+}
+
+bool NvWrite_Flush(uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!NvWrite_Idle())
+    {
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(timeout_ms)) return false;
+        vTaskDelay(pdMS_TO_TICKS(NVW_FLUSH_POLL_MS));
+    }
+    return true;
+}
+
+void NvWrite_FrameDone(void)
+{
+    if (!nvw_want) return;
+    nvw_want = false;
+    (void)xTaskNotifyGive(nvw_task);
+}
+
+uint32_t NvWrite_Failures(void)
+{
+    return nvw_failures;
+}
+
+uint32_t NvWrite_Dropped(void)
+{
+    return nvw_dropped;
+}
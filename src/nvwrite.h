@@ -0,0 +1,66 @@
+/* =============================================================================
+ * nvwrite.h  -  Background writer for the nvstore records, between frames
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * nvstore.h keeps its block in the flash bank the code is not running
+ * from: the upper half of the map, which is bank B while A runs and A
+ * after a fwupdate.h swap, so a write or an erase there never stalls an
+ * instruction fetch (read-while-write; nvstore.c checks the placement,
+ * and fwupdate.h keeps every image below it). What still showed was who
+ * waited for the flash: the calibration, the visitor statistics and
+ * "save" wrote from the timer service task, at the top priority, and
+ * spun through the quad-word writes and, every ~500 saves, the block
+ * erase and its rewrite, a few ms with the actuator's steps and the
+ * render task held off behind it.
+ *
+ * Those writers now post the record to NVWRITE_JOBS and carry on. The
+ * "NvWrite" task, just above idle, owns the nvstore writes: it takes the
+ * jobs in order (so a sequence of saves, like the imgcheck.h seal, lands
+ * in the order it was made), waits for the render task to finish a frame
+ * (NvWrite_FrameDone()), or NVWRITE_GAP_MS without one while the show is
+ * still, and then saves, sleeping rather than spinning while the flash is
+ * busy. Everything above it runs meanwhile.
+ *
+ * NvStore_Load() still reads the block directly and sees a posted record
+ * once it is written; NvWrite_Flush() waits for that.
+ * ============================================================================= */
+
+#ifndef NVWRITE_H
+#define NVWRITE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nvstore.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define NVWRITE_JOBS            24u     /* queued records: every CLI key and a seal */
+#define NVWRITE_TASK_PRIO       1u      /* with the shell, just above idle          */
+#define NVWRITE_GAP_MS          250u    /* no frame this long: the show is still    */
+
+/**
+ * Create the queue and the task (static). Before the scheduler; false
+ * if either was not created, and saves are made on the spot as before.
+ */
+bool NvWrite_Start(void);
+
+/**
+ * Save `data` under `key` (NvStore_Save()) in the background. Any task,
+ * never blocks; false (and counted) if the queue is full. Before
+ * NvWrite_Start() the record is saved at once.
+ */
+bool NvWrite_Post(uint32_t key, const uint32_t data[NVSTORE_WORDS]);
+
+/** Nothing queued or being written. */
+bool NvWrite_Idle(void);
+
+/** Wait up to `timeout_ms` for NvWrite_Idle(); false if it did not come. Tasks, not the timer task. */
+bool NvWrite_Flush(uint32_t timeout_ms);
+
+/** A frame is rendered: the writer may go. NeoPixel task, every frame. */
+void NvWrite_FrameDone(void);
+
+/** Saves that failed (flash error, nvstore full), and posts the full queue refused. */
+uint32_t NvWrite_Failures(void);
+uint32_t NvWrite_Dropped(void);
+
+#endif /* NVWRITE_H */
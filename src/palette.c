@@ -0,0 +1,61 @@
+/* =============================================================================
+ * palette.c  -  16-entry gradient palettes expanded to 256-entry lookup tables
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "palette.h"
+
+/* -- Built-in palettes (flash) ----------------------------------------------- */
+
+static const palette16_t palette_table[PALETTE_COUNT] =
+{
+    /* HSV hues 0, 16, ..., 240 at full saturation and value */
+    [PALETTE_RAINBOW] = { true, {
+        0x0000FFu, 0x0060FFu, 0x00C0FFu, 0x00FFE1u, 0x00FF81u, 0x00FF21u, 0x3CFF00u, 0x9CFF00u,
+        0xFCFF00u, 0xFFA500u, 0xFF4500u, 0xFF0018u, 0xFF0078u, 0xFF00D8u, 0xC900FFu, 0x6900FFu } },
+
+    /* Green (hue 85) to purple (hue 200), the old GreenPurple ramp */
+    [PALETTE_GREEN_PURPLE] = { false, {
+        0x00FF03u, 0x24FF00u, 0x54FF00u, 0x7EFF00u, 0xAEFF00u, 0xDEFF00u, 0xFFF900u, 0xFFC900u,
+        0xFF9900u, 0xFF6F00u, 0xFF3F00u, 0xFF0F00u, 0xFF0018u, 0xFF0048u, 0xFF0072u, 0xFF00A2u } },
+
+    /* Heat 0..255: black through red and orange to yellow, value = heat */
+    [PALETTE_HEAT] = { false, {
+        0x000000u, 0x000111u, 0x000422u, 0x000C33u, 0x001444u, 0x002055u, 0x003066u, 0x004077u,
+        0x005388u, 0x006C99u, 0x0084AAu, 0x009EBBu, 0x00C0CCu, 0x00DDDCu, 0x00EEDDu, 0x00FFD5u } },
+};
+
+/* -- Expanded tables (RAM) --------------------------------------------------- */
+
+pix_t palette_lut[PALETTE_COUNT][256];
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Palette_Init(void)
+{
+    for (uint8_t p = 0; p < PALETTE_COUNT; p++)
+        Palette_Expand(&palette_table[p], palette_lut[p]);
+}
+
+const palette16_t *Palette_Get(palette_id_t id)
+{
+    return ((uint8_t)id < PALETTE_COUNT) ? &palette_table[id] : &palette_table[0];
+}
+
+pix_t Palette_Sample(const palette16_t *pal, uint8_t index)
+{
+    uint8_t hi = index >> 4;
+    uint8_t lo = index & 0x0Fu;
+    uint8_t nx = (hi < 15u) ? (uint8_t)(hi + 1u) : (pal->wrap ? 0u : 15u);
+
+    if (lo == 0u)
+        return pal->entry[hi];
+
+    return Pix_Blend(pal->entry[hi], pal->entry[nx], (uint16_t)lo << 4);
+}
+
+void Palette_Expand(const palette16_t *pal, pix_t *out)
+{
+    for (uint16_t i = 0; i < 256u; i++)
+        out[i] = Palette_Sample(pal, (uint8_t)i);
+}
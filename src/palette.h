@@ -0,0 +1,55 @@
+/* =============================================================================
+ * palette.h  -  16-entry gradient palettes expanded to 256-entry lookup tables
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A palette is 16 packed colours in flash. Palette_Sample() reads it like
+ * FastLED's ColorFromPalette(): the high nibble of the index picks an entry,
+ * the low nibble blends towards the next one (wrapping 15 -> 0 for cyclic
+ * palettes). Palette_Init() expands every built-in palette once into a
+ * 256-entry RAM table, so an effect pays a single table read per pixel
+ * through Palette_Lookup().
+ * ============================================================================= */
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+
+typedef enum
+{
+    PALETTE_RAINBOW = 0,
+    PALETTE_GREEN_PURPLE,
+    PALETTE_HEAT,
+    PALETTE_COUNT
+} palette_id_t;
+
+typedef struct
+{
+    bool  wrap;             /* true: entry 15 blends back into entry 0 */
+    pix_t entry[16];
+} palette16_t;
+
+/* Expanded built-in palettes, filled by Palette_Init(); use Palette_Lookup() */
+extern pix_t palette_lut[PALETTE_COUNT][256];
+
+/** Expand every built-in palette. Call once at start-up, before rendering. */
+void Palette_Init(void);
+
+/** Built-in palette source (flash). */
+const palette16_t *Palette_Get(palette_id_t id);
+
+/** Interpolated colour at index 0-255 of any 16-entry palette. */
+pix_t Palette_Sample(const palette16_t *pal, uint8_t index);
+
+/** Fill out[256] with every Palette_Sample() of pal. */
+void Palette_Expand(const palette16_t *pal, pix_t *out);
+
+/** Colour at index of an expanded built-in palette: one table read. */
+static inline pix_t Palette_Lookup(palette_id_t id, uint8_t index)
+{
+    return palette_lut[id][index];
+}
+
+#endif /* PALETTE_H */
@@ -0,0 +1,140 @@
+/* =============================================================================
+ * particles.c  -  Fixed-pool particle system for short-lived strip effects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "particles.h"
+#include "neopixel.h"
+#include "pixdist.h"
+#include "cache.h"
+
+#define PARTICLE_END        PARTICLE_POS(PIXDIST_SCENE_LEDS)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static particle_t part_pool[PARTICLES_MAX];     /* [0, part_count) live */
+static uint8_t    part_count = 0u;
+static uint8_t    part_cap   = PARTICLES_MAX;   /* Spawn() admits up to this many */
+static pix_t      part_px[PIXDIST_SCENE_LEDS];
+static bool       part_lit   = false;           /* part_px not all black */
+
+/* Advance one particle by steps; false once it has died */
+static bool part_step(particle_t *p, uint8_t steps)
+{
+    if (p->life <= steps) return false;
+    p->life = (uint8_t)(p->life - steps);
+
+    for (uint8_t s = 0; s < steps; s++)
+    {
+        p->vel  = (int16_t)(p->vel + p->accel);
+        p->pos += p->vel;
+    }
+
+    if (p->pos < 0 || p->pos >= PARTICLE_END)
+    {
+        if ((p->flags & PARTICLE_WRAP) == 0u) return false;
+
+        p->pos %= PARTICLE_END;
+        if (p->pos < 0)
+            p->pos += PARTICLE_END;
+    }
+    return true;
+}
+
+/* Add a particle into part_px, split over two LEDs at each end by its sub-LED offset */
+static void part_draw(const particle_t *p)
+{
+    pix_t    c    = p->colour;
+    uint16_t led  = (uint16_t)(p->pos >> 8);
+    uint8_t  frac = (uint8_t)p->pos;
+
+    if ((p->flags & PARTICLE_FADE) != 0u)
+        c = Pix_Scale(c, (uint8_t)(((uint32_t)p->life * 255u) / p->life0));
+
+    for (uint16_t k = 0; k <= p->size; k++)
+    {
+        uint16_t i = (uint16_t)(led + k);
+        pix_t    v = c;
+
+        if (k == 0u)
+            v = Pix_Scale(c, (uint8_t)(255u - frac));
+        else if (k == p->size)
+            v = (frac != 0u) ? Pix_Scale(c, (uint8_t)(frac - 1u)) : 0u;
+
+        if (i >= PIXDIST_SCENE_LEDS)
+        {
+            if ((p->flags & PARTICLE_WRAP) == 0u) break;
+            i = (uint16_t)(i - PIXDIST_SCENE_LEDS);
+        }
+        part_px[i] = Pix_AddSat(part_px[i], v);
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Particles_Init(void)
+{
+    part_count = 0u;
+    part_lit   = false;
+    Pix_Fill(part_px, PIXDIST_SCENE_LEDS, 0u);
+}
+
+bool Particles_Spawn(const particle_t *p)
+{
+    if (part_count >= part_cap || p->life == 0u) return false;
+
+    particle_t *n = &part_pool[part_count++];
+
+    *n       = *p;
+    n->life0 = p->life;
+    if (n->size == 0u)
+        n->size = 1u;
+    return true;
+}
+
+uint8_t Particles_Count(void)
+{
+    return part_count;
+}
+
+void Particles_Clear(void)
+{
+    part_count = 0u;
+}
+
+void Particles_SetCap(uint8_t cap)
+{
+    part_cap = (cap < PARTICLES_MAX) ? cap : PARTICLES_MAX;
+}
+
+bool Particles_Update(uint8_t steps)
+{
+    bool was_lit = part_lit;
+
+    if (steps > PARTICLES_MAX_STEPS)
+        steps = PARTICLES_MAX_STEPS;
+
+    Pix_Fill(part_px, PIXDIST_SCENE_LEDS, 0u);
+
+    for (uint8_t k = 0; k < part_count; )
+    {
+        particle_t *p = &part_pool[k];
+
+        if (!part_step(p, steps))
+        {
+            *p = part_pool[--part_count];   /* swap-remove, re-check slot k */
+            continue;
+        }
+        part_draw(p);
+        k++;
+    }
+
+    part_lit = (part_count != 0u);
+    return part_lit || was_lit;
+}
+
+pix_t CACHE_HOT Particles_Pixel(uint16_t i, uint8_t offset)
+{
+    (void)offset;
+    return part_px[i];
+}
@@ -0,0 +1,79 @@
+/* =============================================================================
+ * particles.h  -  Fixed-pool particle system for short-lived strip effects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Sparks, drips and lightning strikes are particles: a position and
+ * velocity along the strip (1/256 LED fixed point), an optional
+ * acceleration (gravity), a colour, a size in LEDs and a lifetime in frames.
+ *
+ * The pool is a static array of PARTICLES_MAX entries kept densely packed:
+ * Particles_Spawn() appends in O(1) and a dying particle is replaced by the
+ * last live one, also O(1). When the pool is full a spawn is refused (false)
+ * instead of growing the frame time, so a frame never handles more than
+ * PARTICLES_MAX particles for at most PARTICLES_MAX_STEPS steps.
+ *
+ * Particles render additively into their own strip buffer; show them with
+ * the EFFECT_PARTICLES effect, typically on an overlay layer with
+ * EFFECT_BLEND_ADD (see effects.h). All calls belong to the NeoPixel task.
+ * ============================================================================= */
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define PARTICLES_MAX       32u         /* pool size = per-frame update budget   */
+#define PARTICLES_MAX_STEPS 4u          /* frame slots simulated per frame, max  */
+
+#define PARTICLE_FADE       0x01u       /* dim linearly over the lifetime        */
+#define PARTICLE_WRAP       0x02u       /* wrap at the strip ends instead of die */
+
+#define PARTICLE_POS(led)   ((int32_t)(led) << 8)       /* LED index -> position */
+
+typedef struct
+{
+    int32_t pos;            /* 1/256 LED, first LED of the particle          */
+    int16_t vel;            /* 1/256 LED per frame                           */
+    int16_t accel;          /* 1/256 LED per frame per frame                 */
+    pix_t   colour;         /* at full life                                  */
+    uint8_t life;           /* frames left; 0 is not spawned                 */
+    uint8_t size;           /* LEDs covered, >= 1                            */
+    uint8_t flags;          /* PARTICLE_*                                    */
+    uint8_t life0;          /* lifetime at spawn, set by Particles_Spawn()   */
+} particle_t;
+
+/** Empty the pool and the particle buffer. */
+void Particles_Init(void);
+
+/**
+ * Add a copy of p. Returns false (and drops it) when the pool is full, or
+ * holds the Particles_SetCap() count, or life is 0.
+ */
+bool Particles_Spawn(const particle_t *p);
+
+/** Live particles. */
+uint8_t Particles_Count(void);
+
+/** Kill every particle. */
+void Particles_Clear(void);
+
+/**
+ * Admit at most `cap` live particles (PARTICLES_MAX = all); the ones above
+ * it live out their life. Detail control for fpsctl.h. Render task.
+ */
+void Particles_SetCap(uint8_t cap);
+
+/**
+ * Advance every particle by `steps` frame slots (capped), retire the dead
+ * ones and redraw the particle buffer. Effect frame hook: returns true
+ * while particles are alive or the last ones still have to be cleared.
+ */
+bool Particles_Update(uint8_t steps);
+
+/** Per-pixel kernel for the effect registry: LED i of the particle buffer. */
+pix_t Particles_Pixel(uint16_t i, uint8_t offset);
+
+#endif /* PARTICLES_H */
@@ -0,0 +1,560 @@
+/* =============================================================================
+ * pixdist.c  -  Master/slave pixel distribution: one scene across several boards
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "pixdist.h"
+#include "definitions.h"        /* SERCOM4, DMAC, DWT, __ALIGNED */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "cli.h"
+#include "irqstat.h"
+#include "sercom.h"
+#include "crc.h"
+#include <string.h>
+
+#if (PIXDIST_ROLE != PIXDIST_NONE) && (NEO_OUTPUTS > 3u)
+#error "PIXDIST_ROLE needs SERCOM4 / PB12, which NeoPixel output 3 uses"
+#endif
+#if (PIXDIST_ROLE == PIXDIST_SLAVE) && !NEO_STREAMING
+#error "A PIXDIST_SLAVE receives into the streaming back buffer, set NEO_STREAMING to 1"
+#endif
+#if (PIXDIST_ROLE == PIXDIST_SLAVE) && (PIXDIST_BOARD_LEDS != NUM_LEDS)
+#error "A PIXDIST_SLAVE drives PIXDIST_BOARD_LEDS LEDs, set NUM_LEDS to match"
+#endif
+#if PIXDIST_BOARDS * (PIXDIST_BOARD_LEDS * NEO_CHANNELS + 2u) + 4u > 0xFFFFu
+#error "PIXDIST frame too long for one DMA block"
+#endif
+#if (PIXDIST_ROLE == PIXDIST_MASTER) && (NUM_LEDS + PIXDIST_BOARDS * PIXDIST_BOARD_LEDS > 0xFFFFu)
+#error "PIXDIST_SCENE_LEDS must stay below 64K"
+#endif
+#if PIXDIST_BOARD_LEDS * NEO_CHANNELS >= 0x8000u
+#error "PIXDIST section lengths are 15 bits, shorten PIXDIST_BOARD_LEDS"
+#endif
+
+#define PD_SERCOM           4u
+#define PD_GCLK_HZ          48000000u       /* GCLK3 */
+#define PD_PB12             12u             /* master TX, SERCOM4 PAD0 */
+#define PD_PB13             13u             /* slave RX, SERCOM4 PAD1  */
+#define PD_CYC_US           (configCPU_CLOCK_HZ / 1000000u)
+#define PD_HDR_LEN          4u              /* len[] in the header          */
+#define PD_HDR_CRC          (PIXDIST_HDR_BYTES - 2u)
+#define PD_LEN_MSK          (PIXDIST_KEY - 1u)
+#define PD_RUN_HDR          3u              /* offset u16, count u8         */
+#define PD_RUN_MAX          255u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t pd_frames;
+static volatile uint32_t pd_skipped;
+static volatile uint32_t pd_crc_errors;
+static volatile uint32_t pd_dropped;
+static volatile uint32_t pd_overruns;
+static volatile uint32_t pd_keys;
+static volatile uint32_t pd_resyncs;
+static volatile uint32_t pd_bytes;
+
+#if PIXDIST_ROLE != PIXDIST_NONE
+
+#if PIXDIST_ROLE == PIXDIST_MASTER
+
+static uint8_t       pd_frame[PIXDIST_FRAME_BYTES] DMA_RAM __ALIGNED(4);
+static uint8_t       pd_ref[PIXDIST_BOARDS][PIXDIST_PART_BYTES];   /* each board's part as last sent */
+static uint8_t       pd_seq;
+static bool          pd_keyed;                      /* first frame sent: all keys */
+static volatile bool pd_tx_busy;
+
+static const uint8_t pd_order[NEO_CHANNELS] = NEO_WIRE_ORDER;
+
+#else
+
+typedef enum
+{
+    PD_RX_HELD = 0,                 /* back buffer with the slave loop               */
+    PD_RX_READY,                    /* arm at the next break                         */
+    PD_RX_HDR,                      /* header coming in                              */
+    PD_RX_BUSY,                     /* sections chained from its lengths             */
+    PD_RX_DONE                      /* whole frame in, slave loop woken              */
+} pd_rx_t;
+
+static uint8_t  pd_board = 1u;                  /* this slave's part, 1-based */
+static uint8_t  pd_hdr[PIXDIST_HDR_BYTES];
+static uint8_t  pd_crc[2];
+static uint8_t  pd_sink;                        /* other boards' bytes        */
+static uint8_t  pd_delta[PIXDIST_PART_BYTES];   /* this board's delta runs    */
+static uint8_t *volatile pd_dst;                /* NeoPixel streaming back buffer */
+static volatile uint8_t  pd_rx = PD_RX_HELD;
+static volatile bool     pd_key;                /* the section went to pd_dst */
+static volatile uint16_t pd_len;                /* ...of this many bytes      */
+
+static uint8_t       pd_shown;                  /* seq of the frame on the strip... */
+static volatile bool pd_synced;                 /* ...and the back buffer holds it  */
+
+static TaskHandle_t            pd_task;
+static volatile TickType_t     pd_last;
+static volatile bool           pd_seen;
+
+/* Descriptors after the channel's first, in chain order */
+static dmac_descriptor_registers_t pd_desc[3] DMA_RAM __ALIGNED(8);
+
+static const cli_param_t pd_board_param =
+{
+    "pd_board", &pd_board, CLI_U8, 1u, PIXDIST_BOARDS, NULL, "this slave's part of the pixdist frame"
+};
+
+#endif /* PIXDIST_ROLE */
+
+/* -- ISR --------------------------------------------------------------------- */
+
+#if PIXDIST_ROLE == PIXDIST_MASTER
+
+/* Frame out (dma_qos.c DMAC_OTHER dispatch) */
+static void pd_dma_isr(uint8_t flags)
+{
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) != 0u) pd_frames++;
+    pd_tx_busy = false;
+}
+
+#else
+
+static dmac_descriptor_registers_t *pd_desc0(void)
+{
+    return (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + PIXDIST_DMA_CHANNEL;
+}
+
+/* Fill one descriptor reading `n` bytes of USART data to `dst` (end address if inc) */
+static void pd_fill(dmac_descriptor_registers_t *d, void *dst, uint32_t n, bool inc,
+                    dmac_descriptor_registers_t *next)
+{
+    d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_BYTE |
+                       (inc ? DMAC_BTCTRL_DSTINC_Msk : 0u) |
+                       ((next == NULL) ? DMAC_BTCTRL_BLOCKACT_INT : DMAC_BTCTRL_BLOCKACT_NOACT);
+    d->DMAC_BTCNT    = (uint16_t)n;
+    d->DMAC_SRCADDR  = (uint32_t)&SERCOM4_REGS->USART_INT.SERCOM_DATA;
+    d->DMAC_DSTADDR  = (uint32_t)dst + (inc ? n : 0u);
+    d->DMAC_DESCADDR = (uint32_t)next;
+}
+
+static uint16_t pd_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* The header alone; its completion chains the rest */
+static void pd_arm(void)
+{
+    pd_fill(pd_desc0(), pd_hdr, sizeof(pd_hdr), true, NULL);
+    pd_rx = PD_RX_HDR;
+    DMAC_REGS->CHANNEL[PIXDIST_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+}
+
+/* In the gap after the header: skip the sections before this board's, take
+   it (a key into the back buffer, a delta to stage) and its CRC, skip the
+   rest. False if the lengths make no frame; the header CRC is the loop's */
+static bool pd_arm_sections(void)
+{
+    struct { void *dst; uint32_t n; bool inc; } s[4];
+    dmac_descriptor_registers_t *next = NULL;
+    uint32_t before = 0u, after = 0u, k = 0u;
+
+    if (pd_hdr[0] != PIXDIST_MAGIC || pd_hdr[3] != PIXDIST_BOARDS) return false;
+    for (uint32_t b = 0; b < PIXDIST_BOARDS; b++)
+    {
+        uint16_t w = pd_u16(&pd_hdr[PD_HDR_LEN + 2u * b]);
+        uint32_t n = w & PD_LEN_MSK;
+
+        if (n > PIXDIST_PART_BYTES || ((w & PIXDIST_KEY) != 0u && n != PIXDIST_PART_BYTES)) return false;
+        if (b + 1u < pd_board)      before += n + 2u;
+        else if (b + 1u > pd_board) after  += n + 2u;
+        else
+        {
+            pd_key = (w & PIXDIST_KEY) != 0u;
+            pd_len = (uint16_t)n;
+        }
+    }
+
+    if (before != 0u) { s[k].dst = &pd_sink; s[k].n = before; s[k].inc = false; k++; }
+    if (pd_len != 0u) { s[k].dst = pd_key ? pd_dst : pd_delta; s[k].n = pd_len; s[k].inc = true; k++; }
+    s[k].dst = pd_crc; s[k].n = sizeof(pd_crc); s[k].inc = true; k++;
+    if (after != 0u)  { s[k].dst = &pd_sink; s[k].n = after; s[k].inc = false; k++; }
+
+    while (k-- != 0u)
+    {
+        dmac_descriptor_registers_t *d = (k == 0u) ? pd_desc0() : &pd_desc[k - 1u];
+
+        pd_fill(d, s[k].dst, s[k].n, s[k].inc, next);
+        next = d;
+    }
+    pd_rx = PD_RX_BUSY;
+    DMAC_REGS->CHANNEL[PIXDIST_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    return true;
+}
+
+/* Header or frame in (dma_qos.c DMAC_OTHER dispatch) */
+static void pd_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) == 0u)
+    {
+        pd_rx = PD_RX_READY;                /* bus error: wait for the next break */
+        return;
+    }
+    if (pd_rx == PD_RX_HDR)
+    {
+        if (!pd_arm_sections())
+        {
+            pd_crc_errors++;
+            pd_rx = PD_RX_READY;
+        }
+        return;
+    }
+    pd_rx = PD_RX_DONE;
+    if (pd_task != NULL) vTaskNotifyGiveIndexedFromISR(pd_task, PIXDIST_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* Frame error = break: a frame starts */
+static void pd_break_isr(void)
+{
+    uint16_t status = SERCOM4_REGS->USART_INT.SERCOM_STATUS;
+
+    SERCOM4_REGS->USART_INT.SERCOM_STATUS  = status;
+    SERCOM4_REGS->USART_INT.SERCOM_INTFLAG = SERCOM_USART_INT_INTFLAG_ERROR_Msk;
+    if ((status & SERCOM_USART_INT_STATUS_BUFOVF_Msk) != 0u) pd_overruns++;
+    if ((status & SERCOM_USART_INT_STATUS_FERR_Msk) == 0u) return;
+
+    if (pd_rx == PD_RX_HDR || pd_rx == PD_RX_BUSY)
+    {
+        /* The previous frame was cut short */
+        (void)Sercom_DmaStop(PIXDIST_DMA_CHANNEL);
+        if (pd_rx == PD_RX_BUSY && pd_key) pd_synced = false;   /* half a key in the back buffer */
+        pd_dropped++;
+        pd_rx = PD_RX_READY;
+    }
+    if ((SERCOM4_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_RXC_Msk) != 0u)
+        (void)SERCOM4_REGS->USART_INT.SERCOM_DATA;          /* the break byte */
+    if (pd_rx == PD_RX_READY) pd_arm();
+}
+
+static void pd_irq(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_PIXDIST);
+    pd_break_isr();
+    IRQSTAT_EXIT(IRQSTAT_PIXDIST);
+}
+
+/* A delta's runs straight into the back buffer; false if one is malformed */
+static bool pd_apply(const uint8_t *p, uint32_t len)
+{
+    const uint8_t *end = p + len;
+
+    while (p != end)
+    {
+        uint32_t at, n;
+
+        if ((uint32_t)(end - p) < PD_RUN_HDR) return false;
+        at = pd_u16(p);
+        n  = p[2];
+        p += PD_RUN_HDR;
+        if (n == 0u || at + n > PIXDIST_BOARD_LEDS || (uint32_t)(end - p) < n * NEO_CHANNELS) return false;
+        memcpy(&pd_dst[at * NEO_CHANNELS], p, n * NEO_CHANNELS);
+        p += n * NEO_CHANNELS;
+    }
+    return true;
+}
+
+/* Hand the (new) back buffer to the receiver; it starts on the next break */
+static void pd_release(void)
+{
+    taskENTER_CRITICAL();
+    pd_dst = NeoPixel_StageBytes();
+    pd_rx  = PD_RX_READY;
+    taskEXIT_CRITICAL();
+}
+
+#endif /* PIXDIST_ROLE */
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+static void pd_hw_init(void)
+{
+    /* 3 Mbit/s 8N1, TX on PAD0 for a master, RX on PAD1 for a slave */
+    static const sercom_cfg_t usart =
+    {
+        SERCOM_USART, 3u, 0u, 1u, (PIXDIST_ROLE == PIXDIST_MASTER) ? SERCOM_F_TX : SERCOM_F_RX,
+        SERCOM_USART_BAUD(PD_GCLK_HZ, 3000000u), 0u
+    };
+
+    Sercom_Open(PD_SERCOM, &usart);
+
+#if PIXDIST_ROLE == PIXDIST_MASTER
+    /* PB12 -> peripheral C (SERCOM4 PAD0); PORT drives it low for the break */
+    PORT_REGS->GROUP[1].PORT_PMUX[PD_PB12 >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[1].PORT_PMUX[PD_PB12 >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(2u));
+    PORT_REGS->GROUP[1].PORT_OUTCLR = 1u << PD_PB12;
+    PORT_REGS->GROUP[1].PORT_DIRSET = 1u << PD_PB12;
+    PORT_REGS->GROUP[1].PORT_PINCFG[PD_PB12] = PORT_PINCFG_PMUXEN_Msk;
+
+    (void)Sercom_DmaAttach(PD_SERCOM, SERCOM_DMA_TX, PIXDIST_DMA_CHANNEL, DMA_CLASS_COMMS, pd_dma_isr);
+    Sercom_Enable(PD_SERCOM);
+#else
+    /* PB13 -> peripheral C (SERCOM4 PAD1), pulled up so an open line reads idle */
+    PORT_REGS->GROUP[1].PORT_PMUX[PD_PB13 >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[1].PORT_PMUX[PD_PB13 >> 1] & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(2u));
+    PORT_REGS->GROUP[1].PORT_OUTSET = 1u << PD_PB13;
+    PORT_REGS->GROUP[1].PORT_PINCFG[PD_PB13] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_PULLEN_Msk;
+
+    SERCOM4_REGS->USART_INT.SERCOM_INTENSET = SERCOM_USART_INT_INTENSET_ERROR_Msk;
+
+    (void)Sercom_DmaAttach(PD_SERCOM, SERCOM_DMA_RX, PIXDIST_DMA_CHANNEL, DMA_CLASS_COMMS, pd_dma_isr);
+    Sercom_Enable(PD_SERCOM);
+    (void)Sercom_Irq(PD_SERCOM, pd_irq, PIXDIST_IRQ_PRIO);
+#endif
+}
+
+#if PIXDIST_ROLE == PIXDIST_MASTER
+static void pd_spin_us(uint32_t us)
+{
+    uint32_t t0 = DWT->CYCCNT;
+
+    while ((DWT->CYCCNT - t0) < us * PD_CYC_US) {}
+}
+
+static void pd_wire(pix_t px, uint8_t *w)
+{
+    for (uint8_t c = 0; c < NEO_CHANNELS; c++)
+    {
+        uint8_t ch = pd_order[c];
+
+        w[c] = (ch == 0u) ? Pix_R(px) : (ch == 1u) ? Pix_G(px) : (ch == 2u) ? Pix_B(px) : 0u;
+    }
+}
+
+/* Board b's key frame due: staggered over PIXDIST_KEY_FRAMES, all at the first frame */
+static bool pd_key_due(uint32_t b)
+{
+    return !PIXDIST_DELTA || !pd_keyed ||
+           ((pd_seq + b * PIXDIST_KEY_FRAMES / PIXDIST_BOARDS) % PIXDIST_KEY_FRAMES) == 0u;
+}
+
+/* Board b's section at `out` from its pixels, pd_ref brought up to them:
+   the runs that changed or, if they would not be shorter, the key frame.
+   Returns the len word */
+static uint16_t pd_pack(uint32_t b, const pix_t *px, uint8_t *out, bool key)
+{
+    uint8_t *ref   = pd_ref[b];
+    uint8_t *end   = out + PIXDIST_PART_BYTES;
+    uint8_t *p     = out;
+    uint8_t *count = NULL;                      /* LEDs in the open run    */
+    uint32_t last  = 0u;                        /* first LED after it      */
+
+    for (uint32_t i = 0; i < PIXDIST_BOARD_LEDS; i++, px++)
+    {
+        uint8_t  w[NEO_CHANNELS];
+        uint8_t *r = &ref[i * NEO_CHANNELS];
+        uint32_t gap;
+
+        pd_wire(*px, w);
+        if (memcmp(w, r, NEO_CHANNELS) == 0) continue;
+        memcpy(r, w, NEO_CHANNELS);
+        if (key) continue;
+
+        /* Unchanged LEDs since the run cost their bytes; a new run its header */
+        gap = i - last;
+        if (count != NULL && gap * NEO_CHANNELS <= PD_RUN_HDR && *count + gap + 1u <= PD_RUN_MAX)
+        {
+            uint32_t n = (gap + 1u) * NEO_CHANNELS;
+
+            if (p + n >= end) { key = true; continue; }
+            memcpy(p, &ref[last * NEO_CHANNELS], n);
+            p += n;
+            *count = (uint8_t)(*count + gap + 1u);
+        }
+        else
+        {
+            if (p + PD_RUN_HDR + NEO_CHANNELS >= end) { key = true; continue; }
+            p[0] = (uint8_t)i;
+            p[1] = (uint8_t)(i >> 8);
+            p[2] = 1u;
+            count = &p[2];
+            memcpy(&p[PD_RUN_HDR], w, NEO_CHANNELS);
+            p += PD_RUN_HDR + NEO_CHANNELS;
+        }
+        last = i + 1u;
+    }
+
+    if (!key) return (uint16_t)(p - out);
+    memcpy(out, ref, PIXDIST_PART_BYTES);
+    return (uint16_t)(PIXDIST_PART_BYTES | PIXDIST_KEY);
+}
+#endif
+
+#endif /* PIXDIST_ROLE != PIXDIST_NONE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void PixDist_Start(void)
+{
+#if PIXDIST_ROLE == PIXDIST_SLAVE
+    (void)Cli_Register(&pd_board_param);
+#endif
+#if PIXDIST_ROLE != PIXDIST_NONE
+    pd_hw_init();
+#endif
+}
+
+bool PixDist_Send(const pix_t *px, uint8_t brightness)
+{
+#if PIXDIST_ROLE == PIXDIST_MASTER
+    uint8_t *h = pd_frame;
+    uint8_t *p = &pd_frame[PIXDIST_HDR_BYTES];
+    uint16_t crc;
+
+    if (pd_tx_busy)
+    {
+        pd_skipped++;
+        return false;
+    }
+
+    h[0] = PIXDIST_MAGIC;
+    h[1] = pd_seq;
+    h[2] = brightness;
+    h[3] = (uint8_t)PIXDIST_BOARDS;
+    for (uint32_t b = 0; b < PIXDIST_BOARDS; b++)
+    {
+        uint16_t len = pd_pack(b, &px[b * PIXDIST_BOARD_LEDS], p, pd_key_due(b));
+        uint32_t n   = len & PD_LEN_MSK;
+
+        if ((len & PIXDIST_KEY) != 0u) pd_keys++;
+        h[PD_HDR_LEN + 2u * b]      = (uint8_t)len;
+        h[PD_HDR_LEN + 2u * b + 1u] = (uint8_t)(len >> 8);
+        crc  = Crc16_Ccitt(p, n);
+        p   += n;
+        *p++ = (uint8_t)crc;
+        *p++ = (uint8_t)(crc >> 8);
+    }
+    crc = Crc16_Ccitt(h, PD_HDR_CRC);
+    h[PD_HDR_CRC]      = (uint8_t)crc;
+    h[PD_HDR_CRC + 1u] = (uint8_t)(crc >> 8);
+    pd_seq++;
+    pd_keyed = true;
+    pd_bytes += (uint32_t)(p - pd_frame);
+
+    /* Break: hand PB12 to PORT (driving low), then the mark before the header */
+    PORT_REGS->GROUP[1].PORT_PINCFG[PD_PB12] = 0u;
+    pd_spin_us(PIXDIST_BREAK_US);
+    PORT_REGS->GROUP[1].PORT_PINCFG[PD_PB12] = PORT_PINCFG_PMUXEN_Msk;
+    pd_spin_us(PIXDIST_MAB_US);
+
+    /* The header by hand, then the gap the slaves chain their sections in */
+    for (uint32_t i = 0; i < PIXDIST_HDR_BYTES; i++)
+    {
+        while ((SERCOM4_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_DRE_Msk) == 0u) {}
+        SERCOM4_REGS->USART_INT.SERCOM_DATA = h[i];
+    }
+    while ((SERCOM4_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_TXC_Msk) == 0u) {}
+    pd_spin_us(PIXDIST_GAP_US);
+
+    pd_tx_busy = true;
+    Sercom_DmaStart(PD_SERCOM, SERCOM_DMA_TX, PIXDIST_DMA_CHANNEL, &pd_frame[PIXDIST_HDR_BYTES],
+                    (uint32_t)(p - &pd_frame[PIXDIST_HDR_BYTES]));
+    return true;
+#else
+    (void)px;
+    (void)brightness;
+    return true;
+#endif
+}
+
+void PixDist_Run(void)
+{
+#if PIXDIST_ROLE == PIXDIST_SLAVE
+    uint8_t bright = NeoPixel_GetBrightness();
+
+    pd_task = xTaskGetCurrentTaskHandle();
+    pd_release();
+    for (;;)
+    {
+        if (ulTaskNotifyTakeIndexed(PIXDIST_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(PIXDIST_LOSS_MS)) == 0u ||
+            pd_rx != PD_RX_DONE)
+            continue;                       /* nothing yet: the strip holds its frame */
+
+        const uint8_t *part = pd_key ? pd_dst : pd_delta;
+        bool show = false;
+
+        if (Crc16_Ccitt(pd_hdr, PD_HDR_CRC) != pd_u16(&pd_hdr[PD_HDR_CRC]) ||
+            Crc16_Ccitt(part, pd_len) != pd_u16(pd_crc))
+        {
+            pd_crc_errors++;
+            if (pd_key) pd_synced = false;      /* the back buffer took it */
+        }
+        else if (pd_key)
+        {
+            pd_keys++;
+            show = true;
+        }
+        else if (!pd_synced || pd_hdr[1] != (uint8_t)(pd_shown + 1u))
+        {
+            pd_resyncs++;                       /* a frame went missing: wait for a key */
+        }
+        else if (!pd_apply(pd_delta, pd_len))
+        {
+            pd_crc_errors++;
+            pd_synced = false;
+        }
+        else
+        {
+            show = true;
+        }
+
+        if (show)
+        {
+            if (pd_hdr[2] != bright)
+            {
+                NeoPixel_Wait();            /* tables are in use while a frame encodes */
+                bright = pd_hdr[2];
+                NeoPixel_SetBrightness(bright);
+            }
+            NeoPixel_Show();                /* the new back buffer is a copy of it */
+            pd_shown  = pd_hdr[1];
+            pd_synced = true;
+            pd_frames++;
+            pd_last = xTaskGetTickCount();
+            pd_seen = true;
+        }
+        pd_release();
+    }
+#endif
+}
+
+void PixDist_GetStats(pixdist_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    out->frames     = pd_frames;
+    out->skipped    = pd_skipped;
+    out->crc_errors = pd_crc_errors;
+    out->dropped    = pd_dropped;
+    out->overruns   = pd_overruns;
+    out->keys       = pd_keys;
+    out->resyncs    = pd_resyncs;
+    out->bytes      = pd_bytes;
+#if PIXDIST_ROLE == PIXDIST_SLAVE
+    out->present    = pd_seen && (xTaskGetTickCount() - pd_last) < pdMS_TO_TICKS(PIXDIST_LOSS_MS);
+#else
+    out->present    = false;
+#endif
+    taskEXIT_CRITICAL();
+}
+
+uint32_t PixDist_Frames(void)
+{
+    return pd_frames;
+}
+
+uint32_t PixDist_Bytes(void)
+{
+    return pd_bytes;
+}
@@ -0,0 +1,156 @@
+/* =============================================================================
+ * pixdist.h  -  Master/slave pixel distribution: one scene across several boards
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * For installations longer than one board can drive. The master renders the
+ * whole scene (its own strip, then PIXDIST_BOARDS slave strips of
+ * PIXDIST_BOARD_LEDS each, PIXDIST_SCENE_LEDS in all) with the one effect
+ * engine and sends every slave its part over a multi-drop RS-485 link; each
+ * slave only puts what it receives on its strip.
+ *
+ *   Link   SERCOM4 USART at 3 Mbit/s 8N1 from GCLK3 48 MHz, peripheral C:
+ *          master TX on PB12 (PAD0), slave RX on PB13 (PAD1), one RS-485
+ *          driver on the master and a receiver on every slave.
+ *   Frame  Break (line low PIXDIST_BREAK_US), mark, then
+ *
+ *            header   0xA5, seq, brightness, boards, len[boards], CRC-16
+ *            gap      line idle PIXDIST_GAP_US
+ *            board 1: len bytes, CRC-16; board 2: ..., up to PIXDIST_BOARDS
+ *
+ *          len is a u16 per board: its section's bytes, bit 15 set for a
+ *          key frame. A key section is the whole part, PIXDIST_BOARD_LEDS x
+ *          NEO_CHANNELS bytes; a delta section lists what changed since
+ *          the frame numbered seq - 1, as runs of
+ *
+ *            offset (u16, LED), count (u8, LEDs), count x NEO_CHANNELS bytes
+ *
+ *          and is empty for a board whose part did not change. Pixel bytes
+ *          are in wire order (NEO_WIRE_ORDER), uncorrected; every board
+ *          applies its own gamma and white balance and the master's
+ *          brightness. The CRCs are CRC-16/CCITT-FALSE (as telem.h), little
+ *          endian: the header's over the bytes before it, a section's over
+ *          its len bytes.
+ *   Delta  The master keeps the last part it sent to each board and sends
+ *          the difference, unchanged LEDs between two runs folded in when
+ *          that is shorter than a new run. A part that would take more
+ *          than a key frame goes as one, and every board gets a key frame
+ *          every PIXDIST_KEY_FRAMES frames (staggered, so the keys share
+ *          the link evenly) and at the first frame. A slide over a static
+ *          background or a sparkle costs a few runs instead of the strip,
+ *          so the same link carries more boards or a higher frame rate.
+ *          PIXDIST_DELTA 0 makes every section a key frame.
+ *
+ * Both ends move the frame by DMA (PIXDIST_DMA_CHANNEL), so neither takes
+ * a per-byte interrupt. The master packs the frame in the render task,
+ * writes the header after the break and starts the DMA for the sections
+ * after the gap; a frame still on the line is skipped, not waited for. A
+ * slave runs the NeoPixel driver in streaming mode, whose back buffer holds
+ * plain wire-order bytes and is kept a copy of the frame on the strip: on
+ * each break its DMA drops the header in a small buffer, and the header's
+ * completion interrupt, within the gap, chains the rest from the lengths:
+ * skip the other boards' sections, this board's into the back buffer (a
+ * key) or a small staging buffer (a delta), its CRC. The slave loop checks
+ * both CRCs, applies a delta's runs straight into the back buffer and shows
+ * it. A delta that does not follow the last frame shown (one lost or
+ * corrupt) is passed over until the next key frame, counted as a resync.
+ * The slave's board number (CLI "pd_board", 1 based) selects its part; all
+ * slaves run the same firmware.
+ *
+ * Slaves show their part one frame transfer after the master's strip
+ * (~4.4 ms for key frames to three 144-LED boards, a delta as long as what
+ * it holds). A slave that gets no frame holds the last one, so a static
+ * scene stays up; the master sends a frame only when the scene changes.
+ * The power limiter (power.h) runs on the master, per
+ * board, with one board's budget each.
+ *
+ * SERCOM4 is NeoPixel parallel output 3, so PIXDIST_ROLE needs
+ * NEO_OUTPUTS <= 3. Every board must be built for the same NEO_CHIP.
+ * ============================================================================= */
+
+#ifndef PIXDIST_H
+#define PIXDIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+#include "neopixel.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define PIXDIST_NONE            0
+#define PIXDIST_MASTER          1
+#define PIXDIST_SLAVE           2
+#define PIXDIST_ROLE            PIXDIST_NONE    /* this board's place on the link   */
+
+#define PIXDIST_BOARDS          3u      /* slave boards on the link                  */
+#define PIXDIST_BOARD_LEDS      NUM_LEDS        /* LEDs on each slave                */
+#define PIXDIST_DMA_CHANNEL     8u      /* DMA_OTHER channel, dma_qos.h              */
+#define PIXDIST_IRQ_PRIO        IRQ_PRIO_PIXDIST    /* NVIC, irqprio.h           */
+#define PIXDIST_NOTIFY_INDEX    1u      /* slave: effects' index, it runs no effects */
+#define PIXDIST_BREAK_US        20u     /* > 6 character times at 3 Mbit/s           */
+#define PIXDIST_MAB_US          4u      /* mark after break                          */
+#define PIXDIST_LOSS_MS         1000u   /* slave: no frame for this long: lost       */
+#define PIXDIST_GAP_US          10u     /* header to sections: the slave re-arms     */
+#define PIXDIST_DELTA           1       /* 0 = every section a key frame             */
+#define PIXDIST_KEY_FRAMES      50u     /* a key frame per board at least this often */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define PIXDIST_HDR_BYTES       (4u + 2u * PIXDIST_BOARDS + 2u)        /* lens, CRC */
+#define PIXDIST_MAGIC           0xA5u
+#define PIXDIST_KEY             0x8000u                                 /* len bit   */
+#define PIXDIST_PART_BYTES      ((uint32_t)(PIXDIST_BOARD_LEDS) * NEO_CHANNELS)
+#define PIXDIST_SECTION_BYTES   (PIXDIST_PART_BYTES + 2u)              /* part + CRC */
+#define PIXDIST_FRAME_BYTES     (PIXDIST_HDR_BYTES + PIXDIST_BOARDS * PIXDIST_SECTION_BYTES)   /* all keys */
+
+#if PIXDIST_ROLE == PIXDIST_MASTER
+#define PIXDIST_REMOTE_LEDS     ((uint32_t)(PIXDIST_BOARDS) * (PIXDIST_BOARD_LEDS))
+#else
+#define PIXDIST_REMOTE_LEDS     0u
+#endif
+#define PIXDIST_SCENE_LEDS      ((uint16_t)((uint32_t)(NUM_LEDS) + PIXDIST_REMOTE_LEDS))   /* rendered */
+
+typedef struct
+{
+    uint32_t frames;                    /* master: sent, slave: shown                */
+    uint32_t skipped;                   /* master: link still busy, frame not sent   */
+    uint32_t crc_errors;                /* slave: part or header corrupt             */
+    uint32_t dropped;                   /* slave: frame cut short by a break         */
+    uint32_t overruns;                  /* slave: USART buffer overflows             */
+    uint32_t keys;                      /* master: key sections sent, slave: taken   */
+    uint32_t resyncs;                   /* slave: deltas passed over, out of step    */
+    uint32_t bytes;                     /* master: sent on the link                  */
+    bool     present;                   /* slave: a frame within PIXDIST_LOSS_MS     */
+} pixdist_stats_t;
+
+/**
+ * Set up PB12/PB13, SERCOM4 and the DMA channel for PIXDIST_ROLE; a slave
+ * registers "pd_board". Before the scheduler. Does nothing with
+ * PIXDIST_NONE.
+ */
+void PixDist_Start(void);
+
+/**
+ * Master: send the slaves' part of the rendered scene, px[0] being the
+ * first LED of board 1 (PIXDIST_BOARDS x PIXDIST_BOARD_LEDS pixels). Never
+ * blocks; false if the previous frame is still on the link (counted as
+ * skipped). From the render task; true and nothing sent on other roles.
+ */
+bool PixDist_Send(const pix_t *px, uint8_t brightness);
+
+/**
+ * Slave: receive frames and show this board's part, forever. Replaces the
+ * effect loop in the NeoPixel task, since it owns NeoPixel_Show(). Returns
+ * at once on other roles.
+ */
+void PixDist_Run(void);
+
+/** Link counters. Any task. */
+void PixDist_GetStats(pixdist_stats_t *out);
+
+/** Frames sent or shown (telemetry). Any task. */
+uint32_t PixDist_Frames(void);
+
+/** Master: bytes sent on the link since boot (telemetry). Any task. */
+uint32_t PixDist_Bytes(void);
+
+#endif /* PIXDIST_H */
@@ -0,0 +1,161 @@
+/* =============================================================================
+ * pixmath.c  -  Packed-pixel fixed-point maths for whole-strip operations
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "pixmath.h"
+#include "cache.h"
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Pix_Fill(pix_t *px, uint16_t n, pix_t colour)
+{
+    for (uint16_t i = 0; i < n; i++)
+        px[i] = colour;
+}
+
+void CACHE_HOT Pix_ScaleStrip(pix_t *px, uint16_t n, uint8_t scale)
+{
+    if (scale == 255u) return;
+
+    for (uint16_t i = 0; i < n; i++)
+        px[i] = Pix_Scale(px[i], scale);
+}
+
+void Pix_FadeToBlack(pix_t *px, uint16_t n, uint8_t amount)
+{
+    Pix_ScaleStrip(px, n, (uint8_t)(255u - amount));
+}
+
+void Pix_AddStrip(pix_t *dst, const pix_t *src, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        dst[i] = Pix_AddSat(dst[i], src[i]);
+}
+
+/* 16-bit lanes hold 257 x 255 at most, so fold them every 256 pixels */
+#define PIX_SUM_BATCH       256u
+
+void Pix_SumStrip(const pix_t *px, uint16_t n, pix_sum_t *out)
+{
+    out->r = out->g = out->b = 0u;
+
+    for (uint16_t i = 0; i < n; )
+    {
+        uint32_t lo = 0u;               /* R | B << 16 */
+        uint32_t hi = 0u;               /* G           */
+        uint16_t end = ((uint32_t)n - i > PIX_SUM_BATCH) ? (uint16_t)(i + PIX_SUM_BATCH) : n;
+
+        for (; i < end; i++)
+        {
+#if PIX_DSP
+            lo = __UXTAB16(lo, px[i]);
+            hi = __UXTAB16(hi, __ROR(px[i], 8u));
+#else
+            lo += PIX_LO(px[i]);
+            hi += PIX_HI(px[i]);
+#endif
+        }
+
+        out->r += lo & 0xFFFFu;
+        out->b += lo >> 16;
+        out->g += hi & 0xFFFFu;
+    }
+}
+
+void Pix_BlendStrip(pix_t *dst, const pix_t *src, uint16_t n, uint16_t t)
+{
+    for (uint16_t i = 0; i < n; i++)
+        dst[i] = Pix_Blend(dst[i], src[i], t);
+}
+
+/* -- Planar strips ----------------------------------------------------------- */
+
+/* Apply `op` to the three planes, word by word */
+#define PIX_PLANES_EACH(n, op)                                    \
+    for (uint32_t w = 0; w < PIX_PLANE_WORDS(n); w++) { op(r); op(g); op(b); }
+
+void Pix_PlanesFill(const pix_planes_t *pl, uint16_t n, pix_t colour)
+{
+    uint32_t r = Pix_R(colour) * 0x01010101u;
+    uint32_t g = Pix_G(colour) * 0x01010101u;
+    uint32_t b = Pix_B(colour) * 0x01010101u;
+
+#define PIX_OP_FILL(c)      pl->c[w] = c
+    PIX_PLANES_EACH(n, PIX_OP_FILL)
+#undef PIX_OP_FILL
+}
+
+void CACHE_HOT Pix_PlanesScale(const pix_planes_t *pl, uint16_t n, uint8_t scale)
+{
+    if (scale == 255u) return;
+
+#define PIX_OP_SCALE(c)     pl->c[w] = Pix_Scale(pl->c[w], scale)
+    PIX_PLANES_EACH(n, PIX_OP_SCALE)
+#undef PIX_OP_SCALE
+}
+
+void Pix_PlanesAdd(const pix_planes_t *dst, const pix_planes_t *src, uint16_t n)
+{
+#define PIX_OP_ADD(c)       dst->c[w] = Pix_AddSat(dst->c[w], src->c[w])
+    PIX_PLANES_EACH(n, PIX_OP_ADD)
+#undef PIX_OP_ADD
+}
+
+void Pix_PlanesBlend(const pix_planes_t *dst, const pix_planes_t *src, uint16_t n, uint16_t t)
+{
+#define PIX_OP_BLEND(c)     dst->c[w] = Pix_Blend(dst->c[w], src->c[w], t)
+    PIX_PLANES_EACH(n, PIX_OP_BLEND)
+#undef PIX_OP_BLEND
+}
+
+/* One plane's total: four lanes in two halfword pairs, folded as Pix_SumStrip() */
+static uint32_t pix_plane_sum(const uint32_t *v, uint16_t n)
+{
+    uint32_t words = PIX_PLANE_WORDS(n);
+    uint32_t total = 0u;
+
+    for (uint32_t i = 0; i < words; )
+    {
+        uint32_t lo  = 0u;              /* lanes 0 and 2 */
+        uint32_t hi  = 0u;              /* lanes 1 and 3 */
+        uint32_t end = (words - i > PIX_SUM_BATCH) ? i + PIX_SUM_BATCH : words;
+
+        for (; i < end; i++)
+        {
+            uint32_t x = v[i];
+
+            if (i == words - 1u && (n & 3u) != 0u)
+                x &= 0xFFFFFFFFu >> (8u * (4u - (n & 3u)));     /* lanes past n */
+#if PIX_DSP
+            lo = __UXTAB16(lo, x);
+            hi = __UXTAB16(hi, __ROR(x, 8u));
+#else
+            lo += PIX_LO(x);
+            hi += PIX_HI(x);
+#endif
+        }
+
+        total += (lo & 0xFFFFu) + (lo >> 16) + (hi & 0xFFFFu) + (hi >> 16);
+    }
+    return total;
+}
+
+void Pix_PlanesSum(const pix_planes_t *pl, uint16_t n, pix_sum_t *out)
+{
+    out->r = pix_plane_sum(pl->r, n);
+    out->g = pix_plane_sum(pl->g, n);
+    out->b = pix_plane_sum(pl->b, n);
+}
+
+void Pix_ToPlanes(const pix_planes_t *pl, const pix_t *px, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        Pix_PlanesSet(pl, i, px[i]);
+}
+
+void Pix_FromPlanes(pix_t *px, const pix_planes_t *pl, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        px[i] = Pix_PlanesGet(pl, i);
+}
@@ -0,0 +1,200 @@
+/* =============================================================================
+ * pixmath.h  -  Packed-pixel fixed-point maths for whole-strip operations
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A pix_t holds one RGB pixel as four byte lanes in a 32-bit word:
+ *
+ *   bits  7..0  R      15..8  G      23..16  B      31..24  unused (0)
+ *
+ * so one Cortex-M4 SIMD instruction works on all three channels at once:
+ * saturating add is a single UQADD8, the 50 % mix a single UHADD8, and a
+ * scale or blend is two multiplies on UXTB16-unpacked lane pairs instead of
+ * three (or six) byte multiplies. Without __ARM_FEATURE_DSP the same results
+ * come from plain SWAR fallbacks. The per-channel maximum is a USUB8 / SEL
+ * pair; the per-channel multiply has no packed form and stays per byte.
+ *
+ * Scale factors are 0-255 with 255 = unchanged; blend positions are 0-256
+ * with 256 = all of the second pixel.
+ *
+ * A pix_planes_t is the planar form of a strip: one word array per channel,
+ * pixel i in byte lane i % 4 of word i / 4. The lane-wise helpers above do
+ * not care what a lane holds, so on planes the same UQADD8 / UHADD8 /
+ * UXTB16 forms work on four pixels of one channel per word instead of three
+ * channels of one pixel. For whole-strip work (fills, fades, mixes, sums);
+ * the encoder interleaves the planes into wire order once, on the way to
+ * the back buffer (NeoPixel_SetPlanes()).
+ * ============================================================================= */
+
+#ifndef PIXMATH_H
+#define PIXMATH_H
+
+#include <stdint.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"     /* __UQADD8, __UHADD8, __USUB8, __SEL, __UXTB16, __UXTAB16, __ROR */
+#define PIX_DSP             1
+#else
+#define PIX_DSP             0
+#endif
+
+typedef uint32_t pix_t;
+
+#define PIX_LANES_LO_MSK    0x00FF00FFu     /* R and B as two halfword lanes */
+
+/* R and B (lanes 0, 2) / G (lanes 1, 3) unpacked to 16-bit halves */
+#if PIX_DSP
+#define PIX_LO(p)           __UXTB16(p)
+#define PIX_HI(p)           __UXTB16(__ROR((p), 8u))
+#else
+#define PIX_LO(p)           ((p) & PIX_LANES_LO_MSK)
+#define PIX_HI(p)           (((p) >> 8) & PIX_LANES_LO_MSK)
+#endif
+
+static inline pix_t Pix_Make(uint8_t r, uint8_t g, uint8_t b)
+{
+    return (pix_t)r | ((pix_t)g << 8) | ((pix_t)b << 16);
+}
+
+static inline uint8_t Pix_R(pix_t p) { return (uint8_t)p; }
+static inline uint8_t Pix_G(pix_t p) { return (uint8_t)(p >> 8); }
+static inline uint8_t Pix_B(pix_t p) { return (uint8_t)(p >> 16); }
+
+/** Every channel times (scale + 1) / 256, so 255 leaves the pixel unchanged. */
+static inline pix_t Pix_Scale(pix_t p, uint8_t scale)
+{
+    uint32_t k = (uint32_t)scale + 1u;
+
+    return (((PIX_LO(p) * k) >> 8) & PIX_LANES_LO_MSK)
+         |  ((PIX_HI(p) * k)       & ~PIX_LANES_LO_MSK);
+}
+
+/** a -> b by t / 256 per channel (t = 0..256), in gamma (stored) space. */
+static inline pix_t Pix_Blend(pix_t a, pix_t b, uint16_t t)
+{
+    uint32_t u = 256u - t;
+
+    /* each lane <= 255 x 256 after the multiply-add, no carry into the next */
+    return (((PIX_LO(a) * u + PIX_LO(b) * t) >> 8) & PIX_LANES_LO_MSK)
+         |  ((PIX_HI(a) * u + PIX_HI(b) * t)       & ~PIX_LANES_LO_MSK);
+}
+
+/** Per-channel a + b, clipped at 255. */
+static inline pix_t Pix_AddSat(pix_t a, pix_t b)
+{
+#if PIX_DSP
+    return __UQADD8(a, b);
+#else
+    uint32_t sum   = (a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu);
+    uint32_t carry = ((sum & (a | b)) | (a & b)) & 0x80808080u;     /* lanes >= 256 */
+
+    return sum | (a & 0x80808080u) | (b & 0x80808080u) | ((carry >> 7) * 0xFFu);
+#endif
+}
+
+/** Per-channel (a + b) / 2, rounded down. */
+static inline pix_t Pix_Average(pix_t a, pix_t b)
+{
+#if PIX_DSP
+    return __UHADD8(a, b);
+#else
+    return (a & b) + (((a ^ b) >> 1) & 0x7F7F7F7Fu);
+#endif
+}
+
+/** Per-channel max(a, b). */
+static inline pix_t Pix_Max(pix_t a, pix_t b)
+{
+#if PIX_DSP
+    (void)__USUB8(a, b);            /* GE flags: lanes where a >= b */
+    return __SEL(a, b);
+#else
+    uint32_t out = 0u;
+
+    for (uint32_t sh = 0u; sh < 24u; sh += 8u)
+    {
+        uint32_t ca = (a >> sh) & 0xFFu;
+        uint32_t cb = (b >> sh) & 0xFFu;
+
+        out |= ((ca > cb) ? ca : cb) << sh;
+    }
+    return out;
+#endif
+}
+
+/** Per-channel a x (b + 1) / 256, so a white b leaves a unchanged. */
+static inline pix_t Pix_Multiply(pix_t a, pix_t b)
+{
+    return Pix_Make((uint8_t)((Pix_R(a) * (Pix_R(b) + 1u)) >> 8),
+                    (uint8_t)((Pix_G(a) * (Pix_G(b) + 1u)) >> 8),
+                    (uint8_t)((Pix_B(a) * (Pix_B(b) + 1u)) >> 8));
+}
+
+/* -- Whole-strip operations (n pixels, in place into px / dst) -------------- */
+
+void Pix_Fill(pix_t *px, uint16_t n, pix_t colour);
+
+/** Scale every pixel by scale (255 = unchanged). */
+void Pix_ScaleStrip(pix_t *px, uint16_t n, uint8_t scale);
+
+/** Dim every pixel by amount / 256 towards black (0 = unchanged). */
+void Pix_FadeToBlack(pix_t *px, uint16_t n, uint8_t amount);
+
+/** dst = saturating dst + src, per channel. */
+void Pix_AddStrip(pix_t *dst, const pix_t *src, uint16_t n);
+
+/** dst = dst -> src by t / 256 (t = 0..256). */
+void Pix_BlendStrip(pix_t *dst, const pix_t *src, uint16_t n, uint16_t t);
+
+/** Per-channel totals of n pixels, e.g. for power estimates. */
+typedef struct
+{
+    uint32_t r;
+    uint32_t g;
+    uint32_t b;
+} pix_sum_t;
+
+void Pix_SumStrip(const pix_t *px, uint16_t n, pix_sum_t *out);
+
+/* -- Planar strips (n pixels, whole words: lanes past n go along) ----------- */
+
+/* Words per plane of n pixels */
+#define PIX_PLANE_WORDS(n)  (((uint32_t)(n) + 3u) / 4u)
+
+typedef struct
+{
+    uint32_t *r;                /* PIX_PLANE_WORDS(n) words each */
+    uint32_t *g;
+    uint32_t *b;
+} pix_planes_t;
+
+static inline pix_t Pix_PlanesGet(const pix_planes_t *pl, uint16_t i)
+{
+    return Pix_Make(((const uint8_t *)pl->r)[i], ((const uint8_t *)pl->g)[i], ((const uint8_t *)pl->b)[i]);
+}
+
+static inline void Pix_PlanesSet(const pix_planes_t *pl, uint16_t i, pix_t p)
+{
+    ((uint8_t *)pl->r)[i] = Pix_R(p);
+    ((uint8_t *)pl->g)[i] = Pix_G(p);
+    ((uint8_t *)pl->b)[i] = Pix_B(p);
+}
+
+void Pix_PlanesFill(const pix_planes_t *pl, uint16_t n, pix_t colour);
+
+/** Scale every pixel by scale (255 = unchanged). */
+void Pix_PlanesScale(const pix_planes_t *pl, uint16_t n, uint8_t scale);
+
+/** dst = saturating dst + src, per channel. */
+void Pix_PlanesAdd(const pix_planes_t *dst, const pix_planes_t *src, uint16_t n);
+
+/** dst = dst -> src by t / 256 (t = 0..256). */
+void Pix_PlanesBlend(const pix_planes_t *dst, const pix_planes_t *src, uint16_t n, uint16_t t);
+
+/** Per-channel totals of the first n pixels, as Pix_SumStrip(). */
+void Pix_PlanesSum(const pix_planes_t *pl, uint16_t n, pix_sum_t *out);
+
+/** Planes from a packed strip and back. */
+void Pix_ToPlanes(const pix_planes_t *pl, const pix_t *px, uint16_t n);
+void Pix_FromPlanes(pix_t *px, const pix_planes_t *pl, uint16_t n);
+
+#endif /* PIXMATH_H */
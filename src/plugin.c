@@ -0,0 +1,284 @@
+/* =============================================================================
+ * plugin.c  -  Effect plug-ins loaded from the QSPI assets or the SD card at runtime
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "plugin.h"
+#include "definitions.h"        /* core_cm4.h: DWT, __DSB, __ISB */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "crc.h"
+#include "rng.h"
+#include "fastmath.h"
+#include "assets.h"
+#include "stream.h"
+#include "log.h"
+#include <stddef.h>
+#include <string.h>
+
+#define PL_ALIGN(n)         (((n) + 7u) & ~7u)
+#define PL_READ_MS          2000u       /* a file from the card, all of it */
+
+_Static_assert(EFFECT_COUNT + PLUGIN_SLOTS <= 32u, "step_effect() keeps one bit per effect id");
+_Static_assert(PLUGIN_SLOTS < 0x100u - EFFECT_COUNT, "effect ids are bytes");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    effect_t          fx;                       /* the registry row effects.c reads */
+    plugin_render_fn  render;
+    char              name[PLUGIN_NAME_LEN + 1u];
+    uint32_t          size;
+    uint32_t          bss;
+    uint32_t          budget;                   /* cycles per LED */
+    uint32_t          max_cycles;
+    uint32_t          overruns;
+    uint8_t           strikes;                  /* over budget in a row */
+    bool              disabled;
+} plugin_slot_t;
+
+static const char *const pl_status_name[PLUGIN_STATUS_COUNT] =
+{
+    "ok", "full", "bad header", "wrong abi", "bad crc", "name taken", "read error"
+};
+
+static plugin_slot_t     pl_slot[PLUGIN_SLOTS];
+static volatile uint32_t pl_count;              /* slots below it are registered */
+
+#if PLUGIN_ENABLE
+/* The execution region: images and their bss, bottom up, never freed */
+static uint32_t          pl_arena[PLUGIN_ARENA_BYTES / 4u] __attribute__((aligned(8)));
+static uint32_t          pl_used;               /* bytes */
+
+static uint8_t  pl_sin8(uint8_t x)                  { return Math_Sin8(x); }
+static uint32_t pl_now_ms(void)                     { return xTaskGetTickCount() * portTICK_PERIOD_MS; }
+
+static const plugin_api_t pl_api =
+{
+    PLUGIN_ABI, (uint16_t)sizeof(plugin_api_t),
+    Rng_Next32, pl_sin8, Math_Sin16, Math_ValueNoise8, Math_Perlin8, pl_now_ms
+};
+
+static bool pl_name_taken(const char *name)
+{
+    for (uint32_t id = 0; id < EFFECT_COUNT; id++)
+        if (strcmp(Effects_Name((effect_id_t)id), name) == 0) return true;
+    for (uint32_t i = 0; i < pl_count; i++)
+        if (strcmp(pl_slot[i].name, name) == 0) return true;
+    return false;
+}
+
+/* The header alone: magic, ABI, sizes against the arena, entry inside the image */
+static plugin_status_t pl_check(const plugin_header_t *h, uint32_t len)
+{
+    uint32_t room = PLUGIN_ARENA_BYTES - pl_used;
+
+    if (h->magic != PLUGIN_MAGIC) return PLUGIN_BAD_HEADER;
+    if (h->abi != PLUGIN_ABI) return PLUGIN_BAD_ABI;
+    if (h->size < PLUGIN_HEADER_BYTES || h->size > len) return PLUGIN_BAD_HEADER;
+    if (h->entry < PLUGIN_HEADER_BYTES || h->entry >= h->size || (h->entry & 1u) == 0u)
+        return PLUGIN_BAD_HEADER;                               /* Thumb code in the image */
+    if (memchr(h->name, '\0', PLUGIN_NAME_LEN) == NULL || h->name[0] == '\0')
+        return PLUGIN_BAD_HEADER;
+    if (pl_count >= PLUGIN_SLOTS || h->bss > PLUGIN_ARENA_BYTES ||
+        PL_ALIGN(h->size) + PL_ALIGN(h->bss) > room)
+        return PLUGIN_FULL;
+    return pl_name_taken(h->name) ? PLUGIN_DUPLICATE : PLUGIN_OK;
+}
+
+/* Up to `len` bytes of stream `s`, waiting on the card for PL_READ_MS at most */
+static uint32_t pl_read(int32_t s, void *dst, uint32_t len)
+{
+    uint32_t got = 0u;
+
+    for (uint32_t t = 0; got < len && t < PL_READ_MS / 10u; )
+    {
+        uint32_t n = Stream_Available(s);
+
+        if (n == 0u)
+        {
+            if (Stream_Ended(s)) break;
+            vTaskDelay(pdMS_TO_TICKS(10u));
+            t++;
+            continue;
+        }
+        if (n > len - got) n = len - got;
+        got += Stream_Read(s, (uint8_t *)dst + got, n);
+    }
+    return got;
+}
+#endif /* PLUGIN_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void *Plugin_Stage(uint32_t len)
+{
+#if PLUGIN_ENABLE
+    if (pl_count >= PLUGIN_SLOTS || len > PLUGIN_ARENA_BYTES - pl_used) return NULL;
+    return (uint8_t *)pl_arena + pl_used;
+#else
+    (void)len;
+    return NULL;
+#endif
+}
+
+plugin_status_t Plugin_Load(const void *image, uint32_t len, effect_id_t *id)
+{
+#if PLUGIN_ENABLE
+    uint8_t        *dst = (uint8_t *)pl_arena + pl_used;
+    plugin_slot_t  *p   = &pl_slot[pl_count];
+    plugin_header_t h;
+    plugin_status_t st;
+    uint32_t        crc;
+
+    if (len < PLUGIN_HEADER_BYTES) return PLUGIN_BAD_HEADER;
+    memcpy(&h, image, sizeof(h));                       /* QSPI or a staged file, any alignment */
+    st = pl_check(&h, len);
+    if (st != PLUGIN_OK) return st;
+
+    if ((const uint8_t *)image != dst) memmove(dst, image, h.size);
+    memset(dst + offsetof(plugin_header_t, crc), 0, sizeof(h.crc));
+    if (!Crc_Memory(dst, h.size, &crc)) return PLUGIN_IO;
+    if (crc != h.crc) return PLUGIN_BAD_CRC;
+    memset(dst + h.size, 0, PL_ALIGN(h.size) - h.size + h.bss);
+
+    memset(p, 0, sizeof(*p));
+    memcpy(p->name, h.name, PLUGIN_NAME_LEN);
+    p->size              = h.size;
+    p->bss               = h.bss;
+    p->budget            = (h.cycles != 0u) ? h.cycles : PLUGIN_CYCLES_DEFAULT;
+    p->render            = (plugin_render_fn)(uintptr_t)(dst + h.entry);   /* bit 0 kept: Thumb */
+    p->fx.name           = p->name;
+    p->fx.animated       = (h.flags & PLUGIN_F_ANIMATED) != 0u;
+    p->fx.params.speed      = h.speed;
+    p->fx.params.brightness = h.brightness;
+    p->fx.cost.pixel        = p->budget;        /* the renderer holds it to that too */
+    pl_used += PL_ALIGN(h.size) + PL_ALIGN(h.bss);
+
+    __DSB();                                            /* the code written before it is fetched */
+    __ISB();
+    *id = (effect_id_t)(EFFECT_COUNT + pl_count);
+    pl_count++;                                         /* the renderer may use it from here */
+    return PLUGIN_OK;
+#else
+    (void)image;
+    (void)len;
+    (void)id;
+    return PLUGIN_FULL;
+#endif
+}
+
+plugin_status_t Plugin_LoadFile(const char *path, effect_id_t *id)
+{
+#if PLUGIN_ENABLE
+    plugin_header_t h;
+    plugin_status_t st;
+    uint8_t        *dst = NULL;
+    int32_t         s   = Stream_Open(path, false);
+
+    if (s < 0) return PLUGIN_IO;
+    if (pl_read(s, &h, sizeof(h)) != sizeof(h)) st = PLUGIN_IO;
+    else if (h.magic != PLUGIN_MAGIC || h.size < sizeof(h)) st = PLUGIN_BAD_HEADER;
+    else if ((dst = Plugin_Stage(h.size)) == NULL) st = PLUGIN_FULL;
+    else
+    {
+        /* The header said how much more: the rest goes straight into the arena */
+        memcpy(dst, &h, sizeof(h));
+        st = (pl_read(s, dst + sizeof(h), h.size - sizeof(h)) == h.size - sizeof(h)) ? PLUGIN_OK : PLUGIN_IO;
+    }
+    Stream_Close(s);
+    return (st == PLUGIN_OK) ? Plugin_Load(dst, h.size, id) : st;
+#else
+    (void)path;
+    (void)id;
+    return PLUGIN_FULL;
+#endif
+}
+
+void Plugin_LoadAssets(void)
+{
+#if PLUGIN_ENABLE
+    asset_t a;
+
+    for (uint32_t i = 0; Assets_Get(i, &a); i++)
+    {
+        effect_id_t     id;
+        plugin_status_t st;
+
+        if (a.kind != ASSET_PLUGIN) continue;
+        st = Plugin_Load(a.data, a.size, &id);
+        if (st == PLUGIN_OK) LOG_INFO("plugin: '%s' is effect %u", Effects_Name(id), (unsigned)id);
+        else LOG_WARN("plugin: %s not loaded, %s", a.name, Plugin_StatusName(st));
+    }
+#endif
+}
+
+uint32_t Plugin_Count(void)
+{
+    return pl_count;
+}
+
+const effect_t *Plugin_Effect(uint8_t slot)
+{
+    return (slot < pl_count) ? &pl_slot[slot].fx : NULL;
+}
+
+void Plugin_Render(uint8_t slot, pix_t *px, uint16_t n, const effect_params_t *params, uint8_t offset)
+{
+#if PLUGIN_ENABLE
+    plugin_slot_t *p = &pl_slot[slot % PLUGIN_SLOTS];
+    plugin_frame_t f;
+    uint32_t       t0, dt;
+
+    if (slot < pl_count && !p->disabled)
+    {
+        f.count  = n;
+        f.offset = offset;
+        f.speed  = params->speed;
+        f.budget = p->budget * n;
+        f.api    = &pl_api;
+
+        t0 = DWT->CYCCNT;
+        p->render(px, &f);
+        dt = DWT->CYCCNT - t0;
+        if (dt > p->max_cycles) p->max_cycles = dt;
+        if (dt <= f.budget)
+        {
+            p->strikes = 0u;
+            return;
+        }
+        p->overruns++;
+        if (++p->strikes < PLUGIN_STRIKES) return;
+        p->disabled = true;
+        LOG_WARN("plugin: '%s' over its budget %u frames in a row, switched off",
+                 p->name, (unsigned)PLUGIN_STRIKES);
+    }
+#else
+    (void)slot;
+    (void)params;
+    (void)offset;
+#endif
+    Pix_Fill(px, n, 0u);
+}
+
+bool Plugin_GetInfo(uint8_t slot, plugin_info_t *out)
+{
+    const plugin_slot_t *p;
+
+    if (slot >= pl_count) return false;
+    p = &pl_slot[slot];
+    out->name       = p->name;
+    out->size       = p->size;
+    out->bss        = p->bss;
+    out->budget     = p->budget;
+    out->max_cycles = p->max_cycles;
+    out->overruns   = p->overruns;
+    out->disabled   = p->disabled;
+    return true;
+}
+
+const char *Plugin_StatusName(plugin_status_t s)
+{
+    return ((uint32_t)s < PLUGIN_STATUS_COUNT) ? pl_status_name[s] : "?";
+}
@@ -0,0 +1,105 @@
+/* =============================================================================
+ * plugin.h  -  Effect plug-ins loaded from the QSPI assets or the SD card at runtime
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A new effect normally means a row in SHOW_EFFECTS, a kernel, a rebuild
+ * and a reflash of every prop. A plug-in is an effect built apart from the
+ * firmware against plugin_abi.h: one function drawing a span of LEDs from
+ * a phase, the speed and a cycle budget, with a header naming it. It is
+ * shipped as an ASSET_PLUGIN entry in the QSPI asset table (mkassets.py
+ * recognises its 'CRFX' header) or as a file on the SD card.
+ *
+ * Plugin_Load() copies the image into PLUGIN_ARENA_BYTES of SRAM, the
+ * execution region, and checks it before anything runs: the magic, the
+ * ABI, the sizes against the region, the entry inside the image, and the
+ * CRC-32 on the DMAC engine. The arena is filled from the bottom and never
+ * given back, so an effect id, once registered, stays valid until the
+ * reset. A good image gets the next effect id after the built-ins
+ * (EFFECT_COUNT, EFFECT_COUNT + 1, ...) and from then on is an effect like
+ * any other: "fx", segments, layers, crossfades, show scripts. At boot the
+ * Init task loads every ASSET_PLUGIN in table order, so the ids are the
+ * same from one boot to the next; "fx load FILE" adds one from the card.
+ *
+ * The renderer calls the plug-in through Plugin_Render() and times it on
+ * the DWT counter against its budget (hdr.cycles per LED). A plug-in over
+ * its budget PLUGIN_STRIKES frames in a row is switched off: its spans go
+ * black and "fx plugins" says why. A plug-in that never returns is caught
+ * by the NeoPixel task's watchdog heartbeat, one that faults by the fault
+ * handler; the CRC proves the image arrived intact, not who wrote it.
+ * ============================================================================= */
+
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "plugin_abi.h"
+#include "effects.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef PLUGIN_ENABLE
+#define PLUGIN_ENABLE           1
+#endif
+#define PLUGIN_SLOTS            4u      /* plug-ins registered at once             */
+#define PLUGIN_ARENA_BYTES      8192u   /* SRAM execution region, images and bss   */
+#define PLUGIN_CYCLES_DEFAULT   200u    /* per LED, for a header cycles of 0        */
+#define PLUGIN_STRIKES          16u     /* frames over budget in a row: switched off */
+
+typedef enum
+{
+    PLUGIN_OK = 0,
+    PLUGIN_FULL,                /* no slot, or no room in the arena */
+    PLUGIN_BAD_HEADER,          /* magic, sizes or entry            */
+    PLUGIN_BAD_ABI,
+    PLUGIN_BAD_CRC,
+    PLUGIN_DUPLICATE,           /* an effect of that name exists    */
+    PLUGIN_IO,                  /* the image could not be read      */
+    PLUGIN_STATUS_COUNT
+} plugin_status_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t    size;           /* image bytes, and its bss */
+    uint32_t    bss;
+    uint32_t    budget;         /* cycles per LED */
+    uint32_t    max_cycles;     /* slowest call */
+    uint32_t    overruns;       /* calls over budget */
+    bool        disabled;       /* PLUGIN_STRIKES in a row */
+} plugin_info_t;
+
+/**
+ * Room for the next image of `len` bytes in the arena, to read a file
+ * straight into before Plugin_Load(); NULL if it cannot fit. Tasks.
+ */
+void *Plugin_Stage(uint32_t len);
+
+/**
+ * Check `len` bytes of image at `image` (mapped QSPI, or a Plugin_Stage()
+ * area), copy it into the arena, and register it as effect `*id`. Tasks
+ * only (the CRC sleeps); one loader at a time.
+ */
+plugin_status_t Plugin_Load(const void *image, uint32_t len, effect_id_t *id);
+
+/** Plugin_Load() of the file at `path` on the card (stream.h); sleeps, a few seconds at most. Tasks. */
+plugin_status_t Plugin_LoadFile(const char *path, effect_id_t *id);
+
+/** Load every ASSET_PLUGIN of the asset table. The Init task (boot.h). */
+void Plugin_LoadAssets(void);
+
+/** Plug-ins registered. */
+uint32_t Plugin_Count(void);
+
+/** Registry entry of plug-in `slot` (its effect id - EFFECT_COUNT); NULL if none. */
+const effect_t *Plugin_Effect(uint8_t slot);
+
+/** Draw `n` LEDs of plug-in `slot` at `offset`. NeoPixel task (effects.c). */
+void Plugin_Render(uint8_t slot, pix_t *px, uint16_t n, const effect_params_t *params, uint8_t offset);
+
+/** Plug-in `slot` for the console; false if none. */
+bool Plugin_GetInfo(uint8_t slot, plugin_info_t *out);
+
+/** "ok", "full", ... for the console. */
+const char *Plugin_StatusName(plugin_status_t s);
+
+#endif /* PLUGIN_H */
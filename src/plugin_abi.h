@@ -0,0 +1,90 @@
+/* =============================================================================
+ * plugin_abi.h  -  The fixed interface between the firmware and an effect plug-in
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Shared by the firmware (plugin.h) and the plug-ins themselves, so it
+ * includes nothing but the C headers: a plug-in is built on its own, with
+ * no firmware symbols, and only ever reaches the firmware through the
+ * plugin_api_t it is handed.
+ *
+ * An image is a plugin_header_t followed by the plug-in's code, read-only
+ * data and initialised data, linked to run at any address it is copied to
+ * (tools/fxplugin/plugin.ld, -fpie, no GOT, no relocations), then
+ * hdr.bss zeroed bytes of its own. Every field is little-endian:
+ *
+ *   magic     'C' 'R' 'F' 'X'
+ *   abi       PLUGIN_ABI; another is refused
+ *   flags     PLUGIN_F_*
+ *   name      the registry name, NUL-padded ("fx" on the console)
+ *   size      the image, this header included
+ *   entry     offset of the plugin_render_fn in the image
+ *   bss       bytes zeroed after the image
+ *   cycles    render budget per LED, 0 = PLUGIN_CYCLES_DEFAULT
+ *   speed, brightness   the default effect_params_t
+ *   crc       CRC-32 (IEEE, as crc.h) of the image with this field 0
+ *
+ * tools/mkfxplugin.py writes the header from the linked ELF.
+ * ============================================================================= */
+
+#ifndef PLUGIN_ABI_H
+#define PLUGIN_ABI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PLUGIN_MAGIC            0x58465243u     /* "CRFX" */
+#define PLUGIN_ABI              1u
+#define PLUGIN_HEADER_BYTES     48u
+#define PLUGIN_NAME_LEN         16u
+
+#define PLUGIN_F_ANIMATED       0x0001u         /* output moves with the phase */
+
+/** Firmware services, in ABI order; new ones are only ever appended. */
+typedef struct
+{
+    uint16_t abi;                               /* PLUGIN_ABI                  */
+    uint16_t size;                              /* sizeof(plugin_api_t)        */
+    uint32_t (*rand32)(void);                   /* rng.h Rng_Next32()          */
+    uint8_t  (*sin8)(uint8_t x);                /* fastmath.h                  */
+    int16_t  (*sin16)(uint16_t x);
+    uint8_t  (*noise8)(uint32_t x);
+    uint8_t  (*perlin8)(uint16_t x, uint16_t y);
+    uint32_t (*now_ms)(void);                   /* since boot                  */
+} plugin_api_t;
+
+/** One call: what to draw and how long it may take. */
+typedef struct
+{
+    uint16_t            count;                  /* LEDs, px[0] .. px[count-1]  */
+    uint8_t             offset;                 /* animation phase             */
+    uint8_t             speed;                  /* phase advance per frame     */
+    uint32_t            budget;                 /* cycles this call may take   */
+    const plugin_api_t *api;
+} plugin_frame_t;
+
+/**
+ * Draw the span: px[i] for every LED i, packed 0x00BBGGRR (pixmath.h pix_t)
+ * at full brightness; the firmware scales it. Called once per frame for
+ * every segment or layer showing the plug-in, from the NeoPixel task.
+ */
+typedef void (*plugin_render_fn)(uint32_t *px, const plugin_frame_t *f);
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t abi;
+    uint16_t flags;
+    char     name[PLUGIN_NAME_LEN];
+    uint32_t size;
+    uint32_t entry;
+    uint32_t bss;
+    uint32_t cycles;
+    uint8_t  speed;
+    uint8_t  brightness;
+    uint16_t reserved;
+    uint32_t crc;
+} plugin_header_t;
+
+_Static_assert(sizeof(plugin_header_t) == PLUGIN_HEADER_BYTES, "plugin_header_t: the image layout");
+
+#endif /* PLUGIN_ABI_H */
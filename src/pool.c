@@ -0,0 +1,167 @@
+/* =============================================================================
+ * pool.c  -  Fixed-block memory pools for transient objects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "pool.h"
+#include "definitions.h"        /* core_cm4.h: PRIMASK */
+#include "FreeRTOS.h"           /* configASSERT */
+
+#if (POOL_SIZE_0 % 8u) || (POOL_SIZE_1 % 8u) || (POOL_SIZE_2 % 8u) || (POOL_SIZE_3 % 8u)
+#error "pool block sizes must be multiples of 8"
+#endif
+#if !(POOL_SIZE_0 < POOL_SIZE_1 && POOL_SIZE_1 < POOL_SIZE_2 && POOL_SIZE_2 < POOL_SIZE_3)
+#error "pool classes must be in ascending size"
+#endif
+
+#define POOL_MAP_WORDS(n)   (((n) + 31u) / 32u)
+#define POOL_COUNT_MAX      32u                 /* largest POOL_COUNT_x for the maps */
+
+#if POOL_COUNT_0 > POOL_COUNT_MAX || POOL_COUNT_1 > POOL_COUNT_MAX || \
+    POOL_COUNT_2 > POOL_COUNT_MAX || POOL_COUNT_3 > POOL_COUNT_MAX
+#error "raise POOL_COUNT_MAX"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct pool_block
+{
+    struct pool_block *next;
+} pool_block_t;
+
+typedef struct
+{
+    uint8_t      *base;
+    uint16_t      size;
+    uint16_t      count;
+    pool_block_t *free;
+    uint16_t      used;
+    uint16_t      peak;
+    uint32_t      fails;
+    uint32_t      map[POOL_MAP_WORDS(POOL_COUNT_MAX)];  /* 1 = handed out */
+} pool_class_t;
+
+/* uint64_t: every block 8-byte aligned */
+static uint64_t pool_mem0[POOL_SIZE_0 * POOL_COUNT_0 / 8u];
+static uint64_t pool_mem1[POOL_SIZE_1 * POOL_COUNT_1 / 8u];
+static uint64_t pool_mem2[POOL_SIZE_2 * POOL_COUNT_2 / 8u];
+static uint64_t pool_mem3[POOL_SIZE_3 * POOL_COUNT_3 / 8u];
+
+static pool_class_t pool_class[POOL_CLASSES] =
+{
+    { .base = (uint8_t *)pool_mem0, .size = POOL_SIZE_0, .count = POOL_COUNT_0 },
+    { .base = (uint8_t *)pool_mem1, .size = POOL_SIZE_1, .count = POOL_COUNT_1 },
+    { .base = (uint8_t *)pool_mem2, .size = POOL_SIZE_2, .count = POOL_COUNT_2 },
+    { .base = (uint8_t *)pool_mem3, .size = POOL_SIZE_3, .count = POOL_COUNT_3 },
+};
+
+static volatile uint32_t pool_fails;
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Pool_Init(void)
+{
+    for (uint32_t c = 0; c < POOL_CLASSES; c++)
+    {
+        pool_class_t *k = &pool_class[c];
+
+        k->free = NULL;
+        for (uint32_t i = k->count; i-- != 0u; )     /* block 0 handed out first */
+        {
+            pool_block_t *b = (pool_block_t *)(k->base + i * k->size);
+
+            b->next = k->free;
+            k->free = b;
+        }
+    }
+}
+
+void *Pool_Alloc(size_t size)
+{
+    pool_class_t *first = NULL;
+
+    for (uint32_t c = 0; c < POOL_CLASSES; c++)
+    {
+        pool_class_t *k = &pool_class[c];
+        pool_block_t *b;
+        uint32_t      primask;
+
+        if (size > k->size) continue;
+        if (first == NULL) first = k;
+
+        primask = __get_PRIMASK();
+        __disable_irq();
+        b = k->free;
+        if (b != NULL)
+        {
+            uint32_t i = (uint32_t)((uint8_t *)b - k->base) / k->size;
+
+            k->free = b->next;
+            k->map[i / 32u] |= 1u << (i % 32u);
+            if (++k->used > k->peak) k->peak = k->used;
+        }
+        __set_PRIMASK(primask);
+        if (b != NULL) return b;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (first != NULL) first->fails++;              /* larger than every class: total only */
+    pool_fails++;
+    __set_PRIMASK(primask);
+    return NULL;
+}
+
+void Pool_Free(void *p)
+{
+    uint8_t *a = (uint8_t *)p;
+
+    if (p == NULL) return;
+    for (uint32_t c = 0; c < POOL_CLASSES; c++)
+    {
+        pool_class_t *k = &pool_class[c];
+        uint32_t      i, bit, primask;
+
+        if (a < k->base || a >= k->base + (uint32_t)k->size * k->count) continue;
+
+        i   = (uint32_t)(a - k->base) / k->size;
+        bit = 1u << (i % 32u);
+        configASSERT(a == k->base + i * k->size);   /* not a block start */
+
+        primask = __get_PRIMASK();
+        __disable_irq();
+        configASSERT((k->map[i / 32u] & bit) != 0u);    /* freed twice */
+        k->map[i / 32u] &= ~bit;
+        ((pool_block_t *)a)->next = k->free;
+        k->free = (pool_block_t *)a;
+        k->used--;
+        __set_PRIMASK(primask);
+        return;
+    }
+    configASSERT(0);                                /* not from a pool */
+}
+
+bool Pool_GetStats(uint32_t cls, pool_stats_t *out)
+{
+    const pool_class_t *k;
+    uint32_t            primask;
+
+    if (cls >= POOL_CLASSES) return false;
+    k = &pool_class[cls];
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    out->size  = k->size;
+    out->count = k->count;
+    out->used  = k->used;
+    out->peak  = k->peak;
+    out->fails = k->fails;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+uint32_t Pool_Fails(void)
+{
+    return pool_fails;
+}
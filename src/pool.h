@@ -0,0 +1,68 @@
+/* =============================================================================
+ * pool.h  -  Fixed-block memory pools for transient objects
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * heap_1 never frees, so anything short-lived (particles, log records,
+ * command messages, I2C transactions) comes from here instead: a few size
+ * classes of equal blocks, each class a LIFO free list in static RAM.
+ *
+ *   Pool_Alloc(n)  smallest class with n <= block size and a free block;
+ *                  a full class spills into the next larger one
+ *   Pool_Free(p)   back to the class p came from, found by address
+ *
+ * Both run in bounded time (a walk over POOL_CLASSES, no search inside a
+ * class) with interrupts masked for a few instructions only, so tasks and
+ * ISRs of any priority may call them. Nothing fragments: a block is always
+ * reused at its own size. Freeing a pointer twice or one that is not a
+ * block trips configASSERT().
+ *
+ * Per class the pool counts blocks in use, the high-water mark and
+ * requests that found every fitting class empty; the CLI "pool" command
+ * prints them, so classes can be resized from real peaks.
+ * ============================================================================= */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* -- User configuration ------------------------------------------------------ */
+/* Block sizes are multiples of 8 (alignment for any type), ascending */
+#define POOL_CLASSES        4u
+#define POOL_SIZE_0         32u
+#define POOL_COUNT_0        32u
+#define POOL_SIZE_1         64u
+#define POOL_COUNT_1        16u
+#define POOL_SIZE_2         128u
+#define POOL_COUNT_2        8u
+#define POOL_SIZE_3         256u
+#define POOL_COUNT_3        4u
+
+typedef struct
+{
+    uint16_t size;              /* bytes per block            */
+    uint16_t count;             /* blocks in the class        */
+    uint16_t used;              /* blocks handed out now      */
+    uint16_t peak;              /* most ever handed out       */
+    uint32_t fails;             /* requests this class refused
+                                 * with no larger one free    */
+} pool_stats_t;
+
+/** Build the free lists. Before the scheduler and before any Pool_Alloc(). */
+void Pool_Init(void);
+
+/** A block of at least size bytes, 8-byte aligned, or NULL. Any task or ISR. */
+void *Pool_Alloc(size_t size);
+
+/** Return a block from Pool_Alloc(); NULL is ignored. Any task or ISR. */
+void Pool_Free(void *p);
+
+/** Counters of class cls (0 = smallest); false past the last class. */
+bool Pool_GetStats(uint32_t cls, pool_stats_t *out);
+
+/** Failed Pool_Alloc() calls since boot, all classes. */
+uint32_t Pool_Fails(void);
+
+#endif /* POOL_H */
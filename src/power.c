@@ -0,0 +1,56 @@
+/* =============================================================================
+ * power.c  -  Estimated-current limiter for the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "power.h"
+#include "neopixel.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t          power_last_ma = 0u;
+static volatile uint32_t power_budget_ma = POWER_BUDGET_MA;
+
+/* -- Public API implementation ----------------------------------------------- */
+
+uint8_t Power_Limit(pix_t *px, uint16_t n)
+{
+    pix_sum_t sum;
+
+    Pix_SumStrip(px, n, &sum);
+
+    /* Colour current at the current global brightness, in mA x 255 x 255 */
+    uint64_t colour = ((uint64_t)sum.r * POWER_MA_R + (uint64_t)sum.g * POWER_MA_G
+                     + (uint64_t)sum.b * POWER_MA_B) * NeoPixel_GetBrightness();
+    uint32_t idle   = ((uint32_t)n * POWER_IDLE_MA_X10) / 10u;
+    uint32_t ma     = idle + (uint32_t)(colour / (255u * 255u));
+    uint32_t budget = power_budget_ma;
+
+    power_last_ma = ma;
+
+    if (POWER_BUDGET_MA == 0u || ma <= budget || colour == 0u)
+        return 255u;
+
+    /* Only the colour share scales; the quiescent draw stays */
+    uint64_t room  = (budget > idle) ? (uint64_t)(budget - idle) * 255u * 255u : 0u;
+    uint32_t scale = (uint32_t)((room * 256u) / colour);        /* Pix_Scale(): (s + 1) / 256 */
+    uint8_t  s     = (scale == 0u) ? 0u : (uint8_t)((scale > 256u ? 256u : scale) - 1u);
+
+    Pix_ScaleStrip(px, n, s);
+    return s;
+}
+
+void Power_SetBudget(uint32_t ma)
+{
+    power_budget_ma = ma;
+}
+
+uint32_t Power_Budget(void)
+{
+    return power_budget_ma;
+}
+
+uint32_t Power_LastMilliamps(void)
+{
+    return power_last_ma;
+}
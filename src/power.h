@@ -0,0 +1,49 @@
+/* =============================================================================
+ * power.h  -  Estimated-current limiter for the NeoPixel strip
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A full-white 144-LED strip draws well over 5 A, enough to brown out the
+ * 5 V rail and reset the board together with the relays. Power_Limit() runs
+ * on the packed frame just before it is staged for encoding:
+ *
+ *   I = idle x LEDs + (sum R x mA_R + sum G x mA_G + sum B x mA_B) / 255
+ *       x global brightness / 255
+ *
+ * and, if I exceeds POWER_BUDGET_MA, scales the whole frame down to fit.
+ * The channel sums are one SIMD pass (Pix_SumStrip()). Gamma and white
+ * balance only ever lower the real duty, so the estimate errs on the safe
+ * side; frames staged pixel by pixel (NeoPixel_SetPixel()) are not limited.
+ *
+ * The budget starts at POWER_BUDGET_MA; Power_SetBudget() lowers it at run
+ * time, e.g. while the 5 V rail sags (railmon.h).
+ * ============================================================================= */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include "pixmath.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define POWER_BUDGET_MA     2000u       /* LED supply budget, 0 = no limit       */
+#define POWER_MA_R          12u         /* mA per LED, red   channel at 255      */
+#define POWER_MA_G          12u         /* mA per LED, green channel at 255      */
+#define POWER_MA_B          12u         /* mA per LED, blue  channel at 255      */
+#define POWER_IDLE_MA_X10   8u          /* quiescent draw per LED, 0.1 mA units  */
+
+/**
+ * Scale px[0..n-1] in place so the estimated strip current stays within
+ * POWER_BUDGET_MA. Returns the scale applied (255 = frame left unchanged).
+ */
+uint8_t Power_Limit(pix_t *px, uint16_t n);
+
+/** LED current budget for the next frames, mA; POWER_BUDGET_MA 0 keeps the limiter off. Any task. */
+void Power_SetBudget(uint32_t ma);
+
+/** Budget in use, mA. Any task. */
+uint32_t Power_Budget(void);
+
+/** Estimated current of the last frame passed to Power_Limit(), before limiting (mA). */
+uint32_t Power_LastMilliamps(void);
+
+#endif /* POWER_H */
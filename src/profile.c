@@ -0,0 +1,101 @@
+/* =============================================================================
+ * profile.c  -  Per-frame cycle profiling via the DWT cycle counter
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "profile.h"
+
+#if PROFILE_ENABLE
+
+#include "cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t       prof_frame[PROFILE_SLOTS];    /* totals for the frame in flight */
+static profile_stat_t prof_stat[PROFILE_SLOTS];
+static uint32_t       prof_hits;                    /* Cache_Hits() at the window start */
+
+static const char * const prof_name[PROFILE_SLOTS] =
+{
+    "render", "encode", "dma_wait", "idle"
+};
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Profile_Reset(void)
+{
+    memset(prof_frame, 0, sizeof(prof_frame));
+    prof_hits = Cache_Hits();
+    for (uint8_t s = 0; s < PROFILE_SLOTS; s++)
+    {
+        prof_stat[s].min    = UINT32_MAX;
+        prof_stat[s].max    = 0u;
+        prof_stat[s].sum    = 0u;
+        prof_stat[s].frames = 0u;
+    }
+}
+
+void Profile_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     /* DWT needs trace enabled */
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;               /* counting since reset (boot.h) */
+
+    Profile_Reset();
+}
+
+void Profile_Add(profile_slot_t slot, uint32_t cycles)
+{
+    prof_frame[slot] += cycles;
+}
+
+void Profile_FrameEnd(void)
+{
+    /* The render stamp wraps the whole effect call, which includes the encode
+     * and DMA wait time measured inside the driver - report it exclusive. */
+    uint32_t inner = prof_frame[PROFILE_ENCODE] + prof_frame[PROFILE_DMA_WAIT];
+
+    prof_frame[PROFILE_RENDER] = (prof_frame[PROFILE_RENDER] > inner)
+                               ? prof_frame[PROFILE_RENDER] - inner : 0u;
+
+    for (uint8_t s = 0; s < PROFILE_SLOTS; s++)
+    {
+        profile_stat_t *st = &prof_stat[s];
+        uint32_t        c  = prof_frame[s];
+
+        if (c < st->min) st->min = c;
+        if (c > st->max) st->max = c;
+        st->sum += c;
+        st->frames++;
+
+        prof_frame[s] = 0u;
+    }
+}
+
+void Profile_Get(profile_slot_t slot, profile_stat_t *out)
+{
+    *out = prof_stat[slot];
+}
+
+void Profile_Print(void)
+{
+    printf("profile: %lu frames, cycles min/avg/max\n", (unsigned long)prof_stat[0].frames);
+
+    for (uint8_t s = 0; s < PROFILE_SLOTS; s++)
+    {
+        const profile_stat_t *st = &prof_stat[s];
+        uint32_t avg = (st->frames != 0u) ? (uint32_t)(st->sum / st->frames) : 0u;
+
+        printf("  %-8s %10lu %10lu %10lu\n", prof_name[s],
+               (unsigned long)((st->frames != 0u) ? st->min : 0u),
+               (unsigned long)avg, (unsigned long)st->max);
+    }
+    printf("  icache   %lu hits, %lu ways locked\n", (unsigned long)(Cache_Hits() - prof_hits),
+           (unsigned long)Cache_LockedWays());
+
+    Profile_Reset();
+}
+
+#endif /* PROFILE_ENABLE */
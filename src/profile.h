@@ -0,0 +1,83 @@
+/* =============================================================================
+ * profile.h  -  Per-frame cycle profiling via the DWT cycle counter
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Each frame is split into four slots, timed in CPU cycles (120 MHz):
+ *
+ *   RENDER    effect maths (HSV, noise, ...) excluding the two below
+ *   ENCODE    WS2812 bit expansion (encode_byte) inside the NeoPixel driver
+ *   DMA_WAIT  time NeoPixel_Show() blocks on the previous frame
+ *   IDLE      time the NeoPixel task sleeps until its next frame slot
+ *
+ * Profile_FrameEnd() folds the per-frame totals into min / avg / max, and
+ * Profile_Print() dumps them over the SERCOM5 console (stdout), with the
+ * CMCC instruction hits of the window (cache.h).
+ *
+ * With PROFILE_ENABLE = 0 every macro below expands to nothing and the API
+ * functions are not built, so there is no cost in release images.
+ * ============================================================================= */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define PROFILE_ENABLE        0         /* 1 = build the profiler in            */
+#define PROFILE_PRINT_FRAMES  250u      /* frames between console reports       */
+
+typedef enum
+{
+    PROFILE_RENDER = 0,
+    PROFILE_ENCODE,
+    PROFILE_DMA_WAIT,
+    PROFILE_IDLE,
+    PROFILE_SLOTS
+} profile_slot_t;
+
+typedef struct
+{
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t frames;
+} profile_stat_t;
+
+#if PROFILE_ENABLE
+
+#include "definitions.h"        /* core_cm4.h: DWT, CoreDebug */
+
+/* Open a timed section: declares a local holding the start stamp */
+#define PROFILE_START(t)        uint32_t t = DWT->CYCCNT
+/* Close it and charge the elapsed cycles to the current frame's slot */
+#define PROFILE_ADD(slot, t)    Profile_Add((slot), DWT->CYCCNT - (t))
+
+/** Enable the DWT cycle counter and clear all statistics. */
+void Profile_Init(void);
+
+/** Clear all statistics (Profile_Print() does this after printing). */
+void Profile_Reset(void);
+
+/** Accumulate cycles into the current frame's slot (task context only). */
+void Profile_Add(profile_slot_t slot, uint32_t cycles);
+
+/** Close the current frame: update min / avg / max and zero the frame totals. */
+void Profile_FrameEnd(void);
+
+/** Copy one slot's statistics since the last reset. */
+void Profile_Get(profile_slot_t slot, profile_stat_t *out);
+
+/** Print all slots to stdout (blocking 115200 8N1) and reset the statistics. */
+void Profile_Print(void);
+
+#else
+
+#define PROFILE_START(t)
+#define PROFILE_ADD(slot, t)
+#define Profile_Init()
+#define Profile_FrameEnd()
+#define Profile_Print()
+
+#endif /* PROFILE_ENABLE */
+
+#endif /* PROFILE_H */
@@ -0,0 +1,363 @@
+/* =============================================================================
+ * qflash.c  -  External QSPI NOR flash, memory mapped, with DMA bulk reads
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "qflash.h"
+#include "definitions.h"        /* QSPI_REGS, DMAC, __DSB / __ISB */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "dma_qos.h"
+#include "crc.h"
+#include "neopixel.h"
+#include "actuator.h"
+
+#if QFLASH_ENABLE && (NEO_BACKEND == NEO_BACKEND_TCC)
+#error "QFLASH_ENABLE: PA08 is QSPI DATA0, not the NeoPixel TCC output"
+#endif
+#if QFLASH_ENABLE && ACT_PWM_DRIVE
+#error "QFLASH_ENABLE: PA10 is QSPI DATA2, not the motor PWM output"
+#endif
+
+/* Commands, common to the W25Q / GD25Q / IS25LP families */
+#define QF_CMD_WREN         0x06u
+#define QF_CMD_RDSR1        0x05u
+#define QF_CMD_RDSR2        0x35u
+#define QF_CMD_WRSR1        0x01u
+#define QF_CMD_WRSR2        0x31u
+#define QF_CMD_RDID         0x9Fu
+#define QF_CMD_RSTEN        0x66u
+#define QF_CMD_RST          0x99u
+#define QF_CMD_SE4K         0x20u
+#define QF_CMD_QPP          0x32u       /* page program, quad data   */
+#define QF_CMD_QREAD        0xEBu       /* fast read quad I/O        */
+
+#define QF_SR1_WIP          0x01u
+#define QF_QE_BIT           (QFLASH_QE_SR2 ? 0x02u : 0x40u)
+
+#define QF_FRAME_CMD        (QSPI_INSTRFRAME_WIDTH_SINGLE_BIT_SPI | QSPI_INSTRFRAME_INSTREN_Msk)
+#define QF_FRAME_ADDR       (QF_FRAME_CMD | QSPI_INSTRFRAME_ADDREN_Msk | QSPI_INSTRFRAME_ADDRLEN_24BITS)
+
+#define QF_DMA_MAX_BEATS    0xFFFFu
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static qflash_info_t     qf_info;
+static SemaphoreHandle_t qf_mutex;
+#if QFLASH_ENABLE
+static StaticSemaphore_t qf_mutex_buf;
+#endif
+
+/* DMA copy in flight: the caller, and the flags it ended with */
+static TaskHandle_t      qf_waiter;
+static volatile uint8_t  qf_dma_flags;
+
+/* -- Controller -------------------------------------------------------------- */
+
+/* One instruction frame; data (len bytes) goes through the mapped window */
+static void qf_run(uint8_t instr, uint32_t frame, uint32_t addr, void *rx, const void *tx, uint32_t len)
+{
+    volatile uint8_t *win = (volatile uint8_t *)(QFLASH_BASE +
+                            (((frame & QSPI_INSTRFRAME_ADDREN_Msk) != 0u) ? addr : 0u));
+
+    QSPI_REGS->QSPI_INSTRCTRL  = QSPI_INSTRCTRL_INSTR(instr);
+    QSPI_REGS->QSPI_INSTRADDR  = addr;
+    QSPI_REGS->QSPI_INSTRFRAME = frame | ((len != 0u) ? QSPI_INSTRFRAME_DATAEN_Msk : 0u);
+    (void)QSPI_REGS->QSPI_INSTRFRAME;           /* frame in place before the data phase */
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (rx != NULL) ((uint8_t *)rx)[i] = win[i];
+        else            win[i] = ((const uint8_t *)tx)[i];
+    }
+    __DSB();
+    __ISB();
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_ENABLE_Msk | QSPI_CTRLA_LASTXFER_Msk;
+    while ((QSPI_REGS->QSPI_INTFLAG & QSPI_INTFLAG_INSTREND_Msk) == 0u) {}
+    QSPI_REGS->QSPI_INTFLAG = QSPI_INTFLAG_INSTREND_Msk;
+}
+
+static uint8_t qf_read_reg(uint8_t instr)
+{
+    uint8_t v = 0u;
+
+    qf_run(instr, QF_FRAME_CMD | QSPI_INSTRFRAME_TFRTYPE_READ, 0u, &v, NULL, 1u);
+    return v;
+}
+
+static void qf_cmd(uint8_t instr)
+{
+    qf_run(instr, QF_FRAME_CMD, 0u, NULL, NULL, 0u);
+}
+
+/* Poll WIP; sleeps a tick between polls once the scheduler runs, spins before */
+static bool qf_wait_ready(void)
+{
+    bool       rtos = xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+    TickType_t t0   = xTaskGetTickCount();
+    uint32_t   spin = QFLASH_TIMEOUT_MS * 1000u;          /* a poll is ~1 us */
+
+    while ((qf_read_reg(QF_CMD_RDSR1) & QF_SR1_WIP) != 0u)
+    {
+        if (rtos)
+        {
+            if ((xTaskGetTickCount() - t0) > pdMS_TO_TICKS(QFLASH_TIMEOUT_MS)) return false;
+            vTaskDelay(1);
+        }
+        else if (--spin == 0u)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Serial-memory read mode: the window at QFLASH_BASE reads the chip */
+static void qf_map_on(void)
+{
+    QSPI_REGS->QSPI_INSTRCTRL  = QSPI_INSTRCTRL_INSTR(QF_CMD_QREAD) | QSPI_INSTRCTRL_OPTCODE(0xFFu);  /* no continuous mode */
+    QSPI_REGS->QSPI_INSTRFRAME = QSPI_INSTRFRAME_WIDTH_QUAD_IO | QSPI_INSTRFRAME_INSTREN_Msk
+                               | QSPI_INSTRFRAME_ADDREN_Msk | QSPI_INSTRFRAME_ADDRLEN_24BITS
+                               | QSPI_INSTRFRAME_OPTCODEEN_Msk | QSPI_INSTRFRAME_OPTCODELEN_8BITS
+                               | QSPI_INSTRFRAME_DATAEN_Msk | QSPI_INSTRFRAME_TFRTYPE_READMEMORY
+                               | QSPI_INSTRFRAME_DUMMYLEN(4u);
+    (void)QSPI_REGS->QSPI_INSTRFRAME;
+}
+
+#if QFLASH_ENABLE
+static bool qf_set_quad(void)
+{
+    uint8_t sr = qf_read_reg(QFLASH_QE_SR2 ? QF_CMD_RDSR2 : QF_CMD_RDSR1);
+
+    if ((sr & QF_QE_BIT) != 0u) return true;
+    sr |= QF_QE_BIT;
+    qf_cmd(QF_CMD_WREN);
+    qf_run(QFLASH_QE_SR2 ? QF_CMD_WRSR2 : QF_CMD_WRSR1, QF_FRAME_CMD | QSPI_INSTRFRAME_TFRTYPE_WRITE,
+           0u, NULL, &sr, 1u);
+    return qf_wait_ready();
+}
+#endif
+
+static bool qf_range(uint32_t offset, uint32_t len)
+{
+    return qf_info.size != 0u && offset <= qf_info.size && len <= qf_info.size - offset;
+}
+
+/* -- DMA --------------------------------------------------------------------- */
+
+#if QFLASH_ENABLE
+/* Copy done or failed (dma_qos.c DMAC_OTHER dispatch) */
+static void qf_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    qf_dma_flags = flags;
+    if (qf_waiter != NULL) vTaskNotifyGiveIndexedFromISR(qf_waiter, QFLASH_NOTIFY_INDEX, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+/* One block of `beats`, software triggered, bursts of 16 beats */
+static bool qf_dma_block(uint8_t *dst, uint32_t src, uint32_t beats, bool words)
+{
+    dmac_descriptor_registers_t *d =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + QFLASH_DMA_CHANNEL;
+    uint32_t bytes = beats * (words ? 4u : 1u);
+    uint32_t got;
+
+    d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk | DMAC_BTCTRL_DSTINC_Msk
+                     | (words ? DMAC_BTCTRL_BEATSIZE_WORD : DMAC_BTCTRL_BEATSIZE_BYTE)
+                     | DMAC_BTCTRL_BLOCKACT_INT;
+    d->DMAC_BTCNT    = (uint16_t)beats;
+    d->DMAC_SRCADDR  = src + bytes;                     /* end addresses with increment */
+    d->DMAC_DSTADDR  = (uint32_t)dst + bytes;
+    d->DMAC_DESCADDR = 0u;
+
+    qf_dma_flags = 0u;
+    qf_waiter    = xTaskGetCurrentTaskHandle();
+    (void)ulTaskNotifyTakeIndexed(QFLASH_NOTIFY_INDEX, pdTRUE, 0u);       /* drop a stale give */
+    DMAC_REGS->CHANNEL[QFLASH_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    DMAC_REGS->DMAC_SWTRIGCTRL = DMAC_SWTRIGCTRL_SWTRIG0_Msk << QFLASH_DMA_CHANNEL;
+
+    got = ulTaskNotifyTakeIndexed(QFLASH_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(QFLASH_TIMEOUT_MS));
+    qf_waiter = NULL;
+    if (got == 0u)
+    {
+        DMAC_REGS->CHANNEL[QFLASH_DMA_CHANNEL].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+        while ((DMAC_REGS->CHANNEL[QFLASH_DMA_CHANNEL].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u) {}
+        return false;
+    }
+    return (qf_dma_flags & DMAC_CHINTFLAG_TERR_Msk) == 0u;
+}
+
+#if QFLASH_ENABLE
+static void qf_dma_init(void)
+{
+    DMAC_REGS->CHANNEL[QFLASH_DMA_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(0u) | DMAC_CHCTRLA_TRIGACT_BLOCK | DMAC_CHCTRLA_BURSTLEN_16BEAT;
+    Dma_Assign(QFLASH_DMA_CHANNEL, DMA_CLASS_BULK);
+    (void)Dma_OtherRegister(QFLASH_DMA_CHANNEL, qf_dma_isr);
+    DMAC_REGS->CHANNEL[QFLASH_DMA_CHANNEL].DMAC_CHINTENSET =
+        DMAC_CHINTENSET_TCMPL_Msk | DMAC_CHINTENSET_TERR_Msk;
+}
+#endif
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool QFlash_Init(void)
+{
+#if QFLASH_ENABLE
+    uint8_t id[3];
+
+    qf_mutex = xSemaphoreCreateMutexStatic(&qf_mutex_buf);
+
+    MCLK_REGS->MCLK_AHBMASK  |= MCLK_AHBMASK_QSPI_Msk | MCLK_AHBMASK_QSPI_2X_Msk;
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_QSPI_Msk;
+
+    /* PA08..PA11 (DATA0..3), PB10 (SCK), PB11 (CS) -> peripheral H */
+    PORT_REGS->GROUP[0].PORT_PMUX[8u >> 1]  = PORT_PMUX_PMUXE(7u) | PORT_PMUX_PMUXO(7u);
+    PORT_REGS->GROUP[0].PORT_PMUX[10u >> 1] = PORT_PMUX_PMUXE(7u) | PORT_PMUX_PMUXO(7u);
+    PORT_REGS->GROUP[1].PORT_PMUX[10u >> 1] = PORT_PMUX_PMUXE(7u) | PORT_PMUX_PMUXO(7u);
+    for (uint32_t pin = 8u; pin <= 11u; pin++)
+        PORT_REGS->GROUP[0].PORT_PINCFG[pin] = PORT_PINCFG_PMUXEN_Msk;
+    PORT_REGS->GROUP[1].PORT_PINCFG[10] = PORT_PINCFG_PMUXEN_Msk;
+    PORT_REGS->GROUP[1].PORT_PINCFG[11] = PORT_PINCFG_PMUXEN_Msk;
+
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_SWRST_Msk;
+    QSPI_REGS->QSPI_CTRLB = QSPI_CTRLB_MODE_MEMORY | QSPI_CTRLB_CSMODE_LASTXFER | QSPI_CTRLB_DATALEN_8BITS;
+    QSPI_REGS->QSPI_BAUD  = QSPI_BAUD_BAUD(QFLASH_BAUD_DIV - 1u);       /* mode 0 */
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_ENABLE_Msk;
+
+    /* Out of any mode a previous run left it in, then identify */
+    qf_cmd(QF_CMD_RSTEN);
+    qf_cmd(QF_CMD_RST);
+    for (volatile uint32_t i = 0; i < 4000u; i++) {}          /* tRST ~30 us */
+    qf_run(QF_CMD_RDID, QF_FRAME_CMD | QSPI_INSTRFRAME_TFRTYPE_READ, 0u, id, NULL, 3u);
+
+    qf_info.jedec[0] = id[0];
+    qf_info.jedec[1] = id[1];
+    qf_info.jedec[2] = id[2];
+    if (id[0] == 0x00u || id[0] == 0xFFu || id[2] < 0x10u || id[2] > 0x18u || !qf_set_quad())
+    {
+        qf_info.size = 0u;
+        return false;
+    }
+    qf_info.size = 1u << id[2];                 /* 0x14 = 1 MB .. 0x18 = 16 MB */
+
+    qf_dma_init();
+    qf_map_on();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QFlash_GetInfo(qflash_info_t *out)
+{
+    *out = qf_info;
+}
+
+const void *QFlash_Map(uint32_t offset)
+{
+    if (qf_info.size == 0u || offset >= qf_info.size) return NULL;
+    return (const void *)(QFLASH_BASE + offset);
+}
+
+/* The copy of QFlash_Read(), under qf_mutex */
+static bool qf_read(void *dst, uint32_t offset, uint32_t len)
+{
+    uint8_t *d = dst;
+    bool     words = (((uint32_t)dst | offset | len) & 3u) == 0u;
+    bool     ok = true;
+
+    while (ok && len != 0u)
+    {
+        uint32_t beats = (words ? len / 4u : len);
+
+        if (beats > QF_DMA_MAX_BEATS) beats = QF_DMA_MAX_BEATS;
+        ok = qf_dma_block(d, QFLASH_BASE + offset, beats, words);
+
+        uint32_t bytes = beats * (words ? 4u : 1u);
+
+        d += bytes;
+        offset += bytes;
+        len -= bytes;
+    }
+    return ok;
+}
+
+bool QFlash_Read(void *dst, uint32_t offset, uint32_t len)
+{
+    bool ok;
+
+    if (!qf_range(offset, len)) return false;
+
+    (void)xSemaphoreTake(qf_mutex, portMAX_DELAY);
+    ok = qf_read(dst, offset, len);
+    (void)xSemaphoreGive(qf_mutex);
+    return ok;
+}
+
+bool QFlash_ReadCrc(void *dst, uint32_t offset, uint32_t len, uint32_t *crc)
+{
+    bool ok;
+
+    if (!qf_range(offset, len)) return false;
+
+    (void)xSemaphoreTake(qf_mutex, portMAX_DELAY);
+    ok = Crc_StreamBegin(QFLASH_DMA_CHANNEL);       /* the engine reads along */
+    if (ok)
+    {
+        ok   = qf_read(dst, offset, len);
+        *crc = Crc_StreamEnd();
+    }
+    (void)xSemaphoreGive(qf_mutex);
+    return ok;
+}
+
+bool QFlash_Erase(uint32_t offset, uint32_t len)
+{
+    uint32_t end = offset + len;
+    bool     ok  = true;
+
+    if (!qf_range(offset, len)) return false;
+
+    (void)xSemaphoreTake(qf_mutex, portMAX_DELAY);
+    for (uint32_t a = offset & ~(QFLASH_SECTOR - 1u); ok && a < end; a += QFLASH_SECTOR)
+    {
+        qf_cmd(QF_CMD_WREN);
+        qf_run(QF_CMD_SE4K, QF_FRAME_ADDR, a, NULL, NULL, 0u);
+        ok = qf_wait_ready();
+    }
+    qf_map_on();
+    (void)xSemaphoreGive(qf_mutex);
+    return ok;
+}
+
+bool QFlash_Program(uint32_t offset, const void *src, uint32_t len)
+{
+    const uint8_t *s = src;
+    bool ok = true;
+
+    if (!qf_range(offset, len)) return false;
+
+    (void)xSemaphoreTake(qf_mutex, portMAX_DELAY);
+    while (ok && len != 0u)
+    {
+        uint32_t n = QFLASH_PAGE - (offset & (QFLASH_PAGE - 1u));      /* to the page end */
+
+        if (n > len) n = len;
+        qf_cmd(QF_CMD_WREN);
+        qf_run(QF_CMD_QPP, QSPI_INSTRFRAME_WIDTH_QUAD_OUTPUT | QSPI_INSTRFRAME_INSTREN_Msk
+                          | QSPI_INSTRFRAME_ADDREN_Msk | QSPI_INSTRFRAME_ADDRLEN_24BITS
+                          | QSPI_INSTRFRAME_TFRTYPE_WRITEMEMORY, offset, NULL, s, n);
+        ok = qf_wait_ready();
+        s += n;
+        offset += n;
+        len -= n;
+    }
+    qf_map_on();
+    (void)xSemaphoreGive(qf_mutex);
+    return ok;
+}
@@ -0,0 +1,92 @@
+/* =============================================================================
+ * qflash.h  -  External QSPI NOR flash, memory mapped, with DMA bulk reads
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A quad-SPI NOR flash (W25Q / GD25Q / IS25LP style, 3-byte addresses, up
+ * to 16 MB) on the QSPI pins, peripheral H:
+ *
+ *   PA08..PA11  DATA0..3      PB10  SCK      PB11  CS
+ *
+ * Between commands the controller is left in serial-memory read mode with
+ * Fast Read Quad I/O (0xEB: address and data on four lines, one mode byte,
+ * four dummy clocks), so the whole chip reads as plain memory at
+ * QFLASH_BASE: any task, or any DMA channel, can read from
+ * QFlash_Map(offset) with no copy and no driver call. At 40 MHz SCK that
+ * is ~20 MB/s sequential, a few hundred ns more per random access. The
+ * CMCC caches instructions only here (startup_xc32.c), so data reads
+ * always see the chip.
+ *
+ * QFlash_Read() copies a run into RAM on a BULK-class DMA channel (dma_qos.h)
+ * while the caller sleeps, for data that is read many times at random.
+ *
+ * Erase and program switch the controller to command mode and back; while
+ * they run, mapped reads return garbage. They are for provisioning only:
+ * stop everything that streams from the chip first (Sound_StopAll(),
+ * Anim_Stop()). Calls are serialised by a mutex.
+ *
+ * The NeoPixel TCC backend (PA08), ACT_PWM_DRIVE (PA10) and the SD card
+ * (sdcard.h) need the same pins, so they cannot be built together with
+ * QFLASH_ENABLE.
+ * ============================================================================= */
+
+#ifndef QFLASH_H
+#define QFLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define QFLASH_ENABLE           0       /* 1 = a flash is fitted on the QSPI pins */
+#define QFLASH_BAUD_DIV         3u      /* SCK = 120 MHz / 3 = 40 MHz             */
+#define QFLASH_QE_SR2           1       /* quad enable: SR2 bit 1 (1) or SR1 bit 6 (0) */
+#define QFLASH_DMA_CHANNEL      6u      /* DMA_OTHER channel, dma_qos.h            */
+#define QFLASH_NOTIFY_INDEX     3u      /* 0: NeoPixel, 1: effects, 2: I2C        */
+#define QFLASH_TIMEOUT_MS       500u    /* one erase (4 KB sector: ~50 ms typ.)   */
+
+#define QFLASH_BASE             0x04000000u     /* QSPI_ADDR, 16 MB window        */
+#define QFLASH_SECTOR           4096u           /* erase unit                     */
+#define QFLASH_PAGE             256u            /* program unit                   */
+
+typedef struct
+{
+    uint8_t  jedec[3];                  /* manufacturer, type, capacity code */
+    uint32_t size;                      /* bytes, 0 = no chip answered       */
+} qflash_info_t;
+
+/**
+ * Set up the pins and QSPI, read the JEDEC ID, set the quad enable bit if
+ * needed and enter memory-mapped mode. Before the scheduler; false if no
+ * chip answered (every other call then fails, QFlash_Map() gives NULL).
+ */
+bool QFlash_Init(void);
+
+/** What QFlash_Init() found. */
+void QFlash_GetInfo(qflash_info_t *out);
+
+/**
+ * Readable pointer to `offset` in the mapped chip, or NULL if the chip is
+ * missing or the offset past its end. Valid for good (outside provisioning).
+ */
+const void *QFlash_Map(uint32_t offset);
+
+/**
+ * Copy `len` bytes from `offset` to `dst` by DMA; the calling task sleeps
+ * until it is done. Word beats when all three are 4-aligned, bytes
+ * otherwise. Any task; false if out of range or the DMA timed out.
+ */
+bool QFlash_Read(void *dst, uint32_t offset, uint32_t len);
+
+/**
+ * QFlash_Read() with the CRC-32 of the bytes copied, computed by the DMAC
+ * CRC engine during the copy (crc.h). Tasks only; false as QFlash_Read(),
+ * or if the engine is unusable.
+ */
+bool QFlash_ReadCrc(void *dst, uint32_t offset, uint32_t len, uint32_t *crc);
+
+/** Erase the 4 KB sectors covering [offset, offset + len). Provisioning only. */
+bool QFlash_Erase(uint32_t offset, uint32_t len);
+
+/** Program `len` bytes (erased area) at `offset`, page by page. Provisioning only. */
+bool QFlash_Program(uint32_t offset, const void *src, uint32_t len);
+
+#endif /* QFLASH_H */
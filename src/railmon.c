@@ -0,0 +1,250 @@
+/* =============================================================================
+ * railmon.c  -  Supply rails and ambient light on ADC0, scanned by the DMAC
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "railmon.h"
+#include "definitions.h"        /* ADC0_REGS, DMAC_REGS, PORT_REGS */
+#include "FreeRTOS.h"
+#include "timers.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "power.h"
+#include "actuator.h"
+#include "log.h"
+
+#if RAILMON_ENABLE && ACT_CUR_SENSE
+#error "RAILMON_ENABLE and ACT_CUR_SENSE both need ADC0 (motor_sense.c)"
+#endif
+#if RAILMON_DMA_SEQ < DMA_OTHER_FIRST || RAILMON_DMA_SEQ >= DMA_OTHER_FIRST + DMA_OTHER_COUNT || \
+    RAILMON_DMA_RES < DMA_OTHER_FIRST || RAILMON_DMA_RES >= DMA_OTHER_FIRST + DMA_OTHER_COUNT
+#error "RAILMON channels must be DMA_OTHER channels with a descriptor slot (dma_qos.h)"
+#endif
+_Static_assert(RAILMON_OVERSAMPLE >= 16u && RAILMON_OVERSAMPLE <= 1024u &&
+               (RAILMON_OVERSAMPLE & (RAILMON_OVERSAMPLE - 1u)) == 0u,
+               "RAILMON_OVERSAMPLE: 16 .. 1024, a power of two (16-bit result)");
+_Static_assert(RAILMON_LIGHT_DARK < RAILMON_LIGHT_BRIGHT, "RAILMON_LIGHT_DARK must be below RAILMON_LIGHT_BRIGHT");
+
+#define RM_SAMPLENUM        (31u - (uint32_t)__builtin_clz(RAILMON_OVERSAMPLE))
+#define RM_IN(ain)          (ADC_INPUTCTRL_MUXPOS(ain) | ADC_INPUTCTRL_MUXNEG_GND)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t rm_val[RAILMON_INPUTS];    /* RailMon_Read() */
+static volatile uint32_t rm_pct = 100u;
+static volatile uint32_t rm_scans, rm_late;
+
+#if RAILMON_ENABLE
+
+/* In railmon_input_t order; each word starts one conversion (DSEQCTRL.AUTOSTART) */
+static const uint32_t rm_seq[RAILMON_INPUTS] = { RM_IN(2u), RM_IN(3u), RM_IN(6u) };
+static const uint8_t  rm_shift[RAILMON_INPUTS] = { RAILMON_RAIL_SHIFT, RAILMON_RAIL_SHIFT, RAILMON_LIGHT_SHIFT };
+
+static uint16_t          rm_raw[RAILMON_INPUTS] DMA_RAM;  /* written by the DMAC */
+static uint32_t          rm_f[RAILMON_INPUTS];            /* codes x 16, low-passed */
+static uint32_t          rm_pct_told = 100u;
+static uint32_t          rm_budget_pct = 100u;
+static railmon_bright_fn rm_hook;
+static TimerHandle_t     rm_timer;
+static StaticTimer_t     rm_timer_buf;
+
+static inline void rm_sync(uint32_t mask)
+{
+    while ((ADC0_REGS->ADC_SYNCBUSY & mask) != 0u) {}
+}
+
+static bool rm_busy(uint32_t ch)
+{
+    return (DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u;
+}
+
+static uint32_t rm_mv(uint32_t f, uint32_t fs_mv)
+{
+    return (uint32_t)(((uint64_t)f * fs_mv) / (65536u * 16u));
+}
+
+/* AIMD on the LED budget: fast down while the rail sags, slow back */
+static void rm_budget(uint32_t mv)
+{
+    uint32_t pct = rm_budget_pct;
+
+    if (mv < RAILMON_ABSENT_MV) pct = 100u;
+    else if (mv < RAILMON_5V_SAG_MV)
+        pct = (pct > RAILMON_BUDGET_MIN_PCT + RAILMON_BUDGET_DOWN_PCT) ? pct - RAILMON_BUDGET_DOWN_PCT
+                                                                      : RAILMON_BUDGET_MIN_PCT;
+    else if (mv >= RAILMON_5V_SAG_MV + RAILMON_5V_HYST_MV && pct < 100u)
+        pct = (pct + RAILMON_BUDGET_UP_PCT < 100u) ? pct + RAILMON_BUDGET_UP_PCT : 100u;
+    if (pct == rm_budget_pct) return;
+
+    if (pct == RAILMON_BUDGET_MIN_PCT || pct == 100u)
+        LOG_INFO("railmon: LED budget %lu%%, 5 V at %lu mV", (unsigned long)pct, (unsigned long)mv);
+    rm_budget_pct = pct;
+    Power_SetBudget(POWER_BUDGET_MA * pct / 100u);
+}
+
+/* Light code -> RAILMON_DARK_PCT .. RAILMON_BRIGHT_PCT, told in steps */
+static void rm_bright(uint32_t code)
+{
+    uint32_t pct;
+
+    if (code <= RAILMON_LIGHT_DARK)        pct = RAILMON_DARK_PCT;
+    else if (code >= RAILMON_LIGHT_BRIGHT) pct = RAILMON_BRIGHT_PCT;
+    else
+        pct = RAILMON_DARK_PCT + (RAILMON_BRIGHT_PCT - RAILMON_DARK_PCT) * (code - RAILMON_LIGHT_DARK)
+                               / (RAILMON_LIGHT_BRIGHT - RAILMON_LIGHT_DARK);
+    rm_pct = pct;
+
+    uint32_t moved = (pct > rm_pct_told) ? pct - rm_pct_told : rm_pct_told - pct;
+    bool     end   = (pct == RAILMON_DARK_PCT || pct == RAILMON_BRIGHT_PCT);
+
+    if (moved == 0u || (moved < RAILMON_BRIGHT_STEP_PCT && !end)) return;
+    rm_pct_told = pct;
+    if (rm_hook != NULL) rm_hook(pct);
+}
+
+static void rm_start(void)
+{
+    DMAC_REGS->CHANNEL[RAILMON_DMA_RES].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    DMAC_REGS->CHANNEL[RAILMON_DMA_SEQ].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;    /* the first word starts it */
+}
+
+/* Timer task, once per scan: filter the last one, start the next */
+static void rm_scan(TimerHandle_t timer)
+{
+    (void)timer;
+    if (rm_busy(RAILMON_DMA_RES) || rm_busy(RAILMON_DMA_SEQ))
+    {
+        rm_late++;
+        return;
+    }
+    for (uint32_t i = 0; i < RAILMON_INPUTS; i++)
+    {
+        uint32_t x = (uint32_t)rm_raw[i] << 4;
+
+        if (rm_scans == 0u) rm_f[i] = x;
+        else rm_f[i] = (uint32_t)((int32_t)rm_f[i] + (((int32_t)x - (int32_t)rm_f[i]) >> rm_shift[i]));
+    }
+    rm_scans++;
+    rm_start();
+
+    rm_val[RAILMON_5V]    = rm_mv(rm_f[RAILMON_5V], RAILMON_5V_FS_MV);
+    rm_val[RAILMON_ACT]   = rm_mv(rm_f[RAILMON_ACT], RAILMON_ACT_FS_MV);
+    rm_val[RAILMON_LIGHT] = rm_mv(rm_f[RAILMON_LIGHT], 1000u);
+    rm_budget(rm_val[RAILMON_5V]);
+    rm_bright(rm_f[RAILMON_LIGHT] >> 4);
+}
+
+static void rm_pin(uint32_t group, uint32_t pin)
+{
+    port_group_registers_t *g = &PORT_REGS->GROUP[group];
+    uint8_t pmux = g->PORT_PMUX[pin >> 1];
+
+    /* Peripheral B (analog); the digital input buffer stays off */
+    pmux = ((pin & 1u) != 0u) ? (uint8_t)((pmux & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(1u))
+                              : (uint8_t)((pmux & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(1u));
+    g->PORT_PMUX[pin >> 1] = pmux;
+    g->PORT_PINCFG[pin]    = PORT_PINCFG_PMUXEN_Msk;
+}
+
+static void rm_adc_init(void)
+{
+    uint32_t sw0 = SW0_FUSES_REGS->FUSES_SW0_WORD_0;
+
+    /* ADC0 on GCLK3 (48 MHz) / 4 = 12 MHz, as in motor_sense.c */
+    MCLK_REGS->MCLK_APBDMASK |= MCLK_APBDMASK_ADC0_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[ADC0_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK3 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[ADC0_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    ADC0_REGS->ADC_CTRLA = ADC_CTRLA_SWRST_Msk;
+    rm_sync(ADC_SYNCBUSY_SWRST_Msk);
+
+    ADC0_REGS->ADC_CALIB =
+        ADC_CALIB_BIASCOMP((sw0 & FUSES_SW0_WORD_0_ADC0_BIASCOMP_Msk) >> FUSES_SW0_WORD_0_ADC0_BIASCOMP_Pos)
+      | ADC_CALIB_BIASR2R((sw0 & FUSES_SW0_WORD_0_ADC0_BIASR2R_Msk) >> FUSES_SW0_WORD_0_ADC0_BIASR2R_Pos)
+      | ADC_CALIB_BIASREFBUF((sw0 & FUSES_SW0_WORD_0_ADC0_BIASREFBUF_Msk) >> FUSES_SW0_WORD_0_ADC0_BIASREFBUF_Pos);
+
+    /* Accumulation past 16 samples is shifted to 16 bits by the ADC itself */
+    ADC0_REGS->ADC_CTRLA     = ADC_CTRLA_PRESCALER_DIV4;
+    ADC0_REGS->ADC_REFCTRL   = ADC_REFCTRL_REFSEL(ADC_REFCTRL_REFSEL_INTVCC1_Val);
+    ADC0_REGS->ADC_INPUTCTRL = rm_seq[0];
+    ADC0_REGS->ADC_AVGCTRL   = ADC_AVGCTRL_SAMPLENUM(RM_SAMPLENUM) | ADC_AVGCTRL_ADJRES(0u);
+    ADC0_REGS->ADC_SAMPCTRL  = ADC_SAMPCTRL_SAMPLEN(3u);
+    ADC0_REGS->ADC_CTRLB     = ADC_CTRLB_RESSEL_16BIT;
+    ADC0_REGS->ADC_DSEQCTRL  = ADC_DSEQCTRL_INPUTCTRL_Msk | ADC_DSEQCTRL_AUTOSTART_Msk;
+    rm_sync(ADC_SYNCBUSY_Msk);
+
+    rm_pin(1u, 8u);     /* PB08 AIN2 */
+    rm_pin(1u, 9u);     /* PB09 AIN3 */
+    rm_pin(0u, 6u);     /* PA06 AIN6 */
+
+    ADC0_REGS->ADC_CTRLA |= ADC_CTRLA_ENABLE_Msk;
+    rm_sync(ADC_SYNCBUSY_ENABLE_Msk);
+}
+
+/* Single blocks, no link: the scan timer enables both again */
+static void rm_dma_init(void)
+{
+    dmac_descriptor_registers_t *seq =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + RAILMON_DMA_SEQ;
+    dmac_descriptor_registers_t *res =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + RAILMON_DMA_RES;
+
+    seq->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_SRCINC_Msk;
+    seq->DMAC_BTCNT    = RAILMON_INPUTS;
+    seq->DMAC_SRCADDR  = (uint32_t)&rm_seq[RAILMON_INPUTS];         /* end address with SRCINC */
+    seq->DMAC_DSTADDR  = (uint32_t)&ADC0_REGS->ADC_DSEQDATA;
+    seq->DMAC_DESCADDR = 0u;
+
+    res->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_HWORD | DMAC_BTCTRL_DSTINC_Msk;
+    res->DMAC_BTCNT    = RAILMON_INPUTS;
+    res->DMAC_SRCADDR  = (uint32_t)&ADC0_REGS->ADC_RESULT;
+    res->DMAC_DSTADDR  = (uint32_t)&rm_raw[RAILMON_INPUTS];         /* end address with DSTINC */
+    res->DMAC_DESCADDR = 0u;
+
+    DMAC_REGS->CHANNEL[RAILMON_DMA_SEQ].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(ADC0_DMAC_ID_SEQ) | DMAC_CHCTRLA_TRIGACT_BURST;
+    DMAC_REGS->CHANNEL[RAILMON_DMA_RES].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(ADC0_DMAC_ID_RESRDY) | DMAC_CHCTRLA_TRIGACT_BURST;    /* one beat per result */
+    Dma_Assign((DMAC_CHANNEL)RAILMON_DMA_SEQ, DMA_CLASS_BULK);
+    Dma_Assign((DMAC_CHANNEL)RAILMON_DMA_RES, DMA_CLASS_BULK);
+}
+
+#endif /* RAILMON_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void RailMon_Init(railmon_bright_fn on_bright)
+{
+#if RAILMON_ENABLE
+    rm_hook = on_bright;
+    rm_adc_init();
+    rm_dma_init();
+    rm_start();
+
+    rm_timer = xTimerCreateStatic("RailMon", pdMS_TO_TICKS(RAILMON_SCAN_MS), pdTRUE, NULL,
+                                  rm_scan, &rm_timer_buf);
+    if (rm_timer != NULL) (void)xTimerStart(rm_timer, 0u);
+#else
+    (void)on_bright;
+#endif
+}
+
+uint32_t RailMon_Read(railmon_input_t in)
+{
+    return ((uint32_t)in < RAILMON_INPUTS) ? rm_val[in] : 0u;
+}
+
+uint32_t RailMon_BrightPct(void)
+{
+    return rm_pct;
+}
+
+uint32_t RailMon_Scans(void)
+{
+    return rm_scans;
+}
+
+uint32_t RailMon_Late(void)
+{
+    return rm_late;
+}
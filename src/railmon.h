@@ -0,0 +1,95 @@
+/* =============================================================================
+ * railmon.h  -  Supply rails and ambient light on ADC0, scanned by the DMAC
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Three analog inputs, each through a divider or a load resistor:
+ *
+ *   RAILMON_5V     PB08 (AIN2)  LED 5 V rail
+ *   RAILMON_ACT    PB09 (AIN3)  actuator supply (12-24 V)
+ *   RAILMON_LIGHT  PA06 (AIN6)  ambient photodiode, more light = higher
+ *
+ * A scan is three conversions of RAILMON_OVERSAMPLE results accumulated
+ * in hardware (16-bit codes against VDDANA). The ADC's DMA sequencing
+ * walks them: one DMA channel feeds each input's INPUTCTRL word to
+ * DSEQDATA, which starts its conversion, the other moves each result to
+ * RAM. The CPU's part is one software timer callback per scan, in the
+ * timer service task: a low-pass filter step on the last scan's codes and
+ * the restart of both channels.
+ *
+ * What the filtered values drive:
+ *
+ *   5 V rail   Power_SetBudget() (power.h): below RAILMON_5V_SAG_MV the LED
+ *              current budget drops by RAILMON_BUDGET_DOWN_PCT per scan,
+ *              down to RAILMON_BUDGET_MIN_PCT, and creeps back up by
+ *              RAILMON_BUDGET_UP_PCT per scan once the rail is
+ *              RAILMON_5V_HYST_MV above the sag. A weak supply settles on
+ *              what it can hold instead of browning out (brownout.h).
+ *   light      the brightness scale RailMon_BrightPct(),
+ *              RAILMON_DARK_PCT .. RAILMON_BRIGHT_PCT between the two light
+ *              codes; the hook given to RailMon_Init() runs when it moves
+ *              by RAILMON_BRIGHT_STEP_PCT, and main.c folds it into the
+ *              global brightness with the mode's.
+ *   actuator   read out only ("rail", telemetry)
+ *
+ * A rail reading below RAILMON_ABSENT_MV is a divider not fitted: the budget
+ * is left alone. ADC0 is also the motor current monitor's (motor_sense.h,
+ * ACT_CUR_SENSE); the two do not build together.
+ * ============================================================================= */
+
+#ifndef RAILMON_H
+#define RAILMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef RAILMON_ENABLE
+#define RAILMON_ENABLE          0       /* 1 = dividers and photodiode fitted   */
+#endif
+#define RAILMON_SCAN_MS         100u
+#define RAILMON_OVERSAMPLE      64u     /* 16 .. 1024, a power of two           */
+#define RAILMON_DMA_SEQ         13u     /* DMA_OTHER channels, dma_qos.h        */
+#define RAILMON_DMA_RES         14u
+#define RAILMON_RAIL_SHIFT      2u      /* filter: 1/4 per scan, ~0.4 s         */
+#define RAILMON_LIGHT_SHIFT     5u      /* 1/32 per scan, ~3 s: no shadow flick */
+
+#define RAILMON_5V_FS_MV        9900u   /* mV at full scale: 20k / 10k divider  */
+#define RAILMON_ACT_FS_MV       36300u  /* 100k / 10k divider                   */
+#define RAILMON_ABSENT_MV       1000u   /* below: input not fitted              */
+#define RAILMON_5V_SAG_MV       4650u
+#define RAILMON_5V_HYST_MV      100u
+#define RAILMON_BUDGET_DOWN_PCT 5u      /* of POWER_BUDGET_MA, per scan         */
+#define RAILMON_BUDGET_UP_PCT   1u
+#define RAILMON_BUDGET_MIN_PCT  25u
+
+#define RAILMON_LIGHT_DARK      2000u   /* code, and below: RAILMON_DARK_PCT    */
+#define RAILMON_LIGHT_BRIGHT    40000u  /* code, and above: RAILMON_BRIGHT_PCT  */
+#define RAILMON_DARK_PCT        40u
+#define RAILMON_BRIGHT_PCT      160u
+#define RAILMON_BRIGHT_STEP_PCT 5u
+
+typedef enum
+{
+    RAILMON_5V = 0,
+    RAILMON_ACT,
+    RAILMON_LIGHT,
+    RAILMON_INPUTS
+} railmon_input_t;
+
+/** The brightness scale moved, pct as RailMon_BrightPct(). Timer task; must not block. */
+typedef void (*railmon_bright_fn)(uint32_t pct);
+
+/** Set up ADC0, the two DMA channels and the scan timer. After Dma_Init(), before the scheduler. */
+void RailMon_Init(railmon_bright_fn on_bright);
+
+/** Filtered value: mV for the rails, 0 .. 1000 for the light. 0 before the first scan. Any task. */
+uint32_t RailMon_Read(railmon_input_t in);
+
+/** Ambient brightness scale in percent; 100 without RAILMON_ENABLE. Any task. */
+uint32_t RailMon_BrightPct(void);
+
+/** Scans filtered, and scans the DMAC had not finished when the next was due. Any task. */
+uint32_t RailMon_Scans(void);
+uint32_t RailMon_Late(void);
+
+#endif /* RAILMON_H */
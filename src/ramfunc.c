@@ -0,0 +1,128 @@
+/* =============================================================================
+ * ramfunc.c  -  Hot code run from SRAM: no flash wait states, no cache misses
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "ramfunc.h"
+
+/* .ramfunc in the linker script, copied by Reset_Handler */
+extern const uint8_t __ramfunc_start[];
+extern const uint8_t __ramfunc_end[];
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Ramfunc_InRam(const void *fn)
+{
+    const uint8_t *p = (const uint8_t *)((uintptr_t)fn & ~(uintptr_t)1u);   /* Thumb bit */
+
+    return p >= __ramfunc_start && p < __ramfunc_end;
+}
+
+uint32_t Ramfunc_Bytes(void)
+{
+    return (uint32_t)(__ramfunc_end - __ramfunc_start);
+}
+
+/* -- Benchmark --------------------------------------------------------------- */
+
+#if RAMFUNC_BENCH_ENABLE
+
+#include "definitions.h"        /* DWT, CMCC plib */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "effects.h"
+#include "neopixel.h"
+#include "fire.h"
+#include "particles.h"
+#include "timeline.h"
+#include "audio.h"
+#include "dmx.h"
+#include "cache.h"
+#include <stdio.h>
+
+typedef enum
+{
+    BENCH_WARM = 0,             /* second run, everything cached */
+    BENCH_COLD,                 /* cache invalidated just before */
+    BENCH_OFF,                  /* CMCC disabled: every fetch pays the wait states */
+    BENCH_STATES
+} bench_state_t;
+
+typedef struct
+{
+    const char      *name;
+    effect_pixel_fn  pixel;     /* NULL: one of the strip kernels below */
+    const void      *code;
+} bench_kernel_t;
+
+static const bench_kernel_t bench_kernel[] =
+{
+    { "green_purple", NeoPixel_GreenPurplePixel, (const void *)NeoPixel_GreenPurplePixel },
+    { "rainbow",      NeoPixel_RainbowPixel,     (const void *)NeoPixel_RainbowPixel     },
+    { "fire",         NeoPixel_FirePixel,        (const void *)NeoPixel_FirePixel        },
+    { "fire_sim",     Fire_Pixel,                (const void *)Fire_Pixel                },
+    { "particles",    Particles_Pixel,           (const void *)Particles_Pixel           },
+    { "timeline",     Timeline_Pixel,            (const void *)Timeline_Pixel            },
+    { "audio",        Audio_Pixel,               (const void *)Audio_Pixel               },
+    { "dmx",          Dmx_Pixel,                 (const void *)Dmx_Pixel                 },
+    { "scale_strip",  NULL,                      (const void *)Pix_ScaleStrip            },
+    { "encode",       NULL,                      (const void *)NeoPixel_WriteSpan        },
+};
+#define BENCH_KERNELS   (sizeof(bench_kernel) / sizeof(bench_kernel[0]))
+#define BENCH_SCALE     (BENCH_KERNELS - 2u)
+
+static pix_t bench_px[NUM_LEDS];
+
+/* In SRAM itself, so only the kernel's own fetches differ between the states */
+static uint32_t RAMFUNC bench_run(uint32_t k)
+{
+    uint32_t t = DWT->CYCCNT;
+
+    if (bench_kernel[k].pixel != NULL)
+    {
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+            bench_px[i] = bench_kernel[k].pixel(i, (uint8_t)i);
+    }
+    else if (k == BENCH_SCALE) Pix_ScaleStrip(bench_px, NUM_LEDS, 128u);
+    else                       NeoPixel_WriteSpan(0u, bench_px, NUM_LEDS);
+    return DWT->CYCCNT - t;
+}
+
+/* Fastest of RAMFUNC_BENCH_RUNS, interrupts masked so only the fetches vary */
+static uint32_t bench_time(uint32_t k, bench_state_t state)
+{
+    uint32_t best = UINT32_MAX;
+
+    for (uint32_t r = 0; r < RAMFUNC_BENCH_RUNS; r++)
+    {
+        uint32_t c;
+
+        taskENTER_CRITICAL();
+        if (state == BENCH_WARM) (void)bench_run(k);
+        if (state != BENCH_WARM) CMCC_InvalidateAll();              /* leaves it off */
+        if (state == BENCH_COLD) CMCC_REGS->CMCC_CTRL = CMCC_CTRL_CEN_Msk;
+        c = bench_run(k);
+        CMCC_REGS->CMCC_CTRL = CMCC_CTRL_CEN_Msk;
+        taskEXIT_CRITICAL();
+        if (c < best) best = c;
+    }
+    return best;
+}
+
+void Ramfunc_Benchmark(void)
+{
+    printf("ramfunc,kernel,where,leds,warm,cold,nocache\n");
+    NeoPixel_RampPrepare(NUM_LEDS);
+    for (uint32_t k = 0; k < BENCH_KERNELS; k++)
+    {
+        uint32_t c[BENCH_STATES];
+
+        for (uint32_t s = 0; s < BENCH_STATES; s++) c[s] = bench_time(k, (bench_state_t)s);
+        printf("ramfunc,%s,%s,%u,%lu,%lu,%lu\n", bench_kernel[k].name,
+               Ramfunc_InRam(bench_kernel[k].code) ? "ram" : "flash", (unsigned)NUM_LEDS,
+               (unsigned long)c[BENCH_WARM], (unsigned long)c[BENCH_COLD], (unsigned long)c[BENCH_OFF]);
+    }
+    if (Cache_LockedWays() != 0u) Cache_Init();         /* the invalidations dropped the lock */
+}
+
+#endif /* RAMFUNC_BENCH_ENABLE */
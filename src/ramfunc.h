@@ -0,0 +1,63 @@
+/* =============================================================================
+ * ramfunc.h  -  Hot code run from SRAM: no flash wait states, no cache misses
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * At 120 MHz the flash needs wait states, which only the CMCC hides; a
+ * miss (cold code, or lines evicted by a QSPI asset read) costs each
+ * fetch several cycles, so the same code takes a different time from one
+ * call to the next. Code in SRAM runs at zero wait states every time.
+ *
+ * The .ramfunc output section (ATSAME51J20A.ld) is linked for SRAM and
+ * stored in flash; Reset_Handler copies it before the C runtime starts,
+ * so it is callable from main() on. It holds:
+ *
+ *   always     the DMAC channel 0 vector, DMAC_0_Handler (dma_qos.c),
+ *              and the plib's DMAC_0_InterruptHandler behind it (the
+ *              NeoPixel / stdio DMA completions), and the context switch,
+ *              xPortPendSVHandler and vTaskSwitchContext. These are picked up by their input
+ *              section names (-ffunction-sections), so the Harmony and
+ *              FreeRTOS sources stay untouched.
+ *   RAMFUNC    whatever is tagged with it.
+ *   hot path   with RAMFUNC_HOT_PATH, every CACHE_HOT function (cache.h):
+ *              the WS2812 encoder, the compositor and the per-pixel
+ *              kernels. The cache lock then has nothing left to hold.
+ *
+ * Calls between SRAM (0x20000000) and flash are out of BL range; the
+ * linker inserts a veneer for each, a few cycles. A RAM function is best
+ * a loop that does not call out. Ramfunc_Benchmark() times every kernel
+ * with the cache warm, cold and off; build once with RAMFUNC_HOT_PATH = 0
+ * and once with 1 and compare the two CSVs.
+ * ============================================================================= */
+
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef RAMFUNC_HOT_PATH
+#define RAMFUNC_HOT_PATH        1       /* CACHE_HOT functions into SRAM */
+#endif
+#define RAMFUNC_BENCH_ENABLE    0       /* 1 = time the kernels at boot, CSV on the console */
+#define RAMFUNC_BENCH_RUNS      16u     /* per kernel and cache state; the minimum is kept */
+
+/* Link into SRAM; long_call reaches it from flash where the declaration carries it */
+#define RAMFUNC                 __attribute__((section(".ramfunc"), long_call))
+
+/** True if `fn` runs from SRAM. */
+bool Ramfunc_InRam(const void *fn);
+
+/** Bytes of code in SRAM. */
+uint32_t Ramfunc_Bytes(void);
+
+#if RAMFUNC_BENCH_ENABLE
+/**
+ * Cycles per strip of every pixel kernel, Pix_ScaleStrip() and the encoder
+ * in each cache state, as "ramfunc,..." CSV lines on stdout. From the render
+ * task, before its first frame; leaves the strip buffer dirty.
+ */
+void Ramfunc_Benchmark(void);
+#endif
+
+#endif /* RAMFUNC_H */
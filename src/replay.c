@@ -0,0 +1,308 @@
+/* =============================================================================
+ * replay.c  -  Record the show's inputs and random draws, and play them back
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "replay.h"
+
+#if REPLAY_ENABLE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "hrtimer.h"
+#include "showclock.h"
+#include "rng.h"
+#include "dsun_sensor.h"
+#include "knob.h"
+
+#define RP_SEEDS            4u              /* xoshiro128** words */
+
+_Static_assert(sizeof(replay_rec_t) == 12u, "replay_rec_t: the dump format is 12 bytes");
+_Static_assert(REPLAY_RECORDS > RP_SEEDS + 1u, "REPLAY_RECORDS: room for the seed and END");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static replay_rec_t     rp_rec[REPLAY_RECORDS];
+static uint32_t         rp_n;
+static volatile uint8_t rp_mode = REPLAY_IDLE;
+static uint32_t         rp_t0;              /* show time the recording or playback started */
+static bool             rp_full;
+static uint32_t         rp_feed;            /* playing: the next input to feed   */
+static uint32_t         rp_mix;             /* ...the next MIX                    */
+static uint32_t         rp_dec;             /* ...the next decision to check      */
+static uint32_t         rp_fed;
+static uint32_t         rp_matched;
+static uint32_t         rp_diverged;
+static uint32_t         rp_diverged_ms;
+static hrtimer_t        rp_timer;
+static bool             rp_ready;
+
+static bool rp_is_input(uint8_t kind)
+{
+    return kind == REPLAY_EDGE || kind == REPLAY_KNOB || kind == REPLAY_END;
+}
+
+static bool rp_is_decision(uint8_t kind)
+{
+    return kind >= REPLAY_HOLD && kind <= REPLAY_POOL;
+}
+
+/* Show time `t` as an offset into the run; an edge stamped just before it is at 0 */
+static uint32_t rp_since(uint32_t t)
+{
+    int32_t d = (int32_t)(t - rp_t0);
+
+    return (d < 0) ? 0u : (uint32_t)d;
+}
+
+/* Masked. The END slot is always kept, and taken once the rest is full */
+static void rp_append(uint8_t kind, uint8_t arg, uint32_t at, uint32_t value)
+{
+    if (rp_n >= REPLAY_RECORDS - 1u && kind != REPLAY_END)
+    {
+        rp_full = true;
+        kind    = REPLAY_END;
+        arg     = 0u;
+        value   = 0u;
+    }
+    rp_rec[rp_n].at       = at;
+    rp_rec[rp_n].value    = value;
+    rp_rec[rp_n].kind     = kind;
+    rp_rec[rp_n].arg      = arg;
+    rp_rec[rp_n].reserved = 0u;
+    rp_n++;
+    if (kind == REPLAY_END) rp_mode = REPLAY_IDLE;
+}
+
+static bool rp_complete(void)
+{
+    if (rp_n < RP_SEEDS + 1u || rp_rec[rp_n - 1u].kind != REPLAY_END) return false;
+    for (uint32_t k = 0; k < RP_SEEDS; k++)
+        if (rp_rec[k].kind != REPLAY_SEED || rp_rec[k].arg != k) return false;
+    return true;
+}
+
+/*
+ * Masked, playing: arm the timer for the next input. Never sooner than
+ * HRTIMER_MIN_US, so the handler of the last one injected (pended at the
+ * show clock's own priority) runs before the next overwrites it.
+ */
+static void rp_arm(void)
+{
+    while (rp_feed < rp_n && !rp_is_input(rp_rec[rp_feed].kind)) rp_feed++;
+    if (rp_feed == rp_n)
+    {
+        rp_mode = REPLAY_IDLE;
+        return;
+    }
+
+    uint32_t due  = rp_t0 + rp_rec[rp_feed].at;
+    uint32_t soon = ShowClock_Now() + HRTIMER_MIN_US;
+
+    if ((int32_t)(due - soon) < 0) due = soon;
+    HrTimer_StartAt(&rp_timer, due, 0u);
+}
+
+/* Show clock ISR: the input due, then the next */
+static void rp_feed_one(hrtimer_t *t, void *arg)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    (void)t;
+    (void)arg;
+    if (rp_mode == REPLAY_PLAYING && rp_feed < rp_n)
+    {
+        const replay_rec_t *r = &rp_rec[rp_feed++];
+
+        switch (r->kind)
+        {
+            case REPLAY_EDGE:
+                dsun_inject_edge(r->value != 0u);
+                rp_fed++;
+                break;
+            case REPLAY_KNOB:
+                Knob_Inject((int32_t)r->value);
+                rp_fed++;
+                break;
+            default:                                /* END: the TRNG and the room again */
+                rp_mode = REPLAY_IDLE;
+                break;
+        }
+        if (rp_mode == REPLAY_PLAYING) rp_arm();
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Replay_Record(void)
+{
+    uint32_t seed[RP_SEEDS];
+
+    Replay_Stop();
+
+    taskENTER_CRITICAL();
+    rp_n    = 0u;
+    rp_full = false;
+    rp_t0   = ShowClock_Now();
+    Rng_Checkpoint(seed);
+    for (uint32_t k = 0; k < RP_SEEDS; k++)
+        rp_append(REPLAY_SEED, (uint8_t)k, 0u, seed[k]);
+    rp_mode = REPLAY_RECORDING;
+    taskEXIT_CRITICAL();
+}
+
+void Replay_Stop(void)
+{
+    if (rp_ready) (void)HrTimer_Stop(&rp_timer);
+
+    taskENTER_CRITICAL();
+    if (rp_mode == REPLAY_RECORDING) rp_append(REPLAY_END, 0u, rp_since(ShowClock_Now()), 0u);
+    rp_mode = REPLAY_IDLE;
+    taskEXIT_CRITICAL();
+}
+
+bool Replay_Play(void)
+{
+    uint32_t seed[RP_SEEDS];
+
+    if (!rp_ready)
+    {
+        HrTimer_Create(&rp_timer, rp_feed_one, NULL, HRTIMER_ISR);
+        rp_ready = true;
+    }
+    (void)HrTimer_Stop(&rp_timer);
+
+    taskENTER_CRITICAL();
+    if (rp_mode == REPLAY_RECORDING || !rp_complete())
+    {
+        taskEXIT_CRITICAL();
+        return false;
+    }
+    for (uint32_t k = 0; k < RP_SEEDS; k++)
+        seed[k] = rp_rec[k].value;
+    Rng_Restore(seed);
+    rp_feed        = RP_SEEDS;
+    rp_mix         = RP_SEEDS;
+    rp_dec         = RP_SEEDS;
+    rp_fed         = 0u;
+    rp_matched     = 0u;
+    rp_diverged    = 0u;
+    rp_diverged_ms = 0u;
+    rp_t0          = ShowClock_Now();
+    rp_mode        = REPLAY_PLAYING;
+    rp_arm();
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+void Replay_Clear(void)
+{
+    Replay_Stop();
+
+    taskENTER_CRITICAL();
+    rp_n    = 0u;
+    rp_full = false;
+    taskEXIT_CRITICAL();
+}
+
+bool Replay_Put(const replay_rec_t *r)
+{
+    bool ok;
+
+    if (r->kind < REPLAY_SEED || r->kind >= REPLAY_KINDS) return false;
+
+    taskENTER_CRITICAL();
+    ok = rp_mode == REPLAY_IDLE && rp_n < REPLAY_RECORDS;
+    if (ok)
+    {
+        rp_rec[rp_n]          = *r;
+        rp_rec[rp_n].reserved = 0u;
+        rp_n++;
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+bool Replay_Get(uint32_t index, replay_rec_t *out)
+{
+    bool ok;
+
+    taskENTER_CRITICAL();
+    ok = index < rp_n;
+    if (ok) *out = rp_rec[index];
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+void Replay_GetStatus(replay_status_t *out)
+{
+    taskENTER_CRITICAL();
+    out->mode        = rp_mode;
+    out->records     = rp_n;
+    out->full        = rp_full;
+    out->span_ms     = (rp_mode == REPLAY_RECORDING) ? rp_since(ShowClock_Now()) / 1000u
+                     : rp_complete() ? rp_rec[rp_n - 1u].at / 1000u : 0u;
+    out->fed         = rp_fed;
+    out->matched     = rp_matched;
+    out->diverged    = rp_diverged;
+    out->diverged_ms = rp_diverged_ms;
+    taskEXIT_CRITICAL();
+}
+
+bool Replay_Playing(void)
+{
+    return rp_mode == REPLAY_PLAYING;
+}
+
+void Replay_Input(replay_kind_t kind, uint8_t arg, uint32_t t, uint32_t value)
+{
+    UBaseType_t mask;
+
+    if (rp_mode != REPLAY_RECORDING) return;
+
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    if (rp_mode == REPLAY_RECORDING) rp_append((uint8_t)kind, arg, rp_since(t), value);
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void Replay_Decide(replay_kind_t kind, uint8_t arg, uint32_t value)
+{
+    uint32_t now = ShowClock_Now();
+
+    if (rp_mode == REPLAY_IDLE) return;
+
+    taskENTER_CRITICAL();
+    if (rp_mode == REPLAY_RECORDING)
+    {
+        rp_append((uint8_t)kind, arg, rp_since(now), value);
+    }
+    else if (rp_mode == REPLAY_PLAYING)
+    {
+        while (rp_dec < rp_n && !rp_is_decision(rp_rec[rp_dec].kind)) rp_dec++;
+
+        const replay_rec_t *r = (rp_dec < rp_n) ? &rp_rec[rp_dec++] : NULL;
+
+        if (r != NULL && r->kind == (uint8_t)kind && r->arg == arg && r->value == value)
+            rp_matched++;
+        else if (rp_diverged++ == 0u)
+            rp_diverged_ms = rp_since(now) / 1000u;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void Replay_RngMix(uint32_t draw, uint32_t entropy)
+{
+    if (rp_mode == REPLAY_RECORDING) rp_append(REPLAY_MIX, 0u, draw, entropy);
+}
+
+bool Replay_RngDue(uint32_t draw, uint32_t *entropy)
+{
+    while (rp_mix < rp_n && rp_rec[rp_mix].kind != REPLAY_MIX) rp_mix++;
+    if (rp_mix == rp_n || rp_rec[rp_mix].at > draw) return false;
+
+    *entropy = rp_rec[rp_mix++].value;
+    return true;
+}
+
+#endif /* REPLAY_ENABLE */
@@ -0,0 +1,163 @@
+/* =============================================================================
+ * replay.h  -  Record the show's inputs and random draws, and play them back
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * What the show does next depends on two things from outside the code:
+ * the TRNG, through rng.h (the actuator's pauses, hold times and pool
+ * picks), and the visitors, through the sensor edges and the operator's
+ * knob. A stutter seen once in the field gets nowhere on the bench if the
+ * dice and the room cannot be made to do the same again. A recording
+ * keeps both, compactly, in REPLAY_RECORDS records of 12 bytes:
+ *
+ *   SEED    the four xoshiro128** words when the recording started
+ *   MIX     a TRNG word the generator took in; `at` is the draw it went
+ *           in at, counted from the seed
+ *   EDGE    a presence edge (value: the level) at `at` microseconds in
+ *   KNOB    a knob delta, in detents
+ *   HOLD, PACE, HURRY, POOL
+ *           what the actuator drew from it (value; arg: the channel):
+ *           a step's hold, the pause, a pause redrawn for a fuller
+ *           room, the pick from the scare pool
+ *   END     where the recording stopped
+ *
+ * The seed and the mixes are all the generator ever takes, so they fix
+ * every draw after them; the decisions are there to check that they did.
+ * Playback restarts the generator from the seed, mixes the recorded words
+ * in at their draws instead of the TRNG's, and feeds the inputs back at
+ * their times from the show clock (hrtimer.h): the edges through
+ * dsun_inject_edge(), so the EIC handler, the event bus and the actuator
+ * take them exactly as real ones, and the knob deltas through
+ * Knob_Inject(). Real edges and turns are dropped meanwhile, and each
+ * decision drawn is compared with the recorded one: "diverged" says the
+ * run went another way (the tasks met in another order), and from when.
+ * At END the TRNG and the sensor take over again.
+ *
+ * The state the show is in when the recording starts (an actuator
+ * sequence under way, the effect chosen) is not part of it: record from a
+ * quiet point, the show just started or the actuator parked, and play
+ * from the same point. A slow frame then comes back on cue, as often as
+ * needed, with the profiler (profile.h) or the trace recorder on.
+ *
+ * "replay rec" records and "replay stop" ends it; a full ring ends it
+ * itself, as a recording with holes in it would not play back. "replay
+ * play" plays it back and "replay" prints where it stands. "replay dump"
+ * prints the recording as "replay put" lines after a "replay clear":
+ * pasted into another unit's console they load it there. "replay list"
+ * prints it as text.
+ *
+ * Recording costs a few dozen cycles per MIX, input or decision, in the
+ * context that makes it; nothing is written per draw. With REPLAY_ENABLE
+ * = 0 the hooks expand to nothing and the module is not built.
+ * ============================================================================= */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef REPLAY_ENABLE
+#define REPLAY_ENABLE           1       /* 1 = build record / replay in        */
+#endif
+#define REPLAY_RECORDS          512u    /* ring, 12 bytes each                 */
+
+typedef enum
+{
+    REPLAY_IDLE = 0,
+    REPLAY_RECORDING,
+    REPLAY_PLAYING
+} replay_mode_t;
+
+typedef enum
+{
+    REPLAY_SEED = 1,
+    REPLAY_MIX,
+    REPLAY_EDGE,
+    REPLAY_KNOB,
+    REPLAY_HOLD,
+    REPLAY_PACE,
+    REPLAY_HURRY,
+    REPLAY_POOL,
+    REPLAY_END,
+    REPLAY_KINDS
+} replay_kind_t;
+
+typedef struct
+{
+    uint32_t at;                /* us since the start; MIX: the draw       */
+    uint32_t value;
+    uint8_t  kind;              /* replay_kind_t                           */
+    uint8_t  arg;               /* SEED: the word; decisions: the channel  */
+    uint16_t reserved;
+} replay_rec_t;
+
+typedef struct
+{
+    uint8_t  mode;              /* replay_mode_t                            */
+    uint32_t records;
+    bool     full;              /* the ring filled and ended the recording  */
+    uint32_t span_ms;           /* recorded so far, or the recording's END  */
+    uint32_t fed;               /* inputs played back                       */
+    uint32_t matched;           /* decisions drawn as recorded              */
+    uint32_t diverged;          /* ...and not                               */
+    uint32_t diverged_ms;       /* into the playback at the first           */
+} replay_status_t;
+
+#if REPLAY_ENABLE
+
+#define REPLAY_INPUT(kind, arg, t, value)   Replay_Input((kind), (arg), (t), (value))
+#define REPLAY_DECIDE(kind, arg, value)     Replay_Decide((kind), (arg), (value))
+#define REPLAY_PLAYING()                    Replay_Playing()
+#define REPLAY_RNG_MIX(draw, e)             Replay_RngMix((draw), (e))
+#define REPLAY_RNG_DUE(draw, e)             Replay_RngDue((draw), (e))
+
+/**
+ * Start a recording: the ring is cleared and the generator's state taken
+ * as the seed. Ends a playback first. Any task.
+ */
+void Replay_Record(void);
+
+/** End the recording (appending END) or the playback. Any task. */
+void Replay_Stop(void);
+
+/**
+ * Play the recording back from now, as "replay rec" started it. False
+ * without a complete one (SEED to END) or while recording. Any task.
+ */
+bool Replay_Play(void);
+
+/** Drop the recording, to load another with Replay_Put(). Any task. */
+void Replay_Clear(void);
+
+/** Append `r` to the recording while idle; false if full or not idle. Any task. */
+bool Replay_Put(const replay_rec_t *r);
+
+/** Record `index` of the recording into `out`; false past its end. Any task. */
+bool Replay_Get(uint32_t index, replay_rec_t *out);
+
+void Replay_GetStatus(replay_status_t *out);
+
+/** A playback is running: live inputs are to be dropped. Any context. */
+bool Replay_Playing(void);
+
+/* Hooks. An input at show time `t`: any task or ISR at or below the syscall ceiling */
+void Replay_Input(replay_kind_t kind, uint8_t arg, uint32_t t, uint32_t value);
+/* A decision drawn from rng.h: recorded, or checked in a playback. Tasks */
+void Replay_Decide(replay_kind_t kind, uint8_t arg, uint32_t value);
+/* rng.c, in its critical section: `entropy` taken in at draw `draw` */
+void Replay_RngMix(uint32_t draw, uint32_t entropy);
+/* rng.c, playing: true with the word recorded for draw `draw` */
+bool Replay_RngDue(uint32_t draw, uint32_t *entropy);
+
+#else
+
+#define REPLAY_INPUT(kind, arg, t, value)   ((void)0)
+#define REPLAY_DECIDE(kind, arg, value)     ((void)0)
+#define REPLAY_PLAYING()                    (false)
+#define REPLAY_RNG_MIX(draw, e)             ((void)0)
+#define REPLAY_RNG_DUE(draw, e)             ((void)(e), false)
+
+#endif /* REPLAY_ENABLE */
+
+#endif /* REPLAY_H */
@@ -0,0 +1,168 @@
+/* =============================================================================
+ * resume.c  -  Warm resume: the show picks up where a watchdog, fault or brown-out reset cut it
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "resume.h"
+#include "definitions.h"        /* RSTC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "fault.h"
+#include "brownout.h"
+#include "log.h"
+#include <stddef.h>
+#include <string.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t     magic;
+    uint32_t     tick;                          /* of the last write          */
+    uint32_t     frames;                        /* shown since the cold boot  */
+    uint32_t     chain;                         /* warm resumes since then    */
+    uint8_t      effect[EFFECTS_MAX_SEGMENTS];  /* or RESUME_NONE             */
+    uint8_t      offset[EFFECTS_MAX_SEGMENTS];
+    resume_lid_t lid;
+    uint32_t     sum;
+} rs_record_t;
+
+_Static_assert(offsetof(rs_record_t, sum) % 4u == 0u, "rs_sum() folds whole words");
+
+/* Backup RAM, NOLOAD like the fault record: survives the reset, not a power loss */
+static rs_record_t  rs_rec __attribute__((section(".bkupram_noinit")));
+
+static bool         rs_warm;
+static resume_lid_t rs_lid;                     /* the snapshot's, moved to this boot */
+
+static uint32_t rs_sum(const rs_record_t *r)
+{
+    const uint32_t *w = (const uint32_t *)r;
+    uint32_t        s = RESUME_MAGIC;
+
+    for (uint32_t i = 0; i < offsetof(rs_record_t, sum) / 4u; i++)
+        s = ((s << 5) | (s >> 27)) ^ w[i];
+    return s;
+}
+
+/* With the record's fields just written: seal it. Inside the critical section */
+static void rs_seal(void)
+{
+    rs_rec.tick  = xTaskGetTickCount();
+    rs_rec.magic = RESUME_MAGIC;
+    rs_rec.sum   = rs_sum(&rs_rec);
+}
+
+static void rs_cold(void)
+{
+    memset(&rs_rec, 0, sizeof(rs_rec));
+    memset(rs_rec.effect, RESUME_NONE, sizeof(rs_rec.effect));
+    rs_rec.lid.patt = RESUME_NONE;
+    rs_seal();
+}
+
+/* A reset the show did not ask for */
+static bool rs_warm_reset(void)
+{
+    uint32_t cause = RSTC_REGS->RSTC_RCAUSE;
+
+    return (cause & (RSTC_RCAUSE_WDT_Msk | RSTC_RCAUSE_BODVDD_Msk | RSTC_RCAUSE_BODCORE_Msk)) != 0u
+        || Fault_Last() != NULL || Brownout_WasReset();
+}
+
+/* The snapshot's ticks, from the last write, onto this boot's tick 0 */
+static void rs_rebase(resume_lid_t *l, uint32_t t)
+{
+    if (l->due != 0u)
+    {
+        int32_t left = (int32_t)(l->due - t);
+
+        l->due = (left > 0) ? (uint32_t)left : 1u;      /* overdue: at once */
+    }
+    for (uint32_t i = 0; i < ACT_PACE_BUSY_ARRIVALS; i++)
+        l->pace_arr[i] -= t;                            /* before tick 0 */
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Resume_Init(void)
+{
+#if RESUME_ENABLE
+    if (!rs_warm_reset() || rs_rec.magic != RESUME_MAGIC || rs_rec.sum != rs_sum(&rs_rec))
+    {
+        rs_cold();
+        return false;
+    }
+    if (rs_rec.chain >= RESUME_MAX_CHAIN)
+    {
+        LOG_WARN("resume: %lu warm resets in a row, starting cold", (unsigned long)rs_rec.chain + 1u);
+        rs_cold();
+        return false;
+    }
+
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS; k++)
+    {
+        if (rs_rec.effect[k] >= EFFECT_COUNT) continue;
+        (void)Effects_SetPhase(k, (effect_id_t)rs_rec.effect[k], rs_rec.offset[k]);
+    }
+    rs_rebase(&rs_rec.lid, rs_rec.tick);
+    rs_lid = rs_rec.lid;
+    rs_rec.chain++;
+    rs_seal();                                          /* still good if this boot dies early */
+    rs_warm = true;
+
+    LOG_INFO("resume: warm, '%s' from frame %lu, resume %lu of %u",
+             Effects_Name((effect_id_t)rs_rec.effect[0]), (unsigned long)rs_rec.frames, (unsigned long)rs_rec.chain, RESUME_MAX_CHAIN);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Resume_Warm(void)
+{
+    return rs_warm;
+}
+
+const resume_lid_t *Resume_Lid(void)
+{
+    return rs_warm ? &rs_lid : NULL;
+}
+
+void Resume_SaveFrame(void)
+{
+#if RESUME_ENABLE
+    uint8_t effect[EFFECTS_MAX_SEGMENTS];
+    uint8_t offset[EFFECTS_MAX_SEGMENTS];
+
+    for (uint8_t k = 0; k < EFFECTS_MAX_SEGMENTS; k++)
+    {
+        effect_id_t id;
+
+        effect[k] = RESUME_NONE;
+        offset[k] = 0u;
+        if (Effects_GetPhase(k, &id, &offset[k])) effect[k] = (uint8_t)id;
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(rs_rec.effect, effect, sizeof(effect));
+    memcpy(rs_rec.offset, offset, sizeof(offset));
+    rs_rec.frames++;
+    if (rs_rec.chain != 0u && xTaskGetTickCount() >= pdMS_TO_TICKS(RESUME_STABLE_MS))
+        rs_rec.chain = 0u;                              /* it held: the next reset may resume */
+    rs_seal();
+    taskEXIT_CRITICAL();
+#endif
+}
+
+void Resume_SaveLid(const resume_lid_t *lid)
+{
+#if RESUME_ENABLE
+    taskENTER_CRITICAL();
+    memcpy(&rs_rec.lid, lid, sizeof(rs_rec.lid));
+    rs_seal();
+    taskEXIT_CRITICAL();
+#else
+    (void)lid;
+#endif
+}
@@ -0,0 +1,90 @@
+/* =============================================================================
+ * resume.h  -  Warm resume: the show picks up where a watchdog, fault or brown-out reset cut it
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A reset the prop did not ask for (the watchdog, a fault record, a
+ * brown-out) used to start the show over: the default effect from phase
+ * 0, and the lid's ACT_BOOT_DELAY_MS before its first scare, as after a
+ * power-up. A visitor standing in front of it saw the lights jump and the
+ * lid go quiet for fifteen seconds.
+ *
+ * A snapshot of the show therefore lives in backup RAM (.bkupram_noinit,
+ * NOLOAD like the fault record and brownout_mark), checksummed:
+ *
+ *   effects    every segment's effect and animation phase, and the frames
+ *              shown since the cold boot; the render task, every frame
+ *   lid        the pattern playing and its step, or the tick the pause
+ *              before the next one ends, and the pacing history (the
+ *              recent arrivals and the average dwell); the actuator, on
+ *              each change, in the timer task
+ *
+ * Both writers fill the record and its sum under one critical section,
+ * a few dozen words. Resume_Init() after Effects_Init() takes it if the
+ * reset is one of the warm kinds and the sum holds: the segments restart
+ * on their effects at their phases, so the first frame after the reset
+ * carries straight on from the last one before it, and Actuator_Start()
+ * arms the lid with what was left of its pause instead of the boot delay.
+ * A pattern cut mid-way is not replayed from its step: the relays dropped
+ * at the reset and the lid with them, so the lid waits its cooldown and
+ * goes on with the next one. Every other reset (power-up, the reset pin,
+ * "reboot", a firmware update) starts cold.
+ *
+ * A state that crashes the show would crash it again: after
+ * RESUME_MAX_CHAIN warm resumes without RESUME_STABLE_MS of show between
+ * them the next boot is cold.
+ * ============================================================================= */
+
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "effects.h"            /* EFFECTS_MAX_SEGMENTS */
+#include "actuator.h"           /* ACT_PACE_BUSY_ARRIVALS */
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef RESUME_ENABLE
+#define RESUME_ENABLE           1
+#endif
+#define RESUME_MAX_CHAIN        3u      /* warm resumes in a row, then a cold boot */
+#define RESUME_STABLE_MS        60000u  /* of show that clears the chain           */
+
+#define RESUME_MAGIC            0x4D535552u     /* "RUSM" */
+#define RESUME_NONE             0xFFu           /* no effect on a segment, no pattern */
+#define RESUME_OTHER            0xFEu           /* a pattern from a caller's table */
+
+/** The lid's part of the snapshot; ticks of the boot that wrote it. */
+typedef struct
+{
+    uint32_t due;               /* tick the pause before the next pattern ends, 0 = none */
+    uint32_t pace_dwell;        /* the pacing history (actuator.c act_pace_*) */
+    uint32_t pace_arr[ACT_PACE_BUSY_ARRIVALS];
+    uint8_t  pace_head;
+    uint8_t  pace_n;
+    uint8_t  patt;              /* Actuator_Pattern() index playing, RESUME_OTHER, RESUME_NONE */
+    uint8_t  pc;                /* and its step */
+} resume_lid_t;
+
+/**
+ * Take the snapshot if this is a warm reset and it checks out, and restart
+ * the effect segments from it. After Fault_Init() and Effects_Init(),
+ * before Brownout_Init() and the scheduler. True if the show resumes.
+ */
+bool Resume_Init(void);
+
+/** True if this boot resumed the show. */
+bool Resume_Warm(void);
+
+/**
+ * The lid's snapshot, its ticks moved to this boot: `due` counts from
+ * tick 0, arrivals lie before it. NULL after a cold boot. Actuator_Start().
+ */
+const resume_lid_t *Resume_Lid(void);
+
+/** Record the effects after a rendered frame. Render task. */
+void Resume_SaveFrame(void);
+
+/** Record the lid's state. Timer task (the actuator). */
+void Resume_SaveLid(const resume_lid_t *lid);
+
+#endif /* RESUME_H */
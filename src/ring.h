@@ -0,0 +1,250 @@
+/* =============================================================================
+ * ring.h  -  Bounded lock-free rings between ISRs and tasks, header only
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A FreeRTOS queue costs a critical section and a list check per item
+ * (rtosbench.h "queue"); a byte-wide stream buffer much the same per call.
+ * A ring of fixed-size slots between one consumer and its producers needs
+ * neither: the head and tail are free-running indices, each written by one
+ * side only, and a DMB orders the slot against the index that publishes it.
+ *
+ *   RING_STATIC(ev_ring, sizeof(ev_t), 32u);       storage and the ring
+ *
+ *   producer                            consumer
+ *   Ring_Put(&ev_ring, &e);             while (Ring_Get(&ev_ring, &e)) ...
+ *
+ * The slot count is a power of two; nothing blocks. A full ring refuses
+ * the item (false) and counts it in `dropped`. A consumer that sleeps is
+ * woken by whatever its producers already use (a task notification).
+ *
+ *   single producer   Ring_Put(), or Ring_Reserve() / Ring_Commit() to
+ *                     write in place: a run of contiguous free slots up to
+ *                     the end of the buffer, committed at once (the USART
+ *                     or USB TX path fills it straight from the formatter)
+ *   multi producer    Ring_PutMP(), or Ring_ClaimMP() / Ring_PublishMP()
+ *                     in place: any mix of tasks and ISRs, with LDREX /
+ *                     STREX. A claim takes the next slot (`wr` counts the
+ *                     claims and the writers still in flight), and the
+ *                     last writer out publishes every slot claimed so far,
+ *                     so a writer interrupted mid-slot holds the others'
+ *                     slots back until it is done, but never loses them.
+ *                     No masking, no spinning on another writer; up to
+ *                     RING_WR_BUSY writers mid-slot at once.
+ *   consumer          one context: Ring_Get(), or Ring_Peek() /
+ *                     Ring_Release() to read in place, a contiguous run
+ *
+ * A ring is either single or multi producer for its whole life: the two
+ * publish the head differently. Indices wrap at RING_INDEX_MASK + 1, so a
+ * ring holds up to RING_SLOTS_MAX slots. The data cache is off (cache.h),
+ * so a ring may also feed the DMAC, given a DMA_RAM buffer (dmaram.h).
+ *
+ * rtosbench.h ("rtbench") times each against xQueueSend() and stream
+ * buffers.
+ * ============================================================================= */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "definitions.h"        /* core_cm4.h: __LDREXW, __STREXW, __CLREX, __DMB */
+
+#define RING_INDEX_MASK         0x00FFFFFFu     /* indices are 24 bits: `wr` packs one */
+#define RING_SLOTS_MAX          (1u << 23)
+#define RING_WR_SHIFT           8u              /* wr = claim << 8 | writers in flight */
+#define RING_WR_BUSY            0xFFu
+
+typedef struct
+{
+    volatile uint32_t head;     /* slots before it are readable; the producer(s) */
+    volatile uint32_t tail;     /* slots before it are free; the consumer */
+    volatile uint32_t wr;       /* multi producer: next claim and writers in flight */
+    volatile uint32_t dropped;  /* items refused, ring full */
+    uint32_t          slots;    /* a power of two */
+    uint32_t          size;     /* bytes per slot */
+    uint8_t          *buf;
+} ring_t;
+
+/** Word-aligned storage and a static ring `name` of `n` slots of `bytes`. */
+#define RING_STATIC(name, bytes, n)                                                       \
+    _Static_assert(((n) & ((n) - 1u)) == 0u && (n) != 0u && (n) <= RING_SLOTS_MAX,         \
+                   #name ": a power of two of slots");                                    \
+    static uint32_t name##_buf[((bytes) * (n) + 3u) / 4u];                                \
+    static ring_t   name = { 0u, 0u, 0u, 0u, (n), (bytes), (uint8_t *)name##_buf }
+
+/** Set up `r` over `buf` (`n` slots of `bytes`). False unless `n` is a power of two. */
+static inline bool Ring_Init(ring_t *r, void *buf, uint32_t bytes, uint32_t n)
+{
+    if (n == 0u || (n & (n - 1u)) != 0u || n > RING_SLOTS_MAX) return false;
+    r->head = r->tail = r->wr = r->dropped = 0u;
+    r->slots = n;
+    r->size  = bytes;
+    r->buf   = (uint8_t *)buf;
+    return true;
+}
+
+static inline uint8_t *ring_slot(const ring_t *r, uint32_t i)
+{
+    return r->buf + (i & (r->slots - 1u)) * r->size;
+}
+
+static inline uint32_t ring_min(uint32_t a, uint32_t b)
+{
+    return (a < b) ? a : b;
+}
+
+/** Slots readable now. Any context. */
+static inline uint32_t Ring_Count(const ring_t *r)
+{
+    return (r->head - r->tail) & RING_INDEX_MASK;
+}
+
+static inline bool Ring_Empty(const ring_t *r)
+{
+    return r->head == r->tail;
+}
+
+/* -- Single producer --------------------------------------------------------- */
+
+/**
+ * Up to the next `*n` free slots, contiguous, to write in place; NULL when
+ * full (`*n` 0). Hand back the count written to Ring_Commit().
+ */
+static inline void *Ring_Reserve(ring_t *r, uint32_t *n)
+{
+    uint32_t h    = r->head;
+    uint32_t room = r->slots - ((h - r->tail) & RING_INDEX_MASK);
+
+    *n = ring_min(room, r->slots - (h & (r->slots - 1u)));
+    return (*n != 0u) ? ring_slot(r, h) : NULL;
+}
+
+/** Publish `n` slots written since Ring_Reserve(). */
+static inline void Ring_Commit(ring_t *r, uint32_t n)
+{
+    __DMB();                            /* the slots before the head */
+    r->head = (r->head + n) & RING_INDEX_MASK;
+}
+
+/** Copy one item in; false, counted, when full. */
+static inline bool Ring_Put(ring_t *r, const void *item)
+{
+    uint32_t n;
+    void    *p = Ring_Reserve(r, &n);
+
+    if (p == NULL)
+    {
+        r->dropped++;
+        return false;
+    }
+    memcpy(p, item, r->size);
+    Ring_Commit(r, 1u);
+    return true;
+}
+
+/* -- Multi producer ---------------------------------------------------------- */
+
+static inline void ring_atomic_inc(volatile uint32_t *v)
+{
+    uint32_t n;
+
+    do {
+        n = __LDREXW(v) + 1u;
+    } while (__STREXW(n, v) != 0u);
+}
+
+/**
+ * Claim the next slot to write in place; NULL, counted, when full. Every
+ * claim is followed by one Ring_PublishMP() from the same context, soon:
+ * the items claimed after it wait for it. Any task or ISR.
+ */
+static inline void *Ring_ClaimMP(ring_t *r)
+{
+    uint32_t w, c;
+
+    do {
+        w = __LDREXW(&r->wr);
+        c = w >> RING_WR_SHIFT;
+        if (((c - r->tail) & RING_INDEX_MASK) >= r->slots)
+        {
+            __CLREX();
+            ring_atomic_inc(&r->dropped);
+            return NULL;
+        }
+    } while (__STREXW((((c + 1u) & RING_INDEX_MASK) << RING_WR_SHIFT) | ((w & RING_WR_BUSY) + 1u),
+                      &r->wr) != 0u);
+    return ring_slot(r, c);
+}
+
+/**
+ * Done with the claimed slot. The last writer in flight moves the head up
+ * to every claim so far; a nested writer may have moved it further
+ * meanwhile, so it only ever moves forward.
+ */
+static inline void Ring_PublishMP(ring_t *r)
+{
+    uint32_t w, h, c;
+
+    __DMB();                            /* the slot before the head */
+    do {
+        w = __LDREXW(&r->wr) - 1u;
+    } while (__STREXW(w, &r->wr) != 0u);
+    if ((w & RING_WR_BUSY) != 0u) return;
+
+    c = w >> RING_WR_SHIFT;
+    do {
+        h = __LDREXW(&r->head);
+        if (((c - h) & RING_INDEX_MASK) > r->slots)
+        {
+            __CLREX();                  /* already past c */
+            return;
+        }
+    } while (__STREXW(c, &r->head) != 0u);
+}
+
+/** Copy one item in; false, counted, when full. Any task or ISR. */
+static inline bool Ring_PutMP(ring_t *r, const void *item)
+{
+    void *p = Ring_ClaimMP(r);
+
+    if (p == NULL) return false;
+    memcpy(p, item, r->size);
+    Ring_PublishMP(r);
+    return true;
+}
+
+/* -- Consumer ---------------------------------------------------------------- */
+
+/** Up to the next `*n` readable slots, contiguous, in place; NULL when empty. */
+static inline const void *Ring_Peek(ring_t *r, uint32_t *n)
+{
+    uint32_t t = r->tail;
+
+    *n = ring_min((r->head - t) & RING_INDEX_MASK, r->slots - (t & (r->slots - 1u)));
+    if (*n == 0u) return NULL;
+    __DMB();                            /* the slots after the head */
+    return ring_slot(r, t);
+}
+
+/** Free `n` slots read since Ring_Peek(). */
+static inline void Ring_Release(ring_t *r, uint32_t n)
+{
+    __DMB();                            /* done reading before the slots are reused */
+    r->tail = (r->tail + n) & RING_INDEX_MASK;
+}
+
+/** Copy the oldest item out; false when empty. */
+static inline bool Ring_Get(ring_t *r, void *item)
+{
+    uint32_t    n;
+    const void *p = Ring_Peek(r, &n);
+
+    if (p == NULL) return false;
+    memcpy(item, p, r->size);
+    Ring_Release(r, 1u);
+    return true;
+}
+
+#endif /* RING_H */
@@ -0,0 +1,170 @@
+/* =============================================================================
+ * rng.c  -  Shared pseudo-random service seeded from the TRNG
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "rng.h"
+#include "definitions.h"        /* TRNG_ReadData(), TRNG_REGS, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "irqprio.h"
+#include "irqstat.h"
+#include "replay.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t rng_s[4] = { 1u, 2u, 3u, 4u };     /* never all zero */
+static uint32_t rng_draws = 0u;
+static uint32_t rng_count = 0u;                    /* since Rng_Checkpoint(), for replay.h */
+static volatile uint32_t rng_entropy = 0u;          /* from TRNG_Handler() */
+static volatile bool     rng_fresh   = false;
+
+static inline uint32_t rotl(uint32_t x, uint32_t k)
+{
+    return (x << k) | (x >> (32u - k));
+}
+
+/* xoshiro128** step (Blackman & Vigna); caller holds the critical section */
+static inline uint32_t rng_step(void)
+{
+    uint32_t r = rotl(rng_s[1] * 5u, 7u) * 9u;
+    uint32_t t = rng_s[1] << 9;
+
+    rng_s[2] ^= rng_s[0];
+    rng_s[3] ^= rng_s[1];
+    rng_s[1] ^= rng_s[2];
+    rng_s[0] ^= rng_s[3];
+    rng_s[2] ^= t;
+    rng_s[3]  = rotl(rng_s[3], 11u);
+    return r;
+}
+
+/* One TRNG word into the state; caller holds the critical section */
+static inline void rng_mix(uint32_t e)
+{
+    rng_s[0] ^= e;
+    rng_s[1] |= 1u;                                 /* keeps the state non-zero */
+}
+
+/* Start one background TRNG conversion; TRNG_Handler() collects it */
+static inline void rng_request_entropy(void)
+{
+    TRNG_REGS->TRNG_INTENSET = TRNG_INTENSET_DATARDY_Msk;
+    TRNG_REGS->TRNG_CTRLA   |= TRNG_CTRLA_ENABLE_Msk;
+}
+
+void TRNG_Handler(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_TRNG);
+    rng_entropy = TRNG_REGS->TRNG_DATA;             /* clears DATARDY */
+    rng_fresh   = true;
+    TRNG_REGS->TRNG_INTENCLR = TRNG_INTENCLR_DATARDY_Msk;
+    TRNG_REGS->TRNG_CTRLA   &= ~TRNG_CTRLA_ENABLE_Msk;
+    IRQSTAT_EXIT(IRQSTAT_TRNG);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Rng_Init(void)
+{
+    for (uint8_t k = 0; k < 4u; k++)
+        rng_s[k] = TRNG_ReadData();
+    if ((rng_s[0] | rng_s[1] | rng_s[2] | rng_s[3]) == 0u)
+        rng_s[0] = 1u;                              /* xoshiro would stick at zero */
+
+    NVIC_SetPriority(TRNG_IRQn, IRQ_PRIO_TRNG);
+    NVIC_EnableIRQ(TRNG_IRQn);
+}
+
+uint32_t Rng_Next32(void)
+{
+    uint32_t r;
+    uint32_t e;
+
+    taskENTER_CRITICAL();
+    if (rng_fresh)
+    {
+        rng_fresh = false;
+        if (!REPLAY_PLAYING())
+        {
+            rng_mix(rng_entropy);
+            REPLAY_RNG_MIX(rng_count, rng_entropy);
+        }
+    }
+    if (REPLAY_PLAYING() && REPLAY_RNG_DUE(rng_count, &e))
+        rng_mix(e);                                 /* the recorded word at its draw */
+    rng_count++;
+    r = rng_step();
+    if (++rng_draws >= RNG_RESEED_DRAWS)
+    {
+        rng_draws = 0u;
+        rng_request_entropy();
+    }
+    taskEXIT_CRITICAL();
+    return r;
+}
+
+uint32_t Rng_Range(uint32_t min, uint32_t max)
+{
+    uint32_t span = max - min + 1u;                 /* 0 = the full 32-bit range */
+
+    if (max < min) return min;
+    if (span == 0u) return Rng_Next32();
+
+    /* Lemire: Rng_Map() plus rejection of the few low products that bias */
+    uint64_t m = (uint64_t)Rng_Next32() * span;
+
+    if ((uint32_t)m < span)
+    {
+        uint32_t floor = (0u - span) % span;
+
+        while ((uint32_t)m < floor)
+            m = (uint64_t)Rng_Next32() * span;
+    }
+    return min + (uint32_t)(m >> 32);
+}
+
+uint8_t Rng_Weighted(const uint16_t *weights, uint8_t n)
+{
+    uint32_t total = 0u;
+    uint8_t  pick  = 0u;
+
+    for (uint8_t i = 0; i < n; i++)
+        total += weights[i];
+    if (total == 0u)
+        return 0u;
+
+    /* Walk the whole table so the cost does not depend on the draw */
+    uint32_t r = Rng_Map(Rng_Next32(), 0u, total - 1u);
+    uint32_t acc = 0u;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        acc += weights[i];
+        pick += (uint8_t)(r >= acc);
+    }
+    return pick;
+}
+
+void Rng_Checkpoint(uint32_t s[4])
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    for (uint8_t k = 0; k < 4u; k++)
+        s[k] = rng_s[k];
+    rng_count = 0u;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void Rng_Restore(const uint32_t s[4])
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    for (uint8_t k = 0; k < 4u; k++)
+        rng_s[k] = s[k];
+    if ((rng_s[0] | rng_s[1] | rng_s[2] | rng_s[3]) == 0u)
+        rng_s[0] = 1u;
+    rng_count = 0u;
+    rng_fresh = false;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
@@ -0,0 +1,67 @@
+/* =============================================================================
+ * rng.h  -  Shared pseudo-random service seeded from the TRNG
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * One xoshiro128** generator for every task: a draw costs a few dozen
+ * cycles instead of a blocking TRNG conversion, and the state update sits
+ * in a short critical section so concurrent callers never tear it.
+ *
+ * Rng_Init() seeds the 128-bit state from four TRNG words. Every
+ * RNG_RESEED_DRAWS draws the TRNG is started in the background; its
+ * data-ready interrupt hands over one fresh word, which the next draw
+ * mixes into the state. No caller ever waits on the TRNG after boot.
+ *
+ * Hot per-LED loops (fire.c) keep their own local xorshift stream and only
+ * seed it from here.
+ *
+ * The state and the TRNG words mixed into it decide every draw, so
+ * replay.h records just those: Rng_Checkpoint() at the start, then each
+ * word with the draw it went in at. In a playback the recorded words go in
+ * at the same draws and the TRNG's are dropped.
+ * ============================================================================= */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define RNG_RESEED_DRAWS    1024u       /* draws between TRNG entropy top-ups */
+
+/** Seed from the TRNG and enable its interrupt. Call before the scheduler starts. */
+void Rng_Init(void);
+
+/** Next 32 random bits. Any task; not from ISRs. */
+uint32_t Rng_Next32(void);
+
+/** Uniform in [min, max] inclusive, without modulo bias. Any task. */
+uint32_t Rng_Range(uint32_t min, uint32_t max);
+
+/**
+ * Map 32 random bits `r` onto [min, max] inclusive in constant time (one
+ * 32x32->64 multiply, keep the high word). The bias is below
+ * (max - min + 1) / 2^32, i.e. under 1e-5 for spans up to ~40000.
+ */
+static inline uint32_t Rng_Map(uint32_t r, uint32_t min, uint32_t max)
+{
+    uint32_t span = max - min + 1u;             /* 0 = the full 32-bit range */
+
+    if (max < min) return min;
+    if (span == 0u) return r;
+    return min + (uint32_t)(((uint64_t)r * span) >> 32);
+}
+
+/**
+ * Index in [0, n) picked with probability weights[i] / sum(weights), in
+ * constant time for a given n. Zero weights are never picked; if all are
+ * zero (or n is 0) the result is 0. Any task.
+ */
+uint8_t Rng_Weighted(const uint16_t *weights, uint8_t n);
+
+/** Copy the state into `s` and count the draws from zero again (replay.h). Any task or ISR. */
+void Rng_Checkpoint(uint32_t s[4]);
+
+/** Carry on from a Rng_Checkpoint() state, draws from zero, TRNG word pending dropped. Same contexts. */
+void Rng_Restore(const uint32_t s[4]);
+
+#endif /* RNG_H */
@@ -0,0 +1,83 @@
+/* =============================================================================
+ * rtos_trace.c  -  Scheduler / ISR / queue / DMA event recorder in RAM
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "rtos_trace.h"
+
+#if RTOS_TRACE_ENABLE
+
+#include "definitions.h"        /* core_cm4.h: DWT, PRIMASK; CPU_CLOCK_FREQUENCY */
+#include <string.h>
+
+#if (RTOS_TRACE_EVENTS & (RTOS_TRACE_EVENTS - 1u)) != 0u
+#error "RTOS_TRACE_EVENTS must be a power of two"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Not static: the debugger dumps it by name */
+rtos_trace_t rtos_trace;
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void RtosTrace_Init(void)
+{
+    memset(&rtos_trace, 0, sizeof(rtos_trace));
+    rtos_trace.magic    = RTOS_TRACE_MAGIC;
+    rtos_trace.cpu_hz   = CPU_CLOCK_FREQUENCY;
+    rtos_trace.capacity = RTOS_TRACE_EVENTS;
+    rtos_trace.enabled  = 1u;
+}
+
+void RtosTrace_Enable(uint32_t on)
+{
+    rtos_trace.enabled = (on != 0u) ? 1u : 0u;
+}
+
+void RtosTrace_Event(uint32_t type, uint32_t arg)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (rtos_trace.enabled != 0u)
+    {
+        uint32_t h = rtos_trace.head;
+
+        if (RTOS_TRACE_ONESHOT && h >= RTOS_TRACE_EVENTS)
+        {
+            rtos_trace.enabled = 0u;
+        }
+        else
+        {
+            rtos_trace_ev_t *e = &rtos_trace.ev[h & (RTOS_TRACE_EVENTS - 1u)];
+
+            e->cycles = DWT->CYCCNT;
+            e->word   = (type << 24) | (arg & 0x00FFFFFFu);
+            rtos_trace.head = h + 1u;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+void RtosTrace_TaskCreate(const void *tcb, const char *name)
+{
+    uint32_t t = RTOS_TRACE_PTR(tcb);
+
+    for (uint32_t i = 0; i < RTOS_TRACE_TASKS; i++)
+    {
+        rtos_trace_task_t *k = &rtos_trace.tasks[i];
+
+        if (k->tcb == 0u || k->tcb == t)
+        {
+            /* A TCB reused after vTaskDelete() gets the new name */
+            strncpy(k->name, name, sizeof(k->name) - 1u);
+            k->name[sizeof(k->name) - 1u] = '\0';
+            k->tcb = t;
+            break;
+        }
+    }
+    RtosTrace_Event(RTOS_TRACE_CREATE, t);
+}
+
+#endif /* RTOS_TRACE_ENABLE */
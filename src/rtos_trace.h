@@ -0,0 +1,118 @@
+/* =============================================================================
+ * rtos_trace.h  -  Scheduler / ISR / queue / DMA event recorder in RAM
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * With RTOS_TRACE_ENABLE = 1 the FreeRTOS trace hooks (FreeRTOSConfig.h)
+ * and a few macros in our own ISRs write 8-byte events into the
+ * rtos_trace ring: a DWT cycle stamp and one word of type + argument.
+ * Recorded:
+ *
+ *   task switch-in (TCB)       task create (TCB, name into the task table)
+ *   ISR enter / exit (IRQ)     queue / semaphore send, receive, send failed
+ *   DMAC callbacks (channel, complete / error)
+ *
+ * Each event costs a few stores with interrupts masked for them; the ring
+ * keeps the latest RTOS_TRACE_EVENTS events (or stops when full, with
+ * RTOS_TRACE_ONESHOT), so a starved task shows up as a gap in its
+ * switch-ins next to whoever held the CPU.
+ *
+ * Getting it out, either way:
+ *   - debugger:  "dump binary value trace.bin rtos_trace" (gdb), or any
+ *     memory read of &rtos_trace, sizeof(rtos_trace)
+ *   - console:   the CLI "trace" command stops the recorder and prints
+ *     the area as hex lines
+ * tools/rtos_trace2json.py turns either into Chrome trace JSON for
+ * Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Stamps are DWT->CYCCNT (Metrics_Init() starts it), 120 MHz, 32 bits;
+ * the converter unwraps them, which holds while events are less than
+ * ~35 s apart (the tick and the Coop task make sure of that).
+ * ============================================================================= */
+
+#ifndef RTOS_TRACE_H
+#define RTOS_TRACE_H
+
+#include <stdint.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef RTOS_TRACE_ENABLE
+#define RTOS_TRACE_ENABLE   0
+#endif
+#define RTOS_TRACE_EVENTS   1024u       /* 8 bytes each, power of two           */
+#define RTOS_TRACE_TASKS    16u         /* names kept for the converter         */
+#define RTOS_TRACE_ONESHOT  0           /* 1 = stop when full instead of wrap   */
+
+#define RTOS_TRACE_MAGIC    0x43525452u /* "RTRC" */
+
+typedef enum
+{
+    RTOS_TRACE_SWITCH = 1,      /* arg: TCB - RAM base      */
+    RTOS_TRACE_CREATE,          /* arg: TCB - RAM base      */
+    RTOS_TRACE_ISR_IN,          /* arg: exception number    */
+    RTOS_TRACE_ISR_OUT,         /* arg: exception number    */
+    RTOS_TRACE_Q_SEND,          /* arg: queue - RAM base    */
+    RTOS_TRACE_Q_RECV,
+    RTOS_TRACE_Q_FAIL,          /* send with the queue full */
+    RTOS_TRACE_DMA              /* arg: channel | event << 8 */
+} rtos_trace_type_t;
+
+typedef struct
+{
+    uint32_t cycles;
+    uint32_t word;              /* type << 24 | 24-bit argument */
+} rtos_trace_ev_t;
+
+typedef struct
+{
+    uint32_t tcb;               /* 0 = free */
+    char     name[16];
+} rtos_trace_task_t;
+
+/* The whole area, read as one block by the debugger or the CLI */
+typedef struct
+{
+    uint32_t          magic;
+    uint32_t          cpu_hz;
+    uint32_t          capacity;
+    volatile uint32_t head;             /* events written since start (wraps) */
+    volatile uint32_t enabled;
+    rtos_trace_task_t tasks[RTOS_TRACE_TASKS];
+    rtos_trace_ev_t   ev[RTOS_TRACE_EVENTS];
+} rtos_trace_t;
+
+/* Pointer argument: offset from the SRAM base, fits the 24 bits */
+#define RTOS_TRACE_RAM              0x20000000u
+#define RTOS_TRACE_PTR(p)           ((uint32_t)(uintptr_t)(p) - RTOS_TRACE_RAM)
+
+#if RTOS_TRACE_ENABLE
+
+extern rtos_trace_t rtos_trace;
+
+/** Clear the ring and start recording. Before the scheduler. */
+void RtosTrace_Init(void);
+
+/** Stop / restart recording (the ring is kept). Any task or ISR. */
+void RtosTrace_Enable(uint32_t on);
+
+/** One event; use the macros. Any context. */
+void RtosTrace_Event(uint32_t type, uint32_t arg);
+
+/** Task create hook: remembers the name for the converter. */
+void RtosTrace_TaskCreate(const void *tcb, const char *name);
+
+/** Exception number of the running ISR, for RTOS_TRACE_ISR_*(). */
+#define RTOS_TRACE_IPSR()           ({ uint32_t r_; __asm volatile ("mrs %0, ipsr" : "=r" (r_)); r_; })
+
+#define RTOS_TRACE_ISR_ENTER()      RtosTrace_Event(RTOS_TRACE_ISR_IN,  RTOS_TRACE_IPSR())
+#define RTOS_TRACE_ISR_EXIT()       RtosTrace_Event(RTOS_TRACE_ISR_OUT, RTOS_TRACE_IPSR())
+#define RTOS_TRACE_DMA_EVENT(ch, e) RtosTrace_Event(RTOS_TRACE_DMA, (uint32_t)(ch) | ((uint32_t)(e) << 8))
+
+#else
+
+#define RTOS_TRACE_ISR_ENTER()      ((void)0)
+#define RTOS_TRACE_ISR_EXIT()       ((void)0)
+#define RTOS_TRACE_DMA_EVENT(ch, e) ((void)0)
+
+#endif /* RTOS_TRACE_ENABLE */
+
+#endif /* RTOS_TRACE_H */
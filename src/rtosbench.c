@@ -0,0 +1,409 @@
+/* =============================================================================
+ * rtosbench.c  -  What the FreeRTOS primitives cost on this board, in cycles
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "rtosbench.h"
+
+#if RTOSBENCH_ENABLE
+
+#include "definitions.h"        /* core_cm4.h: DWT, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "stream_buffer.h"
+#include "cpufreq.h"
+#include "irqprio.h"
+#include "ring.h"
+#include "lz.h"
+#include "adpcm.h"
+#include <string.h>
+
+#define RB_NOW()            (DWT->CYCCNT)
+#define RB_TOP              (configMAX_PRIORITIES - 1u)
+#define RB_STACK            (configMINIMAL_STACK_SIZE * 2u)
+#define RB_SB_BYTES         (2u * RTOSBENCH_SB_CHUNK)
+
+/* The "lz block" input: sequences of 12 literals and a 20-byte match 12
+ * back, 32 bytes out for 16 in, then 32 literals to close the block */
+#define RB_LZ_SEQ           ((RTOSBENCH_LZ_BYTES - RB_LZ_TAIL) / 32u)
+#define RB_LZ_TAIL          32u
+#define RB_LZ_DATA          (RB_LZ_SEQ * 16u + 2u + RB_LZ_TAIL)
+#define RB_LZ_IN            (LZ_FILE_HEADER + LZ_BLOCK_HEADER + RB_LZ_DATA)
+
+_Static_assert(RB_LZ_SEQ * 32u + RB_LZ_TAIL == RTOSBENCH_LZ_BYTES, "RTOSBENCH_LZ_BYTES: whole sequences");
+
+typedef enum
+{
+    RB_IDLE = 0,
+    RB_WAKE,                    /* record each wake into rb_row         */
+    RB_YIELD,                   /* ping-pong taskYIELD() with the caller */
+    RB_QUEUE,                   /* record each item until a 0           */
+    RB_STREAM                   /* drain RTOSBENCH_ROUNDS chunks        */
+} rb_mode_t;
+
+typedef struct
+{
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} rb_acc_t;
+
+static const char * const rb_name[RTOSBENCH_ROWS] =
+{
+    [RTOSBENCH_CRITICAL]   = "critical",
+    [RTOSBENCH_ISR_MASK]   = "isr mask",
+    [RTOSBENCH_YIELD]      = "yield",
+    [RTOSBENCH_NOTIFY]     = "notify",
+    [RTOSBENCH_ISR_ENTRY]  = "isr entry",
+    [RTOSBENCH_ISR_WAKE]   = "isr wake",
+    [RTOSBENCH_QUEUE]      = "queue",
+    [RTOSBENCH_QUEUE_WAKE] = "queue wake",
+    [RTOSBENCH_STREAM]     = "stream",
+    [RTOSBENCH_SB_SOLO]    = "sb chunk",
+    [RTOSBENCH_RING]       = "ring",
+    [RTOSBENCH_RING_MP]    = "ring mp",
+    [RTOSBENCH_RING_CHUNK] = "ring chunk",
+    [RTOSBENCH_LZ_BLOCK]   = "lz block",
+    [RTOSBENCH_ADPCM_BLOCK] = "adpcm",
+};
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static rb_acc_t             rb_acc[RTOSBENCH_ROWS];
+static uint32_t             rb_zero;                /* two back-to-back stamps */
+static volatile uint8_t     rb_mode;
+static volatile uint8_t     rb_row;
+static volatile uint32_t    rb_stamp;               /* set just before the wake */
+static volatile uint32_t    rb_pend;                /* set just before the NVIC pend */
+
+static TaskHandle_t         rb_task;
+static StackType_t          rb_stack[RB_STACK];
+static StaticTask_t         rb_tcb;
+static QueueHandle_t        rb_queue;
+static StaticQueue_t        rb_queue_buf;
+static uint8_t              rb_queue_store[4u * sizeof(uint32_t)];
+static StreamBufferHandle_t rb_sb;
+static StaticStreamBuffer_t rb_sb_buf;
+static uint8_t              rb_sb_store[RB_SB_BYTES + 1u];
+static uint8_t              rb_chunk[RTOSBENCH_SB_CHUNK];
+static uint8_t              rb_sink[RTOSBENCH_SB_CHUNK];
+static uint8_t              rb_lz_in[RB_LZ_IN];
+static uint8_t              rb_lz_out[RTOSBENCH_LZ_BYTES] __attribute__((aligned(4)));
+static uint8_t              rb_adpcm_in[ADPCM_BLOCK_BYTES];
+static int32_t              rb_adpcm_acc[ADPCM_BLOCK_SAMPLES];
+
+RING_STATIC(rb_ring,    sizeof(uint32_t), 4u);
+RING_STATIC(rb_ring_mp, sizeof(uint32_t), 4u);
+RING_STATIC(rb_ring_b,  1u, RB_SB_BYTES);
+
+static void rb_add(uint32_t row, uint32_t cycles)
+{
+    rb_acc_t *a = &rb_acc[row];
+
+    cycles = (cycles > rb_zero) ? cycles - rb_zero : 0u;
+    if (a->n == 0u || cycles < a->min) a->min = cycles;
+    if (cycles > a->max) a->max = cycles;
+    a->sum += cycles;
+    a->n++;
+}
+
+/* Unused vector: pended by the caller, wakes the helper */
+void FREQM_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    rb_add(RTOSBENCH_ISR_ENTRY, RB_NOW() - rb_pend);
+    rb_stamp = RB_NOW();
+    vTaskNotifyGiveFromISR(rb_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* The other end of every two-task row, at RB_TOP */
+static void rb_helper(void *arg)
+{
+    uint32_t v;
+    uint32_t got;
+
+    (void)arg;
+    for (;;)
+    {
+        (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        v = RB_NOW();
+        switch (rb_mode)
+        {
+        case RB_WAKE:
+            rb_add(rb_row, v - rb_stamp);
+            break;
+        case RB_YIELD:
+            while (rb_mode == RB_YIELD)
+            {
+                rb_stamp = RB_NOW();
+                taskYIELD();
+            }
+            break;
+        case RB_QUEUE:
+            while (xQueueReceive(rb_queue, &v, portMAX_DELAY) == pdPASS && v != 0u)
+                rb_add(RTOSBENCH_QUEUE_WAKE, RB_NOW() - rb_stamp);
+            break;
+        case RB_STREAM:
+            for (got = 0u; got < RTOSBENCH_ROUNDS * RTOSBENCH_SB_CHUNK; )
+                got += (uint32_t)xStreamBufferReceive(rb_sb, rb_sink, sizeof(rb_sink), portMAX_DELAY);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static bool rb_create(void)
+{
+    if (rb_task != NULL) return true;
+
+    rb_queue = xQueueCreateStatic(4u, sizeof(uint32_t), rb_queue_store, &rb_queue_buf);
+    rb_sb    = xStreamBufferCreateStatic(RB_SB_BYTES, 1u, rb_sb_store, &rb_sb_buf);
+    rb_task  = xTaskCreateStatic(rb_helper, "RtBench", RB_STACK, NULL, RB_TOP, rb_stack, &rb_tcb);
+
+    NVIC_SetPriority(FREQM_IRQn, IRQ_PRIO_RTOSBENCH);
+    NVIC_ClearPendingIRQ(FREQM_IRQn);
+    NVIC_EnableIRQ(FREQM_IRQn);
+    return rb_task != NULL && rb_queue != NULL && rb_sb != NULL;
+}
+
+/* A chunk into the byte ring in place and out again, wrapping as a stream would */
+static void rb_ring_chunk(void)
+{
+    uint32_t n, done;
+    uint8_t *w;
+
+    for (done = 0u; done < sizeof(rb_chunk); done += n)
+    {
+        w = Ring_Reserve(&rb_ring_b, &n);
+        n = ring_min(n, sizeof(rb_chunk) - done);
+        memcpy(w, &rb_chunk[done], n);
+        Ring_Commit(&rb_ring_b, n);
+    }
+    for (done = 0u; done < sizeof(rb_sink); done += n)
+    {
+        const uint8_t *p = Ring_Peek(&rb_ring_b, &n);
+
+        memcpy(&rb_sink[done], p, n);
+        Ring_Release(&rb_ring_b, n);
+    }
+}
+
+/* Write the "lz block" file: header, the block, the end marker left out */
+static void rb_lz_make(void)
+{
+    uint8_t *p = rb_lz_in;
+
+    *p++ = 'C'; *p++ = 'R'; *p++ = 'L'; *p++ = 'Z';
+    *p++ = LZ_VERSION; *p++ = 0u;
+    *p++ = (uint8_t)RTOSBENCH_LZ_BYTES; *p++ = (uint8_t)(RTOSBENCH_LZ_BYTES >> 8);
+    *p++ = (uint8_t)RTOSBENCH_LZ_BYTES; *p++ = (uint8_t)(RTOSBENCH_LZ_BYTES >> 8);
+    *p++ = (uint8_t)RB_LZ_DATA;         *p++ = (uint8_t)(RB_LZ_DATA >> 8);
+
+    for (uint32_t i = 0; i < RB_LZ_SEQ; i++)
+    {
+        *p++ = (12u << 4) | 15u;                    /* 12 literals, match 15 + 4 + ... */
+        for (uint32_t k = 0; k < 12u; k++) *p++ = (uint8_t)(i * 29u + k * 7u);
+        *p++ = 12u;                                 /* offset */
+        *p++ = 0u;
+        *p++ = 1u;                                  /* ... 1: 20 bytes */
+    }
+    *p++ = 15u << 4;                                /* the tail: 15 + 17 literals */
+    *p++ = RB_LZ_TAIL - 15u;
+    for (uint32_t k = 0; k < RB_LZ_TAIL; k++) *p++ = (uint8_t)k;
+}
+
+/* Decode the block, a tenth of the rounds: it is a few thousand times a ring put */
+static void rb_lz(void)
+{
+    lz_dec_t d;
+    uint32_t used, t0;
+
+    rb_lz_make();
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS / 10u; i++)
+    {
+        Lz_Init(&d, sizeof(rb_lz_out));
+        t0 = RB_NOW();
+        if (Lz_Decode(&d, rb_lz_in, sizeof(rb_lz_in), &used, rb_lz_out) != LZ_BLOCK) return;
+        rb_add(RTOSBENCH_LZ_BLOCK, RB_NOW() - t0);
+    }
+}
+
+/* Decode and mix an ADPCM block, a tenth of the rounds like "lz block". The
+ * nibbles are a scrambled mix of every code, so the step index wanders
+ * and the saturation gets its turn, as in real sound */
+static void rb_adpcm(void)
+{
+    adpcm_dec_t d;
+    uint32_t    t0, x = 0x2545F491u;
+
+    rb_adpcm_in[0] = 0u;
+    rb_adpcm_in[1] = 0u;
+    rb_adpcm_in[2] = 40u;                           /* index: mid-table */
+    rb_adpcm_in[3] = 0u;
+    for (uint32_t i = ADPCM_HEADER_BYTES; i < ADPCM_BLOCK_BYTES; i++)
+    {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        rb_adpcm_in[i] = (uint8_t)x;
+    }
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS / 10u; i++)
+    {
+        Adpcm_Start(&d);
+        t0 = RB_NOW();
+        Adpcm_Mix(&d, rb_adpcm_in, rb_adpcm_acc, ADPCM_BLOCK_SAMPLES, 256u);
+        rb_add(RTOSBENCH_ADPCM_BLOCK, RB_NOW() - t0);
+    }
+}
+
+/* Alone in the caller: stamp overhead, the critical sections, a queue, a
+ * stream buffer and the rings with nobody waiting */
+static void rb_solo(void)
+{
+    uint32_t    t0, v = 1u;
+    UBaseType_t m;
+
+    rb_zero = 0xFFFFFFFFu;
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS; i++)
+    {
+        t0 = RB_NOW();
+        v  = RB_NOW() - t0;
+        if (v < rb_zero) rb_zero = v;
+    }
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS; i++)
+    {
+        t0 = RB_NOW();
+        taskENTER_CRITICAL();
+        taskEXIT_CRITICAL();
+        rb_add(RTOSBENCH_CRITICAL, RB_NOW() - t0);
+
+        t0 = RB_NOW();
+        m  = taskENTER_CRITICAL_FROM_ISR();
+        taskEXIT_CRITICAL_FROM_ISR(m);
+        rb_add(RTOSBENCH_ISR_MASK, RB_NOW() - t0);
+
+        t0 = RB_NOW();
+        (void)xQueueSend(rb_queue, &v, 0);
+        (void)xQueueReceive(rb_queue, &v, 0);
+        rb_add(RTOSBENCH_QUEUE, RB_NOW() - t0);
+
+        t0 = RB_NOW();
+        (void)xStreamBufferSend(rb_sb, rb_chunk, sizeof(rb_chunk), 0);
+        (void)xStreamBufferReceive(rb_sb, rb_sink, sizeof(rb_sink), 0);
+        rb_add(RTOSBENCH_SB_SOLO, RB_NOW() - t0);
+
+        t0 = RB_NOW();
+        (void)Ring_Put(&rb_ring, &v);
+        (void)Ring_Get(&rb_ring, &v);
+        rb_add(RTOSBENCH_RING, RB_NOW() - t0);
+
+        t0 = RB_NOW();
+        (void)Ring_PutMP(&rb_ring_mp, &v);
+        (void)Ring_Get(&rb_ring_mp, &v);
+        rb_add(RTOSBENCH_RING_MP, RB_NOW() - t0);
+
+        t0 = RB_NOW();
+        rb_ring_chunk();
+        rb_add(RTOSBENCH_RING_CHUNK, RB_NOW() - t0);
+    }
+}
+
+/* Caller at RB_TOP with the helper: each resume after the helper's yield */
+static void rb_yield(void)
+{
+    vTaskPrioritySet(NULL, RB_TOP);
+    rb_mode = RB_YIELD;
+    xTaskNotifyGive(rb_task);
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS; i++)
+    {
+        taskYIELD();
+        rb_add(RTOSBENCH_YIELD, RB_NOW() - rb_stamp);
+    }
+    rb_mode = RB_IDLE;
+    taskYIELD();                                    /* the helper leaves its loop */
+}
+
+/* Caller below the helper: every send or notify switches to it at once */
+static void rb_wakes(void)
+{
+    uint32_t v;
+
+    vTaskPrioritySet(NULL, RB_TOP - 1u);
+
+    rb_mode = RB_WAKE;
+    rb_row  = RTOSBENCH_NOTIFY;
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS; i++)
+    {
+        rb_stamp = RB_NOW();
+        xTaskNotifyGive(rb_task);
+    }
+
+    rb_row = RTOSBENCH_ISR_WAKE;
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS; i++)
+    {
+        rb_pend = RB_NOW();
+        NVIC_SetPendingIRQ(FREQM_IRQn);
+        __DSB();
+        __ISB();
+    }
+
+    rb_mode = RB_QUEUE;
+    xTaskNotifyGive(rb_task);                       /* into xQueueReceive() */
+    for (v = 1u; v <= RTOSBENCH_ROUNDS; v++)
+    {
+        rb_stamp = RB_NOW();
+        (void)xQueueSend(rb_queue, &v, portMAX_DELAY);
+    }
+    v = 0u;
+    (void)xQueueSend(rb_queue, &v, portMAX_DELAY);
+
+    rb_mode = RB_STREAM;
+    xTaskNotifyGive(rb_task);
+    for (uint32_t i = 0; i < RTOSBENCH_ROUNDS; i++)
+    {
+        uint32_t t0 = RB_NOW();
+
+        (void)xStreamBufferSend(rb_sb, rb_chunk, sizeof(rb_chunk), portMAX_DELAY);
+        rb_add(RTOSBENCH_STREAM, RB_NOW() - t0);
+    }
+    rb_mode = RB_IDLE;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void RtosBench_Run(rtosbench_result_t out[RTOSBENCH_ROWS])
+{
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+
+    memset(out, 0, RTOSBENCH_ROWS * sizeof(out[0]));
+    if (!rb_create()) return;
+
+    memset(rb_acc, 0, sizeof(rb_acc));
+    CpuFreq_Hold();                                 /* cycles at 120 MHz throughout */
+    rb_solo();
+    rb_lz();
+    rb_adpcm();
+    rb_yield();
+    rb_wakes();
+    vTaskPrioritySet(NULL, prio);
+    CpuFreq_Release();
+
+    for (uint32_t r = 0; r < RTOSBENCH_ROWS; r++)
+    {
+        out[r].n = rb_acc[r].n;
+        if (rb_acc[r].n == 0u) continue;
+        out[r].min = rb_acc[r].min;
+        out[r].avg = (uint32_t)(rb_acc[r].sum / rb_acc[r].n);
+        out[r].max = rb_acc[r].max;
+    }
+}
+
+const char *RtosBench_Name(rtosbench_row_t r)
+{
+    return ((uint32_t)r < RTOSBENCH_ROWS) ? rb_name[r] : "?";
+}
+
+#endif /* RTOSBENCH_ENABLE */
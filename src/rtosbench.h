@@ -0,0 +1,109 @@
+/* =============================================================================
+ * rtosbench.h  -  What the FreeRTOS primitives cost on this board, in cycles
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Micro-benchmarks of the kernel as built: the GCC/SAM/ARM_CM4F port and
+ * the options of FreeRTOSConfig.h, with whatever the compiler made of
+ * them. Each row is RTOSBENCH_ROUNDS samples of DWT->CYCCNT, at full speed
+ * (CpuFreq_Hold()), net of the cost of the two stamps themselves:
+ *
+ *   critical      taskENTER_CRITICAL() + taskEXIT_CRITICAL()
+ *   isr mask      the FromISR pair: BASEPRI raised and restored
+ *   yield         taskYIELD() to a ready task of the same priority: PendSV
+ *                 and the context switch, FPU context included once used
+ *   notify        xTaskNotifyGive() to a higher task blocked in
+ *                 ulTaskNotifyTake(), until it runs
+ *   isr entry     NVIC pend to the first line of the handler (FREQM, an
+ *                 unused vector, at IRQ_PRIO_RTOSBENCH); its max is held
+ *                 up by whatever masked interrupts meanwhile
+ *   isr wake      vTaskNotifyGiveFromISR() in that handler to the task
+ *                 running: handler exit, PendSV, switch
+ *   queue         xQueueSend() + xQueueReceive() of a word, nobody waiting
+ *   queue wake    xQueueSend() to a higher task blocked in xQueueReceive()
+ *   stream        xStreamBufferSend() of RTOSBENCH_SB_CHUNK bytes to a
+ *                 higher task waiting on the buffer; "rtbench" shows it as
+ *                 KB/s too
+ *   sb chunk      xStreamBufferSend() + xStreamBufferReceive() of a chunk,
+ *                 nobody waiting
+ *   ring          Ring_Put() + Ring_Get() of a word (ring.h), to set
+ *                 against "queue"
+ *   ring mp       Ring_PutMP() + Ring_Get(): the LDREX / STREX claim and
+ *                 publish
+ *   ring chunk    a chunk written in place through Ring_Reserve() /
+ *                 Ring_Commit() and read through Ring_Peek() /
+ *                 Ring_Release() on a byte ring, to set against "sb chunk"
+ *   lz block      Lz_Decode() of a RTOSBENCH_LZ_BYTES block (lz.h) of short
+ *                 literal runs and overlapping matches, as an animation
+ *                 packs; what the Stream task spends per segment of a
+ *                 packed file, "rtbench" shows it as KB/s too
+ *   adpcm         Adpcm_Mix() of one ADPCM_BLOCK_SAMPLES block (adpcm.h)
+ *                 of mixed nibbles into an accumulator at unity gain, what
+ *                 the Sound task spends per ADPCM voice per mixed block;
+ *                 "rtbench" shows it as cycles a sample and the share of
+ *                 the CPU one voice takes at SOUND_RATE_HZ
+ *
+ * The helper task, the queue and the buffer are created (static) at the
+ * first run, which blocks the calling task for a moment with the helper at
+ * the top priority: run it from the console ("rtbench") with the show
+ * idle, once per configuration or compiler flag change, and compare the
+ * tables. The first line prints the options they depend on.
+ *
+ * With RTOSBENCH_ENABLE = 0 the module is not built.
+ * ============================================================================= */
+
+#ifndef RTOSBENCH_H
+#define RTOSBENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef RTOSBENCH_ENABLE
+#define RTOSBENCH_ENABLE        0       /* 1 = build the benchmark in         */
+#endif
+#define RTOSBENCH_ROUNDS        1000u   /* samples per row                    */
+#define RTOSBENCH_SB_CHUNK      64u     /* bytes per stream buffer send       */
+#define RTOSBENCH_LZ_BYTES      4096u   /* decoded per "lz block", a segment  */
+
+typedef enum
+{
+    RTOSBENCH_CRITICAL = 0,
+    RTOSBENCH_ISR_MASK,
+    RTOSBENCH_YIELD,
+    RTOSBENCH_NOTIFY,
+    RTOSBENCH_ISR_ENTRY,
+    RTOSBENCH_ISR_WAKE,
+    RTOSBENCH_QUEUE,
+    RTOSBENCH_QUEUE_WAKE,
+    RTOSBENCH_STREAM,
+    RTOSBENCH_SB_SOLO,
+    RTOSBENCH_RING,
+    RTOSBENCH_RING_MP,
+    RTOSBENCH_RING_CHUNK,
+    RTOSBENCH_LZ_BLOCK,
+    RTOSBENCH_ADPCM_BLOCK,
+    RTOSBENCH_ROWS
+} rtosbench_row_t;
+
+typedef struct
+{
+    uint32_t n;                 /* samples */
+    uint32_t min;               /* cycles  */
+    uint32_t avg;
+    uint32_t max;
+} rtosbench_result_t;
+
+#if RTOSBENCH_ENABLE
+
+/**
+ * Run every row into `out`; blocks the calling task for the run (tens of
+ * milliseconds). One task at a time, not from a timer callback.
+ */
+void RtosBench_Run(rtosbench_result_t out[RTOSBENCH_ROWS]);
+
+/** Console name of row `r`. */
+const char *RtosBench_Name(rtosbench_row_t r);
+
+#endif /* RTOSBENCH_ENABLE */
+
+#endif /* RTOSBENCH_H */
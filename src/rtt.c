@@ -0,0 +1,123 @@
+/* =============================================================================
+ * rtt.c  -  Memory-mapped debug channel read by the debugger over SWD
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "rtt.h"
+#include "definitions.h"        /* core_cm4.h: __get_PRIMASK, __DMB */
+#include "log.h"
+#include <stdarg.h>
+#include <string.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Layout fixed by the RTT host tools */
+typedef struct
+{
+    const char       *name;
+    uint8_t          *buf;
+    uint32_t          size;
+    volatile uint32_t wr;               /* target writes */
+    volatile uint32_t rd;               /* host writes   */
+    uint32_t          flags;            /* 0: skip when full */
+} rtt_ring_t;
+
+typedef struct
+{
+    char       id[16];                  /* "SEGGER RTT", written last */
+    int32_t    up_count;
+    int32_t    down_count;
+    rtt_ring_t up[1];
+} rtt_cb_t;
+
+typedef struct
+{
+    rtt_cb_t cb;
+    uint8_t  up_buf[RTT_UP_SIZE];
+} rtt_area_t;
+
+static rtt_area_t rtt __attribute__((section(".rtt"), used, aligned(4)));
+static volatile uint32_t rtt_dropped;
+
+_Static_assert(sizeof(rtt_area_t) <= 0x800u, "RTT area larger than RTT_LENGTH");
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Rtt_Init(void)
+{
+    static const char id_tail[] = " RTT";
+
+    /* Hide the block while it is (re)built, so a host never sees half of it */
+    rtt.cb.id[0] = '\0';
+    __DMB();
+    rtt.cb.up_count   = 1;
+    rtt.cb.down_count = 0;
+    rtt.cb.up[0].name  = "Terminal";
+    rtt.cb.up[0].buf   = rtt.up_buf;
+    rtt.cb.up[0].size  = RTT_UP_SIZE;
+    rtt.cb.up[0].wr    = 0u;
+    rtt.cb.up[0].rd    = 0u;
+    rtt.cb.up[0].flags = 0u;
+    rtt_dropped = 0u;
+
+    /* The ID is assembled in RAM only, so a host scanning memory cannot find
+     * a stale copy in flash; its first byte goes last */
+    memset(&rtt.cb.id[1], 0, sizeof(rtt.cb.id) - 1u);
+    memcpy(&rtt.cb.id[1], "EGGER", 5u);
+    memcpy(&rtt.cb.id[6], id_tail, sizeof(id_tail) - 1u);
+    __DMB();
+    rtt.cb.id[0] = 'S';
+}
+
+size_t Rtt_Write(const void *data, size_t len)
+{
+    rtt_ring_t    *r   = &rtt.cb.up[0];
+    const uint8_t *src = data;
+    uint32_t       primask = __get_PRIMASK();
+    uint32_t       wr, room;
+
+    __disable_irq();
+    wr   = r->wr;
+    room = (r->rd + r->size - wr - 1u) % r->size;       /* one byte kept free */
+    if (len > room)
+    {
+        rtt_dropped += (uint32_t)len;
+        __set_PRIMASK(primask);
+        return 0u;
+    }
+    for (size_t n = 0u; n < len; )
+    {
+        size_t run = r->size - wr;
+
+        if (run > len - n) run = len - n;
+        memcpy(&r->buf[wr], &src[n], run);
+        n  += run;
+        wr  = (wr + (uint32_t)run) % r->size;
+    }
+    __DMB();                            /* data before the index the host polls */
+    r->wr = wr;
+    __set_PRIMASK(primask);
+    return len;
+}
+
+void Rtt_Printf(const char *fmt, ...)
+{
+    char    line[LOG_LINE_MAX];
+    va_list ap;
+    size_t  n;
+
+    va_start(ap, fmt);
+    n = Log_VFormat(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    (void)Rtt_Write(line, n);
+}
+
+void Rtt_LogSink(const char *line, size_t len)
+{
+    (void)Rtt_Write(line, len);
+}
+
+uint32_t Rtt_Dropped(void)
+{
+    return rtt_dropped;
+}
@@ -0,0 +1,48 @@
+/* =============================================================================
+ * rtt.h  -  Memory-mapped debug channel read by the debugger over SWD
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A SEGGER RTT compatible control block with one up (target to host)
+ * ring buffer, in the .rtt section the linker script places at the top of
+ * RAM (RTT_ADDR). Writing is a bounded copy into the ring and one index
+ * store; the debugger reads the ring in the background through the AHB-AP
+ * while the core runs, so logging costs no UART time, no DMA and no
+ * interrupts, and works from ISRs and with the scheduler stopped.
+ *
+ * Any RTT host can attach: J-Link RTT Viewer (auto-detects), OpenOCD
+ * ("rtt setup 0x2003F800 0x800 {SEGGER RTT}", "rtt start",
+ * "rtt server start 9090 0"), pyOCD or probe-rs.
+ *
+ * When the host does not keep up, writes that do not fit are dropped
+ * (Rtt_Dropped()), never waited for. Writers mask interrupts only for the
+ * copy, so keep single writes short (a log line, not a frame dump).
+ * ============================================================================= */
+
+#ifndef RTT_H
+#define RTT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define RTT_ADDR            0x2003F800u /* RTT_ORIGIN in ATSAME51J20A.ld      */
+#define RTT_UP_SIZE         1536u       /* ring bytes; block + ring <= 0x800  */
+#define RTT_LOG             0           /* 1 = log.h lines go to RTT, not SERCOM5 */
+
+/** Set up the control block. After reset, before any other call; any time
+ *  after that it just empties the ring. */
+void Rtt_Init(void);
+
+/** Queue len bytes, all or nothing. Any task or ISR; returns bytes taken. */
+size_t Rtt_Write(const void *data, size_t len);
+
+/** Formatted line (log.h conversions), cut at LOG_LINE_MAX. Any task or ISR. */
+void Rtt_Printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/** log.h sink: Log_SetSink(Rtt_LogSink) moves the console log to RTT. */
+void Rtt_LogSink(const char *line, size_t len);
+
+/** Bytes dropped because the host had not read far enough. */
+uint32_t Rtt_Dropped(void);
+
+#endif /* RTT_H */
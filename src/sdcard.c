@@ -0,0 +1,368 @@
+/* =============================================================================
+ * sdcard.c  -  SD card block reads on SDHC0 with ADMA2
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "sdcard.h"
+#include "definitions.h"        /* SDHC0_REGS */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "qflash.h"
+#include "dmaram.h"
+#include "neopixel.h"
+#include "actuator.h"
+#include "rtos_trace.h"
+#include "irqstat.h"
+#include "showclock.h"
+
+#if SDCARD_ENABLE && QFLASH_ENABLE
+#error "SDCARD_ENABLE: SDHC0 and the QSPI flash use the same pins"
+#endif
+#if SDCARD_ENABLE && (NEO_BACKEND == NEO_BACKEND_TCC)
+#error "SDCARD_ENABLE: PA08 is SDHC0 CMD, not the NeoPixel TCC output"
+#endif
+#if SDCARD_ENABLE && ACT_PWM_DRIVE
+#error "SDCARD_ENABLE: PA10 is SDHC0 DAT1, not the motor PWM output"
+#endif
+#if SDCARD_ENABLE && ACT_STEPPER_DRIVE
+#error "SDCARD_ENABLE: PA10 is SDHC0 DAT1, not the stepper's STEP output"
+#endif
+
+#define SD_BASE_HZ          48000000u   /* GCLK3 */
+#define SD_DIV_IDENT        60u         /* 48 MHz / (2 * 60) = 400 kHz */
+#define SD_DIV_TRANSFER     1u          /* 24 MHz, default speed       */
+
+/* Response kinds, SDHC_CR bits */
+#define SD_R_NONE           SDHC_CR_RESPTYP_NONE
+#define SD_R1               (SDHC_CR_RESPTYP_48_BIT | SDHC_CR_CMDCCEN_Msk | SDHC_CR_CMDICEN_Msk)
+#define SD_R1B              (SDHC_CR_RESPTYP_48_BIT_BUSY | SDHC_CR_CMDCCEN_Msk | SDHC_CR_CMDICEN_Msk)
+#define SD_R2               (SDHC_CR_RESPTYP_136_BIT | SDHC_CR_CMDCCEN_Msk)
+#define SD_R3               SDHC_CR_RESPTYP_48_BIT              /* OCR: no CRC, no index */
+#define SD_R6               SD_R1
+#define SD_R7               SD_R1
+
+#define SD_OCR_BUSY         0x80000000u /* set = power-up done */
+#define SD_OCR_CCS          0x40000000u
+#define SD_OCR_HCS          0x40000000u
+#define SD_OCR_VDD          0x00FF8000u /* 2.7 .. 3.6 V */
+
+/* ADMA2 line: transfer, valid; END on the last */
+#define SD_ADMA_VALID       0x0001u
+#define SD_ADMA_END         0x0002u
+#define SD_ADMA_TRAN        0x0020u
+#define SD_ADMA_MAX         65536u      /* bytes per line, length 0 = 64 KB */
+#define SD_ADMA_LINES       ((SDCARD_MAX_RUN * SDCARD_BLOCK + SD_ADMA_MAX - 1u) / SD_ADMA_MAX)
+
+typedef struct
+{
+    uint16_t attr;
+    uint16_t len;
+    uint32_t addr;
+} sd_adma_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static sdcard_info_t     sd_info;
+#if SDCARD_ENABLE
+static SemaphoreHandle_t sd_mutex;
+static StaticSemaphore_t sd_mutex_buf;
+
+static sd_adma_t         sd_adma[SD_ADMA_LINES] DMA_RAM __ALIGNED(4);
+#endif
+
+static TaskHandle_t      sd_waiter;
+static volatile uint32_t sd_lat_max;        /* microseconds */
+static volatile uint32_t sd_errors;
+
+/* -- ISR --------------------------------------------------------------------- */
+
+/* Transfer complete or an error: wake the reader; it reads the flags itself */
+void SDHC0_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    IRQSTAT_ENTER(IRQSTAT_SDCARD);
+    RTOS_TRACE_ISR_ENTER();
+    SDHC0_REGS->SDHC_NISIER = 0u;
+    SDHC0_REGS->SDHC_EISIER = 0u;
+    if (sd_waiter != NULL) vTaskNotifyGiveIndexedFromISR(sd_waiter, SDCARD_NOTIFY_INDEX, &woken);
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_SDCARD);
+    portYIELD_FROM_ISR(woken);
+}
+
+#if SDCARD_ENABLE
+
+/* -- Controller -------------------------------------------------------------- */
+
+/* SDCLK = 48 MHz / (2 * div), div 0 = 48 MHz */
+static void sd_clock(uint32_t div)
+{
+    SDHC0_REGS->SDHC_CCR = 0u;
+    SDHC0_REGS->SDHC_CCR = SDHC_CCR_SDCLKFSEL(div & 0xFFu) | SDHC_CCR_USDCLKFSEL(div >> 8)
+                         | SDHC_CCR_INTCLKEN_Msk;
+    while ((SDHC0_REGS->SDHC_CCR & SDHC_CCR_INTCLKS_Msk) == 0u) {}
+    SDHC0_REGS->SDHC_CCR |= SDHC_CCR_SDCLKEN_Msk;
+}
+
+static void sd_reset_lines(void)
+{
+    SDHC0_REGS->SDHC_SRR = SDHC_SRR_SWRSTCMD_Msk | SDHC_SRR_SWRSTDAT_Msk;
+    while ((SDHC0_REGS->SDHC_SRR & (SDHC_SRR_SWRSTCMD_Msk | SDHC_SRR_SWRSTDAT_Msk)) != 0u) {}
+}
+
+/* One command, polled to its response (microseconds; R1b waits out the busy) */
+static bool sd_cmd(uint8_t idx, uint32_t arg, uint16_t resp, bool data)
+{
+    uint32_t inhibit = SDHC_PSR_CMDINHC_Msk | ((data || resp == SD_R1B) ? SDHC_PSR_CMDINHD_Msk : 0u);
+    uint16_t st;
+
+    while ((SDHC0_REGS->SDHC_PSR & inhibit) != 0u) {}
+    SDHC0_REGS->SDHC_NISTR = SDHC_NISTR_Msk;
+    SDHC0_REGS->SDHC_EISTR = SDHC_EISTR_Msk;
+    SDHC0_REGS->SDHC_ARG1R = arg;
+    SDHC0_REGS->SDHC_CR    = SDHC_CR_CMDIDX(idx) | resp | (data ? SDHC_CR_DPSEL_Msk : 0u);
+
+    do {
+        st = SDHC0_REGS->SDHC_NISTR;
+    } while ((st & (SDHC_NISTR_CMDC_Msk | SDHC_NISTR_ERRINT_Msk)) == 0u);
+
+    if (resp == SD_R1B && (st & SDHC_NISTR_ERRINT_Msk) == 0u)
+    {
+        do {
+            st = SDHC0_REGS->SDHC_NISTR;
+        } while ((st & (SDHC_NISTR_TRFC_Msk | SDHC_NISTR_ERRINT_Msk)) == 0u);
+    }
+    if ((st & SDHC_NISTR_ERRINT_Msk) != 0u)
+    {
+        sd_reset_lines();
+        return false;
+    }
+    SDHC0_REGS->SDHC_NISTR = SDHC_NISTR_CMDC_Msk;
+    return true;
+}
+
+static bool sd_acmd(uint8_t idx, uint32_t arg, uint16_t resp)
+{
+    return sd_cmd(55u, (uint32_t)sd_info.rca << 16, SD_R1, false) && sd_cmd(idx, arg, resp, false);
+}
+
+/* Capacity from CSD; the response registers hold CSD bits 127..8 as 119..0 */
+static uint32_t sd_csd_blocks(void)
+{
+    const volatile uint32_t *r = SDHC0_REGS->SDHC_RR;
+
+    if (((r[3] >> 22) & 3u) == 1u)                                  /* CSD 2.0 */
+        return (((r[1] >> 8) & 0x3FFFFFu) + 1u) << 10;
+
+    uint32_t c_size = ((r[2] & 3u) << 10) | (r[1] >> 22);           /* CSD 1.0 */
+    uint32_t mult   = (r[1] >> 7) & 7u;
+    uint32_t bl_len = (r[2] >> 8) & 0xFu;
+
+    return (c_size + 1u) << (mult + 2u + bl_len - 9u);
+}
+
+/* One command's run, <= SDCARD_MAX_RUN blocks */
+static bool sd_read_run(uint32_t lba, uint8_t *dst, uint32_t count)
+{
+    uint32_t bytes = count * SDCARD_BLOCK;
+    uint32_t lines = 0u;
+    uint32_t t0;
+    uint16_t st;
+    bool     ok;
+
+    for (uint32_t off = 0; off < bytes; off += SD_ADMA_MAX, lines++)
+    {
+        uint32_t n = (bytes - off < SD_ADMA_MAX) ? bytes - off : SD_ADMA_MAX;
+
+        sd_adma[lines].attr = SD_ADMA_TRAN | SD_ADMA_VALID | ((off + n == bytes) ? SD_ADMA_END : 0u);
+        sd_adma[lines].len  = (uint16_t)n;                          /* 65536 -> 0 */
+        sd_adma[lines].addr = (uint32_t)dst + off;
+    }
+    __DSB();
+
+    SDHC0_REGS->SDHC_ASAR[0] = (uint32_t)sd_adma;
+    SDHC0_REGS->SDHC_BSR     = SDHC_BSR_BLOCKSIZE(SDCARD_BLOCK);
+    SDHC0_REGS->SDHC_BCR     = (uint16_t)count;
+    SDHC0_REGS->SDHC_TMR     = SDHC_TMR_DMAEN_Msk | SDHC_TMR_DTDSEL_READ
+                             | ((count > 1u) ? (SDHC_TMR_MSBSEL_MULTIPLE | SDHC_TMR_BCEN_Msk
+                                                | SDHC_TMR_ACMDEN_CMD12) : 0u);
+
+    t0 = ShowClock_Now();
+    sd_waiter = xTaskGetCurrentTaskHandle();
+    (void)ulTaskNotifyTakeIndexed(SDCARD_NOTIFY_INDEX, pdTRUE, 0u);         /* drop a stale give */
+    if (!sd_cmd((count > 1u) ? 18u : 17u, sd_info.high_capacity ? lba : lba * SDCARD_BLOCK, SD_R1, true))
+    {
+        sd_waiter = NULL;
+        return false;
+    }
+
+    /* Arm the interrupt, then check once more in case it is already over */
+    SDHC0_REGS->SDHC_NISIER = SDHC_NISIER_TRFC_Msk;
+    SDHC0_REGS->SDHC_EISIER = SDHC_EISTR_Msk;
+    if ((SDHC0_REGS->SDHC_NISTR & (SDHC_NISTR_TRFC_Msk | SDHC_NISTR_ERRINT_Msk)) == 0u)
+        (void)ulTaskNotifyTakeIndexed(SDCARD_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(SDCARD_TIMEOUT_MS));
+    SDHC0_REGS->SDHC_NISIER = 0u;
+    SDHC0_REGS->SDHC_EISIER = 0u;
+    sd_waiter = NULL;
+
+    st = SDHC0_REGS->SDHC_NISTR;
+    ok = (st & (SDHC_NISTR_TRFC_Msk | SDHC_NISTR_ERRINT_Msk)) == SDHC_NISTR_TRFC_Msk;
+    if (!ok)
+    {
+        if ((st & SDHC_NISTR_TRFC_Msk) == 0u)                       /* timed out: stop the card */
+            (void)sd_cmd(12u, 0u, SD_R1B, false);
+        sd_reset_lines();
+    }
+    else
+    {
+        uint32_t dt = ShowClock_Since(t0);
+
+        if (dt > sd_lat_max) sd_lat_max = dt;
+    }
+    return ok;
+}
+
+static bool sd_identify(void)
+{
+    uint32_t ocr_arg = SD_OCR_VDD;
+    uint32_t tries;
+
+    sd_info.blocks = 0u;
+    sd_info.rca    = 0u;
+    sd_clock(SD_DIV_IDENT);
+    SDHC0_REGS->SDHC_HC1R &= (uint8_t)~SDHC_HC1R_DW_Msk;
+    vTaskDelay(pdMS_TO_TICKS(2u));                  /* 74 clocks and then some */
+
+    (void)sd_cmd(0u, 0u, SD_R_NONE, false);
+    if (sd_cmd(8u, 0x1AAu, SD_R7, false) && (SDHC0_REGS->SDHC_RR[0] & 0xFFFu) == 0x1AAu)
+        ocr_arg |= SD_OCR_HCS;                      /* v2 card: may be high capacity */
+
+    for (tries = 0u; tries < 1000u; tries += 10u)
+    {
+        if (!sd_acmd(41u, ocr_arg, SD_R3)) return false;            /* no card */
+        if ((SDHC0_REGS->SDHC_RR[0] & SD_OCR_BUSY) != 0u) break;
+        vTaskDelay(pdMS_TO_TICKS(10u));
+    }
+    if (tries >= 1000u) return false;
+    sd_info.high_capacity = (SDHC0_REGS->SDHC_RR[0] & SD_OCR_CCS) != 0u;
+
+    if (!sd_cmd(2u, 0u, SD_R2, false)) return false;
+    if (!sd_cmd(3u, 0u, SD_R6, false)) return false;
+    sd_info.rca = (uint16_t)(SDHC0_REGS->SDHC_RR[0] >> 16);
+
+    if (!sd_cmd(9u, (uint32_t)sd_info.rca << 16, SD_R2, false)) return false;
+    uint32_t blocks = sd_csd_blocks();
+
+    if (!sd_cmd(7u, (uint32_t)sd_info.rca << 16, SD_R1B, false)) return false;
+    if (!sd_acmd(6u, 2u, SD_R1)) return false;                      /* 4-bit bus */
+    SDHC0_REGS->SDHC_HC1R |= SDHC_HC1R_DW_4BIT;
+    if (!sd_info.high_capacity && !sd_cmd(16u, SDCARD_BLOCK, SD_R1, false)) return false;
+
+    sd_clock(SD_DIV_TRANSFER);
+    sd_info.blocks = blocks;
+    return true;
+}
+
+#endif /* SDCARD_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void SdCard_Init(void)
+{
+#if SDCARD_ENABLE
+    sd_mutex = xSemaphoreCreateMutexStatic(&sd_mutex_buf);
+
+    MCLK_REGS->MCLK_AHBMASK |= MCLK_AHBMASK_SDHC0_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[SDHC0_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK3 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[SDHC0_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+    GCLK_REGS->GCLK_PCHCTRL[SDHC0_GCLK_ID_SLOW] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[SDHC0_GCLK_ID_SLOW] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    /* PA08..PA11 (CMD, DAT0..2), PB10 (DAT3), PB11 (CK) -> peripheral I; pull-ups on CMD / DAT */
+    PORT_REGS->GROUP[0].PORT_PMUX[8u >> 1]  = PORT_PMUX_PMUXE(8u) | PORT_PMUX_PMUXO(8u);
+    PORT_REGS->GROUP[0].PORT_PMUX[10u >> 1] = PORT_PMUX_PMUXE(8u) | PORT_PMUX_PMUXO(8u);
+    PORT_REGS->GROUP[1].PORT_PMUX[10u >> 1] = PORT_PMUX_PMUXE(8u) | PORT_PMUX_PMUXO(8u);
+    PORT_REGS->GROUP[0].PORT_OUTSET = 0xFu << 8;
+    PORT_REGS->GROUP[1].PORT_OUTSET = 1u << 10;
+    for (uint32_t pin = 8u; pin <= 11u; pin++)
+        PORT_REGS->GROUP[0].PORT_PINCFG[pin] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_PULLEN_Msk;
+    PORT_REGS->GROUP[1].PORT_PINCFG[10] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_PULLEN_Msk;
+    PORT_REGS->GROUP[1].PORT_PINCFG[11] = PORT_PINCFG_PMUXEN_Msk;
+
+    SDHC0_REGS->SDHC_SRR = SDHC_SRR_SWRSTALL_Msk;
+    while ((SDHC0_REGS->SDHC_SRR & SDHC_SRR_SWRSTALL_Msk) != 0u) {}
+
+    /* No detect pin: force "inserted"; 32-bit ADMA2; all status bits latched */
+    SDHC0_REGS->SDHC_HC1R   = SDHC_HC1R_CARDDSEL_Msk | SDHC_HC1R_CARDDTL_Msk | SDHC_HC1R_DMASEL_32BIT;
+    SDHC0_REGS->SDHC_PCR    = SDHC_PCR_SDBVSEL_3V3 | SDHC_PCR_SDBPWR_Msk;
+    SDHC0_REGS->SDHC_TCR    = SDHC_TCR_DTCVAL(0xEu);
+    SDHC0_REGS->SDHC_NISTER = SDHC_NISTER_Msk;
+    SDHC0_REGS->SDHC_EISTER = SDHC_EISTER_Msk;
+    SDHC0_REGS->SDHC_NISIER = 0u;
+    SDHC0_REGS->SDHC_EISIER = 0u;
+
+    NVIC_SetPriority(SDHC0_IRQn, SDCARD_IRQ_PRIO);
+    NVIC_EnableIRQ(SDHC0_IRQn);
+#endif
+}
+
+bool SdCard_Identify(void)
+{
+#if SDCARD_ENABLE
+    bool ok;
+
+    (void)xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    ok = sd_identify();
+    if (!ok) sd_info.blocks = 0u;
+    (void)xSemaphoreGive(sd_mutex);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+void SdCard_GetInfo(sdcard_info_t *out)
+{
+    *out = sd_info;
+}
+
+bool SdCard_Read(uint32_t lba, void *dst, uint32_t count)
+{
+#if SDCARD_ENABLE
+    uint8_t *d  = dst;
+    bool     ok = true;
+
+    if (sd_info.blocks == 0u || lba >= sd_info.blocks || count > sd_info.blocks - lba) return false;
+
+    (void)xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    while (ok && count != 0u)
+    {
+        uint32_t n = (count > SDCARD_MAX_RUN) ? SDCARD_MAX_RUN : count;
+
+        ok = sd_read_run(lba, d, n);
+        lba   += n;
+        d     += n * SDCARD_BLOCK;
+        count -= n;
+    }
+    if (!ok) sd_errors++;
+    (void)xSemaphoreGive(sd_mutex);
+    return ok;
+#else
+    (void)lba;
+    (void)dst;
+    (void)count;
+    return false;
+#endif
+}
+
+uint32_t SdCard_LatencyMaxUs(void)
+{
+    return sd_lat_max;
+}
+
+uint32_t SdCard_Errors(void)
+{
+    return sd_errors;
+}
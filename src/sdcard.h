@@ -0,0 +1,77 @@
+/* =============================================================================
+ * sdcard.h  -  SD card block reads on SDHC0 with ADMA2
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A microSD socket on SDHC0, 4-bit bus, peripheral I:
+ *
+ *   PA08  CMD     PA09..PA11  DAT0..2     PB10  DAT3     PB11  CK
+ *
+ * These are the QSPI pins as well (qflash.h), so a board carries one or the
+ * other: SDCARD_ENABLE and QFLASH_ENABLE cannot be built together, nor
+ * with the NeoPixel TCC backend (PA08), ACT_PWM_DRIVE or ACT_STEPPER_DRIVE
+ * (PA10), or the I2S sound output (PA09..PA11, sound.h). There is no
+ * card-detect pin; SdCard_Identify() finds out by asking.
+ *
+ * The controller runs from GCLK3 (48 MHz): 400 kHz while identifying, then
+ * 24 MHz default speed, ~11 MB/s at 4 bits. SDHC and SDXC (block
+ * addressed) and standard-capacity cards all work. Reads go straight into
+ * the caller's buffer by the controller's own ADMA2 engine (not the DMAC),
+ * one CMD18 with auto-CMD12 for a whole run; the caller sleeps on a task
+ * notification until the transfer-complete interrupt. Read only: nothing
+ * here writes the card.
+ *
+ * SD read latency is not bounded: a card can take 100 ms or more on a
+ * block now and then (wear levelling). stream.h reads ahead to cover
+ * that; SdCard_LatencyMaxUs() keeps the worst seen.
+ * ============================================================================= */
+
+#ifndef SDCARD_H
+#define SDCARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define SDCARD_ENABLE           0       /* 1 = a socket is wired to SDHC0            */
+#define SDCARD_BLOCK            512u
+#define SDCARD_MAX_RUN          256u    /* blocks per command (128 KB, 2 ADMA lines) */
+#define SDCARD_NOTIFY_INDEX     3u      /* qflash.h's: the two never build together  */
+#define SDCARD_IRQ_PRIO         IRQ_PRIO_SDCARD     /* NVIC, irqprio.h           */
+#define SDCARD_TIMEOUT_MS       500u    /* one read command, well past a slow block  */
+
+typedef struct
+{
+    uint32_t blocks;                    /* capacity in SDCARD_BLOCK, 0 = no card */
+    uint16_t rca;
+    bool     high_capacity;             /* SDHC / SDXC: block addressed */
+} sdcard_info_t;
+
+/** Clocks, pins and the controller, no card traffic. After SYS_Initialize(). */
+void SdCard_Init(void);
+
+/**
+ * Power the card up and bring it to 4-bit transfer state (up to ~1 s, the
+ * card's own power-up). From a task; false if no card answered, and again
+ * after a card is swapped. Serialised with the reads.
+ */
+bool SdCard_Identify(void);
+
+/** What the last SdCard_Identify() found. */
+void SdCard_GetInfo(sdcard_info_t *out);
+
+/**
+ * Read `count` blocks from `lba` into `dst` (4-byte aligned). From a task,
+ * which sleeps until the data is in; any length, split into runs of
+ * SDCARD_MAX_RUN. False on a card error or timeout; the card must then be
+ * identified again.
+ */
+bool SdCard_Read(uint32_t lba, void *dst, uint32_t count);
+
+/** Slowest SdCard_Read() command since boot, microseconds. */
+uint32_t SdCard_LatencyMaxUs(void);
+
+/** Failed commands since boot. */
+uint32_t SdCard_Errors(void);
+
+#endif /* SDCARD_H */
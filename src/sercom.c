@@ -0,0 +1,235 @@
+/* =============================================================================
+ * sercom.c  -  One table-driven driver for every SERCOM: USART, SPI, I2C, DMA
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "sercom.h"
+#include <stddef.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    sercom_registers_t *regs;
+    volatile uint32_t  *apb;            /* MCLK APBxMASK                   */
+    uint32_t            apb_msk;
+    uint8_t             gclk_id;        /* GCLK PCHCTRL channel, core      */
+    uint8_t             dma_rx;         /* DMAC trigger sources            */
+    uint8_t             dma_tx;
+    IRQn_Type           irq;            /* first of four: _0 _1 _2 _OTHER  */
+} sercom_inst_t;
+
+static const sercom_inst_t sercom_inst[SERCOM_COUNT] =
+{
+    { SERCOM0_REGS, &MCLK_REGS->MCLK_APBAMASK, MCLK_APBAMASK_SERCOM0_Msk, SERCOM0_GCLK_ID_CORE,
+      SERCOM0_DMAC_ID_RX, SERCOM0_DMAC_ID_TX, SERCOM0_0_IRQn },
+    { SERCOM1_REGS, &MCLK_REGS->MCLK_APBAMASK, MCLK_APBAMASK_SERCOM1_Msk, SERCOM1_GCLK_ID_CORE,
+      SERCOM1_DMAC_ID_RX, SERCOM1_DMAC_ID_TX, SERCOM1_0_IRQn },
+    { SERCOM2_REGS, &MCLK_REGS->MCLK_APBBMASK, MCLK_APBBMASK_SERCOM2_Msk, SERCOM2_GCLK_ID_CORE,
+      SERCOM2_DMAC_ID_RX, SERCOM2_DMAC_ID_TX, SERCOM2_0_IRQn },
+    { SERCOM3_REGS, &MCLK_REGS->MCLK_APBBMASK, MCLK_APBBMASK_SERCOM3_Msk, SERCOM3_GCLK_ID_CORE,
+      SERCOM3_DMAC_ID_RX, SERCOM3_DMAC_ID_TX, SERCOM3_0_IRQn },
+    { SERCOM4_REGS, &MCLK_REGS->MCLK_APBDMASK, MCLK_APBDMASK_SERCOM4_Msk, SERCOM4_GCLK_ID_CORE,
+      SERCOM4_DMAC_ID_RX, SERCOM4_DMAC_ID_TX, SERCOM4_0_IRQn },
+    { SERCOM5_REGS, &MCLK_REGS->MCLK_APBDMASK, MCLK_APBDMASK_SERCOM5_Msk, SERCOM5_GCLK_ID_CORE,
+      SERCOM5_DMAC_ID_RX, SERCOM5_DMAC_ID_TX, SERCOM5_0_IRQn },
+};
+
+static uint8_t       sercom_mode[SERCOM_COUNT];
+static sercom_isr_fn sercom_isr[SERCOM_IRQ_COUNT];
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* SYNCBUSY is at the same offset in every mode; SWRST and ENABLE are bits 0, 1 */
+static void sercom_sync(sercom_registers_t *r)
+{
+    while (r->USART_INT.SERCOM_SYNCBUSY != 0u) {}
+}
+
+static dmac_descriptor_registers_t *sercom_desc(uint32_t base, uint8_t ch)
+{
+    return (dmac_descriptor_registers_t *)base + ch;
+}
+
+static void sercom_usart(sercom_registers_t *r, const sercom_cfg_t *c)
+{
+    r->USART_INT.SERCOM_CTRLA = SERCOM_USART_INT_CTRLA_MODE_USART_INT_CLK |
+                                SERCOM_USART_INT_CTRLA_TXPO(c->txpo) |
+                                SERCOM_USART_INT_CTRLA_RXPO(c->rxpo) |
+                                SERCOM_USART_INT_CTRLA_SAMPR_16X_ARITHMETIC |
+                                SERCOM_USART_INT_CTRLA_DORD_Msk;                /* LSB first */
+    r->USART_INT.SERCOM_CTRLB = (((c->flags & SERCOM_F_TX) != 0u)    ? SERCOM_USART_INT_CTRLB_TXEN_Msk   : 0u) |
+                                (((c->flags & SERCOM_F_RX) != 0u)    ? SERCOM_USART_INT_CTRLB_RXEN_Msk   : 0u) |
+                                (((c->flags & SERCOM_F_STOP2) != 0u) ? SERCOM_USART_INT_CTRLB_SBMODE_Msk : 0u);
+    sercom_sync(r);
+    r->USART_INT.SERCOM_BAUD  = c->baud;
+}
+
+static void sercom_spi(sercom_registers_t *r, const sercom_cfg_t *c)
+{
+    r->SPIM.SERCOM_CTRLA = SERCOM_SPIM_CTRLA_MODE_SPI_MASTER |
+                           SERCOM_SPIM_CTRLA_DOPO(c->txpo) | SERCOM_SPIM_CTRLA_DIPO(c->rxpo) |
+                           (((c->flags & SERCOM_F_CPOL) != 0u) ? SERCOM_SPIM_CTRLA_CPOL_Msk : 0u) |
+                           (((c->flags & SERCOM_F_CPHA) != 0u) ? SERCOM_SPIM_CTRLA_CPHA_Msk : 0u) |
+                           SERCOM_SPIM_CTRLA_DORD_MSB;
+    r->SPIM.SERCOM_CTRLB = SERCOM_SPIM_CTRLB_CHSIZE_8_BIT |
+                           (((c->flags & SERCOM_F_RX) != 0u) ? SERCOM_SPIM_CTRLB_RXEN_Msk : 0u);
+    sercom_sync(r);
+    r->SPIM.SERCOM_BAUD  = (uint8_t)c->baud;
+    r->SPIM.SERCOM_CTRLC = c->ctrlc;
+}
+
+static void sercom_i2c(sercom_registers_t *r, const sercom_cfg_t *c)
+{
+    /* Smart mode: reading DATA acknowledges and fetches the next byte */
+    r->I2CM.SERCOM_CTRLA = SERCOM_I2CM_CTRLA_MODE_I2C_MASTER | SERCOM_I2CM_CTRLA_SDAHOLD_75NS |
+                           SERCOM_I2CM_CTRLA_SPEED(((c->flags & SERCOM_F_FAST) != 0u) ? 1u : 0u);
+    r->I2CM.SERCOM_CTRLB = SERCOM_I2CM_CTRLB_SMEN_Msk;
+    sercom_sync(r);
+    r->I2CM.SERCOM_BAUD  = SERCOM_I2CM_BAUD_BAUD(c->baud);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+sercom_registers_t *Sercom_Regs(uint8_t n)
+{
+    return (n < SERCOM_COUNT) ? sercom_inst[n].regs : NULL;
+}
+
+void Sercom_Open(uint8_t n, const sercom_cfg_t *cfg)
+{
+    const sercom_inst_t *s;
+    sercom_registers_t  *r;
+
+    if (n >= SERCOM_COUNT) return;
+    s = &sercom_inst[n];
+    r = s->regs;
+
+    *s->apb |= s->apb_msk;
+    GCLK_REGS->GCLK_PCHCTRL[s->gclk_id] = GCLK_PCHCTRL_GEN(cfg->gclk) | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[s->gclk_id] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    r->USART_INT.SERCOM_CTRLA = SERCOM_USART_INT_CTRLA_SWRST_Msk;
+    sercom_sync(r);
+
+    sercom_mode[n] = cfg->mode;
+    switch (cfg->mode)
+    {
+        case SERCOM_SPI: sercom_spi(r, cfg);   break;
+        case SERCOM_I2C: sercom_i2c(r, cfg);   break;
+        default:         sercom_usart(r, cfg); break;
+    }
+}
+
+void Sercom_Enable(uint8_t n)
+{
+    sercom_registers_t *r;
+
+    if (n >= SERCOM_COUNT) return;
+    r = sercom_inst[n].regs;
+
+    r->USART_INT.SERCOM_CTRLA |= SERCOM_USART_INT_CTRLA_ENABLE_Msk;       /* bit 1 in every mode */
+    sercom_sync(r);
+    if (sercom_mode[n] == SERCOM_I2C)
+    {
+        r->I2CM.SERCOM_STATUS = SERCOM_I2CM_STATUS_BUSSTATE(1u);           /* force IDLE */
+        sercom_sync(r);
+    }
+}
+
+void Sercom_Disable(uint8_t n)
+{
+    sercom_registers_t *r;
+
+    if (n >= SERCOM_COUNT) return;
+    r = sercom_inst[n].regs;
+
+    r->USART_INT.SERCOM_CTRLA &= ~SERCOM_USART_INT_CTRLA_ENABLE_Msk;
+    sercom_sync(r);
+}
+
+bool Sercom_Irq(uint8_t n, sercom_isr_fn fn, uint32_t prio)
+{
+    if (n >= SERCOM_IRQ_COUNT) return false;
+
+    sercom_isr[n] = fn;
+    for (IRQn_Type irq = sercom_inst[n].irq; irq <= sercom_inst[n].irq + 3; irq++)
+    {
+        NVIC_SetPriority(irq, prio);
+        NVIC_ClearPendingIRQ(irq);
+        NVIC_EnableIRQ(irq);
+    }
+    return true;
+}
+
+bool Sercom_DmaAttach(uint8_t n, sercom_dir_t dir, uint8_t ch, dma_class_t cls, dma_other_fn done)
+{
+    if (n >= SERCOM_COUNT || ch < DMA_OTHER_FIRST || ch >= DMA_OTHER_FIRST + DMA_OTHER_COUNT)
+        return false;
+
+    DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC((dir == SERCOM_DMA_RX) ? sercom_inst[n].dma_rx : sercom_inst[n].dma_tx) |
+        DMAC_CHCTRLA_TRIGACT_BURST;                                     /* one byte per trigger */
+    Dma_Assign((DMAC_CHANNEL)ch, cls);
+    if (done != NULL)
+    {
+        (void)Dma_OtherRegister(ch, done);
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk | DMAC_CHINTENSET_TERR_Msk;
+    }
+    return true;
+}
+
+void Sercom_DmaStart(uint8_t n, sercom_dir_t dir, uint8_t ch, void *buf, uint32_t len)
+{
+    dmac_descriptor_registers_t *d    = sercom_desc(DMAC_REGS->DMAC_BASEADDR, ch);
+    uint32_t                     data = (uint32_t)&sercom_inst[n].regs->USART_INT.SERCOM_DATA;
+    uint32_t                     end  = (uint32_t)buf + len;        /* end address with INC */
+
+    d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_BLOCKACT_INT |
+                       ((dir == SERCOM_DMA_RX) ? DMAC_BTCTRL_DSTINC_Msk : DMAC_BTCTRL_SRCINC_Msk);
+    d->DMAC_BTCNT    = (uint16_t)len;
+    d->DMAC_SRCADDR  = (dir == SERCOM_DMA_RX) ? data : end;
+    d->DMAC_DSTADDR  = (dir == SERCOM_DMA_RX) ? end  : data;
+    d->DMAC_DESCADDR = 0u;
+    sercom_desc(DMAC_REGS->DMAC_WRBADDR, ch)->DMAC_BTCNT = (uint16_t)len;   /* nothing moved until it runs */
+    DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+}
+
+uint32_t Sercom_DmaStop(uint8_t ch)
+{
+    DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+    while ((DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u) {}
+    return sercom_desc(DMAC_REGS->DMAC_WRBADDR, ch)->DMAC_BTCNT;
+}
+
+/* -- Interrupt handlers ------------------------------------------------------ */
+
+/* Every vector of SERCOM0..4; a source left on with no handler is switched off */
+static void sercom_dispatch(uint8_t n)
+{
+    if (sercom_isr[n] != NULL)
+        sercom_isr[n]();
+    else
+        sercom_inst[n].regs->USART_INT.SERCOM_INTENCLR = 0xFFu;
+}
+
+void SERCOM0_0_Handler(void)     { sercom_dispatch(0u); }
+void SERCOM0_1_Handler(void)     { sercom_dispatch(0u); }
+void SERCOM0_2_Handler(void)     { sercom_dispatch(0u); }
+void SERCOM0_OTHER_Handler(void) { sercom_dispatch(0u); }
+void SERCOM1_0_Handler(void)     { sercom_dispatch(1u); }
+void SERCOM1_1_Handler(void)     { sercom_dispatch(1u); }
+void SERCOM1_2_Handler(void)     { sercom_dispatch(1u); }
+void SERCOM1_OTHER_Handler(void) { sercom_dispatch(1u); }
+void SERCOM2_0_Handler(void)     { sercom_dispatch(2u); }
+void SERCOM2_1_Handler(void)     { sercom_dispatch(2u); }
+void SERCOM2_2_Handler(void)     { sercom_dispatch(2u); }
+void SERCOM2_OTHER_Handler(void) { sercom_dispatch(2u); }
+void SERCOM3_0_Handler(void)     { sercom_dispatch(3u); }
+void SERCOM3_1_Handler(void)     { sercom_dispatch(3u); }
+void SERCOM3_2_Handler(void)     { sercom_dispatch(3u); }
+void SERCOM3_OTHER_Handler(void) { sercom_dispatch(3u); }
+void SERCOM4_0_Handler(void)     { sercom_dispatch(4u); }
+void SERCOM4_1_Handler(void)     { sercom_dispatch(4u); }
+void SERCOM4_2_Handler(void)     { sercom_dispatch(4u); }
+void SERCOM4_OTHER_Handler(void) { sercom_dispatch(4u); }
@@ -0,0 +1,137 @@
+/* =============================================================================
+ * sercom.h  -  One table-driven driver for every SERCOM: USART, SPI, I2C, DMA
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Each of the six SERCOMs is a row of one constant table: its registers,
+ * APB clock bit, core GCLK channel, first NVIC vector and DMAC triggers.
+ * Sercom_Open() takes an instance number and a sercom_cfg_t and does what
+ * every driver used to spell out for its own instance: the bus clock, the
+ * GCLK channel, the software reset, and CTRLA / CTRLB / CTRLC / BAUD for
+ * the mode, computed at compile time by the SERCOM_*_BAUD() macros:
+ *
+ *   USART   internal clock, 16x arithmetic sampling, LSB first, 8 bits,
+ *           one or two stop bits, TXPO / RXPO pads, TX and / or RX
+ *   SPI     master, 8 bits (or 32-bit DATA through CTRLC), MSB first,
+ *           DOPO / DIPO pads, any of the four clock modes, RX optional
+ *   I2C     master, smart mode, 75 ns SDA hold, BUSSTATE forced idle on
+ *           Sercom_Enable()
+ *
+ * The instance is left disabled, so its interrupts and DMA can be set up
+ * first; Sercom_Enable() starts it. Pins stay with the driver (PMUX,
+ * pulls, a PORT break): only it knows the board.
+ *
+ * Nothing here waits on the bus. Bytes move by DMA or in the driver's
+ * interrupt: Sercom_Irq() routes all four vectors of an instance to one
+ * handler, and Sercom_DmaAttach() ties a DMA_OTHER channel (dma_qos.h) to
+ * the instance's RX or TX trigger, one byte per beat, with an optional
+ * completion callback. Sercom_DmaStart() then runs one block to or from
+ * DATA, Sercom_DmaStop() cuts it short and says how much was left. A
+ * chained or circular transfer programs the channel's descriptors
+ * itself, on the trigger Sercom_DmaAttach() set.
+ *
+ *   dmx.c        SERCOM0  USART RX, DMA         netbridge.c  SERCOM3  USART, DMA both ways
+ *   neopixel.c   SERCOM0/1/3/4  SPI TX, DMA     pixdist.c    SERCOM4  USART, DMA
+ *   i2c_bus.c    SERCOM2  I2C, DMA read phase
+ *
+ * SERCOM5 is the console: the MCC USART plib and the stdio DMA in
+ * stdio_uart.c own it and its vectors, so it can be opened here but not
+ * given to Sercom_Irq().
+ * ============================================================================= */
+
+#ifndef SERCOM_H
+#define SERCOM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"        /* sercom_registers_t */
+#include "dma_qos.h"
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define SERCOM_COUNT            6u
+#define SERCOM_IRQ_COUNT        5u      /* instances with Sercom_Irq(): 0..4         */
+
+/* BAUD register values; the rates are constants, so these fold at compile time */
+#define SERCOM_USART_BAUD(gclk_hz, bps) \
+    (65536u - (uint32_t)((65536ull * 16u * (bps)) / (gclk_hz)))     /* 16x arithmetic */
+#define SERCOM_SPI_BAUD(gclk_hz, sck_hz) \
+    ((gclk_hz) / (2u * (sck_hz)) - 1u)
+#define SERCOM_I2C_BAUD(gclk_hz, scl_hz, rise_ns) \
+    (((gclk_hz) / (scl_hz) - 10u - (gclk_hz) / 1000000u * (rise_ns) / 1000u) / 2u)
+
+typedef enum
+{
+    SERCOM_USART = 0,
+    SERCOM_SPI,
+    SERCOM_I2C
+} sercom_mode_t;
+
+/* sercom_cfg_t.flags */
+#define SERCOM_F_TX             0x01u   /* USART: transmitter on                     */
+#define SERCOM_F_RX             0x02u   /* USART, SPI: receiver on                   */
+#define SERCOM_F_STOP2          0x04u   /* USART: two stop bits                      */
+#define SERCOM_F_CPOL           0x08u   /* SPI: clock idles high                     */
+#define SERCOM_F_CPHA           0x10u   /* SPI: data changes on the leading edge     */
+#define SERCOM_F_FAST           0x20u   /* I2C: CTRLA.SPEED 1                        */
+
+typedef struct
+{
+    uint8_t  mode;              /* sercom_mode_t                             */
+    uint8_t  gclk;              /* generator of the core clock, 0..11        */
+    uint8_t  txpo;              /* USART TXPO, SPI DOPO                      */
+    uint8_t  rxpo;              /* USART RXPO, SPI DIPO                      */
+    uint8_t  flags;             /* SERCOM_F_*                                */
+    uint16_t baud;              /* BAUD register, SERCOM_*_BAUD()            */
+    uint32_t ctrlc;             /* SPI CTRLC (DATA32B), 0 otherwise          */
+} sercom_cfg_t;
+
+typedef enum
+{
+    SERCOM_DMA_RX = 0,          /* DATA to memory, one beat per RXC          */
+    SERCOM_DMA_TX               /* memory to DATA, one beat per DRE          */
+} sercom_dir_t;
+
+/** Interrupt of an instance, whichever of its four vectors fired. ISR. */
+typedef void (*sercom_isr_fn)(void);
+
+/** Registers of instance `n`, NULL past the last. */
+sercom_registers_t *Sercom_Regs(uint8_t n);
+
+/**
+ * Clock instance `n` from generator cfg->gclk, reset it and set it up for
+ * cfg->mode; it is left disabled with every interrupt off. Before the
+ * scheduler, or with the instance idle and its users stopped.
+ */
+void Sercom_Open(uint8_t n, const sercom_cfg_t *cfg);
+
+/** Enable instance `n` (an I2C master also takes the bus as idle). */
+void Sercom_Enable(uint8_t n);
+
+/** Disable instance `n`, registers kept. */
+void Sercom_Disable(uint8_t n);
+
+/**
+ * Route the four vectors of instance `n` (< SERCOM_IRQ_COUNT) to `fn` at
+ * NVIC priority `prio` and enable them; the sources stay the driver's
+ * INTENSET. False for SERCOM5, or past the last.
+ */
+bool Sercom_Irq(uint8_t n, sercom_isr_fn fn, uint32_t prio);
+
+/**
+ * Trigger DMA_OTHER channel `ch` by instance `n`'s RX or TX, one byte per
+ * beat, on the priority level of `cls`. With `done`, a block that ends (or
+ * a transfer error) calls it from the DMAC_OTHER interrupt. Channel idle;
+ * false if `ch` is not a DMA_OTHER channel.
+ */
+bool Sercom_DmaAttach(uint8_t n, sercom_dir_t dir, uint8_t ch, dma_class_t cls, dma_other_fn done);
+
+/**
+ * Move `len` (1..65535) bytes between `buf` and instance `n`'s DATA on
+ * channel `ch` (attached, idle) as a single block, and return at once.
+ * `buf` must be in DMA-reachable RAM or flash.
+ */
+void Sercom_DmaStart(uint8_t n, sercom_dir_t dir, uint8_t ch, void *buf, uint32_t len);
+
+/** Stop channel `ch`; the bytes of its block it did not move. Any context. */
+uint32_t Sercom_DmaStop(uint8_t ch);
+
+#endif /* SERCOM_H */
@@ -0,0 +1,411 @@
+/* =============================================================================
+ * servo.c  -  Hobby servo bank on TCC0: buffered setpoints, slewed in the frame ISR
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include <stddef.h>
+#include "servo.h"
+
+#if SERVO_ENABLE
+
+#include "definitions.h"        /* TCC0_PWMInitialize, PORT_REGS, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "neopixel.h"           /* NEO_BACKEND, NEO_HW_FRAME_START, NEO_RAIL_GATE */
+#include "actuator.h"           /* ACT_PWM_DRIVE, ACT_STEPPER_DRIVE */
+#include "pixdist.h"
+#include "showsync.h"
+#include "brownout.h"
+#include "tickless.h"
+#include "irqstat.h"
+#include "motion.h"
+
+#define SV_HZ               1875000u                /* TCC0 counts: GCLK0 120 MHz / 64 */
+#define SV_PER              (SV_HZ / SERVO_HZ)
+#define SV_GROUP            1u                      /* PORTB */
+#define SV_PIN0             12u                     /* PB12 = WO0, peripheral G */
+#define SV_US(us)           ((uint32_t)(us) * 15u / 8u)     /* counts */
+
+#define SV_X_MASK(id, name, wo, min, max, rest, slew, accel, jerk) | (1u << (wo))
+#define SV_WO_MASK          (0u SHOW_SERVOS(SV_X_MASK))
+
+#if NEO_BACKEND != NEO_BACKEND_SPI || NEO_HW_FRAME_START
+#error "SERVO_ENABLE needs TCC0, which the CCL / TCC NeoPixel backends and NEO_HW_FRAME_START use"
+#endif
+#if ACT_PWM_DRIVE || ACT_STEPPER_DRIVE
+#error "SERVO_ENABLE needs TCC0, which ACT_PWM_DRIVE / ACT_STEPPER_DRIVE use"
+#endif
+#if (PIXDIST_ROLE != PIXDIST_NONE) && (SV_WO_MASK & 0x03u)
+#error "SHOW_SERVOS: PB12 / PB13 (WO0 / WO1) are the pixdist link"
+#endif
+#if SHOWSYNC_ENABLE && (SV_WO_MASK & 0x0Cu)
+#error "SHOW_SERVOS: PB14 / PB15 (WO2 / WO3) are the show-sync CAN"
+#endif
+#if NEO_RAIL_GATE && (SV_WO_MASK & 0x10u)
+#error "SHOW_SERVOS: PB16 (WO4) is the LED rail switch"
+#endif
+
+#define SV_X_ONE_WO(id, name, wo, min, max, rest, slew, accel, jerk) + 1u
+_Static_assert(SERVO_COUNT >= 1u && SERVO_COUNT <= 6u, "SHOW_SERVOS: TCC0 has six compare channels");
+_Static_assert(__builtin_popcount(SV_WO_MASK) == (0u SHOW_SERVOS(SV_X_ONE_WO)) && SV_WO_MASK < 0x40u,
+               "SHOW_SERVOS: one row per WO, 0..5");
+_Static_assert(SV_PER - 1u < 0x1000000u, "SERVO_HZ: a period over 24 bits");
+
+typedef struct
+{
+    const char *name;
+    uint8_t     wo;
+    uint16_t    min_us;
+    uint16_t    max_us;
+    uint16_t    rest_us;
+    int32_t     vmax;           /* Q8 counts per frame, 0 = none   */
+    int32_t     acc;            /* Q8 counts per frame^2, 0 = none */
+    uint32_t    slew;           /* counts/s, s^2, s^3: motion.h    */
+    uint32_t    accel;
+    uint32_t    jerk;
+} sv_cfg_t;
+
+#define SV_X_CFG(id, name, wo, min, max, rest, slew, accel, jerk)                                    \
+    [SERVO_##id] = { name, wo, min, max, rest,                                                 \
+                     (int32_t)((uint64_t)(slew) * 15u * 256u / (8u * SERVO_HZ)),               \
+                     (int32_t)((uint64_t)(accel) * 15u * 256u / (8u * SERVO_HZ * SERVO_HZ)),    \
+                     SV_US(slew), SV_US(accel), SV_US(jerk) },
+
+static const sv_cfg_t sv_cfg[SERVO_COUNT] =
+{
+    SHOW_SERVOS(SV_X_CFG)
+};
+
+#define SV_X_CHECK(id, name, wo, min, max, rest, slew, accel, jerk) \
+    && (min) < (max) && (rest) >= (min) && (rest) <= (max) && (max) < 1000000u / SERVO_HZ
+
+_Static_assert(1 SHOW_SERVOS(SV_X_CHECK), "SHOW_SERVOS: min < max, rest between, max within the frame");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t          sv_stage[SERVO_COUNT];     /* counts, task side                 */
+static bool              sv_staged[SERVO_COUNT];
+static uint32_t          sv_target[SERVO_COUNT];    /* counts, committed: the ISR's       */
+static int32_t           sv_pos[SERVO_COUNT];       /* Q8 counts                          */
+static int32_t           sv_vel[SERVO_COUNT];       /* Q8 counts per frame                */
+static volatile bool     sv_released[SERVO_COUNT];
+static volatile uint32_t sv_frames;
+
+/* A move from rest runs a planned profile; sv_prof[!sv_cur] is the next plan */
+static motion_profile_t  sv_prof[2][SERVO_COUNT];
+static uint8_t           sv_cur[SERVO_COUNT];
+static motion_run_t      sv_run[SERVO_COUNT];
+static bool              sv_ramp[SERVO_COUNT];      /* sv_run is driving it              */
+static int32_t           sv_from[SERVO_COUNT];      /* counts, where the profile started */
+static SemaphoreHandle_t sv_lock;                   /* one Servo_Commit() at a time       */
+static StaticSemaphore_t sv_lock_buf;
+
+static uint32_t sv_clamp(servo_id_t id, uint32_t us)
+{
+    const sv_cfg_t *c = &sv_cfg[id];
+
+    if (us < c->min_us) us = c->min_us;
+    if (us > c->max_us) us = c->max_us;
+    return SV_US(us);
+}
+
+static uint32_t sv_isqrt(uint64_t x)
+{
+    uint64_t r = 0u;
+
+    for (uint64_t b = 1ull << 62; b != 0u; b >>= 2)
+    {
+        if (x >= r + b)
+        {
+            x -= r + b;
+            r  = (r >> 1) + b;
+        }
+        else
+        {
+            r >>= 1;
+        }
+    }
+    return (uint32_t)r;
+}
+
+/*
+ * One frame of motion toward the target: the speed it wants is the most
+ * it can still brake from in the distance left, sqrt(2 acc d), within
+ * vmax; the speed moves toward that by at most acc. The last step lands
+ * on the target exactly.
+ */
+static void sv_step(servo_id_t id)
+{
+    const sv_cfg_t *c = &sv_cfg[id];
+    int32_t d = (int32_t)(sv_target[id] << 8) - sv_pos[id];
+    int32_t v = sv_vel[id];
+    int32_t ad = (d < 0) ? -d : d;
+
+    if (c->vmax == 0)
+    {
+        sv_pos[id] += d;                                /* no limit: a jump */
+        return;
+    }
+    if (c->acc == 0)
+    {
+        v = (d > c->vmax) ? c->vmax : (d < -c->vmax) ? -c->vmax : d;
+    }
+    else
+    {
+        int32_t want = (int32_t)sv_isqrt(2u * (uint64_t)c->acc * (uint64_t)ad);
+
+        if (want > c->vmax) want = c->vmax;
+        if (d < 0) want = -want;
+        if (v < want - c->acc)      v += c->acc;
+        else if (v > want + c->acc) v -= c->acc;
+        else                        v  = want;
+        if (ad <= c->acc && ((v < 0) ? -v : v) <= c->acc)
+            v = d;                                      /* settle on it */
+    }
+    if ((d > 0 && v > d) || (d < 0 && v < d)) v = d;    /* never past the target */
+    sv_pos[id] += v;
+    sv_vel[id]  = (sv_pos[id] == (int32_t)(sv_target[id] << 8)) ? 0 : v;
+}
+
+/* Frame start: the pulses of the next frame into CCBUF */
+void TCC0_OTHER_Handler(void)
+{
+    bool off;
+
+    IRQSTAT_ENTER(IRQSTAT_SERVO);
+    TCC0_REGS->TCC_INTFLAG = TCC_INTFLAG_OVF_Msk;
+    off = Brownout_Active();
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+    {
+        uint32_t cc = 0u;
+
+        if (!off && !sv_released[i])
+        {
+            if (sv_ramp[i])
+            {
+                sv_pos[i] = (sv_from[i] + Motion_Tick(&sv_run[i])) << 8;
+                sv_ramp[i] = !Motion_Done(&sv_run[i]);
+            }
+            else
+            {
+                sv_step((servo_id_t)i);
+            }
+            cc = (uint32_t)(sv_pos[i] + 128) >> 8;
+        }
+        TCC0_REGS->TCC_CCBUF[sv_cfg[i].wo] = cc;
+    }
+    sv_frames++;
+    IRQSTAT_EXIT(IRQSTAT_SERVO);
+}
+
+static bool sv_tickless_veto(void)
+{
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+        if (!sv_released[i]) return true;
+    return false;
+}
+
+#endif /* SERVO_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Servo_Init(void)
+{
+#if SERVO_ENABLE
+    port_group_registers_t *g = &PORT_REGS->GROUP[SV_GROUP];
+
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+    {
+        sv_target[i]   = SV_US(sv_cfg[i].rest_us);
+        sv_stage[i]    = sv_target[i];
+        sv_pos[i]      = (int32_t)(sv_target[i] << 8);
+        sv_released[i] = true;
+    }
+    sv_lock = xSemaphoreCreateMutexStatic(&sv_lock_buf);
+
+    /* MCC's TCC0 setup, retimed: GCLK0 / 64, SERVO_HZ, every output its own CC */
+    TCC0_PWMInitialize();
+    TCC0_REGS->TCC_CTRLA   = TCC_CTRLA_PRESCALER_DIV64 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC0_REGS->TCC_WEXCTRL = TCC_WEXCTRL_OTMX(0UL);
+    TCC0_REGS->TCC_PER     = SV_PER - 1u;
+    for (uint32_t k = 0; k < 6u; k++)
+        TCC0_REGS->TCC_CC[k] = 0u;
+    TCC0_REGS->TCC_INTENSET = TCC_INTENSET_OVF_Msk;
+    while (TCC0_REGS->TCC_SYNCBUSY != 0u) {}
+
+    /* PB12 + wo -> peripheral G (TCC0 / WO[wo]), low until the first pulse */
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+    {
+        uint32_t pin = SV_PIN0 + sv_cfg[i].wo;
+
+        g->PORT_OUTCLR = 1u << pin;
+        g->PORT_DIRSET = 1u << pin;
+        g->PORT_PMUX[pin >> 1] = (uint8_t)((pin & 1u)
+            ? ((g->PORT_PMUX[pin >> 1] & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(6u))
+            : ((g->PORT_PMUX[pin >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(6u)));
+        g->PORT_PINCFG[pin] |= PORT_PINCFG_PMUXEN_Msk;
+    }
+
+    NVIC_SetPriority(TCC0_OTHER_IRQn, SERVO_IRQ_PRIO);
+    NVIC_EnableIRQ(TCC0_OTHER_IRQn);
+    (void)Tickless_RegisterVeto(sv_tickless_veto);
+    TCC0_PWMStart();
+#endif
+}
+
+bool Servo_StageUs(servo_id_t id, uint16_t us)
+{
+#if SERVO_ENABLE
+    if ((uint32_t)id >= SERVO_COUNT) return false;
+    taskENTER_CRITICAL();
+    sv_stage[id]  = sv_clamp(id, us);
+    sv_staged[id] = true;
+    taskEXIT_CRITICAL();
+    return true;
+#else
+    (void)id;
+    (void)us;
+    return false;
+#endif
+}
+
+bool Servo_Stage(servo_id_t id, uint16_t pos)
+{
+#if SERVO_ENABLE
+    if ((uint32_t)id >= SERVO_COUNT) return false;
+    if (pos > SERVO_POS_FULL) pos = SERVO_POS_FULL;
+    return Servo_StageUs(id, (uint16_t)(sv_cfg[id].min_us
+                         + (uint32_t)(sv_cfg[id].max_us - sv_cfg[id].min_us) * pos / SERVO_POS_FULL));
+#else
+    (void)id;
+    (void)pos;
+    return false;
+#endif
+}
+
+void Servo_Commit(void)
+{
+#if SERVO_ENABLE
+    uint32_t to[SERVO_COUNT];
+    int32_t  from[SERVO_COUNT];
+    bool     go[SERVO_COUNT], plan[SERVO_COUNT];
+
+    if (sv_lock == NULL) return;
+    (void)xSemaphoreTake(sv_lock, portMAX_DELAY);
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+    {
+        go[i]   = sv_staged[i];
+        to[i]   = sv_stage[i];
+        from[i] = (sv_pos[i] + 128) >> 8;
+        plan[i] = go[i] && (sv_released[i] || (!sv_ramp[i] && sv_vel[i] == 0));
+        sv_staged[i] = false;
+    }
+    taskEXIT_CRITICAL();
+
+    /* Servos at rest get a profile (cached: a pose met before is planned) */
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+    {
+        motion_move_t m = { (int32_t)to[i] - from[i], sv_cfg[i].slew, sv_cfg[i].accel,
+                            sv_cfg[i].jerk, SERVO_HZ };
+
+        if (plan[i])
+            plan[i] = sv_cfg[i].vmax != 0 && sv_cfg[i].acc != 0 &&
+                      Motion_Plan(&m, &sv_prof[sv_cur[i] ^ 1u][i]);
+    }
+
+    /* The frame ISR is masked meanwhile: it sees the old set or the new one */
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+    {
+        bool rest = sv_released[i] || (!sv_ramp[i] && sv_vel[i] == 0);
+
+        if (!go[i]) continue;
+        if (rest)
+        {
+            sv_vel[i]  = 0;                             /* limp: from rest where it was */
+            sv_ramp[i] = false;
+        }
+        if (plan[i] && rest && ((sv_pos[i] + 128) >> 8) == from[i])
+        {
+            sv_cur[i] ^= 1u;
+            sv_from[i] = from[i];
+            sv_pos[i]  = from[i] << 8;
+            Motion_Start(&sv_run[i], &sv_prof[sv_cur[i]][i]);
+            sv_ramp[i] = true;
+        }
+        else if (sv_ramp[i])
+        {
+            sv_vel[i]  = Motion_Vel(&sv_run[i]) >> 8;   /* retarget: the tracker takes over */
+            sv_ramp[i] = false;
+        }
+        sv_target[i]   = to[i];
+        sv_released[i] = false;
+    }
+    taskEXIT_CRITICAL();
+    (void)xSemaphoreGive(sv_lock);
+#endif
+}
+
+bool Servo_Set(servo_id_t id, uint16_t pos)
+{
+    if (!Servo_Stage(id, pos)) return false;
+    Servo_Commit();
+    return true;
+}
+
+void Servo_Release(servo_id_t id)
+{
+#if SERVO_ENABLE
+    if ((uint32_t)id < SERVO_COUNT) sv_released[id] = true;
+#else
+    (void)id;
+#endif
+}
+
+void Servo_ReleaseAll(void)
+{
+#if SERVO_ENABLE
+    for (uint32_t i = 0; i < SERVO_COUNT; i++)
+        sv_released[i] = true;
+#endif
+}
+
+bool Servo_Get(servo_id_t id, servo_state_t *out)
+{
+#if SERVO_ENABLE
+    if ((uint32_t)id >= SERVO_COUNT) return false;
+    taskENTER_CRITICAL();
+    out->target_us = (uint16_t)(sv_target[id] * 8u / 15u);
+    out->now_us    = (uint16_t)(((uint32_t)(sv_pos[id] + 128) >> 8) * 8u / 15u);
+    out->released  = sv_released[id];
+    out->moving    = sv_pos[id] != (int32_t)(sv_target[id] << 8);
+    taskEXIT_CRITICAL();
+    return true;
+#else
+    (void)id;
+    (void)out;
+    return false;
+#endif
+}
+
+const char *Servo_Name(servo_id_t id)
+{
+#if SERVO_ENABLE
+    return ((uint32_t)id < SERVO_COUNT) ? sv_cfg[id].name : NULL;
+#else
+    (void)id;
+    return NULL;
+#endif
+}
+
+uint32_t Servo_Frames(void)
+{
+#if SERVO_ENABLE
+    return sv_frames;
+#else
+    return 0u;
+#endif
+}
@@ -0,0 +1,111 @@
+/* =============================================================================
+ * servo.h  -  Hobby servo bank on TCC0: buffered setpoints, slewed in the frame ISR
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The animatronic eyes, lids and jaw (SHOW_SERVOS, showcfg.h) are up to
+ * six hobby servos on the six compare channels of TCC0, one pulse each
+ * per SERVO_HZ frame. TCC0 keeps the setup TCC0_PWMInitialize() gives it
+ * (single-slope PWM, buffered CC, outputs straight on WO0..5), on GCLK0 /
+ * 64, 1.875 MHz: a count is 0.53 us, so 1000..2000 us has ~1900 steps.
+ *
+ *   Pins      PB12..PB17, peripheral G: row `wo` is on PB12 + wo
+ *   Frame     every overflow starts all the pulses together; its
+ *             interrupt, the only work per frame, writes the pulses of
+ *             the frame after it to CCBUF, which TCC0 loads at the next
+ *             overflow. A pulse is never cut or stretched by a late write.
+ *   Motion    a move from rest follows a profile from motion.h, planned
+ *             (or found in its cache) by Servo_Commit(): at most `slew`
+ *             us/s and `accel` us/s^2, S-curved by `jerk` us/s^3 or, with
+ *             jerk 0, a trapezoid; the ISR only steps it. A new target
+ *             while a servo moves hands it to a tracker that keeps its
+ *             position and velocity, Q8 counts, and eases toward the
+ *             target within slew and accel, braking so as to stop on it.
+ *             accel 0 is a plain slew-rate limit, slew 0 a jump. All
+ *             integer, a few dozen cycles per servo.
+ *
+ * Setpoints are double-buffered: Servo_Stage() writes a target into the
+ * staging set, Servo_Commit() hands the whole set to the frame ISR in one
+ * step, so the eyes' two axes (or a whole pose) start in the same frame.
+ * Servo_Set() is the two for one servo. Positions are per mille of a
+ * row's min..max travel.
+ *
+ * A released servo gets no pulses and goes limp; all are released in a
+ * brown-out, by Actuator_Safe() and the e-stop, until their next
+ * setpoint. Standby would stop GCLK0, so tickless idle is vetoed while
+ * any servo is held. "servo" on the console lists and moves them.
+ *
+ * TCC0 is free only with the SPI NeoPixel backend (no NEO_HW_FRAME_START),
+ * and neither ACT_PWM_DRIVE nor ACT_STEPPER_DRIVE. PB12/PB13 are the
+ * pixdist link, PB14/PB15 the show-sync CAN and PB16 the LED rail switch
+ * while those are built.
+ * ============================================================================= */
+
+#ifndef SERVO_H
+#define SERVO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "showcfg.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef SERVO_ENABLE
+#define SERVO_ENABLE            0       /* 1 = servos are wired to PB12..PB17        */
+#endif
+#define SERVO_HZ                50u     /* frame rate; analogue servos want 50       */
+#define SERVO_IRQ_PRIO          IRQ_PRIO_SERVO  /* NVIC, irqprio.h                   */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define SERVO_POS_FULL          1000u   /* per mille of the row's travel             */
+
+typedef enum
+{
+#define SERVO_X_ENUM(id, name, wo, min, max, rest, slew, accel, jerk) SERVO_##id,
+    SHOW_SERVOS(SERVO_X_ENUM)
+#undef SERVO_X_ENUM
+    SERVO_COUNT
+} servo_id_t;
+
+typedef struct
+{
+    uint16_t target_us;         /* committed setpoint                        */
+    uint16_t now_us;            /* pulse of the frame going out              */
+    bool     released;          /* no pulses                                 */
+    bool     moving;
+} servo_state_t;
+
+/**
+ * TCC0 from TCC0_PWMInitialize() at SERVO_HZ, PB12..PB17 for the rows, every
+ * servo released at its rest position. Before the scheduler. Does nothing
+ * unless SERVO_ENABLE.
+ */
+void Servo_Init(void);
+
+/** Stage `pos` (0..SERVO_POS_FULL) for servo `id`; Servo_Commit() applies it. Any task. */
+bool Servo_Stage(servo_id_t id, uint16_t pos);
+
+/** Stage a pulse length in us, clamped to the row's travel. Any task. */
+bool Servo_StageUs(servo_id_t id, uint16_t us);
+
+/** Hand every staged setpoint over at once, from the next frame on. Any task. */
+void Servo_Commit(void);
+
+/** Stage and commit one servo. Any task. */
+bool Servo_Set(servo_id_t id, uint16_t pos);
+
+/** Stop pulsing servo `id` (limp) until its next commit. Any task. */
+void Servo_Release(servo_id_t id);
+
+/** Release every servo. Any context, interrupts included. */
+void Servo_ReleaseAll(void);
+
+/** State of servo `id`; false past the last. Any task. */
+bool Servo_Get(servo_id_t id, servo_state_t *out);
+
+/** Console name of servo `id`, NULL past the last. Any context. */
+const char *Servo_Name(servo_id_t id);
+
+/** Frames sent since Servo_Init(). Any context. */
+uint32_t Servo_Frames(void);
+
+#endif /* SERVO_H */
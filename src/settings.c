@@ -0,0 +1,219 @@
+/* =============================================================================
+ * settings.c  -  Versioned run-time settings in SmartEEPROM
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "settings.h"
+#include "definitions.h"        /* NVMCTRL plib, SEEPROM_ADDR */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "nvwrite.h"
+
+#define SETTINGS_MAGIC      SETTINGS_KEY('C', 'R', 'S', 'E')
+#define SETTINGS_FREE       0xFFFFFFFFu
+#define SETTINGS_PAGE       16u                                 /* bytes, one slot */
+
+#if SETTINGS_SLOTS > 31u
+#error "SETTINGS_SLOTS: the dirty mask is 32 bits and page 0 is the header"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t key;
+    uint32_t value;
+} settings_slot_t;
+
+static settings_slot_t   settings_ram[SETTINGS_SLOTS];
+static volatile uint32_t settings_dirty;       /* bit i: slot i differs from SmartEEPROM */
+static volatile uint32_t settings_writes;
+static bool              settings_ok;
+static bool              settings_buffered;    /* a page in the NVMCTRL buffer, not yet written */
+
+static TimerHandle_t     settings_timer;
+static StaticTimer_t     settings_timer_buf;
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+static volatile uint32_t *settings_page(uint32_t i)
+{
+    return (volatile uint32_t *)(SEEPROM_ADDR + i * SETTINGS_PAGE);
+}
+
+/* One page, committed by the write to the next page or the flush */
+static void settings_write_page(uint32_t i, uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3)
+{
+    volatile uint32_t *p = settings_page(i);
+
+    p[0] = w0;
+    p[1] = w1;
+    p[2] = w2;
+    p[3] = w3;
+}
+
+/* Busy, or made busy by starting the reallocation a full sector needs */
+static bool settings_flash_busy(void)
+{
+    if (NVMCTRL_SmartEEPROM_IsBusy() || NVMCTRL_IsBusy()) return true;    /* or a fwupdate.c erase */
+    if (!NvWrite_Idle()) return true;                                     /* an nvstore save in hand */
+    if (NVMCTRL_SmartEEPROM_IsActiveSectorFull())
+    {
+        NVMCTRL_SmartEEPROMSectorReallocate();
+        return true;
+    }
+    return false;
+}
+
+/* Blank store, or one of another layout: header and every slot free */
+static void settings_format(void)
+{
+    for (uint32_t i = 0; i < SETTINGS_SLOTS; i++)
+    {
+        while (settings_flash_busy()) {}
+        settings_write_page(i + 1u, SETTINGS_FREE, SETTINGS_FREE, SETTINGS_FREE, SETTINGS_FREE);
+        settings_ram[i].key = SETTINGS_FREE;
+    }
+    while (settings_flash_busy()) {}
+    settings_write_page(0u, SETTINGS_MAGIC, SETTINGS_VERSION | (SETTINGS_SLOTS << 16), ~SETTINGS_MAGIC, 0u);
+    NVMCTRL_SmartEEPROMFlushPageBuffer();
+}
+
+static void settings_timer_cb(TimerHandle_t t)
+{
+    (void)t;
+    (void)Settings_Flush();
+}
+
+/* Slot of key, or the first free one; SETTINGS_SLOTS if neither. Under a critical section */
+static uint32_t settings_find(uint32_t key, bool add)
+{
+    uint32_t spare = SETTINGS_SLOTS;
+
+    for (uint32_t i = 0; i < SETTINGS_SLOTS; i++)
+    {
+        if (settings_ram[i].key == key) return i;
+        if (settings_ram[i].key == SETTINGS_FREE && spare == SETTINGS_SLOTS) spare = i;
+    }
+    return add ? spare : SETTINGS_SLOTS;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Settings_Init(void)
+{
+    uint32_t st = NVMCTRL_SmartEEPROMStatusGet();
+    volatile const uint32_t *h;
+
+    settings_ok = false;
+    if (((st & NVMCTRL_SEESTAT_SBLK_Msk) >> NVMCTRL_SEESTAT_SBLK_Pos) == 0u) return false;
+
+    while (NVMCTRL_SmartEEPROM_IsBusy()) {}
+    NVMCTRL_REGS->NVMCTRL_SEECFG = NVMCTRL_SEECFG_WMODE_BUFFERED;      /* auto reallocation on */
+
+    h = settings_page(0u);
+    if (h[0] != SETTINGS_MAGIC || h[2] != ~SETTINGS_MAGIC ||
+        h[1] != (SETTINGS_VERSION | (SETTINGS_SLOTS << 16)))
+        settings_format();
+    else
+    {
+        for (uint32_t i = 0; i < SETTINGS_SLOTS; i++)
+        {
+            volatile const uint32_t *p = settings_page(i + 1u);
+
+            /* A torn slot reads free; its value falls back to the default */
+            settings_ram[i].key   = (p[2] == ~p[1]) ? p[0] : SETTINGS_FREE;
+            settings_ram[i].value = p[1];
+        }
+    }
+
+    settings_timer = xTimerCreateStatic("Settings", pdMS_TO_TICKS(SETTINGS_FLUSH_MS), pdFALSE, NULL,
+                                        settings_timer_cb, &settings_timer_buf);
+    settings_ok = (settings_timer != NULL);
+    return settings_ok;
+}
+
+bool Settings_Ready(void)
+{
+    return settings_ok;
+}
+
+bool Settings_Load(uint32_t key, uint32_t *value)
+{
+    bool found = false;
+
+    if (!settings_ok || key == SETTINGS_FREE) return false;
+    taskENTER_CRITICAL();
+    uint32_t i = settings_find(key, false);
+
+    if (i < SETTINGS_SLOTS)
+    {
+        *value = settings_ram[i].value;
+        found  = true;
+    }
+    taskEXIT_CRITICAL();
+    return found;
+}
+
+bool Settings_Put(uint32_t key, uint32_t value)
+{
+    uint32_t i;
+
+    if (!settings_ok || key == SETTINGS_FREE) return false;
+    taskENTER_CRITICAL();
+    i = settings_find(key, true);
+    if (i < SETTINGS_SLOTS && (settings_ram[i].key != key || settings_ram[i].value != value))
+    {
+        settings_ram[i].key   = key;
+        settings_ram[i].value = value;
+        settings_dirty |= 1u << i;
+    }
+    taskEXIT_CRITICAL();
+    if (i == SETTINGS_SLOTS) return false;
+
+    /* Every change pushes the write back: one batch after the last */
+    if (settings_dirty != 0u)
+        (void)xTimerChangePeriod(settings_timer, pdMS_TO_TICKS(SETTINGS_FLUSH_MS), 0u);
+    return true;
+}
+
+bool Settings_Flush(void)
+{
+    if (!settings_ok) return false;
+
+    for (uint32_t i = 0; i < SETTINGS_SLOTS; i++)
+    {
+        settings_slot_t s;
+
+        if ((settings_dirty & (1u << i)) == 0u) continue;
+        if (settings_flash_busy())
+        {
+            (void)xTimerChangePeriod(settings_timer, pdMS_TO_TICKS(SETTINGS_RETRY_MS), 0u);
+            return false;
+        }
+        taskENTER_CRITICAL();
+        s = settings_ram[i];
+        settings_dirty &= ~(1u << i);
+        taskEXIT_CRITICAL();
+        settings_write_page(i + 1u, s.key, s.value, ~s.value, 0u);
+        settings_writes++;
+        settings_buffered = true;
+    }
+    if (settings_buffered)
+    {
+        if (NVMCTRL_SmartEEPROM_IsBusy())
+        {
+            (void)xTimerChangePeriod(settings_timer, pdMS_TO_TICKS(SETTINGS_RETRY_MS), 0u);
+            return false;
+        }
+        NVMCTRL_SmartEEPROMFlushPageBuffer();   /* the last page */
+        settings_buffered = false;
+    }
+    return true;
+}
+
+uint32_t Settings_Writes(void)
+{
+    return settings_writes;
+}
@@ -0,0 +1,84 @@
+/* =============================================================================
+ * settings.h  -  Versioned run-time settings in SmartEEPROM
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The NVMCTRL SmartEEPROM emulates a small byte-addressable EEPROM
+ * (SEEPROM_ADDR) on two sectors of SETTINGS_SEESBLK flash blocks each at
+ * the very end of flash, and levels the wear itself: every page write goes
+ * to the next free spot of the active sector, and a full sector is copied
+ * to the other one and erased. The fuses in initialization.c
+ * (NVMCTRL_SEESBLK / NVMCTRL_SEEPSZ) must match the values below; without
+ * them SEESTAT.SBLK reads 0, Settings_Init() returns false and the CLI
+ * keeps its parameters in nvstore.h as before.
+ *
+ * Layout, one 16-byte SmartEEPROM page each:
+ *
+ *   page 0       magic, version:u16, slots:u16, ~magic
+ *   page 1..n    key, value, ~value, 0            (key 0xFFFFFFFF = free)
+ *
+ * A slot holds one 32-bit value under a key: a CLI parameter (cli.h, keyed
+ * by a hash of its name), the start-up effect, a wear counter (wear.h),
+ * ... so adding or removing
+ * one needs no layout change. SETTINGS_VERSION only moves when the layout
+ * itself does; a store with another version is formatted, and every value
+ * falls back to its default once.
+ *
+ * Settings_Put() only changes the RAM copy and (re)starts a one-shot
+ * timer; SETTINGS_FLUSH_MS after the last change the timer service task
+ * writes the slots that changed, in buffered mode (one NVM page write per
+ * slot). Dragging a value through twenty steps in the CLI is one write,
+ * not twenty. The flush never waits on the flash: while the SmartEEPROM is
+ * busy, or after it starts a sector reallocation (the one erase, run in
+ * hardware), it retries SETTINGS_RETRY_MS later instead of stalling the
+ * bus.
+ * ============================================================================= */
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define SETTINGS_SEESBLK        1u      /* flash blocks per sector, fuse NVMCTRL_SEESBLK */
+#define SETTINGS_SEEPSZ         2u      /* 16-byte pages, fuse NVMCTRL_SEEPSZ            */
+#define SETTINGS_VERSION        1u      /* layout, not contents                          */
+#define SETTINGS_SLOTS          31u     /* fits the smallest SmartEEPROM, 512 bytes      */
+#define SETTINGS_FLUSH_MS       2000u   /* quiet time before changes are written         */
+#define SETTINGS_RETRY_MS       20u     /* flash busy: try again after                   */
+
+/** Keys of the ones that are not CLI parameters; 0xFFFFFFFF is reserved. */
+#define SETTINGS_KEY(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define SETTINGS_KEY_EFFECT     SETTINGS_KEY('F', 'X', '0', 'S')  /* segment 0 at start-up */
+
+/**
+ * Check the fuses, format the store if it is blank or of another version,
+ * and read every slot into RAM. Before the scheduler, before anything
+ * loads a value. False if SmartEEPROM is not configured.
+ */
+bool Settings_Init(void);
+
+/** True if Settings_Init() found the SmartEEPROM. Any task. */
+bool Settings_Ready(void);
+
+/** Latest value under key (written or only put); false if none. Any task. */
+bool Settings_Load(uint32_t key, uint32_t *value);
+
+/**
+ * Keep value under key; written SETTINGS_FLUSH_MS after the last change.
+ * Never blocks. False if the store is not ready or all slots are taken.
+ * Tasks only.
+ */
+bool Settings_Put(uint32_t key, uint32_t value);
+
+/**
+ * Write the changed slots now. Timer service task only (a pended call);
+ * false if the flash was busy and some are left for the retry.
+ */
+bool Settings_Flush(void);
+
+/** Slot writes since boot, for wear estimates (telemetry). Any task. */
+uint32_t Settings_Writes(void);
+
+#endif /* SETTINGS_H */
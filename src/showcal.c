@@ -0,0 +1,247 @@
+/* =============================================================================
+ * showcal.c  -  Weekly opening hours on the RTC: the prop sleeps when closed
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "showcal.h"
+#include "showcfg.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "tickless.h"
+#include "actuator.h"
+#include "settings.h"
+#include "mode.h"
+#include "log.h"
+
+#define SC_DAY_MIN          (24u * 60u)
+#define SC_MAGIC            0x4C414353u     /* "SCAL" */
+#define SC_KEY(n)           SETTINGS_KEY('C', 'A', 'L', '0' + (n))
+#define SC_X_ROW(d, o, c)   { (d), (o), (c) },
+#define SC_X_ONE(d, o, c)   + 1u
+
+_Static_assert((0u SHOW_HOURS(SC_X_ONE)) <= SHOWCAL_MAX_WINDOWS, "SHOW_HOURS: more rows than SHOWCAL_MAX_WINDOWS");
+_Static_assert(SHOWCAL_MAX_WINDOWS <= 10u, "one settings key per window, CAL0 .. CAL9");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static showcal_window_t sc_win[SHOWCAL_MAX_WINDOWS] = { SHOW_HOURS(SC_X_ROW) };
+static showcal_hook_fn  sc_hook[SHOWCAL_MAX_HOOKS];
+static uint32_t         sc_nhook;
+static TimerHandle_t    sc_timer;
+static StaticTimer_t    sc_timer_buf;
+
+/* Wall clock: whole seconds of the week at RTC count sc_rtc */
+static uint32_t         sc_rtc;
+static uint32_t         sc_secs;
+static bool             sc_valid;
+static volatile bool    sc_open = true;
+static uint32_t         sc_wake_until;          /* sc_secs the arrival's open ends, 0 = none */
+
+/* Backup RAM, NOLOAD like brownout_mark: the clock, to the last check, across a reset */
+static struct
+{
+    uint32_t magic;
+    uint32_t secs;
+} sc_mark __attribute__((section(".bkupram_noinit")));
+
+/* Carry the RTC into the seconds; the timer calls it far more often than the ~36 h wrap */
+static uint32_t sc_secs_now(void)
+{
+    uint32_t s;
+
+    taskENTER_CRITICAL();
+    s        = (Tickless_RtcCount() - sc_rtc) / TICKLESS_RTC_HZ;
+    sc_rtc  += s * TICKLESS_RTC_HZ;
+    sc_secs  = (sc_secs + s) % (SHOWCAL_WEEK_MIN * 60u);
+    s        = sc_secs;
+    taskEXIT_CRITICAL();
+    return s;
+}
+
+static bool sc_day(const showcal_window_t *w, uint32_t day)
+{
+    return (w->days & (1u << (day % 7u))) != 0u;
+}
+
+static bool sc_in(const showcal_window_t *w, uint32_t mow)
+{
+    uint32_t day = mow / SC_DAY_MIN;
+    uint32_t m   = mow % SC_DAY_MIN;
+
+    if (w->open < w->close)
+        return sc_day(w, day) && m >= w->open && m < w->close;
+    return (sc_day(w, day) && m >= w->open)                 /* past midnight */
+        || (sc_day(w, day + 6u) && m < w->close);
+}
+
+static bool sc_should_open(uint32_t secs)
+{
+    bool any = false;
+
+    if (!SHOWCAL_ENABLE || !sc_valid) return true;
+    if (sc_wake_until != 0u)
+    {
+        uint32_t left = (sc_wake_until + SHOWCAL_WEEK_MIN * 60u - secs) % (SHOWCAL_WEEK_MIN * 60u);
+
+        if (left != 0u && left <= SHOWCAL_WAKE_MIN * 60u) return true;
+        sc_wake_until = 0u;
+    }
+    for (uint32_t i = 0; i < SHOWCAL_MAX_WINDOWS; i++)
+    {
+        if (sc_win[i].days == 0u) continue;
+        any = true;
+        if (sc_in(&sc_win[i], secs / 60u)) return true;
+    }
+    return !any;
+}
+
+static void sc_apply(bool open)
+{
+    if (open == sc_open) return;
+    sc_open = open;
+    LOG_INFO("showcal: %s", open ? "open" : "closed");
+    (void)Actuator_Park(!open);
+    Tickless_SetStandby(!open || TICKLESS_STANDBY);
+    for (uint32_t i = 0; i < sc_nhook; i++)
+        sc_hook[i](open);
+}
+
+/* On the minute, timer task; keeps the backup RAM copy fresh too */
+static void sc_check(void)
+{
+    uint32_t secs = sc_secs_now();
+
+    if (sc_valid)
+    {
+        sc_mark.secs  = secs;
+        sc_mark.magic = SC_MAGIC;
+    }
+    sc_apply(sc_should_open(secs));
+    if (sc_timer != NULL)
+        (void)xTimerChangePeriod(sc_timer, pdMS_TO_TICKS((60u - secs % 60u) * 1000u), 0);
+}
+
+static void sc_timer_cb(TimerHandle_t timer)
+{
+    (void)timer;
+    sc_check();
+}
+
+static void sc_ev_check(void *a, uint32_t b)
+{
+    (void)a;
+    (void)b;
+    sc_check();
+}
+
+/* Mode hook, timer task: an arrival while closed opens for SHOWCAL_WAKE_MIN */
+static void sc_mode_changed(mode_id_t from, mode_id_t to)
+{
+    (void)from;
+    if (SHOWCAL_WAKE_MIN == 0u || to != MODE_ARMED || sc_open) return;
+    sc_wake_until = (sc_secs_now() + SHOWCAL_WAKE_MIN * 60u) % (SHOWCAL_WEEK_MIN * 60u);
+    if (sc_wake_until == 0u) sc_wake_until = 1u;
+    LOG_INFO("showcal: woken by an arrival");
+    sc_check();
+}
+
+static uint32_t sc_pack(const showcal_window_t *w)
+{
+    return ((uint32_t)w->days << 24) | ((uint32_t)w->open << 12) | w->close;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void ShowCal_Init(void)
+{
+#if SHOWCAL_ENABLE
+    uint32_t v;
+
+    for (uint32_t i = 0; i < SHOWCAL_MAX_WINDOWS; i++)
+    {
+        if (!Settings_Load(SC_KEY(i), &v)) continue;
+        sc_win[i].days  = (uint8_t)((v >> 24) & SHOW_DAYS_ALL);
+        sc_win[i].open  = (uint16_t)(((v >> 12) & 0xFFFu) % SC_DAY_MIN);
+        sc_win[i].close = (uint16_t)((v & 0xFFFu) % SC_DAY_MIN);
+    }
+
+    sc_rtc = Tickless_RtcCount();
+    if (sc_mark.magic == SC_MAGIC && sc_mark.secs < SHOWCAL_WEEK_MIN * 60u)
+    {
+        sc_secs  = sc_mark.secs;
+        sc_valid = true;
+    }
+
+    (void)Mode_OnChange(sc_mode_changed);
+    sc_timer = xTimerCreateStatic("ShowCal", 1u, pdFALSE, NULL, sc_timer_cb, &sc_timer_buf);
+    if (sc_timer != NULL) (void)xTimerStart(sc_timer, 0u);
+#endif
+}
+
+bool ShowCal_OnChange(showcal_hook_fn hook)
+{
+    if (sc_nhook == SHOWCAL_MAX_HOOKS || hook == NULL) return false;
+    sc_hook[sc_nhook++] = hook;
+    return true;
+}
+
+bool ShowCal_Open(void)
+{
+    return sc_open;
+}
+
+void ShowCal_SetTime(uint32_t mow)
+{
+    taskENTER_CRITICAL();
+    sc_rtc        = Tickless_RtcCount();
+    sc_secs       = (mow % SHOWCAL_WEEK_MIN) * 60u;
+    sc_valid      = true;
+    sc_wake_until = 0u;
+    taskEXIT_CRITICAL();
+    (void)xTimerPendFunctionCall(sc_ev_check, NULL, 0u, 0);
+}
+
+bool ShowCal_Now(uint32_t *mow)
+{
+    *mow = sc_secs_now() / 60u;
+    return sc_valid;
+}
+
+bool ShowCal_GetWindow(uint32_t n, showcal_window_t *out)
+{
+    if (n >= SHOWCAL_MAX_WINDOWS) return false;
+    taskENTER_CRITICAL();
+    *out = sc_win[n];
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+bool ShowCal_SetWindow(uint32_t n, const showcal_window_t *w)
+{
+    showcal_window_t v = { 0u, 0u, 0u };
+
+    if (n >= SHOWCAL_MAX_WINDOWS) return false;
+    if (w->days != 0u)
+    {
+        if (w->open >= SC_DAY_MIN || w->close >= SC_DAY_MIN) return false;
+        v = *w;
+        v.days &= SHOW_DAYS_ALL;
+    }
+    taskENTER_CRITICAL();
+    sc_win[n] = v;
+    taskEXIT_CRITICAL();
+    (void)Settings_Put(SC_KEY(n), sc_pack(&v));
+    (void)xTimerPendFunctionCall(sc_ev_check, NULL, 0u, 0);
+    return true;
+}
+
+uint32_t ShowCal_WakeLeft(void)
+{
+    uint32_t secs  = sc_secs_now();
+    uint32_t until = sc_wake_until;
+    uint32_t left  = (until + SHOWCAL_WEEK_MIN * 60u - secs) % (SHOWCAL_WEEK_MIN * 60u);
+
+    if (until == 0u || left > SHOWCAL_WAKE_MIN * 60u) return 0u;
+    return (left + 59u) / 60u;
+}
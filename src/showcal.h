@@ -0,0 +1,90 @@
+/* =============================================================================
+ * showcal.h  -  Weekly opening hours on the RTC: the prop sleeps when closed
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A wall clock on the RTC count (tickless.h: 32.768 kHz from the ULP
+ * oscillator, runs in every sleep mode) and a week of opening windows,
+ * SHOW_HOURS in showcfg.h or the ones saved from the console:
+ *
+ *   cal                         clock, state, windows
+ *   cal time <day> <hh:mm>      set the clock, day = mon .. sun
+ *   cal win <n> <days> <hh:mm> <hh:mm>
+ *                               window n: days a SHOW_DAY_* mask (0x1f =
+ *                               mon-fri), open and close; "cal win <n>
+ *                               off" drops it. Saved with the settings
+ *
+ * Outside every window the show closes:
+ *
+ *   - the actuator is parked (Actuator_Park()): the lid rests, no random
+ *     schedule, no scare;
+ *   - the LEDs go dark through the ShowCal_OnChange() hooks (main.c folds
+ *     closed into the global brightness), and the renderer sleeps on the
+ *     dark strip;
+ *   - STANDBY is allowed (Tickless_SetStandby()) whatever TICKLESS_STANDBY,
+ *     the vetoes still apply.
+ *
+ * Nothing then runs but the RTC and the EIC: the MCU wakes on the tickless
+ * RTC compare, once a minute for the calendar, and on a sensor edge. An
+ * arrival while closed (MODE_ARMED) opens the show for SHOWCAL_WAKE_MIN
+ * minutes from then, for the staff or a late group: that visitor wakes
+ * it, the next one gets the lid. 0 keeps it closed.
+ *
+ * The clock is checked by a software timer on the minute, in the timer
+ * service task: no task, no stack. It is not a calendar with dates, only
+ * the minute of the week, set by hand; it survives a reset in backup RAM
+ * (to the last minute) but not a power loss, and until it is set the show
+ * is always open. The ULP oscillator is good to a few percent: set the
+ * clock again every week or two.
+ * ============================================================================= */
+
+#ifndef SHOWCAL_H
+#define SHOWCAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef SHOWCAL_ENABLE
+#define SHOWCAL_ENABLE          1       /* 0 = always open, as before         */
+#endif
+#define SHOWCAL_MAX_WINDOWS     4u
+#define SHOWCAL_WAKE_MIN        20u     /* opened by an arrival while closed  */
+#define SHOWCAL_MAX_HOOKS       2u
+
+#define SHOWCAL_WEEK_MIN        (7u * 24u * 60u)
+
+typedef struct
+{
+    uint8_t  days;              /* SHOW_DAY_* bits, 0 = unused */
+    uint16_t open;              /* minute of the day */
+    uint16_t close;             /* at or before open: the next day */
+} showcal_window_t;
+
+/** Open or closed, in the timer task. Must not block. */
+typedef void (*showcal_hook_fn)(bool open);
+
+/** Load the windows, pick the clock up after a reset. After Mode_Init() and Settings_Init(). */
+void ShowCal_Init(void);
+
+/** Add an open / closed hook. Before the scheduler; false if the table is full. */
+bool ShowCal_OnChange(showcal_hook_fn hook);
+
+/** True while the show is open (always, with no clock or no window). Any task. */
+bool ShowCal_Open(void);
+
+/** Set the clock to minute `mow` of the week, 0 = Monday 00:00. Any task. */
+void ShowCal_SetTime(uint32_t mow);
+
+/** Minute of the week now; false if the clock was never set. Any task. */
+bool ShowCal_Now(uint32_t *mow);
+
+/** Window `n`, or false past SHOWCAL_MAX_WINDOWS. Any task. */
+bool ShowCal_GetWindow(uint32_t n, showcal_window_t *out);
+
+/** Replace window `n` (days 0 drops it) and save it with the next settings batch. Any task. */
+bool ShowCal_SetWindow(uint32_t n, const showcal_window_t *w);
+
+/** Minutes the open left by an arrival still runs, 0 if none. Any task. */
+uint32_t ShowCal_WakeLeft(void);
+
+#endif /* SHOWCAL_H */
@@ -0,0 +1,142 @@
+/* =============================================================================
+ * showcfg.h  -  The prop in one table: strips, segments, effects, relays, sensors
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Each list below is an X-macro: a row per item, expanded by the module
+ * that owns it into its enum, its const tables and its compile-time sums.
+ * Nothing here is registered at run time, and the hot path indexes const
+ * tables by enum, as before:
+ *
+ *   SHOW_STRIPS     parallel NeoPixel outputs and their LEDs: NUM_LEDS and
+ *                   NEO_OUTPUTS (neopixel.h). The outputs split the pixel
+ *                   space evenly, so every strip has the same length.
+ *   SHOW_EFFECTS    effect_id_t and the registry with the kernels, frame
+ *                   hooks and default parameters (effects.h / effects.c)
+ *   SHOW_SEGMENTS   the strip layout Effects_Init() starts with; segment 0
+ *                   runs the saved effect instead, if there is one
+ *   SHOW_FRAMES     neo_frame_id_t and the solid frames pre-encoded into
+ *                   flash for NeoPixel_ShowFrame() (neopixel.h)
+ *   SHOW_ACTUATORS  act_channel_t, the relay pins and which channel runs the
+ *                   random / presence schedule (actuator.h / actuator.c)
+ *   SHOW_IOSEQ      the auxiliary outputs the DMA sequencer drives on
+ *                   IOSEQ_GROUP, bit i of a step for row i (ioseq.h)
+ *   SHOW_SERVOS     servo_id_t, the TCC0 output and the travel and motion
+ *                   limits of each hobby servo (servo.h)
+ *   SHOW_SENSORS    the switched-output sensor array on DSUN_ARRAY_GROUP:
+ *                   DSUN_ARRAY_MASK (dsun_sensor.h) and the depths
+ *                   visitor.h orders the arrivals by
+ *   SHOW_HOURS      the weekly opening windows of showcal.h, until the
+ *                   console ("cal win") saves others
+ *
+ * Adding an effect is one row here and its kernel; adding a relay pair or
+ * a sensor is one row and the wiring. The rows only name things: each is
+ * expanded where the symbols it refers to are declared.
+ * ============================================================================= */
+
+#ifndef SHOWCFG_H
+#define SHOWCFG_H
+
+/* -- Strips ------------------------------------------------------------------ */
+/* X(name, leds), in output order (neopixel.h: SERCOM1 PA16 first) */
+#define SHOW_STRIPS(X)                                                          \
+    X(COFFIN,       144)
+
+/* -- Effects ----------------------------------------------------------------- */
+/*
+ * X(id, "name", pixel kernel, frame hook or NULL, prepare hook or NULL,
+ *   kernel animated, speed, brightness, cycles per LED, cycles per frame).
+ * The id becomes EFFECT_<id>; its position is the number the console, the
+ * settings and the show packs use, so append new rows. The two costs are
+ * the worst case of the kernel (with the brightness scale) and of the frame
+ * hook, as the "cost" lines of EFFECTS_BENCH_ENABLE print them; the
+ * renderer admits a scene by them (effects.h).
+ */
+#define SHOW_EFFECTS(X)                                                         \
+    X(GREEN_PURPLE, "green_purple", NeoPixel_GreenPurplePixel, NULL,             NeoPixel_RampPrepare, true,  1u, 255u,  40u,     0u) \
+    X(RAINBOW,      "rainbow",      NeoPixel_RainbowPixel,     NULL,             NeoPixel_RampPrepare, true,  1u, 255u,  48u,     0u) \
+    X(FIRE,         "fire",         NeoPixel_FirePixel,        NULL,             NULL,                 true,  1u, 255u, 160u,     0u) \
+    X(FIRE_SIM,     "fire_sim",     Fire_Pixel,                Fire_Update,      NULL,                 false, 1u, 255u,  24u, 40000u) \
+    X(PARTICLES,    "particles",    Particles_Pixel,           Particles_Update, NULL,                 false, 0u, 255u,  24u, 30000u) /* particles.h pool, usually an additive layer */ \
+    X(TIMELINE,     "timeline",     Timeline_Pixel,            Timeline_Update,  NULL,                 false, 0u, 255u,  16u,   800u) /* timeline.h keyframes, solid colour          */ \
+    X(AUDIO,        "audio",        Audio_Pixel,               Audio_Update,     NULL,                 false, 0u, 255u,  32u,  3000u) /* audio.h spectrum bars, flash on beats       */ \
+    X(DMX,          "dmx",          Dmx_Pixel,                 Dmx_Update,       NULL,                 false, 0u, 255u,  24u,  1500u) /* dmx.h universe from a lighting console      */ \
+    X(NET,          "net",          NetBridge_Pixel,           NetBridge_Update, NULL,                 false, 0u, 255u,  24u,  1500u) /* netbridge.h sACN / Art-Net universes        */
+
+/* Running on segment 0 until one is saved (SETTINGS_KEY_EFFECT) */
+#define SHOW_EFFECT_DEFAULT     GREEN_PURPLE
+
+/* -- Segments ---------------------------------------------------------------- */
+/* X(start, count, effect id), at most EFFECTS_MAX_SEGMENTS; later rows draw over earlier */
+#define SHOW_SEGMENTS(X)                                                        \
+    X(0u, PIXDIST_SCENE_LEDS, SHOW_EFFECT_DEFAULT)
+
+/* -- Constant frames --------------------------------------------------------- */
+/*
+ * X(id, "name", r, g, b, w): every LED at these wire values, no gamma or
+ * brightness; w only on RGBW chips. A row over POWER_BUDGET_MA for the
+ * whole strip fails the build (power.h). SHOW_BOOT_FRAME goes out right
+ * after reset, before the scheduler starts (NeoPixel_ShowBootFrame()).
+ */
+#define SHOW_FRAMES(X)                                                          \
+    X(BLACK, "black",   0u,  0u,  0u, 0u)   /* blackout between strobe flashes */ \
+    X(FLASH, "flash",  88u, 88u, 88u, 0u)   /* scare strobe, 144 LEDs ~1.9 A   */ \
+    X(BLOOD, "blood", 255u,  0u,  0u, 0u)   /* full red                        */ \
+    X(EMBER, "ember",  24u,  4u,  0u, 0u)   /* dim glow: powered, booting      */
+
+#define SHOW_BOOT_FRAME         EMBER
+
+/* -- Actuators --------------------------------------------------------------- */
+/* X(id, "name", PORT group, UP relay pin, DOWN relay pin, runs the schedule) */
+#define SHOW_ACTUATORS(X)                                                       \
+    X(LID, "lid", 0u, PORT_PA20, PORT_PA21, true)  /* RELAY_1 / RELAY_2, TCC1 and the shunt */ \
+    X(AUX, "aux", 1u, PORT_PB06, PORT_PB07, false) /* PRelayIN / PRelayOUT: arm, fog valve  */
+
+/* -- Sequenced outputs ------------------------------------------------------- */
+/* X(id, "name", pin of IOSEQ_GROUP), at most 16; the row is the bit in a step */
+#define SHOW_IOSEQ(X)                                                           \
+    X(FOG,    "fog",    PORT_PB00)  /* fog machine trigger, via its opto         */ \
+    X(STROBE, "strobe", PORT_PB01)  /* strobe MOSFET                             */ \
+    X(KNOCK,  "knock",  PORT_PB02)  /* solenoid knocker inside the lid           */
+
+/* -- Servos ------------------------------------------------------------------ */
+/*
+ * X(id, "name", TCC0 WO 0..5 = PB12..PB17, min us, max us, rest us,
+ *   slew us/s, accel us/s^2; 0 = no limit, jerk us/s^3; 0 = trapezoid),
+ * at most one row per WO
+ */
+#define SHOW_SERVOS(X)                                                          \
+    X(EYE_X, "eye_x", 0u, 1000u, 2000u, 1500u, 4000u, 40000u, 800000u)  /* eyes left / right   */ \
+    X(EYE_Y, "eye_y", 1u, 1200u, 1800u, 1500u, 3000u, 30000u, 600000u)  /* eyes up / down      */ \
+    X(LIDS,  "lids",  2u, 1000u, 2000u, 1000u, 8000u,     0u,      0u)  /* eyelids: snap blink */ \
+    X(JAW,   "jaw",   3u, 1100u, 1900u, 1100u, 5000u, 60000u,      0u)  /* jaw, with the sound */
+
+/* -- Sensors ----------------------------------------------------------------- */
+/* X(id, pin of DSUN_ARRAY_GROUP, depth: 0 = furthest out along the walkway) */
+#define SHOW_SENSORS(X)                                                         \
+    X(PRESENCE,     19u, 1u)        /* PA19 = DSUN_SENSOR_PIN */
+
+/* -- Opening hours ----------------------------------------------------------- */
+/*
+ * X(days, open, close): SHOW_DAY_* bits, minutes of the day (SHOW_HM());
+ * a close at or before the open runs past midnight. At most
+ * SHOWCAL_MAX_WINDOWS rows; none, or no clock set, means always open.
+ */
+#define SHOW_HOURS(X)                                                           \
+    X(SHOW_DAYS_ALL, SHOW_HM(17, 0), SHOW_HM(23, 30))
+
+#define SHOW_DAY_MON            0x01u
+#define SHOW_DAY_TUE            0x02u
+#define SHOW_DAY_WED            0x04u
+#define SHOW_DAY_THU            0x08u
+#define SHOW_DAY_FRI            0x10u
+#define SHOW_DAY_SAT            0x20u
+#define SHOW_DAY_SUN            0x40u
+#define SHOW_DAYS_ALL           0x7Fu
+#define SHOW_HM(h, m)           ((h) * 60u + (m))
+
+/* -- Expansion helpers ------------------------------------------------------- */
+#define SHOW_CAT(a, b)          SHOW_CAT_(a, b)
+#define SHOW_CAT_(a, b)         a##b
+#define SHOW_X_ONE(...)         + 1u
+
+#endif /* SHOWCFG_H */
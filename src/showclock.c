@@ -0,0 +1,97 @@
+/* =============================================================================
+ * showclock.c  -  The microsecond timebase: show cues, intervals, deadlines
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "showclock.h"
+#include "definitions.h"        /* TC0_REGS, MCLK, GCLK */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "irqstat.h"
+#include "hrtimer.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t shc_hi;        /* TC0 overflows: the high word of ShowClock_Now64() */
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* Caller masks interrupts: one READSYNC at a time */
+static uint32_t shc_read(void)
+{
+    TC0_REGS->COUNT32.TC_CTRLBSET = TC_CTRLBSET_CMD_READSYNC;
+    while ((TC0_REGS->COUNT32.TC_SYNCBUSY & (TC_SYNCBUSY_CTRLB_Msk | TC_SYNCBUSY_COUNT_Msk)) != 0u) {}
+    return TC0_REGS->COUNT32.TC_COUNT;
+}
+
+/* The carry, and the CC1 match of hrtimer.h (or the vector it pended) */
+void TC0_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+    uint8_t    flags;
+
+    IRQSTAT_ENTER(IRQSTAT_SHOWCLOCK);
+    flags = TC0_REGS->COUNT32.TC_INTFLAG & (TC_INTFLAG_OVF_Msk | TC_INTFLAG_MC1_Msk);
+    TC0_REGS->COUNT32.TC_INTFLAG = flags;
+    if ((flags & TC_INTFLAG_OVF_Msk) != 0u) shc_hi++;
+    HrTimer_Isr(&woken);
+    IRQSTAT_EXIT(IRQSTAT_SHOWCLOCK);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void ShowClock_Init(void)
+{
+    /* TC0 is the COUNT32 master, TC1 its slave; both need their bus clock */
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_TC0_Msk | MCLK_APBAMASK_TC1_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TC0_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[TC0_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    TC0_REGS->COUNT32.TC_CTRLA = TC_CTRLA_SWRST_Msk;
+    while ((TC0_REGS->COUNT32.TC_SYNCBUSY & TC_SYNCBUSY_SWRST_Msk) != 0u) {}
+
+    /* Free running up-counter, no top, no interrupts; an event on TC0 EVU
+     * stamps the count into CC0 (ShowClock_Stamp()) */
+    TC0_REGS->COUNT32.TC_CTRLA  = TC_CTRLA_MODE_COUNT32 | TC_CTRLA_PRESCALER_DIV1 | TC_CTRLA_CAPTEN0_Msk;
+    TC0_REGS->COUNT32.TC_EVCTRL = TC_EVCTRL_TCEI_Msk | TC_EVCTRL_EVACT_STAMP;
+    TC0_REGS->COUNT32.TC_INTFLAG  = TC_INTFLAG_Msk;
+    TC0_REGS->COUNT32.TC_INTENSET = TC_INTENSET_OVF_Msk;     /* the 64-bit carry */
+    TC0_REGS->COUNT32.TC_CTRLA |= TC_CTRLA_ENABLE_Msk;
+    while ((TC0_REGS->COUNT32.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    NVIC_SetPriority(TC0_IRQn, SHOWCLOCK_IRQ_PRIO);
+    NVIC_ClearPendingIRQ(TC0_IRQn);
+    NVIC_EnableIRQ(TC0_IRQn);
+}
+
+uint32_t ShowClock_Now(void)
+{
+    uint32_t t;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    t = shc_read();
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return t;
+}
+
+uint64_t ShowClock_Now64(void)
+{
+    uint32_t hi, t;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();   /* holds TC0_Handler off too */
+
+    t  = shc_read();
+    hi = shc_hi;
+    if ((TC0_REGS->COUNT32.TC_INTFLAG & TC_INTFLAG_OVF_Msk) != 0u)
+    {
+        t = shc_read();             /* wrapped, carry not taken yet: t is past the wrap now */
+        hi++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return ((uint64_t)hi << 32) | t;
+}
+
+uint32_t ShowClock_Stamp(void)
+{
+    return TC0_REGS->COUNT32.TC_CC[0];
+}
@@ -0,0 +1,113 @@
+/* =============================================================================
+ * showclock.h  -  The microsecond timebase: show cues, intervals, deadlines
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * TC0 + TC1 chained as one 32-bit counter run free from GCLK2 (DFLL48M / 48
+ * = 1 MHz), so ShowClock_Now() is a hardware microsecond count that no task
+ * can delay or stretch. It wraps every ~71.6 minutes; compare times only
+ * through differences (ShowClock_Until()), which stay correct across the
+ * wrap for anything under ~35 minutes apart.
+ *
+ * Every time-based show element takes its start on this clock: the
+ * timeline renderer interpolates at the show time of each frame, and
+ * actuator sequences can be queued to start at a show time. A cue that
+ * should land together picks one time a little ahead:
+ *
+ *   uint32_t t = ShowClock_Now() + SHOWCLOCK_CUE_LEAD_US;
+ *   Timeline_PlayAt(&flash, t);
+ *   Actuator_TriggerAt(ACT_CH_LID, slam, t);
+ *
+ * Both then start on the same frame every run, whatever the task load.
+ *
+ * It is also the timebase for anything that measures short intervals
+ * independent of how often it is called (sensor debouncing, pulse widths,
+ * SD command latency): take ShowClock_Now() once, then test
+ * ShowClock_Since() against a limit, or set a ShowClock_Deadline() and poll
+ * ShowClock_Expired(). A wait for a show time blocks for
+ * ShowClock_TicksUntil() RTOS ticks and checks the clock again on waking.
+ *
+ * Time that must not wrap (uptime, logs read back days later) comes from
+ * ShowClock_Now64(): the TC0 overflow interrupt carries the count into a
+ * high word, once every ~71.6 minutes. Like the count itself it pauses in
+ * STANDBY (tickless.h); the RTOS tick is corrected for the sleep, so wall
+ * time over hours (wear.h) stays on the tick.
+ *
+ * CC1 is the compare of the microsecond callbacks (hrtimer.h), which
+ * share the TC0 vector with the carry.
+ *
+ * SysTick belongs to FreeRTOS alone (xPortSysTickHandler in the vector
+ * table); there is no SysTick plib. The tick is for blocking; anything in
+ * microseconds is read here.
+ * ============================================================================= */
+
+#ifndef SHOWCLOCK_H
+#define SHOWCLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"           /* TickType_t, configTICK_RATE_HZ */
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define SHOWCLOCK_CUE_LEAD_US   40000u  /* lead for a cue: > one frame + command latency */
+#define SHOWCLOCK_IRQ_PRIO      IRQ_PRIO_SHOWCLOCK  /* the carry and hrtimer.h, irqprio.h */
+
+#define SHOWCLOCK_US_PER_TICK   (1000000u / configTICK_RATE_HZ)
+
+/** Start the counter. Call after SYS_Initialize(), before anything reads it. */
+void ShowClock_Init(void);
+
+/** Current show time in microseconds (wraps at 2^32). Any task or ISR. */
+uint32_t ShowClock_Now(void);
+
+/**
+ * Show time in microseconds as 64 bits, whose low word is ShowClock_Now();
+ * never wraps. Any task or ISR at or below configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ */
+uint64_t ShowClock_Now64(void);
+
+/**
+ * Show time captured by hardware at the latest event routed through EVSYS
+ * to EVENT_ID_USER_TC0_EVU, with no interrupt latency in it. Any task or ISR.
+ */
+uint32_t ShowClock_Stamp(void);
+
+/** Signed microseconds from now until show time t (negative once past). */
+static inline int32_t ShowClock_Until(uint32_t t)
+{
+    return (int32_t)(t - ShowClock_Now());
+}
+
+/** Microseconds elapsed since show time t (correct across the wrap). */
+static inline uint32_t ShowClock_Since(uint32_t t)
+{
+    return ShowClock_Now() - t;
+}
+
+/** Show time `us` microseconds from now (under ~35 minutes). */
+static inline uint32_t ShowClock_Deadline(uint32_t us)
+{
+    return ShowClock_Now() + us;
+}
+
+/** True once show time t is reached. */
+static inline bool ShowClock_Expired(uint32_t t)
+{
+    return ShowClock_Until(t) <= 0;
+}
+
+/** Microseconds (below 2^31) as RTOS ticks, to the nearest tick. */
+static inline TickType_t ShowClock_UsToTicks(uint32_t us)
+{
+    return (TickType_t)((us + SHOWCLOCK_US_PER_TICK / 2u) / SHOWCLOCK_US_PER_TICK);
+}
+
+/** Ticks to block until show time t, to the nearest tick; 0 once due. */
+static inline TickType_t ShowClock_TicksUntil(uint32_t t)
+{
+    int32_t us = ShowClock_Until(t);
+
+    return (us > 0) ? ShowClock_UsToTicks((uint32_t)us) : 0u;
+}
+
+#endif /* SHOWCLOCK_H */
@@ -0,0 +1,323 @@
+/* =============================================================================
+ * showscript.c  -  One show, one timeline: the compiled cue stream player
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "showscript.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "hrtimer.h"
+#include "showclock.h"
+#include "showsync.h"           /* SHOWSYNC_PICK */
+#include "actuator.h"
+#include "sound.h"
+#include "assets.h"
+#include "assetcache.h"
+#include "effects.h"
+#include "timeline.h"
+#include "ioseq.h"
+#include <string.h>
+
+#define SCR_HEADER          16u
+#define SCR_TL_ENTRY        8u
+#define SCR_DONE            0xFFFFu         /* cursor: nothing more of its kind */
+
+/* The stream as mkshow.py writes it; XC32 lays these out without padding */
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t cues;
+    uint16_t timelines;
+    uint16_t reserved;
+    uint32_t loop_us;
+} scr_header_t;
+
+typedef struct
+{
+    uint32_t t_us;
+    uint8_t  kind;
+    uint8_t  a, b, c, d, e;
+    uint16_t w;
+} scr_cue_t;
+
+typedef struct
+{
+    uint32_t offset;
+    uint16_t keys;
+    uint8_t  loop;
+    uint8_t  reserved;
+} scr_tl_entry_t;
+
+_Static_assert(sizeof(scr_header_t) == SCR_HEADER, "show header is 16 bytes");
+_Static_assert(sizeof(scr_cue_t) == 12u, "show cue is 12 bytes");
+_Static_assert(sizeof(scr_tl_entry_t) == SCR_TL_ENTRY, "show timeline entry is 8 bytes");
+_Static_assert(sizeof(((showscript_status_t *)0)->name) == sizeof(((asset_t *)0)->name),
+               "status name holds an asset name");
+_Static_assert(sizeof(timeline_key_t) == 8u, "mkshow.py writes 8-byte keys");
+
+/* Cursors: the cues handed over ahead of their time, and the ones at it */
+enum { SCR_TIMED = 0, SCR_NOW, SCR_CURSORS };
+
+typedef struct
+{
+    uint16_t i;                 /* next cue of this kind, SCR_DONE */
+    uint32_t base;              /* show time of this pass's t_us 0 */
+    uint32_t passes;
+} scr_cursor_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const scr_cue_t  *scr_cue;
+static uint16_t          scr_cues;
+static uint32_t          scr_loop_us;
+static scr_cursor_t      scr_cur[SCR_CURSORS];
+static timeline_t        scr_tl[SHOWSCRIPT_TIMELINES];
+static uint16_t          scr_tls;
+static bool              scr_tl_started;
+static hrtimer_t         scr_timer;
+static bool              scr_ready;
+static showscript_status_t scr_status;
+
+static uint8_t scr_class(uint8_t kind)
+{
+    return (kind == SHOWSCRIPT_EFFECT || kind == SHOWSCRIPT_IOSEQ) ? SCR_NOW : SCR_TIMED;
+}
+
+static uint32_t scr_lead(uint8_t c)
+{
+    return (c == SCR_TIMED) ? SHOWCLOCK_CUE_LEAD_US : 0u;
+}
+
+/* Move cursor `c` onto its next cue, into the next pass with a loop. Critical section held */
+static void scr_seek(uint8_t c)
+{
+    scr_cursor_t *k = &scr_cur[c];
+
+    for (uint32_t wrap = 0; wrap < 2u; wrap++)
+    {
+        while (k->i < scr_cues && scr_class(scr_cue[k->i].kind) != c) k->i++;
+        if (k->i < scr_cues) return;
+        if (scr_loop_us == 0u) break;
+        k->base += scr_loop_us;
+        k->i     = 0u;
+        k->passes++;
+    }
+    k->i = SCR_DONE;                            /* none of its kind, or the end */
+}
+
+/* The cursor due first, SCR_CURSORS when both are done. Critical section held */
+static uint8_t scr_first(uint32_t *due)
+{
+    uint8_t first = SCR_CURSORS;
+
+    for (uint8_t c = 0; c < SCR_CURSORS; c++)
+    {
+        const scr_cursor_t *k = &scr_cur[c];
+        uint32_t            d;
+
+        if (k->i == SCR_DONE) continue;
+        d = k->base + scr_cue[k->i].t_us - scr_lead(c);
+        if (first == SCR_CURSORS || (int32_t)(d - *due) < 0)
+        {
+            first = c;
+            *due  = d;
+        }
+    }
+    return first;
+}
+
+/* Hand cue `q` over for show time `at` */
+static bool scr_run(const scr_cue_t *q, uint32_t at)
+{
+    switch (q->kind)
+    {
+    case SHOWSCRIPT_ACT:
+    {
+        const act_step_t *seq = (q->b == SHOWSYNC_PICK) ? NULL : Actuator_Pattern(q->b);
+
+        if (q->a >= ACT_CHANNELS || (seq == NULL && q->b != SHOWSYNC_PICK)) return false;
+        return Actuator_TriggerAt((act_channel_t)q->a, seq, at);
+    }
+    case SHOWSCRIPT_SOUND:
+    {
+        int32_t wait = ShowClock_Until(at);
+
+        AssetCache_PrefetchSound(q->a);         /* the lead covers the copy */
+        return Sound_Cue(q->a, q->w, (wait > 0) ? ((uint32_t)wait + 500u) / 1000u : 0u);
+    }
+    case SHOWSCRIPT_TIMELINE:
+        if (q->a >= scr_tls) return false;
+        Timeline_PlayAt(&scr_tl[q->a], at);
+        scr_tl_started = true;
+        return true;
+    case SHOWSCRIPT_EFFECT:
+    {
+        effect_cmd_t cmd = { q->a, q->b, q->c, q->d, q->e, q->w };
+
+        return Effects_Post(&cmd);
+    }
+    case SHOWSCRIPT_IOSEQ:
+        return IoSeq_Pattern((ioseq_pattern_t)q->a);
+    default:
+        return false;
+    }
+}
+
+/* Timer task: every cue due, then the timer on the next */
+static void scr_walk(hrtimer_t *t, void *arg)
+{
+    (void)arg;
+
+    for (;;)
+    {
+        const scr_cue_t *q;
+        uint32_t         due = 0u, at;
+        uint8_t          c;
+
+        taskENTER_CRITICAL();
+        c = scr_first(&due);
+        if (c == SCR_CURSORS)
+        {
+            scr_status.playing = false;
+            taskEXIT_CRITICAL();
+            return;
+        }
+        if (ShowClock_Until(due) > 0)
+        {
+            HrTimer_StartAt(t, due, 0u);
+            taskEXIT_CRITICAL();
+            return;
+        }
+        q  = &scr_cue[scr_cur[c].i];
+        at = scr_cur[c].base + q->t_us;
+        scr_cur[c].i++;
+        scr_seek(c);
+        scr_status.passes = (scr_cur[SCR_TIMED].passes > scr_cur[SCR_NOW].passes)
+                          ? scr_cur[SCR_TIMED].passes : scr_cur[SCR_NOW].passes;
+        taskEXIT_CRITICAL();
+
+        /* Outside: a Play or Stop meanwhile lets this one cue still run */
+        if (ShowClock_Until(at) < 0) scr_status.late++;
+        if (scr_run(q, at)) scr_status.done++;
+        else                scr_status.refused++;
+    }
+}
+
+/* Header, cue table and timelines inside `size`; the timelines into scr_tl */
+static bool scr_load(const uint8_t *p, uint32_t size)
+{
+    const scr_header_t   *h = (const scr_header_t *)p;
+    const scr_tl_entry_t *e;
+    uint32_t              end;
+
+    if (p == NULL || ((uintptr_t)p & 3u) != 0u || size < SCR_HEADER) return false;
+    if (h->magic != SHOWSCRIPT_MAGIC || h->version != SHOWSCRIPT_VERSION) return false;
+    if (h->cues == 0u || h->cues >= SCR_DONE || h->timelines > SHOWSCRIPT_TIMELINES) return false;
+
+    end = SCR_HEADER + (uint32_t)h->cues * sizeof(scr_cue_t) + (uint32_t)h->timelines * SCR_TL_ENTRY;
+    if (end > size) return false;
+
+    e = (const scr_tl_entry_t *)(p + SCR_HEADER + (uint32_t)h->cues * sizeof(scr_cue_t));
+    for (uint32_t i = 0; i < h->timelines; i++)
+    {
+        if ((e[i].offset & 3u) != 0u || e[i].offset < end || e[i].keys == 0u ||
+            e[i].offset + (uint32_t)e[i].keys * sizeof(timeline_key_t) > size) return false;
+    }
+
+    scr_cue     = (const scr_cue_t *)(p + SCR_HEADER);
+    scr_cues    = h->cues;
+    scr_loop_us = h->loop_us;
+    scr_tls     = h->timelines;
+    for (uint32_t i = 0; i < h->timelines; i++)
+    {
+        scr_tl[i].keys  = (const timeline_key_t *)(p + e[i].offset);
+        scr_tl[i].count = e[i].keys;
+        scr_tl[i].loop  = e[i].loop != 0u;
+    }
+    return true;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool ShowScript_PlayAt(const void *data, uint32_t size, uint32_t at)
+{
+    uint32_t due = 0u;
+    bool     ok;
+
+    if (!scr_ready)
+    {
+        HrTimer_Create(&scr_timer, scr_walk, NULL, HRTIMER_TASK);
+        scr_ready = true;
+    }
+    ShowScript_Stop();
+
+    taskENTER_CRITICAL();
+    ok = scr_load(data, size);
+    if (ok)
+    {
+        memset(&scr_status, 0, sizeof(scr_status));
+        scr_status.playing   = true;
+        scr_status.cues      = scr_cues;
+        scr_status.timelines = scr_tls;
+        scr_status.loop_us   = scr_loop_us;
+        for (uint8_t c = 0; c < SCR_CURSORS; c++)
+        {
+            scr_cur[c].i      = 0u;
+            scr_cur[c].base   = at;
+            scr_cur[c].passes = 0u;
+            scr_seek(c);
+        }
+        if (scr_first(&due) != SCR_CURSORS) HrTimer_StartAt(&scr_timer, due, 0u);
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+bool ShowScript_Play(const void *data, uint32_t size)
+{
+    return ShowScript_PlayAt(data, size, ShowClock_Now() + SHOWCLOCK_CUE_LEAD_US);
+}
+
+bool ShowScript_PlayAsset(const char *name)
+{
+    asset_t a;
+
+    if (!Assets_Find(name, &a) || a.kind != ASSET_SHOW) return false;
+    if (!ShowScript_Play(a.data, a.size)) return false;
+
+    taskENTER_CRITICAL();
+    memcpy(scr_status.name, a.name, sizeof(scr_status.name));       /* both NUL-terminated, one size */
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+void ShowScript_Stop(void)
+{
+    bool tl;
+
+    if (!scr_ready) return;
+
+    taskENTER_CRITICAL();
+    (void)HrTimer_Stop(&scr_timer);
+    scr_cur[SCR_TIMED].i = SCR_DONE;
+    scr_cur[SCR_NOW].i   = SCR_DONE;
+    scr_status.playing   = false;
+    tl                   = scr_tl_started;
+    scr_tl_started       = false;
+    taskEXIT_CRITICAL();
+
+    if (tl) Timeline_Play(NULL);                /* its keys may be about to go */
+}
+
+bool ShowScript_Playing(void)
+{
+    return scr_status.playing;
+}
+
+void ShowScript_GetStatus(showscript_status_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = scr_status;
+    taskEXIT_CRITICAL();
+}
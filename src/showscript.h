@@ -0,0 +1,90 @@
+/* =============================================================================
+ * showscript.h  -  One show, one timeline: the compiled cue stream player
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A show is written as a script of timed cues for the LEDs, the relays,
+ * the sound and the auxiliary outputs, and compiled on the host by
+ * tools/mkshow.py into a cue stream that goes into the asset image
+ * (ASSET_SHOW). Everything a cue needs is resolved by the compiler, so
+ * there is nothing to parse here:
+ *
+ *   header    'C' 'R' 'S' 'H'  version(u16)  cues(u16)  timelines(u16)
+ *             reserved(u16)  loop_us(u32)
+ *   cue       t_us(u32) kind(u8) a b c d e(u8) w(u16), ascending t_us
+ *   timeline  offset(u32) keys(u16) loop(u8) reserved(u8)
+ *   keys      timeline_key_t, 8 bytes each, at `offset` from the stream
+ *
+ * all little-endian, 12 bytes per cue. The stream is played where it is,
+ * in the QSPI window; only the timeline_t of each timeline is kept in RAM,
+ * pointing at its keys there.
+ *
+ * The player walks the stream against the show clock on a HRTIMER_TASK
+ * timer (hrtimer.h), one callback per cue time, the cues then handed over
+ * as they are: an actuator pattern, a sound cue, a timeline start or an
+ * effect command. Cues that take a show time (act, sound, timeline) are
+ * handed over SHOWCLOCK_CUE_LEAD_US before theirs, so they land on it;
+ * the others (effects, ioseq) go at their time and take effect at the
+ * next frame or at once. Each kind keeps its own cursor, so the cost per
+ * cue is the same however long the show is.
+ *
+ * With loop_us the show restarts that long after its start, on the same
+ * clock, so the passes do not drift. The gates of each output still
+ * apply: a refused cue (brown-out, parked, queue full) is counted and the
+ * show goes on.
+ * ============================================================================= */
+
+#ifndef SHOWSCRIPT_H
+#define SHOWSCRIPT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define SHOWSCRIPT_MAGIC        0x48535243u     /* "CRSH" */
+#define SHOWSCRIPT_VERSION      1u
+#define SHOWSCRIPT_TIMELINES    8u              /* timelines per show (mkshow.py MAX_TIMELINES) */
+
+/* Cue kinds; a..e and w per kind */
+#define SHOWSCRIPT_ACT          1u      /* a channel, b pattern (SHOWSYNC_PICK: random)    */
+#define SHOWSCRIPT_SOUND        2u      /* a cue id, w gain                                */
+#define SHOWSCRIPT_EFFECT       3u      /* effect_cmd_t: a op, b index, c id, d mode,
+                                           e value, w frames                               */
+#define SHOWSCRIPT_TIMELINE     4u      /* a timeline                                      */
+#define SHOWSCRIPT_IOSEQ        5u      /* a ioseq_pattern_t                               */
+
+typedef struct
+{
+    bool     playing;
+    uint16_t cues;
+    uint16_t timelines;
+    uint32_t loop_us;           /* 0 = once                     */
+    uint32_t passes;            /* loops started                */
+    uint32_t done;              /* cues handed over             */
+    uint32_t refused;           /* ...and turned down           */
+    uint32_t late;              /* handed over after their time */
+    char     name[21];          /* asset, "" for ShowScript_Play() */
+} showscript_status_t;
+
+/**
+ * Play the cue stream `data` (`size` bytes, left in place while it plays)
+ * from show time `at`, stopping whatever played. False if it is not a
+ * valid stream. Any task.
+ */
+bool ShowScript_PlayAt(const void *data, uint32_t size, uint32_t at);
+
+/** ShowScript_PlayAt() SHOWCLOCK_CUE_LEAD_US from now. Any task. */
+bool ShowScript_Play(const void *data, uint32_t size);
+
+/** ShowScript_Play() of the ASSET_SHOW asset `name`. Any task. */
+bool ShowScript_PlayAsset(const char *name);
+
+/** Stop the show; cues already handed over still run. Any task. */
+void ShowScript_Stop(void);
+
+/** A show is playing (false once one without loop ended). Any task. */
+bool ShowScript_Playing(void);
+
+/** Progress and counters of the current or last show. Any task. */
+void ShowScript_GetStatus(showscript_status_t *out);
+
+#endif /* SHOWSCRIPT_H */
@@ -0,0 +1,827 @@
+/* =============================================================================
+ * showsync.c  -  CAN FD show-sync network: shared show time and cues across props
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "showsync.h"
+#include "showclock.h"
+#include "actuator.h"
+#include "sound.h"
+#include "assetcache.h"
+#include "timeline.h"
+#include "cli.h"
+#include "tickless.h"
+#include "definitions.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "irqstat.h"
+#include "loadtest.h"
+#include <string.h>
+
+/* Message types, first data byte */
+#define SS_MSG_SYNC         1u          /* seq                               */
+#define SS_MSG_FOLLOW       2u          /* seq, network time SYNC left at    */
+#define SS_MSG_HELLO        3u
+#define SS_MSG_DELAY_REQ    4u          /* seq                               */
+#define SS_MSG_DELAY_RESP   5u          /* requester, seq, network time it arrived */
+#define SS_MSG_CUE          0x10u       /* + showsync_kind_t: time, args     */
+
+/* Standard IDs: class | node, a lower ID wins arbitration */
+#define SS_ID_SYNC          0x080u
+#define SS_ID_CUE           0x100u
+#define SS_ID_HELLO         0x200u
+#define SS_ID_FIRST         0x080u      /* hardware filter range */
+#define SS_ID_LAST          0x2FFu
+#define SS_ID_NODE_MSK      0x03Fu
+#define SS_ID_TXE           0u          /* queue only: our SYNC left the controller */
+#define SS_ID_WAKE          1u          /* queue only: a local effect cue was added */
+
+#define SS_DATA             12u         /* element data field (F0DS / TBDS = 12 bytes) */
+#define SS_DATA_DLC         9u
+#define SS_ELEM_WORDS       (2u + SS_DATA / 4u)
+#define SS_RX_FIFO          16u
+#define SS_TX_FIFO          4u
+#define SS_TX_EVENTS        4u
+#define SS_QUEUE_LEN        16u
+#define SS_FX_SLOTS         4u
+
+#define SS_BIT_US           2u          /* timestamp counter: one 500 kbit/s bit time */
+#define SS_MM_DELAY         0x80u       /* TX event marker: DELAY_REQ, else SYNC seq   */
+#define SS_DELAY_MAX_US     1000        /* larger path delay samples are discarded      */
+#define SS_DRIFT_MAX_Q24    167772      /* 1 %, free-running DFLL worst case          */
+
+typedef struct
+{
+    uint16_t id;
+    uint8_t  len;
+    uint8_t  data[SS_DATA];
+    uint32_t at;                        /* local show time of start of frame */
+} ss_frame_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Network time = local + offset + drift * (local - anchor), drift in Q24 */
+static int32_t  ss_offset;
+static int32_t  ss_drift_q24;
+static uint32_t ss_anchor;
+
+static uint8_t           ss_node;
+static volatile uint8_t  ss_master;
+static volatile bool     ss_locked;
+static volatile int32_t  ss_err_us;
+static volatile uint32_t ss_steps;
+static volatile int32_t  ss_delay_us;           /* master -> us path delay, two-way */
+static volatile uint32_t ss_bus_errors;
+
+#if SHOWSYNC_ENABLE
+
+/* Message RAM: the controller addresses it with 16-bit offsets from 0x20000000 */
+typedef struct
+{
+    uint32_t sidf[1];
+    uint32_t rxf0[SS_RX_FIFO][SS_ELEM_WORDS];
+    uint32_t txef[SS_TX_EVENTS][2];
+    uint32_t txb[SS_TX_FIFO][SS_ELEM_WORDS];
+} ss_mram_t;
+
+static ss_mram_t ss_mram __ALIGNED(4);
+
+#define SS_STACK            (configMINIMAL_STACK_SIZE * 2u)
+
+static StackType_t   ss_stack[SS_STACK];
+static StaticTask_t  ss_tcb;
+static StaticQueue_t ss_queue_buf;
+static uint8_t       ss_queue_store[SS_QUEUE_LEN * sizeof(ss_frame_t)];
+static QueueHandle_t ss_queue;
+
+static volatile TickType_t ss_master_tick;     /* master last heard (or boot) */
+static TickType_t    ss_seen[SS_ID_NODE_MSK + 1u];
+static uint64_t      ss_seen_mask;
+static volatile uint8_t ss_peers;
+
+static uint8_t       ss_tx_seq;                 /* our latest SYNC      */
+static uint8_t       ss_rx_seq;                 /* the master's latest  */
+static uint32_t      ss_rx_at;
+static bool          ss_rx_valid;
+static uint32_t      ss_last_at;                /* previous servo sample */
+
+/* Two-way delay: the latest SYNC gave the forward leg, DELAY_REQ the way back */
+static int32_t       ss_fwd;                    /* net(t2) - t1             */
+static bool          ss_fwd_valid;
+static uint8_t       ss_dreq_seq;
+static uint32_t      ss_dreq_t3;                /* network time it left     */
+static bool          ss_dreq_valid;
+static uint8_t       ss_dreq_wait;              /* periods to the next one  */
+static bool          ss_delay_valid;
+
+static const timeline_t *ss_timeline[SHOWSYNC_TIMELINES];
+
+typedef struct
+{
+    bool         used;
+    uint32_t     at;                            /* local show time */
+    effect_cmd_t cmd;
+} ss_fx_t;
+
+static ss_fx_t ss_fx[SS_FX_SLOTS];
+
+static const cli_param_t ss_node_param =
+{
+    "node", &ss_node, CLI_U8, 1u, SS_ID_NODE_MSK, NULL, "show-sync ID, unique, the lowest one is master"
+};
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif /* SHOWSYNC_ENABLE */
+
+/* -- Network time ------------------------------------------------------------ */
+
+/* Caller holds the critical section */
+static uint32_t ss_net_locked(uint32_t local)
+{
+    int32_t dt = (int32_t)(local - ss_anchor);
+
+    return local + (uint32_t)ss_offset + (uint32_t)(int32_t)(((int64_t)ss_drift_q24 * dt) >> 24);
+}
+
+static uint32_t ss_net(uint32_t local)
+{
+    uint32_t t;
+
+    taskENTER_CRITICAL();
+    t = ss_net_locked(local);
+    taskEXIT_CRITICAL();
+    return t;
+}
+
+/* -- Cues -------------------------------------------------------------------- */
+
+#if SHOWSYNC_ENABLE
+static void ss_fx_add(const effect_cmd_t *cmd, uint32_t at)
+{
+    static const ss_frame_t wake = { SS_ID_WAKE, 0u, { 0u }, 0u };
+    bool added = false;
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < SS_FX_SLOTS && !added; i++)
+    {
+        if (!ss_fx[i].used)
+        {
+            ss_fx[i].cmd  = *cmd;
+            ss_fx[i].at   = at;
+            ss_fx[i].used = true;
+            added = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+    if (added) (void)xQueueSend(ss_queue, &wake, 0);
+    else       (void)Effects_Post(cmd);             /* all slots taken: now */
+}
+
+/* Post the effect cues that are due; ticks until the next one */
+static TickType_t ss_fx_run(void)
+{
+    TickType_t next = portMAX_DELAY;
+
+    for (uint32_t i = 0; i < SS_FX_SLOTS; i++)
+    {
+        effect_cmd_t cmd;
+        int32_t      wait;
+        bool         used;
+
+        taskENTER_CRITICAL();
+        used = ss_fx[i].used;
+        cmd  = ss_fx[i].cmd;
+        wait = ShowClock_Until(ss_fx[i].at);
+        if (used && wait < 500) ss_fx[i].used = false;
+        taskEXIT_CRITICAL();
+
+        if (!used) continue;
+        if (wait < 500)
+        {
+            (void)Effects_Post(&cmd);
+            continue;
+        }
+        TickType_t t = ShowClock_UsToTicks((uint32_t)wait);
+        if (t < next) next = t;
+    }
+    return next;
+}
+#endif
+
+/* Carry out a cue at its network time, on this prop */
+static void ss_run(const showsync_cue_t *q)
+{
+    uint32_t at   = ShowSync_ToLocal(q->at);
+    int32_t  wait = ShowClock_Until(at);
+
+    switch (q->kind)
+    {
+    case SHOWSYNC_CUE_ACT:
+    {
+        const act_step_t *seq = (q->id == SHOWSYNC_PICK) ? NULL : Actuator_Pattern(q->id);
+
+        if (seq != NULL || q->id == SHOWSYNC_PICK)
+            (void)Actuator_TriggerAt((act_channel_t)q->ch, seq, at);
+        break;
+    }
+    case SHOWSYNC_CUE_SOUND:
+        AssetCache_PrefetchSound(q->id);        /* the network lead covers the copy */
+        (void)Sound_Cue(q->id, q->gain, (wait > 0) ? ((uint32_t)wait + 500u) / 1000u : 0u);
+        break;
+    case SHOWSYNC_CUE_EFFECT:
+#if SHOWSYNC_ENABLE
+        ss_fx_add(&q->fx, at);
+#else
+        (void)Effects_Post(&q->fx);
+#endif
+        break;
+    case SHOWSYNC_CUE_TIMELINE:
+#if SHOWSYNC_ENABLE
+        if (q->id < SHOWSYNC_TIMELINES && ss_timeline[q->id] != NULL)
+            Timeline_PlayAt(ss_timeline[q->id], at);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+#if SHOWSYNC_ENABLE
+
+static uint8_t ss_cue_encode(const showsync_cue_t *q, uint8_t *d)
+{
+    d[0] = (uint8_t)(SS_MSG_CUE + q->kind);
+    put32(&d[1], q->at);
+    switch (q->kind)
+    {
+    case SHOWSYNC_CUE_ACT:
+        d[5] = q->ch;
+        d[6] = q->id;
+        return 7u;
+    case SHOWSYNC_CUE_SOUND:
+        d[5] = q->id;
+        d[6] = (uint8_t)q->gain;
+        d[7] = (uint8_t)(q->gain >> 8);
+        return 8u;
+    case SHOWSYNC_CUE_EFFECT:
+        d[5]  = q->fx.op;
+        d[6]  = q->fx.index;
+        d[7]  = q->fx.id;
+        d[8]  = q->fx.mode;
+        d[9]  = q->fx.value;
+        d[10] = (uint8_t)q->fx.frames;
+        d[11] = (uint8_t)(q->fx.frames >> 8);
+        return 12u;
+    case SHOWSYNC_CUE_TIMELINE:
+        d[5] = q->id;
+        return 6u;
+    default:
+        return 0u;
+    }
+}
+
+static bool ss_cue_decode(const ss_frame_t *f, showsync_cue_t *q)
+{
+    static const uint8_t need[] = { 0u, 7u, 8u, 12u, 6u };
+
+    memset(q, 0, sizeof(*q));
+    q->kind = (uint8_t)(f->data[0] - SS_MSG_CUE);
+    if (q->kind < SHOWSYNC_CUE_ACT || q->kind > SHOWSYNC_CUE_TIMELINE || f->len < need[q->kind])
+        return false;
+    q->at = get32(&f->data[1]);
+    switch (q->kind)
+    {
+    case SHOWSYNC_CUE_ACT:
+        q->ch = f->data[5];
+        q->id = f->data[6];
+        break;
+    case SHOWSYNC_CUE_SOUND:
+        q->id   = f->data[5];
+        q->gain = (uint16_t)(f->data[6] | (f->data[7] << 8));
+        break;
+    case SHOWSYNC_CUE_TIMELINE:
+        q->id = f->data[5];
+        break;
+    default:
+        q->fx.op     = f->data[5];
+        q->fx.index  = f->data[6];
+        q->fx.id     = f->data[7];
+        q->fx.mode   = f->data[8];
+        q->fx.value  = f->data[9];
+        q->fx.frames = (uint16_t)(f->data[10] | (f->data[11] << 8));
+        break;
+    }
+    return true;
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+static uint16_t ss_mram_off(const void *p)
+{
+    return (uint16_t)((uintptr_t)p - CAN1_MSG_RAM_ADDR);
+}
+
+/* Queue a frame in the TX FIFO; `event` records its TX time (MM = mm) */
+static bool ss_send(uint16_t id, const uint8_t *d, uint8_t len, uint8_t mm, bool event)
+{
+    uint32_t w[SS_DATA / 4u] = { 0u };
+    bool     ok = false;
+
+    memcpy(w, d, len);
+    taskENTER_CRITICAL();
+    uint32_t fqs = CAN1_REGS->CAN_TXFQS;
+    if ((fqs & CAN_TXFQS_TFQF_Msk) == 0u && (CAN1_REGS->CAN_CCCR & CAN_CCCR_INIT_Msk) == 0u)
+    {
+        uint32_t i = (fqs & CAN_TXFQS_TFQPI_Msk) >> CAN_TXFQS_TFQPI_Pos;
+        volatile uint32_t *e = ss_mram.txb[i];
+
+        e[0] = CAN_TXBE_0_ID((uint32_t)id << 18);
+        e[1] = CAN_TXBE_1_DLC((len <= 8u) ? len : SS_DATA_DLC) | CAN_TXBE_1_FDF_Msk | CAN_TXBE_1_BRS_Msk |
+               (event ? CAN_TXBE_1_EFC_Msk : 0u) | CAN_TXBE_1_MM(mm);
+        for (uint32_t k = 0; k < SS_DATA / 4u; k++) e[2u + k] = w[k];
+        __DMB();                                /* element before the request */
+        CAN1_REGS->CAN_TXBAR = 1u << i;
+        ok = true;
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+/* Local show time of a 16-bit controller timestamp read against (now, tscv) */
+static uint32_t ss_stamp(uint32_t now, uint32_t tscv, uint32_t ts)
+{
+    return now - ((tscv - ts) & 0xFFFFu) * SS_BIT_US;
+}
+
+void CAN1_Handler(void)
+{
+    uint32_t   ir   = CAN1_REGS->CAN_IR;
+    uint32_t   now  = ShowClock_Now();
+    uint32_t   tscv = CAN1_REGS->CAN_TSCV;
+    BaseType_t woken = pdFALSE;
+    ss_frame_t f;
+
+    IRQSTAT_ENTER(IRQSTAT_SHOWSYNC);
+    CAN1_REGS->CAN_IR = ir;
+    if ((ir & (CAN_IR_BO_Msk | CAN_IR_RF0L_Msk | CAN_IR_TEFL_Msk)) != 0u) ss_bus_errors++;
+
+    while ((CAN1_REGS->CAN_RXF0S & CAN_RXF0S_F0FL_Msk) != 0u)
+    {
+        uint32_t i = (CAN1_REGS->CAN_RXF0S & CAN_RXF0S_F0GI_Msk) >> CAN_RXF0S_F0GI_Pos;
+        const volatile uint32_t *e = ss_mram.rxf0[i];
+        uint32_t w1  = e[1];
+        uint32_t dlc = (w1 & CAN_RXF0E_1_DLC_Msk) >> CAN_RXF0E_1_DLC_Pos;
+        uint32_t w[SS_DATA / 4u];
+
+        for (uint32_t k = 0; k < SS_DATA / 4u; k++) w[k] = e[2u + k];
+        f.id  = (uint16_t)((e[0] & CAN_RXF0E_0_ID_Msk) >> 18);
+        f.len = (uint8_t)((dlc <= 8u) ? dlc : SS_DATA);
+        f.at  = ss_stamp(now, tscv, w1 & CAN_RXF0E_1_RXTS_Msk);
+        memcpy(f.data, w, SS_DATA);
+        CAN1_REGS->CAN_RXF0A = CAN_RXF0A_F0AI(i);
+        if (xQueueSendFromISR(ss_queue, &f, &woken) != pdPASS) ss_bus_errors++;
+    }
+
+    while ((CAN1_REGS->CAN_TXEFS & CAN_TXEFS_EFFL_Msk) != 0u)
+    {
+        uint32_t i  = (CAN1_REGS->CAN_TXEFS & CAN_TXEFS_EFGI_Msk) >> CAN_TXEFS_EFGI_Pos;
+        uint32_t w1 = ((const volatile uint32_t *)ss_mram.txef[i])[1];
+
+        f.id      = SS_ID_TXE;
+        f.len     = 1u;
+        f.data[0] = (uint8_t)((w1 & CAN_TXEFE_1_MM_Msk) >> CAN_TXEFE_1_MM_Pos);
+        f.at      = ss_stamp(now, tscv, w1 & CAN_TXEFE_1_TXTS_Msk);
+        CAN1_REGS->CAN_TXEFA = CAN_TXEFA_EFAI(i);
+        (void)xQueueSendFromISR(ss_queue, &f, &woken);
+    }
+    IRQSTAT_EXIT(IRQSTAT_SHOWSYNC);
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool ss_hw_init(void)
+{
+    if (((uintptr_t)&ss_mram + sizeof(ss_mram) - CAN1_MSG_RAM_ADDR) > 0x10000u) return false;
+
+    MCLK_REGS->MCLK_AHBMASK |= MCLK_AHBMASK_CAN1_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[CAN1_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK3 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[CAN1_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    /* PB14 TX, PB15 RX: peripheral H */
+    PORT_REGS->GROUP[1].PORT_PMUX[14u >> 1] = PORT_PMUX_PMUXE(7u) | PORT_PMUX_PMUXO(7u);
+    PORT_REGS->GROUP[1].PORT_PINCFG[14] = PORT_PINCFG_PMUXEN_Msk;
+    PORT_REGS->GROUP[1].PORT_PINCFG[15] = PORT_PINCFG_PMUXEN_Msk;
+
+    CAN1_REGS->CAN_CCCR = CAN_CCCR_INIT_Msk;
+    while ((CAN1_REGS->CAN_CCCR & CAN_CCCR_INIT_Msk) == 0u) {}
+    CAN1_REGS->CAN_CCCR = CAN_CCCR_INIT_Msk | CAN_CCCR_CCE_Msk | CAN_CCCR_FDOE_Msk | CAN_CCCR_BRSE_Msk;
+
+    /* 48 MHz: arbitration /2, 48 tq (1 + 37 + 10, 79 %); data /1, 24 tq (1 + 17 + 6, 75 %) */
+    CAN1_REGS->CAN_NBTP = CAN_NBTP_NBRP(1u) | CAN_NBTP_NTSEG1(36u) | CAN_NBTP_NTSEG2(9u) | CAN_NBTP_NSJW(9u);
+    CAN1_REGS->CAN_DBTP = CAN_DBTP_DBRP(0u) | CAN_DBTP_DTSEG1(16u) | CAN_DBTP_DTSEG2(5u) |
+                          CAN_DBTP_DSJW(5u) | CAN_DBTP_TDC_Msk;
+    CAN1_REGS->CAN_TDCR = CAN_TDCR_TDCO(18u);   /* secondary sample point at the data sample point */
+    CAN1_REGS->CAN_TSCC = CAN_TSCC_TSS_INC | CAN_TSCC_TCP(0u);
+
+    /* One classic range filter, 0x080..0x2FF -> RX FIFO 0; the rest rejected */
+    ss_mram.sidf[0] = CAN_SIDFE_0_SFT(0u) | CAN_SIDFE_0_SFEC(1u) |
+                      CAN_SIDFE_0_SFID1(SS_ID_FIRST) | CAN_SIDFE_0_SFID2(SS_ID_LAST);
+    CAN1_REGS->CAN_SIDFC = CAN_SIDFC_FLSSA(ss_mram_off(ss_mram.sidf)) | CAN_SIDFC_LSS(1u);
+    CAN1_REGS->CAN_XIDFC = 0u;
+    CAN1_REGS->CAN_GFC   = CAN_GFC_ANFS(2u) | CAN_GFC_ANFE(2u) | CAN_GFC_RRFS_Msk | CAN_GFC_RRFE_Msk;
+
+    CAN1_REGS->CAN_RXF0C = CAN_RXF0C_F0SA(ss_mram_off(ss_mram.rxf0)) | CAN_RXF0C_F0S(SS_RX_FIFO);
+    CAN1_REGS->CAN_RXESC = CAN_RXESC_F0DS(1u);                  /* 12 data bytes */
+    CAN1_REGS->CAN_TXBC  = CAN_TXBC_TBSA(ss_mram_off(ss_mram.txb)) | CAN_TXBC_TFQS(SS_TX_FIFO);
+    CAN1_REGS->CAN_TXESC = CAN_TXESC_TBDS(1u);
+    CAN1_REGS->CAN_TXEFC = CAN_TXEFC_EFSA(ss_mram_off(ss_mram.txef)) | CAN_TXEFC_EFS(SS_TX_EVENTS);
+
+    CAN1_REGS->CAN_IE  = CAN_IE_RF0NE_Msk | CAN_IE_RF0LE_Msk | CAN_IE_TEFNE_Msk | CAN_IE_TEFLE_Msk |
+                         CAN_IE_BOE_Msk;
+    CAN1_REGS->CAN_ILS = 0u;
+    CAN1_REGS->CAN_ILE = CAN_ILE_EINT0_Msk;
+
+    CAN1_REGS->CAN_CCCR &= ~CAN_CCCR_INIT_Msk;                  /* CCE clears with it */
+    while ((CAN1_REGS->CAN_CCCR & CAN_CCCR_INIT_Msk) != 0u) {}
+
+    NVIC_SetPriority(CAN1_IRQn, SHOWSYNC_IRQ_PRIO);
+    NVIC_EnableIRQ(CAN1_IRQn);
+    return true;
+}
+
+/* Default ID from the 128-bit serial number */
+static uint8_t ss_serial_node(void)
+{
+    uint32_t h = *(const volatile uint32_t *)0x008061FCu ^ *(const volatile uint32_t *)0x00806010u ^
+                 *(const volatile uint32_t *)0x00806014u ^ *(const volatile uint32_t *)0x00806018u;
+
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return (uint8_t)(h % SS_ID_NODE_MSK + 1u);
+}
+
+/* -- Sync task --------------------------------------------------------------- */
+
+/* SYNC / FOLLOW_UP pair: it reached us at network time t1 (the master's
+   send time plus the path delay), local time t2 */
+static void ss_servo(uint32_t t1, uint32_t t2)
+{
+    taskENTER_CRITICAL();
+    uint32_t pred = ss_net_locked(t2);
+    int32_t  err  = (int32_t)(t1 - pred);
+    int32_t  dt   = (int32_t)(t2 - ss_last_at);
+
+    if (!ss_locked || err > (int32_t)SHOWSYNC_STEP_US || err < -(int32_t)SHOWSYNC_STEP_US)
+    {
+        ss_offset    = (int32_t)(t1 - t2);
+        ss_drift_q24 = 0;
+        ss_locked    = true;
+        ss_steps++;
+    }
+    else
+    {
+        /* Phase 1/4, rate 1/8 of the error seen over the interval */
+        if (dt > 0) ss_drift_q24 += (int32_t)((((int64_t)err << 24) / dt) / 8);
+        if (ss_drift_q24 >  SS_DRIFT_MAX_Q24) ss_drift_q24 =  SS_DRIFT_MAX_Q24;
+        if (ss_drift_q24 < -SS_DRIFT_MAX_Q24) ss_drift_q24 = -SS_DRIFT_MAX_Q24;
+        ss_offset = (int32_t)(pred - t2) + err / 4;
+    }
+    ss_anchor  = t2;
+    ss_last_at = t2;
+    ss_err_us  = err;
+    taskEXIT_CRITICAL();
+}
+
+/* Re-anchor at `local` so the drift term never spans a wrap */
+static void ss_fold(uint32_t local)
+{
+    taskENTER_CRITICAL();
+    ss_offset = (int32_t)(ss_net_locked(local) - local);
+    ss_anchor = local;
+    taskEXIT_CRITICAL();
+}
+
+/* Node `n` sent SYNC: follow the lowest ID, take over from a higher one once on its time */
+static void ss_heard_master(uint8_t n, TickType_t now)
+{
+    uint8_t me = ss_node;
+
+    if (n == me) return;                        /* duplicate ID: ignore it */
+    if (ss_master == me)
+    {
+        if (n > me) return;                     /* it yields once it hears us */
+    }
+    else if (ss_master != 0u && n > ss_master && (now - ss_master_tick) < pdMS_TO_TICKS(SHOWSYNC_LOSS_MS))
+    {
+        return;                                 /* a lower master is alive */
+    }
+    ss_master = n;
+    ss_master_tick = now;
+    if (n > me && ss_locked) ss_master = me;
+}
+
+static void ss_handle(const ss_frame_t *f, TickType_t now)
+{
+    uint8_t d[SS_DATA];
+    uint8_t n = (uint8_t)(f->id & SS_ID_NODE_MSK);
+
+    if (f->id == SS_ID_WAKE) return;
+    if (f->id == SS_ID_TXE)
+    {
+        if (f->data[0] == (SS_MM_DELAY | ss_dreq_seq))
+        {
+            ss_dreq_t3    = ss_net(f->at);
+            ss_dreq_valid = true;
+        }
+        else if (ss_master == ss_node && f->data[0] == ss_tx_seq)
+        {
+            d[0] = SS_MSG_FOLLOW;
+            d[1] = ss_tx_seq;
+            put32(&d[2], ss_net(f->at));
+            (void)ss_send((uint16_t)(SS_ID_SYNC | ss_node), d, 6u, 0u, false);
+        }
+        return;
+    }
+    if (n == 0u || f->len == 0u) return;
+    if (n != ss_node)
+    {
+        ss_seen[n] = now;
+        ss_seen_mask |= 1ull << n;
+    }
+
+    switch (f->data[0])
+    {
+    case SS_MSG_SYNC:
+        ss_heard_master(n, now);
+        if (ss_master == n && f->len >= 2u)
+        {
+            ss_rx_seq   = f->data[1];
+            ss_rx_at    = f->at;
+            ss_rx_valid = true;
+        }
+        break;
+    case SS_MSG_FOLLOW:
+        if (ss_master == n && ss_rx_valid && f->len >= 6u && f->data[1] == ss_rx_seq)
+        {
+            uint32_t t1 = get32(&f->data[2]);
+
+            ss_fwd       = (int32_t)(ss_net(ss_rx_at) - t1);
+            ss_fwd_valid = true;
+            ss_servo(t1 + (uint32_t)ss_delay_us, ss_rx_at);
+            ss_rx_valid = false;
+        }
+        break;
+    case SS_MSG_DELAY_REQ:
+        if (ss_master == ss_node && f->len >= 2u)
+        {
+            d[0] = SS_MSG_DELAY_RESP;
+            d[1] = n;
+            d[2] = f->data[1];
+            put32(&d[3], ss_net(f->at));
+            (void)ss_send((uint16_t)(SS_ID_SYNC | ss_node), d, 7u, 0u, false);
+        }
+        break;
+    case SS_MSG_DELAY_RESP:
+        if (ss_master == n && f->len >= 7u && f->data[1] == ss_node && f->data[2] == ss_dreq_seq &&
+            ss_dreq_valid && ss_fwd_valid)
+        {
+            /* PTP: delay = ((t2 - t1) + (t4 - t3)) / 2, the offset error cancels */
+            int32_t back  = (int32_t)(get32(&f->data[3]) - ss_dreq_t3);
+            int32_t delay = (ss_fwd + back) / 2;
+
+            if (delay >= 0 && delay <= SS_DELAY_MAX_US)
+            {
+                ss_delay_us    = ss_delay_valid ? ss_delay_us + (delay - ss_delay_us) / 8 : delay;
+                ss_delay_valid = true;
+            }
+            ss_dreq_valid = false;
+        }
+        break;
+    case SS_MSG_HELLO:
+        break;
+    default:
+    {
+        showsync_cue_t q;
+
+        if (ss_cue_decode(f, &q)) ss_run(&q);
+        break;
+    }
+    }
+}
+
+/* Once a period: clock anchor, peers, election, our SYNC beacon */
+static void ss_period(TickType_t now)
+{
+    uint8_t peers = 0u;
+
+    ss_fold(ShowClock_Now());
+    for (uint32_t n = 1u; n <= SS_ID_NODE_MSK; n++)
+    {
+        if ((ss_seen_mask & (1ull << n)) == 0u) continue;
+        if ((now - ss_seen[n]) < pdMS_TO_TICKS(SHOWSYNC_PEER_MS)) peers++;
+        else ss_seen_mask &= ~(1ull << n);
+    }
+    ss_peers = peers;
+
+    /* Followers measure the way back now and then, staggered by node */
+    if (ss_master != ss_node && ss_locked && ss_dreq_wait-- == 0u)
+    {
+        uint8_t d[2] = { SS_MSG_DELAY_REQ, 0u };
+
+        ss_dreq_wait  = (uint8_t)(SHOWSYNC_DELAY_MS / SHOWSYNC_PERIOD_MS - 1u);
+        ss_dreq_seq   = (uint8_t)((ss_dreq_seq + 1u) & ~SS_MM_DELAY);
+        ss_dreq_valid = false;
+        d[1] = ss_dreq_seq;
+        (void)ss_send((uint16_t)(SS_ID_SYNC | ss_node), d, 2u, (uint8_t)(SS_MM_DELAY | ss_dreq_seq), true);
+    }
+
+    if (ss_master != ss_node && (now - ss_master_tick) >= pdMS_TO_TICKS(SHOWSYNC_LOSS_MS))
+    {
+        ss_master = ss_node;                    /* no lower ID: ours is the time */
+        ss_locked = true;
+    }
+    if (ss_master == ss_node)
+    {
+        uint8_t d[2];
+
+        ss_tx_seq = (uint8_t)((ss_tx_seq + 1u) & ~SS_MM_DELAY);
+        d[0] = SS_MSG_SYNC;
+        d[1] = ss_tx_seq;
+        (void)ss_send((uint16_t)(SS_ID_SYNC | ss_node), d, 2u, ss_tx_seq, true);
+    }
+}
+
+static TickType_t ss_left(TickType_t due, TickType_t now)
+{
+    int32_t d = (int32_t)(due - now);
+
+    return (d > 0) ? (TickType_t)d : 0u;
+}
+
+static void ss_task(void *arg)
+{
+    TickType_t beacon = xTaskGetTickCount();
+    TickType_t hello  = beacon;
+    ss_frame_t f;
+
+    (void)arg;
+    ss_master_tick = beacon;                    /* listen a loss time before claiming */
+    for (;;)
+    {
+        TickType_t now  = xTaskGetTickCount();
+        TickType_t wait = ss_left(beacon, now);
+
+        if (ss_left(hello, now) < wait) wait = ss_left(hello, now);
+        TickType_t fx = ss_fx_run();
+        if (fx < wait) wait = fx;
+
+        if (xQueueReceive(ss_queue, &f, wait) == pdPASS) ss_handle(&f, xTaskGetTickCount());
+
+        now = xTaskGetTickCount();
+        if ((CAN1_REGS->CAN_CCCR & CAN_CCCR_INIT_Msk) != 0u)
+            CAN1_REGS->CAN_CCCR &= ~CAN_CCCR_INIT_Msk;  /* bus off: rejoin after 129 x 11 bits */
+        if ((int32_t)(now - beacon) >= 0)
+        {
+            beacon += pdMS_TO_TICKS(SHOWSYNC_PERIOD_MS);
+            if ((int32_t)(now - beacon) >= 0) beacon = now + pdMS_TO_TICKS(SHOWSYNC_PERIOD_MS);
+            ss_period(now);
+        }
+        if ((int32_t)(now - hello) >= 0)
+        {
+            uint8_t d[1] = { SS_MSG_HELLO };
+
+            hello = now + pdMS_TO_TICKS(SHOWSYNC_HELLO_MS);
+            (void)ss_send((uint16_t)(SS_ID_HELLO | ss_node), d, 1u, 0u, false);
+        }
+    }
+}
+
+/* The CAN clock stops in standby */
+static bool ss_tickless_veto(void)
+{
+    return true;
+}
+
+#endif /* SHOWSYNC_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void ShowSync_Start(void)
+{
+#if SHOWSYNC_ENABLE
+    ss_node  = ss_serial_node();
+    ss_dreq_wait = (uint8_t)(ss_node % (SHOWSYNC_DELAY_MS / SHOWSYNC_PERIOD_MS));
+    ss_queue = xQueueCreateStatic(SS_QUEUE_LEN, sizeof(ss_frame_t), ss_queue_store, &ss_queue_buf);
+    LOADTEST_NAME(ss_queue, "showsync");
+    if (!ss_hw_init()) return;
+    (void)Cli_Register(&ss_node_param);
+    (void)Tickless_RegisterVeto(ss_tickless_veto);
+    (void)xTaskCreateStatic(ss_task, "Sync", SS_STACK, NULL, SHOWSYNC_TASK_PRIO, ss_stack, &ss_tcb);
+#endif
+}
+
+uint32_t ShowSync_Now(void)
+{
+    return ss_net(ShowClock_Now());
+}
+
+uint32_t ShowSync_ToNet(uint32_t t)
+{
+    return ss_net(t);
+}
+
+uint32_t ShowSync_ToLocal(uint32_t t)
+{
+    uint32_t l;
+
+    taskENTER_CRITICAL();
+    l = t - (uint32_t)ss_offset;
+    l -= (uint32_t)(int32_t)(((int64_t)ss_drift_q24 * (int32_t)(l - ss_anchor)) >> 24);
+    taskEXIT_CRITICAL();
+    return l;
+}
+
+bool ShowSync_Cue(const showsync_cue_t *cue)
+{
+#if SHOWSYNC_ENABLE
+    uint8_t d[SS_DATA];
+    uint8_t len = ss_cue_encode(cue, d);
+    bool    sent = (len != 0u) && ss_send((uint16_t)(SS_ID_CUE | ss_node), d, len, 0u, false);
+
+    ss_run(cue);
+    return sent;
+#else
+    ss_run(cue);
+    return false;
+#endif
+}
+
+bool ShowSync_Scare(void)
+{
+#if SHOWSYNC_ENABLE
+    showsync_cue_t q = { 0 };
+
+    if (ss_peers == 0u) return false;
+    q.kind = SHOWSYNC_CUE_ACT;
+    q.ch   = ACT_CH_LID;
+    q.id   = SHOWSYNC_PICK;
+    q.at   = ShowSync_Now() + SHOWSYNC_CUE_LEAD_US;
+    (void)ShowSync_Cue(&q);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShowSync_RegisterTimeline(uint8_t id, const timeline_t *tl)
+{
+#if SHOWSYNC_ENABLE
+    if (id >= SHOWSYNC_TIMELINES) return false;
+    ss_timeline[id] = tl;
+    return true;
+#else
+    (void)tl;
+    return id < SHOWSYNC_TIMELINES;
+#endif
+}
+
+bool ShowSync_Following(void)
+{
+#if SHOWSYNC_ENABLE
+    return ss_master != 0u && ss_master != ss_node && ss_locked &&
+           (xTaskGetTickCount() - ss_master_tick) < pdMS_TO_TICKS(SHOWSYNC_LOSS_MS);
+#else
+    return false;
+#endif
+}
+
+void ShowSync_GetStatus(showsync_status_t *out)
+{
+    taskENTER_CRITICAL();
+    out->node       = ss_node;
+    out->master     = ss_master;
+    out->locked     = ss_locked;
+#if SHOWSYNC_ENABLE
+    out->peers      = ss_peers;
+#else
+    out->peers      = 0u;
+#endif
+    out->err_us     = ss_err_us;
+    out->delay_us   = ss_delay_us;
+    out->drift_ppm  = (int32_t)(((int64_t)ss_drift_q24 * 1000000) >> 24);
+    out->steps      = ss_steps;
+    out->bus_errors = ss_bus_errors;
+    taskEXIT_CRITICAL();
+}
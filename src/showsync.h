@@ -0,0 +1,144 @@
+/* =============================================================================
+ * showsync.h  -  CAN FD show-sync network: shared show time and cues across props
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Several props on one CAN bus (CAN1, PB14 TX / PB15 RX, peripheral H, an
+ * external transceiver) share one network show time, so a cue lands on
+ * every prop together: one lid slams as the next one's sound starts.
+ *
+ *   Bus     ISO CAN FD, 500 kbit/s arbitration, 2 Mbit/s data (BRS), from
+ *           GCLK3 48 MHz. Standard IDs only; a hardware range filter puts
+ *           0x080..0x2FF in RX FIFO 0 and drops everything else, so other
+ *           traffic on the bus costs no interrupt.
+ *   Clock   The lowest node ID sending SYNC is the master. Every
+ *           SHOWSYNC_PERIOD_MS it sends SYNC, then FOLLOW_UP carrying the
+ *           network time at which SYNC left (its TX event timestamp). The
+ *           others stamp SYNC on arrival (RX timestamp) and steer an offset
+ *           and a rate onto the master's clock. Both stamps are taken by
+ *           the CAN controller at start of frame, in 2 us bit times, so the
+ *           result is free of ISR and task latency: props agree to a few us.
+ *   Delay   Each follower also sends DELAY_REQ every SHOWSYNC_DELAY_MS and
+ *           the master answers with its RX timestamp, PTP style: the path
+ *           delay is half the round trip of the two exchanges, and the
+ *           follower aims at the master's send time plus it. On one CAN
+ *           segment it is the transceiver loop, a bit time at most.
+ *   Master  A prop that hears no lower ID for SHOWSYNC_LOSS_MS takes over
+ *           at the network time it already follows, so the time stays
+ *           continuous when the master is switched off or a lower ID joins.
+ *   Cues    A cue names a network time and what to do then (an actuator
+ *           pattern, a sound, an effect command, a registered timeline).
+ *           The sender runs it too, so every prop starts it at the same
+ *           show time.
+ *
+ * Timelines run on the network time (timeline.h), so a long or looping
+ * one stays on the same frame on every prop however far the crystals
+ * differ; alone, the network time is the show clock.
+ *
+ * On a network the master's random schedule paces the room: followers keep
+ * their own schedule off, and every random event or presence arrival on
+ * any prop becomes ShowSync_Scare(), the lid of every prop at once (each
+ * picks its own pattern within its own thermal budget). The start is to
+ * the RTOS tick (actuator.h), so two props land within about a 1 ms tick
+ * of each other whatever the clock skew.
+ *
+ * The node ID (CLI "node", 1..63) orders the election and must be unique
+ * on the bus; it defaults to a value hashed from the chip serial number.
+ * ============================================================================= */
+
+#ifndef SHOWSYNC_H
+#define SHOWSYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "effects.h"
+#include "timeline.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define SHOWSYNC_ENABLE         0       /* 1 = a CAN transceiver is on PB14/PB15  */
+#define SHOWSYNC_PERIOD_MS      100u    /* SYNC beacons from the master           */
+#define SHOWSYNC_LOSS_MS        350u    /* no lower ID heard: take over           */
+#define SHOWSYNC_HELLO_MS       1000u   /* every prop announces itself            */
+#define SHOWSYNC_DELAY_MS       1000u   /* follower path-delay request            */
+#define SHOWSYNC_PEER_MS        3500u   /* not heard for this long: gone          */
+#define SHOWSYNC_STEP_US        1000u   /* larger error: step, not steer          */
+#define SHOWSYNC_CUE_LEAD_US    50000u  /* lead for ShowSync_Scare()              */
+#define SHOWSYNC_TASK_PRIO      3u
+#define SHOWSYNC_IRQ_PRIO       IRQ_PRIO_SHOWSYNC   /* NVIC, irqprio.h          */
+#define SHOWSYNC_TIMELINES      8u      /* ShowSync_RegisterTimeline() ids        */
+
+#define SHOWSYNC_PICK           0xFFu   /* cue id: a random pick on each prop    */
+
+typedef enum
+{
+    SHOWSYNC_CUE_ACT = 1,               /* Actuator_TriggerAt(ch, Actuator_Pattern(id)) */
+    SHOWSYNC_CUE_SOUND,                 /* Sound_Cue(id, gain)                          */
+    SHOWSYNC_CUE_EFFECT,                /* Effects_Post(&fx)                            */
+    SHOWSYNC_CUE_TIMELINE               /* Timeline_PlayAt() of registered timeline id  */
+} showsync_kind_t;
+
+typedef struct
+{
+    uint8_t      kind;                  /* showsync_kind_t                          */
+    uint8_t      ch;                    /* ACT: act_channel_t                       */
+    uint8_t      id;                    /* ACT: pattern or SHOWSYNC_PICK, SOUND: clip, TIMELINE */
+    uint16_t     gain;                  /* SOUND                                    */
+    effect_cmd_t fx;                    /* EFFECT                                   */
+    uint32_t     at;                    /* network show time                        */
+} showsync_cue_t;
+
+typedef struct
+{
+    uint8_t  node;                      /* this prop                                */
+    uint8_t  master;                    /* 0 = none yet                             */
+    bool     locked;                    /* following the master's time (or is it)   */
+    uint8_t  peers;                     /* other props heard lately                 */
+    int32_t  err_us;                    /* latest SYNC error before correction      */
+    int32_t  drift_ppm;                 /* rate correction against the master       */
+    int32_t  delay_us;                  /* measured path delay from the master      */
+    uint32_t steps;                     /* times the clock was stepped              */
+    uint32_t bus_errors;                /* bus-off events and lost frames           */
+} showsync_status_t;
+
+/**
+ * Bring up CAN1 and create the sync task; registers "node". After
+ * ShowClock_Init(), before the scheduler. Does nothing (and every other
+ * call runs local only) unless SHOWSYNC_ENABLE.
+ */
+void ShowSync_Start(void);
+
+/** Network show time now (ShowClock_Now() when alone). Any task. */
+uint32_t ShowSync_Now(void);
+
+/** Network time of local show time `t` (showclock.h). Any task. */
+uint32_t ShowSync_ToNet(uint32_t t);
+
+/** Local show time (showclock.h) of network time `t`. Any task. */
+uint32_t ShowSync_ToLocal(uint32_t t);
+
+/**
+ * Make `tl` playable by SHOWSYNC_CUE_TIMELINE cues as `id`; every prop
+ * registers its own timelines under the ids the show uses. Before cues
+ * arrive; false if `id` is out of range.
+ */
+bool ShowSync_RegisterTimeline(uint8_t id, const timeline_t *tl);
+
+/**
+ * Send `cue` to every prop and run it here, all at network time cue->at.
+ * Any task; false if it could not be sent (it still runs here).
+ */
+bool ShowSync_Cue(const showsync_cue_t *cue);
+
+/**
+ * A lid scare on every prop SHOWSYNC_CUE_LEAD_US from now. False, with
+ * nothing sent, if no other prop is on the bus. Any task.
+ */
+bool ShowSync_Scare(void);
+
+/** True while another prop is master: the random schedule is theirs. Any task. */
+bool ShowSync_Following(void);
+
+/** Election and clock state. Any task. */
+void ShowSync_GetStatus(showsync_status_t *out);
+
+#endif /* SHOWSYNC_H */
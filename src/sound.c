@@ -0,0 +1,505 @@
+/* =============================================================================
+ * sound.c  -  DAC or I2S sound-effect playback in step with the actuator
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "sound.h"
+#include "definitions.h"        /* core_cm4.h: DWT, __DMB; plib_dmac.h */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "cli.h"
+#include "rtos_trace.h"
+#include "stream.h"
+#include "loadtest.h"
+#include "sdcard.h"
+#include "qflash.h"
+#include "actuator.h"           /* ACT_PWM_DRIVE, ACT_STEPPER_DRIVE */
+#include "adpcm.h"
+#include <string.h>
+
+#if SOUND_ENABLE && SOUND_OUTPUT == SOUND_OUT_I2S
+#if SDCARD_ENABLE || QFLASH_ENABLE
+#error "SOUND_OUT_I2S: PA09..PA11 are SDHC0 / QSPI data, not the I2S clock unit 0 pins"
+#endif
+#if ACT_PWM_DRIVE || ACT_STEPPER_DRIVE
+#error "SOUND_OUT_I2S: PA10 is the I2S SCK, not the lid's PWM / STEP output"
+#endif
+_Static_assert(SOUND_I2S_SCK_DIV >= 1u && SOUND_I2S_SCK_DIV <= 64u, "SOUND_I2S_SCK_DIV: MCKDIV is 6 bits");
+#endif
+
+#if SOUND_OUTPUT == SOUND_OUT_I2S
+typedef uint32_t sound_sample_t;        /* 16C: L in the low half, R in the high */
+#define SOUND_MID           0u          /* silence                                */
+#define SOUND_BEAT          DMAC_BTCTRL_BEATSIZE_WORD
+#define SOUND_DST           (&I2S_REGS->I2S_TXDATA)
+#define SOUND_TRIGGER       I2S_DMAC_ID_TX_0
+#else
+typedef uint16_t sound_sample_t;
+#define SOUND_MID           2048u       /* DAC mid-scale, silence */
+#define SOUND_BEAT          DMAC_BTCTRL_BEATSIZE_HWORD
+#define SOUND_DST           (&DAC_REGS->DAC_DATA[1])
+#define SOUND_TRIGGER       TCC2_DMAC_ID_OVF
+#endif
+#define SOUND_STOP_ID       0xFFu       /* cue id that means Sound_StopAll() */
+#define SOUND_STREAM_ID     0xFEu       /* cue id of Sound_CueStream()       */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const sound_clip_t *sound_clip[SOUND_CLIPS];
+
+static volatile uint32_t   sound_late;
+static volatile uint32_t   sound_dropped;
+
+#if SOUND_ENABLE
+
+typedef struct
+{
+    uint8_t  id;
+    int8_t   stream;                    /* SOUND_STREAM_ID: stream.h handle  */
+    uint16_t gain;
+    uint32_t start;                     /* sample number of the first sample */
+} sound_cue_t;
+
+typedef struct
+{
+    const sound_clip_t *clip;           /* NULL = free */
+    uint32_t pos;
+    uint32_t start;
+    uint16_t gain;
+    int8_t   stream;                    /* -1, or the stream it plays (clip = sentinel) */
+    adpcm_dec_t adpcm;                  /* SOUND_FMT_ADPCM clips */
+} sound_voice_t;
+
+#define SOUND_STACK         (configMINIMAL_STACK_SIZE * 2u)
+
+static StackType_t   sound_stack[SOUND_STACK];
+static StaticTask_t  sound_tcb;
+static TaskHandle_t  sound_task_handle;
+
+static QueueHandle_t sound_queue;
+static StaticQueue_t sound_queue_buf;
+static uint8_t       sound_queue_store[SOUND_CUE_QUEUE * sizeof(sound_cue_t)];
+
+/* DMA ring: the DMAC plays one half while the task mixes the other */
+static sound_sample_t sound_buf[2][SOUND_BLOCK] DMA_RAM;
+static dmac_descriptor_registers_t sound_desc1 DMA_RAM __ALIGNED(16);
+
+/* Blocks played, and DWT when the latest one ended; ISR writes cyc first */
+static volatile uint32_t sound_done;
+static volatile uint32_t sound_done_cyc;
+
+static uint8_t       sound_volume = SOUND_VOLUME;
+
+/* Mixer, Sound task only */
+static sound_voice_t sound_voice[SOUND_VOICES];
+static int32_t       sound_acc[SOUND_BLOCK];
+static int8_t        sound_pull[SOUND_BLOCK];           /* a stream voice's samples */
+
+/* Stands in for the clip of a stream voice: never runs out by length */
+static const sound_clip_t sound_stream_clip = { NULL, 0xFFFFFFFFu };
+
+static const cli_param_t sound_volume_param =
+{
+    "volume", &sound_volume, CLI_U8, 0u, 255u, NULL, "sound effects master level, 0 = mute"
+};
+
+/* -- ISR --------------------------------------------------------------------- */
+
+/* A block has gone out (dma_qos.c DMAC_OTHER dispatch) */
+static void sound_dma_isr(uint8_t flags)
+{
+    BaseType_t woken = pdFALSE;
+
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) != 0u)
+    {
+        sound_done_cyc = DWT->CYCCNT;
+        __DMB();
+        sound_done++;
+        RTOS_TRACE_DMA_EVENT(SOUND_DMA_CHANNEL, 1u);
+        vTaskNotifyGiveFromISR(sound_task_handle, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/* -- Mixer ------------------------------------------------------------------- */
+
+/* Sample number on the DAC now: block count plus the time into the block */
+static uint32_t sound_now(void)
+{
+    uint32_t n, cyc, in;
+
+    do {
+        n   = sound_done;
+        __DMB();
+        cyc = sound_done_cyc;
+        __DMB();
+    } while (n != sound_done);
+
+    in = (DWT->CYCCNT - cyc) / SOUND_TIMER_PER;
+    if (in >= SOUND_BLOCK) in = SOUND_BLOCK - 1u;     /* ISR still pending */
+    return n * SOUND_BLOCK + in;
+}
+
+/* Let go of a voice, closing the stream it owned */
+static void sound_free_voice(sound_voice_t *v)
+{
+    if (v->clip == &sound_stream_clip) Stream_Close(v->stream);
+    v->clip = NULL;
+}
+
+/* Free voice, else the one furthest into its clip */
+static sound_voice_t *sound_pick_voice(void)
+{
+    sound_voice_t *best = &sound_voice[0];
+
+    for (uint32_t v = 0; v < SOUND_VOICES; v++)
+    {
+        if (sound_voice[v].clip == NULL) return &sound_voice[v];
+        if (sound_voice[v].pos > best->pos) best = &sound_voice[v];
+    }
+    return best;
+}
+
+static void sound_take_cues(void)
+{
+    sound_cue_t c;
+
+    while (xQueueReceive(sound_queue, &c, 0) == pdPASS)
+    {
+        if (c.id == SOUND_STOP_ID)
+        {
+            for (uint32_t v = 0; v < SOUND_VOICES; v++)
+                if (sound_voice[v].clip != NULL) sound_free_voice(&sound_voice[v]);
+            continue;
+        }
+
+        sound_voice_t *v = sound_pick_voice();
+
+        if (v->clip != NULL) sound_free_voice(v);
+        v->clip   = (c.id == SOUND_STREAM_ID) ? &sound_stream_clip : sound_clip[c.id];
+        v->stream = c.stream;
+        v->pos    = 0u;
+        v->start = c.start;
+        Adpcm_Start(&v->adpcm);
+        v->gain  = c.gain;
+    }
+}
+
+/* Block of samples b0 .. b0 + SOUND_BLOCK - 1 into out */
+static void sound_mix(sound_sample_t *out, uint32_t b0)
+{
+    bool any = false;
+
+    memset(sound_acc, 0, sizeof(sound_acc));
+    for (uint32_t k = 0; k < SOUND_VOICES; k++)
+    {
+        sound_voice_t *v = &sound_voice[k];
+        int32_t  from = (int32_t)(v->start - b0);
+        uint32_t n;
+
+        if (v->clip == NULL || from >= (int32_t)SOUND_BLOCK) continue;
+        if (from < 0) from = 0;                     /* started in an earlier block */
+
+        n = SOUND_BLOCK - (uint32_t)from;
+        if (v->clip == &sound_stream_clip)
+        {
+            /* Whatever the ring holds; short of that is silence (underrun) */
+            uint32_t got = Stream_Read(v->stream, sound_pull, n);
+
+            for (uint32_t i = 0; i < got; i++)
+                sound_acc[(uint32_t)from + i] += (int32_t)sound_pull[i] * v->gain;
+            if (got < n && Stream_Ended(v->stream)) sound_free_voice(v);
+            any = true;
+            continue;
+        }
+        if (n > v->clip->len - v->pos) n = v->clip->len - v->pos;
+        if (v->clip->fmt == SOUND_FMT_ADPCM)
+            Adpcm_Mix(&v->adpcm, (const uint8_t *)v->clip->pcm, &sound_acc[from], n, v->gain);
+        else
+            for (uint32_t i = 0; i < n; i++)
+                sound_acc[(uint32_t)from + i] += (int32_t)v->clip->pcm[v->pos + i] * v->gain;
+        v->pos += n;
+        if (v->pos >= v->clip->len) v->clip = NULL;
+        any = true;
+    }
+
+    if (!any)
+    {
+        for (uint32_t i = 0; i < SOUND_BLOCK; i++) out[i] = SOUND_MID;
+        return;
+    }
+
+#if SOUND_OUTPUT == SOUND_OUT_I2S
+    /* One voice at unity and full volume spans +-32768, on both channels */
+    for (uint32_t i = 0; i < SOUND_BLOCK; i++)
+    {
+        int32_t s = (sound_acc[i] * (int32_t)sound_volume) >> 8;
+
+        if (s < -32768) s = -32768;
+        if (s > 32767)  s = 32767;
+        out[i] = (uint32_t)(uint16_t)s * 0x00010001u;
+    }
+#else
+    /* One voice at unity and full volume spans +-2048 */
+    for (uint32_t i = 0; i < SOUND_BLOCK; i++)
+    {
+        int32_t s = ((sound_acc[i] * (int32_t)sound_volume) >> 12) + (int32_t)SOUND_MID;
+
+        if (s < 0)     s = 0;
+        if (s > 4095)  s = 4095;
+        out[i] = (uint16_t)s;
+    }
+#endif
+}
+
+static void sound_task(void *arg)
+{
+    uint32_t prev = 0u;
+
+    (void)arg;
+    for (;;)
+    {
+        (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t done = sound_done;
+        uint32_t blk  = done + 1u;                  /* plays after the one going out */
+
+        if (done - prev > 1u) sound_late += done - prev - 1u;   /* slots never mixed */
+        prev = done;
+
+        sound_take_cues();
+        sound_mix(sound_buf[blk & 1u], blk * SOUND_BLOCK);
+        if (sound_done != done) sound_late++;       /* its half was already playing */
+    }
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+#if SOUND_OUTPUT == SOUND_OUT_I2S
+
+/* Clock unit 0 master: BCLK and LRCK out, Philips I2S, two 16-bit slots */
+static void sound_i2s_init(void)
+{
+    MCLK_REGS->MCLK_APBDMASK |= MCLK_APBDMASK_I2S_Msk;
+    GCLK_REGS->GCLK_GENCTRL[5] = GCLK_GENCTRL_DIV(SOUND_I2S_GCLK_DIV) | GCLK_GENCTRL_SRC(7U) | GCLK_GENCTRL_GENEN_Msk;
+    while ((GCLK_REGS->GCLK_SYNCBUSY & GCLK_SYNCBUSY_GENCTRL_GCLK5) != 0u) {}
+    GCLK_REGS->GCLK_PCHCTRL[I2S_GCLK_ID_0] = GCLK_PCHCTRL_GEN_GCLK5 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[I2S_GCLK_ID_0] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    I2S_REGS->I2S_CTRLA = I2S_CTRLA_SWRST_Msk;
+    while ((I2S_REGS->I2S_SYNCBUSY & I2S_SYNCBUSY_SWRST_Msk) != 0u) {}
+
+    I2S_REGS->I2S_CLKCTRL[0] = I2S_CLKCTRL_SLOTSIZE_16 | I2S_CLKCTRL_NBSLOTS(1u) | I2S_CLKCTRL_FSWIDTH_HALF
+                             | I2S_CLKCTRL_BITDELAY_I2S | I2S_CLKCTRL_FSSEL_SCKDIV | I2S_CLKCTRL_SCKSEL_MCKDIV
+                             | I2S_CLKCTRL_MCKSEL_GCLK | I2S_CLKCTRL_MCKDIV(SOUND_I2S_SCK_DIV - 1u);
+    I2S_REGS->I2S_TXCTRL     = I2S_TXCTRL_TXDEFAULT_ZERO | I2S_TXCTRL_TXSAME_ZERO | I2S_TXCTRL_DATASIZE_16C
+                             | I2S_TXCTRL_SLOTADJ_LEFT | I2S_TXCTRL_DMA_SINGLE;
+
+    /* PA09 (FS0), PA10 (SCK0), PA11 (SDO) -> peripheral J */
+    PORT_REGS->GROUP[0].PORT_PMUX[9u >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[9u >> 1] & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(9u));
+    PORT_REGS->GROUP[0].PORT_PMUX[10u >> 1] = PORT_PMUX_PMUXE(9u) | PORT_PMUX_PMUXO(9u);
+    for (uint32_t pin = 9u; pin <= 11u; pin++)
+        PORT_REGS->GROUP[0].PORT_PINCFG[pin] = PORT_PINCFG_PMUXEN_Msk;
+}
+
+/* Clocks, then the serializer: it asks the DMAC for the first frame at once */
+static void sound_i2s_start(void)
+{
+    I2S_REGS->I2S_CTRLA = I2S_CTRLA_ENABLE_Msk | I2S_CTRLA_CKEN0_Msk;
+    while ((I2S_REGS->I2S_SYNCBUSY & (I2S_SYNCBUSY_ENABLE_Msk | I2S_SYNCBUSY_CKEN0_Msk)) != 0u) {}
+    I2S_REGS->I2S_CTRLA |= I2S_CTRLA_TXEN_Msk;
+    while ((I2S_REGS->I2S_SYNCBUSY & I2S_SYNCBUSY_TXEN_Msk) != 0u) {}
+}
+
+#else
+
+static void sound_dac_init(void)
+{
+    /* GCLK2 1 MHz: well below the 100 ksps conversion-rate limit */
+    MCLK_REGS->MCLK_APBDMASK |= MCLK_APBDMASK_DAC_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[DAC_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[DAC_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    DAC_REGS->DAC_CTRLA = DAC_CTRLA_SWRST_Msk;
+    while ((DAC_REGS->DAC_SYNCBUSY & DAC_SYNCBUSY_SWRST_Msk) != 0u) {}
+
+    /* 0 .. VDDANA, output refreshed every 30 us between samples */
+    DAC_REGS->DAC_CTRLB      = DAC_CTRLB_REFSEL_VDDANA;
+    DAC_REGS->DAC_DACCTRL[1] = DAC_DACCTRL_ENABLE_Msk | DAC_DACCTRL_CCTRL_CC100K | DAC_DACCTRL_REFRESH(1u);
+
+    /* PA05 -> peripheral B (VOUT1) */
+    PORT_REGS->GROUP[0].PORT_PMUX[5u >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[5u >> 1] & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(1u));
+    PORT_REGS->GROUP[0].PORT_PINCFG[5] = PORT_PINCFG_PMUXEN_Msk;
+
+    DAC_REGS->DAC_CTRLA = DAC_CTRLA_ENABLE_Msk;
+    while ((DAC_REGS->DAC_SYNCBUSY & DAC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    while ((DAC_REGS->DAC_STATUS & DAC_STATUS_READY1_Msk) == 0u) {}
+    DAC_REGS->DAC_DATA[1] = SOUND_MID;
+}
+
+#endif /* SOUND_OUTPUT */
+
+static void sound_dma_init(void)
+{
+    dmac_descriptor_registers_t *desc0 =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + SOUND_DMA_CHANNEL;
+    const uint16_t btctrl = DMAC_BTCTRL_VALID_Msk | SOUND_BEAT
+                          | DMAC_BTCTRL_SRCINC_Msk | DMAC_BTCTRL_BLOCKACT_INT;
+
+    for (uint32_t i = 0; i < SOUND_BLOCK; i++)
+    {
+        sound_buf[0][i] = SOUND_MID;
+        sound_buf[1][i] = SOUND_MID;
+    }
+
+    desc0->DMAC_BTCTRL   = btctrl;
+    desc0->DMAC_BTCNT    = SOUND_BLOCK;
+    desc0->DMAC_SRCADDR  = (uint32_t)&sound_buf[0][SOUND_BLOCK];     /* end address with SRCINC */
+    desc0->DMAC_DSTADDR  = (uint32_t)SOUND_DST;
+    desc0->DMAC_DESCADDR = (uint32_t)&sound_desc1;
+
+    sound_desc1.DMAC_BTCTRL   = btctrl;
+    sound_desc1.DMAC_BTCNT    = SOUND_BLOCK;
+    sound_desc1.DMAC_SRCADDR  = (uint32_t)&sound_buf[1][SOUND_BLOCK];
+    sound_desc1.DMAC_DSTADDR  = (uint32_t)SOUND_DST;
+    sound_desc1.DMAC_DESCADDR = (uint32_t)desc0;
+
+    DMAC_REGS->CHANNEL[SOUND_DMA_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(SOUND_TRIGGER) | DMAC_CHCTRLA_TRIGACT_BURST;       /* one sample per overflow / frame */
+    Dma_Assign(SOUND_DMA_CHANNEL, DMA_CLASS_REALTIME);
+    (void)Dma_OtherRegister(SOUND_DMA_CHANNEL, sound_dma_isr);
+    DMAC_REGS->CHANNEL[SOUND_DMA_CHANNEL].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk;
+    DMAC_REGS->CHANNEL[SOUND_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+}
+
+#if SOUND_OUTPUT == SOUND_OUT_DAC
+/* TCC2 overflow every SOUND_TIMER_PER GCLK0 cycles -> DMA trigger */
+static void sound_timer_init(void)
+{
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_TCC2_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TCC2_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK0 | GCLK_PCHCTRL_CHEN_Msk;   /* shared with TCC3 */
+    while ((GCLK_REGS->GCLK_PCHCTRL[TCC2_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    TCC2_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC2_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TCC2_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV1;
+    TCC2_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NFRQ;
+    TCC2_REGS->TCC_PER   = SOUND_TIMER_PER - 1u;
+    while (TCC2_REGS->TCC_SYNCBUSY != 0u) {}
+    TCC2_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    while ((TCC2_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+}
+#endif
+
+#endif /* SOUND_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Sound_Register(uint8_t id, const sound_clip_t *clip)
+{
+    if (id >= SOUND_CLIPS) return false;
+
+    sound_clip[id] = clip;
+    return true;
+}
+
+void Sound_Start(void)
+{
+#if SOUND_ENABLE
+    sound_queue = xQueueCreateStatic(SOUND_CUE_QUEUE, sizeof(sound_cue_t),
+                                     sound_queue_store, &sound_queue_buf);
+    LOADTEST_NAME(sound_queue, "sound");
+    sound_task_handle = xTaskCreateStatic(sound_task, "Sound", SOUND_STACK, NULL, SOUND_TASK_PRIO,
+                                          sound_stack, &sound_tcb);
+    (void)Cli_Register(&sound_volume_param);
+#if SOUND_OUTPUT == SOUND_OUT_I2S
+    sound_i2s_init();
+    sound_dma_init();
+    sound_i2s_start();                          /* first frame from here */
+#else
+    sound_dac_init();
+    sound_dma_init();
+    sound_timer_init();                         /* first sample from here */
+#endif
+#endif
+}
+
+bool Sound_Cue(uint8_t id, uint16_t gain, uint32_t delay_ms)
+{
+#if SOUND_ENABLE
+    sound_cue_t c;
+
+    if (id >= SOUND_CLIPS || sound_clip[id] == NULL || sound_clip[id]->len == 0u)
+    {
+        sound_dropped++;
+        return false;
+    }
+    c.id     = id;
+    c.stream = -1;
+    c.gain   = gain;
+    c.start = sound_now() + SOUND_LATENCY + delay_ms * (SOUND_RATE_HZ / 50u) / 20u;
+    if (xQueueSend(sound_queue, &c, 0) != pdPASS)
+    {
+        sound_dropped++;
+        return false;
+    }
+    return true;
+#else
+    (void)id;
+    (void)gain;
+    (void)delay_ms;
+    return false;
+#endif
+}
+
+bool Sound_CueStream(int32_t stream, uint16_t gain)
+{
+#if SOUND_ENABLE
+    sound_cue_t c;
+
+    if (stream < 0 || stream > 127)
+    {
+        sound_dropped++;
+        return false;
+    }
+    c.id     = SOUND_STREAM_ID;
+    c.stream = (int8_t)stream;
+    c.gain   = gain;
+    c.start  = sound_now() + SOUND_LATENCY;
+    if (xQueueSend(sound_queue, &c, 0) != pdPASS)
+    {
+        Stream_Close(stream);
+        sound_dropped++;
+        return false;
+    }
+    return true;
+#else
+    Stream_Close(stream);
+    (void)gain;
+    return false;
+#endif
+}
+
+void Sound_StopAll(void)
+{
+#if SOUND_ENABLE
+    sound_cue_t c = { SOUND_STOP_ID, -1, 0u, 0u };
+
+    (void)xQueueSend(sound_queue, &c, 0);
+#endif
+}
+
+uint32_t Sound_Late(void)
+{
+    return sound_late;
+}
+
+uint32_t Sound_Dropped(void)
+{
+    return sound_dropped;
+}
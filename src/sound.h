@@ -0,0 +1,153 @@
+/* =============================================================================
+ * sound.h  -  DAC or I2S sound-effect playback in step with the actuator
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Clips are signed 8-bit mono PCM at SOUND_RATE_HZ in flash
+ * (tools/wav2clip.py makes one from a WAV file), registered by id with
+ * Sound_Register(), or 16-bit sound in 4-bit IMA-ADPCM (SOUND_FMT_ADPCM,
+ * adpcm.h), half the bytes again, decoded by the mixer as it plays. Output is DAC1 on PA05 (VOUT1; VOUT0 is PA02, the
+ * motor_sense.h shunt input) into a small audio amplifier. The CPU takes
+ * no part in the sample timing:
+ *
+ *   TCC2 overflow (GCLK0 120 MHz / SOUND_TIMER_PER = SOUND_RATE_HZ)
+ *     -> DMAC SOUND_DMA_CHANNEL trigger, one half word per overflow
+ *     -> DAC DATA1, from a two-block ping-pong ring
+ *
+ * Each block played (SOUND_BLOCK samples) raises one DMAC interrupt that
+ * wakes the "Sound" task, which mixes the next block but one into the
+ * half just freed: up to SOUND_VOICES clips summed in fixed point with
+ * their gain and the "volume" parameter, saturated to 12 bits around
+ * mid-scale. Between sounds the DAC rests at mid-scale, so there is no
+ * click at a start.
+ *
+ * Timing: a cue is stamped with the sample being played when it is made
+ * (block count plus DWT cycles since that block began), and the voice
+ * starts exactly SOUND_LATENCY samples later, whatever the load, since
+ * the mixer places it at its offset inside the block. So a cue made on a
+ * relay edge stays sample-locked to it. The actuator sequence engine
+ * makes them: an ACT_SOUND() step in a table (actuator.h) fires with the
+ * next drive step, or a set time after it; with ACT_HW_TIMING the cues
+ * are stamped against the TCC1 pattern start, edge-exact as well.
+ *
+ * A voice can also play a file from the SD card as it is read
+ * (Sound_CueStream(), stream.h), for music and long clips.
+ *
+ * With SOUND_OUTPUT = SOUND_OUT_I2S the same mixer feeds an external I2S
+ * DAC / amplifier (PCM5102A, MAX98357A, UDA1334A: any that makes its own
+ * master clock from BCLK) instead, 16-bit, the mono mix on both channels:
+ *
+ *   GCLK5 (DPLL0 120 MHz / SOUND_I2S_GCLK_DIV) -> I2S clock unit 0
+ *     SCK = / SOUND_I2S_SCK_DIV, FS = SCK / 32 (two 16-bit slots)
+ *     -> TXRDY -> DMAC SOUND_DMA_CHANNEL, one word (L | R) per frame
+ *     -> the same two-block ping-pong ring
+ *
+ *   PA10  SCK (BCLK)      PA09  FS (LRCK)      PA11  SDO (DIN)
+ *
+ * The sample rate is then 120 MHz / SOUND_TIMER_PER = 22058.8 Hz, 0.04 %
+ * over the clips' 22050 (inaudible). DPLL0 and the show clock (showclock.h)
+ * both run from GCLK2, so audio and show time keep an exact ratio: three
+ * samples every 136 us, with no drift between a cue and the sound it
+ * stamps. TCC2 is not used. Clock unit 0's only pins are these (SDHC0 and
+ * QSPI data) or the lid relays, so I2S builds without SDCARD_ENABLE and
+ * QFLASH_ENABLE: its clips are the ones registered from internal flash.
+ *
+ * A block mixed after its playback began is counted by Sound_Late(), a
+ * cue that found no clip or no room by Sound_Dropped(); a new cue takes
+ * the voice furthest into its clip when all are busy.
+ * ============================================================================= */
+
+#ifndef SOUND_H
+#define SOUND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define SOUND_OUT_DAC           0       /* DAC1, PA05                            */
+#define SOUND_OUT_I2S           1       /* external codec on PA09..PA11          */
+
+#define SOUND_ENABLE            0       /* 1 = build and start playback          */
+#define SOUND_OUTPUT            SOUND_OUT_DAC
+#define SOUND_RATE_HZ           22050u
+#define SOUND_I2S_GCLK_DIV      10u     /* GCLK5: 120 MHz / 10 = 12 MHz          */
+#define SOUND_I2S_SCK_DIV       17u     /* BCLK 705.9 kHz, 32 per frame          */
+#define SOUND_BLOCK             256u    /* samples per DMA block, 11.6 ms       */
+#define SOUND_LATENCY           (2u * SOUND_BLOCK)     /* cue to first sample   */
+#define SOUND_VOICES            4u
+#define SOUND_CLIPS             16u     /* registered ids 0..SOUND_CLIPS-1      */
+#define SOUND_CUE_QUEUE         8u      /* cues in flight to the mixer          */
+#define SOUND_VOLUME            192u    /* default "volume", / 255              */
+#define SOUND_TASK_PRIO         3u      /* with NeoPixel: a block is 11.6 ms    */
+#define SOUND_DMA_CHANNEL       5u      /* DMA_OTHER channel, dma_qos.h          */
+#define SOUND_GAIN_UNITY        256u    /* clip gain: 256 = as recorded          */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#if SOUND_OUTPUT == SOUND_OUT_I2S
+#define SOUND_TIMER_PER         (SOUND_I2S_GCLK_DIV * SOUND_I2S_SCK_DIV * 32u)   /* GCLK0 counts per sample */
+#else
+#define SOUND_TIMER_PER         (120000000u / SOUND_RATE_HZ)                     /* GCLK0 counts per sample */
+#endif
+
+/* Clip ids the built-in actuator sequences cue; others are free for
+ * timeline / CLI use */
+typedef enum
+{
+    SOUND_CREAK = 0,                    /* lid starts to open    */
+    SOUND_SLAM,                         /* lid slammed down      */
+    SOUND_BUILTIN_COUNT
+} sound_id_t;
+
+typedef enum
+{
+    SOUND_FMT_PCM8 = 0,                 /* signed 8-bit                  */
+    SOUND_FMT_ADPCM                     /* adpcm.h blocks                */
+} sound_fmt_t;
+
+typedef struct
+{
+    const int8_t *pcm;                  /* SOUND_RATE_HZ, mono, in flash */
+    uint32_t      len;                  /* samples                       */
+    uint8_t       fmt;                  /* sound_fmt_t, 0 = PCM8         */
+} sound_clip_t;
+
+/**
+ * Make `clip` the sound for cue `id`; the clip must stay valid for good.
+ * Before Sound_Start(); false if `id` is out of range.
+ */
+bool Sound_Register(uint8_t id, const sound_clip_t *clip);
+
+/**
+ * Set up TCC2 and the DAC (or the I2S) and the DMA ring, register
+ * "volume" with cli.h and create the task (static). After Dma_Init() and
+ * Metrics_Init() (DWT), before Cli_Start() and the scheduler. No-op unless
+ * SOUND_ENABLE.
+ */
+void Sound_Start(void);
+
+/**
+ * Play clip `id` at `gain` (SOUND_GAIN_UNITY = as recorded) starting
+ * exactly SOUND_LATENCY samples plus `delay_ms` from now. Any task, never
+ * blocks; false (and counted as dropped) if the id has no clip or the cue
+ * queue is full.
+ */
+bool Sound_Cue(uint8_t id, uint16_t gain, uint32_t delay_ms);
+
+/**
+ * Play an open stream (stream.h, the same PCM format as a clip) at `gain`
+ * from SOUND_LATENCY samples from now until its file ends. The mixer owns
+ * the handle from here and closes it when done or stopped; an underrun
+ * plays as silence. Open the stream early enough for Stream_Ready().
+ * False (and the stream closed) if the cue queue is full.
+ */
+bool Sound_CueStream(int32_t stream, uint16_t gain);
+
+/** Silence every voice and pending cue at the next block. Any task. */
+void Sound_StopAll(void);
+
+/** Blocks mixed too late for their slot since boot. */
+uint32_t Sound_Late(void);
+
+/** Cues lost: no clip registered, cue queue full. */
+uint32_t Sound_Dropped(void);
+
+#endif /* SOUND_H */
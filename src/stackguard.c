@@ -0,0 +1,95 @@
+/* =============================================================================
+ * stackguard.c  -  MPU no-access guard at the bottom of the running task's stack
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "stackguard.h"
+#include "definitions.h"        /* core_cm4.h: MPU, SCB; mpu_armv7.h */
+
+_Static_assert((STACKGUARD_BYTES & (STACKGUARD_BYTES - 1u)) == 0u && STACKGUARD_BYTES >= 32u,
+               "STACKGUARD_BYTES: a power of two, 32 at the least");
+
+/* No access, never executed, normal memory; RASR SIZE is log2(bytes) - 1 */
+#define SG_RASR     ARM_MPU_RASR(1u, ARM_MPU_AP_NONE, 0u, 0u, 0u, 0u, 0u, \
+                                 (uint32_t)__builtin_ctz(STACKGUARD_BYTES) - 1u)
+
+#define SG_STACKED  (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_MLSPERR_Msk)   /* exception entry pushes */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t sg_base;       /* guard of the running task, 0 before the first */
+
+static uint32_t sg_guard(const void *stack)
+{
+    return ((uint32_t)stack + STACKGUARD_BYTES - 1u) & ~(STACKGUARD_BYTES - 1u);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void StackGuard_Init(void)
+{
+#if STACKGUARD_ENABLE
+    /* No guard until the first task is switched in; MemManage is enabled by Fault_Init() */
+    ARM_MPU_ClrRegion(STACKGUARD_REGION);
+    ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+#endif
+}
+
+void StackGuard_SwitchedIn(const void *stack)
+{
+#if STACKGUARD_ENABLE
+    uint32_t base = sg_guard(stack);
+
+    /* RBAR with VALID selects the region too. Exception return from
+     * PendSV synchronises the writes */
+    sg_base   = base;
+    MPU->RBAR = base | MPU_RBAR_VALID_Msk | STACKGUARD_REGION;
+    MPU->RASR = SG_RASR;
+#else
+    (void)stack;
+#endif
+}
+
+void StackGuard_Lift(void)
+{
+#if STACKGUARD_ENABLE
+    MPU->RNR  = STACKGUARD_REGION;
+    MPU->RASR = 0u;
+    __DSB();
+    __ISB();
+#endif
+}
+
+void StackGuard_Restore(void)
+{
+#if STACKGUARD_ENABLE
+    MPU->RNR  = STACKGUARD_REGION;
+    MPU->RASR = SG_RASR;
+    __DSB();
+    __ISB();
+#endif
+}
+
+uint32_t StackGuard_Words(const void *stack)
+{
+#if STACKGUARD_ENABLE
+    return (sg_guard(stack) + STACKGUARD_BYTES - (uint32_t)stack) / 4u;
+#else
+    (void)stack;
+    return 0u;
+#endif
+}
+
+bool StackGuard_Hit(uint32_t cfsr, uint32_t mmfar)
+{
+#if STACKGUARD_ENABLE
+    /* The guard is the only region: a push on exception entry that faults ran into it */
+    if (sg_base == 0u) return false;
+    if ((cfsr & SG_STACKED) != 0u) return true;
+    return (cfsr & SCB_CFSR_MMARVALID_Msk) != 0u && mmfar - sg_base < STACKGUARD_BYTES;
+#else
+    (void)cfsr;
+    (void)mmfar;
+    return false;
+#endif
+}
@@ -0,0 +1,67 @@
+/* =============================================================================
+ * stackguard.h  -  MPU no-access guard at the bottom of the running task's stack
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * configCHECK_FOR_STACK_OVERFLOW 2 compares a 16-byte fill pattern at the
+ * end of the outgoing task's stack on every context switch: four word
+ * compares per switch, and it sees an overflow only after the fact, at the
+ * next switch, and only if the bytes the task wrote over were not 0xA5.
+ *
+ * With STACKGUARD_ENABLE one MPU region (STACKGUARD_REGION, the highest
+ * priority) is made no-access over STACKGUARD_BYTES at the bottom of the
+ * running task's stack, moved on every switch-in (traceTASK_SWITCHED_IN,
+ * two register writes). All other memory keeps the default map
+ * (PRIVDEFENA; the tasks run privileged). The first push or store into
+ * the guard raises MemManage at the faulting instruction, before anything
+ * below the stack is touched, and the fault capture (fault.h) records it as
+ * a stack overflow of the running task with the stacked pc of the offender.
+ * The pattern check is then compiled out (FreeRTOSConfig.h).
+ *
+ * The guard starts at the first STACKGUARD_BYTES-aligned address in the
+ * stack, so each task loses STACKGUARD_BYTES plus up to STACKGUARD_BYTES - 4
+ * of alignment off the bottom of its stack; StackGuard_Words() is the
+ * figure stackmon.c takes off the free words. A frame that moves sp down
+ * by more than the guard in one go (a large local array) can still step
+ * over it without touching it.
+ *
+ * The interrupt stack (MSP) and DMA are not covered. The kernel's own
+ * high-water scan reads every stack from its very bottom, so the guard of
+ * the caller is lifted around it (StackGuard_Lift()).
+ * ============================================================================= */
+
+#ifndef STACKGUARD_H
+#define STACKGUARD_H
+
+#include <stdint.h>             /* no FreeRTOS.h: FreeRTOSConfig.h includes this */
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef STACKGUARD_ENABLE
+#define STACKGUARD_ENABLE   1       /* 0 = fill pattern check on every switch */
+#endif
+#define STACKGUARD_REGION   7u      /* MPU region, the highest wins overlaps  */
+#define STACKGUARD_BYTES    32u     /* power of two, 32 at the least          */
+
+/** Enable the MPU and MemManage reporting. Before the scheduler. */
+void StackGuard_Init(void);
+
+/** Context-switch hook (traceTASK_SWITCHED_IN): guard the bottom of `stack` (TCB pxStack). */
+void StackGuard_SwitchedIn(const void *stack);
+
+/**
+ * Lift the running task's guard until StackGuard_Restore(), for a read
+ * from the very bottom of its stack (uxTaskGetSystemState()). Task level,
+ * no blocking in between: a switch-out and in puts the guard back.
+ */
+void StackGuard_Lift(void);
+
+/** Put the running task's guard back after StackGuard_Lift(). */
+void StackGuard_Restore(void);
+
+/** Words lost to the guard and its alignment at the bottom of `stack`; 0 when disabled. */
+uint32_t StackGuard_Words(const void *stack);
+
+/** Whether a MemManage with these CFSR and MMFAR hit the guard (or stacked into it). */
+bool StackGuard_Hit(uint32_t cfsr, uint32_t mmfar);
+
+#endif /* STACKGUARD_H */
@@ -0,0 +1,105 @@
+/* =============================================================================
+ * stackmon.c  -  Task stack high-water marks and right-sizing report
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "stackmon.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "stackguard.h"
+#include "log.h"
+#include <string.h>
+
+#if configRECORD_STACK_HIGH_ADDRESS != 1
+#error "stackmon.c needs configRECORD_STACK_HIGH_ADDRESS 1 for the stack sizes"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Timer service task only */
+static TaskStatus_t      stackmon_ts[STACKMON_MAX_TASKS];
+static TaskHandle_t      stackmon_warned[STACKMON_MAX_TASKS];
+static StaticTimer_t     stackmon_timer;
+
+/* Written by the timer task with the scheduler suspended, see StackMon_Read() */
+static stackmon_report_t stackmon_report;
+static volatile uint32_t stackmon_min_free = 0xFFFFu;
+
+static uint16_t stackmon_recommend(uint32_t used)
+{
+    uint32_t margin = used / 4u;
+
+    if (margin < STACKMON_MARGIN_WORDS) margin = STACKMON_MARGIN_WORDS;
+    used += margin + STACKMON_ROUND_WORDS - 1u;
+    return (uint16_t)(used - used % STACKMON_ROUND_WORDS);
+}
+
+/* Log a task once when it first runs short */
+static void stackmon_warn(const TaskStatus_t *ts, const stackmon_task_t *t)
+{
+    uint32_t k;
+
+    for (k = 0; k < STACKMON_MAX_TASKS && stackmon_warned[k] != NULL; k++)
+        if (stackmon_warned[k] == ts->xHandle) return;
+    if (k < STACKMON_MAX_TASKS) stackmon_warned[k] = ts->xHandle;
+    LOG_WARN("stack: %s %u of %u words free", ts->pcTaskName,
+             (unsigned)(t->size - t->used), (unsigned)t->size);
+}
+
+static void stackmon_sample(TimerHandle_t timer)
+{
+    UBaseType_t n;
+    uint32_t    min_free = 0xFFFFu;
+
+    (void)timer;
+    vTaskSuspendAll();
+    /* The high-water scan reads this task's own stack bottom too, under its guard */
+    StackGuard_Lift();
+    n = uxTaskGetSystemState(stackmon_ts, STACKMON_MAX_TASKS, NULL);
+    StackGuard_Restore();
+    stackmon_report.count = n;
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        const TaskStatus_t *ts   = &stackmon_ts[i];
+        stackmon_task_t    *t    = &stackmon_report.task[i];
+        uint32_t            size = (uint32_t)(ts->pxEndOfStack - ts->pxStackBase) + 1u;
+        uint32_t            lost = StackGuard_Words(ts->pxStackBase);
+        uint32_t            free = (ts->usStackHighWaterMark > lost) ? ts->usStackHighWaterMark - lost : 0u;
+
+        strncpy(t->name, ts->pcTaskName, sizeof(t->name) - 1u);
+        t->name[sizeof(t->name) - 1u] = '\0';
+        t->size      = (uint16_t)size;
+        t->used      = (uint16_t)(size - free);
+        t->recommend = stackmon_recommend(size - free);
+        if (free < min_free) min_free = free;
+    }
+    (void)xTaskResumeAll();
+    stackmon_min_free = min_free;
+
+    for (UBaseType_t i = 0; i < n; i++)
+        if ((uint32_t)(stackmon_report.task[i].size - stackmon_report.task[i].used) < STACKMON_WARN_WORDS)
+            stackmon_warn(&stackmon_ts[i], &stackmon_report.task[i]);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool StackMon_Start(void)
+{
+    TimerHandle_t t = xTimerCreateStatic("StackMon", pdMS_TO_TICKS(STACKMON_PERIOD_MS), pdTRUE,
+                                         NULL, stackmon_sample, &stackmon_timer);
+
+    return xTimerStart(t, 0) == pdPASS;
+}
+
+void StackMon_Read(stackmon_report_t *out)
+{
+    vTaskSuspendAll();
+    memcpy(out, &stackmon_report, sizeof(*out));
+    (void)xTaskResumeAll();
+}
+
+uint32_t StackMon_MinFree(void)
+{
+    return stackmon_min_free;
+}
@@ -0,0 +1,62 @@
+/* =============================================================================
+ * stackmon.h  -  Task stack high-water marks and right-sizing report
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Every STACKMON_PERIOD_MS a timer callback reads the high-water mark of
+ * every task (uxTaskGetSystemState(), the same scan as
+ * uxTaskGetStackHighWaterMark() - the 0xA5 the kernel paints new stacks
+ * with) together with the stack size (configRECORD_STACK_HIGH_ADDRESS)
+ * and keeps per task:
+ *
+ *   size       words given to xTaskCreateStatic() / the kernel hooks
+ *   used       deepest use since boot (size - high-water mark), counting
+ *              the words lost to the MPU guard (StackGuard_Words())
+ *   recommend  used + max(used / 4, STACKMON_MARGIN_WORDS), rounded up
+ *              to STACKMON_ROUND_WORDS
+ *
+ * A task whose headroom drops below STACKMON_WARN_WORDS is logged once, well
+ * before the stack guard would fault it. The CLI "stack" command prints the
+ * table and the words a resize would free; telemetry carries the smallest
+ * headroom of any task ("stack_min_free"). Run every effect and a visitor
+ * sequence before trusting the numbers: only paths taken get measured.
+ *
+ * Not covered: the interrupt stack (MSP, sized by the linker).
+ * ============================================================================= */
+
+#ifndef STACKMON_H
+#define STACKMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define STACKMON_PERIOD_MS      5000u
+#define STACKMON_MAX_TASKS      12u
+#define STACKMON_MARGIN_WORDS   32u         /* least headroom a recommendation keeps */
+#define STACKMON_ROUND_WORDS    16u
+#define STACKMON_WARN_WORDS     24u         /* log when headroom falls below this    */
+
+typedef struct
+{
+    char     name[16];
+    uint16_t size;              /* words */
+    uint16_t used;              /* words, peak since boot */
+    uint16_t recommend;         /* words */
+} stackmon_task_t;
+
+typedef struct
+{
+    uint32_t        count;      /* 0 = not sampled yet */
+    stackmon_task_t task[STACKMON_MAX_TASKS];
+} stackmon_report_t;
+
+/** Create (static) and start the sampling timer. Before the scheduler. */
+bool StackMon_Start(void);
+
+/** Copy of the latest table. Any task. */
+void StackMon_Read(stackmon_report_t *out);
+
+/** Smallest headroom of any task in words, 0xFFFF before the first sample. */
+uint32_t StackMon_MinFree(void);
+
+#endif /* STACKMON_H */
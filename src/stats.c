@@ -0,0 +1,208 @@
+/* =============================================================================
+ * stats.c  -  Visitor statistics: dwell-time histogram and arrival rates
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "stats.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "nvstore.h"
+#include "nvwrite.h"
+#include "log.h"
+#include <string.h>
+
+#define STATS_KEY_TOTAL     NVSTORE_KEY('S', 'T', 'A', 'T')
+#define STATS_KEY_HIST0     NVSTORE_KEY('S', 'T', 'H', '0')    /* buckets 0..3 */
+#define STATS_KEY_HIST1     NVSTORE_KEY('S', 'T', 'H', '1')    /* buckets 4..7 */
+#define STATS_KEY_PEAK      NVSTORE_KEY('S', 'T', 'P', 'K')
+
+#if STATS_DWELL_BUCKETS != 8u
+#error "the NVM layout holds 8 histogram buckets"
+#endif
+
+#define STATS_MIN_MS        60000u
+#define STATS_MINUTES       60u
+#define STATS_HOURS         24u
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static stats_t    stats_life;                   /* lifetime fields only       */
+static uint8_t    stats_min[STATS_MINUTES];     /* arrivals per minute, ring  */
+static uint16_t   stats_hour[STATS_HOURS];      /* arrivals per hour, ring    */
+static uint16_t   stats_min_sum;                /* sum of stats_min           */
+static uint32_t   stats_minute;                 /* minute of uptime now       */
+static bool       stats_present;
+static TickType_t stats_since;                  /* arrival of the visitor now */
+static TickType_t stats_saved;                  /* tick of the last save      */
+static bool       stats_dirty;
+
+static inline uint32_t stats_now_min(void)
+{
+    return (uint32_t)(((uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS) / STATS_MIN_MS);
+}
+
+/* Roll the minute and hour rings forward to now; caller holds the lock */
+static void stats_advance(void)
+{
+    uint32_t now = stats_now_min();
+    uint32_t gap = now - stats_minute;
+
+    /* At most one full turn of each ring, whatever the gap */
+    for (uint32_t i = 0; i < gap && i < STATS_MINUTES; i++)
+    {
+        uint32_t m = (stats_minute + 1u + i) % STATS_MINUTES;
+        stats_min_sum -= stats_min[m];
+        stats_min[m] = 0u;
+    }
+    uint32_t hgap = now / STATS_MINUTES - stats_minute / STATS_MINUTES;
+    for (uint32_t i = 0; i < hgap && i < STATS_HOURS; i++)
+        stats_hour[(stats_minute / STATS_MINUTES + 1u + i) % STATS_HOURS] = 0u;
+    stats_minute = now;
+}
+
+/* Histogram bucket of a dwell: 0 for < 1 s, then one per power of two */
+static inline uint8_t stats_bucket(uint32_t seconds)
+{
+    uint32_t b = (seconds == 0u) ? 0u : 32u - (uint32_t)__builtin_clz(seconds);
+    return (uint8_t)((b < STATS_DWELL_BUCKETS) ? b : STATS_DWELL_BUCKETS - 1u);
+}
+
+static void stats_arrive(void)
+{
+    uint32_t m = stats_minute % STATS_MINUTES;
+    uint32_t h = (stats_minute / STATS_MINUTES) % STATS_HOURS;
+
+    if (stats_min[m] < UINT8_MAX) { stats_min[m]++; stats_min_sum++; }
+    if (stats_hour[h] < UINT16_MAX) stats_hour[h]++;
+    if (stats_hour[h] > stats_life.peak_ever) stats_life.peak_ever = stats_hour[h];
+    stats_life.arrivals++;
+}
+
+static void stats_leave(uint32_t ms)
+{
+    uint8_t b = stats_bucket(ms / 1000u);
+
+    if (stats_life.dwell_hist[b] < UINT16_MAX) stats_life.dwell_hist[b]++;
+    stats_life.dwell_s += (ms + 500u) / 1000u;
+}
+
+static void stats_pack(uint32_t rec[NVSTORE_WORDS], uint8_t first)
+{
+    const uint16_t *h = &stats_life.dwell_hist[first];
+
+    rec[0] = (uint32_t)h[0] | ((uint32_t)h[1] << 16);
+    rec[1] = (uint32_t)h[2] | ((uint32_t)h[3] << 16);
+}
+
+static void stats_unpack(const uint32_t rec[NVSTORE_WORDS], uint8_t first)
+{
+    uint16_t *h = &stats_life.dwell_hist[first];
+
+    h[0] = (uint16_t)rec[0]; h[1] = (uint16_t)(rec[0] >> 16);
+    h[2] = (uint16_t)rec[1]; h[3] = (uint16_t)(rec[1] >> 16);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Stats_Init(void)
+{
+    uint32_t rec[NVSTORE_WORDS];
+
+    memset(&stats_life, 0, sizeof(stats_life));
+    if (NvStore_Load(STATS_KEY_TOTAL, rec)) { stats_life.arrivals = rec[0]; stats_life.dwell_s = rec[1]; }
+    if (NvStore_Load(STATS_KEY_HIST0, rec)) stats_unpack(rec, 0u);
+    if (NvStore_Load(STATS_KEY_HIST1, rec)) stats_unpack(rec, 4u);
+    if (NvStore_Load(STATS_KEY_PEAK, rec))  stats_life.peak_ever = (uint16_t)rec[0];
+
+    memset(stats_min, 0, sizeof(stats_min));
+    memset(stats_hour, 0, sizeof(stats_hour));
+    stats_min_sum = 0u;
+    stats_minute  = stats_now_min();
+    stats_present = false;
+    stats_saved   = xTaskGetTickCount();
+    stats_dirty   = false;
+}
+
+void Stats_Edge(bool detected)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    taskENTER_CRITICAL();
+    stats_advance();
+    if (detected)
+    {
+        /* A lost falling edge just restarts the visit */
+        stats_arrive();
+        stats_present = true;
+        stats_since   = now;
+        stats_dirty   = true;
+    }
+    else if (stats_present)
+    {
+        stats_leave((uint32_t)(now - stats_since) * portTICK_PERIOD_MS);
+        stats_present = false;
+        stats_dirty   = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (stats_dirty && (now - stats_saved) >= pdMS_TO_TICKS(STATS_SAVE_MS))
+        Stats_Save();
+}
+
+void Stats_Get(stats_t *out)
+{
+    uint8_t cur;
+
+    taskENTER_CRITICAL();
+    stats_advance();
+    *out = stats_life;
+    out->last_hour = stats_min_sum;
+    cur = (uint8_t)((stats_minute / STATS_MINUTES) % STATS_HOURS);
+    out->peak_hour = 0u;
+    out->peak_hours_ago = 0u;
+    for (uint8_t i = 0; i < STATS_HOURS; i++)
+    {
+        uint16_t n = stats_hour[(cur + STATS_HOURS - i) % STATS_HOURS];
+        if (n > out->peak_hour) { out->peak_hour = n; out->peak_hours_ago = i; }
+    }
+    taskEXIT_CRITICAL();
+    out->per_min_q8 = (uint16_t)(((uint32_t)out->last_hour * 256u + STATS_MINUTES / 2u) / STATS_MINUTES);
+}
+
+void Stats_Save(void)
+{
+    stats_t  s;
+    uint32_t rec[NVSTORE_WORDS];
+
+    taskENTER_CRITICAL();
+    s = stats_life;
+    stats_dirty = false;
+    taskEXIT_CRITICAL();
+    stats_saved = xTaskGetTickCount();
+
+    /* Written by the NvWrite task, which skips records that did not change */
+    rec[0] = s.arrivals; rec[1] = s.dwell_s;
+    (void)NvWrite_Post(STATS_KEY_TOTAL, rec);
+    stats_pack(rec, 0u);
+    (void)NvWrite_Post(STATS_KEY_HIST0, rec);
+    stats_pack(rec, 4u);
+    (void)NvWrite_Post(STATS_KEY_HIST1, rec);
+    rec[0] = s.peak_ever; rec[1] = 0u;
+    (void)NvWrite_Post(STATS_KEY_PEAK, rec);
+}
+
+void Stats_Print(void)
+{
+    stats_t s;
+
+    Stats_Get(&s);
+    LOG_INFO("stats: arrivals %lu, dwell %lu s", (unsigned long)s.arrivals, (unsigned long)s.dwell_s);
+    LOG_INFO("stats: last hour %u (%u.%02u/min), peak %u %uh ago, ever %u",
+             s.last_hour, s.per_min_q8 >> 8, ((s.per_min_q8 & 0xFFu) * 100u) >> 8,
+             s.peak_hour, s.peak_hours_ago, s.peak_ever);
+    LOG_INFO("stats: dwell <1 s: %u", s.dwell_hist[0]);
+    for (uint8_t b = 1; b < STATS_DWELL_BUCKETS - 1u; b++)
+        LOG_INFO("stats: dwell %lu-%lu s: %u", 1uL << (b - 1u), (1uL << b) - 1uL, s.dwell_hist[b]);
+    LOG_INFO("stats: dwell >=%lu s: %u", 1uL << (STATS_DWELL_BUCKETS - 2u),
+             s.dwell_hist[STATS_DWELL_BUCKETS - 1u]);
+}
@@ -0,0 +1,60 @@
+/* =============================================================================
+ * stats.h  -  Visitor statistics: dwell-time histogram and arrival rates
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Fed with presence edges (Stats_Edge(), from the actuator's presence
+ * handler), every update is O(1):
+ *
+ *   - a dwell-time histogram in power-of-two buckets: <1 s, 1 s, 2-3 s,
+ *     4-7 s ... >= 64 s, with the total time visitors stayed;
+ *   - arrivals in each of the last 60 minutes, summed as they roll over,
+ *     for arrivals per minute over the last hour;
+ *   - arrivals in each of the last 24 hours of uptime, for the peak hour.
+ *
+ * The lifetime counters (arrivals, dwell total, histogram, best hour ever)
+ * survive resets: they are loaded from nvstore.h at Stats_Init() and
+ * posted back (nvwrite.h) at most every STATS_SAVE_MS, on the next edge. Histogram
+ * buckets saturate at 65535.
+ *
+ * Stats_Get() copies a snapshot for any task; Stats_Print() logs it on
+ * the console. Stats_Edge() belongs to one task (the timer service task).
+ * ============================================================================= */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define STATS_DWELL_BUCKETS     8u          /* last bucket: >= 2^(N-2) s      */
+#define STATS_SAVE_MS           (15u * 60u * 1000u)     /* NVM save interval */
+
+typedef struct
+{
+    uint32_t arrivals;                          /* lifetime                   */
+    uint32_t dwell_s;                           /* lifetime seconds present   */
+    uint16_t dwell_hist[STATS_DWELL_BUCKETS];   /* lifetime visits per bucket */
+    uint16_t peak_ever;                         /* best hour of uptime, ever  */
+    uint16_t last_hour;                         /* arrivals, last 60 minutes  */
+    uint16_t per_min_q8;                        /* last_hour / 60, Q8         */
+    uint16_t peak_hour;                         /* best hour, last 24 hours   */
+    uint8_t  peak_hours_ago;                    /* 0 = the current hour       */
+} stats_t;
+
+/** Load the lifetime counters from NVM. Before the scheduler. */
+void Stats_Init(void);
+
+/** One presence edge: true = a visitor arrived, false = they left. One task. */
+void Stats_Edge(bool detected);
+
+/** Consistent snapshot of all counters. Any task. */
+void Stats_Get(stats_t *out);
+
+/** Save the lifetime counters now (if changed). The Stats_Edge() task. */
+void Stats_Save(void);
+
+/** Log a snapshot, one line per item, at LOG_INFO. Any task. */
+void Stats_Print(void);
+
+#endif /* STATS_H */
@@ -0,0 +1,78 @@
+/* =============================================================================
+ * status.c  -  Live status screen on the I2C LCD
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "status.h"
+#include "metrics.h"
+#include "lcd_i2c.h"
+#include "i2c_bus.h"
+#include "log.h"
+#include "evbus.h"
+#include "coop.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* A coop.h thread: what must outlive a wait is static */
+static evbus_sub_t  status_sub = EVBUS_NONE;     /* lid moves: redraw at once */
+static TickType_t   status_wake;
+static char         status_line[LCD_COLS + 1];
+static metrics_t    status_m;
+
+/* Next period, or an actuator event before it (same period) */
+static bool status_due(void)
+{
+    evbus_event_t ev;
+
+    if (EventBus_Receive(status_sub, &ev, 0u)) return true;
+    if ((TickType_t)(xTaskGetTickCount() - status_wake) < pdMS_TO_TICKS(STATUS_PERIOD_MS)) return false;
+    status_wake += pdMS_TO_TICKS(STATUS_PERIOD_MS);
+    return true;
+}
+
+static coop_state_t status_thread(coop_t *pt, void *arg)
+{
+    char      *line = status_line;
+    metrics_t *m    = &status_m;
+
+    (void)arg;
+    COOP_BEGIN(pt);
+    status_wake = xTaskGetTickCount();
+
+    for (;;)
+    {
+        Metrics_Read(m);
+
+        (void)Log_Format(line, sizeof(status_line), "F%2u.%u R%4luk D%2u%%    ",
+                         m->neo.fps_q4 >> 4, ((m->neo.fps_q4 & 0xFu) * 10u) >> 4,
+                         (unsigned long)(m->neo.render_cycles / 1000u), m->act.duty_pct);
+        LCD_I2C_FrameWrite(0u, 0u, line);
+
+        if (m->act.last_trigger_ms == 0u)
+        {
+            (void)Log_Format(line, sizeof(status_line), "H%5lu T    -    ", (unsigned long)m->heap_free);
+        }
+        else
+        {
+            uint32_t ago = (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS) - m->act.last_trigger_ms;
+            (void)Log_Format(line, sizeof(status_line), "H%5lu T%5lus    ",
+                             (unsigned long)m->heap_free, (unsigned long)(ago / 1000u));
+        }
+        LCD_I2C_FrameWrite(0u, 1u, line);
+
+        COOP_WAIT_UNTIL(pt, status_due());
+    }
+    COOP_END(pt);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Status_Start(void)
+{
+    I2c_Init();
+    if (!LCD_I2C_FrameStart(STATUS_LCD_ADDR)) return false;
+    status_sub = EventBus_Subscribe(EVBUS_MASK(EVBUS_ACTUATOR));
+    return Coop_Add("status", status_thread, NULL);
+}
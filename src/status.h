@@ -0,0 +1,31 @@
+/* =============================================================================
+ * status.h  -  Live status screen on the I2C LCD
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A thread of the Coop task (coop.h) reads the metrics snapshot
+ * (metrics.h) every STATUS_PERIOD_MS, and within COOP_POLL_MS of an
+ * actuator event (evbus.h), and writes it into the LCD shadow
+ * framebuffer, whose own thread sends only the cells that changed:
+ *
+ *   F50.0 R 812k D 7%      fps, render kcycles/frame, lid duty
+ *   H 9344 T   42s         free heap bytes, seconds since last trigger
+ *
+ * Neither thread ever waits on, locks or masks anything the NeoPixel task
+ * or the actuator uses, so the screen costs them no jitter.
+ * ============================================================================= */
+
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define STATUS_LCD_ENABLE   0           /* 1 = build and start the status screen */
+#define STATUS_LCD_ADDR     0x27u       /* PCF8574 backpack (0x3F on PCF8574A)  */
+#define STATUS_PERIOD_MS    1000u
+
+/** Start I2C, the LCD framebuffer thread and the status thread. Before the scheduler. */
+bool Status_Start(void);
+
+#endif /* STATUS_H */
@@ -0,0 +1,168 @@
+/* =============================================================================
+ * statusled.c  -  Status LED patterns played by TCC3 and the DMAC, no CPU
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "statusled.h"
+#include "definitions.h"        /* PORT_REGS, TCC3_REGS, DMAC_REGS */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "fault.h"
+#include <stdbool.h>
+
+#define SL_TIMER_HZ         (120000000u / 1024u)     /* GCLK0 / DIV1024 */
+#define SL_TIMER_PER        (SL_TIMER_HZ * STATUSLED_SLOT_MS / 1000u)
+#define SL_LAST             (STATUSLED_SLOTS - 1u)
+
+_Static_assert(STATUSLED_SLOTS >= 2u && STATUSLED_SLOTS <= 32u, "a pattern is one 32-bit mask");
+_Static_assert(SL_TIMER_PER >= 1u && SL_TIMER_PER <= 0x10000u, "STATUSLED_SLOT_MS: TCC3 is 16 bits");
+_Static_assert(2u * STATUSLED_CODE_MAX < STATUSLED_SLOTS, "no pause left after STATUSLED_CODE_MAX blinks");
+#if STATUSLED_DMA_CHANNEL < DMA_OTHER_FIRST || STATUSLED_DMA_CHANNEL >= DMA_OTHER_FIRST + DMA_OTHER_COUNT
+#error "STATUSLED_DMA_CHANNEL must be a DMA_OTHER channel with a descriptor slot (dma_qos.h)"
+#endif
+
+static const uint32_t sl_pattern[STATUSLED_PATTERNS] =
+{
+    [STATUSLED_OFF]      = 0x00000000u,
+    [STATUSLED_ON]       = 0xFFFFFFFFu,
+    [STATUSLED_BOOT]     = 0x55555555u,
+    [STATUSLED_OK]       = 0x0F0F0F0Fu,
+    [STATUSLED_DEGRADED] = 0x00050005u,
+};
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t          sl_ring[STATUSLED_SLOTS] DMA_RAM;  /* OUTTGL words, read by the DMAC */
+static volatile uint32_t sl_mask;                   /* playing */
+static volatile uint32_t sl_next;                   /* from the end of this cycle */
+static volatile bool     sl_pending;
+static volatile bool     sl_code;                   /* sl_mask / sl_next is a fault code */
+
+static bool sl_lit(uint32_t mask, uint32_t slot)
+{
+    return ((mask >> slot) & 1u) != 0u;
+}
+
+/* LED where the last slot leaves it, the ring toggles from there */
+static void sl_load(uint32_t mask)
+{
+    if (sl_lit(mask, SL_LAST)) PORT_REGS->GROUP[0].PORT_OUTSET = STATUSLED_PIN;
+    else                       PORT_REGS->GROUP[0].PORT_OUTCLR = STATUSLED_PIN;
+
+    for (uint32_t i = 0; i < STATUSLED_SLOTS; i++)
+        sl_ring[i] = (sl_lit(mask, i) != sl_lit(mask, (i + SL_LAST) % STATUSLED_SLOTS))
+                   ? STATUSLED_PIN : 0u;
+    sl_mask = mask;
+}
+
+/* Block end: the last slot is out, the next trigger is a slot away. DMAC_OTHER ISR */
+static void sl_dma_isr(uint8_t flags)
+{
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) == 0u || !sl_pending) return;
+
+    DMAC_REGS->CHANNEL[STATUSLED_DMA_CHANNEL].DMAC_CHINTENCLR = DMAC_CHINTENCLR_TCMPL_Msk;
+    sl_load(sl_next);
+    sl_pending = false;
+}
+
+static void sl_post(uint32_t mask, bool code)
+{
+    taskENTER_CRITICAL();
+    sl_next    = mask;
+    sl_code    = code;
+    sl_pending = true;
+    /* Every cycle end sets the flag; only the next one may interrupt */
+    DMAC_REGS->CHANNEL[STATUSLED_DMA_CHANNEL].DMAC_CHINTFLAG  = DMAC_CHINTFLAG_TCMPL_Msk;
+    DMAC_REGS->CHANNEL[STATUSLED_DMA_CHANNEL].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk;
+    taskEXIT_CRITICAL();
+}
+
+static uint32_t sl_code_mask(uint32_t n)
+{
+    uint32_t mask = 0u;
+
+    if (n > STATUSLED_CODE_MAX) n = STATUSLED_CODE_MAX;
+    for (uint32_t k = 0; k < n; k++)
+        mask |= 1u << (2u * k);
+    return mask;
+}
+
+/* TCC3 overflow once a slot -> DMA trigger */
+static void sl_timer_init(void)
+{
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_TCC3_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TCC3_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK0 | GCLK_PCHCTRL_CHEN_Msk;   /* shared with TCC2 */
+    while ((GCLK_REGS->GCLK_PCHCTRL[TCC3_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    TCC3_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC3_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TCC3_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV1024 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC3_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NFRQ;
+    TCC3_REGS->TCC_PER   = SL_TIMER_PER - 1u;
+    while (TCC3_REGS->TCC_SYNCBUSY != 0u) {}
+    TCC3_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    while ((TCC3_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+}
+
+/* One descriptor over the ring, linked to itself: a word per trigger for ever */
+static void sl_dma_init(void)
+{
+    dmac_descriptor_registers_t *desc0 =
+        (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR + STATUSLED_DMA_CHANNEL;
+
+    desc0->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_WORD
+                         | DMAC_BTCTRL_SRCINC_Msk | DMAC_BTCTRL_BLOCKACT_INT;
+    desc0->DMAC_BTCNT    = STATUSLED_SLOTS;
+    desc0->DMAC_SRCADDR  = (uint32_t)&sl_ring[STATUSLED_SLOTS];     /* end address with SRCINC */
+    desc0->DMAC_DSTADDR  = (uint32_t)&PORT_REGS->GROUP[0].PORT_OUTTGL;
+    desc0->DMAC_DESCADDR = (uint32_t)desc0;
+
+    DMAC_REGS->CHANNEL[STATUSLED_DMA_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(TCC3_DMAC_ID_OVF) | DMAC_CHCTRLA_TRIGACT_BURST;    /* one slot per overflow */
+    Dma_Assign((DMAC_CHANNEL)STATUSLED_DMA_CHANNEL, DMA_CLASS_BULK);
+    (void)Dma_OtherRegister(STATUSLED_DMA_CHANNEL, sl_dma_isr);
+    DMAC_REGS->CHANNEL[STATUSLED_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void StatusLed_Init(void)
+{
+    const fault_record_t *r = Fault_Last();
+
+    PORT_REGS->GROUP[0].PORT_DIRSET = STATUSLED_PIN;
+    sl_code = (r != NULL);
+    sl_load(sl_code ? sl_code_mask(r->cause) : sl_pattern[STATUSLED_BOOT]);
+    sl_dma_init();
+    sl_timer_init();
+}
+
+void StatusLed_Set(statusled_pattern_t p)
+{
+    if ((uint32_t)p < STATUSLED_PATTERNS)
+        sl_post(sl_pattern[p], false);
+}
+
+void StatusLed_Code(uint32_t n)
+{
+    sl_post(sl_code_mask(n), true);
+}
+
+void StatusLed_Booted(void)
+{
+    if (!sl_code && StatusLed_Mask() == sl_pattern[STATUSLED_BOOT])
+        StatusLed_Set(STATUSLED_OK);
+}
+
+void StatusLed_Ack(void)
+{
+    if (sl_code)
+        StatusLed_Set(STATUSLED_OK);
+}
+
+uint32_t StatusLed_Mask(void)
+{
+    return sl_pending ? sl_next : sl_mask;
+}
@@ -0,0 +1,75 @@
+/* =============================================================================
+ * statusled.h  -  Status LED patterns played by TCC3 and the DMAC, no CPU
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The on-board LED (PA14) shows a pattern of STATUSLED_SLOTS slots of
+ * STATUSLED_SLOT_MS each, bit i of a 32-bit mask lighting slot i. TCC3
+ * overflows once per slot and triggers a DMA channel, which writes the
+ * slot's word to PORT OUTTGL from a ring of toggle masks that one
+ * descriptor, linked to itself, walks for ever. No task, no stack and no
+ * interrupt while a pattern plays: the LED keeps its rhythm however busy
+ * the CPU is, and a render task hogging it no longer freezes the blink.
+ *
+ *   STATUSLED_BOOT       4 Hz, from StatusLed_Init() until the deferred
+ *                        inits have run (boot.h)
+ *   STATUSLED_OK         1 Hz, half on
+ *   STATUSLED_DEGRADED   a double blip every 2 s, for a caller to flag
+ *                        reduced operation
+ *   StatusLed_Code(n)    n short blinks and a pause: after a fault reset
+ *                        the LED counts its cause (FAULT_*, fault.h) until
+ *                        "fault ack" on the console
+ *
+ * A new pattern is picked up at the end of a cycle: the channel interrupt
+ * (DMAC_OTHER) is enabled only while one is waiting, sets the LED to where
+ * the new ring starts and swaps the ring, so a toggle is never lost.
+ *
+ * That the LED blinks says the clocks and the DMAC run, not that the tasks
+ * do: the watchdog (watchdog.h) covers those and resets, and the fault is
+ * then counted out here. TCC3 runs on GCLK0, so in tickless STANDBY the LED
+ * holds its state until the wake.
+ * ============================================================================= */
+
+#ifndef STATUSLED_H
+#define STATUSLED_H
+
+#include <stdint.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define STATUSLED_PIN           PORT_PA14   /* group 0, onboard_LED_PIN in MCC          */
+#define STATUSLED_DMA_CHANNEL   12u         /* DMA_OTHER channel, dma_qos.h             */
+#define STATUSLED_SLOTS         32u         /* bits of a pattern                        */
+#define STATUSLED_SLOT_MS       125u        /* 4 s per pattern                          */
+#define STATUSLED_CODE_MAX      12u         /* blinks; the pause is the rest of the ring */
+
+typedef enum
+{
+    STATUSLED_OFF = 0,
+    STATUSLED_ON,
+    STATUSLED_BOOT,
+    STATUSLED_OK,
+    STATUSLED_DEGRADED,
+    STATUSLED_PATTERNS
+} statusled_pattern_t;
+
+/**
+ * Claim TCC3 and the DMA channel and start STATUSLED_BOOT, or the code of
+ * the last fault (Fault_Last()). After Fault_Init() and Dma_Init().
+ */
+void StatusLed_Init(void);
+
+/** Play a pattern from the end of the current cycle. Any task. */
+void StatusLed_Set(statusled_pattern_t p);
+
+/** n (1..STATUSLED_CODE_MAX) short blinks per cycle. Any task. */
+void StatusLed_Code(uint32_t n);
+
+/** Boot is over: STATUSLED_BOOT becomes STATUSLED_OK, a fault code stays. Any task. */
+void StatusLed_Booted(void);
+
+/** The fault code was seen: back to STATUSLED_OK if one is showing. Any task. */
+void StatusLed_Ack(void);
+
+/** The mask playing, or waiting to, bit i = slot i lit. Any task. */
+uint32_t StatusLed_Mask(void);
+
+#endif /* STATUSLED_H */
@@ -0,0 +1,412 @@
+/* =============================================================================
+ * stdio_uart.c  -  stdin / stdout on the SERCOM5 console, by DMA and interrupt
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The C library's read() and write(). MCC's stdio module would generate
+ * polled ones in config/default/stdio/xc32_monitor.c; it is left out of
+ * the MCC project and these take its place.
+ * ============================================================================= */
+
+#include "stdio_uart.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "definitions.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream_buffer.h"
+#include "irqprio.h"
+#include "neopixel.h"           /* NEO_OUTPUTS: DMAC channel ownership */
+#include "dma_qos.h"
+#include "rtos_trace.h"
+#include "irqstat.h"
+#include "tickless.h"
+#include "boot.h"               /* BOOT_DEFER_USART */
+
+/* stdout: write() only copies into STDIO_TX_RING bytes and a DMAC channel
+ * drains the ring into SERCOM5 DATA, one beat per TX-ready trigger. When
+ * the ring is full STDIO_TX_POLICY either drops the rest (counted in
+ * STDIO_TxDropped()) or sleeps the writer until it drains. Before the
+ * scheduler starts the boot does not wait for the UART either: the first
+ * line goes out on the DMA as soon as SERCOM5 is enabled (it may be
+ * deferred, boot.h), the rest once the scheduler unmasks the DMA
+ * interrupt; what does not fit then is dropped. Only an ISR writing
+ * before the first write() polls, and not if SERCOM5 is still off. */
+#define STDIO_TX_DROP           0
+#define STDIO_TX_BLOCK          1
+
+#define STDIO_TX_DMA            1
+#define STDIO_TX_RING           1024U                   /* power of two */
+#define STDIO_TX_POLICY         STDIO_TX_BLOCK
+#define STDIO_TX_DMA_CHANNEL    DMAC_CHANNEL_1
+
+#if STDIO_TX_DMA && ((NEO_OUTPUTS > 1U) || (STDIO_TX_RING & (STDIO_TX_RING - 1U)) != 0U)
+#error "STDIO_TX_DMA_CHANNEL is a NeoPixel output, or STDIO_TX_RING is not a power of two"
+#endif
+#if BOOT_DEFER_USART && !STDIO_TX_DMA
+#error "BOOT_DEFER_USART: pre-scheduler output would poll a disabled SERCOM5"
+#endif
+
+/* stdin: after STDIO_RxStart() the SERCOM5 RXC interrupt collects bytes in
+ * a line buffer and hands it to the STDIO_RX_STREAM byte stream buffer in
+ * one go at a line end ('\r' or '\n'), when it fills, or when the line has
+ * been idle for STDIO_RX_IDLE_BITS bit times (TC3 one-shot, restarted by
+ * every byte). So a task blocked in read() or on STDIO_RxStream() sleeps
+ * until a whole line, or the tail of a paste, is in. Bytes the stream has
+ * no room for are dropped and counted in STDIO_RxOverruns(). TC3 shares
+ * its GCLK channel with TC2 (dsun_sensor.c); both run from the 1 MHz GCLK2. */
+#define STDIO_RX_IRQ            1
+#define STDIO_RX_LINE           64U                     /* line buffer, bytes */
+#define STDIO_RX_STREAM         256U                    /* stream buffer, bytes */
+#define STDIO_RX_BAUD           115200U
+#define STDIO_RX_IDLE_BITS      20U                     /* two characters */
+#define STDIO_RX_IDLE_US        ((STDIO_RX_IDLE_BITS * 1000000U + STDIO_RX_BAUD - 1U) / STDIO_RX_BAUD)
+#define STDIO_RX_IRQ_PRIO       IRQ_PRIO_STDIO          /* irqprio.h */
+#define STDIO_RX_AWAKE_MS       60000U                  /* no standby this long after input */
+
+extern int read(int handle, void *buffer, unsigned int len);
+extern int write(int handle, void * buffer, size_t count);
+
+void STDIO_Init(void)
+{
+    /* Unbuffered both ways: write() queues at once, read() sees every byte */
+    setbuf(stdin, NULL);
+    setbuf(stdout, NULL);
+}
+
+#if STDIO_TX_DMA
+static uint8_t           stdioTxRing[STDIO_TX_RING];
+static volatile uint32_t stdioTxHead;       /* free-running write index */
+static volatile uint32_t stdioTxTail;       /* free-running DMA index   */
+static volatile uint32_t stdioTxBurst;      /* bytes on the DMA, 0 = idle */
+static volatile uint32_t stdioTxDrops;
+static bool              stdioTxReady = false;
+
+/* Start the DMA on the next contiguous run of the ring; interrupts masked */
+static void STDIO_TxKick(void)
+{
+    uint32_t tail = stdioTxTail & (STDIO_TX_RING - 1U);
+    uint32_t len  = stdioTxHead - stdioTxTail;
+
+    if ((stdioTxBurst != 0U) || (len == 0U))
+    {
+        return;
+    }
+    if (len > (STDIO_TX_RING - tail))
+    {
+        len = STDIO_TX_RING - tail;
+    }
+    stdioTxBurst = len;
+    (void)DMAC_ChannelTransfer(STDIO_TX_DMA_CHANNEL, &stdioTxRing[tail],
+                               (const void *)&SERCOM5_REGS->USART_INT.SERCOM_DATA, len);
+}
+
+static void STDIO_TxDone(DMAC_TRANSFER_EVENT event, uintptr_t context)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    (void)event;
+    (void)context;
+    stdioTxTail += stdioTxBurst;
+    stdioTxBurst = 0U;
+    STDIO_TxKick();
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+static void STDIO_TxInit(void)
+{
+    /* One byte to SERCOM5 DATA per DRE trigger */
+    DMAC_ChannelDisable(STDIO_TX_DMA_CHANNEL);
+    DMAC_REGS->CHANNEL[STDIO_TX_DMA_CHANNEL].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT(2U)
+                                                          | DMAC_CHCTRLA_TRIGSRC(SERCOM5_DMAC_ID_TX);
+    (void)DMAC_ChannelSettingsSet(STDIO_TX_DMA_CHANNEL,
+                                  DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BLOCKACT_INT
+                                  | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC_Msk);
+    Dma_Assign(STDIO_TX_DMA_CHANNEL, DMA_CLASS_BULK);
+    DMAC_ChannelCallbackRegister(STDIO_TX_DMA_CHANNEL, STDIO_TxDone, 0U);
+    stdioTxHead  = 0U;
+    stdioTxTail  = 0U;
+    stdioTxBurst = 0U;
+    stdioTxReady = true;
+}
+
+/* Copy what fits into the ring and start the DMA; returns bytes taken */
+static size_t STDIO_TxPut(const uint8_t *data, size_t count)
+{
+    size_t n;
+
+    taskENTER_CRITICAL();
+    if (!stdioTxReady)
+    {
+        STDIO_TxInit();
+    }
+    n = STDIO_TX_RING - (stdioTxHead - stdioTxTail);
+    if (n > count)
+    {
+        n = count;
+    }
+    for (size_t done = 0U; done < n; )
+    {
+        uint32_t at  = (stdioTxHead + done) & (STDIO_TX_RING - 1U);
+        size_t   run = STDIO_TX_RING - at;
+
+        if (run > (n - done))
+        {
+            run = n - done;
+        }
+        (void)memcpy(&stdioTxRing[at], &data[done], run);
+        done += run;
+    }
+    stdioTxHead += n;
+    STDIO_TxKick();
+    taskEXIT_CRITICAL();
+    return n;
+}
+#endif
+
+#if STDIO_RX_IRQ
+static StreamBufferHandle_t stdioRxStream = NULL;
+static StaticStreamBuffer_t stdioRxStreamBuf;
+static uint8_t             stdioRxStreamStore[STDIO_RX_STREAM];
+static uint8_t             stdioRxLine[STDIO_RX_LINE];
+static uint32_t            stdioRxLen;          /* bytes in stdioRxLine, ISRs only */
+static volatile uint32_t   stdioRxOverruns;
+static volatile TickType_t stdioRxLastTick;     /* latest byte, for the standby veto */
+
+/* Move the line buffer into the stream; from the RXC and TC3 ISRs (same priority) */
+static void STDIO_RxFlush(BaseType_t *woken)
+{
+    if (stdioRxLen != 0U)
+    {
+        size_t sent = xStreamBufferSendFromISR(stdioRxStream, stdioRxLine, stdioRxLen, woken);
+
+        stdioRxOverruns += (uint32_t)(stdioRxLen - sent);
+        stdioRxLen = 0U;
+    }
+}
+
+void SERCOM5_2_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    IRQSTAT_ENTER(IRQSTAT_STDIO_RX);
+    RTOS_TRACE_ISR_ENTER();
+    while ((SERCOM5_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_RXC_Msk) != 0U)
+    {
+        uint16_t status = SERCOM5_REGS->USART_INT.SERCOM_STATUS;
+        uint8_t  c      = (uint8_t)SERCOM5_REGS->USART_INT.SERCOM_DATA;   /* clears RXC */
+
+        if ((status & (SERCOM_USART_INT_STATUS_PERR_Msk | SERCOM_USART_INT_STATUS_FERR_Msk |
+                       SERCOM_USART_INT_STATUS_BUFOVF_Msk)) != 0U)
+        {
+            /* Garbled or lost byte: drop it, keep the line */
+            SERCOM5_REGS->USART_INT.SERCOM_STATUS = SERCOM_USART_INT_STATUS_PERR_Msk |
+                SERCOM_USART_INT_STATUS_FERR_Msk | SERCOM_USART_INT_STATUS_BUFOVF_Msk;
+            SERCOM5_REGS->USART_INT.SERCOM_INTFLAG = (uint8_t)SERCOM_USART_INT_INTFLAG_ERROR_Msk;
+            stdioRxOverruns++;
+            continue;
+        }
+        stdioRxLastTick = xTaskGetTickCountFromISR();
+        stdioRxLine[stdioRxLen++] = c;
+        if ((c == (uint8_t)'\r') || (c == (uint8_t)'\n') || (stdioRxLen == STDIO_RX_LINE))
+        {
+            STDIO_RxFlush(&woken);
+        }
+    }
+
+    /* (Re)start the idle timeout while a partial line is waiting */
+    if (stdioRxLen != 0U)
+    {
+        TC3_REGS->COUNT16.TC_CTRLBSET = TC_CTRLBSET_CMD_RETRIGGER;
+    }
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_STDIO_RX);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* Line idle for STDIO_RX_IDLE_BITS: pass on what arrived */
+void TC3_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    IRQSTAT_ENTER(IRQSTAT_STDIO_IDLE);
+    RTOS_TRACE_ISR_ENTER();
+    TC3_REGS->COUNT16.TC_INTFLAG = TC_INTFLAG_OVF_Msk;
+    STDIO_RxFlush(&woken);
+    RTOS_TRACE_ISR_EXIT();
+    IRQSTAT_EXIT(IRQSTAT_STDIO_IDLE);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* Standby would stop SERCOM5: not while TX is queued, nor while someone types */
+static bool STDIO_TicklessVeto(void)
+{
+    return (stdioTxHead != stdioTxTail) ||
+           ((xTaskGetTickCount() - stdioRxLastTick) < pdMS_TO_TICKS(STDIO_RX_AWAKE_MS));
+}
+
+bool STDIO_RxStart(void)
+{
+    if (stdioRxStream != NULL)
+    {
+        return true;
+    }
+    stdioRxStream = xStreamBufferCreateStatic(STDIO_RX_STREAM, 1U, stdioRxStreamStore, &stdioRxStreamBuf);
+    if (stdioRxStream == NULL)
+    {
+        return false;
+    }
+
+    /* TC3: one-shot STDIO_RX_IDLE_US at 1 MHz, stopped until the first byte */
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_TC3_Msk;
+    GCLK_REGS->GCLK_PCHCTRL[TC3_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK2 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[TC3_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0U)
+    {
+    }
+    TC3_REGS->COUNT16.TC_CTRLA = TC_CTRLA_SWRST_Msk;
+    while ((TC3_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_SWRST_Msk) != 0U)
+    {
+    }
+    TC3_REGS->COUNT16.TC_CTRLA  = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1;
+    TC3_REGS->COUNT16.TC_WAVE   = TC_WAVE_WAVEGEN_MFRQ;
+    TC3_REGS->COUNT16.TC_CC[0]  = STDIO_RX_IDLE_US - 1U;
+    TC3_REGS->COUNT16.TC_CTRLBSET = TC_CTRLBSET_ONESHOT_Msk;
+    while ((TC3_REGS->COUNT16.TC_SYNCBUSY & (TC_SYNCBUSY_CTRLB_Msk | TC_SYNCBUSY_CC0_Msk)) != 0U)
+    {
+    }
+    TC3_REGS->COUNT16.TC_INTFLAG  = TC_INTFLAG_Msk;
+    TC3_REGS->COUNT16.TC_INTENSET = TC_INTENSET_OVF_Msk;
+    TC3_REGS->COUNT16.TC_CTRLA |= TC_CTRLA_ENABLE_Msk;
+    while ((TC3_REGS->COUNT16.TC_SYNCBUSY & TC_SYNCBUSY_ENABLE_Msk) != 0U)
+    {
+    }
+    TC3_REGS->COUNT16.TC_CTRLBSET = TC_CTRLBSET_CMD_STOP;
+
+    NVIC_SetPriority(TC3_IRQn, STDIO_RX_IRQ_PRIO);
+    NVIC_ClearPendingIRQ(TC3_IRQn);
+    NVIC_EnableIRQ(TC3_IRQn);
+
+    /* Drop whatever the receiver holds, then take RXC by interrupt */
+    while ((SERCOM5_REGS->USART_INT.SERCOM_INTFLAG & SERCOM_USART_INT_INTFLAG_RXC_Msk) != 0U)
+    {
+        (void)SERCOM5_REGS->USART_INT.SERCOM_DATA;
+    }
+    stdioRxLen = 0U;
+    NVIC_SetPriority(SERCOM5_2_IRQn, STDIO_RX_IRQ_PRIO);
+    NVIC_ClearPendingIRQ(SERCOM5_2_IRQn);
+    NVIC_EnableIRQ(SERCOM5_2_IRQn);
+    SERCOM5_REGS->USART_INT.SERCOM_INTENSET = (uint8_t)SERCOM_USART_INT_INTENSET_RXC_Msk;
+    (void)Tickless_RegisterVeto(STDIO_TicklessVeto);
+    return true;
+}
+
+StreamBufferHandle_t STDIO_RxStream(void)
+{
+    return stdioRxStream;
+}
+
+uint32_t STDIO_RxOverruns(void)
+{
+    return stdioRxOverruns;
+}
+#endif
+
+bool STDIO_TxTryWrite(const void *data, size_t count)
+{
+#if STDIO_TX_DMA
+    bool ok = false;
+
+    if ((__get_IPSR() == 0U) && (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED))
+    {
+        /* All or nothing, so a frame is never split around other output */
+        taskENTER_CRITICAL();
+        if ((STDIO_TX_RING - (stdioTxHead - stdioTxTail)) >= count)
+        {
+            (void)STDIO_TxPut(data, count);
+            ok = true;
+        }
+        taskEXIT_CRITICAL();
+    }
+    return ok;
+#else
+    return write(1, (void *)data, count) == (int)count;
+#endif
+}
+
+uint32_t STDIO_TxDropped(void)
+{
+#if STDIO_TX_DMA
+    return stdioTxDrops;
+#else
+    return 0U;
+#endif
+}
+
+int read(int handle, void *buffer, unsigned int len)
+{
+    int nChars = 0;
+    bool success = false;
+    if ((handle == 0)  && (len > 0U))
+    {
+#if STDIO_RX_IRQ
+        if ((stdioRxStream != NULL) && (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING))
+        {
+            /* Sleep until a line (or an idle-terminated fragment) is in */
+            return (int)xStreamBufferReceive(stdioRxStream, buffer, len, portMAX_DELAY);
+        }
+#endif
+        do
+        {
+            success = SERCOM5_USART_Read(buffer, 1);
+        }while( !success);
+        nChars = 1;
+    }
+    return nChars;
+}
+
+int write(int handle, void * buffer, size_t count)
+{
+   bool success = false;
+   if (handle == 1)
+   {
+#if STDIO_TX_DMA
+       BaseType_t state = xTaskGetSchedulerState();
+
+       if (__get_IPSR() != 0U)
+       {
+           /* Not from ISRs: polling would interleave with the DMA */
+           if (stdioTxReady ||
+               ((SERCOM5_REGS->USART_INT.SERCOM_CTRLA & SERCOM_USART_INT_CTRLA_ENABLE_Msk) == 0U))
+           {
+               stdioTxDrops += (uint32_t)count;
+               return (int)count;
+           }
+       }
+       else
+       {
+           const uint8_t *data = buffer;
+           size_t done = STDIO_TxPut(data, count);
+
+           while (done < count)
+           {
+               if ((STDIO_TX_POLICY == STDIO_TX_BLOCK) && (state == taskSCHEDULER_RUNNING))
+               {
+                   vTaskDelay(1);      /* ~11 bytes leave per ms at 115200 */
+                   done += STDIO_TxPut(&data[done], count - done);
+               }
+               else
+               {
+                   stdioTxDrops += (uint32_t)(count - done);
+                   break;
+               }
+           }
+           return (int)count;
+       }
+#endif
+       do
+       {
+           success = SERCOM5_USART_Write(buffer, count);
+       }while( !success);
+   }
+   return (int)count;
+}
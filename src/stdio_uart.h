@@ -0,0 +1,43 @@
+/* =============================================================================
+ * stdio_uart.h  -  stdin / stdout on the SERCOM5 console, by DMA and interrupt
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * stdout is drained by DMA and stdin is filled by interrupt; see
+ * stdio_uart.c for the buffering and overflow policies.
+ * ============================================================================= */
+
+#ifndef STDIO_UART_H
+#define STDIO_UART_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+
+/** Unbuffered stdin and stdout. Right after SYS_Initialize(), before any printf(). */
+void STDIO_Init(void);
+
+/** Bytes stdout dropped because the TX ring was full. */
+uint32_t STDIO_TxDropped(void);
+
+/**
+ * Queue all `count` bytes for the console or none of them; never blocks.
+ * Any task, not ISRs. False if they did not fit (the caller retries or
+ * drops them).
+ */
+bool STDIO_TxTryWrite(const void *data, size_t count);
+
+/** Start interrupt-driven reception; before the scheduler. Always true (static). */
+bool STDIO_RxStart(void);
+
+/**
+ * Console input, one line (or idle-terminated fragment) per wake-up.
+ * NULL before STDIO_RxStart(). Read by one task only.
+ */
+StreamBufferHandle_t STDIO_RxStream(void);
+
+/** Received bytes lost to line errors or a full stream buffer. */
+uint32_t STDIO_RxOverruns(void);
+
+#endif /* STDIO_UART_H */
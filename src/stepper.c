@@ -0,0 +1,464 @@
+/* =============================================================================
+ * stepper.c  -  Stepper lid drive: step pulses from TCC0 and the DMAC, no CPU
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "stepper.h"
+#include "actuator.h"           /* ACT_STEPPER_DRIVE */
+
+#if ACT_STEPPER_DRIVE
+
+#include "definitions.h"        /* PORT_REGS, TCC0_REGS, DMAC_REGS */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "neopixel.h"           /* NEO_BACKEND */
+#include "dma_qos.h"
+#include "dmaram.h"
+#include "showclock.h"
+#include "tickless.h"
+#include "cli.h"
+
+#if NEO_BACKEND != NEO_BACKEND_SPI
+#error "ACT_STEPPER_DRIVE needs TCC0, which the CCL / TCC NeoPixel backends use"
+#endif
+#if STEPPER_DMA_CHANNEL < DMA_OTHER_FIRST || STEPPER_DMA_CHANNEL >= DMA_OTHER_FIRST + DMA_OTHER_COUNT
+#error "STEPPER_DMA_CHANNEL must be a DMA_OTHER channel with a descriptor slot (dma_qos.h)"
+#endif
+
+#define ST_HZ               15000000u               /* TCC0 counts: GCLK0 120 MHz / 8 */
+#define ST_PER_MAX          0x1000000u              /* 24-bit counter */
+#define ST_PULSE            (STEPPER_PULSE_US * (ST_HZ / 1000000u))
+#define ST_PIN              10u                     /* PA10, TCC0 / WO2 (function F) */
+#define ST_HZ_MAX           50000u                  /* "step_hz" ceiling */
+
+_Static_assert(ST_HZ / STEPPER_START_HZ < ST_PER_MAX, "STEPPER_START_HZ: a period over 24 bits");
+_Static_assert(ST_HZ / ST_HZ_MAX > 8u * ST_PULSE, "STEPPER_PULSE_US: too long for the top rate");
+_Static_assert(STEPPER_RAMP_MAX >= 1u && 2u * STEPPER_RAMP_MAX + 1u <= 0xFFFFu, "STEPPER_RAMP_MAX: BTCNT is 16 bits");
+_Static_assert(STEPPER_MOVE_MAX >= 2u && STEPPER_MOVE_MAX <= 0xFFFFu, "STEPPER_MOVE_MAX: BTCNT is 16 bits");
+_Static_assert(STEPPER_MAX_HZ > STEPPER_START_HZ && STEPPER_MAX_HZ <= ST_HZ_MAX, "STEPPER_MAX_HZ out of range");
+
+/* A move: a intervals up the ramp, c at the cruise period, d down it */
+typedef struct
+{
+    uint32_t n;                 /* steps */
+    uint32_t a;
+    uint32_t c;
+    uint32_t d;
+} st_plan_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* PER words: the ramp up, mirrored down, and its first step again after the
+   last (the period after a move's last pulse, written to PERBUF as well) */
+static uint32_t st_ramp[2u * STEPPER_RAMP_MAX + 1u] DMA_RAM;
+static uint32_t st_cruise DMA_RAM;                  /* PER word of the cruise period */
+static const uint32_t st_zero = 0u;                 /* CCBUF[2]: no more pulses */
+static dmac_descriptor_registers_t st_desc[3] DMA_RAM __ALIGNED(8);
+
+static uint32_t st_cum[STEPPER_RAMP_MAX + 1u];      /* counts to the end of ramp step k */
+static uint32_t st_r;                               /* ramp steps in the table */
+static uint32_t st_cp;                              /* cruise period, counts */
+
+static uint16_t st_max_hz = STEPPER_MAX_HZ;
+static uint16_t st_acc_h  = STEPPER_ACCEL / 100u;
+static volatile bool st_dirty;                      /* a parameter changed: rebuild at the next move */
+
+static st_plan_t         st_move;
+static uint32_t          st_t0;                     /* show time of its first pulse */
+static volatile uint32_t st_done;                   /* steps it made, once over */
+static volatile bool     st_busy;
+static bool              st_ready;
+static stepper_stats_t   st_stats;
+
+static void st_changed(void)
+{
+    st_dirty = true;
+}
+
+static const cli_param_t st_params[] =
+{
+    { "step_hz",  &st_max_hz, CLI_U16, STEPPER_START_HZ + 1u, ST_HZ_MAX, st_changed, "stepper cruise rate, steps/s" },
+    { "step_acc", &st_acc_h,  CLI_U16, 10u, 0xFFFFu, st_changed, "stepper acceleration, 100 steps/s^2" },
+};
+
+/* -- Ramp -------------------------------------------------------------------- */
+
+/* floor(sqrt(x)), bit by bit */
+static uint32_t st_isqrt(uint64_t x)
+{
+    uint64_t res = 0u;
+    uint64_t bit = 1ull << 62;
+
+    while (bit > x)
+        bit >>= 2;
+
+    while (bit != 0u)
+    {
+        if (x >= res + bit)
+        {
+            x  -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+/*
+ * The table for the present step_hz / step_acc. Step k ends at t(k + 1)
+ * counts from the start, t(s) = ST_HZ * (v(s) - v0) / a with v(s) =
+ * sqrt(v0^2 + 2 a s) in Q8; each period is the difference of two rounded
+ * times, so the rounding never adds up along the ramp.
+ */
+static void st_build(void)
+{
+    const uint64_t v0 = STEPPER_START_HZ;
+    const uint64_t vm = st_max_hz;
+    const uint64_t a  = (uint64_t)st_acc_h * 100u;
+    uint32_t r = (uint32_t)((vm * vm - v0 * v0 + 2u * a - 1u) / (2u * a));
+    uint32_t t = 0u;
+
+    if (r < 1u) r = 1u;
+    if (r > STEPPER_RAMP_MAX) r = STEPPER_RAMP_MAX;
+
+    st_cum[0] = 0u;
+    for (uint32_t k = 0; k < r; k++)
+    {
+        uint32_t v  = st_isqrt((v0 * v0 + 2u * a * (k + 1u)) << 16);
+        uint32_t tk = (uint32_t)(((uint64_t)ST_HZ * (v - (uint32_t)(v0 << 8)) + a * 128u) / (a * 256u));
+
+        st_ramp[k]    = tk - t - 1u;
+        st_cum[k + 1] = tk;
+        t = tk;
+    }
+    for (uint32_t k = 0; k < r; k++)
+        st_ramp[r + k] = st_ramp[r - 1u - k];
+    st_ramp[2u * r] = st_ramp[0];
+
+    /* Cruise where the ramp ends: STEPPER_MAX_HZ, or less if the table ran out */
+    uint32_t vr = st_isqrt(v0 * v0 + 2u * a * r);
+
+    if (vr > vm) vr = (uint32_t)vm;
+    st_cp     = (ST_HZ + vr / 2u) / vr;
+    st_cruise = st_cp - 1u;
+    st_r      = r;
+    st_stats.ramp_steps = (uint16_t)r;
+    st_stats.cruise_hz  = (uint16_t)((ST_HZ + st_cp / 2u) / st_cp);
+}
+
+/* n steps are n - 1 periods: up the ramp, cruise, down; a short move turns at its middle */
+static void st_plan(uint32_t n, st_plan_t *p)
+{
+    uint32_t i = n - 1u;
+
+    p->n = n;
+    if (i >= 2u * st_r)
+    {
+        p->a = st_r;
+        p->d = st_r;
+        p->c = i - 2u * st_r;
+    }
+    else
+    {
+        p->a = i / 2u;
+        p->d = i - p->a;
+        p->c = 0u;
+    }
+}
+
+static uint64_t st_plan_counts(const st_plan_t *p)
+{
+    return (uint64_t)st_cum[p->a] + (uint64_t)p->c * st_cp + st_cum[p->d];
+}
+
+/* The last ramp step k (0 .. st_r) that has ended by `t` counts */
+static uint32_t st_ramp_at(uint32_t t)
+{
+    uint32_t lo = 0u, hi = st_r;
+
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi + 1u) / 2u;
+
+        if (st_cum[mid] <= t) lo = mid;
+        else                  hi = mid - 1u;
+    }
+    return lo;
+}
+
+/* Steps of the running move made `t` counts after its first pulse */
+static uint32_t st_steps_at(const st_plan_t *p, uint64_t t)
+{
+    uint64_t span;
+
+    if (t < st_cum[p->a]) return 1u + st_ramp_at((uint32_t)t);
+    t -= st_cum[p->a];
+    span = (uint64_t)p->c * st_cp;
+    if (t < span) return 1u + p->a + (uint32_t)(t / st_cp);
+    t -= span;
+    if (t < st_cum[p->d])
+    {
+        uint32_t left = st_cum[p->d] - (uint32_t)t;         /* of the periods down */
+
+        return 1u + p->a + p->c + p->d - (st_ramp_at(left - 1u) + 1u);
+    }
+    return p->n;
+}
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+/* PA10 as a plain output, low: between moves STEP is never left high */
+static void st_pin_gpio(void)
+{
+    PORT_REGS->GROUP[0].PORT_OUTCLR = 1u << ST_PIN;
+    PORT_REGS->GROUP[0].PORT_PINCFG[ST_PIN] &= (uint8_t)~PORT_PINCFG_PMUXEN_Msk;
+}
+
+static void st_timer_off(void)
+{
+    TCC0_REGS->TCC_CTRLA &= ~TCC_CTRLA_ENABLE_Msk;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    st_pin_gpio();
+}
+
+static void st_channel_off(void)
+{
+    DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+    while ((DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u) {}
+    DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHINTENCLR = DMAC_CHINTENCLR_Msk;
+    DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHINTFLAG  = DMAC_CHINTFLAG_Msk;
+}
+
+static void st_fill(dmac_descriptor_registers_t *d, const uint32_t *src, uint32_t n, bool inc,
+                    volatile void *dst, uint32_t act)
+{
+    d->DMAC_BTCTRL   = DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_BEATSIZE_WORD | act
+                     | (inc ? DMAC_BTCTRL_SRCINC_Msk : 0u);
+    d->DMAC_BTCNT    = (uint16_t)n;
+    d->DMAC_SRCADDR  = (uint32_t)(inc ? &src[n] : src);    /* end address with SRCINC */
+    d->DMAC_DSTADDR  = (uint32_t)dst;
+    d->DMAC_DESCADDR = 0u;
+}
+
+/*
+ * The move's PER words are the ramp up, the cruise word c times and the
+ * ramp down with the extra word after it: n in all. The first two go to
+ * PER and PERBUF now, the rest to PERBUF one per overflow, then two beats
+ * of 0 to CCBUF[2]: the last pulse is out at the first, no pulse follows
+ * the second, whose block interrupt stops TCC0.
+ */
+static void st_chain(const st_plan_t *p, uint32_t *per0, uint32_t *per1)
+{
+    struct { const uint32_t *src; uint32_t n; bool inc; } seg[3] =
+    {
+        { &st_ramp[0],                 p->a,       true  },
+        { &st_cruise,                  p->c,       false },
+        { &st_ramp[2u * st_r - p->d],  p->d + 1u,  true  },
+    };
+    dmac_descriptor_registers_t *d = (dmac_descriptor_registers_t *)DMAC_REGS->DMAC_BASEADDR
+                                   + STEPPER_DMA_CHANNEL;
+    uint32_t *const first[2] = { per0, per1 };
+    uint32_t s = 0u, used = 0u;
+
+    for (uint32_t k = 0; k < 2u; k++)
+    {
+        while (seg[s].n == 0u) s++;
+        *first[k] = *seg[s].src;
+        seg[s].n--;
+        if (seg[s].inc) seg[s].src++;
+    }
+    for (; s < 3u; s++)
+    {
+        if (seg[s].n == 0u) continue;
+        st_fill(d, seg[s].src, seg[s].n, seg[s].inc, &TCC0_REGS->TCC_PERBUF, DMAC_BTCTRL_BLOCKACT_NOACT);
+        d->DMAC_DESCADDR = (uint32_t)&st_desc[used];
+        d = &st_desc[used++];
+    }
+    st_fill(d, &st_zero, 2u, false, &TCC0_REGS->TCC_CCBUF[2], DMAC_BTCTRL_BLOCKACT_INT);
+}
+
+/* The move's last pulse is out. DMAC_OTHER ISR */
+static void st_dma_isr(uint8_t flags)
+{
+    if ((flags & DMAC_CHINTFLAG_TCMPL_Msk) == 0u || !st_busy) return;
+
+    st_timer_off();
+    st_done  = st_move.n;
+    st_busy  = false;
+    st_stats.steps += st_move.n;
+}
+
+static bool st_tickless_veto(void)
+{
+    return st_busy;
+}
+
+#endif /* ACT_STEPPER_DRIVE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Stepper_Init(void)
+{
+#if ACT_STEPPER_DRIVE
+    PORT_REGS->GROUP[0].PORT_DIRSET = 1u << ST_PIN;
+    st_pin_gpio();
+    PORT_REGS->GROUP[0].PORT_PMUX[ST_PIN >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[ST_PIN >> 1] & ~PORT_PMUX_PMUXE_Msk) | PORT_PMUX_PMUXE(5u));
+
+    /* TCC0 on GCLK channel 25 (GCLK0, 120 MHz), as MCC leaves it; replace its setup */
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_TCC0_Msk;
+    TCC0_REGS->TCC_CTRLA = TCC_CTRLA_SWRST_Msk;
+    while ((TCC0_REGS->TCC_SYNCBUSY & TCC_SYNCBUSY_SWRST_Msk) != 0u) {}
+    TCC0_REGS->TCC_CTRLA = TCC_CTRLA_PRESCALER_DIV8 | TCC_CTRLA_PRESCSYNC_PRESC;
+    TCC0_REGS->TCC_WAVE  = TCC_WAVE_WAVEGEN_NPWM;
+    while (TCC0_REGS->TCC_SYNCBUSY != 0u) {}
+
+    /* One word to PERBUF (CCBUF[2] at the end) per TCC0 overflow */
+    DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHCTRLA =
+        DMAC_CHCTRLA_TRIGSRC(TCC0_DMAC_ID_OVF) | DMAC_CHCTRLA_TRIGACT_BURST;
+    Dma_Assign((DMAC_CHANNEL)STEPPER_DMA_CHANNEL, DMA_CLASS_STREAM);
+    (void)Dma_OtherRegister(STEPPER_DMA_CHANNEL, st_dma_isr);
+    (void)Tickless_RegisterVeto(st_tickless_veto);
+
+    for (uint32_t i = 0; i < sizeof(st_params) / sizeof(st_params[0]); i++)
+        (void)Cli_Register(&st_params[i]);
+    st_build();
+    st_ready = true;
+#endif
+}
+
+bool Stepper_Move(uint32_t steps)
+{
+#if ACT_STEPPER_DRIVE
+    uint32_t per0, per1;
+
+    if (!st_ready || steps < 2u) return false;
+    (void)Stepper_Halt();
+    if (steps > STEPPER_MOVE_MAX) steps = STEPPER_MOVE_MAX;
+    if (st_dirty)
+    {
+        st_dirty = false;
+        st_build();
+    }
+
+    st_plan(steps, &st_move);
+    st_chain(&st_move, &per0, &per1);
+
+    TCC0_REGS->TCC_COUNT  = 0u;
+    TCC0_REGS->TCC_PER    = per0;
+    TCC0_REGS->TCC_PERBUF = per1;                       /* loaded at the first overflow */
+    TCC0_REGS->TCC_CC[2]    = ST_PULSE;
+    TCC0_REGS->TCC_CCBUF[2] = ST_PULSE;
+    while (TCC0_REGS->TCC_SYNCBUSY != 0u) {}
+
+    taskENTER_CRITICAL();
+    st_done = 0u;
+    st_busy = true;
+    st_stats.moves++;
+    DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHINTENSET = DMAC_CHINTENSET_TCMPL_Msk;
+    DMAC_REGS->CHANNEL[STEPPER_DMA_CHANNEL].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    PORT_REGS->GROUP[0].PORT_PINCFG[ST_PIN] |= PORT_PINCFG_PMUXEN_Msk;
+    st_t0 = ShowClock_Now();
+    TCC0_REGS->TCC_CTRLA |= TCC_CTRLA_ENABLE_Msk;
+    taskEXIT_CRITICAL();
+    return true;
+#else
+    (void)steps;
+    return false;
+#endif
+}
+
+uint32_t Stepper_Halt(void)
+{
+#if ACT_STEPPER_DRIVE
+    UBaseType_t mask;
+    uint32_t    done;
+
+    if (!st_ready) return 0u;
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    if (st_busy)
+    {
+        st_timer_off();
+        st_channel_off();
+        done = Stepper_Done();
+        st_done = done;
+        st_busy = false;
+        st_stats.halted++;
+        st_stats.steps += done;
+    }
+    done = st_done;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return done;
+#else
+    return 0u;
+#endif
+}
+
+bool Stepper_Busy(void)
+{
+#if ACT_STEPPER_DRIVE
+    return st_busy;
+#else
+    return false;
+#endif
+}
+
+uint32_t Stepper_Done(void)
+{
+#if ACT_STEPPER_DRIVE
+    if (!st_busy) return st_done;
+    return st_steps_at(&st_move, (uint64_t)(ShowClock_Now() - st_t0) * (ST_HZ / 1000000u));
+#else
+    return 0u;
+#endif
+}
+
+uint32_t Stepper_MoveMs(uint32_t steps)
+{
+#if ACT_STEPPER_DRIVE
+    st_plan_t p;
+
+    if (steps < 2u) return 0u;
+    if (steps > STEPPER_MOVE_MAX) steps = STEPPER_MOVE_MAX;
+    st_plan(steps, &p);
+    return (uint32_t)((st_plan_counts(&p) + ST_HZ / 1000u - 1u) / (ST_HZ / 1000u));
+#else
+    (void)steps;
+    return 0u;
+#endif
+}
+
+uint32_t Stepper_StepsIn(uint32_t ms)
+{
+#if ACT_STEPPER_DRIVE
+    uint32_t lo = 2u, hi = STEPPER_MOVE_MAX;
+
+    if (Stepper_MoveMs(2u) > ms) return 0u;
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi + 1u) / 2u;
+
+        if (Stepper_MoveMs(mid) <= ms) lo = mid;
+        else                           hi = mid - 1u;
+    }
+    return lo;
+#else
+    (void)ms;
+    return 0u;
+#endif
+}
+
+void Stepper_GetStats(stepper_stats_t *out)
+{
+#if ACT_STEPPER_DRIVE
+    taskENTER_CRITICAL();
+    *out = st_stats;
+    taskEXIT_CRITICAL();
+#else
+    *out = (stepper_stats_t){ 0 };
+#endif
+}
@@ -0,0 +1,104 @@
+/* =============================================================================
+ * stepper.h  -  Stepper lid drive: step pulses from TCC0 and the DMAC, no CPU
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * With ACT_STEPPER_DRIVE (actuator.h) the lid is a stepper motor on a
+ * STEP / DIR / ENABLE driver instead of the relay actuator. The lid's two
+ * outputs keep their job of saying which way and whether: PA20 (UP) is
+ * DIR, high for up, and PA21 (DOWN) is ENABLE, high to energise, so a
+ * reset, Actuator_Safe() and the e-stop fault (estop.h) all leave the
+ * motor unpowered; a driver with an active-low ~EN takes it through the
+ * inverter the relay stage already has. STEP comes from here:
+ *
+ *   Pulses  TCC0 in single-slope PWM at 15 MHz (GCLK0 / 8) on PA10 (WO2):
+ *           every period starts with a STEPPER_PULSE_US pulse (CC2), so
+ *           one period is one step and PER is the time to the next.
+ *   Ramp    each overflow triggers one DMAC beat (STEPPER_DMA_CHANNEL)
+ *           that writes the period after next to PERBUF, which TCC0 takes
+ *           over at the following overflow, exactly as ioseq.h times its
+ *           steps. A move is a chain of at most four descriptors:
+ *             accelerate  the ramp table, in order
+ *             cruise      one period, STEPPER_MAX_HZ, over and over
+ *             decelerate  the ramp table mirrored
+ *             end         0 to CCBUF[2]: no pulse from the next period on
+ *           and the end's block interrupt, the only one of the move,
+ *           stops TCC0. A short move turns at the middle of the ramp.
+ *
+ * The ramp is constant acceleration, STEPPER_ACCEL steps/s^2 from
+ * STEPPER_START_HZ: step k of it lasts t(k + 1) - t(k), with t(s) =
+ * (sqrt(v0^2 + 2 a s) - v0) / a, up to STEPPER_MAX_HZ or
+ * STEPPER_RAMP_MAX steps. It is computed once (and again after a "step_hz"
+ * or "step_acc" change, at the next move), into a table in counts with its
+ * running sum, so the length of any move and how far one has got are a
+ * look-up, not a simulation.
+ *
+ * The sequence engine in actuator.c drives it as it drives the relays:
+ * an UP or DOWN step of `hold` ms becomes the longest move that fits in
+ * `hold` (Stepper_StepsIn()), cut to the stop when the position is known;
+ * a GOTO step converts its distance to steps and holds for the move's
+ * length; OFF releases ENABLE. Nothing runs per step on the CPU, at any
+ * rate the driver takes. TCC0 runs on GCLK0, so tickless idle is vetoed
+ * while a move runs.
+ *
+ * TCC0 is free only with the SPI NeoPixel backend and without
+ * ACT_PWM_DRIVE, which uses PA10 and TCC0 for the MOSFET stage, and PA10
+ * is SDHC0 DAT1 (sdcard.h).
+ * ============================================================================= */
+
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define STEPPER_TRAVEL_STEPS    6400u       /* the lid's full travel, microsteps included */
+#define STEPPER_START_HZ        400u        /* first step of a move, and the last         */
+#define STEPPER_MAX_HZ          20000u      /* cruise; "step_hz"                          */
+#define STEPPER_ACCEL           400000u     /* steps/s^2; "step_acc" in hundreds          */
+#define STEPPER_RAMP_MAX        512u        /* ramp table, steps                          */
+#define STEPPER_PULSE_US        2u          /* STEP high; DRV8825 / TMC2209 need >= 1.9   */
+#define STEPPER_MOVE_MAX        60000u      /* steps in one move                          */
+#define STEPPER_DMA_CHANNEL     19u         /* DMA_OTHER channel, dma_qos.h               */
+
+typedef struct
+{
+    uint32_t moves;
+    uint32_t halted;            /* cut short by Stepper_Halt()              */
+    uint32_t steps;             /* stepped, all moves                       */
+    uint16_t ramp_steps;        /* of the table in use                      */
+    uint16_t cruise_hz;         /* it reaches                               */
+} stepper_stats_t;
+
+/**
+ * PA10 to TCC0 / WO2, TCC0 and the DMA channel idle, the ramp built;
+ * registers "step_hz" and "step_acc". From Actuator_Start(), before the
+ * scheduler. DIR and ENABLE are the actuator's pins.
+ */
+void Stepper_Init(void);
+
+/**
+ * Step `steps` (2 .. STEPPER_MOVE_MAX) from now, DIR already set; a move
+ * still running is halted first. False for fewer than 2 steps. Timer task.
+ */
+bool Stepper_Move(uint32_t steps);
+
+/** Stop at once, no decelerating; steps the move made. Any context, interrupts included. */
+uint32_t Stepper_Halt(void);
+
+/** A move is running. Any context. */
+bool Stepper_Busy(void);
+
+/** Steps the running move has made by now, or the last one made. Any context. */
+uint32_t Stepper_Done(void);
+
+/** Length of a move of `steps`, ms rounded up. Any context. */
+uint32_t Stepper_MoveMs(uint32_t steps);
+
+/** The longest move that fits in `ms`, at most STEPPER_MOVE_MAX; 0 below 2 steps. Any context. */
+uint32_t Stepper_StepsIn(uint32_t ms);
+
+/** Counters since boot. Any task. */
+void Stepper_GetStats(stepper_stats_t *out);
+
+#endif /* STEPPER_H */
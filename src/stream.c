@@ -0,0 +1,448 @@
+/* =============================================================================
+ * stream.c  -  Read-ahead streaming of SD card files to the show pipelines
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "stream.h"
+#include "sdcard.h"
+#include "fat.h"
+#include "lz.h"
+#include "definitions.h"        /* __DMB, DWT */
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+#if (STREAM_SEG_BYTES % SDCARD_BLOCK) != 0u
+#error "STREAM_SEG_BYTES must be a multiple of the card block"
+#endif
+#if (STREAM_LZ_RAW % SDCARD_BLOCK) != 0u
+#error "STREAM_LZ_RAW must be a multiple of the card block"
+#endif
+
+typedef enum
+{
+    STREAM_FREE = 0,
+    STREAM_OPENING,                     /* claimed, the task opens the file */
+    STREAM_RUN,
+    STREAM_FAILED,                      /* missing file or card error       */
+    STREAM_CLOSING                      /* the task frees it                */
+} stream_state_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t stream_underruns;
+
+/* Decoder costs: written by the Stream task, read under a critical section */
+static uint32_t stream_lz_blocks;
+static uint64_t stream_lz_in;
+static uint64_t stream_lz_out;
+static uint64_t stream_lz_cycles;
+static uint32_t stream_lz_max;
+static uint32_t stream_lz_errors;
+
+#if SDCARD_ENABLE
+
+typedef struct
+{
+    volatile uint8_t  state;            /* stream_state_t                         */
+    bool              loop;
+    volatile bool     eof;              /* task read the last byte (no loop)      */
+    char              path[STREAM_PATH_LEN];
+    fat_file_t        file;             /* Stream task only                       */
+
+    /* Ring: the task fills seg[head % N], the consumer drains seg[tail % N] */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t          off;              /* consumer, into seg[tail % N]           */
+    volatile uint16_t len[STREAM_SEGMENTS];
+    uint8_t           seg[STREAM_SEGMENTS][STREAM_SEG_BYTES] __attribute__((aligned(4)));
+
+#if STREAM_LZ_ENABLE
+    /* Packed file: the task decodes raw[] a block per segment */
+    bool              lz;
+    uint32_t          raw_pos;
+    uint32_t          raw_len;
+    uint32_t          pass;             /* head at the start of this pass     */
+    uint32_t          cycles;           /* decoding the block so far          */
+    lz_dec_t          dec;
+    uint8_t           raw[STREAM_LZ_RAW] __attribute__((aligned(4)));
+#endif
+} stream_slot_t;
+
+#define STREAM_STACK        (configMINIMAL_STACK_SIZE * 2u)
+
+static StackType_t   stream_stack[STREAM_STACK];
+static StaticTask_t  stream_tcb;
+static TaskHandle_t  stream_task_handle;
+
+static stream_slot_t stream_slot[STREAM_COUNT];
+
+/* -- Reader task ------------------------------------------------------------- */
+
+/* Stop a running stream; a card error makes the card be identified again */
+static void stream_fail(stream_slot_t *s, bool card)
+{
+    taskENTER_CRITICAL();
+    if (s->state == STREAM_RUN) s->state = STREAM_FAILED;
+    taskEXIT_CRITICAL();
+    if (card) Fat_Unmount();
+}
+
+#if STREAM_LZ_ENABLE
+/* A packed file keeps its first read for the decoder; a plain one starts over */
+static uint8_t stream_probe(stream_slot_t *s)
+{
+    int32_t n = Fat_Read(&s->file, s->raw, STREAM_LZ_RAW);
+
+    if (n < 0)
+    {
+        Fat_Unmount();
+        return STREAM_FAILED;
+    }
+    s->raw_pos = 0u;
+    s->raw_len = (uint32_t)n;
+    s->pass    = 0u;
+    s->cycles  = 0u;
+    s->lz      = n >= (int32_t)LZ_FILE_HEADER && Lz_IsPacked(s->raw);
+    if (s->lz) Lz_Init(&s->dec, STREAM_SEG_BYTES);
+    else       Fat_Rewind(&s->file);
+    return STREAM_RUN;
+}
+
+/* A block decoded into segment `k`: count it and hand it to the consumer */
+static void stream_lz_block(stream_slot_t *s, uint32_t k)
+{
+    taskENTER_CRITICAL();
+    stream_lz_blocks++;
+    stream_lz_in     += Lz_BlockPacked(&s->dec);
+    stream_lz_out    += Lz_BlockBytes(&s->dec);
+    stream_lz_cycles += s->cycles;
+    if (s->cycles > stream_lz_max) stream_lz_max = s->cycles;
+    taskEXIT_CRITICAL();
+    s->cycles = 0u;
+
+    s->len[k] = (uint16_t)Lz_BlockBytes(&s->dec);
+    __DMB();                                    /* data before the count */
+    s->head++;
+}
+
+/* Decode into the next segment, reading the card as the decoder asks */
+static void stream_fill_lz(stream_slot_t *s)
+{
+    uint32_t    k = s->head % STREAM_SEGMENTS;
+    uint32_t    used, t0;
+    lz_result_t r;
+
+    for (;;)
+    {
+        if (s->raw_pos == s->raw_len)
+        {
+            int32_t n = Fat_Read(&s->file, s->raw, STREAM_LZ_RAW);
+
+            if (n < 0)
+            {
+                stream_fail(s, true);
+                return;
+            }
+            if (n == 0)                         /* cut short: what there was plays */
+            {
+                s->eof = true;
+                return;
+            }
+            s->raw_pos = 0u;
+            s->raw_len = (uint32_t)n;
+        }
+
+        t0 = DWT->CYCCNT;
+        r  = Lz_Decode(&s->dec, &s->raw[s->raw_pos], s->raw_len - s->raw_pos, &used, s->seg[k]);
+        s->cycles  += DWT->CYCCNT - t0;
+        s->raw_pos += used;
+
+        switch (r)
+        {
+            case LZ_BLOCK:
+                stream_lz_block(s, k);
+                return;
+
+            case LZ_END:
+                if (s->loop && s->head != s->pass)      /* not for a file of no blocks */
+                {
+                    Fat_Rewind(&s->file);
+                    Lz_Init(&s->dec, STREAM_SEG_BYTES);
+                    s->raw_pos = 0u;
+                    s->raw_len = 0u;
+                    s->pass    = s->head;
+                }
+                else
+                {
+                    s->eof = true;
+                }
+                return;
+
+            case LZ_ERROR:
+                stream_lz_errors++;
+                stream_fail(s, false);
+                return;
+
+            default:                                    /* LZ_MORE: the next read */
+                break;
+        }
+    }
+}
+#endif /* STREAM_LZ_ENABLE */
+
+/* Carry out open and close requests */
+static void stream_service(void)
+{
+    for (uint32_t i = 0; i < STREAM_COUNT; i++)
+    {
+        stream_slot_t *s = &stream_slot[i];
+
+        if (s->state == STREAM_CLOSING)
+        {
+            s->state = STREAM_FREE;
+        }
+        else if (s->state == STREAM_OPENING)
+        {
+            s->head = 0u;
+            s->tail = 0u;
+            s->off  = 0u;
+            s->eof  = false;
+
+            uint8_t next = Fat_Open(s->path, &s->file) ? STREAM_RUN : STREAM_FAILED;
+
+#if STREAM_LZ_ENABLE
+            if (next == STREAM_RUN) next = stream_probe(s);
+#endif
+            taskENTER_CRITICAL();
+            if (s->state == STREAM_OPENING) s->state = next;       /* not closed meanwhile */
+            taskEXIT_CRITICAL();
+        }
+    }
+}
+
+/* The running stream with the least buffered, NULL if every ring is full */
+static stream_slot_t *stream_neediest(void)
+{
+    stream_slot_t *best = NULL;
+
+    for (uint32_t i = 0; i < STREAM_COUNT; i++)
+    {
+        stream_slot_t *s = &stream_slot[i];
+
+        if (s->state != STREAM_RUN || s->eof || s->head - s->tail >= STREAM_SEGMENTS) continue;
+        if (best == NULL || s->head - s->tail < best->head - best->tail) best = s;
+    }
+    return best;
+}
+
+static void stream_fill(stream_slot_t *s)
+{
+#if STREAM_LZ_ENABLE
+    if (s->lz)
+    {
+        stream_fill_lz(s);
+        return;
+    }
+#endif
+
+    uint32_t k = s->head % STREAM_SEGMENTS;
+    int32_t  n = Fat_Read(&s->file, s->seg[k], STREAM_SEG_BYTES);
+
+    if (n < 0)
+    {
+        stream_fail(s, true);
+        return;
+    }
+    if (n > 0)
+    {
+        s->len[k] = (uint16_t)n;
+        __DMB();                                /* data before the count */
+        s->head++;
+    }
+    if (n < (int32_t)STREAM_SEG_BYTES)          /* the end of the file */
+    {
+        if (s->loop && s->file.size != 0u) Fat_Rewind(&s->file);
+        else                               s->eof = true;
+    }
+}
+
+static void stream_task(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        if (!Fat_Mounted())
+        {
+            if (!SdCard_Identify() || !Fat_Mount())
+            {
+                stream_service();               /* opens fail until a card is in */
+                vTaskDelay(pdMS_TO_TICKS(STREAM_RETRY_MS));
+                continue;
+            }
+        }
+
+        stream_service();
+
+        stream_slot_t *s = stream_neediest();
+
+        if (s != NULL) stream_fill(s);
+        else           (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+static stream_slot_t *stream_get(int32_t h)
+{
+    if (h < 0 || h >= (int32_t)STREAM_COUNT) return NULL;
+    return &stream_slot[h];
+}
+
+#endif /* SDCARD_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Stream_Start(void)
+{
+#if SDCARD_ENABLE
+    stream_task_handle = xTaskCreateStatic(stream_task, "Stream", STREAM_STACK, NULL, STREAM_TASK_PRIO,
+                                           stream_stack, &stream_tcb);
+#endif
+}
+
+int32_t Stream_Open(const char *path, bool loop)
+{
+#if SDCARD_ENABLE
+    int32_t h = -1;
+
+    if (strlen(path) >= STREAM_PATH_LEN) return -1;
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < STREAM_COUNT && h < 0; i++)
+    {
+        if (stream_slot[i].state == STREAM_FREE)
+        {
+            stream_slot[i].state = STREAM_OPENING;
+            h = (int32_t)i;
+        }
+    }
+    taskEXIT_CRITICAL();
+    if (h < 0) return -1;
+
+    strcpy(stream_slot[h].path, path);
+    stream_slot[h].loop = loop;
+    (void)xTaskNotifyGive(stream_task_handle);
+    return h;
+#else
+    (void)path;
+    (void)loop;
+    return -1;
+#endif
+}
+
+void Stream_Close(int32_t h)
+{
+#if SDCARD_ENABLE
+    stream_slot_t *s = stream_get(h);
+
+    if (s == NULL || s->state == STREAM_FREE) return;
+    s->state = STREAM_CLOSING;
+    (void)xTaskNotifyGive(stream_task_handle);
+#else
+    (void)h;
+#endif
+}
+
+uint32_t Stream_Read(int32_t h, void *dst, uint32_t len)
+{
+#if SDCARD_ENABLE
+    stream_slot_t *s = stream_get(h);
+    uint8_t       *d = dst;
+    uint32_t       got = 0u;
+    bool           freed = false;
+
+    if (s == NULL || s->state != STREAM_RUN) return 0u;
+
+    while (got < len && s->tail != s->head)
+    {
+        uint32_t k = s->tail % STREAM_SEGMENTS;
+        uint32_t n = s->len[k] - s->off;
+
+        if (n > len - got) n = len - got;
+        memcpy(d + got, &s->seg[k][s->off], n);
+        got    += n;
+        s->off += n;
+        if (s->off == s->len[k])
+        {
+            s->off = 0u;
+            __DMB();                            /* copied out before the task reuses it */
+            s->tail++;
+            freed = true;
+        }
+    }
+    if (freed) (void)xTaskNotifyGive(stream_task_handle);
+    if (got < len && !s->eof) stream_underruns++;
+    return got;
+#else
+    (void)h;
+    (void)dst;
+    (void)len;
+    return 0u;
+#endif
+}
+
+uint32_t Stream_Available(int32_t h)
+{
+#if SDCARD_ENABLE
+    stream_slot_t *s = stream_get(h);
+    uint32_t       n = 0u;
+
+    if (s == NULL || s->state != STREAM_RUN) return 0u;
+    for (uint32_t t = s->tail; t != s->head; t++) n += s->len[t % STREAM_SEGMENTS];
+    return n - s->off;
+#else
+    (void)h;
+    return 0u;
+#endif
+}
+
+bool Stream_Ready(int32_t h)
+{
+#if SDCARD_ENABLE
+    stream_slot_t *s = stream_get(h);
+
+    return s != NULL && s->state == STREAM_RUN && (s->eof || s->head - s->tail == STREAM_SEGMENTS);
+#else
+    (void)h;
+    return false;
+#endif
+}
+
+bool Stream_Ended(int32_t h)
+{
+#if SDCARD_ENABLE
+    stream_slot_t *s = stream_get(h);
+
+    if (s == NULL || s->state == STREAM_FREE || s->state == STREAM_FAILED) return true;
+    return s->state == STREAM_RUN && s->eof && s->tail == s->head;
+#else
+    (void)h;
+    return true;
+#endif
+}
+
+uint32_t Stream_Underruns(void)
+{
+    return stream_underruns;
+}
+
+void Stream_GetLzStats(stream_lz_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    out->blocks     = stream_lz_blocks;
+    out->in_kb      = (uint32_t)(stream_lz_in >> 10);
+    out->out_kb     = (uint32_t)(stream_lz_out >> 10);
+    out->cycles_avg = (stream_lz_blocks != 0u) ? (uint32_t)(stream_lz_cycles / stream_lz_blocks) : 0u;
+    out->cycles_max = stream_lz_max;
+    out->errors     = stream_lz_errors;
+    taskEXIT_CRITICAL();
+}
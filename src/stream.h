@@ -0,0 +1,102 @@
+/* =============================================================================
+ * stream.h  -  Read-ahead streaming of SD card files to the show pipelines
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A stream is a file on the card (fat.h) read ahead into a ring of
+ * STREAM_SEGMENTS segments by the "Stream" task, so a consumer that runs
+ * on a deadline (the sound mixer, an animation step) only ever copies from
+ * RAM and never waits on the card:
+ *
+ *   card -> Fat_Read() one segment -> ring -> Stream_Read() (never blocks)
+ *
+ * The task refills whichever open stream is emptiest first, a whole
+ * segment (one multi-block command) at a time, and sleeps when every ring
+ * is full; a consumer freeing a segment wakes it. A full ring covers
+ * STREAM_SEGMENTS * STREAM_SEG_BYTES of playback, ~1.1 s of 22 kHz sound
+ * at the defaults, so a card stalling for a few hundred milliseconds (they
+ * do, SdCard_LatencyMaxUs()) is never heard or seen. A read the ring could
+ * not satisfy before the end of the file is counted by Stream_Underruns().
+ *
+ * With `loop` the file restarts at its end without a gap, the first
+ * segment following the last in the ring.
+ *
+ * A file packed by tools/lzpack.py (lz.h, told apart by its header) is
+ * read STREAM_LZ_RAW bytes at a time and decoded by the task a block per
+ * segment, so the ring, and every consumer, sees the plain bytes and the
+ * card moves only the packed ones. A block is a segment, the decoder's
+ * whole window: no RAM goes on history or whole files. The cycles each
+ * block costs are kept (Stream_GetLzStats(), "sd"), and rtosbench.h times
+ * one against the kernel primitives.
+ *
+ * Open a stream ahead of when it is needed; Stream_Ready() says when the
+ * ring is full. Sound_CueStream() (sound.h) and Anim_StartStream()
+ * (anim.h) play one. The task also brings the card up, and again after a
+ * card error or swap. No-op unless SDCARD_ENABLE.
+ * ============================================================================= */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#define STREAM_COUNT            2u      /* open at once: a sound and an animation */
+#define STREAM_SEGMENTS         6u
+#define STREAM_SEG_BYTES        4096u   /* a multiple of 512; 24 KB per stream    */
+#define STREAM_PATH_LEN         32u
+#define STREAM_TASK_PRIO        2u      /* below the mixer and NeoPixel            */
+#define STREAM_RETRY_MS         1000u   /* no card: try again this often           */
+#ifndef STREAM_LZ_ENABLE
+#define STREAM_LZ_ENABLE        1       /* 1 = decode lzpack.py files as they stream */
+#endif
+#define STREAM_LZ_RAW           2048u   /* packed bytes per card read, per stream   */
+
+typedef struct
+{
+    uint32_t blocks;                    /* decoded since boot              */
+    uint32_t in_kb;                     /* packed, read from the card      */
+    uint32_t out_kb;                    /* plain, into the rings           */
+    uint32_t cycles_avg;                /* per block, every piece of input */
+    uint32_t cycles_max;
+    uint32_t errors;                    /* corrupt files stopped           */
+} stream_lz_stats_t;
+
+/**
+ * Create the task (static). After SdCard_Init(), before the scheduler.
+ * No-op unless SDCARD_ENABLE.
+ */
+void Stream_Start(void);
+
+/**
+ * Start reading `path` ahead. Any task, never blocks: the file is opened
+ * by the Stream task. Returns a handle, or -1 if all STREAM_COUNT are open.
+ * A file that is missing shows as Stream_Ended() straight away.
+ */
+int32_t Stream_Open(const char *path, bool loop);
+
+/** Free the handle; the ring is dropped. Any task. */
+void Stream_Close(int32_t s);
+
+/**
+ * Copy up to `len` buffered bytes to `dst`, never blocking. Fewer than
+ * `len` before the end of the file is an underrun. One consumer per stream.
+ */
+uint32_t Stream_Read(int32_t s, void *dst, uint32_t len);
+
+/** Bytes Stream_Read() would return now. */
+uint32_t Stream_Available(int32_t s);
+
+/** Ring full (or the whole file in): safe to start playing. */
+bool Stream_Ready(int32_t s);
+
+/** Everything read, or the file missing or a card error. */
+bool Stream_Ended(int32_t s);
+
+/** Short reads before the end of a file since boot. */
+uint32_t Stream_Underruns(void);
+
+/** What decoding packed files has cost so far. Any task. */
+void Stream_GetLzStats(stream_lz_stats_t *out);
+
+#endif /* STREAM_H */
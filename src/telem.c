@@ -0,0 +1,441 @@
+/* =============================================================================
+ * telem.c  -  Binary telemetry stream for host dashboards
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "telem.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cobs.h"
+#include "cli.h"
+#include "metrics.h"
+#include "neopixel.h"
+#include "stats.h"
+#include "tlog.h"
+#include "idle.h"
+#include "tickless.h"
+#include "cpufreq.h"
+#include "dmamem.h"
+#include "evbus.h"
+#include "mode.h"
+#include "framestat.h"
+#include "fpsctl.h"
+#include "stackmon.h"
+#include "pool.h"
+#include "audio.h"
+#include "sound.h"
+#include "sdcard.h"
+#include "stream.h"
+#include "showsync.h"
+#include "dmx.h"
+#include "netbridge.h"
+#include "pixdist.h"
+#include "usbcdc.h"
+#include "settings.h"
+#include "stdio_uart.h"
+#include "memstat.h"
+#include "railmon.h"
+#include "power.h"
+#include "crc.h"
+#include <string.h>
+
+#define TELEM_PAYLOAD_MAX   768u        /* largest of the three frame kinds: the schema */
+#define TELEM_CAP_MAX       (11u + 3u * (uint32_t)PIXDIST_SCENE_LEDS)  /* an 'F' payload */
+#define TELEM_SNAP_NONE     0xFFu
+
+_Static_assert(!USBCDC_ENABLE || COBS_FRAME_MAX(TELEM_CAP_MAX) <= USBCDC_TX_BUF,
+               "USBCDC_TX_BUF must hold one capture frame of the whole scene");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    const char    *name;
+    telem_read_fn  read;
+} telem_chan_t;
+
+static telem_chan_t   telem_chan[TELEM_MAX_CHANNELS];
+static uint32_t       telem_count;
+static uint8_t        telem_hz = TELEM_HZ;
+static uint16_t       telem_seq;
+static volatile uint32_t telem_dropped;
+
+/* Per-sample snapshots the built-in readers pick from */
+static metrics_t      telem_m;
+static neo_tx_stats_t telem_tx;
+static stats_t        telem_st;
+
+static metrics_tasks_t telem_tasks;
+
+static uint8_t        telem_payload[TELEM_PAYLOAD_MAX];
+static uint8_t        telem_frame[COBS_FRAME_MAX(TELEM_PAYLOAD_MAX)];
+
+/*
+ * Frame capture: the render task copies the scene into the snapshot the
+ * Telem task is not encoding and hands it over; the Telem task frames and
+ * sends it. A snapshot not yet picked up is overwritten by a newer one.
+ */
+static volatile uint32_t telem_cap_left;
+static uint8_t        telem_cap_every = TELEM_CAP_EVERY;
+static uint8_t        telem_cap_skip;           /* frames since the last snapshot */
+static uint16_t       telem_cap_seq;
+static pix_t          telem_snap[2][PIXDIST_SCENE_LEDS];
+static uint16_t       telem_snap_n[2];
+static uint32_t       telem_snap_ms[2];
+static volatile uint8_t telem_snap_ready = TELEM_SNAP_NONE;    /* newest whole snapshot */
+static volatile uint8_t telem_snap_busy  = TELEM_SNAP_NONE;    /* being encoded         */
+static TaskHandle_t   telem_handle;
+
+static uint8_t        telem_cap_payload[TELEM_CAP_MAX];
+static uint8_t        telem_cap_frame[COBS_FRAME_MAX(TELEM_CAP_MAX)];
+
+#define TELEM_STACK         (configMINIMAL_STACK_SIZE * 2u)
+static StackType_t    telem_stack[TELEM_STACK];
+static StaticTask_t   telem_tcb;
+
+static const cli_param_t telem_hz_param =
+{
+    "telem_hz", &telem_hz, CLI_U8, 0u, TELEM_HZ_MAX, NULL, "telemetry samples per second, 0 = off"
+};
+
+static uint32_t telem_fps_q4(void)      { return telem_m.neo.fps_q4; }
+static uint32_t telem_render(void)      { return telem_m.neo.render_cycles; }
+static uint32_t telem_missed(void)      { return telem_m.neo.missed; }
+static uint32_t telem_icache(void)      { return telem_m.neo.cache_hits; }
+static uint32_t telem_duty(void)        { return telem_m.act.duty_pct; }
+static uint32_t telem_triggers(void)    { return telem_m.act.triggers; }
+static uint32_t telem_heap(void)        { return telem_m.heap_free; }
+static uint32_t telem_cpu_busy(void)    { return telem_m.cpu.busy_pm; }
+static uint32_t telem_cpu_peak(void)    { return telem_m.cpu.peak_pm; }
+static uint32_t telem_dma_err(void)     { return telem_tx.dma_errors; }
+static uint32_t telem_spi_err(void)     { return telem_tx.spi_errors; }
+static uint32_t telem_neo_tmo(void)     { return telem_tx.timeouts; }
+static uint32_t telem_neo_late(void)    { return telem_tx.late; }
+static uint32_t telem_neo_overdue(void) { return telem_tx.overdue; }
+static uint32_t telem_arrivals(void)    { return telem_st.arrivals; }
+static uint32_t telem_sd_lat(void)      { return SdCard_LatencyMaxUs() / 1000u; }
+static uint32_t telem_mode(void)        { return (uint32_t)Mode_Get(); }
+static uint32_t telem_dropped_slots(void) { return telem_m.neo.dropped; }
+
+static uint32_t telem_fstat(framestat_kind_t k, bool max)
+{
+    framestat_result_t r;
+
+    FrameStat_Get(k, &r);
+    return max ? r.max_us : r.p99_us;
+}
+
+static uint32_t telem_ival_p99(void)    { return telem_fstat(FRAMESTAT_INTERVAL, false); }
+static uint32_t telem_ival_max(void)    { return telem_fstat(FRAMESTAT_INTERVAL, true); }
+static uint32_t telem_rend_p99(void)    { return telem_fstat(FRAMESTAT_RENDER, false); }
+static uint32_t telem_jit_p99(void)     { return telem_fstat(FRAMESTAT_JITTER, false); }
+static uint32_t telem_jit_max(void)     { return telem_fstat(FRAMESTAT_JITTER, true); }
+
+static uint32_t telem_rail_5v(void)    { return RailMon_Read(RAILMON_5V); }
+static uint32_t telem_rail_act(void)   { return RailMon_Read(RAILMON_ACT); }
+
+static uint32_t telem_sync_err(void)
+{
+    showsync_status_t st;
+
+    ShowSync_GetStatus(&st);
+    return (st.err_us < 0) ? (uint32_t)-st.err_us : (uint32_t)st.err_us;
+}
+
+static uint32_t telem_sync_peers(void)
+{
+    showsync_status_t st;
+
+    ShowSync_GetStatus(&st);
+    return st.peers;
+}
+
+static const telem_chan_t telem_builtin[] =
+{
+    { "fps_q4",      telem_fps_q4   },
+    { "render_cyc",  telem_render   },
+    { "missed",      telem_missed   },
+    { "dropped",     telem_dropped_slots },
+    { "ival_p99_us", telem_ival_p99 },
+    { "ival_max_us", telem_ival_max },
+    { "rend_p99_us", telem_rend_p99 },
+    { "jit_p99_us",  telem_jit_p99  },
+    { "jit_max_us",  telem_jit_max  },
+    { "fps_rung",    FpsCtl_Rung    },
+    { "icache_hits", telem_icache   },
+    { "dma_err",     telem_dma_err  },
+    { "spi_err",     telem_spi_err  },
+    { "neo_timeout", telem_neo_tmo  },
+    { "neo_late",    telem_neo_late },
+    { "neo_overdue", telem_neo_overdue },
+    { "duty_pct",    telem_duty     },
+    { "triggers",    telem_triggers },
+    { "arrivals",    telem_arrivals },
+    { "tx_drop",     STDIO_TxDropped },
+    { "rx_overrun",  STDIO_RxOverruns },
+    { "tlog_drop",   Tlog_Dropped   },
+    { "telem_drop",  Telem_Dropped  },
+    { "heap_free",   telem_heap     },
+    { "heap_min",    MemStat_HeapMin },
+    { "ram_free",    MemStat_RamFree },
+    { "cpu_busy_pm", telem_cpu_busy },
+    { "cpu_peak_pm", telem_cpu_peak },
+    { "idle_load_pm", Idle_LoadPm   },
+    { "sleeps",      Tickless_Sleeps },
+    { "standbys",    Tickless_Standbys },
+    { "clk_low_pm",  CpuFreq_LowPm  },
+    { "clk_switches", CpuFreq_Switches },
+    { "dmamem_err",  DmaMem_Errors  },
+    { "evbus_drop",  EventBus_Dropped },
+    { "mode",        telem_mode     },
+    { "mode_changes", Mode_Changes  },
+    { "stack_min_free", StackMon_MinFree },
+    { "pool_fails",  Pool_Fails     },
+    { "pool_peak_b", MemStat_PoolPeak },
+    { "audio_cyc_max", Audio_CyclesMax },
+    { "audio_over",  Audio_OverBudget },
+    { "audio_overrun", Audio_Overruns },
+    { "beats",       Audio_Beats    },
+    { "snd_late",    Sound_Late     },
+    { "snd_drop",    Sound_Dropped  },
+    { "sd_lat_ms",   telem_sd_lat   },
+    { "sd_err",      SdCard_Errors  },
+    { "stream_under", Stream_Underruns },
+    { "sync_err_us", telem_sync_err },
+    { "sync_peers",  telem_sync_peers },
+    { "dmx_pkts",    Dmx_Packets    },
+    { "net_frames",  NetBridge_Frames },
+    { "pd_frames",   PixDist_Frames },
+    { "pd_bytes",    PixDist_Bytes  },
+    { "usb_rx_ovr",  UsbCdc_RxOverruns },
+    { "set_writes",  Settings_Writes },
+    { "rail_5v_mv",  telem_rail_5v  },
+    { "rail_act_mv", telem_rail_act },
+    { "led_budget_ma", Power_Budget },
+    { "bright_pct",  RailMon_BrightPct },
+};
+
+static uint8_t *telem_put16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *telem_put32(uint8_t *p, uint32_t v)
+{
+    return telem_put16(telem_put16(p, v), v >> 16);
+}
+
+/* NUL-terminated name, cut to fit before end */
+static uint8_t *telem_put_name(uint8_t *p, const uint8_t *end, const char *name)
+{
+    size_t n = strlen(name);
+
+    if (p >= end) return p;
+    if (n > (size_t)(end - p) - 1u) n = (size_t)(end - p) - 1u;
+    memcpy(p, name, n);
+    p[n] = 0u;
+    return p + n + 1u;
+}
+
+/* CRC the payload from start to p, frame it into frame and queue it, or drop it */
+static void telem_send_from(const uint8_t *start, uint8_t *p, uint8_t *frame)
+{
+    size_t len = (size_t)(p - start);
+    bool   sent;
+
+    (void)telem_put16(p, Crc16_Ccitt(start, (uint32_t)len));
+    len  = Cobs_Frame(frame, start, len + 2u);
+    sent = UsbCdc_Connected() ? UsbCdc_TryWrite(frame, len) : STDIO_TxTryWrite(frame, len);
+    if (!sent) telem_dropped++;
+}
+
+static void telem_send(uint8_t *p)
+{
+    telem_send_from(telem_payload, p, telem_frame);
+}
+
+/* The newest snapshot, if the render task left one */
+static void telem_send_capture(void)
+{
+    uint8_t  *p = telem_cap_payload;
+    uint8_t   s;
+
+    taskENTER_CRITICAL();
+    s = telem_snap_ready;
+    telem_snap_ready = TELEM_SNAP_NONE;
+    telem_snap_busy  = s;
+    taskEXIT_CRITICAL();
+    if (s == TELEM_SNAP_NONE) return;
+
+    *p++ = 'F';
+    p    = telem_put16(p, telem_cap_seq++);
+    p    = telem_put32(p, telem_snap_ms[s]);
+    p    = telem_put16(p, telem_snap_n[s]);
+    for (uint16_t i = 0; i < telem_snap_n[s]; i++)
+    {
+        *p++ = Pix_R(telem_snap[s][i]);
+        *p++ = Pix_G(telem_snap[s][i]);
+        *p++ = Pix_B(telem_snap[s][i]);
+    }
+    telem_snap_busy = TELEM_SNAP_NONE;
+    telem_send_from(telem_cap_payload, p, telem_cap_frame);
+}
+
+static void telem_send_schema(void)
+{
+    uint8_t       *p   = telem_payload;
+    const uint8_t *end = &telem_payload[TELEM_PAYLOAD_MAX - 2u];   /* CRC */
+
+    *p++ = 'S';
+    *p++ = (uint8_t)telem_count;
+    for (uint32_t i = 0; i < telem_count; i++)
+        p = telem_put_name(p, end, telem_chan[i].name);
+    telem_send(p);
+}
+
+static void telem_send_sample(uint32_t now_ms)
+{
+    uint8_t *p = telem_payload;
+
+    Metrics_Read(&telem_m);
+    NeoPixel_GetStats(&telem_tx);
+    Stats_Get(&telem_st);
+
+    *p++ = 'D';
+    p    = telem_put16(p, telem_seq++);
+    p    = telem_put32(p, now_ms);
+    *p++ = (uint8_t)telem_count;
+    for (uint32_t i = 0; i < telem_count; i++)
+        p = telem_put32(p, telem_chan[i].read());
+    telem_send(p);
+}
+
+/* CPU share of every task over the latest cpuload.h period, in permille */
+static void telem_send_load(uint32_t now_ms)
+{
+    uint8_t       *p   = telem_payload;
+    const uint8_t *end = &telem_payload[TELEM_PAYLOAD_MAX - 2u];
+
+    Metrics_ReadTasks(&telem_tasks);
+    if (telem_tasks.count == 0u) return;            /* none published yet */
+
+    *p++ = 'L';
+    p    = telem_put16(p, telem_seq++);
+    p    = telem_put32(p, now_ms);
+    for (uint32_t i = 0; i < telem_tasks.count && (size_t)(end - p) > 3u; i++)
+    {
+        p = telem_put16(p, telem_tasks.task[i].pm);
+        p = telem_put_name(p, end, telem_tasks.task[i].name);
+    }
+    telem_send(p);
+}
+
+static void telem_task(void *arg)
+{
+    TickType_t wake   = xTaskGetTickCount();
+    TickType_t load   = wake;
+    TickType_t schema = wake - pdMS_TO_TICKS(TELEM_SCHEMA_S * 1000u);     /* at once */
+
+    (void)arg;
+    for (;;)
+    {
+        uint8_t    hz     = telem_hz;
+        TickType_t period = pdMS_TO_TICKS(1000u / ((hz != 0u) ? hz : 1u));
+        TickType_t late   = xTaskGetTickCount() - wake;
+
+        /* Sleep to the next sample; a captured frame wakes the task early */
+        (void)ulTaskNotifyTake(pdTRUE, (late < period) ? period - late : 0u);
+        telem_send_capture();
+        if ((xTaskGetTickCount() - wake) < period) continue;
+        wake += period;
+        if (hz == 0u)
+        {
+            wake = xTaskGetTickCount();             /* no catch-up once it is set */
+            continue;
+        }
+
+        uint32_t now_ms = (uint32_t)(wake * portTICK_PERIOD_MS);
+
+        if ((wake - schema) >= pdMS_TO_TICKS(TELEM_SCHEMA_S * 1000u))
+        {
+            schema = wake;
+            telem_send_schema();
+        }
+        telem_send_sample(now_ms);
+        if ((wake - load) >= pdMS_TO_TICKS(1000u))
+        {
+            load = wake;
+            telem_send_load(now_ms);
+        }
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Telem_Register(const char *name, telem_read_fn read)
+{
+    if (telem_count == TELEM_MAX_CHANNELS || read == NULL) return false;
+
+    telem_chan[telem_count].name = name;
+    telem_chan[telem_count].read = read;
+    telem_count++;
+    return true;
+}
+
+bool Telem_Start(void)
+{
+    _Static_assert(sizeof(telem_builtin) / sizeof(telem_builtin[0]) <= TELEM_MAX_CHANNELS,
+                   "TELEM_MAX_CHANNELS drops built-in channels");
+    for (uint32_t i = 0; i < sizeof(telem_builtin) / sizeof(telem_builtin[0]); i++)
+        (void)Telem_Register(telem_builtin[i].name, telem_builtin[i].read);
+    (void)Cli_Register(&telem_hz_param);
+    telem_handle = xTaskCreateStatic(telem_task, "Telem", TELEM_STACK, NULL, TELEM_TASK_PRIO,
+                                     telem_stack, &telem_tcb);
+    return telem_handle != NULL;
+}
+
+uint32_t Telem_Dropped(void)
+{
+    return telem_dropped;
+}
+
+void Telem_Capture(uint32_t frames, uint8_t every)
+{
+    telem_cap_every = (every != 0u) ? every : 1u;
+    telem_cap_skip  = 0u;
+    telem_cap_left  = frames;
+}
+
+uint32_t Telem_CaptureLeft(void)
+{
+    return telem_cap_left;
+}
+
+uint8_t Telem_CaptureEvery(void)
+{
+    return telem_cap_every;
+}
+
+void Telem_CaptureFrame(const pix_t *px, uint16_t n)
+{
+    uint8_t w;
+
+    if (telem_cap_left == 0u || ++telem_cap_skip < telem_cap_every) return;
+    telem_cap_skip = 0u;
+    if (n > PIXDIST_SCENE_LEDS) n = PIXDIST_SCENE_LEDS;
+
+    /* The buffer the Telem task is not reading; a stale one is taken back */
+    taskENTER_CRITICAL();
+    w = (telem_snap_busy == 1u) ? 0u : 1u;
+    if (telem_snap_ready == w) telem_snap_ready = TELEM_SNAP_NONE;
+    taskEXIT_CRITICAL();
+
+    memcpy(telem_snap[w], px, (size_t)n * sizeof(pix_t));
+    telem_snap_n[w]  = n;
+    telem_snap_ms[w] = (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    telem_snap_ready = w;
+    telem_cap_left--;
+    if (telem_handle != NULL) xTaskNotifyGive(telem_handle);
+}
@@ -0,0 +1,97 @@
+/* =============================================================================
+ * telem.h  -  Binary telemetry stream for host dashboards
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The "Telem" task samples every registered counter telem_hz times a second
+ * (a cli.h parameter, 0 = off) and sends the values as one COBS frame
+ * (cobs.h), on the USB port while a host holds it open (usbcdc.h), else
+ * on the console. Once a second it also sends the CPU load of
+ * every task, as last measured by cpuload.h, and
+ * every TELEM_SCHEMA_S seconds the channel names, so a host tool can join
+ * at any time. Payloads, all little endian, end in a CRC-16/CCITT-FALSE
+ * (poly 0x1021, init 0xFFFF) of the bytes before it:
+ *
+ *   'S' | n:u8 | name\0 * n                                   schema
+ *   'D' | seq:u16 | time_ms:u32 | n:u8 | value:u32 * n         sample
+ *   'L' | seq:u16 | time_ms:u32 | (permille:u16 | name\0) * k  task load
+ *   'F' | seq:u16 | time_ms:u32 | n:u16 | (r, g, b) * n          frame
+ *
+ * 'F' frames carry the whole rendered scene, after the power limiter and
+ * before gamma and wire encoding, for the next Telem_Capture() frames
+ * (CLI "capture"), every `every`-th rendered frame, with their own seq.
+ * The render task only copies the scene into one of two snapshots and
+ * wakes the Telem task, which frames and sends it; a snapshot it has not
+ * picked up yet is replaced by the next, so capture never stalls a frame.
+ * A 144-LED frame is ~450 bytes: USB takes every frame, the console about
+ * one in three at 60 fps (decimate to suit), and a frame that does not fit
+ * its TX ring (1 KB) only goes on USB. tools/frame_view.py shows them.
+ *
+ * A frame is queued whole or not at all (STDIO_TxTryWrite(),
+ * UsbCdc_TryWrite()), so the
+ * stream never stalls the task or splits around console text; frames that
+ * do not fit are counted by Telem_Dropped() and seq shows the gap.
+ *
+ * Built in: frame rate, render cycles, missed frames, NeoPixel DMA / SPI
+ * errors, timeouts and late frames, lid duty and triggers, visitor
+ * arrivals, dropped console and tlog output, RX overruns, free heap, its
+ * low-water mark and the free RAM (memstat.h), CPU
+ * busy share and its rolling peak, and the idle-hook load (idle.h), all
+ * permille, the tickless sleeps / standbys entered (tickless.h) and the
+ * smallest stack headroom of any task (stackmon.h), failed pool
+ * allocations and the pool peak bytes (pool.h), the audio block cost, budget misses, overruns
+ * and beats (audio.h), late sound blocks and dropped cues (sound.h), and
+ * overrun USB OUT packets.
+ * tools/telem_decode.py prints the stream as CSV.
+ * ============================================================================= */
+
+#ifndef TELEM_H
+#define TELEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define TELEM_MAX_CHANNELS  64u
+#define TELEM_HZ            5u          /* default sample rate, "telem_hz"     */
+#define TELEM_HZ_MAX        200u        /* the console holds ~50, USB all  */
+#define TELEM_SCHEMA_S      5u          /* names resent this often             */
+#define TELEM_CAP_EVERY     2u          /* default capture decimation          */
+#define TELEM_TASK_PRIO     1u
+
+/** Reads one counter; called from the Telem task. */
+typedef uint32_t (*telem_read_fn)(void);
+
+/**
+ * Add a channel (name without spaces, kept by pointer). Before
+ * Telem_Start(); false if the table is full.
+ */
+bool Telem_Register(const char *name, telem_read_fn read);
+
+/**
+ * Register the built-in channels and the telem_hz parameter, then create
+ * the task (static). Before Cli_Start() and the scheduler.
+ */
+bool Telem_Start(void);
+
+/** Frames not sent because the console TX ring or USB buffer was full. */
+uint32_t Telem_Dropped(void);
+
+/**
+ * Send `frames` 'F' frames (0 = stop), one of every `every` rendered (0 is
+ * taken as 1). Frames that do not fit the transport are dropped and still
+ * counted. Any task.
+ */
+void Telem_Capture(uint32_t frames, uint8_t every);
+
+/** Capture frames still to take, and the decimation. Any task. */
+uint32_t Telem_CaptureLeft(void);
+uint8_t  Telem_CaptureEvery(void);
+
+/**
+ * Render task hook: the scene just rendered, `n` pixels. Returns at once
+ * unless a capture is running; else a copy of the scene, no encoding.
+ */
+void Telem_CaptureFrame(const pix_t *px, uint16_t n);
+
+#endif /* TELEM_H */
@@ -0,0 +1,200 @@
+/* =============================================================================
+ * tickless.c  -  Tickless idle on the RTC, standby when nothing needs clocks
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "tickless.h"
+#include "definitions.h"        /* RTC, PM, OSC32KCTRL, MCLK, DMAC, SysTick */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "idle.h"
+#include "cpufreq.h"
+#include "irqstat.h"
+
+#if configUSE_TICKLESS_IDLE != 2
+#error "tickless.c needs configUSE_TICKLESS_IDLE 2 (its own vPortSuppressTicksAndSleep)"
+#endif
+
+#define TICKLESS_TICK_US        (1000000u / configTICK_RATE_HZ)
+#define TICKLESS_TICK_CYCLES    (configCPU_CLOCK_HZ / configTICK_RATE_HZ / CpuFreq_Div())
+#define TICKLESS_CYCLES_PER_US  (configCPU_CLOCK_HZ / 1000000u / CpuFreq_Div())   /* SysTick counts */
+
+/* idle.h / cpuload.h work on 32-bit cycle differences: < 35.8 s at 120 MHz */
+#if TICKLESS_MAX_MS > 30000u
+#error "TICKLESS_MAX_MS must stay below one DWT->CYCCNT wrap"
+#endif
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static tickless_veto_fn  tickless_veto[TICKLESS_MAX_VETOES];
+static uint32_t          tickless_nveto;
+static volatile uint32_t tickless_sleeps;
+static volatile uint32_t tickless_standbys;
+static volatile bool     tickless_standby_on = TICKLESS_STANDBY;
+
+static uint32_t tickless_rtc_now(void)
+{
+    while ((RTC_REGS->MODE0.RTC_SYNCBUSY & RTC_MODE0_SYNCBUSY_COUNT_Msk) != 0u) {}
+    return RTC_REGS->MODE0.RTC_COUNT;
+}
+
+static void tickless_sleep_mode(uint32_t mode)
+{
+    PM_REGS->PM_SLEEPCFG = (uint8_t)mode;
+    while ((PM_REGS->PM_SLEEPCFG & PM_SLEEPCFG_SLEEPMODE_Msk) != mode) {}
+}
+
+static bool tickless_standby_ok(void)
+{
+    if (DMAC_REGS->DMAC_BUSYCH != 0u || DMAC_REGS->DMAC_PENDCH != 0u) return false;
+    for (uint32_t i = 0; i < tickless_nveto; i++)
+        if (tickless_veto[i]()) return false;
+    return true;
+}
+
+/* -- Interrupt handler --------------------------------------------------------- */
+
+/* Compare match: the wake-up itself is all we need */
+void RTC_Handler(void)
+{
+    IRQSTAT_ENTER(IRQSTAT_TICKLESS);
+    RTC_REGS->MODE0.RTC_INTFLAG = RTC_MODE0_INTFLAG_CMP0_Msk;
+    IRQSTAT_EXIT(IRQSTAT_TICKLESS);
+}
+
+/* -- Kernel hook ---------------------------------------------------------------- */
+
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+    if (xExpectedIdleTime > pdMS_TO_TICKS(TICKLESS_MAX_MS))
+        xExpectedIdleTime = pdMS_TO_TICKS(TICKLESS_MAX_MS);
+
+    /* Masked, not BASEPRI: the interrupt that ends the sleep must still wake it */
+    __disable_irq();
+    __DSB();
+    __ISB();
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep)
+    {
+        __enable_irq();
+        return;
+    }
+
+    /* Stop the tick; how far into the current period are we? */
+    uint32_t pend   = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0u;
+    uint32_t into_us;
+
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk;
+    if (pend)
+    {
+        SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;     /* that tick is stepped below */
+        into_us   = 0u;
+    }
+    else
+    {
+        into_us = (SysTick->LOAD + 1u - SysTick->VAL) / TICKLESS_CYCLES_PER_US;
+    }
+
+    /* Wake at the tick the kernel expects the next task on */
+    uint32_t wait_us = (uint32_t)(xExpectedIdleTime - pend) * TICKLESS_TICK_US - into_us;
+    uint32_t wait    = (uint32_t)(((uint64_t)wait_us * TICKLESS_RTC_HZ) / 1000000u);
+    uint32_t start   = tickless_rtc_now();
+
+    if (wait < 4u) wait = 4u;                   /* COMP0 write sync margin */
+    RTC_REGS->MODE0.RTC_COMP[0] = start + wait;
+    while ((RTC_REGS->MODE0.RTC_SYNCBUSY & RTC_MODE0_SYNCBUSY_COMP0_Msk) != 0u) {}
+    RTC_REGS->MODE0.RTC_INTFLAG  = RTC_MODE0_INTFLAG_CMP0_Msk;
+    RTC_REGS->MODE0.RTC_INTENSET = RTC_MODE0_INTENSET_CMP0_Msk;
+
+    bool standby = tickless_standby_on &&
+                   wait_us >= TICKLESS_STANDBY_MIN_MS * 1000u &&
+                   tickless_standby_ok();
+
+    tickless_sleeps++;
+    Idle_SleepEnter();
+    if (standby)
+    {
+        tickless_standbys++;
+        tickless_sleep_mode(PM_SLEEPCFG_SLEEPMODE_STANDBY);
+    }
+    __DSB();
+    __WFI();
+    __ISB();
+
+    uint32_t slept_us = (uint32_t)(((uint64_t)(tickless_rtc_now() - start) * 1000000u) / TICKLESS_RTC_HZ);
+
+    if (standby)
+    {
+        tickless_sleep_mode(PM_SLEEPCFG_SLEEPMODE_IDLE);
+        Idle_SleepExitStandby(slept_us);
+    }
+    else
+    {
+        Idle_SleepExit();
+    }
+    RTC_REGS->MODE0.RTC_INTENCLR = RTC_MODE0_INTENCLR_CMP0_Msk;
+
+    /* Step the kernel by whole ticks, resume the SysTick mid-period */
+    uint32_t   since = into_us + slept_us;
+    TickType_t ticks = (TickType_t)(pend + since / TICKLESS_TICK_US);
+    uint32_t   rest  = since % TICKLESS_TICK_US;
+
+    if (ticks >= xExpectedIdleTime)
+    {
+        ticks = xExpectedIdleTime;              /* late wake: never past the deadline */
+        rest  = 0u;
+    }
+    SysTick->LOAD = (TICKLESS_TICK_US - rest) * TICKLESS_CYCLES_PER_US - 1u;
+    SysTick->VAL  = 0u;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = TICKLESS_TICK_CYCLES - 1u;  /* taken at the next reload */
+    vTaskStepTick(ticks);
+
+    __enable_irq();
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Tickless_Init(void)
+{
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_RTC_Msk;
+    OSC32KCTRL_REGS->OSC32KCTRL_RTCCTRL = OSC32KCTRL_RTCCTRL_RTCSEL_ULP32K;
+
+    RTC_REGS->MODE0.RTC_CTRLA = RTC_MODE0_CTRLA_SWRST_Msk;
+    while ((RTC_REGS->MODE0.RTC_SYNCBUSY & RTC_MODE0_SYNCBUSY_SWRST_Msk) != 0u) {}
+    RTC_REGS->MODE0.RTC_CTRLA = RTC_MODE0_CTRLA_MODE_COUNT32 | RTC_MODE0_CTRLA_PRESCALER_DIV1 |
+                                RTC_MODE0_CTRLA_COUNTSYNC_Msk;
+    RTC_REGS->MODE0.RTC_CTRLA |= RTC_MODE0_CTRLA_ENABLE_Msk;
+    while ((RTC_REGS->MODE0.RTC_SYNCBUSY & (RTC_MODE0_SYNCBUSY_ENABLE_Msk |
+                                            RTC_MODE0_SYNCBUSY_COUNTSYNC_Msk)) != 0u) {}
+
+    NVIC_SetPriority(RTC_IRQn, TICKLESS_IRQ_PRIO);
+    NVIC_ClearPendingIRQ(RTC_IRQn);
+    NVIC_EnableIRQ(RTC_IRQn);
+}
+
+bool Tickless_RegisterVeto(tickless_veto_fn veto)
+{
+    if (tickless_nveto == TICKLESS_MAX_VETOES || veto == NULL) return false;
+    tickless_veto[tickless_nveto++] = veto;
+    return true;
+}
+
+void Tickless_SetStandby(bool allow)
+{
+    tickless_standby_on = allow;
+}
+
+uint32_t Tickless_RtcCount(void)
+{
+    return tickless_rtc_now();
+}
+
+uint32_t Tickless_Sleeps(void)
+{
+    return tickless_sleeps;
+}
+
+uint32_t Tickless_Standbys(void)
+{
+    return tickless_standbys;
+}
@@ -0,0 +1,74 @@
+/* =============================================================================
+ * tickless.h  -  Tickless idle on the RTC, standby when nothing needs clocks
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * With configUSE_TICKLESS_IDLE = 2 the kernel calls our
+ * vPortSuppressTicksAndSleep() whenever every task is blocked for two
+ * ticks or more. It stops the SysTick, sets the RTC (32.768 kHz from the
+ * ULP oscillator, runs in every sleep mode) to wake the core when the next
+ * task is due, sleeps, and on wake-up steps the tick count by the time the
+ * RTC saw. No 1 kHz wake-ups while the lid rests 25-60 s.
+ *
+ * The sleep mode is chosen at each entry:
+ *   STANDBY   if TICKLESS_STANDBY, the gap is at least
+ *             TICKLESS_STANDBY_MIN_MS and no veto objects
+ *   IDLE      otherwise: only the CPU stops, every peripheral runs on
+ *
+ * In STANDBY the DFLL, both DPLLs and every GCLK stop, and with them all
+ * peripherals but the RTC and the EIC (ULP32K, the D-SUN still wakes us).
+ * That is only safe when nothing is in flight, so modules whose hardware
+ * must keep running register a veto, called with interrupts masked just
+ * before the decision (keep it to a few register or variable reads):
+ *
+ *   built in      DMAC: any channel busy or pending (NeoPixel, console TX)
+ *   actuator.c    a sequence is playing (TCC1 pattern, PWM, relay steps)
+ *   dsun_sensor   ranging is on (TC2 / TC4)
+ *   i2c_bus.c     a transaction is queued
+ *   stdio_uart.c  console TX queued, or input within STDIO_RX_AWAKE_MS
+ *
+ * Side effects of STANDBY, why it is off by default (mains installs):
+ *   - the show clock (TC0, 1 MHz) pauses: cue times stretch by the sleep;
+ *   - the first console byte after a standby is lost (press Enter once);
+ *   - wake-up takes the DFLL / DPLL restart, some hundred microseconds.
+ * Battery installs set TICKLESS_STANDBY to 1; Tickless_SetStandby() turns
+ * it on and off at run time, e.g. for the closed hours of showcal.h.
+ *
+ * Sleep time goes to idle.h, which keeps DWT->CYCCNT and the load meter
+ * in step with the RTC.
+ * ============================================================================= */
+
+#ifndef TICKLESS_H
+#define TICKLESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define TICKLESS_STANDBY            0       /* 1 = standby when nothing vetoes   */
+#define TICKLESS_STANDBY_MIN_MS     20u     /* shorter gaps sleep in IDLE        */
+#define TICKLESS_MAX_MS             30000u  /* longest sleep, < one CYCCNT wrap  */
+#define TICKLESS_MAX_VETOES         12u
+#define TICKLESS_RTC_HZ             32768u  /* ULP32K, Tickless_RtcCount()     */
+#define TICKLESS_IRQ_PRIO           IRQ_PRIO_TICKLESS   /* irqprio.h: only wakes */
+
+/** True while the module's hardware must keep its clocks. ISR context. */
+typedef bool (*tickless_veto_fn)(void);
+
+/** Start the RTC. After Idle_Init(), before the scheduler. */
+void Tickless_Init(void);
+
+/** Add a standby veto. Before the scheduler; false if the table is full. */
+bool Tickless_RegisterVeto(tickless_veto_fn veto);
+
+/** Allow STANDBY (the vetoes still apply) or keep to IDLE; starts as TICKLESS_STANDBY. Any task. */
+void Tickless_SetStandby(bool allow);
+
+/** RTC count, TICKLESS_RTC_HZ, in every sleep mode; wraps every ~36 h. Any task. */
+uint32_t Tickless_RtcCount(void);
+
+/** Sleeps entered since boot, and how many of them were STANDBY. Any task. */
+uint32_t Tickless_Sleeps(void);
+uint32_t Tickless_Standbys(void);
+
+#endif /* TICKLESS_H */
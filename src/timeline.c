@@ -0,0 +1,134 @@
+/* =============================================================================
+ * timeline.c  -  Keyframe timeline interpolated per rendered frame
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "timeline.h"
+#include "effects.h"
+#include "fastmath.h"
+#include "showsync.h"
+#include "cache.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const timeline_t *volatile tl_req = NULL;     /* pending Timeline_Play()   */
+static volatile bool              tl_req_set = false;
+static volatile bool              tl_req_now = true;    /* else start at tl_req_at */
+static volatile uint32_t          tl_req_at  = 0u;
+
+static const timeline_t *tl      = NULL;             /* playing, or NULL          */
+static uint32_t          tl_start;                   /* network time of the first key */
+static uint16_t          tl_cur  = 0u;               /* key at or before now      */
+static pix_t             tl_colour = 0u;
+static uint8_t           tl_value  = 0u;
+
+/* Output at ms into tl, which the caller keeps below the last key's time */
+static void tl_interpolate(uint32_t ms)
+{
+    const timeline_key_t *k = tl->keys;
+
+    if (ms < k[tl_cur].t_ms)                        /* looped back */
+        tl_cur = 0u;
+    while (tl_cur + 1u < tl->count && k[tl_cur + 1u].t_ms <= ms)
+        tl_cur++;
+
+    const timeline_key_t *a = &k[tl_cur];
+    const timeline_key_t *b = &k[tl_cur + 1u];
+    uint32_t f = 0u;
+
+    if (ms > a->t_ms)
+        f = ((ms - a->t_ms) << 8) / (uint32_t)(b->t_ms - a->t_ms);   /* 0..255 */
+
+    if (a->ease == TIMELINE_EASE)
+        f = Math_Ease8((uint8_t)f);
+    else if (a->ease == TIMELINE_STEP)
+        f = 0u;
+
+    tl_colour = Pix_Blend(a->colour, b->colour, (uint16_t)f);
+    tl_value  = Math_Lerp8(a->value, b->value, (uint8_t)f);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Timeline_Play(const timeline_t *t)
+{
+    taskENTER_CRITICAL();
+    tl_req     = t;
+    tl_req_now = true;
+    tl_req_set = true;
+    taskEXIT_CRITICAL();
+    Effects_Wake();
+}
+
+void Timeline_PlayAt(const timeline_t *t, uint32_t at)
+{
+    taskENTER_CRITICAL();
+    tl_req     = t;
+    tl_req_at  = at;
+    tl_req_now = false;
+    tl_req_set = true;
+    taskEXIT_CRITICAL();
+    Effects_Wake();
+}
+
+bool Timeline_Playing(void)
+{
+    return tl != NULL;
+}
+
+uint8_t Timeline_Value(void)
+{
+    return tl_value;
+}
+
+bool Timeline_Update(uint8_t steps)
+{
+    uint32_t now = ShowSync_Now();
+
+    (void)steps;
+
+    if (tl_req_set)
+    {
+        taskENTER_CRITICAL();
+        tl         = tl_req;
+        tl_start   = tl_req_now ? now : ShowSync_ToNet(tl_req_at);
+        tl_req_set = false;
+        taskEXIT_CRITICAL();
+
+        if (tl != NULL && tl->count == 0u)
+            tl = NULL;
+        tl_cur   = 0u;
+    }
+
+    if (tl == NULL) return false;
+    if ((int32_t)(now - tl_start) < 0)
+        return true;                                /* cued: hold, keep frames coming */
+
+    const timeline_key_t *last = &tl->keys[tl->count - 1u];
+    uint32_t ms = (now - tl_start) / 1000u;
+
+    if (ms >= last->t_ms)
+    {
+        if (!tl->loop || last->t_ms == 0u)
+        {
+            /* Hold the last key; this frame still changes, the next ones do not */
+            tl_colour = last->colour;
+            tl_value  = last->value;
+            tl = NULL;
+            return true;
+        }
+        ms %= last->t_ms;
+    }
+
+    tl_interpolate(ms);
+    return true;
+}
+
+pix_t CACHE_HOT Timeline_Pixel(uint16_t i, uint8_t offset)
+{
+    (void)i;
+    (void)offset;
+    return tl_colour;
+}
@@ -0,0 +1,78 @@
+/* =============================================================================
+ * timeline.h  -  Keyframe timeline interpolated per rendered frame
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * A show is authored as a few sparse keyframes (time, colour, parameter
+ * value) and played back at whatever rate the renderer runs. Every frame the
+ * two keys around the current time are interpolated in fixed point, so the
+ * same data gives 25 or 100 FPS output and the cost per frame is one divide
+ * plus one blend, independent of the key count (the cursor only moves
+ * forward).
+ *
+ * Time is taken from the show clock (showclock.h), not from frame counts,
+ * so dropped or late frames never stretch the show, and a timeline started
+ * with Timeline_PlayAt() lines up with actuator cues on the same clock.
+ * The clock is read as network time (showsync.h), so on a show-sync
+ * network every prop plays the same frame; alone it is the show clock
+ * plus a constant. The interpolated colour is shown by
+ * the EFFECT_TIMELINE effect (see effects.h); the value track is free for
+ * whatever parameter the caller binds it to (Timeline_Value()).
+ * ============================================================================= */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixmath.h"
+
+/* How a key moves towards the next one */
+#define TIMELINE_LINEAR     0u          /* constant rate                          */
+#define TIMELINE_EASE       1u          /* smoothstep in and out (Math_Ease8)     */
+#define TIMELINE_STEP       2u          /* hold, jump at the next key             */
+
+typedef struct
+{
+    uint16_t t_ms;          /* from the start of the timeline, ascending     */
+    uint8_t  ease;          /* TIMELINE_*, towards the next key              */
+    uint8_t  value;         /* parameter track                               */
+    pix_t    colour;
+} timeline_key_t;
+
+typedef struct
+{
+    const timeline_key_t *keys;     /* first key normally at t_ms = 0        */
+    uint16_t              count;
+    bool                  loop;     /* restart after the last key, else hold */
+} timeline_t;
+
+/**
+ * Start playing `tl` from its first key on the next frame; NULL stops and
+ * holds the current output. The timeline must stay valid while it plays.
+ * Safe to call from any task.
+ */
+void Timeline_Play(const timeline_t *tl);
+
+/**
+ * Timeline_Play() with the first key at show time `t` (ShowClock_Now()
+ * units). Until then the current output is held. Safe to call from any task.
+ */
+void Timeline_PlayAt(const timeline_t *tl, uint32_t t);
+
+/** True while a timeline is playing (false once a non-looping one ended). */
+bool Timeline_Playing(void);
+
+/** Interpolated value track of the current frame. */
+uint8_t Timeline_Value(void);
+
+/**
+ * Interpolate the current frame at the show time; steps is unused (the
+ * clock already covers late frames). Effect frame hook: returns true while
+ * the output is changing.
+ */
+bool Timeline_Update(uint8_t steps);
+
+/** Effect kernel: the interpolated colour on every LED. */
+pix_t Timeline_Pixel(uint16_t i, uint8_t offset);
+
+#endif /* TIMELINE_H */
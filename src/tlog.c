@@ -0,0 +1,137 @@
+/* =============================================================================
+ * tlog.c  -  Tokenized binary logging, decoded on the host from the ELF
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "tlog.h"
+#include "definitions.h"        /* core_cm4.h: __LDREXW, __STREXW, __DMB */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "showclock.h"
+#include "cobs.h"
+#include "stdio_uart.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* seq = claim index + 1 once the rest of the slot is valid */
+typedef struct
+{
+    volatile uint32_t seq;
+    uint32_t          hdr;              /* format ID | nargs << 24 */
+    uint32_t          time_us;
+    uint32_t          args[TLOG_ARGS_MAX];
+} tlog_rec_t;
+
+static tlog_rec_t        tlog_ring[TLOG_RING];
+static volatile uint32_t tlog_head;     /* next index to claim, writers   */
+static volatile uint32_t tlog_tail;     /* next index to drain, drain task */
+static volatile uint32_t tlog_dropped;
+
+#define TLOG_STACK          (configMINIMAL_STACK_SIZE * 2u)
+static StackType_t       tlog_stack[TLOG_STACK];
+static StaticTask_t      tlog_tcb;
+
+#define TLOG_PAYLOAD_MAX    (8u + 4u * TLOG_ARGS_MAX + 1u)
+
+/* Add to a counter shared by tasks and ISRs without masking interrupts */
+static void tlog_atomic_inc(volatile uint32_t *v)
+{
+    uint32_t n;
+
+    do {
+        n = __LDREXW(v) + 1u;
+    } while (__STREXW(n, v) != 0u);
+}
+
+static uint8_t *tlog_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+/* Encode and send one record as a delimited frame, whole: the drain task
+ * waits for room rather than split it around other console output */
+static void tlog_emit(const tlog_rec_t *r)
+{
+    uint8_t  payload[TLOG_PAYLOAD_MAX];
+    uint8_t  frame[COBS_FRAME_MAX(TLOG_PAYLOAD_MAX)];
+    uint32_t nargs = r->hdr >> 24;
+    uint8_t *p     = payload;
+    uint8_t  sum   = 0u;
+    size_t   len;
+
+    p = tlog_put32(p, r->hdr & 0x00FFFFFFu);
+    p = tlog_put32(p, r->time_us);
+    for (uint32_t i = 0u; i < nargs; i++)
+        p = tlog_put32(p, r->args[i]);
+    for (uint8_t *q = payload; q < p; q++)
+        sum += *q;
+    *p++ = (uint8_t)(0u - sum);
+
+    len = Cobs_Frame(frame, payload, (size_t)(p - payload));
+    while (!STDIO_TxTryWrite(frame, len))
+        vTaskDelay(1);                  /* ~11 bytes leave per ms at 115200 */
+}
+
+/* Drain every finished record in claim order, then sleep */
+static void tlog_task(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        uint32_t t = tlog_tail;
+        const tlog_rec_t *r = &tlog_ring[t & (TLOG_RING - 1u)];
+
+        if (r->seq != t + 1u)
+        {
+            /* Empty, or the oldest writer has not finished its slot yet */
+            vTaskDelay(pdMS_TO_TICKS(TLOG_DRAIN_MS));
+            continue;
+        }
+        __DMB();                        /* slot contents after its seq */
+        tlog_emit(r);
+        __DMB();                        /* done reading before the slot is reused */
+        tlog_tail = t + 1u;
+    }
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+bool Tlog_Start(void)
+{
+    return xTaskCreateStatic(tlog_task, "Tlog", TLOG_STACK, NULL, TLOG_TASK_PRIO,
+                             tlog_stack, &tlog_tcb) != NULL;
+}
+
+void Tlog_Write(uint32_t id, uint32_t nargs, const uint32_t *args)
+{
+    uint32_t    h;
+    tlog_rec_t *r;
+
+    /* Claim index h; a slot is free once the drain task has passed h - TLOG_RING */
+    do {
+        h = __LDREXW(&tlog_head);
+        if ((h - tlog_tail) >= TLOG_RING)
+        {
+            __CLREX();
+            tlog_atomic_inc(&tlog_dropped);
+            return;
+        }
+    } while (__STREXW(h + 1u, &tlog_head) != 0u);
+
+    r          = &tlog_ring[h & (TLOG_RING - 1u)];
+    r->hdr     = id | (nargs << 24);
+    r->time_us = ShowClock_Now();
+    for (uint32_t i = 0u; i < nargs; i++)
+        r->args[i] = args[i];
+    __DMB();                            /* contents before the publish */
+    r->seq = h + 1u;
+}
+
+uint32_t Tlog_Dropped(void)
+{
+    return tlog_dropped;
+}
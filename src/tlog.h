@@ -0,0 +1,83 @@
+/* =============================================================================
+ * tlog.h  -  Tokenized binary logging, decoded on the host from the ELF
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * TLOG("lid %u open after %u ms", ch, ms) does not format anything. Its
+ * format string is placed in the .tlog_fmt section, which the linker keeps
+ * in the ELF but never loads into flash, and the string's offset in that
+ * section is its ID. At run time the call only stores the ID, a show-clock
+ * time stamp and up to TLOG_ARGS_MAX raw 32-bit argument words in a ring:
+ * a few dozen cycles and no locks (interrupts are masked only for the
+ * show-clock read), so it is safe in any task or ISR and cheap enough to
+ * leave on in production.
+ *
+ * Writers claim a ring slot with LDREX/STREX and publish it with a sequence
+ * word, so they never wait for one another. A full ring drops the record
+ * (counted by Tlog_Dropped()) instead of blocking.
+ *
+ * The "Tlog" task (Tlog_Start()) drains finished records to stdout as
+ * COBS frames delimited by 0x00 bytes, which text written to the console
+ * never contains, so both can share the SERCOM5 port:
+ *
+ *   00 | cobs( id:u32 | time_us:u32 | arg:u32 * n | sum:u8 ) | 00
+ *
+ * all little endian, sum = the two's complement of the byte sum before it.
+ * tools/tlog_decode.py takes the built ELF and the captured stream and
+ * prints every record with its format applied; text in between is passed
+ * through as is.
+ *
+ * Arguments are integers (pointers only through a uintptr_t cast). %s
+ * cannot be decoded, as the string itself is not sent. Every call site
+ * gets its own ID, even for identical strings.
+ * ============================================================================= */
+
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef TLOG_ENABLE
+#define TLOG_ENABLE         1
+#endif
+#define TLOG_ARGS_MAX       4u          /* argument words per record            */
+#define TLOG_RING           64u         /* records in flight, power of two      */
+#define TLOG_DRAIN_MS       10u         /* drain task poll period when idle     */
+#define TLOG_TASK_PRIO      1u          /* just above idle                      */
+
+/*
+ * Non-allocated (not loaded) ELF section for the format strings. GCC appends
+ * its own flags to the name; the '@' starts an assembler comment on ARM, so
+ * the "" (no SHF_ALLOC) flags given here are the ones that count.
+ */
+#ifndef TLOG_SECTION
+#define TLOG_SECTION        ".tlog_fmt,\"\",%progbits @"
+#endif
+
+#if (TLOG_RING & (TLOG_RING - 1u)) != 0u
+#error "TLOG_RING must be a power of two"
+#endif
+
+/** Create the drain task (static). Before the scheduler starts. */
+bool Tlog_Start(void);
+
+/** Store one record; use TLOG(). Any task or ISR, never blocks. */
+void Tlog_Write(uint32_t id, uint32_t nargs, const uint32_t *args);
+
+/** Records lost to a full ring since boot. */
+uint32_t Tlog_Dropped(void);
+
+#if TLOG_ENABLE
+#define TLOG(fmt, ...)                                                          \
+    do {                                                                        \
+        static const char tlog_fmt_[] __attribute__((section(TLOG_SECTION))) = fmt; \
+        const uint32_t tlog_args_[] = { 0u, ##__VA_ARGS__ };  /* [0] pads no args */ \
+        _Static_assert(sizeof(tlog_args_) / 4u - 1u <= TLOG_ARGS_MAX, "TLOG: too many arguments"); \
+        Tlog_Write((uint32_t)(uintptr_t)tlog_fmt_, sizeof(tlog_args_) / 4u - 1u, &tlog_args_[1]); \
+    } while (0)
+#else
+#define TLOG(fmt, ...)      ((void)0)
+#endif
+
+#endif /* TLOG_H */
@@ -0,0 +1,342 @@
+/* =============================================================================
+ * tof.c  -  VL53L1X time-of-flight distance sensor on the I2C bus
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "tof.h"
+#include <string.h>
+#include "definitions.h"        /* EIC, PORT, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "i2c_bus.h"
+#include "evbus.h"
+#include "irqstat.h"
+#include "log.h"
+
+#define TOF_PIN             15u                 /* PA15 */
+#define TOF_LINE            (1u << 15)          /* EXTINT[15]: EIC CONFIG[1], field 7 */
+#define TOF_STACK           (configMINIMAL_STACK_SIZE * 2u)
+#define TOF_WAIT_MS         (2u * TOF_PERIOD_MS + TOF_BUDGET_MS)    /* a result is overdue */
+#define TOF_BOOT_TRIES      10u                 /* 2 ms apart; it boots in 1.2 ms */
+
+/* Registers, 16-bit addresses, big-endian data */
+#define TOF_REG_VHV_LOOP    0x0008u             /* VHV_CONFIG__TIMEOUT_MACROP_LOOP_BOUND */
+#define TOF_REG_VHV_INIT    0x000Bu             /* VHV_CONFIG__INIT                      */
+#define TOF_REG_CFG         0x002Du             /* first of the default configuration    */
+#define TOF_REG_CLEAR       0x0086u             /* SYSTEM__INTERRUPT_CLEAR               */
+#define TOF_REG_MODE        0x0087u             /* SYSTEM__MODE_START                    */
+#define TOF_REG_RESULT      0x0089u             /* RESULT__RANGE_STATUS                  */
+#define TOF_REG_OSC         0x00DEu             /* RESULT__OSC_CALIBRATE_VAL             */
+#define TOF_REG_BOOT        0x00E5u             /* FIRMWARE__SYSTEM_STATUS               */
+#define TOF_REG_ID          0x010Fu             /* IDENTIFICATION__MODEL_ID              */
+
+#define TOF_MODEL_ID        0xEACCu
+#define TOF_MODE_RANGING    0x40u               /* back-to-back on the period timer      */
+#define TOF_CFG_BYTES       91u                 /* 0x2D..0x87                            */
+#define TOF_RESULT_BYTES    17u
+#define TOF_AT(reg)         (2u + (reg) - TOF_REG_CFG)      /* in the setup write        */
+
+/* Timing budget (RANGE_CONFIG__TIMEOUT_MACROP_A / _B), per distance mode */
+#if TOF_LONG
+#if   TOF_BUDGET_MS == 20u
+#define TOF_BUDGET_A        0x001Eu
+#define TOF_BUDGET_B        0x0022u
+#elif TOF_BUDGET_MS == 33u
+#define TOF_BUDGET_A        0x0060u
+#define TOF_BUDGET_B        0x006Eu
+#elif TOF_BUDGET_MS == 50u
+#define TOF_BUDGET_A        0x00ADu
+#define TOF_BUDGET_B        0x00C6u
+#elif TOF_BUDGET_MS == 100u
+#define TOF_BUDGET_A        0x01CCu
+#define TOF_BUDGET_B        0x01EAu
+#elif TOF_BUDGET_MS == 200u
+#define TOF_BUDGET_A        0x02D9u
+#define TOF_BUDGET_B        0x02F8u
+#elif TOF_BUDGET_MS == 500u
+#define TOF_BUDGET_A        0x048Fu
+#define TOF_BUDGET_B        0x04A4u
+#else
+#error "TOF_BUDGET_MS: 20, 33, 50, 100, 200 or 500 in long mode"
+#endif
+#else
+#if   TOF_BUDGET_MS == 15u
+#define TOF_BUDGET_A        0x001Du
+#define TOF_BUDGET_B        0x0027u
+#elif TOF_BUDGET_MS == 20u
+#define TOF_BUDGET_A        0x0051u
+#define TOF_BUDGET_B        0x006Eu
+#elif TOF_BUDGET_MS == 33u
+#define TOF_BUDGET_A        0x00D6u
+#define TOF_BUDGET_B        0x006Eu
+#elif TOF_BUDGET_MS == 50u
+#define TOF_BUDGET_A        0x01AEu
+#define TOF_BUDGET_B        0x01E8u
+#elif TOF_BUDGET_MS == 100u
+#define TOF_BUDGET_A        0x02E1u
+#define TOF_BUDGET_B        0x0388u
+#elif TOF_BUDGET_MS == 200u
+#define TOF_BUDGET_A        0x03E1u
+#define TOF_BUDGET_B        0x0496u
+#elif TOF_BUDGET_MS == 500u
+#define TOF_BUDGET_A        0x0591u
+#define TOF_BUDGET_B        0x05C1u
+#else
+#error "TOF_BUDGET_MS: 15, 20, 33, 50, 100, 200 or 500 in short mode"
+#endif
+#endif
+
+_Static_assert(TOF_PERIOD_MS >= TOF_BUDGET_MS, "TOF_PERIOD_MS: a measurement must fit the period");
+_Static_assert(TOF_NOTIFY_INDEX != I2C_NOTIFY_INDEX, "TOF_NOTIFY_INDEX: I2c_Wait() blocks on its own");
+_Static_assert(TOF_NOTIFY_INDEX < configTASK_NOTIFICATION_ARRAY_ENTRIES, "TOF_NOTIFY_INDEX");
+
+/* -- Internal state ---------------------------------------------------------- */
+
+#if TOF_ENABLE
+/* 0x2D..0x87 after reset, long mode, 100 ms budget (ST VL53L1X ultra-lite driver) */
+static const uint8_t tof_default[TOF_CFG_BYTES] =
+{
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x02, 0x08, 0x00, 0x08, 0x10, 0x01, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0xFF, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x0B, 0x00, 0x00, 0x02, 0x0A, 0x21,
+    0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0xC8, 0x00, 0x00, 0x38, 0xFF, 0x01, 0x00, 0x08, 0x00,
+    0x00, 0x01, 0xCC, 0x0F, 0x01, 0xF1, 0x0D, 0x01, 0x68, 0x00, 0x80, 0x08, 0xB8, 0x00, 0x00, 0x00,
+    0x00, 0x0F, 0x89, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0F, 0x0D, 0x0E, 0x0E, 0x00,
+    0x00, 0x02, 0xC7, 0xFF, 0x9B, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00
+};
+
+/* RESULT__RANGE_STATUS -> the driver's status codes, 255 = not a result */
+static const uint8_t tof_status_map[24] =
+{
+    255, 255, 255,   5,   2,   4,   1,   7,   3,   0, 255, 255,
+      9,  13, 255, 255, 255, 255,  10,   6, 255, 255,  11,  12
+};
+#endif
+
+static TaskHandle_t      tof_task;
+static tof_stats_t       tof_stats;
+static volatile uint16_t tof_mm = TOF_NO_RANGE;
+
+/* Result ready: GPIO1 fell */
+void EIC_EXTINT_15_Handler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    IRQSTAT_ENTER(IRQSTAT_TOF);
+    EIC_REGS->EIC_INTFLAG = EIC_INTFLAG_EXTINT(TOF_LINE);
+    if (tof_task != NULL)
+        vTaskNotifyGiveIndexedFromISR(tof_task, TOF_NOTIFY_INDEX, &woken);
+    IRQSTAT_EXIT(IRQSTAT_TOF);
+    portYIELD_FROM_ISR(woken);
+}
+
+#if TOF_ENABLE
+
+static StackType_t  tof_stack[TOF_STACK];
+static StaticTask_t tof_tcb;
+
+static bool tof_i2c(const uint8_t *tx, uint16_t tx_len, uint8_t *rx, uint16_t rx_len)
+{
+    if (I2c_Transfer(TOF_ADDR, tx, tx_len, rx, rx_len, TOF_I2C_MS) == I2C_OK) return true;
+    tof_stats.i2c_errors++;
+    return false;
+}
+
+static bool tof_read(uint16_t reg, uint8_t *out, uint16_t n)
+{
+    uint8_t a[2] = { (uint8_t)(reg >> 8), (uint8_t)reg };
+
+    return tof_i2c(a, 2u, out, n);
+}
+
+static bool tof_write8(uint16_t reg, uint8_t v)
+{
+    uint8_t b[3] = { (uint8_t)(reg >> 8), (uint8_t)reg, v };
+
+    return tof_i2c(b, 3u, NULL, 0u);
+}
+
+static inline bool tof_asserted(void)
+{
+    return (PORT_REGS->GROUP[0].PORT_IN & (1u << TOF_PIN)) == 0u;
+}
+
+/* Next result: the edge, or GPIO1 found low once the wait runs out (an edge
+ * before the last clear); false if none came */
+static bool tof_wait(void)
+{
+    return ulTaskNotifyTakeIndexed(TOF_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(TOF_WAIT_MS)) != 0u ||
+           tof_asserted();
+}
+
+static void tof_put16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/* Boot, identify, one write of the whole configuration, the VHV run; ranging from then on */
+static bool tof_setup(void)
+{
+    uint8_t  cfg[2u + TOF_CFG_BYTES];
+    uint8_t  r[2];
+    uint32_t osc, period;
+    uint32_t i;
+
+    for (i = 0u; i < TOF_BOOT_TRIES; i++)
+    {
+        if (tof_read(TOF_REG_BOOT, r, 1u) && (r[0] & 0x01u) != 0u) break;
+        vTaskDelay(pdMS_TO_TICKS(2u));
+    }
+    if (i == TOF_BOOT_TRIES) return false;
+    if (!tof_read(TOF_REG_ID, r, 2u)) return false;
+    if (((uint32_t)r[0] << 8 | r[1]) != TOF_MODEL_ID)
+    {
+        static bool warned;
+
+        if (!warned) LOG_WARN("tof: 0x%02x is not a VL53L1X (id %02x%02x)", TOF_ADDR, r[0], r[1]);
+        warned = true;
+        return false;
+    }
+    if (!tof_read(TOF_REG_OSC, r, 2u)) return false;
+    osc    = ((uint32_t)r[0] << 8 | r[1]) & 0x3FFu;
+    period = osc * TOF_PERIOD_MS * 1075u / 1000u;   /* the period in oscillator ticks, +7.5 % */
+
+    tof_put16(cfg, TOF_REG_CFG);
+    memcpy(&cfg[2], tof_default, sizeof(tof_default));
+    cfg[TOF_AT(0x0030u)] |= 0x10u;                  /* GPIO1 active low */
+#if !TOF_LONG
+    cfg[TOF_AT(0x004Bu)] = 0x14u;                   /* PHASECAL_CONFIG__TIMEOUT_MACROP */
+    cfg[TOF_AT(0x0060u)] = 0x07u;                   /* RANGE_CONFIG__VCSEL_PERIOD_A    */
+    cfg[TOF_AT(0x0063u)] = 0x05u;                   /* RANGE_CONFIG__VCSEL_PERIOD_B    */
+    cfg[TOF_AT(0x0069u)] = 0x38u;                   /* RANGE_CONFIG__VALID_PHASE_HIGH  */
+    tof_put16(&cfg[TOF_AT(0x0078u)], 0x0705u);      /* SD_CONFIG__WOI_SD0 / SD1        */
+    tof_put16(&cfg[TOF_AT(0x007Au)], 0x0606u);      /* SD_CONFIG__INITIAL_PHASE_SD0 / SD1 */
+#endif
+    tof_put16(&cfg[TOF_AT(0x005Eu)], TOF_BUDGET_A);
+    tof_put16(&cfg[TOF_AT(0x0061u)], TOF_BUDGET_B);
+    tof_put16(&cfg[TOF_AT(0x006Cu)], period >> 16); /* SYSTEM__INTERMEASUREMENT_PERIOD */
+    tof_put16(&cfg[TOF_AT(0x006Eu)], period);
+    if (!tof_i2c(cfg, sizeof(cfg), NULL, 0u)) return false;
+    tof_stats.setups++;
+
+    /* First measurement calibrates the VHV; then keep its result as the start */
+    (void)ulTaskNotifyTakeIndexed(TOF_NOTIFY_INDEX, pdTRUE, 0u);
+    if (!tof_write8(TOF_REG_MODE, TOF_MODE_RANGING)) return false;
+    if (!tof_wait()) return false;
+    if (!tof_write8(TOF_REG_CLEAR, 0x01u)) return false;
+    if (!tof_write8(TOF_REG_MODE, 0x00u)) return false;
+    if (!tof_write8(TOF_REG_VHV_LOOP, 0x09u)) return false;
+    if (!tof_write8(TOF_REG_VHV_INIT, 0x00u)) return false;
+
+    (void)ulTaskNotifyTakeIndexed(TOF_NOTIFY_INDEX, pdTRUE, 0u);
+    return tof_write8(TOF_REG_CLEAR, 0x01u) && tof_write8(TOF_REG_MODE, TOF_MODE_RANGING);
+}
+
+/* One result: the block in one read, then the clear that lets GPIO1 go */
+static bool tof_result(void)
+{
+    uint8_t  b[TOF_RESULT_BYTES];
+    uint32_t st;
+    uint16_t mm;
+    bool     ok;
+
+    if (!tof_read(TOF_REG_RESULT, b, sizeof(b))) return false;
+    ok = tof_write8(TOF_REG_CLEAR, 0x01u);
+
+    st = b[0] & 0x1Fu;
+    st = (st < sizeof(tof_status_map)) ? tof_status_map[st] : st;
+    mm = (uint16_t)(b[13] << 8 | b[14]);
+
+    taskENTER_CRITICAL();
+    tof_stats.readings++;
+    if (st != 0u) tof_stats.invalid++;
+    tof_stats.mm           = mm;
+    tof_stats.status       = (uint8_t)st;
+    tof_stats.spads        = b[3];
+    tof_stats.ambient_kcps = ((uint32_t)b[7] << 8 | b[8]) * 8u;
+    tof_stats.signal_kcps  = ((uint32_t)b[15] << 8 | b[16]) * 8u;
+    taskEXIT_CRITICAL();
+    tof_mm = (st == 0u) ? mm : TOF_NO_RANGE;
+
+    EventBus_Publish(EVBUS_DISTANCE, (uint8_t)st, mm);
+    return ok;
+}
+
+static void tof_task_fn(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        if (tof_setup())
+        {
+            LOG_INFO("tof: ranging, %s mode, %u ms every %u ms",
+                     TOF_LONG ? "long" : "short", TOF_BUDGET_MS, TOF_PERIOD_MS);
+            tof_stats.ranging = true;
+            for (;;)
+            {
+                if (!tof_wait())
+                {
+                    tof_stats.missed++;
+                    break;
+                }
+                if (!tof_result()) break;
+            }
+            tof_stats.ranging = false;
+            tof_mm = TOF_NO_RANGE;
+        }
+        vTaskDelay(pdMS_TO_TICKS(TOF_RETRY_MS));
+    }
+}
+
+static void tof_hw_init(void)
+{
+    /* PA15 input, pulled up, to the EIC (peripheral A) */
+    PORT_REGS->GROUP[0].PORT_PMUX[TOF_PIN >> 1] =
+        (uint8_t)((PORT_REGS->GROUP[0].PORT_PMUX[TOF_PIN >> 1] & ~PORT_PMUX_PMUXO_Msk) | PORT_PMUX_PMUXO(0u));
+    PORT_REGS->GROUP[0].PORT_OUTSET = 1u << TOF_PIN;
+    PORT_REGS->GROUP[0].PORT_PINCFG[TOF_PIN] = PORT_PINCFG_PMUXEN_Msk | PORT_PINCFG_INEN_Msk |
+                                               PORT_PINCFG_PULLEN_Msk;
+
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_EIC_Msk;
+    EIC_REGS->EIC_CTRLA &= (uint8_t)~EIC_CTRLA_ENABLE_Msk;
+    while ((EIC_REGS->EIC_SYNCBUSY & EIC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    EIC_REGS->EIC_CTRLA |= EIC_CTRLA_CKSEL_CLK_ULP32K;
+    EIC_REGS->EIC_CONFIG[1] = (EIC_REGS->EIC_CONFIG[1] &
+                               ~(EIC_CONFIG_SENSE7_Msk | EIC_CONFIG_FILTEN7_Msk)) |
+                              EIC_CONFIG_SENSE7_FALL;
+    EIC_REGS->EIC_ASYNCH  |= EIC_ASYNCH_ASYNCH(TOF_LINE);
+    EIC_REGS->EIC_INTFLAG  = EIC_INTFLAG_EXTINT(TOF_LINE);
+    EIC_REGS->EIC_INTENSET = EIC_INTENSET_EXTINT(TOF_LINE);
+    EIC_REGS->EIC_CTRLA |= EIC_CTRLA_ENABLE_Msk;
+    while ((EIC_REGS->EIC_SYNCBUSY & EIC_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    NVIC_SetPriority(EIC_EXTINT_15_IRQn, TOF_IRQ_PRIO);
+    NVIC_ClearPendingIRQ(EIC_EXTINT_15_IRQn);
+    NVIC_EnableIRQ(EIC_EXTINT_15_IRQn);
+}
+
+#endif /* TOF_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Tof_Start(void)
+{
+#if TOF_ENABLE
+    I2c_Init();
+    tof_task = xTaskCreateStatic(tof_task_fn, "ToF", TOF_STACK, NULL, TOF_TASK_PRIO,
+                                 tof_stack, &tof_tcb);
+    tof_hw_init();
+#endif
+}
+
+uint16_t Tof_Mm(void)
+{
+    return tof_mm;
+}
+
+void Tof_GetStats(tof_stats_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = tof_stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,89 @@
+/* =============================================================================
+ * tof.h  -  VL53L1X time-of-flight distance sensor on the I2C bus
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The D-SUN on PA19 (dsun_sensor.h) says someone is there; this says how
+ * far. A VL53L1X (4 m, or 1.3 m in short mode) on the shared I2C bus
+ * (i2c_bus.h) at TOF_ADDR ranges continuously on its own timer: one
+ * measurement of TOF_BUDGET_MS every TOF_PERIOD_MS, nothing asked of the
+ * bus in between.
+ *
+ *   SDA/SCL  PA12 / PA13, the I2C bus (i2c_bus.h)
+ *   GPIO1    PA15  EXTINT[15], pull-up; the sensor pulls it low when a
+ *                  result is ready, until the interrupt is cleared
+ *
+ * Each result costs two transactions and no polling: the falling edge
+ * wakes the "ToF" task, which reads the 17-byte result block in one
+ * write-then-read (its read phase is the bus's DMA, I2C_DMA_MIN) and then
+ * clears the sensor's interrupt with one 3-byte write; without the clear
+ * the sensor holds GPIO1 low and never raises another edge. The task
+ * publishes every reading as EVBUS_DISTANCE (evbus.h): arg the range
+ * status, value the distance in mm.
+ *
+ *   status   0 valid, 1 sigma too high, 2 signal too weak, 4 out of
+ *            bounds, 7 wrap-around, others (ST's ultra-lite driver codes)
+ *
+ * Setup is one 93-byte write of ST's default configuration, with the
+ * distance mode, timing budget, inter-measurement period and interrupt
+ * polarity patched in, then the first VHV calibration run. A sensor that
+ * does not answer, or stops raising results, is set up again every
+ * TOF_RETRY_MS: it may be plugged in at any time. "tof" on the console
+ * shows the last reading and the counters.
+ *
+ * The EIC stays on the ULP32K clock, so the edge also wakes the board
+ * from tickless idle.
+ * ============================================================================= */
+
+#ifndef TOF_H
+#define TOF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef TOF_ENABLE
+#define TOF_ENABLE              0       /* 1 = a VL53L1X is on the I2C bus           */
+#endif
+#define TOF_ADDR                0x29u   /* 7-bit, the sensor's power-up address      */
+#define TOF_LONG                1       /* 1 = long mode (4 m), 0 = short (1.3 m)    */
+#define TOF_BUDGET_MS           50u     /* 20, 33, 50, 100, 200, 500; 15 short only  */
+#define TOF_PERIOD_MS           100u    /* one measurement every; >= TOF_BUDGET_MS   */
+#define TOF_RETRY_MS            1000u   /* set up again after a failure              */
+#define TOF_I2C_MS              10u     /* timeout of one transaction                */
+#define TOF_TASK_PRIO           1u
+#define TOF_NOTIFY_INDEX        1u      /* its own task: any but I2C_NOTIFY_INDEX    */
+#define TOF_IRQ_PRIO            IRQ_PRIO_TOF    /* NVIC, irqprio.h                   */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define TOF_NO_RANGE            0xFFFFu /* Tof_Mm(): no valid reading                */
+
+typedef struct
+{
+    uint32_t readings;          /* results read                              */
+    uint32_t invalid;           /* of them, status not 0                     */
+    uint32_t missed;            /* no result within the period: set up again */
+    uint32_t i2c_errors;        /* transactions that failed                  */
+    uint32_t setups;            /* configurations written                    */
+    uint32_t signal_kcps;       /* last reading's return signal rate, kcps   */
+    uint32_t ambient_kcps;      /* its ambient rate, kcps                    */
+    uint16_t mm;                /* its distance                              */
+    uint8_t  status;            /* its range status                          */
+    uint8_t  spads;             /* SPADs it used                             */
+    bool     ranging;           /* set up and producing results              */
+} tof_stats_t;
+
+/**
+ * The I2C bus (I2c_Init()), GPIO1's pin and EIC line, and the task that
+ * sets the sensor up and reads it. Before the scheduler. Does nothing
+ * unless TOF_ENABLE.
+ */
+void Tof_Start(void);
+
+/** Last valid distance in mm, TOF_NO_RANGE if the last reading was not. Any context. */
+uint16_t Tof_Mm(void);
+
+/** Counters and the last reading. Any task. */
+void Tof_GetStats(tof_stats_t *out);
+
+#endif /* TOF_H */
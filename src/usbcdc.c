@@ -0,0 +1,557 @@
+/* =============================================================================
+ * usbcdc.c  -  USB CDC-ACM device: a fast second port for the shell and telemetry
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "usbcdc.h"
+#include "definitions.h"        /* USB, OSCCTRL, GCLK, __ALIGNED */
+#include "task.h"
+#include "tickless.h"
+#include "irqstat.h"
+#include "dmaram.h"             /* the USB master reads the descriptors and buffers */
+#include <string.h>
+
+#define USB_EP_SIZE         64u
+#define USB_EP_SIZE_CODE    3u                  /* PCKSIZE.SIZE for 64 bytes */
+#define USB_EPS             3u                  /* 0 control, 1 data, 2 notify */
+#define USB_EP_DATA         1u
+#define USB_EP_NOTIFY       2u
+#define USB_EP_OUT          0u                  /* descriptor bank 0 */
+#define USB_EP_IN           1u                  /* descriptor bank 1 */
+#define USB_EP0_BUF         128u                /* longest descriptor, the configuration */
+
+#define USB_DFLL_MUL        48000u              /* 48 MHz / 1 kHz SOF */
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static volatile uint32_t usb_rx_overruns;
+
+#if USBCDC_ENABLE
+
+static usb_descriptor_device_registers_t usb_eps[USB_EPS] DMA_RAM __ALIGNED(4);
+static uint8_t usb_ep0_out[USB_EP_SIZE]  DMA_RAM __ALIGNED(4);
+static uint8_t usb_ep0_in[USB_EP0_BUF]   DMA_RAM __ALIGNED(4);
+static uint8_t usb_rx_buf[USB_EP_SIZE]   DMA_RAM __ALIGNED(4);
+
+/* TX double buffer: writers fill usb_tx[usb_tx_fill], the other may be on the bus */
+static uint8_t           usb_tx[2][USBCDC_TX_BUF] DMA_RAM __ALIGNED(4);
+static volatile uint32_t usb_tx_len[2];
+static volatile uint8_t  usb_tx_fill;
+static volatile bool     usb_tx_busy;
+
+static volatile uint8_t  usb_config;            /* SET_CONFIGURATION value, 0 = none */
+static volatile bool     usb_dtr;
+static volatile bool     usb_suspended;
+static uint8_t           usb_address;           /* applied after SET_ADDRESS's status stage */
+static bool              usb_ep0_data_out;      /* SET_LINE_CODING data stage pending */
+static uint8_t           usb_line_coding[7] = { 0x00, 0xC2, 0x01, 0x00, 0u, 0u, 8u };  /* 115200 8N1 */
+
+static StreamBufferHandle_t usb_rx_stream = NULL;
+static StaticStreamBuffer_t usb_rx_stream_buf;
+static uint8_t              usb_rx_stream_store[USBCDC_RX_STREAM + 1u];
+
+/* -- Descriptors ------------------------------------------------------------- */
+
+static const uint8_t usb_device_desc[18] =
+{
+    18u, 1u, 0x00u, 0x02u,                      /* USB 2.0 */
+    0x02u, 0x00u, 0x00u, USB_EP_SIZE,           /* CDC class at device level */
+    (uint8_t)USBCDC_VID, (uint8_t)(USBCDC_VID >> 8), (uint8_t)USBCDC_PID, (uint8_t)(USBCDC_PID >> 8),
+    0x00u, 0x01u, 1u, 2u, 3u, 1u                /* bcdDevice 1.00, strings, one configuration */
+};
+
+#define USB_CONFIG_LEN      67u
+
+static const uint8_t usb_config_desc[USB_CONFIG_LEN] =
+{
+    9u, 2u, USB_CONFIG_LEN, 0u, 2u, 1u, 0u, 0xC0u, 50u,     /* self powered, 100 mA */
+
+    /* Interface 0: communication class, ACM */
+    9u, 4u, 0u, 0u, 1u, 0x02u, 0x02u, 0x00u, 0u,
+    5u, 0x24u, 0x00u, 0x10u, 0x01u,                         /* header, CDC 1.10           */
+    5u, 0x24u, 0x01u, 0x00u, 1u,                            /* call management, data if 1 */
+    4u, 0x24u, 0x02u, 0x02u,                                /* ACM: line coding + state   */
+    5u, 0x24u, 0x06u, 0u, 1u,                               /* union: 0 controls 1        */
+    7u, 5u, 0x80u | USB_EP_NOTIFY, 0x03u, 8u, 0u, 16u,      /* interrupt IN, 16 ms        */
+
+    /* Interface 1: data class, bulk OUT + IN */
+    9u, 4u, 1u, 0u, 2u, 0x0Au, 0x00u, 0x00u, 0u,
+    7u, 5u, USB_EP_DATA, 0x02u, USB_EP_SIZE, 0u, 0u,
+    7u, 5u, 0x80u | USB_EP_DATA, 0x02u, USB_EP_SIZE, 0u, 0u,
+};
+
+static const char *const usb_strings[] = { "Coffin Reborn", "Coffin prop" };
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+#define USB_EP(n)           (USB_REGS->DEVICE.DEVICE_ENDPOINT[n])
+
+/* Send n bytes of buf on endpoint ep's IN bank as one transfer, packets by the USB's own DMA */
+static void usb_in(uint8_t ep, const uint8_t *buf, uint32_t n, bool zlp)
+{
+    usb_eps[ep].DEVICE_DESC_BANK[USB_EP_IN].USB_ADDR    = (uint32_t)buf;
+    usb_eps[ep].DEVICE_DESC_BANK[USB_EP_IN].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_EP_SIZE_CODE) |
+                                                          USB_DEVICE_PCKSIZE_BYTE_COUNT(n) |
+                                                          USB_DEVICE_PCKSIZE_AUTO_ZLP(zlp ? 1u : 0u);
+    USB_EP(ep).USB_EPSTATUSSET = USB_DEVICE_EPSTATUSSET_BK1RDY_Msk;
+}
+
+/* Take the next OUT packet on endpoint ep into buf */
+static void usb_out(uint8_t ep, uint8_t *buf)
+{
+    usb_eps[ep].DEVICE_DESC_BANK[USB_EP_OUT].USB_ADDR    = (uint32_t)buf;
+    usb_eps[ep].DEVICE_DESC_BANK[USB_EP_OUT].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_EP_SIZE_CODE);
+    USB_EP(ep).USB_EPSTATUSCLR = USB_DEVICE_EPSTATUSCLR_BK0RDY_Msk;
+}
+
+/* Start the filled TX buffer if the bus is free; the writers switch to the other */
+static void usb_tx_kick(void)
+{
+    uint8_t  b = usb_tx_fill;
+    uint32_t n = usb_tx_len[b];
+
+    if (usb_tx_busy || n == 0u) return;
+    usb_tx_fill        = b ^ 1u;
+    usb_tx_len[b ^ 1u] = 0u;
+    usb_tx_busy        = true;
+    usb_in(USB_EP_DATA, usb_tx[b], n, true);    /* ZLP ends a transfer of whole packets */
+}
+
+/* Append up to count bytes; all-or-nothing when whole. Bytes taken */
+static size_t usb_tx_put(const uint8_t *data, size_t count, bool whole)
+{
+    size_t n = 0u;
+
+    taskENTER_CRITICAL();                       /* masks the USB interrupt: a few us per KB */
+    if (usb_config != 0u && usb_dtr && !usb_suspended)
+    {
+        uint8_t  b    = usb_tx_fill;
+        uint32_t room = USBCDC_TX_BUF - usb_tx_len[b];
+
+        n = (count <= room) ? count : (whole ? 0u : room);
+        memcpy(&usb_tx[b][usb_tx_len[b]], data, n);
+        usb_tx_len[b] += n;
+        usb_tx_kick();
+    }
+    taskEXIT_CRITICAL();
+    return n;
+}
+
+static void usb_stall_ep0(void)
+{
+    USB_EP(0).USB_EPSTATUSSET = USB_DEVICE_EPSTATUSSET_STALLRQ0_Msk | USB_DEVICE_EPSTATUSSET_STALLRQ1_Msk;
+}
+
+/* Data stage of a device-to-host request, cut to what the host asked for */
+static void usb_ep0_reply(const uint8_t *data, uint32_t n, uint16_t wlength)
+{
+    if (n > wlength) n = wlength;
+    if (n > USB_EP0_BUF) n = USB_EP0_BUF;
+    memcpy(usb_ep0_in, data, n);
+    usb_in(0u, usb_ep0_in, n, n < wlength);     /* short of wLength: end with a ZLP if whole */
+}
+
+static void usb_ep0_status(void)
+{
+    usb_in(0u, usb_ep0_in, 0u, false);
+}
+
+/* String descriptor: 0 the language, 1.. usb_strings[], 3 the chip serial number */
+static bool usb_string(uint8_t index, uint16_t wlength)
+{
+    uint8_t d[2u + 2u * 16u];
+    char    serial[9];
+    const char *s;
+    uint32_t n = 0u;
+
+    if (index == 0u)
+    {
+        static const uint8_t lang[4] = { 4u, 3u, 0x09u, 0x04u };    /* en-US */
+
+        usb_ep0_reply(lang, sizeof(lang), wlength);
+        return true;
+    }
+    if (index == 3u)
+    {
+        uint32_t h = *(const volatile uint32_t *)0x008061FCu ^ *(const volatile uint32_t *)0x00806010u ^
+                     *(const volatile uint32_t *)0x00806014u ^ *(const volatile uint32_t *)0x00806018u;
+
+        for (uint32_t i = 0; i < 8u; i++)
+            serial[i] = "0123456789ABCDEF"[(h >> (28u - 4u * i)) & 0xFu];
+        serial[8] = '\0';
+        s = serial;
+    }
+    else if (index <= sizeof(usb_strings) / sizeof(usb_strings[0]))
+        s = usb_strings[index - 1u];
+    else
+        return false;
+
+    for (; s[n] != '\0' && n < 16u; n++)
+    {
+        d[2u + 2u * n] = (uint8_t)s[n];
+        d[3u + 2u * n] = 0u;
+    }
+    d[0] = (uint8_t)(2u + 2u * n);
+    d[1] = 3u;
+    usb_ep0_reply(d, d[0], wlength);
+    return true;
+}
+
+static void usb_configure(uint8_t config)
+{
+    usb_config = config;
+    usb_dtr    = false;
+    if (config == 0u)
+    {
+        USB_EP(USB_EP_DATA).USB_EPCFG   = 0u;
+        USB_EP(USB_EP_NOTIFY).USB_EPCFG = 0u;
+        return;
+    }
+    USB_EP(USB_EP_DATA).USB_EPCFG   = USB_DEVICE_EPCFG_EPTYPE0(3u) | USB_DEVICE_EPCFG_EPTYPE1(3u);   /* bulk */
+    USB_EP(USB_EP_NOTIFY).USB_EPCFG = USB_DEVICE_EPCFG_EPTYPE1(4u);                                 /* interrupt */
+    USB_EP(USB_EP_DATA).USB_EPSTATUSCLR = USB_DEVICE_EPSTATUSCLR_DTGLOUT_Msk | USB_DEVICE_EPSTATUSCLR_DTGLIN_Msk |
+                                          USB_DEVICE_EPSTATUSCLR_STALLRQ0_Msk | USB_DEVICE_EPSTATUSCLR_STALLRQ1_Msk;
+    USB_EP(USB_EP_DATA).USB_EPINTENSET = USB_DEVICE_EPINTENSET_TRCPT0_Msk | USB_DEVICE_EPINTENSET_TRCPT1_Msk;
+    usb_tx_len[0] = usb_tx_len[1] = 0u;
+    usb_tx_busy   = false;
+    usb_out(USB_EP_DATA, usb_rx_buf);
+}
+
+/* Standard and CDC class requests on the control endpoint */
+static void usb_setup(void)
+{
+    const uint8_t *s       = usb_ep0_out;
+    uint8_t        type    = s[0];
+    uint8_t        req     = s[1];
+    uint16_t       wvalue  = (uint16_t)(s[2] | (s[3] << 8));
+    uint16_t       wlength = (uint16_t)(s[6] | (s[7] << 8));
+    uint8_t        two[2]  = { 0u, 0u };
+
+    usb_ep0_data_out = false;
+    if ((type & 0x60u) == 0x20u)                /* class, CDC-ACM */
+    {
+        switch (req)
+        {
+        case 0x20u:                             /* SET_LINE_CODING: 7 bytes follow */
+            usb_ep0_data_out = true;
+            return;
+        case 0x21u:                             /* GET_LINE_CODING */
+            usb_ep0_reply(usb_line_coding, sizeof(usb_line_coding), wlength);
+            return;
+        case 0x22u:                             /* SET_CONTROL_LINE_STATE */
+            usb_dtr = (wvalue & 1u) != 0u;
+            usb_ep0_status();
+            return;
+        case 0x23u:                             /* SEND_BREAK */
+            usb_ep0_status();
+            return;
+        default:
+            usb_stall_ep0();
+            return;
+        }
+    }
+    if ((type & 0x60u) != 0u)
+    {
+        usb_stall_ep0();
+        return;
+    }
+
+    switch (req)
+    {
+    case 0u:                                    /* GET_STATUS */
+        if ((type & 0x1Fu) == 0u) two[0] = 1u;  /* self powered */
+        usb_ep0_reply(two, 2u, wlength);
+        break;
+    case 1u:                                    /* CLEAR_FEATURE: endpoint halt */
+        if ((type & 0x1Fu) == 2u && (s[4] & 0x0Fu) == USB_EP_DATA)
+            USB_EP(USB_EP_DATA).USB_EPSTATUSCLR = (s[4] & 0x80u) ?
+                (USB_DEVICE_EPSTATUSCLR_STALLRQ1_Msk | USB_DEVICE_EPSTATUSCLR_DTGLIN_Msk) :
+                (USB_DEVICE_EPSTATUSCLR_STALLRQ0_Msk | USB_DEVICE_EPSTATUSCLR_DTGLOUT_Msk);
+        usb_ep0_status();
+        break;
+    case 3u:                                    /* SET_FEATURE: accepted, nothing to do */
+        usb_ep0_status();
+        break;
+    case 5u:                                    /* SET_ADDRESS */
+        usb_address = (uint8_t)(wvalue & 0x7Fu);
+        usb_ep0_status();
+        break;
+    case 6u:                                    /* GET_DESCRIPTOR */
+        switch (wvalue >> 8)
+        {
+        case 1u: usb_ep0_reply(usb_device_desc, sizeof(usb_device_desc), wlength); break;
+        case 2u: usb_ep0_reply(usb_config_desc, sizeof(usb_config_desc), wlength); break;
+        case 3u: if (!usb_string((uint8_t)wvalue, wlength)) usb_stall_ep0();      break;
+        default: usb_stall_ep0();                                                  break;
+        }
+        break;
+    case 8u:                                    /* GET_CONFIGURATION */
+        two[0] = usb_config;
+        usb_ep0_reply(two, 1u, wlength);
+        break;
+    case 9u:                                    /* SET_CONFIGURATION */
+        if (wvalue > 1u)
+        {
+            usb_stall_ep0();
+            break;
+        }
+        usb_configure((uint8_t)wvalue);
+        usb_ep0_status();
+        break;
+    case 10u:                                   /* GET_INTERFACE */
+        usb_ep0_reply(two, 1u, wlength);
+        break;
+    case 11u:                                   /* SET_INTERFACE: one setting each */
+        usb_ep0_status();
+        break;
+    default:
+        usb_stall_ep0();
+        break;
+    }
+}
+
+/* Bus reset: address 0, control endpoint only */
+static void usb_reset(void)
+{
+    USB_REGS->DEVICE.USB_DADD = 0u;
+    usb_address = 0u;
+    usb_configure(0u);
+    usb_suspended = false;
+
+    USB_EP(0).USB_EPCFG = USB_DEVICE_EPCFG_EPTYPE0(1u) | USB_DEVICE_EPCFG_EPTYPE1(1u);     /* control */
+    usb_eps[0].DEVICE_DESC_BANK[USB_EP_IN].USB_ADDR = (uint32_t)usb_ep0_in;
+    usb_out(0u, usb_ep0_out);
+    USB_EP(0).USB_EPINTENSET = USB_DEVICE_EPINTENSET_RXSTP_Msk | USB_DEVICE_EPINTENSET_TRCPT0_Msk |
+                               USB_DEVICE_EPINTENSET_TRCPT1_Msk;
+}
+
+static void usb_ep0_isr(void)
+{
+    uint8_t f = USB_EP(0).USB_EPINTFLAG;
+
+    if ((f & USB_DEVICE_EPINTFLAG_RXSTP_Msk) != 0u)
+    {
+        USB_EP(0).USB_EPINTFLAG   = USB_DEVICE_EPINTFLAG_RXSTP_Msk | USB_DEVICE_EPINTFLAG_TRCPT0_Msk |
+                                    USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+        USB_EP(0).USB_EPSTATUSCLR = USB_DEVICE_EPSTATUSCLR_STALLRQ0_Msk | USB_DEVICE_EPSTATUSCLR_STALLRQ1_Msk;
+        usb_setup();
+        usb_out(0u, usb_ep0_out);               /* the data or status stage OUT */
+        return;
+    }
+    if ((f & USB_DEVICE_EPINTFLAG_TRCPT0_Msk) != 0u)
+    {
+        USB_EP(0).USB_EPINTFLAG = USB_DEVICE_EPINTFLAG_TRCPT0_Msk;
+        if (usb_ep0_data_out)
+        {
+            usb_ep0_data_out = false;
+            memcpy(usb_line_coding, usb_ep0_out, sizeof(usb_line_coding));
+            usb_ep0_status();
+        }
+        usb_out(0u, usb_ep0_out);
+    }
+    if ((f & USB_DEVICE_EPINTFLAG_TRCPT1_Msk) != 0u)
+    {
+        USB_EP(0).USB_EPINTFLAG = USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+        if (usb_address != 0u && (USB_REGS->DEVICE.USB_DADD & USB_DEVICE_DADD_ADDEN_Msk) == 0u)
+            USB_REGS->DEVICE.USB_DADD = USB_DEVICE_DADD_ADDEN_Msk | USB_DEVICE_DADD_DADD(usb_address);
+    }
+}
+
+static void usb_data_isr(BaseType_t *woken)
+{
+    uint8_t f = USB_EP(USB_EP_DATA).USB_EPINTFLAG;
+
+    if ((f & USB_DEVICE_EPINTFLAG_TRCPT0_Msk) != 0u)
+    {
+        uint32_t n = usb_eps[USB_EP_DATA].DEVICE_DESC_BANK[USB_EP_OUT].USB_PCKSIZE & USB_DEVICE_PCKSIZE_BYTE_COUNT_Msk;
+
+        USB_EP(USB_EP_DATA).USB_EPINTFLAG = USB_DEVICE_EPINTFLAG_TRCPT0_Msk;
+        if (xStreamBufferSendFromISR(usb_rx_stream, usb_rx_buf, n, woken) < n) usb_rx_overruns++;
+        usb_out(USB_EP_DATA, usb_rx_buf);
+    }
+    if ((f & USB_DEVICE_EPINTFLAG_TRCPT1_Msk) != 0u)
+    {
+        USB_EP(USB_EP_DATA).USB_EPINTFLAG = USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+        usb_tx_busy = false;
+        usb_tx_kick();                          /* the buffer filled meanwhile */
+    }
+}
+
+/* One handler for all four USB vectors */
+static void usb_isr(void)
+{
+    BaseType_t woken = pdFALSE;
+    uint16_t   f     = USB_REGS->DEVICE.USB_INTFLAG & USB_REGS->DEVICE.USB_INTENSET;
+    uint16_t   eps;
+
+    IRQSTAT_ENTER(IRQSTAT_USB);
+    if ((f & USB_DEVICE_INTFLAG_EORST_Msk) != 0u)
+    {
+        USB_REGS->DEVICE.USB_INTFLAG = USB_DEVICE_INTFLAG_EORST_Msk;
+        usb_reset();
+    }
+    if ((f & USB_DEVICE_INTFLAG_SUSPEND_Msk) != 0u)
+    {
+        /* Asleep (or unplugged) until WAKEUP: writes are refused meanwhile */
+        USB_REGS->DEVICE.USB_INTFLAG   = USB_DEVICE_INTFLAG_SUSPEND_Msk | USB_DEVICE_INTFLAG_WAKEUP_Msk;
+        USB_REGS->DEVICE.USB_INTENCLR  = USB_DEVICE_INTFLAG_SUSPEND_Msk;
+        USB_REGS->DEVICE.USB_INTENSET  = USB_DEVICE_INTFLAG_WAKEUP_Msk;
+        usb_suspended = true;
+    }
+    else if ((f & (USB_DEVICE_INTFLAG_WAKEUP_Msk | USB_DEVICE_INTFLAG_EORSM_Msk)) != 0u)
+    {
+        USB_REGS->DEVICE.USB_INTFLAG   = USB_DEVICE_INTFLAG_WAKEUP_Msk | USB_DEVICE_INTFLAG_EORSM_Msk;
+        USB_REGS->DEVICE.USB_INTENCLR  = USB_DEVICE_INTFLAG_WAKEUP_Msk;
+        USB_REGS->DEVICE.USB_INTENSET  = USB_DEVICE_INTFLAG_SUSPEND_Msk;
+        usb_suspended = false;
+    }
+
+    eps = USB_REGS->DEVICE.USB_EPINTSMRY;
+    if ((eps & (1u << 0)) != 0u) usb_ep0_isr();
+    if ((eps & (1u << USB_EP_DATA)) != 0u) usb_data_isr(&woken);
+    if ((eps & (1u << USB_EP_NOTIFY)) != 0u) USB_EP(USB_EP_NOTIFY).USB_EPINTFLAG = 0xFFu;
+    IRQSTAT_EXIT(IRQSTAT_USB);
+    portYIELD_FROM_ISR(woken);
+}
+
+void USB_OTHER_Handler(void)    { usb_isr(); }
+void USB_SOF_HSOF_Handler(void) { usb_isr(); }
+void USB_TRCPT0_Handler(void)   { usb_isr(); }
+void USB_TRCPT1_Handler(void)   { usb_isr(); }
+
+/* Standby stops the USB clock: not while a host has us configured */
+static bool usb_tickless_veto(void)
+{
+    return usb_config != 0u && !usb_suspended;
+}
+
+/* 48 MHz from the DFLL, closed loop on the host's SOF */
+static void usb_clock_init(void)
+{
+    OSCCTRL_REGS->OSCCTRL_DFLLMUL = OSCCTRL_DFLLMUL_MUL(USB_DFLL_MUL) |
+                                    OSCCTRL_DFLLMUL_CSTEP(1u) | OSCCTRL_DFLLMUL_FSTEP(1u);
+    while ((OSCCTRL_REGS->OSCCTRL_DFLLSYNC & OSCCTRL_DFLLSYNC_DFLLMUL_Msk) != 0u) {}
+    OSCCTRL_REGS->OSCCTRL_DFLLCTRLB = OSCCTRL_DFLLCTRLB_MODE_Msk | OSCCTRL_DFLLCTRLB_USBCRM_Msk |
+                                      OSCCTRL_DFLLCTRLB_CCDIS_Msk;
+    while ((OSCCTRL_REGS->OSCCTRL_DFLLSYNC & OSCCTRL_DFLLSYNC_DFLLCTRLB_Msk) != 0u) {}
+
+    GCLK_REGS->GCLK_GENCTRL[4] = GCLK_GENCTRL_DIV(1U) | GCLK_GENCTRL_SRC(6U) | GCLK_GENCTRL_GENEN_Msk;
+    while ((GCLK_REGS->GCLK_SYNCBUSY & GCLK_SYNCBUSY_GENCTRL_GCLK4) == GCLK_SYNCBUSY_GENCTRL_GCLK4) {}
+    GCLK_REGS->GCLK_PCHCTRL[USB_GCLK_ID] = GCLK_PCHCTRL_GEN_GCLK4 | GCLK_PCHCTRL_CHEN_Msk;
+    while ((GCLK_REGS->GCLK_PCHCTRL[USB_GCLK_ID] & GCLK_PCHCTRL_CHEN_Msk) == 0u) {}
+
+    MCLK_REGS->MCLK_AHBMASK  |= MCLK_AHBMASK_USB_Msk;
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_USB_Msk;
+}
+
+static void usb_hw_init(void)
+{
+    uint32_t cal    = SW0_FUSES_REGS->FUSES_SW0_WORD_1;
+    uint32_t transn = (cal & FUSES_SW0_WORD_1_USB_TRANSN_Msk) >> FUSES_SW0_WORD_1_USB_TRANSN_Pos;
+    uint32_t transp = (cal & FUSES_SW0_WORD_1_USB_TRANSP_Msk) >> FUSES_SW0_WORD_1_USB_TRANSP_Pos;
+    uint32_t trim   = (cal & FUSES_SW0_WORD_1_USB_TRIM_Msk) >> FUSES_SW0_WORD_1_USB_TRIM_Pos;
+
+    usb_clock_init();
+
+    /* PA24 D-, PA25 D+ -> peripheral H */
+    PORT_REGS->GROUP[0].PORT_PMUX[24u >> 1] = PORT_PMUX_PMUXE(7u) | PORT_PMUX_PMUXO(7u);
+    PORT_REGS->GROUP[0].PORT_PINCFG[24] = PORT_PINCFG_PMUXEN_Msk;
+    PORT_REGS->GROUP[0].PORT_PINCFG[25] = PORT_PINCFG_PMUXEN_Msk;
+
+    USB_REGS->DEVICE.USB_CTRLA = USB_CTRLA_SWRST_Msk;
+    while ((USB_REGS->DEVICE.USB_SYNCBUSY & USB_SYNCBUSY_SWRST_Msk) != 0u) {}
+
+    /* Factory pad calibration; an erased fuse gets the datasheet defaults */
+    USB_REGS->DEVICE.USB_PADCAL = (uint16_t)(USB_PADCAL_TRANSN((transn == 0x1Fu) ? 9u : transn) |
+                                             USB_PADCAL_TRANSP((transp == 0x1Fu) ? 25u : transp) |
+                                             USB_PADCAL_TRIM((trim == 0x7u) ? 6u : trim));
+
+    memset(usb_eps, 0, sizeof(usb_eps));
+    USB_REGS->DEVICE.USB_DESCADD = (uint32_t)usb_eps;
+    USB_REGS->DEVICE.USB_CTRLB   = USB_DEVICE_CTRLB_SPDCONF_FS | USB_DEVICE_CTRLB_DETACH_Msk;
+    USB_REGS->DEVICE.USB_CTRLA   = USB_CTRLA_MODE_DEVICE | USB_CTRLA_ENABLE_Msk;
+    while ((USB_REGS->DEVICE.USB_SYNCBUSY & USB_SYNCBUSY_ENABLE_Msk) != 0u) {}
+
+    USB_REGS->DEVICE.USB_INTENSET = USB_DEVICE_INTFLAG_EORST_Msk | USB_DEVICE_INTFLAG_SUSPEND_Msk;
+    NVIC_SetPriority(USB_OTHER_IRQn,  USBCDC_IRQ_PRIO);
+    NVIC_SetPriority(USB_TRCPT0_IRQn, USBCDC_IRQ_PRIO);
+    NVIC_SetPriority(USB_TRCPT1_IRQn, USBCDC_IRQ_PRIO);
+    NVIC_EnableIRQ(USB_OTHER_IRQn);
+    NVIC_EnableIRQ(USB_TRCPT0_IRQn);
+    NVIC_EnableIRQ(USB_TRCPT1_IRQn);
+
+    USB_REGS->DEVICE.USB_CTRLB &= (uint16_t)~USB_DEVICE_CTRLB_DETACH_Msk;   /* D+ pull-up: the host sees us */
+}
+
+#endif /* USBCDC_ENABLE */
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void UsbCdc_Start(void)
+{
+#if USBCDC_ENABLE
+    usb_rx_stream = xStreamBufferCreateStatic(USBCDC_RX_STREAM, 1u, usb_rx_stream_store, &usb_rx_stream_buf);
+    (void)Tickless_RegisterVeto(usb_tickless_veto);
+    usb_hw_init();
+#endif
+}
+
+bool UsbCdc_Connected(void)
+{
+#if USBCDC_ENABLE
+    return usb_config != 0u && usb_dtr && !usb_suspended;
+#else
+    return false;
+#endif
+}
+
+bool UsbCdc_TryWrite(const void *data, size_t count)
+{
+#if USBCDC_ENABLE
+    return count != 0u && usb_tx_put((const uint8_t *)data, count, true) == count;
+#else
+    (void)data;
+    (void)count;
+    return false;
+#endif
+}
+
+size_t UsbCdc_Write(const void *data, size_t count)
+{
+#if USBCDC_ENABLE
+    const uint8_t *p    = (const uint8_t *)data;
+    size_t         done = 0u;
+    TickType_t     t0   = xTaskGetTickCount();
+
+    while (done < count && UsbCdc_Connected())
+    {
+        size_t n = usb_tx_put(&p[done], count - done, false);
+
+        done += n;
+        if (n == 0u)
+        {
+            if ((xTaskGetTickCount() - t0) >= pdMS_TO_TICKS(USBCDC_WRITE_MS)) break;
+            vTaskDelay(1u);
+        }
+    }
+    return done;
+#else
+    (void)data;
+    (void)count;
+    return 0u;
+#endif
+}
+
+StreamBufferHandle_t UsbCdc_RxStream(void)
+{
+#if USBCDC_ENABLE
+    return usb_rx_stream;
+#else
+    return NULL;
+#endif
+}
+
+uint32_t UsbCdc_RxOverruns(void)
+{
+    return usb_rx_overruns;
+}
@@ -0,0 +1,83 @@
+/* =============================================================================
+ * usbcdc.h  -  USB CDC-ACM device: a fast second port for the shell and telemetry
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The console (SERCOM5) tops out near 11 KB/s, which a full telemetry
+ * sample at 50 Hz already fills. The native USB port (PA24 D-, PA25 D+,
+ * peripheral H) enumerates as a full-speed CDC-ACM serial port (a virtual
+ * COM port with the OS's own driver) and gives the host the same CLI and
+ * telemetry at USB speed, plus rendered-frame capture (telem.h), which
+ * only fits here.
+ *
+ *   Clock   USB needs 48 MHz within 0.25 %: GCLK4 from the DFLL, which is
+ *           switched to USB clock recovery and trims itself on the host's
+ *           1 ms start-of-frame. GCLK2 (1 MHz, the DPLL reference) is cut
+ *           from the same DFLL, so once a host is attached the 120 MHz core
+ *           clock tracks the host's crystal too; it stays within the
+ *           DFLL's open-loop accuracy when none is.
+ *   Data    Bulk IN and OUT on endpoint 1 (64-byte packets), an interrupt
+ *           endpoint 2 the ACM class requires but nothing is sent on.
+ *           The USB controller moves every packet to and from RAM as a bus
+ *           master of its own, the CPU only sets up whole transfers: a
+ *           transfer of up to USBCDC_TX_BUF bytes goes out as back-to-back
+ *           packets with one interrupt at the end.
+ *   TX      Two buffers: writers append to one while the other is on the
+ *           bus, and the transfer-complete interrupt swaps them, so a
+ *           write never waits for the host to poll and the bus gets whole
+ *           buffers, not one write at a time.
+ *   RX      Each OUT packet goes into a stream buffer (UsbCdc_RxStream()),
+ *           read by the second CLI task like STDIO_RxStream().
+ *
+ * The port is "open" (UsbCdc_Connected()) while the host has DTR up, i.e.
+ * a terminal or tools/telem_decode.py holds it; writes are refused when it
+ * is not, so nothing piles up for a port nobody reads.
+ * ============================================================================= */
+
+#ifndef USBCDC_H
+#define USBCDC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+#include "irqprio.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define USBCDC_ENABLE           0       /* 1 = the USB connector is fitted         */
+#define USBCDC_VID              0x04D8u /* Microchip                               */
+#define USBCDC_PID              0x000Au /* generic CDC RS-232 emulation            */
+#define USBCDC_TX_BUF           2048u   /* bytes per TX buffer, two of them        */
+#define USBCDC_RX_STREAM        256u    /* bytes waiting for the CLI               */
+#define USBCDC_WRITE_MS         50u     /* UsbCdc_Write(): longest wait for room   */
+#define USBCDC_IRQ_PRIO         IRQ_PRIO_USB        /* NVIC, irqprio.h         */
+
+/**
+ * Clock the USB from the DFLL in recovery mode, set up the pins and the
+ * endpoint table and attach to the bus. Before the scheduler. Does nothing
+ * unless USBCDC_ENABLE.
+ */
+void UsbCdc_Start(void);
+
+/** True while the host is configured and holds the port open (DTR). Any task. */
+bool UsbCdc_Connected(void);
+
+/**
+ * Queue `count` bytes whole or not at all; never blocks. False if the port
+ * is not open or the fill buffer has no room. Any task.
+ */
+bool UsbCdc_TryWrite(const void *data, size_t count);
+
+/**
+ * Queue `count` bytes, waiting up to USBCDC_WRITE_MS in all for room; the
+ * rest is dropped. Bytes queued. Tasks only.
+ */
+size_t UsbCdc_Write(const void *data, size_t count);
+
+/** Bytes from the host; NULL unless USBCDC_ENABLE. Read by one task only. */
+StreamBufferHandle_t UsbCdc_RxStream(void);
+
+/** OUT packets dropped because the RX stream was full. Any task. */
+uint32_t UsbCdc_RxOverruns(void);
+
+#endif /* USBCDC_H */
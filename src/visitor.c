@@ -0,0 +1,103 @@
+/* =============================================================================
+ * visitor.c  -  Direction of travel from the order of sensor-array edges
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "visitor.h"
+#include <stdbool.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static const visitor_sensor_t visitor_sensors[] = VISITOR_SENSORS;
+
+#define VISITOR_SENSOR_COUNT    (sizeof(visitor_sensors) / sizeof(visitor_sensors[0]))
+
+typedef struct
+{
+    uint32_t time;          /* show clock, us */
+    uint8_t  sensor;        /* index into visitor_sensors */
+} visitor_arrival_t;
+
+static visitor_arrival_t visitor_hist[VISITOR_HISTORY];
+static uint8_t           visitor_head;          /* next slot to write */
+static uint8_t           visitor_count;
+static visitor_dir_t     visitor_last;          /* last class reported ... */
+static uint32_t          visitor_last_time;     /* ... and when */
+
+static const char *const visitor_names[VISITOR_DIR_COUNT] =
+{
+    "none", "approach", "pass-by", "retreat"
+};
+
+/* Compare one arrival with the newest arrival at another sensor, then keep it */
+static visitor_dir_t visitor_arrival(uint8_t s, uint32_t t)
+{
+    visitor_dir_t dir = VISITOR_NONE;
+
+    /* Arrivals older than the window belong to an earlier visitor */
+    while (visitor_count > 0u)
+    {
+        uint8_t oldest = (uint8_t)((visitor_head + VISITOR_HISTORY - visitor_count) % VISITOR_HISTORY);
+        if (t - visitor_hist[oldest].time <= VISITOR_WINDOW_US) break;
+        visitor_count--;
+    }
+
+    for (uint8_t n = 1; n <= visitor_count; n++)
+    {
+        const visitor_arrival_t *a = &visitor_hist[(visitor_head + VISITOR_HISTORY - n) % VISITOR_HISTORY];
+        uint8_t from, to;
+
+        if (a->sensor == s) continue;
+        from = visitor_sensors[a->sensor].depth;
+        to   = visitor_sensors[s].depth;
+        dir  = (to > from) ? VISITOR_APPROACH : (to < from) ? VISITOR_RETREAT : VISITOR_PASS_BY;
+        break;
+    }
+
+    visitor_hist[visitor_head].time   = t;
+    visitor_hist[visitor_head].sensor = s;
+    visitor_head = (uint8_t)((visitor_head + 1u) % VISITOR_HISTORY);
+    if (visitor_count < VISITOR_HISTORY) visitor_count++;
+
+    /* Once per window per class: later rows of the same walk stay quiet */
+    if (dir != VISITOR_NONE)
+    {
+        if ((dir == visitor_last) && (t - visitor_last_time <= VISITOR_WINDOW_US))
+        {
+            visitor_last_time = t;
+            return VISITOR_NONE;
+        }
+        visitor_last      = dir;
+        visitor_last_time = t;
+    }
+    return dir;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Visitor_Init(void)
+{
+    visitor_head  = 0u;
+    visitor_count = 0u;
+    visitor_last  = VISITOR_NONE;
+}
+
+visitor_dir_t Visitor_Arrivals(uint32_t rising, uint32_t time_us)
+{
+    visitor_dir_t dir = VISITOR_NONE;
+
+    for (uint8_t s = 0; (s < VISITOR_SENSOR_COUNT) && (rising != 0u); s++)
+    {
+        if ((rising & visitor_sensors[s].bit) == 0u) continue;
+        rising &= ~visitor_sensors[s].bit;
+
+        visitor_dir_t d = visitor_arrival(s, time_us);
+        if (d != VISITOR_NONE) dir = d;
+    }
+    return dir;
+}
+
+const char *Visitor_Name(visitor_dir_t dir)
+{
+    return (dir < VISITOR_DIR_COUNT) ? visitor_names[dir] : "?";
+}
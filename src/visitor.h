@@ -0,0 +1,69 @@
+/* =============================================================================
+ * visitor.h  -  Direction of travel from the order of sensor-array edges
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Each array sensor (dsun_sensor.h, DSUN_ARRAY_MASK) is given a depth: 0
+ * for the sensors furthest out along the walkway, higher for those nearer
+ * the coffin. Visitor_Arrivals() takes the debounced rising edges of one
+ * array sample with their show time and compares every new arrival with
+ * the latest arrival at another sensor inside VISITOR_WINDOW_US:
+ *
+ *   deeper than before          VISITOR_APPROACH   (walking towards us)
+ *   shallower than before       VISITOR_RETREAT    (walking away)
+ *   same depth, other sensor    VISITOR_PASS_BY    (crossing in front)
+ *
+ * An approach is reported on the second sensor, before the visitor stands
+ * in front of the coffin, which is the lead time the actuator needs. Each
+ * class is reported once per window, so a walk past three rows of sensors
+ * fires one approach, not two.
+ *
+ *   uint32_t present = dsun_array_update();
+ *   visitor_dir_t d = Visitor_Arrivals(dsun_array_rising(), ShowClock_Now());
+ *   if (d == VISITOR_APPROACH) Actuator_Trigger(ACT_CH_LID, scare);
+ *
+ * Call from the task that polls the array; no locking inside.
+ * ============================================================================= */
+
+#ifndef VISITOR_H
+#define VISITOR_H
+
+#include <stdint.h>
+#include "dsun_sensor.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define VISITOR_WINDOW_US   2000000u    /* edges further apart are separate visitors */
+#define VISITOR_HISTORY     4u          /* arrivals kept inside the window */
+
+/* { array bit, depth } per sensor, the SHOW_SENSORS rows (showcfg.h) */
+#define VISITOR_X_SENSOR(id, pin, depth)    { DSUN_ARRAY_BIT(pin), depth },
+#define VISITOR_SENSORS     { SHOW_SENSORS(VISITOR_X_SENSOR) }
+
+typedef enum
+{
+    VISITOR_NONE = 0,
+    VISITOR_APPROACH,
+    VISITOR_PASS_BY,
+    VISITOR_RETREAT,
+    VISITOR_DIR_COUNT
+} visitor_dir_t;
+
+typedef struct
+{
+    uint32_t bit;           /* DSUN_ARRAY_BIT(pin)                       */
+    uint8_t  depth;         /* 0 = furthest out, higher = nearer the lid */
+} visitor_sensor_t;
+
+/** Forget all arrivals. */
+void Visitor_Init(void);
+
+/**
+ * Feed the rising-edge mask of one array sample (dsun_array_rising()) seen
+ * at show time time_us. Returns the direction a new arrival completed, or
+ * VISITOR_NONE. With several arrivals in one mask the last classified wins.
+ */
+visitor_dir_t Visitor_Arrivals(uint32_t rising, uint32_t time_us);
+
+/** Name of a direction for logs ("approach", ...). */
+const char *Visitor_Name(visitor_dir_t dir);
+
+#endif /* VISITOR_H */
@@ -0,0 +1,135 @@
+/* =============================================================================
+ * watchdog.c  -  Hardware watchdog fed only while every critical task checks in
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "watchdog.h"
+#include "definitions.h"        /* WDT, NVIC */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "irqprio.h"
+#include "fault.h"
+#include "log.h"
+
+typedef struct
+{
+    const char          *name;
+    TickType_t           deadline;
+    volatile TickType_t  last;          /* last check-in */
+    volatile bool        paused;
+} wdog_task_t;
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static wdog_task_t       wdog_task[WATCHDOG_MAX_TASKS];
+static volatile uint32_t wdog_count;
+static volatile uint32_t wdog_late = WATCHDOG_NONE;     /* first task found late */
+
+static TimerHandle_t wdog_timer;
+static StaticTimer_t wdog_timer_buf;
+
+/* -- Hardware ---------------------------------------------------------------- */
+
+static void wdog_feed(void)
+{
+    if ((WDT_REGS->WDT_SYNCBUSY & WDT_SYNCBUSY_CLEAR_Msk) == 0u)
+        WDT_REGS->WDT_CLEAR = WDT_CLEAR_CLEAR_KEY;
+}
+
+/* Early warning: nobody fed for WATCHDOG_EW. Record, safe and reset now
+ * (fault.h) rather than wait for the WDT */
+void __attribute__((naked, noreturn)) WDT_Handler(void)
+{
+    FAULT_ENTRY(FAULT_WATCHDOG);
+}
+
+/* -- Supervisor: timer service task ------------------------------------------- */
+
+static void wdog_timer_cb(TimerHandle_t t)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    (void)t;
+    for (uint32_t i = 0; i < wdog_count; i++)
+    {
+        const wdog_task_t *w = &wdog_task[i];
+
+        if (!w->paused && (TickType_t)(now - w->last) > w->deadline)
+        {
+            if (wdog_late == WATCHDOG_NONE)
+            {
+                wdog_late = i;
+                LOG_ERROR("watchdog: '%s' missed its %lu ms heartbeat, resetting", w->name,
+                          (unsigned long)(w->deadline * portTICK_PERIOD_MS));
+            }
+            return;
+        }
+    }
+    wdog_late = WATCHDOG_NONE;                  /* a late task caught up in time */
+    wdog_feed();
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+watchdog_id_t Watchdog_Register(const char *name, uint32_t deadline_ms)
+{
+    watchdog_id_t id = WATCHDOG_NONE;
+
+    taskENTER_CRITICAL();
+    if (wdog_count < WATCHDOG_MAX_TASKS)
+    {
+        wdog_task_t *w = &wdog_task[wdog_count];
+
+        w->name     = name;
+        w->deadline = pdMS_TO_TICKS(deadline_ms);
+        w->last     = xTaskGetTickCount();
+        w->paused   = false;
+        id = (watchdog_id_t)wdog_count++;
+    }
+    taskEXIT_CRITICAL();
+    if (id == WATCHDOG_NONE) LOG_WARN("watchdog: no room for '%s'", name);
+    return id;
+}
+
+void Watchdog_CheckIn(watchdog_id_t id)
+{
+    if (id >= WATCHDOG_MAX_TASKS) return;
+    wdog_task[id].last   = xTaskGetTickCount();
+    wdog_task[id].paused = false;
+}
+
+void Watchdog_Pause(watchdog_id_t id)
+{
+    if (id >= WATCHDOG_MAX_TASKS) return;
+    wdog_task[id].paused = true;
+}
+
+bool Watchdog_Start(void)
+{
+#if WATCHDOG_ENABLE
+    wdog_timer = xTimerCreateStatic("Watchdog", pdMS_TO_TICKS(WATCHDOG_FEED_MS), pdTRUE, NULL,
+                                    wdog_timer_cb, &wdog_timer_buf);
+    if (wdog_timer == NULL || xTimerStart(wdog_timer, 0u) != pdPASS) return false;
+
+    /* CONFIG and EWCTRL only take writes while the WDT is off */
+    WDT_REGS->WDT_CTRLA    = 0u;
+    while ((WDT_REGS->WDT_SYNCBUSY & WDT_SYNCBUSY_ENABLE_Msk) != 0u) {}
+    WDT_REGS->WDT_CONFIG   = WATCHDOG_PER;
+    WDT_REGS->WDT_EWCTRL   = WATCHDOG_EW;
+    WDT_REGS->WDT_INTFLAG  = WDT_INTFLAG_EW_Msk;
+    WDT_REGS->WDT_INTENSET = WDT_INTENSET_EW_Msk;
+    NVIC_SetPriority(WDT_IRQn, IRQ_PRIO_WDT);
+    NVIC_EnableIRQ(WDT_IRQn);
+    WDT_REGS->WDT_CTRLA    = WDT_CTRLA_ENABLE_Msk;
+    while ((WDT_REGS->WDT_SYNCBUSY & WDT_SYNCBUSY_ENABLE_Msk) != 0u) {}
+#endif
+    return true;
+}
+
+const char *Watchdog_Late(void)
+{
+    uint32_t i = wdog_late;
+
+    return (i < wdog_count) ? wdog_task[i].name : "Tmr Svc";     /* the supervisor itself */
+}
@@ -0,0 +1,68 @@
+/* =============================================================================
+ * watchdog.h  -  Hardware watchdog fed only while every critical task checks in
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * The WDT (enabled here rather than by the WDT_ENABLE fuse, so a debug
+ * session can still load an image that hangs) resets the chip unless it
+ * is cleared within WATCHDOG_PER. Nothing clears it blindly: each task
+ * that matters registers a heartbeat deadline and calls Watchdog_CheckIn()
+ * from its loop, and a supervisor timer feeds the WDT every
+ * WATCHDOG_FEED_MS only if every registered task checked in within its
+ * deadline. A task that is about to block for good on purpose (a static
+ * scene, waiting for a request) calls Watchdog_Pause() first; its next
+ * check-in re-arms it.
+ *
+ *   Missed     The supervisor stops feeding and logs the task once.
+ *   Warning    WATCHDOG_EW after the last feed the early-warning interrupt
+ *              (priority 0, above every critical section) records a fault
+ *              (fault.h, cause "watchdog") with the late task and where the
+ *              CPU was, opens the relays and resets at once. The record is
+ *              logged on the next boot.
+ *   Reset      If even that interrupt cannot run, the WDT resets the chip
+ *              at WATCHDOG_PER; Fault_Init() reports the reset cause.
+ *
+ * The supervisor is a timer callback, so a starved or stuck timer service
+ * task (the actuators run there too) stops the feeding by itself; the
+ * record then names "Tmr Svc". The WDT halts while a debugger holds the
+ * CPU. Its 250 ms wake-up also bounds every tickless sleep (tickless.h).
+ * ============================================================================= */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* -- User configuration ------------------------------------------------------ */
+#ifndef WATCHDOG_ENABLE
+#define WATCHDOG_ENABLE         1
+#endif
+#define WATCHDOG_MAX_TASKS      8u
+#define WATCHDOG_FEED_MS        250u
+#define WATCHDOG_PER            WDT_CONFIG_PER_CYC2048          /* 1.024 kHz: reset 2 s after a feed */
+#define WATCHDOG_EW             WDT_EWCTRL_EWOFFSET_CYC1024     /* early warning 1 s after it        */
+
+#define WATCHDOG_NONE           0xFFu   /* Watchdog_Register(): table full */
+
+typedef uint8_t watchdog_id_t;
+
+/**
+ * Supervise the calling task: it must check in at least every
+ * `deadline_ms` from now on. The name is kept by pointer. Any task;
+ * WATCHDOG_NONE if the table is full (the task is then not supervised).
+ */
+watchdog_id_t Watchdog_Register(const char *name, uint32_t deadline_ms);
+
+/** Heartbeat; also ends a Watchdog_Pause(). Any task, cheap. */
+void Watchdog_CheckIn(watchdog_id_t id);
+
+/** Excuse the task until its next check-in, before a wait with no bound. */
+void Watchdog_Pause(watchdog_id_t id);
+
+/** Start the WDT and the supervisor timer. Before the scheduler. */
+bool Watchdog_Start(void);
+
+/** Name of the task that missed its deadline, "Tmr Svc" when none did. Any context. */
+const char *Watchdog_Late(void);
+
+#endif /* WATCHDOG_H */
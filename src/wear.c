@@ -0,0 +1,133 @@
+/* =============================================================================
+ * wear.c  -  Lifetime wear counters: relay cycles, energised time, boots, scares
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ * ============================================================================= */
+
+#include "wear.h"
+#include "settings.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include <string.h>
+
+#define WEAR_KEY_BOOTS      SETTINGS_KEY('W', 'B', 'O', 'T')
+#define WEAR_KEY_SCARES     SETTINGS_KEY('W', 'S', 'C', 'R')
+#define WEAR_KEY_UPTIME     SETTINGS_KEY('W', 'U', 'P', 'T')
+#define WEAR_KEY_BROWNOUTS  SETTINGS_KEY('W', 'B', 'R', 'N')
+#define WEAR_KEY_RELAY(ch, d)   SETTINGS_KEY('W', 'R', '0' + (ch), (d) ? 'D' : 'U')
+#define WEAR_KEY_ON(ch)         SETTINGS_KEY('W', 'O', 'N', '0' + (ch))
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static wear_t        wear;
+static uint32_t      wear_on_ms[ACT_CHANNELS];  /* not yet a whole second  */
+static uint32_t      wear_up_ms;
+static TickType_t    wear_tick;                 /* uptime counted up to    */
+
+static TimerHandle_t wear_timer;
+static StaticTimer_t wear_timer_buf;
+
+static void wear_load(uint32_t key, uint32_t *v)
+{
+    if (!Settings_Load(key, v)) *v = 0u;
+}
+
+/* Fold the ticks since the last call into uptime_s; under a critical section */
+static void wear_uptime(void)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    wear_up_ms += (uint32_t)(now - wear_tick) * portTICK_PERIOD_MS;
+    wear_tick   = now;
+    wear.uptime_s += wear_up_ms / 1000u;
+    wear_up_ms    %= 1000u;
+}
+
+static void wear_timer_cb(TimerHandle_t t)
+{
+    (void)t;
+    Wear_Commit();
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Wear_Init(void)
+{
+    memset(&wear, 0, sizeof(wear));
+    wear_load(WEAR_KEY_BOOTS, &wear.boots);
+    wear_load(WEAR_KEY_SCARES, &wear.scares);
+    wear_load(WEAR_KEY_UPTIME, &wear.uptime_s);
+    wear_load(WEAR_KEY_BROWNOUTS, &wear.brownouts);
+    for (uint32_t ch = 0; ch < ACT_CHANNELS; ch++)
+    {
+        wear_load(WEAR_KEY_RELAY(ch, 0u), &wear.relay[ch][0]);
+        wear_load(WEAR_KEY_RELAY(ch, 1u), &wear.relay[ch][1]);
+        wear_load(WEAR_KEY_ON(ch), &wear.on_s[ch]);
+        wear_on_ms[ch] = 0u;
+    }
+    wear_up_ms = 0u;
+    wear_tick  = xTaskGetTickCount();
+
+    wear.boots++;
+    (void)Settings_Put(WEAR_KEY_BOOTS, wear.boots);     /* with the first batch */
+
+    wear_timer = xTimerCreateStatic("Wear", pdMS_TO_TICKS(WEAR_COMMIT_MS), pdTRUE, NULL,
+                                    wear_timer_cb, &wear_timer_buf);
+    if (wear_timer != NULL) (void)xTimerStart(wear_timer, 0u);
+}
+
+void Wear_Relay(act_channel_t ch, uint8_t op)
+{
+    if (op == ACT_OP_UP)        wear.relay[ch][0]++;
+    else if (op == ACT_OP_DOWN) wear.relay[ch][1]++;
+}
+
+void Wear_Energised(act_channel_t ch, uint32_t ms)
+{
+    wear_on_ms[ch] += ms;
+    if (wear_on_ms[ch] >= 1000u)
+    {
+        wear.on_s[ch]  += wear_on_ms[ch] / 1000u;
+        wear_on_ms[ch] %= 1000u;
+    }
+}
+
+void Wear_Scare(void)
+{
+    wear.scares++;
+}
+
+void Wear_Brownout(void)
+{
+    wear.brownouts++;
+}
+
+void Wear_Commit(void)
+{
+    wear_t w;
+
+    taskENTER_CRITICAL();
+    wear_uptime();
+    w = wear;
+    taskEXIT_CRITICAL();
+
+    /* Unchanged ones cost nothing: settings.h only writes what differs */
+    (void)Settings_Put(WEAR_KEY_BOOTS, w.boots);
+    (void)Settings_Put(WEAR_KEY_SCARES, w.scares);
+    (void)Settings_Put(WEAR_KEY_UPTIME, w.uptime_s);
+    (void)Settings_Put(WEAR_KEY_BROWNOUTS, w.brownouts);
+    for (uint32_t ch = 0; ch < ACT_CHANNELS; ch++)
+    {
+        (void)Settings_Put(WEAR_KEY_RELAY(ch, 0u), w.relay[ch][0]);
+        (void)Settings_Put(WEAR_KEY_RELAY(ch, 1u), w.relay[ch][1]);
+        (void)Settings_Put(WEAR_KEY_ON(ch), w.on_s[ch]);
+    }
+}
+
+void Wear_Get(wear_t *out)
+{
+    taskENTER_CRITICAL();
+    wear_uptime();
+    *out = wear;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,64 @@
+/* =============================================================================
+ * wear.h  -  Lifetime wear counters: relay cycles, energised time, boots, scares
+ * Target : ATSAME51J20A   MPLAB X + XC32
+ *
+ * Relays and actuators are replaced on cycle counts, so these are kept
+ * for the life of the board, across resets and reflashing:
+ *
+ *   - closures of each relay, per channel and direction (UP / DOWN);
+ *   - energised time per channel, either direction;
+ *   - boots, lid scares (sequences started on the lid) and powered time;
+ *   - supply brown-outs caught by brownout.h.
+ *
+ * Counting is a RAM increment on the actuator's own path (timer service
+ * task), never a flash access. Every WEAR_COMMIT_MS, and on the CLI's
+ * `save`, the counters are handed to settings.h, which writes the ones
+ * that changed in its next batch; a reset loses at most one interval.
+ * Without the SmartEEPROM (Settings_Ready() false) they count from boot
+ * only. Time is kept in whole seconds, the rest carried in RAM.
+ * ============================================================================= */
+
+#ifndef WEAR_H
+#define WEAR_H
+
+#include <stdint.h>
+#include "actuator.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define WEAR_COMMIT_MS          (15u * 60u * 1000u)     /* hand to settings.h */
+
+typedef struct
+{
+    uint32_t boots;                         /* this one included              */
+    uint32_t scares;                        /* sequences started on the lid   */
+    uint32_t uptime_s;                      /* powered, all boots             */
+    uint32_t brownouts;                     /* supply sags, brownout.h        */
+    uint32_t relay[ACT_CHANNELS][2];        /* closures, [0] UP, [1] DOWN     */
+    uint32_t on_s[ACT_CHANNELS];            /* energised, either direction    */
+} wear_t;
+
+/**
+ * Load the counters (after Settings_Init()), count this boot and start
+ * the commit timer. Before the scheduler.
+ */
+void Wear_Init(void);
+
+/** One relay closure, op ACT_OP_UP or ACT_OP_DOWN. Timer service task. */
+void Wear_Relay(act_channel_t ch, uint8_t op);
+
+/** ms a channel was energised. Timer service task. */
+void Wear_Energised(act_channel_t ch, uint32_t ms);
+
+/** A sequence started on the lid. Timer service task. */
+void Wear_Scare(void);
+
+/** A supply brown-out. Timer service task. */
+void Wear_Brownout(void);
+
+/** Hand the counters to settings.h now. Timer service task. */
+void Wear_Commit(void);
+
+/** Consistent snapshot, uptime up to now. Any task. */
+void Wear_Get(wear_t *out);
+
+#endif /* WEAR_H */
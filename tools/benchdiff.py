@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Compare two Effects_Benchmark() captures, e.g. release against default.
+
+Effects_Benchmark() (src/effects.c, EFFECTS_BENCH_ENABLE) prints one
+"bench,backend,effect,slot,frames,min,avg,max" line per effect and slot,
+in CPU cycles, on the console at boot. Save each image's console output
+to a file; other lines in it are skipped. Prints, for every effect and
+slot in both, the average and worst case of each and the change in
+percent, then the render slot's total over all effects.
+
+    benchdiff.py bench_default.txt bench_release.txt
+    benchdiff.py -s encode bench_default.txt bench_release.txt
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import sys
+
+
+def parse(path):
+    rows = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            cols = line.strip().split(',')
+            if len(cols) != 8 or cols[0] != 'bench' or not cols[4].isdigit():
+                continue
+            backend, effect, slot = cols[1:4]
+            rows[(effect, slot)] = (backend, int(cols[6]), int(cols[7]))
+    return rows
+
+
+def pct(new, old):
+    return '%+7.1f%%' % (100.0 * (new - old) / old) if old else '      -'
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('base', help='capture to compare against (default configuration)')
+    ap.add_argument('new', help='capture to compare (release configuration)')
+    ap.add_argument('-s', '--slot', help='only this slot: render, encode or dma_wait')
+    args = ap.parse_args()
+
+    base, new = parse(args.base), parse(args.new)
+    if not base or not new:
+        print('benchdiff: no bench lines in %s' % (args.base if not base else args.new), file=sys.stderr)
+        return 1
+    backends = {r[0] for r in base.values()} | {r[0] for r in new.values()}
+    if len(backends) > 1:
+        print('benchdiff: warning: mixed backends %s' % ', '.join(sorted(backends)), file=sys.stderr)
+
+    print('  %-16s %-8s %9s %9s %8s %9s %9s %8s'
+          % ('effect', 'slot', 'avg', 'avg new', 'change', 'max', 'max new', 'change'))
+    total = [0, 0]
+    for key in sorted(set(base) & set(new)):
+        if args.slot and key[1] != args.slot:
+            continue
+        _, avg, top = base[key]
+        _, navg, ntop = new[key]
+        print('  %-16s %-8s %9d %9d %s %9d %9d %s'
+              % (key[0], key[1], avg, navg, pct(navg, avg), top, ntop, pct(ntop, top)))
+        if key[1] == 'render':
+            total[0] += avg
+            total[1] += navg
+    print('  %-25s %9d %9d %s' % ('render, all effects', total[0], total[1], pct(total[1], total[0])))
+    for key in sorted(set(base) ^ set(new)):
+        print('benchdiff: %s/%s only in %s' % (key[0], key[1], args.base if key in base else args.new))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Show the frames captured by src/telem.c ('F' frames, CLI "capture").
+
+Reads the telemetry stream (USB CDC port, console or a saved capture)
+and draws every captured frame: by default as one line of truecolor
+blocks in the terminal, the strip scaled to its width; with --tk in a
+window, the strip on top and below it one row per frame for the last 240
+frames (written round, newest over oldest), so a chase or a fade shows
+as a picture. Samples and console text in the same stream are skipped;
+lost frames go to stderr.
+
+    stty -F /dev/ttyACM0 raw && frame_view.py /dev/ttyACM0
+    frame_view.py --tk capture.bin
+
+Values are as rendered, before gamma, so dim colours look brighter here
+than on the strip. Only the Python standard library is needed (tkinter
+for --tk).
+"""
+
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from tlog_decode import cobs_decode     # noqa: E402
+from telem_decode import crc16          # noqa: E402
+
+
+def frames(src):
+    """(seq, time_ms, bytes rgb) of every good 'F' frame in src."""
+    buf = b""
+    while True:
+        data = src.read1(4096) if hasattr(src, "read1") else src.read(4096)
+        if not data:
+            return
+        buf += data
+        *chunks, buf = buf.split(b"\0")
+        for chunk in chunks:
+            p = cobs_decode(chunk) if chunk else None
+            if not p or len(p) < 11 or p[0:1] != b"F":
+                continue
+            if crc16(p[:-2]) != struct.unpack_from("<H", p, len(p) - 2)[0]:
+                continue
+            seq, t, n = struct.unpack_from("<HIH", p, 1)
+            if len(p) >= 11 + 3 * n:
+                yield seq, t, p[9:9 + 3 * n]
+
+
+def term_view(src):
+    width = max(8, os.get_terminal_size(sys.stdout.fileno()).columns - 12) \
+        if sys.stdout.isatty() else 72
+    last = None
+    for seq, t, rgb in frames(src):
+        if last is not None and (seq - last - 1) & 0xFFFF:
+            sys.stderr.write("# lost %d frames\n" % ((seq - last - 1) & 0xFFFF))
+        last = seq
+        n = len(rgb) // 3
+        cols = min(width, n) or 1
+        line = []
+        for c in range(cols):
+            i = 3 * (c * n // cols)
+            line.append("\x1b[48;2;%d;%d;%dm " % (rgb[i], rgb[i + 1], rgb[i + 2]))
+        sys.stdout.write("%9.3f %s\x1b[0m\n" % (t / 1000.0, "".join(line)))
+        sys.stdout.flush()
+
+
+def tk_view(src, history=240):
+    import threading
+    import tkinter
+
+    root = tkinter.Tk()
+    root.title("frame_view")
+    latest = {"frame": None, "lost": 0}
+    lock = threading.Lock()
+
+    def reader():
+        last = None
+        for seq, t, rgb in frames(src):
+            with lock:
+                if last is not None:
+                    latest["lost"] += (seq - last - 1) & 0xFFFF
+                latest["frame"] = (t, rgb)
+            last = seq
+
+    threading.Thread(target=reader, daemon=True).start()
+    state = {"img": None, "n": 0, "row": 0}
+    label = tkinter.Label(root, font=("TkFixedFont",))
+    label.pack(side=tkinter.TOP)
+    canvas = tkinter.Label(root)
+    canvas.pack()
+
+    def draw():
+        with lock:
+            frame, latest["frame"] = latest["frame"], None
+            lost = latest["lost"]
+        if frame is not None:
+            t, rgb = frame
+            n = len(rgb) // 3
+            if state["img"] is None or n != state["n"]:
+                state["n"] = n
+                state["img"] = tkinter.PhotoImage(width=n, height=history + 8)
+                state["row"] = 0
+                canvas.configure(image=state["img"])
+            row = "{" + " ".join("#%02x%02x%02x" % (rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2])
+                                 for i in range(n)) + "}"
+            state["img"].put(" ".join([row] * 8), to=(0, 0))
+            state["img"].put(row, to=(0, 8 + state["row"]))
+            state["row"] = (state["row"] + 1) % history
+            label.configure(text="%9.3f s  %d px  %d lost" % (t / 1000.0, n, lost))
+        root.after(15, draw)
+
+    draw()
+    root.mainloop()
+
+
+def main(argv):
+    tk = len(argv) > 1 and argv[1] == "--tk"
+    if tk:
+        argv = argv[:1] + argv[2:]
+    if len(argv) > 2:
+        sys.exit(__doc__)
+    src = open(argv[1], "rb") if len(argv) == 2 else sys.stdin.buffer
+    try:
+        (tk_view if tk else term_view)(src)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main(sys.argv)
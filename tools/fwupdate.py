@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Send a firmware image to a running prop (src/fwupdate.h, CLI "fwup").
+
+The image (a raw .bin, e.g. xc32-objcopy -O binary CR-Proj.production.elf)
+is padded to a multiple of 4 with 0xFF, its CRC-32 sent with the size,
+and then sent in chunks, each one only when the prop asks for it with
+"fwup: more <offset>", so neither the console nor the USB port can drop
+bytes while the flash is busy. The prop checks the CRC, then swaps banks
+and resets at the next gap between scares; the show runs meanwhile.
+
+    stty -F /dev/ttyACM0 raw -echo && fwupdate.py /dev/ttyACM0 CR-Proj.bin
+    stty -F /dev/ttyUSB0 115200 raw -echo && fwupdate.py /dev/ttyUSB0 CR-Proj.bin
+
+Turn telemetry off on that port first (telem.h) so its frames do not
+hide the replies. Only the Python standard library is needed.
+"""
+
+import os
+import re
+import sys
+import time
+import zlib
+
+CHUNK = 256                     # FWUPDATE_CHUNK
+IMAGE_MAX = 0x7A000             # FWUPDATE_IMAGE_MAX
+REPLY_S = 10.0
+
+
+def replies(fd):
+    """Lines the prop prints, until REPLY_S passes without one."""
+    buf = b""
+    while True:
+        deadline = time.monotonic() + REPLY_S
+        while b"\n" not in buf:
+            if time.monotonic() > deadline:
+                raise SystemExit("fwupdate: no reply from the prop")
+            try:
+                buf += os.read(fd, 256)
+            except BlockingIOError:
+                time.sleep(0.01)
+        line, buf = buf.split(b"\n", 1)
+        yield line.decode("ascii", "replace").strip()
+
+
+def send(fd, data):
+    while data:
+        try:
+            data = data[os.write(fd, data):]
+        except BlockingIOError:
+            time.sleep(0.01)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.exit(__doc__)
+    image = open(argv[2], "rb").read()
+    image += b"\xff" * (-len(image) % 4)
+    if len(image) > IMAGE_MAX:
+        sys.exit("fwupdate: %d bytes, at most %d fit a bank" % (len(image), IMAGE_MAX))
+    crc = zlib.crc32(image) & 0xFFFFFFFF
+
+    fd = os.open(argv[1], os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    send(fd, b"\rfwup %d 0x%08X\r" % (len(image), crc))
+    more = re.compile(r"fwup: more (\d+)")
+    for line in replies(fd):
+        m = more.search(line)
+        if m:
+            off = int(m.group(1))
+            send(fd, image[off:off + CHUNK])
+            sys.stderr.write("\r%3d %%" % (100 * off // len(image)))
+        elif "fwup: " in line and "usage" not in line:
+            sys.stderr.write("\n%s\n" % line[line.index("fwup: "):])
+            sys.exit(0 if "image ok" in line else 1)
+        elif "usage: fwup" in line:
+            sys.exit("\nfwupdate: refused, %s" % line)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
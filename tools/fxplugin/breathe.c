@@ -0,0 +1,20 @@
+/* =============================================================================
+ * breathe.c  -  Example effect plug-in: a slow ember-red breath, brightest mid-span
+ * Target : ATSAME51J20A   built apart from the firmware, see tools/mkfxplugin.py
+ * ============================================================================= */
+
+#include "plugin_abi.h"
+
+void fx_render(uint32_t *px, const plugin_frame_t *f)
+{
+    const plugin_api_t *api   = f->api;
+    uint32_t            level = api->sin8(f->offset);
+    uint32_t            step  = (128u << 8) / f->count;    /* half a sine over the span */
+
+    for (uint16_t i = 0; i < f->count; i++)
+    {
+        uint32_t r = (level * api->sin8((uint8_t)((i * step) >> 8))) >> 8;
+
+        px[i] = r | ((r >> 3) << 8);                        /* 0x00BBGGRR */
+    }
+}
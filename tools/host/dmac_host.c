@@ -0,0 +1,366 @@
+/* =============================================================================
+ * dmac_host.c  -  DMAC plib shim and DMAC model for the host builds
+ * Target : Linux x86-64, GCC
+ * ============================================================================= */
+
+#include "definitions.h"
+#include "dma_qos.h"            /* DMA_OTHER_FIRST */
+#include "hostregs.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+#define HOST_PERIPH_LO      0x40000000u     /* destinations here are peripherals */
+#define HOST_PERIPH_HI      0x48000000u
+#define HOST_BLOCKS_PER_RUN 4096u           /* a ring with no wire time ends here */
+
+typedef struct
+{
+    DMAC_CHANNEL_CALLBACK     callback;
+    uintptr_t                 context;
+    bool                      busy;         /* the plib's isBusy */
+    bool                      ended;        /* the interrupt ends the transfer */
+    bool                      run;          /* the model executes `cur` */
+    dmac_descriptor_registers_t cur;
+    uint64_t                  due;          /* cur ends */
+    uint32_t                  byte_ns;
+    uint32_t                  wire_len;
+    uint32_t                  transfers;
+    uint32_t                  blocks;
+    uint8_t                   flags;        /* CHINTFLAG of the last interrupt */
+} host_dmac_ch_t;
+
+static dmac_descriptor_registers_t host_desc[HOST_DMAC_CHANNELS] __ALIGNED(16);
+static dmac_descriptor_registers_t host_wrb[HOST_DMAC_CHANNELS]  __ALIGNED(16);
+static host_dmac_ch_t              host_ch[HOST_DMAC_CHANNELS];
+static uint8_t                     host_wire[HOST_DMAC_CHANNELS][HOST_DMAC_WIRE_MAX];
+
+/* dma_qos.c's vectors */
+void DMAC_0_Handler(void);
+void DMAC_1_Handler(void);
+void DMAC_2_Handler(void);
+void DMAC_3_Handler(void);
+void DMAC_OTHER_Handler(void) __attribute__((weak));
+
+static void (* const host_vector[DMA_OTHER_FIRST])(void) =
+{
+    DMAC_0_Handler, DMAC_1_Handler, DMAC_2_Handler, DMAC_3_Handler
+};
+
+/* -- Model ------------------------------------------------------------------- */
+
+static uint32_t dmac_beat(const dmac_descriptor_registers_t *d)
+{
+    return 1u << ((d->DMAC_BTCTRL & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos);
+}
+
+static uint32_t dmac_bytes(const dmac_descriptor_registers_t *d)
+{
+    return (uint32_t)d->DMAC_BTCNT * dmac_beat(d);
+}
+
+/* Begin executing `d` on `ch`; its block ends after its bytes' wire time */
+static void dmac_load(host_dmac_ch_t *c, const dmac_descriptor_registers_t *d, uint64_t now)
+{
+    c->cur = *d;
+    c->due = now + (uint64_t)dmac_bytes(d) * c->byte_ns;
+}
+
+static void dmac_start(DMAC_CHANNEL ch, uint64_t now)
+{
+    host_dmac_ch_t *c = &host_ch[ch];
+
+    c->run      = true;
+    c->wire_len = 0u;
+    c->transfers++;
+    dmac_load(c, &host_desc[ch], now);
+}
+
+/* Move the block's beats: SRCINC/DSTINC address the end, a peripheral destination is captured */
+static void dmac_copy(host_dmac_ch_t *c, DMAC_CHANNEL ch)
+{
+    const dmac_descriptor_registers_t *d = &c->cur;
+    uint32_t  beat  = dmac_beat(d);
+    uint32_t  bytes = dmac_bytes(d);
+    uintptr_t src   = d->DMAC_SRCADDR;
+    uintptr_t dst   = d->DMAC_DSTADDR;
+    bool      sinc  = (d->DMAC_BTCTRL & DMAC_BTCTRL_SRCINC_Msk) != 0u;
+    bool      dinc  = (d->DMAC_BTCTRL & DMAC_BTCTRL_DSTINC_Msk) != 0u;
+    bool      wire  = (dst >= HOST_PERIPH_LO) && (dst < HOST_PERIPH_HI);
+
+    if (sinc) src -= bytes;
+    if (dinc) dst -= bytes;
+
+    for (uint32_t n = 0; n < bytes; n += beat)
+    {
+        const uint8_t *s = (const uint8_t *)(src + (sinc ? n : 0u));
+
+        if (wire)
+        {
+            for (uint32_t b = 0; b < beat && c->wire_len < HOST_DMAC_WIRE_MAX; b++)
+                host_wire[ch][c->wire_len++] = s[b];
+        }
+        else
+        {
+            memcpy((uint8_t *)(dst + (dinc ? n : 0u)), s, beat);
+        }
+    }
+    host_wrb[ch] = *d;
+    host_wrb[ch].DMAC_BTCNT = 0u;
+}
+
+/* The plib's handler of `ch`, behind its vector: busy state and callback */
+static void dmac_plib_isr(DMAC_CHANNEL ch)
+{
+    host_dmac_ch_t *c     = &host_ch[ch];
+    uint8_t         flags = DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG;
+
+    DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = 0u;
+    if (c->ended) c->busy = false;
+    if (c->callback != NULL)
+        c->callback(((flags & DMAC_CHINTFLAG_TERR_Msk) != 0u) ? DMAC_TRANSFER_EVENT_ERROR
+                                                               : DMAC_TRANSFER_EVENT_COMPLETE,
+                    c->context);
+}
+
+/* The channel's interrupt: dma_qos.c's DMAC_n vector, or its DMAC_OTHER */
+static void dmac_raise(DMAC_CHANNEL ch, uint8_t flags, bool ended)
+{
+    host_dmac_ch_t *c = &host_ch[ch];
+
+    c->flags = flags;
+    if (ch < DMA_OTHER_FIRST)
+    {
+        c->ended = ended;
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = flags;
+        host_vector[ch]();
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = 0u;
+    }
+    else if (DMAC_OTHER_Handler != NULL)
+    {
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = flags;
+        *(volatile uint32_t *)&DMAC_REGS->DMAC_INTSTATUS |= 1u << ch;      /* read-only on the chip */
+        DMAC_OTHER_Handler();
+        *(volatile uint32_t *)&DMAC_REGS->DMAC_INTSTATUS &= ~(1u << ch);
+        DMAC_REGS->CHANNEL[ch].DMAC_CHINTFLAG = 0u;
+    }
+}
+
+/* End the current block of `ch`; false once the channel has stopped */
+static bool dmac_block_end(DMAC_CHANNEL ch)
+{
+    host_dmac_ch_t *c   = &host_ch[ch];
+    bool            irq = (c->cur.DMAC_BTCTRL & (DMAC_BTCTRL_BLOCKACT_INT & DMAC_BTCTRL_BLOCKACT_Msk)) != 0u;
+    uintptr_t       next;
+
+    if ((c->cur.DMAC_BTCTRL & DMAC_BTCTRL_VALID_Msk) == 0u)
+    {
+        c->run = false;                 /* fetch error: TERR, channel off */
+        DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+        dmac_raise(ch, (uint8_t)DMAC_CHINTFLAG_TERR_Msk, true);
+        return false;
+    }
+
+    dmac_copy(c, ch);
+    c->blocks++;
+    next = c->cur.DMAC_DESCADDR;
+    if (next == 0u)
+    {
+        c->run = false;
+        DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+    }
+    else
+    {
+        dmac_load(c, (const dmac_descriptor_registers_t *)next, c->due);
+    }
+    if (irq)
+        dmac_raise(ch, (uint8_t)DMAC_CHINTFLAG_TCMPL_Msk, !c->run);
+    return c->run;
+}
+
+/* -- Public API implementation: plib ----------------------------------------- */
+
+void DMAC_Initialize(void)
+{
+    memset(host_ch, 0, sizeof(host_ch));
+    DMAC_REGS->DMAC_BASEADDR = (uint32_t)(uintptr_t)host_desc;
+    DMAC_REGS->DMAC_WRBADDR  = (uint32_t)(uintptr_t)host_wrb;
+    for (DMAC_CHANNEL ch = 0; ch < DMA_OTHER_FIRST; ch++)
+        host_desc[ch].DMAC_BTCTRL = DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_BYTE
+                                  | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk;
+    DMAC_REGS->DMAC_CTRL = DMAC_CTRL_DMAENABLE_Msk;
+}
+
+bool DMAC_ChannelTransfer(DMAC_CHANNEL channel, const void *srcAddr, const void *destAddr, size_t blockSize)
+{
+    dmac_descriptor_registers_t *d = &host_desc[channel];
+
+    if (host_ch[channel].busy) return false;
+
+    d->DMAC_SRCADDR  = (uint32_t)((uintptr_t)srcAddr
+                     + (((d->DMAC_BTCTRL & DMAC_BTCTRL_SRCINC_Msk) != 0u) ? blockSize : 0u));
+    d->DMAC_DSTADDR  = (uint32_t)((uintptr_t)destAddr
+                     + (((d->DMAC_BTCTRL & DMAC_BTCTRL_DSTINC_Msk) != 0u) ? blockSize : 0u));
+    d->DMAC_BTCNT    = (uint16_t)(blockSize / dmac_beat(d));
+    d->DMAC_DESCADDR = 0u;
+    host_ch[channel].busy = true;
+    DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    dmac_start(channel, Host_Ns());
+    return true;
+}
+
+bool DMAC_ChannelLinkedListTransfer(DMAC_CHANNEL channel, dmac_descriptor_registers_t *channelDesc)
+{
+    if (host_ch[channel].busy && host_ch[channel].run) return false;
+
+    host_desc[channel] = *channelDesc;
+    host_ch[channel].busy = true;
+    DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+    dmac_start(channel, Host_Ns());
+    return true;
+}
+
+bool DMAC_ChannelIsBusy(DMAC_CHANNEL channel)
+{
+    return host_ch[channel].busy;
+}
+
+void DMAC_ChannelDisable(DMAC_CHANNEL channel)
+{
+    DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA &= ~DMAC_CHCTRLA_ENABLE_Msk;
+    host_ch[channel].run  = false;
+    host_ch[channel].busy = false;
+}
+
+void DMAC_ChannelCallbackRegister(DMAC_CHANNEL channel, const DMAC_CHANNEL_CALLBACK callback, const uintptr_t context)
+{
+    host_ch[channel].callback = callback;
+    host_ch[channel].context  = context;
+}
+
+void DMAC_0_InterruptHandler(void)
+{
+    dmac_plib_isr(0u);
+}
+
+void DMAC_1_InterruptHandler(void)
+{
+    dmac_plib_isr(1u);
+}
+
+void DMAC_2_InterruptHandler(void)
+{
+    dmac_plib_isr(2u);
+}
+
+void DMAC_3_InterruptHandler(void)
+{
+    dmac_plib_isr(3u);
+}
+
+DMAC_CHANNEL_CONFIG DMAC_ChannelSettingsGet(DMAC_CHANNEL channel)
+{
+    return host_desc[channel].DMAC_BTCTRL;
+}
+
+bool DMAC_ChannelSettingsSet(DMAC_CHANNEL channel, DMAC_CHANNEL_CONFIG setting)
+{
+    DMAC_ChannelDisable(channel);
+    host_desc[channel].DMAC_BTCTRL = (uint16_t)setting;
+    return true;
+}
+
+uint16_t DMAC_ChannelGetTransferredCount(DMAC_CHANNEL channel)
+{
+    return host_ch[channel].run ? 0u : host_desc[channel].DMAC_BTCNT;
+}
+
+void DMAC_ChannelCRCSetup(DMAC_CHANNEL channel, DMAC_CRC_SETUP CRCSetup)
+{
+    (void)channel;
+    (void)CRCSetup;
+}
+
+uint32_t DMAC_CRCRead(void)
+{
+    return 0u;                  /* not modelled: crc.c's self check fails, as it should */
+}
+
+uint32_t DMAC_CRCCalculate(void *buffer, uint32_t length, DMAC_CRC_SETUP CRCSetup)
+{
+    (void)buffer;
+    (void)length;
+    (void)CRCSetup;
+    return 0u;
+}
+
+void DMAC_CRCDisable(void)
+{
+}
+
+void DMAC_ChannelSuspend(DMAC_CHANNEL channel)
+{
+    host_ch[channel].run = false;
+}
+
+void DMAC_ChannelResume(DMAC_CHANNEL channel)
+{
+    host_ch[channel].run = host_ch[channel].busy;
+}
+
+DMAC_TRANSFER_EVENT DMAC_ChannelTransferStatusGet(DMAC_CHANNEL channel)
+{
+    uint8_t f = host_ch[channel].flags;
+
+    if ((f & DMAC_CHINTFLAG_TERR_Msk) != 0u) return DMAC_TRANSFER_EVENT_ERROR;
+    if ((f & DMAC_CHINTFLAG_TCMPL_Msk) != 0u) return DMAC_TRANSFER_EVENT_COMPLETE;
+    return DMAC_TRANSFER_EVENT_NONE;
+}
+
+/* -- Public API implementation: host model ----------------------------------- */
+
+void HostDmac_SetByteNs(DMAC_CHANNEL ch, uint32_t ns)
+{
+    host_ch[ch].byte_ns = ns;
+}
+
+uint32_t HostDmac_Run(uint64_t now_ns)
+{
+    uint32_t done = 0u;
+
+    for (DMAC_CHANNEL ch = 0; ch < HOST_DMAC_CHANNELS; ch++)
+    {
+        host_dmac_ch_t *c = &host_ch[ch];
+
+        /* Enabled by hand since the last run: CHCTRLA.ENABLE over the BASEADDR descriptor */
+        if (!c->run && !c->busy && (DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u)
+            dmac_start(ch, now_ns);
+
+        for (uint32_t n = 0; c->run && c->due <= now_ns && n < HOST_BLOCKS_PER_RUN; n++)
+        {
+            done++;
+            if (!dmac_block_end(ch))
+                break;
+        }
+    }
+    return done;
+}
+
+bool HostDmac_Busy(void)
+{
+    for (DMAC_CHANNEL ch = 0; ch < HOST_DMAC_CHANNELS; ch++)
+        if (host_ch[ch].run || (DMAC_REGS->CHANNEL[ch].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0u)
+            return true;
+    return false;
+}
+
+const uint8_t *HostDmac_Wire(DMAC_CHANNEL ch, uint32_t *len)
+{
+    *len = host_ch[ch].wire_len;
+    return host_wire[ch];
+}
+
+void HostDmac_Counts(DMAC_CHANNEL ch, uint32_t *transfers, uint32_t *blocks)
+{
+    *transfers = host_ch[ch].transfers;
+    *blocks    = host_ch[ch].blocks;
+}
@@ -0,0 +1,61 @@
+/* =============================================================================
+ * hostregs.c  -  The SAME51's register space in host memory (tools/host)
+ * Target : Linux x86-64, GCC
+ * ============================================================================= */
+
+#define _GNU_SOURCE
+#include "hostregs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/* -- Internal state ---------------------------------------------------------- */
+
+__thread uint32_t host_excl;            /* the last __LDREX*() value (cmsis_compiler.h) */
+
+static const struct
+{
+    uintptr_t   base;
+    size_t      len;
+    const char *name;
+    int         fill;                   /* what it reads before it is written */
+} host_regions[] =
+{
+    /* flash from the first page Linux hands out (vm.mmap_min_addr): nvstore.c
+     * and settings.c find their blocks erased */
+    { 0x00001000u, 0x000FF000u, "flash",            0xFF },
+    { 0x00800000u, 0x00010000u, "fuses, user page", 0    },
+    { 0x03000000u, 0x00004000u, "CMCC RAMs",        0    },
+    { 0x04000000u, 0x01000000u, "QSPI window",      0    },
+    { 0x40000000u, 0x08000000u, "HPB0..3, SEEPROM, SDHC, BKUPRAM", 0 },
+    { 0xE0000000u, 0x00100000u, "PPB: SCS, DWT",    0    },
+};
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void Host_MapRegisters(void)
+{
+    for (size_t i = 0; i < sizeof(host_regions) / sizeof(host_regions[0]); i++)
+    {
+        void *p = mmap((void *)host_regions[i].base, host_regions[i].len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+
+        if (p != (void *)host_regions[i].base)
+        {
+            fprintf(stderr, "hostregs: cannot map %s at 0x%08lx\n",
+                    host_regions[i].name, (unsigned long)host_regions[i].base);
+            exit(2);
+        }
+        if (host_regions[i].fill != 0) memset(p, host_regions[i].fill, host_regions[i].len);
+    }
+}
+
+uint64_t Host_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,28 @@
+/* =============================================================================
+ * hostregs.h  -  The SAME51's register space in host memory (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * The firmware reaches every peripheral through the DFP's fixed addresses
+ * (SERCOM1_REGS is 0x40003400, DWT 0xE0001000, ...). Host_MapRegisters()
+ * maps zeroed anonymous memory at those addresses, so the sources build
+ * and run unchanged: a write lands in memory, a read returns the last
+ * write or zero. Nothing behind it acts on a write; the peripherals the
+ * host builds model (the DMAC, TRNG) are the plib shims' own code.
+ *
+ * The host executables are linked -no-pie, which keeps the firmware's
+ * statics below 4 G, so the (uint32_t) pointer casts in DMA descriptors
+ * still round-trip. Call it first thing in main(), before any module.
+ * ============================================================================= */
+
+#ifndef HOSTREGS_H
+#define HOSTREGS_H
+
+#include <stdint.h>
+
+/** Map the fuse rows, CMCC, QSPI window, HPB0..3, SEEPROM, BKUPRAM and the PPB; exits on failure. */
+void Host_MapRegisters(void);
+
+/** Nanoseconds on the host's monotonic clock. */
+uint64_t Host_Ns(void);
+
+#endif /* HOSTREGS_H */
@@ -0,0 +1,233 @@
+/* =============================================================================
+ * neotest.c  -  Host test of the NeoPixel encoder, the effects and the
+ *               actuator tables (tools/host, "make test")
+ * Target : Linux x86-64, GCC
+ *
+ * Runs, in order, and exits 1 if any check fails:
+ *
+ *   1. NeoPixel_SelfTest(): the encode LUT against the bit-loop reference,
+ *      the golden vector 0xA5 -> D3 49 A6 and the zero padding.
+ *   2. The wire: a known frame through NeoPixel_Show() and the modelled
+ *      DMAC, captured at the SPI DATA register and decoded back, 3 SPI
+ *      bits per LED bit (110 = 1, 100 = 0): GRB order, the unlit LEDs, the
+ *      padding and the reset tail, and the frame length.
+ *   3. The built-in actuator sequences (Actuator_Pattern()): each ends in
+ *      ACT_OP_END within ACT_SEQ_MAX_STEPS, with known ops and loops that
+ *      stay inside the table.
+ *   4. Every effect for `frames` frames (default 200, first argument) of
+ *      Effects_Render(1), Show() included, timed on the host's clock. One
+ *      "bench,host,<effect>,render,frames,min,avg,max" line per effect, in
+ *      ns per frame: the columns of Effects_Benchmark(), so two runs
+ *      compare with tools/benchdiff.py.
+ *
+ * The wire time is 0 (HostDmac_SetByteNs() unset): every transfer ends at
+ * the next wait, so the timing is the CPU's alone.
+ * ============================================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "definitions.h"
+#include "hostregs.h"
+#include "neopixel.h"
+#include "effects.h"
+#include "actuator.h"
+#include "dma_qos.h"
+#include "dmamem.h"
+#include "palette.h"
+#include "fire.h"
+#include "particles.h"
+#include "showclock.h"
+#include "rng.h"
+#include "framestat.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define TEST_FRAMES         200u        /* timed frames per effect, argv[1] */
+#define TEST_WARMUP         4u          /* untimed frames after Effects_Init() */
+#define TEST_SEED           1u          /* TRNG sequence: repeatable runs */
+#define TEST_FRAME_US       20000u      /* FrameStat_Init(), 50 Hz */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define TEST_WIRE_BYTES     (NEO_SEG_BUF_SIZE + NEO_RESET_BEATS * NEO_DMA_BEAT)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static unsigned test_failures;
+
+static const struct { uint8_t r, g, b; } test_px[] =
+{
+    { 255u,   0u,   0u },
+    {   0u, 255u,   0u },
+    {   0u,   0u, 255u },
+    { 255u, 255u, 255u },
+};
+
+/* -- Helpers ----------------------------------------------------------------- */
+
+static void fail(const char *what, unsigned long at, unsigned long got, unsigned long want)
+{
+    printf("FAIL %s at %lu: 0x%lx, expected 0x%lx\n", what, at, got, want);
+    test_failures++;
+}
+
+/* Colour byte from its NEO_SPI_BITS SPI bytes; -1 if a bit cell is neither code */
+static int wire_byte(const uint8_t *p)
+{
+    uint32_t bits = 0u;
+    int      v    = 0;
+
+    for (uint8_t i = 0; i < NEO_ENC_BYTES; i++)
+        bits = (bits << 8) | p[i];
+    for (int8_t n = 7; n >= 0; n--)
+    {
+        uint32_t cell = (bits >> ((uint32_t)n * NEO_SPI_BITS)) & ((1u << NEO_SPI_BITS) - 1u);
+
+        if (cell == NEO_SPI_ONE)       v = (v << 1) | 1;
+        else if (cell == NEO_SPI_ZERO) v <<= 1;
+        else return -1;
+    }
+    return v;
+}
+
+/* -- Checks ------------------------------------------------------------------ */
+
+static void test_selftest(void)
+{
+    uint8_t f = NeoPixel_SelfTest();
+
+    if (f != 0u) fail("NeoPixel_SelfTest", 0u, f, 0u);
+}
+
+static void test_wire(void)
+{
+    static const uint8_t order[NEO_CHANNELS] = NEO_WIRE_ORDER;
+    const uint8_t *w;
+    uint32_t       len;
+    neo_tx_stats_t st;
+
+    /* 0 and 255 go through gamma, brightness and balance unchanged */
+    NeoPixel_SetBrightness(255u);
+    NeoPixel_SetWhiteBalance(255u, 255u, 255u);
+    NeoPixel_Clear();
+    for (uint16_t i = 0; i < sizeof(test_px) / sizeof(test_px[0]); i++)
+        NeoPixel_SetPixel(i, test_px[i].r, test_px[i].g, test_px[i].b);
+    NeoPixel_Show();
+    NeoPixel_Wait();
+
+    w = HostDmac_Wire(DMAC_CHANNEL_NEO, &len);
+    if (len != TEST_WIRE_BYTES) fail("wire length", 0u, len, TEST_WIRE_BYTES);
+    if (len > TEST_WIRE_BYTES) len = TEST_WIRE_BYTES;
+
+    for (uint32_t i = 0; i < NEO_SEG_LEDS && (i + 1u) * NEO_LED_BYTES <= len; i++)
+    {
+        for (uint8_t s = 0; s < NEO_CHANNELS; s++)
+        {
+            uint8_t rgb[3] = { 0u, 0u, 0u };
+            int     got    = wire_byte(&w[i * NEO_LED_BYTES + s * NEO_ENC_BYTES]);
+
+            if (i < sizeof(test_px) / sizeof(test_px[0]))
+            {
+                rgb[0] = test_px[i].r;
+                rgb[1] = test_px[i].g;
+                rgb[2] = test_px[i].b;
+            }
+            if (got != ((order[s] < 3u) ? rgb[order[s]] : 0))
+                fail("wire pixel byte", i * NEO_CHANNELS + s, (unsigned long)got,
+                     (order[s] < 3u) ? rgb[order[s]] : 0u);
+        }
+    }
+    for (uint32_t n = NEO_SEG_LEDS * NEO_LED_BYTES; n < len; n++)
+        if (w[n] != 0u) fail("wire padding / reset tail", n, w[n], 0u);
+
+    NeoPixel_GetStats(&st);
+    if (st.frames == 0u) fail("frames started", 0u, 0u, 1u);
+}
+
+static void test_patterns(void)
+{
+    uint8_t k = 0;
+
+    for (const act_step_t *seq; (seq = Actuator_Pattern(k)) != NULL; k++)
+    {
+        uint8_t pc = 0;
+
+        while (pc < ACT_SEQ_MAX_STEPS && seq[pc].op != ACT_OP_END)
+        {
+            const act_step_t *s = &seq[pc];
+
+            if (s->op > ACT_OP_GOTO) fail("actuator op", k * 256u + pc, s->op, ACT_OP_GOTO);
+            if (s->op == ACT_OP_LOOP && s->arg > pc)
+                fail("actuator loop", k * 256u + pc, s->arg, pc);
+            pc++;
+        }
+        if (pc == ACT_SEQ_MAX_STEPS) fail("actuator sequence end", k, pc, ACT_SEQ_MAX_STEPS - 1u);
+    }
+    if (k == 0u) fail("actuator patterns", 0u, 0u, 1u);
+}
+
+static void test_timing(uint32_t frames)
+{
+    neo_tx_stats_t st;
+
+    Effects_SetBudget(0u);              /* every effect runs, whatever it costs */
+    printf("bench,backend,effect,slot,frames,min,avg,max\n");
+
+    for (uint32_t id = 0; id < Effects_Count(); id++)
+    {
+        uint64_t lo = UINT64_MAX, hi = 0u, sum = 0u;
+
+        Effects_Init((effect_id_t)id);
+        for (uint32_t f = 0; f < TEST_WARMUP; f++)
+            (void)Effects_Render(1u);
+
+        for (uint32_t f = 0; f < frames; f++)
+        {
+            uint64_t t0 = Host_Ns();
+
+            (void)Effects_Render(1u);
+
+            uint64_t dt = Host_Ns() - t0;
+
+            sum += dt;
+            if (dt < lo) lo = dt;
+            if (dt > hi) hi = dt;
+        }
+        printf("bench,host,%s,render,%lu,%llu,%llu,%llu\n", Effects_Name((effect_id_t)id),
+               (unsigned long)frames, (unsigned long long)lo,
+               (unsigned long long)(sum / frames), (unsigned long long)hi);
+    }
+
+    NeoPixel_GetStats(&st);
+    if (st.dma_errors != 0u) fail("DMA errors", 0u, st.dma_errors, 0u);
+    if (st.timeouts != 0u)   fail("transfer timeouts", 0u, st.timeouts, 0u);
+}
+
+/* -- Main -------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : TEST_FRAMES;
+
+    if (frames == 0u) frames = TEST_FRAMES;
+
+    Host_MapRegisters();
+    HostTrng_Seed(TEST_SEED);
+    DMAC_Initialize();
+    ShowClock_Init();
+    NeoPixel_Init();
+    Rng_Init();
+    Dma_Init();
+    DmaMem_Init();
+    Palette_Init();
+    Fire_Init();
+    Particles_Init();
+    FrameStat_Init(TEST_FRAME_US);
+
+    test_selftest();
+    test_wire();
+    test_patterns();
+    test_timing(frames);
+
+    printf("%s: %u failure(s)\n", (test_failures == 0u) ? "PASS" : "FAIL", test_failures);
+    return (test_failures == 0u) ? 0 : 1;
+}
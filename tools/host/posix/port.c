@@ -0,0 +1,564 @@
+/* =============================================================================
+ * port.c  -  FreeRTOS port layer on POSIX threads, for the host simulation
+ *            (tools/host, "make sim")
+ * Target : Linux x86-64, GCC
+ *
+ * Written for this project after the FreeRTOS Kernel's POSIX port
+ * (portable/ThirdParty/GCC/Posix, MIT, Copyright (C) 2021 Amazon.com, Inc.
+ * or its affiliates), whose license below it keeps; it is not that port
+ * and is not vendored kernel code.
+ *
+ * Where it differs from the kernel's port: a switch requested inside the
+ * tick (the tick hook's FromISR calls) waits for the handler to end, as
+ * PendSV would; portSET_INTERRUPT_MASK_FROM_ISR() really masks the tick;
+ * a task's code runs on its thread's own pthread stack.
+ *
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ * ============================================================================= */
+
+/*-----------------------------------------------------------
+* Implementation of functions defined in portable.h for the Posix port.
+*
+* Each task has a pthread which eases use of standard debuggers
+* (allowing backtraces of tasks etc). Threads for tasks that are not
+* running are blocked in prvSuspendSelf() on their own event; only the
+* thread of the current task runs FreeRTOS code at any time.
+*
+* The tick is SIGALRM, sent to the thread of the current task once per
+* tick period by a timer thread. Masking interrupts is blocking SIGALRM in
+* that thread, so a thread that is not running and entered its suspension
+* from a critical section or the handler keeps it blocked until resumed.
+* A switch requested from inside the handler (the tick hook's FromISR
+* calls) is held until the handler ends, as PendSV would be.
+*
+* Task stacks are not used for the task's code: each thread has its own
+* pthread stack. The top of the FreeRTOS stack holds the thread's data.
+*----------------------------------------------------------*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "list.h"
+#include "wait_for_event.h"
+/*-----------------------------------------------------------*/
+
+#define SIG_RESUME    SIGUSR1
+#define SIG_TICK      SIGALRM
+
+typedef struct THREAD
+{
+    pthread_t pthread;
+    TaskFunction_t pxCode;
+    void * pvParams;
+    BaseType_t xDying;
+    struct event * ev;
+} Thread_t;
+
+/*
+ * The additional per-thread data is stored at the beginning of the
+ * task's stack.
+ */
+static inline Thread_t * prvGetThreadFromTask( TaskHandle_t xTask )
+{
+    StackType_t * pxTopOfStack = *( StackType_t ** ) xTask;
+
+    return ( Thread_t * ) ( pxTopOfStack + 1 );
+}
+
+/*-----------------------------------------------------------*/
+
+static pthread_once_t hSigSetupThread = PTHREAD_ONCE_INIT;
+static sigset_t xTickSignal;
+static pthread_t hMainThread;
+static pthread_t hTimerTickThread;
+static volatile BaseType_t xTimerTickThreadShouldRun;
+static volatile UBaseType_t uxCriticalNesting;
+static volatile BaseType_t xSchedulerStarted = pdFALSE;
+static volatile BaseType_t xSchedulerEnd = pdFALSE;
+static volatile BaseType_t xInsideInterrupt = pdFALSE;
+static volatile BaseType_t xSwitchPending = pdFALSE;
+/*-----------------------------------------------------------*/
+
+static void prvSetupSignalsAndSchedulerPolicy( void );
+static void prvSetupTimerInterrupt( void );
+static void * prvWaitForStart( void * pvParams );
+static void prvSwitchThread( Thread_t * pxThreadToResume,
+                             Thread_t * pxThreadToSuspend );
+static void prvSuspendSelf( Thread_t * thread );
+static void prvResumeThread( Thread_t * xThreadId );
+static void vPortSystemTickHandler( int sig );
+static void vPortStartFirstTask( void );
+static void prvPortYieldFromTask( void );
+/*-----------------------------------------------------------*/
+
+static void prvFatalError( const char * pcCall,
+                           int iErrno ) __attribute__( ( __noreturn__ ) );
+
+void prvFatalError( const char * pcCall,
+                    int iErrno )
+{
+    fprintf( stderr, "%s: %s\n", pcCall, strerror( iErrno ) );
+    abort();
+}
+
+/*
+ * See header file for description.
+ */
+StackType_t * pxPortInitialiseStack( StackType_t * pxTopOfStack,
+                                     StackType_t * pxEndOfStack,
+                                     TaskFunction_t pxCode,
+                                     void * pvParameters )
+{
+    Thread_t * thread;
+    pthread_attr_t xThreadAttributes;
+    sigset_t xSavedMask;
+    int iRet;
+
+    ( void ) pthread_once( &hSigSetupThread, prvSetupSignalsAndSchedulerPolicy );
+
+    /*
+     * Store the additional thread data at the start of the stack.
+     */
+    thread = ( Thread_t * ) ( pxTopOfStack + 1 ) - 1;
+    pxTopOfStack = ( StackType_t * ) thread - 1;
+
+    if( ( StackType_t * ) thread <= pxEndOfStack )
+    {
+        prvFatalError( "pxPortInitialiseStack", ENOMEM );
+    }
+
+    thread->pxCode = pxCode;
+    thread->pvParams = pvParameters;
+    thread->xDying = pdFALSE;
+    thread->ev = event_create();
+
+    if( thread->ev == NULL )
+    {
+        prvFatalError( "event_create", ENOMEM );
+    }
+
+    pthread_attr_init( &xThreadAttributes );
+
+    /* The new thread starts with the tick blocked, whoever creates it. */
+    pthread_sigmask( SIG_BLOCK, &xTickSignal, &xSavedMask );
+    iRet = pthread_create( &thread->pthread, &xThreadAttributes, prvWaitForStart, thread );
+    pthread_sigmask( SIG_SETMASK, &xSavedMask, NULL );
+    pthread_attr_destroy( &xThreadAttributes );
+
+    if( iRet != 0 )
+    {
+        prvFatalError( "pthread_create", iRet );
+    }
+
+    return pxTopOfStack;
+}
+/*-----------------------------------------------------------*/
+
+void vPortStartFirstTask( void )
+{
+    Thread_t * pxFirstThread = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+    /* Start the first task. */
+    prvResumeThread( pxFirstThread );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+BaseType_t xPortStartScheduler( void )
+{
+    int iSignal;
+    sigset_t xSignals;
+
+    hMainThread = pthread_self();
+
+    /* The main thread only waits for vPortEndScheduler() from here on. */
+    sigemptyset( &xSignals );
+    sigaddset( &xSignals, SIG_RESUME );
+    pthread_sigmask( SIG_BLOCK, &xSignals, NULL );
+    pthread_sigmask( SIG_BLOCK, &xTickSignal, NULL );
+
+    xSchedulerStarted = pdTRUE;
+
+    /* Start the timer that generates the tick ISR(SIGALRM).
+     * Interrupts are disabled here already. */
+    prvSetupTimerInterrupt();
+
+    /* Start the first task. */
+    vPortStartFirstTask();
+
+    /* Wait until signaled by vPortEndScheduler(). */
+    while( xSchedulerEnd != pdTRUE )
+    {
+        sigwait( &xSignals, &iSignal );
+    }
+
+    /* Stop the timer tick thread. */
+    xTimerTickThreadShouldRun = pdFALSE;
+    pthread_join( hTimerTickThread, NULL );
+
+    /* Restore the original signal mask. */
+    pthread_sigmask( SIG_UNBLOCK, &xSignals, NULL );
+    pthread_sigmask( SIG_UNBLOCK, &xTickSignal, NULL );
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+    xSchedulerEnd = pdTRUE;
+    pthread_kill( hMainThread, SIG_RESUME );
+
+    /* The calling task never runs again. */
+    prvSuspendSelf( prvGetThreadFromTask( xTaskGetCurrentTaskHandle() ) );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+    if( uxCriticalNesting == 0 )
+    {
+        vPortDisableInterrupts();
+    }
+
+    uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+    uxCriticalNesting--;
+
+    /* If we have reached 0 then re-enable the interrupts. */
+    if( uxCriticalNesting == 0 )
+    {
+        vPortEnableInterrupts();
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvPortYieldFromTask( void )
+{
+    Thread_t * xThreadToSuspend;
+    Thread_t * xThreadToResume;
+
+    xThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+    vTaskSwitchContext();
+
+    xThreadToResume = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+    prvSwitchThread( xThreadToResume, xThreadToSuspend );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+    if( xSchedulerStarted == pdFALSE )
+    {
+        return;
+    }
+
+    if( xInsideInterrupt != pdFALSE )
+    {
+        /* Switched when the tick handler returns. */
+        xSwitchPending = pdTRUE;
+        return;
+    }
+
+    vPortEnterCritical();
+
+    prvPortYieldFromTask();
+
+    vPortExitCritical();
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+    pthread_sigmask( SIG_BLOCK, &xTickSignal, NULL );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+    pthread_sigmask( SIG_UNBLOCK, &xTickSignal, NULL );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortSetInterruptMask( void )
+{
+    sigset_t xOld;
+
+    /* Also from task code (taskENTER_CRITICAL_FROM_ISR() there): really
+     * mask, and report whether the tick was masked before. */
+    pthread_sigmask( SIG_BLOCK, &xTickSignal, &xOld );
+
+    return ( sigismember( &xOld, SIG_TICK ) == 1 ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMask( BaseType_t xMask )
+{
+    if( xMask == pdFALSE )
+    {
+        pthread_sigmask( SIG_UNBLOCK, &xTickSignal, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortIsInsideInterrupt( void )
+{
+    return xInsideInterrupt;
+}
+/*-----------------------------------------------------------*/
+
+static void * prvTimerTickHandler( void * arg )
+{
+    struct timespec xNext;
+
+    ( void ) arg;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNext );
+
+    while( xTimerTickThreadShouldRun != pdFALSE )
+    {
+        xNext.tv_nsec += ( long ) portTICK_RATE_MICROSECONDS * 1000L;
+
+        if( xNext.tv_nsec >= 1000000000L )
+        {
+            xNext.tv_nsec -= 1000000000L;
+            xNext.tv_sec++;
+        }
+
+        /* Absolute: the tick keeps its rate however long a signal takes. */
+        while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &xNext, NULL ) == EINTR )
+        {
+        }
+
+        /* Signal the current thread to run the tick handler. */
+        pthread_kill( prvGetThreadFromTask( xTaskGetCurrentTaskHandle() )->pthread, SIG_TICK );
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Setup the systick timer to generate the tick interrupts at the required
+ * frequency.
+ */
+void prvSetupTimerInterrupt( void )
+{
+    int iRet;
+
+    xTimerTickThreadShouldRun = pdTRUE;
+    iRet = pthread_create( &hTimerTickThread, NULL, prvTimerTickHandler, NULL );
+
+    if( iRet != 0 )
+    {
+        prvFatalError( "pthread_create", iRet );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void vPortSystemTickHandler( int sig )
+{
+    Thread_t * pxThreadToSuspend;
+    Thread_t * pxThreadToResume;
+    BaseType_t xSwitchRequired;
+
+    ( void ) sig;
+
+    uxCriticalNesting++; /* Signals are blocked in this signal handler. */
+    xInsideInterrupt = pdTRUE;
+
+    pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+    xSwitchRequired = xTaskIncrementTick();
+
+    if( xSwitchPending != pdFALSE )
+    {
+        xSwitchPending = pdFALSE;
+        xSwitchRequired = pdTRUE;
+    }
+
+    xInsideInterrupt = pdFALSE;
+
+    if( xSwitchRequired != pdFALSE )
+    {
+        /* Select Next Task. */
+        vTaskSwitchContext();
+
+        pxThreadToResume = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+        prvSwitchThread( pxThreadToResume, pxThreadToSuspend );
+    }
+
+    uxCriticalNesting--;
+}
+/*-----------------------------------------------------------*/
+
+void vPortThreadDying( void * pxTaskToDelete,
+                       volatile BaseType_t * pxPendYield )
+{
+    Thread_t * pxThread = prvGetThreadFromTask( pxTaskToDelete );
+
+    ( void ) pxPendYield;
+
+    pxThread->xDying = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortCancelThread( void * pxTaskToDelete )
+{
+    Thread_t * pxThreadToCancel = prvGetThreadFromTask( pxTaskToDelete );
+
+    /* A task deleted by another is suspended, so it can be safely
+     * cancelled; one that deleted itself has ended its thread already. */
+    if( pxThreadToCancel->xDying == pdFALSE )
+    {
+        pthread_cancel( pxThreadToCancel->pthread );
+    }
+
+    pthread_join( pxThreadToCancel->pthread, NULL );
+    event_delete( pxThreadToCancel->ev );
+}
+/*-----------------------------------------------------------*/
+
+static void * prvWaitForStart( void * pvParams )
+{
+    Thread_t * pxThread = pvParams;
+
+    prvSuspendSelf( pxThread );
+
+    /* Resumed for the first time, unblocks all signals. */
+    uxCriticalNesting = 0;
+    vPortEnableInterrupts();
+
+    /* Call the task's entry point. */
+    pxThread->pxCode( pxThread->pvParams );
+
+    /* A function that implements a task must not exit or attempt to return to
+     * the caller function as there is nothing to return to. If it is required
+     * to exit a task then it should be deleted (by calling vTaskDelete(NULL))
+     * before reaching the end of the function. */
+    configASSERT( pdFALSE );
+
+    vTaskDelete( NULL );
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSwitchThread( Thread_t * pxThreadToResume,
+                             Thread_t * pxThreadToSuspend )
+{
+    BaseType_t uxSavedCriticalNesting;
+
+    if( pxThreadToSuspend != pxThreadToResume )
+    {
+        /*
+         * Switch tasks.
+         *
+         * The critical section nesting is per-task, so save it on the
+         * stack of the current (suspending thread), restoring it when
+         * we switch back to this task.
+         */
+        uxSavedCriticalNesting = uxCriticalNesting;
+
+        prvResumeThread( pxThreadToResume );
+
+        if( pxThreadToSuspend->xDying == pdTRUE )
+        {
+            pthread_exit( NULL );
+        }
+
+        prvSuspendSelf( pxThreadToSuspend );
+
+        uxCriticalNesting = uxSavedCriticalNesting;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSuspendSelf( Thread_t * thread )
+{
+    /*
+     * Suspend this thread by waiting for its event.
+     *
+     * A suspended thread must not handle signals (interrupts) so
+     * all signals must be blocked by calling this from:
+     *
+     * - Inside a critical section (vPortEnterCritical() /
+     *   vPortExitCritical()).
+     *
+     * - From a signal handler that has all signals masked.
+     *
+     * - A thread with all signals blocked with pthread_sigmask().
+     */
+    event_wait( thread->ev );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvResumeThread( Thread_t * xThreadId )
+{
+    event_signal( xThreadId->ev );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupSignalsAndSchedulerPolicy( void )
+{
+    struct sigaction sigtick;
+    int iRet;
+
+    sigemptyset( &xTickSignal );
+    sigaddset( &xTickSignal, SIG_TICK );
+
+    /* The handler runs with the tick blocked: one tick at a time. */
+    memset( &sigtick, 0, sizeof( sigtick ) );
+    sigtick.sa_flags = 0;
+    sigtick.sa_handler = vPortSystemTickHandler;
+    sigfillset( &sigtick.sa_mask );
+
+    iRet = sigaction( SIG_TICK, &sigtick, NULL );
+
+    if( iRet == -1 )
+    {
+        prvFatalError( "sigaction", errno );
+    }
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,139 @@
+/* =============================================================================
+ * rtos_test.c  -  The kernel calls of the host test build (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * One pseudo-task runs everything, with no scheduler behind it (portmacro.h
+ * in shim/rtos). A take that finds no notification runs the DMAC model
+ * until one arrives: the interrupt that would have woken the task runs in
+ * the waiter's place. A wait nothing can end is a timeout, or, for
+ * portMAX_DELAY, a fatal error: on the target it would hang.
+ * ============================================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "stream_buffer.h"
+#include "definitions.h"
+#include "hostregs.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint8_t  rtos_task;                      /* its address is the handle */
+static uint32_t rtos_notify[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+static uint8_t  rtos_pending[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+static uint64_t rtos_t0;
+
+/* -- Public API implementation ----------------------------------------------- */
+
+TickType_t xTaskGetTickCount(void)
+{
+    uint64_t now = Host_Ns();
+
+    if (rtos_t0 == 0u) rtos_t0 = now;
+    return (TickType_t)((now - rtos_t0) / (1000000000u / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    return taskSCHEDULER_RUNNING;       /* modules take their task paths (DMA copies, waits) */
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)(void *)&rtos_task;
+}
+
+uint32_t ulTaskGenericNotifyTake(UBaseType_t uxIndexToWaitOn, BaseType_t xClearCountOnExit,
+                                 TickType_t xTicksToWait)
+{
+    while (rtos_notify[uxIndexToWaitOn] == 0u)
+    {
+        if (xTicksToWait == 0u) return 0u;
+        if (HostDmac_Run(UINT64_MAX) == 0u)
+        {
+            if (xTicksToWait != portMAX_DELAY) return 0u;
+            fprintf(stderr, "rtos_test: notify take %lu blocks forever\n", (unsigned long)uxIndexToWaitOn);
+            exit(2);
+        }
+    }
+
+    uint32_t v = rtos_notify[uxIndexToWaitOn];
+
+    rtos_notify[uxIndexToWaitOn]  = (xClearCountOnExit != pdFALSE) ? 0u : v - 1u;
+    rtos_pending[uxIndexToWaitOn] = 0u;
+    return v;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify, uint32_t ulValue,
+                              eNotifyAction eAction, uint32_t *pulPreviousNotificationValue)
+{
+    uint32_t *v = &rtos_notify[uxIndexToNotify];
+
+    (void)xTaskToNotify;
+    if (pulPreviousNotificationValue != NULL) *pulPreviousNotificationValue = *v;
+    switch (eAction)
+    {
+    case eSetBits:                  *v |= ulValue; break;
+    case eIncrement:                (*v)++;        break;
+    case eSetValueWithOverwrite:    *v = ulValue;  break;
+    case eSetValueWithoutOverwrite:
+        if (rtos_pending[uxIndexToNotify] != 0u) return pdFAIL;
+        *v = ulValue;
+        break;
+    default:                        break;
+    }
+    rtos_pending[uxIndexToNotify] = 1u;
+    return pdPASS;
+}
+
+BaseType_t xTaskGenericNotifyFromISR(TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify, uint32_t ulValue,
+                                     eNotifyAction eAction, uint32_t *pulPreviousNotificationValue,
+                                     BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdFALSE;
+    return xTaskGenericNotify(xTaskToNotify, uxIndexToNotify, ulValue, eAction, pulPreviousNotificationValue);
+}
+
+void vTaskGenericNotifyGiveFromISR(TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify,
+                                   BaseType_t *pxHigherPriorityTaskWoken)
+{
+    (void)xTaskGenericNotifyFromISR(xTaskToNotify, uxIndexToNotify, 0u, eIncrement, NULL,
+                                    pxHigherPriorityTaskWoken);
+}
+
+/* Queues and stream buffers exist, but nothing in the test build feeds them */
+QueueHandle_t xQueueGenericCreateStatic(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize,
+                                        uint8_t *pucQueueStorage, StaticQueue_t *pxStaticQueue,
+                                        const uint8_t ucQueueType)
+{
+    (void)uxQueueLength;
+    (void)uxItemSize;
+    (void)pucQueueStorage;
+    (void)ucQueueType;
+    return (QueueHandle_t)(void *)pxStaticQueue;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait)
+{
+    (void)xQueue;
+    (void)pvBuffer;
+    (void)xTicksToWait;
+    return pdFAIL;
+}
+
+size_t xStreamBufferSendFromISR(StreamBufferHandle_t xStreamBuffer, const void *pvTxData,
+                                size_t xDataLengthBytes, BaseType_t * const pxHigherPriorityTaskWoken)
+{
+    (void)xStreamBuffer;
+    (void)pvTxData;
+    (void)xDataLengthBytes;
+    if (pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdFALSE;
+    return 0u;
+}
@@ -0,0 +1,156 @@
+/* =============================================================================
+ * cmsis_compiler.h  -  CMSIS compiler layer for the host builds (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * Forced into every translation unit (-include) ahead of the device header,
+ * so the CMSIS core (core_cm4.h) and the DFP headers compile as they are:
+ * the include guards below keep the ARM cmsis_compiler.h and cmsis_gcc.h
+ * out, and the intrinsics the firmware uses get plain C bodies. The core's
+ * register blocks (SCB, NVIC, DWT, SysTick) are real addresses, backed by
+ * host memory from Host_MapRegisters() (hostregs.h).
+ *
+ * Interrupt masking is a no-op in the test build: it has no interrupts of
+ * its own. In the simulation (HOST_SIM) the interrupts are the POSIX
+ * port's tick signal: PRIMASK and BASEPRI both block it (sim/sim.h), and
+ * IPSR is nonzero inside the handler. __ARM_FEATURE_DSP stays undefined,
+ * so pixmath.h and adpcm.c take their portable C paths.
+ * ============================================================================= */
+
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __ASM                       __asm
+#define __INLINE                    inline
+#define __STATIC_INLINE             static inline
+#define __STATIC_FORCEINLINE        __attribute__((always_inline)) static inline
+#define __NO_RETURN                 __attribute__((__noreturn__))
+#define __USED                      __attribute__((used))
+#define __WEAK                      __attribute__((weak))
+#define __PACKED                    __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT             struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION              union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)                __attribute__((aligned(x)))
+#define __RESTRICT                  __restrict
+#define __COMPILER_BARRIER()        __asm volatile ("" ::: "memory")
+
+__PACKED_STRUCT T_UINT16_READ  { uint16_t v; };
+__PACKED_STRUCT T_UINT16_WRITE { uint16_t v; };
+__PACKED_STRUCT T_UINT32_READ  { uint32_t v; };
+__PACKED_STRUCT T_UINT32_WRITE { uint32_t v; };
+#define __UNALIGNED_UINT16_READ(addr)       (((const struct T_UINT16_READ *)(const void *)(addr))->v)
+#define __UNALIGNED_UINT16_WRITE(addr, val) (void)((((struct T_UINT16_WRITE *)(void *)(addr))->v) = (val))
+#define __UNALIGNED_UINT32_READ(addr)       (((const struct T_UINT32_READ *)(const void *)(addr))->v)
+#define __UNALIGNED_UINT32_WRITE(addr, val) (void)((((struct T_UINT32_WRITE *)(void *)(addr))->v) = (val))
+
+/* -- Barriers, hints --------------------------------------------------------- */
+#define __NOP()                     __asm volatile ("nop")
+#define __DSB()                     __sync_synchronize()
+#define __DMB()                     __sync_synchronize()
+#define __ISB()                     __sync_synchronize()
+#define __WFI()                     ((void)0)
+#define __WFE()                     ((void)0)
+#define __SEV()                     ((void)0)
+#define __BKPT(value)               __builtin_trap()
+
+/* -- Core registers: no exceptions, thread mode, nothing masked ------------- */
+#ifdef HOST_SIM
+void     HostSim_IrqMask(uint32_t masked);
+uint32_t HostSim_IrqMasked(void);
+uint32_t HostSim_IrqActive(void);
+
+__STATIC_FORCEINLINE void     __enable_irq(void)            { HostSim_IrqMask(0u); }
+__STATIC_FORCEINLINE void     __disable_irq(void)           { HostSim_IrqMask(1u); }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void)           { return HostSim_IrqMasked(); }
+__STATIC_FORCEINLINE void     __set_PRIMASK(uint32_t v)     { HostSim_IrqMask(v & 1u); }
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void)           { return HostSim_IrqMasked() << 5; }
+__STATIC_FORCEINLINE void     __set_BASEPRI(uint32_t v)     { HostSim_IrqMask(v != 0u); }
+__STATIC_FORCEINLINE void     __set_BASEPRI_MAX(uint32_t v) { if (v != 0u) HostSim_IrqMask(1u); }
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void)              { return HostSim_IrqActive() ? 16u : 0u; }
+#else
+__STATIC_FORCEINLINE void     __enable_irq(void)            { }
+__STATIC_FORCEINLINE void     __disable_irq(void)           { }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void)           { return 0u; }
+__STATIC_FORCEINLINE void     __set_PRIMASK(uint32_t v)     { (void)v; }
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void)           { return 0u; }
+__STATIC_FORCEINLINE void     __set_BASEPRI(uint32_t v)     { (void)v; }
+__STATIC_FORCEINLINE void     __set_BASEPRI_MAX(uint32_t v) { (void)v; }
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void)              { return 0u; }
+#endif
+__STATIC_FORCEINLINE void     __enable_fault_irq(void)      { }
+__STATIC_FORCEINLINE void     __disable_fault_irq(void)     { }
+__STATIC_FORCEINLINE uint32_t __get_FAULTMASK(void)         { return 0u; }
+__STATIC_FORCEINLINE void     __set_FAULTMASK(uint32_t v)   { (void)v; }
+__STATIC_FORCEINLINE uint32_t __get_CONTROL(void)           { return 0u; }
+__STATIC_FORCEINLINE void     __set_CONTROL(uint32_t v)     { (void)v; }
+__STATIC_FORCEINLINE uint32_t __get_FPSCR(void)             { return 0u; }
+__STATIC_FORCEINLINE void     __set_FPSCR(uint32_t v)       { (void)v; }
+__STATIC_FORCEINLINE uint32_t __get_MSP(void)               { return 0u; }
+__STATIC_FORCEINLINE uint32_t __get_PSP(void)               { return 0u; }
+
+/* -- Bit operations ---------------------------------------------------------- */
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t v)             { return __builtin_bswap32(v); }
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t v)           { return ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu); }
+__STATIC_FORCEINLINE int16_t  __REVSH(int16_t v)            { return (int16_t)__builtin_bswap16((uint16_t)v); }
+__STATIC_FORCEINLINE uint32_t __ROR(uint32_t v, uint32_t n) { n &= 31u; return (n == 0u) ? v : (v >> n) | (v << (32u - n)); }
+__STATIC_FORCEINLINE uint8_t  __CLZ(uint32_t v)             { return (v == 0u) ? 32u : (uint8_t)__builtin_clz(v); }
+
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t v)
+{
+    uint32_t r = 0u;
+
+    for (uint8_t i = 0; i < 32u; i++, v >>= 1)
+        r = (r << 1) | (v & 1u);
+    return r;
+}
+
+__STATIC_FORCEINLINE int32_t __SSAT(int32_t v, uint32_t bits)
+{
+    const int32_t max = (int32_t)((1u << (bits - 1u)) - 1u);
+
+    return (v > max) ? max : (v < -max - 1) ? -max - 1 : v;
+}
+
+__STATIC_FORCEINLINE uint32_t __USAT(int32_t v, uint32_t bits)
+{
+    const uint32_t max = (1u << bits) - 1u;
+
+    return (v < 0) ? 0u : ((uint32_t)v > max) ? max : (uint32_t)v;
+}
+
+/* -- Exclusive access --------------------------------------------------------
+ * The store is a compare-and-swap against the value the load saw, per
+ * thread (a task is a thread in the simulation): it fails if an interrupt
+ * or another task wrote the word in between, as a cleared monitor would. */
+extern __thread uint32_t host_excl;
+
+__STATIC_FORCEINLINE uint8_t  __LDREXB(volatile uint8_t *p)  { return (uint8_t)(host_excl = *p); }
+__STATIC_FORCEINLINE uint16_t __LDREXH(volatile uint16_t *p) { return (uint16_t)(host_excl = *p); }
+__STATIC_FORCEINLINE uint32_t __LDREXW(volatile uint32_t *p) { return host_excl = *p; }
+
+__STATIC_FORCEINLINE uint32_t __STREXB(uint8_t v, volatile uint8_t *p)
+{
+    uint8_t seen = (uint8_t)host_excl;
+
+    return __atomic_compare_exchange_n(p, &seen, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 0u : 1u;
+}
+
+__STATIC_FORCEINLINE uint32_t __STREXH(uint16_t v, volatile uint16_t *p)
+{
+    uint16_t seen = (uint16_t)host_excl;
+
+    return __atomic_compare_exchange_n(p, &seen, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 0u : 1u;
+}
+
+__STATIC_FORCEINLINE uint32_t __STREXW(uint32_t v, volatile uint32_t *p)
+{
+    uint32_t seen = host_excl;
+
+    return __atomic_compare_exchange_n(p, &seen, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 0u : 1u;
+}
+
+__STATIC_FORCEINLINE void     __CLREX(void)                  { }
+
+#endif /* __CMSIS_COMPILER_H */
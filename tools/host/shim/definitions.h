@@ -0,0 +1,39 @@
+/* =============================================================================
+ * definitions.h  -  The MCC umbrella header, for the host builds (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * Found ahead of src/config/default/definitions.h. The device header, the
+ * CMSIS core and the plib headers that only declare or touch registers are
+ * the firmware's own (the registers are host memory, hostregs.h); the DMAC
+ * and TRNG plibs are replaced by shims whose implementations model them
+ * (dmac_host.c, trng_host.c).
+ * ============================================================================= */
+
+#ifndef DEFINITIONS_H
+#define DEFINITIONS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "peripheral/nvmctrl/plib_nvmctrl.h"
+#include "peripheral/tcc/plib_tcc0.h"
+#include "peripheral/evsys/plib_evsys.h"
+#include "peripheral/port/plib_port.h"
+#include "peripheral/clock/plib_clock.h"
+#include "peripheral/nvic/plib_nvic.h"
+#include "peripheral/dmac/plib_dmac.h"          /* shim */
+#include "peripheral/cmcc/plib_cmcc.h"
+#include "peripheral/trng/plib_trng.h"          /* shim */
+#include "peripheral/sercom/usart/plib_sercom5_usart.h"
+
+#define DEVICE_NAME          "ATSAME51J20A"
+#define DEVICE_ARCH          "CORTEX-M4"
+#define DEVICE_FAMILY        "SAME"
+#define DEVICE_SERIES        "SAME51"
+
+#define CPU_CLOCK_FREQUENCY 120000000U
+
+void SYS_Initialize(void *data);
+
+#endif /* DEFINITIONS_H */
@@ -0,0 +1,116 @@
+/* =============================================================================
+ * plib_dmac.h  -  DMAC plib shim for the host builds (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * Same interface as src/config/default/peripheral/dmac/plib_dmac.h, with
+ * the plib and the DMAC itself modelled in dmac_host.c. Channels started
+ * through the plib and channels the firmware starts by hand (the
+ * descriptor at DMAC_BASEADDR, then CHCTRLA.ENABLE: dmamem.c, crc.c, ...)
+ * run the same way: block by block along the DESCADDR chain, each block's
+ * beats copied when it ends, a block with BLOCKACT INT raising TCMPL. As
+ * on the chip the interrupt takes dma_qos.c's vectors: DMAC_0_Handler()
+ * to DMAC_3_Handler() for the plib's channels, into a fast handler or the
+ * modelled plib handler and its callback, DMAC_OTHER_Handler() for the rest.
+ *
+ * Time is the host's: a block ends HostDmac_SetByteNs() nanoseconds per
+ * byte after it started, 0 (the default) at the next HostDmac_Run().
+ * Bytes written to a peripheral (a destination in the register space,
+ * hostregs.h) are kept per channel for HostDmac_Wire(); the CRC engine
+ * is not modelled.
+ * ============================================================================= */
+
+#ifndef PLIB_DMAC_H
+#define PLIB_DMAC_H
+
+#include <device.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define DMAC_CRC_BEAT_SIZE_BYTE     (0x0U)
+#define DMAC_CRC_BEAT_SIZE_HWORD    (0x1U)
+#define DMAC_CRC_BEAT_SIZE_WORD     (0x2U)
+
+typedef uint8_t DMAC_CRC_BEAT_SIZE;
+
+#define DMAC_CHANNEL_0              (0U)
+#define DMAC_CHANNEL_1              (1U)
+#define DMAC_CHANNEL_2              (2U)
+#define DMAC_CHANNEL_3              (3U)
+
+typedef uint32_t DMAC_CHANNEL;
+
+typedef enum
+{
+    DMAC_TRANSFER_EVENT_NONE     = 0,
+    DMAC_TRANSFER_EVENT_COMPLETE = 1,
+    DMAC_TRANSFER_EVENT_ERROR    = 2
+} DMAC_TRANSFER_EVENT;
+
+typedef enum
+{
+    DMAC_CRC_TYPE_16 = 0x0,
+    DMAC_CRC_TYPE_32 = 0x1
+} DMAC_CRC_POLYNOMIAL_TYPE;
+
+typedef enum
+{
+    DMAC_CRC_MODE_DEFAULT        = 0x0,
+    DMAC_CRC_MODE_RESERVED       = 0x1,
+    DMAC_CRC_MODE_MEMORY_MONITOR = 0x2,
+    DMAC_CRC_MODE_MEMORY_GEN     = 0x3
+} DMAC_CRC_MODE;
+
+typedef struct
+{
+    DMAC_CRC_POLYNOMIAL_TYPE polynomial_type;
+    DMAC_CRC_MODE            crc_mode;
+    uint32_t                 seed;
+} DMAC_CRC_SETUP;
+
+typedef uint32_t DMAC_CHANNEL_CONFIG;
+
+typedef void (*DMAC_CHANNEL_CALLBACK)(DMAC_TRANSFER_EVENT event, uintptr_t contextHandle);
+
+void DMAC_ChannelCallbackRegister(DMAC_CHANNEL channel, const DMAC_CHANNEL_CALLBACK callback, const uintptr_t context);
+void DMAC_Initialize(void);
+bool DMAC_ChannelTransfer(DMAC_CHANNEL channel, const void *srcAddr, const void *destAddr, size_t blockSize);
+bool DMAC_ChannelLinkedListTransfer(DMAC_CHANNEL channel, dmac_descriptor_registers_t *channelDesc);
+bool DMAC_ChannelIsBusy(DMAC_CHANNEL channel);
+void DMAC_ChannelDisable(DMAC_CHANNEL channel);
+DMAC_CHANNEL_CONFIG DMAC_ChannelSettingsGet(DMAC_CHANNEL channel);
+bool DMAC_ChannelSettingsSet(DMAC_CHANNEL channel, DMAC_CHANNEL_CONFIG setting);
+uint16_t DMAC_ChannelGetTransferredCount(DMAC_CHANNEL channel);
+void DMAC_ChannelCRCSetup(DMAC_CHANNEL channel, DMAC_CRC_SETUP CRCSetup);
+uint32_t DMAC_CRCRead(void);
+uint32_t DMAC_CRCCalculate(void *buffer, uint32_t length, DMAC_CRC_SETUP CRCSetup);
+void DMAC_CRCDisable(void);
+void DMAC_ChannelSuspend(DMAC_CHANNEL channel);
+void DMAC_ChannelResume(DMAC_CHANNEL channel);
+DMAC_TRANSFER_EVENT DMAC_ChannelTransferStatusGet(DMAC_CHANNEL channel);
+
+/* -- Host model -------------------------------------------------------------- */
+
+#define HOST_DMAC_CHANNELS      32u
+#define HOST_DMAC_WIRE_MAX      65536u  /* peripheral bytes kept per channel */
+
+/** Modelled transfer time of `ch`, ns per byte; 0 = a block ends at the next HostDmac_Run(). */
+void HostDmac_SetByteNs(DMAC_CHANNEL ch, uint32_t ns);
+
+/**
+ * Run the DMAC up to `now_ns` (Host_Ns()): start the channels enabled by
+ * hand, end every block due and raise its interrupt. Returns the blocks
+ * ended. The caller is the interrupt context: nothing else may run
+ * firmware code meanwhile.
+ */
+uint32_t HostDmac_Run(uint64_t now_ns);
+
+/** True while any channel runs. */
+bool HostDmac_Busy(void);
+
+/** Bytes `ch` wrote to a peripheral since its transfer started, in order. */
+const uint8_t *HostDmac_Wire(DMAC_CHANNEL ch, uint32_t *len);
+
+/** Transfers started and blocks ended on `ch` since DMAC_Initialize(). */
+void HostDmac_Counts(DMAC_CHANNEL ch, uint32_t *transfers, uint32_t *blocks);
+
+#endif /* PLIB_DMAC_H */
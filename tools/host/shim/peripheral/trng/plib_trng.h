@@ -0,0 +1,24 @@
+/* =============================================================================
+ * plib_trng.h  -  TRNG plib shim for the host builds (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * Same interface as src/config/default/peripheral/trng/plib_trng.h. The
+ * "true" random numbers are a xorshift32 (trng_host.c), seeded with
+ * HostTrng_Seed() so a run can be repeated exactly.
+ * ============================================================================= */
+
+#ifndef TRNG_H
+#define TRNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+void TRNG_Initialize(void);
+uint32_t TRNG_ReadData(void);
+
+/* -- Host model -------------------------------------------------------------- */
+
+/** Restart the sequence from `seed` (0 is taken as 1). */
+void HostTrng_Seed(uint32_t seed);
+
+#endif /* TRNG_H */
@@ -0,0 +1,59 @@
+/* =============================================================================
+ * portmacro.h  -  FreeRTOS port layer of the host test build (tools/host)
+ * Target : Linux x86-64, GCC
+ *
+ * The test build runs the firmware's code from one host thread, with no
+ * scheduler: the kernel headers are the real ones, the kernel calls the
+ * modules make are answered by rtos_test.c (the calling "task" never
+ * blocks, a wait runs the DMAC model instead). The simulation build uses
+ * the POSIX port instead of this directory.
+ * ============================================================================= */
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#include <stdint.h>
+
+#define portCHAR                char
+#define portFLOAT               float
+#define portDOUBLE              double
+#define portLONG                long
+#define portSHORT               short
+#define portSTACK_TYPE          uint32_t
+#define portBASE_TYPE           long
+
+typedef portSTACK_TYPE          StackType_t;
+typedef long                    BaseType_t;
+typedef unsigned long           UBaseType_t;
+typedef uint32_t                TickType_t;
+
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define portTICK_TYPE_IS_ATOMIC 1
+#define portSTACK_GROWTH        (-1)
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portBYTE_ALIGNMENT      8
+#define portDONT_DISCARD        __attribute__((used))
+#define portNOP()
+#define portINLINE              __inline
+#define portFORCE_INLINE        inline __attribute__((always_inline))
+
+#define portYIELD()                                 ((void)0)
+#define portEND_SWITCHING_ISR(xSwitchRequired)      ((void)(xSwitchRequired))
+#define portYIELD_FROM_ISR(x)                       portEND_SWITCHING_ISR(x)
+#define portSET_INTERRUPT_MASK_FROM_ISR()           0u
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)        ((void)(x))
+#define portDISABLE_INTERRUPTS()                    ((void)0)
+#define portENABLE_INTERRUPTS()                     ((void)0)
+#define portENTER_CRITICAL()                        ((void)0)
+#define portEXIT_CRITICAL()                         ((void)0)
+#define portSUPPRESS_TICKS_AND_SLEEP(xExpected)     ((void)(xExpected))
+
+#define portTASK_FUNCTION_PROTO(vFunction, pvParameters)    void vFunction(void *pvParameters)
+#define portTASK_FUNCTION(vFunction, pvParameters)          void vFunction(void *pvParameters)
+
+static portFORCE_INLINE BaseType_t xPortIsInsideInterrupt(void)
+{
+    return 0;
+}
+
+#endif /* PORTMACRO_H */
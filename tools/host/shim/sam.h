@@ -0,0 +1,5 @@
+/* sam.h  -  XC32's device selector, for the host builds (tools/host) */
+#ifndef HOST_SAM_H
+#define HOST_SAM_H
+#include "device.h"
+#endif
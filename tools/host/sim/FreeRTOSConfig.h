@@ -0,0 +1,27 @@
+/* =============================================================================
+ * FreeRTOSConfig.h  -  The firmware's kernel configuration, for the host
+ *                      simulation (tools/host, "make sim")
+ * Target : Linux x86-64, GCC, FreeRTOS on posix/port.c
+ *
+ * First on the sim's include path: takes config/default/FreeRTOSConfig.h
+ * as it is and changes only what posix/port.c or the simulation needs.
+ *
+ *   configUSE_TICK_HOOK      1 - sim.c's tick hook is the interrupt side:
+ *                                the DMAC model, pended IRQs, the load.
+ *   configUSE_TICKLESS_IDLE  0 - the port's tick is a host timer; the
+ *                                RTC sleep of tickless.c has nothing to
+ *                                stop (stubs_host.c answers Tickless_*()).
+ *   configQUEUE_REGISTRY_SIZE - names the kernel's own queues ("TmrQ")
+ *                                in the report: no LOADTEST_NAME() there.
+ * ============================================================================= */
+
+#include_next "FreeRTOSConfig.h"
+
+#undef  configUSE_TICK_HOOK
+#define configUSE_TICK_HOOK                     1
+
+#undef  configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE                 0
+
+#undef  configQUEUE_REGISTRY_SIZE
+#define configQUEUE_REGISTRY_SIZE               8
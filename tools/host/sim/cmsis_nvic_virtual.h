@@ -0,0 +1,38 @@
+/* =============================================================================
+ * cmsis_nvic_virtual.h  -  The NVIC calls for the simulation
+ *                          (tools/host, "make sim", -DCMSIS_NVIC_VIRTUAL)
+ * Target : Linux x86-64, GCC, FreeRTOS on posix/port.c
+ *
+ * core_cm4.h takes the NVIC_*() names from here. ISER / ICER / ISPR / ICPR
+ * are write-1 on the chip and plain memory on the host, where a second
+ * NVIC_EnableIRQ() in the same word would undo the first; enable and pend
+ * go to nvic_host.c's masks instead. Priorities, grouping and the reset
+ * stay CMSIS's own: they are plain registers on the chip as well.
+ * ============================================================================= */
+
+#ifndef CMSIS_NVIC_VIRTUAL_H
+#define CMSIS_NVIC_VIRTUAL_H
+
+#include <stdint.h>
+
+void     HostSim_NvicEnable(IRQn_Type irq);
+void     HostSim_NvicDisable(IRQn_Type irq);
+uint32_t HostSim_NvicEnabled(IRQn_Type irq);
+void     HostSim_NvicPend(IRQn_Type irq);
+void     HostSim_NvicUnpend(IRQn_Type irq);
+uint32_t HostSim_NvicPending(IRQn_Type irq);
+
+#define NVIC_SetPriorityGrouping    __NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping    __NVIC_GetPriorityGrouping
+#define NVIC_EnableIRQ              HostSim_NvicEnable
+#define NVIC_GetEnableIRQ           HostSim_NvicEnabled
+#define NVIC_DisableIRQ             HostSim_NvicDisable
+#define NVIC_GetPendingIRQ          HostSim_NvicPending
+#define NVIC_SetPendingIRQ          HostSim_NvicPend
+#define NVIC_ClearPendingIRQ        HostSim_NvicUnpend
+#define NVIC_GetActive              __NVIC_GetActive
+#define NVIC_SetPriority            __NVIC_SetPriority
+#define NVIC_GetPriority            __NVIC_GetPriority
+#define NVIC_SystemReset            __NVIC_SystemReset
+
+#endif /* CMSIS_NVIC_VIRTUAL_H */
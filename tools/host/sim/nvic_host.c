@@ -0,0 +1,298 @@
+/* =============================================================================
+ * nvic_host.c  -  The simulation's interrupt side: NVIC, TC0, PORT, clocks
+ *                 (tools/host, "make sim")
+ * Target : Linux x86-64, GCC, FreeRTOS on posix/port.c
+ * ============================================================================= */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "definitions.h"
+#include "device_vectors.h"      /* H3DeviceVectors */
+#include "hostregs.h"
+#include "neopixel.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define SIM_CLOCK_NS        20000u      /* clock thread period: CYCCNT and TC0 COUNT */
+#define SIM_IRQ_PASSES      8u          /* handler rounds per tick: an ISR pends the next */
+
+/* -- Derived constants - do not edit ----------------------------------------- */
+#define SIM_IRQS            (PERIPH_MAX_IRQn + 1u)
+#define SIM_IRQ_WORDS       ((SIM_IRQS + 31u) / 32u)
+#define SIM_VECTOR_IRQ0     16u         /* exception_table: pvStack, then 15 exceptions */
+#define SIM_NEO_BYTE_NS     (8000000000ull / NEO_SPI_HZ)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+/* Status flags the firmware waits on, held set: oscillators and clocks
+ * ready, SERCOM data register empty and transmit complete, and so on */
+#define SIM_READY(reg, bits)    { (uintptr_t)&(reg), sizeof(reg), (bits) }
+
+static const struct
+{
+    uintptr_t addr;
+    uint8_t   width;
+    uint32_t  bits;
+} sim_ready[] =
+{
+    SIM_READY(OSCCTRL_REGS->OSCCTRL_STATUS, OSCCTRL_STATUS_XOSCRDY_Msk | OSCCTRL_STATUS_DFLLRDY_Msk),
+    SIM_READY(OSCCTRL_REGS->DPLL[0].OSCCTRL_DPLLSTATUS, OSCCTRL_DPLLSTATUS_LOCK_Msk | OSCCTRL_DPLLSTATUS_CLKRDY_Msk),
+    SIM_READY(OSCCTRL_REGS->DPLL[1].OSCCTRL_DPLLSTATUS, OSCCTRL_DPLLSTATUS_LOCK_Msk | OSCCTRL_DPLLSTATUS_CLKRDY_Msk),
+    SIM_READY(OSC32KCTRL_REGS->OSC32KCTRL_STATUS, OSC32KCTRL_STATUS_XOSC32KRDY_Msk),
+    SIM_READY(MCLK_REGS->MCLK_INTFLAG, MCLK_INTFLAG_CKRDY_Msk),
+    SIM_READY(SUPC_REGS->SUPC_STATUS, SUPC_STATUS_B33SRDY_Msk | SUPC_STATUS_BOD33RDY_Msk),
+    SIM_READY(NVMCTRL_REGS->NVMCTRL_STATUS, NVMCTRL_STATUS_READY_Msk),
+    SIM_READY(DAC_REGS->DAC_STATUS, DAC_STATUS_READY0_Msk | DAC_STATUS_READY1_Msk),
+    SIM_READY(QSPI_REGS->QSPI_INTFLAG, QSPI_INTFLAG_INSTREND_Msk),
+    SIM_READY(SDHC0_REGS->SDHC_CCR, SDHC_CCR_INTCLKS_Msk),
+    SIM_READY(SERCOM0_REGS->USART_INT.SERCOM_INTFLAG, SERCOM_USART_INT_INTFLAG_DRE_Msk | SERCOM_USART_INT_INTFLAG_TXC_Msk),
+    SIM_READY(SERCOM1_REGS->USART_INT.SERCOM_INTFLAG, SERCOM_USART_INT_INTFLAG_DRE_Msk | SERCOM_USART_INT_INTFLAG_TXC_Msk),
+    SIM_READY(SERCOM2_REGS->USART_INT.SERCOM_INTFLAG, SERCOM_USART_INT_INTFLAG_DRE_Msk | SERCOM_USART_INT_INTFLAG_TXC_Msk),
+    SIM_READY(SERCOM3_REGS->USART_INT.SERCOM_INTFLAG, SERCOM_USART_INT_INTFLAG_DRE_Msk | SERCOM_USART_INT_INTFLAG_TXC_Msk),
+    SIM_READY(SERCOM4_REGS->USART_INT.SERCOM_INTFLAG, SERCOM_USART_INT_INTFLAG_DRE_Msk | SERCOM_USART_INT_INTFLAG_TXC_Msk),
+    SIM_READY(SERCOM5_REGS->USART_INT.SERCOM_INTFLAG, SERCOM_USART_INT_INTFLAG_DRE_Msk | SERCOM_USART_INT_INTFLAG_TXC_Msk),
+};
+
+extern const H3DeviceVectors exception_table;      /* interrupts.c */
+
+static uint32_t          sim_enabled[SIM_IRQ_WORDS];
+static uint32_t          sim_pending[SIM_IRQ_WORDS];
+static uint32_t          sim_count[SIM_IRQS];
+static uint32_t          sim_tc0_last;
+static uint64_t          sim_t0;
+static pthread_t         sim_clock;
+
+/* -- Model ------------------------------------------------------------------- */
+
+/* One IRQ's bit in a mask, set or cleared atomically: tasks and handlers share them */
+static void nvic_bit(uint32_t *mask, IRQn_Type irq, bool on)
+{
+    uint32_t w   = (uint32_t)irq / 32u;
+    uint32_t bit = 1u << ((uint32_t)irq % 32u);
+
+    if ((int32_t)irq < 0 || w >= SIM_IRQ_WORDS) return;
+    if (on) (void)__atomic_fetch_or(&mask[w], bit, __ATOMIC_SEQ_CST);
+    else    (void)__atomic_fetch_and(&mask[w], ~bit, __ATOMIC_SEQ_CST);
+}
+
+static uint32_t nvic_test(const uint32_t *mask, IRQn_Type irq)
+{
+    uint32_t w = (uint32_t)irq / 32u;
+
+    if ((int32_t)irq < 0 || w >= SIM_IRQ_WORDS) return 0u;
+    return (__atomic_load_n(&mask[w], __ATOMIC_SEQ_CST) >> ((uint32_t)irq % 32u)) & 1u;
+}
+
+/* TC0 (showclock.h): COUNT crossing CC1 raises MC1, the wrap OVF */
+static void tc0_model(void)
+{
+    tc_count32_registers_t *tc  = &TC0_REGS->COUNT32;
+    uint32_t                now = tc->TC_COUNT;
+    uint8_t                 f   = 0u;
+
+    if ((tc->TC_CTRLA & TC_CTRLA_ENABLE_Msk) == 0u) return;
+    if (now < sim_tc0_last) f |= TC_INTFLAG_OVF_Msk;
+    if ((int32_t)(now - tc->TC_CC[1]) >= 0 && (int32_t)(sim_tc0_last - tc->TC_CC[1]) < 0)
+        f |= TC_INTFLAG_MC1_Msk;
+    sim_tc0_last = now;
+    if (f == 0u) return;
+
+    tc->TC_INTFLAG = f;
+    nvic_bit(sim_pending, TC0_IRQn, true);
+}
+
+/* OUTSET / OUTCLR / OUTTGL, DIRSET / DIRCLR / DIRTGL; IN is the outputs plus the inputs as left */
+static void port_model(void)
+{
+    for (uint32_t g = 0; g < PORT_GROUP_NUMBER; g++)
+    {
+        port_group_registers_t *p = &PORT_REGS->GROUP[g];
+        uint32_t out = (p->PORT_OUT | p->PORT_OUTSET) & ~p->PORT_OUTCLR;
+        uint32_t dir = (p->PORT_DIR | p->PORT_DIRSET) & ~p->PORT_DIRCLR;
+
+        p->PORT_OUT    = out ^ p->PORT_OUTTGL;
+        p->PORT_DIR    = dir ^ p->PORT_DIRTGL;
+        p->PORT_OUTSET = p->PORT_OUTCLR = p->PORT_OUTTGL = 0u;
+        p->PORT_DIRSET = p->PORT_DIRCLR = p->PORT_DIRTGL = 0u;
+        *(volatile uint32_t *)&p->PORT_IN = (p->PORT_OUT & p->PORT_DIR) | (p->PORT_IN & ~p->PORT_DIR);
+    }
+}
+
+/* Every pended, enabled IRQ by number, as the NVIC would at one priority.
+ * The handler's flags were modelled set; what it clears by writing 1 stays
+ * set in memory, so they are cleared after it. */
+static void nvic_dispatch(void)
+{
+    void *const *vec = (void *const *)&exception_table;
+
+    for (uint32_t pass = 0; pass < SIM_IRQ_PASSES; pass++)
+    {
+        bool ran = false;
+
+        for (uint32_t w = 0; w < SIM_IRQ_WORDS; w++)
+        {
+            uint32_t due = __atomic_load_n(&sim_pending[w], __ATOMIC_SEQ_CST) & sim_enabled[w];
+
+            while (due != 0u)
+            {
+                uint32_t irq = w * 32u + (uint32_t)__builtin_ctz(due);
+
+                due &= due - 1u;
+                nvic_bit(sim_pending, (IRQn_Type)irq, false);
+                sim_count[irq]++;
+                ((void (*)(void))vec[SIM_VECTOR_IRQ0 + irq])();
+                if (irq == TC0_IRQn) TC0_REGS->COUNT32.TC_INTFLAG = 0u;
+                ran = true;
+            }
+        }
+        if (!ran) break;
+    }
+}
+
+static void ready_model(void)
+{
+    for (uint32_t i = 0; i < sizeof(sim_ready) / sizeof(sim_ready[0]); i++)
+    {
+        switch (sim_ready[i].width)
+        {
+        case 1u: *(volatile uint8_t *)sim_ready[i].addr  |= (uint8_t)sim_ready[i].bits;  break;
+        case 2u: *(volatile uint16_t *)sim_ready[i].addr |= (uint16_t)sim_ready[i].bits; break;
+        default: *(volatile uint32_t *)sim_ready[i].addr |= sim_ready[i].bits;           break;
+        }
+    }
+}
+
+/* Host time into the cycle counter and the show clock, the ready flags; a
+ * reset request ends the run */
+static void *clock_thread(void *arg)
+{
+    struct timespec next;
+
+    (void)arg;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (;;)
+    {
+        uint64_t ns = Host_Ns() - sim_t0;
+
+        DWT->CYCCNT = (uint32_t)(ns * (configCPU_CLOCK_HZ / 1000000u) / 1000u);
+        TC0_REGS->COUNT32.TC_COUNT = (uint32_t)(ns / 1000u);
+        ready_model();
+
+        if ((SCB->AIRCR & SCB_AIRCR_SYSRESETREQ_Msk) != 0u)
+        {
+            char line[96];
+            int  n = snprintf(line, sizeof(line), "sim: reset requested at %llu ms, task %s\n",
+                              (unsigned long long)(ns / 1000000u),
+                              (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) ? "-"
+                              : pcTaskGetName(NULL));
+
+            (void)syscall(SYS_write, STDERR_FILENO, line, (size_t)n);   /* not stdio_uart.c's write() */
+            _exit(3);
+        }
+
+        next.tv_nsec += SIM_CLOCK_NS;
+        if (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) != 0) {}
+    }
+    return NULL;
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void HostSim_ClockStart(void)
+{
+    sigset_t all, old;
+
+    sim_t0 = Host_Ns();
+    ready_model();
+    HostDmac_SetByteNs(DMAC_CHANNEL_NEO, (uint32_t)SIM_NEO_BYTE_NS);
+
+    /* No signal for this thread: the tick goes to the tasks' */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    if (pthread_create(&sim_clock, NULL, clock_thread, NULL) != 0)
+    {
+        fprintf(stderr, "sim: no clock thread\n");
+        _exit(2);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void HostSim_Interrupts(void)
+{
+    port_model();
+    (void)HostDmac_Run(Host_Ns());
+    tc0_model();
+    nvic_dispatch();
+}
+
+void HostSim_NvicEnable(IRQn_Type irq)
+{
+    nvic_bit(sim_enabled, irq, true);
+}
+
+void HostSim_NvicDisable(IRQn_Type irq)
+{
+    nvic_bit(sim_enabled, irq, false);
+}
+
+uint32_t HostSim_NvicEnabled(IRQn_Type irq)
+{
+    return nvic_test(sim_enabled, irq);
+}
+
+void HostSim_NvicPend(IRQn_Type irq)
+{
+    nvic_bit(sim_pending, irq, true);
+}
+
+void HostSim_NvicUnpend(IRQn_Type irq)
+{
+    nvic_bit(sim_pending, irq, false);
+}
+
+uint32_t HostSim_NvicPending(IRQn_Type irq)
+{
+    return nvic_test(sim_pending, irq);
+}
+
+uint32_t HostSim_IrqCount(uint32_t irq)
+{
+    return (irq < SIM_IRQS) ? sim_count[irq] : 0u;
+}
+
+void HostSim_IrqMask(uint32_t masked)
+{
+    sigset_t tick;
+
+    /* A handler restoring PRIMASK 0 does not open the tick to itself */
+    if (masked == 0u && xPortIsInsideInterrupt() != pdFALSE) return;
+
+    sigemptyset(&tick);
+    sigaddset(&tick, SIGALRM);
+    pthread_sigmask((masked != 0u) ? SIG_BLOCK : SIG_UNBLOCK, &tick, NULL);
+}
+
+uint32_t HostSim_IrqMasked(void)
+{
+    sigset_t now;
+
+    pthread_sigmask(SIG_BLOCK, NULL, &now);
+    return (sigismember(&now, SIGALRM) == 1) ? 1u : 0u;
+}
+
+uint32_t HostSim_IrqActive(void)
+{
+    return (xPortIsInsideInterrupt() != pdFALSE) ? 1u : 0u;
+}
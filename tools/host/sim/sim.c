@@ -0,0 +1,258 @@
+/* =============================================================================
+ * sim.c  -  The firmware on the host, under synthetic load
+ *           (tools/host, "make sim", build/hostsim)
+ * Target : Linux x86-64, GCC, FreeRTOS on posix/port.c
+ *
+ * main.c runs as it is (as Firmware_Main()): every module's init, every
+ * task, the scheduler, with the peripherals of sim.h behind it. A report
+ * task at the top priority lets it boot, starts a LoadTest_Start() run
+ * (loadtest.h: presence edges through dsun_inject_edge(), the heavy effect
+ * layers) and, when it is over, prints, then exits:
+ *
+ *   tasks     per task: priority, run time in us and its share of the run
+ *             from the run-time counters, and the busiest second
+ *   queues    LoadTest_GetLevels(): per queue / stream buffer the deepest
+ *             fill against its size, the sends and the sends that found
+ *             it full
+ *   counts    edges injected, HrTimer periods skipped, NeoPixel frames
+ *             and their faults, the IRQs dispatched
+ *
+ *   build/hostsim [-t seconds] [-e edges/s] [-x] [-b boot s] [-s seed]
+ *
+ * Times are host times: the shares say where the CPU goes and how that
+ * moves with the load, not what the M4F takes. The NeoPixel wire time is
+ * modelled (nvic_host.c), so a render that no longer fits the frame shows.
+ * ============================================================================= */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+#include "definitions.h"
+#include "hostregs.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "loadtest.h"
+#include "hrtimer.h"
+#include "neopixel.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define SIM_SECONDS         10u         /* load run, -t                      */
+#define SIM_BOOT_S          1u          /* settle before the run, -b         */
+#define SIM_SEED            1u          /* TRNG sequence, -s                 */
+#define SIM_MAX_TASKS       48u
+#define SIM_REPORT_STACK    1024u
+#define SIM_REPORT_PRIO     (configMAX_PRIORITIES - 1u)
+
+/* -- Internal state ---------------------------------------------------------- */
+
+typedef struct
+{
+    TaskHandle_t handle;
+    const char  *name;
+    UBaseType_t  prio;
+    uint32_t     last;              /* run-time counter at the last sample */
+    uint32_t     delta;             /* counts since the one before         */
+    uint64_t     total;             /* during the run, counts              */
+    double       peak;              /* busiest second, share of it         */
+} sim_task_t;
+
+static uint32_t      sim_seconds = SIM_SECONDS;
+static uint32_t      sim_edge_hz;
+static bool          sim_fx;
+static uint32_t      sim_boot_s  = SIM_BOOT_S;
+
+static sim_task_t    sim_task[SIM_MAX_TASKS];
+static uint32_t      sim_ntasks;
+static uint64_t      sim_span;      /* all tasks' counts during the run */
+static TaskStatus_t  sim_status[SIM_MAX_TASKS];
+
+static StaticTask_t  sim_tcb;
+static StackType_t   sim_stack[SIM_REPORT_STACK];
+
+void Firmware_Main(void);           /* main.c, -Dmain=Firmware_Main */
+void Firmware_TickHook(void);       /* freertos_hooks.c             */
+
+/* -- Helpers ----------------------------------------------------------------- */
+
+/* Run-time counter deltas since the last call; `counting` adds them to the run */
+static void sim_sample(bool counting)
+{
+    UBaseType_t n    = uxTaskGetSystemState(sim_status, SIM_MAX_TASKS, NULL);
+    uint64_t    span = 0u;
+
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        const TaskStatus_t *s = &sim_status[i];
+        sim_task_t         *t = NULL;
+
+        for (uint32_t k = 0; k < sim_ntasks && t == NULL; k++)
+            if (sim_task[k].handle == s->xHandle) t = &sim_task[k];
+        if (t == NULL)
+        {
+            if (sim_ntasks == SIM_MAX_TASKS) continue;
+            t         = &sim_task[sim_ntasks++];
+            t->handle = s->xHandle;
+            t->name   = s->pcTaskName;
+            t->prio   = s->uxBasePriority;
+            t->last   = s->ulRunTimeCounter;
+        }
+
+        t->delta = (uint32_t)s->ulRunTimeCounter - t->last;
+        t->last  = (uint32_t)s->ulRunTimeCounter;
+        span    += t->delta;
+    }
+    if (!counting || span == 0u) return;
+
+    for (uint32_t k = 0; k < sim_ntasks; k++)
+    {
+        sim_task_t *t     = &sim_task[k];
+        double      share = 100.0 * (double)t->delta / (double)span;
+
+        t->total += t->delta;
+        t->delta  = 0u;
+        if (share > t->peak) t->peak = share;
+    }
+    sim_span += span;
+}
+
+static int sim_by_total(const void *a, const void *b)
+{
+    const sim_task_t *x = a, *y = b;
+
+    return (x->total < y->total) - (x->total > y->total);
+}
+
+static void sim_report(void)
+{
+    static loadtest_level_t lv[LOADTEST_OBJECTS];
+    loadtest_status_t       st;
+    hrtimer_stats_t         hr;
+    neo_tx_stats_t          neo;
+    uint32_t                us_div = configCPU_CLOCK_HZ / 1000000u;
+    uint32_t                n;
+
+    qsort(sim_task, sim_ntasks, sizeof(sim_task[0]), sim_by_total);
+    printf("task             prio      run_us  share%%  peak1s%%\n");
+    for (uint32_t i = 0; i < sim_ntasks; i++)
+    {
+        const sim_task_t *t = &sim_task[i];
+
+        printf("%-16s %4lu %11llu %7.2f %8.2f\n", t->name, (unsigned long)t->prio,
+               (unsigned long long)(t->total / us_div),
+               (sim_span != 0u) ? 100.0 * (double)t->total / (double)sim_span : 0.0, t->peak);
+    }
+
+    n = LoadTest_GetLevels(lv, LOADTEST_OBJECTS);
+    printf("\nqueue                size    high   sends    full\n");
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const char *name = lv[i].name;
+        char        addr[20];
+
+        if (name == NULL) name = pcQueueGetName((QueueHandle_t)lv[i].obj);     /* the kernel's */
+        if (name == NULL)
+        {
+            (void)snprintf(addr, sizeof(addr), "%08lx", (unsigned long)(uintptr_t)lv[i].obj);
+            name = addr;
+        }
+        printf("%-16s %8lu %7lu %7lu %7lu\n", name,
+               (unsigned long)lv[i].size, (unsigned long)lv[i].high,
+               (unsigned long)lv[i].sends, (unsigned long)lv[i].full);
+    }
+
+    LoadTest_GetStatus(&st);
+    HrTimer_GetStats(&hr);
+    NeoPixel_GetStats(&neo);
+    printf("\nrun %lu ms, %lu edges at %lu/s%s; hrtimer %lu fired, %lu skipped, %lu late (max %lu us)\n",
+           (unsigned long)st.ms, (unsigned long)st.edges, (unsigned long)st.edge_hz,
+           st.fx ? ", heavy effects" : "", (unsigned long)hr.fired, (unsigned long)hr.skipped,
+           (unsigned long)hr.late, (unsigned long)hr.late_max_us);
+    printf("neopixel %lu frames, %lu late, %lu timeouts, %lu DMA errors, %lu SPI errors\n",
+           (unsigned long)neo.frames, (unsigned long)neo.late, (unsigned long)neo.timeouts,
+           (unsigned long)neo.dma_errors, (unsigned long)neo.spi_errors);
+    printf("irqs");
+    for (uint32_t irq = 0; irq <= PERIPH_MAX_IRQn; irq++)
+        if (HostSim_IrqCount(irq) != 0u)
+            printf(" %lu:%lu", (unsigned long)irq, (unsigned long)HostSim_IrqCount(irq));
+    printf("\n");
+}
+
+/* Boots, runs the load, reports, ends the process */
+static void sim_task_fn(void *arg)
+{
+    TickType_t wake;
+
+    (void)arg;
+    vTaskDelay(pdMS_TO_TICKS(sim_boot_s * 1000u));
+    sim_sample(false);
+    if (!LoadTest_Start(sim_edge_hz, sim_seconds, sim_fx))
+    {
+        printf("sim: LoadTest_Start(%lu, %lu) refused\n", (unsigned long)sim_edge_hz,
+               (unsigned long)sim_seconds);
+        _exit(2);
+    }
+
+    wake = xTaskGetTickCount();
+    for (uint32_t s = 0; s < sim_seconds; s++)
+    {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000u));
+        sim_sample(true);
+    }
+    vTaskDelay(pdMS_TO_TICKS(10u));     /* the end timer's task callback */
+
+    sim_report();
+    _exit(0);
+}
+
+static void sim_usage(const char *argv0)
+{
+    printf("usage: %s [-t seconds] [-e edges/s] [-x] [-b boot_s] [-s seed]\n"
+           "  -t  load run length, default %u s\n"
+           "  -e  synthetic presence edges per second, default 0, up to %u\n"
+           "  -x  the heavy effect layers on top (loadtest.h)\n"
+           "  -b  boot time before the run, default %u s\n"
+           "  -s  TRNG seed, default %u\n",
+           argv0, SIM_SECONDS, LOADTEST_EDGE_HZ_MAX, SIM_BOOT_S, SIM_SEED);
+}
+
+/* -- Public API implementation ----------------------------------------------- */
+
+/* The interrupt side, then the firmware's own hook */
+void vApplicationTickHook(void)
+{
+    HostSim_Interrupts();
+    Firmware_TickHook();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = SIM_SEED;
+    int      c;
+
+    while ((c = getopt(argc, argv, "t:e:xb:s:h")) != -1)
+    {
+        switch (c)
+        {
+        case 't': sim_seconds = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'e': sim_edge_hz = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'x': sim_fx      = true;                               break;
+        case 'b': sim_boot_s  = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 's': seed        = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:  sim_usage(argv[0]); return (c == 'h') ? 0 : 2;
+        }
+    }
+    if (sim_seconds == 0u) sim_seconds = SIM_SECONDS;
+
+    Host_MapRegisters();
+    HostTrng_Seed(seed);
+    HostSim_ClockStart();
+    (void)xTaskCreateStatic(sim_task_fn, "Sim", SIM_REPORT_STACK, NULL, SIM_REPORT_PRIO,
+                            sim_stack, &sim_tcb);
+
+    Firmware_Main();
+    return 1;                           /* the scheduler does not return */
+}
@@ -0,0 +1,48 @@
+/* =============================================================================
+ * sim.h  -  The host simulation's interrupt side (tools/host, "make sim")
+ * Target : Linux x86-64, GCC, FreeRTOS on posix/port.c
+ *
+ * The firmware runs unchanged on posix/port.c: a task is a thread, the
+ * tick is a signal to the running one. What the chip does beside the CPU
+ * is modelled here, from the tick hook, so in interrupt context with the
+ * tick masked:
+ *
+ *   NVIC    NVIC_EnableIRQ() and the rest on enable and pending masks
+ *           (cmsis_nvic_virtual.h); every pended, enabled IRQ runs the
+ *           firmware's own handler from exception_table (interrupts.c)
+ *   TC0     the show clock: COUNT follows the host's microseconds, CC1
+ *           raises MC1 (hrtimer.h), the wrap OVF
+ *   DMAC    dmac_host.c, the NeoPixel channel at its SPI wire time
+ *   PORT    OUTSET / OUTCLR / OUTTGL and DIRSET / DIRCLR folded into OUT
+ *           and DIR, IN reads back the outputs
+ *   READY   the status flags init and drivers wait on held set: clocks,
+ *           DPLL lock, NVMCTRL READY, SERCOM DRE / TXC, ...
+ *
+ * A clock thread, which runs no firmware code, keeps DWT->CYCCNT at
+ * configCPU_CLOCK_HZ and TC0's COUNT at 1 MHz of host time between ticks,
+ * and ends the run on a reset request (SCB->AIRCR SYSRESETREQ: a fault, an
+ * assert, the watchdog). Interrupts are seen once per tick: a peripheral
+ * raises its IRQ up to 1 ms late, HrTimer periods below that are skipped.
+ * ============================================================================= */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Start the clock thread. After Host_MapRegisters(), before the firmware. */
+void HostSim_ClockStart(void);
+
+/** The interrupt side, once per tick (vApplicationTickHook()). */
+void HostSim_Interrupts(void);
+
+/** IRQs dispatched since the start, by IRQ number; 0 past the last. */
+uint32_t HostSim_IrqCount(uint32_t irq);
+
+/* PRIMASK / BASEPRI / IPSR for cmsis_compiler.h: the tick signal's mask */
+void     HostSim_IrqMask(uint32_t masked);
+uint32_t HostSim_IrqMasked(void);
+uint32_t HostSim_IrqActive(void);
+
+#endif /* SIM_H */
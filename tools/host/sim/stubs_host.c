@@ -0,0 +1,125 @@
+/* =============================================================================
+ * stubs_host.c  -  What the simulation answers in place of the target
+ *                  (tools/host, "make sim")
+ * Target : Linux x86-64, GCC, FreeRTOS on posix/port.c
+ *
+ *   tickless.h    not built (configUSE_TICKLESS_IDLE 0 here): vetoes are
+ *                 taken and ignored, the RTC count is host time
+ *   stdout        printf(), puts() and fwrite() to stdout / stderr go
+ *                 straight to write(2) with the tick masked. Through
+ *                 stdio a task preempted holding the stream's lock would
+ *                 block every higher priority task that logs, and no
+ *                 tick could end it; stdio_uart.c's write() replaces
+ *                 the C library's, hence the raw system call
+ *   vectors       what exception_table names and the sim has no use for:
+ *                 Reset_Handler and SysTick (the port's tick is its
+ *                 signal); the DMAC plib's handlers are dmac_host.c's
+ *
+ * The linker script's symbols (SRAM bounds, .dma_ram, ...) come from the
+ * Makefile's --defsym.
+ * ============================================================================= */
+
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "sim.h"
+#include "hostregs.h"
+#include "tickless.h"
+
+/* -- User configuration ------------------------------------------------------ */
+#define SIM_PRINTF_MAX      512u        /* longest printf() line, bytes */
+
+/* -- Helpers ----------------------------------------------------------------- */
+
+static void sim_write(int fd, const void *data, size_t len)
+{
+    const char *p      = data;
+    uint32_t    masked = HostSim_IrqMasked();
+
+    HostSim_IrqMask(1u);
+    while (len > 0u)
+    {
+        long n = syscall(SYS_write, fd, p, len);
+
+        if (n <= 0) break;
+        p   += n;
+        len -= (size_t)n;
+    }
+    HostSim_IrqMask(masked);
+}
+
+/* -- Public API implementation: stdout --------------------------------------- */
+
+int printf(const char *fmt, ...)
+{
+    char    line[SIM_PRINTF_MAX];
+    va_list ap;
+    int     n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) sim_write(STDOUT_FILENO, line, ((size_t)n < sizeof(line)) ? (size_t)n : sizeof(line) - 1u);
+    return n;
+}
+
+int puts(const char *s)
+{
+    sim_write(STDOUT_FILENO, s, strlen(s));
+    sim_write(STDOUT_FILENO, "\n", 1u);
+    return 1;
+}
+
+size_t fwrite(const void *data, size_t size, size_t count, FILE *f)
+{
+    if (f != stdout && f != stderr) return fwrite_unlocked(data, size, count, f);
+    sim_write((f == stdout) ? STDOUT_FILENO : STDERR_FILENO, data, size * count);
+    return count;
+}
+
+/* -- Public API implementation: tickless.h ----------------------------------- */
+
+void Tickless_Init(void)
+{
+}
+
+bool Tickless_RegisterVeto(tickless_veto_fn veto)
+{
+    (void)veto;
+    return true;
+}
+
+void Tickless_SetStandby(bool allow)
+{
+    (void)allow;
+}
+
+uint32_t Tickless_RtcCount(void)
+{
+    return (uint32_t)(Host_Ns() / 1000u * TICKLESS_RTC_HZ / 1000000u);
+}
+
+uint32_t Tickless_Sleeps(void)
+{
+    return 0u;
+}
+
+uint32_t Tickless_Standbys(void)
+{
+    return 0u;
+}
+
+/* -- Public API implementation: vectors -------------------------------------- */
+
+void Reset_Handler(void)
+{
+    _exit(3);
+}
+
+void xPortSysTickHandler(void)
+{
+}
+
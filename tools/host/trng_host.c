@@ -0,0 +1,32 @@
+/* =============================================================================
+ * trng_host.c  -  TRNG plib shim for the host builds (tools/host)
+ * Target : Linux x86-64, GCC
+ * ============================================================================= */
+
+#include "peripheral/trng/plib_trng.h"
+
+/* -- Internal state ---------------------------------------------------------- */
+
+static uint32_t trng_state = 0x2545F491u;
+
+/* -- Public API implementation ----------------------------------------------- */
+
+void TRNG_Initialize(void)
+{
+}
+
+uint32_t TRNG_ReadData(void)
+{
+    uint32_t x = trng_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    trng_state = x;
+    return x;
+}
+
+void HostTrng_Seed(uint32_t seed)
+{
+    trng_state = (seed != 0u) ? seed : 1u;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Pack a show file into independent LZ4 blocks for the SD card (src/lz.h).
+
+Animations (mkanim output) and raw sound clips (wav2clip.py --raw) read
+from the card stream straight through the Stream task's decoder, so a
+packed file plays exactly as the plain one does, with fewer bytes to
+read. Keep the 8.3 name the show opens; the header tells them apart.
+
+    lzpack.py GHOST.ANI GHOST.ANI
+    lzpack.py --block 4096 MUSIC.PCM MUSIC.PCM
+
+The block is the decoder's window and must not exceed STREAM_SEG_BYTES
+(stream.h); a block that does not shrink is stored as it is. Only the
+Python standard library is needed.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'CRLZ'                 # LZ_MAGIC
+VERSION = 1                     # LZ_VERSION
+STORED = 0x8000                 # LZ_STORED
+MIN_MATCH = 4
+MF_LIMIT = 12                   # LZ4: no match starts in the last 12 bytes
+LAST_LITERALS = 5               # LZ4: the last 5 bytes are literals
+HASH_BITS = 12
+
+
+def length(n):
+    """LZ4 length extension bytes for a length already past 15."""
+    out = bytearray()
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+    return out
+
+
+def sequence(out, lit, match, offset):
+    lit_n = len(lit)
+    token = (min(lit_n, 15) << 4) | (min(match - MIN_MATCH, 15) if match else 0)
+    out.append(token)
+    if lit_n >= 15:
+        out += length(lit_n - 15)
+    out += lit
+    if match:
+        out += struct.pack('<H', offset)
+        if match - MIN_MATCH >= 15:
+            out += length(match - MIN_MATCH - 15)
+
+
+def compress(block):
+    """One LZ4 block, with no match reaching before its start: greedy, hashed."""
+    n = len(block)
+    table = {}
+    out = bytearray()
+    anchor = i = 0
+    limit = n - MF_LIMIT
+    while i < limit:
+        key = block[i:i + MIN_MATCH]
+        ref = table.get(key)
+        table[key] = i
+        if ref is None or i - ref > 0xFFFF:
+            i += 1
+            continue
+        m = MIN_MATCH
+        while i + m < n - LAST_LITERALS and block[ref + m] == block[i + m]:
+            m += 1
+        sequence(out, block[anchor:i], m, i - ref)
+        for k in range(i + 1, min(i + m, limit)):
+            table[block[k:k + MIN_MATCH]] = k
+        i += m
+        anchor = i
+    sequence(out, block[anchor:], 0, 0)
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('src', help='the plain file')
+    ap.add_argument('dst', help='the packed file to write (may be src)')
+    ap.add_argument('--block', type=int, default=4096, help='bytes per block, STREAM_SEG_BYTES')
+    args = ap.parse_args()
+    if not 0 < args.block <= 0x7FFF:
+        raise SystemExit('lzpack: the block takes 1 to 32767 bytes')
+
+    with open(args.src, 'rb') as f:
+        data = f.read()
+    if data[:4] == MAGIC:
+        raise SystemExit('lzpack: %s is packed already' % args.src)
+
+    out = bytearray(MAGIC + struct.pack('<BBH', VERSION, 0, args.block))
+    for at in range(0, len(data), args.block):
+        block = data[at:at + args.block]
+        packed = compress(block)
+        if len(packed) >= len(block):
+            out += struct.pack('<HH', len(block), len(block) | STORED) + block
+        else:
+            out += struct.pack('<HH', len(block), len(packed)) + packed
+    out += struct.pack('<HH', 0, 0)
+
+    with open(args.dst, 'wb') as f:
+        f.write(out)
+    print('%s: %d -> %d bytes (%.0f %%)' % (args.dst, len(data), len(out),
+          100.0 * len(out) / max(len(data), 1)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
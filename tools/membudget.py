@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""Check the RAM and flash used by each module against tools/membudget.txt.
+
+Reads the map file XC32 writes next to the image (its Memory-Usage Report
+By Module and Data-Memory tables) and prints where the RAM goes: the
+largest sections (the FreeRTOS heap, neo_buf, task stacks, the DMAC
+descriptors), the stack reservation left behind them, and the totals.
+A module over its budget is an error and the exit status 1, so the
+MPLAB X post-build step (CR-Proj/nbproject/configurations.xml) fails the
+build; one above WARN_PCT of it is a warning.
+
+    membudget.py dist/default/production/CR-Proj.production.map
+    membudget.py -v CR-Proj.debug.map              # every module
+    membudget.py --suggest CR-Proj.production.map > tools/membudget.txt
+    membudget.py dist/release/production/CR-Proj.production.map \
+                 -c dist/default/production/CR-Proj.production.map
+
+--compare prints what each module gains or loses against another build's
+map, e.g. the release configuration (LTO, -O2, NDEBUG) against default.
+
+--suggest prints a budget file from the map with HEADROOM_PCT on top, to
+start from after a feature has deliberately grown a module.
+Only the Python standard library is needed.
+"""
+
+import argparse
+import fnmatch
+import os
+import re
+import sys
+
+WARN_PCT = 90
+HEADROOM_PCT = 25
+TOP = 12                        # largest RAM sections listed
+BASENAME_W = 25                 # width of the report's basename column
+
+RAM_BASE, RAM_END = 0x20000000, 0x20040000
+MODULE_ROW = re.compile(r'^\s*(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+[0-9a-fA-F]+    (.*)$')
+SECTION_ROW = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x[0-9a-fA-F]+\s+(\d+)\s*(.*)$')
+
+
+def size(text):
+    text = text.strip()
+    if text == '-':
+        return None
+    if text[-1:] in 'kK':
+        return int(float(text[:-1]) * 1024)
+    return int(text, 0)
+
+
+def kb(n):
+    return '-' if n is None else ('%dK' % (n // 1024) if n % 1024 == 0 else str(n))
+
+
+def module_name(basename, filename):
+    if filename.endswith('.a'):                 # one line per member: count the library
+        return os.path.splitext(os.path.basename(filename.replace('\\', '/')))[0]
+    name = os.path.basename((filename or basename).replace('\\', '/'))
+    return name[:-2] if name.endswith('.o') else name
+
+
+def parse_map(path):
+    """{module: [text, data, bss]}, [(section, address, bytes)], stack bytes."""
+    modules, sections, stack = {}, [], None
+    table = None
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\r\n')
+            if line.startswith('Microchip PIC32 Memory-Usage Report By Module'):
+                table = 'module'
+            elif line.startswith('RAM Data-Memory Usage'):
+                table = 'ram'
+            elif line.startswith('Dynamic Data-Memory Reservation'):
+                table = 'dynamic'
+            elif line.startswith('Discarded input sections') or line.startswith('Memory Configuration'):
+                table = None
+            elif table == 'module':
+                m = MODULE_ROW.match(line)
+                if m and not m.group(5).startswith('dist/'):        # the image total
+                    rest = m.group(5)
+                    name = module_name(rest[:BASENAME_W].strip(), rest[BASENAME_W:].strip())
+                    row = modules.setdefault(name, [0, 0, 0])
+                    for i in range(3):
+                        row[i] += int(m.group(i + 1))
+            elif table in ('ram', 'dynamic'):
+                m = SECTION_ROW.match(line)
+                if m and table == 'ram':
+                    sections.append((m.group(1), int(m.group(2), 16), int(m.group(3))))
+                elif m and m.group(1) == 'stack':
+                    stack = int(m.group(3))
+    if not modules:
+        sys.exit('membudget: error: %s: no Memory-Usage Report By Module (not an XC32 map?)' % path)
+    return modules, sections, stack
+
+
+def parse_budget(path):
+    """[(pattern, ram, flash)] in file order; the first matching line applies."""
+    rules = []
+    with open(path) as f:
+        for n, line in enumerate(f, 1):
+            words = line.split('#', 1)[0].split()
+            if not words:
+                continue
+            if len(words) != 3:
+                sys.exit('membudget: error: %s:%d: want "module ram flash"' % (path, n))
+            try:
+                rules.append((words[0], size(words[1]), size(words[2])))
+            except ValueError:
+                sys.exit('membudget: error: %s:%d: bad size' % (path, n))
+    return rules
+
+
+def rule_for(rules, name):
+    for pattern, ram, flash in rules:
+        if pattern not in ('total', 'stack') and fnmatch.fnmatchcase(name, pattern):
+            return ram, flash
+    return None, None
+
+
+def check(what, used, limit, out):
+    """0 fits, 1 warning, 2 over; prints the last two."""
+    if limit is None or used * 100 < limit * WARN_PCT:
+        return 0
+    kind = 'error' if used > limit else 'warning'
+    out.append('membudget: %s: %s %d of %d bytes (%d%%)' % (kind, what, used, limit, used * 100 // limit))
+    return 2 if used > limit else 1
+
+
+def suggest(modules, stack):
+    def up(n):
+        return ((n * (100 + HEADROOM_PCT) // 100 + 255) // 256) * 256
+
+    print('# module                    ram       flash')
+    for name in sorted(modules, key=lambda k: -(modules[k][1] + modules[k][2])):
+        text, data, bss = modules[name]
+        if data + bss >= 2048 or text + data >= 8192:
+            print('%-24s %8s %10s' % (name, kb(up(data + bss)), kb(up(text + data))))
+    print('%-24s %8s %10s' % ('*', '2K', '8K'))
+    print('%-24s %8s %10s' % ('stack', kb(max(4096, (stack or 0) // 2 // 1024 * 1024)), '-'))
+    print('%-24s %8s %10s' % ('total', '224K', '488K'))
+
+
+def compare(modules, other, other_path):
+    print('membudget: against %s' % other_path)
+    print('  %-28s %8s %8s %8s %8s' % ('module', 'ram', 'delta', 'flash', 'delta'))
+    rows = []
+    for name in set(modules) | set(other):
+        t, d, b = modules.get(name, (0, 0, 0))
+        ot, od, ob = other.get(name, (0, 0, 0))
+        rows.append((name, d + b, d + b - (od + ob), t + d, t + d - (ot + od)))
+    for row in sorted(rows, key=lambda r: -abs(r[4]) - abs(r[2])):
+        if row[2] or row[4]:
+            print('  %-28s %8d %+8d %8d %+8d' % row)
+    print('  %-28s %8d %+8d %8d %+8d' % ('total', sum(r[1] for r in rows), sum(r[2] for r in rows),
+                                          sum(r[3] for r in rows), sum(r[4] for r in rows)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('map')
+    ap.add_argument('-b', '--budget', default=os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                           'membudget.txt'))
+    ap.add_argument('-v', '--verbose', action='store_true', help='list every module')
+    ap.add_argument('-w', '--warn-only', action='store_true', help='report, never fail')
+    ap.add_argument('-c', '--compare', metavar='MAP', help='per-module difference against MAP')
+    ap.add_argument('--suggest', action='store_true', help='print a budget file for this map')
+    args = ap.parse_args()
+
+    modules, sections, stack = parse_map(args.map)
+    if args.suggest:
+        suggest(modules, stack)
+        return 0
+    if args.compare:
+        compare(modules, parse_map(args.compare)[0], args.compare)
+        return 0
+    rules = parse_budget(args.budget)
+
+    ram_total = sum(d + b for _, d, b in modules.values())
+    flash_total = sum(t + d for t, d, _ in modules.values())
+    named = sorted((s for s in sections if RAM_BASE <= s[1] < RAM_END), key=lambda s: -s[2])
+
+    print('membudget: RAM %d (+ %s stack), flash %d bytes, %d modules'
+          % (ram_total, '?' if stack is None else str(stack), flash_total, len(modules)))
+    for name, addr, n in named[:TOP]:
+        print('  %-28s 0x%08x %8d' % (name, addr, n))
+
+    out, worst = [], 0
+    rows = sorted(modules.items(), key=lambda kv: -(kv[1][1] + kv[1][2]))
+    if args.verbose:
+        print('  %-28s %8s %8s %8s %8s' % ('module', 'ram', 'budget', 'flash', 'budget'))
+    for name, (text, data, bss) in rows:
+        ram, flash = rule_for(rules, name)
+        if args.verbose:
+            print('  %-28s %8d %8s %8d %8s' % (name, data + bss, kb(ram), text + data, kb(flash)))
+        worst = max(worst, check('%s RAM' % name, data + bss, ram, out),
+                    check('%s flash' % name, text + data, flash, out))
+    for pattern, ram, flash in rules:
+        if pattern == 'total':
+            worst = max(worst, check('total RAM', ram_total, ram, out),
+                        check('total flash', flash_total, flash, out))
+        elif pattern == 'stack' and ram is not None and stack is not None and stack < ram:
+            out.append('membudget: error: stack reservation %d bytes, at least %d wanted' % (stack, ram))
+            worst = 2
+    for line in out:
+        print(line)
+    return 1 if worst == 2 and not args.warn_only else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
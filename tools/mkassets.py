@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Pack animations and sound clips into a QSPI flash image for src/assets.c.
+
+Each input is NAME=PATH[:ID], ID being the sound cue id (default 0) for a
+sound clip and free for the others. Files ending in .wav become
+8-bit mono sound clips at SOUND_RATE_HZ, as wav2clip.py makes them
+(with --adpcm, IMA-ADPCM clips as wav2clip.py --adpcm makes them);
+anything starting with the anim.h 'NA' header is an animation, a mkshow.py
+cue stream (its 'CRSH' header) a show script, a mkfxplugin.py image (its
+'CRFX' header) an effect plug-in, the rest is stored raw.
+
+    mkassets.py -o assets.bin creak=creak.wav:0 slam=slam.wav:1 intro=intro.nanim
+
+The image goes at offset 0 of the chip (any QSPI programmer, or
+QFlash_Erase() / QFlash_Program() from a provisioning build). The listing
+ends each entry with its CRC-32, for the CLI's "assets crc" on the prop.
+Only the Python standard library is needed.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from wav2clip import read_mono, resample, adpcm_encode, FMT_ADPCM    # noqa: E402
+
+MAGIC = b'CRAS'
+VERSION = 1
+NAME_LEN = 20
+ALIGN = 4096                    # QFLASH_SECTOR: each asset can be rewritten alone
+RAW, ANIM, SOUND, SHOW, PLUGIN = 0, 1, 2, 3, 4
+
+
+def load(path, normalize, adpcm):
+    """(kind, fmt, data) of one input; fmt is the sound format, 0 for the rest."""
+    if path.lower().endswith('.wav'):
+        x, rate = read_mono(path)
+        x = resample(x, rate)
+        peak = max((abs(v) for v in x), default=0.0)
+        gain = 1.0 if not normalize or peak == 0.0 else 1.0 / peak
+        if adpcm:
+            return SOUND, FMT_ADPCM, adpcm_encode([max(-32768, min(32767, int(round(v * gain * 32767.0))))
+                                                   for v in x])
+        pcm = [max(-128, min(127, int(round(v * gain * 127.0)))) for v in x]
+        return SOUND, 0, struct.pack('<%db' % len(pcm), *pcm)
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:4] == b'CRSH':
+        return SHOW, 0, data
+    if data[:4] == b'CRFX':
+        return PLUGIN, 0, data
+    return (ANIM if data[:2] == b'NA' else RAW), 0, data
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('assets', nargs='+', metavar='NAME=PATH[:ID]')
+    ap.add_argument('-o', '--output', required=True)
+    ap.add_argument('--no-normalize', action='store_true')
+    ap.add_argument('--adpcm', action='store_true', help='sound clips in IMA-ADPCM, half the bytes')
+    args = ap.parse_args()
+
+    entries = []
+    for spec in args.assets:
+        name, _, rest = spec.partition('=')
+        path, _, cid = rest.partition(':')
+        if not name or not path or len(name) > NAME_LEN:
+            sys.exit('%s: want NAME=PATH[:ID], name up to %d characters' % (spec, NAME_LEN))
+        kind, fmt, data = load(path, not args.no_normalize, args.adpcm)
+        entries.append((name, kind, fmt, int(cid) if cid else 0, data))
+
+    table = 8 + 32 * len(entries)
+    off = (table + ALIGN - 1) // ALIGN * ALIGN
+    head = MAGIC + struct.pack('<HH', VERSION, len(entries))
+    body = b''
+    for name, kind, fmt, cid, data in entries:
+        head += struct.pack('<20sBBBBII', name.encode(), kind, cid, fmt, 0, off, len(data))
+        body += data + b'\xff' * (-len(data) % ALIGN)
+        off += len(data) + (-len(data) % ALIGN)
+
+    image = head + b'\xff' * ((table + ALIGN - 1) // ALIGN * ALIGN - table) + body
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    for name, kind, fmt, cid, data in entries:
+        print('%-20s %-5s %3d %7d %08x' % (name, ('raw', 'anim', 'sound', 'show', 'fx')[kind], cid, len(data),
+                                            zlib.crc32(data) & 0xFFFFFFFF))
+    print('%s: %d bytes' % (args.output, len(image)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Turn a linked effect plug-in ELF into a CRFX image (src/plugin_abi.h).
+
+The plug-in is one C file with a plugin_render_fn called fx_render,
+compiled position-independent and linked at the end of the header with
+tools/fxplugin/plugin.ld, keeping its relocations so they can be checked:
+
+    xc32-gcc -mprocessor=ATSAME51J20A -O2 -fpie -ffreestanding -nostdlib \\
+        -Isrc -Wl,-T,tools/fxplugin/plugin.ld -Wl,--emit-relocs \\
+        -o breathe.elf tools/fxplugin/breathe.c
+    mkfxplugin.py breathe.elf breathe.fx --name breathe --animated --speed 2
+
+The image is refused if anything in it needs an absolute address or a
+GOT (a pointer in initialised data, a global reached through the GOT):
+the firmware copies it anywhere in its arena and patches nothing. Put
+the .fx in the QSPI assets (mkassets.py) or on the SD card ("fx load").
+Only the Python standard library is needed.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x58465243              # PLUGIN_MAGIC, "CRFX"
+ABI = 1                         # PLUGIN_ABI
+HEADER_BYTES = 48               # PLUGIN_HEADER_BYTES
+NAME_LEN = 16                   # PLUGIN_NAME_LEN
+F_ANIMATED = 0x0001             # PLUGIN_F_ANIMATED
+HEADER = struct.Struct('<IHH16sIIIIBBHI')
+
+SHT_PROGBITS, SHT_RELA, SHT_NOBITS, SHT_REL = 1, 4, 8, 9
+SHF_ALLOC = 0x2
+EM_ARM = 40
+
+# Relocations that bake in an address or go through a GOT; everything
+# else an -fpie Thumb build leaves behind is PC-relative
+ABSOLUTE = {2: 'R_ARM_ABS32', 5: 'R_ARM_ABS16', 8: 'R_ARM_ABS8',
+            26: 'R_ARM_GOT_BREL', 43: 'R_ARM_MOVW_ABS_NC', 44: 'R_ARM_MOVT_ABS',
+            47: 'R_ARM_THM_MOVW_ABS_NC', 48: 'R_ARM_THM_MOVT_ABS',
+            96: 'R_ARM_GOT_PREL'}
+
+
+def sections(elf):
+    """(name, type, flags, addr, offset, size, info) of every section."""
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        raise SystemExit('mkfxplugin: not a little-endian 32-bit ELF')
+    machine, = struct.unpack_from('<H', elf, 18)
+    if machine != EM_ARM:
+        raise SystemExit('mkfxplugin: not an ARM ELF')
+    shoff, = struct.unpack_from('<I', elf, 32)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 46)
+    raw = [struct.unpack_from('<IIIIIIIIII', elf, shoff + i * shentsize) for i in range(shnum)]
+    strtab = raw[shstrndx][4]
+    out = []
+    for name, typ, flags, addr, off, size, link, info, align, entsize in raw:
+        end = elf.index(b'\0', strtab + name)
+        out.append((elf[strtab + name:end].decode(), typ, flags, addr, off, size, info))
+    return out
+
+
+def build(elf, args):
+    secs = sections(elf)
+    entry, = struct.unpack_from('<I', elf, 24)
+
+    for name, typ, flags, addr, off, size, info in secs:
+        if name.startswith('.got') and size:
+            raise SystemExit('mkfxplugin: %s present, the image needs a GOT' % name)
+        if typ in (SHT_REL, SHT_RELA) and secs[info][2] & SHF_ALLOC:
+            step = 8 if typ == SHT_REL else 12
+            for r in range(off, off + size, step):
+                kind = struct.unpack_from('<I', elf, r + 4)[0] & 0xFF
+                if kind in ABSOLUTE:
+                    where, = struct.unpack_from('<I', elf, r)
+                    raise SystemExit('mkfxplugin: %s at 0x%x in %s, the image must run anywhere'
+                                     % (ABSOLUTE[kind], where, secs[info][0]))
+
+    body = [s for s in secs if s[1] == SHT_PROGBITS and s[2] & SHF_ALLOC and s[5]]
+    bss = [s for s in secs if s[1] == SHT_NOBITS and s[2] & SHF_ALLOC and s[5]]
+    if not body:
+        raise SystemExit('mkfxplugin: no code')
+    if min(s[3] for s in body) < HEADER_BYTES:
+        raise SystemExit('mkfxplugin: not linked after the header (tools/fxplugin/plugin.ld)')
+
+    end = max(s[3] + s[5] for s in body)
+    image = bytearray(end)
+    for name, typ, flags, addr, off, size, info in body:
+        image[addr:addr + size] = elf[off:off + size]
+
+    bss_bytes = 0
+    if bss:
+        start = min(s[3] for s in bss)
+        if start != (end + 7) & ~7:
+            raise SystemExit('mkfxplugin: .bss must follow the image, 8-aligned')
+        bss_bytes = max(s[3] + s[5] for s in bss) - start
+
+    if not HEADER_BYTES <= (entry & ~1) < end or not entry & 1:
+        raise SystemExit('mkfxplugin: entry 0x%x is not Thumb code in the image' % entry)
+
+    name = args.name.encode()
+    if not 0 < len(name) < NAME_LEN:
+        raise SystemExit('mkfxplugin: the name takes 1 to %d characters' % (NAME_LEN - 1))
+    flags = F_ANIMATED if args.animated else 0
+    fields = [MAGIC, ABI, flags, name, end, entry, bss_bytes, args.cycles,
+              args.speed, args.brightness, 0, 0]
+    image[:HEADER_BYTES] = HEADER.pack(*fields)
+    fields[-1] = zlib.crc32(image) & 0xFFFFFFFF
+    image[:HEADER_BYTES] = HEADER.pack(*fields)
+    return bytes(image), bss_bytes
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('elf', help='the linked plug-in')
+    ap.add_argument('out', help='the .fx image to write')
+    ap.add_argument('--name', required=True, help='registry name ("fx NAME" on the console)')
+    ap.add_argument('--animated', action='store_true', help='its output moves with the phase')
+    ap.add_argument('--speed', type=int, default=1, help='default phase advance per frame')
+    ap.add_argument('--brightness', type=int, default=255, help='default brightness')
+    ap.add_argument('--cycles', type=int, default=0,
+                    help='render budget per LED, 0 for the firmware default')
+    args = ap.parse_args()
+    if not (0 <= args.speed <= 255 and 0 <= args.brightness <= 255 and args.cycles >= 0):
+        raise SystemExit('mkfxplugin: speed and brightness are bytes, cycles not negative')
+
+    with open(args.elf, 'rb') as f:
+        image, bss = build(f.read(), args)
+    with open(args.out, 'wb') as f:
+        f.write(image)
+    print('%s: %s, %d bytes and %d of bss' % (args.out, args.name, len(image), bss), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
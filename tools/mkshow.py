@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+"""Compile a show script into the cue stream src/showscript.c plays.
+
+A show script is one timeline for the whole prop: the LEDs, the relays,
+the sound and the auxiliary outputs, each line a cue at a time from the
+start of the show. The compiler sorts the cues by time (lines at the same
+time keep their order) and writes them as fixed 12-byte records, with the
+LED keyframe timelines the script defines after them, so the firmware only
+walks the stream against the show clock.
+
+    # storm.show
+    loop 20                         # repeat every 20 s; without: play once
+    timeline flash                  # keys: time colour [value] [ease]
+      0.00  #000000
+      0.05  #c0c0ff 255 step
+      0.15  #000000
+    end
+    0       select 0 fire 50        # segment, effect, crossfade frames
+    1.5     timeline flash
+    1.5     ioseq storm
+    +0.04   sound 1 200             # +: after the line before
+    2       act lid violent
+    8s      brightness 96
+    9500ms  layer 0 particles add 128
+
+Cues (names of effects and actuator channels are read from showcfg.h):
+
+    act CH PATTERN              quick | drop | violent | pick, or a number
+    sound ID [GAIN]             cue id, gain 256 = as recorded
+    select SEG EFFECT [FRAMES]
+    layer N EFFECT BLEND ALPHA  replace | add | multiply | max
+    alpha N VALUE
+    clear N
+    brightness VALUE
+    timeline NAME
+    ioseq PATTERN               strobe | knock | fog | storm, or a number
+
+Times are seconds, or with an s / ms suffix. Pack the output with
+mkassets.py (it is recognised by its 'CRSH' header) and play it with
+"show NAME" on the console.
+
+    mkshow.py storm.show -o storm.cue
+    mkassets.py -o assets.bin storm=storm.cue thunder=thunder.wav:1
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = b'CRSH'
+VERSION = 1
+HEADER = 16
+CUE = 12
+TIMELINE = 8
+MAX_TIMELINES = 8               # SHOWSCRIPT_TIMELINES
+MAX_US = 0x7FFFFFFF
+
+ACT, SOUND, EFFECT, TIMELINE_CUE, IOSEQ = 1, 2, 3, 4, 5
+FX_SELECT, FX_LAYER, FX_ALPHA, FX_CLEAR, FX_BRIGHTNESS = range(5)
+
+PATTERNS = {'quick': 0, 'drop': 1, 'violent': 2, 'pick': 0xFF}
+IOSEQ_PATTERNS = {'strobe': 0, 'knock': 1, 'fog': 2, 'storm': 3}
+BLENDS = {'replace': 0, 'add': 1, 'multiply': 2, 'max': 3}
+EASES = {'linear': 0, 'ease': 1, 'step': 2}
+
+SHOWCFG = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src', 'showcfg.h')
+
+
+class ScriptError(Exception):
+    pass
+
+
+def showcfg_names(path, macro):
+    """The "name" strings of the rows of an X-macro list, in order."""
+    try:
+        with open(path) as f:
+            text = f.read()
+    except OSError:
+        return {}
+    at = text.find('#define %s(X)' % macro)
+    if at < 0:
+        return {}
+    body = []
+    for line in text[at:].splitlines():
+        body.append(line)
+        if not line.rstrip().endswith('\\'):
+            break
+    rows = re.findall(r'X\(\s*\w+\s*,\s*"([^"]+)"', '\n'.join(body))
+    return {name: i for i, name in enumerate(rows)}
+
+
+def number(word, what, top):
+    try:
+        v = int(word, 0)
+    except ValueError:
+        raise ScriptError('%s: not a number: %s' % (what, word))
+    if not 0 <= v <= top:
+        raise ScriptError('%s: %d is outside 0..%d' % (what, v, top))
+    return v
+
+
+def named(word, names, what, top=255):
+    if word in names:
+        return names[word]
+    if names and not re.match(r'^(0x)?[0-9a-fA-F]+$', word):
+        raise ScriptError('%s: no %s, want one of %s' % (word, what, ', '.join(sorted(names))))
+    return number(word, what, top)
+
+
+def seconds(word):
+    """Microseconds of a time: 1.5, 1.5s, 1500ms."""
+    m = re.match(r'^(\d+(?:\.\d*)?|\.\d+)(ms|s)?$', word)
+    if not m:
+        raise ScriptError('not a time: %s' % word)
+    us = float(m.group(1)) * (1000.0 if m.group(2) == 'ms' else 1000000.0)
+    return int(round(us))
+
+
+def colour(word):
+    m = re.match(r'^#([0-9a-fA-F]{6})$', word)
+    if not m:
+        raise ScriptError('not a colour (#rrggbb): %s' % word)
+    v = int(m.group(1), 16)
+    r, g, b = v >> 16, (v >> 8) & 0xFF, v & 0xFF
+    return r | (g << 8) | (b << 16)                 # pix_t lanes (pixmath.h)
+
+
+def cue(kind, a=0, b=0, c=0, d=0, e=0, w=0):
+    return (kind, a, b, c, d, e, w)
+
+
+def parse_cue(words, tables, timelines):
+    op, args = words[0], words[1:]
+    need = {'act': 2, 'sound': 1, 'select': 2, 'layer': 4, 'alpha': 2, 'clear': 1,
+            'brightness': 1, 'timeline': 1, 'ioseq': 1}
+    if op not in need:
+        raise ScriptError('unknown cue: %s' % op)
+    if len(args) < need[op]:
+        raise ScriptError('%s: wants %d arguments' % (op, need[op]))
+    effects, channels = tables
+    if op == 'act':
+        return cue(ACT, named(args[0], channels, 'channel'), named(args[1], PATTERNS, 'pattern'))
+    if op == 'sound':
+        gain = number(args[1], 'gain', 0xFFFF) if len(args) > 1 else 256
+        return cue(SOUND, number(args[0], 'sound id', 255), w=gain)
+    if op == 'select':
+        frames = number(args[2], 'frames', 0xFFFF) if len(args) > 2 else 0
+        return cue(EFFECT, FX_SELECT, number(args[0], 'segment', 255),
+                   named(args[1], effects, 'effect'), w=frames)
+    if op == 'layer':
+        return cue(EFFECT, FX_LAYER, number(args[0], 'layer', 255), named(args[1], effects, 'effect'),
+                   named(args[2], BLENDS, 'blend'), number(args[3], 'alpha', 255))
+    if op == 'alpha':
+        return cue(EFFECT, FX_ALPHA, number(args[0], 'layer', 255), e=number(args[1], 'alpha', 255))
+    if op == 'clear':
+        return cue(EFFECT, FX_CLEAR, number(args[0], 'layer', 255))
+    if op == 'brightness':
+        return cue(EFFECT, FX_BRIGHTNESS, e=number(args[0], 'brightness', 255))
+    if op == 'timeline':
+        if args[0] not in timelines:
+            raise ScriptError('timeline %s is not defined above' % args[0])
+        return cue(TIMELINE_CUE, timelines[args[0]])
+    return cue(IOSEQ, named(args[0], IOSEQ_PATTERNS, 'ioseq pattern'))
+
+
+def compile_script(lines, tables):
+    cues, tldefs, timelines = [], [], {}
+    loop_us, last, keys = 0, 0, None
+
+    for n, raw in enumerate(lines, 1):
+        words = []
+        for w in raw.split():
+            if w.startswith('#') and not re.match(r'^#[0-9a-fA-F]{6}$', w):
+                break                               # comment; #rrggbb is a colour
+            words.append(w)
+        if not words:
+            continue
+        try:
+            if keys is not None:
+                if words[0] == 'end':
+                    if not keys[2]:
+                        raise ScriptError('timeline %s has no keys' % keys[0])
+                    tldefs.append(keys)
+                    keys = None
+                    continue
+                ms = seconds(words[0]) // 1000
+                if ms > 0xFFFF:
+                    raise ScriptError('key past 65.5 s (timeline.h t_ms)')
+                if keys[2] and ms < keys[2][-1][0]:
+                    raise ScriptError('keys must be in time order')
+                value = number(words[2], 'value', 255) if len(words) > 2 else 0
+                ease = EASES[words[3]] if len(words) > 3 and words[3] in EASES else 0
+                if len(words) > 3 and words[3] not in EASES:
+                    raise ScriptError('ease: want %s' % ', '.join(EASES))
+                keys[2].append((ms, ease, value, colour(words[1])))
+            elif words[0] == 'loop':
+                loop_us = seconds(words[1])
+            elif words[0] == 'timeline':
+                if words[1] in timelines:
+                    raise ScriptError('timeline %s defined twice' % words[1])
+                if len(timelines) == MAX_TIMELINES:
+                    raise ScriptError('more than %d timelines' % MAX_TIMELINES)
+                timelines[words[1]] = len(timelines)
+                keys = (words[1], len(words) > 2 and words[2] == 'loop', [])
+            else:
+                t = last + seconds(words[0][1:]) if words[0].startswith('+') else seconds(words[0])
+                if t > MAX_US:
+                    raise ScriptError('cue past %d s' % (MAX_US // 1000000))
+                cues.append((t, len(cues), parse_cue(words[1:], tables, timelines)))
+                last = t
+        except (ScriptError, IndexError) as e:
+            raise ScriptError('line %d: %s' % (n, e if isinstance(e, ScriptError) else 'missing argument'))
+    if keys is not None:
+        raise ScriptError('timeline %s: no end' % keys[0])
+    if not cues:
+        raise ScriptError('no cues')
+    cues.sort()
+    if loop_us and loop_us <= cues[-1][0]:
+        raise ScriptError('loop %.3f s is not after the last cue' % (loop_us / 1e6))
+    return cues, tldefs, loop_us
+
+
+def build(cues, tldefs, loop_us):
+    head = MAGIC + struct.pack('<HHHHI', VERSION, len(cues), len(tldefs), 0, loop_us)
+    body = b''.join(struct.pack('<IBBBBBBH', t, *c) for t, _, c in cues)
+    off = HEADER + CUE * len(cues) + TIMELINE * len(tldefs)
+    table, blobs = b'', b''
+    for name, loop, keys in tldefs:
+        table += struct.pack('<IHBB', off + len(blobs), len(keys), 1 if loop else 0, 0)
+        blobs += b''.join(struct.pack('<HBBI', *k) for k in keys)
+    return head + body + table + blobs
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('script')
+    ap.add_argument('-o', '--output', required=True)
+    ap.add_argument('--showcfg', default=SHOWCFG, help='effect and channel names (default: src/showcfg.h)')
+    args = ap.parse_args()
+
+    tables = (showcfg_names(args.showcfg, 'SHOW_EFFECTS'), showcfg_names(args.showcfg, 'SHOW_ACTUATORS'))
+    with open(args.script) as f:
+        try:
+            cues, tldefs, loop_us = compile_script(f.read().splitlines(), tables)
+        except ScriptError as e:
+            sys.exit('%s: %s' % (args.script, e))
+    data = build(cues, tldefs, loop_us)
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    kinds = {}
+    for _, _, c in cues:
+        kinds[c[0]] = kinds.get(c[0], 0) + 1
+    print('%s: %d cues (%s), %d timelines, %.3f s%s, %d bytes' % (
+        args.output, len(cues),
+        ', '.join('%d %s' % (kinds[k], ('act', 'sound', 'fx', 'timeline', 'ioseq')[k - 1]) for k in sorted(kinds)),
+        len(tldefs), cues[-1][0] / 1e6, ', loop %.3f s' % (loop_us / 1e6) if loop_us else '', len(data)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Turn an rtos_trace dump (src/rtos_trace.h) into Chrome trace JSON.
+
+Input is either the raw area read by the debugger
+
+    (gdb) dump binary value trace.bin rtos_trace
+
+or a console log holding the output of the CLI "trace" command; lines not
+starting with "trace " are ignored, so a whole session capture will do.
+
+    rtos_trace2json.py trace.bin > trace.json
+    rtos_trace2json.py console.log -o trace.json
+
+Open the result in https://ui.perfetto.dev or chrome://tracing. Task run
+slices are on the "CPU" track, interrupt handlers on "ISR" (exception
+number, IRQ = exception - 16), queue traffic and DMA callbacks are
+instants on "Events". Times are microseconds from the oldest event kept.
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+MAGIC = 0x43525452
+HEADER = struct.Struct("<5I")
+TASK = struct.Struct("<I16s")
+EVENT = struct.Struct("<II")
+
+SWITCH, CREATE, ISR_IN, ISR_OUT, Q_SEND, Q_RECV, Q_FAIL, DMA = range(1, 9)
+INSTANT_NAMES = {Q_SEND: "send", Q_RECV: "receive", Q_FAIL: "send failed"}
+DMA_EVENTS = {0: "none", 1: "complete", 2: "error"}
+
+HEX_LINE = re.compile(r"^trace ([0-9a-f]{5}) ([0-9a-f]*)\s*$")
+
+
+def load(path):
+    data = open(path, "rb").read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+
+    # CLI hex dump: offset + bytes per line, the last dump in the file wins
+    area = bytearray()
+    for line in data.decode("latin-1").splitlines():
+        if line.startswith("trace begin"):
+            area = bytearray()
+            continue
+        m = HEX_LINE.match(line.strip())
+        if m is None:
+            continue
+        off = int(m.group(1), 16)
+        chunk = bytes.fromhex(m.group(2))
+        if len(area) < off:
+            area.extend(b"\0" * (off - len(area)))
+        area[off:off + len(chunk)] = chunk
+    return bytes(area)
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        sys.exit("rtos_trace2json: dump too short")
+    magic, cpu_hz, capacity, head, _enabled = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("rtos_trace2json: no rtos_trace magic, wrong address?")
+
+    ntasks = (len(data) - HEADER.size - capacity * EVENT.size) // TASK.size
+    if ntasks < 0:
+        sys.exit("rtos_trace2json: dump shorter than its capacity says")
+    tasks = {}
+    off = HEADER.size
+    for _ in range(ntasks):
+        tcb, name = TASK.unpack_from(data, off)
+        off += TASK.size
+        if tcb != 0:
+            tasks[tcb] = name.split(b"\0")[0].decode("latin-1")
+
+    # Oldest first: the ring has wrapped once head passed the capacity
+    count = min(head, capacity)
+    first = head - count
+    events = []
+    for i in range(first, head):
+        cycles, word = EVENT.unpack_from(data, off + (i % capacity) * EVENT.size)
+        events.append((cycles, word >> 24, word & 0xFFFFFF))
+    return cpu_hz, tasks, events, head - count
+
+
+def convert(cpu_hz, tasks, events):
+    out = [
+        {"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "rtos_trace"}},
+        {"ph": "M", "pid": 1, "tid": 1, "name": "thread_name", "args": {"name": "CPU"}},
+        {"ph": "M", "pid": 1, "tid": 2, "name": "thread_name", "args": {"name": "ISR"}},
+        {"ph": "M", "pid": 1, "tid": 3, "name": "thread_name", "args": {"name": "Events"}},
+    ]
+    scale = 1e6 / cpu_hz
+    base = events[0][0] if events else 0
+    total = 0
+    last = base
+    running = None          # (name, start_us)
+    isr_open = {}           # exception -> [start_us, ...]
+
+    def task_name(tcb):
+        return tasks.get(tcb, "tcb 0x%06x" % tcb)
+
+    for cycles, kind, arg in events:
+        total += (cycles - last) & 0xFFFFFFFF   # 32-bit CYCCNT unwrapped
+        last = cycles
+        t = total * scale
+
+        if kind == SWITCH:
+            if running is not None and running[0] != task_name(arg):
+                out.append({"ph": "X", "pid": 1, "tid": 1, "name": running[0],
+                            "ts": running[1], "dur": t - running[1]})
+                running = None
+            if running is None:
+                running = (task_name(arg), t)
+        elif kind == CREATE:
+            out.append({"ph": "i", "pid": 1, "tid": 3, "s": "t", "ts": t,
+                        "name": "create " + task_name(arg)})
+        elif kind == ISR_IN:
+            isr_open.setdefault(arg, []).append(t)
+        elif kind == ISR_OUT:
+            starts = isr_open.get(arg)
+            if starts:
+                start = starts.pop()
+                name = "IRQ %d" % (arg - 16) if arg >= 16 else "exception %d" % arg
+                out.append({"ph": "X", "pid": 1, "tid": 2, "name": name,
+                            "ts": start, "dur": t - start})
+        elif kind in INSTANT_NAMES:
+            out.append({"ph": "i", "pid": 1, "tid": 3, "s": "t", "ts": t,
+                        "name": INSTANT_NAMES[kind],
+                        "args": {"queue": "0x%08x" % (0x20000000 + arg)}})
+        elif kind == DMA:
+            ch, ev = arg & 0xFF, arg >> 8
+            out.append({"ph": "i", "pid": 1, "tid": 3, "s": "t", "ts": t,
+                        "name": "DMA ch%d %s" % (ch, DMA_EVENTS.get(ev, str(ev)))})
+
+    if running is not None:
+        t = total * scale
+        out.append({"ph": "X", "pid": 1, "tid": 1, "name": running[0],
+                    "ts": running[1], "dur": t - running[1]})
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("dump", help="raw rtos_trace area or console log with a CLI 'trace' dump")
+    ap.add_argument("-o", "--output", help="JSON file (default stdout)")
+    args = ap.parse_args()
+
+    cpu_hz, tasks, events, lost = parse(load(args.dump))
+    trace = convert(cpu_hz, tasks, events)
+    text = json.dumps({"traceEvents": trace, "displayTimeUnit": "ms"})
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    sys.stderr.write("%d events, %d older ones overwritten, %d tasks\n"
+                     % (len(events), lost, len(tasks)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Decode the telemetry stream written by src/telem.c.
+
+Frames are COBS-encoded between 0x00 bytes (see src/telem.h), each payload
+ending in a CRC-16/CCITT-FALSE. Samples are printed as CSV on stdout, with
+a header line each time the channel names change; task load and lost
+frames go to stderr as '#' comments, so the CSV can be piped to a plotting
+tool as is. Console text and tlog frames in the same stream are skipped.
+
+Captured frames (CLI "capture", USB port only) are noted on stderr; with
+-f they are also appended to a raw rgb24 file, one row of n pixels per
+frame, e.g. for ffmpeg -f rawvideo -pix_fmt rgb24 -video_size <n>x1.
+
+    cat /dev/ttyACM0 | telem_decode.py > show.csv
+    telem_decode.py capture.bin
+    telem_decode.py -f frames.rgb /dev/ttyACM0 > show.csv
+
+Only the Python standard library is needed.
+"""
+
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from tlog_decode import cobs_decode     # noqa: E402
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def names(blob, count):
+    out = blob.split(b"\0")[:count]
+    return [n.decode("latin-1") for n in out]
+
+
+class Decoder:
+    def __init__(self, out, log, frames=None):
+        self.out, self.log, self.frames = out, log, frames
+        self.schema = None
+        self.header = None
+        self.seq = None
+        self.fseq = None
+
+    def frame(self, p):
+        if len(p) < 3 or crc16(p[:-2]) != struct.unpack_from("<H", p, len(p) - 2)[0]:
+            return
+        kind, body = p[0:1], p[1:-2]
+        if kind == b"S" and body:
+            self.schema = names(body[1:], body[0])
+        elif kind in (b"D", b"L") and len(body) >= 6:
+            seq, t = struct.unpack_from("<HI", body)
+            if self.seq is not None and (seq - self.seq - 1) & 0xFFFF:
+                self.log.write("# lost %d frames\n" % ((seq - self.seq - 1) & 0xFFFF))
+            self.seq = seq
+            if kind == b"D":
+                self.sample(t, body[6:])
+            else:
+                self.load(t, body[6:])
+        elif kind == b"F" and len(body) >= 8:
+            self.frame_rgb(body)
+
+    def sample(self, t, body):
+        if not body or len(body) < 1 + 4 * body[0]:
+            return
+        values = struct.unpack_from("<%dI" % body[0], body, 1)
+        cols = self.schema if self.schema and len(self.schema) == len(values) \
+            else ["ch%d" % i for i in range(len(values))]
+        if cols != self.header:
+            self.header = cols
+            self.out.write("time_ms," + ",".join(cols) + "\n")
+        self.out.write("%d,%s\n" % (t, ",".join(str(v) for v in values)))
+        self.out.flush()
+
+    def load(self, t, body):
+        parts, i = [], 0
+        while i + 3 <= len(body):
+            pm, = struct.unpack_from("<H", body, i)
+            end = body.find(b"\0", i + 2)
+            if end < 0:
+                break
+            parts.append("%s %.1f%%" % (body[i + 2:end].decode("latin-1"), pm / 10.0))
+            i = end + 1
+        self.log.write("# load %d ms: %s\n" % (t, ", ".join(parts)))
+        self.log.flush()
+
+
+    def frame_rgb(self, body):
+        seq, t, n = struct.unpack_from("<HIH", body)
+        if len(body) < 8 + 3 * n:
+            return
+        if self.fseq is not None and (seq - self.fseq - 1) & 0xFFFF:
+            self.log.write("# lost %d captured frames\n" % ((seq - self.fseq - 1) & 0xFFFF))
+        self.fseq = seq
+        self.log.write("# frame %d at %d ms, %d pixels\n" % (seq, t, n))
+        if self.frames:
+            self.frames.write(body[8:8 + 3 * n])
+
+
+def main(argv):
+    frames = None
+    if len(argv) > 2 and argv[1] == "-f":
+        frames = open(argv[2], "ab")
+        argv = argv[:1] + argv[3:]
+    if len(argv) > 2:
+        sys.exit(__doc__)
+    src = open(argv[1], "rb") if len(argv) == 2 else sys.stdin.buffer
+    dec = Decoder(sys.stdout, sys.stderr, frames)
+    buf = b""
+    while True:
+        data = src.read1(4096) if hasattr(src, "read1") else src.read(4096)
+        if not data:
+            break
+        buf += data
+        *chunks, buf = buf.split(b"\0")
+        for chunk in chunks:
+            p = cobs_decode(chunk) if chunk else None
+            if p is not None:
+                dec.frame(p)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
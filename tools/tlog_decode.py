@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Decode the tokenized log stream written by src/tlog.c.
+
+The firmware sends each TLOG() record as a COBS frame between 0x00 bytes:
+
+    00 | cobs( id:u32 | time_us:u32 | arg:u32 * n | sum:u8 ) | 00
+
+id is the offset of the record's format string in the .tlog_fmt section of
+the ELF that was flashed. Console text between frames is passed through;
+frames of other binary streams (telem.h) are skipped.
+
+    tlog_decode.py dist/default/production/CR-Proj.production.elf capture.bin
+    cat /dev/ttyACM0 | tlog_decode.py firmware.elf
+
+Only the Python standard library is needed.
+"""
+
+import re
+import struct
+import sys
+
+SECTION = ".tlog_fmt"
+
+# printf conversions understood by the decoder (all arguments are 32-bit words)
+# Console text: anything printable; other chunks are frames of other streams
+TEXT = re.compile(rb"[\t\r\n\x20-\x7e\x80-\xff]*")
+
+CONV = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diuxXcosp%])")
+
+
+def read_section(path, name):
+    """Bytes of section `name` of a 32-bit little-endian ELF."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit("%s: not a 32-bit little-endian ELF" % path)
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def header(i):
+        return struct.unpack_from("<IIIIIIIIII", elf, shoff + i * shentsize)
+
+    strtab = header(shstrndx)
+    for i in range(shnum):
+        sh = header(i)
+        start = strtab[4] + sh[0]
+        if elf[start:elf.index(b"\0", start)].decode() == name:
+            return elf[sh[4]:sh[4] + sh[5]]
+    sys.exit("%s: no %s section (no TLOG() calls linked in?)" % (path, name))
+
+
+def fmt_at(section, off):
+    end = section.find(b"\0", off)
+    if off >= len(section) or end < 0:
+        return None
+    return section[off:end].decode("latin-1")
+
+
+def apply(fmt, args):
+    """printf `fmt` with raw 32-bit words."""
+    it = iter(args)
+
+    def conv(m):
+        flags, width, prec, _, c = m.groups()
+        if c == "%":
+            return "%"
+        v = next(it, None)
+        if v is None:
+            return "<?>"
+        if c in "di":
+            v = v - (1 << 32) if v & 0x80000000 else v
+        elif c == "c":
+            v = chr(v & 0xFF)
+        elif c == "p":
+            flags, c = flags + "#", "x"
+        elif c == "s":
+            return "<str@0x%08x>" % v       # the string itself is not sent
+        spec = "%" + flags + width + ("." + prec if prec else "") + ("d" if c == "u" else c)
+        return spec % v
+
+    return CONV.sub(conv, fmt)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def record(section, chunk):
+    """Decoded line for a frame, or None if chunk is not a valid frame."""
+    p = cobs_decode(chunk)
+    if p is None or len(p) < 9 or (len(p) - 9) % 4 or sum(p) & 0xFF:
+        return None
+    words = struct.unpack("<%dI" % ((len(p) - 1) // 4), p[:-1])
+    fmt = fmt_at(section, words[0])
+    if fmt is None:
+        return None
+    return "%10.6f  %s" % (words[1] / 1e6, apply(fmt, words[2:]))
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.exit(__doc__)
+    section = read_section(argv[1], SECTION)
+    src = open(argv[2], "rb") if len(argv) == 3 else sys.stdin.buffer
+    buf = b""
+    while True:
+        data = src.read1(4096) if hasattr(src, "read1") else src.read(4096)
+        if not data:
+            break
+        buf += data
+        *chunks, buf = buf.split(b"\0")
+        for chunk in chunks:
+            if not chunk:
+                continue
+            line = record(section, chunk)
+            if line is not None:
+                print(line, flush=True)
+            elif TEXT.fullmatch(chunk):
+                sys.stdout.write(chunk.decode("latin-1", "replace"))
+                sys.stdout.flush()
+            # else another binary stream (telem.h) or a damaged frame
+    if buf:
+        sys.stdout.write(buf.decode("latin-1", "replace"))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Convert a WAV file into a sound clip for src/sound.c.
+
+The clip is written as C source: signed 8-bit mono PCM at SOUND_RATE_HZ in
+a const array (so it stays in flash) and a sound_clip_t pointing at it.
+Stereo is mixed down, other rates are resampled linearly, and the peak is
+scaled to full range unless --no-normalize is given.
+
+    wav2clip.py slam.wav slam > ../src/clip_slam.c
+
+then, before Sound_Start():
+
+    extern const sound_clip_t clip_slam;
+    Sound_Register(SOUND_SLAM, &clip_slam);
+
+With --raw the same samples are written as a bare file instead, for the SD
+card (Sound_CueStream(), "sdplay" on the console):
+
+    wav2clip.py --raw THEME.PCM theme.wav theme
+
+With --adpcm the clip is 16-bit sound in 4-bit IMA-ADPCM blocks
+(src/adpcm.h, SOUND_FMT_ADPCM) instead: half the bytes of the 8-bit clip.
+Clips only: streams from the card stay 8-bit PCM.
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import struct
+import sys
+import wave
+
+RATE_HZ = 22050                 # SOUND_RATE_HZ in src/sound.h
+BLOCK_SAMPLES = 256             # ADPCM_BLOCK_SAMPLES in src/adpcm.h
+FMT_ADPCM = 1                   # SOUND_FMT_ADPCM in src/sound.h
+
+STEP = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767]
+INDEX = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def read_mono(path):
+    with wave.open(path, 'rb') as w:
+        ch, width, rate = w.getnchannels(), w.getsampwidth(), w.getframerate()
+        raw = w.readframes(w.getnframes())
+    if width == 1:
+        vals = [b - 128 for b in raw]                       # unsigned 8-bit
+        scale = 128.0
+    elif width == 2:
+        vals = list(struct.unpack('<%dh' % (len(raw) // 2), raw))
+        scale = 32768.0
+    else:
+        sys.exit('%s: %d-bit samples, only 8 and 16 are supported' % (path, 8 * width))
+    frames = [sum(vals[i:i + ch]) / (ch * scale) for i in range(0, len(vals), ch)]
+    return frames, rate
+
+
+def resample(x, rate):
+    if rate == RATE_HZ or not x:
+        return x
+    n = int(len(x) * RATE_HZ / rate)
+    out = []
+    for i in range(n):
+        t = i * rate / RATE_HZ
+        k = int(t)
+        f = t - k
+        b = x[k + 1] if k + 1 < len(x) else x[k]
+        out.append(x[k] * (1.0 - f) + b * f)
+    return out
+
+
+def adpcm_encode(x):
+    """16-bit samples (-32768..32767) to adpcm.h blocks, decoded as Adpcm_Mix() does."""
+    out = bytearray()
+    pred, index = 0, 0
+    for b in range(0, len(x), BLOCK_SAMPLES):
+        out += struct.pack('<hBB', pred, index, 0)
+        nibs = []
+        for s in x[b:b + BLOCK_SAMPLES]:
+            step = STEP[index]
+            d = s - pred
+            m = min(7, (4 * abs(d)) // step)        # (2m + 1) step / 8 is the middle of its range
+            diff = ((2 * m + 1) * step) >> 3
+            pred = max(-32768, min(32767, pred - diff if d < 0 else pred + diff))
+            index = max(0, min(len(STEP) - 1, index + INDEX[m]))
+            nibs.append(m | (8 if d < 0 else 0))
+        if len(nibs) & 1:
+            nibs.append(0)
+        out += bytes(nibs[i] | (nibs[i + 1] << 4) for i in range(0, len(nibs), 2))
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('wav')
+    ap.add_argument('name', help='C name, e.g. slam -> clip_slam')
+    ap.add_argument('--no-normalize', action='store_true')
+    ap.add_argument('--raw', metavar='FILE', help='write the PCM bytes to FILE instead of C')
+    ap.add_argument('--adpcm', action='store_true', help='16-bit IMA-ADPCM clip instead of 8-bit PCM')
+    args = ap.parse_args()
+    if args.raw and args.adpcm:
+        sys.exit('--adpcm is for clips, streams are 8-bit PCM')
+
+    x, rate = read_mono(args.wav)
+    x = resample(x, rate)
+    peak = max((abs(v) for v in x), default=0.0)
+    gain = 1.0 if args.no_normalize or peak == 0.0 else 1.0 / peak
+    name = 'clip_' + args.name
+
+    if args.adpcm:
+        data = adpcm_encode([max(-32768, min(32767, int(round(v * gain * 32767.0)))) for v in x])
+        print('/* %s: %s, %d samples at %d Hz (%.2f s) in %d bytes of IMA-ADPCM, made by tools/wav2clip.py */'
+              % (name, args.wav, len(x), RATE_HZ, len(x) / RATE_HZ, len(data)))
+        print()
+        print('#include "sound.h"')
+        print()
+        print('static const uint8_t %s_adpcm[%d] =' % (name, len(data)))
+        print('{')
+        for i in range(0, len(data), 16):
+            print('    ' + ', '.join('0x%02x' % v for v in data[i:i + 16]) + ',')
+        print('};')
+        print()
+        print('const sound_clip_t %s = { (const int8_t *)%s_adpcm, %du, SOUND_FMT_ADPCM };' % (name, name, len(x)))
+        return
+
+    pcm = [max(-128, min(127, int(round(v * gain * 127.0)))) for v in x]
+
+    if args.raw:
+        with open(args.raw, 'wb') as f:
+            f.write(struct.pack('<%db' % len(pcm), *pcm))
+        return
+
+    print('/* %s: %s, %d samples at %d Hz (%.2f s), made by tools/wav2clip.py */'
+          % (name, args.wav, len(pcm), RATE_HZ, len(pcm) / RATE_HZ))
+    print()
+    print('#include "sound.h"')
+    print()
+    print('static const int8_t %s_pcm[%d] =' % (name, len(pcm)))
+    print('{')
+    for i in range(0, len(pcm), 16):
+        print('    ' + ', '.join('%4d' % v for v in pcm[i:i + 16]) + ',')
+    print('};')
+    print()
+    print('const sound_clip_t %s = { %s_pcm, %du };' % (name, name, len(pcm)))
+
+
+if __name__ == '__main__':
+    main()